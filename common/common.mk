@@ -1,8 +1,12 @@
 CYCLONETCPSRC += $(CYCLONETCP)/cyclone_tcp/common/datetime.c \
 				 $(CYCLONETCP)/cyclone_tcp/common/debug.c \
 				 $(CYCLONETCP)/cyclone_tcp/common/endian.c \
+				 $(CYCLONETCP)/cyclone_tcp/common/mutex_profile.c \
 				 $(CYCLONETCP)/cyclone_tcp/common/os.c \
+				 $(CYCLONETCP)/cyclone_tcp/common/probe.c \
 				 $(CYCLONETCP)/cyclone_tcp/common/resource_manager.c \
-				 $(CYCLONETCP)/cyclone_tcp/common/str.c 
+				 $(CYCLONETCP)/cyclone_tcp/common/str.c \
+				 $(CYCLONETCP)/cyclone_tcp/common/task_registry.c \
+				 $(CYCLONETCP)/cyclone_tcp/common/tlsf.c 
 
 CYCLONETCPINC += $(CYCLONETCP)/cyclone_tcp/common/ 
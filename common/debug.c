@@ -25,6 +25,9 @@
  **/
 
 //Dependencies
+#include <stdarg.h>
+#include <string.h>
+#include <inttypes.h>
 #include "debug.h"
 
 
@@ -53,3 +56,623 @@ void debugDisplayArray(FILE *stream,
          fprintf(stream, "\r\n");
    }
 }
+
+
+#if defined(USE_DEFERRED_TRACE)
+
+//Memory barrier between the record contents and the ring indices
+#if defined(__GNUC__)
+   #define TRACE_MEMORY_BARRIER() __sync_synchronize()
+#else
+   #define TRACE_MEMORY_BARRIER()
+#endif
+
+
+/**
+ * @brief Argument types of conversion specifications
+ **/
+
+typedef enum
+{
+   TRACE_ARG_NONE      = 0,
+   TRACE_ARG_INT       = 1,
+   TRACE_ARG_LONG      = 2,
+   TRACE_ARG_LONG_LONG = 3,
+   TRACE_ARG_SIZE      = 4,
+   TRACE_ARG_POINTER   = 5,
+   TRACE_ARG_DOUBLE    = 6,
+   TRACE_ARG_STRING    = 7
+} DebugTraceArgType;
+
+
+/**
+ * @brief Conversion specification
+ **/
+
+typedef struct
+{
+   size_t length;          ///<Length of the specification, including the '%' sign
+   uint_t stars;           ///<Number of '*' width and precision fields
+   DebugTraceArgType type; ///<Type of the argument
+} DebugTraceSpec;
+
+
+/**
+ * @brief Trace ring buffer
+ *
+ * Each ring has a single producer and a single consumer, so that
+ * no lock is required. The indices run freely and are reduced
+ * modulo the size of the ring
+ *
+ **/
+
+typedef struct
+{
+   OsTask *owner;            ///<Task that writes to the ring
+   volatile uint32_t head;   ///<Write index (modified by the producer)
+   volatile uint32_t tail;   ///<Read index (modified by the consumer)
+   volatile uint32_t lost;   ///<Number of records dropped (modified by the producer)
+   uint32_t reported;        ///<Number of lost records already reported (modified by the consumer)
+   uint8_t data[TRACE_BUFFER_SIZE];
+} DebugTraceRing;
+
+
+//Per-task ring buffers
+static DebugTraceRing debugTraceRing[TRACE_BUFFER_COUNT];
+//Ring shared by the other contexts, serialized by osTaskSuspendAll
+static DebugTraceRing debugTraceSharedRing;
+
+
+/**
+ * @brief Parse a conversion specification
+ * @param[in] p Pointer to the '%' sign
+ * @param[out] spec Description of the conversion specification
+ **/
+
+static void debugTraceParseSpec(const char_t *p, DebugTraceSpec *spec)
+{
+   uint_t n;
+   const char_t *start;
+
+   //Save the beginning of the specification
+   start = p++;
+   //Number of 'l' modifiers
+   n = 0;
+
+   //Initialize the specification
+   spec->stars = 0;
+   spec->type = TRACE_ARG_NONE;
+
+   //Skip flags, width and precision
+   while(*p != '\0' && strchr("-+ #0123456789.*", *p))
+   {
+      //The width or the precision is passed as an argument?
+      if(*p == '*')
+         spec->stars++;
+      p++;
+   }
+
+   //Length modifiers
+   while(*p != '\0' && strchr("hlLqjzt", *p))
+   {
+      if(*p == 'l' || *p == 'q')
+         n++;
+      else if(*p == 'z' || *p == 't' || *p == 'j')
+         spec->type = TRACE_ARG_SIZE;
+      p++;
+   }
+
+   //Conversion specifier
+   switch(*p)
+   {
+   case 'd':
+   case 'i':
+   case 'u':
+   case 'x':
+   case 'X':
+   case 'o':
+   case 'c':
+      //Integer argument
+      if(spec->type != TRACE_ARG_SIZE)
+         spec->type = (n >= 2) ? TRACE_ARG_LONG_LONG : (n == 1) ? TRACE_ARG_LONG : TRACE_ARG_INT;
+      break;
+   case 'p':
+      spec->type = TRACE_ARG_POINTER;
+      break;
+   case 's':
+      spec->type = TRACE_ARG_STRING;
+      break;
+   case 'f':
+   case 'F':
+   case 'e':
+   case 'E':
+   case 'g':
+   case 'G':
+      spec->type = TRACE_ARG_DOUBLE;
+      break;
+   default:
+      //'%%' and unsupported specifiers take no argument
+      spec->type = TRACE_ARG_NONE;
+      spec->stars = 0;
+      break;
+   }
+
+   //Length of the specification
+   spec->length = p - start + (*p != '\0');
+}
+
+
+/**
+ * @brief Retrieve the ring buffer of the calling task
+ * @return Pointer to the ring, or NULL if the shared ring must be used
+ **/
+
+static DebugTraceRing *debugTraceGetRing(void)
+{
+   uint_t i;
+   OsTask *task;
+   DebugTraceRing *ring;
+
+   //Get a handle to the calling task
+   task = osTaskGetHandle();
+   //The underlying RTOS cannot identify the calling task?
+   if(task == OS_INVALID_HANDLE)
+      return NULL;
+
+   //Owners never change once set, so no lock is needed here
+   for(i = 0; i < TRACE_BUFFER_COUNT; i++)
+   {
+      if(debugTraceRing[i].owner == task)
+         return &debugTraceRing[i];
+   }
+
+   //Initialize pointer
+   ring = NULL;
+
+   //Enter critical section
+   osTaskSuspendAll();
+
+   //Attach an unused ring to the calling task
+   for(i = 0; i < TRACE_BUFFER_COUNT; i++)
+   {
+      if(debugTraceRing[i].owner == NULL)
+      {
+         debugTraceRing[i].owner = task;
+         ring = &debugTraceRing[i];
+         break;
+      }
+   }
+
+   //Leave critical section
+   osTaskResumeAll();
+
+   //Return a pointer to the ring, if any
+   return ring;
+}
+
+
+/**
+ * @brief Append a record to a ring buffer
+ * @param[in] ring Pointer to the ring
+ * @param[in] record Pointer to the record
+ * @param[in] length Length of the record
+ **/
+
+static void debugTracePush(DebugTraceRing *ring, const uint8_t *record, size_t length)
+{
+   size_t i;
+   uint32_t head;
+
+   //Read the current write index
+   head = ring->head;
+
+   //Not enough room in the ring?
+   if(TRACE_BUFFER_SIZE - (head - ring->tail) < length)
+   {
+      //The record is lost
+      ring->lost++;
+      return;
+   }
+
+   //Copy the record, wrapping around the end of the ring
+   for(i = 0; i < length; i++)
+      ring->data[(head + i) & (TRACE_BUFFER_SIZE - 1)] = record[i];
+
+   //The record must be complete before it becomes visible
+   TRACE_MEMORY_BARRIER();
+   //Publish the record
+   ring->head = head + length;
+}
+
+
+/**
+ * @brief Record a trace message
+ *
+ * The message is not formatted. The pointer to the format string, which
+ * acts as an identifier, is recorded along with the raw arguments. String
+ * arguments are copied, since they often point to temporary buffers.
+ * Format strings must therefore be string literals
+ *
+ * @param[in] format Format string
+ **/
+
+void debugTraceWrite(const char_t *format, ...)
+{
+   size_t n;
+   size_t length;
+   uint_t i;
+   va_list ap;
+   const char_t *p;
+   const char_t *s;
+   DebugTraceSpec spec;
+   DebugTraceRing *ring;
+   uint8_t record[TRACE_MAX_RECORD_SIZE];
+
+   //Each record starts with its length and the format string
+   length = sizeof(uint16_t);
+   memcpy(record + length, &format, sizeof(format));
+   length += sizeof(format);
+
+   //Retrieve the arguments
+   va_start(ap, format);
+
+   //Parse the format string
+   for(p = format; *p != '\0'; p++)
+   {
+      //Literal character?
+      if(*p != '%')
+         continue;
+
+      //Parse the conversion specification
+      debugTraceParseSpec(p, &spec);
+      p += spec.length - 1;
+
+      //The record is too short to hold the arguments?
+      if(length + spec.stars * sizeof(int) + sizeof(long long) + sizeof(double) > sizeof(record))
+         break;
+
+      //Width and precision arguments
+      for(i = 0; i < spec.stars; i++)
+      {
+         int value = va_arg(ap, int);
+         memcpy(record + length, &value, sizeof(value));
+         length += sizeof(value);
+      }
+
+      //Save the argument
+      if(spec.type == TRACE_ARG_INT)
+      {
+         int value = va_arg(ap, int);
+         memcpy(record + length, &value, sizeof(value));
+         length += sizeof(value);
+      }
+      else if(spec.type == TRACE_ARG_LONG)
+      {
+         long value = va_arg(ap, long);
+         memcpy(record + length, &value, sizeof(value));
+         length += sizeof(value);
+      }
+      else if(spec.type == TRACE_ARG_LONG_LONG)
+      {
+         long long value = va_arg(ap, long long);
+         memcpy(record + length, &value, sizeof(value));
+         length += sizeof(value);
+      }
+      else if(spec.type == TRACE_ARG_SIZE)
+      {
+         size_t value = va_arg(ap, size_t);
+         memcpy(record + length, &value, sizeof(value));
+         length += sizeof(value);
+      }
+      else if(spec.type == TRACE_ARG_POINTER)
+      {
+         void *value = va_arg(ap, void *);
+         memcpy(record + length, &value, sizeof(value));
+         length += sizeof(value);
+      }
+      else if(spec.type == TRACE_ARG_DOUBLE)
+      {
+         double value = va_arg(ap, double);
+         memcpy(record + length, &value, sizeof(value));
+         length += sizeof(value);
+      }
+      else if(spec.type == TRACE_ARG_STRING)
+      {
+         //Copy the string, truncated to fit in the record
+         s = va_arg(ap, const char_t *);
+         n = (s != NULL) ? strlen(s) : 0;
+         n = min(n, TRACE_MAX_STRING_LEN);
+         n = min(n, sizeof(record) - length - 1);
+
+         //The string is preceded by its length
+         record[length++] = (uint8_t) n;
+         memcpy(record + length, s, n);
+         length += n;
+      }
+   }
+
+   //Release the argument list
+   va_end(ap);
+
+   //Arguments that did not fit would be replayed as garbage
+   if(*p != '\0')
+      format = NULL;
+
+   //Save the length of the record
+   record[0] = LSB(length);
+   record[1] = MSB(length);
+
+   //Retrieve the ring of the calling task
+   ring = debugTraceGetRing();
+
+   //Per-task ring?
+   if(ring != NULL)
+   {
+      //Drop the record if it was truncated
+      if(format != NULL)
+         debugTracePush(ring, record, length);
+      else
+         ring->lost++;
+   }
+   else
+   {
+      //Enter critical section
+      osTaskSuspendAll();
+
+      //The shared ring has several producers
+      if(format != NULL)
+         debugTracePush(&debugTraceSharedRing, record, length);
+      else
+         debugTraceSharedRing.lost++;
+
+      //Leave critical section
+      osTaskResumeAll();
+   }
+}
+
+
+/**
+ * @brief Format a record
+ * @param[in] stream Pointer to a FILE object that identifies an output stream
+ * @param[in] record Pointer to the record
+ * @param[in] length Length of the record
+ **/
+
+static void debugTraceReplay(FILE *stream, const uint8_t *record, size_t length)
+{
+   uint_t i;
+   size_t n;
+   int stars[2];
+   const char_t *p;
+   const char_t *format;
+   DebugTraceSpec spec;
+   char_t buffer[TRACE_MAX_STRING_LEN + 1];
+   char_t conversion[32];
+
+   //Retrieve the format string
+   memcpy(&format, record + sizeof(uint16_t), sizeof(format));
+   //Point to the arguments
+   record += sizeof(uint16_t) + sizeof(format);
+
+   //Parse the format string
+   for(p = format; *p != '\0'; p += spec.length)
+   {
+      //Literal characters?
+      if(*p != '%')
+      {
+         //Output the characters up to the next conversion specification
+         n = strcspn(p, "%");
+         fwrite(p, 1, n, stream);
+         spec.length = n;
+         continue;
+      }
+
+      //Parse the conversion specification
+      debugTraceParseSpec(p, &spec);
+
+      //Specification without argument?
+      if(spec.type == TRACE_ARG_NONE)
+      {
+         //Only '%%' produces an output
+         if(!strncmp(p, "%%", 2))
+            fputc('%', stream);
+         continue;
+      }
+
+      //The arguments that follow an unsupported specification cannot be located
+      if(spec.length >= sizeof(conversion) || spec.stars > 2)
+      {
+         fputs("...\r\n", stream);
+         break;
+      }
+
+      //Copy the conversion specification
+      memcpy(conversion, p, spec.length);
+      conversion[spec.length] = '\0';
+
+      //Retrieve width and precision arguments
+      for(i = 0; i < spec.stars; i++)
+      {
+         memcpy(&stars[i], record, sizeof(int));
+         record += sizeof(int);
+      }
+
+//Output the argument using the original conversion specification
+#define TRACE_REPLAY(value) \
+   ((spec.stars == 0) ? fprintf(stream, conversion, value) : \
+   (spec.stars == 1) ? fprintf(stream, conversion, stars[0], value) : \
+   fprintf(stream, conversion, stars[0], stars[1], value))
+
+      if(spec.type == TRACE_ARG_INT)
+      {
+         int value;
+         memcpy(&value, record, sizeof(value));
+         record += sizeof(value);
+         TRACE_REPLAY(value);
+      }
+      else if(spec.type == TRACE_ARG_LONG)
+      {
+         long value;
+         memcpy(&value, record, sizeof(value));
+         record += sizeof(value);
+         TRACE_REPLAY(value);
+      }
+      else if(spec.type == TRACE_ARG_LONG_LONG)
+      {
+         long long value;
+         memcpy(&value, record, sizeof(value));
+         record += sizeof(value);
+         TRACE_REPLAY(value);
+      }
+      else if(spec.type == TRACE_ARG_SIZE)
+      {
+         size_t value;
+         memcpy(&value, record, sizeof(value));
+         record += sizeof(value);
+         TRACE_REPLAY(value);
+      }
+      else if(spec.type == TRACE_ARG_POINTER)
+      {
+         void *value;
+         memcpy(&value, record, sizeof(value));
+         record += sizeof(value);
+         TRACE_REPLAY(value);
+      }
+      else if(spec.type == TRACE_ARG_DOUBLE)
+      {
+         double value;
+         memcpy(&value, record, sizeof(value));
+         record += sizeof(value);
+         TRACE_REPLAY(value);
+      }
+      else
+      {
+         //Retrieve the copy of the string
+         n = *(record++);
+         memcpy(buffer, record, n);
+         buffer[n] = '\0';
+         record += n;
+         TRACE_REPLAY(buffer);
+      }
+
+#undef TRACE_REPLAY
+   }
+}
+
+
+/**
+ * @brief Output the records of a ring buffer
+ * @param[in] stream Pointer to a FILE object that identifies an output stream
+ * @param[in] ring Pointer to the ring
+ **/
+
+static void debugTraceDrain(FILE *stream, DebugTraceRing *ring)
+{
+   size_t i;
+   size_t length;
+   uint32_t lost;
+   uint32_t tail;
+   uint8_t record[TRACE_MAX_RECORD_SIZE];
+
+   //Process the pending records
+   while(ring->tail != ring->head)
+   {
+      //The record must be read after its publication
+      TRACE_MEMORY_BARRIER();
+
+      //Read the current read index
+      tail = ring->tail;
+
+      //Retrieve the length of the record
+      length = ring->data[tail & (TRACE_BUFFER_SIZE - 1)];
+      length |= ring->data[(tail + 1) & (TRACE_BUFFER_SIZE - 1)] << 8;
+
+      //Copy the record, wrapping around the end of the ring
+      for(i = 0; i < length; i++)
+         record[i] = ring->data[(tail + i) & (TRACE_BUFFER_SIZE - 1)];
+
+      //Free the room used by the record
+      TRACE_MEMORY_BARRIER();
+      ring->tail = tail + length;
+
+      //Format the record
+      debugTraceReplay(stream, record, length);
+   }
+
+   //Number of records lost since the last report
+   lost = ring->lost - ring->reported;
+
+   //Any record lost?
+   if(lost != 0)
+   {
+      //Each counter has a single writer
+      ring->reported += lost;
+      //Report the number of lost records
+      fprintf(stream, "[%" PRIu32 " trace records lost]\r\n", lost);
+   }
+}
+
+
+/**
+ * @brief Output the pending trace records
+ *
+ * This function is called periodically by the trace task. It may
+ * also be called from a debugger or the main loop of a bare-metal
+ * application. Only one caller may drain the rings at a time
+ *
+ * @param[in] stream Pointer to a FILE object that identifies an output stream
+ **/
+
+void debugTraceFlush(FILE *stream)
+{
+   uint_t i;
+
+   //Drain the per-task rings
+   for(i = 0; i < TRACE_BUFFER_COUNT; i++)
+      debugTraceDrain(stream, &debugTraceRing[i]);
+
+   //Drain the shared ring
+   debugTraceDrain(stream, &debugTraceSharedRing);
+}
+
+
+/**
+ * @brief Start the trace task
+ * @return Error code
+ **/
+
+error_t debugTraceStart(void)
+{
+   OsTask *task;
+
+   //Create a low priority task that outputs the trace records
+   task = osTaskCreate("Trace", debugTraceTask,
+      NULL, TRACE_STACK_SIZE, TRACE_PRIORITY);
+
+   //Unable to create the task?
+   if(task == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Trace task
+ * @param[in] param Unused parameter
+ **/
+
+void debugTraceTask(void *param)
+{
+   //Main loop
+   while(1)
+   {
+      //Output the pending records
+      debugTraceFlush(stderr);
+      //Wait for new records to accumulate
+      osDelay(TRACE_FLUSH_INTERVAL);
+   }
+}
+
+#endif
@@ -30,6 +30,7 @@
 //Dependencies
 #include <stdio.h>
 #include "os.h"
+#include "error.h"
 
 //Trace level definitions
 #define TRACE_LEVEL_NO_TRACE 0
@@ -44,27 +45,83 @@
    #define TRACE_LEVEL TRACE_LEVEL_DEBUG
 #endif
 
+//Size of each trace ring buffer (must be a power of two)
+#ifndef TRACE_BUFFER_SIZE
+   #define TRACE_BUFFER_SIZE 1024
+#elif ((TRACE_BUFFER_SIZE & (TRACE_BUFFER_SIZE - 1)) != 0)
+   #error TRACE_BUFFER_SIZE parameter is invalid
+#endif
+
+//Number of per-task trace ring buffers
+#ifndef TRACE_BUFFER_COUNT
+   #define TRACE_BUFFER_COUNT 4
+#elif (TRACE_BUFFER_COUNT < 0)
+   #error TRACE_BUFFER_COUNT parameter is invalid
+#endif
+
+//Maximum size of a trace record
+#ifndef TRACE_MAX_RECORD_SIZE
+   #define TRACE_MAX_RECORD_SIZE 128
+#elif (TRACE_MAX_RECORD_SIZE < 32 || TRACE_MAX_RECORD_SIZE > TRACE_BUFFER_SIZE)
+   #error TRACE_MAX_RECORD_SIZE parameter is invalid
+#endif
+
+//Maximum number of characters recorded for a string argument
+#ifndef TRACE_MAX_STRING_LEN
+   #define TRACE_MAX_STRING_LEN 40
+#elif (TRACE_MAX_STRING_LEN < 1 || TRACE_MAX_STRING_LEN > 255)
+   #error TRACE_MAX_STRING_LEN parameter is invalid
+#endif
+
+//Interval between two flushes of the trace task
+#ifndef TRACE_FLUSH_INTERVAL
+   #define TRACE_FLUSH_INTERVAL 100
+#elif (TRACE_FLUSH_INTERVAL < 1)
+   #error TRACE_FLUSH_INTERVAL parameter is invalid
+#endif
+
+//Stack size required to run the trace task
+#ifndef TRACE_STACK_SIZE
+   #define TRACE_STACK_SIZE 400
+#elif (TRACE_STACK_SIZE < 1)
+   #error TRACE_STACK_SIZE parameter is invalid
+#endif
+
+//Priority at which the trace task should run
+#ifndef TRACE_PRIORITY
+   #define TRACE_PRIORITY 0
+#elif (TRACE_PRIORITY < 0)
+   #error TRACE_PRIORITY parameter is invalid
+#endif
+
+//Deferred tracing?
+#if defined(USE_DEFERRED_TRACE)
+   #define TRACE_PRINTF(...) debugTraceWrite(__VA_ARGS__)
+#else
+   #define TRACE_PRINTF(...) osTaskSuspendAll(), fprintf(stderr, __VA_ARGS__), osTaskResumeAll()
+#endif
+
 //Debugging macros
 #if (TRACE_LEVEL >= TRACE_LEVEL_FATAL)
-   #define TRACE_FATAL(...) osTaskSuspendAll(), fprintf(stderr, __VA_ARGS__), osTaskResumeAll()
+   #define TRACE_FATAL(...) TRACE_PRINTF(__VA_ARGS__)
 #else
    #define TRACE_FATAL(...)
 #endif
 
 #if (TRACE_LEVEL >= TRACE_LEVEL_ERROR)
-   #define TRACE_ERROR(...) osTaskSuspendAll(), fprintf(stderr, __VA_ARGS__), osTaskResumeAll()
+   #define TRACE_ERROR(...) TRACE_PRINTF(__VA_ARGS__)
 #else
    #define TRACE_ERROR(...)
 #endif
 
 #if (TRACE_LEVEL >= TRACE_LEVEL_WARNING)
-   #define TRACE_WARNING(...) osTaskSuspendAll(), fprintf(stderr, __VA_ARGS__), osTaskResumeAll()
+   #define TRACE_WARNING(...) TRACE_PRINTF(__VA_ARGS__)
 #else
    #define TRACE_WARNING(...)
 #endif
 
 #if (TRACE_LEVEL >= TRACE_LEVEL_INFO)
-   #define TRACE_INFO(...) osTaskSuspendAll(), fprintf(stderr, __VA_ARGS__), osTaskResumeAll()
+   #define TRACE_INFO(...) TRACE_PRINTF(__VA_ARGS__)
    #define TRACE_INFO_ARRAY(p, a, n) osTaskSuspendAll(), debugDisplayArray(stderr, p, a, n), osTaskResumeAll()
    #define TRACE_INFO_CHUNKED_BUFFER(p, b, o, n)
    #define TRACE_INFO_MPI(p, a) osTaskSuspendAll(), mpiDump(stderr, p, a), osTaskResumeAll()
@@ -76,7 +133,7 @@
 #endif
 
 #if (TRACE_LEVEL >= TRACE_LEVEL_DEBUG)
-   #define TRACE_DEBUG(...) osTaskSuspendAll(), fprintf(stderr, __VA_ARGS__), osTaskResumeAll()
+   #define TRACE_DEBUG(...) TRACE_PRINTF(__VA_ARGS__)
    #define TRACE_DEBUG_ARRAY(p, a, n) osTaskSuspendAll(), debugDisplayArray(stderr, p, a, n), osTaskResumeAll()
    #define TRACE_DEBUG_CHUNKED_BUFFER(p, b, o, n)
    #define TRACE_DEBUG_MPI(p, a) osTaskSuspendAll(), mpiDump(stderr, p, a), osTaskResumeAll()
@@ -93,4 +150,11 @@ void debugInit(uint32_t baudrate);
 void debugDisplayArray(FILE *stream,
    const char_t *prepend, const void *data, size_t length);
 
+#if defined(USE_DEFERRED_TRACE)
+void debugTraceWrite(const char_t *format, ...);
+void debugTraceFlush(FILE *stream);
+error_t debugTraceStart(void);
+void debugTraceTask(void *param);
+#endif
+
 #endif
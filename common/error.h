@@ -114,6 +114,8 @@ typedef enum
    ERROR_NOT_FOUND,
 
    ERROR_NO_RUNNING,
+   ERROR_INVALID_PACKET,
+   ERROR_BUFFER_EMPTY,
 
    ERROR_INVALID_FILE = 300,
    ERROR_FILE_NOT_FOUND,
@@ -177,6 +179,7 @@ typedef enum
    ERROR_NOT_CONFIGURED,
    ERROR_NAME_RESOLUTION_FAILED,
    ERROR_NO_ROUTE,
+   ERROR_DUPLICATE_ADDRESS,
 
    ERROR_WRITE_FAILED,
    ERROR_READ_FAILED,
@@ -0,0 +1,243 @@
+/**
+ * @file mutex_profile.c
+ * @brief Lock contention profiling
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The RTOS ports call these functions from osMutexAcquire and
+ * osMutexRelease when USE_MUTEX_PROFILING is defined. Durations are
+ * measured with the cycle counter used by the instrumentation probes.
+ * The statistics of a mutex are only updated by the task holding it,
+ * so recording them takes no extra lock
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Dependencies
+#include <string.h>
+#include <inttypes.h>
+#include "os.h"
+#include "mutex_profile.h"
+#include "probe.h"
+#include "debug.h"
+
+//List of profiled mutexes
+static MutexProfile *mutexProfileList = NULL;
+
+
+/**
+ * @brief Start profiling a mutex
+ * @param[in] profile Statistics attached to the mutex
+ * @param[in] name Name of the mutex (NULL for an anonymous mutex)
+ **/
+
+void mutexProfileRegister(MutexProfile *profile, const char_t *name)
+{
+   //Clear statistics
+   memset(profile, 0, sizeof(MutexProfile));
+   //Save the name of the mutex
+   profile->name = (name != NULL) ? name : "Unnamed";
+
+   //Enter critical section
+   osTaskSuspendAll();
+   //Add the mutex to the list
+   profile->next = mutexProfileList;
+   mutexProfileList = profile;
+   //Leave critical section
+   osTaskResumeAll();
+}
+
+
+/**
+ * @brief Stop profiling a mutex
+ * @param[in] profile Statistics attached to the mutex
+ **/
+
+void mutexProfileUnregister(MutexProfile *profile)
+{
+   MutexProfile **p;
+
+   //Enter critical section
+   osTaskSuspendAll();
+
+   //Remove the mutex from the list
+   for(p = &mutexProfileList; *p != NULL; p = &(*p)->next)
+   {
+      if(*p == profile)
+      {
+         *p = profile->next;
+         break;
+      }
+   }
+
+   //Leave critical section
+   osTaskResumeAll();
+}
+
+
+/**
+ * @brief Record an acquisition
+ *
+ * This function is called by the task that has just obtained the mutex
+ *
+ * @param[in] profile Statistics attached to the mutex
+ * @param[in] requestTime Timestamp of the acquisition request
+ * @param[in] contended TRUE if the mutex was owned by another task
+ **/
+
+void mutexProfileAcquired(MutexProfile *profile, uint32_t requestTime, bool_t contended)
+{
+   uint32_t wait;
+
+   //Save the beginning of the hold period
+   profile->acquireTime = PROBE_GET_CYCLES();
+   //Time spent waiting for the mutex
+   wait = profile->acquireTime - requestTime;
+
+   //Update statistics
+   profile->acquisitions++;
+   profile->totalWaitCycles += wait;
+
+   //The mutex was not immediately available?
+   if(contended)
+      profile->contentions++;
+
+   //Keep track of the longest wait
+   if(wait > profile->maxWaitCycles)
+      profile->maxWaitCycles = wait;
+}
+
+
+/**
+ * @brief Record a release
+ *
+ * This function is called by the owner, right before releasing the mutex
+ *
+ * @param[in] profile Statistics attached to the mutex
+ **/
+
+void mutexProfileReleased(MutexProfile *profile)
+{
+   uint32_t hold;
+
+   //Time the mutex has been held
+   hold = PROBE_GET_CYCLES() - profile->acquireTime;
+
+   //Update statistics
+   profile->totalHoldCycles += hold;
+
+   //Keep track of the longest hold
+   if(hold > profile->maxHoldCycles)
+      profile->maxHoldCycles = hold;
+}
+
+
+/**
+ * @brief Retrieve the statistics of the profiled mutexes
+ *
+ * The statistics are copied without owning the mutexes, so the counters
+ * of a given mutex may be slightly out of step with each other
+ *
+ * @param[out] stats Array where to copy the statistics
+ * @param[in] maxCount Size of the array
+ * @return Number of entries copied
+ **/
+
+uint_t mutexProfileGetStats(MutexProfile *stats, uint_t maxCount)
+{
+   uint_t n;
+   MutexProfile *p;
+
+   //Enter critical section
+   osTaskSuspendAll();
+
+   //Copy the statistics of each mutex
+   for(n = 0, p = mutexProfileList; p != NULL && n < maxCount; p = p->next, n++)
+   {
+      stats[n] = *p;
+      stats[n].next = NULL;
+   }
+
+   //Leave critical section
+   osTaskResumeAll();
+
+   //Return the number of entries
+   return n;
+}
+
+
+/**
+ * @brief Clear the statistics of all the profiled mutexes
+ **/
+
+void mutexProfileReset(void)
+{
+   MutexProfile *p;
+
+   //Enter critical section
+   osTaskSuspendAll();
+
+   //Loop through the profiled mutexes
+   for(p = mutexProfileList; p != NULL; p = p->next)
+   {
+      p->acquisitions = 0;
+      p->contentions = 0;
+      p->totalWaitCycles = 0;
+      p->maxWaitCycles = 0;
+      p->totalHoldCycles = 0;
+      p->maxHoldCycles = 0;
+   }
+
+   //Leave critical section
+   osTaskResumeAll();
+}
+
+
+/**
+ * @brief Display the statistics of the profiled mutexes
+ **/
+
+void mutexProfileDump(void)
+{
+   uint_t i;
+   uint_t n;
+   MutexProfile stats[16];
+
+   //Take a snapshot of the statistics
+   n = mutexProfileGetStats(stats, arraysize(stats));
+
+   //Debug message
+   TRACE_INFO("%-24s %10s %10s %12s %10s %12s %10s\r\n", "Mutex", "Acquired",
+      "Contended", "Avg wait", "Max wait", "Avg hold", "Max hold");
+
+   //Loop through the profiled mutexes
+   for(i = 0; i < n; i++)
+   {
+      //Display the statistics of the current mutex
+      TRACE_INFO("%-24s %10" PRIu32 " %10" PRIu32 " %12" PRIu32 " %10" PRIu32 " %12" PRIu32 " %10" PRIu32 "\r\n",
+         stats[i].name, stats[i].acquisitions, stats[i].contentions,
+         stats[i].acquisitions ? (uint32_t) (stats[i].totalWaitCycles / stats[i].acquisitions) : 0,
+         stats[i].maxWaitCycles,
+         stats[i].acquisitions ? (uint32_t) (stats[i].totalHoldCycles / stats[i].acquisitions) : 0,
+         stats[i].maxHoldCycles);
+   }
+}
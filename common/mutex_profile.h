@@ -0,0 +1,63 @@
+/**
+ * @file mutex_profile.h
+ * @brief Lock contention profiling
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _MUTEX_PROFILE_H
+#define _MUTEX_PROFILE_H
+
+//Dependencies
+#include "os.h"
+
+
+/**
+ * @brief Statistics collected for a mutex
+ **/
+
+typedef struct _MutexProfile
+{
+   struct _MutexProfile *next; ///<Next profiled mutex
+   const char_t *name;         ///<Name given at creation
+   uint32_t acquisitions;      ///<Number of acquisitions
+   uint32_t contentions;       ///<Number of acquisitions that had to wait
+   uint64_t totalWaitCycles;   ///<Cumulated time spent waiting for the mutex
+   uint32_t maxWaitCycles;     ///<Longest wait
+   uint64_t totalHoldCycles;   ///<Cumulated time the mutex has been held
+   uint32_t maxHoldCycles;     ///<Longest hold
+   uint32_t acquireTime;       ///<Timestamp of the current acquisition
+} MutexProfile;
+
+
+//Lock contention profiling related functions
+void mutexProfileRegister(MutexProfile *profile, const char_t *name);
+void mutexProfileUnregister(MutexProfile *profile);
+
+void mutexProfileAcquired(MutexProfile *profile, uint32_t requestTime, bool_t contended);
+void mutexProfileReleased(MutexProfile *profile);
+
+uint_t mutexProfileGetStats(MutexProfile *stats, uint_t maxCount);
+void mutexProfileReset(void);
+void mutexProfileDump(void);
+
+#endif
@@ -78,7 +78,10 @@ typedef signed int int_t;
 typedef unsigned int uint_t;
 typedef int bool_t;
 
-#ifndef _WIN32
+#if defined(USE_POSIX)
+   #include <time.h>
+   #include <unistd.h>
+#elif !defined(_WIN32)
    typedef unsigned long time_t;
 #endif
 
@@ -119,6 +122,7 @@ void osTaskSwitchFromIrq(void);
 
 //Event specific functions
 OsEvent *osEventCreate(bool_t manualReset, bool_t initialState);
+OsEvent *osEventCreateSingleWaiter(bool_t initialState);
 void osEventClose(OsEvent *event);
 void osEventSet(OsEvent *event);
 void osEventReset(OsEvent *event);
@@ -133,6 +137,7 @@ void osSemaphoreRelease(OsSemaphore *semaphore);
 
 //Mutex specific functions
 OsMutex *osMutexCreate(bool_t initialOwner);
+OsMutex *osMutexCreateNamed(bool_t initialOwner, const char_t *name);
 void osMutexClose(OsMutex *mutex);
 void osMutexAcquire(OsMutex *mutex);
 void osMutexRelease(OsMutex *mutex);
@@ -159,6 +164,8 @@ void osMemFree(void *p);
 //Atomic operations
 uint16_t osAtomicInc16(uint16_t *n);
 uint32_t osAtomicInc32(uint32_t *n);
+uint32_t osAtomicDec32(uint32_t *n);
+uint32_t osAtomicAdd32(uint32_t *n, uint32_t value);
 
 //Time related functions
 void osDelay(time_t delay);
@@ -166,8 +173,12 @@ time_t osGetTickCount(void);
 time_t osGetTime(void);
 
 const char_t *timeFormat(time_t time);
+
+//The C library provides these functions on POSIX systems
+#if !defined(USE_POSIX)
 void usleep(uint_t delay);
 void sleep(uint_t delay);
+#endif
 
 
 //#define osWaitForEvent2(event, timeout) xQueuePeek(event, NULL, timeout)
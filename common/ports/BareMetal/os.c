@@ -0,0 +1,866 @@
+/**
+ * @file os.c
+ * @brief RTOS abstraction layer (bare-metal port)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * This port runs the TCP/IP stack without any RTOS. The application
+ * calls tcpIpStackPoll from its main loop, mutexes do nothing and events
+ * are plain flags that may be set from interrupt service routines
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Dependencies
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "os.h"
+#include "debug.h"
+
+//TLSF allocator?
+#if defined(USE_TLSF)
+   #include "error.h"
+   #include "tlsf.h"
+#endif
+
+
+/**
+ * @brief Event object
+ **/
+
+typedef struct
+{
+   volatile bool_t signaled;
+   bool_t manualReset;
+} OsBareMetalEvent;
+
+
+/**
+ * @brief Semaphore object
+ **/
+
+typedef struct
+{
+   volatile uint_t count;
+   uint_t maxCount;
+} OsBareMetalSemaphore;
+
+
+/**
+ * @brief Queue object
+ **/
+
+typedef struct
+{
+   uint_t length;
+   size_t itemSize;
+   volatile uint_t readIndex;
+   volatile uint_t count;
+   uint8_t buffer[];
+} OsBareMetalQueue;
+
+
+//Number of milliseconds elapsed since startup
+static volatile time_t osTickCount = 0;
+//Dummy object used as mutex handle
+static uint8_t osBareMetalMutex;
+
+
+/**
+ * @brief Start OS scheduler
+ *
+ * There is no scheduler. The application runs its superloop instead
+ *
+ **/
+
+void osStart(void)
+{
+}
+
+
+/**
+ * @brief Create a new task
+ *
+ * Tasks are not supported without an RTOS
+ *
+ * @param[in] name A brief description of the task
+ * @param[in] taskCode Pointer to the task entry function
+ * @param[in] params A pointer to a variable to be passed to the task
+ * @param[in] stackSize The initial size of the stack, in words
+ * @param[in] priority The priority at which the task should run
+ * @return OS_INVALID_HANDLE
+ **/
+
+OsTask *osTaskCreate(const char_t *name, TaskCode taskCode,
+   void *params, size_t stackSize, uint_t priority)
+{
+   //The task cannot be created
+   return OS_INVALID_HANDLE;
+}
+
+
+/**
+ * @brief Delete a task
+ * @param[in] task A handle to the task to be deleted
+ **/
+
+void osTaskDelete(OsTask *task)
+{
+}
+
+
+/**
+ * @brief Get current task handle
+ * @return NULL since there is a single thread of execution
+ **/
+
+OsTask *osTaskGetHandle(void)
+{
+   return NULL;
+}
+
+
+/**
+ * @brief Suspend scheduler activity
+ *
+ * Interrupt service routines are the only concurrent contexts,
+ * so they are masked while the critical section is held
+ *
+ **/
+
+void osTaskSuspendAll(void)
+{
+   //Mask interrupts
+   OS_DISABLE_IRQ();
+}
+
+
+/**
+ * @brief Resume scheduler activity
+ **/
+
+void osTaskResumeAll(void)
+{
+   //Unmask interrupts
+   OS_ENABLE_IRQ();
+}
+
+
+/**
+ * @brief Force a context switch
+ **/
+
+void osTaskSwitch(void)
+{
+}
+
+
+/**
+ * @brief Request a context switch from an interrupt service routine
+ **/
+
+void osTaskSwitchFromIrq(void)
+{
+}
+
+
+/**
+ * @brief Create a event object
+ * @param[in] manualReset If this parameter is TRUE, the function creates a
+ *   manual-reset event object.  If this parameter is FALSE, the function
+ *   creates an auto-reset event object
+ * @param[in] initialState If this parameter is TRUE, the initial state of the
+ *   event object is signaled. Otherwise, it is nonsignaled
+ * @return If the function succeeds, the return value is a handle to the newly
+ *   created event object. If the function fails, the return value is NULL
+ **/
+
+OsEvent *osEventCreate(bool_t manualReset, bool_t initialState)
+{
+   OsBareMetalEvent *event;
+
+   //Allocate a new event object
+   event = osMemAlloc(sizeof(OsBareMetalEvent));
+   //Failed to allocate memory?
+   if(!event) return NULL;
+
+   //Initialize the event object
+   event->signaled = initialState;
+   event->manualReset = manualReset;
+
+   //Return a handle to the newly created event object
+   return (OsEvent *) event;
+}
+
+
+/**
+ * @brief Create an auto-reset event object with a single waiting task
+ * @param[in] initialState If this parameter is TRUE, the initial state of the
+ *   event object is signaled. Otherwise, it is nonsignaled
+ * @return If the function succeeds, the return value is a handle to the newly
+ *   created event object. If the function fails, the return value is NULL
+ **/
+
+OsEvent *osEventCreateSingleWaiter(bool_t initialState)
+{
+   //All events are simple flags
+   return osEventCreate(FALSE, initialState);
+}
+
+
+/**
+ * @brief Close an event object
+ **/
+
+void osEventClose(OsEvent *event)
+{
+   //Release the event object
+   osMemFree(event);
+}
+
+
+/**
+ * @brief Set the specified event object to the signaled state
+ * @param[in] event A handle to the event object
+ **/
+
+void osEventSet(OsEvent *event)
+{
+   //Set the specified event to the signaled state
+   ((OsBareMetalEvent *) event)->signaled = TRUE;
+}
+
+
+/**
+ * @brief Set the specified event object to the nonsignaled state
+ * @param[in] event A handle to the event object
+ **/
+
+void osEventReset(OsEvent *event)
+{
+   //Force the specified event to the nonsignaled state
+   ((OsBareMetalEvent *) event)->signaled = FALSE;
+}
+
+
+/**
+ * @brief Waits until the specified event is in the signaled state
+ *
+ * Nothing else runs while this function spins, except interrupt service
+ * routines. Events that are set by the TCP/IP stack itself should thus be
+ * polled with a zero time-out
+ *
+ * @param[in] event A handle to the event object
+ * @param[in] timeout The time-out interval, in milliseconds. If a nonzero value
+ *   is specified, the function waits until the object is signaled or the
+ *   interval elapses. If this parameter is zero, the function always returns
+ *   immediately. If this parameter is INFINITE_DELAY, the function will return
+ *   only when the object is signaled
+ * @return TRUE if the state of the specified object is signaled, FALSE if the
+ *   time-out interval elapsed, and the object's state is nonsignaled
+ **/
+
+bool_t osEventWait(OsEvent *event, time_t timeout)
+{
+   time_t startTime;
+   OsBareMetalEvent *desc = (OsBareMetalEvent *) event;
+
+   //Save current time
+   startTime = osGetTickCount();
+
+   //Wait until the event is signaled or the time-out interval elapses
+   while(!desc->signaled)
+   {
+      //Time-out interval elapsed?
+      if(timeout != INFINITE_DELAY && (osGetTickCount() - startTime) >= timeout)
+         return FALSE;
+   }
+
+   //Auto-reset event?
+   if(!desc->manualReset)
+      desc->signaled = FALSE;
+
+   //The event was signaled
+   return TRUE;
+}
+
+
+/**
+ * @brief Set an event object to the signaled state from an IRQ routine
+ * @param[in] event A handle to the event object
+ * @return FALSE since no task can be woken
+ **/
+
+bool_t osEventSetFromIrq(OsEvent *event)
+{
+   //Set the specified event to the signaled state
+   ((OsBareMetalEvent *) event)->signaled = TRUE;
+   //No context switch is required
+   return FALSE;
+}
+
+
+/**
+ * @brief Create a semaphore object
+ * @param[in] maxCount The maximum count for the semaphore object. This value
+ *   must be greater than zero
+ * @param[in] initialCount The initial count for the semaphore object
+ * @return If the function succeeds, the return value is a handle to the newly
+ *   created semaphore object. If the function fails, the return value is NULL
+ **/
+
+OsSemaphore *osSemaphoreCreate(uint_t maxCount, uint_t initialCount)
+{
+   OsBareMetalSemaphore *semaphore;
+
+   //Allocate a new semaphore object
+   semaphore = osMemAlloc(sizeof(OsBareMetalSemaphore));
+   //Failed to allocate memory?
+   if(!semaphore) return NULL;
+
+   //Initialize the semaphore object
+   semaphore->count = initialCount;
+   semaphore->maxCount = maxCount;
+
+   //Return a handle to the newly created semaphore object
+   return (OsSemaphore *) semaphore;
+}
+
+
+/**
+ * @brief Close a semaphore object
+ **/
+
+void osSemaphoreClose(OsSemaphore *semaphore)
+{
+   //Release the semaphore object
+   osMemFree(semaphore);
+}
+
+
+/**
+ * @brief Wait for the specified semaphore to be available
+ * @param[in] semaphore A handle to the semaphore object
+ * @param[in] timeout Timeout interval, in milliseconds
+ * @return TRUE if the semaphore is available, FALSE if the timeout
+ *   interval elapsed
+ **/
+
+bool_t osSemaphoreWait(OsSemaphore *semaphore, time_t timeout)
+{
+   time_t startTime;
+   OsBareMetalSemaphore *desc = (OsBareMetalSemaphore *) semaphore;
+
+   //Save current time
+   startTime = osGetTickCount();
+
+   //Wait until the count is nonzero or the time-out interval elapses
+   while(desc->count == 0)
+   {
+      //Time-out interval elapsed?
+      if(timeout != INFINITE_DELAY && (osGetTickCount() - startTime) >= timeout)
+         return FALSE;
+   }
+
+   //Decrement the count
+   osTaskSuspendAll();
+   desc->count--;
+   osTaskResumeAll();
+
+   //The semaphore was available
+   return TRUE;
+}
+
+
+/**
+ * @brief Release the specified semaphore object
+ * @param[in] semaphore A handle to the semaphore object
+ **/
+
+void osSemaphoreRelease(OsSemaphore *semaphore)
+{
+   OsBareMetalSemaphore *desc = (OsBareMetalSemaphore *) semaphore;
+
+   //Increment the count, up to the maximum value
+   osTaskSuspendAll();
+   if(desc->count < desc->maxCount)
+      desc->count++;
+   osTaskResumeAll();
+}
+
+
+/**
+ * @brief Create a mutex object
+ *
+ * There is a single thread of execution, so mutexes do nothing
+ *
+ * @param[in] initialOwner Unused parameter
+ * @return A valid dummy handle
+ **/
+
+OsMutex *osMutexCreate(bool_t initialOwner)
+{
+   //All the mutexes share the same dummy handle
+   return (OsMutex *) &osBareMetalMutex;
+}
+
+
+/**
+ * @brief Create a named mutex object
+ *
+ * Mutexes can never be contended, hence they are not profiled
+ *
+ * @param[in] initialOwner Unused parameter
+ * @param[in] name Unused parameter
+ * @return A valid dummy handle
+ **/
+
+OsMutex *osMutexCreateNamed(bool_t initialOwner, const char_t *name)
+{
+   //All the mutexes share the same dummy handle
+   return (OsMutex *) &osBareMetalMutex;
+}
+
+
+/**
+ * @brief Close a mutex object
+ **/
+
+void osMutexClose(OsMutex *mutex)
+{
+}
+
+
+/**
+ * @brief Acquire ownership of the specified mutex object
+ * @param[in] mutex A handle to the mutex object
+ **/
+
+void osMutexAcquire(OsMutex *mutex)
+{
+}
+
+
+/**
+ * @brief Release ownership of the specified mutex object
+ * @param[in] mutex A handle to the mutex object
+ **/
+
+void osMutexRelease(OsMutex *mutex)
+{
+}
+
+
+OsQueue *osQueueCreate(uint_t length, size_t itemSize)
+{
+   OsBareMetalQueue *queue;
+
+   //Allocate a queue object large enough to hold the items
+   queue = osMemAlloc(sizeof(OsBareMetalQueue) + length * itemSize);
+   //Failed to allocate memory?
+   if(!queue) return NULL;
+
+   //Initialize the queue object
+   queue->length = length;
+   queue->itemSize = itemSize;
+   queue->readIndex = 0;
+   queue->count = 0;
+
+   //Return a handle to the newly created queue object
+   return (OsQueue *) queue;
+}
+
+
+void osQueueClose(OsQueue *queue)
+{
+   //Release the queue object
+   osMemFree(queue);
+}
+
+
+bool_t osQueueSend(OsQueue *queue, const void *item, time_t timeout)
+{
+   uint_t i;
+   bool_t status;
+   OsBareMetalQueue *desc = (OsBareMetalQueue *) queue;
+
+   //Enter critical section
+   osTaskSuspendAll();
+
+   //Any room left in the queue?
+   if(desc->count < desc->length)
+   {
+      //Index of the first free slot
+      i = (desc->readIndex + desc->count) % desc->length;
+      //Copy the item to the queue
+      memcpy(desc->buffer + i * desc->itemSize, item, desc->itemSize);
+      desc->count++;
+      //The item has been queued
+      status = TRUE;
+   }
+   else
+   {
+      //The queue is full
+      status = FALSE;
+   }
+
+   //Leave critical section
+   osTaskResumeAll();
+
+   //Nobody can drain the queue while the caller waits, so the
+   //function never blocks
+   return status;
+}
+
+
+bool_t osQueueReceive(OsQueue *queue, void *item, time_t timeout)
+{
+   time_t startTime;
+   OsBareMetalQueue *desc = (OsBareMetalQueue *) queue;
+
+   //Save current time
+   startTime = osGetTickCount();
+
+   //Wait until an item is available or the time-out interval elapses
+   while(desc->count == 0)
+   {
+      //Time-out interval elapsed?
+      if(timeout != INFINITE_DELAY && (osGetTickCount() - startTime) >= timeout)
+         return FALSE;
+   }
+
+   //Enter critical section
+   osTaskSuspendAll();
+
+   //Copy the oldest item
+   memcpy(item, desc->buffer + desc->readIndex * desc->itemSize, desc->itemSize);
+   desc->readIndex = (desc->readIndex + 1) % desc->length;
+   desc->count--;
+
+   //Leave critical section
+   osTaskResumeAll();
+
+   //An item has been received
+   return TRUE;
+}
+
+
+bool_t osQueuePeek(OsQueue *queue, void *item, time_t timeout)
+{
+   time_t startTime;
+   OsBareMetalQueue *desc = (OsBareMetalQueue *) queue;
+
+   //Save current time
+   startTime = osGetTickCount();
+
+   //Wait until an item is available or the time-out interval elapses
+   while(desc->count == 0)
+   {
+      //Time-out interval elapsed?
+      if(timeout != INFINITE_DELAY && (osGetTickCount() - startTime) >= timeout)
+         return FALSE;
+   }
+
+   //Copy the oldest item without removing it from the queue
+   memcpy(item, desc->buffer + desc->readIndex * desc->itemSize, desc->itemSize);
+   //An item is available
+   return TRUE;
+}
+
+
+bool_t osQueueSendFromIrq(OsQueue *queue, const void *item, bool_t *higherPriorityTaskWoken)
+{
+   //No context switch is required
+   *higherPriorityTaskWoken = FALSE;
+   //Interrupts are not nested with the main loop critical sections
+   return osQueueSend(queue, item, 0);
+}
+
+
+bool_t osQueueReceiveFromIrq(OsQueue *queue, void *item, bool_t *higherPriorityTaskWoken)
+{
+   //No context switch is required
+   *higherPriorityTaskWoken = FALSE;
+   //Never wait within an interrupt service routine
+   return osQueueReceive(queue, item, 0);
+}
+
+
+void osTimerStart(OsTimer *timer, time_t delay)
+{
+   timer->startTime = osGetTickCount();
+   timer->interval = delay;
+   timer->running = TRUE;
+}
+
+
+void osTimerStop(OsTimer *timer)
+{
+   timer->running = FALSE;
+}
+
+
+bool_t osTimerRunning(OsTimer *timer)
+{
+   //Check whether the timer is currently running
+   return timer->running;
+}
+
+
+bool_t osTimerElapsed(OsTimer *timer)
+{
+   //Make sure the timer is currently running
+   if(!timer->running)
+      return FALSE;
+
+   if(timeCompare(osGetTickCount(), timer->startTime + timer->interval) >= 0)
+      return TRUE;
+   else
+      return FALSE;
+}
+
+
+/**
+ * @brief Allocate a memory block
+ * @param[in] size Bytes to allocate
+ * @return  A pointer to the allocated memory block or NULL if
+ *   there is insufficient memory available
+ **/
+
+void *osMemAlloc(size_t size)
+{
+   void *p;
+
+   //Enter critical section
+   osTaskSuspendAll();
+
+//TLSF allocator?
+#if defined(USE_TLSF)
+   //Allocate a memory block in constant time
+   p = tlsfAlloc(size);
+#else
+   //Allocate a memory block
+   p = malloc(size);
+#endif
+
+   //Leave critical section
+   osTaskResumeAll();
+
+   //Return a pointer to the newly allocated memory block
+   return p;
+}
+
+
+/**
+ * @brief Release a previously allocated memory block
+ * @param[in] p Previously allocated memory block to be freed
+ **/
+
+void osMemFree(void *p)
+{
+   //Make sure the pointer is valid
+   if(p != NULL)
+   {
+      //Enter critical section
+      osTaskSuspendAll();
+
+//TLSF allocator?
+#if defined(USE_TLSF)
+      //Release the memory block in constant time
+      tlsfFree(p);
+#else
+      //Free memory block
+      free(p);
+#endif
+
+      //Leave critical section
+      osTaskResumeAll();
+   }
+}
+
+
+/**
+ * @brief 16-bit increment operation
+ * @param[in] n Pointer to a 16-bit to be incremented
+ * @return The value resulting from the increment
+ **/
+
+uint16_t osAtomicInc16(uint16_t *n)
+{
+   uint16_t m;
+
+   //Enter critical section
+   osTaskSuspendAll();
+   //Increment the specified 16-bit integer
+   m = ++(*n);
+   //Leave critical section
+   osTaskResumeAll();
+
+   //Return the incremented value
+   return m;
+}
+
+
+/**
+ * @brief 32-bit increment operation
+ * @param[in] n Pointer to a 32-bit to be incremented
+ * @return The value resulting from the increment
+ **/
+
+uint32_t osAtomicInc32(uint32_t *n)
+{
+   uint32_t m;
+
+   //Enter critical section
+   osTaskSuspendAll();
+   //Increment the specified 32-bit integer
+   m = ++(*n);
+   //Leave critical section
+   osTaskResumeAll();
+
+   //Return the incremented value
+   return m;
+}
+
+
+/**
+ * @brief 32-bit decrement operation
+ * @param[in] n Pointer to a 32-bit to be decremented
+ * @return The value resulting from the decrement
+ **/
+
+uint32_t osAtomicDec32(uint32_t *n)
+{
+   uint32_t m;
+
+   //Enter critical section
+   osTaskSuspendAll();
+   //Decrement the specified 32-bit integer
+   m = --(*n);
+   //Leave critical section
+   osTaskResumeAll();
+
+   //Return the decremented value
+   return m;
+}
+
+
+/**
+ * @brief 32-bit addition operation
+ * @param[in] n Pointer to a 32-bit integer to be updated
+ * @param[in] value Value to be added
+ * @return The value resulting from the addition
+ **/
+
+uint32_t osAtomicAdd32(uint32_t *n, uint32_t value)
+{
+   uint32_t m;
+
+   //Enter critical section
+   osTaskSuspendAll();
+   //Add the specified value to the 32-bit integer
+   m = (*n += value);
+   //Leave critical section
+   osTaskResumeAll();
+
+   //Return the resulting value
+   return m;
+}
+
+
+/**
+ * @brief Delay routine
+ * @param[in] delay Number of milliseconds to spin for
+ **/
+
+void osDelay(time_t delay)
+{
+   time_t startTime;
+
+   //Save current time
+   startTime = osGetTickCount();
+   //Busy-wait until the delay elapses
+   while((osGetTickCount() - startTime) < delay);
+}
+
+
+/**
+ * @brief Advance the system time
+ *
+ * This function must be called every millisecond from the
+ * system tick interrupt
+ *
+ **/
+
+void osTickIrqHandler(void)
+{
+   //Increment the tick counter
+   osTickCount++;
+}
+
+
+/**
+ * @brief Retrieve system time
+ * @return Number of milliseconds elapsed since the system was last started
+ **/
+
+time_t osGetTickCount(void)
+{
+   return osTickCount;
+}
+
+
+time_t osGetTime(void)
+{
+   return 0;
+}
+
+
+const char_t *timeFormat(time_t time)
+{
+   static char_t buffer[16];
+   sprintf(buffer, "%lus %03lums", time / 1000, time % 1000);
+   return buffer;
+}
+
+
+/**
+ * @brief Delay routine
+ **/
+
+void usleep(uint_t delay)
+{
+   delay *= 4;
+   while(delay--);
+}
+
+
+/**
+ * @brief Delay routine
+ **/
+
+void sleep(uint_t delay)
+{
+   delay *= 3500;
+   while(delay--);
+}
@@ -0,0 +1,3 @@
+CYCLONETCPSRC += $(CYCLONETCP)/common/ports/BareMetal/os.c 
+				 
+CYCLONETCPINC += $(CYCLONETCP)/common/ports/BareMetal/
@@ -37,6 +37,12 @@
 #include "os.h"
 #include "debug.h"
 
+//TLSF allocator?
+#if defined(USE_TLSF)
+   #include "error.h"
+   #include "tlsf.h"
+#endif
+
 //Include RTOS dependent headers
 #if defined(USE_FREERTOS)
    #include "freertos.h"
@@ -46,6 +52,57 @@
    #include <windows.h>
 #endif
 
+//Direct to task notifications are available?
+#if defined(USE_FREERTOS) && defined(configUSE_TASK_NOTIFICATIONS)
+   #if (configUSE_TASK_NOTIFICATIONS == 1)
+      #define OS_TASK_NOTIFY_SUPPORT ENABLED
+   #endif
+#endif
+
+#ifndef OS_TASK_NOTIFY_SUPPORT
+   #define OS_TASK_NOTIFY_SUPPORT DISABLED
+#endif
+
+//Task registry?
+#if defined(USE_TASK_REGISTRY)
+   #include "task_registry.h"
+#endif
+
+//Lock contention profiling?
+#if defined(USE_FREERTOS) && defined(USE_MUTEX_PROFILING)
+   #include "mutex_profile.h"
+   #include "probe.h"
+
+/**
+ * @brief Profiled mutex
+ **/
+
+typedef struct
+{
+   xSemaphoreHandle handle; ///<FreeRTOS mutex
+   MutexProfile profile;    ///<Contention statistics
+} OsMutexDesc;
+
+#endif
+
+#if (OS_TASK_NOTIFY_SUPPORT == ENABLED)
+
+/**
+ * @brief Event descriptor
+ *
+ * Regular events rely on a binary semaphore. Single-waiter events have
+ * no semaphore and wake up the waiting task through its notification value
+ **/
+
+typedef struct
+{
+   xSemaphoreHandle semaphore;   ///<Binary semaphore (NULL for single-waiter events)
+   xTaskHandle volatile waiter;  ///<Task waiting for a single-waiter event
+   volatile bool_t signaled;     ///<State of a single-waiter event
+} OsEventDesc;
+
+#endif
+
 
 /**
  * @brief Start OS scheduler
@@ -80,10 +137,24 @@ OsTask *osTaskCreate(const char_t *name, TaskCode taskCode,
    portBASE_TYPE status;
    xTaskHandle task = NULL;
 
+#if defined(USE_TASK_REGISTRY)
+   //The new task must not run before being registered
+   vTaskSuspendAll();
+#endif
+
    //Create a new task
    status = xTaskCreate((pdTASK_CODE) taskCode,
       (const signed char *) name, stackSize, params, priority, &task);
 
+#if defined(USE_TASK_REGISTRY)
+   //Keep track of the newly created task
+   if(status == pdPASS)
+      taskRegistryAdd((OsTask *) task, name, stackSize);
+
+   //Resume scheduler activity
+   xTaskResumeAll();
+#endif
+
    //Check the return value
    if(status == pdPASS)
       return task;
@@ -106,6 +177,10 @@ void osTaskDelete(OsTask *task)
 {
 //FreeRTOS port?
 #if defined(USE_FREERTOS)
+#if defined(USE_TASK_REGISTRY)
+   //Stop tracking the task
+   taskRegistryRemove((task != NULL) ? task : (OsTask *) xTaskGetCurrentTaskHandle());
+#endif
    //Delete the specified task
    vTaskDelete((xTaskHandle) task);
 #endif
@@ -200,22 +275,47 @@ OsEvent *osEventCreate(bool_t manualReset, bool_t initialState)
 {
 //FreeRTOS port?
 #if defined(USE_FREERTOS)
-   xSemaphoreHandle event;
+   xSemaphoreHandle semaphore;
+#if (OS_TASK_NOTIFY_SUPPORT == ENABLED)
+   OsEventDesc *event;
+#endif
 
-   //Create an event object
-   vSemaphoreCreateBinary(event);
+   //Create a binary semaphore
+   vSemaphoreCreateBinary(semaphore);
    //Any error to report?
-   if(!event) return NULL;
+   if(!semaphore) return NULL;
 
    //Initial state is signaled or nonsignaled?
    if(!initialState)
    {
       //Set the specified event object to the nonsignaled state
-      xSemaphoreTake(event, 0);
+      xSemaphoreTake(semaphore, 0);
+   }
+
+#if (OS_TASK_NOTIFY_SUPPORT == ENABLED)
+   //Allocate a new event descriptor
+   event = osMemAlloc(sizeof(OsEventDesc));
+
+   //Failed to allocate memory?
+   if(!event)
+   {
+      //Clean up side effects
+      vSemaphoreDelete(semaphore);
+      //Report an error
+      return NULL;
    }
 
+   //Any number of tasks may wait for this event
+   event->semaphore = semaphore;
+   event->waiter = NULL;
+   event->signaled = FALSE;
+
    //Return a handle to the newly created event object
    return (OsEvent *) event;
+#else
+   //Return a handle to the newly created event object
+   return (OsEvent *) semaphore;
+#endif
 
 //Windows port?
 #elif defined(_WIN32)
@@ -234,6 +334,46 @@ OsEvent *osEventCreate(bool_t manualReset, bool_t initialState)
 }
 
 
+/**
+ * @brief Create an auto-reset event object with a single waiting task
+ *
+ * The returned event behaves like an auto-reset event created with
+ * osEventCreate, but only one task at a time may wait for it. When the
+ * FreeRTOS kernel provides direct to task notifications, the waiting task
+ * is woken up through its notification value instead of a semaphore, which
+ * is both smaller and faster
+ *
+ * @param[in] initialState If this parameter is TRUE, the initial state of the
+ *   event object is signaled. Otherwise, it is nonsignaled
+ * @return If the function succeeds, the return value is a handle to the newly
+ *   created event object. If the function fails, the return value is NULL
+ **/
+
+OsEvent *osEventCreateSingleWaiter(bool_t initialState)
+{
+//Direct to task notifications are available?
+#if (OS_TASK_NOTIFY_SUPPORT == ENABLED)
+   OsEventDesc *event;
+
+   //Allocate a new event descriptor
+   event = osMemAlloc(sizeof(OsEventDesc));
+   //Failed to allocate memory?
+   if(!event) return NULL;
+
+   //No semaphore is needed since the waiting task is notified directly
+   event->semaphore = NULL;
+   event->waiter = NULL;
+   event->signaled = initialState;
+
+   //Return a handle to the newly created event object
+   return (OsEvent *) event;
+#else
+   //Fall back to a regular auto-reset event
+   return osEventCreate(FALSE, initialState);
+#endif
+}
+
+
 /**
  * @brief Close an event object
  **/
@@ -245,8 +385,17 @@ void osEventClose(OsEvent *event)
    //Make sure the handle is valid
    if(event)
    {
+#if (OS_TASK_NOTIFY_SUPPORT == ENABLED)
+      //Properly dispose the underlying semaphore, if any
+      if(((OsEventDesc *) event)->semaphore)
+         vSemaphoreDelete(((OsEventDesc *) event)->semaphore);
+
+      //Release the event descriptor
+      osMemFree(event);
+#else
       //Properly dispose the event object
       vSemaphoreDelete((xSemaphoreHandle) event);
+#endif
    }
 #endif
 }
@@ -259,8 +408,37 @@ void osEventClose(OsEvent *event)
 
 void osEventSet(OsEvent *event)
 {
+//Direct to task notifications are available?
+#if (OS_TASK_NOTIFY_SUPPORT == ENABLED)
+   xTaskHandle task;
+   OsEventDesc *desc = (OsEventDesc *) event;
+
+   //Regular event object?
+   if(desc->semaphore)
+   {
+      //Set the specified event to the signaled state
+      xSemaphoreGive(desc->semaphore);
+   }
+   else
+   {
+      //Enter critical section
+      taskENTER_CRITICAL();
+
+      //Set the specified event to the signaled state
+      desc->signaled = TRUE;
+      //Retrieve the task that is currently waiting for the event
+      task = desc->waiter;
+      desc->waiter = NULL;
+
+      //Leave critical section
+      taskEXIT_CRITICAL();
+
+      //Wake up the waiting task, if any
+      if(task != NULL)
+         xTaskNotifyGive(task);
+   }
 //FreeRTOS port?
-#if defined(USE_FREERTOS)
+#elif defined(USE_FREERTOS)
    //Set the specified event to the signaled state
    xSemaphoreGive((xSemaphoreHandle) event);
 #endif
@@ -274,8 +452,23 @@ void osEventSet(OsEvent *event)
 
 void osEventReset(OsEvent *event)
 {
+//Direct to task notifications are available?
+#if (OS_TASK_NOTIFY_SUPPORT == ENABLED)
+   OsEventDesc *desc = (OsEventDesc *) event;
+
+   //Regular event object?
+   if(desc->semaphore)
+   {
+      //Force the specified event to the nonsignaled state
+      xSemaphoreTake(desc->semaphore, 0);
+   }
+   else
+   {
+      //Force the specified event to the nonsignaled state
+      desc->signaled = FALSE;
+   }
 //FreeRTOS port?
-#if defined(USE_FREERTOS)
+#elif defined(USE_FREERTOS)
    //Force the specified event to the nonsignaled state
    xSemaphoreTake((xSemaphoreHandle) event, 0);
 #endif
@@ -296,8 +489,64 @@ void osEventReset(OsEvent *event)
 
 bool_t osEventWait(OsEvent *event, time_t timeout)
 {
+//Direct to task notifications are available?
+#if (OS_TASK_NOTIFY_SUPPORT == ENABLED)
+   bool_t signaled;
+   portTickType startTime;
+   portTickType elapsedTime;
+   OsEventDesc *desc = (OsEventDesc *) event;
+
+   //Regular event object?
+   if(desc->semaphore)
+   {
+      //Waits until the specified event is in the signaled
+      //state or the time-out interval elapses
+      return xSemaphoreTake(desc->semaphore, timeout);
+   }
+
+   //Save current time
+   startTime = xTaskGetTickCount();
+
+   //A stale notification may wake up the task before the event is
+   //signaled, so the state of the event must be re-checked every time
+   while(1)
+   {
+      //Enter critical section
+      taskENTER_CRITICAL();
+
+      //Time elapsed since the beginning of the wait
+      elapsedTime = xTaskGetTickCount() - startTime;
+
+      //Check whether the event is in the signaled state
+      signaled = desc->signaled;
+
+      //Signaled event or time-out interval elapsed?
+      if(signaled || (timeout != INFINITE_DELAY && elapsedTime >= timeout))
+      {
+         //Auto-reset event
+         desc->signaled = FALSE;
+         desc->waiter = NULL;
+         //Leave critical section
+         taskEXIT_CRITICAL();
+
+         //Return the state of the event
+         return signaled;
+      }
+
+      //Register the calling task as the waiter
+      desc->waiter = xTaskGetCurrentTaskHandle();
+
+      //Leave critical section
+      taskEXIT_CRITICAL();
+
+      //Block until the task is notified or the remaining time elapses
+      if(timeout == INFINITE_DELAY)
+         ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+      else
+         ulTaskNotifyTake(pdTRUE, timeout - elapsedTime);
+   }
 //FreeRTOS port?
-#if defined(USE_FREERTOS)
+#elif defined(USE_FREERTOS)
    //Waits until the specified event is in the signaled
    //state or the time-out interval elapses
    return xSemaphoreTake((xSemaphoreHandle) event, timeout);
@@ -318,8 +567,45 @@ bool_t osEventWait(OsEvent *event, time_t timeout)
 
 bool_t osEventSetFromIrq(OsEvent *event)
 {
+//Direct to task notifications are available?
+#if (OS_TASK_NOTIFY_SUPPORT == ENABLED)
+   unsigned portBASE_TYPE mask;
+   portBASE_TYPE flag;
+   xTaskHandle task;
+   OsEventDesc *desc = (OsEventDesc *) event;
+
+   //No higher priority task has been woken yet
+   flag = pdFALSE;
+
+   //Regular event object?
+   if(desc->semaphore)
+   {
+      //Set the specified event to the signaled state
+      xSemaphoreGiveFromISR(desc->semaphore, &flag);
+   }
+   else
+   {
+      //Mask interrupts that may access the event
+      mask = portSET_INTERRUPT_MASK_FROM_ISR();
+
+      //Set the specified event to the signaled state
+      desc->signaled = TRUE;
+      //Retrieve the task that is currently waiting for the event
+      task = desc->waiter;
+      desc->waiter = NULL;
+
+      //Restore interrupt mask
+      portCLEAR_INTERRUPT_MASK_FROM_ISR(mask);
+
+      //Wake up the waiting task, if any
+      if(task != NULL)
+         vTaskNotifyGiveFromISR(task, &flag);
+   }
+
+   //A higher priority task has been woken?
+   return flag;
 //FreeRTOS port?
-#if defined(USE_FREERTOS)
+#elif defined(USE_FREERTOS)
    portBASE_TYPE flag;
 
    //Set the specified event to the signaled state
@@ -443,8 +729,60 @@ void osSemaphoreRelease(OsSemaphore *semaphore)
 
 OsMutex *osMutexCreate(bool_t initialOwner)
 {
+   //Create an anonymous mutex
+   return osMutexCreateNamed(initialOwner, NULL);
+}
+
+
+/**
+ * @brief Create a named mutex object
+ *
+ * The name identifies the mutex in the lock contention statistics
+ * and must remain valid for the lifetime of the mutex
+ *
+ * @param[in] initialOwner If this value is TRUE the calling task obtains
+ *   initial ownership of the mutex object. Otherwise, the calling task
+ *   does not obtain ownership of the mutex
+ * @param[in] name NULL-terminated string that names the mutex
+ * @return If the function succeeds, the return value is a handle to the newly
+ *   created mutex object. If the function fails, the return value is NULL
+ **/
+
+OsMutex *osMutexCreateNamed(bool_t initialOwner, const char_t *name)
+{
+//FreeRTOS port with lock contention profiling?
+#if defined(USE_FREERTOS) && defined(USE_MUTEX_PROFILING)
+   OsMutexDesc *mutex;
+
+   //Allocate a memory block to hold the mutex descriptor
+   mutex = osMemAlloc(sizeof(OsMutexDesc));
+   //Failed to allocate memory?
+   if(!mutex) return NULL;
+
+   //Create a mutex object
+   mutex->handle = xSemaphoreCreateMutex();
+
+   //Any error to report?
+   if(!mutex->handle)
+   {
+      //Clean up side effects
+      osMemFree(mutex);
+      //Report an error
+      return NULL;
+   }
+
+   //Start collecting statistics
+   mutexProfileRegister(&mutex->profile, name);
+
+   //Get the initial ownership of the mutex?
+   if(initialOwner)
+      osMutexAcquire((OsMutex *) mutex);
+
+   //Return a handle to the newly created mutex
+   return (OsMutex *) mutex;
+
 //FreeRTOS port?
-#if defined(USE_FREERTOS)
+#elif defined(USE_FREERTOS)
    xSemaphoreHandle mutex;
 
    //Create a mutex object
@@ -466,6 +804,9 @@ OsMutex *osMutexCreate(bool_t initialOwner)
 #elif defined(_WIN32)
    HANDLE mutex;
 
+   //The name is only meaningful to the profiler
+   (void) name;
+
    //Create a mutex object
    mutex = CreateMutex(NULL, initialOwner, NULL);
    //Return a handle to the newly created mutex
@@ -485,8 +826,20 @@ OsMutex *osMutexCreate(bool_t initialOwner)
 
 void osMutexClose(OsMutex *mutex)
 {
+//FreeRTOS port with lock contention profiling?
+#if defined(USE_FREERTOS) && defined(USE_MUTEX_PROFILING)
+   //Make sure the handle is valid
+   if(mutex)
+   {
+      //Stop collecting statistics
+      mutexProfileUnregister(&((OsMutexDesc *) mutex)->profile);
+      //Properly dispose the specified mutex
+      vSemaphoreDelete(((OsMutexDesc *) mutex)->handle);
+      //Release the mutex descriptor
+      osMemFree(mutex);
+   }
 //FreeRTOS port?
-#if defined(USE_FREERTOS)
+#elif defined(USE_FREERTOS)
    //Make sure the handle is valid
    if(mutex)
    {
@@ -504,8 +857,28 @@ void osMutexClose(OsMutex *mutex)
 
 void osMutexAcquire(OsMutex *mutex)
 {
+//FreeRTOS port with lock contention profiling?
+#if defined(USE_FREERTOS) && defined(USE_MUTEX_PROFILING)
+   bool_t contended;
+   uint32_t requestTime;
+   OsMutexDesc *desc = (OsMutexDesc *) mutex;
+
+   //Save the time at which the mutex is requested
+   requestTime = PROBE_GET_CYCLES();
+   //Check whether the mutex is immediately available
+   contended = (xSemaphoreTake(desc->handle, 0) != pdTRUE);
+
+   //The mutex is owned by another task?
+   if(contended)
+   {
+      //Block until the mutex is released
+      xSemaphoreTake(desc->handle, portMAX_DELAY);
+   }
+
+   //Update statistics
+   mutexProfileAcquired(&desc->profile, requestTime, contended);
 //FreeRTOS port?
-#if defined(USE_FREERTOS)
+#elif defined(USE_FREERTOS)
    //Obtain ownership of the mutex object
    xSemaphoreTake((xSemaphoreHandle) mutex, portMAX_DELAY);
 #endif
@@ -519,8 +892,14 @@ void osMutexAcquire(OsMutex *mutex)
 
 void osMutexRelease(OsMutex *mutex)
 {
+//FreeRTOS port with lock contention profiling?
+#if defined(USE_FREERTOS) && defined(USE_MUTEX_PROFILING)
+   //Update statistics before giving the mutex away
+   mutexProfileReleased(&((OsMutexDesc *) mutex)->profile);
+   //Release ownership of the mutex object
+   xSemaphoreGive(((OsMutexDesc *) mutex)->handle);
 //FreeRTOS port?
-#if defined(USE_FREERTOS)
+#elif defined(USE_FREERTOS)
    //Release ownership of the mutex object
    xSemaphoreGive((xSemaphoreHandle) mutex);
 #endif
@@ -668,8 +1047,20 @@ bool_t osTimerElapsed(OsTimer *timer)
 
 void *osMemAlloc(size_t size)
 {
+//TLSF allocator?
+#if defined(USE_TLSF)
+   void *p;
+
+   //Enter critical section
+   osTaskSuspendAll();
+   //Allocate a memory block in constant time
+   p = tlsfAlloc(size);
+   //Leave critical section
+   osTaskResumeAll();
+   //Return a pointer to the newly allocated memory block
+   return p;
 //FreeRTOS port?
-#if defined(USE_FREERTOS)
+#elif defined(USE_FREERTOS)
    void *p;
 
    //Suspends all tasks
@@ -696,8 +1087,20 @@ void *osMemAlloc(size_t size)
 
 void osMemFree(void *p)
 {
+//TLSF allocator?
+#if defined(USE_TLSF)
+   //Make sure the pointer is valid
+   if(p != NULL)
+   {
+      //Enter critical section
+      osTaskSuspendAll();
+      //Release the memory block in constant time
+      tlsfFree(p);
+      //Leave critical section
+      osTaskResumeAll();
+   }
 //FreeRTOS port?
-#if defined(USE_FREERTOS)
+#elif defined(USE_FREERTOS)
    //Make sure the pointer is valid
    if(p != NULL)
    {
@@ -725,6 +1128,10 @@ void osMemFree(void *p)
 
 uint16_t osAtomicInc16(uint16_t *n)
 {
+#if defined(__GNUC__) && (defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__))
+   //Exclusive load and store instructions make the operation lock-free
+   return __sync_add_and_fetch(n, 1);
+#else
    uint16_t m;
 
    //Enter critical section
@@ -736,6 +1143,7 @@ uint16_t osAtomicInc16(uint16_t *n)
 
    //Return the incremented value
    return m;
+#endif
 }
 
 
@@ -747,6 +1155,10 @@ uint16_t osAtomicInc16(uint16_t *n)
 
 uint32_t osAtomicInc32(uint32_t *n)
 {
+#if defined(__GNUC__) && (defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__))
+   //Exclusive load and store instructions make the operation lock-free
+   return __sync_add_and_fetch(n, 1);
+#else
    uint32_t m;
 
    //Enter critical section
@@ -758,6 +1170,62 @@ uint32_t osAtomicInc32(uint32_t *n)
 
    //Return the incremented value
    return m;
+#endif
+}
+
+
+/**
+ * @brief 32-bit decrement operation
+ * @param[in] n Pointer to a 32-bit to be decremented
+ * @return The value resulting from the decrement
+ **/
+
+uint32_t osAtomicDec32(uint32_t *n)
+{
+#if defined(__GNUC__) && (defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__))
+   //Exclusive load and store instructions make the operation lock-free
+   return __sync_sub_and_fetch(n, 1);
+#else
+   uint32_t m;
+
+   //Enter critical section
+   osTaskSuspendAll();
+   //Decrement the specified 32-bit integer
+   m = --(*n);
+   //Leave critical section
+   osTaskResumeAll();
+
+   //Return the decremented value
+   return m;
+#endif
+}
+
+
+/**
+ * @brief 32-bit addition operation
+ * @param[in] n Pointer to a 32-bit integer to be updated
+ * @param[in] value Value to be added
+ * @return The value resulting from the addition
+ **/
+
+uint32_t osAtomicAdd32(uint32_t *n, uint32_t value)
+{
+#if defined(__GNUC__) && (defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__))
+   //Exclusive load and store instructions make the operation lock-free
+   return __sync_add_and_fetch(n, value);
+#else
+   uint32_t m;
+
+   //Enter critical section
+   osTaskSuspendAll();
+   //Add the specified value to the 32-bit integer
+   m = (*n += value);
+   //Leave critical section
+   osTaskResumeAll();
+
+   //Return the resulting value
+   return m;
+#endif
 }
 
 
@@ -0,0 +1,1226 @@
+/**
+ * @file os.c
+ * @brief RTOS abstraction layer (POSIX port)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * This port runs the TCP/IP stack as a regular Linux process. Tasks are
+ * mapped onto threads, events onto condition variables, and time is
+ * derived from the monotonic clock. Combined with the TAP driver, it
+ * allows the stack to be run under sanitizers and profilers.
+ * USE_POSIX must be defined when building the whole project
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Dependencies
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+#include "os.h"
+#include "debug.h"
+
+//TLSF allocator?
+#if defined(USE_TLSF)
+   #include "error.h"
+   #include "tlsf.h"
+#endif
+
+//Task registry?
+#if defined(USE_TASK_REGISTRY)
+   #include "task_registry.h"
+#endif
+
+//Lock contention profiling?
+#if defined(USE_MUTEX_PROFILING)
+   #include "mutex_profile.h"
+   #include "probe.h"
+#endif
+
+
+/**
+ * @brief Mutex object
+ **/
+
+typedef struct
+{
+   pthread_mutex_t mutex;
+#if defined(USE_MUTEX_PROFILING)
+   MutexProfile profile;
+#endif
+} OsPosixMutex;
+
+
+/**
+ * @brief Task creation parameters
+ **/
+
+typedef struct
+{
+   TaskCode taskCode;
+   void *params;
+   const char_t *name;
+   size_t stackSize;
+} OsPosixTaskParams;
+
+
+/**
+ * @brief Event object
+ **/
+
+typedef struct
+{
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+   bool_t signaled;
+   bool_t manualReset;
+} OsPosixEvent;
+
+
+/**
+ * @brief Semaphore object
+ **/
+
+typedef struct
+{
+   pthread_mutex_t mutex;
+   pthread_cond_t cond;
+   uint_t count;
+   uint_t maxCount;
+} OsPosixSemaphore;
+
+
+/**
+ * @brief Queue object
+ **/
+
+typedef struct
+{
+   pthread_mutex_t mutex;
+   pthread_cond_t notEmpty;
+   pthread_cond_t notFull;
+   uint_t length;
+   size_t itemSize;
+   uint_t readIndex;
+   uint_t count;
+   uint8_t buffer[];
+} OsPosixQueue;
+
+
+//Lock emulating the suspension of the scheduler
+static pthread_mutex_t osSchedulerMutex;
+static pthread_once_t osSchedulerOnce = PTHREAD_ONCE_INIT;
+
+
+/**
+ * @brief Initialize the lock emulating the suspension of the scheduler
+ **/
+
+static void osPosixSchedulerInit(void)
+{
+   pthread_mutexattr_t attr;
+
+   //Critical sections may be nested
+   pthread_mutexattr_init(&attr);
+   pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+
+   //Initialize the lock
+   pthread_mutex_init(&osSchedulerMutex, &attr);
+   pthread_mutexattr_destroy(&attr);
+}
+
+
+/**
+ * @brief Initialize a condition variable driven by the monotonic clock
+ * @param[out] cond Condition variable to initialize
+ * @return 0 on success, an errno value otherwise
+ **/
+
+static int osPosixCondInit(pthread_cond_t *cond)
+{
+   int ret;
+   pthread_condattr_t attr;
+
+   //Time-outs must not be affected by changes of the wall clock
+   pthread_condattr_init(&attr);
+   pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+
+   //Initialize the condition variable
+   ret = pthread_cond_init(cond, &attr);
+   pthread_condattr_destroy(&attr);
+
+   //Return status code
+   return ret;
+}
+
+
+/**
+ * @brief Convert a relative time-out to an absolute monotonic deadline
+ * @param[out] deadline Absolute deadline
+ * @param[in] timeout Time-out interval, in milliseconds
+ **/
+
+static void osPosixGetDeadline(struct timespec *deadline, time_t timeout)
+{
+   //Get current time
+   clock_gettime(CLOCK_MONOTONIC, deadline);
+
+   //Add the time-out interval
+   deadline->tv_sec += timeout / 1000;
+   deadline->tv_nsec += (timeout % 1000) * 1000000;
+
+   //Normalize the result
+   if(deadline->tv_nsec >= 1000000000)
+   {
+      deadline->tv_sec++;
+      deadline->tv_nsec -= 1000000000;
+   }
+}
+
+
+/**
+ * @brief Wait on a condition variable for a limited amount of time
+ * @param[in] cond Condition variable
+ * @param[in] mutex Mutex held by the calling thread
+ * @param[in] deadline Absolute deadline (NULL to wait forever)
+ * @return FALSE if the deadline has passed, TRUE otherwise
+ **/
+
+static bool_t osPosixCondWait(pthread_cond_t *cond,
+   pthread_mutex_t *mutex, const struct timespec *deadline)
+{
+   //Infinite time-out?
+   if(deadline == NULL)
+      return !pthread_cond_wait(cond, mutex);
+   else
+      return pthread_cond_timedwait(cond, mutex, deadline) != ETIMEDOUT;
+}
+
+
+/**
+ * @brief Entry point of the threads backing the tasks
+ * @param[in] arg Task creation parameters
+ * @return Unused value
+ **/
+
+static void *osPosixTaskEntry(void *arg)
+{
+   OsPosixTaskParams params;
+
+   //Copy the creation parameters and release them
+   params = *((OsPosixTaskParams *) arg);
+   free(arg);
+
+#if defined(USE_TASK_REGISTRY)
+   //The thread registers itself so that it cannot exit beforehand
+   taskRegistryAdd((OsTask *) pthread_self(), params.name, params.stackSize);
+#endif
+
+   //Run the task
+   params.taskCode(params.params);
+
+#if defined(USE_TASK_REGISTRY)
+   //Stop tracking the task
+   taskRegistryRemove((OsTask *) pthread_self());
+#endif
+
+   //The task has returned
+   return NULL;
+}
+
+
+/**
+ * @brief Start OS scheduler
+ *
+ * Tasks start running as soon as they are created. The calling
+ * thread simply sleeps forever
+ *
+ **/
+
+void osStart(void)
+{
+   //Sleep forever
+   while(1)
+      pause();
+}
+
+
+/**
+ * @brief Create a new task
+ *
+ * Each task runs in its own thread. Stack size and priority values are
+ * meant for microcontrollers and are therefore ignored
+ *
+ * @param[in] name A brief description of the task
+ * @param[in] taskCode Pointer to the task entry function
+ * @param[in] params A pointer to a variable to be passed to the task
+ * @param[in] stackSize The initial size of the stack, in words
+ * @param[in] priority The priority at which the task should run
+ * @return If the function succeeds, the return value is a pointer to the
+ *   new task. If the function fails, the return value is NULL
+ **/
+
+OsTask *osTaskCreate(const char_t *name, TaskCode taskCode,
+   void *params, size_t stackSize, uint_t priority)
+{
+   pthread_t thread;
+   OsPosixTaskParams *taskParams;
+
+   //Allocate memory to hold the creation parameters
+   taskParams = malloc(sizeof(OsPosixTaskParams));
+   //Failed to allocate memory?
+   if(!taskParams) return OS_INVALID_HANDLE;
+
+   //Save the task entry point and its parameter
+   taskParams->taskCode = taskCode;
+   taskParams->params = params;
+   taskParams->name = name;
+   taskParams->stackSize = stackSize;
+
+   //Create a new thread
+   if(pthread_create(&thread, NULL, osPosixTaskEntry, taskParams))
+   {
+      //Clean up side effects
+      free(taskParams);
+      //Report an error
+      return OS_INVALID_HANDLE;
+   }
+
+   //Threads are never joined
+   pthread_detach(thread);
+
+   //Return a handle to the newly created task
+   return (OsTask *) thread;
+}
+
+
+/**
+ * @brief Delete a task
+ * @param[in] task A handle to the task to be deleted
+ **/
+
+void osTaskDelete(OsTask *task)
+{
+#if defined(USE_TASK_REGISTRY)
+   //Stop tracking the task
+   taskRegistryRemove((task != NULL) ? task : (OsTask *) pthread_self());
+#endif
+
+   //Delete the calling task?
+   if(task == NULL)
+      pthread_exit(NULL);
+   else
+      pthread_cancel((pthread_t) task);
+}
+
+
+/**
+ * @brief Get current task handle
+ * @return A handle to the currently running task
+ **/
+
+OsTask *osTaskGetHandle(void)
+{
+   //Return a handle to the calling thread
+   return (OsTask *) pthread_self();
+}
+
+
+/**
+ * @brief Suspend scheduler activity
+ *
+ * Other threads keep running. Only the critical sections that rely on
+ * this function are serialized
+ *
+ **/
+
+void osTaskSuspendAll(void)
+{
+   //The lock is created on first use
+   pthread_once(&osSchedulerOnce, osPosixSchedulerInit);
+   //Enter critical section
+   pthread_mutex_lock(&osSchedulerMutex);
+}
+
+
+/**
+ * @brief Resume scheduler activity
+ **/
+
+void osTaskResumeAll(void)
+{
+   //Leave critical section
+   pthread_mutex_unlock(&osSchedulerMutex);
+}
+
+
+/**
+ * @brief Force a context switch
+ **/
+
+void osTaskSwitch(void)
+{
+   //Yield the processor
+   sched_yield();
+}
+
+
+/**
+ * @brief Request a context switch from an interrupt service routine
+ **/
+
+void osTaskSwitchFromIrq(void)
+{
+}
+
+
+/**
+ * @brief Create a event object
+ * @param[in] manualReset If this parameter is TRUE, the function creates a
+ *   manual-reset event object.  If this parameter is FALSE, the function
+ *   creates an auto-reset event object
+ * @param[in] initialState If this parameter is TRUE, the initial state of the
+ *   event object is signaled. Otherwise, it is nonsignaled
+ * @return If the function succeeds, the return value is a handle to the newly
+ *   created event object. If the function fails, the return value is NULL
+ **/
+
+OsEvent *osEventCreate(bool_t manualReset, bool_t initialState)
+{
+   OsPosixEvent *event;
+
+   //Allocate a new event object
+   event = malloc(sizeof(OsPosixEvent));
+   //Failed to allocate memory?
+   if(!event) return NULL;
+
+   //Initialize the mutex and the condition variable
+   if(pthread_mutex_init(&event->mutex, NULL))
+   {
+      //Clean up side effects
+      free(event);
+      //Report an error
+      return NULL;
+   }
+
+   if(osPosixCondInit(&event->cond))
+   {
+      //Clean up side effects
+      pthread_mutex_destroy(&event->mutex);
+      free(event);
+      //Report an error
+      return NULL;
+   }
+
+   //Initial state of the event object
+   event->signaled = initialState;
+   event->manualReset = manualReset;
+
+   //Return a handle to the newly created event object
+   return (OsEvent *) event;
+}
+
+
+/**
+ * @brief Create an auto-reset event object with a single waiting task
+ * @param[in] initialState If this parameter is TRUE, the initial state of the
+ *   event object is signaled. Otherwise, it is nonsignaled
+ * @return If the function succeeds, the return value is a handle to the newly
+ *   created event object. If the function fails, the return value is NULL
+ **/
+
+OsEvent *osEventCreateSingleWaiter(bool_t initialState)
+{
+   //Condition variables are already cheap for a single waiter
+   return osEventCreate(FALSE, initialState);
+}
+
+
+/**
+ * @brief Close an event object
+ **/
+
+void osEventClose(OsEvent *event)
+{
+   OsPosixEvent *desc = (OsPosixEvent *) event;
+
+   //Make sure the handle is valid
+   if(desc)
+   {
+      //Properly dispose the event object
+      pthread_cond_destroy(&desc->cond);
+      pthread_mutex_destroy(&desc->mutex);
+      free(desc);
+   }
+}
+
+
+/**
+ * @brief Set the specified event object to the signaled state
+ * @param[in] event A handle to the event object
+ **/
+
+void osEventSet(OsEvent *event)
+{
+   OsPosixEvent *desc = (OsPosixEvent *) event;
+
+   //Enter critical section
+   pthread_mutex_lock(&desc->mutex);
+
+   //Set the specified event to the signaled state
+   desc->signaled = TRUE;
+
+   //Wake up the waiting tasks
+   if(desc->manualReset)
+      pthread_cond_broadcast(&desc->cond);
+   else
+      pthread_cond_signal(&desc->cond);
+
+   //Leave critical section
+   pthread_mutex_unlock(&desc->mutex);
+}
+
+
+/**
+ * @brief Set the specified event object to the nonsignaled state
+ * @param[in] event A handle to the event object
+ **/
+
+void osEventReset(OsEvent *event)
+{
+   OsPosixEvent *desc = (OsPosixEvent *) event;
+
+   //Force the specified event to the nonsignaled state
+   pthread_mutex_lock(&desc->mutex);
+   desc->signaled = FALSE;
+   pthread_mutex_unlock(&desc->mutex);
+}
+
+
+/**
+ * @brief Waits until the specified event is in the signaled state
+ * @param[in] event A handle to the event object
+ * @param[in] timeout The time-out interval, in milliseconds. If a nonzero value
+ *   is specified, the function waits until the object is signaled or the
+ *   interval elapses. If this parameter is zero, the function always returns
+ *   immediately. If this parameter is INFINITE_DELAY, the function will return
+ *   only when the object is signaled
+ * @return TRUE if the state of the specified object is signaled, FALSE if the
+ *   time-out interval elapsed, and the object's state is nonsignaled
+ **/
+
+bool_t osEventWait(OsEvent *event, time_t timeout)
+{
+   bool_t signaled;
+   struct timespec deadline;
+   OsPosixEvent *desc = (OsPosixEvent *) event;
+
+   //Compute the absolute deadline
+   if(timeout != INFINITE_DELAY)
+      osPosixGetDeadline(&deadline, timeout);
+
+   //Enter critical section
+   pthread_mutex_lock(&desc->mutex);
+
+   //Wait until the event is signaled or the time-out interval elapses
+   while(!desc->signaled && timeout != 0)
+   {
+      if(!osPosixCondWait(&desc->cond, &desc->mutex,
+         (timeout != INFINITE_DELAY) ? &deadline : NULL))
+      {
+         break;
+      }
+   }
+
+   //Retrieve the state of the event
+   signaled = desc->signaled;
+
+   //Auto-reset event?
+   if(signaled && !desc->manualReset)
+      desc->signaled = FALSE;
+
+   //Leave critical section
+   pthread_mutex_unlock(&desc->mutex);
+
+   //Return the state of the event
+   return signaled;
+}
+
+
+/**
+ * @brief Set an event object to the signaled state from an IRQ routine
+ *
+ * Interrupts are emulated by host threads (the TAP reader task for
+ * instance), so the event is set the regular way
+ *
+ * @param[in] event A handle to the event object
+ * @return FALSE since the host scheduler handles the context switch
+ **/
+
+bool_t osEventSetFromIrq(OsEvent *event)
+{
+   //Set the specified event to the signaled state
+   osEventSet(event);
+   //No context switch has to be requested
+   return FALSE;
+}
+
+
+/**
+ * @brief Create a semaphore object
+ * @param[in] maxCount The maximum count for the semaphore object. This value
+ *   must be greater than zero
+ * @param[in] initialCount The initial count for the semaphore object
+ * @return If the function succeeds, the return value is a handle to the newly
+ *   created semaphore object. If the function fails, the return value is NULL
+ **/
+
+OsSemaphore *osSemaphoreCreate(uint_t maxCount, uint_t initialCount)
+{
+   OsPosixSemaphore *semaphore;
+
+   //Allocate a new semaphore object
+   semaphore = malloc(sizeof(OsPosixSemaphore));
+   //Failed to allocate memory?
+   if(!semaphore) return NULL;
+
+   //Initialize the mutex and the condition variable
+   if(pthread_mutex_init(&semaphore->mutex, NULL))
+   {
+      //Clean up side effects
+      free(semaphore);
+      //Report an error
+      return NULL;
+   }
+
+   if(osPosixCondInit(&semaphore->cond))
+   {
+      //Clean up side effects
+      pthread_mutex_destroy(&semaphore->mutex);
+      free(semaphore);
+      //Report an error
+      return NULL;
+   }
+
+   //Initial count of the semaphore object
+   semaphore->count = initialCount;
+   semaphore->maxCount = maxCount;
+
+   //Return a handle to the newly created semaphore object
+   return (OsSemaphore *) semaphore;
+}
+
+
+/**
+ * @brief Close a semaphore object
+ **/
+
+void osSemaphoreClose(OsSemaphore *semaphore)
+{
+   OsPosixSemaphore *desc = (OsPosixSemaphore *) semaphore;
+
+   //Make sure the handle is valid
+   if(desc)
+   {
+      //Properly dispose the semaphore object
+      pthread_cond_destroy(&desc->cond);
+      pthread_mutex_destroy(&desc->mutex);
+      free(desc);
+   }
+}
+
+
+/**
+ * @brief Wait for the specified semaphore to be available
+ * @param[in] semaphore A handle to the semaphore object
+ * @param[in] timeout Timeout interval, in milliseconds
+ * @return TRUE if the semaphore is available, FALSE if the timeout
+ *   interval elapsed
+ **/
+
+bool_t osSemaphoreWait(OsSemaphore *semaphore, time_t timeout)
+{
+   bool_t available;
+   struct timespec deadline;
+   OsPosixSemaphore *desc = (OsPosixSemaphore *) semaphore;
+
+   //Compute the absolute deadline
+   if(timeout != INFINITE_DELAY)
+      osPosixGetDeadline(&deadline, timeout);
+
+   //Enter critical section
+   pthread_mutex_lock(&desc->mutex);
+
+   //Wait until the count is nonzero or the time-out interval elapses
+   while(desc->count == 0 && timeout != 0)
+   {
+      if(!osPosixCondWait(&desc->cond, &desc->mutex,
+         (timeout != INFINITE_DELAY) ? &deadline : NULL))
+      {
+         break;
+      }
+   }
+
+   //Check whether the semaphore is available
+   available = (desc->count > 0);
+
+   //Decrement the count
+   if(available)
+      desc->count--;
+
+   //Leave critical section
+   pthread_mutex_unlock(&desc->mutex);
+
+   //Return status
+   return available;
+}
+
+
+/**
+ * @brief Release the specified semaphore object
+ * @param[in] semaphore A handle to the semaphore object
+ **/
+
+void osSemaphoreRelease(OsSemaphore *semaphore)
+{
+   OsPosixSemaphore *desc = (OsPosixSemaphore *) semaphore;
+
+   //Enter critical section
+   pthread_mutex_lock(&desc->mutex);
+
+   //Increment the count, up to the maximum value
+   if(desc->count < desc->maxCount)
+   {
+      desc->count++;
+      //Wake up one waiting task
+      pthread_cond_signal(&desc->cond);
+   }
+
+   //Leave critical section
+   pthread_mutex_unlock(&desc->mutex);
+}
+
+
+/**
+ * @brief Create a mutex object
+ * @param[in] initialOwner If this value is TRUE the calling task obtains
+ *   initial ownership of the mutex object. Otherwise, the calling task
+ *   does not obtain ownership of the mutex
+ * @return If the function succeeds, the return value is a handle to the newly
+ *   created mutex object. If the function fails, the return value is NULL
+ **/
+
+OsMutex *osMutexCreate(bool_t initialOwner)
+{
+   //Create an anonymous mutex
+   return osMutexCreateNamed(initialOwner, NULL);
+}
+
+
+/**
+ * @brief Create a named mutex object
+ *
+ * The name identifies the mutex in the lock contention statistics
+ * and must remain valid for the lifetime of the mutex
+ *
+ * @param[in] initialOwner If this value is TRUE the calling task obtains
+ *   initial ownership of the mutex object. Otherwise, the calling task
+ *   does not obtain ownership of the mutex
+ * @param[in] name NULL-terminated string that names the mutex
+ * @return If the function succeeds, the return value is a handle to the newly
+ *   created mutex object. If the function fails, the return value is NULL
+ **/
+
+OsMutex *osMutexCreateNamed(bool_t initialOwner, const char_t *name)
+{
+   OsPosixMutex *mutex;
+
+   //Allocate a new mutex object
+   mutex = malloc(sizeof(OsPosixMutex));
+   //Failed to allocate memory?
+   if(!mutex) return NULL;
+
+   //Initialize the mutex object
+   if(pthread_mutex_init(&mutex->mutex, NULL))
+   {
+      //Clean up side effects
+      free(mutex);
+      //Report an error
+      return NULL;
+   }
+
+#if defined(USE_MUTEX_PROFILING)
+   //Start collecting statistics
+   mutexProfileRegister(&mutex->profile, name);
+#else
+   //The name is only meaningful to the profiler
+   (void) name;
+#endif
+
+   //Get the initial ownership of the mutex?
+   if(initialOwner)
+      osMutexAcquire((OsMutex *) mutex);
+
+   //Return a handle to the newly created mutex
+   return (OsMutex *) mutex;
+}
+
+
+/**
+ * @brief Close a mutex object
+ **/
+
+void osMutexClose(OsMutex *mutex)
+{
+   //Make sure the handle is valid
+   if(mutex)
+   {
+#if defined(USE_MUTEX_PROFILING)
+      //Stop collecting statistics
+      mutexProfileUnregister(&((OsPosixMutex *) mutex)->profile);
+#endif
+      //Properly dispose the specified mutex
+      pthread_mutex_destroy(&((OsPosixMutex *) mutex)->mutex);
+      free(mutex);
+   }
+}
+
+
+/**
+ * @brief Acquire ownership of the specified mutex object
+ * @param[in] mutex A handle to the mutex object
+ **/
+
+void osMutexAcquire(OsMutex *mutex)
+{
+#if defined(USE_MUTEX_PROFILING)
+   bool_t contended;
+   uint32_t requestTime;
+   OsPosixMutex *desc = (OsPosixMutex *) mutex;
+
+   //Save the time at which the mutex is requested
+   requestTime = PROBE_GET_CYCLES();
+   //Check whether the mutex is immediately available
+   contended = (pthread_mutex_trylock(&desc->mutex) != 0);
+
+   //The mutex is owned by another thread?
+   if(contended)
+   {
+      //Block until the mutex is released
+      pthread_mutex_lock(&desc->mutex);
+   }
+
+   //Update statistics
+   mutexProfileAcquired(&desc->profile, requestTime, contended);
+#else
+   //Obtain ownership of the mutex object
+   pthread_mutex_lock(&((OsPosixMutex *) mutex)->mutex);
+#endif
+}
+
+
+/**
+ * @brief Release ownership of the specified mutex object
+ * @param[in] mutex A handle to the mutex object
+ **/
+
+void osMutexRelease(OsMutex *mutex)
+{
+#if defined(USE_MUTEX_PROFILING)
+   //Update statistics before giving the mutex away
+   mutexProfileReleased(&((OsPosixMutex *) mutex)->profile);
+#endif
+   //Release ownership of the mutex object
+   pthread_mutex_unlock(&((OsPosixMutex *) mutex)->mutex);
+}
+
+
+OsQueue *osQueueCreate(uint_t length, size_t itemSize)
+{
+   OsPosixQueue *queue;
+
+   //Allocate a queue object large enough to hold the items
+   queue = malloc(sizeof(OsPosixQueue) + length * itemSize);
+   //Failed to allocate memory?
+   if(!queue) return NULL;
+
+   //Initialize the synchronization objects
+   pthread_mutex_init(&queue->mutex, NULL);
+   osPosixCondInit(&queue->notEmpty);
+   osPosixCondInit(&queue->notFull);
+
+   //Initialize the queue object
+   queue->length = length;
+   queue->itemSize = itemSize;
+   queue->readIndex = 0;
+   queue->count = 0;
+
+   //Return a handle to the newly created queue object
+   return (OsQueue *) queue;
+}
+
+
+void osQueueClose(OsQueue *queue)
+{
+   OsPosixQueue *desc = (OsPosixQueue *) queue;
+
+   //Make sure the handle is valid
+   if(desc)
+   {
+      //Properly dispose the queue object
+      pthread_cond_destroy(&desc->notFull);
+      pthread_cond_destroy(&desc->notEmpty);
+      pthread_mutex_destroy(&desc->mutex);
+      free(desc);
+   }
+}
+
+
+bool_t osQueueSend(OsQueue *queue, const void *item, time_t timeout)
+{
+   uint_t i;
+   bool_t status;
+   struct timespec deadline;
+   OsPosixQueue *desc = (OsPosixQueue *) queue;
+
+   //Compute the absolute deadline
+   if(timeout != INFINITE_DELAY)
+      osPosixGetDeadline(&deadline, timeout);
+
+   //Enter critical section
+   pthread_mutex_lock(&desc->mutex);
+
+   //Wait for room in the queue
+   while(desc->count >= desc->length && timeout != 0)
+   {
+      if(!osPosixCondWait(&desc->notFull, &desc->mutex,
+         (timeout != INFINITE_DELAY) ? &deadline : NULL))
+      {
+         break;
+      }
+   }
+
+   //Any room left in the queue?
+   status = (desc->count < desc->length);
+
+   if(status)
+   {
+      //Index of the first free slot
+      i = (desc->readIndex + desc->count) % desc->length;
+      //Copy the item to the queue
+      memcpy(desc->buffer + i * desc->itemSize, item, desc->itemSize);
+      desc->count++;
+      //Wake up one receiving task
+      pthread_cond_signal(&desc->notEmpty);
+   }
+
+   //Leave critical section
+   pthread_mutex_unlock(&desc->mutex);
+
+   //Return status
+   return status;
+}
+
+
+/**
+ * @brief Retrieve an item from a queue
+ * @param[in] queue A handle to the queue object
+ * @param[out] item Buffer where to copy the item
+ * @param[in] timeout Time-out interval, in milliseconds
+ * @param[in] remove The item is removed from the queue if TRUE
+ * @return TRUE if an item has been retrieved, FALSE otherwise
+ **/
+
+static bool_t osPosixQueueGet(OsQueue *queue, void *item, time_t timeout, bool_t remove)
+{
+   bool_t status;
+   struct timespec deadline;
+   OsPosixQueue *desc = (OsPosixQueue *) queue;
+
+   //Compute the absolute deadline
+   if(timeout != INFINITE_DELAY)
+      osPosixGetDeadline(&deadline, timeout);
+
+   //Enter critical section
+   pthread_mutex_lock(&desc->mutex);
+
+   //Wait for an item to be available
+   while(desc->count == 0 && timeout != 0)
+   {
+      if(!osPosixCondWait(&desc->notEmpty, &desc->mutex,
+         (timeout != INFINITE_DELAY) ? &deadline : NULL))
+      {
+         break;
+      }
+   }
+
+   //Any item available?
+   status = (desc->count > 0);
+
+   if(status)
+   {
+      //Copy the oldest item
+      memcpy(item, desc->buffer + desc->readIndex * desc->itemSize, desc->itemSize);
+
+      //Remove the item from the queue?
+      if(remove)
+      {
+         desc->readIndex = (desc->readIndex + 1) % desc->length;
+         desc->count--;
+         //Wake up one sending task
+         pthread_cond_signal(&desc->notFull);
+      }
+   }
+
+   //Leave critical section
+   pthread_mutex_unlock(&desc->mutex);
+
+   //Return status
+   return status;
+}
+
+
+bool_t osQueueReceive(OsQueue *queue, void *item, time_t timeout)
+{
+   //Retrieve and remove the oldest item
+   return osPosixQueueGet(queue, item, timeout, TRUE);
+}
+
+
+bool_t osQueuePeek(OsQueue *queue, void *item, time_t timeout)
+{
+   //Retrieve the oldest item without removing it
+   return osPosixQueueGet(queue, item, timeout, FALSE);
+}
+
+
+bool_t osQueueSendFromIrq(OsQueue *queue, const void *item, bool_t *higherPriorityTaskWoken)
+{
+   //No context switch has to be requested
+   *higherPriorityTaskWoken = FALSE;
+   //Never wait within an interrupt context
+   return osQueueSend(queue, item, 0);
+}
+
+
+bool_t osQueueReceiveFromIrq(OsQueue *queue, void *item, bool_t *higherPriorityTaskWoken)
+{
+   //No context switch has to be requested
+   *higherPriorityTaskWoken = FALSE;
+   //Never wait within an interrupt context
+   return osQueueReceive(queue, item, 0);
+}
+
+
+void osTimerStart(OsTimer *timer, time_t delay)
+{
+   timer->startTime = osGetTickCount();
+   timer->interval = delay;
+   timer->running = TRUE;
+}
+
+
+void osTimerStop(OsTimer *timer)
+{
+   timer->running = FALSE;
+}
+
+
+bool_t osTimerRunning(OsTimer *timer)
+{
+   //Check whether the timer is currently running
+   return timer->running;
+}
+
+
+bool_t osTimerElapsed(OsTimer *timer)
+{
+   //Make sure the timer is currently running
+   if(!timer->running)
+      return FALSE;
+
+   if(timeCompare(osGetTickCount(), timer->startTime + timer->interval) >= 0)
+      return TRUE;
+   else
+      return FALSE;
+}
+
+
+/**
+ * @brief Allocate a memory block
+ * @param[in] size Bytes to allocate
+ * @return  A pointer to the allocated memory block or NULL if
+ *   there is insufficient memory available
+ **/
+
+void *osMemAlloc(size_t size)
+{
+//TLSF allocator?
+#if defined(USE_TLSF)
+   void *p;
+
+   //Enter critical section
+   osTaskSuspendAll();
+   //Allocate a memory block in constant time
+   p = tlsfAlloc(size);
+   //Leave critical section
+   osTaskResumeAll();
+   //Return a pointer to the newly allocated memory block
+   return p;
+#else
+   //The C library allocator is thread-safe
+   return malloc(size);
+#endif
+}
+
+
+/**
+ * @brief Release a previously allocated memory block
+ * @param[in] p Previously allocated memory block to be freed
+ **/
+
+void osMemFree(void *p)
+{
+//TLSF allocator?
+#if defined(USE_TLSF)
+   //Make sure the pointer is valid
+   if(p != NULL)
+   {
+      //Enter critical section
+      osTaskSuspendAll();
+      //Release the memory block in constant time
+      tlsfFree(p);
+      //Leave critical section
+      osTaskResumeAll();
+   }
+#else
+   //Free memory block
+   free(p);
+#endif
+}
+
+
+/**
+ * @brief 16-bit increment operation
+ * @param[in] n Pointer to a 16-bit to be incremented
+ * @return The value resulting from the increment
+ **/
+
+uint16_t osAtomicInc16(uint16_t *n)
+{
+   //Atomically increment the specified 16-bit integer
+   return __sync_add_and_fetch(n, 1);
+}
+
+
+/**
+ * @brief 32-bit increment operation
+ * @param[in] n Pointer to a 32-bit to be incremented
+ * @return The value resulting from the increment
+ **/
+
+uint32_t osAtomicInc32(uint32_t *n)
+{
+   //Atomically increment the specified 32-bit integer
+   return __sync_add_and_fetch(n, 1);
+}
+
+
+/**
+ * @brief 32-bit decrement operation
+ * @param[in] n Pointer to a 32-bit to be decremented
+ * @return The value resulting from the decrement
+ **/
+
+uint32_t osAtomicDec32(uint32_t *n)
+{
+   //Atomically decrement the specified 32-bit integer
+   return __sync_sub_and_fetch(n, 1);
+}
+
+
+/**
+ * @brief 32-bit addition operation
+ * @param[in] n Pointer to a 32-bit integer to be updated
+ * @param[in] value Value to be added
+ * @return The value resulting from the addition
+ **/
+
+uint32_t osAtomicAdd32(uint32_t *n, uint32_t value)
+{
+   //Atomically add the specified value to the 32-bit integer
+   return __sync_add_and_fetch(n, value);
+}
+
+
+/**
+ * @brief Delay routine
+ * @param[in] delay Amount of time for which the calling task should block
+ **/
+
+void osDelay(time_t delay)
+{
+   struct timespec ts;
+
+   //Convert the delay to seconds and nanoseconds
+   ts.tv_sec = delay / 1000;
+   ts.tv_nsec = (delay % 1000) * 1000000;
+
+   //Sleep for the whole delay, even if interrupted by a signal
+   while(nanosleep(&ts, &ts) && errno == EINTR);
+}
+
+
+/**
+ * @brief Retrieve system time
+ * @return Number of milliseconds elapsed since the system was last started
+ **/
+
+time_t osGetTickCount(void)
+{
+   struct timespec ts;
+
+   //The monotonic clock is not affected by changes of the wall clock
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+
+   //Convert the result to milliseconds
+   return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+
+time_t osGetTime(void)
+{
+   return time(NULL);
+}
+
+
+const char_t *timeFormat(time_t time)
+{
+   static char_t buffer[16];
+   sprintf(buffer, "%lus %03lums", time / 1000, time % 1000);
+   return buffer;
+}
@@ -0,0 +1 @@
+CYCLONETCPSRC += $(CYCLONETCP)/common/ports/Posix/os.c 
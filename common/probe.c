@@ -0,0 +1,171 @@
+/**
+ * @file probe.c
+ * @brief Cycle-accurate instrumentation probes
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Probes time the hot paths of the stack with the cycle counter of the
+ * core (DWT CYCCNT on Cortex-M, TSC on x86). Timings are inclusive: the
+ * cycles spent in a nested probed function are also accounted to the
+ * caller, which is what flame graphs expect. The probes are compiled out
+ * unless USE_PROBES is defined
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Dependencies
+#include <string.h>
+#include "os.h"
+#include "probe.h"
+
+//Statistics of each probe
+static ProbeStats probeStats[PROBE_COUNT];
+
+//Name of each probe
+static const char_t *const probeName[PROBE_COUNT] =
+{
+   "ethProcessFrame",
+   "ipv4ProcessPacket",
+   "ipv6ProcessPacket",
+   "tcpProcessSegment",
+   "udpProcessDatagram",
+   "ipCalcChecksumEx",
+   "nicSendPacket",
+   "tlsWriteRecord",
+   "tlsReadRecord",
+   "socketSend",
+   "socketReceive"
+};
+
+
+/**
+ * @brief Enable the cycle counter and clear the statistics
+ **/
+
+void probeInit(void)
+{
+#if (defined(USE_PROBES) || defined(USE_MUTEX_PROFILING)) && \
+   (defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__))
+   //Enable the trace and debug blocks (DEMCR register)
+   *((volatile uint32_t *) 0xE000EDFC) |= 0x01000000;
+   //Reset the cycle counter (DWT_CYCCNT register)
+   *((volatile uint32_t *) 0xE0001004) = 0;
+   //Enable the cycle counter (DWT_CTRL register)
+   *((volatile uint32_t *) 0xE0001000) |= 0x00000001;
+#endif
+
+   //Clear statistics
+   probeReset();
+}
+
+
+/**
+ * @brief Clear the statistics of all the probes
+ **/
+
+void probeReset(void)
+{
+   //Enter critical section
+   osTaskSuspendAll();
+   //Clear statistics
+   memset(probeStats, 0, sizeof(probeStats));
+   //Leave critical section
+   osTaskResumeAll();
+}
+
+
+/**
+ * @brief Record the duration of a probed block
+ *
+ * This function is invoked automatically when a block instrumented
+ * with PROBE_ENTER is left
+ *
+ * @param[in] context Timing of the block
+ **/
+
+void probeLeave(ProbeContext *context)
+{
+#if defined(USE_PROBES)
+   uint32_t cycles;
+   ProbeStats *stats;
+
+   //Elapsed cycles (the counter may wrap around once)
+   cycles = PROBE_GET_CYCLES() - context->start;
+   //Point to the statistics of the probe
+   stats = &probeStats[context->id];
+
+   //Probed functions run in several tasks
+   osTaskSuspendAll();
+
+   //Update statistics
+   stats->count++;
+   stats->totalCycles += cycles;
+
+   //Keep track of the longest execution
+   if(cycles > stats->maxCycles)
+      stats->maxCycles = cycles;
+
+   //Leave critical section
+   osTaskResumeAll();
+#endif
+}
+
+
+/**
+ * @brief Retrieve the statistics of a probe
+ * @param[in] id Probe identifier
+ * @param[out] stats Consistent snapshot of the statistics
+ **/
+
+void probeGetStats(ProbeId id, ProbeStats *stats)
+{
+   //Invalid probe identifier?
+   if(id >= PROBE_COUNT)
+   {
+      memset(stats, 0, sizeof(ProbeStats));
+      return;
+   }
+
+   //Enter critical section
+   osTaskSuspendAll();
+   //Copy statistics
+   *stats = probeStats[id];
+   //Leave critical section
+   osTaskResumeAll();
+}
+
+
+/**
+ * @brief Get the name of a probe
+ * @param[in] id Probe identifier
+ * @return Name of the probed function
+ **/
+
+const char_t *probeGetName(ProbeId id)
+{
+   //Invalid probe identifier?
+   if(id >= PROBE_COUNT)
+      return "Unknown";
+
+   //Return the name of the probed function
+   return probeName[id];
+}
@@ -0,0 +1,119 @@
+/**
+ * @file probe.h
+ * @brief Cycle-accurate instrumentation probes
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _PROBE_H
+#define _PROBE_H
+
+//Dependencies
+#include "os.h"
+
+//Cycle counter
+#ifndef PROBE_GET_CYCLES
+   #if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+      //DWT cycle count register of Cortex-M3/M4 cores
+      #define PROBE_GET_CYCLES() (*((volatile uint32_t *) 0xE0001004))
+   #elif defined(__GNUC__) && (defined(__i386__) || defined(__x86_64__))
+      //Time stamp counter of x86 processors
+      #define PROBE_GET_CYCLES() ((uint32_t) __builtin_ia32_rdtsc())
+   #else
+      //Fall back to the system tick counter
+      #define PROBE_GET_CYCLES() ((uint32_t) osGetTickCount())
+   #endif
+#endif
+
+//Instrumentation probes are enabled?
+#if defined(USE_PROBES)
+
+//Scope exit hooks are a GCC extension
+#if !defined(__GNUC__)
+   #error USE_PROBES requires a compiler supporting the cleanup attribute
+#endif
+
+//Start timing the enclosing block. The elapsed cycles are recorded
+//automatically when the block is left, whatever the exit path
+#define PROBE_ENTER(id) ProbeContext probeContext \
+   __attribute__((cleanup(probeLeave))) = {id, PROBE_GET_CYCLES()}
+
+#else
+
+//Probes are compiled out
+#define PROBE_ENTER(id)
+
+#endif
+
+
+/**
+ * @brief Instrumentation points
+ **/
+
+typedef enum
+{
+   PROBE_ETH_PROCESS_FRAME = 0,
+   PROBE_IPV4_PROCESS_PACKET,
+   PROBE_IPV6_PROCESS_PACKET,
+   PROBE_TCP_PROCESS_SEGMENT,
+   PROBE_UDP_PROCESS_DATAGRAM,
+   PROBE_IP_CALC_CHECKSUM,
+   PROBE_NIC_SEND_PACKET,
+   PROBE_TLS_WRITE_RECORD,
+   PROBE_TLS_READ_RECORD,
+   PROBE_SOCKET_SEND,
+   PROBE_SOCKET_RECEIVE,
+   PROBE_COUNT
+} ProbeId;
+
+
+/**
+ * @brief Timing of a probed block in progress
+ **/
+
+typedef struct
+{
+   ProbeId id;
+   uint32_t start;
+} ProbeContext;
+
+
+/**
+ * @brief Statistics collected by a probe
+ **/
+
+typedef struct
+{
+   uint32_t count;       ///<Number of times the probed block has been executed
+   uint64_t totalCycles; ///<Cumulated duration, in cycles
+   uint32_t maxCycles;   ///<Longest execution, in cycles
+} ProbeStats;
+
+
+//Instrumentation related functions
+void probeInit(void);
+void probeReset(void);
+void probeLeave(ProbeContext *context);
+void probeGetStats(ProbeId id, ProbeStats *stats);
+const char_t *probeGetName(ProbeId id);
+
+#endif
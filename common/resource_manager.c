@@ -26,126 +26,362 @@
 
 //Dependencies
 #include <string.h>
+#include <ctype.h>
 #include "os.h"
+#include "endian.h"
 #include "resource_manager.h"
 #include "debug.h"
 
+#if (RES_EXTERNAL_SUPPORT == ENABLED)
+
+//Block device holding the resource image
+static const ResStorageDriver *resDriver = NULL;
+//Address of the resource image on the block device
+static uint32_t resBaseAddress;
+//Mutex preventing simultaneous access to the cache
+static OsMutex *resCacheMutex = OS_INVALID_HANDLE;
+//Block cache
+static ResCacheBlock resCache[RES_CACHE_BLOCK_COUNT];
+//Block being read asynchronously
+static ResCacheBlock *resPendingBlock;
+//Counter used to find the least recently used block
+static uint32_t resCacheCounter;
+//Size of the resource image
+static uint32_t resImageSize;
+
+#else
+
 //Resource data
 extern uint8_t res[];
 
+#endif
+
+#if (RES_EXTERNAL_SUPPORT == ENABLED)
+
+error_t resInitStorage(const ResStorageDriver *driver, uint32_t baseAddress)
+{
+   error_t error;
+   uint_t i;
+   uint8_t buffer[4];
+
+   //Check parameters
+   if(driver == NULL || driver->read == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Create a mutex to protect the cache
+   if(resCacheMutex == OS_INVALID_HANDLE)
+      resCacheMutex = osMutexCreate(FALSE);
+
+   //Any error to report?
+   if(resCacheMutex == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Enter critical section
+   osMutexAcquire(resCacheMutex);
+
+   //Wait for any read issued to the previous device
+   resCompleteRead();
+
+   //Save the location of the resource image
+   resDriver = driver;
+   resBaseAddress = baseAddress;
+
+   //Invalidate the cache
+   for(i = 0; i < RES_CACHE_BLOCK_COUNT; i++)
+      resCache[i].valid = FALSE;
+
+   //Leave critical section
+   osMutexRelease(resCacheMutex);
+
+   //The size of the image is not known yet
+   resImageSize = 0;
+
+   //Read the total size of the resource image, which bounds the read-ahead
+   error = resReadData(0, buffer, sizeof(uint32_t));
+   //Any error to report?
+   if(error) return error;
+
+   //Save the size of the image
+   resImageSize = LOAD32LE(buffer);
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+#endif
+
 
 error_t resGetData(const char_t *path, uint8_t **data, size_t *length)
 {
-   bool_t found;
-   bool_t match;
-   uint_t n;
-   uint_t dirLength;
-   ResEntry *resEntry;
+   //Compressed variants are never returned
+   return resGetDataEx(path, 0, data, length, NULL);
+}
+
+
+error_t resGetDataEx(const char_t *path, uint_t acceptedEncodings,
+   uint8_t **data, size_t *length, uint_t *flags)
+{
+#if (RES_EXTERNAL_SUPPORT == ENABLED)
+   //The resource image is not memory-mapped. The file API
+   //must be used instead
+   return ERROR_NOT_IMPLEMENTED;
+#else
+   error_t error;
+   ResEntry resEntry;
+
+   //Search the resource data for the specified file
+   error = resFindEntry(path, acceptedEncodings, &resEntry);
+   //Unable to find the specified file?
+   if(error) return error;
+
+   //Return the location of the specified resource
+   *data = res + resEntry.dataStart;
+   //Return the length of the resource
+   *length = resEntry.dataLength;
+
+   //Return the flags of the resource, if requested
+   if(flags != NULL)
+      *flags = resEntry.type & RES_FLAG_MASK;
+
+   //Successful processing
+   return NO_ERROR;
+#endif
+}
+
+
+uint32_t resGetTag(const uint8_t *data)
+{
+   //The content hash is stored just before the data of the file
+   //(only when RES_FLAG_TAG is set)
+   return LOAD32LE(data - 4);
+}
+
+
+error_t resGetFileTag(const DirEntry *dirEntry, uint32_t *tag)
+{
+   error_t error;
+   uint8_t buffer[4];
+
+   //Make sure the file carries a content hash
+   if(!(dirEntry->type & RES_FLAG_TAG) || dirEntry->dataStart < 4)
+      return ERROR_NOT_FOUND;
+
+   //The content hash is stored just before the data of the file
+   error = resReadData(dirEntry->dataStart - 4, buffer, 4);
+   //Any error to report?
+   if(error) return error;
+
+   //The hash is stored in little-endian byte order
+   *tag = LOAD32LE(buffer);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+error_t resFindEntry(const char_t *path, uint_t acceptedEncodings, ResEntry *entry)
+{
+   error_t error;
+   const ResHeader *resHeader;
+   uint8_t buffer[sizeof(ResHeader)];
 
    //Point to the resource header
-   ResHeader *resHeader = (ResHeader *) res;
+   resHeader = (ResHeader *) resMapData(0, sizeof(ResHeader), buffer);
+   //Failed to read the header?
+   if(resHeader == NULL)
+      return ERROR_READ_FAILED;
 
    //Make sure the resource data is valid
    if(resHeader->totalSize < sizeof(ResHeader))
       return ERROR_INVALID_RESOURCE;
 
-   //Retrieve the length of the root directory
-   dirLength = resHeader->rootEntry.dataLength;
-   //Point to the contents of the root directory
-   resEntry = (ResEntry *) (res + resHeader->rootEntry.dataStart);
+   //Look up the full path in the hash index first
+   error = resSearchIndex(path, acceptedEncodings, entry);
 
-   //Parse the entire path
-   for(found = FALSE; !found && path[0] != '\0'; path += n + 1)
+   //No index, or the path contains components that only the
+   //directory walk can resolve?
+   if(error == ERROR_NOT_CONFIGURED)
+      error = resSearchPath(path, acceptedEncodings, entry);
+
+   //Return status code
+   return error;
+}
+
+
+error_t resSearchIndex(const char_t *path, uint_t acceptedEncodings, ResEntry *entry)
+{
+   uint_t i;
+   uint_t j;
+   uint_t k;
+   uint_t n;
+   uint32_t h;
+   uint32_t offset;
+   uint32_t totalSize;
+   char_t c;
+   bool_t found;
+   ResIndex index;
+   const uint8_t *p;
+   const ResHeader *resHeader;
+   const ResIndexEntry *record;
+   const ResEntry *resEntry;
+   uint8_t buffer[max(sizeof(ResHeader) + sizeof(ResIndex), RES_MAP_BUFFER_SIZE)];
+
+   //Point to the resource header and to the index descriptor
+   p = resMapData(0, sizeof(ResHeader) + sizeof(ResIndex), buffer);
+   //Failed to read data?
+   if(p == NULL)
+      return ERROR_READ_FAILED;
+
+   //Point to the resource header
+   resHeader = (ResHeader *) p;
+
+   //The resource data may not carry an index
+   if(!((uint8_t) resHeader->rootEntry.type & RES_FLAG_INDEX))
+      return ERROR_NOT_CONFIGURED;
+
+   //Save the total size of the resource data
+   totalSize = resHeader->totalSize;
+   //Copy the index descriptor
+   memcpy(&index, p + sizeof(ResHeader), sizeof(ResIndex));
+
+   //The number of buckets must be a power of two
+   if(!index.bucketCount || (index.bucketCount & (index.bucketCount - 1)))
+      return ERROR_INVALID_RESOURCE;
+   //Make sure the bucket table lies within the resource data
+   if(index.dataStart > totalSize || index.bucketCount > ((totalSize - index.dataStart) / 4))
+      return ERROR_INVALID_RESOURCE;
+
+   //The paths are stored without leading separator
+   if(path[0] == '/' || path[0] == '\\')
+      path++;
+
+   //Compute the hash of the path (32-bit FNV-1a, case-insensitive)
+   for(h = 2166136261UL, i = 0, n = 0; ; i++)
    {
-      //Search for the separator that terminates the current token
-      for(n = 0; path[n] != '\\' && path[n] != '/' && path[n] != '\0'; n++);
+      //Get current character
+      c = path[i];
 
-      if(n == 0 && path[n] != '\0')
+      //End of a component?
+      if(c == '/' || c == '\\' || c == '\0')
       {
-         path++;
-         for(n = 0; path[n] != '\\' && path[n] != '/' && path[n] != '\0'; n++);
+         //Empty, . and .. components are left to the directory walk
+         if(i == n || (i == (n + 1) && path[n] == '.') ||
+            (i == (n + 2) && path[n] == '.' && path[n + 1] == '.'))
+         {
+            return ERROR_NOT_CONFIGURED;
+         }
+
+         //End of the path?
+         if(c == '\0') break;
+
+         //Beginning of the next component
+         n = i + 1;
+         //The index uses / as separator
+         c = '/';
       }
 
-      //Loop through the directory
-      for(match = FALSE; !match && dirLength > 0; )
+      //Mix in the current character
+      h ^= (uint8_t) tolower((uint8_t) c);
+      //Multiply by the FNV prime
+      h *= 16777619UL;
+   }
+
+   //No file has been found yet
+   found = FALSE;
+
+   //Probe the table until an empty bucket is found
+   for(j = h & (index.bucketCount - 1), k = 0; k < index.bucketCount; k++)
+   {
+      //Read the current bucket
+      p = resMapData(index.dataStart + j * 4, 4, buffer);
+      //Failed to read data?
+      if(p == NULL)
+         return ERROR_READ_FAILED;
+
+      //Retrieve the offset of the record
+      offset = LOAD32LE(p);
+      //Empty bucket?
+      if(!offset) break;
+
+      //Make sure the record is valid
+      if(offset > (totalSize - sizeof(ResIndexEntry)))
+         return ERROR_INVALID_RESOURCE;
+
+      //Point to the record
+      record = (ResIndexEntry *) resMapData(offset,
+         min(totalSize - offset, sizeof(ResIndexEntry) + 255), buffer);
+      //Failed to read data?
+      if(record == NULL)
+         return ERROR_READ_FAILED;
+
+      //Compare the record against the path
+      if(record->hash == h && record->pathLength == i &&
+         record->pathLength <= (totalSize - offset - sizeof(ResIndexEntry)) &&
+         resComparePath(record->path, path, i))
       {
-         //Check the number of remaining bytes
-         if(dirLength < sizeof(ResEntry))
-            return ERROR_INVALID_RESOURCE;
          //Make sure the entry is valid
-         if(dirLength < (sizeof(ResEntry) + resEntry->nameLength))
+         if(record->entryStart > (totalSize - sizeof(ResEntry)))
             return ERROR_INVALID_RESOURCE;
 
-         //Compare current entry name against the expected one
-         if(resEntry->nameLength == n && !strncasecmp(resEntry->name, path, n))
+         //Point to the corresponding entry
+         resEntry = (ResEntry *) resMapData(record->entryStart, sizeof(ResEntry), buffer);
+         //Failed to read data?
+         if(resEntry == NULL)
+            return ERROR_READ_FAILED;
+
+         //Several variants of the same file may be present. Skip
+         //the variants whose encoding is not acceptable
+         if(!(resEntry->type & RES_ENCODING_MASK & ~acceptedEncodings))
          {
-            //Check the type of the entry
-            if(resEntry->type == RES_TYPE_DIR)
-            {
-               //Save the length of the directory
-               dirLength = resEntry->dataLength;
-               //Point to the contents of the directory
-               resEntry = (ResEntry *) (res + resEntry->dataStart);
-            }
-            else
+            //Compressed variants are preferred
+            if(!found || (resEntry->type & RES_ENCODING_MASK))
             {
-               //A file may only appear at the end of the path
-               if(path[n] != '\0') return ERROR_INVALID_PATH;
-               //The search process is complete
+               //Save the entry
+               memcpy(entry, resEntry, sizeof(ResEntry));
                found = TRUE;
             }
-            //The current entry matches the specified path
-            match = TRUE;
-         }
-         else
-         {
-            //Remaining bytes to process
-            dirLength -= sizeof(ResEntry) + resEntry->nameLength;
-            //Point to the next entry
-            resEntry = (ResEntry *) ((uint8_t *) resEntry + sizeof(ResEntry) + resEntry->nameLength);
          }
       }
 
-      //Unable to find the specified file?
-      if(!match) return ERROR_NOT_FOUND;
+      //Next bucket
+      j = (j + 1) & (index.bucketCount - 1);
    }
 
    //Unable to find the specified file?
    if(!found)
       return ERROR_NOT_FOUND;
-   //Enforce the entry type
-   if(resEntry->type != RES_TYPE_FILE)
-      return ERROR_NOT_FOUND;
-
-   //Return the location of the specified resource
-   *data = res + resEntry->dataStart;
-   //Return the length of the resource
-   *length = resEntry->dataLength;
 
    //Successful processing
    return NO_ERROR;
 }
 
 
-error_t resSearchFile(const char_t *path, DirEntry *dirEntry)
+error_t resSearchPath(const char_t *path, uint_t acceptedEncodings, ResEntry *entry)
 {
    bool_t found;
    bool_t match;
+   bool_t sorted;
+   int_t r;
    uint_t n;
-   uint_t length;
-   ResEntry *resEntry;
+   uint32_t offset;
+   uint32_t dirLength;
+   const ResHeader *resHeader;
+   const ResEntry *resEntry;
+   uint8_t buffer[max(sizeof(ResHeader), RES_MAP_BUFFER_SIZE)];
 
    //Point to the resource header
-   ResHeader *resHeader = (ResHeader *) res;
+   resHeader = (ResHeader *) resMapData(0, sizeof(ResHeader), buffer);
+   //Failed to read the header?
+   if(resHeader == NULL)
+      return ERROR_READ_FAILED;
 
-   //Make sure the resource data is valid
-   if(resHeader->totalSize < sizeof(ResHeader))
-      return ERROR_INVALID_RESOURCE;
+   //Check whether the entries of each directory are sorted by name
+   sorted = ((uint8_t) resHeader->rootEntry.type & RES_FLAG_SORTED) ? TRUE : FALSE;
 
    //Retrieve the length of the root directory
-   length = resHeader->rootEntry.dataLength;
-   //Point to the contents of the root directory
-   resEntry = (ResEntry *) (res + resHeader->rootEntry.dataStart);
+   dirLength = resHeader->rootEntry.dataLength;
+   //Offset of the contents of the root directory
+   offset = resHeader->rootEntry.dataStart;
 
    //Parse the entire path
    for(found = FALSE; !found && path[0] != '\0'; path += n + 1)
@@ -160,60 +396,161 @@ error_t resSearchFile(const char_t *path, DirEntry *dirEntry)
       }
 
       //Loop through the directory
-      for(match = FALSE; !match && length > 0; )
+      for(match = FALSE; !match && dirLength > 0; )
       {
          //Check the number of remaining bytes
-         if(length < sizeof(ResEntry))
+         if(dirLength < sizeof(ResEntry))
             return ERROR_INVALID_RESOURCE;
+
+         //Point to the current entry
+         resEntry = (ResEntry *) resMapData(offset, min(dirLength, RES_MAP_BUFFER_SIZE), buffer);
+         //Failed to read data?
+         if(resEntry == NULL)
+            return ERROR_READ_FAILED;
+
          //Make sure the entry is valid
-         if(length < (sizeof(ResEntry) + resEntry->nameLength))
+         if(dirLength < (sizeof(ResEntry) + resEntry->nameLength))
             return ERROR_INVALID_RESOURCE;
 
          //Compare current entry name against the expected one
-         if(resEntry->nameLength == n && !strncasecmp(resEntry->name, path, n))
+         r = resCompareName(resEntry, path, n);
+
+         //Matching entry?
+         if(!r)
          {
             //Check the type of the entry
             if(resEntry->type == RES_TYPE_DIR)
             {
                //Save the length of the directory
-               length = resEntry->dataLength;
-               //Point to the contents of the directory
-               resEntry = (ResEntry *) (res + resEntry->dataStart);
+               dirLength = resEntry->dataLength;
+               //Offset of the contents of the directory
+               offset = resEntry->dataStart;
+               //The current entry matches the specified path
+               match = TRUE;
             }
             else
             {
                //A file may only appear at the end of the path
                if(path[n] != '\0') return ERROR_INVALID_PATH;
-               //The search process is complete
-               found = TRUE;
+
+               //Several variants of the same file may be present. Skip
+               //the variants whose encoding is not acceptable
+               if(!(resEntry->type & RES_ENCODING_MASK & ~acceptedEncodings))
+               {
+                  //Compressed variants are preferred
+                  if(!found || (resEntry->type & RES_ENCODING_MASK))
+                  {
+                     //Save the entry
+                     memcpy(entry, resEntry, sizeof(ResEntry));
+                     found = TRUE;
+                  }
+               }
+
+               //No need to search any further once a compressed variant
+               //has been selected
+               if(found && (entry->type & RES_ENCODING_MASK))
+                  match = TRUE;
             }
-            //The current entry matches the specified path
-            match = TRUE;
          }
-         else
+         //The expected name cannot appear any further in a sorted directory?
+         else if(r > 0 && sorted)
+         {
+            break;
+         }
+
+         //Move to the next entry if necessary
+         if(!match)
          {
             //Remaining bytes to process
-            length -= sizeof(ResEntry) + resEntry->nameLength;
+            dirLength -= sizeof(ResEntry) + resEntry->nameLength;
             //Point to the next entry
-            resEntry = (ResEntry *) ((uint8_t *) resEntry + sizeof(ResEntry) + resEntry->nameLength);
+            offset += sizeof(ResEntry) + resEntry->nameLength;
          }
       }
 
+      //The last token of the path designates a file?
+      if(found)
+         match = TRUE;
+
       //Unable to find the specified file?
       if(!match) return ERROR_NOT_FOUND;
    }
 
    //Unable to find the specified file?
-   if(!found) return ERROR_NOT_FOUND;
+   if(!found)
+      return ERROR_NOT_FOUND;
+   //Enforce the entry type
+   if((entry->type & RES_TYPE_MASK) != RES_TYPE_FILE)
+      return ERROR_NOT_FOUND;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+int_t resCompareName(const ResEntry *entry, const char_t *name, size_t length)
+{
+   int_t r;
+
+   //Compare the common part of the names
+   r = strncasecmp(entry->name, name, min(entry->nameLength, length));
+
+   //The shorter name sorts first when the common part is identical
+   //(same ordering as the resource compiler)
+   if(!r)
+      r = (int_t) entry->nameLength - (int_t) length;
+
+   //Return comparison result
+   return r;
+}
+
+
+bool_t resComparePath(const char_t *indexPath, const char_t *path, size_t length)
+{
+   size_t i;
+   char_t c;
+
+   //Compare the paths character by character
+   for(i = 0; i < length; i++)
+   {
+      //Both separators are accepted in the path
+      c = (path[i] == '\\') ? '/' : path[i];
+
+      //Case-insensitive comparison
+      if(tolower((uint8_t) c) != tolower((uint8_t) indexPath[i]))
+         return FALSE;
+   }
+
+   //The paths match
+   return TRUE;
+}
+
+
+error_t resSearchFile(const char_t *path, DirEntry *dirEntry)
+{
+   //Compressed variants are not visible through the file API
+   return resSearchFileEx(path, 0, dirEntry);
+}
+
+
+error_t resSearchFileEx(const char_t *path, uint_t acceptedEncodings, DirEntry *dirEntry)
+{
+   error_t error;
+   ResEntry resEntry;
+
+   //Search the resource data for the specified file
+   error = resFindEntry(path, acceptedEncodings, &resEntry);
+   //Unable to find the specified file?
+   if(error) return error;
 
    //Return information about the file
-   dirEntry->type = resEntry->type;
+   dirEntry->type = resEntry.type;
    dirEntry->volume = 0;
-   dirEntry->dataStart = resEntry->dataStart;
-   dirEntry->dataLength = resEntry->dataLength;
-   dirEntry->nameLength = 0; //resEntry->nameLength;
+   dirEntry->dataStart = resEntry.dataStart;
+   dirEntry->dataLength = resEntry.dataLength;
+   dirEntry->nameLength = 0; //resEntry.nameLength;
    //Copy the filename
-   //strncpy(dirEntry->name, resEntry->name, dirEntry->nameLength);
+   //strncpy(dirEntry->name, resEntry.name, dirEntry->nameLength);
    //Properly terminate the filename
    //dirEntry->name[dirEntry->nameLength] = '\0';
 
@@ -235,18 +572,264 @@ error_t resOpenFile(FsFile *file, const DirEntry *dirEntry, uint_t mode)
 
 error_t resSeekFile(FsFile *file, uint32_t *position)
 {
-   return ERROR_NOT_IMPLEMENTED;
+   //Make sure the position lies within the file
+   if(*position > file->size)
+      return ERROR_OUT_OF_RANGE;
+
+   //Move the file pointer
+   file->offset = *position;
+
+   //Successful processing
+   return NO_ERROR;
 }
 
 
 uint_t resReadFile(FsFile *file, void *data, size_t length)
 {
+   error_t error;
+
+   //Do not read past the end of the file
    length = min(length, file->size - file->offset);
-   memcpy(data, res + file->start + file->offset, length);
+
+   //Read the data
+   error = resReadData(file->start + file->offset, data, length);
+   //Any error to report?
+   if(error) return 0;
+
+   //Advance the file pointer
    file->offset += length;
+   //Return the number of bytes read
    return length;
 }
 
+
+const uint8_t *resMapData(uint32_t offset, size_t length, uint8_t *buffer)
+{
+#if (RES_EXTERNAL_SUPPORT == ENABLED)
+   error_t error;
+
+   //Copy the data to the buffer provided by the caller
+   error = resReadData(offset, buffer, length);
+   //Return a pointer to the data
+   return error ? NULL : buffer;
+#else
+   //The resource image is memory-mapped
+   return res + offset;
+#endif
+}
+
+
+error_t resReadData(uint32_t offset, void *data, size_t length)
+{
+#if (RES_EXTERNAL_SUPPORT == ENABLED)
+   error_t error;
+   size_t n;
+   uint8_t *p;
+   ResCacheBlock *block;
+
+   //The block device must be registered first
+   if(resDriver == NULL)
+      return ERROR_NOT_CONFIGURED;
+
+   //Point to the output buffer
+   p = (uint8_t *) data;
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Enter critical section
+   osMutexAcquire(resCacheMutex);
+
+   //Copy the data block by block
+   while(length > 0)
+   {
+      //Load the block containing the current offset
+      error = resLoadBlock(offset & ~(RES_CACHE_BLOCK_SIZE - 1), &block);
+      //Any error to report?
+      if(error) break;
+
+      //Number of bytes to copy from the current block
+      n = min(length, RES_CACHE_BLOCK_SIZE - (offset & (RES_CACHE_BLOCK_SIZE - 1)));
+      //Copy the data
+      memcpy(p, block->data + (offset & (RES_CACHE_BLOCK_SIZE - 1)), n);
+
+      //Advance data pointer
+      p += n;
+      offset += n;
+      length -= n;
+   }
+
+   //Files are mostly read sequentially. Fetch the next block in the
+   //background while the caller processes the data
+   if(!error)
+      resPrefetchBlock((offset + RES_CACHE_BLOCK_SIZE - 1) & ~(RES_CACHE_BLOCK_SIZE - 1));
+
+   //Leave critical section
+   osMutexRelease(resCacheMutex);
+
+   //Return status code
+   return error;
+#else
+   //The resource image is memory-mapped
+   memcpy(data, res + offset, length);
+   //Successful processing
+   return NO_ERROR;
+#endif
+}
+
+
+#if (RES_EXTERNAL_SUPPORT == ENABLED)
+
+error_t resLoadBlock(uint32_t offset, ResCacheBlock **block)
+{
+   error_t error;
+   uint_t i;
+   ResCacheBlock *entry;
+   ResCacheBlock *oldestEntry;
+
+   //Keep track of the least recently used block
+   oldestEntry = &resCache[0];
+
+   //Search the cache for the specified block
+   for(i = 0; i < RES_CACHE_BLOCK_COUNT; i++)
+   {
+      //Point to the current block
+      entry = &resCache[i];
+
+      //Matching block?
+      if(entry->valid && entry->offset == offset)
+      {
+         //The block may still be read in the background
+         if(entry->pending)
+            resCompleteRead();
+
+         //The block may have been discarded if the read failed
+         if(entry->valid)
+         {
+            //Update the time of the last access
+            entry->lastUse = ++resCacheCounter;
+            //Return a pointer to the block
+            *block = entry;
+            //Cache hit
+            return NO_ERROR;
+         }
+      }
+
+      //Free blocks are used first, then the least recently used one
+      if(!entry->valid)
+         oldestEntry = entry;
+      else if(oldestEntry->valid && timeCompare(entry->lastUse, oldestEntry->lastUse) < 0)
+         oldestEntry = entry;
+   }
+
+   //The device cannot process two reads at the same time
+   resCompleteRead();
+
+   //Read the block from the device
+   error = resDriver->read(resBaseAddress + offset, oldestEntry->data, RES_CACHE_BLOCK_SIZE);
+
+   //Check status code
+   if(!error)
+   {
+      //Save the offset of the block
+      oldestEntry->valid = TRUE;
+      oldestEntry->offset = offset;
+      oldestEntry->lastUse = ++resCacheCounter;
+      //Return a pointer to the block
+      *block = oldestEntry;
+   }
+   else
+   {
+      //The contents of the block are lost
+      oldestEntry->valid = FALSE;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+void resPrefetchBlock(uint32_t offset)
+{
+   error_t error;
+   uint_t i;
+   ResCacheBlock *entry;
+   ResCacheBlock *oldestEntry;
+
+   //Asynchronous reads are not supported by the device?
+   if(resDriver->startRead == NULL || resDriver->waitRead == NULL)
+      return;
+   //Only one read may be in progress at a time
+   if(resPendingBlock != NULL)
+      return;
+   //Do not read past the end of the resource image
+   if(offset >= resImageSize)
+      return;
+
+   //Keep track of the least recently used block
+   oldestEntry = &resCache[0];
+
+   //Loop through the cache
+   for(i = 0; i < RES_CACHE_BLOCK_COUNT; i++)
+   {
+      //Point to the current block
+      entry = &resCache[i];
+
+      //The block is already present in the cache?
+      if(entry->valid && entry->offset == offset)
+         return;
+
+      //Free blocks are used first, then the least recently used one
+      if(!entry->valid)
+         oldestEntry = entry;
+      else if(oldestEntry->valid && timeCompare(entry->lastUse, oldestEntry->lastUse) < 0)
+         oldestEntry = entry;
+   }
+
+   //Start reading the block in the background
+   error = resDriver->startRead(resBaseAddress + offset, oldestEntry->data, RES_CACHE_BLOCK_SIZE);
+
+   //Check status code
+   if(!error)
+   {
+      //The block becomes the most recently used one, so that it is
+      //not evicted before the caller gets to it
+      oldestEntry->valid = TRUE;
+      oldestEntry->pending = TRUE;
+      oldestEntry->offset = offset;
+      oldestEntry->lastUse = ++resCacheCounter;
+      //Save a pointer to the block
+      resPendingBlock = oldestEntry;
+   }
+   else
+   {
+      //The contents of the block are lost
+      oldestEntry->valid = FALSE;
+   }
+}
+
+
+void resCompleteRead(void)
+{
+   error_t error;
+
+   //Any read in progress?
+   if(resPendingBlock != NULL)
+   {
+      //Wait for the read to complete
+      error = resDriver->waitRead();
+
+      //The read has completed
+      resPendingBlock->pending = FALSE;
+      //Discard the block if the read failed
+      if(error) resPendingBlock->valid = FALSE;
+
+      //No more read in progress
+      resPendingBlock = NULL;
+   }
+}
+
+#endif
+
 #ifndef _WIN32
 
 FILE *fopen(const char_t *filename, const char_t *mode)
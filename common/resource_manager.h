@@ -28,8 +28,30 @@
 #define _RESOURCE_MANAGER_H
 
 //Dependencies
+#include "os.h"
 #include "error.h"
 
+//External storage support (resource image read from a block device)
+#ifndef RES_EXTERNAL_SUPPORT
+   #define RES_EXTERNAL_SUPPORT DISABLED
+#elif (RES_EXTERNAL_SUPPORT != ENABLED && RES_EXTERNAL_SUPPORT != DISABLED)
+   #error RES_EXTERNAL_SUPPORT parameter is invalid
+#endif
+
+//Size of a cache block
+#ifndef RES_CACHE_BLOCK_SIZE
+   #define RES_CACHE_BLOCK_SIZE 512
+#elif (RES_CACHE_BLOCK_SIZE < 64 || (RES_CACHE_BLOCK_SIZE & (RES_CACHE_BLOCK_SIZE - 1)))
+   #error RES_CACHE_BLOCK_SIZE parameter is invalid
+#endif
+
+//Number of blocks in the cache
+#ifndef RES_CACHE_BLOCK_COUNT
+   #define RES_CACHE_BLOCK_COUNT 8
+#elif (RES_CACHE_BLOCK_COUNT < 2)
+   #error RES_CACHE_BLOCK_COUNT parameter is invalid
+#endif
+
 #define MODE_BINARY 0
 #define MODE_TEXT 1
 
@@ -48,6 +70,26 @@ typedef enum
 } ResType;
 
 
+/**
+ * @brief Resource flags (stored in the upper bits of the type field)
+ **/
+
+typedef enum
+{
+   RES_FLAG_GZIP   = 0x10, ///<The file is stored gzip-compressed
+   RES_FLAG_TAG    = 0x20, ///<A 32-bit content hash precedes the file data
+   RES_FLAG_SORTED = 0x40, ///<Root entry only: directories are sorted by name
+   RES_FLAG_INDEX  = 0x80  ///<Root entry only: a hash index of the file paths is present
+} ResFlags;
+
+//Mask used to retrieve the type of an entry
+#define RES_TYPE_MASK 0x0F
+//Mask used to retrieve the flags of an entry
+#define RES_FLAG_MASK 0xF0
+//Mask used to retrieve the encoding of a file
+#define RES_ENCODING_MASK RES_FLAG_GZIP
+
+
 #ifdef _WIN32
    #define strncasecmp _strnicmp
 #endif
@@ -83,12 +125,44 @@ typedef __packed struct
 } ResHeader;
 
 
+/**
+ * @brief Hash index descriptor (follows the resource header)
+ **/
+
+typedef __packed struct
+{
+   uint32_t dataStart;   ///<Offset of the bucket table
+   uint32_t bucketCount; ///<Number of buckets (power of two)
+} ResIndex;
+
+
+/**
+ * @brief Hash index record
+ **/
+
+typedef __packed struct
+{
+   uint32_t hash;        ///<Hash of the path
+   uint32_t entryStart;  ///<Offset of the corresponding entry
+   uint8_t pathLength;   ///<Length of the path
+   char_t path[];        ///<Full path (no leading separator)
+} ResIndexEntry;
+
+
 #if (defined(__GNUC__) || defined(_WIN32))
    #undef __packed
    #pragma pack(pop)
 #endif
 
 
+//Size of the buffer needed to map an entry or an index record
+#if (RES_EXTERNAL_SUPPORT == ENABLED)
+   #define RES_MAP_BUFFER_SIZE (sizeof(ResEntry) + 255)
+#else
+   #define RES_MAP_BUFFER_SIZE 1
+#endif
+
+
 typedef struct
 {
    uint_t type;
@@ -109,10 +183,55 @@ typedef struct
 } FsFile;
 
 
+#if (RES_EXTERNAL_SUPPORT == ENABLED)
+
+/**
+ * @brief Block device driver
+ *
+ * The asynchronous functions are optional. When provided, the block
+ * following the last one read is fetched in the background (DMA read-ahead)
+ *
+ **/
+
+typedef struct
+{
+   error_t (*read)(uint32_t address, uint8_t *data, size_t length);      ///<Read data (blocking)
+   error_t (*startRead)(uint32_t address, uint8_t *data, size_t length); ///<Start an asynchronous read
+   error_t (*waitRead)(void);                                            ///<Wait for the asynchronous read to complete
+} ResStorageDriver;
+
+
+/**
+ * @brief Cache block
+ **/
+
+typedef struct
+{
+   bool_t valid;                        ///<The block holds data
+   bool_t pending;                      ///<An asynchronous read is in progress
+   uint32_t offset;                     ///<Offset of the block in the resource image
+   uint32_t lastUse;                    ///<Time of the last access (LRU replacement)
+   uint8_t data[RES_CACHE_BLOCK_SIZE];  ///<Contents of the block
+} ResCacheBlock;
+
+#endif
+
+
 //Resource management
 error_t resGetData(const char_t *path, uint8_t **data, size_t *length);
+error_t resGetDataEx(const char_t *path, uint_t acceptedEncodings,
+   uint8_t **data, size_t *length, uint_t *flags);
+uint32_t resGetTag(const uint8_t *data);
+error_t resGetFileTag(const DirEntry *dirEntry, uint32_t *tag);
+
+error_t resFindEntry(const char_t *path, uint_t acceptedEncodings, ResEntry *entry);
+error_t resSearchIndex(const char_t *path, uint_t acceptedEncodings, ResEntry *entry);
+error_t resSearchPath(const char_t *path, uint_t acceptedEncodings, ResEntry *entry);
+int_t resCompareName(const ResEntry *entry, const char_t *name, size_t length);
+bool_t resComparePath(const char_t *indexPath, const char_t *path, size_t length);
 
 error_t resSearchFile(const char_t *path, DirEntry *dirEntry);
+error_t resSearchFileEx(const char_t *path, uint_t acceptedEncodings, DirEntry *dirEntry);
 
 //error_t resOpenDirectory(Directory *directory, const DirEntry *entry);
 //error_t resReadDirectory(Directory *directory, DirEntry *entry);
@@ -121,4 +240,14 @@ error_t resOpenFile(FsFile *file, const DirEntry *dirEntry, uint_t mode);
 error_t resSeekFile(FsFile *file, uint32_t *position);
 uint_t resReadFile(FsFile *file, void *data, size_t length);
 
+const uint8_t *resMapData(uint32_t offset, size_t length, uint8_t *buffer);
+error_t resReadData(uint32_t offset, void *data, size_t length);
+
+#if (RES_EXTERNAL_SUPPORT == ENABLED)
+error_t resInitStorage(const ResStorageDriver *driver, uint32_t baseAddress);
+error_t resLoadBlock(uint32_t offset, ResCacheBlock **block);
+void resPrefetchBlock(uint32_t offset);
+void resCompleteRead(void);
+#endif
+
 #endif
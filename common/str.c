@@ -116,3 +116,52 @@ void strRemoveTrailingSpace(char_t *s)
    //Trim whitespace from the end
    if(end) *end = '\0';
 }
+
+
+/**
+ * @brief Search a memory block for a given substring
+ *
+ * Candidate positions are located with memchr() on the first character
+ * of the substring, and the last character is checked before comparing
+ * the remaining ones, so that most of the input is never examined byte
+ * by byte in C code
+ *
+ * @param[in] s Memory block to search
+ * @param[in] sLen Length of the memory block
+ * @param[in] t Substring to search for
+ * @param[in] tLen Length of the substring
+ * @return The index of the first occurrence of the substring,
+ *   or -1 if the substring does not appear in the memory block
+ **/
+
+int_t strSearch(const char_t *s, size_t sLen, const char_t *t, size_t tLen)
+{
+   const char_t *p;
+   const char_t *end;
+
+   //An empty substring matches at the beginning
+   if(!tLen)
+      return 0;
+   //The substring cannot be longer than the memory block
+   if(tLen > sLen)
+      return -1;
+
+   //Last position where the substring may start
+   end = s + sLen - tLen;
+
+   //Loop through the candidate positions
+   for(p = s; p <= end; p++)
+   {
+      //Search for the first character of the substring
+      p = memchr(p, t[0], end - p + 1);
+      //No more candidates?
+      if(!p) break;
+
+      //Compare the last character, then the remaining ones
+      if(p[tLen - 1] == t[tLen - 1] && !memcmp(p + 1, t + 1, tLen - 1))
+         return p - s;
+   }
+
+   //The substring does not appear in the memory block
+   return -1;
+}
@@ -31,5 +31,6 @@
 char_t *strDuplicate(const char_t *s);
 char_t *strTrimWhitespace(char_t *s);
 void strRemoveTrailingSpace(char_t *s);
+int_t strSearch(const char_t *s, size_t sLen, const char_t *t, size_t tLen);
 
 #endif
@@ -0,0 +1,287 @@
+/**
+ * @file task_registry.c
+ * @brief Task registry (CPU usage and stack high-water marks)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The RTOS ports record every task created through osTaskCreate when
+ * USE_TASK_REGISTRY is defined, so that the stack sizes and the CPU use of
+ * the TCP/IP stack tasks can be checked on the target.
+ *
+ * With FreeRTOS, the amount of free stack is given by
+ * uxTaskGetStackHighWaterMark (INCLUDE_uxTaskGetStackHighWaterMark must be
+ * set to 1) and the CPU time is measured with the probe cycle counter. The
+ * latter requires INCLUDE_xTaskGetCurrentTaskHandle to be set to 1 and the
+ * following lines in FreeRTOSConfig.h:
+ *
+ * void taskRegistrySwitchHook(void);
+ * #define traceTASK_SWITCHED_IN() taskRegistrySwitchHook()
+ *
+ * With the POSIX port, the CPU time of each thread is read from its CPU-time
+ * clock and the stack usage is not available
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Dependencies
+#include "os.h"
+#include "task_registry.h"
+#include "probe.h"
+#include "debug.h"
+
+//Include RTOS dependent headers
+#if defined(USE_FREERTOS)
+   #include "freertos.h"
+   #include "task.h"
+#elif defined(USE_POSIX)
+   #include <time.h>
+   #include <pthread.h>
+#endif
+
+//Registered tasks
+static TaskStats taskRegistry[TASK_REGISTRY_SIZE];
+
+#if defined(USE_FREERTOS)
+//Task currently running (NULL if the task is not registered)
+static TaskStats *taskRegistryCurrent = NULL;
+//Timestamp of the last context switch
+static uint32_t taskRegistrySwitchTime = 0;
+//Cumulated execution time of all the tasks
+static uint64_t taskRegistryTotalTime = 0;
+#endif
+
+
+/**
+ * @brief Register a task
+ *
+ * The task is silently ignored when the registry is full
+ *
+ * @param[in] task Handle of the task
+ * @param[in] name Name of the task
+ * @param[in] stackSize Stack size given at creation
+ **/
+
+void taskRegistryAdd(OsTask *task, const char_t *name, size_t stackSize)
+{
+   uint_t i;
+
+   //Enter critical section
+   osTaskSuspendAll();
+
+   //Look for a free entry
+   for(i = 0; i < TASK_REGISTRY_SIZE; i++)
+   {
+      if(taskRegistry[i].task == NULL)
+      {
+         //Save the task handle and its parameters
+         taskRegistry[i].task = task;
+         taskRegistry[i].name = (name != NULL) ? name : "Unnamed";
+         taskRegistry[i].stackSize = stackSize;
+         taskRegistry[i].stackFree = TASK_REGISTRY_UNKNOWN;
+         taskRegistry[i].cpuTime = 0;
+         break;
+      }
+   }
+
+   //Leave critical section
+   osTaskResumeAll();
+}
+
+
+/**
+ * @brief Unregister a task
+ * @param[in] task Handle of the task
+ **/
+
+void taskRegistryRemove(OsTask *task)
+{
+   uint_t i;
+
+   //Enter critical section
+   osTaskSuspendAll();
+
+   //Look for the corresponding entry
+   for(i = 0; i < TASK_REGISTRY_SIZE; i++)
+   {
+      if(taskRegistry[i].task == task)
+      {
+#if defined(USE_FREERTOS)
+         //A task deleting itself keeps running until the next switch
+         if(taskRegistryCurrent == &taskRegistry[i])
+            taskRegistryCurrent = NULL;
+#endif
+         //Release the entry
+         taskRegistry[i].task = NULL;
+         break;
+      }
+   }
+
+   //Leave critical section
+   osTaskResumeAll();
+}
+
+
+/**
+ * @brief Context switch hook
+ *
+ * This function is called by the kernel each time a task is switched in
+ * and charges the time elapsed since the previous switch to the task
+ * that was running
+ **/
+
+void taskRegistrySwitchHook(void)
+{
+#if defined(USE_FREERTOS)
+   uint_t i;
+   uint32_t time;
+   xTaskHandle task;
+
+   //Time elapsed since the last context switch
+   time = PROBE_GET_CYCLES();
+   taskRegistryTotalTime += time - taskRegistrySwitchTime;
+
+   //Charge the elapsed time to the task that was running
+   if(taskRegistryCurrent != NULL)
+      taskRegistryCurrent->cpuTime += time - taskRegistrySwitchTime;
+
+   //Save the time of the context switch
+   taskRegistrySwitchTime = time;
+
+   //Retrieve the task that is switched in
+   task = xTaskGetCurrentTaskHandle();
+   taskRegistryCurrent = NULL;
+
+   //Look for the corresponding entry
+   for(i = 0; i < TASK_REGISTRY_SIZE; i++)
+   {
+      if(taskRegistry[i].task == (OsTask *) task)
+      {
+         taskRegistryCurrent = &taskRegistry[i];
+         break;
+      }
+   }
+#endif
+}
+
+
+/**
+ * @brief Retrieve the statistics of the registered tasks
+ * @param[out] stats Array where to copy the statistics
+ * @param[in] maxCount Size of the array
+ * @param[out] totalCpuTime Execution time of all the tasks, registered or not
+ * @return Number of entries copied
+ **/
+
+uint_t taskRegistryGetStats(TaskStats *stats, uint_t maxCount, uint64_t *totalCpuTime)
+{
+   uint_t i;
+   uint_t n;
+#if defined(USE_POSIX)
+   clockid_t clock;
+   struct timespec ts;
+#endif
+
+   //Enter critical section
+   osTaskSuspendAll();
+
+   //Loop through the registry
+   for(i = 0, n = 0; i < TASK_REGISTRY_SIZE && n < maxCount; i++)
+   {
+      //Skip free entries
+      if(taskRegistry[i].task == NULL)
+         continue;
+
+      //Copy the current entry
+      stats[n] = taskRegistry[i];
+
+#if defined(USE_FREERTOS) && (INCLUDE_uxTaskGetStackHighWaterMark == 1)
+      //Minimum amount of stack space that has remained
+      stats[n].stackFree = uxTaskGetStackHighWaterMark((xTaskHandle) stats[n].task);
+#elif defined(USE_POSIX)
+      //Read the CPU-time clock of the thread
+      if(!pthread_getcpuclockid((pthread_t) stats[n].task, &clock) &&
+         !clock_gettime(clock, &ts))
+      {
+         stats[n].cpuTime = (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+      }
+#endif
+      //Next entry
+      n++;
+   }
+
+#if defined(USE_FREERTOS)
+   //Execution time of all the tasks
+   *totalCpuTime = taskRegistryTotalTime;
+#elif defined(USE_POSIX)
+   //Execution time of the whole process
+   clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+   *totalCpuTime = (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+#else
+   //CPU usage is not available
+   *totalCpuTime = 0;
+#endif
+
+   //Leave critical section
+   osTaskResumeAll();
+
+   //Return the number of entries
+   return n;
+}
+
+
+/**
+ * @brief Display the statistics of the registered tasks
+ **/
+
+void taskRegistryDump(void)
+{
+   uint_t i;
+   uint_t n;
+   uint_t cpu;
+   uint64_t total;
+   TaskStats stats[TASK_REGISTRY_SIZE];
+
+   //Take a snapshot of the statistics
+   n = taskRegistryGetStats(stats, TASK_REGISTRY_SIZE, &total);
+
+   //Debug message
+   TRACE_INFO("%-28s %8s %8s %7s\r\n", "Task", "Stack", "Free", "CPU");
+
+   //Loop through the registered tasks
+   for(i = 0; i < n; i++)
+   {
+      //CPU usage, in tenths of percent
+      cpu = total ? (uint_t) (stats[i].cpuTime * 1000 / total) : 0;
+
+      //Display the statistics of the current task
+      if(stats[i].stackFree != TASK_REGISTRY_UNKNOWN)
+      {
+         TRACE_INFO("%-28s %8u %8u %5u.%u%%\r\n", stats[i].name, stats[i].stackSize,
+            stats[i].stackFree, cpu / 10, cpu % 10);
+      }
+      else
+      {
+         TRACE_INFO("%-28s %8u %8s %5u.%u%%\r\n", stats[i].name, stats[i].stackSize,
+            "-", cpu / 10, cpu % 10);
+      }
+   }
+}
@@ -0,0 +1,66 @@
+/**
+ * @file task_registry.h
+ * @brief Task registry (CPU usage and stack high-water marks)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _TASK_REGISTRY_H
+#define _TASK_REGISTRY_H
+
+//Dependencies
+#include "os.h"
+
+//Maximum number of tasks that can be tracked
+#ifndef TASK_REGISTRY_SIZE
+   #define TASK_REGISTRY_SIZE 16
+#elif (TASK_REGISTRY_SIZE < 1)
+   #error TASK_REGISTRY_SIZE parameter is not valid
+#endif
+
+//Value reported when the stack usage cannot be determined
+#define TASK_REGISTRY_UNKNOWN ((size_t) -1)
+
+
+/**
+ * @brief Statistics collected for a task
+ **/
+
+typedef struct
+{
+   OsTask *task;       ///<Handle of the task
+   const char_t *name; ///<Name given at creation
+   size_t stackSize;   ///<Stack size given at creation
+   size_t stackFree;   ///<Minimum amount of free stack space ever observed
+   uint64_t cpuTime;   ///<Cumulated execution time
+} TaskStats;
+
+
+//Task registry related functions
+void taskRegistryAdd(OsTask *task, const char_t *name, size_t stackSize);
+void taskRegistryRemove(OsTask *task);
+void taskRegistrySwitchHook(void);
+
+uint_t taskRegistryGetStats(TaskStats *stats, uint_t maxCount, uint64_t *totalCpuTime);
+void taskRegistryDump(void);
+
+#endif
@@ -0,0 +1,504 @@
+/**
+ * @file tlsf.c
+ * @brief TLSF memory allocator
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Two-level segregated fit allocator. Free blocks are kept in lists indexed
+ * by a first-level power-of-two class and a second-level linear subdivision,
+ * and two bitmaps locate a suitable list with a couple of bit scans. Both
+ * allocation and release are O(1), while immediate coalescing keeps
+ * fragmentation bounded
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Dependencies
+#include <string.h>
+#include "os.h"
+#include "error.h"
+#include "tlsf.h"
+#include "debug.h"
+
+//Status bits stored in the size field
+#define TLSF_BLOCK_FREE      0x01
+#define TLSF_BLOCK_PREV_FREE 0x02
+#define TLSF_BLOCK_FLAGS     0x03
+
+//Overhead of a used block
+#define TLSF_BLOCK_OVERHEAD offsetof(TlsfBlock, nextFree)
+//Smallest payload (room for the free list pointers)
+#define TLSF_MIN_BLOCK_SIZE (sizeof(TlsfBlock) - TLSF_BLOCK_OVERHEAD)
+//Largest payload
+#define TLSF_MAX_BLOCK_SIZE (((size_t) 1 << TLSF_FL_INDEX_MAX) - TLSF_ALIGN_SIZE)
+
+//Block helpers
+#define TLSF_BLOCK_SIZE(block) ((block)->size & ~(size_t) TLSF_BLOCK_FLAGS)
+#define TLSF_BLOCK_PAYLOAD(block) ((void *) ((uint8_t *) (block) + TLSF_BLOCK_OVERHEAD))
+#define TLSF_BLOCK_FROM_PAYLOAD(p) ((TlsfBlock *) ((uint8_t *) (p) - TLSF_BLOCK_OVERHEAD))
+#define TLSF_BLOCK_NEXT(block) ((TlsfBlock *) ((uint8_t *) TLSF_BLOCK_PAYLOAD(block) + TLSF_BLOCK_SIZE(block)))
+
+//Round a value up or down to the alignment
+#define TLSF_ALIGN_UP(x) (((x) + TLSF_ALIGN_SIZE - 1) & ~(size_t) (TLSF_ALIGN_SIZE - 1))
+#define TLSF_ALIGN_DOWN(x) ((x) & ~(size_t) (TLSF_ALIGN_SIZE - 1))
+
+//Default heap
+static uint8_t tlsfHeap[TLSF_HEAP_SIZE];
+//Allocator context
+static TlsfContext tlsfContext;
+
+//TLSF related functions
+static uint_t tlsfFls(uint32_t x);
+static uint_t tlsfFfs(uint32_t x);
+static void tlsfMapping(size_t size, uint_t *fl, uint_t *sl);
+static TlsfBlock *tlsfFindSuitable(size_t size, uint_t *fl, uint_t *sl);
+static void tlsfInsertFree(TlsfBlock *block);
+static void tlsfRemoveFree(TlsfBlock *block, uint_t fl, uint_t sl);
+
+
+/**
+ * @brief Set up the heap
+ *
+ * The default heap is used unless this function is called before the
+ * first allocation
+ *
+ * @param[in] heap Memory region to be managed
+ * @param[in] size Size of the memory region
+ * @return Error code
+ **/
+
+error_t tlsfInit(void *heap, size_t size)
+{
+   size_t n;
+   uint8_t *p;
+   TlsfBlock *block;
+   TlsfBlock *sentinel;
+
+   //Check parameters
+   if(!heap)
+      return ERROR_INVALID_PARAMETER;
+
+   //Align the beginning of the region
+   p = (uint8_t *) TLSF_ALIGN_UP((uintptr_t) heap);
+   n = (uintptr_t) p - (uintptr_t) heap;
+
+   //The region must hold at least one block and the sentinel
+   if(size < (n + 2 * TLSF_BLOCK_OVERHEAD + TLSF_MIN_BLOCK_SIZE))
+      return ERROR_INVALID_PARAMETER;
+
+   //Size of the payload of the initial free block
+   n = TLSF_ALIGN_DOWN(size - n - 2 * TLSF_BLOCK_OVERHEAD);
+   //Larger regions cannot be mapped to a free list
+   n = min(n, TLSF_MAX_BLOCK_SIZE);
+
+   //Clear the free lists
+   memset(&tlsfContext, 0, sizeof(TlsfContext));
+
+   //The whole region forms a single free block
+   block = (TlsfBlock *) p;
+   block->prevPhys = NULL;
+   block->size = n | TLSF_BLOCK_FREE;
+
+   //A zero-sized used block terminates the region, so that
+   //no boundary check is needed when merging
+   sentinel = TLSF_BLOCK_NEXT(block);
+   sentinel->prevPhys = block;
+   sentinel->size = TLSF_BLOCK_PREV_FREE;
+
+   //Add the block to the relevant free list
+   tlsfInsertFree(block);
+
+   //Save the size of the heap
+   tlsfContext.stats.heapSize = n + TLSF_BLOCK_OVERHEAD;
+   tlsfContext.stats.largestFree = n;
+   //The heap is now ready
+   tlsfContext.initialized = TRUE;
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Allocate a memory block
+ *
+ * Allocation time does not depend on the number of blocks. Calls to
+ * tlsfAlloc and tlsfFree must be serialized by the caller
+ *
+ * @param[in] size Bytes to allocate
+ * @return Pointer to the allocated block, or NULL if there is
+ *   insufficient memory available
+ **/
+
+void *tlsfAlloc(size_t size)
+{
+   uint_t fl;
+   uint_t sl;
+   size_t n;
+   TlsfBlock *block;
+   TlsfBlock *remaining;
+   TlsfBlock *next;
+
+   //Set up the default heap on first use
+   if(!tlsfContext.initialized)
+      tlsfInit(tlsfHeap, TLSF_HEAP_SIZE);
+
+   //Reject requests that cannot be satisfied
+   if(!size || size > TLSF_MAX_BLOCK_SIZE)
+   {
+      tlsfContext.stats.failCount++;
+      return NULL;
+   }
+
+   //Adjust the size of the payload
+   size = max(TLSF_ALIGN_UP(size), TLSF_MIN_BLOCK_SIZE);
+
+   //Find a free list whose blocks are all large enough
+   block = tlsfFindSuitable(size, &fl, &sl);
+
+   //Out of memory?
+   if(block == NULL)
+   {
+      //Debug message
+      TRACE_WARNING("TLSF: failed to allocate %u bytes\r\n", size);
+      //Update statistics
+      tlsfContext.stats.failCount++;
+      //Report an error
+      return NULL;
+   }
+
+   //Remove the block from its free list
+   tlsfRemoveFree(block, fl, sl);
+
+   //Size of the block
+   n = TLSF_BLOCK_SIZE(block);
+
+   //Split the block if the remainder can form a new block
+   if(n >= (size + TLSF_BLOCK_OVERHEAD + TLSF_MIN_BLOCK_SIZE))
+   {
+      //Resize the block
+      block->size = size | (block->size & TLSF_BLOCK_PREV_FREE);
+
+      //The remainder follows the allocated payload
+      remaining = TLSF_BLOCK_NEXT(block);
+      remaining->prevPhys = block;
+      remaining->size = (n - size - TLSF_BLOCK_OVERHEAD) | TLSF_BLOCK_FREE;
+
+      //Update the physical neighbor of the remainder
+      next = TLSF_BLOCK_NEXT(remaining);
+      next->prevPhys = remaining;
+
+      //Return the remainder to a free list
+      tlsfInsertFree(remaining);
+   }
+   else
+   {
+      //The whole block is used
+      block->size &= ~(size_t) TLSF_BLOCK_FREE;
+
+      //The next block no longer follows a free block
+      next = TLSF_BLOCK_NEXT(block);
+      next->size &= ~(size_t) TLSF_BLOCK_PREV_FREE;
+   }
+
+   //Update statistics
+   tlsfContext.stats.usedSize += TLSF_BLOCK_SIZE(block) + TLSF_BLOCK_OVERHEAD;
+   tlsfContext.stats.peakUsedSize = max(tlsfContext.stats.peakUsedSize,
+      tlsfContext.stats.usedSize);
+   tlsfContext.stats.allocCount++;
+
+   //Return a pointer to the payload
+   return TLSF_BLOCK_PAYLOAD(block);
+}
+
+
+/**
+ * @brief Release a memory block
+ *
+ * The block is immediately merged with its free physical neighbors,
+ * which bounds fragmentation
+ *
+ * @param[in] p Previously allocated memory block to be freed
+ **/
+
+void tlsfFree(void *p)
+{
+   uint_t fl;
+   uint_t sl;
+   TlsfBlock *block;
+   TlsfBlock *prev;
+   TlsfBlock *next;
+
+   //Make sure the pointer is valid
+   if(p == NULL)
+      return;
+
+   //Point to the block header
+   block = TLSF_BLOCK_FROM_PAYLOAD(p);
+
+   //Ignore blocks that have already been released
+   if(block->size & TLSF_BLOCK_FREE)
+      return;
+
+   //Update statistics
+   tlsfContext.stats.usedSize -= TLSF_BLOCK_SIZE(block) + TLSF_BLOCK_OVERHEAD;
+   tlsfContext.stats.freeCount++;
+
+   //Merge with the previous physical block if it is free
+   if(block->size & TLSF_BLOCK_PREV_FREE)
+   {
+      prev = block->prevPhys;
+      tlsfMapping(TLSF_BLOCK_SIZE(prev), &fl, &sl);
+      tlsfRemoveFree(prev, fl, sl);
+
+      prev->size += TLSF_BLOCK_SIZE(block) + TLSF_BLOCK_OVERHEAD;
+      block = prev;
+   }
+
+   //Merge with the next physical block if it is free
+   next = TLSF_BLOCK_NEXT(block);
+
+   if(next->size & TLSF_BLOCK_FREE)
+   {
+      tlsfMapping(TLSF_BLOCK_SIZE(next), &fl, &sl);
+      tlsfRemoveFree(next, fl, sl);
+
+      block->size += TLSF_BLOCK_SIZE(next) + TLSF_BLOCK_OVERHEAD;
+   }
+
+   //Mark the resulting block as free
+   block->size |= TLSF_BLOCK_FREE;
+
+   //Update the physical neighbor
+   next = TLSF_BLOCK_NEXT(block);
+   next->prevPhys = block;
+   next->size |= TLSF_BLOCK_PREV_FREE;
+
+   //Add the block to the relevant free list
+   tlsfInsertFree(block);
+}
+
+
+/**
+ * @brief Get allocator statistics
+ * @param[out] stats Snapshot of the statistics
+ **/
+
+void tlsfGetStats(TlsfStats *stats)
+{
+   uint_t fl;
+   uint_t sl;
+
+   //Enter critical section
+   osTaskSuspendAll();
+
+   //Copy statistics
+   *stats = tlsfContext.stats;
+
+   //The list of the highest class holds the largest blocks
+   if(tlsfContext.flBitmap)
+   {
+      fl = tlsfFls(tlsfContext.flBitmap);
+      sl = tlsfFls(tlsfContext.slBitmap[fl]);
+      stats->largestFree = TLSF_BLOCK_SIZE(tlsfContext.blocks[fl][sl]);
+   }
+   else
+   {
+      stats->largestFree = 0;
+   }
+
+   //Leave critical section
+   osTaskResumeAll();
+}
+
+
+/**
+ * @brief Find last set bit
+ * @param[in] x Non-zero value
+ * @return Index of the most significant bit that is set
+ **/
+
+static uint_t tlsfFls(uint32_t x)
+{
+#if defined(__GNUC__)
+   return 31 - __builtin_clz(x);
+#else
+   uint_t n;
+
+   //Binary search over the 32 bits
+   n = 0;
+   if(x & 0xFFFF0000) { x >>= 16; n += 16; }
+   if(x & 0x0000FF00) { x >>= 8; n += 8; }
+   if(x & 0x000000F0) { x >>= 4; n += 4; }
+   if(x & 0x0000000C) { x >>= 2; n += 2; }
+   if(x & 0x00000002) { n += 1; }
+
+   return n;
+#endif
+}
+
+
+/**
+ * @brief Find first set bit
+ * @param[in] x Non-zero value
+ * @return Index of the least significant bit that is set
+ **/
+
+static uint_t tlsfFfs(uint32_t x)
+{
+   //Isolate the least significant bit
+   return tlsfFls(x & (~x + 1));
+}
+
+
+/**
+ * @brief Map a block size to a free list
+ * @param[in] size Size of the payload
+ * @param[out] fl First-level index
+ * @param[out] sl Second-level index
+ **/
+
+static void tlsfMapping(size_t size, uint_t *fl, uint_t *sl)
+{
+   uint_t n;
+
+   //Small blocks are linearly mapped to the first class
+   if(size < TLSF_SMALL_BLOCK_SIZE)
+   {
+      *fl = 0;
+      *sl = (uint_t) size >> TLSF_ALIGN_SIZE_LOG2;
+   }
+   else
+   {
+      n = tlsfFls((uint32_t) size);
+      *sl = ((uint_t) (size >> (n - TLSF_SL_INDEX_COUNT_LOG2))) ^ TLSF_SL_INDEX_COUNT;
+      *fl = n - (TLSF_FL_INDEX_SHIFT - 1);
+   }
+}
+
+
+/**
+ * @brief Find a free block that is large enough
+ * @param[in] size Size of the payload
+ * @param[out] fl First-level index of the list holding the block
+ * @param[out] sl Second-level index of the list holding the block
+ * @return Pointer to the free block, or NULL if none is found
+ **/
+
+static TlsfBlock *tlsfFindSuitable(size_t size, uint_t *fl, uint_t *sl)
+{
+   uint32_t map;
+
+   //Round the size up to the next list, so that any block
+   //of that list satisfies the request
+   if(size >= TLSF_SMALL_BLOCK_SIZE)
+      size += ((size_t) 1 << (tlsfFls((uint32_t) size) - TLSF_SL_INDEX_COUNT_LOG2)) - 1;
+
+   //Map the size to a free list
+   tlsfMapping(size, fl, sl);
+
+   //The request exceeds the largest class?
+   if(*fl >= TLSF_FL_INDEX_COUNT)
+      return NULL;
+
+   //Search the lists of the same class that hold larger blocks
+   map = tlsfContext.slBitmap[*fl] & (~(uint32_t) 0 << *sl);
+
+   //No suitable list in this class?
+   if(!map)
+   {
+      //Search the next classes
+      if((*fl + 1) >= 32)
+         return NULL;
+
+      map = tlsfContext.flBitmap & (~(uint32_t) 0 << (*fl + 1));
+
+      //No free block is large enough?
+      if(!map)
+         return NULL;
+
+      //Smallest class holding free blocks
+      *fl = tlsfFfs(map);
+      map = tlsfContext.slBitmap[*fl];
+   }
+
+   //Smallest suitable list
+   *sl = tlsfFfs(map);
+
+   //Return the first block of the list
+   return tlsfContext.blocks[*fl][*sl];
+}
+
+
+/**
+ * @brief Add a free block to the relevant list
+ * @param[in] block Pointer to the free block
+ **/
+
+static void tlsfInsertFree(TlsfBlock *block)
+{
+   uint_t fl;
+   uint_t sl;
+
+   //Map the size of the block to a free list
+   tlsfMapping(TLSF_BLOCK_SIZE(block), &fl, &sl);
+
+   //Insert the block at the head of the list
+   block->prevFree = NULL;
+   block->nextFree = tlsfContext.blocks[fl][sl];
+   if(block->nextFree != NULL)
+      block->nextFree->prevFree = block;
+   tlsfContext.blocks[fl][sl] = block;
+
+   //The list is not empty anymore
+   tlsfContext.flBitmap |= 1UL << fl;
+   tlsfContext.slBitmap[fl] |= 1UL << sl;
+}
+
+
+/**
+ * @brief Remove a free block from its list
+ * @param[in] block Pointer to the free block
+ * @param[in] fl First-level index of the list
+ * @param[in] sl Second-level index of the list
+ **/
+
+static void tlsfRemoveFree(TlsfBlock *block, uint_t fl, uint_t sl)
+{
+   //Unlink the block
+   if(block->nextFree != NULL)
+      block->nextFree->prevFree = block->prevFree;
+
+   if(block->prevFree != NULL)
+      block->prevFree->nextFree = block->nextFree;
+   else
+      tlsfContext.blocks[fl][sl] = block->nextFree;
+
+   //Clear the bitmaps when the list becomes empty
+   if(tlsfContext.blocks[fl][sl] == NULL)
+   {
+      tlsfContext.slBitmap[fl] &= ~(1UL << sl);
+
+      if(!tlsfContext.slBitmap[fl])
+         tlsfContext.flBitmap &= ~(1UL << fl);
+   }
+}
@@ -0,0 +1,118 @@
+/**
+ * @file tlsf.h
+ * @brief TLSF memory allocator
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _TLSF_H
+#define _TLSF_H
+
+//Dependencies
+#include "os.h"
+
+//Size of the default heap
+#ifndef TLSF_HEAP_SIZE
+   #define TLSF_HEAP_SIZE 32768
+#elif (TLSF_HEAP_SIZE < 1024)
+   #error TLSF_HEAP_SIZE parameter is invalid
+#endif
+
+//Number of second-level lists per first-level class (log2)
+#ifndef TLSF_SL_INDEX_COUNT_LOG2
+   #define TLSF_SL_INDEX_COUNT_LOG2 4
+#elif (TLSF_SL_INDEX_COUNT_LOG2 < 1 || TLSF_SL_INDEX_COUNT_LOG2 > 5)
+   #error TLSF_SL_INDEX_COUNT_LOG2 parameter is invalid
+#endif
+
+//Largest block size that can be managed (log2)
+#ifndef TLSF_FL_INDEX_MAX
+   #define TLSF_FL_INDEX_MAX 24
+#elif (TLSF_FL_INDEX_MAX < 12 || TLSF_FL_INDEX_MAX > 31)
+   #error TLSF_FL_INDEX_MAX parameter is invalid
+#endif
+
+//Alignment of the allocated blocks
+#define TLSF_ALIGN_SIZE_LOG2 3
+#define TLSF_ALIGN_SIZE (1 << TLSF_ALIGN_SIZE_LOG2)
+
+//Number of second-level lists
+#define TLSF_SL_INDEX_COUNT (1 << TLSF_SL_INDEX_COUNT_LOG2)
+//Blocks below this size are linearly mapped to the first class
+#define TLSF_FL_INDEX_SHIFT (TLSF_SL_INDEX_COUNT_LOG2 + TLSF_ALIGN_SIZE_LOG2)
+#define TLSF_SMALL_BLOCK_SIZE (1 << TLSF_FL_INDEX_SHIFT)
+//Number of first-level classes
+#define TLSF_FL_INDEX_COUNT (TLSF_FL_INDEX_MAX - TLSF_FL_INDEX_SHIFT + 1)
+
+
+/**
+ * @brief Block header
+ *
+ * The free list pointers overlap the payload of used blocks
+ **/
+
+typedef struct _TlsfBlock
+{
+   struct _TlsfBlock *prevPhys; ///<Previous physical block (valid only if that block is free)
+   size_t size;                 ///<Size of the payload, plus status bits
+   struct _TlsfBlock *nextFree; ///<Next free block of the same list
+   struct _TlsfBlock *prevFree; ///<Previous free block of the same list
+} TlsfBlock;
+
+
+/**
+ * @brief Allocator statistics
+ **/
+
+typedef struct
+{
+   size_t heapSize;      ///<Size of the heap available for allocations
+   size_t usedSize;      ///<Number of bytes currently allocated, headers included
+   size_t peakUsedSize;  ///<Highest value reached by usedSize
+   size_t largestFree;   ///<Lower bound of the largest block that can be allocated
+   uint32_t allocCount;  ///<Number of successful allocations
+   uint32_t freeCount;   ///<Number of blocks released
+   uint32_t failCount;   ///<Number of failed allocations
+} TlsfStats;
+
+
+/**
+ * @brief Allocator context
+ **/
+
+typedef struct
+{
+   bool_t initialized;                                          ///<The heap has been set up
+   uint32_t flBitmap;                                           ///<First-level bitmap
+   uint32_t slBitmap[TLSF_FL_INDEX_COUNT];                      ///<Second-level bitmaps
+   TlsfBlock *blocks[TLSF_FL_INDEX_COUNT][TLSF_SL_INDEX_COUNT]; ///<Heads of the free lists
+   TlsfStats stats;                                             ///<Statistics
+} TlsfContext;
+
+
+//TLSF related functions
+error_t tlsfInit(void *heap, size_t size);
+void *tlsfAlloc(size_t size);
+void tlsfFree(void *p);
+void tlsfGetStats(TlsfStats *stats);
+
+#endif
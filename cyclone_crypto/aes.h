@@ -46,6 +46,7 @@ typedef struct
 {
    uint_t nr;
    uint32_t w[60];
+   uint32_t dk[60];
 } AesContext;
 
 
@@ -70,5 +71,7 @@ extern const CipherAlgo aesCipherAlgo;
 error_t aesInit(AesContext *context, const uint8_t *key, size_t keyLength);
 void aesEncryptBlock(AesContext *context, const uint8_t *input, uint8_t *output);
 void aesDecryptBlock(AesContext *context, const uint8_t *input, uint8_t *output);
+void aesEncryptBlocks(AesContext *context, const uint8_t *input, uint8_t *output, size_t n);
+void aesDecryptBlocks(AesContext *context, const uint8_t *input, uint8_t *output, size_t n);
 
 #endif
@@ -0,0 +1,306 @@
+/**
+ * @file aes_ni.c
+ * @brief AES backend using the AES-NI instructions of x86 processors
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The AES instructions are compiled for their own functions, so that the
+ * backend can be part of a generic x86 build. aesNiIsAvailable() tells at
+ * runtime whether the processor supports them, and the software
+ * implementation is used otherwise
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL CRYPTO_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "crypto.h"
+#include "aes.h"
+#include "aes_ni.h"
+
+//Check crypto library configuration
+#if (AES_SUPPORT == ENABLED && (AES_NI_SUPPORT == ENABLED || defined(AES_X86_AES_NI)))
+
+//Dependencies
+#include <wmmintrin.h>
+#if (AES_NI_SUPPORT == ENABLED)
+   #include <cpuid.h>
+#endif
+
+//Generate AES instructions regardless of the options of the compiler
+#define AES_NI_FUNC __attribute__((target("aes,sse2")))
+
+#if (AES_NI_SUPPORT == ENABLED)
+
+//Common interface for encryption algorithms
+const CipherAlgo aesNiCipherAlgo =
+{
+   "AES",
+   sizeof(AesContext),
+   CIPHER_ALGO_TYPE_BLOCK,
+   AES_BLOCK_SIZE,
+   (CipherAlgoInit) aesNiInit,
+   NULL,
+   NULL,
+   (CipherAlgoEncryptBlock) aesNiEncryptBlock,
+   (CipherAlgoDecryptBlock) aesNiDecryptBlock,
+   (CipherAlgoEncryptBlocks) aesNiEncryptBlocks,
+   (CipherAlgoDecryptBlocks) aesNiDecryptBlocks
+};
+
+
+/**
+ * @brief Check whether the processor supports the AES instructions
+ * @return TRUE if AES-NI is available, else FALSE
+ **/
+
+bool_t aesNiIsAvailable(void)
+{
+   unsigned int eax;
+   unsigned int ebx;
+   unsigned int ecx;
+   unsigned int edx;
+
+   //Retrieve the processor features
+   if(!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+      return FALSE;
+
+   //Check the AES flag
+   return (ecx & bit_AES) ? TRUE : FALSE;
+}
+
+
+/**
+ * @brief Key expansion
+ *
+ * The key schedule of the software implementation already has the layout
+ * expected by the AES instructions, including the equivalent inverse
+ * cipher key schedule used by AESDEC
+ *
+ * @param[in] context Pointer to the AES context to initialize
+ * @param[in] key Pointer to the key
+ * @param[in] keyLength Length of the key
+ * @return Error code
+ **/
+
+error_t aesNiInit(AesContext *context, const uint8_t *key, size_t keyLength)
+{
+   //Perform a key expansion
+   return aesInit(context, key, keyLength);
+}
+
+
+/**
+ * @brief Encrypt a 16-byte block using AES-NI
+ * @param[in] context Pointer to the AES context
+ * @param[in] input Plaintext block to encrypt
+ * @param[out] output Ciphertext block resulting from encryption
+ **/
+
+void aesNiEncryptBlock(AesContext *context, const uint8_t *input, uint8_t *output)
+{
+   //Encrypt a single block
+   aesNiEncryptBlocks(context, input, output, 1);
+}
+
+
+/**
+ * @brief Decrypt a 16-byte block using AES-NI
+ * @param[in] context Pointer to the AES context
+ * @param[in] input Ciphertext block to decrypt
+ * @param[out] output Plaintext block resulting from decryption
+ **/
+
+void aesNiDecryptBlock(AesContext *context, const uint8_t *input, uint8_t *output)
+{
+   //Decrypt a single block
+   aesNiDecryptBlocks(context, input, output, 1);
+}
+
+#endif
+
+
+/**
+ * @brief Encrypt consecutive 16-byte blocks using AES-NI
+ *
+ * Four blocks are processed at once so that the latency of the AESENC
+ * instruction is hidden. The output may overlap the input as long as it
+ * does not start after it
+ *
+ * @param[in] context Pointer to the AES context
+ * @param[in] input Plaintext blocks to encrypt
+ * @param[out] output Ciphertext blocks resulting from encryption
+ * @param[in] n Number of blocks
+ **/
+
+AES_NI_FUNC void aesNiEncryptBlocks(AesContext *context, const uint8_t *input, uint8_t *output, size_t n)
+{
+   uint_t i;
+   __m128i k;
+   __m128i s0;
+   __m128i s1;
+   __m128i s2;
+   __m128i s3;
+   const __m128i *rk;
+
+   //Point to the key schedule
+   rk = (const __m128i *) context->w;
+
+   //Process the blocks four at a time
+   while(n >= 4)
+   {
+      //Initial round key addition
+      k = _mm_loadu_si128(rk);
+      s0 = _mm_xor_si128(_mm_loadu_si128((__m128i *) input), k);
+      s1 = _mm_xor_si128(_mm_loadu_si128((__m128i *) (input + 16)), k);
+      s2 = _mm_xor_si128(_mm_loadu_si128((__m128i *) (input + 32)), k);
+      s3 = _mm_xor_si128(_mm_loadu_si128((__m128i *) (input + 48)), k);
+
+      //Apply round function 10, 12 or 14 times depending on the key length
+      for(i = 1; i < context->nr; i++)
+      {
+         k = _mm_loadu_si128(rk + i);
+         s0 = _mm_aesenc_si128(s0, k);
+         s1 = _mm_aesenc_si128(s1, k);
+         s2 = _mm_aesenc_si128(s2, k);
+         s3 = _mm_aesenc_si128(s3, k);
+      }
+
+      //Last round
+      k = _mm_loadu_si128(rk + i);
+      _mm_storeu_si128((__m128i *) output, _mm_aesenclast_si128(s0, k));
+      _mm_storeu_si128((__m128i *) (output + 16), _mm_aesenclast_si128(s1, k));
+      _mm_storeu_si128((__m128i *) (output + 32), _mm_aesenclast_si128(s2, k));
+      _mm_storeu_si128((__m128i *) (output + 48), _mm_aesenclast_si128(s3, k));
+
+      //Next blocks
+      input += 64;
+      output += 64;
+      n -= 4;
+   }
+
+   //Process the remaining blocks
+   while(n > 0)
+   {
+      //Initial round key addition
+      s0 = _mm_xor_si128(_mm_loadu_si128((__m128i *) input), _mm_loadu_si128(rk));
+
+      //Apply round function 10, 12 or 14 times depending on the key length
+      for(i = 1; i < context->nr; i++)
+         s0 = _mm_aesenc_si128(s0, _mm_loadu_si128(rk + i));
+
+      //Last round
+      _mm_storeu_si128((__m128i *) output, _mm_aesenclast_si128(s0, _mm_loadu_si128(rk + i)));
+
+      //Next block
+      input += 16;
+      output += 16;
+      n--;
+   }
+}
+
+
+/**
+ * @brief Decrypt consecutive 16-byte blocks using AES-NI
+ *
+ * The equivalent inverse cipher key schedule computed by aesInit() is the
+ * one expected by the AESDEC instruction. The output may overlap the input
+ * as long as it does not start after it
+ *
+ * @param[in] context Pointer to the AES context
+ * @param[in] input Ciphertext blocks to decrypt
+ * @param[out] output Plaintext blocks resulting from decryption
+ * @param[in] n Number of blocks
+ **/
+
+AES_NI_FUNC void aesNiDecryptBlocks(AesContext *context, const uint8_t *input, uint8_t *output, size_t n)
+{
+   uint_t i;
+   __m128i k;
+   __m128i s0;
+   __m128i s1;
+   __m128i s2;
+   __m128i s3;
+   const __m128i *rk;
+
+   //Point to the key schedule
+   rk = (const __m128i *) context->dk;
+
+   //Process the blocks four at a time
+   while(n >= 4)
+   {
+      //Initial round key addition
+      k = _mm_loadu_si128(rk + context->nr);
+      s0 = _mm_xor_si128(_mm_loadu_si128((__m128i *) input), k);
+      s1 = _mm_xor_si128(_mm_loadu_si128((__m128i *) (input + 16)), k);
+      s2 = _mm_xor_si128(_mm_loadu_si128((__m128i *) (input + 32)), k);
+      s3 = _mm_xor_si128(_mm_loadu_si128((__m128i *) (input + 48)), k);
+
+      //Apply round function 10, 12 or 14 times depending on the key length
+      for(i = context->nr - 1; i > 0; i--)
+      {
+         k = _mm_loadu_si128(rk + i);
+         s0 = _mm_aesdec_si128(s0, k);
+         s1 = _mm_aesdec_si128(s1, k);
+         s2 = _mm_aesdec_si128(s2, k);
+         s3 = _mm_aesdec_si128(s3, k);
+      }
+
+      //Last round
+      k = _mm_loadu_si128(rk);
+      _mm_storeu_si128((__m128i *) output, _mm_aesdeclast_si128(s0, k));
+      _mm_storeu_si128((__m128i *) (output + 16), _mm_aesdeclast_si128(s1, k));
+      _mm_storeu_si128((__m128i *) (output + 32), _mm_aesdeclast_si128(s2, k));
+      _mm_storeu_si128((__m128i *) (output + 48), _mm_aesdeclast_si128(s3, k));
+
+      //Next blocks
+      input += 64;
+      output += 64;
+      n -= 4;
+   }
+
+   //Process the remaining blocks
+   while(n > 0)
+   {
+      //Initial round key addition
+      s0 = _mm_xor_si128(_mm_loadu_si128((__m128i *) input), _mm_loadu_si128(rk + context->nr));
+
+      //Apply round function 10, 12 or 14 times depending on the key length
+      for(i = context->nr - 1; i > 0; i--)
+         s0 = _mm_aesdec_si128(s0, _mm_loadu_si128(rk + i));
+
+      //Last round
+      _mm_storeu_si128((__m128i *) output, _mm_aesdeclast_si128(s0, _mm_loadu_si128(rk)));
+
+      //Next block
+      input += 16;
+      output += 16;
+      n--;
+   }
+}
+
+#endif
@@ -0,0 +1,62 @@
+/**
+ * @file aes_ni.h
+ * @brief AES backend using the AES-NI instructions of x86 processors
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _AES_NI_H
+#define _AES_NI_H
+
+//Dependencies
+#include "crypto.h"
+#include "aes.h"
+
+//The software implementation also relies on the AES instructions
+//when the compiler targets them
+#if (AES_HW_ACCEL_SUPPORT == ENABLED && defined(__GNUC__) && defined(__AES__))
+   #define AES_X86_AES_NI
+#endif
+
+//The AES-NI backend requires an x86 processor and a GCC-compatible compiler
+#if (AES_NI_SUPPORT == ENABLED && (!defined(__GNUC__) || \
+   (!defined(__i386__) && !defined(__x86_64__))))
+   #error AES_NI_SUPPORT requires an x86 target and a GCC-compatible compiler
+#endif
+
+//Common interface for encryption algorithms
+#define AES_NI_CIPHER_ALGO (&aesNiCipherAlgo)
+
+//AES-NI related constants
+extern const CipherAlgo aesNiCipherAlgo;
+
+//AES-NI related functions
+bool_t aesNiIsAvailable(void);
+error_t aesNiInit(AesContext *context, const uint8_t *key, size_t keyLength);
+void aesNiEncryptBlock(AesContext *context, const uint8_t *input, uint8_t *output);
+void aesNiDecryptBlock(AesContext *context, const uint8_t *input, uint8_t *output);
+void aesNiEncryptBlocks(AesContext *context, const uint8_t *input, uint8_t *output, size_t n);
+void aesNiDecryptBlocks(AesContext *context, const uint8_t *input, uint8_t *output, size_t n);
+
+#endif
@@ -51,8 +51,8 @@ static const char_t base64EncTable[64] =
    'w', 'x', 'y', 'z', '0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '+', '/'
 };
 
-//Base64 decoding table
-static const uint8_t base64DecTable[128] =
+//Base64 decoding table (invalid characters map to 0xFF)
+static const uint8_t base64DecTable[256] =
 {
    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
@@ -61,7 +61,15 @@ static const uint8_t base64DecTable[128] =
    0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
    0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
-   0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
+   0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30, 0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+   0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF
 };
 
 
@@ -130,6 +138,10 @@ void base64Encode(const void *input, size_t inputLength, char_t *output, size_t
 error_t base64Decode(const char_t *input, size_t inputLength, void *output, size_t *outputLength)
 {
    uint_t j;
+   uint32_t a;
+   uint32_t b;
+   uint32_t c;
+   uint32_t d;
    uint32_t value;
 
    //Point to the first byte of the output stream
@@ -141,7 +153,31 @@ error_t base64Decode(const char_t *input, size_t inputLength, void *output, size
    if(inputLength % 4)
       return ERROR_INVALID_LENGTH;
 
-   //Process the Base64 encoded string
+   //Decode all the blocks but the last one, which may contain padding
+   while(inputLength > 4)
+   {
+      //Translate the 4 characters of the current block
+      a = base64DecTable[(uint8_t) input[0]];
+      b = base64DecTable[(uint8_t) input[1]];
+      c = base64DecTable[(uint8_t) input[2]];
+      d = base64DecTable[(uint8_t) input[3]];
+
+      //Ensure the characters belong to the Base64 character set
+      if((a | b | c | d) & 0x80)
+         return ERROR_INVALID_CHARACTER;
+
+      //Map the 4-character block to 3 bytes. The fourth byte written by
+      //STORE32BE is overwritten by the next block
+      value = (a << 18) | (b << 12) | (c << 6) | d;
+      STORE32BE(value << 8, p + i);
+
+      //Next block
+      i += 3;
+      input += 4;
+      inputLength -= 4;
+   }
+
+   //Process the last block
    while(inputLength >= 4)
    {
       //Divide the input stream into blocks of 4 characters
@@ -169,7 +205,7 @@ error_t base64Decode(const char_t *input, size_t inputLength, void *output, size
             return NO_ERROR;
          }
          //Ensure the current character belongs to the Base64 character set
-         else if(((uint8_t) *input) > 127 || base64DecTable[(uint8_t) *input] > 63)
+         else if(base64DecTable[(uint8_t) *input] > 63)
          {
             //Decoding failed
             return ERROR_INVALID_CHARACTER;
@@ -285,7 +285,9 @@ const CipherAlgo camelliaCipherAlgo =
    NULL,
    NULL,
    (CipherAlgoEncryptBlock) camelliaEncryptBlock,
-   (CipherAlgoDecryptBlock) camelliaDecryptBlock
+   (CipherAlgoDecryptBlock) camelliaDecryptBlock,
+   NULL,
+   NULL
 };
 
 
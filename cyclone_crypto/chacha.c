@@ -0,0 +1,301 @@
+/**
+ * @file chacha.c
+ * @brief ChaCha encryption algorithm
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * ChaCha is a stream cipher designed by D. J. Bernstein. It is a variant of
+ * Salsa20 with better diffusion per round. Refer to RFC 7539 for more details
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL CRYPTO_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "crypto.h"
+#include "chacha.h"
+
+//Check crypto library configuration
+#if (CHACHA_SUPPORT == ENABLED)
+
+//ChaCha quarter-round function
+#define CHACHA_QUARTER_ROUND(a, b, c, d) \
+{ \
+   a += b; d ^= a; d = ROL32(d, 16); \
+   c += d; b ^= c; b = ROL32(b, 12); \
+   a += b; d ^= a; d = ROL32(d, 8); \
+   c += d; b ^= c; b = ROL32(b, 7); \
+}
+
+//Common interface for encryption algorithms
+const CipherAlgo chacha20CipherAlgo =
+{
+   "ChaCha20",
+   sizeof(ChachaContext),
+   CIPHER_ALGO_TYPE_STREAM,
+   0,
+   (CipherAlgoInit) chacha20Init,
+   (CipherAlgoEncryptStream) chachaCipher,
+   (CipherAlgoDecryptStream) chachaCipher,
+   NULL,
+   NULL,
+   NULL,
+   NULL
+};
+
+
+/**
+ * @brief Initialize a ChaCha20 context using the supplied key
+ *
+ * The nonce and the block counter are set to zero. Use chachaInit
+ * when a nonce must be specified
+ *
+ * @param[in] context Pointer to the ChaCha context to initialize
+ * @param[in] key Pointer to the key
+ * @param[in] keyLength Length of the key
+ * @return Error code
+ **/
+
+error_t chacha20Init(ChachaContext *context, const uint8_t *key, size_t keyLength)
+{
+   uint8_t nonce[12];
+
+   //Use an all-zero nonce
+   memset(nonce, 0, sizeof(nonce));
+   //Initialize ChaCha20 context
+   return chachaInit(context, 20, key, keyLength, nonce, sizeof(nonce));
+}
+
+
+/**
+ * @brief Initialize a ChaCha context using the supplied key and nonce
+ * @param[in] context Pointer to the ChaCha context to initialize
+ * @param[in] nr Number of rounds (8, 12 or 20)
+ * @param[in] key Pointer to the key
+ * @param[in] keyLength Length of the key (16 or 32 bytes)
+ * @param[in] nonce Pointer to the nonce
+ * @param[in] nonceLength Length of the nonce (8 or 12 bytes)
+ * @return Error code
+ **/
+
+error_t chachaInit(ChachaContext *context, uint_t nr, const uint8_t *key,
+   size_t keyLength, const uint8_t *nonce, size_t nonceLength)
+{
+   uint32_t *w;
+
+   //Check parameters
+   if(context == NULL || key == NULL || nonce == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The number of rounds must be 8, 12 or 20
+   if(nr != 8 && nr != 12 && nr != 20)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the number of rounds to be applied
+   context->nr = nr;
+   //Point to the state
+   w = context->state;
+
+   //Check the length of the key
+   if(keyLength == 16)
+   {
+      //The first four words are the constant "expand 16-byte k"
+      w[0] = 0x61707865;
+      w[1] = 0x3120646E;
+      w[2] = 0x79622D36;
+      w[3] = 0x6B206574;
+
+      //The 128-bit key is used twice
+      w[4] = LOAD32LE(key);
+      w[5] = LOAD32LE(key + 4);
+      w[6] = LOAD32LE(key + 8);
+      w[7] = LOAD32LE(key + 12);
+      w[8] = LOAD32LE(key);
+      w[9] = LOAD32LE(key + 4);
+      w[10] = LOAD32LE(key + 8);
+      w[11] = LOAD32LE(key + 12);
+   }
+   else if(keyLength == 32)
+   {
+      //The first four words are the constant "expand 32-byte k"
+      w[0] = 0x61707865;
+      w[1] = 0x3320646E;
+      w[2] = 0x79622D32;
+      w[3] = 0x6B206574;
+
+      //The next eight words are taken from the 256-bit key
+      w[4] = LOAD32LE(key);
+      w[5] = LOAD32LE(key + 4);
+      w[6] = LOAD32LE(key + 8);
+      w[7] = LOAD32LE(key + 12);
+      w[8] = LOAD32LE(key + 16);
+      w[9] = LOAD32LE(key + 20);
+      w[10] = LOAD32LE(key + 24);
+      w[11] = LOAD32LE(key + 28);
+   }
+   else
+   {
+      //Invalid key length
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //Check the length of the nonce
+   if(nonceLength == 8)
+   {
+      //64-bit block counter followed by a 64-bit nonce
+      w[12] = 0;
+      w[13] = 0;
+      w[14] = LOAD32LE(nonce);
+      w[15] = LOAD32LE(nonce + 4);
+   }
+   else if(nonceLength == 12)
+   {
+      //32-bit block counter followed by a 96-bit nonce (RFC 7539)
+      w[12] = 0;
+      w[13] = LOAD32LE(nonce);
+      w[14] = LOAD32LE(nonce + 4);
+      w[15] = LOAD32LE(nonce + 8);
+   }
+   else
+   {
+      //Invalid nonce length
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //No keystream is available yet
+   context->pos = 64;
+
+   //No error to report
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Encrypt/decrypt data with the ChaCha algorithm
+ * @param[in] context Pointer to the ChaCha context
+ * @param[in] input Pointer to the data to encrypt/decrypt (optional)
+ * @param[in] output Pointer to the resulting data
+ * @param[in] length Number of bytes to be processed
+ **/
+
+void chachaCipher(ChachaContext *context, const uint8_t *input, uint8_t *output, size_t length)
+{
+   size_t i;
+   size_t n;
+   uint8_t *k;
+
+   //Process input data
+   while(length > 0)
+   {
+      //Generate a new keystream block if necessary
+      if(context->pos >= 64)
+      {
+         chachaProcessBlock(context);
+         context->pos = 0;
+      }
+
+      //Number of keystream bytes available in the current block
+      n = min(length, 64 - context->pos);
+      //Point to the keystream
+      k = context->block + context->pos;
+
+      //A NULL input pointer returns the raw keystream
+      if(input != NULL)
+      {
+         //XOR the input data with the keystream
+         for(i = 0; i < n; i++)
+            output[i] = input[i] ^ k[i];
+
+         //Advance input pointer
+         input += n;
+      }
+      else
+      {
+         //Copy the keystream
+         for(i = 0; i < n; i++)
+            output[i] = k[i];
+      }
+
+      //Advance data pointer
+      output += n;
+      //Update keystream position
+      context->pos += n;
+      //Remaining bytes to process
+      length -= n;
+   }
+}
+
+
+/**
+ * @brief Generate a 64-byte keystream block
+ * @param[in] context Pointer to the ChaCha context
+ **/
+
+void chachaProcessBlock(ChachaContext *context)
+{
+   uint_t i;
+   uint32_t *w;
+   uint32_t x[16];
+
+   //Point to the state
+   w = context->state;
+
+   //Copy the state to the working state
+   for(i = 0; i < 16; i++)
+      x[i] = w[i];
+
+   //The ChaCha transform alternates column rounds and diagonal rounds
+   for(i = 0; i < context->nr; i += 2)
+   {
+      //Column round
+      CHACHA_QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+      CHACHA_QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+      CHACHA_QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+      CHACHA_QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+
+      //Diagonal round
+      CHACHA_QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+      CHACHA_QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+      CHACHA_QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+      CHACHA_QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+   }
+
+   //Add the original input words to the output words and serialize
+   //the result in little-endian order
+   for(i = 0; i < 16; i++)
+   {
+      x[i] += w[i];
+      STORE32LE(x[i], context->block + i * 4);
+   }
+
+   //Increment block counter. The carry only matters with a 64-bit nonce,
+   //since RFC 7539 limits the keystream to 2^32 blocks per 96-bit nonce
+   if(++w[12] == 0)
+      w[13]++;
+}
+
+#endif
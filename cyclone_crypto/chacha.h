@@ -0,0 +1,69 @@
+/**
+ * @file chacha.h
+ * @brief ChaCha encryption algorithm
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * ChaCha is a stream cipher designed by D. J. Bernstein. It is a variant of
+ * Salsa20 with better diffusion per round. Refer to RFC 7539 for more details
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _CHACHA_H
+#define _CHACHA_H
+
+//Dependencies
+#include "crypto.h"
+
+//Common interface for encryption algorithms
+#define CHACHA20_CIPHER_ALGO (&chacha20CipherAlgo)
+
+
+/**
+ * @brief ChaCha algorithm context
+ **/
+
+typedef struct
+{
+   uint_t nr;
+   uint32_t state[16];
+   uint8_t block[64];
+   size_t pos;
+} ChachaContext;
+
+
+//ChaCha related constants
+extern const CipherAlgo chacha20CipherAlgo;
+
+//ChaCha related functions
+error_t chacha20Init(ChachaContext *context, const uint8_t *key, size_t keyLength);
+
+error_t chachaInit(ChachaContext *context, uint_t nr, const uint8_t *key,
+   size_t keyLength, const uint8_t *nonce, size_t nonceLength);
+
+void chachaCipher(ChachaContext *context, const uint8_t *input, uint8_t *output, size_t length);
+void chachaProcessBlock(ChachaContext *context);
+
+#endif
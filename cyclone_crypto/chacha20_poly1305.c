@@ -0,0 +1,223 @@
+/**
+ * @file chacha20_poly1305.c
+ * @brief ChaCha20Poly1305 AEAD
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * ChaCha20-Poly1305 is an authenticated encryption algorithm that combines
+ * the ChaCha20 stream cipher with the Poly1305 authenticator. Refer to
+ * RFC 7539 for more details
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL CRYPTO_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "crypto.h"
+#include "chacha.h"
+#include "poly1305.h"
+#include "chacha20_poly1305.h"
+
+//Check crypto library configuration
+#if (CHACHA20_POLY1305_SUPPORT == ENABLED)
+
+//ChaCha20Poly1305 related local functions
+static void chacha20Poly1305ComputeTag(Poly1305Context *context,
+   const uint8_t *a, size_t aLen, const uint8_t *c, size_t length, uint8_t *t);
+
+
+/**
+ * @brief Authenticated encryption using ChaCha20Poly1305
+ * @param[in] k Pointer to the 256-bit key
+ * @param[in] kLen Length of the key
+ * @param[in] n Pointer to the 96-bit nonce
+ * @param[in] nLen Length of the nonce
+ * @param[in] a Additional authenticated data
+ * @param[in] aLen Length of the additional data
+ * @param[in] p Plaintext to be encrypted
+ * @param[out] c Ciphertext resulting from the encryption
+ * @param[in] length Total number of data bytes to be encrypted
+ * @param[out] t Authentication tag
+ * @param[in] tLen Length of the authentication tag
+ * @return Error code
+ **/
+
+error_t chacha20Poly1305Encrypt(const uint8_t *k, size_t kLen, const uint8_t *n, size_t nLen,
+   const uint8_t *a, size_t aLen, const uint8_t *p, uint8_t *c, size_t length, uint8_t *t, size_t tLen)
+{
+   error_t error;
+   uint8_t temp[32];
+   ChachaContext chachaContext;
+   Poly1305Context poly1305Context;
+
+   //ChaCha20Poly1305 requires a 256-bit key and a 96-bit nonce
+   if(kLen != 32 || nLen != 12)
+      return ERROR_INVALID_PARAMETER;
+   //The authentication tag is 128 bits long
+   if(tLen != 16)
+      return ERROR_INVALID_PARAMETER;
+
+   //Initialize ChaCha20 context
+   error = chachaInit(&chachaContext, 20, k, kLen, n, nLen);
+   //Any error to report?
+   if(error) return error;
+
+   //The first 32 bytes of the block for counter 0 form the one-time Poly1305 key
+   chachaCipher(&chachaContext, NULL, temp, 32);
+   //The remaining 32 bytes of that block are discarded
+   chachaContext.pos = 64;
+
+   //Encrypt the plaintext, starting with a block counter of 1
+   chachaCipher(&chachaContext, p, c, length);
+
+   //Compute MAC over the AAD and the ciphertext
+   poly1305Init(&poly1305Context, temp);
+   chacha20Poly1305ComputeTag(&poly1305Context, a, aLen, c, length, t);
+
+   //Clear sensitive data
+   memset(temp, 0, sizeof(temp));
+   memset(&chachaContext, 0, sizeof(ChachaContext));
+
+   //Successful encryption
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Authenticated decryption using ChaCha20Poly1305
+ * @param[in] k Pointer to the 256-bit key
+ * @param[in] kLen Length of the key
+ * @param[in] n Pointer to the 96-bit nonce
+ * @param[in] nLen Length of the nonce
+ * @param[in] a Additional authenticated data
+ * @param[in] aLen Length of the additional data
+ * @param[in] c Ciphertext to be decrypted
+ * @param[out] p Plaintext resulting from the decryption
+ * @param[in] length Total number of data bytes to be decrypted
+ * @param[in] t Authentication tag
+ * @param[in] tLen Length of the authentication tag
+ * @return Error code
+ **/
+
+error_t chacha20Poly1305Decrypt(const uint8_t *k, size_t kLen, const uint8_t *n, size_t nLen,
+   const uint8_t *a, size_t aLen, const uint8_t *c, uint8_t *p, size_t length, const uint8_t *t, size_t tLen)
+{
+   error_t error;
+   uint_t i;
+   uint8_t mask;
+   uint8_t temp[32];
+   uint8_t tag[16];
+   ChachaContext chachaContext;
+   Poly1305Context poly1305Context;
+
+   //ChaCha20Poly1305 requires a 256-bit key and a 96-bit nonce
+   if(kLen != 32 || nLen != 12)
+      return ERROR_INVALID_PARAMETER;
+   //The authentication tag is 128 bits long
+   if(tLen != 16)
+      return ERROR_INVALID_PARAMETER;
+
+   //Initialize ChaCha20 context
+   error = chachaInit(&chachaContext, 20, k, kLen, n, nLen);
+   //Any error to report?
+   if(error) return error;
+
+   //The first 32 bytes of the block for counter 0 form the one-time Poly1305 key
+   chachaCipher(&chachaContext, NULL, temp, 32);
+   //The remaining 32 bytes of that block are discarded
+   chachaContext.pos = 64;
+
+   //Compute MAC over the AAD and the ciphertext before decrypting
+   poly1305Init(&poly1305Context, temp);
+   chacha20Poly1305ComputeTag(&poly1305Context, a, aLen, c, length, tag);
+
+   //Compare the tags in constant time
+   for(mask = 0, i = 0; i < 16; i++)
+      mask |= tag[i] ^ t[i];
+
+   //Clear sensitive data
+   memset(temp, 0, sizeof(temp));
+
+   //Wrong authentication tag?
+   if(mask != 0)
+   {
+      //Clear the cipher context
+      memset(&chachaContext, 0, sizeof(ChachaContext));
+      //Report an error
+      return ERROR_FAILURE;
+   }
+
+   //Decrypt the ciphertext, starting with a block counter of 1
+   chachaCipher(&chachaContext, c, p, length);
+   //Clear the cipher context
+   memset(&chachaContext, 0, sizeof(ChachaContext));
+
+   //Successful decryption
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Compute the Poly1305 tag over the AAD and the ciphertext
+ * @param[in] context Pointer to the Poly1305 context
+ * @param[in] a Additional authenticated data
+ * @param[in] aLen Length of the additional data
+ * @param[in] c Ciphertext
+ * @param[in] length Length of the ciphertext
+ * @param[out] t Resulting 128-bit tag
+ **/
+
+static void chacha20Poly1305ComputeTag(Poly1305Context *context,
+   const uint8_t *a, size_t aLen, const uint8_t *c, size_t length, uint8_t *t)
+{
+   uint8_t temp[16];
+
+   //The AAD and the ciphertext are each padded with zeroes to a multiple
+   //of 16 bytes
+   memset(temp, 0, 16);
+
+   //Process the additional authenticated data
+   poly1305Update(context, a, aLen);
+   poly1305Update(context, temp, (16 - (aLen % 16)) % 16);
+
+   //Process the ciphertext
+   poly1305Update(context, c, length);
+   poly1305Update(context, temp, (16 - (length % 16)) % 16);
+
+   //The lengths of the AAD and the ciphertext are encoded as 64-bit
+   //little-endian integers
+   STORE32LE(aLen, temp);
+   STORE32LE(0, temp + 4);
+   STORE32LE(length, temp + 8);
+   STORE32LE(0, temp + 12);
+   poly1305Update(context, temp, 16);
+
+   //Compute the tag
+   poly1305Final(context, t);
+}
+
+#endif
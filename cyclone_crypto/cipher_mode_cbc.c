@@ -106,28 +106,42 @@ error_t cbcDecrypt(const CipherAlgo *cipher, void *context,
    uint8_t *iv, const uint8_t *c, uint8_t *p, size_t length)
 {
    size_t i;
-   uint8_t t[16];
+   size_t n;
+   uint8_t t[CIPHER_BATCH_SIZE * 16];
 
-   //CBC mode operates in a block-by-block fashion
+   //CBC decryption can process several blocks at once
    while(length >= cipher->blockSize)
    {
-      //Save input block
-      memcpy(t, c, cipher->blockSize);
-
-      //Decrypt the current block
-      cipher->decryptBlock(context, c, p);
-
-      //XOR output block with IV contents
+      //Number of blocks to decrypt at once
+      if(cipher->decryptBlocks != NULL)
+         n = min(length / cipher->blockSize, CIPHER_BATCH_SIZE) * cipher->blockSize;
+      else
+         n = cipher->blockSize;
+
+      //Save input blocks
+      memcpy(t, c, n);
+
+      //Decrypt the current blocks
+      if(cipher->decryptBlocks != NULL)
+         cipher->decryptBlocks(context, c, p, n / cipher->blockSize);
+      else
+         cipher->decryptBlock(context, c, p);
+
+      //XOR the first output block with IV contents
       for(i = 0; i < cipher->blockSize; i++)
          p[i] ^= iv[i];
 
-      //Update IV with input block contents
-      memcpy(iv, t, cipher->blockSize);
+      //XOR each subsequent output block with the previous input block
+      for(; i < n; i++)
+         p[i] ^= t[i - cipher->blockSize];
 
-      //Next block
-      c += cipher->blockSize;
-      p += cipher->blockSize;
-      length -= cipher->blockSize;
+      //Update IV with the last input block
+      memcpy(iv, t + n - cipher->blockSize, cipher->blockSize);
+
+      //Next blocks
+      c += n;
+      p += n;
+      length -= n;
    }
 
    //The ciphertext must be a multiple of the block size
@@ -66,12 +66,15 @@
 error_t ccmEncrypt(const CipherAlgo *cipher, void *context, const uint8_t *n, size_t nLen,
    const uint8_t *a, size_t aLen, const uint8_t *p, uint8_t *c, size_t length, uint8_t *t, size_t tLen)
 {
+   size_t i;
+   size_t k;
    size_t m;
    size_t q;
    size_t qLen;
    uint8_t b[16];
    uint8_t y[16];
    uint8_t s[16];
+   uint8_t ks[CIPHER_BATCH_SIZE * 16];
 
    //Check parameters
    if(cipher == NULL || context == NULL)
@@ -184,25 +187,30 @@ error_t ccmEncrypt(const CipherAlgo *cipher, void *context, const uint8_t *n, si
    //Encrypt plaintext
    while(length > 0)
    {
-      //The encryption operates in a block-by-block fashion
-      m = min(length, 16);
+      //Number of counter blocks to encrypt at once
+      k = min((length + 15) / 16, CIPHER_BATCH_SIZE);
+      //Compute S(i) = CIPH(CTR(i)) for the next blocks
+      ccmGenerateKeyStream(cipher, context, b, qLen, ks, k);
 
-      //XOR B(i) with Y(i-1)
-      ccmXorBlock(y, p, y, m);
-      //Compute Y(i) = CIPH(B(i) ^ Y(i-1))
-      cipher->encryptBlock(context, y, y);
+      //The CBC-MAC and the encryption are computed in the same pass
+      for(i = 0; i < k; i++)
+      {
+         //Size of the current block
+         m = min(length, 16);
 
-      //Increment counter
-      ccmIncCounter(b, qLen);
-      //Compute S(i) = CIPH(CTR(i))
-      cipher->encryptBlock(context, b, s);
-      //Compute C(i) = B(i) XOR S(i)
-      ccmXorBlock(c, p, s, m);
-
-      //Next block
-      length -= m;
-      p += m;
-      c += m;
+         //XOR B(i) with Y(i-1)
+         ccmXorBlock(y, p, y, m);
+         //Compute Y(i) = CIPH(B(i) ^ Y(i-1))
+         cipher->encryptBlock(context, y, y);
+
+         //Compute C(i) = B(i) XOR S(i)
+         ccmXorBlock(c, p, ks + 16 * i, m);
+
+         //Next block
+         length -= m;
+         p += m;
+         c += m;
+      }
    }
 
    //Compute MAC
@@ -232,6 +240,8 @@ error_t ccmEncrypt(const CipherAlgo *cipher, void *context, const uint8_t *n, si
 error_t ccmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *n, size_t nLen,
    const uint8_t *a, size_t aLen, const uint8_t *c, uint8_t *p, size_t length, const uint8_t *t, size_t tLen)
 {
+   size_t i;
+   size_t k;
    size_t m;
    size_t q;
    size_t qLen;
@@ -239,6 +249,7 @@ error_t ccmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *n, si
    uint8_t y[16];
    uint8_t r[16];
    uint8_t s[16];
+   uint8_t ks[CIPHER_BATCH_SIZE * 16];
 
    //Check parameters
    if(cipher == NULL || context == NULL)
@@ -351,25 +362,30 @@ error_t ccmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *n, si
    //Decrypt ciphertext
    while(length > 0)
    {
-      //The decryption operates in a block-by-block fashion
-      m = min(length, 16);
+      //Number of counter blocks to encrypt at once
+      k = min((length + 15) / 16, CIPHER_BATCH_SIZE);
+      //Compute S(i) = CIPH(CTR(i)) for the next blocks
+      ccmGenerateKeyStream(cipher, context, b, qLen, ks, k);
 
-      //Increment counter
-      ccmIncCounter(b, qLen);
-      //Compute S(i) = CIPH(CTR(i))
-      cipher->encryptBlock(context, b, s);
-      //Compute B(i) = C(i) XOR S(i)
-      ccmXorBlock(p, c, s, m);
-
-      //XOR B(i) with Y(i-1)
-      ccmXorBlock(y, p, y, m);
-      //Compute Y(i) = CIPH(B(i) ^ Y(i-1))
-      cipher->encryptBlock(context, y, y);
+      //The decryption and the CBC-MAC are computed in the same pass
+      for(i = 0; i < k; i++)
+      {
+         //Size of the current block
+         m = min(length, 16);
+
+         //Compute B(i) = C(i) XOR S(i)
+         ccmXorBlock(p, c, ks + 16 * i, m);
+
+         //XOR B(i) with Y(i-1)
+         ccmXorBlock(y, p, y, m);
+         //Compute Y(i) = CIPH(B(i) ^ Y(i-1))
+         cipher->encryptBlock(context, y, y);
 
-      //Next block
-      length -= m;
-      c += m;
-      p += m;
+         //Next block
+         length -= m;
+         c += m;
+         p += m;
+      }
    }
 
    //Compute MAC
@@ -396,9 +412,21 @@ void ccmXorBlock(uint8_t *a, const uint8_t *b, const uint8_t *c, size_t n)
 {
    size_t i;
 
-   //Perform XOR operation
-   for(i = 0; i < n; i++)
-      a[i] = b[i] ^ c[i];
+   //Full blocks are processed one 32-bit word at a time, provided
+   //that all the buffers are suitably aligned
+   if(n == 16 && !(((uintptr_t) a | (uintptr_t) b | (uintptr_t) c) & 3))
+   {
+      ((uint32_t *) a)[0] = ((const uint32_t *) b)[0] ^ ((const uint32_t *) c)[0];
+      ((uint32_t *) a)[1] = ((const uint32_t *) b)[1] ^ ((const uint32_t *) c)[1];
+      ((uint32_t *) a)[2] = ((const uint32_t *) b)[2] ^ ((const uint32_t *) c)[2];
+      ((uint32_t *) a)[3] = ((const uint32_t *) b)[3] ^ ((const uint32_t *) c)[3];
+   }
+   else
+   {
+      //Perform XOR operation
+      for(i = 0; i < n; i++)
+         a[i] = b[i] ^ c[i];
+   }
 }
 
 
@@ -422,4 +450,45 @@ void ccmIncCounter(uint8_t *a, size_t n)
    }
 }
 
+
+/**
+ * @brief Generate the key stream for consecutive blocks
+ *
+ * The counter blocks are encrypted in a single call when the cipher
+ * provides a multi-block implementation
+ *
+ * @param[in] cipher Cipher algorithm
+ * @param[in] context Cipher algorithm context
+ * @param[in,out] ctr Counter block (incremented before each block)
+ * @param[in] qLen Size in bytes of the counter field
+ * @param[out] s Resulting key stream (n blocks)
+ * @param[in] n Number of blocks to generate
+ **/
+
+void ccmGenerateKeyStream(const CipherAlgo *cipher, void *context,
+   uint8_t *ctr, size_t qLen, uint8_t *s, size_t n)
+{
+   size_t i;
+
+   //Generate the successive counter blocks
+   for(i = 0; i < n; i++)
+   {
+      //Increment counter
+      ccmIncCounter(ctr, qLen);
+      //Save the counter block
+      memcpy(s + 16 * i, ctr, 16);
+   }
+
+   //Encrypt the counter blocks
+   if(cipher->encryptBlocks != NULL)
+   {
+      cipher->encryptBlocks(context, s, s, n);
+   }
+   else
+   {
+      for(i = 0; i < n; i++)
+         cipher->encryptBlock(context, s + 16 * i, s + 16 * i);
+   }
+}
+
 #endif
@@ -42,4 +42,7 @@ error_t ccmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *n, si
 void ccmXorBlock(uint8_t *a, const uint8_t *b, const uint8_t *c, size_t n);
 void ccmIncCounter(uint8_t *a, size_t n);
 
+void ccmGenerateKeyStream(const CipherAlgo *cipher, void *context,
+   uint8_t *ctr, size_t qLen, uint8_t *s, size_t n);
+
 #endif
@@ -62,8 +62,10 @@ error_t ctrEncrypt(const CipherAlgo *cipher, void *context, uint_t m,
    uint8_t *t, const uint8_t *p, uint8_t *c, size_t length)
 {
    size_t i;
+   size_t j;
+   size_t k;
    size_t n;
-   uint8_t o[16];
+   uint8_t o[CIPHER_BATCH_SIZE * 16];
 
    //The parameter must be a multiple of 8
    if(m % 8)
@@ -80,25 +82,41 @@ error_t ctrEncrypt(const CipherAlgo *cipher, void *context, uint_t m,
    //Process plaintext
    while(length > 0)
    {
-      //CTR mode operates in a block-by-block fashion
-      n = min(length, cipher->blockSize);
+      //Number of counter blocks to encrypt at once
+      if(cipher->encryptBlocks != NULL)
+         k = min((length + cipher->blockSize - 1) / cipher->blockSize, CIPHER_BATCH_SIZE);
+      else
+         k = 1;
+
+      //Generate the counter blocks
+      for(j = 0; j < k; j++)
+      {
+         //Copy the current counter block T(j)
+         memcpy(o + j * cipher->blockSize, t, cipher->blockSize);
+
+         //Standard incrementing function
+         for(i = 0; i < m; i++)
+         {
+            //Increment the current byte and propagate the carry if necessary
+            if(++(t[cipher->blockSize - 1 - i]) != 0)
+               break;
+         }
+      }
 
       //Compute O(j) = CIPH(T(j))
-      cipher->encryptBlock(context, t, o);
+      if(cipher->encryptBlocks != NULL)
+         cipher->encryptBlocks(context, o, o, k);
+      else
+         cipher->encryptBlock(context, o, o);
+
+      //Number of bytes covered by the key stream
+      n = min(length, k * cipher->blockSize);
 
-      //Compute C(j) = P(j) XOR T(j)
+      //Compute C(j) = P(j) XOR O(j)
       for(i = 0; i < n; i++)
          c[i] = p[i] ^ o[i];
 
-      //Standard incrementing function
-      for(i = 0; i < m; i++)
-      {
-         //Increment the current byte and propagate the carry if necessary
-         if(++(t[cipher->blockSize - 1 - i]) != 0)
-            break;
-      }
-
-      //Next block
+      //Next blocks
       p += n;
       c += n;
       length -= n;
@@ -125,8 +143,10 @@ error_t ctrDecrypt(const CipherAlgo *cipher, void *context, uint_t m,
    uint8_t *t, const uint8_t *c, uint8_t *p, size_t length)
 {
    size_t i;
+   size_t j;
+   size_t k;
    size_t n;
-   uint8_t o[16];
+   uint8_t o[CIPHER_BATCH_SIZE * 16];
 
    //The parameter must be a multiple of 8
    if(m % 8)
@@ -143,25 +163,41 @@ error_t ctrDecrypt(const CipherAlgo *cipher, void *context, uint_t m,
    //Process ciphertext
    while(length > 0)
    {
-      //CTR mode operates in a block-by-block fashion
-      n = min(length, cipher->blockSize);
+      //Number of counter blocks to encrypt at once
+      if(cipher->encryptBlocks != NULL)
+         k = min((length + cipher->blockSize - 1) / cipher->blockSize, CIPHER_BATCH_SIZE);
+      else
+         k = 1;
+
+      //Generate the counter blocks
+      for(j = 0; j < k; j++)
+      {
+         //Copy the current counter block T(j)
+         memcpy(o + j * cipher->blockSize, t, cipher->blockSize);
+
+         //Standard incrementing function
+         for(i = 0; i < m; i++)
+         {
+            //Increment the current byte and propagate the carry if necessary
+            if(++(t[cipher->blockSize - 1 - i]) != 0)
+               break;
+         }
+      }
 
       //Compute O(j) = CIPH(T(j))
-      cipher->encryptBlock(context, t, o);
+      if(cipher->encryptBlocks != NULL)
+         cipher->encryptBlocks(context, o, o, k);
+      else
+         cipher->encryptBlock(context, o, o);
+
+      //Number of bytes covered by the key stream
+      n = min(length, k * cipher->blockSize);
 
-      //Compute P(j) = C(j) XOR T(j)
+      //Compute P(j) = C(j) XOR O(j)
       for(i = 0; i < n; i++)
          p[i] = c[i] ^ o[i];
 
-      //Standard incrementing function
-      for(i = 0; i < m; i++)
-      {
-         //Increment the current byte and propagate the carry if necessary
-         if(++(t[cipher->blockSize - 1 - i]) != 0)
-            break;
-      }
-
-      //Next block
+      //Next blocks
       c += n;
       p += n;
       length -= n;
@@ -59,6 +59,20 @@
 error_t ecbEncrypt(const CipherAlgo *cipher, void *context,
    const uint8_t *p, uint8_t *c, size_t length)
 {
+   size_t n;
+
+   //Multi-block implementation available?
+   if(cipher->encryptBlocks != NULL)
+   {
+      //Number of complete blocks
+      n = length / cipher->blockSize;
+      //Encrypt all the blocks at once
+      cipher->encryptBlocks(context, p, c, n);
+
+      //Remaining bytes
+      length -= n * cipher->blockSize;
+   }
+
    //ECB mode operates in a block-by-block fashion
    while(length >= cipher->blockSize)
    {
@@ -93,6 +107,20 @@ error_t ecbEncrypt(const CipherAlgo *cipher, void *context,
 error_t ecbDecrypt(const CipherAlgo *cipher, void *context,
    const uint8_t *c, uint8_t *p, size_t length)
 {
+   size_t n;
+
+   //Multi-block implementation available?
+   if(cipher->decryptBlocks != NULL)
+   {
+      //Number of complete blocks
+      n = length / cipher->blockSize;
+      //Decrypt all the blocks at once
+      cipher->decryptBlocks(context, c, p, n);
+
+      //Remaining bytes
+      length -= n * cipher->blockSize;
+   }
+
    //ECB mode operates in a block-by-block fashion
    while(length >= cipher->blockSize)
    {
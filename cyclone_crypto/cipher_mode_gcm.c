@@ -44,6 +44,48 @@
 //Check crypto library configuration
 #if (GCM_SUPPORT == ENABLED)
 
+//Reduction of the bits shifted out when multiplying by x^w
+static const uint16_t gcmReductionTable[GCM_TABLE_N] =
+{
+#if (GCM_TABLE_W == 4)
+   0x0000, 0x1C20, 0x3840, 0x2460, 0x7080, 0x6CA0, 0x48C0, 0x54E0,
+   0xE100, 0xFD20, 0xD940, 0xC560, 0x9180, 0x8DA0, 0xA9C0, 0xB5E0
+#else
+   0x0000, 0x01C2, 0x0384, 0x0246, 0x0708, 0x06CA, 0x048C, 0x054E,
+   0x0E10, 0x0FD2, 0x0D94, 0x0C56, 0x0918, 0x08DA, 0x0A9C, 0x0B5E,
+   0x1C20, 0x1DE2, 0x1FA4, 0x1E66, 0x1B28, 0x1AEA, 0x18AC, 0x196E,
+   0x1230, 0x13F2, 0x11B4, 0x1076, 0x1538, 0x14FA, 0x16BC, 0x177E,
+   0x3840, 0x3982, 0x3BC4, 0x3A06, 0x3F48, 0x3E8A, 0x3CCC, 0x3D0E,
+   0x3650, 0x3792, 0x35D4, 0x3416, 0x3158, 0x309A, 0x32DC, 0x331E,
+   0x2460, 0x25A2, 0x27E4, 0x2626, 0x2368, 0x22AA, 0x20EC, 0x212E,
+   0x2A70, 0x2BB2, 0x29F4, 0x2836, 0x2D78, 0x2CBA, 0x2EFC, 0x2F3E,
+   0x7080, 0x7142, 0x7304, 0x72C6, 0x7788, 0x764A, 0x740C, 0x75CE,
+   0x7E90, 0x7F52, 0x7D14, 0x7CD6, 0x7998, 0x785A, 0x7A1C, 0x7BDE,
+   0x6CA0, 0x6D62, 0x6F24, 0x6EE6, 0x6BA8, 0x6A6A, 0x682C, 0x69EE,
+   0x62B0, 0x6372, 0x6134, 0x60F6, 0x65B8, 0x647A, 0x663C, 0x67FE,
+   0x48C0, 0x4902, 0x4B44, 0x4A86, 0x4FC8, 0x4E0A, 0x4C4C, 0x4D8E,
+   0x46D0, 0x4712, 0x4554, 0x4496, 0x41D8, 0x401A, 0x425C, 0x439E,
+   0x54E0, 0x5522, 0x5764, 0x56A6, 0x53E8, 0x522A, 0x506C, 0x51AE,
+   0x5AF0, 0x5B32, 0x5974, 0x58B6, 0x5DF8, 0x5C3A, 0x5E7C, 0x5FBE,
+   0xE100, 0xE0C2, 0xE284, 0xE346, 0xE608, 0xE7CA, 0xE58C, 0xE44E,
+   0xEF10, 0xEED2, 0xEC94, 0xED56, 0xE818, 0xE9DA, 0xEB9C, 0xEA5E,
+   0xFD20, 0xFCE2, 0xFEA4, 0xFF66, 0xFA28, 0xFBEA, 0xF9AC, 0xF86E,
+   0xF330, 0xF2F2, 0xF0B4, 0xF176, 0xF438, 0xF5FA, 0xF7BC, 0xF67E,
+   0xD940, 0xD882, 0xDAC4, 0xDB06, 0xDE48, 0xDF8A, 0xDDCC, 0xDC0E,
+   0xD750, 0xD692, 0xD4D4, 0xD516, 0xD058, 0xD19A, 0xD3DC, 0xD21E,
+   0xC560, 0xC4A2, 0xC6E4, 0xC726, 0xC268, 0xC3AA, 0xC1EC, 0xC02E,
+   0xCB70, 0xCAB2, 0xC8F4, 0xC936, 0xCC78, 0xCDBA, 0xCFFC, 0xCE3E,
+   0x9180, 0x9042, 0x9204, 0x93C6, 0x9688, 0x974A, 0x950C, 0x94CE,
+   0x9F90, 0x9E52, 0x9C14, 0x9DD6, 0x9898, 0x995A, 0x9B1C, 0x9ADE,
+   0x8DA0, 0x8C62, 0x8E24, 0x8FE6, 0x8AA8, 0x8B6A, 0x892C, 0x88EE,
+   0x83B0, 0x8272, 0x8034, 0x81F6, 0x84B8, 0x857A, 0x873C, 0x86FE,
+   0xA9C0, 0xA802, 0xAA44, 0xAB86, 0xAEC8, 0xAF0A, 0xAD4C, 0xAC8E,
+   0xA7D0, 0xA612, 0xA454, 0xA596, 0xA0D8, 0xA11A, 0xA35C, 0xA29E,
+   0xB5E0, 0xB422, 0xB664, 0xB7A6, 0xB2E8, 0xB32A, 0xB16C, 0xB0AE,
+   0xBBF0, 0xBA32, 0xB874, 0xB9B6, 0xBCF8, 0xBD3A, 0xBF7C, 0xBEBE
+#endif
+};
+
 
 /**
  * @brief Authenticated encryption using GCM
@@ -64,12 +106,15 @@
 error_t gcmEncrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, size_t ivLen,
    const uint8_t *a, size_t aLen, const uint8_t *p, uint8_t *c, size_t length, uint8_t *t, size_t tLen)
 {
+   size_t i;
    size_t k;
+   size_t m;
    size_t n;
-   uint8_t b[16];
+   uint8_t b[CIPHER_BATCH_SIZE * 16];
    uint8_t h[16];
    uint8_t j[16];
    uint8_t s[16];
+   GcmTable table;
 
    //Check parameters
    if(cipher == NULL || context == NULL)
@@ -90,6 +135,9 @@ error_t gcmEncrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
    memset(h, 0, 16 );
    cipher->encryptBlock(context, h, h);
 
+   //Precompute the multiples of H used by the GHASH function
+   gcmGenerateTable(&table, h);
+
    //Check whether the length of the IV is 96 bits
    if(ivLen == 12)
    {
@@ -114,7 +162,7 @@ error_t gcmEncrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
 
          //Apply GHASH function
          gcmXorBlock(j, j, iv, k);
-         gcmMul(j, h);
+         gcmMulTable(&table, j);
 
          //Next block
          iv += k;
@@ -129,7 +177,7 @@ error_t gcmEncrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
       //The GHASH function is applied to the resulting string to form the
       //pre-counter block
       gcmXorBlock(j, j, b, 16);
-      gcmMul(j, h);
+      gcmMulTable(&table, j);
    }
 
    //Compute MSB(CIPH(J(0)))
@@ -149,7 +197,7 @@ error_t gcmEncrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
 
       //Apply GHASH function
       gcmXorBlock(s, s, a, k);
-      gcmMul(s, h);
+      gcmMulTable(&table, s);
 
       //Next block
       a += k;
@@ -162,24 +210,29 @@ error_t gcmEncrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
    //Process plaintext
    while(n > 0)
    {
-      //The encryption operates in a block-by-block fashion
-      k = min(n, 16);
+      //Number of counter blocks to encrypt at once
+      m = min((n + 15) / 16, CIPHER_BATCH_SIZE);
+      //Generate the key stream
+      gcmGenerateKeyStream(cipher, context, j, b, m);
 
-      //Increment counter
-      gcmIncCounter(j);
+      //The encryption operates in a block-by-block fashion
+      for(i = 0; i < m; i++)
+      {
+         //Size of the current block
+         k = min(n, 16);
 
-      //Encrypt plaintext
-      cipher->encryptBlock(context, j, b);
-      gcmXorBlock(c, p, b, k);
+         //Encrypt plaintext
+         gcmXorBlock(c, p, b + 16 * i, k);
 
-      //Apply GHASH function
-      gcmXorBlock(s, s, c, k);
-      gcmMul(s, h);
+         //Apply GHASH function
+         gcmXorBlock(s, s, c, k);
+         gcmMulTable(&table, s);
 
-      //Next block
-      p += k;
-      c += k;
-      n -= k;
+         //Next block
+         p += k;
+         c += k;
+         n -= k;
+      }
    }
 
    //Append the 64-bit representation of the length of the AAD and the ciphertext
@@ -189,7 +242,7 @@ error_t gcmEncrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
 
    //The GHASH function is applied to the result to produce a single output block S
    gcmXorBlock(s, s, b, 16);
-   gcmMul(s, h);
+   gcmMulTable(&table, s);
 
    //Let T = MSB(GCTR(J(0), S)
    gcmXorBlock(t, t, s, tLen);
@@ -218,13 +271,16 @@ error_t gcmEncrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
 error_t gcmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, size_t ivLen,
    const uint8_t *a, size_t aLen, const uint8_t *c, uint8_t *p, size_t length, const uint8_t *t, size_t tLen)
 {
+   size_t i;
    size_t k;
+   size_t m;
    size_t n;
-   uint8_t b[16];
+   uint8_t b[CIPHER_BATCH_SIZE * 16];
    uint8_t h[16];
    uint8_t j[16];
    uint8_t r[16];
    uint8_t s[16];
+   GcmTable table;
 
    //Check parameters
    if(cipher == NULL || context == NULL)
@@ -245,6 +301,9 @@ error_t gcmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
    memset(h, 0, 16 );
    cipher->encryptBlock(context, h, h);
 
+   //Precompute the multiples of H used by the GHASH function
+   gcmGenerateTable(&table, h);
+
    //Check whether the length of the IV is 96 bits
    if(ivLen == 12)
    {
@@ -269,7 +328,7 @@ error_t gcmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
 
          //Apply GHASH function
          gcmXorBlock(j, j, iv, k);
-         gcmMul(j, h);
+         gcmMulTable(&table, j);
 
          //Next block
          iv += k;
@@ -284,7 +343,7 @@ error_t gcmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
       //The GHASH function is applied to the resulting string to form the
       //pre-counter block
       gcmXorBlock(j, j, b, 16);
-      gcmMul(j, h);
+      gcmMulTable(&table, j);
    }
 
    //Compute MSB(CIPH(J(0)))
@@ -304,7 +363,7 @@ error_t gcmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
 
       //Apply GHASH function
       gcmXorBlock(s, s, a, k);
-      gcmMul(s, h);
+      gcmMulTable(&table, s);
 
       //Next block
       a += k;
@@ -317,24 +376,29 @@ error_t gcmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
    //Process ciphertext
    while(n > 0)
    {
-      //The decryption operates in a block-by-block fashion
-      k = min(n, 16);
+      //Number of counter blocks to encrypt at once
+      m = min((n + 15) / 16, CIPHER_BATCH_SIZE);
+      //Generate the key stream
+      gcmGenerateKeyStream(cipher, context, j, b, m);
 
-      //Apply GHASH function
-      gcmXorBlock(s, s, c, k);
-      gcmMul(s, h);
+      //The decryption operates in a block-by-block fashion
+      for(i = 0; i < m; i++)
+      {
+         //Size of the current block
+         k = min(n, 16);
 
-      //Increment counter
-      gcmIncCounter(j);
+         //Apply GHASH function
+         gcmXorBlock(s, s, c, k);
+         gcmMulTable(&table, s);
 
-      //Decrypt ciphertext
-      cipher->encryptBlock(context, j, b);
-      gcmXorBlock(p, c, b, k);
+         //Decrypt ciphertext
+         gcmXorBlock(p, c, b + 16 * i, k);
 
-      //Next block
-      c += k;
-      p += k;
-      n -= k;
+         //Next block
+         c += k;
+         p += k;
+         n -= k;
+      }
    }
 
    //Append the 64-bit representation of the length of the AAD and the ciphertext
@@ -344,7 +408,7 @@ error_t gcmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
 
    //The GHASH function is applied to the result to produce a single output block S
    gcmXorBlock(s, s, b, 16);
-   gcmMul(s, h);
+   gcmMulTable(&table, s);
 
    //Let R = MSB(GCTR(J(0), S)
    gcmXorBlock(r, r, s, tLen);
@@ -358,6 +422,116 @@ error_t gcmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
 }
 
 
+/**
+ * @brief Precompute the GHASH lookup table
+ *
+ * Entry i of the table holds the product of H and the polynomial whose
+ * coefficients are the bits of i, most significant bit first. The GHASH
+ * multiplication can then process GCM_TABLE_W bits of the input at a time
+ *
+ * @param[out] table Table to be initialized
+ * @param[in] h Hash subkey H
+ **/
+
+void gcmGenerateTable(GcmTable *table, const uint8_t *h)
+{
+   uint_t i;
+   uint_t j;
+
+   //The first entry corresponds to the zero polynomial
+   memset(table->m[0], 0, 16);
+
+   //The most significant bit of the index stands for H itself
+   table->m[GCM_TABLE_N / 2][0] = LOAD32BE(h);
+   table->m[GCM_TABLE_N / 2][1] = LOAD32BE(h + 4);
+   table->m[GCM_TABLE_N / 2][2] = LOAD32BE(h + 8);
+   table->m[GCM_TABLE_N / 2][3] = LOAD32BE(h + 12);
+
+   //Each of the remaining powers of two is the previous one multiplied by x
+   for(i = GCM_TABLE_N / 4; i > 0; i >>= 1)
+   {
+      //Shift the block to the right
+      table->m[i][3] = (table->m[2 * i][3] >> 1) | (table->m[2 * i][2] << 31);
+      table->m[i][2] = (table->m[2 * i][2] >> 1) | (table->m[2 * i][1] << 31);
+      table->m[i][1] = (table->m[2 * i][1] >> 1) | (table->m[2 * i][0] << 31);
+      table->m[i][0] = table->m[2 * i][0] >> 1;
+
+      //Reduce the result modulo the field polynomial
+      if(table->m[2 * i][3] & 0x01)
+         table->m[i][0] ^= 0xE1000000;
+   }
+
+   //Multiplication is linear, so that the other entries are sums
+   //of the powers of two
+   for(i = 2; i < GCM_TABLE_N; i <<= 1)
+   {
+      for(j = 1; j < i; j++)
+      {
+         table->m[i + j][0] = table->m[i][0] ^ table->m[j][0];
+         table->m[i + j][1] = table->m[i][1] ^ table->m[j][1];
+         table->m[i + j][2] = table->m[i][2] ^ table->m[j][2];
+         table->m[i + j][3] = table->m[i][3] ^ table->m[j][3];
+      }
+   }
+}
+
+
+/**
+ * @brief Multiplication by H using the precomputed table
+ * @param[in] table GHASH lookup table
+ * @param[in,out] x Block to be multiplied by H
+ **/
+
+void gcmMulTable(const GcmTable *table, uint8_t *x)
+{
+   uint_t i;
+   uint_t b;
+   uint_t r;
+   uint32_t z[4];
+
+   //Let Z = 0
+   z[0] = 0;
+   z[1] = 0;
+   z[2] = 0;
+   z[3] = 0;
+
+   //Process the block GCM_TABLE_W bits at a time (Horner's rule),
+   //starting from the rightmost bits
+   for(i = 0; i < (128 / GCM_TABLE_W); i++)
+   {
+#if (GCM_TABLE_W == 4)
+      //Extract the current nibble
+      b = x[15 - i / 2];
+      b = (i % 2) ? (b >> 4) : (b & 0x0F);
+#else
+      //Extract the current byte
+      b = x[15 - i];
+#endif
+
+      //Bits that are shifted out of the block
+      r = z[3] & (GCM_TABLE_N - 1);
+
+      //Multiply Z by x^w
+      z[3] = (z[3] >> GCM_TABLE_W) | (z[2] << (32 - GCM_TABLE_W));
+      z[2] = (z[2] >> GCM_TABLE_W) | (z[1] << (32 - GCM_TABLE_W));
+      z[1] = (z[1] >> GCM_TABLE_W) | (z[0] << (32 - GCM_TABLE_W));
+      z[0] = (z[0] >> GCM_TABLE_W) ^ ((uint32_t) gcmReductionTable[r] << 16);
+
+      //Add the precomputed multiple of H
+      z[0] ^= table->m[b][0];
+      z[1] ^= table->m[b][1];
+      z[2] ^= table->m[b][2];
+      z[3] ^= table->m[b][3];
+   }
+
+   //Copy the resulting block
+   STORE32BE(z[0], x);
+   STORE32BE(z[1], x + 4);
+   STORE32BE(z[2], x + 8);
+   STORE32BE(z[3], x + 12);
+}
+
+
 /**
  * @brief Multiplication operation
  * @param[in, out] x First block
@@ -453,4 +627,44 @@ void gcmIncCounter(uint8_t *a)
    }
 }
 
+
+/**
+ * @brief Generate the key stream for consecutive blocks
+ *
+ * The counter blocks are encrypted in a single call when the cipher
+ * provides a multi-block implementation
+ *
+ * @param[in] cipher Cipher algorithm
+ * @param[in] context Cipher algorithm context
+ * @param[in,out] j Counter block (incremented before each block)
+ * @param[out] b Resulting key stream (n blocks)
+ * @param[in] n Number of blocks to generate
+ **/
+
+void gcmGenerateKeyStream(const CipherAlgo *cipher, void *context,
+   uint8_t *j, uint8_t *b, size_t n)
+{
+   size_t i;
+
+   //Generate the successive counter blocks
+   for(i = 0; i < n; i++)
+   {
+      //Increment counter
+      gcmIncCounter(j);
+      //Save the counter block
+      memcpy(b + 16 * i, j, 16);
+   }
+
+   //Encrypt the counter blocks
+   if(cipher->encryptBlocks != NULL)
+   {
+      cipher->encryptBlocks(context, b, b, n);
+   }
+   else
+   {
+      for(i = 0; i < n; i++)
+         cipher->encryptBlock(context, b + 16 * i, b + 16 * i);
+   }
+}
+
 #endif
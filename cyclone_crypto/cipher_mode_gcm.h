@@ -32,6 +32,20 @@
 //Dependencies
 #include "crypto.h"
 
+//Number of entries in the GHASH lookup table
+#define GCM_TABLE_N (1 << GCM_TABLE_W)
+
+
+/**
+ * @brief Precomputed multiples of the hash subkey H
+ **/
+
+typedef struct
+{
+   uint32_t m[GCM_TABLE_N][4];
+} GcmTable;
+
+
 //GCM related functions
 error_t gcmEncrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, size_t ivLen,
    const uint8_t *a, size_t aLen, const uint8_t *p, uint8_t *c, size_t length, uint8_t *t, size_t tLen);
@@ -39,9 +53,15 @@ error_t gcmEncrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, s
 error_t gcmDecrypt(const CipherAlgo *cipher, void *context, const uint8_t *iv, size_t ivLen,
    const uint8_t *a, size_t aLen, const uint8_t *c, uint8_t *p, size_t length, const uint8_t *t, size_t tLen);
 
+void gcmGenerateTable(GcmTable *table, const uint8_t *h);
+void gcmMulTable(const GcmTable *table, uint8_t *x);
+
 void gcmMul(uint8_t *x, const uint8_t *y);
 void gcmXorBlock(uint8_t *a, const uint8_t *b, const uint8_t *c, size_t n);
 void gcmShiftBlock(uint8_t *a);
 void gcmIncCounter(uint8_t *a);
 
+void gcmGenerateKeyStream(const CipherAlgo *cipher, void *context,
+   uint8_t *j, uint8_t *b, size_t n);
+
 #endif
@@ -133,6 +133,13 @@
    #error WHIRLPOOL_SUPPORT parameter is invalid
 #endif
 
+//Poly1305 support
+#ifndef POLY1305_SUPPORT
+   #define POLY1305_SUPPORT ENABLED
+#elif (POLY1305_SUPPORT != ENABLED && POLY1305_SUPPORT != DISABLED)
+   #error POLY1305_SUPPORT parameter is invalid
+#endif
+
 //HMAC support
 #ifndef HMAC_SUPPORT
    #define HMAC_SUPPORT ENABLED
@@ -147,6 +154,13 @@
    #error RC4_SUPPORT parameter is invalid
 #endif
 
+//ChaCha support
+#ifndef CHACHA_SUPPORT
+   #define CHACHA_SUPPORT ENABLED
+#elif (CHACHA_SUPPORT != ENABLED && CHACHA_SUPPORT != DISABLED)
+   #error CHACHA_SUPPORT parameter is invalid
+#endif
+
 //RC6 support
 #ifndef RC6_SUPPORT
    #define RC6_SUPPORT ENABLED
@@ -182,6 +196,27 @@
    #error AES_SUPPORT parameter is invalid
 #endif
 
+//Use a single lookup table per direction for AES (saves 6 KB of flash)
+#ifndef AES_COMPACT_TABLES
+   #define AES_COMPACT_TABLES DISABLED
+#elif (AES_COMPACT_TABLES != ENABLED && AES_COMPACT_TABLES != DISABLED)
+   #error AES_COMPACT_TABLES parameter is invalid
+#endif
+
+//AES-NI acceleration (used only when the compiler targets the AES instructions)
+#ifndef AES_HW_ACCEL_SUPPORT
+   #define AES_HW_ACCEL_SUPPORT ENABLED
+#elif (AES_HW_ACCEL_SUPPORT != ENABLED && AES_HW_ACCEL_SUPPORT != DISABLED)
+   #error AES_HW_ACCEL_SUPPORT parameter is invalid
+#endif
+
+//AES-NI backend, selected at runtime when the processor supports it
+#ifndef AES_NI_SUPPORT
+   #define AES_NI_SUPPORT DISABLED
+#elif (AES_NI_SUPPORT != ENABLED && AES_NI_SUPPORT != DISABLED)
+   #error AES_NI_SUPPORT parameter is invalid
+#endif
+
 //Camellia support
 #ifndef CAMELLIA_SUPPORT
    #define CAMELLIA_SUPPORT ENABLED
@@ -252,6 +287,27 @@
    #error GCM_SUPPORT parameter is invalid
 #endif
 
+//Width of the GHASH lookup tables (4-bit or 8-bit)
+#ifndef GCM_TABLE_W
+   #define GCM_TABLE_W 4
+#elif (GCM_TABLE_W != 4 && GCM_TABLE_W != 8)
+   #error GCM_TABLE_W parameter is invalid
+#endif
+
+//Number of blocks handed at once to multi-block cipher implementations
+#ifndef CIPHER_BATCH_SIZE
+   #define CIPHER_BATCH_SIZE 4
+#elif (CIPHER_BATCH_SIZE < 1 || CIPHER_BATCH_SIZE > 8)
+   #error CIPHER_BATCH_SIZE parameter is invalid
+#endif
+
+//ChaCha20Poly1305 support
+#ifndef CHACHA20_POLY1305_SUPPORT
+   #define CHACHA20_POLY1305_SUPPORT ENABLED
+#elif (CHACHA20_POLY1305_SUPPORT != ENABLED && CHACHA20_POLY1305_SUPPORT != DISABLED)
+   #error CHACHA20_POLY1305_SUPPORT parameter is invalid
+#endif
+
 //Maximum context size (hash functions)
 #if (SHA512_SUPPORT == ENABLED)
    #define MAX_HASH_CONTEXT_SIZE sizeof(Sha512Context)
@@ -384,7 +440,8 @@ typedef enum
    CIPHER_MODE_OFB    = 4,
    CIPHER_MODE_CTR    = 5,
    CIPHER_MODE_CCM    = 6,
-   CIPHER_MODE_GCM    = 7
+   CIPHER_MODE_GCM    = 7,
+   CIPHER_MODE_CHACHA20_POLY1305 = 8
 } CipherMode;
 
 
@@ -400,6 +457,8 @@ typedef void (*CipherAlgoEncryptStream)(void *context, const uint8_t *input, uin
 typedef void (*CipherAlgoDecryptStream)(void *context, const uint8_t *input, uint8_t *output, size_t length);
 typedef void (*CipherAlgoEncryptBlock)(void *context, const uint8_t *input, uint8_t *output);
 typedef void (*CipherAlgoDecryptBlock)(void *context, const uint8_t *input, uint8_t *output);
+typedef void (*CipherAlgoEncryptBlocks)(void *context, const uint8_t *input, uint8_t *output, size_t n);
+typedef void (*CipherAlgoDecryptBlocks)(void *context, const uint8_t *input, uint8_t *output, size_t n);
 
 //Common API for pseudo-random number generators
 typedef error_t (*PrngAlgoInit)(void *context);
@@ -453,6 +512,8 @@ typedef struct
    CipherAlgoDecryptStream decryptStream;
    CipherAlgoEncryptBlock encryptBlock;
    CipherAlgoDecryptBlock decryptBlock;
+   CipherAlgoEncryptBlocks encryptBlocks;
+   CipherAlgoDecryptBlocks decryptBlocks;
 } CipherAlgo;
 
 
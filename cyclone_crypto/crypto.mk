@@ -1,8 +1,11 @@
 CYCLONETCPSRC += $(CYCLONETCP)/cyclone_crypto/aes.c \
+				 $(CYCLONETCP)/cyclone_crypto/aes_ni.c \
 				 $(CYCLONETCP)/cyclone_crypto/aria.c \
 				 $(CYCLONETCP)/cyclone_crypto/asn1.c \
 				 $(CYCLONETCP)/cyclone_crypto/base64.c \
 				 $(CYCLONETCP)/cyclone_crypto/camellia.c \
+				 $(CYCLONETCP)/cyclone_crypto/chacha.c \
+				 $(CYCLONETCP)/cyclone_crypto/chacha20_poly1305.c \
 				 $(CYCLONETCP)/cyclone_crypto/cipher_mode_cbc.c \
 				 $(CYCLONETCP)/cyclone_crypto/cipher_mode_ccm.c \
 				 $(CYCLONETCP)/cyclone_crypto/cipher_mode_cfb.c \
@@ -10,10 +13,17 @@ CYCLONETCPSRC += $(CYCLONETCP)/cyclone_crypto/aes.c \
 				 $(CYCLONETCP)/cyclone_crypto/cipher_mode_ecb.c \
 				 $(CYCLONETCP)/cyclone_crypto/cipher_mode_gcm.c \
 				 $(CYCLONETCP)/cyclone_crypto/cipher_mode_ofb.c \
+				 $(CYCLONETCP)/cyclone_crypto/crypto_benchmark.c \
+				 $(CYCLONETCP)/cyclone_crypto/ctr_drbg.c \
 				 $(CYCLONETCP)/cyclone_crypto/des.c \
 				 $(CYCLONETCP)/cyclone_crypto/des3.c \
 				 $(CYCLONETCP)/cyclone_crypto/dh.c \
 				 $(CYCLONETCP)/cyclone_crypto/dsa.c \
+				 $(CYCLONETCP)/cyclone_crypto/ec.c \
+				 $(CYCLONETCP)/cyclone_crypto/ec_curves.c \
+				 $(CYCLONETCP)/cyclone_crypto/ecdh.c \
+				 $(CYCLONETCP)/cyclone_crypto/ecdsa.c \
+				 $(CYCLONETCP)/cyclone_crypto/hkdf.c \
 				 $(CYCLONETCP)/cyclone_crypto/hmac.c \
 				 $(CYCLONETCP)/cyclone_crypto/idea.c \
 				 $(CYCLONETCP)/cyclone_crypto/md2.c \
@@ -22,6 +32,7 @@ CYCLONETCPSRC += $(CYCLONETCP)/cyclone_crypto/aes.c \
 				 $(CYCLONETCP)/cyclone_crypto/mpi.c \
 				 $(CYCLONETCP)/cyclone_crypto/pem.c \
 				 $(CYCLONETCP)/cyclone_crypto/pkcs5.c \
+				 $(CYCLONETCP)/cyclone_crypto/poly1305.c \
 				 $(CYCLONETCP)/cyclone_crypto/rc4.c \
 				 $(CYCLONETCP)/cyclone_crypto/rc6.c \
 				 $(CYCLONETCP)/cyclone_crypto/ripemd128.c \
@@ -0,0 +1,134 @@
+/**
+ * @file crypto_benchmark.h
+ * @brief Cryptographic primitive benchmark
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _CRYPTO_BENCHMARK_H
+#define _CRYPTO_BENCHMARK_H
+
+//Dependencies
+#include "crypto.h"
+
+//Crypto benchmark support
+#ifndef CRYPTO_BENCHMARK_SUPPORT
+   #define CRYPTO_BENCHMARK_SUPPORT DISABLED
+#elif (CRYPTO_BENCHMARK_SUPPORT != ENABLED && CRYPTO_BENCHMARK_SUPPORT != DISABLED)
+   #error CRYPTO_BENCHMARK_SUPPORT parameter is invalid
+#endif
+
+//Amount of data processed by each cipher and hash test
+#ifndef CRYPTO_BENCHMARK_DATA_SIZE
+   #define CRYPTO_BENCHMARK_DATA_SIZE 1048576
+#elif (CRYPTO_BENCHMARK_DATA_SIZE < 1024)
+   #error CRYPTO_BENCHMARK_DATA_SIZE parameter is invalid
+#endif
+
+//Number of bytes passed to the algorithm at a time
+#ifndef CRYPTO_BENCHMARK_CHUNK_SIZE
+   #define CRYPTO_BENCHMARK_CHUNK_SIZE 1024
+#elif (CRYPTO_BENCHMARK_CHUNK_SIZE < 16 || (CRYPTO_BENCHMARK_CHUNK_SIZE % 16) != 0 || \
+   CRYPTO_BENCHMARK_CHUNK_SIZE > CRYPTO_BENCHMARK_DATA_SIZE)
+   #error CRYPTO_BENCHMARK_CHUNK_SIZE parameter is invalid
+#endif
+
+//Number of iterations of each public-key operation
+#ifndef CRYPTO_BENCHMARK_PK_ITERATIONS
+   #define CRYPTO_BENCHMARK_PK_ITERATIONS 10
+#elif (CRYPTO_BENCHMARK_PK_ITERATIONS < 1)
+   #error CRYPTO_BENCHMARK_PK_ITERATIONS parameter is invalid
+#endif
+
+//Time base used by the benchmark (e.g. a cycle counter)
+#ifndef CRYPTO_BENCHMARK_GET_TIME
+   #define CRYPTO_BENCHMARK_GET_TIME() osGetTickCount()
+#endif
+
+//Frequency of the time base, in Hz
+#ifndef CRYPTO_BENCHMARK_TIME_FREQ
+   #define CRYPTO_BENCHMARK_TIME_FREQ 1000
+#endif
+
+//CPU clock frequency, in Hz (0 if unknown)
+#ifndef CRYPTO_BENCHMARK_CPU_FREQ
+   #define CRYPTO_BENCHMARK_CPU_FREQ 0
+#endif
+
+
+/**
+ * @brief Unit of a benchmark result
+ **/
+
+typedef enum
+{
+   CRYPTO_BENCHMARK_UNIT_BYTE = 0,
+   CRYPTO_BENCHMARK_UNIT_OP   = 1
+} CryptoBenchmarkUnit;
+
+
+/**
+ * @brief Benchmark result
+ **/
+
+typedef struct
+{
+   const char_t *algo;       ///<Algorithm name
+   uint_t keySize;           ///<Key size in bits (0 if not relevant)
+   const char_t *test;       ///<Mode of operation or operation name
+   CryptoBenchmarkUnit unit; ///<Unit of the count field
+   uint32_t count;           ///<Number of bytes or operations processed
+   uint64_t time;            ///<Elapsed time, in time base units
+} CryptoBenchmarkResult;
+
+
+//Result reporting callback
+typedef void (*CryptoBenchmarkCallback)(const CryptoBenchmarkResult *result, void *param);
+
+//Crypto benchmark related functions
+error_t cryptoBenchmarkRun(const PrngAlgo *prngAlgo, void *prngContext,
+   CryptoBenchmarkCallback callback, void *param);
+
+error_t cryptoBenchmarkCipher(const CipherAlgo *cipher, size_t keyLength,
+   CipherMode mode, CryptoBenchmarkCallback callback, void *param);
+
+error_t cryptoBenchmarkHash(const HashAlgo *hash,
+   CryptoBenchmarkCallback callback, void *param);
+
+error_t cryptoBenchmarkHmac(const HashAlgo *hash,
+   CryptoBenchmarkCallback callback, void *param);
+
+error_t cryptoBenchmarkRsa(const char_t *privateKey, size_t privateKeyLength,
+   const PrngAlgo *prngAlgo, void *prngContext, CryptoBenchmarkCallback callback, void *param);
+
+error_t cryptoBenchmarkDh(const char_t *dhParams, size_t dhParamsLength,
+   const PrngAlgo *prngAlgo, void *prngContext, CryptoBenchmarkCallback callback, void *param);
+
+error_t cryptoBenchmarkDsa(const char_t *privateKey, size_t privateKeyLength,
+   const PrngAlgo *prngAlgo, void *prngContext, CryptoBenchmarkCallback callback, void *param);
+
+void cryptoBenchmarkDumpResult(const CryptoBenchmarkResult *result, void *param);
+const char_t *cryptoBenchmarkGetModeName(CipherMode mode);
+
+#endif
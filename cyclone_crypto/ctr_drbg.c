@@ -0,0 +1,402 @@
+/**
+ * @file ctr_drbg.c
+ * @brief CTR_DRBG pseudo-random number generator (SP 800-90A)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * CTR_DRBG is the deterministic random bit generator based on a block
+ * cipher specified by NIST SP 800-90A. This implementation uses AES-256
+ * without derivation function. A whole request is generated by encrypting
+ * consecutive counter blocks in a single call. A generator can be attached
+ * to a parent PRNG, from which it reseeds itself, so that every task or
+ * TLS context owns its generator and does not contend for a shared one
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL CRYPTO_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "crypto.h"
+#include "ctr_drbg.h"
+#include "debug.h"
+
+//Common interface for PRNG algorithms
+const PrngAlgo ctrDrbgPrngAlgo =
+{
+   "CTR_DRBG",
+   sizeof(CtrDrbgContext),
+   (PrngAlgoInit) ctrDrbgInit,
+   (PrngAlgoRelease) ctrDrbgRelease,
+   (PrngAlgoSeed) ctrDrbgSeed,
+   (PrngAlgoAddEntropy) ctrDrbgAddEntropy,
+   (PrngAlgoRead) ctrDrbgRead
+};
+
+
+/**
+ * @brief Initialize CTR_DRBG context
+ * @param[in] context Pointer to the CTR_DRBG context to initialize
+ * @return Error code
+ **/
+
+error_t ctrDrbgInit(CtrDrbgContext *context)
+{
+   //Clear DRBG state
+   memset(context, 0, sizeof(CtrDrbgContext));
+
+   //The DRBG is not ready to generate random data
+   context->ready = FALSE;
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Initialize a child generator
+ *
+ * The child generator is instantiated, and then periodically reseeded,
+ * with random data read from the parent generator. The parent is accessed
+ * only when a reseed is due
+ *
+ * @param[in] context Pointer to the CTR_DRBG context to initialize
+ * @param[in] parentAlgo Parent PRNG algorithm
+ * @param[in] parentContext Parent PRNG context
+ * @return Error code
+ **/
+
+error_t ctrDrbgInitChild(CtrDrbgContext *context,
+   const PrngAlgo *parentAlgo, void *parentContext)
+{
+   //Check parameters
+   if(parentAlgo == NULL || parentContext == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Initialize DRBG state
+   ctrDrbgInit(context);
+
+   //Save the parent generator
+   context->parentAlgo = parentAlgo;
+   context->parentContext = parentContext;
+
+   //The child generator is instantiated on first use
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release CTR_DRBG context
+ * @param[in] context Pointer to the CTR_DRBG context
+ **/
+
+void ctrDrbgRelease(CtrDrbgContext *context)
+{
+   //Clear DRBG state
+   memset(context, 0, sizeof(CtrDrbgContext));
+}
+
+
+/**
+ * @brief Instantiate the DRBG
+ *
+ * No derivation function is used, hence the first 48 bytes of the input
+ * must be full-entropy seed material. Up to 48 additional bytes are used
+ * as a personalization string
+ *
+ * @param[in] context Pointer to the CTR_DRBG context
+ * @param[in] input Pointer to the input data
+ * @param[in] length Length of the input data
+ * @return Error code
+ **/
+
+error_t ctrDrbgSeed(CtrDrbgContext *context, const uint8_t *input, size_t length)
+{
+   error_t error;
+   uint8_t key[CTR_DRBG_KEY_LEN];
+
+   //Check parameters
+   if(length < CTR_DRBG_SEED_LEN || length > (2 * CTR_DRBG_SEED_LEN))
+      return ERROR_INVALID_PARAMETER;
+
+   //Set Key = 0 and V = 0
+   memset(key, 0, CTR_DRBG_KEY_LEN);
+   aesInit(&context->cipherContext, key, CTR_DRBG_KEY_LEN);
+   memset(context->v, 0, AES_BLOCK_SIZE);
+
+   //Mix the seed material into the internal state
+   error = ctrDrbgReseed(context, input, length);
+   //Any error to report?
+   if(error) return error;
+
+   //The DRBG is ready to generate random data
+   context->ready = TRUE;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Reseed the DRBG
+ *
+ * The source identifier and the entropy estimate are not used. The input
+ * must provide at least 48 bytes of full-entropy data
+ *
+ * @param[in] context Pointer to the CTR_DRBG context
+ * @param[in] source Entropy source identifier
+ * @param[in] input Pointer to the input data
+ * @param[in] length Length of the input data
+ * @param[in] entropy Actual number of bits of entropy
+ * @return Error code
+ **/
+
+error_t ctrDrbgAddEntropy(CtrDrbgContext *context, uint_t source,
+   const uint8_t *input, size_t length, size_t entropy)
+{
+   //The DRBG must have been instantiated first
+   if(!context->ready)
+      return ERROR_PRNG_NOT_READY;
+
+   //Mix the seed material into the internal state
+   return ctrDrbgReseed(context, input, length);
+}
+
+
+/**
+ * @brief Read random data
+ * @param[in] context Pointer to the CTR_DRBG context
+ * @param[out] output Buffer where to store the output data
+ * @param[in] length Desired length in bytes
+ * @return Error code
+ **/
+
+error_t ctrDrbgRead(CtrDrbgContext *context, uint8_t *output, size_t length)
+{
+   error_t error;
+   size_t n;
+
+   //Large requests are split to honor the maximum request size
+   do
+   {
+      //A reseed is required?
+      if(!context->ready || context->reseedCounter > CTR_DRBG_RESEED_INTERVAL)
+      {
+         //Only child generators can reseed themselves
+         if(context->parentAlgo == NULL)
+            return ERROR_PRNG_NOT_READY;
+
+         //Get fresh seed material from the parent generator
+         error = ctrDrbgReseedFromParent(context);
+         //Any error to report?
+         if(error) return error;
+      }
+
+      //Number of bytes to generate with the current request
+      n = min(length, CTR_DRBG_MAX_REQUEST_SIZE);
+
+      //Generate the requested bytes in a single pass
+      ctrDrbgGenerate(context, output, n);
+      //Update the internal state for backtracking resistance
+      ctrDrbgUpdate(context, NULL);
+
+      //Increment the reseed counter
+      context->reseedCounter++;
+
+      //Next request
+      output += n;
+      length -= n;
+
+      //Loop as long as necessary
+   } while(length > 0);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Reseed a child generator from its parent
+ * @param[in] context Pointer to the CTR_DRBG context
+ * @return Error code
+ **/
+
+error_t ctrDrbgReseedFromParent(CtrDrbgContext *context)
+{
+   error_t error;
+   uint8_t seed[CTR_DRBG_SEED_LEN];
+
+   //Read seed material from the parent generator
+   error = context->parentAlgo->read(context->parentContext, seed, CTR_DRBG_SEED_LEN);
+
+   //Check status code
+   if(!error)
+   {
+      //Instantiate the child generator on first use
+      if(!context->ready)
+         error = ctrDrbgSeed(context, seed, CTR_DRBG_SEED_LEN);
+      else
+         error = ctrDrbgReseed(context, seed, CTR_DRBG_SEED_LEN);
+   }
+
+   //Clear seed material
+   memset(seed, 0, CTR_DRBG_SEED_LEN);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Mix seed material into the internal state
+ * @param[in] context Pointer to the CTR_DRBG context
+ * @param[in] input Entropy input, optionally followed by additional input
+ * @param[in] length Length of the input data
+ * @return Error code
+ **/
+
+error_t ctrDrbgReseed(CtrDrbgContext *context, const uint8_t *input, size_t length)
+{
+   size_t i;
+   uint8_t seed[CTR_DRBG_SEED_LEN];
+
+   //Check parameters
+   if(length < CTR_DRBG_SEED_LEN || length > (2 * CTR_DRBG_SEED_LEN))
+      return ERROR_INVALID_PARAMETER;
+
+   //Get the entropy input
+   memcpy(seed, input, CTR_DRBG_SEED_LEN);
+
+   //XOR the additional input with the entropy input
+   for(i = CTR_DRBG_SEED_LEN; i < length; i++)
+      seed[i - CTR_DRBG_SEED_LEN] ^= input[i];
+
+   //Update the internal state
+   ctrDrbgUpdate(context, seed);
+   //Reset the reseed counter
+   context->reseedCounter = 1;
+
+   //Clear seed material
+   memset(seed, 0, CTR_DRBG_SEED_LEN);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief CTR_DRBG update function
+ * @param[in] context Pointer to the CTR_DRBG context
+ * @param[in] data Provided data (48 bytes), or NULL for an all-zero block
+ **/
+
+void ctrDrbgUpdate(CtrDrbgContext *context, const uint8_t *data)
+{
+   size_t i;
+   uint8_t temp[CTR_DRBG_SEED_LEN];
+
+   //Generate the next 48 bytes of key stream
+   ctrDrbgGenerate(context, temp, CTR_DRBG_SEED_LEN);
+
+   //XOR the provided data with the key stream
+   if(data != NULL)
+   {
+      for(i = 0; i < CTR_DRBG_SEED_LEN; i++)
+         temp[i] ^= data[i];
+   }
+
+   //The leftmost bytes form the new key
+   aesInit(&context->cipherContext, temp, CTR_DRBG_KEY_LEN);
+   //The rightmost bytes form the new value of V
+   memcpy(context->v, temp + CTR_DRBG_KEY_LEN, AES_BLOCK_SIZE);
+
+   //Clear temporary buffer
+   memset(temp, 0, CTR_DRBG_SEED_LEN);
+}
+
+
+/**
+ * @brief Generate key stream in counter mode
+ *
+ * The successive values of V are written directly to the output buffer,
+ * which is then encrypted in a single call
+ *
+ * @param[in] context Pointer to the CTR_DRBG context
+ * @param[out] output Buffer where to store the key stream
+ * @param[in] length Number of bytes to generate
+ **/
+
+void ctrDrbgGenerate(CtrDrbgContext *context, uint8_t *output, size_t length)
+{
+   size_t i;
+   size_t n;
+   uint8_t block[AES_BLOCK_SIZE];
+
+   //Number of complete blocks
+   n = length / AES_BLOCK_SIZE;
+
+   //Generate the successive counter blocks
+   for(i = 0; i < n; i++)
+   {
+      //V = (V + 1) mod 2^128
+      ctrDrbgIncCounter(context->v);
+      //Save the counter block
+      memcpy(output + i * AES_BLOCK_SIZE, context->v, AES_BLOCK_SIZE);
+   }
+
+   //Encrypt all the counter blocks at once
+   aesEncryptBlocks(&context->cipherContext, output, output, n);
+
+   //Last partial block?
+   if((length % AES_BLOCK_SIZE) != 0)
+   {
+      //V = (V + 1) mod 2^128
+      ctrDrbgIncCounter(context->v);
+      //Encrypt the counter block
+      aesEncryptBlock(&context->cipherContext, context->v, block);
+      //Copy the leftmost bytes
+      memcpy(output + n * AES_BLOCK_SIZE, block, length % AES_BLOCK_SIZE);
+   }
+}
+
+
+/**
+ * @brief Increment counter block
+ * @param[in,out] v Pointer to the counter block
+ **/
+
+void ctrDrbgIncCounter(uint8_t *v)
+{
+   int_t i;
+
+   //Increment counter value
+   for(i = AES_BLOCK_SIZE - 1; i >= 0; i--)
+   {
+      //Increment the current byte and propagate the carry if necessary
+      if(++(v[i]) != 0)
+         break;
+   }
+}
@@ -0,0 +1,91 @@
+/**
+ * @file ctr_drbg.h
+ * @brief CTR_DRBG pseudo-random number generator (SP 800-90A)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _CTR_DRBG_H
+#define _CTR_DRBG_H
+
+//Dependencies
+#include "crypto.h"
+#include "aes.h"
+
+//Common interface for PRNG algorithms
+#define CTR_DRBG_PRNG_ALGO (&ctrDrbgPrngAlgo)
+
+//Length of the key used by the block cipher (AES-256)
+#define CTR_DRBG_KEY_LEN 32
+//Length of the seed material (key length + block length)
+#define CTR_DRBG_SEED_LEN 48
+//Maximum number of bytes per generate request (2^19 bits)
+#define CTR_DRBG_MAX_REQUEST_SIZE 65536
+
+//Number of generate requests between two reseeds
+#ifndef CTR_DRBG_RESEED_INTERVAL
+   #define CTR_DRBG_RESEED_INTERVAL 1024
+#elif (CTR_DRBG_RESEED_INTERVAL < 1)
+   #error CTR_DRBG_RESEED_INTERVAL parameter is invalid
+#endif
+
+
+/**
+ * @brief CTR_DRBG context
+ **/
+
+typedef struct
+{
+   bool_t ready;                 //This flag tells whether the DRBG has been instantiated
+   AesContext cipherContext;     //Cipher context (current key)
+   uint8_t v[AES_BLOCK_SIZE];    //Counter block
+   uint_t reseedCounter;         //Number of requests since the last reseed
+   const PrngAlgo *parentAlgo;   //Generator used to reseed (optional)
+   void *parentContext;          //Context of the parent generator
+} CtrDrbgContext;
+
+
+//CTR_DRBG related constants
+extern const PrngAlgo ctrDrbgPrngAlgo;
+
+//CTR_DRBG related functions
+error_t ctrDrbgInit(CtrDrbgContext *context);
+error_t ctrDrbgInitChild(CtrDrbgContext *context,
+   const PrngAlgo *parentAlgo, void *parentContext);
+void ctrDrbgRelease(CtrDrbgContext *context);
+
+error_t ctrDrbgSeed(CtrDrbgContext *context, const uint8_t *input, size_t length);
+
+error_t ctrDrbgAddEntropy(CtrDrbgContext *context, uint_t source,
+   const uint8_t *input, size_t length, size_t entropy);
+
+error_t ctrDrbgRead(CtrDrbgContext *context, uint8_t *output, size_t length);
+
+error_t ctrDrbgReseedFromParent(CtrDrbgContext *context);
+error_t ctrDrbgReseed(CtrDrbgContext *context, const uint8_t *input, size_t length);
+void ctrDrbgUpdate(CtrDrbgContext *context, const uint8_t *data);
+void ctrDrbgGenerate(CtrDrbgContext *context, uint8_t *output, size_t length);
+void ctrDrbgIncCounter(uint8_t *v);
+
+#endif
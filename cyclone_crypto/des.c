@@ -255,7 +255,9 @@ const CipherAlgo desCipherAlgo =
    NULL,
    NULL,
    (CipherAlgoEncryptBlock) desEncryptBlock,
-   (CipherAlgoDecryptBlock) desDecryptBlock
+   (CipherAlgoDecryptBlock) desDecryptBlock,
+   NULL,
+   NULL
 };
 
 
@@ -55,6 +55,8 @@ void dhInitParameters(DhParameters *params)
    mpiInit(&params->xa);
    mpiInit(&params->ya);
    mpiInit(&params->yb);
+   //Initialize Montgomery context
+   mpiMontgomeryInit(&params->pMont);
 }
 
 
@@ -71,6 +73,25 @@ void dhFreeParameters(DhParameters *params)
    mpiFree(&params->xa);
    mpiFree(&params->ya);
    mpiFree(&params->yb);
+   //Free Montgomery context
+   mpiMontgomeryFree(&params->pMont);
+}
+
+
+/**
+ * @brief Precompute the Montgomery context of the prime modulus
+ *
+ * This function must be called once p has been loaded. Both the key pair
+ * generation and the computation of the shared secret benefit from it
+ *
+ * @param[in,out] params Pointer to the Diffie-Hellman parameters
+ * @return Error code
+ **/
+
+error_t dhPrecomputeParameters(DhParameters *params)
+{
+   //The prime modulus is odd
+   return mpiMontgomerySetModulus(&params->pMont, &params->p);
 }
 
 
@@ -114,7 +135,7 @@ error_t dhGenerateKeyPair(DhParameters *params, const PrngAlgo *prngAlgo, void *
    TRACE_DEBUG_MPI("    ", &params->xa);
 
    //Calculate the corresponding public value (ya = g ^ xa mod p)
-   error = mpiExpMod(&params->ya, &params->g, &params->xa, &params->p);
+   error = mpiExpModMont(&params->ya, &params->g, &params->xa, &params->p, &params->pMont);
    //Any error to report?
    if(error) return error;
 
@@ -199,7 +220,7 @@ error_t dhComputeSharedSecret(DhParameters *params,
    do
    {
       //Calculate the shared secret key (k = yb ^ xa mod p)
-      error = mpiExpMod(&z, &params->yb, &params->xa, &params->p);
+      error = mpiExpModMont(&z, &params->yb, &params->xa, &params->p, &params->pMont);
       //Any error to report?
       if(error) return error;
 
@@ -45,12 +45,14 @@ typedef struct
    Mpi xa; ///<Out private value
    Mpi ya; ///<Our public value
    Mpi yb; ///<Peer's public value
+   MpiMontgomeryContext pMont; ///<Montgomery context for the prime modulus
 } DhParameters;
 
 
 //Diffie-Hellman related functions
 void dhInitParameters(DhParameters *params);
 void dhFreeParameters(DhParameters *params);
+error_t dhPrecomputeParameters(DhParameters *params);
 
 error_t dhGenerateKeyPair(DhParameters *params, const PrngAlgo *prngAlgo, void *prngContext);
 
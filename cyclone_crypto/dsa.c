@@ -65,6 +65,8 @@ void dsaInitPublicKey(DsaPublicKey *key)
    mpiInit(&key->q);
    mpiInit(&key->g);
    mpiInit(&key->y);
+   //Initialize Montgomery context
+   mpiMontgomeryInit(&key->pMont);
 }
 
 
@@ -80,6 +82,21 @@ void dsaFreePublicKey(DsaPublicKey *key)
    mpiFree(&key->q);
    mpiFree(&key->g);
    mpiFree(&key->y);
+   //Free Montgomery context
+   mpiMontgomeryFree(&key->pMont);
+}
+
+
+/**
+ * @brief Precompute the Montgomery context of a DSA public key
+ * @param[in,out] key Pointer to the DSA public key
+ * @return Error code
+ **/
+
+error_t dsaPrecomputePublicKey(DsaPublicKey *key)
+{
+   //The prime modulus p is odd
+   return mpiMontgomerySetModulus(&key->pMont, &key->p);
 }
 
 
@@ -95,6 +112,8 @@ void dsaInitPrivateKey(DsaPrivateKey *key)
    mpiInit(&key->q);
    mpiInit(&key->g);
    mpiInit(&key->x);
+   //Initialize Montgomery context
+   mpiMontgomeryInit(&key->pMont);
 }
 
 
@@ -110,6 +129,21 @@ void dsaFreePrivateKey(DsaPrivateKey *key)
    mpiFree(&key->q);
    mpiFree(&key->g);
    mpiFree(&key->x);
+   //Free Montgomery context
+   mpiMontgomeryFree(&key->pMont);
+}
+
+
+/**
+ * @brief Precompute the Montgomery context of a DSA private key
+ * @param[in,out] key Pointer to the DSA private key
+ * @return Error code
+ **/
+
+error_t dsaPrecomputePrivateKey(DsaPrivateKey *key)
+{
+   //The prime modulus p is odd
+   return mpiMontgomerySetModulus(&key->pMont, &key->p);
 }
 
 
@@ -347,7 +381,7 @@ error_t dsaGenerateSignature(const PrngAlgo *prngAlgo, void *prngContext, const
    TRACE_DEBUG_MPI("    ", &z);
 
    //Compute r = (g ^ k mod p) mod q
-   MPI_CHECK(mpiExpMod(&signature->r, &key->g, &k, &key->p));
+   MPI_CHECK(mpiExpModMont(&signature->r, &key->g, &k, &key->p, &key->pMont));
    MPI_CHECK(mpiMod(&signature->r, &signature->r, &key->q));
 
    //Compute k ^ -1 mod q
@@ -460,8 +494,8 @@ error_t dsaVerifySignature(const DsaPublicKey *key,
    MPI_CHECK(mpiMulMod(&u2, &signature->r, &w, &key->q));
 
    //Compute v = ((g ^ u1) * (y ^ u2) mod p) mod q
-   MPI_CHECK(mpiExpMod(&u1, &key->g, &u1, &key->p));
-   MPI_CHECK(mpiExpMod(&u2, &key->y, &u2, &key->p));
+   MPI_CHECK(mpiExpModMont(&u1, &key->g, &u1, &key->p, &key->pMont));
+   MPI_CHECK(mpiExpModMont(&u2, &key->y, &u2, &key->p, &key->pMont));
    MPI_CHECK(mpiMulMod(&v, &u1, &u2, &key->p));
    MPI_CHECK(mpiMod(&v, &v, &key->q));
 
@@ -44,6 +44,7 @@ typedef struct
    Mpi q;
    Mpi g;
    Mpi y;
+   MpiMontgomeryContext pMont; ///<Montgomery context for p
 } DsaPublicKey;
 
 
@@ -57,6 +58,7 @@ typedef struct
    Mpi q;
    Mpi g;
    Mpi x;
+   MpiMontgomeryContext pMont; ///<Montgomery context for p
 } DsaPrivateKey;
 
 
@@ -80,9 +82,11 @@ extern const uint8_t DSA_WITH_SHA256_OID[9];
 //DSA related functions
 void dsaInitPublicKey(DsaPublicKey *key);
 void dsaFreePublicKey(DsaPublicKey *key);
+error_t dsaPrecomputePublicKey(DsaPublicKey *key);
 
 void dsaInitPrivateKey(DsaPrivateKey *key);
 void dsaFreePrivateKey(DsaPrivateKey *key);
+error_t dsaPrecomputePrivateKey(DsaPrivateKey *key);
 
 void dsaInitSignature(DsaSignature *signature);
 void dsaFreeSignature(DsaSignature *signature);
@@ -0,0 +1,962 @@
+/**
+ * @file ec.c
+ * @brief ECC (Elliptic Curve Cryptography)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Elliptic curve arithmetic over prime fields. Points are handled in
+ * Jacobian coordinates so that no modular inversion is needed until
+ * the result is converted back to affine form
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL CRYPTO_TRACE_LEVEL
+
+//Dependencies
+#include <stdlib.h>
+#include "crypto.h"
+#include "ec.h"
+#include "debug.h"
+
+//EC public key OID (1.2.840.10045.2.1)
+const uint8_t EC_PUBLIC_KEY_OID[7] = {0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x02, 0x01};
+
+
+/**
+ * @brief Initialize EC domain parameters
+ * @param[in] params Pointer to the EC domain parameters to initialize
+ **/
+
+void ecInitDomainParameters(EcDomainParameters *params)
+{
+   //Initialize structure
+   params->type = EC_CURVE_TYPE_NONE;
+   params->h = 0;
+   params->mod = NULL;
+
+   //Initialize multiple precision integers
+   mpiInit(&params->p);
+   mpiInit(&params->a);
+   mpiInit(&params->b);
+   ecInit(&params->g);
+   mpiInit(&params->q);
+}
+
+
+/**
+ * @brief Release EC domain parameters
+ * @param[in] params Pointer to the EC domain parameters to free
+ **/
+
+void ecFreeDomainParameters(EcDomainParameters *params)
+{
+   //Free multiple precision integers
+   mpiFree(&params->p);
+   mpiFree(&params->a);
+   mpiFree(&params->b);
+   ecFree(&params->g);
+   mpiFree(&params->q);
+}
+
+
+/**
+ * @brief Load EC domain parameters
+ * @param[out] params Pointer to the structure to be initialized
+ * @param[in] curveInfo Elliptic curve parameters
+ * @return Error code
+ **/
+
+error_t ecLoadDomainParameters(EcDomainParameters *params, const EcCurveInfo *curveInfo)
+{
+   error_t error;
+
+   //Check parameters
+   if(params == NULL || curveInfo == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Debug message
+   TRACE_DEBUG("Loading %s EC domain parameters...\r\n", curveInfo->name);
+
+   //Curve type
+   params->type = curveInfo->type;
+
+   //Import prime modulus
+   MPI_CHECK(mpiReadRaw(&params->p, curveInfo->p, curveInfo->pLen));
+   //Import parameter a
+   MPI_CHECK(mpiReadRaw(&params->a, curveInfo->a, curveInfo->aLen));
+   //Import parameter b
+   MPI_CHECK(mpiReadRaw(&params->b, curveInfo->b, curveInfo->bLen));
+   //Import the x-coordinate of the base point G
+   MPI_CHECK(mpiReadRaw(&params->g.x, curveInfo->gx, curveInfo->gxLen));
+   //Import the y-coordinate of the base point G
+   MPI_CHECK(mpiReadRaw(&params->g.y, curveInfo->gy, curveInfo->gyLen));
+   //Point G is in affine coordinates
+   MPI_CHECK(mpiSetValue(&params->g.z, 1));
+   //Import base point order q
+   MPI_CHECK(mpiReadRaw(&params->q, curveInfo->q, curveInfo->qLen));
+
+   //Cofactor h
+   params->h = curveInfo->h;
+   //Fast modular reduction
+   params->mod = curveInfo->mod;
+
+   //Debug message
+   TRACE_DEBUG("  p:\r\n");
+   TRACE_DEBUG_MPI("    ", &params->p);
+   TRACE_DEBUG("  a:\r\n");
+   TRACE_DEBUG_MPI("    ", &params->a);
+   TRACE_DEBUG("  b:\r\n");
+   TRACE_DEBUG_MPI("    ", &params->b);
+   TRACE_DEBUG("  Gx:\r\n");
+   TRACE_DEBUG_MPI("    ", &params->g.x);
+   TRACE_DEBUG("  Gy:\r\n");
+   TRACE_DEBUG_MPI("    ", &params->g.y);
+   TRACE_DEBUG("  q:\r\n");
+   TRACE_DEBUG_MPI("    ", &params->q);
+
+end:
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Initialize elliptic curve point
+ * @param[in,out] r Pointer to the EC point to be initialized
+ **/
+
+void ecInit(EcPoint *r)
+{
+   //Initialize structure
+   mpiInit(&r->x);
+   mpiInit(&r->y);
+   mpiInit(&r->z);
+}
+
+
+/**
+ * @brief Release an elliptic curve point
+ * @param[in,out] r Pointer to the EC point to initialize to free
+ **/
+
+void ecFree(EcPoint *r)
+{
+   //Release previously allocated resources
+   mpiFree(&r->x);
+   mpiFree(&r->y);
+   mpiFree(&r->z);
+}
+
+
+/**
+ * @brief Copy EC point
+ * @param[out] r Destination EC point
+ * @param[in] s Source EC point
+ * @return Error code
+ **/
+
+error_t ecCopy(EcPoint *r, const EcPoint *s)
+{
+   error_t error;
+
+   //R and S are the same instance?
+   if(r == s)
+      return NO_ERROR;
+
+   //Copy coordinates
+   MPI_CHECK(mpiCopy(&r->x, &s->x));
+   MPI_CHECK(mpiCopy(&r->y, &s->y));
+   MPI_CHECK(mpiCopy(&r->z, &s->z));
+
+end:
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Convert an octet string to an EC point
+ * @param[in] params EC domain parameters
+ * @param[out] r EC point resulting from the conversion
+ * @param[in] data Pointer to the octet string
+ * @param[in] length Length of the octet string
+ * @return Error code
+ **/
+
+error_t ecImport(const EcDomainParameters *params,
+   EcPoint *r, const uint8_t *data, size_t length)
+{
+   error_t error;
+   size_t k;
+
+   //Get the length in octets of the prime
+   k = mpiGetByteLength(&params->p);
+
+   //Check the length of the octet string
+   if(length != (k * 2 + 1))
+      return ERROR_DECODING_FAILED;
+
+   //Compressed point representation is not supported
+   if(data[0] != 0x04)
+      return ERROR_ILLEGAL_PARAMETER;
+
+   //Convert the x-coordinate to a multiple precision integer
+   MPI_CHECK(mpiReadRaw(&r->x, data + 1, k));
+   //Convert the y-coordinate to a multiple precision integer
+   MPI_CHECK(mpiReadRaw(&r->y, data + k + 1, k));
+   //The point is expressed in affine coordinates
+   MPI_CHECK(mpiSetValue(&r->z, 1));
+
+end:
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Convert an EC point to an octet string
+ * @param[in] params EC domain parameters
+ * @param[in] a EC point to be converted (affine coordinates)
+ * @param[out] data Pointer to the octet string
+ * @param[out] length Length of the resulting octet string
+ * @return Error code
+ **/
+
+error_t ecExport(const EcDomainParameters *params,
+   const EcPoint *a, uint8_t *data, size_t *length)
+{
+   error_t error;
+   size_t k;
+
+   //Get the length in octets of the prime
+   k = mpiGetByteLength(&params->p);
+
+   //Point compression is not used
+   data[0] = 0x04;
+
+   //Convert the x-coordinate to an octet string
+   MPI_CHECK(mpiWriteRaw(&a->x, data + 1, k));
+   //Convert the y-coordinate to an octet string
+   MPI_CHECK(mpiWriteRaw(&a->y, data + k + 1, k));
+
+   //Return the total number of bytes that have been written
+   *length = k * 2 + 1;
+
+end:
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Compute projective representation
+ * @param[in] params EC domain parameters
+ * @param[out] r Projective representation of the point
+ * @param[in] s Affine representation of the point
+ * @return Error code
+ **/
+
+error_t ecProjectify(const EcDomainParameters *params, EcPoint *r, const EcPoint *s)
+{
+   error_t error;
+
+   //Copy point
+   MPI_CHECK(ecCopy(r, s));
+   //Map the point to projective space
+   MPI_CHECK(mpiSetValue(&r->z, 1));
+
+end:
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Recover affine representation
+ * @param[in] params EC domain parameters
+ * @param[out] r Affine representation of the point
+ * @param[in] s Projective representation of the point
+ * @return Error code
+ **/
+
+error_t ecAffinify(const EcDomainParameters *params, EcPoint *r, const EcPoint *s)
+{
+   error_t error;
+   Mpi a;
+   Mpi b;
+
+   //Point at the infinity?
+   if(!mpiCompInt(&s->z, 0))
+      return ERROR_INVALID_PARAMETER;
+
+   //Initialize multiple precision integers
+   mpiInit(&a);
+   mpiInit(&b);
+
+   //Compute a = 1/Sz mod p
+   MPI_CHECK(mpiInvMod(&a, &s->z, &params->p));
+
+   //Set Rx = a^2 * Sx mod p
+   MPI_CHECK(ecSqrMod(params, &b, &a));
+   MPI_CHECK(ecMulMod(params, &r->x, &b, &s->x));
+
+   //Set Ry = a^3 * Sy mod p
+   MPI_CHECK(ecMulMod(params, &b, &b, &a));
+   MPI_CHECK(ecMulMod(params, &r->y, &b, &s->y));
+
+   //Set Rz = 1
+   MPI_CHECK(mpiSetValue(&r->z, 1));
+
+end:
+   //Release multiple precision integers
+   mpiFree(&a);
+   mpiFree(&b);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Check whether the affine point S is on the curve
+ * @param[in] params EC domain parameters
+ * @param[in] s Affine representation of the point
+ * @return TRUE if the affine point S is on the curve, else FALSE
+ **/
+
+bool_t ecIsPointAffine(const EcDomainParameters *params, const EcPoint *s)
+{
+   error_t error;
+   Mpi t1;
+   Mpi t2;
+
+   //The coordinates must lie in the range [0, p - 1]
+   if(mpiCompInt(&s->x, 0) < 0 || mpiComp(&s->x, &params->p) >= 0)
+      return FALSE;
+   if(mpiCompInt(&s->y, 0) < 0 || mpiComp(&s->y, &params->p) >= 0)
+      return FALSE;
+
+   //Initialize multiple precision integers
+   mpiInit(&t1);
+   mpiInit(&t2);
+
+   //Compute t1 = (Sx^3 + a * Sx + b) mod p
+   MPI_CHECK(ecSqrMod(params, &t1, &s->x));
+   MPI_CHECK(ecMulMod(params, &t1, &t1, &s->x));
+   MPI_CHECK(ecMulMod(params, &t2, &params->a, &s->x));
+   MPI_CHECK(ecAddMod(params, &t1, &t1, &t2));
+   MPI_CHECK(ecAddMod(params, &t1, &t1, &params->b));
+
+   //Compute t2 = Sy^2
+   MPI_CHECK(ecSqrMod(params, &t2, &s->y));
+
+   //Check whether the point is on the elliptic curve
+   if(mpiComp(&t1, &t2))
+      error = ERROR_FAILURE;
+
+end:
+   //Release multiple precision integers
+   mpiFree(&t1);
+   mpiFree(&t2);
+
+   //Return TRUE if the affine point S is on the curve, else FALSE
+   return error ? FALSE : TRUE;
+}
+
+
+/**
+ * @brief Point doubling
+ * @param[in] params EC domain parameters
+ * @param[out] r Resulting point R = 2S
+ * @param[in] s Point S
+ * @return Error code
+ **/
+
+error_t ecDouble(const EcDomainParameters *params, EcPoint *r, const EcPoint *s)
+{
+   error_t error;
+   Mpi t1;
+   Mpi t2;
+   Mpi t3;
+   Mpi t4;
+   Mpi t5;
+
+   //Initialize multiple precision integers
+   mpiInit(&t1);
+   mpiInit(&t2);
+   mpiInit(&t3);
+   mpiInit(&t4);
+   mpiInit(&t5);
+
+   //Point at the infinity or point of order 2?
+   if(!mpiCompInt(&s->z, 0) || !mpiCompInt(&s->y, 0))
+   {
+      //Set R = (1, 1, 0)
+      MPI_CHECK(mpiSetValue(&r->x, 1));
+      MPI_CHECK(mpiSetValue(&r->y, 1));
+      MPI_CHECK(mpiSetValue(&r->z, 0));
+      //We are done
+      goto end;
+   }
+
+   //Compute t1 = Sy^2
+   MPI_CHECK(ecSqrMod(params, &t1, &s->y));
+   //Compute t2 = 4 * Sx * t1 (S)
+   MPI_CHECK(ecMulMod(params, &t2, &s->x, &t1));
+   MPI_CHECK(ecAddMod(params, &t2, &t2, &t2));
+   MPI_CHECK(ecAddMod(params, &t2, &t2, &t2));
+
+   //Compute t3 = 3 * Sx^2 + a * Sz^4 (M)
+   MPI_CHECK(ecSqrMod(params, &t3, &s->z));
+   MPI_CHECK(ecSqrMod(params, &t3, &t3));
+   MPI_CHECK(ecMulMod(params, &t3, &t3, &params->a));
+   MPI_CHECK(ecSqrMod(params, &t4, &s->x));
+   MPI_CHECK(ecAddMod(params, &t3, &t3, &t4));
+   MPI_CHECK(ecAddMod(params, &t3, &t3, &t4));
+   MPI_CHECK(ecAddMod(params, &t3, &t3, &t4));
+
+   //Compute Rz = 2 * Sy * Sz
+   MPI_CHECK(ecMulMod(params, &t5, &s->y, &s->z));
+   MPI_CHECK(ecAddMod(params, &r->z, &t5, &t5));
+
+   //Compute Rx = M^2 - 2 * S
+   MPI_CHECK(ecSqrMod(params, &t4, &t3));
+   MPI_CHECK(ecSubMod(params, &t4, &t4, &t2));
+   MPI_CHECK(ecSubMod(params, &r->x, &t4, &t2));
+
+   //Compute t1 = 8 * Sy^4
+   MPI_CHECK(ecSqrMod(params, &t1, &t1));
+   MPI_CHECK(ecAddMod(params, &t1, &t1, &t1));
+   MPI_CHECK(ecAddMod(params, &t1, &t1, &t1));
+   MPI_CHECK(ecAddMod(params, &t1, &t1, &t1));
+
+   //Compute Ry = M * (S - Rx) - 8 * Sy^4
+   MPI_CHECK(ecSubMod(params, &t2, &t2, &r->x));
+   MPI_CHECK(ecMulMod(params, &t2, &t2, &t3));
+   MPI_CHECK(ecSubMod(params, &r->y, &t2, &t1));
+
+end:
+   //Release multiple precision integers
+   mpiFree(&t1);
+   mpiFree(&t2);
+   mpiFree(&t3);
+   mpiFree(&t4);
+   mpiFree(&t5);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Point addition
+ * @param[in] params EC domain parameters
+ * @param[out] r Resulting point R = S + T
+ * @param[in] s First operand
+ * @param[in] t Second operand
+ * @return Error code
+ **/
+
+error_t ecAdd(const EcDomainParameters *params,
+   EcPoint *r, const EcPoint *s, const EcPoint *t)
+{
+   error_t error;
+   Mpi u1;
+   Mpi u2;
+   Mpi s1;
+   Mpi s2;
+   Mpi t1;
+   Mpi t2;
+
+   //Check whether S is the point at the infinity
+   if(!mpiCompInt(&s->z, 0))
+      return ecCopy(r, t);
+   //Check whether T is the point at the infinity
+   if(!mpiCompInt(&t->z, 0))
+      return ecCopy(r, s);
+
+   //Initialize multiple precision integers
+   mpiInit(&u1);
+   mpiInit(&u2);
+   mpiInit(&s1);
+   mpiInit(&s2);
+   mpiInit(&t1);
+   mpiInit(&t2);
+
+   //Compute U1 = Sx * Tz^2 and S1 = Sy * Tz^3
+   MPI_CHECK(ecSqrMod(params, &t1, &t->z));
+   MPI_CHECK(ecMulMod(params, &u1, &s->x, &t1));
+   MPI_CHECK(ecMulMod(params, &t1, &t1, &t->z));
+   MPI_CHECK(ecMulMod(params, &s1, &s->y, &t1));
+
+   //Compute U2 = Tx * Sz^2 and S2 = Ty * Sz^3
+   MPI_CHECK(ecSqrMod(params, &t1, &s->z));
+   MPI_CHECK(ecMulMod(params, &u2, &t->x, &t1));
+   MPI_CHECK(ecMulMod(params, &t1, &t1, &s->z));
+   MPI_CHECK(ecMulMod(params, &s2, &t->y, &t1));
+
+   //Compute H = U2 - U1 and R = S2 - S1
+   MPI_CHECK(ecSubMod(params, &u2, &u2, &u1));
+   MPI_CHECK(ecSubMod(params, &s2, &s2, &s1));
+
+   //Special cases of the addition formula?
+   if(!mpiCompInt(&u2, 0))
+   {
+      //S and T are the same point?
+      if(!mpiCompInt(&s2, 0))
+      {
+         //Use the doubling formula
+         MPI_CHECK(ecDouble(params, r, s));
+      }
+      else
+      {
+         //S = -T, hence R is the point at the infinity
+         MPI_CHECK(mpiSetValue(&r->x, 1));
+         MPI_CHECK(mpiSetValue(&r->y, 1));
+         MPI_CHECK(mpiSetValue(&r->z, 0));
+      }
+   }
+   else
+   {
+      //Compute Rz = H * Sz * Tz
+      MPI_CHECK(ecMulMod(params, &t1, &s->z, &t->z));
+      MPI_CHECK(ecMulMod(params, &r->z, &t1, &u2));
+
+      //Compute t1 = H^2 and t2 = H^3
+      MPI_CHECK(ecSqrMod(params, &t1, &u2));
+      MPI_CHECK(ecMulMod(params, &t2, &t1, &u2));
+      //Compute u1 = U1 * H^2
+      MPI_CHECK(ecMulMod(params, &u1, &u1, &t1));
+
+      //Compute Rx = R^2 - H^3 - 2 * U1 * H^2
+      MPI_CHECK(ecSqrMod(params, &t1, &s2));
+      MPI_CHECK(ecSubMod(params, &t1, &t1, &t2));
+      MPI_CHECK(ecSubMod(params, &t1, &t1, &u1));
+      MPI_CHECK(ecSubMod(params, &r->x, &t1, &u1));
+
+      //Compute Ry = R * (U1 * H^2 - Rx) - S1 * H^3
+      MPI_CHECK(ecSubMod(params, &u1, &u1, &r->x));
+      MPI_CHECK(ecMulMod(params, &u1, &u1, &s2));
+      MPI_CHECK(ecMulMod(params, &t2, &t2, &s1));
+      MPI_CHECK(ecSubMod(params, &r->y, &u1, &t2));
+   }
+
+end:
+   //Release multiple precision integers
+   mpiFree(&u1);
+   mpiFree(&u2);
+   mpiFree(&s1);
+   mpiFree(&s2);
+   mpiFree(&t1);
+   mpiFree(&t2);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Scalar multiplication
+ *
+ * The Montgomery ladder performs one addition and one doubling for each
+ * bit of the scalar, whatever its value
+ *
+ * @param[in] params EC domain parameters
+ * @param[out] r Resulting point R = d.S
+ * @param[in] d An integer d such as 0 <= d < p
+ * @param[in] s EC point
+ * @return Error code
+ **/
+
+error_t ecMult(const EcDomainParameters *params,
+   EcPoint *r, const Mpi *d, const EcPoint *s)
+{
+   error_t error;
+   int_t i;
+   EcPoint r0;
+   EcPoint r1;
+
+   //Initialize EC points
+   ecInit(&r0);
+   ecInit(&r1);
+
+   //Set R0 = O (point at the infinity)
+   MPI_CHECK(mpiSetValue(&r0.x, 1));
+   MPI_CHECK(mpiSetValue(&r0.y, 1));
+   MPI_CHECK(mpiSetValue(&r0.z, 0));
+   //Set R1 = S
+   MPI_CHECK(ecCopy(&r1, s));
+
+   //Scan the scalar from left to right
+   for(i = mpiGetBitLength(d) - 1; i >= 0; i--)
+   {
+      //Check the value of the current bit
+      if(mpiGetBitValue(d, i))
+      {
+         //Compute R0 = R0 + R1 and R1 = 2.R1
+         MPI_CHECK(ecAdd(params, &r0, &r0, &r1));
+         MPI_CHECK(ecDouble(params, &r1, &r1));
+      }
+      else
+      {
+         //Compute R1 = R0 + R1 and R0 = 2.R0
+         MPI_CHECK(ecAdd(params, &r1, &r0, &r1));
+         MPI_CHECK(ecDouble(params, &r0, &r0));
+      }
+   }
+
+   //Copy the result
+   MPI_CHECK(ecCopy(r, &r0));
+
+end:
+   //Release EC points
+   ecFree(&r0);
+   ecFree(&r1);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Twin multiplication
+ *
+ * Shamir's trick is used to compute both products at once. This function
+ * is only intended to operate on public values (signature verification)
+ *
+ * @param[in] params EC domain parameters
+ * @param[out] r Resulting point R = d0.S + d1.T
+ * @param[in] d0 An integer d such as 0 <= d0 < p
+ * @param[in] s EC point
+ * @param[in] d1 An integer d such as 0 <= d1 < p
+ * @param[in] t EC point
+ * @return Error code
+ **/
+
+error_t ecTwinMult(const EcDomainParameters *params, EcPoint *r,
+   const Mpi *d0, const EcPoint *s, const Mpi *d1, const EcPoint *t)
+{
+   error_t error;
+   int_t i;
+   uint_t b0;
+   uint_t b1;
+   EcPoint u;
+   EcPoint v;
+
+   //Initialize EC points
+   ecInit(&u);
+   ecInit(&v);
+
+   //Precompute U = S + T
+   MPI_CHECK(ecAdd(params, &u, s, t));
+
+   //Set V = O (point at the infinity)
+   MPI_CHECK(mpiSetValue(&v.x, 1));
+   MPI_CHECK(mpiSetValue(&v.y, 1));
+   MPI_CHECK(mpiSetValue(&v.z, 0));
+
+   //Scan both scalars from left to right
+   for(i = max(mpiGetBitLength(d0), mpiGetBitLength(d1)) - 1; i >= 0; i--)
+   {
+      //Compute V = 2.V
+      MPI_CHECK(ecDouble(params, &v, &v));
+
+      //Retrieve the current bit of each scalar
+      b0 = mpiGetBitValue(d0, i);
+      b1 = mpiGetBitValue(d1, i);
+
+      //Add S, T or S + T to V, depending on the bit values
+      if(b0 && b1)
+      {
+         MPI_CHECK(ecAdd(params, &v, &v, &u));
+      }
+      else if(b0)
+      {
+         MPI_CHECK(ecAdd(params, &v, &v, s));
+      }
+      else if(b1)
+      {
+         MPI_CHECK(ecAdd(params, &v, &v, t));
+      }
+   }
+
+   //Copy the result
+   MPI_CHECK(ecCopy(r, &v));
+
+end:
+   //Release EC points
+   ecFree(&u);
+   ecFree(&v);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Montgomery ladder (x-coordinate only)
+ *
+ * This function implements the X25519 function as described in
+ * RFC 7748. The scalar is expected to be clamped by the caller
+ *
+ * @param[in] params Domain parameters of the Montgomery curve
+ * @param[out] r Resulting u-coordinate
+ * @param[in] k Scalar
+ * @param[in] u Input u-coordinate
+ * @return Error code
+ **/
+
+error_t ecMontgomeryMult(const EcDomainParameters *params,
+   Mpi *r, const Mpi *k, const Mpi *u)
+{
+   error_t error;
+   int_t i;
+   uint_t b;
+   uint_t swap;
+   Mpi tmp;
+   Mpi x1;
+   Mpi x2;
+   Mpi z2;
+   Mpi x3;
+   Mpi z3;
+   Mpi t1;
+   Mpi t2;
+   Mpi t3;
+   Mpi t4;
+   Mpi a24;
+
+   //Initialize multiple precision integers
+   mpiInit(&x1);
+   mpiInit(&x2);
+   mpiInit(&z2);
+   mpiInit(&x3);
+   mpiInit(&z3);
+   mpiInit(&t1);
+   mpiInit(&t2);
+   mpiInit(&t3);
+   mpiInit(&t4);
+   mpiInit(&a24);
+
+   //Compute a24 = (A - 2) / 4
+   MPI_CHECK(mpiSubInt(&a24, &params->a, 2));
+   MPI_CHECK(mpiShiftRight(&a24, 2));
+
+   //Set x1 = u, x2 = 1, z2 = 0, x3 = u and z3 = 1
+   MPI_CHECK(mpiCopy(&x1, u));
+   MPI_CHECK(mpiSetValue(&x2, 1));
+   MPI_CHECK(mpiSetValue(&z2, 0));
+   MPI_CHECK(mpiCopy(&x3, u));
+   MPI_CHECK(mpiSetValue(&z3, 1));
+
+   //No pending swap
+   swap = 0;
+
+   //Process the scalar from left to right
+   for(i = mpiGetBitLength(&params->p) - 1; i >= 0; i--)
+   {
+      //Get the current bit of the scalar
+      b = mpiGetBitValue(k, i);
+
+      //Conditionally swap (x2, z2) and (x3, z3)
+      if(swap ^ b)
+      {
+         tmp = x2, x2 = x3, x3 = tmp;
+         tmp = z2, z2 = z3, z3 = tmp;
+      }
+
+      //Save the current bit for the next iteration
+      swap = b;
+
+      //Compute t1 = x2 + z2 (A) and t2 = x2 - z2 (B)
+      MPI_CHECK(ecAddMod(params, &t1, &x2, &z2));
+      MPI_CHECK(ecSubMod(params, &t2, &x2, &z2));
+      //Compute t3 = x3 + z3 (C) and t4 = x3 - z3 (D)
+      MPI_CHECK(ecAddMod(params, &t3, &x3, &z3));
+      MPI_CHECK(ecSubMod(params, &t4, &x3, &z3));
+
+      //Compute t4 = D * A (DA) and t3 = C * B (CB)
+      MPI_CHECK(ecMulMod(params, &t4, &t4, &t1));
+      MPI_CHECK(ecMulMod(params, &t3, &t3, &t2));
+
+      //Compute x3 = (DA + CB)^2 and z3 = x1 * (DA - CB)^2
+      MPI_CHECK(ecAddMod(params, &x3, &t4, &t3));
+      MPI_CHECK(ecSqrMod(params, &x3, &x3));
+      MPI_CHECK(ecSubMod(params, &z3, &t4, &t3));
+      MPI_CHECK(ecSqrMod(params, &z3, &z3));
+      MPI_CHECK(ecMulMod(params, &z3, &z3, &x1));
+
+      //Compute t1 = A^2 (AA) and t2 = B^2 (BB)
+      MPI_CHECK(ecSqrMod(params, &t1, &t1));
+      MPI_CHECK(ecSqrMod(params, &t2, &t2));
+
+      //Compute x2 = AA * BB
+      MPI_CHECK(ecMulMod(params, &x2, &t1, &t2));
+
+      //Compute z2 = E * (AA + a24 * E) where E = AA - BB
+      MPI_CHECK(ecSubMod(params, &t2, &t1, &t2));
+      MPI_CHECK(ecMulMod(params, &z2, &a24, &t2));
+      MPI_CHECK(ecAddMod(params, &z2, &z2, &t1));
+      MPI_CHECK(ecMulMod(params, &z2, &z2, &t2));
+   }
+
+   //Final conditional swap
+   if(swap)
+   {
+      tmp = x2, x2 = x3, x3 = tmp;
+      tmp = z2, z2 = z3, z3 = tmp;
+   }
+
+   //Multiplying by zero yields the all-zero value
+   if(!mpiCompInt(&z2, 0))
+   {
+      MPI_CHECK(mpiSetValue(r, 0));
+   }
+   else
+   {
+      //Compute r = x2 / z2 mod p
+      MPI_CHECK(mpiInvMod(&z2, &z2, &params->p));
+      MPI_CHECK(ecMulMod(params, r, &x2, &z2));
+   }
+
+end:
+   //Release multiple precision integers
+   mpiFree(&x1);
+   mpiFree(&x2);
+   mpiFree(&z2);
+   mpiFree(&x3);
+   mpiFree(&z3);
+   mpiFree(&t1);
+   mpiFree(&t2);
+   mpiFree(&t3);
+   mpiFree(&t4);
+   mpiFree(&a24);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Modular addition
+ * @param[in] params EC domain parameters
+ * @param[out] r Resulting integer R = (A + B) mod p
+ * @param[in] a An integer such as 0 <= A < p
+ * @param[in] b An integer such as 0 <= B < p
+ * @return Error code
+ **/
+
+error_t ecAddMod(const EcDomainParameters *params, Mpi *r, const Mpi *a, const Mpi *b)
+{
+   error_t error;
+
+   //Compute R = A + B
+   MPI_CHECK(mpiAdd(r, a, b));
+
+   //Compute R = (A + B) mod p
+   if(mpiComp(r, &params->p) >= 0)
+   {
+      MPI_CHECK(mpiSub(r, r, &params->p));
+   }
+
+end:
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Modular subtraction
+ * @param[in] params EC domain parameters
+ * @param[out] r Resulting integer R = (A - B) mod p
+ * @param[in] a An integer such as 0 <= A < p
+ * @param[in] b An integer such as 0 <= B < p
+ * @return Error code
+ **/
+
+error_t ecSubMod(const EcDomainParameters *params, Mpi *r, const Mpi *a, const Mpi *b)
+{
+   error_t error;
+
+   //Compute R = A - B
+   MPI_CHECK(mpiSub(r, a, b));
+
+   //Compute R = (A - B) mod p
+   if(mpiCompInt(r, 0) < 0)
+   {
+      MPI_CHECK(mpiAdd(r, r, &params->p));
+   }
+
+end:
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Modular multiplication
+ * @param[in] params EC domain parameters
+ * @param[out] r Resulting integer R = (A * B) mod p
+ * @param[in] a An integer such as 0 <= A < p
+ * @param[in] b An integer such as 0 <= B < p
+ * @return Error code
+ **/
+
+error_t ecMulMod(const EcDomainParameters *params, Mpi *r, const Mpi *a, const Mpi *b)
+{
+   error_t error;
+
+   //Compute R = A * B
+   MPI_CHECK(mpiMul(r, a, b));
+
+   //Use the fast modular reduction if the curve provides one
+   if(params->mod != NULL)
+   {
+      MPI_CHECK(params->mod(r, &params->p));
+   }
+   else
+   {
+      MPI_CHECK(mpiMod(r, r, &params->p));
+   }
+
+end:
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Modular squaring
+ * @param[in] params EC domain parameters
+ * @param[out] r Resulting integer R = (A ^ 2) mod p
+ * @param[in] a An integer such as 0 <= A < p
+ * @return Error code
+ **/
+
+error_t ecSqrMod(const EcDomainParameters *params, Mpi *r, const Mpi *a)
+{
+   //Compute R = (A ^ 2) mod p
+   return ecMulMod(params, r, a, a);
+}
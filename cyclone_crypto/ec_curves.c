@@ -0,0 +1,383 @@
+/**
+ * @file ec_curves.c
+ * @brief Elliptic curves
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Domain parameters of the elliptic curves supported by the EC module.
+ * Refer to SEC 2 and RFC 7748 for more details
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL CRYPTO_TRACE_LEVEL
+
+//Dependencies
+#include <stdlib.h>
+#include <string.h>
+#include "crypto.h"
+#include "ec_curves.h"
+#include "debug.h"
+
+//secp256r1 OID (1.2.840.10045.3.1.7)
+const uint8_t SECP256R1_OID[8] = {0x2A, 0x86, 0x48, 0xCE, 0x3D, 0x03, 0x01, 0x07};
+//secp384r1 OID (1.3.132.0.34)
+const uint8_t SECP384R1_OID[5] = {0x2B, 0x81, 0x04, 0x00, 0x22};
+//X25519 OID (1.3.101.110)
+const uint8_t X25519_OID[3] = {0x2B, 0x65, 0x6E};
+
+
+/**
+ * @brief secp256r1 elliptic curve
+ **/
+
+const EcCurveInfo secp256r1Curve =
+{
+   //Curve name
+   "secp256r1",
+   //Object identifier
+   SECP256R1_OID,
+   sizeof(SECP256R1_OID),
+   //Curve type
+   EC_CURVE_TYPE_PRIME,
+   //Prime modulus p
+   {
+      0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF},
+   32,
+   //Curve parameter a
+   {
+      0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFC},
+   32,
+   //Curve parameter b
+   {
+      0x5A, 0xC6, 0x35, 0xD8, 0xAA, 0x3A, 0x93, 0xE7, 0xB3, 0xEB, 0xBD, 0x55, 0x76, 0x98, 0x86, 0xBC,
+      0x65, 0x1D, 0x06, 0xB0, 0xCC, 0x53, 0xB0, 0xF6, 0x3B, 0xCE, 0x3C, 0x3E, 0x27, 0xD2, 0x60, 0x4B},
+   32,
+   //Base point G x-coordinate
+   {
+      0x6B, 0x17, 0xD1, 0xF2, 0xE1, 0x2C, 0x42, 0x47, 0xF8, 0xBC, 0xE6, 0xE5, 0x63, 0xA4, 0x40, 0xF2,
+      0x77, 0x03, 0x7D, 0x81, 0x2D, 0xEB, 0x33, 0xA0, 0xF4, 0xA1, 0x39, 0x45, 0xD8, 0x98, 0xC2, 0x96},
+   32,
+   //Base point G y-coordinate
+   {
+      0x4F, 0xE3, 0x42, 0xE2, 0xFE, 0x1A, 0x7F, 0x9B, 0x8E, 0xE7, 0xEB, 0x4A, 0x7C, 0x0F, 0x9E, 0x16,
+      0x2B, 0xCE, 0x33, 0x57, 0x6B, 0x31, 0x5E, 0xCE, 0xCB, 0xB6, 0x40, 0x68, 0x37, 0xBF, 0x51, 0xF5},
+   32,
+   //Base point G order q
+   {
+      0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+      0xBC, 0xE6, 0xFA, 0xAD, 0xA7, 0x17, 0x9E, 0x84, 0xF3, 0xB9, 0xCA, 0xC2, 0xFC, 0x63, 0x25, 0x51},
+   32,
+   //Cofactor
+   1,
+   //Fast modular reduction
+   secp256r1Mod
+};
+
+
+/**
+ * @brief secp384r1 elliptic curve
+ **/
+
+const EcCurveInfo secp384r1Curve =
+{
+   //Curve name
+   "secp384r1",
+   //Object identifier
+   SECP384R1_OID,
+   sizeof(SECP384R1_OID),
+   //Curve type
+   EC_CURVE_TYPE_PRIME,
+   //Prime modulus p
+   {
+      0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+      0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFE,
+      0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFF},
+   48,
+   //Curve parameter a
+   {
+      0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+      0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFE,
+      0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFF, 0xFF, 0xFF, 0xFC},
+   48,
+   //Curve parameter b
+   {
+      0xB3, 0x31, 0x2F, 0xA7, 0xE2, 0x3E, 0xE7, 0xE4, 0x98, 0x8E, 0x05, 0x6B, 0xE3, 0xF8, 0x2D, 0x19,
+      0x18, 0x1D, 0x9C, 0x6E, 0xFE, 0x81, 0x41, 0x12, 0x03, 0x14, 0x08, 0x8F, 0x50, 0x13, 0x87, 0x5A,
+      0xC6, 0x56, 0x39, 0x8D, 0x8A, 0x2E, 0xD1, 0x9D, 0x2A, 0x85, 0xC8, 0xED, 0xD3, 0xEC, 0x2A, 0xEF},
+   48,
+   //Base point G x-coordinate
+   {
+      0xAA, 0x87, 0xCA, 0x22, 0xBE, 0x8B, 0x05, 0x37, 0x8E, 0xB1, 0xC7, 0x1E, 0xF3, 0x20, 0xAD, 0x74,
+      0x6E, 0x1D, 0x3B, 0x62, 0x8B, 0xA7, 0x9B, 0x98, 0x59, 0xF7, 0x41, 0xE0, 0x82, 0x54, 0x2A, 0x38,
+      0x55, 0x02, 0xF2, 0x5D, 0xBF, 0x55, 0x29, 0x6C, 0x3A, 0x54, 0x5E, 0x38, 0x72, 0x76, 0x0A, 0xB7},
+   48,
+   //Base point G y-coordinate
+   {
+      0x36, 0x17, 0xDE, 0x4A, 0x96, 0x26, 0x2C, 0x6F, 0x5D, 0x9E, 0x98, 0xBF, 0x92, 0x92, 0xDC, 0x29,
+      0xF8, 0xF4, 0x1D, 0xBD, 0x28, 0x9A, 0x14, 0x7C, 0xE9, 0xDA, 0x31, 0x13, 0xB5, 0xF0, 0xB8, 0xC0,
+      0x0A, 0x60, 0xB1, 0xCE, 0x1D, 0x7E, 0x81, 0x9D, 0x7A, 0x43, 0x1D, 0x7C, 0x90, 0xEA, 0x0E, 0x5F},
+   48,
+   //Base point G order q
+   {
+      0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+      0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xC7, 0x63, 0x4D, 0x81, 0xF4, 0x37, 0x2D, 0xDF,
+      0x58, 0x1A, 0x0D, 0xB2, 0x48, 0xB0, 0xA7, 0x7A, 0xEC, 0xEC, 0x19, 0x6A, 0xCC, 0xC5, 0x29, 0x73},
+   48,
+   //Cofactor
+   1,
+   //Fast modular reduction
+   NULL
+};
+
+
+/**
+ * @brief Curve25519 (X25519 function)
+ **/
+
+const EcCurveInfo x25519Curve =
+{
+   //Curve name
+   "x25519",
+   //Object identifier
+   X25519_OID,
+   sizeof(X25519_OID),
+   //Curve type
+   EC_CURVE_TYPE_MONTGOMERY,
+   //Prime modulus p
+   {
+      0x7F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+      0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xED},
+   32,
+   //Curve parameter a
+   {
+      0x07, 0x6D, 0x06},
+   3,
+   //Curve parameter b
+   {
+      0x01},
+   1,
+   //Base point G x-coordinate
+   {
+      0x09},
+   1,
+   //Base point G y-coordinate (not used)
+   {0x00},
+   0,
+   //Base point G order q
+   {
+      0x10, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+      0x14, 0xDE, 0xF9, 0xDE, 0xA2, 0xF7, 0x9C, 0xD6, 0x58, 0x12, 0x63, 0x1A, 0x5C, 0xF5, 0xD3, 0xED},
+   32,
+   //Cofactor
+   8,
+   //Fast modular reduction
+   x25519Mod
+};
+
+
+/**
+ * @brief Fast modular reduction (secp256r1 curve)
+ *
+ * The reduction takes advantage of the special form of the prime
+ * p = 2^256 - 2^224 + 2^192 + 2^96 - 1 (refer to FIPS 186-3, D.2.3)
+ *
+ * @param[in,out] a This function accept an integer less than p^2 as
+ *   input and return (a mod p) as output
+ * @param[in] p Prime modulus
+ * @return Error code
+ **/
+
+error_t secp256r1Mod(Mpi *a, const Mpi *p)
+{
+   error_t error;
+   uint_t i;
+   int64_t c;
+   uint64_t t;
+   uint32_t w[16];
+   uint32_t r[8];
+
+   //Copy the 512-bit input value
+   for(i = 0; i < 16; i++)
+      w[i] = (i < a->size) ? a->data[i] : 0;
+
+   //Compute s1 + 2.s2 + 2.s3 + s4 + s5 - s6 - s7 - s8 - s9
+   c = (int64_t) w[0] + w[8] + w[9] - w[11] - w[12] - w[13] - w[14];
+   r[0] = (uint32_t) c;
+   c >>= 32;
+   c += (int64_t) w[1] + w[9] + w[10] - w[12] - w[13] - w[14] - w[15];
+   r[1] = (uint32_t) c;
+   c >>= 32;
+   c += (int64_t) w[2] + w[10] + w[11] - w[13] - w[14] - w[15];
+   r[2] = (uint32_t) c;
+   c >>= 32;
+   c += (int64_t) w[3] + 2 * (int64_t) w[11] + 2 * (int64_t) w[12] + w[13] - w[15] - w[8] - w[9];
+   r[3] = (uint32_t) c;
+   c >>= 32;
+   c += (int64_t) w[4] + 2 * (int64_t) w[12] + 2 * (int64_t) w[13] + w[14] - w[9] - w[10];
+   r[4] = (uint32_t) c;
+   c >>= 32;
+   c += (int64_t) w[5] + 2 * (int64_t) w[13] + 2 * (int64_t) w[14] + w[15] - w[10] - w[11];
+   r[5] = (uint32_t) c;
+   c >>= 32;
+   c += (int64_t) w[6] + 3 * (int64_t) w[14] + 2 * (int64_t) w[15] + w[13] - w[8] - w[9];
+   r[6] = (uint32_t) c;
+   c >>= 32;
+   c += (int64_t) w[7] + 3 * (int64_t) w[15] + w[8] - w[10] - w[11] - w[12] - w[13];
+   r[7] = (uint32_t) c;
+   c >>= 32;
+
+   //Add p as long as the intermediate result is negative
+   while(c < 0)
+   {
+      for(t = 0, i = 0; i < 8; i++)
+      {
+         t += (uint64_t) r[i] + p->data[i];
+         r[i] = (uint32_t) t;
+         t >>= 32;
+      }
+
+      //Propagate the carry
+      c += t;
+   }
+
+   //Adjust the size of the result
+   error = mpiGrow(a, 9);
+   //Any error to report?
+   if(error) return error;
+
+   //Copy the intermediate result
+   for(i = 0; i < a->size; i++)
+      a->data[i] = (i < 8) ? r[i] : 0;
+
+   //The carry is stored in the most significant word
+   a->data[8] = (uint32_t) c;
+   a->sign = 1;
+
+   //The intermediate result is less than 7.p
+   while(mpiComp(a, p) >= 0)
+   {
+      error = mpiSubAbs(a, a, p);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Fast modular reduction (X25519 function)
+ *
+ * The reduction relies on the fact that 2^256 = 38 mod p, where
+ * p = 2^255 - 19
+ *
+ * @param[in,out] a This function accept an integer less than p^2 as
+ *   input and return (a mod p) as output
+ * @param[in] p Prime modulus
+ * @return Error code
+ **/
+
+error_t x25519Mod(Mpi *a, const Mpi *p)
+{
+   error_t error;
+   uint_t i;
+   uint64_t c;
+   uint32_t w[16];
+
+   //Copy the 512-bit input value
+   for(i = 0; i < 16; i++)
+      w[i] = (i < a->size) ? a->data[i] : 0;
+
+   //Compute a = al + 38.ah
+   for(c = 0, i = 0; i < 8; i++)
+   {
+      c += (uint64_t) w[i] + (uint64_t) w[i + 8] * 38;
+      w[i] = (uint32_t) c;
+      c >>= 32;
+   }
+
+   //Fold the remaining carry back into the result
+   while(c > 0)
+   {
+      c *= 38;
+
+      for(i = 0; i < 8; i++)
+      {
+         c += w[i];
+         w[i] = (uint32_t) c;
+         c >>= 32;
+      }
+   }
+
+   //Adjust the size of the result
+   error = mpiGrow(a, 8);
+   //Any error to report?
+   if(error) return error;
+
+   //Copy the intermediate result
+   for(i = 0; i < a->size; i++)
+      a->data[i] = (i < 8) ? w[i] : 0;
+
+   a->sign = 1;
+
+   //The intermediate result is less than 3.p
+   while(mpiComp(a, p) >= 0)
+   {
+      error = mpiSubAbs(a, a, p);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Get the elliptic curve that matches the specified OID
+ * @param[in] oid Object identifier
+ * @param[in] length OID length
+ * @return Elliptic curve parameters
+ **/
+
+const EcCurveInfo *ecGetCurveInfo(const uint8_t *oid, size_t length)
+{
+   //secp256r1 elliptic curve?
+   if(length == sizeof(SECP256R1_OID) && !memcmp(oid, SECP256R1_OID, length))
+      return SECP256R1_CURVE;
+   //secp384r1 elliptic curve?
+   else if(length == sizeof(SECP384R1_OID) && !memcmp(oid, SECP384R1_OID, length))
+      return SECP384R1_CURVE;
+   //X25519 function?
+   else if(length == sizeof(X25519_OID) && !memcmp(oid, X25519_OID, length))
+      return X25519_CURVE;
+   //Unknown identifier?
+   else
+      return NULL;
+}
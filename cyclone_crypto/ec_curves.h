@@ -0,0 +1,108 @@
+/**
+ * @file ec_curves.h
+ * @brief Elliptic curves
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Domain parameters of the elliptic curves supported by the EC module.
+ * Refer to SEC 2 and RFC 7748 for more details
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _EC_CURVES_H
+#define _EC_CURVES_H
+
+//Dependencies
+#include "crypto.h"
+#include "mpi.h"
+
+//Elliptic curves
+#define SECP256R1_CURVE (&secp256r1Curve)
+#define SECP384R1_CURVE (&secp384r1Curve)
+#define X25519_CURVE (&x25519Curve)
+
+
+/**
+ * @brief Elliptic curve type
+ **/
+
+typedef enum
+{
+   EC_CURVE_TYPE_NONE       = 0,
+   EC_CURVE_TYPE_PRIME      = 1, ///<Short Weierstrass curve over a prime field
+   EC_CURVE_TYPE_MONTGOMERY = 2  ///<Montgomery curve (used for X25519)
+} EcCurveType;
+
+
+/**
+ * @brief Fast modular reduction
+ **/
+
+typedef error_t (*EcFastModAlgo)(Mpi *a, const Mpi *p);
+
+
+/**
+ * @brief Elliptic curve parameters
+ **/
+
+typedef struct
+{
+   const char_t *name;   ///<Curve name
+   const uint8_t *oid;   ///<Object identifier
+   size_t oidSize;       ///<OID size
+   EcCurveType type;     ///<Curve type
+   const uint8_t p[66];  ///<Prime modulus p
+   size_t pLen;          ///<Length of p
+   const uint8_t a[66];  ///<Curve parameter a
+   size_t aLen;          ///<Length of a
+   const uint8_t b[66];  ///<Curve parameter b
+   size_t bLen;          ///<Length of b
+   const uint8_t gx[66]; ///<x-coordinate of the base point G
+   size_t gxLen;         ///<Length of Gx
+   const uint8_t gy[66]; ///<y-coordinate of the base point G
+   size_t gyLen;         ///<Length of Gy
+   const uint8_t q[66];  ///<Order of the base point G
+   size_t qLen;          ///<Length of q
+   uint32_t h;           ///<Cofactor h
+   EcFastModAlgo mod;    ///<Fast modular reduction (optional)
+} EcCurveInfo;
+
+
+//Elliptic curve related constants
+extern const uint8_t SECP256R1_OID[8];
+extern const uint8_t SECP384R1_OID[5];
+extern const uint8_t X25519_OID[3];
+
+extern const EcCurveInfo secp256r1Curve;
+extern const EcCurveInfo secp384r1Curve;
+extern const EcCurveInfo x25519Curve;
+
+//Fast modular reduction
+error_t secp256r1Mod(Mpi *a, const Mpi *p);
+error_t x25519Mod(Mpi *a, const Mpi *p);
+
+const EcCurveInfo *ecGetCurveInfo(const uint8_t *oid, size_t length);
+
+#endif
@@ -0,0 +1,370 @@
+/**
+ * @file ecdh.c
+ * @brief ECDH (Elliptic Curve Diffie-Hellman) key exchange
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Elliptic Curve Diffie-Hellman (ECDH) is an anonymous key agreement protocol
+ * that allows two parties, each having an elliptic curve public-private key
+ * pair, to establish a shared secret over an insecure channel. Refer to
+ * SEC 1 and RFC 7748 for more details
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL CRYPTO_TRACE_LEVEL
+
+//Dependencies
+#include <stdlib.h>
+#include <string.h>
+#include "crypto.h"
+#include "ecdh.h"
+#include "debug.h"
+
+
+/**
+ * @brief Initialize ECDH context
+ * @param[in] context Pointer to the ECDH context
+ **/
+
+void ecdhInit(EcdhContext *context)
+{
+   //Initialize EC domain parameters
+   ecInitDomainParameters(&context->params);
+
+   //Initialize private and public keys
+   mpiInit(&context->da);
+   ecInit(&context->qa);
+   ecInit(&context->qb);
+}
+
+
+/**
+ * @brief Release ECDH context
+ * @param[in] context Pointer to the ECDH context
+ **/
+
+void ecdhFree(EcdhContext *context)
+{
+   //Release EC domain parameters
+   ecFreeDomainParameters(&context->params);
+
+   //Release private and public keys
+   mpiFree(&context->da);
+   ecFree(&context->qa);
+   ecFree(&context->qb);
+}
+
+
+/**
+ * @brief ECDH key pair generation
+ * @param[in] context Pointer to the ECDH context
+ * @param[in] prngAlgo PRNG algorithm
+ * @param[in] prngContext Pointer to the PRNG context
+ * @return Error code
+ **/
+
+error_t ecdhGenerateKeyPair(EcdhContext *context, const PrngAlgo *prngAlgo, void *prngContext)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   uint8_t k[32];
+
+   //Debug message
+   TRACE_DEBUG("Generating ECDH key pair...\r\n");
+
+   //X25519 function?
+   if(context->params.type == EC_CURVE_TYPE_MONTGOMERY)
+   {
+      //Generate a random scalar
+      error = prngAlgo->read(prngContext, k, 32);
+      //Any error to report?
+      if(error) return error;
+
+      //Clamp the scalar (RFC 7748, section 5)
+      k[0] &= 0xF8;
+      k[31] &= 0x7F;
+      k[31] |= 0x40;
+
+      //The scalar is little-endian encoded
+      for(i = 0; i < 16; i++)
+         n = k[i], k[i] = k[31 - i], k[31 - i] = n;
+
+      //Convert the scalar to a multiple precision integer
+      error = mpiReadRaw(&context->da, k, 32);
+      //Clear the scalar from memory
+      memset(k, 0, 32);
+      //Any error to report?
+      if(error) return error;
+
+      //Compute the public value Qa = X25519(da, 9)
+      error = ecMontgomeryMult(&context->params, &context->qa.x,
+         &context->da, &context->params.g.x);
+      //Any error to report?
+      if(error) return error;
+   }
+   else
+   {
+      //Let N be the bit length of q
+      n = mpiGetBitLength(&context->params.q);
+
+      //Generate a private value da in the range 1 to q - 1
+      do
+      {
+         //Generate a random number
+         error = mpiRand(&context->da, n, prngAlgo, prngContext);
+         //Any error to report?
+         if(error) return error;
+
+         //Make sure that da < q
+         if(mpiComp(&context->da, &context->params.q) >= 0)
+         {
+            error = mpiShiftRight(&context->da, 1);
+            //Any error to report?
+            if(error) return error;
+         }
+
+         //Discard the value zero
+      } while(!mpiCompInt(&context->da, 0));
+
+      //Compute Qa = da.G
+      error = ecMult(&context->params, &context->qa, &context->da, &context->params.g);
+      //Any error to report?
+      if(error) return error;
+
+      //Convert Qa to affine representation
+      error = ecAffinify(&context->params, &context->qa, &context->qa);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //Debug message
+   TRACE_DEBUG("  Private value:\r\n");
+   TRACE_DEBUG_MPI("    ", &context->da);
+   TRACE_DEBUG("  Public value (X):\r\n");
+   TRACE_DEBUG_MPI("    ", &context->qa.x);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Format our own public value
+ * @param[in] context Pointer to the ECDH context
+ * @param[out] output Buffer where to store the encoded public value
+ * @param[out] written Length of the encoded public value, in bytes
+ * @return Error code
+ **/
+
+error_t ecdhExportPublicKey(EcdhContext *context, uint8_t *output, size_t *written)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   size_t k;
+
+   //X25519 function?
+   if(context->params.type == EC_CURVE_TYPE_MONTGOMERY)
+   {
+      //Get the length of the u-coordinate
+      k = mpiGetByteLength(&context->params.p);
+
+      //Convert the u-coordinate to an octet string
+      error = mpiWriteRaw(&context->qa.x, output, k);
+      //Any error to report?
+      if(error) return error;
+
+      //The u-coordinate is little-endian encoded
+      for(i = 0; i < (k / 2); i++)
+         n = output[i], output[i] = output[k - 1 - i], output[k - 1 - i] = n;
+
+      //Total length of the public value
+      *written = k;
+   }
+   else
+   {
+      //Use the uncompressed point representation
+      error = ecExport(&context->params, &context->qa, output, written);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse the peer's public value
+ * @param[in] context Pointer to the ECDH context
+ * @param[in] input Pointer to the encoded public value
+ * @param[in] length Length of the encoded public value, in bytes
+ * @return Error code
+ **/
+
+error_t ecdhImportPeerPublicKey(EcdhContext *context, const uint8_t *input, size_t length)
+{
+   error_t error;
+   uint_t i;
+   size_t k;
+   uint8_t u[32];
+
+   //X25519 function?
+   if(context->params.type == EC_CURVE_TYPE_MONTGOMERY)
+   {
+      //Get the length of the u-coordinate
+      k = mpiGetByteLength(&context->params.p);
+
+      //Check the length of the public value
+      if(length != k || k > sizeof(u))
+         return ERROR_DECODING_FAILED;
+
+      //The u-coordinate is little-endian encoded
+      for(i = 0; i < k; i++)
+         u[i] = input[k - 1 - i];
+
+      //The most significant bit of the final byte must be masked
+      u[0] &= 0x7F;
+
+      //Convert the u-coordinate to a multiple precision integer
+      error = mpiReadRaw(&context->qb.x, u, k);
+      //Any error to report?
+      if(error) return error;
+   }
+   else
+   {
+      //Decode the uncompressed point representation
+      error = ecImport(&context->params, &context->qb, input, length);
+      //Any error to report?
+      if(error) return error;
+
+      //Make sure the point lies on the curve
+      error = ecdhCheckPublicKey(&context->params, &context->qb);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Check ECDH public value
+ * @param[in] params EC domain parameters
+ * @param[in] publicKey Public value to be checked (affine coordinates)
+ * @return Error code
+ **/
+
+error_t ecdhCheckPublicKey(const EcDomainParameters *params, const EcPoint *publicKey)
+{
+   //Verify that the point lies on the elliptic curve. The check is
+   //sufficient since all the supported curves have a cofactor of 1
+   if(!ecIsPointAffine(params, publicKey))
+      return ERROR_ILLEGAL_PARAMETER;
+
+   //The public value is acceptable
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Compute ECDH shared secret
+ * @param[in] context Pointer to the ECDH context
+ * @param[out] output Buffer where to store the shared secret
+ * @param[in] outputSize Size of the buffer in bytes
+ * @param[out] outputLength Length of the resulting shared secret
+ * @return Error code
+ **/
+
+error_t ecdhComputeSharedSecret(EcdhContext *context,
+   uint8_t *output, size_t outputSize, size_t *outputLength)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   size_t k;
+   EcPoint z;
+
+   //Debug message
+   TRACE_DEBUG("Computing ECDH shared secret...\r\n");
+
+   //Get the length in octets of the prime modulus
+   k = mpiGetByteLength(&context->params.p);
+
+   //Make sure that the output buffer is large enough
+   if(outputSize < k)
+      return ERROR_INVALID_LENGTH;
+
+   //Initialize EC point
+   ecInit(&z);
+
+   //X25519 function?
+   if(context->params.type == EC_CURVE_TYPE_MONTGOMERY)
+   {
+      //Compute the shared secret X25519(da, Qb)
+      MPI_CHECK(ecMontgomeryMult(&context->params, &z.x, &context->da, &context->qb.x));
+
+      //Abort if the result is the all-zero value (RFC 7748, section 6.1)
+      if(!mpiCompInt(&z.x, 0))
+      {
+         error = ERROR_ILLEGAL_PARAMETER;
+         goto end;
+      }
+
+      //Convert the u-coordinate to an octet string
+      MPI_CHECK(mpiWriteRaw(&z.x, output, k));
+
+      //The shared secret is little-endian encoded
+      for(i = 0; i < (k / 2); i++)
+         n = output[i], output[i] = output[k - 1 - i], output[k - 1 - i] = n;
+   }
+   else
+   {
+      //Compute Z = da.Qb
+      MPI_CHECK(ecProjectify(&context->params, &context->qb, &context->qb));
+      MPI_CHECK(ecMult(&context->params, &z, &context->da, &context->qb));
+      MPI_CHECK(ecAffinify(&context->params, &z, &z));
+
+      //The shared secret is the x-coordinate of Z
+      MPI_CHECK(mpiWriteRaw(&z.x, output, k));
+   }
+
+   //Length of the resulting shared secret
+   *outputLength = k;
+
+   //Debug message
+   TRACE_DEBUG("  Shared secret (%u bytes):\r\n", *outputLength);
+   TRACE_DEBUG_ARRAY("    ", output, *outputLength);
+
+end:
+   //Release EC point
+   ecFree(&z);
+
+   //Return status code
+   return error;
+}
@@ -0,0 +1,71 @@
+/**
+ * @file ecdh.h
+ * @brief ECDH (Elliptic Curve Diffie-Hellman) key exchange
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Elliptic Curve Diffie-Hellman (ECDH) is an anonymous key agreement protocol
+ * that allows two parties, each having an elliptic curve public-private key
+ * pair, to establish a shared secret over an insecure channel. Refer to
+ * SEC 1 and RFC 7748 for more details
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _ECDH_H
+#define _ECDH_H
+
+//Dependencies
+#include "crypto.h"
+#include "ec.h"
+
+
+/**
+ * @brief ECDH context
+ **/
+
+typedef struct
+{
+   EcDomainParameters params; ///<EC domain parameters
+   Mpi da;                    ///<One's own private value
+   EcPoint qa;                ///<One's own public value
+   EcPoint qb;                ///<Peer's public value
+} EcdhContext;
+
+
+//ECDH related functions
+void ecdhInit(EcdhContext *context);
+void ecdhFree(EcdhContext *context);
+
+error_t ecdhGenerateKeyPair(EcdhContext *context, const PrngAlgo *prngAlgo, void *prngContext);
+
+error_t ecdhExportPublicKey(EcdhContext *context, uint8_t *output, size_t *written);
+error_t ecdhImportPeerPublicKey(EcdhContext *context, const uint8_t *input, size_t length);
+
+error_t ecdhCheckPublicKey(const EcDomainParameters *params, const EcPoint *publicKey);
+
+error_t ecdhComputeSharedSecret(EcdhContext *context,
+   uint8_t *output, size_t outputSize, size_t *outputLength);
+
+#endif
@@ -0,0 +1,209 @@
+/**
+ * @file hkdf.c
+ * @brief HKDF (HMAC-based Key Derivation Function)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * HKDF follows the extract-then-expand paradigm. The extract step
+ * concentrates the entropy of the input keying material into a short
+ * pseudorandom key, which the expand step stretches into as many bytes
+ * of output keying material as needed. Refer to RFC 5869 for more details
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL CRYPTO_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "crypto.h"
+#include "hkdf.h"
+#include "hmac.h"
+
+
+/**
+ * @brief HKDF key derivation function
+ * @param[in] hash Underlying hash function
+ * @param[in] ikm Input keying material
+ * @param[in] ikmLen Length in octets of the input keying material
+ * @param[in] salt Optional salt value (a non-secret random value)
+ * @param[in] saltLen Length in octets of the salt
+ * @param[in] info Optional application specific information
+ * @param[in] infoLen Length in octets of the application specific information
+ * @param[out] okm Output keying material
+ * @param[in] okmLen Length in octets of the output keying material
+ * @return Error code
+ **/
+
+error_t hkdf(const HashAlgo *hash, const uint8_t *ikm, size_t ikmLen,
+   const uint8_t *salt, size_t saltLen, const uint8_t *info, size_t infoLen,
+   uint8_t *okm, size_t okmLen)
+{
+   error_t error;
+   uint8_t prk[MAX_HASH_DIGEST_SIZE];
+
+   //Perform HKDF extract step
+   error = hkdfExtract(hash, ikm, ikmLen, salt, saltLen, prk);
+
+   //Check status code
+   if(!error)
+   {
+      //Perform HKDF expand step
+      error = hkdfExpand(hash, prk, hash->digestSize, info, infoLen, okm, okmLen);
+   }
+
+   //Clear the pseudorandom key
+   memset(prk, 0, sizeof(prk));
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief HKDF extract step
+ * @param[in] hash Underlying hash function
+ * @param[in] ikm Input keying material
+ * @param[in] ikmLen Length in octets of the input keying material
+ * @param[in] salt Optional salt value (a non-secret random value)
+ * @param[in] saltLen Length in octets of the salt
+ * @param[out] prk Pseudorandom key (hash->digestSize octets)
+ * @return Error code
+ **/
+
+error_t hkdfExtract(const HashAlgo *hash, const uint8_t *ikm, size_t ikmLen,
+   const uint8_t *salt, size_t saltLen, uint8_t *prk)
+{
+   uint8_t zero[MAX_HASH_DIGEST_SIZE];
+
+   //Check parameters
+   if(hash == NULL || prk == NULL)
+      return ERROR_INVALID_PARAMETER;
+   if(ikm == NULL && ikmLen != 0)
+      return ERROR_INVALID_PARAMETER;
+   if(salt == NULL && saltLen != 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //If the salt is not provided, it is set to a string of HashLen zeros
+   if(saltLen == 0)
+   {
+      memset(zero, 0, hash->digestSize);
+      salt = zero;
+      saltLen = hash->digestSize;
+   }
+
+   //Compute PRK = HMAC-Hash(salt, IKM)
+   return hmacCompute(hash, salt, saltLen, ikm, ikmLen, prk);
+}
+
+
+/**
+ * @brief HKDF expand step
+ * @param[in] hash Underlying hash function
+ * @param[in] prk Pseudorandom key
+ * @param[in] prkLen Length in octets of the pseudorandom key
+ * @param[in] info Optional application specific information
+ * @param[in] infoLen Length in octets of the application specific information
+ * @param[out] okm Output keying material
+ * @param[in] okmLen Length in octets of the output keying material
+ * @return Error code
+ **/
+
+error_t hkdfExpand(const HashAlgo *hash, const uint8_t *prk, size_t prkLen,
+   const uint8_t *info, size_t infoLen, uint8_t *okm, size_t okmLen)
+{
+   uint8_t i;
+   size_t n;
+   HmacKey *key;
+   HmacContext *context;
+   uint8_t t[MAX_HASH_DIGEST_SIZE];
+
+   //Check parameters
+   if(hash == NULL || prk == NULL || okm == NULL)
+      return ERROR_INVALID_PARAMETER;
+   if(info == NULL && infoLen != 0)
+      return ERROR_INVALID_PARAMETER;
+
+   //The PRK must be at least HashLen octets
+   if(prkLen < hash->digestSize)
+      return ERROR_INVALID_LENGTH;
+   //The output cannot exceed 255 blocks
+   if(okmLen > (255 * hash->digestSize))
+      return ERROR_INVALID_LENGTH;
+
+   //Allocate a memory buffer to hold the HMAC context
+   context = osMemAlloc(sizeof(HmacContext));
+   //Allocate a memory buffer to hold the precomputed key
+   key = osMemAlloc(sizeof(HmacKey));
+
+   //Failed to allocate memory?
+   if(!context || !key)
+   {
+      //Free previously allocated memory
+      osMemFree(context);
+      osMemFree(key);
+      //Report an error
+      return ERROR_OUT_OF_MEMORY;
+   }
+
+   //The PRK is the HMAC key of every block
+   hmacInitKey(key, hash, prk, prkLen);
+
+   //T(0) is the empty string
+   n = 0;
+
+   //Generate the output keying material one block at a time
+   for(i = 1; okmLen > 0; i++)
+   {
+      //Compute T(i) = HMAC-Hash(PRK, T(i-1) | info | i)
+      hmacInitWithKey(context, key);
+      hmacUpdate(context, t, n);
+      hmacUpdate(context, info, infoLen);
+      hmacUpdate(context, &i, sizeof(uint8_t));
+      hmacFinal(context, t);
+
+      //Length of the current block
+      n = min(okmLen, hash->digestSize);
+      //The output is the concatenation of the blocks
+      memcpy(okm, t, n);
+
+      //Advance data pointer
+      okm += n;
+      //Remaining bytes to generate
+      okmLen -= n;
+      //T(i) is hashed in full in the next block
+      n = hash->digestSize;
+   }
+
+   //Clear sensitive data before freeing memory
+   memset(t, 0, sizeof(t));
+   memset(context, 0, sizeof(HmacContext));
+   memset(key, 0, sizeof(HmacKey));
+   osMemFree(context);
+   osMemFree(key);
+
+   //Successful processing
+   return NO_ERROR;
+}
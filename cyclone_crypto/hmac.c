@@ -110,6 +110,8 @@ void hmacInit(HmacContext *context, const HashAlgo *hash,
 
    //Hash algorithm used to compute HMAC
    context->hash = hash;
+   //The outer pad is computed from the key
+   context->hmacKey = NULL;
 
    //The key is longer than the block size?
    if(keyLength > hash->blockSize)
@@ -142,6 +144,80 @@ void hmacInit(HmacContext *context, const HashAlgo *hash,
 }
 
 
+/**
+ * @brief Precompute the inner and outer hash states for a given key
+ * @param[out] hmacKey Pointer to the precomputed key
+ * @param[in] hash Hash algorithm used to compute HMAC
+ * @param[in] key Key to use in the hash algorithm
+ * @param[in] keyLength Length of the key
+ **/
+
+void hmacInitKey(HmacKey *hmacKey, const HashAlgo *hash,
+   const void *key, size_t keyLength)
+{
+   uint_t i;
+   uint8_t block[MAX_HASH_BLOCK_SIZE];
+
+   //Hash algorithm used to compute HMAC
+   hmacKey->hash = hash;
+
+   //The key is longer than the block size?
+   if(keyLength > hash->blockSize)
+   {
+      //Digest the original key
+      hash->init(hmacKey->innerContext);
+      hash->update(hmacKey->innerContext, key, keyLength);
+      hash->final(hmacKey->innerContext, block);
+      //Key is padded to the right with extra zeros
+      memset(block + hash->digestSize, 0, hash->blockSize - hash->digestSize);
+   }
+   else
+   {
+      //Copy the key
+      memcpy(block, key, keyLength);
+      //Key is padded to the right with extra zeros
+      memset(block + keyLength, 0, hash->blockSize - keyLength);
+   }
+
+   //XOR the resulting key with ipad
+   for(i = 0; i < hash->blockSize; i++)
+      block[i] ^= HMAC_IPAD;
+
+   //Digest the inner pad
+   hash->init(hmacKey->innerContext);
+   hash->update(hmacKey->innerContext, block, hash->blockSize);
+
+   //XOR the original key with opad
+   for(i = 0; i < hash->blockSize; i++)
+      block[i] ^= HMAC_IPAD ^ HMAC_OPAD;
+
+   //Digest the outer pad
+   hash->init(hmacKey->outerContext);
+   hash->update(hmacKey->outerContext, block, hash->blockSize);
+
+   //Erase the padded key
+   memset(block, 0, sizeof(block));
+}
+
+
+/**
+ * @brief Initialize HMAC calculation from a precomputed key
+ * @param[in] context Pointer to the HMAC context to initialize
+ * @param[in] hmacKey Precomputed key (must remain valid until hmacFinal is called)
+ **/
+
+void hmacInitWithKey(HmacContext *context, const HmacKey *hmacKey)
+{
+   //Hash algorithm used to compute HMAC
+   context->hash = hmacKey->hash;
+   //The outer pad is taken from the precomputed key
+   context->hmacKey = hmacKey;
+
+   //Restore the hash state obtained after digesting the inner pad
+   memcpy(context->hashContext, hmacKey->innerContext, context->hash->contextSize);
+}
+
+
 /**
  * @brief Update the HMAC context with a portion of the message being hashed
  * @param[in] context Pointer to the HMAC context
@@ -173,14 +249,23 @@ void hmacFinal(HmacContext *context, uint8_t *digest)
    //Finish the first pass
    hash->final(context->hashContext, context->digest);
 
-   //XOR the original key with opad
-   for(i = 0; i < hash->blockSize; i++)
-      context->key[i] ^= HMAC_IPAD ^ HMAC_OPAD;
+   //Precomputed key?
+   if(context->hmacKey != NULL)
+   {
+      //Restore the hash state obtained after digesting the outer pad
+      memcpy(context->hashContext, context->hmacKey->outerContext, hash->contextSize);
+   }
+   else
+   {
+      //XOR the original key with opad
+      for(i = 0; i < hash->blockSize; i++)
+         context->key[i] ^= HMAC_IPAD ^ HMAC_OPAD;
 
-   //Initialize context for the second pass
-   hash->init(context->hashContext);
-   //Start with outer pad
-   hash->update(context->hashContext, context->key, hash->blockSize);
+      //Initialize context for the second pass
+      hash->init(context->hashContext);
+      //Start with outer pad
+      hash->update(context->hashContext, context->key, hash->blockSize);
+   }
    //Then digest the result of the first hash
    hash->update(context->hashContext, context->digest, hash->digestSize);
    //Finish the second pass
@@ -52,6 +52,21 @@
 #define HMAC_OPAD 0x5C
 
 
+/**
+ * @brief Precomputed HMAC key
+ *
+ * Hash states obtained after digesting the inner and the outer pads.
+ * They are computed once per key and copied for every message
+ **/
+
+typedef struct
+{
+   const HashAlgo *hash;
+   uint8_t innerContext[MAX_HASH_CONTEXT_SIZE];
+   uint8_t outerContext[MAX_HASH_CONTEXT_SIZE];
+} HmacKey;
+
+
 /**
  * @brief HMAC algorithm context
  **/
@@ -59,6 +74,7 @@
 typedef struct
 {
    const HashAlgo *hash;
+   const HmacKey *hmacKey;
    uint8_t hashContext[MAX_HASH_CONTEXT_SIZE];
    uint8_t key[MAX_HASH_BLOCK_SIZE];
    uint8_t digest[MAX_HASH_DIGEST_SIZE];
@@ -82,6 +98,11 @@ error_t hmacCompute(const HashAlgo *hash, const void *key, size_t keyLength,
 void hmacInit(HmacContext *context, const HashAlgo *hash,
    const void *key, size_t length);
 
+void hmacInitKey(HmacKey *hmacKey, const HashAlgo *hash,
+   const void *key, size_t keyLength);
+
+void hmacInitWithKey(HmacContext *context, const HmacKey *hmacKey);
+
 void hmacUpdate(HmacContext *context, const void *data, size_t length);
 void hmacFinal(HmacContext *context, uint8_t *digest);
 
@@ -49,7 +49,9 @@ const CipherAlgo ideaCipherAlgo =
    NULL,
    NULL,
    (CipherAlgoEncryptBlock) ideaEncryptBlock,
-   (CipherAlgoDecryptBlock) ideaDecryptBlock
+   (CipherAlgoDecryptBlock) ideaDecryptBlock,
+   NULL,
+   NULL
 };
 
 
@@ -37,6 +37,108 @@
 #include "debug.h"
 
 
+#if (MPI_POOL_SUPPORT == ENABLED)
+
+//Fixed-capacity limb buffers
+static uint_t mpiPool[MPI_POOL_BLOCK_COUNT][MPI_POOL_BLOCK_SIZE];
+//Allocation status of the buffers
+static bool_t mpiPoolUsed[MPI_POOL_BLOCK_COUNT];
+
+#endif
+
+
+/**
+ * @brief Allocate memory for the limbs of a big number
+ *
+ * When the pool is enabled, buffers that fit in a pool block are taken
+ * from the pool and the heap is only used as a fallback
+ *
+ * @param[in] size Number of words to allocate
+ * @return Pointer to the allocated memory, or NULL on failure
+ **/
+
+uint_t *mpiAllocData(uint_t size)
+{
+#if (MPI_POOL_SUPPORT == ENABLED)
+   uint_t i;
+
+   //Small enough to fit in a pool buffer?
+   if(size <= MPI_POOL_BLOCK_SIZE)
+   {
+      //Enter critical section
+      osTaskSuspendAll();
+
+      //Search for a free buffer
+      for(i = 0; i < MPI_POOL_BLOCK_COUNT; i++)
+      {
+         if(!mpiPoolUsed[i])
+         {
+            mpiPoolUsed[i] = TRUE;
+            break;
+         }
+      }
+
+      //Leave critical section
+      osTaskResumeAll();
+
+      //Free buffer found?
+      if(i < MPI_POOL_BLOCK_COUNT)
+         return mpiPool[i];
+
+      //Debug message
+      TRACE_WARNING("MPI pool exhausted!\r\n");
+   }
+#endif
+
+   //Allocate memory from the heap
+   return osMemAlloc(size * MPI_INT_SIZE);
+}
+
+
+/**
+ * @brief Release memory allocated with mpiAllocData
+ * @param[in] data Pointer to the memory to release
+ **/
+
+void mpiFreeData(uint_t *data)
+{
+#if (MPI_POOL_SUPPORT == ENABLED)
+   //Pool buffer?
+   if(mpiIsPoolData(data))
+   {
+      //Enter critical section
+      osTaskSuspendAll();
+      //Return the buffer to the pool
+      mpiPoolUsed[(data - mpiPool[0]) / MPI_POOL_BLOCK_SIZE] = FALSE;
+      //Leave critical section
+      osTaskResumeAll();
+   }
+   else
+#endif
+   {
+      //Release memory to the heap
+      osMemFree(data);
+   }
+}
+
+
+#if (MPI_POOL_SUPPORT == ENABLED)
+
+/**
+ * @brief Check whether a buffer belongs to the pool
+ * @param[in] data Pointer to the limbs of a big number
+ * @return TRUE if the buffer was taken from the pool, else FALSE
+ **/
+
+bool_t mpiIsPoolData(const uint_t *data)
+{
+   //Compare against the bounds of the pool
+   return (data >= mpiPool[0] && data < mpiPool[0] + MPI_POOL_BLOCK_COUNT * MPI_POOL_BLOCK_SIZE);
+}
+
+#endif
+
+
 /**
  * @brief Initialize a big number
  * @param[in,out] x Pointer to the multiple precision integer to initialize
@@ -63,7 +165,7 @@ void mpiFree(Mpi *x)
    {
       //Erase contents before releasing memory
       memset(x->data, 0, x->size * MPI_INT_SIZE);
-      osMemFree(x->data);
+      mpiFreeData(x->data);
    }
    //Set size to zero
    x->size = 0;
@@ -86,8 +188,21 @@ error_t mpiGrow(Mpi *x, uint_t size)
    if(x->size >= size)
       return NO_ERROR;
 
+#if (MPI_POOL_SUPPORT == ENABLED)
+   //Pool buffers have a fixed capacity and can grow in place
+   if(x->data != NULL && mpiIsPoolData(x->data) && size <= MPI_POOL_BLOCK_SIZE)
+   {
+      //Clear the additional words
+      memset(x->data + x->size, 0, (size - x->size) * MPI_INT_SIZE);
+      //Update the size of the multiple precision integer
+      x->size = size;
+      //Successful operation
+      return NO_ERROR;
+   }
+#endif
+
    //Allocate a memory buffer
-   data = osMemAlloc(size * MPI_INT_SIZE);
+   data = mpiAllocData(size);
    //Failed to allocate memory?
    if(!data) return ERROR_OUT_OF_MEMORY;
    //Clear buffer contents
@@ -99,7 +214,7 @@ error_t mpiGrow(Mpi *x, uint_t size)
       //Copy original data
       memcpy(data, x->data, x->size * MPI_INT_SIZE);
       //Free previously allocated memory
-      osMemFree(x->data);
+      mpiFreeData(x->data);
    }
 
    //Update the size of the multiple precision integer
@@ -704,11 +819,32 @@ error_t mpiAddAbs(Mpi *x, const Mpi *a, const Mpi *b)
    uint_t n;
    uint_t c;
 
+   //Both operands refer to the destination operand?
+   if(x == a && x == b)
+   {
+      Mpi d;
+
+      //Initialize D
+      mpiInit(&d);
+
+      //Copy B operand to D
+      error = mpiCopy(&d, b);
+
+      //Use D instead of B
+      if(!error)
+         error = mpiAddAbs(x, a, &d);
+
+      //Release previously allocated memory
+      mpiFree(&d);
+      //Return status code
+      return error;
+   }
+
    //The destination operand is B?
    if(x == b)
    {
       //Swap A and B
-      const Mpi *t = b;
+      const Mpi *t = a;
       a = b;
       b = t;
    }
@@ -794,7 +930,7 @@ error_t mpiSubAbs(Mpi *x, const Mpi *a, const Mpi *b)
    if(mpiCompAbs(a, b) < 0)
    {
       //Swap A and B if necessary
-      const Mpi *t = b;
+      const Mpi *t = a;
       a = b;
       b = t;
    }
@@ -960,46 +1096,61 @@ error_t mpiShiftRight(Mpi *x, uint_t n)
 }
 
 
-#define ADDC(x, a, c) \
-   x += c; \
-   if((x) != 0) c = 0; \
-   x += a; \
-   if((x) < (a)) c = 1
+//Accumulate a 64-bit product into a three-word column sum
+#define MPI_MUL_ACC(c0, c1, c2, p) \
+   { \
+      uint64_t t = (uint64_t) (c0) + (uint32_t) (p); \
+      c0 = (uint32_t) t; \
+      t = (uint64_t) (c1) + (uint32_t) ((p) >> 32) + (t >> 32); \
+      c1 = (uint32_t) t; \
+      c2 += (uint32_t) (t >> 32); \
+   }
+
+
+/**
+ * @brief Multiple precision multiplication
+ *
+ * Squarings are detected and processed by a dedicated routine. Large
+ * operands of similar length are multiplied using the Karatsuba method
+ *
+ * @param[out] x Resulting integer X = A * B
+ * @param[in] a First operand A
+ * @param[in] b Second operand B
+ * @return Error code
+ **/
 
 error_t mpiMul(Mpi *x, const Mpi *a, const Mpi *b)
 {
    error_t error;
-   int_t i;
-   int_t k;
-   int_t m;
-   int_t n;
-   uint64_t p;
+   uint_t m;
+   uint_t n;
+   uint_t s;
+   uint_t *t;
    Mpi ta;
    Mpi tb;
 
+   //Initialize multiple precision integers
    mpiInit(&ta);
    mpiInit(&tb);
+   //No scratch buffer allocated yet
+   t = NULL;
 
    if(x == a)
    {
       //Copy A to TA
-      error = mpiCopy(&ta, a);
-      //Any error to report?
-      if(error) return error;
+      MPI_CHECK(mpiCopy(&ta, a));
+
+      //Squaring operation?
+      if(b == a)
+         b = &ta;
+
       //Use TA instead of A
       a = &ta;
    }
    if(x == b)
    {
       //Copy B to TB
-      error = mpiCopy(&tb, b);
-      //Any error to report?
-      if(error)
-      {
-         //Free previously allocated memory
-         mpiFree(&ta);
-         return error;
-      }
+      MPI_CHECK(mpiCopy(&tb, b));
       //Use TB instead of B
       b = &tb;
    }
@@ -1008,39 +1159,336 @@ error_t mpiMul(Mpi *x, const Mpi *a, const Mpi *b)
    m = mpiGetLength(a);
    n = mpiGetLength(b);
 
-   //Adjust the size of the destination operand
-   error = mpiGrow(x, m + n);
-   //Any error to report?
-   if(error)
+   //Large operands of similar length?
+   if(min(m, n) >= MPI_KARATSUBA_THRESHOLD && 2 * min(m, n) >= max(m, n))
    {
-      //Free previously allocated memory
-      mpiFree(&ta);
-      mpiFree(&tb);
-      return error;
+      //Both operands are padded to the same length. The buffer also
+      //holds the scratch memory needed by the Karatsuba method
+      s = 2 * max(m, n) + mpiKaratsubaScratchSize(max(m, n));
+
+#if (MPI_POOL_SUPPORT == ENABLED)
+      //Karatsuba multiplication is used only when the buffer fits in the pool
+      if(s <= MPI_POOL_BLOCK_SIZE)
+#endif
+         t = mpiAllocData(s);
    }
 
-   //Set the sign of the result X
-   x->sign = (a->sign == b->sign) ? 1 : -1;
-   //Clear the contents of X
-   memset(x->data, 0, x->size * MPI_INT_SIZE);
+   //Use Karatsuba multiplication?
+   if(t != NULL)
+   {
+      //Length of the padded operands
+      n = max(m, n);
 
-   for(k = 0; k <= (m + n - 2); k++)
+      //Adjust the size of the destination operand
+      MPI_CHECK(mpiGrow(x, 2 * n));
+
+      //Copy the operands
+      memset(t, 0, 2 * n * MPI_INT_SIZE);
+      memcpy(t, a->data, mpiGetLength(a) * MPI_INT_SIZE);
+      memcpy(t + n, b->data, mpiGetLength(b) * MPI_INT_SIZE);
+
+      //Clear the contents of X
+      memset(x->data, 0, x->size * MPI_INT_SIZE);
+
+      //Perform Karatsuba multiplication
+      if(a == b)
+         mpiKaratsubaMul(x->data, t, t, n, t + 2 * n);
+      else
+         mpiKaratsubaMul(x->data, t, t + n, n, t + 2 * n);
+   }
+   else
    {
-      for(i = max(k - n + 1, 0); i <= min(k, m - 1); i++)
+      //Adjust the size of the destination operand
+      MPI_CHECK(mpiGrow(x, m + n));
+
+      //Clear the contents of X
+      memset(x->data, 0, x->size * MPI_INT_SIZE);
+
+      //Perform column-wise multiplication
+      if(m > 0 && n > 0)
       {
-         uint_t c = 0;
-         p = (uint64_t) a->data[i] * b->data[k - i];
-         ADDC(x->data[k], (uint32_t ) p, c);
-         ADDC(x->data[k + 1], (uint32_t) (p >> 32), c);
-         ADDC(x->data[k + 2], 0, c);
+         if(a == b)
+            mpiSqrCore(x->data, a->data, m);
+         else
+            mpiMulCore(x->data, a->data, m, b->data, n);
       }
    }
 
-   //Release previously allocated memory
+   //Set the sign of the result X
+   x->sign = (a->sign == b->sign) ? 1 : -1;
+
+end:
+   //Release scratch memory
+   if(t != NULL)
+      mpiFreeData(t);
+
+   //Release multiple precision integers
    mpiFree(&ta);
    mpiFree(&tb);
-   //Successful operation
-   return NO_ERROR;
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Column-wise (Comba) multiplication of word arrays
+ * @param[out] r Resulting array R = A * B (m + n words)
+ * @param[in] a First operand A
+ * @param[in] m Length of A, in words
+ * @param[in] b Second operand B
+ * @param[in] n Length of B, in words
+ **/
+
+void mpiMulCore(uint_t *r, const uint_t *a, uint_t m, const uint_t *b, uint_t n)
+{
+   uint_t i;
+   uint_t j;
+   uint_t k;
+   uint_t c0;
+   uint_t c1;
+   uint_t c2;
+   uint64_t p;
+
+   //Clear column sum
+   c0 = 0;
+   c1 = 0;
+   c2 = 0;
+
+   //Compute the result one column at a time
+   for(k = 0; k < (m + n - 1); k++)
+   {
+      //Index of the first word of A that contributes to the current column
+      i = (k >= n) ? (k - n + 1) : 0;
+      //Index of the last word of A that contributes to the current column
+      j = (k < m) ? k : (m - 1);
+
+      //Sum the products A[i] * B[k - i]
+      for(; i <= j; i++)
+      {
+         p = (uint64_t) a[i] * b[k - i];
+         MPI_MUL_ACC(c0, c1, c2, p);
+      }
+
+      //Save the current word of the result
+      r[k] = c0;
+
+      //Shift the column sum
+      c0 = c1;
+      c1 = c2;
+      c2 = 0;
+   }
+
+   //Save the most significant word
+   r[k] = c0;
+}
+
+
+/**
+ * @brief Column-wise (Comba) squaring of a word array
+ *
+ * Each cross product A[i] * A[j] appears twice in the square, so it is
+ * computed once and doubled, which saves almost half of the multiplications
+ *
+ * @param[out] r Resulting array R = A^2 (2 * n words)
+ * @param[in] a Operand A
+ * @param[in] n Length of A, in words
+ **/
+
+void mpiSqrCore(uint_t *r, const uint_t *a, uint_t n)
+{
+   uint_t i;
+   uint_t j;
+   uint_t k;
+   uint_t c0;
+   uint_t c1;
+   uint_t c2;
+   uint_t d0;
+   uint_t d1;
+   uint_t d2;
+   uint64_t p;
+
+   //Clear column sum
+   c0 = 0;
+   c1 = 0;
+   c2 = 0;
+
+   //Compute the result one column at a time
+   for(k = 0; k < (2 * n - 1); k++)
+   {
+      //Clear the sum of the cross products
+      d0 = 0;
+      d1 = 0;
+      d2 = 0;
+
+      //Index of the first word of A that contributes to the current column
+      i = (k >= n) ? (k - n + 1) : 0;
+
+      //Sum the cross products A[i] * A[j] with i < j
+      for(j = k - i; i < j; i++, j--)
+      {
+         p = (uint64_t) a[i] * a[j];
+         MPI_MUL_ACC(d0, d1, d2, p);
+      }
+
+      //Double the sum of the cross products
+      d2 = (d2 << 1) | (d1 >> 31);
+      d1 = (d1 << 1) | (d0 >> 31);
+      d0 <<= 1;
+
+      //Even columns also contain the square of a single word
+      if(!(k & 1))
+      {
+         p = (uint64_t) a[k / 2] * a[k / 2];
+         MPI_MUL_ACC(d0, d1, d2, p);
+      }
+
+      //Add the contribution of the current column
+      p = (uint64_t) c0 + d0;
+      c0 = (uint32_t) p;
+      p = (uint64_t) c1 + d1 + (p >> 32);
+      c1 = (uint32_t) p;
+      c2 += d2 + (uint32_t) (p >> 32);
+
+      //Save the current word of the result
+      r[k] = c0;
+
+      //Shift the column sum
+      c0 = c1;
+      c1 = c2;
+      c2 = 0;
+   }
+
+   //Save the most significant word
+   r[k] = c0;
+}
+
+
+/**
+ * @brief Karatsuba multiplication of word arrays
+ *
+ * A and B are split into a low half and a high half, and the product is
+ * computed with three half-size multiplications instead of four. Operands
+ * below MPI_KARATSUBA_THRESHOLD words are multiplied using the Comba method
+ *
+ * @param[out] r Resulting array R = A * B (2 * n words)
+ * @param[in] a First operand A
+ * @param[in] b Second operand B (A and B point to the same array for a squaring)
+ * @param[in] n Length of A and B, in words
+ * @param[in] t Scratch memory (see mpiKaratsubaScratchSize)
+ **/
+
+void mpiKaratsubaMul(uint_t *r, const uint_t *a, const uint_t *b, uint_t n, uint_t *t)
+{
+   uint_t i;
+   uint_t h;
+   uint_t l;
+   uint_t *sa;
+   uint_t *sb;
+   uint_t *z1;
+   uint64_t c;
+
+   //Small operands?
+   if(n < MPI_KARATSUBA_THRESHOLD)
+   {
+      //Use the Comba method
+      if(a == b)
+         mpiSqrCore(r, a, n);
+      else
+         mpiMulCore(r, a, n, b, n);
+
+      //We are done
+      return;
+   }
+
+   //Length of the low and high halves
+   h = n / 2;
+   l = n - h;
+
+   //Partition the scratch memory
+   sa = t;
+   sb = (a == b) ? sa : (t + l + 1);
+   z1 = t + 2 * (l + 1);
+   t = z1 + 2 * (l + 1);
+
+   //Compute SA = A0 + A1
+   for(c = 0, i = 0; i < l; i++)
+   {
+      c += (uint64_t) a[h + i] + ((i < h) ? a[i] : 0);
+      sa[i] = (uint32_t) c;
+      c >>= 32;
+   }
+
+   sa[l] = (uint32_t) c;
+
+   //Compute SB = B0 + B1
+   if(sb != sa)
+   {
+      for(c = 0, i = 0; i < l; i++)
+      {
+         c += (uint64_t) b[h + i] + ((i < h) ? b[i] : 0);
+         sb[i] = (uint32_t) c;
+         c >>= 32;
+      }
+
+      sb[l] = (uint32_t) c;
+   }
+
+   //Compute Z0 = A0 * B0 and Z2 = A1 * B1
+   mpiKaratsubaMul(r, a, b, h, t);
+   mpiKaratsubaMul(r + 2 * h, a + h, b + h, l, t);
+
+   //Compute Z1 = SA * SB
+   mpiKaratsubaMul(z1, sa, sb, l + 1, t);
+
+   //Compute Z1 = Z1 - Z0
+   for(c = 0, i = 0; i < (2 * l + 2); i++)
+   {
+      c = (uint64_t) z1[i] - ((i < 2 * h) ? r[i] : 0) - c;
+      z1[i] = (uint32_t) c;
+      c = (c >> 32) & 1;
+   }
+
+   //Compute Z1 = Z1 - Z2
+   for(c = 0, i = 0; i < (2 * l + 2); i++)
+   {
+      c = (uint64_t) z1[i] - ((i < 2 * l) ? r[2 * h + i] : 0) - c;
+      z1[i] = (uint32_t) c;
+      c = (c >> 32) & 1;
+   }
+
+   //Compute R = R + Z1 * 2^(32 * h). Note that Z1 fits in n + 1 words
+   for(c = 0, i = 0; i < (2 * n - h); i++)
+   {
+      c += (uint64_t) r[h + i] + ((i < (2 * l + 2)) ? z1[i] : 0);
+      r[h + i] = (uint32_t) c;
+      c >>= 32;
+   }
+}
+
+
+/**
+ * @brief Size of the scratch memory needed by the Karatsuba method
+ * @param[in] n Length of the operands, in words
+ * @return Size of the scratch memory, in words
+ **/
+
+uint_t mpiKaratsubaScratchSize(uint_t n)
+{
+   uint_t l;
+   uint_t s;
+
+   //Accumulate the memory needed by each level of recursion
+   for(s = 0; n >= MPI_KARATSUBA_THRESHOLD; n = l + 1)
+   {
+      //Length of the high half
+      l = n - n / 2;
+      //Room for SA, SB and Z1
+      s += 4 * (l + 1);
+   }
+
+   //Return the size of the scratch memory
+   return s;
 }
 
 error_t mpiMulInt(Mpi *x, const Mpi *a, int_t b)
@@ -1258,93 +1706,346 @@ end:
 }
 
 
+/**
+ * @brief Modular exponentiation (X = A ^ E mod P)
+ *
+ * The constants needed by Montgomery multiplication are computed on the
+ * fly. Use mpiExpModMont() when the same odd modulus is used repeatedly
+ *
+ * @param[out] x Resulting integer X
+ * @param[in] a Base A
+ * @param[in] e Exponent E
+ * @param[in] p Modulus P
+ * @return Error code
+ **/
+
 error_t mpiExpMod(Mpi *x, const Mpi *a, const Mpi *e, const Mpi *p)
+{
+   error_t error;
+   MpiMontgomeryContext context;
+
+   //Montgomery multiplication cannot be used with an even modulus
+   if(mpiIsEven(p))
+      return mpiExpModMont(x, a, e, p, NULL);
+
+   //Initialize Montgomery context
+   mpiMontgomeryInit(&context);
+
+   //Compute R^2 mod P and -1/P[0] mod 2^32
+   error = mpiMontgomerySetModulus(&context, p);
+
+   //Check status code
+   if(!error)
+   {
+      //Perform modular exponentiation
+      error = mpiExpModMont(x, a, e, p, &context);
+   }
+
+   //Release Montgomery context
+   mpiMontgomeryFree(&context);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Modular exponentiation using a precomputed Montgomery context
+ *
+ * When the context does not match the modulus (for instance because it
+ * has never been computed), the function falls back to mpiExpMod(). A NULL
+ * context selects ordinary modular multiplications, as needed by an even
+ * modulus
+ *
+ * @param[out] x Resulting integer X = A ^ E mod P
+ * @param[in] a Base A
+ * @param[in] e Exponent E
+ * @param[in] p Modulus P
+ * @param[in] context Montgomery context computed for P, or NULL
+ * @return Error code
+ **/
+
+error_t mpiExpModMont(Mpi *x, const Mpi *a, const Mpi *e,
+   const Mpi *p, const MpiMontgomeryContext *context)
 {
    error_t error;
    int_t i;
-   uint_t k;
+   int_t j;
+   int_t l;
+   uint_t d;
+   uint_t n;
+   uint_t u;
+   uint_t c;
    Mpi b;
    Mpi y;
-   Mpi r2;
+   Mpi t[1 << (MPI_MAX_EXP_WINDOW_SIZE - 1)];
+
+   //Make sure the Montgomery context was computed for this modulus
+   if(context != NULL && !mpiMontgomeryCheckModulus(context, p))
+      return mpiExpMod(x, a, e, p);
+
+   //Length of the exponent, in bits
+   n = mpiGetBitLength(e);
+
+   //Select the window size according to the length of the exponent
+   if(n > 671)
+      d = 6;
+   else if(n > 239)
+      d = 5;
+   else if(n > 79)
+      d = 4;
+   else if(n > 23)
+      d = 3;
+   else
+      d = 1;
+
+   //Limit the size of the table of precomputed powers
+   d = min(d, MPI_MAX_EXP_WINDOW_SIZE);
+   //Number of odd powers to precompute
+   c = 1 << (d - 1);
 
    //Initialize multiple precision integers
    mpiInit(&b);
    mpiInit(&y);
-   mpiInit(&r2);
 
-   if(mpiIsEven(p))
+   for(u = 0; u < c; u++)
+      mpiInit(&t[u]);
+
+   if(context == NULL)
    {
-      if(x == a)
+      //Compute T[0] = A mod P
+      if(mpiComp(a, p) >= 0)
       {
-         MPI_CHECK(mpiCopy(&b, a));
-         a = &b;
+         MPI_CHECK(mpiMod(&t[0], a, p));
       }
-
-      MPI_CHECK(mpiSetValue(x, 1));
-
-      for(i = mpiGetBitLength(e) - 1; i >= 0; i--)
+      else
       {
-         MPI_CHECK(mpiMulMod(x, x, x, p));
-
-         if(mpiGetBitValue(e, i))
-         {
-            MPI_CHECK(mpiMulMod(x, x, a, p));
-         }
+         MPI_CHECK(mpiCopy(&t[0], a));
       }
+
+      //Compute Y = 1
+      MPI_CHECK(mpiSetValue(&y, 1));
    }
    else
    {
-      //Compute the smaller R = (2^32)^k such as R > P
-      k = mpiGetLength(p);
-
-      //Compute R^2 mod P
-      MPI_CHECK(mpiSetValue(&r2, 1));
-      MPI_CHECK(mpiShiftLeft(&r2, 2 * k * (MPI_INT_SIZE * 8)));
-      MPI_CHECK(mpiMod(&r2, &r2, p));
-
-      //Compute B = A * R mod P
+      //Compute T[0] = A * R mod P
       if(mpiComp(a, p) >= 0)
       {
-         MPI_CHECK(mpiMod(&b, a, p));
-         MPI_CHECK(mpiMontgomeryMul(&b, &b, &r2, k, p));
+         MPI_CHECK(mpiMod(&t[0], a, p));
+         MPI_CHECK(mpiExpModMul(&t[0], &t[0], &context->r2, context, p));
       }
       else
       {
-         MPI_CHECK(mpiMontgomeryMul(&b, a, &r2, k, p));
+         MPI_CHECK(mpiExpModMul(&t[0], a, &context->r2, context, p));
       }
 
-      //Compute X = R mod P
-      MPI_CHECK(mpiCopy(&y, &r2));
-      MPI_CHECK(mpiMontgomeryRed(&y, k, p));
+      //Compute Y = R mod P
+      MPI_CHECK(mpiCopy(&y, &context->r2));
+      MPI_CHECK(mpiMontgomeryRedCore(&y, context->k, context->m, p));
+   }
+
+   //Precompute the odd powers T[u] = A^(2u + 1)
+   if(c > 1)
+   {
+      //Compute B = A^2
+      MPI_CHECK(mpiExpModMul(&b, &t[0], &t[0], context, p));
+
+      for(u = 1; u < c; u++)
+      {
+         //Compute T[u] = T[u - 1] * B
+         MPI_CHECK(mpiExpModMul(&t[u], &t[u - 1], &b, context, p));
+      }
+   }
 
-      for(i = mpiGetBitLength(e) - 1; i >= 0; i--)
+   //Scan the exponent from left to right
+   for(i = n - 1; i >= 0; )
+   {
+      if(!mpiGetBitValue(e, i))
+      {
+         //Compute Y = Y^2
+         MPI_CHECK(mpiExpModMul(&y, &y, &y, context, p));
+         //Next bit to process
+         i--;
+      }
+      else
       {
-         //Compute X = X^2 * R^-1 mod P
-         MPI_CHECK(mpiMontgomeryMul(&y, &y, &y, k, p));
+         //Find the longest window E[i..j] of at most d bits whose last bit is set
+         j = max(i - (int_t) d + 1, 0);
+
+         while(!mpiGetBitValue(e, j))
+            j++;
 
-         if(mpiGetBitValue(e, i))
+         //Compute U = E[i..j] and Y = Y^(2^(i - j + 1))
+         for(u = 0, l = i; l >= j; l--)
          {
-            //Compute X = X * B * R^-1 mod P
-            MPI_CHECK(mpiMontgomeryMul(&y, &y, &b, k, p));
+            MPI_CHECK(mpiExpModMul(&y, &y, &y, context, p));
+            u = (u << 1) | mpiGetBitValue(e, l);
          }
+
+         //Compute Y = Y * A^U
+         MPI_CHECK(mpiExpModMul(&y, &y, &t[u >> 1], context, p));
+         //Next bit to process
+         i = j - 1;
       }
+   }
 
-      //Compute X = X * R^-1 mod N
-      MPI_CHECK(mpiMontgomeryRed(&y, k, p));
-      MPI_CHECK(mpiCopy(x, &y));
+   //Compute X = Y * R^-1 mod P
+   if(context != NULL)
+   {
+      MPI_CHECK(mpiMontgomeryRedCore(&y, context->k, context->m, p));
    }
 
+   MPI_CHECK(mpiCopy(x, &y));
+
 end:
    //Release multiple precision integers
    mpiFree(&b);
    mpiFree(&y);
-   mpiFree(&r2);
 
+   for(u = 0; u < c; u++)
+      mpiFree(&t[u]);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Multiplication step of the modular exponentiation
+ *
+ * Montgomery multiplication is used when a Montgomery context is supplied,
+ * while even moduli fall back to an ordinary modular multiplication
+ *
+ * @param[out] x Resulting integer X = A * B * R^-1 mod P, or A * B mod P if no context is supplied
+ * @param[in] a First operand A
+ * @param[in] b Second operand B
+ * @param[in] context Montgomery context computed for P, or NULL
+ * @param[in] p Modulus P
+ * @return Error code
+ **/
+
+error_t mpiExpModMul(Mpi *x, const Mpi *a, const Mpi *b,
+   const MpiMontgomeryContext *context, const Mpi *p)
+{
+   error_t error;
+
+   //Even modulus?
+   if(context == NULL)
+      return mpiMulMod(x, a, b, p);
+
+   //Perform Montgomery multiplication
+   MPI_CHECK(mpiMul(x, a, b));
+   MPI_CHECK(mpiMontgomeryRedCore(x, context->k, context->m, p));
+
+end:
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Initialize a Montgomery context
+ * @param[in] context Pointer to the Montgomery context to initialize
+ **/
+
+void mpiMontgomeryInit(MpiMontgomeryContext *context)
+{
+   //No modulus has been loaded yet
+   context->k = 0;
+   context->m = 0;
+   //Initialize multiple precision integer
+   mpiInit(&context->r2);
+}
+
+
+/**
+ * @brief Release a Montgomery context
+ * @param[in] context Pointer to the Montgomery context to free
+ **/
+
+void mpiMontgomeryFree(MpiMontgomeryContext *context)
+{
+   //The context is no longer usable
+   context->k = 0;
+   context->m = 0;
+   //Free multiple precision integer
+   mpiFree(&context->r2);
+}
+
+
+/**
+ * @brief Compute the Montgomery constants of an odd modulus
+ * @param[in,out] context Pointer to the Montgomery context
+ * @param[in] p Odd modulus P
+ * @return Error code
+ **/
+
+error_t mpiMontgomerySetModulus(MpiMontgomeryContext *context, const Mpi *p)
+{
+   error_t error;
+   uint_t i;
+   uint_t k;
+   uint32_t m;
+
+   //Forget the previous modulus
+   context->k = 0;
+
+   //Montgomery multiplication cannot be used with an even modulus
+   if(mpiIsEven(p))
+      return ERROR_INVALID_PARAMETER;
+
+   //Compute the smaller R = (2^32)^k such as R > P
+   k = mpiGetLength(p);
+
+   //Compute R^2 mod P
+   MPI_CHECK(mpiSetValue(&context->r2, 1));
+   MPI_CHECK(mpiShiftLeft(&context->r2, 2 * k * (MPI_INT_SIZE * 8)));
+   MPI_CHECK(mpiMod(&context->r2, &context->r2, p));
+
+   //Use Newton's method to compute the inverse of P[0] mod 2^32
+   for(m = 2 - p->data[0], i = 0; i < 4; i++)
+         m = m * (2 - m * p->data[0]);
+
+   //Precompute -1/P[0] mod 2^32
+   context->m = ~m + 1;
+   //The context can now be used
+   context->k = k;
+
+end:
    //Return status code
    return error;
 }
 
 
+/**
+ * @brief Check whether a Montgomery context matches a given modulus
+ *
+ * This is a cheap sanity check (length of the modulus and least
+ * significant word) that catches contexts never computed or left
+ * behind by a previous key
+ *
+ * @param[in] context Pointer to the Montgomery context
+ * @param[in] p Modulus P
+ * @return TRUE if the context can be used with P, else FALSE
+ **/
+
+bool_t mpiMontgomeryCheckModulus(const MpiMontgomeryContext *context, const Mpi *p)
+{
+   //Context not computed?
+   if(context->k == 0)
+      return FALSE;
+   //The length of the modulus must match
+   if(context->k != mpiGetLength(p))
+      return FALSE;
+   //M must be equal to -1/P[0] mod 2^32
+   if((uint32_t) (context->m * p->data[0]) != 0xFFFFFFFF)
+      return FALSE;
+
+   //The context matches the modulus
+   return TRUE;
+}
+
+
 /**
  * @brief Montgomery multiplication (X = A * B / 2^k mod P)
  **/
@@ -1363,6 +2064,62 @@ end:
 }
 
 
+/**
+ * @brief Multiply-accumulate kernel (R = R + A * B)
+ *
+ * This is the inner loop of the Montgomery reduction. On Cortex-M3/M4
+ * targets, the UMAAL instruction performs the 32x32 multiplication and
+ * both 32-bit additions at once
+ *
+ * @param[in,out] r Accumulator R (m words)
+ * @param[in] a Word array A
+ * @param[in] m Length of A, in words
+ * @param[in] b Single word B
+ * @return Carry out of the most significant word of R
+ **/
+
+uint_t mpiMulAccCore(uint_t *r, const uint_t *a, uint_t m, uint_t b)
+{
+#if (MPI_ASM_SUPPORT == ENABLED && defined(__GNUC__) && \
+   (defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)))
+   uint_t i;
+   uint_t lo;
+   uint_t c;
+
+   //Clear carry
+   c = 0;
+
+   for(i = 0; i < m; i++)
+   {
+      //Compute C:R[i] = A[i] * B + R[i] + C
+      lo = r[i];
+      __asm__("umaal %0, %1, %2, %3" : "+r" (lo), "+r" (c) : "r" (a[i]), "r" (b));
+      r[i] = lo;
+   }
+
+   //Return carry
+   return c;
+#else
+   uint_t i;
+   uint64_t c;
+
+   //Clear carry
+   c = 0;
+
+   for(i = 0; i < m; i++)
+   {
+      //Compute C:R[i] = A[i] * B + R[i] + C
+      c += (uint64_t) a[i] * b + r[i];
+      r[i] = (uint32_t) c;
+      c >>= 32;
+   }
+
+   //Return carry
+   return (uint_t) c;
+#endif
+}
+
+
 /**
  * @brief Montgomery reduction (X = X / 2^k mod P)
  * @param[in,out] x Pointer to a multiple precision integer
@@ -1391,13 +2148,8 @@ error_t mpiMontgomeryRed(Mpi *x, uint_t k, const Mpi *p)
 
    return NO_ERROR;
 #else
-   error_t error;
    uint_t i;
    uint32_t m;
-   Mpi ll;
-
-   //Initialize multiple precision integer
-   mpiInit(&ll);
 
    //Use Newton's method to compute the inverse of P[0] mod 2^32
    for(m = 2 - p->data[0], i = 0; i < 4; i++)
@@ -1406,27 +2158,57 @@ error_t mpiMontgomeryRed(Mpi *x, uint_t k, const Mpi *p)
    //Precompute -1/P[0] mod 2^32;
    m = ~m + 1;
 
+   //Perform Montgomery reduction
+   return mpiMontgomeryRedCore(x, k, m, p);
+#endif
+}
+
+
+/**
+ * @brief Montgomery reduction with a precomputed constant
+ * @param[in,out] x Pointer to a multiple precision integer
+ * @param[in] k Length of the modulus, in words
+ * @param[in] m Value of -1/P[0] mod 2^32
+ * @param[in] p Modulus P
+ * @return Error code
+ **/
+
+error_t mpiMontgomeryRedCore(Mpi *x, uint_t k, uint_t m, const Mpi *p)
+{
+   error_t error;
+   uint_t i;
+   uint_t j;
+   uint_t c;
+
+   //The intermediate result requires 2k + 1 words
+   MPI_CHECK(mpiGrow(x, 2 * k + 1));
+
+   //Clear one word at a time, starting with the least significant one
    for(i = 0; i < k; i++)
    {
-      MPI_CHECK(mpiSetValue(&ll, 1));
-      ll.data[0] = x->data[0] * m;
+      //Compute X = X + (X[i] * M mod 2^32) * P * 2^(32 * i)
+      c = mpiMulAccCore(x->data + i, p->data, k, x->data[i] * m);
 
-      MPI_CHECK(mpiMul(&ll, p, &ll));
-      MPI_CHECK(mpiAdd(x, x, &ll));
-      MPI_CHECK(mpiShiftRight(x, MPI_INT_SIZE * 8));
+      //Propagate the carry
+      for(j = i + k; c != 0 && j < x->size; j++)
+      {
+         x->data[j] += c;
+         c = (x->data[j] < c) ? 1 : 0;
+      }
    }
 
+   //Divide X by 2^(32 * k)
+   memmove(x->data, x->data + k, (x->size - k) * MPI_INT_SIZE);
+   memset(x->data + x->size - k, 0, k * MPI_INT_SIZE);
+
    if(mpiComp(x, p) >= 0)
    {
       MPI_CHECK(mpiSub(x, x, p));
    }
 
 end:
-   //Release multiple precision integer
-   mpiFree(&ll);
    //Return status code
    return error;
-#endif
 }
 
 
@@ -33,6 +33,48 @@
 #include <stdio.h>
 #include "crypto.h"
 
+//Maximum window size for modular exponentiation
+#ifndef MPI_MAX_EXP_WINDOW_SIZE
+   #define MPI_MAX_EXP_WINDOW_SIZE 5
+#elif (MPI_MAX_EXP_WINDOW_SIZE < 1 || MPI_MAX_EXP_WINDOW_SIZE > 6)
+   #error MPI_MAX_EXP_WINDOW_SIZE parameter is invalid
+#endif
+
+//Operand length (in words) above which Karatsuba multiplication is used
+#ifndef MPI_KARATSUBA_THRESHOLD
+   #define MPI_KARATSUBA_THRESHOLD 32
+#elif (MPI_KARATSUBA_THRESHOLD < 4)
+   #error MPI_KARATSUBA_THRESHOLD parameter is invalid
+#endif
+
+//Assembly optimizations (used only on supported targets)
+#ifndef MPI_ASM_SUPPORT
+   #define MPI_ASM_SUPPORT ENABLED
+#elif (MPI_ASM_SUPPORT != ENABLED && MPI_ASM_SUPPORT != DISABLED)
+   #error MPI_ASM_SUPPORT parameter is invalid
+#endif
+
+//Pool of fixed-capacity limb buffers
+#ifndef MPI_POOL_SUPPORT
+   #define MPI_POOL_SUPPORT DISABLED
+#elif (MPI_POOL_SUPPORT != ENABLED && MPI_POOL_SUPPORT != DISABLED)
+   #error MPI_POOL_SUPPORT parameter is invalid
+#endif
+
+//Number of buffers in the pool
+#ifndef MPI_POOL_BLOCK_COUNT
+   #define MPI_POOL_BLOCK_COUNT 32
+#elif (MPI_POOL_BLOCK_COUNT < 1)
+   #error MPI_POOL_BLOCK_COUNT parameter is invalid
+#endif
+
+//Capacity of each buffer, in words (product of two 2048-bit integers)
+#ifndef MPI_POOL_BLOCK_SIZE
+   #define MPI_POOL_BLOCK_SIZE 132
+#elif (MPI_POOL_BLOCK_SIZE < 1)
+   #error MPI_POOL_BLOCK_SIZE parameter is invalid
+#endif
+
 //Size of the sub data type
 #define MPI_INT_SIZE sizeof(uint_t)
 
@@ -56,7 +98,27 @@ typedef struct
 } Mpi;
 
 
+/**
+ * @brief Montgomery context
+ *
+ * Constants that only depend on an odd modulus P. Keys and domain
+ * parameters compute them once, so that each exponentiation modulo P
+ * no longer needs a long division to obtain R^2 mod P
+ **/
+
+typedef struct
+{
+   uint_t k;  ///<Length of the modulus, in words (0 if not computed)
+   uint_t m;  ///<-1/P[0] mod 2^32
+   Mpi r2;    ///<R^2 mod P, with R = 2^(32 * k)
+} MpiMontgomeryContext;
+
+
 //MPI related functions
+uint_t *mpiAllocData(uint_t size);
+void mpiFreeData(uint_t *data);
+bool_t mpiIsPoolData(const uint_t *data);
+
 void mpiInit(Mpi *x);
 void mpiFree(Mpi *x);
 
@@ -94,6 +156,10 @@ error_t mpiShiftLeft(Mpi *x, uint_t n);
 error_t mpiShiftRight(Mpi *x, uint_t n);
 
 error_t mpiMul(Mpi *x, const Mpi *a, const Mpi *b);
+void mpiMulCore(uint_t *r, const uint_t *a, uint_t m, const uint_t *b, uint_t n);
+void mpiSqrCore(uint_t *r, const uint_t *a, uint_t n);
+void mpiKaratsubaMul(uint_t *r, const uint_t *a, const uint_t *b, uint_t n, uint_t *t);
+uint_t mpiKaratsubaScratchSize(uint_t n);
 error_t mpiMulInt(Mpi *x, const Mpi *a, int_t b);
 
 error_t mpiDiv(Mpi *x, Mpi *y, const Mpi *a, const Mpi *b);
@@ -103,9 +169,20 @@ error_t mpiMod(Mpi *x, const Mpi *a, const Mpi *b);
 error_t mpiMulMod(Mpi *x, const Mpi *a, const Mpi *b, const Mpi *p);
 error_t mpiInvMod(Mpi *x, const Mpi *a, const Mpi *p);
 error_t mpiExpMod(Mpi *x, const Mpi *a, const Mpi *e, const Mpi *p);
+error_t mpiExpModMont(Mpi *x, const Mpi *a, const Mpi *e,
+   const Mpi *p, const MpiMontgomeryContext *context);
+error_t mpiExpModMul(Mpi *x, const Mpi *a, const Mpi *b,
+   const MpiMontgomeryContext *context, const Mpi *p);
+
+void mpiMontgomeryInit(MpiMontgomeryContext *context);
+void mpiMontgomeryFree(MpiMontgomeryContext *context);
+error_t mpiMontgomerySetModulus(MpiMontgomeryContext *context, const Mpi *p);
+bool_t mpiMontgomeryCheckModulus(const MpiMontgomeryContext *context, const Mpi *p);
 
 error_t mpiMontgomeryMul(Mpi *x, const Mpi *a, const Mpi *b, uint_t k, const Mpi *p);
 error_t mpiMontgomeryRed(Mpi *x, uint_t k, const Mpi *p);
+error_t mpiMontgomeryRedCore(Mpi *x, uint_t k, uint_t m, const Mpi *p);
+uint_t mpiMulAccCore(uint_t *r, const uint_t *a, uint_t m, uint_t b);
 
 void mpiDump(FILE *stream, const char_t *prepend, const Mpi *a);
 
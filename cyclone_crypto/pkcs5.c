@@ -137,6 +137,7 @@ error_t pbkdf2(const HashAlgo *hash, const uint8_t *p, size_t pLen,
    uint_t k;
    uint8_t *u;
    uint8_t *t;
+   HmacKey *key;
    HmacContext *context;
    uint8_t a[4];
 
@@ -146,21 +147,27 @@ error_t pbkdf2(const HashAlgo *hash, const uint8_t *p, size_t pLen,
 
    //Allocate a memory buffer to hold the HMAC context
    context = osMemAlloc(sizeof(HmacContext));
+   //Allocate a memory buffer to hold the precomputed key
+   key = osMemAlloc(sizeof(HmacKey));
    //Allocate temporary buffers
    u = osMemAlloc(hash->digestSize);
    t = osMemAlloc(hash->digestSize);
 
    //Failed to allocate memory?
-   if(!context || !u || !t)
+   if(!context || !key || !u || !t)
    {
       //Free previously allocated memory
       osMemFree(context);
+      osMemFree(key);
       osMemFree(u);
       osMemFree(t);
       //Report an error
       return ERROR_OUT_OF_MEMORY;
    }
 
+   //The password is the HMAC key of every iteration
+   hmacInitKey(key, hash, p, pLen);
+
    //For each block of the derived key apply the function F
    for(i = 1; dkLen > 0; i++)
    {
@@ -171,7 +178,7 @@ error_t pbkdf2(const HashAlgo *hash, const uint8_t *p, size_t pLen,
       a[3] = i & 0xFF;
 
       //Compute U1 = PRF(P, S || INT(i))
-      hmacInit(context, hash, p, pLen);
+      hmacInitWithKey(context, key);
       hmacUpdate(context, s, sLen);
       hmacUpdate(context, a, 4);
       hmacFinal(context, u);
@@ -183,7 +190,7 @@ error_t pbkdf2(const HashAlgo *hash, const uint8_t *p, size_t pLen,
       for(j = 1; j < c; j++)
       {
          //Compute U(j) = PRF(P, U(j-1))
-         hmacInit(context, hash, p, pLen);
+         hmacInitWithKey(context, key);
          hmacUpdate(context, u, hash->digestSize);
          hmacFinal(context, u);
 
@@ -201,8 +208,12 @@ error_t pbkdf2(const HashAlgo *hash, const uint8_t *p, size_t pLen,
       dkLen -= k;
    }
 
+   //Erase the precomputed key
+   memset(key, 0, sizeof(HmacKey));
+
    //Free previously allocated memory
    osMemFree(context);
+   osMemFree(key);
    osMemFree(u);
    osMemFree(t);
 
@@ -0,0 +1,275 @@
+/**
+ * @file poly1305.c
+ * @brief Poly1305 message-authentication code
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneCrypto Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Poly1305 is a one-time message authentication code designed by
+ * D. J. Bernstein. Refer to RFC 7539 for more details
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL CRYPTO_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "crypto.h"
+#include "poly1305.h"
+
+//Check crypto library configuration
+#if (POLY1305_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Initialize Poly1305 message-authentication code computation
+ * @param[in] context Pointer to the Poly1305 context to initialize
+ * @param[in] key Pointer to the 256-bit one-time key
+ **/
+
+void poly1305Init(Poly1305Context *context, const uint8_t *key)
+{
+   //The first 16 bytes of the key form the value r. Clamp it and split
+   //it into five 26-bit limbs
+   context->r[0] = LOAD32LE(key) & 0x03FFFFFF;
+   context->r[1] = (LOAD32LE(key + 3) >> 2) & 0x03FFFF03;
+   context->r[2] = (LOAD32LE(key + 6) >> 4) & 0x03FFC0FF;
+   context->r[3] = (LOAD32LE(key + 9) >> 6) & 0x03F03FFF;
+   context->r[4] = (LOAD32LE(key + 12) >> 8) & 0x000FFFFF;
+
+   //The last 16 bytes of the key form the value s
+   context->pad[0] = LOAD32LE(key + 16);
+   context->pad[1] = LOAD32LE(key + 20);
+   context->pad[2] = LOAD32LE(key + 24);
+   context->pad[3] = LOAD32LE(key + 28);
+
+   //The accumulator is set to zero
+   context->h[0] = 0;
+   context->h[1] = 0;
+   context->h[2] = 0;
+   context->h[3] = 0;
+   context->h[4] = 0;
+
+   //Number of bytes in the buffer
+   context->size = 0;
+}
+
+
+/**
+ * @brief Update Poly1305 message-authentication code computation
+ * @param[in] context Pointer to the Poly1305 context
+ * @param[in] data Pointer to the input message
+ * @param[in] length Length of the input message
+ **/
+
+void poly1305Update(Poly1305Context *context, const void *data, size_t length)
+{
+   size_t n;
+
+   //Process the incoming data
+   while(length > 0)
+   {
+      //The buffer can hold at most 16 bytes
+      n = min(length, 16 - context->size);
+
+      //Copy the data to the buffer
+      memcpy(context->buffer + context->size, data, n);
+
+      //Update the Poly1305 context
+      context->size += n;
+      //Advance the data pointer
+      data = (uint8_t *) data + n;
+      //Remaining bytes to process
+      length -= n;
+
+      //Process message in 16-byte blocks
+      if(context->size == 16)
+      {
+         //Transform the 16-byte block
+         poly1305ProcessBlock(context);
+         //Empty the buffer
+         context->size = 0;
+      }
+   }
+}
+
+
+/**
+ * @brief Finish Poly1305 message-authentication code computation
+ * @param[in] context Pointer to the Poly1305 context
+ * @param[out] tag Calculated 128-bit tag
+ **/
+
+void poly1305Final(Poly1305Context *context, uint8_t *tag)
+{
+   uint32_t mask;
+   uint32_t g[5];
+   uint64_t temp;
+   uint32_t *h;
+
+   //Process the last block
+   if(context->size != 0)
+      poly1305ProcessBlock(context);
+
+   //Point to the accumulator
+   h = context->h;
+
+   //Fully carry the accumulator
+   h[2] += h[1] >> 26;
+   h[1] &= 0x03FFFFFF;
+   h[3] += h[2] >> 26;
+   h[2] &= 0x03FFFFFF;
+   h[4] += h[3] >> 26;
+   h[3] &= 0x03FFFFFF;
+   h[0] += (h[4] >> 26) * 5;
+   h[4] &= 0x03FFFFFF;
+   h[1] += h[0] >> 26;
+   h[0] &= 0x03FFFFFF;
+
+   //Compute h + -p = h - (2^130 - 5)
+   g[0] = h[0] + 5;
+   g[1] = h[1] + (g[0] >> 26);
+   g[0] &= 0x03FFFFFF;
+   g[2] = h[2] + (g[1] >> 26);
+   g[1] &= 0x03FFFFFF;
+   g[3] = h[3] + (g[2] >> 26);
+   g[2] &= 0x03FFFFFF;
+   g[4] = h[4] + (g[3] >> 26) - (1UL << 26);
+   g[3] &= 0x03FFFFFF;
+
+   //Select h if h < p, or h - p if h >= p, without branching
+   mask = (g[4] >> 31) - 1;
+   h[0] = (h[0] & ~mask) | (g[0] & mask);
+   h[1] = (h[1] & ~mask) | (g[1] & mask);
+   h[2] = (h[2] & ~mask) | (g[2] & mask);
+   h[3] = (h[3] & ~mask) | (g[3] & mask);
+   h[4] = (h[4] & ~mask) | (g[4] & mask);
+
+   //Convert the accumulator back to four 32-bit words
+   h[0] = h[0] | (h[1] << 26);
+   h[1] = (h[1] >> 6) | (h[2] << 20);
+   h[2] = (h[2] >> 12) | (h[3] << 14);
+   h[3] = (h[3] >> 18) | (h[4] << 8);
+
+   //The value s is added to the accumulator modulo 2^128
+   temp = (uint64_t) h[0] + context->pad[0];
+   STORE32LE((uint32_t) temp, tag);
+   temp = (uint64_t) h[1] + context->pad[1] + (temp >> 32);
+   STORE32LE((uint32_t) temp, tag + 4);
+   temp = (uint64_t) h[2] + context->pad[2] + (temp >> 32);
+   STORE32LE((uint32_t) temp, tag + 8);
+   temp = (uint64_t) h[3] + context->pad[3] + (temp >> 32);
+   STORE32LE((uint32_t) temp, tag + 12);
+
+   //Clear the key material
+   memset(context, 0, sizeof(Poly1305Context));
+}
+
+
+/**
+ * @brief Process a message block
+ *
+ * The block held in the buffer is converted to a 130-bit number by
+ * appending a 0x01 byte, added to the accumulator and multiplied by r
+ * modulo 2^130 - 5
+ *
+ * @param[in] context Pointer to the Poly1305 context
+ **/
+
+void poly1305ProcessBlock(Poly1305Context *context)
+{
+   uint32_t hibit;
+   uint32_t c;
+   uint32_t *r;
+   uint32_t *h;
+   uint32_t s[5];
+   uint64_t d[5];
+   uint8_t *m;
+
+   //Point to the context
+   r = context->r;
+   h = context->h;
+   m = context->buffer;
+
+   //Check whether the block is complete
+   if(context->size == 16)
+   {
+      //The 0x01 byte is appended beyond the end of the block
+      hibit = 1UL << 24;
+   }
+   else
+   {
+      //A partial block is padded with a 0x01 byte and zeroes
+      m[context->size] = 0x01;
+      memset(m + context->size + 1, 0, 15 - context->size);
+      hibit = 0;
+   }
+
+   //Add the block to the accumulator
+   h[0] += LOAD32LE(m) & 0x03FFFFFF;
+   h[1] += (LOAD32LE(m + 3) >> 2) & 0x03FFFFFF;
+   h[2] += (LOAD32LE(m + 6) >> 4) & 0x03FFFFFF;
+   h[3] += (LOAD32LE(m + 9) >> 6) & 0x03FFFFFF;
+   h[4] += ((LOAD32LE(m + 12) >> 8) & 0x00FFFFFF) | hibit;
+
+   //Precompute 5 * r (2^130 is congruent to 5 modulo p)
+   s[1] = r[1] * 5;
+   s[2] = r[2] * 5;
+   s[3] = r[3] * 5;
+   s[4] = r[4] * 5;
+
+   //Multiply the accumulator by r
+   d[0] = (uint64_t) h[0] * r[0] + (uint64_t) h[1] * s[4] + (uint64_t) h[2] * s[3] +
+      (uint64_t) h[3] * s[2] + (uint64_t) h[4] * s[1];
+   d[1] = (uint64_t) h[0] * r[1] + (uint64_t) h[1] * r[0] + (uint64_t) h[2] * s[4] +
+      (uint64_t) h[3] * s[3] + (uint64_t) h[4] * s[2];
+   d[2] = (uint64_t) h[0] * r[2] + (uint64_t) h[1] * r[1] + (uint64_t) h[2] * r[0] +
+      (uint64_t) h[3] * s[4] + (uint64_t) h[4] * s[3];
+   d[3] = (uint64_t) h[0] * r[3] + (uint64_t) h[1] * r[2] + (uint64_t) h[2] * r[1] +
+      (uint64_t) h[3] * r[0] + (uint64_t) h[4] * s[4];
+   d[4] = (uint64_t) h[0] * r[4] + (uint64_t) h[1] * r[3] + (uint64_t) h[2] * r[2] +
+      (uint64_t) h[3] * r[1] + (uint64_t) h[4] * r[0];
+
+   //Partial reduction modulo 2^130 - 5
+   c = (uint32_t) (d[0] >> 26);
+   h[0] = (uint32_t) d[0] & 0x03FFFFFF;
+   d[1] += c;
+   c = (uint32_t) (d[1] >> 26);
+   h[1] = (uint32_t) d[1] & 0x03FFFFFF;
+   d[2] += c;
+   c = (uint32_t) (d[2] >> 26);
+   h[2] = (uint32_t) d[2] & 0x03FFFFFF;
+   d[3] += c;
+   c = (uint32_t) (d[3] >> 26);
+   h[3] = (uint32_t) d[3] & 0x03FFFFFF;
+   d[4] += c;
+   c = (uint32_t) (d[4] >> 26);
+   h[4] = (uint32_t) d[4] & 0x03FFFFFF;
+   h[0] += c * 5;
+   h[1] += h[0] >> 26;
+   h[0] &= 0x03FFFFFF;
+}
+
+#endif
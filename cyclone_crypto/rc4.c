@@ -48,6 +48,8 @@ const CipherAlgo rc4CipherAlgo =
    (CipherAlgoEncryptStream) rc4Cipher,
    (CipherAlgoDecryptStream) rc4Cipher,
    NULL,
+   NULL,
+   NULL,
    NULL
 };
 
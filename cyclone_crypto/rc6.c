@@ -56,7 +56,9 @@ const CipherAlgo rc6CipherAlgo =
    NULL,
    NULL,
    (CipherAlgoEncryptBlock) rc6EncryptBlock,
-   (CipherAlgoDecryptBlock) rc6DecryptBlock
+   (CipherAlgoDecryptBlock) rc6DecryptBlock,
+   NULL,
+   NULL
 };
 
 
@@ -69,6 +69,8 @@ void rsaInitPublicKey(RsaPublicKey *key)
    //Initialize multiple precision integers
    mpiInit(&key->n);
    mpiInit(&key->e);
+   //Initialize Montgomery context
+   mpiMontgomeryInit(&key->nMont);
 }
 
 
@@ -82,6 +84,8 @@ void rsaFreePublicKey(RsaPublicKey *key)
    //Free multiple precision integers
    mpiFree(&key->n);
    mpiFree(&key->e);
+   //Free Montgomery context
+   mpiMontgomeryFree(&key->nMont);
 }
 
 
@@ -101,6 +105,10 @@ void rsaInitPrivateKey(RsaPrivateKey *key)
    mpiInit(&key->dp);
    mpiInit(&key->dq);
    mpiInit(&key->qinv);
+   //Initialize Montgomery contexts
+   mpiMontgomeryInit(&key->nMont);
+   mpiMontgomeryInit(&key->pMont);
+   mpiMontgomeryInit(&key->qMont);
 }
 
 
@@ -120,6 +128,65 @@ void rsaFreePrivateKey(RsaPrivateKey *key)
    mpiFree(&key->dp);
    mpiFree(&key->dq);
    mpiFree(&key->qinv);
+   //Free Montgomery contexts
+   mpiMontgomeryFree(&key->nMont);
+   mpiMontgomeryFree(&key->pMont);
+   mpiMontgomeryFree(&key->qMont);
+}
+
+
+/**
+ * @brief Precompute the Montgomery context of a RSA public key
+ *
+ * This function must be called once the modulus has been loaded. Public
+ * key operations then skip the computation of R^2 mod n
+ *
+ * @param[in,out] key Pointer to the RSA public key
+ * @return Error code
+ **/
+
+error_t rsaPrecomputePublicKey(RsaPublicKey *key)
+{
+   //The modulus of a valid RSA key is odd
+   return mpiMontgomerySetModulus(&key->nMont, &key->n);
+}
+
+
+/**
+ * @brief Precompute the Montgomery contexts of a RSA private key
+ *
+ * This function must be called once the key has been loaded. The factors
+ * are optional, in which case only the modulus is processed
+ *
+ * @param[in,out] key Pointer to the RSA private key
+ * @return Error code
+ **/
+
+error_t rsaPrecomputePrivateKey(RsaPrivateKey *key)
+{
+   error_t error;
+
+   //Process the modulus
+   error = mpiMontgomerySetModulus(&key->nMont, &key->n);
+   //Any error to report?
+   if(error) return error;
+
+   //The Chinese remainder algorithm operates modulo p and q
+   if(key->p.size && key->q.size)
+   {
+      //Process the first factor
+      error = mpiMontgomerySetModulus(&key->pMont, &key->p);
+      //Any error to report?
+      if(error) return error;
+
+      //Process the second factor
+      error = mpiMontgomerySetModulus(&key->qMont, &key->q);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //Successful processing
+   return NO_ERROR;
 }
 
 
@@ -146,7 +213,7 @@ error_t rsaep(const RsaPublicKey *key, const Mpi *m, Mpi *c)
       return ERROR_OUT_OF_RANGE;
 
    //Perform modular exponentiation (c = m ^ e mod n)
-   return mpiExpMod(c, m, &key->e, &key->n);
+   return mpiExpModMont(c, m, &key->e, &key->n, &key->nMont);
 }
 
 
@@ -183,9 +250,9 @@ error_t rsadp(const RsaPrivateKey *key, const Mpi *c, Mpi *m)
       key->dp.size && key->dq.size && key->qinv.size)
    {
       //Compute m1 = c ^ dP mod p
-      MPI_CHECK(mpiExpMod(&m1, c, &key->dp, &key->p));
+      MPI_CHECK(mpiExpModMont(&m1, c, &key->dp, &key->p, &key->pMont));
       //Compute m2 = c ^ dQ mod q
-      MPI_CHECK(mpiExpMod(&m2, c, &key->dq, &key->q));
+      MPI_CHECK(mpiExpModMont(&m2, c, &key->dq, &key->q, &key->qMont));
       //Let h = (m1 - m2) * qInv mod p
       MPI_CHECK(mpiSub(&h, &m1, &m2));
       MPI_CHECK(mpiMulMod(&h, &h, &key->qinv, &key->p));
@@ -197,7 +264,7 @@ error_t rsadp(const RsaPrivateKey *key, const Mpi *c, Mpi *m)
    else if(key->n.size && key->d.size)
    {
       //Let m = c ^ d mod n
-      error = mpiExpMod(m, c, &key->d, &key->n);
+      error = mpiExpModMont(m, c, &key->d, &key->n, &key->nMont);
    }
    //Invalid parameters?
    else
@@ -736,6 +803,207 @@ error_t rsassaPkcs1v15Verify(const RsaPublicKey *key, const HashAlgo *hash,
 }
 
 
+/**
+ * @brief RSASSA-PSS signature generation operation
+ * @param[in] prngAlgo PRNG algorithm
+ * @param[in] prngContext Pointer to the PRNG context
+ * @param[in] key Signer's RSA private key
+ * @param[in] hash Hash function used to digest the message
+ * @param[in] saltLength Length of the salt, in bytes
+ * @param[in] digest Digest of the message to be signed
+ * @param[out] signature Resulting signature
+ * @param[out] signatureLength Length of the resulting signature
+ * @return Error code
+ **/
+
+error_t rsassaPssSign(const PrngAlgo *prngAlgo, void *prngContext,
+   const RsaPrivateKey *key, const HashAlgo *hash, size_t saltLength,
+   const uint8_t *digest, uint8_t *signature, size_t *signatureLength)
+{
+   error_t error;
+   uint_t k;
+   uint_t emBits;
+   size_t emLength;
+   uint8_t *em;
+   Mpi m;
+   Mpi s;
+
+   //Check parameters
+   if(prngAlgo == NULL || prngContext == NULL)
+      return ERROR_INVALID_PARAMETER;
+   if(key == NULL || hash == NULL || digest == NULL)
+      return ERROR_INVALID_PARAMETER;
+   if(signature == NULL || signatureLength == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Debug message
+   TRACE_DEBUG("RSASSA-PSS signature generation...\r\n");
+   TRACE_DEBUG("  Modulus:\r\n");
+   TRACE_DEBUG_MPI("    ", &key->n);
+   TRACE_DEBUG("  Message digest:\r\n");
+   TRACE_DEBUG_ARRAY("    ", digest, hash->digestSize);
+
+   //Initialize multiple-precision integers
+   mpiInit(&m);
+   mpiInit(&s);
+
+   //Get the length in octets of the modulus n
+   k = mpiGetByteLength(&key->n);
+   //The encoded message is one bit shorter than the modulus
+   emBits = mpiGetBitLength(&key->n) - 1;
+   emLength = (emBits + 7) / 8;
+
+   //Point to the buffer where the encoded message EM will be generated
+   em = signature;
+
+   //Apply the EMSA-PSS encoding operation
+   error = emsaPssEncode(prngAlgo, prngContext, hash,
+      saltLength, digest, em, emBits);
+   //Any error to report?
+   if(error) return error;
+
+   //Debug message
+   TRACE_DEBUG("  Encoded message\r\n");
+   TRACE_DEBUG_ARRAY("    ", em, emLength);
+
+   //Start of exception handling block
+   do
+   {
+      //Convert the encoded message EM to an integer message representative m
+      error = mpiReadRaw(&m, em, emLength);
+      //Conversion failed?
+      if(error) break;
+
+      //Apply the RSASP1 signature primitive
+      error = rsasp1(key, &m, &s);
+      //Any error to report?
+      if(error) break;
+
+      //Convert the signature representative s to a signature of length k octets
+      error = mpiWriteRaw(&s, signature, k);
+      //Conversion failed?
+      if(error) break;
+
+      //Length of the resulting signature
+      *signatureLength = k;
+
+      //Debug message
+      TRACE_DEBUG("  Signature:\r\n");
+      TRACE_DEBUG_ARRAY("    ", signature, *signatureLength);
+
+      //End of exception handling block
+   } while(0);
+
+   //Free previously allocated memory
+   mpiFree(&m);
+   mpiFree(&s);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief RSASSA-PSS signature verification operation
+ * @param[in] key Signer's RSA public key
+ * @param[in] hash Hash function used to digest the message
+ * @param[in] saltLength Length of the salt, in bytes
+ * @param[in] digest Digest of the message whose signature is to be verified
+ * @param[in] signature Signature to be verified
+ * @param[in] signatureLength Length of the signature to be verified
+ * @return Error code
+ **/
+
+error_t rsassaPssVerify(const RsaPublicKey *key, const HashAlgo *hash,
+   size_t saltLength, const uint8_t *digest, const uint8_t *signature,
+   size_t signatureLength)
+{
+   error_t error;
+   uint_t k;
+   uint_t emBits;
+   size_t emLength;
+   uint8_t *em;
+   Mpi s;
+   Mpi m;
+
+   //Check parameters
+   if(key == NULL || hash == NULL || digest == NULL || signature == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Debug message
+   TRACE_DEBUG("RSASSA-PSS signature verification...\r\n");
+   TRACE_DEBUG("  Modulus:\r\n");
+   TRACE_DEBUG_MPI("    ", &key->n);
+   TRACE_DEBUG("  Public exponent:\r\n");
+   TRACE_DEBUG_MPI("    ", &key->e);
+   TRACE_DEBUG("  Message digest:\r\n");
+   TRACE_DEBUG_ARRAY("    ", digest, hash->digestSize);
+   TRACE_DEBUG("  Signature:\r\n");
+   TRACE_DEBUG_ARRAY("    ", signature, signatureLength);
+
+   //Get the length in octets of the modulus n
+   k = mpiGetByteLength(&key->n);
+   //The encoded message is one bit shorter than the modulus
+   emBits = mpiGetBitLength(&key->n) - 1;
+   emLength = (emBits + 7) / 8;
+
+   //Check the length of the signature
+   if(signatureLength != k)
+      return ERROR_INVALID_LENGTH;
+
+   //Initialize multiple-precision integers
+   mpiInit(&s);
+   mpiInit(&m);
+
+   //Allocate a memory buffer to hold the encoded message
+   em = osMemAlloc(k);
+   //Failed to allocate memory?
+   if(!em) return ERROR_OUT_OF_MEMORY;
+
+   //Start of exception handling block
+   do
+   {
+      //Convert the signature to an integer signature representative s
+      error = mpiReadRaw(&s, signature, signatureLength);
+      //Conversion failed?
+      if(error) break;
+
+      //Apply the RSAVP1 verification primitive
+      error = rsavp1(key, &s, &m);
+      //Any error to report?
+      if(error) break;
+
+      //Convert the message representative m to an encoded message EM
+      error = mpiWriteRaw(&m, em, emLength);
+      //The message representative does not fit in emLength octets?
+      if(error)
+      {
+         //Report an error
+         error = ERROR_INVALID_SIGNATURE;
+         break;
+      }
+
+      //Debug message
+      TRACE_DEBUG("  Encoded message\r\n");
+      TRACE_DEBUG_ARRAY("    ", em, emLength);
+
+      //Apply the EMSA-PSS verification operation
+      error = emsaPssVerify(hash, saltLength, digest, em, emBits);
+
+      //End of exception handling block
+   } while(0);
+
+   //Release multiple precision integers
+   mpiFree(&s);
+   mpiFree(&m);
+   //Free previously allocated memory
+   osMemFree(em);
+
+   //Return status code
+   return error;
+}
+
+
 /**
  * @brief PKCS #1 v1.5 encoding method
  * @param[in] hash Hash function used to digest the message
@@ -887,3 +1155,223 @@ error_t emsaPkcs1v15Decode(const uint8_t *em, size_t emLength, const uint8_t **o
    //EM successfully decoded
    return NO_ERROR;
 }
+
+
+/**
+ * @brief EMSA-PSS encoding operation
+ * @param[in] prngAlgo PRNG algorithm
+ * @param[in] prngContext Pointer to the PRNG context
+ * @param[in] hash Hash function used to digest the message
+ * @param[in] saltLength Length of the salt, in bytes
+ * @param[in] digest Digest of the message to be signed
+ * @param[out] em Encoded message
+ * @param[in] emBits Maximal bit length of the encoded message
+ * @return Error code
+ **/
+
+error_t emsaPssEncode(const PrngAlgo *prngAlgo, void *prngContext,
+   const HashAlgo *hash, size_t saltLength, const uint8_t *digest,
+   uint8_t *em, uint_t emBits)
+{
+   error_t error;
+   size_t n;
+   size_t emLength;
+   uint8_t *db;
+   uint8_t *h;
+   uint8_t *salt;
+   HashContext *hashContext;
+   uint8_t padding[8];
+
+   //Length of the encoded message, in bytes
+   emLength = (emBits + 7) / 8;
+
+   //Check the length of the encoded message
+   if(emLength < (hash->digestSize + saltLength + 2))
+      return ERROR_INVALID_LENGTH;
+
+   //Length of the data block DB
+   n = emLength - hash->digestSize - 1;
+
+   //Point to the data block, the hash H and the salt
+   db = em;
+   h = em + n;
+   salt = db + n - saltLength;
+
+   //Generate a random salt
+   error = prngAlgo->read(prngContext, salt, saltLength);
+   //Any error to report?
+   if(error) return error;
+
+   //Allocate a memory buffer to hold the hash context
+   hashContext = osMemAlloc(hash->contextSize);
+   //Failed to allocate memory?
+   if(!hashContext) return ERROR_OUT_OF_MEMORY;
+
+   //Compute H = Hash(00 00 00 00 00 00 00 00 || mHash || salt)
+   memset(padding, 0, sizeof(padding));
+   hash->init(hashContext);
+   hash->update(hashContext, padding, sizeof(padding));
+   hash->update(hashContext, digest, hash->digestSize);
+   hash->update(hashContext, salt, saltLength);
+   hash->final(hashContext, h);
+
+   //Free previously allocated memory
+   osMemFree(hashContext);
+
+   //DB = PS || 0x01 || salt, where PS consists of zero octets
+   memset(db, 0, n - saltLength - 1);
+   db[n - saltLength - 1] = 0x01;
+
+   //Let maskedDB = DB xor MGF(H, emLen - hLen - 1)
+   error = mgf1(hash, h, hash->digestSize, db, n);
+   //Any error to report?
+   if(error) return error;
+
+   //Set the leftmost 8 * emLen - emBits bits of maskedDB to zero
+   db[0] &= 0xFF >> (8 * emLength - emBits);
+   //Append the trailer field
+   em[emLength - 1] = 0xBC;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief EMSA-PSS verification operation
+ * @param[in] hash Hash function used to digest the message
+ * @param[in] saltLength Length of the salt, in bytes
+ * @param[in] digest Digest of the message whose signature is to be verified
+ * @param[in] em Encoded message (modified in place)
+ * @param[in] emBits Maximal bit length of the encoded message
+ * @return Error code
+ **/
+
+error_t emsaPssVerify(const HashAlgo *hash, size_t saltLength,
+   const uint8_t *digest, uint8_t *em, uint_t emBits)
+{
+   error_t error;
+   size_t i;
+   size_t n;
+   size_t emLength;
+   uint8_t mask;
+   uint8_t *db;
+   uint8_t *h;
+   HashContext *hashContext;
+   uint8_t padding[8];
+
+   //Length of the encoded message, in bytes
+   emLength = (emBits + 7) / 8;
+
+   //Check the length of the encoded message
+   if(emLength < (hash->digestSize + saltLength + 2))
+      return ERROR_INVALID_SIGNATURE;
+   //The rightmost octet of EM must have hexadecimal value 0xBC
+   if(em[emLength - 1] != 0xBC)
+      return ERROR_INVALID_SIGNATURE;
+
+   //Length of the data block DB
+   n = emLength - hash->digestSize - 1;
+   //Point to the masked data block and to the hash H
+   db = em;
+   h = em + n;
+
+   //The leftmost 8 * emLen - emBits bits of maskedDB must be zero
+   mask = 0xFF >> (8 * emLength - emBits);
+   if(db[0] & ~mask)
+      return ERROR_INVALID_SIGNATURE;
+
+   //Let DB = maskedDB xor MGF(H, emLen - hLen - 1)
+   error = mgf1(hash, h, hash->digestSize, db, n);
+   //Any error to report?
+   if(error) return error;
+
+   //Set the leftmost 8 * emLen - emBits bits of DB to zero
+   db[0] &= mask;
+
+   //The leftmost octets of DB must be zero, followed by 0x01
+   for(i = 0; i < (n - saltLength - 1); i++)
+   {
+      if(db[i] != 0x00)
+         return ERROR_INVALID_SIGNATURE;
+   }
+   if(db[i] != 0x01)
+      return ERROR_INVALID_SIGNATURE;
+
+   //Allocate a memory buffer to hold the hash context
+   hashContext = osMemAlloc(hash->contextSize);
+   //Failed to allocate memory?
+   if(!hashContext) return ERROR_OUT_OF_MEMORY;
+
+   //Compute H' = Hash(00 00 00 00 00 00 00 00 || mHash || salt)
+   memset(padding, 0, sizeof(padding));
+   hash->init(hashContext);
+   hash->update(hashContext, padding, sizeof(padding));
+   hash->update(hashContext, digest, hash->digestSize);
+   hash->update(hashContext, db + n - saltLength, saltLength);
+   hash->final(hashContext, NULL);
+
+   //The signature is valid if H = H'
+   error = memcmp(h, hashContext->digest, hash->digestSize) ?
+      ERROR_INVALID_SIGNATURE : NO_ERROR;
+
+   //Free previously allocated memory
+   osMemFree(hashContext);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief MGF1 mask generation function
+ * @param[in] hash Hash function
+ * @param[in] seed Seed from which the mask is generated
+ * @param[in] seedLength Length of the seed, in bytes
+ * @param[in,out] data Data block to be masked
+ * @param[in] dataLength Length of the data block, in bytes
+ * @return Error code
+ **/
+
+error_t mgf1(const HashAlgo *hash, const uint8_t *seed, size_t seedLength,
+   uint8_t *data, size_t dataLength)
+{
+   size_t i;
+   size_t n;
+   uint32_t counter;
+   uint8_t c[4];
+   HashContext *hashContext;
+
+   //Allocate a memory buffer to hold the hash context
+   hashContext = osMemAlloc(hash->contextSize);
+   //Failed to allocate memory?
+   if(!hashContext) return ERROR_OUT_OF_MEMORY;
+
+   //The mask is the concatenation of Hash(seed || C) for C = 0, 1, ...
+   for(counter = 0; dataLength > 0; counter++)
+   {
+      //Convert the counter to an octet string of length 4
+      STORE32BE(counter, c);
+
+      //Compute Hash(seed || C)
+      hash->init(hashContext);
+      hash->update(hashContext, seed, seedLength);
+      hash->update(hashContext, c, sizeof(c));
+      hash->final(hashContext, NULL);
+
+      //XOR the data block with the mask
+      n = min(dataLength, hash->digestSize);
+      for(i = 0; i < n; i++)
+         data[i] ^= hashContext->digest[i];
+
+      //Advance data pointer
+      data += n;
+      dataLength -= n;
+   }
+
+   //Free previously allocated memory
+   osMemFree(hashContext);
+
+   //Successful processing
+   return NO_ERROR;
+}
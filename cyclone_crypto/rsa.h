@@ -42,6 +42,7 @@ typedef struct
 {
    Mpi n; ///<Modulus
    Mpi e; ///<Public exponent
+   MpiMontgomeryContext nMont; ///<Montgomery context for the modulus
 } RsaPublicKey;
 
 
@@ -59,6 +60,9 @@ typedef struct
    Mpi dp;   ///<First factor's CRT exponent
    Mpi dq;   ///<second factor's CRT exponent
    Mpi qinv; ///<CRT coefficient
+   MpiMontgomeryContext nMont; ///<Montgomery context for the modulus
+   MpiMontgomeryContext pMont; ///<Montgomery context for the first factor
+   MpiMontgomeryContext qMont; ///<Montgomery context for the second factor
 } RsaPrivateKey;
 
 
@@ -77,6 +81,9 @@ void rsaFreePublicKey(RsaPublicKey *key);
 void rsaInitPrivateKey(RsaPrivateKey *key);
 void rsaFreePrivateKey(RsaPrivateKey *key);
 
+error_t rsaPrecomputePublicKey(RsaPublicKey *key);
+error_t rsaPrecomputePrivateKey(RsaPrivateKey *key);
+
 error_t rsaep(const RsaPublicKey *key, const Mpi *m, Mpi *c);
 error_t rsadp(const RsaPrivateKey *key, const Mpi *c, Mpi *m);
 
@@ -95,10 +102,28 @@ error_t rsassaPkcs1v15Sign(const RsaPrivateKey *key, const HashAlgo *hash,
 error_t rsassaPkcs1v15Verify(const RsaPublicKey *key, const HashAlgo *hash,
    const uint8_t *digest, const uint8_t *signature, size_t signatureLength);
 
+error_t rsassaPssSign(const PrngAlgo *prngAlgo, void *prngContext,
+   const RsaPrivateKey *key, const HashAlgo *hash, size_t saltLength,
+   const uint8_t *digest, uint8_t *signature, size_t *signatureLength);
+
+error_t rsassaPssVerify(const RsaPublicKey *key, const HashAlgo *hash,
+   size_t saltLength, const uint8_t *digest, const uint8_t *signature,
+   size_t signatureLength);
+
 error_t emsaPkcs1v15Encode(const HashAlgo *hash,
    const uint8_t *digest, uint8_t *em, size_t emLength);
 
 error_t emsaPkcs1v15Decode(const uint8_t *em, size_t emLength, const uint8_t **oid,
    size_t *oidLength, const uint8_t **digest, size_t *digestLength);
 
+error_t emsaPssEncode(const PrngAlgo *prngAlgo, void *prngContext,
+   const HashAlgo *hash, size_t saltLength, const uint8_t *digest,
+   uint8_t *em, uint_t emBits);
+
+error_t emsaPssVerify(const HashAlgo *hash, size_t saltLength,
+   const uint8_t *digest, uint8_t *em, uint_t emBits);
+
+error_t mgf1(const HashAlgo *hash, const uint8_t *seed, size_t seedLength,
+   uint8_t *data, size_t dataLength);
+
 #endif
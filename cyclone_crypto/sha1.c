@@ -42,13 +42,32 @@
 //Check crypto library configuration
 #if (SHA1_SUPPORT == ENABLED)
 
+//Select the SHA extensions when the compiler targets them
+#if (SHA1_HW_ACCEL_SUPPORT == ENABLED && defined(__GNUC__) && \
+   defined(__SHA__) && defined(__SSE4_1__))
+   #include <immintrin.h>
+   #define SHA1_X86_SHA_EXT
+#elif (SHA1_HW_ACCEL_SUPPORT == ENABLED && defined(__GNUC__) && \
+   defined(__aarch64__) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO)))
+   #include <arm_neon.h>
+   #define SHA1_ARM_SHA_EXT
+#endif
+
 //Macro to access the circular buffer
-#define MASK(t) ((t) & 0x0F)
+#define W(t) w[(t) & 0x0F]
 
 //SHA-1 auxiliary functions
-#define CH(x, y, z) (((x) & (y)) | (~(x) & (z)))
+#define CH(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
 #define PARITY(x, y, z) ((x) ^ (y) ^ (z))
-#define MAJ(x, y, z) (((x) & (y)) | ((x) & (z)) | ((y) & (z)))
+#define MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
+
+//Message schedule (alternate method, computed in the 16-word circular buffer)
+#define SCHEDULE(t) (W(t) = ROL32(W((t) + 13) ^ W((t) + 8) ^ W((t) + 2) ^ W(t), 1))
+
+//SHA-1 round (the working registers are renamed rather than moved)
+#define ROUND(a, b, c, d, e, f, k, x) \
+   e += ROL32(a, 5) + f(b, c, d) + (k) + (x); \
+   b = ROL32(b, 30)
 
 //SHA-1 padding
 static const uint8_t padding[64] =
@@ -146,11 +165,33 @@ void sha1Init(Sha1Context *context)
 
 void sha1Update(Sha1Context *context, const void *data, size_t length)
 {
+   size_t n;
+
    //Process the incoming data
    while(length > 0)
    {
+      //Complete blocks can be processed without being copied to the buffer
+      if(context->size == 0 && length >= 64)
+      {
+         //Number of bytes that form complete blocks
+         n = length - (length % 64);
+
+         //Transform the blocks directly from the input
+         sha1ProcessBlocks(context, data, n / 64);
+
+         //Update the SHA-1 context
+         context->totalSize += n;
+         //Advance the data pointer
+         data = (uint8_t *) data + n;
+         //Remaining bytes to process
+         length -= n;
+
+         //Process the remaining bytes, if any
+         continue;
+      }
+
       //The buffer can hold at most 64 bytes
-      size_t n = min(length, 64 - context->size);
+      n = min(length, 64 - context->size);
 
       //Copy the data to the buffer
       memcpy(context->buffer + context->size, data, n);
@@ -219,58 +260,263 @@ void sha1Final(Sha1Context *context, uint8_t *digest)
 
 void sha1ProcessBlock(Sha1Context *context)
 {
-   uint_t s;
-   uint_t t;
-   uint32_t temp;
+   //Transform the block held in the buffer
+   sha1ProcessBlocks(context, context->buffer, 1);
+}
+
+
+#if defined(SHA1_X86_SHA_EXT)
+
+/**
+ * @brief Process consecutive message blocks (Intel SHA extensions)
+ * @param[in] context Pointer to the SHA-1 context
+ * @param[in] data Pointer to the first block
+ * @param[in] n Number of 64-byte blocks to process
+ **/
 
-   //Initialize the 5 working registers
-   uint32_t a = context->h[0];
-   uint32_t b = context->h[1];
-   uint32_t c = context->h[2];
-   uint32_t d = context->h[3];
-   uint32_t e = context->h[4];
+void sha1ProcessBlocks(Sha1Context *context, const uint8_t *data, size_t n)
+{
+   uint_t i;
+   __m128i m[4];
+   __m128i e[2];
+   __m128i abcd;
+   __m128i abcdSave;
+   __m128i eSave;
+   __m128i mask;
+
+   //Byte shuffle that converts the big-endian message to the word order
+   //expected by the SHA-1 instructions
+   mask = _mm_set_epi64x(0x0001020304050607ULL, 0x08090A0B0C0D0E0FULL);
+
+   //Load the current hash value
+   abcd = _mm_shuffle_epi32(_mm_loadu_si128((__m128i *) context->h), 0x1B);
+   e[0] = _mm_set_epi32(context->h[4], 0, 0, 0);
 
    //Process message in 16-word blocks
-   uint32_t *w = context->w;
+   while(n > 0)
+   {
+      //Save current hash value
+      abcdSave = abcd;
+      eSave = e[0];
+
+      //Load the 16 message words
+      for(i = 0; i < 4; i++)
+         m[i] = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *) (data + 16 * i)), mask);
+
+      //Each iteration performs 4 rounds
+      for(i = 0; i < 20; i++)
+      {
+         //Compute E + W for the next 4 rounds
+         if(i == 0)
+            e[0] = _mm_add_epi32(e[0], m[0]);
+         else
+            e[i & 1] = _mm_sha1nexte_epu32(e[i & 1], m[i & 3]);
+
+         //Save A, which gives the next value of E
+         e[(i + 1) & 1] = abcd;
+
+         //Finalize the message words used by the next 4 rounds
+         if(i >= 3 && i <= 18)
+            m[(i + 1) & 3] = _mm_sha1msg2_epu32(m[(i + 1) & 3], m[i & 3]);
+
+         //Perform 4 rounds
+         if(i < 5)
+            abcd = _mm_sha1rnds4_epu32(abcd, e[i & 1], 0);
+         else if(i < 10)
+            abcd = _mm_sha1rnds4_epu32(abcd, e[i & 1], 1);
+         else if(i < 15)
+            abcd = _mm_sha1rnds4_epu32(abcd, e[i & 1], 2);
+         else
+            abcd = _mm_sha1rnds4_epu32(abcd, e[i & 1], 3);
+
+         //Start computing the message words used 12 rounds later
+         if(i >= 1 && i <= 16)
+            m[(i + 3) & 3] = _mm_sha1msg1_epu32(m[(i + 3) & 3], m[i & 3]);
+         if(i >= 2 && i <= 17)
+            m[(i + 2) & 3] = _mm_xor_si128(m[(i + 2) & 3], m[i & 3]);
+      }
+
+      //Update the hash value
+      e[0] = _mm_sha1nexte_epu32(e[0], eSave);
+      abcd = _mm_add_epi32(abcd, abcdSave);
+
+      //Next block
+      data += 64;
+      n--;
+   }
+
+   //Save the resulting hash value
+   _mm_storeu_si128((__m128i *) context->h, _mm_shuffle_epi32(abcd, 0x1B));
+   context->h[4] = _mm_extract_epi32(e[0], 3);
+}
+
+#elif defined(SHA1_ARM_SHA_EXT)
+
+/**
+ * @brief Process consecutive message blocks (ARMv8 cryptographic extension)
+ * @param[in] context Pointer to the SHA-1 context
+ * @param[in] data Pointer to the first block
+ * @param[in] n Number of 64-byte blocks to process
+ **/
 
-   //Convert from big-endian byte order to host byte order
-   for(t = 0; t < 16; t++)
-      w[t] = betoh32(w[t]);
+void sha1ProcessBlocks(Sha1Context *context, const uint8_t *data, size_t n)
+{
+   uint_t i;
+   uint32x4_t m[4];
+   uint32x4_t temp;
+   uint32x4_t abcd;
+   uint32x4_t abcdSave;
+   uint32_t e;
+   uint32_t eNext;
+   uint32_t eSave;
+
+   //Load the current hash value
+   abcd = vld1q_u32(context->h);
+   e = context->h[4];
 
-   //SHA-1 hash computation (alternate method)
-   for(t = 0; t < 80; t++)
+   //Process message in 16-word blocks
+   while(n > 0)
    {
-      //Current index in the circular buffer
-      s = MASK(t);
-
-      //The alternate method requires preprocessing
-      if(t >= 16)
-         w[s] = ROL32(w[MASK(s + 13)] ^ w[MASK(s + 8)] ^ w[MASK(s + 2)] ^ w[s], 1);
-
-      //Calculate T
-      if(t < 20)
-         temp = ROL32(a, 5) + CH(b, c, d) + e + w[s] + k[0];
-      else if(t < 40)
-         temp = ROL32(a, 5) + PARITY(b, c, d) + e + w[s] + k[1];
-      else if(t < 60)
-         temp = ROL32(a, 5) + MAJ(b, c, d) + e + w[s] + k[2];
-      else
-         temp = ROL32(a, 5) + PARITY(b, c, d) + e + w[s] + k[3];
-
-      //Update the working registers
-      e = d;
-      d = c;
-      c = ROL32(b, 30);
-      b = a;
-      a = temp;
+      //Save current hash value
+      abcdSave = abcd;
+      eSave = e;
+
+      //Load the 16 message words
+      for(i = 0; i < 4; i++)
+         m[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+
+      //Each iteration performs 4 rounds
+      for(i = 0; i < 20; i++)
+      {
+         //Add the round constant
+         temp = vaddq_u32(m[i & 3], vdupq_n_u32(k[i / 5]));
+         //Value of E for the next 4 rounds
+         eNext = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+
+         //Perform 4 rounds
+         if(i < 5)
+            abcd = vsha1cq_u32(abcd, e, temp);
+         else if(i >= 10 && i < 15)
+            abcd = vsha1mq_u32(abcd, e, temp);
+         else
+            abcd = vsha1pq_u32(abcd, e, temp);
+
+         //Update E
+         e = eNext;
+
+         //Compute the message words used 16 rounds later
+         if(i < 16)
+            m[i & 3] = vsha1su1q_u32(vsha1su0q_u32(m[i & 3], m[(i + 1) & 3],
+               m[(i + 2) & 3]), m[(i + 3) & 3]);
+      }
+
+      //Update the hash value
+      abcd = vaddq_u32(abcd, abcdSave);
+      e += eSave;
+
+      //Next block
+      data += 64;
+      n--;
    }
 
-   //Update the hash value
-   context->h[0] += a;
-   context->h[1] += b;
-   context->h[2] += c;
-   context->h[3] += d;
-   context->h[4] += e;
+   //Save the resulting hash value
+   vst1q_u32(context->h, abcd);
+   context->h[4] = e;
+}
+
+#else
+
+/**
+ * @brief Process consecutive message blocks
+ * @param[in] context Pointer to the SHA-1 context
+ * @param[in] data Pointer to the first block
+ * @param[in] n Number of 64-byte blocks to process
+ **/
+
+void sha1ProcessBlocks(Sha1Context *context, const uint8_t *data, size_t n)
+{
+   uint_t t;
+   uint32_t a;
+   uint32_t b;
+   uint32_t c;
+   uint32_t d;
+   uint32_t e;
+   uint32_t w[16];
+
+   //Process message in 16-word blocks
+   while(n > 0)
+   {
+      //Initialize the 5 working registers
+      a = context->h[0];
+      b = context->h[1];
+      c = context->h[2];
+      d = context->h[3];
+      e = context->h[4];
+
+      //Convert from big-endian byte order to host byte order
+      for(t = 0; t < 16; t++)
+         w[t] = LOAD32BE(data + 4 * t);
+
+      //Rounds 0 to 14 use the message words directly
+      for(t = 0; t < 15; t += 5)
+      {
+         ROUND(a, b, c, d, e, CH, k[0], W(t));
+         ROUND(e, a, b, c, d, CH, k[0], W(t + 1));
+         ROUND(d, e, a, b, c, CH, k[0], W(t + 2));
+         ROUND(c, d, e, a, b, CH, k[0], W(t + 3));
+         ROUND(b, c, d, e, a, CH, k[0], W(t + 4));
+      }
+
+      //Rounds 15 to 19
+      ROUND(a, b, c, d, e, CH, k[0], W(15));
+      ROUND(e, a, b, c, d, CH, k[0], SCHEDULE(16));
+      ROUND(d, e, a, b, c, CH, k[0], SCHEDULE(17));
+      ROUND(c, d, e, a, b, CH, k[0], SCHEDULE(18));
+      ROUND(b, c, d, e, a, CH, k[0], SCHEDULE(19));
+
+      //Rounds 20 to 39
+      for(t = 20; t < 40; t += 5)
+      {
+         ROUND(a, b, c, d, e, PARITY, k[1], SCHEDULE(t));
+         ROUND(e, a, b, c, d, PARITY, k[1], SCHEDULE(t + 1));
+         ROUND(d, e, a, b, c, PARITY, k[1], SCHEDULE(t + 2));
+         ROUND(c, d, e, a, b, PARITY, k[1], SCHEDULE(t + 3));
+         ROUND(b, c, d, e, a, PARITY, k[1], SCHEDULE(t + 4));
+      }
+
+      //Rounds 40 to 59
+      for(t = 40; t < 60; t += 5)
+      {
+         ROUND(a, b, c, d, e, MAJ, k[2], SCHEDULE(t));
+         ROUND(e, a, b, c, d, MAJ, k[2], SCHEDULE(t + 1));
+         ROUND(d, e, a, b, c, MAJ, k[2], SCHEDULE(t + 2));
+         ROUND(c, d, e, a, b, MAJ, k[2], SCHEDULE(t + 3));
+         ROUND(b, c, d, e, a, MAJ, k[2], SCHEDULE(t + 4));
+      }
+
+      //Rounds 60 to 79
+      for(t = 60; t < 80; t += 5)
+      {
+         ROUND(a, b, c, d, e, PARITY, k[3], SCHEDULE(t));
+         ROUND(e, a, b, c, d, PARITY, k[3], SCHEDULE(t + 1));
+         ROUND(d, e, a, b, c, PARITY, k[3], SCHEDULE(t + 2));
+         ROUND(c, d, e, a, b, PARITY, k[3], SCHEDULE(t + 3));
+         ROUND(b, c, d, e, a, PARITY, k[3], SCHEDULE(t + 4));
+      }
+
+      //Update the hash value
+      context->h[0] += a;
+      context->h[1] += b;
+      context->h[2] += c;
+      context->h[3] += d;
+      context->h[4] += e;
+
+      //Next block
+      data += 64;
+      n--;
+   }
 }
 
 #endif
+
+#endif
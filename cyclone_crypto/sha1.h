@@ -32,6 +32,13 @@
 //Dependencies
 #include "crypto.h"
 
+//Hardware acceleration (used only when the compiler targets SHA extensions)
+#ifndef SHA1_HW_ACCEL_SUPPORT
+   #define SHA1_HW_ACCEL_SUPPORT ENABLED
+#elif (SHA1_HW_ACCEL_SUPPORT != ENABLED && SHA1_HW_ACCEL_SUPPORT != DISABLED)
+   #error SHA1_HW_ACCEL_SUPPORT parameter is invalid
+#endif
+
 //SHA-1 block size
 #define SHA1_BLOCK_SIZE 64
 //SHA-1 digest size
@@ -70,5 +77,6 @@ void sha1Init(Sha1Context *context);
 void sha1Update(Sha1Context *context, const void *data, size_t length);
 void sha1Final(Sha1Context *context, uint8_t *digest);
 void sha1ProcessBlock(Sha1Context *context);
+void sha1ProcessBlocks(Sha1Context *context, const uint8_t *data, size_t n);
 
 #endif
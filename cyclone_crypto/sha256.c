@@ -42,14 +42,37 @@
 //Check crypto library configuration
 #if (SHA224_SUPPORT == ENABLED || SHA256_SUPPORT == ENABLED)
 
+//Select the SHA extensions when the compiler targets them
+#if (SHA256_HW_ACCEL_SUPPORT == ENABLED && defined(__GNUC__) && \
+   defined(__SHA__) && defined(__SSE4_1__))
+   #include <immintrin.h>
+   #define SHA256_X86_SHA_EXT
+#elif (SHA256_HW_ACCEL_SUPPORT == ENABLED && defined(__GNUC__) && \
+   defined(__aarch64__) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO)))
+   #include <arm_neon.h>
+   #define SHA256_ARM_SHA_EXT
+#endif
+
+//Macro to access the circular buffer
+#define W(t) w[(t) & 0x0F]
+
 //SHA-256 auxiliary functions
-#define CH(x, y, z) (((x) & (y)) | (~(x) & (z)))
-#define MAJ(x, y, z) (((x) & (y)) | ((x) & (z)) | ((y) & (z)))
+#define CH(x, y, z) ((z) ^ ((x) & ((y) ^ (z))))
+#define MAJ(x, y, z) (((x) & (y)) | ((z) & ((x) | (y))))
 #define SIGMA1(x) (ROR32(x, 2) ^ ROR32(x, 13) ^ ROR32(x, 22))
 #define SIGMA2(x) (ROR32(x, 6) ^ ROR32(x, 11) ^ ROR32(x, 25))
 #define SIGMA3(x) (ROR32(x, 7) ^ ROR32(x, 18) ^ SHR32(x, 3))
 #define SIGMA4(x) (ROR32(x, 17) ^ ROR32(x, 19) ^ SHR32(x, 10))
 
+//Message schedule (computed in place in the 16-word circular buffer)
+#define SCHEDULE(t) (W(t) += SIGMA4(W((t) + 14)) + W((t) + 9) + SIGMA3(W((t) + 1)))
+
+//SHA-256 round (the working registers are renamed rather than moved)
+#define ROUND(a, b, c, d, e, f, g, h, t, x) \
+   h += SIGMA2(e) + CH(e, f, g) + k[t] + (x); \
+   d += h; \
+   h += SIGMA1(a) + MAJ(a, b, c)
+
 //SHA-256 padding
 static const uint8_t padding[64] =
 {
@@ -153,11 +176,33 @@ void sha256Init(Sha256Context *context)
 
 void sha256Update(Sha256Context *context, const void *data, size_t length)
 {
+   size_t n;
+
    //Process the incoming data
    while(length > 0)
    {
+      //Complete blocks can be processed without being copied to the buffer
+      if(context->size == 0 && length >= 64)
+      {
+         //Number of bytes that form complete blocks
+         n = length - (length % 64);
+
+         //Transform the blocks directly from the input
+         sha256ProcessBlocks(context, data, n / 64);
+
+         //Update the SHA-256 context
+         context->totalSize += n;
+         //Advance the data pointer
+         data = (uint8_t *) data + n;
+         //Remaining bytes to process
+         length -= n;
+
+         //Process the remaining bytes, if any
+         continue;
+      }
+
       //The buffer can hold at most 64 bytes
-      size_t n = min(length, 64 - context->size);
+      n = min(length, 64 - context->size);
 
       //Copy the data to the buffer
       memcpy(context->buffer + context->size, data, n);
@@ -226,58 +271,233 @@ void sha256Final(Sha256Context *context, uint8_t *digest)
 
 void sha256ProcessBlock(Sha256Context *context)
 {
-   uint_t t;
-   uint32_t temp1;
-   uint32_t temp2;
-
-   //Initialize the 8 working registers
-   uint32_t a = context->h[0];
-   uint32_t b = context->h[1];
-   uint32_t c = context->h[2];
-   uint32_t d = context->h[3];
-   uint32_t e = context->h[4];
-   uint32_t f = context->h[5];
-   uint32_t g = context->h[6];
-   uint32_t h = context->h[7];
+   //Transform the block held in the buffer
+   sha256ProcessBlocks(context, context->buffer, 1);
+}
+
+
+#if defined(SHA256_X86_SHA_EXT)
+
+/**
+ * @brief Process consecutive message blocks (Intel SHA extensions)
+ * @param[in] context Pointer to the SHA-256 context
+ * @param[in] data Pointer to the first block
+ * @param[in] n Number of 64-byte blocks to process
+ **/
+
+void sha256ProcessBlocks(Sha256Context *context, const uint8_t *data, size_t n)
+{
+   uint_t i;
+   __m128i m[4];
+   __m128i temp;
+   __m128i state0;
+   __m128i state1;
+   __m128i abefSave;
+   __m128i cdghSave;
+   __m128i mask;
+
+   //Byte shuffle that converts big-endian words to host byte order
+   mask = _mm_set_epi64x(0x0C0D0E0F08090A0BULL, 0x0405060700010203ULL);
+
+   //The SHA-256 instructions expect the state as ABEF and CDGH
+   temp = _mm_shuffle_epi32(_mm_loadu_si128((__m128i *) &context->h[0]), 0xB1);
+   state1 = _mm_shuffle_epi32(_mm_loadu_si128((__m128i *) &context->h[4]), 0x1B);
+   state0 = _mm_alignr_epi8(temp, state1, 8);
+   state1 = _mm_blend_epi16(state1, temp, 0xF0);
 
    //Process message in 16-word blocks
-   uint32_t *w = context->w;
+   while(n > 0)
+   {
+      //Save current hash value
+      abefSave = state0;
+      cdghSave = state1;
+
+      //Each iteration performs 4 rounds
+      for(i = 0; i < 16; i++)
+      {
+         //The first 16 words come from the message
+         if(i < 4)
+            m[i] = _mm_shuffle_epi8(_mm_loadu_si128((__m128i *) (data + 16 * i)), mask);
+         //The subsequent words are computed from the message schedule
+         else
+            m[i & 3] = _mm_sha256msg2_epu32(_mm_add_epi32(_mm_sha256msg1_epu32(m[i & 3],
+               m[(i + 1) & 3]), _mm_alignr_epi8(m[(i + 3) & 3], m[(i + 2) & 3], 4)), m[(i + 3) & 3]);
+
+         //Add the round constants
+         temp = _mm_add_epi32(m[i & 3], _mm_loadu_si128((__m128i *) &k[4 * i]));
+
+         //Perform 4 rounds
+         state1 = _mm_sha256rnds2_epu32(state1, state0, temp);
+         temp = _mm_shuffle_epi32(temp, 0x0E);
+         state0 = _mm_sha256rnds2_epu32(state0, state1, temp);
+      }
+
+      //Update the hash value
+      state0 = _mm_add_epi32(state0, abefSave);
+      state1 = _mm_add_epi32(state1, cdghSave);
+
+      //Next block
+      data += 64;
+      n--;
+   }
+
+   //Restore the word order of the state
+   temp = _mm_shuffle_epi32(state0, 0x1B);
+   state1 = _mm_shuffle_epi32(state1, 0xB1);
+   state0 = _mm_blend_epi16(temp, state1, 0xF0);
+   state1 = _mm_alignr_epi8(state1, temp, 8);
+
+   //Save the resulting hash value
+   _mm_storeu_si128((__m128i *) &context->h[0], state0);
+   _mm_storeu_si128((__m128i *) &context->h[4], state1);
+}
 
-   //Convert from big-endian byte order to host byte order
-   for(t = 0; t < 16; t++)
-      w[t] = betoh32(w[t]);
+#elif defined(SHA256_ARM_SHA_EXT)
 
-   //Prepare the message schedule
-   for(t = 16; t < 64; t++)
-      w[t] = SIGMA4(w[t - 2]) + w[t - 7] + SIGMA3(w[t - 15]) + w[t - 16];
+/**
+ * @brief Process consecutive message blocks (ARMv8 cryptographic extension)
+ * @param[in] context Pointer to the SHA-256 context
+ * @param[in] data Pointer to the first block
+ * @param[in] n Number of 64-byte blocks to process
+ **/
 
-   //SHA-256 hash computation
-   for(t = 0; t < 64; t++)
+void sha256ProcessBlocks(Sha256Context *context, const uint8_t *data, size_t n)
+{
+   uint_t i;
+   uint32x4_t m[4];
+   uint32x4_t temp;
+   uint32x4_t abcd;
+   uint32x4_t state0;
+   uint32x4_t state1;
+   uint32x4_t abcdSave;
+   uint32x4_t efghSave;
+
+   //Load the current hash value
+   state0 = vld1q_u32(&context->h[0]);
+   state1 = vld1q_u32(&context->h[4]);
+
+   //Process message in 16-word blocks
+   while(n > 0)
    {
-      //Calculate T1 and T2
-      temp1 = h + SIGMA2(e) + CH(e, f, g) + k[t] + w[t];
-      temp2 = SIGMA1(a) + MAJ(a, b, c);
-
-      //Update the working registers
-      h = g;
-      g = f;
-      f = e;
-      e = d + temp1;
-      d = c;
-      c = b;
-      b = a;
-      a = temp1 + temp2;
+      //Save current hash value
+      abcdSave = state0;
+      efghSave = state1;
+
+      //Each iteration performs 4 rounds
+      for(i = 0; i < 16; i++)
+      {
+         //The first 16 words come from the message
+         if(i < 4)
+            m[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(data + 16 * i)));
+         //The subsequent words are computed from the message schedule
+         else
+            m[i & 3] = vsha256su1q_u32(vsha256su0q_u32(m[i & 3], m[(i + 1) & 3]),
+               m[(i + 2) & 3], m[(i + 3) & 3]);
+
+         //Add the round constants
+         temp = vaddq_u32(m[i & 3], vld1q_u32(&k[4 * i]));
+
+         //Perform 4 rounds
+         abcd = state0;
+         state0 = vsha256hq_u32(state0, state1, temp);
+         state1 = vsha256h2q_u32(state1, abcd, temp);
+      }
+
+      //Update the hash value
+      state0 = vaddq_u32(state0, abcdSave);
+      state1 = vaddq_u32(state1, efghSave);
+
+      //Next block
+      data += 64;
+      n--;
    }
 
-   //Update the hash value
-   context->h[0] += a;
-   context->h[1] += b;
-   context->h[2] += c;
-   context->h[3] += d;
-   context->h[4] += e;
-   context->h[5] += f;
-   context->h[6] += g;
-   context->h[7] += h;
+   //Save the resulting hash value
+   vst1q_u32(&context->h[0], state0);
+   vst1q_u32(&context->h[4], state1);
 }
 
+#else
+
+/**
+ * @brief Process consecutive message blocks
+ * @param[in] context Pointer to the SHA-256 context
+ * @param[in] data Pointer to the first block
+ * @param[in] n Number of 64-byte blocks to process
+ **/
+
+void sha256ProcessBlocks(Sha256Context *context, const uint8_t *data, size_t n)
+{
+   uint_t t;
+   uint32_t a;
+   uint32_t b;
+   uint32_t c;
+   uint32_t d;
+   uint32_t e;
+   uint32_t f;
+   uint32_t g;
+   uint32_t h;
+   uint32_t w[16];
+
+   //Process message in 16-word blocks
+   while(n > 0)
+   {
+      //Initialize the 8 working registers
+      a = context->h[0];
+      b = context->h[1];
+      c = context->h[2];
+      d = context->h[3];
+      e = context->h[4];
+      f = context->h[5];
+      g = context->h[6];
+      h = context->h[7];
+
+      //Convert from big-endian byte order to host byte order
+      for(t = 0; t < 16; t++)
+         w[t] = LOAD32BE(data + 4 * t);
+
+      //The first 16 rounds use the message words directly
+      for(t = 0; t < 16; t += 8)
+      {
+         ROUND(a, b, c, d, e, f, g, h, t, W(t));
+         ROUND(h, a, b, c, d, e, f, g, t + 1, W(t + 1));
+         ROUND(g, h, a, b, c, d, e, f, t + 2, W(t + 2));
+         ROUND(f, g, h, a, b, c, d, e, t + 3, W(t + 3));
+         ROUND(e, f, g, h, a, b, c, d, t + 4, W(t + 4));
+         ROUND(d, e, f, g, h, a, b, c, t + 5, W(t + 5));
+         ROUND(c, d, e, f, g, h, a, b, t + 6, W(t + 6));
+         ROUND(b, c, d, e, f, g, h, a, t + 7, W(t + 7));
+      }
+
+      //The remaining rounds expand the message schedule on the fly
+      for(t = 16; t < 64; t += 8)
+      {
+         ROUND(a, b, c, d, e, f, g, h, t, SCHEDULE(t));
+         ROUND(h, a, b, c, d, e, f, g, t + 1, SCHEDULE(t + 1));
+         ROUND(g, h, a, b, c, d, e, f, t + 2, SCHEDULE(t + 2));
+         ROUND(f, g, h, a, b, c, d, e, t + 3, SCHEDULE(t + 3));
+         ROUND(e, f, g, h, a, b, c, d, t + 4, SCHEDULE(t + 4));
+         ROUND(d, e, f, g, h, a, b, c, t + 5, SCHEDULE(t + 5));
+         ROUND(c, d, e, f, g, h, a, b, t + 6, SCHEDULE(t + 6));
+         ROUND(b, c, d, e, f, g, h, a, t + 7, SCHEDULE(t + 7));
+      }
+
+      //Update the hash value
+      context->h[0] += a;
+      context->h[1] += b;
+      context->h[2] += c;
+      context->h[3] += d;
+      context->h[4] += e;
+      context->h[5] += f;
+      context->h[6] += g;
+      context->h[7] += h;
+
+      //Next block
+      data += 64;
+      n--;
+   }
+}
+
+#endif
+
 #endif
@@ -32,6 +32,13 @@
 //Dependencies
 #include "crypto.h"
 
+//Hardware acceleration (used only when the compiler targets SHA extensions)
+#ifndef SHA256_HW_ACCEL_SUPPORT
+   #define SHA256_HW_ACCEL_SUPPORT ENABLED
+#elif (SHA256_HW_ACCEL_SUPPORT != ENABLED && SHA256_HW_ACCEL_SUPPORT != DISABLED)
+   #error SHA256_HW_ACCEL_SUPPORT parameter is invalid
+#endif
+
 //SHA-256 block size
 #define SHA256_BLOCK_SIZE 64
 //SHA-256 digest size
@@ -53,7 +60,7 @@ typedef struct
    };
    union
    {
-      uint32_t w[64];
+      uint32_t w[16];
       uint8_t buffer[64];
    };
    size_t size;
@@ -70,5 +77,6 @@ void sha256Init(Sha256Context *context);
 void sha256Update(Sha256Context *context, const void *data, size_t length);
 void sha256Final(Sha256Context *context, uint8_t *digest);
 void sha256ProcessBlock(Sha256Context *context);
+void sha256ProcessBlocks(Sha256Context *context, const uint8_t *data, size_t n);
 
 #endif
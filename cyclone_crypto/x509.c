@@ -36,6 +36,7 @@
 #include "asn1.h"
 #include "rsa.h"
 #include "dsa.h"
+#include "ecdsa.h"
 #include "md5.h"
 #include "sha1.h"
 #include "sha224.h"
@@ -161,6 +162,70 @@ error_t x509ParseCertificate(const uint8_t *data, size_t length,
 }
 
 
+/**
+ * @brief Locate the subject name of a X.509 certificate
+ *
+ * Only the fields that precede the Subject are walked through, so that
+ * a candidate issuer can be discarded without parsing the whole certificate
+ *
+ * @param[in] data Pointer to the X.509 certificate
+ * @param[in] length Length of the X.509 certificate
+ * @param[out] subject Raw ASN.1 sequence of the subject name
+ * @return Error code
+ **/
+
+error_t x509ReadSubjectName(const uint8_t *data, size_t length, X509Name *subject)
+{
+   error_t error;
+   uint_t i;
+   size_t n;
+   Asn1Tag tag;
+
+   //Clear the name structure
+   memset(subject, 0, sizeof(X509Name));
+
+   //Read the contents of the certificate
+   error = asn1ReadTag(data, length, &tag);
+   //Failed to decode ASN.1 tag?
+   if(error) return ERROR_BAD_CERTIFICATE;
+
+   //Read the contents of the TBSCertificate structure
+   error = asn1ReadTag(tag.value, tag.length, &tag);
+   //Failed to decode ASN.1 tag?
+   if(error) return ERROR_BAD_CERTIFICATE;
+
+   //Point to the very first field of the TBSCertificate
+   data = tag.value;
+   length = tag.length;
+
+   //Skip the Version (optional), SerialNumber, Signature, Issuer
+   //and Validity fields
+   for(i = 0; i < 5; i++)
+   {
+      //Read current field
+      error = asn1ReadTag(data, length, &tag);
+      //Failed to decode ASN.1 tag?
+      if(error) return ERROR_BAD_CERTIFICATE;
+
+      //The Version field is absent in X.509v1 certificates
+      if(i == 0 && asn1CheckTag(&tag, TRUE, ASN1_CLASS_CONTEXT_SPECIFIC, 0))
+         continue;
+
+      //Point to the next field
+      data += tag.totalLength;
+      length -= tag.totalLength;
+   }
+
+   //Read Subject field
+   error = x509ParseName(data, length, &n, subject);
+   //Any error to report?
+   if(error) return ERROR_BAD_CERTIFICATE;
+
+   //Subject name successfully located
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Parse TBSCertificate structure
  * @param[in] data Pointer to the ASN.1 structure to parse
@@ -446,8 +511,6 @@ error_t x509ParseName(const uint8_t *data, size_t length,
 {
    error_t error;
    Asn1Tag tag;
-   Asn1Tag attrType;
-   Asn1Tag attrValue;
 
    //Debug message
    TRACE_DEBUG("    Parsing Name...\r\n");
@@ -469,6 +532,32 @@ error_t x509ParseName(const uint8_t *data, size_t length,
    //The tag does not match the criteria?
    if(error) return error;
 
+   //Names are compared in their DER form. The individual attributes are
+   //only decoded on demand by calling x509ParseNameAttributes
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Decode the attributes of a Name structure
+ * @param[in,out] name Name whose raw ASN.1 sequence has already been located
+ * @return Error code
+ **/
+
+error_t x509ParseNameAttributes(X509Name *name)
+{
+   error_t error;
+   const uint8_t *data;
+   size_t length;
+   Asn1Tag tag;
+   Asn1Tag attrType;
+   Asn1Tag attrValue;
+
+   //Read the contents of the Name structure
+   error = asn1ReadTag(name->rawData, name->rawDataLen, &tag);
+   //Failed to decode ASN.1 tag?
+   if(error) return error;
+
    //The Name describes a hierarchical name composed of attributes
    data = tag.value;
    length = tag.length;
@@ -815,6 +904,34 @@ error_t x509ParseSubjectPublicKeyInfo(const uint8_t *data, size_t length,
       //Any error to report?
       if(error) return error;
    }
+   //EC public key identifier?
+   else if(!asn1CheckOid(&tag, EC_PUBLIC_KEY_OID, sizeof(EC_PUBLIC_KEY_OID)))
+   {
+      //Read the ECParameters structure
+      error = x509ParseEcParameters(p, n, certInfo);
+      //Any error to report?
+      if(error) return error;
+
+      //Read the contents of the SubjectPublicKey field
+      error = asn1ReadTag(data, length, &tag);
+      //Failed to decode ASN.1 tag?
+      if(error) return error;
+
+      //The ECPoint is encapsulated within a bit string
+      error = asn1CheckTag(&tag, FALSE, ASN1_CLASS_UNIVERSAL, ASN1_TYPE_BIT_STRING);
+      //The tag does not match the criteria?
+      if(error) return error;
+
+      //The bit string shall contain an initial octet which encodes
+      //the number of unused bits in the final subsequent octet
+      if(tag.length < 1 || tag.value[0] != 0x00)
+         return ERROR_FAILURE;
+
+      //Read ECPoint structure
+      error = x509ParseEcPublicKey(tag.value + 1, tag.length - 1, certInfo);
+      //Any error to report?
+      if(error) return error;
+   }
 
    //No error to report
    return NO_ERROR;
@@ -1011,6 +1128,69 @@ error_t x509ParseDsaPublicKey(const uint8_t *data,
 }
 
 
+/**
+ * @brief Parse ECParameters structure
+ * @param[in] data Pointer to the ASN.1 structure to parse
+ * @param[in] length Length of the ASN.1 structure
+ * @param[out] certInfo Information resulting from the parsing process
+ * @return Error code
+ **/
+
+error_t x509ParseEcParameters(const uint8_t *data,
+   size_t length, X509CertificateInfo *certInfo)
+{
+   error_t error;
+   Asn1Tag tag;
+
+   //Debug message
+   TRACE_DEBUG("      Parsing ECParameters...\r\n");
+
+   //Read namedCurve field
+   error = asn1ReadTag(data, length, &tag);
+   //Failed to decode ASN.1 tag?
+   if(error) return error;
+
+   //Only named curves are supported (RFC 5480, section 2.1.1)
+   error = asn1CheckTag(&tag, FALSE, ASN1_CLASS_UNIVERSAL, ASN1_TYPE_OBJECT_IDENTIFIER);
+   //The tag does not match the criteria?
+   if(error) return error;
+
+   //Save the curve identifier
+   certInfo->subjectPublicKey.namedCurve = tag.value;
+   certInfo->subjectPublicKey.namedCurveLen = tag.length;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse ECPoint structure
+ * @param[in] data Pointer to the ASN.1 structure to parse
+ * @param[in] length Length of the ASN.1 structure
+ * @param[out] certInfo Information resulting from the parsing process
+ * @return Error code
+ **/
+
+error_t x509ParseEcPublicKey(const uint8_t *data,
+   size_t length, X509CertificateInfo *certInfo)
+{
+   //Debug message
+   TRACE_DEBUG("      Parsing ECPoint...\r\n");
+
+   //The ECPoint is mapped directly to the contents of the bit string
+   if(length == 0)
+      return ERROR_FAILURE;
+
+   //Save the EC public key
+   certInfo->subjectPublicKey.ecPoint = data;
+   certInfo->subjectPublicKey.ecPointLen = length;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Parse IssuerUniqueID structure
  * @param[in] data Pointer to the ASN.1 structure to parse
@@ -1483,8 +1663,8 @@ error_t x509ReadRsaPublicKey(const X509CertificateInfo *certInfo, RsaPublicKey *
    TRACE_DEBUG("  Public exponent:\r\n");
    TRACE_DEBUG_MPI("    ", &key->e);
 
-   //Successful processing
-   return NO_ERROR;
+   //Precompute the Montgomery context of the modulus
+   return rsaPrecomputePublicKey(key);
 }
 
 
@@ -1538,6 +1718,55 @@ error_t x509ReadDsaPublicKey(const X509CertificateInfo *certInfo, DsaPublicKey *
    TRACE_DEBUG("  Public value y:\r\n");
    TRACE_DEBUG_MPI("    ", &key->y);
 
+   //Precompute the Montgomery context of p
+   return dsaPrecomputePublicKey(key);
+}
+
+
+/**
+ * @brief Read an EC public key
+ * @param[in] certInfo X.509 certificate
+ * @param[out] params EC domain parameters
+ * @param[out] publicKey EC public key
+ * @return Error code
+ **/
+
+error_t x509ReadEcPublicKey(const X509CertificateInfo *certInfo,
+   EcDomainParameters *params, EcPoint *publicKey)
+{
+   error_t error;
+   const EcCurveInfo *curveInfo;
+
+   //The certificate shall contain a valid EC public key
+   if(!certInfo->subjectPublicKey.namedCurve || !certInfo->subjectPublicKey.ecPoint)
+      return ERROR_INVALID_KEY;
+
+   //Retrieve the elliptic curve that has been used to generate the key
+   curveInfo = ecGetCurveInfo(certInfo->subjectPublicKey.namedCurve,
+      certInfo->subjectPublicKey.namedCurveLen);
+
+   //Make sure the specified elliptic curve is supported
+   if(curveInfo == NULL || curveInfo->type != EC_CURVE_TYPE_PRIME)
+      return ERROR_BAD_CERTIFICATE;
+
+   //Load EC domain parameters
+   error = ecLoadDomainParameters(params, curveInfo);
+   //Any error to report?
+   if(error) return error;
+
+   //Retrieve the EC public key
+   error = ecImport(params, publicKey, certInfo->subjectPublicKey.ecPoint,
+      certInfo->subjectPublicKey.ecPointLen);
+   //Any error to report?
+   if(error) return error;
+
+   //Debug message
+   TRACE_DEBUG("EC public key (%s):\r\n", curveInfo->name);
+   TRACE_DEBUG("  X:\r\n");
+   TRACE_DEBUG_MPI("    ", &publicKey->x);
+   TRACE_DEBUG("  Y:\r\n");
+   TRACE_DEBUG_MPI("    ", &publicKey->y);
+
    //Successful processing
    return NO_ERROR;
 }
@@ -1557,9 +1786,10 @@ error_t x509ValidateCertificate(const X509CertificateInfo *certInfo,
    const HashAlgo *hashAlgo;
    HashContext *hashContext;
 
-   //Use RSA or DSA signature algorithm?
+   //Use RSA, DSA or ECDSA signature algorithm?
    bool_t rsaSignAlgo = FALSE;
    bool_t dsaSignAlgo = FALSE;
+   bool_t ecdsaSignAlgo = FALSE;
 
    //Check the certificate validity period
    //if()
@@ -1632,6 +1862,41 @@ error_t x509ValidateCertificate(const X509CertificateInfo *certInfo,
       dsaSignAlgo = TRUE;
       hashAlgo = SHA256_HASH_ALGO;
    }
+   else if(certInfo->signatureAlgoLen == sizeof(ECDSA_WITH_SHA1_OID) &&
+      !memcmp(certInfo->signatureAlgo, ECDSA_WITH_SHA1_OID, sizeof(ECDSA_WITH_SHA1_OID)))
+   {
+      //ECDSA with SHA-1 signature algorithm
+      ecdsaSignAlgo = TRUE;
+      hashAlgo = SHA1_HASH_ALGO;
+   }
+   else if(certInfo->signatureAlgoLen == sizeof(ECDSA_WITH_SHA224_OID) &&
+      !memcmp(certInfo->signatureAlgo, ECDSA_WITH_SHA224_OID, sizeof(ECDSA_WITH_SHA224_OID)))
+   {
+      //ECDSA with SHA-224 signature algorithm
+      ecdsaSignAlgo = TRUE;
+      hashAlgo = SHA224_HASH_ALGO;
+   }
+   else if(certInfo->signatureAlgoLen == sizeof(ECDSA_WITH_SHA256_OID) &&
+      !memcmp(certInfo->signatureAlgo, ECDSA_WITH_SHA256_OID, sizeof(ECDSA_WITH_SHA256_OID)))
+   {
+      //ECDSA with SHA-256 signature algorithm
+      ecdsaSignAlgo = TRUE;
+      hashAlgo = SHA256_HASH_ALGO;
+   }
+   else if(certInfo->signatureAlgoLen == sizeof(ECDSA_WITH_SHA384_OID) &&
+      !memcmp(certInfo->signatureAlgo, ECDSA_WITH_SHA384_OID, sizeof(ECDSA_WITH_SHA384_OID)))
+   {
+      //ECDSA with SHA-384 signature algorithm
+      ecdsaSignAlgo = TRUE;
+      hashAlgo = SHA384_HASH_ALGO;
+   }
+   else if(certInfo->signatureAlgoLen == sizeof(ECDSA_WITH_SHA512_OID) &&
+      !memcmp(certInfo->signatureAlgo, ECDSA_WITH_SHA512_OID, sizeof(ECDSA_WITH_SHA512_OID)))
+   {
+      //ECDSA with SHA-512 signature algorithm
+      ecdsaSignAlgo = TRUE;
+      hashAlgo = SHA512_HASH_ALGO;
+   }
    else
    {
       //The specified signature algorithm is not supported
@@ -1702,6 +1967,43 @@ error_t x509ValidateCertificate(const X509CertificateInfo *certInfo,
       dsaFreePublicKey(&dsaPublicKey);
       dsaFreeSignature(&dsaSignature);
    }
+   else if(ecdsaSignAlgo)
+   {
+      EcDomainParameters ecParams;
+      EcPoint ecPublicKey;
+      EcdsaSignature ecdsaSignature;
+
+      //Initialize EC domain parameters
+      ecInitDomainParameters(&ecParams);
+      //Initialize EC public key
+      ecInit(&ecPublicKey);
+      //Initialize ECDSA signature
+      ecdsaInitSignature(&ecdsaSignature);
+
+      //Get the EC public key
+      error = x509ReadEcPublicKey(issuerCertInfo, &ecParams, &ecPublicKey);
+
+      //Check status code
+      if(!error)
+      {
+         //Read the ASN.1 encoded signature
+         error = ecdsaReadSignature(certInfo->signatureValue,
+            certInfo->signatureValueLen, &ecdsaSignature);
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //Verify ECDSA signature
+         error = ecdsaVerifySignature(&ecParams, &ecPublicKey,
+            hashContext->digest, hashAlgo->digestSize, &ecdsaSignature);
+      }
+
+      //Release previously allocated resources
+      ecFreeDomainParameters(&ecParams);
+      ecFree(&ecPublicKey);
+      ecdsaFreeSignature(&ecdsaSignature);
+   }
    else
    {
       //The signature algorithm is not supported...
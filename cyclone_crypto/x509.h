@@ -33,6 +33,7 @@
 #include "crypto.h"
 #include "rsa.h"
 #include "dsa.h"
+#include "ec.h"
 
 
 /**
@@ -138,6 +139,28 @@ typedef struct
 } X509DsaPublicKey;
 
 
+/**
+ * @brief EC parameters
+ **/
+
+typedef struct
+{
+   const uint8_t *namedCurve;
+   size_t namedCurveLen;
+} X509EcParameters;
+
+
+/**
+ * @brief EC public key
+ **/
+
+typedef struct
+{
+   const uint8_t *ecPoint;
+   size_t ecPointLen;
+} X509EcPublicKey;
+
+
 /**
  * @brief Subject public key
  **/
@@ -149,6 +172,8 @@ typedef struct
    X509RsaPublicKey;
    X509DsaParameters;
    X509DsaPublicKey;
+   X509EcParameters;
+   X509EcPublicKey;
 } X509SubjectPublicKey;
 
 
@@ -223,6 +248,8 @@ extern const uint8_t X509_INHIBIT_ANY_POLICY_OID[3];
 error_t x509ParseCertificate(const uint8_t *data, size_t length,
    X509CertificateInfo *certInfo);
 
+error_t x509ReadSubjectName(const uint8_t *data, size_t length, X509Name *subject);
+
 error_t x509ParseTbsCertificate(const uint8_t *data, size_t length,
    size_t *totalLength, X509CertificateInfo *certInfo);
 
@@ -238,6 +265,8 @@ error_t x509ParseSignature(const uint8_t *data, size_t length,
 error_t x509ParseName(const uint8_t *data, size_t length,
    size_t *totalLength, X509Name *name);
 
+error_t x509ParseNameAttributes(X509Name *name);
+
 error_t x509ParseValidity(const uint8_t *data, size_t length,
    size_t *totalLength, X509CertificateInfo *certInfo);
 
@@ -253,6 +282,12 @@ error_t x509ParseDsaParameters(const uint8_t *data,
 error_t x509ParseDsaPublicKey(const uint8_t *data,
    size_t length, X509CertificateInfo *certInfo);
 
+error_t x509ParseEcParameters(const uint8_t *data,
+   size_t length, X509CertificateInfo *certInfo);
+
+error_t x509ParseEcPublicKey(const uint8_t *data,
+   size_t length, X509CertificateInfo *certInfo);
+
 error_t x509ParseIssuerUniqueId(const uint8_t *data, size_t length,
    size_t *totalLength, X509CertificateInfo *certInfo);
 
@@ -274,6 +309,9 @@ error_t x509ParseSignatureValue(const uint8_t *data, size_t length,
 error_t x509ReadRsaPublicKey(const X509CertificateInfo *certInfo, RsaPublicKey *key);
 error_t x509ReadDsaPublicKey(const X509CertificateInfo *certInfo, DsaPublicKey *key);
 
+error_t x509ReadEcPublicKey(const X509CertificateInfo *certInfo,
+   EcDomainParameters *params, EcPoint *publicKey);
+
 error_t x509ValidateCertificate(const X509CertificateInfo *certInfo,
    const X509CertificateInfo *issuerCertInfo);
 
@@ -1,12 +1,22 @@
 CYCLONETCPSRC +=  $(CYCLONETCP)/cyclone_ssl/ssl_common.c \
 				 $(CYCLONETCP)/cyclone_ssl/tls.c \
+				 $(CYCLONETCP)/cyclone_ssl/tls_ca_store.c \
 				 $(CYCLONETCP)/cyclone_ssl/tls_cache.c \
+				 $(CYCLONETCP)/cyclone_ssl/tls_cert_cache.c \
 				 $(CYCLONETCP)/cyclone_ssl/tls_cipher_suites.c \
 				 $(CYCLONETCP)/cyclone_ssl/tls_client.c \
+				 $(CYCLONETCP)/cyclone_ssl/tls_client_cache.c \
 				 $(CYCLONETCP)/cyclone_ssl/tls_common.c \
 				 $(CYCLONETCP)/cyclone_ssl/tls_io.c \
 				 $(CYCLONETCP)/cyclone_ssl/tls_misc.c \
 				 $(CYCLONETCP)/cyclone_ssl/tls_record.c \
-				 $(CYCLONETCP)/cyclone_ssl/tls_server.c
+				 $(CYCLONETCP)/cyclone_ssl/tls_server.c \
+				 $(CYCLONETCP)/cyclone_ssl/tls_ticket.c \
+				 $(CYCLONETCP)/cyclone_ssl/tls_crypto_worker.c \
+				 $(CYCLONETCP)/cyclone_ssl/tls_dh_key_pool.c \
+				 $(CYCLONETCP)/cyclone_ssl/tls13_misc.c \
+				 $(CYCLONETCP)/cyclone_ssl/tls13_common.c \
+				 $(CYCLONETCP)/cyclone_ssl/tls13_client.c \
+				 $(CYCLONETCP)/cyclone_ssl/tls13_server.c
 
 CYCLONETCPINC += $(CYCLONETCP)/cyclone_ssl/
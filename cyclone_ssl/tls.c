@@ -43,7 +43,11 @@
 #include "tls_server.h"
 #include "tls_common.h"
 #include "tls_record.h"
+#include "tls_io.h"
 #include "tls_misc.h"
+#include "tls_client_cache.h"
+#include "tls13_common.h"
+#include "tls13_client.h"
 #include "x509.h"
 #include "pem.h"
 #include "bsd_socket.h"
@@ -52,6 +56,14 @@
 //Check SSL library configuration
 #if (TLS_SUPPORT == ENABLED)
 
+//Memory held by multiple precision integers and EC structures
+#define TLS_MPI_MEM_SIZE(x) ((x)->size * MPI_INT_SIZE)
+#define TLS_EC_POINT_MEM_SIZE(q) (TLS_MPI_MEM_SIZE(&(q)->x) + \
+   TLS_MPI_MEM_SIZE(&(q)->y) + TLS_MPI_MEM_SIZE(&(q)->z))
+#define TLS_EC_PARAMS_MEM_SIZE(params) (TLS_MPI_MEM_SIZE(&(params)->p) + \
+   TLS_MPI_MEM_SIZE(&(params)->a) + TLS_MPI_MEM_SIZE(&(params)->b) + \
+   TLS_EC_POINT_MEM_SIZE(&(params)->g) + TLS_MPI_MEM_SIZE(&(params)->q))
+
 
 /**
  * @brief TLS context initialization
@@ -84,14 +96,32 @@ TlsContext *tlsInit(void)
    //Default client authentication mode
    context->clientAuthMode = TLS_CLIENT_AUTH_NONE;
 
+#if (TLS_CLIENT_CACHE_SUPPORT == ENABLED)
+   //Client sessions are saved to and resumed from the default cache
+   context->clientCache = tlsDefaultClientCache;
+#endif
+
    //Initialize multiple precision integers
    dhInitParameters(&context->dhParameters);
    rsaInitPublicKey(&context->peerRsaPublicKey);
    dsaInitPublicKey(&context->peerDsaPublicKey);
 
+   //Initialize ECDH context and peer's EC public key
+   ecdhInit(&context->ecdhContext);
+   ecInitDomainParameters(&context->peerEcParams);
+   ecInit(&context->peerEcPublicKey);
+
+   //Default size of the send and receive buffers
+   context->txBufferSize = TLS_MAX_PROTOCOL_DATA_LENGTH;
+   context->rxBufferSize = TLS_MAX_PROTOCOL_DATA_LENGTH;
+
+   //No limit on the record size until otherwise negotiated
+   context->maxFragLength = TLS_MAX_RECORD_LENGTH;
+   context->recordSizeLimit = TLS_MAX_RECORD_LENGTH;
+
    //Allocate send and receive buffers
-   context->txBuffer = osMemAlloc(TLS_TX_BUFFER_SIZE);
-   context->rxBuffer = osMemAlloc(TLS_RX_BUFFER_SIZE);
+   context->txBuffer = osMemAlloc(TLS_TX_BUFFER_SIZE(context->txBufferSize));
+   context->rxBuffer = osMemAlloc(TLS_RX_BUFFER_SIZE(context->rxBufferSize));
    //Failed to allocate memory?
    if(!context->txBuffer || !context->rxBuffer)
    {
@@ -104,8 +134,8 @@ TlsContext *tlsInit(void)
    }
 
    //Clear send and receive buffers
-   memset(context->txBuffer, 0, TLS_TX_BUFFER_SIZE);
-   memset(context->rxBuffer, 0, TLS_RX_BUFFER_SIZE);
+   memset(context->txBuffer, 0, TLS_TX_BUFFER_SIZE(context->txBufferSize));
+   memset(context->rxBuffer, 0, TLS_RX_BUFFER_SIZE(context->rxBufferSize));
 
    //Return a handle to the freshly created TLS context
    return context;
@@ -184,10 +214,21 @@ error_t tlsSetPrng(TlsContext *context, const PrngAlgo *prngAlgo, void *prngCont
    if(prngAlgo == NULL || prngContext == NULL)
       return ERROR_INVALID_PARAMETER;
 
+#if (TLS_CTR_DRBG_SUPPORT == ENABLED)
+   //The application PRNG is only used to seed the private generator of
+   //the context, so that concurrent handshakes do not contend for it
+   ctrDrbgInitChild(&context->prngChild, prngAlgo, prngContext);
+
+   //PRNG algorithm that will be used to generate random numbers
+   context->prngAlgo = CTR_DRBG_PRNG_ALGO;
+   //PRNG context
+   context->prngContext = &context->prngChild;
+#else
    //PRNG algorithm that will be used to generate random numbers
    context->prngAlgo = prngAlgo;
    //PRNG context
    context->prngContext = prngContext;
+#endif
 
    //Successful processing
    return NO_ERROR;
@@ -230,6 +271,147 @@ error_t tlsSetServerName(TlsContext *context, const char_t *serverName)
 }
 
 
+/**
+ * @brief Set the application protocols accepted by the server
+ *
+ * The list is formatted as a comma-delimited string, by order of
+ * preference (for instance "h2,http/1.1"). The server selects the
+ * first protocol of its list that the client offers in its ALPN
+ * extension. The handshake proceeds without ALPN when no common
+ * protocol is found
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] protocolList NULL-terminated list of protocol names
+ * @return Error code
+ **/
+
+error_t tlsSetAlpnProtocolList(TlsContext *context, const char_t *protocolList)
+{
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   size_t length;
+
+   //Invalid parameters?
+   if(context == NULL || protocolList == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Retrieve the length of the list
+   length = strlen(protocolList);
+
+   //Release the previous list, if any
+   osMemFree(context->protocolList);
+
+   //Allocate a memory block to hold the list
+   context->protocolList = osMemAlloc(length + 1);
+   //Failed to allocate memory?
+   if(!context->protocolList) return ERROR_OUT_OF_MEMORY;
+
+   //Save the list of protocols
+   strcpy(context->protocolList, protocolList);
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //ALPN is not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the size of the send and receive buffers
+ *
+ * Each buffer must be large enough to hold the longest handshake message
+ * exchanged in that direction. A device that negotiates a small maximum
+ * fragment length with its peers can use much smaller buffers than the
+ * 16 KB required by full-sized records
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] txBufferSize Maximum length of the protocol data that can be sent
+ * @param[in] rxBufferSize Maximum length of the protocol data that can be received
+ * @return Error code
+ **/
+
+error_t tlsSetBufferSize(TlsContext *context, size_t txBufferSize, size_t rxBufferSize)
+{
+   uint8_t *txBuffer;
+   uint8_t *rxBuffer;
+
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+   //Each buffer must hold at least a fragment of the smallest size
+   if(txBufferSize < TLS_MIN_RECORD_LENGTH || rxBufferSize < TLS_MIN_RECORD_LENGTH)
+      return ERROR_INVALID_PARAMETER;
+   //The buffers cannot be resized once the handshake has started
+   if(context->state != TLS_STATE_INIT)
+      return ERROR_WRONG_STATE;
+
+   //Allocate the new send and receive buffers
+   txBuffer = osMemAlloc(TLS_TX_BUFFER_SIZE(txBufferSize));
+   rxBuffer = osMemAlloc(TLS_RX_BUFFER_SIZE(rxBufferSize));
+   //Failed to allocate memory?
+   if(!txBuffer || !rxBuffer)
+   {
+      //Clean up side effects
+      osMemFree(txBuffer);
+      osMemFree(rxBuffer);
+      //Report an error
+      return ERROR_OUT_OF_MEMORY;
+   }
+
+   //Clear send and receive buffers
+   memset(txBuffer, 0, TLS_TX_BUFFER_SIZE(txBufferSize));
+   memset(rxBuffer, 0, TLS_RX_BUFFER_SIZE(rxBufferSize));
+
+   //Release the previous buffers
+   osMemFree(context->txBuffer);
+   osMemFree(context->rxBuffer);
+
+   //Save the new buffers
+   context->txBuffer = txBuffer;
+   context->txBufferSize = txBufferSize;
+   context->rxBuffer = rxBuffer;
+   context->rxBufferSize = rxBufferSize;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set the maximum fragment length to be negotiated with the server
+ * @param[in] context Pointer to the TLS context
+ * @param[in] maxFragLength Maximum fragment length (512, 1024, 2048, 4096 or 16384 bytes)
+ * @return Error code
+ **/
+
+error_t tlsSetMaxFragmentLength(TlsContext *context, size_t maxFragLength)
+{
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+#if (TLS_MAX_FRAG_LENGTH_SUPPORT == ENABLED)
+   //Only the values defined by RFC 6066 can be requested
+   if(maxFragLength != 512 && maxFragLength != 1024 && maxFragLength != 2048 &&
+      maxFragLength != 4096 && maxFragLength != TLS_MAX_RECORD_LENGTH)
+   {
+      //Report an error
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //Save the maximum fragment length
+   context->maxFragLength = maxFragLength;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
 /**
  * @brief Set session cache
  * @param[in] context Pointer to the TLS context
@@ -251,6 +433,206 @@ error_t tlsSetCache(TlsContext *context, TlsCache *cache)
 }
 
 
+/**
+ * @brief Set client-side session cache
+ *
+ * Client contexts use the most recently created client-side session cache
+ * by default. This function selects another cache, or disables automatic
+ * session resumption when the cache parameter is NULL
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] clientCache Sessions indexed by server name and port
+ * @return Error code
+ **/
+
+error_t tlsSetClientCache(TlsContext *context, TlsClientCache *clientCache)
+{
+#if (TLS_CLIENT_CACHE_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Sessions will be saved to and resumed from this cache
+   context->clientCache = clientCache;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Client-side session cache is not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the keys used to protect session tickets
+ *
+ * A server that is given a ticket context issues session tickets to the
+ * clients that support them (refer to RFC 5077). The session state is then
+ * kept by the clients rather than in the session cache of the server
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] ticketContext Ticket keys shared by the server contexts
+ * @return Error code
+ **/
+
+error_t tlsSetTicketContext(TlsContext *context, TlsTicketContext *ticketContext)
+{
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //Check parameters
+   if(context == NULL || ticketContext == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The keys will be used to issue and decrypt session tickets
+   context->ticketContext = ticketContext;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Session tickets are not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the crypto worker pool
+ * @param[in] context Pointer to the TLS context
+ * @param[in] cryptoWorker Pool of tasks running the public-key operations
+ * @return Error code
+ **/
+
+error_t tlsSetCryptoWorker(TlsContext *context, TlsCryptoWorker *cryptoWorker)
+{
+#if (TLS_CRYPTO_WORKER_SUPPORT == ENABLED)
+   //Check parameters
+   if(context == NULL || cryptoWorker == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Create the event used to wait for the completion of the crypto jobs
+   if(context->cryptoEvent == NULL)
+   {
+      context->cryptoEvent = osEventCreate(FALSE, FALSE);
+
+      //Out of resources?
+      if(context->cryptoEvent == OS_INVALID_HANDLE)
+         return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //The handshake public-key operations will be run by the worker tasks
+   context->cryptoWorker = cryptoWorker;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Crypto workers are not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the pool of precomputed Diffie-Hellman key pairs
+ * @param[in] context Pointer to the TLS context
+ * @param[in] dhKeyPool Key pairs generated by a background task
+ * @return Error code
+ **/
+
+error_t tlsSetDhKeyPool(TlsContext *context, TlsDhKeyPool *dhKeyPool)
+{
+#if (TLS_DH_KEY_POOL_SUPPORT == ENABLED)
+   //Check parameters
+   if(context == NULL || dhKeyPool == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //DHE handshakes will use the precomputed key pairs
+   context->dhKeyPool = dhKeyPool;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Precomputed key pairs are not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Enable or disable False Start
+ *
+ * When enabled, the client sends application data right after its own
+ * Finished message, provided that a forward-secret AEAD cipher suite has
+ * been negotiated. The server's Finished message is then checked by the
+ * first call to tlsRead
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] enabled Specifies whether False Start may be used
+ * @return Error code
+ **/
+
+error_t tlsSetFalseStart(TlsContext *context, bool_t enabled)
+{
+#if (TLS_FALSE_START_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //False Start only applies to TLS clients
+   if(context->entity != TLS_CONNECTION_END_CLIENT)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the setting
+   context->falseStartEnabled = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //False Start is not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Enable or disable non-blocking operation
+ *
+ * In non-blocking mode, the socket must be given a zero timeout.
+ * tlsConnect, tlsRead and tlsWrite then return ERROR_WOULD_BLOCK instead of
+ * waiting, and the same call is repeated once the socket is ready. Partially
+ * received records are kept in the TLS context. The part of a record the
+ * socket does not accept stays in the TX buffer and is sent by the next
+ * call or by tlsFlush. After ERROR_WOULD_BLOCK, the application calls
+ * tlsFlush: if it also returns ERROR_WOULD_BLOCK, the connection waits for
+ * the socket to become writable, otherwise for incoming data
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] enabled Specifies whether operations may return ERROR_WOULD_BLOCK
+ * @return Error code
+ **/
+
+error_t tlsSetNonBlocking(TlsContext *context, bool_t enabled)
+{
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The mode cannot change while a record is partially sent or received
+   if(context->txPendingLength > 0 || context->rxRecordPos > 0)
+      return ERROR_WRONG_STATE;
+
+   //Save the setting
+   context->nonBlocking = enabled;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Non-blocking operation is not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
 /**
  * @brief Set client authentication mode
  * @param[in] context Pointer to the TLS context
@@ -351,6 +733,92 @@ error_t tlsSetTrustedCaList(TlsContext *context, const char_t *trustedCaList, si
 }
 
 
+/**
+ * @brief Set the trusted CA store
+ *
+ * When a trusted CA store is specified, it takes precedence over the
+ * trusted CA list
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] caStore Trusted CA store created with tlsInitCaStore
+ * @return Error code
+ **/
+
+error_t tlsSetCaStore(TlsContext *context, const TlsCaStore *caStore)
+{
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the trusted CA store
+   context->caStore = caStore;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set the cache of validated certificate chains
+ *
+ * The cache can be shared by several client contexts. A certificate chain
+ * found in the cache is accepted without verifying its signatures again,
+ * provided that it has been validated against the same trusted CAs
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] certCache Cache created with tlsInitCertCache
+ * @return Error code
+ **/
+
+error_t tlsSetCertCache(TlsContext *context, TlsCertCache *certCache)
+{
+#if (TLS_CERT_CACHE_SUPPORT == ENABLED)
+   //Check parameters
+   if(context == NULL || certCache == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Validated certificate chains will be looked up in the cache
+   context->certCache = certCache;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Certificate chain cache is not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Set the amount of 0-RTT data the server accepts (TLS 1.3)
+ *
+ * The value is advertised in the session tickets issued by the server.
+ * A value of zero disables 0-RTT data
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] maxEarlyDataSize Maximum amount of 0-RTT data, in bytes
+ * @return Error code
+ **/
+
+error_t tlsSetMaxEarlyDataSize(TlsContext *context, uint32_t maxEarlyDataSize)
+{
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the amount of 0-RTT data accepted per session
+   context->maxEarlyDataSize = maxEarlyDataSize;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //0-RTT data are not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
 /**
  * @brief Import a certificate and the corresponding private key
  * @param[in] context Pointer to the TLS context
@@ -367,6 +835,7 @@ error_t tlsAddCertificate(TlsContext *context, const char_t *certChain,
    error_t error;
    const char_t *p;
    size_t n;
+   uint8_t *q;
    uint8_t *derCert;
    size_t derCertSize;
    size_t derCertLength;
@@ -374,6 +843,7 @@ error_t tlsAddCertificate(TlsContext *context, const char_t *certChain,
    TlsCertificateType certType;
    TlsSignatureAlgo certSignAlgo;
    TlsHashAlgo certHashAlgo;
+   TlsCertDesc *cert;
 
    //Invalid TLS context?
    if(context == NULL)
@@ -394,6 +864,19 @@ error_t tlsAddCertificate(TlsContext *context, const char_t *certChain,
    //Failed to allocate memory?
    if(!certInfo) return ERROR_OUT_OF_MEMORY;
 
+   //Point to the structure that describes the certificate
+   cert = &context->certs[context->numCerts];
+
+   //Initialize private keys
+   rsaInitPrivateKey(&cert->rsaPrivateKey);
+   dsaInitPrivateKey(&cert->dsaPrivateKey);
+   ecInitDomainParameters(&cert->ecParams);
+   mpiInit(&cert->ecPrivateKey);
+
+   //The certificate list is built once for all
+   cert->certList = NULL;
+   cert->certListLength = 0;
+
    //Point to the beginning of the certificate chain
    p = certChain;
    n = certChainLength;
@@ -403,6 +886,9 @@ error_t tlsAddCertificate(TlsContext *context, const char_t *certChain,
    derCertSize = 0;
    derCertLength = 0;
 
+   //Time spent decoding the certificate chain and the private key
+   TLS_PROFILE_START(context, TLS_PROFILE_PEM);
+
    //Start of exception handling block
    do
    {
@@ -421,15 +907,81 @@ error_t tlsAddCertificate(TlsContext *context, const char_t *certChain,
       //The specified signature algorithm is not supported?
       if(error) break;
 
+      //The private key is decoded once for all, rather than at each handshake
+      if(certType == TLS_CERT_RSA_SIGN)
+      {
+         //Decode the PEM structure that holds the RSA private key
+         error = pemReadRsaPrivateKey(privateKey, privateKeyLength, &cert->rsaPrivateKey);
+      }
+      else if(certType == TLS_CERT_DSS_SIGN)
+      {
+         //Decode the PEM structure that holds the DSA private key
+         error = pemReadDsaPrivateKey(privateKey, privateKeyLength, &cert->dsaPrivateKey);
+      }
+      else if(certType == TLS_CERT_ECDSA_SIGN)
+      {
+         //Decode the PEM structure that holds the EC private key
+         error = pemReadEcPrivateKey(privateKey, privateKeyLength, &cert->ecParams, &cert->ecPrivateKey);
+      }
+
+      //Failed to decode the private key?
+      if(error) break;
+
+      //Allocate a memory buffer to hold the certificate list in the format
+      //used by the Certificate message (DER encoding is shorter than PEM)
+      cert->certList = osMemAlloc(certChainLength);
+
+      //Failed to allocate memory?
+      if(!cert->certList)
+      {
+         //Report an error
+         error = ERROR_OUT_OF_MEMORY;
+         break;
+      }
+
+      //Convert each certificate of the chain
+      do
+      {
+         //Point to the current certificate
+         q = cert->certList + cert->certListLength;
+
+         //Each certificate is preceded by a 3-byte length field
+         STORE24BE(derCertLength, q);
+         //Copy the DER encoded certificate
+         memcpy(q + 3, derCert, derCertLength);
+
+         //Update the length of the certificate list
+         cert->certListLength += derCertLength + 3;
+
+         //Read PEM certificates, one by one
+         error = pemReadCertificate(&p, &n, &derCert, &derCertSize, &derCertLength);
+
+         //Loop as long as necessary
+      } while(!error);
+
+      //Any error to report?
+      if(error != ERROR_END_OF_FILE)
+         break;
+
+      //Parse the last certificate of the chain
+      error = x509ParseCertificate(q + 3, LOAD24BE(q), certInfo);
+      //Failed to parse the X.509 certificate?
+      if(error) break;
+
+      //The issuer of the last certificate is compared against the list
+      //of certificate authorities that the peer trusts
+      cert->rootIssuer = certInfo->issuer.rawData;
+      cert->rootIssuerLength = certInfo->issuer.rawDataLen;
+
       //End of exception handling block
    } while(0);
 
+   //The local certificate has been decoded
+   TLS_PROFILE_STOP(context, TLS_PROFILE_PEM);
+
    //Check whether the certificate is acceptable
    if(!error)
    {
-      //Point to the structure that describes the certificate
-      TlsCertDesc *cert = &context->certs[context->numCerts];
-
       //Save the certificate chain and the corresponding private key
       cert->certChain = certChain;
       cert->certChainLength = certChainLength;
@@ -442,6 +994,15 @@ error_t tlsAddCertificate(TlsContext *context, const char_t *certChain,
       //Update the number of certificate
       context->numCerts++;
    }
+   else
+   {
+      //Clean up side effects
+      rsaFreePrivateKey(&cert->rsaPrivateKey);
+      dsaFreePrivateKey(&cert->dsaPrivateKey);
+      ecFreeDomainParameters(&cert->ecParams);
+      mpiFree(&cert->ecPrivateKey);
+      osMemFree(cert->certList);
+   }
 
    //Release previously allocated memory
    osMemFree(derCert);
@@ -480,32 +1041,132 @@ error_t tlsConnect(TlsContext *context)
    if(context->prngAlgo == NULL || context->prngContext == NULL)
       return ERROR_NOT_CONFIGURED;
 
-#if (TLS_CLIENT_SUPPORT == ENABLED)
-   //TLS operates as a client?
-   if(context->entity == TLS_CONNECTION_END_CLIENT)
+#if (TLS_CLIENT_SUPPORT == ENABLED)
+   //TLS operates as a client?
+   if(context->entity == TLS_CONNECTION_END_CLIENT)
+   {
+      //Initiate TLS handshake with the remote server
+      error = tlsClientHandshake(context);
+   }
+   else
+#endif
+#if (TLS_SERVER_SUPPORT == ENABLED)
+   //TLS operates as a server?
+   if(context->entity == TLS_CONNECTION_END_SERVER)
+   {
+      //Initiate TLS handshake with the remote client
+      error = tlsServerHandshake(context);
+   }
+   else
+#endif
+   //Unsupported mode of operation?
+   {
+      //Cannot establish a secure session between the server and the client...
+      error = ERROR_INVALID_PARAMETER;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send 0-RTT data before the handshake completes (TLS 1.3)
+ *
+ * The first call sends the ClientHello. The data are protected with the
+ * keys derived from the PSK of the last session established with the
+ * server. tlsConnect() must then be called to complete the handshake and
+ * tlsIsEarlyDataAccepted() tells whether the server has processed the data
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] data Pointer to a buffer containing the data to be transmitted
+ * @param[in] length Number of bytes to be transmitted
+ * @param[out] written Number of bytes that have been sent
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code (ERROR_NOT_CONFIGURED if no session allows 0-RTT data)
+ **/
+
+error_t tlsWriteEarlyData(TlsContext *context, const void *data,
+   size_t length, size_t *written, uint_t flags)
+{
+#if (TLS_CLIENT_SUPPORT == ENABLED && TLS_EARLY_DATA_SUPPORT == ENABLED)
+   error_t error;
+   size_t n;
+
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+   //Check parameters
+   if((data == NULL && length != 0) || written == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //No data has been sent yet
+   *written = 0;
+
+   //Only the client can send 0-RTT data
+   if(context->entity != TLS_CONNECTION_END_CLIENT)
+      return ERROR_INVALID_PARAMETER;
+
+   //Verify that the PRNG is properly set
+   if(context->prngAlgo == NULL || context->prngContext == NULL)
+      return ERROR_NOT_CONFIGURED;
+
+   //The handshake has not started yet?
+   if(context->state == TLS_STATE_INIT)
    {
-      //Initiate TLS handshake with the remote server
-      error = tlsClientHandshake(context);
+      //Send the ClientHello and install the early traffic keys
+      error = tls13StartEarlyData(context);
+      //Any error to report?
+      if(error) return error;
    }
-   else
-#endif
-#if (TLS_SERVER_SUPPORT == ENABLED)
-   //TLS operates as a server?
-   if(context->entity == TLS_CONNECTION_END_SERVER)
+
+   //0-RTT data can only be sent before the server's flight is processed
+   if(context->state != TLS_STATE_SERVER_HELLO || !context->earlyDataEnabled)
+      return ERROR_UNEXPECTED_STATE;
+
+   //The amount of 0-RTT data is limited by the ticket
+   length = min(length, context->sessionMaxEarlyDataSize - context->earlyDataLength);
+
+   //Send the data
+   while(length > 0)
    {
-      //Initiate TLS handshake with the remote client
-      error = tlsServerHandshake(context);
-   }
-   else
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+      //The previous record must leave the TX buffer first
+      error = tlsIoFlush(context, *written > 0);
+      //Any error to report?
+      if(error) return error;
 #endif
-   //Unsupported mode of operation?
-   {
-      //Cannot establish a secure session between the server and the client...
-      error = ERROR_INVALID_PARAMETER;
+
+      //Calculate the number of bytes to write at a time
+      n = min(length, context->txBufferSize);
+      //The record length cannot exceed the negotiated limits
+      n = min(n, context->maxFragLength);
+      n = min(n, context->recordSizeLimit);
+
+      //Build the record directly from the caller's buffer
+      error = tlsWriteRecordData(context, data, n, TLS_TYPE_APPLICATION_DATA);
+      //Failed to send data?
+      if(error) return error;
+
+      //Advance data pointer
+      data = (uint8_t *) data + n;
+      //Data left to be written
+      length -= n;
+
+      //Total number of bytes that have been sent
+      *written += n;
+      context->earlyDataLength += n;
    }
 
-   //Return status code
-   return error;
+   //Unused parameter
+   (void) flags;
+
+   //Successful write operation
+   return NO_ERROR;
+#else
+   //0-RTT data are not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
 }
 
 
@@ -522,7 +1183,6 @@ error_t tlsWrite(TlsContext *context, const void *data, size_t length, uint_t fl
 {
    error_t error;
    size_t n;
-   uint8_t *p;
 
    //Invalid TLS context?
    if(context == NULL)
@@ -531,26 +1191,53 @@ error_t tlsWrite(TlsContext *context, const void *data, size_t length, uint_t fl
    if(data == NULL && length != 0)
       return ERROR_INVALID_PARAMETER;
 
-   //Pointer to the buffer where to copy the data
-   p = context->txBuffer + sizeof(TlsRecord);
+   //No record has been sent yet
+   n = 0;
 
    //Send all the data
    while(length > 0)
    {
+#if (TLS_FALSE_START_SUPPORT == ENABLED)
+      //With False Start, application data may be sent before the
+      //server's Finished message has been received
+      if(context->state != TLS_STATE_APPLICATION_DATA && !context->falseStart)
+         return ERROR_NOT_CONNECTED;
+#else
       //Check the current state before sending data
       if(context->state != TLS_STATE_APPLICATION_DATA)
          return ERROR_NOT_CONNECTED;
+#endif
 
-      //Calculate the number of bytes to write at a time
-      n = min(length, TLS_MAX_PROTOCOL_DATA_LENGTH);
-      //The record length cannot exceed 16384 bytes
-      n = min(n, TLS_MAX_RECORD_LENGTH);
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+      //The previous record must leave the TX buffer first. Once part of
+      //the data has been sent, the function waits for the socket
+      error = tlsIoFlush(context, n > 0);
+
+      //Check status code
+      if(error == ERROR_WOULD_BLOCK)
+      {
+         //The caller will try again once the socket is writable
+         return error;
+      }
+      else if(error)
+      {
+         //Send an alert message to the peer
+         tlsProcessError(context, error);
+         //Report an error
+         return error;
+      }
+#endif
 
-      //Copy data to the send buffer
-      memcpy(p, data, n);
+      //Calculate the number of bytes to write at a time
+      n = min(length, context->txBufferSize);
+      //The record length cannot exceed the negotiated limits
+      n = min(n, context->maxFragLength);
+      n = min(n, context->recordSizeLimit);
 
-      //Send application data
-      error = tlsWriteProtocolData(context, n, TLS_TYPE_APPLICATION_DATA);
+      //Build the record directly from the caller's buffer
+      TLS_PROFILE_START(context, TLS_PROFILE_RECORD_WRITE);
+      error = tlsWriteRecordData(context, data, n, TLS_TYPE_APPLICATION_DATA);
+      TLS_PROFILE_STOP(context, TLS_PROFILE_RECORD_WRITE);
 
       //Failed to send data?
       if(error)
@@ -572,6 +1259,23 @@ error_t tlsWrite(TlsContext *context, const void *data, size_t length, uint_t fl
 }
 
 
+/**
+ * @brief Send the data left in the TX buffer by non-blocking operations
+ * @param[in] context Pointer to the TLS context
+ * @return Error code (ERROR_WOULD_BLOCK if the socket is not writable)
+ **/
+
+error_t tlsFlush(TlsContext *context)
+{
+   //Invalid TLS context?
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Send pending data, if any
+   return tlsIoFlush(context, FALSE);
+}
+
+
 /**
  * @brief Receive application data from a the remote host using TLS
  * @param[in] context Pointer to the TLS context
@@ -588,7 +1292,9 @@ error_t tlsRead(TlsContext *context, void *data, size_t size, size_t *received,
    size_t i;
    size_t n;
    uint8_t *p;
+   bool_t zeroCopy;
    TlsContentType contentType;
+   TlsRecord record;
 
    //Invalid TLS context?
    if(context == NULL)
@@ -600,6 +1306,29 @@ error_t tlsRead(TlsContext *context, void *data, size_t size, size_t *received,
    //No data has been read yet
    *received = 0;
 
+   //Records are decrypted directly into the user buffer, unless the data
+   //must be scanned for a break character
+   zeroCopy = (flags & TLS_FLAG_BREAK_CHAR) ? FALSE : TRUE;
+
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+   //A record received by several calls is staged in the receive buffer,
+   //since the user buffer may change from one call to the next
+   if(context->nonBlocking)
+      zeroCopy = FALSE;
+#endif
+
+#if (TLS_CLIENT_SUPPORT == ENABLED && TLS_FALSE_START_SUPPORT == ENABLED)
+   //The server's Finished message must be processed before any
+   //application data can be read
+   if(context->falseStart)
+   {
+      //Complete the handshake
+      error = tlsClientHandshake(context);
+      //Any error to report?
+      if(error) return error;
+   }
+#endif
+
    //Read as much data as possible
    for(*received = 0; *received < size; )
    {
@@ -620,8 +1349,115 @@ error_t tlsRead(TlsContext *context, void *data, size_t size, size_t *received,
          return ERROR_NOT_CONNECTED;
       }
 
+      //Clear status code
+      error = NO_ERROR;
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+      //The 0-RTT data received during the handshake are returned first
+      if(context->earlyData != NULL && context->earlyDataPos < context->earlyDataLength)
+      {
+         //Limit the number of bytes to read at a time
+         n = min(context->earlyDataLength - context->earlyDataPos, size - *received);
+         //Copy data to user buffer
+         memcpy(data, context->earlyData + context->earlyDataPos, n);
+
+         //Total number of data that have been read
+         *received += n;
+         //Advance data pointer
+         data = (uint8_t *) data + n;
+         context->earlyDataPos += n;
+
+         //The TLS_FLAG_WAIT_ALL flag causes the function to return
+         //only when the requested number of bytes have been read
+         if(!(flags & TLS_FLAG_WAIT_ALL))
+            break;
+
+         //Read the next record
+         continue;
+      }
+#endif
+
+      //No data pending in the receive buffer?
+      if(context->rxBufferLength == 0 && zeroCopy)
+      {
+         //Read the header of the next TLS record
+         error = tlsReadRecordHeader(context, &record);
+
+         //Application data that fit in the user buffer?
+         if(!error && record.type == TLS_TYPE_APPLICATION_DATA &&
+            ntohs(record.length) <= (size - *received))
+         {
+            //Decrypt the record directly into the user buffer
+            TLS_PROFILE_START(context, TLS_PROFILE_RECORD_READ);
+            error = tlsReadRecordData(context, &record, data, size - *received, &n);
+            TLS_PROFILE_STOP(context, TLS_PROFILE_RECORD_READ);
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+            //With TLS 1.3, the actual content type of a protected record is
+            //only known once the record has been decrypted
+            if(!error && record.type != TLS_TYPE_APPLICATION_DATA)
+            {
+               //Move the record to the receive buffer
+               memcpy(context->rxBuffer, data, n);
+
+               //Save record type
+               context->rxBufferType = (TlsContentType) record.type;
+               //Number of bytes available for reading
+               context->rxBufferLength = n;
+               //Rewind to the beginning of the buffer
+               context->rxBufferReadIndex = 0;
+               //Set write index
+               context->rxBufferWriteIndex = n;
+            }
+            else
+#endif
+            //Check status code
+            if(!error)
+            {
+               //Total number of data that have been read
+               *received += n;
+               //Advance data pointer
+               data = (uint8_t *) data + n;
+
+               //The TLS_FLAG_WAIT_ALL flag causes the function to return
+               //only when the requested number of bytes have been read
+               if(!(flags & TLS_FLAG_WAIT_ALL))
+                  break;
+
+               //Read the next record
+               continue;
+            }
+         }
+         else if(!error)
+         {
+            //Stage the record in the receive buffer
+            TLS_PROFILE_START(context, TLS_PROFILE_RECORD_READ);
+            error = tlsReadRecordData(context, &record,
+               context->rxBuffer, TLS_RX_BUFFER_SIZE(context->rxBufferSize), &n);
+            TLS_PROFILE_STOP(context, TLS_PROFILE_RECORD_READ);
+
+            //Check status code
+            if(!error)
+            {
+               //Save record type
+               context->rxBufferType = (TlsContentType) record.type;
+               //Number of bytes available for reading
+               context->rxBufferLength = n;
+               //Rewind to the beginning of the buffer
+               context->rxBufferReadIndex = 0;
+               //Set write index
+               context->rxBufferWriteIndex = n;
+            }
+         }
+
+         //The record has been silently dropped?
+         if(error == ERROR_MESSAGE_DISCARDED)
+            continue;
+      }
+
       //The TLS record layer receives uninterpreted data from higher layers
-      error = tlsReadProtocolData(context, (void **) &p, &n, &contentType);
+      if(!error)
+         error = tlsReadProtocolData(context, (void **) &p, &n, &contentType);
 
       //Check the higher-level protocol that was used to convey the data
       if(!error)
@@ -690,6 +1526,20 @@ error_t tlsRead(TlsContext *context, void *data, size_t size, size_t *received,
             //Number of bytes still pending in the receive buffer
             context->rxBufferLength -= n;
          }
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+         //Post-handshake message received?
+         else if(contentType == TLS_TYPE_HANDSHAKE &&
+            context->version == TLS_VERSION_1_3)
+         {
+            //Parse NewSessionTicket or KeyUpdate message
+            error = tls13ParsePostHandshakeMessage(context, (TlsHandshake *) p, n);
+
+            //Advance read index
+            context->rxBufferReadIndex += n;
+            //Number of bytes still pending in the receive buffer
+            context->rxBufferLength -= n;
+         }
+#endif
          //An inappropriate message was received?
          else
          {
@@ -701,6 +1551,14 @@ error_t tlsRead(TlsContext *context, void *data, size_t size, size_t *received,
       //An error was encountered?
       if(error)
       {
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+         //No more data available for now?
+         if(error == ERROR_WOULD_BLOCK)
+         {
+            //The user must be satisfied with data already on hand
+            return (*received > 0) ? NO_ERROR : ERROR_WOULD_BLOCK;
+         }
+#endif
          //Send an alert message to the peer
          tlsProcessError(context, error);
          //Exit immediately
@@ -726,6 +1584,16 @@ error_t tlsShutdown(TlsContext *context)
    if(context == NULL)
       return ERROR_INVALID_PARAMETER;
 
+#if (TLS_FALSE_START_SUPPORT == ENABLED)
+   //The client keys are in use as soon as False Start has begun
+   if(context->falseStart)
+   {
+      //The handshake will never be completed
+      context->falseStart = FALSE;
+      context->state = TLS_STATE_APPLICATION_DATA;
+   }
+#endif
+
    //Check current state
    if(context->state == TLS_STATE_APPLICATION_DATA ||
       context->state == TLS_STATE_CLOSED)
@@ -754,6 +1622,8 @@ error_t tlsShutdown(TlsContext *context)
 
 void tlsFree(TlsContext *context)
 {
+   uint_t i;
+
    //Invalid TLS context?
    if(context == NULL)
       return;
@@ -764,17 +1634,54 @@ void tlsFree(TlsContext *context)
    //Release server name
    osMemFree(context->serverName);
 
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   //Release the list of application protocols
+   osMemFree(context->protocolList);
+   osMemFree(context->selectedProtocol);
+#endif
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //Release the cookie sent by the server
+   osMemFree(context->cookie);
+#endif
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   //Release the 0-RTT data that have not been read
+   osMemFree(context->earlyData);
+#endif
+
+#if (TLS_CRYPTO_WORKER_SUPPORT == ENABLED)
+   //Release the event used to wait for crypto jobs
+   if(context->cryptoEvent != NULL)
+      osEventClose(context->cryptoEvent);
+#endif
+
    //Free multiple precision integers
    dhFreeParameters(&context->dhParameters);
    rsaFreePublicKey(&context->peerRsaPublicKey);
    dsaFreePublicKey(&context->peerDsaPublicKey);
 
+   //Release ECDH context and peer's EC public key
+   ecdhFree(&context->ecdhContext);
+   ecFreeDomainParameters(&context->peerEcParams);
+   ecFree(&context->peerEcPublicKey);
+
+   //Release the private keys of the certificates
+   for(i = 0; i < context->numCerts; i++)
+   {
+      rsaFreePrivateKey(&context->certs[i].rsaPrivateKey);
+      dsaFreePrivateKey(&context->certs[i].dsaPrivateKey);
+      ecFreeDomainParameters(&context->certs[i].ecParams);
+      mpiFree(&context->certs[i].ecPrivateKey);
+      osMemFree(context->certs[i].certList);
+   }
+
    //Release send buffer
-   memset(context->txBuffer, 0, TLS_TX_BUFFER_SIZE);
+   memset(context->txBuffer, 0, TLS_TX_BUFFER_SIZE(context->txBufferSize));
    osMemFree(context->txBuffer);
 
    //Release receive buffer
-   memset(context->rxBuffer, 0, TLS_RX_BUFFER_SIZE);
+   memset(context->rxBuffer, 0, TLS_RX_BUFFER_SIZE(context->rxBufferSize));
    osMemFree(context->rxBuffer);
 
    //Release resources used to compute handshake message hash
@@ -798,12 +1705,227 @@ void tlsFree(TlsContext *context)
       osMemFree(context->readCipherContext);
    }
 
+#if (TLS_CTR_DRBG_SUPPORT == ENABLED)
+   //Clear the internal state of the private generator
+   ctrDrbgRelease(&context->prngChild);
+#endif
+
    //Clear the TLS context before freeing memory
    memset(context, 0, sizeof(TlsContext));
    osMemFree(context);
 }
 
 
+/**
+ * @brief Retrieve the profiling counters of a TLS context
+ * @param[in] context Pointer to the TLS context
+ * @param[out] profile Time spent in each phase, using the TLS_PROFILE_GET_TIME time base
+ * @return Error code
+ **/
+
+error_t tlsGetProfile(const TlsContext *context, TlsProfile *profile)
+{
+#if (TLS_PROFILING_SUPPORT == ENABLED)
+   //Check parameters
+   if(context == NULL || profile == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Copy the counters
+   *profile = context->profile;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Profiling is not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Retrieve the application protocol negotiated through ALPN
+ * @param[in] context Pointer to the TLS context
+ * @return Name of the selected protocol, or NULL if none was negotiated
+ **/
+
+const char_t *tlsGetAlpnProtocol(const TlsContext *context)
+{
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return NULL;
+
+   //Return the protocol selected during the handshake
+   return context->selectedProtocol;
+#else
+   //ALPN is not supported
+   return NULL;
+#endif
+}
+
+
+/**
+ * @brief Check whether application data can be read without blocking
+ *
+ * Only the data that has already been received and decrypted is taken
+ * into account. The underlying socket is not checked
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return TRUE if application data is waiting in the receive buffer, else FALSE
+ **/
+
+bool_t tlsIsRxReady(const TlsContext *context)
+{
+   //Invalid TLS context?
+   if(context == NULL)
+      return FALSE;
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   //0-RTT data not read yet?
+   if(context->earlyData != NULL && context->earlyDataPos < context->earlyDataLength)
+      return TRUE;
+#endif
+
+   //Application data left in the receive buffer?
+   if(context->rxBufferLength > 0 && context->rxBufferType == TLS_TYPE_APPLICATION_DATA)
+      return TRUE;
+
+   //No data can be read without blocking
+   return FALSE;
+}
+
+
+/**
+ * @brief Check whether the server has accepted the 0-RTT data (TLS 1.3)
+ * @param[in] context Pointer to the TLS context
+ * @return TRUE if the 0-RTT data have been accepted, else FALSE
+ **/
+
+bool_t tlsIsEarlyDataAccepted(const TlsContext *context)
+{
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   //Invalid TLS context?
+   if(context == NULL)
+      return FALSE;
+
+   //The flag is set once the handshake confirms the 0-RTT data
+   return context->earlyDataAccepted;
+#else
+   //0-RTT data are not supported
+   return FALSE;
+#endif
+}
+
+
+/**
+ * @brief Retrieve the amount of memory held by a TLS context
+ *
+ * Once the handshake is complete, the resources it needed are released
+ * and only the record layer state is accounted for
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[out] size Number of bytes allocated on behalf of the context
+ * @return Error code
+ **/
+
+error_t tlsGetMemUsage(const TlsContext *context, size_t *size)
+{
+   uint_t i;
+   size_t n;
+   const TlsCertDesc *cert;
+
+   //Check parameters
+   if(context == NULL || size == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //TLS context
+   n = sizeof(TlsContext);
+
+   //Server name
+   if(context->serverName != NULL)
+      n += strlen(context->serverName) + 1;
+
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   //Application protocols
+   if(context->protocolList != NULL)
+      n += strlen(context->protocolList) + 1;
+   if(context->selectedProtocol != NULL)
+      n += strlen(context->selectedProtocol) + 1;
+#endif
+
+   //Record buffers
+   n += TLS_TX_BUFFER_SIZE(context->txBufferSize);
+   n += TLS_RX_BUFFER_SIZE(context->rxBufferSize);
+
+   //Handshake hash contexts
+   if(context->handshakeMd5Context != NULL)
+      n += sizeof(Md5Context);
+   if(context->handshakeSha1Context != NULL)
+      n += sizeof(Sha1Context);
+   if(context->handshakeHashContext != NULL)
+      n += context->prfHashAlgo->contextSize;
+
+   //Bulk cipher contexts
+   if(context->writeCipherContext != NULL)
+      n += context->cipherAlgo->contextSize;
+   if(context->readCipherContext != NULL)
+      n += context->cipherAlgo->contextSize;
+
+   //Diffie-Hellman parameters and ECDH context
+   n += TLS_MPI_MEM_SIZE(&context->dhParameters.p);
+   n += TLS_MPI_MEM_SIZE(&context->dhParameters.g);
+   n += TLS_MPI_MEM_SIZE(&context->dhParameters.xa);
+   n += TLS_MPI_MEM_SIZE(&context->dhParameters.ya);
+   n += TLS_MPI_MEM_SIZE(&context->dhParameters.yb);
+   n += TLS_EC_PARAMS_MEM_SIZE(&context->ecdhContext.params);
+   n += TLS_MPI_MEM_SIZE(&context->ecdhContext.da);
+   n += TLS_EC_POINT_MEM_SIZE(&context->ecdhContext.qa);
+   n += TLS_EC_POINT_MEM_SIZE(&context->ecdhContext.qb);
+
+   //Public key of the peer
+   n += TLS_MPI_MEM_SIZE(&context->peerRsaPublicKey.n);
+   n += TLS_MPI_MEM_SIZE(&context->peerRsaPublicKey.e);
+   n += TLS_MPI_MEM_SIZE(&context->peerDsaPublicKey.p);
+   n += TLS_MPI_MEM_SIZE(&context->peerDsaPublicKey.q);
+   n += TLS_MPI_MEM_SIZE(&context->peerDsaPublicKey.g);
+   n += TLS_MPI_MEM_SIZE(&context->peerDsaPublicKey.y);
+   n += TLS_EC_PARAMS_MEM_SIZE(&context->peerEcParams);
+   n += TLS_EC_POINT_MEM_SIZE(&context->peerEcPublicKey);
+
+   //Loop through the end entity certificates
+   for(i = 0; i < context->numCerts; i++)
+   {
+      //Point to the current certificate
+      cert = &context->certs[i];
+
+      //Certificate list
+      n += cert->certListLength;
+
+      //Decoded private keys
+      n += TLS_MPI_MEM_SIZE(&cert->rsaPrivateKey.n);
+      n += TLS_MPI_MEM_SIZE(&cert->rsaPrivateKey.e);
+      n += TLS_MPI_MEM_SIZE(&cert->rsaPrivateKey.d);
+      n += TLS_MPI_MEM_SIZE(&cert->rsaPrivateKey.p);
+      n += TLS_MPI_MEM_SIZE(&cert->rsaPrivateKey.q);
+      n += TLS_MPI_MEM_SIZE(&cert->rsaPrivateKey.dp);
+      n += TLS_MPI_MEM_SIZE(&cert->rsaPrivateKey.dq);
+      n += TLS_MPI_MEM_SIZE(&cert->rsaPrivateKey.qinv);
+      n += TLS_MPI_MEM_SIZE(&cert->dsaPrivateKey.p);
+      n += TLS_MPI_MEM_SIZE(&cert->dsaPrivateKey.q);
+      n += TLS_MPI_MEM_SIZE(&cert->dsaPrivateKey.g);
+      n += TLS_MPI_MEM_SIZE(&cert->dsaPrivateKey.x);
+      n += TLS_EC_PARAMS_MEM_SIZE(&cert->ecParams);
+      n += TLS_MPI_MEM_SIZE(&cert->ecPrivateKey);
+   }
+
+   //Return the total amount of memory
+   *size = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Save TLS session
  * @param[in] context Pointer to the TLS context
@@ -818,8 +1940,18 @@ error_t tlsSaveSession(const TlsContext *context, TlsSession *session)
       return ERROR_INVALID_PARAMETER;
 
    //Invalid session parameters?
-   if(!context->sessionIdLength || !context->cipherSuite)
+   if(!context->cipherSuite)
+      return ERROR_FAILURE;
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //The session can be resumed either by its identifier or by a ticket
+   if(!context->sessionIdLength && !context->ticketLength)
+      return ERROR_FAILURE;
+#else
+   //The session can only be resumed by its identifier
+   if(!context->sessionIdLength)
       return ERROR_FAILURE;
+#endif
 
    //Save session identifier
    memcpy(session->id, context->sessionId, context->sessionIdLength);
@@ -835,6 +1967,29 @@ error_t tlsSaveSession(const TlsContext *context, TlsSession *session)
    //Save master secret
    memcpy(session->masterSecret, context->masterSecret, 48);
 
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //Save the ticket issued by the server, if any
+   memcpy(session->ticket, context->ticket, context->ticketLength);
+   session->ticketLength = context->ticketLength;
+   session->ticketLifetime = context->ticketLifetime;
+#endif
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //TLS 1.3 sessions are resumed with a PSK derived from the ticket
+   if(context->version == TLS_VERSION_1_3)
+      session->idLength = 0;
+
+   //Save the parameters needed to offer the PSK
+   session->version = context->version;
+   session->ticketAgeAdd = context->ticketAgeAdd;
+   session->ticketTimestamp = context->ticketTimestamp;
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   session->maxEarlyDataSize = context->sessionMaxEarlyDataSize;
+#else
+   session->maxEarlyDataSize = 0;
+#endif
+#endif
+
    //Successful processing
    return NO_ERROR;
 }
@@ -864,6 +2019,34 @@ error_t tlsRestoreSession(TlsContext *context, const TlsSession *session)
    //Restore master secret
    memcpy(context->masterSecret, session->masterSecret, 48);
 
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //The client must not present a ticket beyond the lifetime hint
+   //supplied by the server (a value of zero means unspecified)
+   if(session->ticketLength > 0 && (session->ticketLifetime == 0 ||
+      (osGetTickCount() - session->timestamp) / 1000 < session->ticketLifetime))
+   {
+      //Restore session ticket
+      memcpy(context->ticket, session->ticket, session->ticketLength);
+      context->ticketLength = session->ticketLength;
+      context->ticketLifetime = session->ticketLifetime;
+   }
+   else
+   {
+      //Discard the outdated ticket
+      context->ticketLength = 0;
+   }
+#endif
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //Restore the parameters needed to offer the PSK
+   context->sessionVersion = session->version;
+   context->ticketAgeAdd = session->ticketAgeAdd;
+   context->ticketTimestamp = session->ticketTimestamp;
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   context->sessionMaxEarlyDataSize = session->maxEarlyDataSize;
+#endif
+#endif
+
    //Successful processing
    return NO_ERROR;
 }
@@ -36,12 +36,16 @@
 #include "rsa.h"
 #include "dsa.h"
 #include "dh.h"
+#include "ecdh.h"
+#include "ecdsa.h"
+#include "ctr_drbg.h"
 
 //TLS version numbers
 #define SSL_VERSION_3_0 0x0300
 #define TLS_VERSION_1_0 0x0301
 #define TLS_VERSION_1_1 0x0302
 #define TLS_VERSION_1_2 0x0303
+#define TLS_VERSION_1_3 0x0304
 
 //Enable SSL/TLS support
 #ifndef TLS_SUPPORT
@@ -74,7 +78,7 @@
 //Maximum version that can be negotiated
 #ifndef TLS_MAX_VERSION
    #define TLS_MAX_VERSION TLS_VERSION_1_2
-#elif (TLS_MAX_VERSION > TLS_VERSION_1_2 || TLS_MAX_VERSION < TLS_MIN_VERSION)
+#elif (TLS_MAX_VERSION > TLS_VERSION_1_3 || TLS_MAX_VERSION < TLS_MIN_VERSION)
    #error TLS_MAX_VERSION parameter is invalid
 #endif
 
@@ -99,6 +103,191 @@
    #error TLS_SESSION_CACHE_LIFETIME parameter is invalid
 #endif
 
+//Client-side session cache keyed by server name and port
+#ifndef TLS_CLIENT_CACHE_SUPPORT
+   #define TLS_CLIENT_CACHE_SUPPORT DISABLED
+#elif (TLS_CLIENT_CACHE_SUPPORT != ENABLED && TLS_CLIENT_CACHE_SUPPORT != DISABLED)
+   #error TLS_CLIENT_CACHE_SUPPORT parameter is invalid
+#endif
+
+//Maximum length of the server name stored in client-side cache entries
+#ifndef TLS_CLIENT_CACHE_MAX_HOST_LEN
+   #define TLS_CLIENT_CACHE_MAX_HOST_LEN 64
+#elif (TLS_CLIENT_CACHE_MAX_HOST_LEN < 40)
+   #error TLS_CLIENT_CACHE_MAX_HOST_LEN parameter is invalid
+#endif
+
+//Number of independently locked session cache shards
+#ifndef TLS_SESSION_CACHE_SHARDS
+   #define TLS_SESSION_CACHE_SHARDS 1
+#elif (TLS_SESSION_CACHE_SHARDS < 1)
+   #error TLS_SESSION_CACHE_SHARDS parameter is invalid
+#endif
+
+//Session ticket mechanism (RFC 5077)
+#ifndef TLS_TICKET_SUPPORT
+   #define TLS_TICKET_SUPPORT DISABLED
+#elif (TLS_TICKET_SUPPORT != ENABLED && TLS_TICKET_SUPPORT != DISABLED)
+   #error TLS_TICKET_SUPPORT parameter is invalid
+#elif (TLS_TICKET_SUPPORT == ENABLED && TLS_SESSION_RESUME_SUPPORT != ENABLED)
+   #error TLS_TICKET_SUPPORT requires TLS_SESSION_RESUME_SUPPORT
+#endif
+
+//Lifetime of session tickets
+#ifndef TLS_TICKET_LIFETIME
+   #define TLS_TICKET_LIFETIME 3600000
+#elif (TLS_TICKET_LIFETIME < 1000)
+   #error TLS_TICKET_LIFETIME parameter is invalid
+#endif
+
+//Period after which a new ticket encryption key is generated
+#ifndef TLS_TICKET_KEY_LIFETIME
+   #define TLS_TICKET_KEY_LIFETIME TLS_TICKET_LIFETIME
+#elif (TLS_TICKET_KEY_LIFETIME < TLS_TICKET_LIFETIME)
+   #error TLS_TICKET_KEY_LIFETIME parameter is invalid
+#endif
+
+//Maximum size of the tickets a client can store
+#ifndef TLS_MAX_TICKET_SIZE
+   #define TLS_MAX_TICKET_SIZE 256
+#elif (TLS_MAX_TICKET_SIZE < 128 || TLS_MAX_TICKET_SIZE > 65535)
+   #error TLS_MAX_TICKET_SIZE parameter is invalid
+#endif
+
+//0-RTT data (TLS 1.3)
+#ifndef TLS_EARLY_DATA_SUPPORT
+   #define TLS_EARLY_DATA_SUPPORT DISABLED
+#elif (TLS_EARLY_DATA_SUPPORT != ENABLED && TLS_EARLY_DATA_SUPPORT != DISABLED)
+   #error TLS_EARLY_DATA_SUPPORT parameter is invalid
+#elif (TLS_EARLY_DATA_SUPPORT == ENABLED && (TLS_TICKET_SUPPORT != ENABLED || \
+   TLS_MAX_VERSION < TLS_VERSION_1_3))
+   #error TLS_EARLY_DATA_SUPPORT requires TLS_TICKET_SUPPORT and TLS 1.3
+#endif
+
+//Maximum age difference tolerated when accepting 0-RTT data
+#ifndef TLS_EARLY_DATA_MAX_SKEW
+   #define TLS_EARLY_DATA_MAX_SKEW 10000
+#elif (TLS_EARLY_DATA_MAX_SKEW < 0)
+   #error TLS_EARLY_DATA_MAX_SKEW parameter is invalid
+#endif
+
+//Crypto worker support
+#ifndef TLS_CRYPTO_WORKER_SUPPORT
+   #define TLS_CRYPTO_WORKER_SUPPORT DISABLED
+#elif (TLS_CRYPTO_WORKER_SUPPORT != ENABLED && TLS_CRYPTO_WORKER_SUPPORT != DISABLED)
+   #error TLS_CRYPTO_WORKER_SUPPORT parameter is invalid
+#endif
+
+//Number of crypto worker tasks
+#ifndef TLS_CRYPTO_WORKER_COUNT
+   #define TLS_CRYPTO_WORKER_COUNT 1
+#elif (TLS_CRYPTO_WORKER_COUNT < 1)
+   #error TLS_CRYPTO_WORKER_COUNT parameter is invalid
+#endif
+
+//Maximum number of pending crypto jobs
+#ifndef TLS_CRYPTO_WORKER_QUEUE_SIZE
+   #define TLS_CRYPTO_WORKER_QUEUE_SIZE 4
+#elif (TLS_CRYPTO_WORKER_QUEUE_SIZE < 1)
+   #error TLS_CRYPTO_WORKER_QUEUE_SIZE parameter is invalid
+#endif
+
+//Stack size required to run a crypto worker task
+#ifndef TLS_CRYPTO_WORKER_STACK_SIZE
+   #define TLS_CRYPTO_WORKER_STACK_SIZE 800
+#elif (TLS_CRYPTO_WORKER_STACK_SIZE < 1)
+   #error TLS_CRYPTO_WORKER_STACK_SIZE parameter is invalid
+#endif
+
+//Priority at which the crypto worker tasks should run
+#ifndef TLS_CRYPTO_WORKER_PRIORITY
+   #define TLS_CRYPTO_WORKER_PRIORITY 1
+#elif (TLS_CRYPTO_WORKER_PRIORITY < 0)
+   #error TLS_CRYPTO_WORKER_PRIORITY parameter is invalid
+#endif
+
+//Maximum time to wait for a free slot in the job queue
+#ifndef TLS_CRYPTO_WORKER_TIMEOUT
+   #define TLS_CRYPTO_WORKER_TIMEOUT 5000
+#elif (TLS_CRYPTO_WORKER_TIMEOUT < 0)
+   #error TLS_CRYPTO_WORKER_TIMEOUT parameter is invalid
+#endif
+
+//Pool of precomputed Diffie-Hellman key pairs
+#ifndef TLS_DH_KEY_POOL_SUPPORT
+   #define TLS_DH_KEY_POOL_SUPPORT DISABLED
+#elif (TLS_DH_KEY_POOL_SUPPORT != ENABLED && TLS_DH_KEY_POOL_SUPPORT != DISABLED)
+   #error TLS_DH_KEY_POOL_SUPPORT parameter is invalid
+#endif
+
+//Number of precomputed Diffie-Hellman key pairs
+#ifndef TLS_DH_KEY_POOL_SIZE
+   #define TLS_DH_KEY_POOL_SIZE 2
+#elif (TLS_DH_KEY_POOL_SIZE < 1)
+   #error TLS_DH_KEY_POOL_SIZE parameter is invalid
+#endif
+
+//Lifetime of a precomputed key pair (0 means each pair is used only once)
+#ifndef TLS_DH_KEY_POOL_LIFETIME
+   #define TLS_DH_KEY_POOL_LIFETIME 0
+#elif (TLS_DH_KEY_POOL_LIFETIME < 0)
+   #error TLS_DH_KEY_POOL_LIFETIME parameter is invalid
+#endif
+
+//Stack size required to run the key generation task
+#ifndef TLS_DH_KEY_POOL_STACK_SIZE
+   #define TLS_DH_KEY_POOL_STACK_SIZE 500
+#elif (TLS_DH_KEY_POOL_STACK_SIZE < 1)
+   #error TLS_DH_KEY_POOL_STACK_SIZE parameter is invalid
+#endif
+
+//Priority at which the key generation task should run
+#ifndef TLS_DH_KEY_POOL_PRIORITY
+   #define TLS_DH_KEY_POOL_PRIORITY 0
+#elif (TLS_DH_KEY_POOL_PRIORITY < 0)
+   #error TLS_DH_KEY_POOL_PRIORITY parameter is invalid
+#endif
+
+//Cache of the certificate chains successfully validated by the client
+#ifndef TLS_CERT_CACHE_SUPPORT
+   #define TLS_CERT_CACHE_SUPPORT DISABLED
+#elif (TLS_CERT_CACHE_SUPPORT != ENABLED && TLS_CERT_CACHE_SUPPORT != DISABLED)
+   #error TLS_CERT_CACHE_SUPPORT parameter is invalid
+#endif
+
+//Lifetime of a validated certificate chain
+#ifndef TLS_CERT_CACHE_LIFETIME
+   #define TLS_CERT_CACHE_LIFETIME 3600000
+#elif (TLS_CERT_CACHE_LIFETIME < 1000)
+   #error TLS_CERT_CACHE_LIFETIME parameter is invalid
+#endif
+
+//False Start support (RFC 7918)
+#ifndef TLS_FALSE_START_SUPPORT
+   #define TLS_FALSE_START_SUPPORT DISABLED
+#elif (TLS_FALSE_START_SUPPORT != ENABLED && TLS_FALSE_START_SUPPORT != DISABLED)
+   #error TLS_FALSE_START_SUPPORT parameter is invalid
+#endif
+
+//Per-context random number generator seeded from the application PRNG
+#ifndef TLS_CTR_DRBG_SUPPORT
+   #define TLS_CTR_DRBG_SUPPORT DISABLED
+#elif (TLS_CTR_DRBG_SUPPORT != ENABLED && TLS_CTR_DRBG_SUPPORT != DISABLED)
+   #error TLS_CTR_DRBG_SUPPORT parameter is invalid
+#endif
+
+//Per-phase profiling of the handshake and of the record layer
+#ifndef TLS_PROFILING_SUPPORT
+   #define TLS_PROFILING_SUPPORT DISABLED
+#elif (TLS_PROFILING_SUPPORT != ENABLED && TLS_PROFILING_SUPPORT != DISABLED)
+   #error TLS_PROFILING_SUPPORT parameter is invalid
+#endif
+
+//Time base used for profiling (may be redefined as a cycle counter)
+#ifndef TLS_PROFILE_GET_TIME
+   #define TLS_PROFILE_GET_TIME() ((uint32_t) osGetTickCount())
+#endif
+
 //SNI (Server Name Indication) extension
 #ifndef TLS_SNI_SUPPORT
    #define TLS_SNI_SUPPORT ENABLED
@@ -106,6 +295,27 @@
    #error TLS_SNI_SUPPORT parameter is invalid
 #endif
 
+//MaxFragmentLength extension (RFC 6066)
+#ifndef TLS_MAX_FRAG_LENGTH_SUPPORT
+   #define TLS_MAX_FRAG_LENGTH_SUPPORT ENABLED
+#elif (TLS_MAX_FRAG_LENGTH_SUPPORT != ENABLED && TLS_MAX_FRAG_LENGTH_SUPPORT != DISABLED)
+   #error TLS_MAX_FRAG_LENGTH_SUPPORT parameter is invalid
+#endif
+
+//RecordSizeLimit extension (RFC 8449)
+#ifndef TLS_RECORD_SIZE_LIMIT_SUPPORT
+   #define TLS_RECORD_SIZE_LIMIT_SUPPORT ENABLED
+#elif (TLS_RECORD_SIZE_LIMIT_SUPPORT != ENABLED && TLS_RECORD_SIZE_LIMIT_SUPPORT != DISABLED)
+   #error TLS_RECORD_SIZE_LIMIT_SUPPORT parameter is invalid
+#endif
+
+//ALPN extension (RFC 7301)
+#ifndef TLS_ALPN_SUPPORT
+   #define TLS_ALPN_SUPPORT DISABLED
+#elif (TLS_ALPN_SUPPORT != ENABLED && TLS_ALPN_SUPPORT != DISABLED)
+   #error TLS_ALPN_SUPPORT parameter is invalid
+#endif
+
 //Maximum number of certificates the end entity can load
 #ifndef TLS_MAX_CERTIFICATES
    #define TLS_MAX_CERTIFICATES 3
@@ -113,13 +323,36 @@
    #error TLS_MAX_CERTIFICATES parameter is invalid
 #endif
 
-//Maximum message length that can be handled by the higher-level protocol
+//Default maximum message length that can be handled by the higher-level protocol
 #ifndef TLS_MAX_PROTOCOL_DATA_LENGTH
    #define TLS_MAX_PROTOCOL_DATA_LENGTH 16384
 #elif (TLS_MAX_PROTOCOL_DATA_LENGTH < 4096)
    #error TLS_MAX_PROTOCOL_DATA_LENGTH parameter is invalid
 #endif
 
+//Non-blocking operation (handshake and record layer resume where they stopped)
+#ifndef TLS_NON_BLOCKING_SUPPORT
+   #define TLS_NON_BLOCKING_SUPPORT DISABLED
+#elif (TLS_NON_BLOCKING_SUPPORT != ENABLED && TLS_NON_BLOCKING_SUPPORT != DISABLED)
+   #error TLS_NON_BLOCKING_SUPPORT parameter is invalid
+#elif (TLS_NON_BLOCKING_SUPPORT == ENABLED && TLS_BSD_SOCKET_SUPPORT == ENABLED)
+   #error TLS_NON_BLOCKING_SUPPORT requires the native socket API
+#endif
+
+//Maximum time to wait for the socket when pending data must be flushed
+#ifndef TLS_FLUSH_TIMEOUT
+   #define TLS_FLUSH_TIMEOUT 10000
+#elif (TLS_FLUSH_TIMEOUT < 0)
+   #error TLS_FLUSH_TIMEOUT parameter is invalid
+#endif
+
+//Size of the read-ahead buffer (0 disables read-ahead)
+#ifndef TLS_READ_AHEAD_SIZE
+   #define TLS_READ_AHEAD_SIZE 1024
+#elif (TLS_READ_AHEAD_SIZE < 0)
+   #error TLS_READ_AHEAD_SIZE parameter is invalid
+#endif
+
 //RSA key exchange support
 #ifndef TLS_RSA_SUPPORT
    #define TLS_RSA_SUPPORT ENABLED
@@ -148,6 +381,20 @@
    #error TLS_DH_ANON_SUPPORT parameter is invalid
 #endif
 
+//ECDHE_RSA key exchange support
+#ifndef TLS_ECDHE_RSA_SUPPORT
+   #define TLS_ECDHE_RSA_SUPPORT ENABLED
+#elif (TLS_ECDHE_RSA_SUPPORT != ENABLED && TLS_ECDHE_RSA_SUPPORT != DISABLED)
+   #error TLS_ECDHE_RSA_SUPPORT parameter is invalid
+#endif
+
+//ECDHE_ECDSA key exchange support
+#ifndef TLS_ECDHE_ECDSA_SUPPORT
+   #define TLS_ECDHE_ECDSA_SUPPORT ENABLED
+#elif (TLS_ECDHE_ECDSA_SUPPORT != ENABLED && TLS_ECDHE_ECDSA_SUPPORT != DISABLED)
+   #error TLS_ECDHE_ECDSA_SUPPORT parameter is invalid
+#endif
+
 //RSA signature capability
 #ifndef TLS_RSA_SIGN_SUPPORT
    #define TLS_RSA_SIGN_SUPPORT ENABLED
@@ -162,6 +409,13 @@
    #error TLS_DSA_SIGN_SUPPORT parameter is invalid
 #endif
 
+//ECDSA signature capability
+#ifndef TLS_ECDSA_SIGN_SUPPORT
+   #define TLS_ECDSA_SIGN_SUPPORT ENABLED
+#elif (TLS_ECDSA_SIGN_SUPPORT != ENABLED && TLS_ECDSA_SIGN_SUPPORT != DISABLED)
+   #error TLS_ECDSA_SIGN_SUPPORT parameter is invalid
+#endif
+
 //Stream cipher support
 #ifndef TLS_STREAM_CIPHER_SUPPORT
    #define TLS_STREAM_CIPHER_SUPPORT ENABLED
@@ -190,6 +444,13 @@
    #error TLS_GCM_CIPHER_SUPPORT parameter is invalid
 #endif
 
+//ChaCha20Poly1305 support
+#ifndef TLS_CHACHA20_POLY1305_SUPPORT
+   #define TLS_CHACHA20_POLY1305_SUPPORT ENABLED
+#elif (TLS_CHACHA20_POLY1305_SUPPORT != ENABLED && TLS_CHACHA20_POLY1305_SUPPORT != DISABLED)
+   #error TLS_CHACHA20_POLY1305_SUPPORT parameter is invalid
+#endif
+
 //RC4 cipher support
 #ifndef TLS_RC4_SUPPORT
    #define TLS_RC4_SUPPORT ENABLED
@@ -290,13 +551,15 @@
 
 //Maximum record length
 #define TLS_MAX_RECORD_LENGTH 16384
+//Smallest maximum fragment length that can be negotiated
+#define TLS_MIN_RECORD_LENGTH 512
 //Data overhead caused by record encryption
 #define TLS_MAX_RECORD_OVERHEAD 512
 
-//TX buffer size
-#define TLS_TX_BUFFER_SIZE (sizeof(TlsRecord) + TLS_MAX_PROTOCOL_DATA_LENGTH + TLS_MAX_RECORD_OVERHEAD)
-//RX buffer size
-#define TLS_RX_BUFFER_SIZE (TLS_MAX_PROTOCOL_DATA_LENGTH + TLS_MAX_RECORD_OVERHEAD)
+//TX buffer size needed to hold the specified amount of protocol data
+#define TLS_TX_BUFFER_SIZE(n) (sizeof(TlsRecord) + (n) + TLS_MAX_RECORD_OVERHEAD)
+//RX buffer size needed to hold the specified amount of protocol data
+#define TLS_RX_BUFFER_SIZE(n) ((n) + TLS_MAX_RECORD_OVERHEAD)
 
 //Additional dependencies
 #if (TLS_BSD_SOCKET_SUPPORT == DISABLED)
@@ -382,6 +645,8 @@ typedef enum
    TLS_TYPE_SERVER_HELLO         = 2,
    TLS_TYPE_HELLO_VERIFY_REQUEST = 3,
    TLS_TYPE_NEW_SESSION_TICKET   = 4,
+   TLS_TYPE_END_OF_EARLY_DATA    = 5,
+   TLS_TYPE_ENCRYPTED_EXTENSIONS = 8,
    TLS_TYPE_CERTIFICATE          = 11,
    TLS_TYPE_SERVER_KEY_EXCHANGE  = 12,
    TLS_TYPE_CERTIFICATE_REQUEST  = 13,
@@ -391,7 +656,9 @@ typedef enum
    TLS_TYPE_FINISHED             = 20,
    TLS_TYPE_CERTIFICATE_URL      = 21,
    TLS_TYPE_CERTIFICATE_STATUS   = 22,
-   TLS_TYPE_SUPPLEMENTAL_DATA    = 23
+   TLS_TYPE_SUPPLEMENTAL_DATA    = 23,
+   TLS_TYPE_KEY_UPDATE           = 24,
+   TLS_TYPE_MESSAGE_HASH         = 254
 } TlsMessageType;
 
 
@@ -436,12 +703,14 @@ typedef enum
    TLS_ALERT_INTERNAL_ERROR                  = 80,
    TLS_ALERT_USER_CANCELED                   = 90,
    TLS_ALERT_NO_RENEGOTIATION                = 100,
+   TLS_ALERT_MISSING_EXTENSION               = 109,
    TLS_ALERT_UNSUPPORTED_EXTENSION           = 110,
    TLS_ALERT_CERTIFICATE_UNOBTAINABLE        = 111,
    TLS_ALERT_UNRECOGNIZED_NAME               = 112,
    TLS_ALERT_BAD_CERTIFICATE_STATUS_RESPONSE = 113,
    TLS_ALERT_BAD_CERTIFICATE_HASH_VALUE      = 114,
-   TLS_ALERT_UNKNOWN_PSK_IDENTITY            = 115
+   TLS_ALERT_UNKNOWN_PSK_IDENTITY            = 115,
+   TLS_ALERT_CERTIFICATE_REQUIRED            = 116
 } TlsAlertDescription;
 
 
@@ -503,13 +772,14 @@ typedef enum
 
 typedef enum
 {
-   TLS_HASH_ALGO_NONE   = 0,
-   TLS_HASH_ALGO_MD5    = 1,
-   TLS_HASH_ALGO_SHA1   = 2,
-   TLS_HASH_ALGO_SHA224 = 3,
-   TLS_HASH_ALGO_SHA256 = 4,
-   TLS_HASH_ALGO_SHA384 = 5,
-   TLS_HASH_ALGO_SHA512 = 6
+   TLS_HASH_ALGO_NONE      = 0,
+   TLS_HASH_ALGO_MD5       = 1,
+   TLS_HASH_ALGO_SHA1      = 2,
+   TLS_HASH_ALGO_SHA224    = 3,
+   TLS_HASH_ALGO_SHA256    = 4,
+   TLS_HASH_ALGO_SHA384    = 5,
+   TLS_HASH_ALGO_SHA512    = 6,
+   TLS_HASH_ALGO_INTRINSIC = 8
 } TlsHashAlgo;
 
 
@@ -519,10 +789,13 @@ typedef enum
 
 typedef enum
 {
-   TLS_SIGN_ALGO_ANONYMOUS = 0,
-   TLS_SIGN_ALGO_RSA       = 1,
-   TLS_SIGN_ALGO_DSA       = 2,
-   TLS_SIGN_ALGO_ECDSA     = 3
+   TLS_SIGN_ALGO_ANONYMOUS           = 0,
+   TLS_SIGN_ALGO_RSA                 = 1,
+   TLS_SIGN_ALGO_DSA                 = 2,
+   TLS_SIGN_ALGO_ECDSA               = 3,
+   TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA256 = 4, //RFC 8446 (with TLS_HASH_ALGO_INTRINSIC)
+   TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA384 = 5, //RFC 8446 (with TLS_HASH_ALGO_INTRINSIC)
+   TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA512 = 6  //RFC 8446 (with TLS_HASH_ALGO_INTRINSIC)
 } TlsSignatureAlgo;
 
 
@@ -548,11 +821,43 @@ typedef enum
    TLS_EXT_SIGNATURE_ALGORITHMS   = 13,
    TLS_EXT_USE_SRTP               = 14,
    TLS_EXT_HEARTBEAT              = 15,
+   TLS_EXT_ALPN                   = 16,
+   TLS_EXT_RECORD_SIZE_LIMIT      = 28,
    TLS_EXT_SESSION_TICKET         = 35,
+   TLS_EXT_PRE_SHARED_KEY         = 41,
+   TLS_EXT_EARLY_DATA             = 42,
+   TLS_EXT_SUPPORTED_VERSIONS     = 43,
+   TLS_EXT_COOKIE                 = 44,
+   TLS_EXT_PSK_KEY_EXCHANGE_MODES = 45,
+   TLS_EXT_KEY_SHARE              = 51,
    TLS_EXT_RENEGOTIATION_INFO     = 65281
 } TlsExtensionType;
 
 
+/**
+ * @brief Maximum fragment length
+ **/
+
+typedef enum
+{
+   TLS_MAX_FRAG_LENGTH_512  = 1,
+   TLS_MAX_FRAG_LENGTH_1024 = 2,
+   TLS_MAX_FRAG_LENGTH_2048 = 3,
+   TLS_MAX_FRAG_LENGTH_4096 = 4
+} TlsMaxFragLength;
+
+
+/**
+ * @brief PSK key exchange modes
+ **/
+
+typedef enum
+{
+   TLS_PSK_KEY_EXCH_MODE_PSK_KE     = 0,
+   TLS_PSK_KEY_EXCH_MODE_PSK_DHE_KE = 1
+} TlsPskKeyExchMode;
+
+
 /**
  * @brief Name type
  **/
@@ -569,6 +874,7 @@ typedef enum
 
 typedef enum
 {
+   TLS_EC_CURVE_NONE                     = 0,
    TLS_EC_CURVE_SECT163K1                = 1,
    TLS_EC_CURVE_SECT163R1                = 2,
    TLS_EC_CURVE_SECT163R2                = 3,
@@ -594,6 +900,7 @@ typedef enum
    TLS_EC_CURVE_SECP256R1                = 23,
    TLS_EC_CURVE_SECP384R1                = 24,
    TLS_EC_CURVE_SECP521R1                = 25,
+   TLS_EC_CURVE_ECDH_X25519              = 29, //RFC 8422
    TLS_EC_CURVE_ARBITRARY_EXPLICIT_PRIME = 65281,
    TLS_EC_CURVE_ARBITRARY_EXPLICIT_CHAR2 = 65282
 } TlsEcNamedCurve;
@@ -632,20 +939,25 @@ typedef enum
    TLS_STATE_INIT                      = 0,
    TLS_STATE_CLIENT_HELLO              = 1,
    TLS_STATE_SERVER_HELLO              = 2,
-   TLS_STATE_SERVER_CERTIFICATE        = 3,
-   TLS_STATE_SERVER_KEY_EXCHANGE       = 4,
-   TLS_STATE_CERTIFICATE_REQUEST       = 5,
-   TLS_STATE_SERVER_HELLO_DONE         = 6,
-   TLS_STATE_CLIENT_CERTIFICATE        = 7,
-   TLS_STATE_CLIENT_KEY_EXCHANGE       = 8,
-   TLS_STATE_CERTIFICATE_VERIFY        = 9,
-   TLS_STATE_CLIENT_CHANGE_CIPHER_SPEC = 10,
-   TLS_STATE_CLIENT_FINISHED           = 11,
-   TLS_STATE_SERVER_CHANGE_CIPHER_SPEC = 12,
-   TLS_STATE_SERVER_FINISHED           = 13,
-   TLS_STATE_APPLICATION_DATA          = 14,
-   TLS_STATE_CLOSED                    = 15,
-   TLS_STATE_FATAL_ERROR               = 16
+   TLS_STATE_HELLO_RETRY_REQUEST       = 3,
+   TLS_STATE_ENCRYPTED_EXTENSIONS      = 4,
+   TLS_STATE_SERVER_CERTIFICATE        = 5,
+   TLS_STATE_SERVER_KEY_EXCHANGE       = 6,
+   TLS_STATE_CERTIFICATE_REQUEST       = 7,
+   TLS_STATE_SERVER_HELLO_DONE         = 8,
+   TLS_STATE_SERVER_CERTIFICATE_VERIFY = 9,
+   TLS_STATE_END_OF_EARLY_DATA         = 10,
+   TLS_STATE_CLIENT_CERTIFICATE        = 11,
+   TLS_STATE_CLIENT_KEY_EXCHANGE       = 12,
+   TLS_STATE_CERTIFICATE_VERIFY        = 13,
+   TLS_STATE_CLIENT_CHANGE_CIPHER_SPEC = 14,
+   TLS_STATE_CLIENT_FINISHED           = 15,
+   TLS_STATE_NEW_SESSION_TICKET        = 16,
+   TLS_STATE_SERVER_CHANGE_CIPHER_SPEC = 17,
+   TLS_STATE_SERVER_FINISHED           = 18,
+   TLS_STATE_APPLICATION_DATA          = 19,
+   TLS_STATE_CLOSED                    = 20,
+   TLS_STATE_FATAL_ERROR               = 21
 } TlsState;
 
 
@@ -724,6 +1036,18 @@ typedef __packed struct
 } TlsCertificateTypes;
 
 
+/**
+ * @brief Key share entry (TLS 1.3)
+ **/
+
+typedef __packed struct
+{
+   uint16_t group;         //0-1
+   uint16_t length;        //2-3
+   uint8_t keyExchange[];  //4
+} TlsKeyShareEntry;
+
+
 /**
  * @brief Signature algorithm
  **/
@@ -803,6 +1127,28 @@ typedef __packed struct
 } TlsServerNameList;
 
 
+/**
+ * @brief List of supported elliptic curves
+ **/
+
+typedef __packed struct
+{
+   uint16_t length;  //0-1
+   uint16_t value[]; //2
+} TlsEllipticCurveList;
+
+
+/**
+ * @brief List of supported EC point formats
+ **/
+
+typedef __packed struct
+{
+   uint8_t length;  //0
+   uint8_t value[]; //1
+} TlsEcPointFormatList;
+
+
 /**
  * @brief Digitally-signed element (SSL 3.0, TLS 1.0 and TLS 1.1)
  **/
@@ -951,6 +1297,20 @@ typedef __packed struct
 } TlsCertificateVerify;
 
 
+/**
+ * @brief NewSessionTicket message
+ **/
+
+typedef __packed struct
+{
+   uint8_t msgType;             //0
+   uint8_t length[3];           //1-3
+   uint32_t ticketLifetimeHint; //4-7
+   uint16_t ticketLength;       //8-9
+   uint8_t ticket[];            //10
+} TlsNewSessionTicket;
+
+
 /**
  * @brief Finished message
  **/
@@ -1031,34 +1391,316 @@ typedef struct
    uint16_t cipherSuite;      ///<Cipher suite identifier
    uint8_t compressionMethod; ///<Compression method
    uint8_t masterSecret[48];  ///<Master secret
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   uint8_t ticket[TLS_MAX_TICKET_SIZE]; ///<Session ticket
+   size_t ticketLength;       ///<Length of the session ticket
+   uint32_t ticketLifetime;   ///<Lifetime of the session ticket, in seconds
+#endif
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   uint16_t version;          ///<Version negotiated when the session was established
+   uint32_t ticketAgeAdd;     ///<Value added to the age of the ticket (TLS 1.3)
+   time_t ticketTimestamp;    ///<Time at which the ticket was received (TLS 1.3)
+   uint32_t maxEarlyDataSize; ///<Amount of 0-RTT data the server accepts with the ticket
+#endif
 } TlsSession;
 
 
+/**
+ * @brief Session cache entry
+ **/
+
+typedef struct _TlsCacheEntry
+{
+   struct _TlsCacheEntry *hashNext; ///<Next entry in the same hash bucket
+   struct _TlsCacheEntry *lruPrev;  ///<More recently used entry
+   struct _TlsCacheEntry *lruNext;  ///<Less recently used entry
+   TlsSession session;              ///<Session parameters
+} TlsCacheEntry;
+
+
+/**
+ * @brief Session cache shard
+ *
+ * Sessions are indexed by a hash of their identifier. Entries in use are
+ * also linked in least recently used order, so that an entry can be
+ * replaced without scanning the whole shard
+ *
+ **/
+
+typedef struct
+{
+   OsMutex *mutex;           ///<Mutex preventing simultaneous access to the shard
+   uint_t size;              ///<Maximum number of entries
+   uint_t bucketCount;       ///<Number of hash buckets (power of two)
+   TlsCacheEntry **buckets;  ///<Hash buckets
+   TlsCacheEntry *lruHead;   ///<Most recently used entry
+   TlsCacheEntry *lruTail;   ///<Least recently used entry
+   TlsCacheEntry *freeList;  ///<Unused entries
+} TlsCacheShard;
+
+
 /**
  * @brief Session cache
+ *
+ * The session ID hash selects the shard holding a session, so that
+ * handshakes running in different tasks seldom contend for the same lock
+ *
  **/
 
 typedef struct
 {
-   OsMutex *mutex;        ///<Mutex preventing simultaneous access to the cache
-   uint_t size;           ///<Maximum number of entries
-   TlsSession sessions[]; ///<Cache entries
+   uint_t size;                                    ///<Maximum number of entries
+   uint_t shardCount;                              ///<Number of shards in use
+   TlsCacheShard shards[TLS_SESSION_CACHE_SHARDS]; ///<Independently locked shards
+   TlsCacheEntry entries[];                        ///<Cache entries
 } TlsCache;
 
 
+/**
+ * @brief Client-side session cache entry
+ **/
+
+typedef struct
+{
+   bool_t valid;                                  ///<The entry is in use
+   char_t host[TLS_CLIENT_CACHE_MAX_HOST_LEN + 1]; ///<Server name (or IP address)
+   uint16_t port;                                 ///<Server port
+   time_t lastUsed;                               ///<Time at which the entry was last used
+   TlsSession session;                            ///<Session parameters
+} TlsClientCacheEntry;
+
+
+/**
+ * @brief Client-side session cache
+ *
+ * Sessions are indexed by the name and the port of the server, so that
+ * a new TLS context connecting to the same server resumes the last
+ * session automatically. The cache can be shared by all the clients
+ *
+ **/
+
+typedef struct
+{
+   OsMutex *mutex;                 ///<Mutex preventing simultaneous access to the cache
+   uint_t size;                    ///<Maximum number of entries
+   TlsClientCacheEntry entries[];  ///<Cache entries
+} TlsClientCache;
+
+
+/**
+ * @brief Session ticket encryption key
+ **/
+
+typedef struct
+{
+   bool_t valid;         ///<The key has been generated
+   time_t timestamp;     ///<Time at which the key was generated
+   uint8_t name[16];     ///<Name identifying the key
+   uint8_t encKey[16];   ///<AES-128 encryption key
+   uint8_t macKey[32];   ///<HMAC-SHA-256 key
+} TlsTicketKey;
+
+
+/**
+ * @brief Session ticket keys shared by the server contexts
+ **/
+
+typedef struct
+{
+   OsMutex *mutex;       ///<Mutex preventing simultaneous access to the keys
+   uint_t current;       ///<Index of the key used to protect new tickets
+   TlsTicketKey keys[2]; ///<Current and previous ticket keys
+} TlsTicketContext;
+
+
+/**
+ * @brief Profiled phases
+ **/
+
+typedef enum
+{
+   TLS_PROFILE_HANDSHAKE      = 0, ///<Whole handshake
+   TLS_PROFILE_CERTIFICATE    = 1, ///<Parsing and validation of the peer's certificate chain
+   TLS_PROFILE_KEY_EXCHANGE   = 2, ///<Key exchange messages, including RSA and DH operations
+   TLS_PROFILE_KEY_DERIVATION = 3, ///<Master secret and key block computation (PRF)
+   TLS_PROFILE_PEM            = 4, ///<Decoding of the local certificates and private keys
+   TLS_PROFILE_RECORD_WRITE   = 5, ///<Application data records sent, including I/O
+   TLS_PROFILE_RECORD_READ    = 6, ///<Application data records received, including I/O
+   TLS_PROFILE_IO             = 7, ///<Time spent in the underlying socket calls
+   TLS_PROFILE_PHASE_COUNT    = 8
+} TlsProfilePhase;
+
+
+/**
+ * @brief Per-phase profiling counters
+ **/
+
+typedef struct
+{
+   uint32_t count[TLS_PROFILE_PHASE_COUNT]; ///<Number of times each phase has been entered
+   uint32_t time[TLS_PROFILE_PHASE_COUNT];  ///<Cumulative time spent in each phase
+   uint32_t start[TLS_PROFILE_PHASE_COUNT]; ///<Time at which each phase was last entered
+} TlsProfile;
+
+
+//Profiling related macros
+#if (TLS_PROFILING_SUPPORT == ENABLED)
+   #define TLS_PROFILE_START(context, phase) \
+      (context)->profile.start[phase] = TLS_PROFILE_GET_TIME()
+   #define TLS_PROFILE_STOP(context, phase) \
+      (context)->profile.time[phase] += TLS_PROFILE_GET_TIME() - (context)->profile.start[phase], \
+      (context)->profile.count[phase]++
+#else
+   #define TLS_PROFILE_START(context, phase)
+   #define TLS_PROFILE_STOP(context, phase)
+#endif
+
+
+/**
+ * @brief Crypto worker statistics
+ **/
+
+typedef struct
+{
+   uint32_t jobs;         ///<Number of jobs processed
+   uint32_t rejected;     ///<Number of jobs rejected because the queue was full
+   uint32_t queueTime;    ///<Cumulative time spent in the queue, in milliseconds
+   uint32_t runTime;      ///<Cumulative processing time, in milliseconds
+   uint32_t maxQueueTime; ///<Longest time spent in the queue, in milliseconds
+   uint32_t maxRunTime;   ///<Longest processing time, in milliseconds
+} TlsCryptoWorkerStats;
+
+
+/**
+ * @brief Pool of tasks running the handshake public-key operations
+ **/
+
+typedef struct
+{
+   OsQueue *queue;                          ///<Pending crypto jobs
+   OsMutex *mutex;                          ///<Mutex protecting the statistics
+   OsTask *tasks[TLS_CRYPTO_WORKER_COUNT];  ///<Worker tasks
+   TlsCryptoWorkerStats stats;              ///<Statistics
+} TlsCryptoWorker;
+
+
+/**
+ * @brief Precomputed Diffie-Hellman key pair
+ **/
+
+typedef struct
+{
+   bool_t valid;     ///<The key pair can be used
+   time_t timestamp; ///<Time at which the key pair was generated
+   Mpi xa;           ///<Private value
+   Mpi ya;           ///<Public value
+} TlsDhKeyPair;
+
+
+/**
+ * @brief Pool of Diffie-Hellman key pairs generated in the background
+ **/
+
+typedef struct
+{
+   OsMutex *mutex;                           ///<Mutex preventing simultaneous access to the pool
+   OsEvent *event;                           ///<Event signaling that the pool must be refilled
+   OsTask *task;                             ///<Key generation task
+   const PrngAlgo *prngAlgo;                 ///<Pseudo-random number generator to be used
+   void *prngContext;                        ///<Pseudo-random number generator context
+   DhParameters params;                      ///<Diffie-Hellman parameters
+   uint_t index;                             ///<Index of the next key pair to use
+   TlsDhKeyPair pairs[TLS_DH_KEY_POOL_SIZE]; ///<Precomputed key pairs
+} TlsDhKeyPool;
+
+
+/**
+ * @brief Trusted CA certificate
+ **/
+
+typedef struct _TlsTrustedCa
+{
+   struct _TlsTrustedCa *next; ///<Next CA whose subject has the same hash value
+   const uint8_t *derCert;     ///<DER encoded certificate
+   size_t derCertLength;       ///<Length of the certificate
+   const uint8_t *subject;     ///<DER encoded subject name
+   size_t subjectLength;       ///<Length of the subject name
+} TlsTrustedCa;
+
+
+/**
+ * @brief Trusted CA store
+ *
+ * The trusted CA certificates are decoded once for all and indexed by
+ * a hash of their subject name, so that the issuer of a certificate can
+ * be found without parsing the whole list. The store is never modified
+ * once created and can be shared by several TLS contexts
+ *
+ **/
+
+typedef struct
+{
+   uint_t count;           ///<Number of trusted CA certificates
+   uint_t bucketCount;     ///<Number of hash buckets (power of two)
+   TlsTrustedCa **buckets; ///<Hash buckets
+   TlsTrustedCa cas[];     ///<Trusted CA certificates
+} TlsCaStore;
+
+
+/**
+ * @brief Validated certificate chain
+ **/
+
+typedef struct
+{
+   bool_t valid;                          ///<The entry is in use
+   time_t timestamp;                      ///<Time at which the chain was validated
+   time_t lastUsed;                       ///<Time at which the entry was last used
+   uint8_t digest[SHA256_DIGEST_SIZE];    ///<Digest of the certificate list
+   const char_t *trustedCaList;           ///<Trusted CA list used to validate the chain
+   const TlsCaStore *caStore;             ///<Trusted CA store used to validate the chain
+} TlsCertCacheEntry;
+
+
+/**
+ * @brief Cache of validated certificate chains
+ *
+ * A client that connects repeatedly to the same servers is presented the
+ * same certificate chains. The digest of each chain that passed the PKIX
+ * path validation is recorded, so that the signatures of an unchanged
+ * chain do not need to be verified again
+ *
+ **/
+
+typedef struct
+{
+   OsMutex *mutex;                ///<Mutex preventing simultaneous access to the cache
+   uint_t size;                   ///<Maximum number of entries
+   TlsCertCacheEntry entries[];   ///<Cache entries
+} TlsCertCache;
+
+
 /**
  * @brief Certificate descriptor
  **/
 
 typedef struct
 {
-   const char_t *certChain;   ///<End entity certificate chain (PEM format)
-   size_t certChainLength;    ///<Length of the certificate chain
-   const char_t *privateKey;  ///<Private key (PEM format)
-   size_t privateKeyLength;   ///<Length of the private key
-   TlsCertificateType type;   ///<End entity certificate type
-   TlsSignatureAlgo signAlgo; ///<Signature algorithm used to sign the end entity certificate
-   TlsHashAlgo hashAlgo;      ///<Hash algorithm used to sign the end entity certificate
+   const char_t *certChain;     ///<End entity certificate chain (PEM format)
+   size_t certChainLength;      ///<Length of the certificate chain
+   const char_t *privateKey;    ///<Private key (PEM format)
+   size_t privateKeyLength;     ///<Length of the private key
+   TlsCertificateType type;     ///<End entity certificate type
+   TlsSignatureAlgo signAlgo;   ///<Signature algorithm used to sign the end entity certificate
+   TlsHashAlgo hashAlgo;        ///<Hash algorithm used to sign the end entity certificate
+   RsaPrivateKey rsaPrivateKey; ///<RSA private key, decoded once when the certificate is loaded
+   DsaPrivateKey dsaPrivateKey; ///<DSA private key, decoded once when the certificate is loaded
+   EcDomainParameters ecParams; ///<EC domain parameters of the ECDSA private key
+   Mpi ecPrivateKey;            ///<ECDSA private key, decoded once when the certificate is loaded
+   uint8_t *certList;           ///<DER encoded certificate list, ready to be sent
+   size_t certListLength;       ///<Length of the certificate list
+   const uint8_t *rootIssuer;   ///<Issuer of the last certificate of the chain
+   size_t rootIssuerLength;     ///<Length of the issuer distinguished name
 } TlsCertDesc;
 
 
@@ -1077,13 +1719,22 @@ typedef struct
 
    const PrngAlgo *prngAlgo;                ///<Pseudo-random number generator to be used
    void *prngContext;                       ///<Pseudo-random number generator context
+#if (TLS_CTR_DRBG_SUPPORT == ENABLED)
+   CtrDrbgContext prngChild;                ///<Private generator reseeded from the application PRNG
+#endif
 
    const uint16_t *cipherSuites;            ///<List of supported cipher suites
    uint_t numCipherSuites;                  ///<Number of cipher suites in the list
 
    char_t *serverName;                      ///<Fully qualified DNS hostname of the server
 
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   char_t *protocolList;                    ///<Application protocols accepted by the server, by order of preference
+   char_t *selectedProtocol;                ///<Application protocol negotiated during the handshake
+#endif
+
    DhParameters dhParameters;               ///<Diffie-Hellman parameters
+   EcdhContext ecdhContext;                 ///<ECDH context
 
    TlsCertDesc certs[TLS_MAX_CERTIFICATES]; //End entity certificates
    uint_t numCerts;                         //Number of certificates available
@@ -1091,17 +1742,44 @@ typedef struct
 
    const char_t *trustedCaList;             ///<List of trusted CA (PEM format)
    size_t trustedCaListLength;              ///<Number of trusted CA in the list
+   const TlsCaStore *caStore;               ///<Indexed trusted CA store
+#if (TLS_CERT_CACHE_SUPPORT == ENABLED)
+   TlsCertCache *certCache;                 ///<Validated certificate chains (client only)
+#endif
 
    TlsCertificateType peerCertType;         ///<Peer certificate type
    RsaPublicKey peerRsaPublicKey;           ///<Peer RSA public key
    DsaPublicKey peerDsaPublicKey;           ///<Peer DSA public key
+   EcDomainParameters peerEcParams;         ///<Peer EC domain parameters
+   EcPoint peerEcPublicKey;                 ///<Peer EC public key
 
    TlsCache *cache;                         ///<TLS session cache
+#if (TLS_CLIENT_CACHE_SUPPORT == ENABLED)
+   TlsClientCache *clientCache;             ///<Sessions indexed by server name and port (client only)
+#endif
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   TlsTicketContext *ticketContext;         ///<Keys used to protect session tickets (server only)
+   bool_t newSessionTicket;                 ///<A NewSessionTicket message is part of the handshake
+   uint8_t ticket[TLS_MAX_TICKET_SIZE];     ///<Session ticket (client only)
+   size_t ticketLength;                     ///<Length of the session ticket
+   uint32_t ticketLifetime;                 ///<Lifetime of the session ticket, in seconds
+#endif
+#if (TLS_CRYPTO_WORKER_SUPPORT == ENABLED)
+   TlsCryptoWorker *cryptoWorker;           ///<Tasks running the public-key operations
+   OsEvent *cryptoEvent;                    ///<Event signaling the completion of a crypto job
+#endif
+#if (TLS_DH_KEY_POOL_SUPPORT == ENABLED)
+   TlsDhKeyPool *dhKeyPool;                 ///<Precomputed Diffie-Hellman key pairs (server only)
+#endif
 
    uint8_t sessionId[32];                   ///<Session identifier
    size_t sessionIdLength;                  ///<Length of the session identifier
 
    bool_t resume;                           ///<This flag tells whether the connection is established by resuming a session
+#if (TLS_FALSE_START_SUPPORT == ENABLED)
+   bool_t falseStartEnabled;                ///<The application accepts to use False Start (client only)
+   bool_t falseStart;                       ///<Application data may flow before the server's Finished message (client only)
+#endif
    uint16_t clientVersion;                  ///<Latest version supported by the client
    uint16_t version;                        ///<Negotiated TLS version
    uint16_t cipherSuite;                    ///<Negotiated cipher suite
@@ -1109,6 +1787,7 @@ typedef struct
 
    TlsHashAlgo signHashAlgo;                ///<Hash algorithm used for signing
    TlsKeyExchMethod keyExchMethod;          ///<Key exchange method
+   uint16_t namedCurve;                     ///<Named curve used for ECDHE key exchange
    const CipherAlgo *cipherAlgo;            ///<Bulk cipher algorithm
    CipherMode cipherMode;                   ///<Cipher mode of operation
    const HashAlgo *hashAlgo;                ///<Hash algorithm for MAC operations
@@ -1136,15 +1815,36 @@ typedef struct
    HmacContext hmacContext;                 ///<HMAC context
 
    uint8_t *txBuffer;                       ///<TX buffer
+   size_t txBufferSize;                     ///<Maximum length of the protocol data the TX buffer can hold
    TlsContentType txBufferType;             ///<Type of data that resides in the TX buffer
    size_t txBufferLength;                   ///<Number of bytes that are pending to be sent
 
    uint8_t *rxBuffer;                       ///<RX buffer
+   size_t rxBufferSize;                     ///<Maximum length of the protocol data the RX buffer can hold
    TlsContentType rxBufferType;             ///<Type of data that resides in the RX buffer
    size_t rxBufferLength;                   ///<Number of bytes available for reading
    size_t rxBufferWriteIndex;               ///<Current write index
    size_t rxBufferReadIndex;                ///<Current read index
 
+   size_t maxFragLength;                    ///<Maximum fragment length (requested or negotiated)
+   size_t recordSizeLimit;                  ///<Maximum record size the peer is willing to receive
+   bool_t recordSizeLimitExt;               ///<The peer sent a RecordSizeLimit extension
+
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+   bool_t nonBlocking;                      ///<Operations return instead of waiting for the socket
+   bool_t handshakePending;                 ///<The handshake stopped on a would-block condition
+   TlsRecord rxRecord;                      ///<Header of the record being received
+   size_t rxRecordPos;                      ///<Number of bytes of the current record received so far
+   const uint8_t *txPending;                ///<Part of the last record the socket has not accepted yet
+   size_t txPendingLength;                  ///<Number of bytes pending to be sent
+#endif
+
+#if (TLS_READ_AHEAD_SIZE > 0)
+   uint8_t readAhead[TLS_READ_AHEAD_SIZE];  ///<Data received from the socket but not consumed yet
+   size_t readAheadPos;                     ///<Current read position in the read-ahead buffer
+   size_t readAheadLength;                  ///<Number of bytes pending in the read-ahead buffer
+#endif
+
    union
    {
       struct
@@ -1161,6 +1861,8 @@ typedef struct
    uint8_t keyBlock[192];                   ///<Key material
    uint8_t *writeMacKey;                    ///<Write MAC key
    uint8_t *readMacKey;                     ///<Read MAC key
+   HmacKey writeHmacKey;                    ///<Precomputed write MAC key
+   HmacKey readHmacKey;                     ///<Precomputed read MAC key
    uint8_t *writeEncKey;                    ///<Encryption key that serves for write operations
    uint8_t *readEncKey;                     ///<Encryption key that serves for read operations
    uint8_t *writeIv;                        ///<Write IV
@@ -1168,6 +1870,39 @@ typedef struct
 
    TlsSequenceNumber writeSeqNum;           ///<Write sequence number
    TlsSequenceNumber readSeqNum;            ///<Read sequence number
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   bool_t helloRetryRequest;                ///<A HelloRetryRequest message has been exchanged
+   uint16_t sessionVersion;                 ///<Version of the session being resumed (client only)
+   uint16_t signScheme;                     ///<Signature scheme used in the CertificateVerify message
+   uint8_t certRequestContext[32];          ///<Context of the CertificateRequest message (client only)
+   size_t certRequestContextLength;         ///<Length of the certificate request context
+   uint8_t *cookie;                         ///<Cookie sent by the server in a HelloRetryRequest
+   size_t cookieLength;                     ///<Length of the cookie
+   uint32_t ticketAgeAdd;                   ///<Value added to the age of the ticket
+   time_t ticketTimestamp;                  ///<Time at which the ticket was received or issued
+   bool_t pskOffered;                       ///<The ClientHello carries a pre_shared_key extension (client only)
+   uint8_t secret[48];                      ///<Current secret of the key schedule
+   uint8_t clientHsTrafficSecret[48];       ///<Client handshake traffic secret
+   uint8_t serverHsTrafficSecret[48];       ///<Server handshake traffic secret
+   uint8_t clientAppTrafficSecret[48];      ///<Client application traffic secret
+   uint8_t serverAppTrafficSecret[48];      ///<Server application traffic secret
+   uint8_t resumptionMasterSecret[48];      ///<Secret from which the session tickets derive their PSK
+#endif
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   uint32_t maxEarlyDataSize;               ///<Amount of 0-RTT data accepted per session (server only)
+   uint32_t sessionMaxEarlyDataSize;        ///<Amount of 0-RTT data the resumed session allows
+   bool_t earlyDataEnabled;                 ///<0-RTT data have been offered
+   bool_t earlyDataAccepted;                ///<0-RTT data have been accepted by the server
+   bool_t earlyDataRejected;                ///<0-RTT data offered by the client must be skipped (server only)
+   size_t earlyDataLength;                  ///<Amount of 0-RTT data sent or received
+   uint8_t *earlyData;                      ///<0-RTT data received before the end of the handshake (server only)
+   size_t earlyDataPos;                     ///<Number of 0-RTT bytes already returned to the application
+#endif
+
+#if (TLS_PROFILING_SUPPORT == ENABLED)
+   TlsProfile profile;                      ///<Per-phase time counters
+#endif
 } TlsContext;
 
 
@@ -1178,25 +1913,67 @@ error_t tlsSetSocket(TlsContext *context, TlsSocket socket);
 error_t tlsSetConnectionEnd(TlsContext *context, TlsConnectionEnd entity);
 error_t tlsSetPrng(TlsContext *context, const PrngAlgo *prngAlgo, void *prngContext);
 error_t tlsSetServerName(TlsContext *context, const char_t *serverName);
+error_t tlsSetAlpnProtocolList(TlsContext *context, const char_t *protocolList);
+error_t tlsSetBufferSize(TlsContext *context, size_t txBufferSize, size_t rxBufferSize);
+error_t tlsSetMaxFragmentLength(TlsContext *context, size_t maxFragLength);
 error_t tlsSetCache(TlsContext *context, TlsCache *cache);
+error_t tlsSetClientCache(TlsContext *context, TlsClientCache *clientCache);
+error_t tlsSetTicketContext(TlsContext *context, TlsTicketContext *ticketContext);
+error_t tlsSetCryptoWorker(TlsContext *context, TlsCryptoWorker *cryptoWorker);
+error_t tlsSetDhKeyPool(TlsContext *context, TlsDhKeyPool *dhKeyPool);
+error_t tlsSetFalseStart(TlsContext *context, bool_t enabled);
+error_t tlsSetNonBlocking(TlsContext *context, bool_t enabled);
 error_t tlsSetClientAuthMode(TlsContext *context, TlsClientAuthMode mode);
 error_t tlsSetCipherSuites(TlsContext *context, const uint16_t *cipherSuites, uint_t length);
 error_t tlsSetDhParameters(TlsContext *context, const char_t *params, size_t length);
 error_t tlsSetTrustedCaList(TlsContext *context, const char_t *trustedCaList, size_t length);
+error_t tlsSetCaStore(TlsContext *context, const TlsCaStore *caStore);
+error_t tlsSetCertCache(TlsContext *context, TlsCertCache *certCache);
+error_t tlsSetMaxEarlyDataSize(TlsContext *context, uint32_t maxEarlyDataSize);
 
 error_t tlsAddCertificate(TlsContext *context, const char_t *certChain,
    size_t certChainLength, const char_t *privateKey, size_t privateKeyLength);
 
 error_t tlsConnect(TlsContext *context);
+error_t tlsWriteEarlyData(TlsContext *context, const void *data,
+   size_t length, size_t *written, uint_t flags);
 error_t tlsWrite(TlsContext *context, const void *data, size_t length, uint_t flags);
 error_t tlsRead(TlsContext *context, void *data, size_t size, size_t *received, uint_t flags);
+error_t tlsFlush(TlsContext *context);
 error_t tlsShutdown(TlsContext *context);
 void tlsFree(TlsContext *context);
 
+error_t tlsGetProfile(const TlsContext *context, TlsProfile *profile);
+error_t tlsGetMemUsage(const TlsContext *context, size_t *size);
+const char_t *tlsGetAlpnProtocol(const TlsContext *context);
+bool_t tlsIsRxReady(const TlsContext *context);
+bool_t tlsIsEarlyDataAccepted(const TlsContext *context);
+
 error_t tlsSaveSession(const TlsContext *context, TlsSession *session);
 error_t tlsRestoreSession(TlsContext *context, const TlsSession *session);
 
 TlsCache *tlsInitCache(uint_t size);
 void tlsFreeCache(TlsCache *cache);
 
+TlsClientCache *tlsInitClientCache(uint_t size);
+void tlsFreeClientCache(TlsClientCache *clientCache);
+
+TlsTicketContext *tlsInitTicketContext(void);
+void tlsFreeTicketContext(TlsTicketContext *ticketContext);
+
+TlsCryptoWorker *tlsInitCryptoWorker(void);
+error_t tlsGetCryptoWorkerStats(TlsCryptoWorker *cryptoWorker, TlsCryptoWorkerStats *stats);
+void tlsFreeCryptoWorker(TlsCryptoWorker *cryptoWorker);
+
+TlsDhKeyPool *tlsInitDhKeyPool(const char_t *params, size_t length,
+   const PrngAlgo *prngAlgo, void *prngContext);
+void tlsFreeDhKeyPool(TlsDhKeyPool *dhKeyPool);
+
+TlsCaStore *tlsInitCaStore(const char_t *trustedCaList, size_t length);
+void tlsFreeCaStore(TlsCaStore *caStore);
+
+TlsCertCache *tlsInitCertCache(uint_t size);
+void tlsFlushCertCache(TlsCertCache *certCache);
+void tlsFreeCertCache(TlsCertCache *certCache);
+
 #endif
@@ -0,0 +1,1241 @@
+/**
+ * @file tls13_client.c
+ * @brief TLS 1.3 client
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Client side of the TLS 1.3 handshake: ClientHello extensions, processing
+ * of the server's flight, PSK resumption and 0-RTT data. Refer to RFC 8446
+ * for more details
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_cipher_suites.h"
+#include "tls_client.h"
+#include "tls_common.h"
+#include "tls_record.h"
+#include "tls_misc.h"
+#include "tls_client_cache.h"
+#include "tls13_misc.h"
+#include "tls13_common.h"
+#include "tls13_client.h"
+#include "debug.h"
+
+//Check SSL library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_CLIENT_SUPPORT == ENABLED && \
+   TLS_MAX_VERSION >= TLS_VERSION_1_3)
+
+
+/**
+ * @brief Process the current state of the TLS 1.3 client handshake
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13ClientHandshakeStep(TlsContext *context)
+{
+   error_t error;
+
+   //The TLS 1.3 handshake is implemented as a state machine
+   //representing the current location in the protocol
+   switch(context->state)
+   {
+   //Send ClientHello message?
+   case TLS_STATE_CLIENT_HELLO:
+      //The client sends a second ClientHello in response
+      //to a HelloRetryRequest message
+      error = tlsSendClientHello(context);
+      break;
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   //Send EndOfEarlyData message?
+   case TLS_STATE_END_OF_EARLY_DATA:
+      //The 0-RTT data accepted by the server are terminated
+      //by an EndOfEarlyData message
+      error = tls13SendEndOfEarlyData(context);
+      break;
+#endif
+   //Send Certificate message?
+   case TLS_STATE_CLIENT_CERTIFICATE:
+      //This message is only sent if the server requests a certificate
+      error = tls13SendCertificate(context);
+      break;
+   //Send CertificateVerify message?
+   case TLS_STATE_CERTIFICATE_VERIFY:
+      //The client proves the possession of the private key
+      TLS_PROFILE_START(context, TLS_PROFILE_KEY_EXCHANGE);
+      error = tls13SendCertificateVerify(context);
+      TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_EXCHANGE);
+      break;
+   //Send Finished message?
+   case TLS_STATE_CLIENT_FINISHED:
+      //The Finished message concludes the handshake
+      error = tls13SendFinished(context);
+      break;
+   //Wait for a message from the server?
+   case TLS_STATE_SERVER_HELLO:
+   case TLS_STATE_ENCRYPTED_EXTENSIONS:
+   case TLS_STATE_SERVER_CERTIFICATE:
+   case TLS_STATE_SERVER_CERTIFICATE_VERIFY:
+   case TLS_STATE_SERVER_FINISHED:
+      //Parse incoming handshake message
+      error = tls13ParseServerMessage(context);
+      break;
+   //A fatal error was encountered?
+   case TLS_STATE_FATAL_ERROR:
+      //Debug message
+      TRACE_WARNING("TLS handshake failure!\r\n");
+      //Terminate immediately the connection
+      error = ERROR_HANDSHAKE_FAILED;
+      break;
+   //Invalid state?
+   default:
+      //Report an error and exit immediately
+      error = ERROR_UNEXPECTED_STATE;
+      break;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Parse incoming handshake message (TLS 1.3)
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13ParseServerMessage(TlsContext *context)
+{
+   error_t error;
+   size_t length;
+   void *message;
+   TlsContentType contentType;
+
+   //A message can be fragmented across several records...
+   error = tlsReadProtocolData(context, &message, &length, &contentType);
+   //Any error to report?
+   if(error) return error;
+
+   //Handshake message received?
+   if(contentType == TLS_TYPE_HANDSHAKE)
+   {
+      //Check handshake message type
+      switch(((TlsHandshake *) message)->msgType)
+      {
+      //ServerHello message received?
+      case TLS_TYPE_SERVER_HELLO:
+         //The version is confirmed by the SupportedVersions extension
+         error = tlsParseServerHello(context, message, length);
+         break;
+      //EncryptedExtensions message received?
+      case TLS_TYPE_ENCRYPTED_EXTENSIONS:
+         //This message is the first one protected with the
+         //handshake traffic keys
+         error = tls13ParseEncryptedExtensions(context, message, length);
+         break;
+      //CertificateRequest message received?
+      case TLS_TYPE_CERTIFICATE_REQUEST:
+         //The server requests client authentication
+         error = tls13ParseCertificateRequest(context, message, length);
+         break;
+      //Certificate message received?
+      case TLS_TYPE_CERTIFICATE:
+         //The server sends its certificate chain unless a PSK is used
+         TLS_PROFILE_START(context, TLS_PROFILE_CERTIFICATE);
+         error = tlsParseCertificate(context, message, length);
+         TLS_PROFILE_STOP(context, TLS_PROFILE_CERTIFICATE);
+         break;
+      //CertificateVerify message received?
+      case TLS_TYPE_CERTIFICATE_VERIFY:
+         //The server proves the possession of its private key
+         TLS_PROFILE_START(context, TLS_PROFILE_KEY_EXCHANGE);
+         error = tls13ParseCertificateVerify(context, message, length);
+         TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_EXCHANGE);
+         break;
+      //Finished message received?
+      case TLS_TYPE_FINISHED:
+         //The Finished message authenticates the handshake
+         error = tls13ParseFinished(context, message, length);
+         break;
+      //Invalid handshake message received?
+      default:
+         //Report an error
+         error = ERROR_UNEXPECTED_MESSAGE;
+         break;
+      }
+   }
+   //Alert message received?
+   else if(contentType == TLS_TYPE_ALERT)
+   {
+      //Parse Alert message
+      error = tlsParseAlert(context, message, length);
+   }
+   //Application data received?
+   else
+   {
+      //ChangeCipherSpec records are dropped by the record layer and the
+      //server cannot send application data before its Finished message
+      error = ERROR_UNEXPECTED_MESSAGE;
+   }
+
+   //Advance read index
+   context->rxBufferReadIndex += length;
+   //Number of bytes still pending in the receive buffer
+   context->rxBufferLength -= length;
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Format the ClientHello extensions specific to TLS 1.3
+ *
+ * The PreSharedKey extension, if any, comes last. Its binder is computed
+ * by tls13ComputeClientHelloBinder() once the message is complete
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] p Buffer where to format the extensions
+ * @param[out] written Total number of bytes that have been written
+ * @return Error code
+ **/
+
+error_t tls13FormatClientHelloExtensions(TlsContext *context,
+   uint8_t *p, size_t *written)
+{
+   error_t error;
+   size_t n;
+   size_t length;
+   uint16_t version;
+   TlsExtension *extension;
+
+   //Total length of the extensions
+   length = 0;
+
+   //Add the SupportedVersions extension
+   extension = (TlsExtension *) p;
+   extension->type = HTONS(TLS_EXT_SUPPORTED_VERSIONS);
+
+   //List the supported versions in descending order of preference.
+   //SSL 3.0 is never offered along with TLS 1.3
+   for(n = 1, version = TLS_MAX_VERSION; version >= max(TLS_MIN_VERSION,
+      TLS_VERSION_1_0); version--, n += 2)
+   {
+      STORE16BE(version, extension->value + n);
+   }
+
+   //Fix the length of the list and of the extension
+   extension->value[0] = (uint8_t) (n - 1);
+   extension->length = htons(n);
+
+   //Point to the next extension
+   p += sizeof(TlsExtension) + n;
+   length += sizeof(TlsExtension) + n;
+
+   //The key share of the first ClientHello uses the preferred group. The
+   //second ClientHello carries the group selected by the HelloRetryRequest
+   if(!context->helloRetryRequest)
+   {
+      //X25519 is preferred over the NIST curves
+      if(tlsGetCurveInfo(TLS_EC_CURVE_ECDH_X25519) != NULL)
+         error = tls13GenerateKeyShare(context, TLS_EC_CURVE_ECDH_X25519);
+      else
+         error = tls13GenerateKeyShare(context, TLS_EC_CURVE_SECP256R1);
+
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //Add the KeyShare extension
+   extension = (TlsExtension *) p;
+   extension->type = HTONS(TLS_EXT_KEY_SHARE);
+
+   //A single KeyShareEntry is offered
+   error = tls13FormatKeyShareEntry(context,
+      (TlsKeyShareEntry *) (extension->value + 2), &n);
+   //Any error to report?
+   if(error) return error;
+
+   //Fix the length of the list and of the extension
+   STORE16BE(n, extension->value);
+   extension->length = htons(n + 2);
+
+   //Point to the next extension
+   p += sizeof(TlsExtension) + n + 2;
+   length += sizeof(TlsExtension) + n + 2;
+
+   //Add the PskKeyExchangeModes extension. Only psk_dhe_ke is offered, so
+   //that resumed sessions also provide forward secrecy
+   extension = (TlsExtension *) p;
+   extension->type = HTONS(TLS_EXT_PSK_KEY_EXCHANGE_MODES);
+   extension->value[0] = 1;
+   extension->value[1] = TLS_PSK_KEY_EXCH_MODE_PSK_DHE_KE;
+   extension->length = HTONS(2);
+
+   //Point to the next extension
+   p += sizeof(TlsExtension) + 2;
+   length += sizeof(TlsExtension) + 2;
+
+   //The client must echo the cookie of the HelloRetryRequest
+   if(context->cookieLength > 0)
+   {
+      //Add the Cookie extension
+      extension = (TlsExtension *) p;
+      extension->type = HTONS(TLS_EXT_COOKIE);
+
+      //Copy the cookie
+      STORE16BE(context->cookieLength, extension->value);
+      memcpy(extension->value + 2, context->cookie, context->cookieLength);
+      extension->length = htons(context->cookieLength + 2);
+
+      //Point to the next extension
+      p += sizeof(TlsExtension) + context->cookieLength + 2;
+      length += sizeof(TlsExtension) + context->cookieLength + 2;
+   }
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   //0-RTT data cannot be sent after a HelloRetryRequest
+   if(context->earlyDataEnabled && !context->helloRetryRequest)
+   {
+      //Add an empty EarlyData extension
+      extension = (TlsExtension *) p;
+      extension->type = HTONS(TLS_EXT_EARLY_DATA);
+      extension->length = HTONS(0);
+
+      //Point to the next extension
+      p += sizeof(TlsExtension);
+      length += sizeof(TlsExtension);
+   }
+#endif
+
+   //No PSK is offered for the moment
+   context->pskOffered = FALSE;
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //A ticket received in a TLS 1.3 connection can be presented?
+   if(context->ticketLength > 0 && context->sessionVersion == TLS_VERSION_1_3)
+   {
+      const HashAlgo *hash;
+      uint32_t ticketAge;
+
+      //Hash function associated with the ticket
+      hash = tls13GetCipherSuiteHash(context->cipherSuite);
+
+      //Make sure the cipher suite of the session is still supported
+      if(hash != NULL)
+      {
+         //Add the PreSharedKey extension
+         extension = (TlsExtension *) p;
+         extension->type = HTONS(TLS_EXT_PRE_SHARED_KEY);
+
+         //The age of the ticket is obfuscated by adding the ticket_age_add
+         //value sent by the server
+         ticketAge = (uint32_t) (osGetTickCount() - context->ticketTimestamp);
+         ticketAge += context->ticketAgeAdd;
+
+         //Format the single PskIdentity of the list
+         n = context->ticketLength;
+         STORE16BE(n + 6, extension->value);
+         STORE16BE(n, extension->value + 2);
+         memcpy(extension->value + 4, context->ticket, n);
+         STORE32BE(ticketAge, extension->value + n + 4);
+         n += 8;
+
+         //The binder is filled in once the message is complete
+         STORE16BE(hash->digestSize + 1, extension->value + n);
+         extension->value[n + 2] = (uint8_t) hash->digestSize;
+         memset(extension->value + n + 3, 0, hash->digestSize);
+         n += hash->digestSize + 3;
+
+         //Fix the length of the extension
+         extension->length = htons(n);
+
+         //Point to the next extension
+         p += sizeof(TlsExtension) + n;
+         length += sizeof(TlsExtension) + n;
+
+         //Early Secret = HKDF-Extract(0, PSK)
+         error = tls13GenerateEarlySecret(context, hash,
+            context->masterSecret, hash->digestSize);
+         //Any error to report?
+         if(error) return error;
+
+         //The server may accept the PSK
+         context->pskOffered = TRUE;
+      }
+   }
+#endif
+
+   //Total number of bytes that have been written
+   *written = length;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Compute the PSK binder of the ClientHello message
+ * @param[in] context Pointer to the TLS context
+ * @param[in,out] message ClientHello message whose last extension is the
+ *   PreSharedKey extension
+ * @param[in] length Length of the ClientHello message
+ * @return Error code
+ **/
+
+error_t tls13ComputeClientHelloBinder(TlsContext *context,
+   TlsClientHello *message, size_t length)
+{
+   const HashAlgo *hash;
+   uint8_t *binder;
+
+   //No PSK offered?
+   if(!context->pskOffered)
+      return NO_ERROR;
+
+   //Hash function associated with the ticket
+   hash = tls13GetCipherSuiteHash(context->cipherSuite);
+
+   //The binder is located at the very end of the message
+   binder = (uint8_t *) message + length - hash->digestSize;
+
+   //The binder covers the message up to, but not including, the
+   //binders list (refer to RFC 8446, section 4.2.11.2)
+   return tls13ComputePskBinder(context, hash, message,
+      length - hash->digestSize - 3, binder);
+}
+
+
+/**
+ * @brief Parse HelloRetryRequest message
+ *
+ * The server sends a HelloRetryRequest when the ClientHello does not
+ * carry an acceptable key share or when it wants a cookie to be echoed
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message Incoming HelloRetryRequest message to parse
+ * @param[in] length Message length
+ * @param[in] cipherSuite Cipher suite selected by the server
+ * @param[in] extensions List of extensions
+ * @param[in] extensionsLength Length of the list of extensions
+ * @return Error code
+ **/
+
+static error_t tls13ParseHelloRetryRequest(TlsContext *context,
+   const TlsServerHello *message, size_t length, uint16_t cipherSuite,
+   const uint8_t *extensions, size_t extensionsLength)
+{
+   error_t error;
+   uint16_t namedGroup;
+   const HashAlgo *hash;
+   const TlsExtension *keyShare;
+   const TlsExtension *cookie;
+
+   //Debug message
+   TRACE_INFO("HelloRetryRequest received\r\n");
+
+   //Only one HelloRetryRequest can be received
+   if(context->helloRetryRequest)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //Hash function of the selected cipher suite
+   hash = tls13GetCipherSuiteHash(cipherSuite);
+   //Make sure the cipher suite was offered
+   if(hash == NULL)
+      return ERROR_ILLEGAL_PARAMETER;
+
+   //The transcript has already been started along with 0-RTT data?
+   if(context->handshakeHashContext != NULL && context->prfHashAlgo != hash)
+      return ERROR_HANDSHAKE_FAILED;
+
+   //Search for the KeyShare and Cookie extensions
+   keyShare = tlsGetExtension(extensions, extensionsLength, TLS_EXT_KEY_SHARE);
+   cookie = tlsGetExtension(extensions, extensionsLength, TLS_EXT_COOKIE);
+
+   //A HelloRetryRequest that would not change the ClientHello
+   //must be rejected
+   if(keyShare == NULL && cookie == NULL)
+      return ERROR_ILLEGAL_PARAMETER;
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   //0-RTT data are implicitly rejected by a HelloRetryRequest
+   if(context->earlyDataEnabled)
+   {
+      //Discard the early traffic keys before another cipher suite is selected
+      tls13FreeTrafficKeys(context);
+   }
+#endif
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //The ticket cannot be presented again if its hash function does not
+   //match the cipher suite of the HelloRetryRequest
+   if(context->pskOffered && tls13GetCipherSuiteHash(context->cipherSuite) != hash)
+      context->ticketLength = 0;
+#endif
+
+   //Select TLS 1.3 and the cipher suite
+   error = tlsSetVersion(context, TLS_VERSION_1_3);
+   //Any error to report?
+   if(error) return error;
+
+   error = tlsSetCipherSuite(context, cipherSuite);
+   //The specified cipher suite is not supported?
+   if(error) return error;
+
+   //Start the transcript with the first ClientHello, if necessary
+   if(context->handshakeHashContext == NULL)
+   {
+      //Initialize handshake message hashing
+      error = tlsInitHandshakeHash(context);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //The first ClientHello is replaced with its hash
+   error = tls13DigestClientHello(context);
+   //Any error to report?
+   if(error) return error;
+
+   //Update the hash value with the incoming handshake message
+   tlsUpdateHandshakeHash(context, message, length);
+
+   //The server requests a key share for another group?
+   if(keyShare != NULL)
+   {
+      //The extension contains the selected group
+      if(ntohs(keyShare->length) != sizeof(uint16_t))
+         return ERROR_DECODING_FAILED;
+
+      //Retrieve the selected group
+      namedGroup = LOAD16BE(keyShare->value);
+
+      //The group must be supported and differ from the one of the key share
+      //sent in the first ClientHello
+      if(namedGroup == context->namedCurve || tlsGetCurveInfo(namedGroup) == NULL)
+         return ERROR_ILLEGAL_PARAMETER;
+
+      //Generate a key share for the selected group
+      error = tls13GenerateKeyShare(context, namedGroup);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //The server sent a cookie?
+   if(cookie != NULL)
+   {
+      //Malformed extension?
+      if(ntohs(cookie->length) < 3 ||
+         ntohs(cookie->length) != (LOAD16BE(cookie->value) + 2))
+      {
+         //Report an error
+         return ERROR_DECODING_FAILED;
+      }
+
+      //Allocate a memory buffer to hold the cookie
+      context->cookie = osMemAlloc(ntohs(cookie->length) - 2);
+      //Failed to allocate memory?
+      if(context->cookie == NULL) return ERROR_OUT_OF_MEMORY;
+
+      //Save the cookie. It will be echoed in the second ClientHello
+      context->cookieLength = ntohs(cookie->length) - 2;
+      memcpy(context->cookie, cookie->value + 2, context->cookieLength);
+   }
+
+   //The client responds with a second ClientHello
+   context->helloRetryRequest = TRUE;
+   context->state = TLS_STATE_CLIENT_HELLO;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse ServerHello message (TLS 1.3)
+ *
+ * This function is called by tlsParseServerHello() when the server
+ * selects TLS 1.3 through the SupportedVersions extension
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message Incoming ServerHello message to parse
+ * @param[in] length Message length
+ * @param[in] cipherSuite Cipher suite selected by the server
+ * @param[in] compressionMethod Compression method selected by the server
+ * @param[in] extensions List of extensions
+ * @param[in] extensionsLength Length of the list of extensions
+ * @return Error code
+ **/
+
+error_t tls13ParseServerHello(TlsContext *context, const TlsServerHello *message,
+   size_t length, uint16_t cipherSuite, uint8_t compressionMethod,
+   const uint8_t *extensions, size_t extensionsLength)
+{
+   error_t error;
+   size_t n;
+   const HashAlgo *hash;
+   const TlsExtension *extension;
+   const TlsKeyShareEntry *keyShare;
+
+   //The SupportedVersions extension contains the selected version
+   extension = tlsGetExtension(extensions, extensionsLength, TLS_EXT_SUPPORTED_VERSIONS);
+
+   //Malformed extension?
+   if(ntohs(extension->length) != sizeof(uint16_t))
+      return ERROR_DECODING_FAILED;
+   //The server must select a version offered by the client
+   if(LOAD16BE(extension->value) != TLS_VERSION_1_3)
+      return ERROR_ILLEGAL_PARAMETER;
+
+   //The server must echo the legacy session ID of the client
+   if(message->sessionId.length != context->sessionIdLength ||
+      memcmp(message->sessionId.value, context->sessionId, context->sessionIdLength))
+   {
+      //Report an error
+      return ERROR_ILLEGAL_PARAMETER;
+   }
+
+   //Compression is not supported by TLS 1.3
+   if(compressionMethod != TLS_COMPRESSION_METHOD_NULL)
+      return ERROR_ILLEGAL_PARAMETER;
+
+   //A HelloRetryRequest is a ServerHello with a special random value
+   if(!memcmp(&message->random, tls13HelloRetryRequestRandom, 32))
+   {
+      //Parse HelloRetryRequest message
+      return tls13ParseHelloRetryRequest(context, message, length,
+         cipherSuite, extensions, extensionsLength);
+   }
+
+   //Hash function of the selected cipher suite
+   hash = tls13GetCipherSuiteHash(cipherSuite);
+   //Make sure the cipher suite was offered
+   if(hash == NULL)
+      return ERROR_ILLEGAL_PARAMETER;
+
+   //The cipher suite must match the one of the HelloRetryRequest
+   if(context->helloRetryRequest && cipherSuite != context->cipherSuite)
+      return ERROR_ILLEGAL_PARAMETER;
+
+   //The transcript has already been started along with 0-RTT data?
+   if(context->handshakeHashContext != NULL && context->prfHashAlgo != hash)
+      return ERROR_HANDSHAKE_FAILED;
+
+   //Search for the PreSharedKey extension
+   extension = tlsGetExtension(extensions, extensionsLength, TLS_EXT_PRE_SHARED_KEY);
+
+   //The server accepted the PSK?
+   if(extension != NULL)
+   {
+      //The server cannot select a PSK that was not offered
+      if(!context->pskOffered)
+         return ERROR_ILLEGAL_PARAMETER;
+      //Malformed extension?
+      if(ntohs(extension->length) != sizeof(uint16_t))
+         return ERROR_DECODING_FAILED;
+      //A single identity was offered
+      if(LOAD16BE(extension->value) != 0)
+         return ERROR_ILLEGAL_PARAMETER;
+      //The cipher suite must be compatible with the PSK
+      if(tls13GetCipherSuiteHash(context->cipherSuite) != hash)
+         return ERROR_ILLEGAL_PARAMETER;
+   }
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   //The early traffic keys depend on the cipher suite of the session
+   if(context->earlyDataEnabled && cipherSuite != context->cipherSuite)
+   {
+      //Discard them before another cipher suite is selected
+      tls13FreeTrafficKeys(context);
+   }
+#endif
+
+   //Select TLS 1.3 and the cipher suite
+   error = tlsSetVersion(context, TLS_VERSION_1_3);
+   //Any error to report?
+   if(error) return error;
+
+   error = tlsSetCipherSuite(context, cipherSuite);
+   //The specified cipher suite is not supported?
+   if(error) return error;
+
+   error = tlsSetCompressionMethod(context, compressionMethod);
+   //The specified compression method is not supported?
+   if(error) return error;
+
+   //Resume the session?
+   if(extension != NULL)
+   {
+      //The early secret has been computed from the PSK
+      context->resume = TRUE;
+   }
+   else
+   {
+      //Perform a full handshake
+      context->resume = FALSE;
+
+      //Early Secret = HKDF-Extract(0, 0)
+      error = tls13GenerateEarlySecret(context, hash, NULL, 0);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //Search for the KeyShare extension
+   extension = tlsGetExtension(extensions, extensionsLength, TLS_EXT_KEY_SHARE);
+
+   //Only the psk_dhe_ke mode is offered, so the extension is mandatory
+   if(extension == NULL)
+      return ERROR_ILLEGAL_PARAMETER;
+
+   //Point to the KeyShareEntry selected by the server
+   keyShare = (TlsKeyShareEntry *) extension->value;
+   n = ntohs(extension->length);
+
+   //Malformed extension?
+   if(n < sizeof(TlsKeyShareEntry) ||
+      n != (sizeof(TlsKeyShareEntry) + ntohs(keyShare->length)))
+   {
+      //Report an error
+      return ERROR_DECODING_FAILED;
+   }
+
+   //The server must use the group of the key share sent by the client
+   if(ntohs(keyShare->group) != context->namedCurve)
+      return ERROR_ILLEGAL_PARAMETER;
+
+   //Compute the (EC)DHE shared secret
+   TLS_PROFILE_START(context, TLS_PROFILE_KEY_EXCHANGE);
+   error = tls13ComputeSharedSecret(context, keyShare->keyExchange,
+      ntohs(keyShare->length));
+   TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_EXCHANGE);
+   //Any error to report?
+   if(error) return error;
+
+   //Save server random value
+   context->serverRandom = message->random;
+
+   //Start the transcript with the ClientHello, if necessary
+   if(context->handshakeHashContext == NULL)
+   {
+      //Initialize handshake message hashing
+      error = tlsInitHandshakeHash(context);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //Update the hash value with the incoming handshake message
+   tlsUpdateHandshakeHash(context, message, length);
+
+   //Compute the handshake traffic secrets
+   TLS_PROFILE_START(context, TLS_PROFILE_KEY_DERIVATION);
+   error = tls13GenerateHandshakeSecret(context);
+   TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_DERIVATION);
+   //Any error to report?
+   if(error) return error;
+
+   //The rest of the server's flight is protected
+   error = tls13InstallTrafficKeys(context, context->serverHsTrafficSecret,
+      TLS_CONNECTION_END_SERVER);
+   //Any error to report?
+   if(error) return error;
+
+   //Prepare to receive an EncryptedExtensions message
+   context->state = TLS_STATE_ENCRYPTED_EXTENSIONS;
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse EncryptedExtensions message
+ *
+ * The extensions that are not needed to establish the cryptographic
+ * context are sent by the server in this message
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message Incoming EncryptedExtensions message to parse
+ * @param[in] length Message length
+ * @return Error code
+ **/
+
+error_t tls13ParseEncryptedExtensions(TlsContext *context,
+   const TlsHandshake *message, size_t length)
+{
+   size_t n;
+   const TlsExtension *extension;
+
+   //Debug message
+   TRACE_INFO("EncryptedExtensions message received (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //Check current state
+   if(context->state != TLS_STATE_ENCRYPTED_EXTENSIONS)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //The message consists of the list of extensions
+   n = length - sizeof(TlsHandshake);
+
+   //Malformed message?
+   if(n < 2 || n != (LOAD16BE(message->data) + 2u))
+      return ERROR_DECODING_FAILED;
+
+#if (TLS_MAX_FRAG_LENGTH_SUPPORT == ENABLED)
+   //The client requested a maximum fragment length?
+   if(context->maxFragLength < TLS_MAX_RECORD_LENGTH)
+   {
+      //Search for the MaxFragmentLength extension
+      extension = tlsGetExtension(message->data, n, TLS_EXT_MAX_FRAGMENT_LENGTH);
+
+      //The server accepted the request?
+      if(extension != NULL)
+      {
+         //Malformed extension?
+         if(ntohs(extension->length) != 1)
+            return ERROR_DECODING_FAILED;
+
+         //The server must echo the value requested by the client
+         if(extension->value[0] < TLS_MAX_FRAG_LENGTH_512 ||
+            extension->value[0] > TLS_MAX_FRAG_LENGTH_4096 ||
+            (256U << extension->value[0]) != context->maxFragLength)
+         {
+            //Report an error
+            return ERROR_ILLEGAL_PARAMETER;
+         }
+      }
+      else
+      {
+         //The server will use full-sized records
+         context->maxFragLength = TLS_MAX_RECORD_LENGTH;
+      }
+   }
+#endif
+
+#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+   //The server may advertise the size of the largest record it is
+   //willing to receive
+   extension = tlsGetExtension(message->data, n, TLS_EXT_RECORD_SIZE_LIMIT);
+
+   //RecordSizeLimit extension found?
+   if(extension != NULL)
+   {
+      //Malformed extension?
+      if(ntohs(extension->length) != sizeof(uint16_t))
+         return ERROR_DECODING_FAILED;
+      //Endpoints must not advertise a limit smaller than 64 bytes
+      if(LOAD16BE(extension->value) < 64)
+         return ERROR_ILLEGAL_PARAMETER;
+
+      //With TLS 1.3, the limit includes the content type byte
+      context->recordSizeLimit = min(LOAD16BE(extension->value) - 1,
+         TLS_MAX_RECORD_LENGTH);
+   }
+#endif
+
+   //Search for the EarlyData extension
+   extension = tlsGetExtension(message->data, n, TLS_EXT_EARLY_DATA);
+
+   //The server accepted the 0-RTT data?
+   if(extension != NULL)
+   {
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+      //The extension can only be sent in response to an
+      //EarlyData extension
+      if(!context->earlyDataEnabled || context->helloRetryRequest ||
+         !context->resume)
+      {
+         //Report an error
+         return ERROR_ILLEGAL_PARAMETER;
+      }
+
+      //Malformed extension?
+      if(ntohs(extension->length) != 0)
+         return ERROR_DECODING_FAILED;
+
+      //The client must send an EndOfEarlyData message
+      context->earlyDataAccepted = TRUE;
+#else
+      //0-RTT data were not offered
+      return ERROR_ILLEGAL_PARAMETER;
+#endif
+   }
+
+   //Update the hash value with the incoming handshake message
+   tlsUpdateHandshakeHash(context, message, length);
+
+   //A server authenticating with a PSK does not send its certificate
+   if(context->resume)
+      context->state = TLS_STATE_SERVER_FINISHED;
+   else
+      context->state = TLS_STATE_SERVER_CERTIFICATE;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse CertificateRequest message (TLS 1.3)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message Incoming CertificateRequest message to parse
+ * @param[in] length Message length
+ * @return Error code
+ **/
+
+error_t tls13ParseCertificateRequest(TlsContext *context,
+   const TlsHandshake *message, size_t length)
+{
+   uint_t i;
+   size_t n;
+   uint16_t signScheme;
+   const uint8_t *p;
+   const TlsExtension *extension;
+   const TlsSignHashAlgos *supportedSignAlgos;
+
+   //Debug message
+   TRACE_INFO("CertificateRequest message received (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //The message follows the EncryptedExtensions message, and is never
+   //sent when the server authenticates with a PSK
+   if(context->state != TLS_STATE_SERVER_CERTIFICATE || context->clientCertRequested)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //Point to the certificate_request_context field
+   p = message->data;
+   n = length - sizeof(TlsHandshake);
+
+   //Malformed message?
+   if(n < 1 || n < (p[0] + 1u))
+      return ERROR_DECODING_FAILED;
+   //Make sure the context fits in the buffer
+   if(p[0] > sizeof(context->certRequestContext))
+      return ERROR_ILLEGAL_PARAMETER;
+
+   //The client echoes the context in its Certificate message
+   context->certRequestContextLength = p[0];
+   memcpy(context->certRequestContext, p + 1, p[0]);
+
+   //Point to the list of extensions
+   n -= p[0] + 1;
+   p += p[0] + 1;
+
+   //Malformed message?
+   if(n < 2 || n != (LOAD16BE(p) + 2u))
+      return ERROR_DECODING_FAILED;
+
+   //The SignatureAlgorithms extension is mandatory
+   extension = tlsGetExtension(p, n, TLS_EXT_SIGNATURE_ALGORITHMS);
+   if(extension == NULL)
+      return ERROR_ILLEGAL_PARAMETER;
+
+   //Point to the list of signature schemes
+   supportedSignAlgos = (TlsSignHashAlgos *) extension->value;
+
+   //Check the length of the list
+   if(ntohs(extension->length) < sizeof(TlsSignHashAlgos))
+      return ERROR_DECODING_FAILED;
+   if(ntohs(extension->length) != (sizeof(TlsSignHashAlgos) + ntohs(supportedSignAlgos->length)))
+      return ERROR_DECODING_FAILED;
+
+   //Update the hash value with the incoming handshake message
+   tlsUpdateHandshakeHash(context, message, length);
+
+   //The client must send a Certificate message, even if it is empty
+   context->clientCertRequested = TRUE;
+   //No suitable certificate has been found for the moment
+   context->cert = NULL;
+
+   //Loop through the list of available certificates
+   for(i = 0; i < context->numCerts; i++)
+   {
+      //The certificate can be used if its key matches one of the
+      //signature schemes supported by the server
+      signScheme = tls13SelectSignScheme(&context->certs[i], supportedSignAlgos);
+
+      //Suitable certificate found?
+      if(signScheme != 0)
+      {
+         context->cert = &context->certs[i];
+         context->signScheme = signScheme;
+         break;
+      }
+   }
+
+   //The server sends its Certificate message next
+   return NO_ERROR;
+}
+
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+
+/**
+ * @brief Send EndOfEarlyData message
+ *
+ * This message is protected with the early traffic keys. The rest of the
+ * client's flight is then protected with the handshake traffic keys
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13SendEndOfEarlyData(TlsContext *context)
+{
+   error_t error;
+   TlsHandshake *message;
+
+   //Point to the EndOfEarlyData message
+   message = (TlsHandshake *) (context->txBuffer + sizeof(TlsRecord));
+   //The message has an empty body
+   message->msgType = TLS_TYPE_END_OF_EARLY_DATA;
+   STORE24BE(0, message->length);
+
+   //Debug message
+   TRACE_INFO("Sending EndOfEarlyData message (%u bytes)...\r\n", sizeof(TlsHandshake));
+   TRACE_DEBUG_ARRAY("  ", message, sizeof(TlsHandshake));
+
+   //Send handshake message
+   error = tlsWriteProtocolData(context, sizeof(TlsHandshake), TLS_TYPE_HANDSHAKE);
+   //Failed to send TLS record?
+   if(error) return error;
+
+   //Switch to the client handshake traffic keys
+   error = tls13InstallTrafficKeys(context, context->clientHsTrafficSecret,
+      TLS_CONNECTION_END_CLIENT);
+   //Any error to report?
+   if(error) return error;
+
+   //The client sends a Certificate message if requested
+   if(context->clientCertRequested)
+      context->state = TLS_STATE_CLIENT_CERTIFICATE;
+   else
+      context->state = TLS_STATE_CLIENT_FINISHED;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send the ClientHello message ahead of 0-RTT data
+ *
+ * A ClientHello offering 0-RTT data is sent if the last session established
+ * with the server allows it. The early traffic keys are then installed so
+ * that application data can be sent before the handshake completes
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code (ERROR_NOT_CONFIGURED if 0-RTT data cannot be sent)
+ **/
+
+error_t tls13StartEarlyData(TlsContext *context)
+{
+   error_t error;
+   uint8_t digest[MAX_HASH_DIGEST_SIZE];
+
+#if (TLS_CLIENT_CACHE_SUPPORT == ENABLED)
+   //Unless the application has restored a session, look for the last
+   //session established with the server
+   if(context->sessionIdLength == 0 && !context->cipherSuite)
+      tlsRestoreFromClientCache(context);
+#endif
+
+   //0-RTT data require a TLS 1.3 ticket that allows them
+   if(context->ticketLength == 0 || context->sessionVersion != TLS_VERSION_1_3 ||
+      context->sessionMaxEarlyDataSize == 0 ||
+      tls13GetCipherSuiteHash(context->cipherSuite) == NULL)
+   {
+      //Report an error
+      return ERROR_NOT_CONFIGURED;
+   }
+
+   //The ClientHello carries an EarlyData extension
+   context->earlyDataEnabled = TRUE;
+   context->earlyDataLength = 0;
+
+   //Send ClientHello message
+   error = tlsSendClientHello(context);
+   //Any error to report?
+   if(error) return error;
+
+   //0-RTT data are protected with the cipher suite of the session
+   error = tlsSetVersion(context, TLS_VERSION_1_3);
+   //Any error to report?
+   if(error) return error;
+
+   error = tlsSetCipherSuite(context, context->cipherSuite);
+   //Any error to report?
+   if(error) return error;
+
+   //The transcript starts with the ClientHello
+   error = tlsInitHandshakeHash(context);
+   //Any error to report?
+   if(error) return error;
+
+   //Transcript-Hash(ClientHello)
+   error = tls13GetTranscriptHash(context, digest);
+   //Any error to report?
+   if(error) return error;
+
+   //client_early_traffic_secret = Derive-Secret(Early Secret,
+   //"c e traffic", ClientHello). The handshake traffic secret is
+   //not known yet, so its buffer is borrowed
+   error = tls13DeriveSecret(context->prfHashAlgo, context->secret,
+      "c e traffic", digest, context->clientHsTrafficSecret);
+   //Any error to report?
+   if(error) return error;
+
+   //Install the early traffic keys
+   return tls13InstallTrafficKeys(context, context->clientHsTrafficSecret,
+      TLS_CONNECTION_END_CLIENT);
+}
+
+#endif
+
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+
+/**
+ * @brief Parse NewSessionTicket message (TLS 1.3)
+ *
+ * The message is sent by the server after the handshake. The PSK of the
+ * ticket is derived from the resumption master secret and the nonce
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message Incoming NewSessionTicket message to parse
+ * @param[in] length Message length
+ * @return Error code
+ **/
+
+error_t tls13ParseNewSessionTicket(TlsContext *context,
+   const TlsNewSessionTicket *message, size_t length)
+{
+   error_t error;
+   size_t n;
+   size_t nonceLength;
+   size_t ticketLength;
+   uint32_t lifetime;
+   uint32_t ageAdd;
+   const uint8_t *p;
+   const uint8_t *nonce;
+   const uint8_t *ticket;
+   const TlsExtension *extension;
+
+   //Debug message
+   TRACE_INFO("NewSessionTicket message received (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //Point to the body of the message
+   p = (uint8_t *) message + sizeof(TlsHandshake);
+   n = length - sizeof(TlsHandshake);
+
+   //Malformed message?
+   if(n < 9)
+      return ERROR_DECODING_FAILED;
+
+   //Get the lifetime of the ticket and the value used to obfuscate its age
+   lifetime = LOAD32BE(p);
+   ageAdd = LOAD32BE(p + 4);
+
+   //Get the nonce
+   nonceLength = p[8];
+   nonce = p + 9;
+   p += nonceLength + 9;
+   n -= 9;
+
+   //Malformed message?
+   if(n < (nonceLength + 2))
+      return ERROR_DECODING_FAILED;
+
+   //Get the ticket
+   n -= nonceLength + 2;
+   ticketLength = LOAD16BE(p);
+   ticket = p + 2;
+   p += ticketLength + 2;
+
+   //Malformed message?
+   if(ticketLength == 0 || n < (ticketLength + 2))
+      return ERROR_DECODING_FAILED;
+
+   //The extensions come last
+   n -= ticketLength;
+   if(n != (LOAD16BE(p) + 2u))
+      return ERROR_DECODING_FAILED;
+
+   //Servers must not use any value greater than 7 days
+   if(lifetime > 604800)
+      return ERROR_ILLEGAL_PARAMETER;
+
+   //Tickets that do not fit in the buffer are silently discarded
+   if(lifetime == 0 || ticketLength > TLS_MAX_TICKET_SIZE)
+      return NO_ERROR;
+
+   //PSK = HKDF-Expand-Label(resumption_master_secret, "resumption",
+   //ticket_nonce, Hash.length)
+   error = tls13HkdfExpandLabel(context->prfHashAlgo, context->resumptionMasterSecret,
+      context->prfHashAlgo->digestSize, "resumption", nonce, nonceLength,
+      context->masterSecret, context->prfHashAlgo->digestSize);
+   //Any error to report?
+   if(error) return error;
+
+   //Save the ticket
+   memcpy(context->ticket, ticket, ticketLength);
+   context->ticketLength = ticketLength;
+   context->ticketLifetime = lifetime;
+   context->ticketAgeAdd = ageAdd;
+   context->ticketTimestamp = osGetTickCount();
+   context->sessionVersion = TLS_VERSION_1_3;
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   //The EarlyData extension indicates that 0-RTT data may be sent
+   //along with the ticket
+   extension = tlsGetExtension(p, n, TLS_EXT_EARLY_DATA);
+
+   //Check whether the extension is present
+   if(extension != NULL && ntohs(extension->length) == sizeof(uint32_t))
+      context->sessionMaxEarlyDataSize = LOAD32BE(extension->value);
+   else
+      context->sessionMaxEarlyDataSize = 0;
+#else
+   //0-RTT data are not supported
+   (void) extension;
+#endif
+
+#if (TLS_CLIENT_CACHE_SUPPORT == ENABLED)
+   //The session can be resumed by the next connection to the same server
+   tlsSaveToClientCache(context);
+#endif
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+#endif
+
+#endif
@@ -0,0 +1,61 @@
+/**
+ * @file tls13_client.h
+ * @brief TLS 1.3 client
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _TLS13_CLIENT_H
+#define _TLS13_CLIENT_H
+
+//Dependencies
+#include "tls.h"
+
+//TLS 1.3 client related functions
+error_t tls13ClientHandshakeStep(TlsContext *context);
+error_t tls13ParseServerMessage(TlsContext *context);
+
+error_t tls13FormatClientHelloExtensions(TlsContext *context,
+   uint8_t *p, size_t *written);
+
+error_t tls13ComputeClientHelloBinder(TlsContext *context,
+   TlsClientHello *message, size_t length);
+
+error_t tls13ParseServerHello(TlsContext *context, const TlsServerHello *message,
+   size_t length, uint16_t cipherSuite, uint8_t compressionMethod,
+   const uint8_t *extensions, size_t extensionsLength);
+
+error_t tls13ParseEncryptedExtensions(TlsContext *context,
+   const TlsHandshake *message, size_t length);
+
+error_t tls13ParseCertificateRequest(TlsContext *context,
+   const TlsHandshake *message, size_t length);
+
+error_t tls13SendEndOfEarlyData(TlsContext *context);
+error_t tls13StartEarlyData(TlsContext *context);
+
+error_t tls13ParseNewSessionTicket(TlsContext *context,
+   const TlsNewSessionTicket *message, size_t length);
+
+#endif
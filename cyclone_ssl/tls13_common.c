@@ -0,0 +1,919 @@
+/**
+ * @file tls13_common.c
+ * @brief TLS 1.3 handshake messages common to client and server
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Handshake messages whose format or processing is specific to TLS 1.3
+ * and that are shared by the client and the server: Certificate,
+ * CertificateVerify, Finished and the post-handshake messages
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_client.h"
+#include "tls_common.h"
+#include "tls_record.h"
+#include "tls_io.h"
+#include "tls_misc.h"
+#include "tls13_misc.h"
+#include "tls13_common.h"
+#include "tls13_client.h"
+#include "debug.h"
+
+//Check SSL library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_MAX_VERSION >= TLS_VERSION_1_3)
+
+
+/**
+ * @brief Format the content covered by a CertificateVerify signature
+ *
+ * The content consists of 64 spaces, a context string that depends on the
+ * signer, a single zero byte and the current transcript hash
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] entity Entity generating the signature
+ * @param[out] content Buffer where to format the content
+ * @param[out] length Length of the content
+ * @return Error code
+ **/
+
+static error_t tls13FormatSignedContent(TlsContext *context,
+   TlsConnectionEnd entity, uint8_t *content, size_t *length)
+{
+   error_t error;
+   const char_t *label;
+
+   //The context string identifies the signer
+   if(entity == TLS_CONNECTION_END_CLIENT)
+      label = "TLS 1.3, client CertificateVerify";
+   else
+      label = "TLS 1.3, server CertificateVerify";
+
+   //The content starts with 64 bytes of octet 32
+   memset(content, 0x20, 64);
+   //Append the context string and the separator
+   strcpy((char_t *) content + 64, label);
+   *length = 64 + strlen(label) + 1;
+
+   //Append Transcript-Hash(Handshake Context, Certificate)
+   error = tls13GetTranscriptHash(context, content + *length);
+   //Any error to report?
+   if(error) return error;
+
+   //Total length of the content to be signed
+   *length += context->prfHashAlgo->digestSize;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+
+/**
+ * @brief Get the hash algorithm that goes with an ECDSA key
+ *
+ * TLS 1.3 ties each ECDSA signature scheme to a single curve
+ *
+ * @param[in] params EC domain parameters of the key
+ * @return Hash algorithm identifier
+ **/
+
+static TlsHashAlgo tls13GetEcdsaHashAlgo(const EcDomainParameters *params)
+{
+   uint_t n;
+
+   //Retrieve the size of the curve
+   n = mpiGetBitLength(&params->p);
+
+   //ecdsa_secp256r1_sha256, ecdsa_secp384r1_sha384 or ecdsa_secp521r1_sha512
+   if(n == 256)
+      return TLS_HASH_ALGO_SHA256;
+   else if(n == 384)
+      return TLS_HASH_ALGO_SHA384;
+   else if(n == 521)
+      return TLS_HASH_ALGO_SHA512;
+   else
+      return TLS_HASH_ALGO_NONE;
+}
+
+#endif
+
+
+/**
+ * @brief Select the signature scheme to be used with a certificate
+ * @param[in] cert Certificate of the signer
+ * @param[in] supportedSignAlgos Signature schemes supported by the peer
+ * @return Signature scheme (0 if the certificate cannot be used)
+ **/
+
+uint16_t tls13SelectSignScheme(const TlsCertDesc *cert,
+   const TlsSignHashAlgos *supportedSignAlgos)
+{
+   uint_t i;
+   uint_t n;
+   const TlsSignHashAlgo *p;
+
+   //The signature_algorithms extension is mandatory
+   if(supportedSignAlgos == NULL)
+      return 0;
+
+   //Number of signature schemes in the list
+   n = ntohs(supportedSignAlgos->length) / sizeof(TlsSignHashAlgo);
+
+   //The schemes are listed in descending order of preference
+   for(i = 0; i < n; i++)
+   {
+      //Point to the current scheme
+      p = &supportedSignAlgos->value[i];
+
+#if (TLS_RSA_SIGN_SUPPORT == ENABLED)
+      //RSASSA-PSS with an rsaEncryption key?
+      if(cert->type == TLS_CERT_RSA_SIGN && p->hash == TLS_HASH_ALGO_INTRINSIC)
+      {
+         //The rsa_pss_rsae schemes are numbered after the
+         //identifier of the hash function they use
+         if(p->signature == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA256 ||
+            p->signature == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA384 ||
+            p->signature == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA512)
+         {
+            //Make sure the hash function is available
+            if(tlsGetPssHashAlgo(p->signature) != NULL)
+               return (p->hash << 8) | p->signature;
+         }
+      }
+#endif
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+      //ECDSA scheme matching the curve of the key?
+      if(cert->type == TLS_CERT_ECDSA_SIGN && p->signature == TLS_SIGN_ALGO_ECDSA)
+      {
+         //Make sure the hash function is available
+         if(p->hash == tls13GetEcdsaHashAlgo(&cert->ecParams) &&
+            tlsGetHashAlgo(p->hash) != NULL)
+         {
+            return (p->hash << 8) | p->signature;
+         }
+      }
+#endif
+   }
+
+   //No acceptable signature scheme
+   return 0;
+}
+
+
+/**
+ * @brief Send Certificate message (TLS 1.3)
+ *
+ * Each certificate of the list is followed by its own set of extensions,
+ * and the list is preceded by the certificate request context
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13SendCertificate(TlsContext *context)
+{
+   error_t error;
+   size_t i;
+   size_t n;
+   size_t length;
+   size_t contextLength;
+   uint8_t *p;
+   const uint8_t *certList;
+   size_t certListLength;
+   TlsHandshake *message;
+
+   //Point to the Certificate message
+   message = (TlsHandshake *) (context->txBuffer + sizeof(TlsRecord));
+   //Set message type
+   message->msgType = TLS_TYPE_CERTIFICATE;
+
+   //The client echoes the context of the CertificateRequest message
+   if(context->entity == TLS_CONNECTION_END_CLIENT)
+      contextLength = context->certRequestContextLength;
+   else
+      contextLength = 0;
+
+   //Point to the first byte of the message body
+   p = message->data;
+
+   //certificate_request_context field
+   p[0] = (uint8_t) contextLength;
+   memcpy(p + 1, context->certRequestContext, contextLength);
+   p += contextLength + 1;
+
+   //Skip the length of the certificate list
+   p += 3;
+   length = 0;
+
+   //A client with no suitable certificate sends an empty list
+   if(context->cert != NULL)
+   {
+      //The certificate list has been DER encoded when the certificate was
+      //loaded. Each entry is preceded by a 3-byte length field
+      certList = context->cert->certList;
+      certListLength = context->cert->certListLength;
+
+      //Loop through the certificates
+      for(i = 0; i < certListLength; i += n + 3)
+      {
+         //Get the length of the current certificate
+         n = LOAD24BE(certList + i);
+
+         //Prevent the buffer from overflowing
+         if((sizeof(TlsHandshake) + contextLength + 4 + length + n + 5) >
+            context->txBufferSize)
+         {
+            return ERROR_MESSAGE_TOO_LONG;
+         }
+
+         //Copy the certificate along with its length
+         memcpy(p + length, certList + i, n + 3);
+         length += n + 3;
+
+         //No extension is sent for the certificate
+         STORE16BE(0, p + length);
+         length += 2;
+      }
+   }
+
+   //Fill in the length of the certificate list
+   STORE24BE(length, p - 3);
+   //Length of the message body
+   length += contextLength + 4;
+
+   //Fix message header
+   STORE24BE(length, message->length);
+   //Length of the complete handshake message
+   length += sizeof(TlsHandshake);
+
+   //Debug message
+   TRACE_INFO("Sending Certificate message (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //Send handshake message
+   error = tlsWriteProtocolData(context, length, TLS_TYPE_HANDSHAKE);
+   //Failed to send TLS record?
+   if(error) return error;
+
+   //Update FSM state
+   if(context->entity == TLS_CONNECTION_END_SERVER)
+      context->state = TLS_STATE_SERVER_CERTIFICATE_VERIFY;
+   else if(context->cert != NULL)
+      context->state = TLS_STATE_CERTIFICATE_VERIFY;
+   else
+      context->state = TLS_STATE_CLIENT_FINISHED;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send CertificateVerify message (TLS 1.3)
+ *
+ * The signature covers the transcript hash up to and including the
+ * Certificate message
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13SendCertificateVerify(TlsContext *context)
+{
+   error_t error;
+   size_t length;
+   const HashAlgo *hash;
+   TlsCertificateVerify *message;
+   TlsDigitalSignature2 *signature;
+   uint8_t content[TLS13_MAX_SIGNED_CONTENT_SIZE];
+   uint8_t digest[MAX_HASH_DIGEST_SIZE];
+
+   //Point to the CertificateVerify message
+   message = (TlsCertificateVerify *) (context->txBuffer + sizeof(TlsRecord));
+   //Set message type
+   message->msgType = TLS_TYPE_CERTIFICATE_VERIFY;
+
+   //Point to the digitally-signed element
+   signature = (TlsDigitalSignature2 *) message->signature;
+   //Signature scheme selected during the negotiation
+   signature->algorithm.hash = MSB(context->signScheme);
+   signature->algorithm.signature = LSB(context->signScheme);
+
+   //Format the content covered by the signature
+   error = tls13FormatSignedContent(context, context->entity, content, &length);
+   //Any error to report?
+   if(error) return error;
+
+#if (TLS_RSA_SIGN_SUPPORT == ENABLED)
+   //RSASSA-PSS signature scheme?
+   if(signature->algorithm.hash == TLS_HASH_ALGO_INTRINSIC)
+   {
+      //The scheme implies the hash function
+      hash = tlsGetPssHashAlgo(signature->algorithm.signature);
+
+      //Digest the content
+      error = hash->compute(content, length, digest);
+      //Any error to report?
+      if(error) return error;
+
+      //The length of the salt must be equal to the length of the digest
+      error = rsassaPssSign(context->prngAlgo, context->prngContext,
+         &context->cert->rsaPrivateKey, hash, hash->digestSize, digest,
+         signature->value, &length);
+   }
+   else
+#endif
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+   //ECDSA signature scheme?
+   if(signature->algorithm.signature == TLS_SIGN_ALGO_ECDSA)
+   {
+      //Retrieve the hash function of the scheme
+      hash = tlsGetHashAlgo(signature->algorithm.hash);
+
+      //Digest the content
+      error = hash->compute(content, length, digest);
+      //Any error to report?
+      if(error) return error;
+
+      //Generate an ECDSA signature
+      error = tlsGenerateEcdsaSignature(&context->cert->ecParams,
+         context->prngAlgo, context->prngContext, &context->cert->ecPrivateKey,
+         digest, hash->digestSize, signature->value, &length);
+   }
+   else
+#endif
+   //Invalid signature scheme?
+   {
+      //Report an error
+      error = ERROR_UNSUPPORTED_SIGNATURE_ALGO;
+   }
+
+   //Failed to generate the signature?
+   if(error) return error;
+
+   //Length of the signature
+   signature->length = htons(length);
+   //Total length of the digitally-signed element
+   length += sizeof(TlsDigitalSignature2);
+
+   //Fix message header
+   STORE24BE(length, message->length);
+   //Length of the complete handshake message
+   length += sizeof(TlsHandshake);
+
+   //Debug message
+   TRACE_INFO("Sending CertificateVerify message (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //Send handshake message
+   error = tlsWriteProtocolData(context, length, TLS_TYPE_HANDSHAKE);
+   //Failed to send TLS record?
+   if(error) return error;
+
+   //Prepare to send a Finished message
+   context->state = (context->entity == TLS_CONNECTION_END_CLIENT) ?
+      TLS_STATE_CLIENT_FINISHED : TLS_STATE_SERVER_FINISHED;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send Finished message (TLS 1.3)
+ *
+ * Once its Finished message has been sent, the sender protects its
+ * records with the application traffic keys
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13SendFinished(TlsContext *context)
+{
+   error_t error;
+   size_t length;
+   TlsFinished *message;
+
+   //The verify data is an HMAC over the transcript hash
+   error = tls13ComputeVerifyData(context, context->entity);
+   //Unable to generate the verify data?
+   if(error) return error;
+
+   //Point to the Finished message
+   message = (TlsFinished *) (context->txBuffer + sizeof(TlsRecord));
+   //Set message type
+   message->msgType = TLS_TYPE_FINISHED;
+   //Set message length
+   STORE24BE(context->verifyDataLength, message->length);
+
+   //Copy the resulting verify data
+   memcpy(message->verifyData, context->verifyData, context->verifyDataLength);
+   //Length of the complete handshake message
+   length = context->verifyDataLength + sizeof(TlsHandshake);
+
+   //Debug message
+   TRACE_INFO("Sending Finished message (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //Send handshake message
+   error = tlsWriteProtocolData(context, length, TLS_TYPE_HANDSHAKE);
+   //Failed to send TLS record?
+   if(error) return error;
+
+   //TLS operates as a client or a server?
+   if(context->entity == TLS_CONNECTION_END_CLIENT)
+   {
+      //The resumption master secret covers the client Finished message
+      error = tls13GenerateResumptionSecret(context);
+      //Any error to report?
+      if(error) return error;
+
+      //Subsequent records are protected with the application traffic keys
+      error = tls13InstallTrafficKeys(context, context->clientAppTrafficSecret,
+         TLS_CONNECTION_END_CLIENT);
+      //Any error to report?
+      if(error) return error;
+
+      //The handshake is complete
+      context->state = TLS_STATE_APPLICATION_DATA;
+   }
+   else
+   {
+      //The application traffic secrets cover the server Finished message
+      error = tls13GenerateMasterSecret(context);
+      //Any error to report?
+      if(error) return error;
+
+      //The server may send application data before the client's
+      //second flight has been received
+      error = tls13InstallTrafficKeys(context, context->serverAppTrafficSecret,
+         TLS_CONNECTION_END_SERVER);
+      //Any error to report?
+      if(error) return error;
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+      //0-RTT data are followed by an EndOfEarlyData message
+      if(context->earlyDataAccepted)
+         context->state = TLS_STATE_END_OF_EARLY_DATA;
+      else
+#endif
+      //The client sends a Certificate message if requested
+      if(context->clientCertRequested)
+         context->state = TLS_STATE_CLIENT_CERTIFICATE;
+      else
+         context->state = TLS_STATE_CLIENT_FINISHED;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse CertificateVerify message (TLS 1.3)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message Incoming CertificateVerify message to parse
+ * @param[in] length Message length
+ * @return Error code
+ **/
+
+error_t tls13ParseCertificateVerify(TlsContext *context,
+   const TlsCertificateVerify *message, size_t length)
+{
+   error_t error;
+   size_t n;
+   const HashAlgo *hash;
+   const TlsDigitalSignature2 *signature;
+   TlsConnectionEnd peer;
+   uint8_t content[TLS13_MAX_SIGNED_CONTENT_SIZE];
+   uint8_t digest[MAX_HASH_DIGEST_SIZE];
+
+   //Debug message
+   TRACE_INFO("CertificateVerify message received (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //The message is sent by the peer right after its Certificate message
+   if(context->entity == TLS_CONNECTION_END_CLIENT)
+   {
+      //Check current state
+      if(context->state != TLS_STATE_SERVER_CERTIFICATE_VERIFY)
+         return ERROR_UNEXPECTED_MESSAGE;
+
+      //The server signs the transcript
+      peer = TLS_CONNECTION_END_SERVER;
+   }
+   else
+   {
+      //Check current state
+      if(context->state != TLS_STATE_CERTIFICATE_VERIFY)
+         return ERROR_UNEXPECTED_MESSAGE;
+
+      //The client signs the transcript
+      peer = TLS_CONNECTION_END_CLIENT;
+   }
+
+   //Check the length of the message
+   if(length < (sizeof(TlsCertificateVerify) + sizeof(TlsDigitalSignature2)))
+      return ERROR_DECODING_FAILED;
+
+   //Point to the digitally-signed element
+   signature = (TlsDigitalSignature2 *) message->signature;
+   //Retrieve the length of the signature
+   n = ntohs(signature->length);
+
+   //Make sure the signature fits in the message
+   if(length != (sizeof(TlsCertificateVerify) + sizeof(TlsDigitalSignature2) + n))
+      return ERROR_DECODING_FAILED;
+
+   //The signature covers the transcript up to the Certificate message
+   error = tls13FormatSignedContent(context, peer, content, &length);
+   //Any error to report?
+   if(error) return error;
+
+#if (TLS_RSA_SIGN_SUPPORT == ENABLED)
+   //RSASSA-PSS signature scheme?
+   if(context->peerCertType == TLS_CERT_RSA_SIGN &&
+      signature->algorithm.hash == TLS_HASH_ALGO_INTRINSIC &&
+      (signature->algorithm.signature == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA256 ||
+      signature->algorithm.signature == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA384 ||
+      signature->algorithm.signature == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA512))
+   {
+      //The scheme implies the hash function
+      hash = tlsGetPssHashAlgo(signature->algorithm.signature);
+      //Make sure the hash function is available
+      if(hash == NULL) return ERROR_ILLEGAL_PARAMETER;
+
+      //Digest the content
+      error = hash->compute(content, length, digest);
+      //Any error to report?
+      if(error) return error;
+
+      //The length of the salt must be equal to the length of the digest
+      error = rsassaPssVerify(&context->peerRsaPublicKey, hash,
+         hash->digestSize, digest, signature->value, n);
+   }
+   else
+#endif
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+   //ECDSA signature scheme?
+   if(context->peerCertType == TLS_CERT_ECDSA_SIGN &&
+      signature->algorithm.signature == TLS_SIGN_ALGO_ECDSA)
+   {
+      //The hash function must match the curve of the key
+      if(signature->algorithm.hash != tls13GetEcdsaHashAlgo(&context->peerEcParams))
+         return ERROR_ILLEGAL_PARAMETER;
+
+      //Retrieve the hash function of the scheme
+      hash = tlsGetHashAlgo(signature->algorithm.hash);
+      //Make sure the hash function is available
+      if(hash == NULL) return ERROR_ILLEGAL_PARAMETER;
+
+      //Digest the content
+      error = hash->compute(content, length, digest);
+      //Any error to report?
+      if(error) return error;
+
+      //Verify the ECDSA signature
+      error = tlsVerifyEcdsaSignature(&context->peerEcParams,
+         &context->peerEcPublicKey, digest, hash->digestSize,
+         signature->value, n);
+   }
+   else
+#endif
+   //Invalid signature scheme?
+   {
+      //The scheme was not offered or does not match the certificate
+      return ERROR_ILLEGAL_PARAMETER;
+   }
+
+   //Signature verification failed?
+   if(error) return ERROR_INVALID_SIGNATURE;
+
+   //Update the hash value with the incoming handshake message
+   tlsUpdateHandshakeHash(context, message,
+      sizeof(TlsCertificateVerify) + sizeof(TlsDigitalSignature2) + n);
+
+   //Prepare to receive a Finished message
+   context->state = (context->entity == TLS_CONNECTION_END_CLIENT) ?
+      TLS_STATE_SERVER_FINISHED : TLS_STATE_CLIENT_FINISHED;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse Finished message (TLS 1.3)
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message Incoming Finished message to parse
+ * @param[in] length Message length
+ * @return Error code
+ **/
+
+error_t tls13ParseFinished(TlsContext *context,
+   const TlsFinished *message, size_t length)
+{
+   error_t error;
+   TlsConnectionEnd peer;
+
+   //Debug message
+   TRACE_INFO("Finished message received (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //Check current state
+   if(context->entity == TLS_CONNECTION_END_CLIENT)
+   {
+      if(context->state != TLS_STATE_SERVER_FINISHED)
+         return ERROR_UNEXPECTED_MESSAGE;
+
+      //The message is sent by the server
+      peer = TLS_CONNECTION_END_SERVER;
+   }
+   else
+   {
+      if(context->state != TLS_STATE_CLIENT_FINISHED)
+         return ERROR_UNEXPECTED_MESSAGE;
+
+      //The message is sent by the client
+      peer = TLS_CONNECTION_END_CLIENT;
+   }
+
+   //The verify data is computed from the transcript that
+   //precedes the Finished message
+   error = tls13ComputeVerifyData(context, peer);
+   //Unable to generate the verify data?
+   if(error) return error;
+
+   //Check the length of the Finished message
+   if(length != (sizeof(TlsFinished) + context->verifyDataLength))
+      return ERROR_DECODING_FAILED;
+
+   //Check the resulting verify data
+   if(memcmp(message->verifyData, context->verifyData, context->verifyDataLength))
+      return ERROR_INVALID_SIGNATURE;
+
+   //Update the hash value with the incoming handshake message
+   tlsUpdateHandshakeHash(context, message, length);
+
+   //TLS operates as a client or a server?
+   if(context->entity == TLS_CONNECTION_END_CLIENT)
+   {
+      //The application traffic secrets cover the server Finished message
+      error = tls13GenerateMasterSecret(context);
+      //Any error to report?
+      if(error) return error;
+
+      //Subsequent records sent by the server are protected with
+      //its application traffic keys
+      error = tls13InstallTrafficKeys(context, context->serverAppTrafficSecret,
+         TLS_CONNECTION_END_SERVER);
+      //Any error to report?
+      if(error) return error;
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+      //The 0-RTT data are terminated by an EndOfEarlyData message
+      if(context->earlyDataAccepted)
+      {
+         //The message is protected with the early traffic keys
+         context->state = TLS_STATE_END_OF_EARLY_DATA;
+         //Successful processing
+         return NO_ERROR;
+      }
+#endif
+
+      //The second flight of the client is protected with its
+      //handshake traffic keys
+      error = tls13InstallTrafficKeys(context, context->clientHsTrafficSecret,
+         TLS_CONNECTION_END_CLIENT);
+      //Any error to report?
+      if(error) return error;
+
+      //The client sends a Certificate message if requested
+      if(context->clientCertRequested)
+         context->state = TLS_STATE_CLIENT_CERTIFICATE;
+      else
+         context->state = TLS_STATE_CLIENT_FINISHED;
+   }
+   else
+   {
+      //The resumption master secret covers the client Finished message
+      error = tls13GenerateResumptionSecret(context);
+      //Any error to report?
+      if(error) return error;
+
+      //Subsequent records sent by the client are protected with
+      //its application traffic keys
+      error = tls13InstallTrafficKeys(context, context->clientAppTrafficSecret,
+         TLS_CONNECTION_END_CLIENT);
+      //Any error to report?
+      if(error) return error;
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+      //Session tickets are issued when a ticket context is available
+      if(context->ticketContext != NULL)
+         context->state = TLS_STATE_NEW_SESSION_TICKET;
+      else
+#endif
+         context->state = TLS_STATE_APPLICATION_DATA;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send KeyUpdate message
+ *
+ * The sender updates its application traffic secret once the message
+ * has been sent
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] updateRequested The peer must update its own keys in return
+ * @return Error code
+ **/
+
+error_t tls13SendKeyUpdate(TlsContext *context, bool_t updateRequested)
+{
+   error_t error;
+   size_t length;
+   uint8_t *secret;
+   TlsHandshake *message;
+
+   //Data the socket has not accepted yet must be sent first
+   error = tlsIoFlush(context, TRUE);
+   //Any error to report?
+   if(error) return error;
+
+   //Point to the KeyUpdate message
+   message = (TlsHandshake *) (context->txBuffer + sizeof(TlsRecord));
+   //Format message header
+   message->msgType = TLS_TYPE_KEY_UPDATE;
+   STORE24BE(1, message->length);
+   //Indicate whether the peer should also update its keys
+   message->data[0] = updateRequested ? 1 : 0;
+
+   //Length of the complete handshake message
+   length = sizeof(TlsHandshake) + 1;
+
+   //Debug message
+   TRACE_INFO("Sending KeyUpdate message (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //The message is protected with the current keys
+   error = tlsWriteProtocolData(context, length, TLS_TYPE_HANDSHAKE);
+   //Failed to send TLS record?
+   if(error) return error;
+
+   //Point to the application traffic secret of the local host
+   if(context->entity == TLS_CONNECTION_END_CLIENT)
+      secret = context->clientAppTrafficSecret;
+   else
+      secret = context->serverAppTrafficSecret;
+
+   //Compute the next generation of the secret
+   error = tls13UpdateTrafficSecret(context, secret);
+   //Any error to report?
+   if(error) return error;
+
+   //Subsequent records are protected with the new keys
+   return tls13InstallTrafficKeys(context, secret, context->entity);
+}
+
+
+/**
+ * @brief Parse KeyUpdate message
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message Incoming KeyUpdate message to parse
+ * @param[in] length Message length
+ * @return Error code
+ **/
+
+error_t tls13ParseKeyUpdate(TlsContext *context,
+   const TlsHandshake *message, size_t length)
+{
+   error_t error;
+   uint8_t *secret;
+   TlsConnectionEnd peer;
+
+   //Debug message
+   TRACE_INFO("KeyUpdate message received (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //The message consists of a single byte
+   if(length != (sizeof(TlsHandshake) + 1))
+      return ERROR_DECODING_FAILED;
+
+   //The request_update field must be either 0 or 1
+   if(message->data[0] > 1)
+      return ERROR_ILLEGAL_PARAMETER;
+
+   //Point to the application traffic secret of the peer
+   if(context->entity == TLS_CONNECTION_END_CLIENT)
+   {
+      peer = TLS_CONNECTION_END_SERVER;
+      secret = context->serverAppTrafficSecret;
+   }
+   else
+   {
+      peer = TLS_CONNECTION_END_CLIENT;
+      secret = context->clientAppTrafficSecret;
+   }
+
+   //Compute the next generation of the secret
+   error = tls13UpdateTrafficSecret(context, secret);
+   //Any error to report?
+   if(error) return error;
+
+   //Subsequent records sent by the peer are protected with the new keys
+   error = tls13InstallTrafficKeys(context, secret, peer);
+   //Any error to report?
+   if(error) return error;
+
+   //The peer requests the local host to update its keys as well?
+   if(message->data[0] == 1)
+      error = tls13SendKeyUpdate(context, FALSE);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Process a handshake message received after the handshake
+ *
+ * NewSessionTicket and KeyUpdate messages may be received at any time
+ * once the handshake is complete
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message Incoming handshake message
+ * @param[in] length Message length
+ * @return Error code
+ **/
+
+error_t tls13ParsePostHandshakeMessage(TlsContext *context,
+   const TlsHandshake *message, size_t length)
+{
+   error_t error;
+
+   //Check handshake message type
+   switch(message->msgType)
+   {
+#if (TLS_CLIENT_SUPPORT == ENABLED && TLS_TICKET_SUPPORT == ENABLED)
+   //NewSessionTicket message received?
+   case TLS_TYPE_NEW_SESSION_TICKET:
+      //Only the server can issue tickets
+      if(context->entity == TLS_CONNECTION_END_CLIENT)
+         error = tls13ParseNewSessionTicket(context, (TlsNewSessionTicket *) message, length);
+      else
+         error = ERROR_UNEXPECTED_MESSAGE;
+      break;
+#endif
+   //KeyUpdate message received?
+   case TLS_TYPE_KEY_UPDATE:
+      //The peer has updated its sending keys
+      error = tls13ParseKeyUpdate(context, message, length);
+      break;
+   //Invalid handshake message received?
+   default:
+      //Post-handshake client authentication is not supported
+      error = ERROR_UNEXPECTED_MESSAGE;
+      break;
+   }
+
+   //Return status code
+   return error;
+}
+
+#endif
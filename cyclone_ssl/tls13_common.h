@@ -0,0 +1,59 @@
+/**
+ * @file tls13_common.h
+ * @brief TLS 1.3 handshake messages common to client and server
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _TLS13_COMMON_H
+#define _TLS13_COMMON_H
+
+//Dependencies
+#include "tls.h"
+
+//Maximum size of the content covered by a CertificateVerify signature
+#define TLS13_MAX_SIGNED_CONTENT_SIZE (64 + 34 + MAX_HASH_DIGEST_SIZE)
+
+//TLS 1.3 related functions
+uint16_t tls13SelectSignScheme(const TlsCertDesc *cert,
+   const TlsSignHashAlgos *supportedSignAlgos);
+
+error_t tls13SendCertificate(TlsContext *context);
+error_t tls13SendCertificateVerify(TlsContext *context);
+error_t tls13SendFinished(TlsContext *context);
+error_t tls13SendKeyUpdate(TlsContext *context, bool_t updateRequested);
+
+error_t tls13ParseCertificateVerify(TlsContext *context,
+   const TlsCertificateVerify *message, size_t length);
+
+error_t tls13ParseFinished(TlsContext *context,
+   const TlsFinished *message, size_t length);
+
+error_t tls13ParseKeyUpdate(TlsContext *context,
+   const TlsHandshake *message, size_t length);
+
+error_t tls13ParsePostHandshakeMessage(TlsContext *context,
+   const TlsHandshake *message, size_t length);
+
+#endif
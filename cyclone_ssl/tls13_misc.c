@@ -0,0 +1,780 @@
+/**
+ * @file tls13_misc.c
+ * @brief TLS 1.3 helper functions
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * TLS 1.3 derives all its traffic keys from a chain of HKDF operations
+ * seeded with the pre-shared key and the (EC)DHE shared secret. Refer to
+ * RFC 8446, section 7 for more details
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_cipher_suites.h"
+#include "tls_misc.h"
+#include "tls13_misc.h"
+#include "hkdf.h"
+#include "debug.h"
+
+//Check SSL library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_MAX_VERSION >= TLS_VERSION_1_3)
+
+//Random value of a HelloRetryRequest (SHA-256 of "HelloRetryRequest")
+const uint8_t tls13HelloRetryRequestRandom[32] =
+{
+   0xCF, 0x21, 0xAD, 0x74, 0xE5, 0x9A, 0x61, 0x11, 0xBE, 0x1D, 0x8C, 0x02, 0x1E, 0x65, 0xB8, 0x91,
+   0xC2, 0xA2, 0x11, 0x16, 0x7A, 0xBB, 0x8C, 0x5E, 0x07, 0x9E, 0x09, 0xE2, 0xC8, 0xA8, 0x33, 0x9C
+};
+
+//Last bytes of the server random when TLS 1.2 is negotiated
+const uint8_t tls13DowngradeTls12Sentinel[8] =
+{
+   0x44, 0x4F, 0x57, 0x4E, 0x47, 0x52, 0x44, 0x01
+};
+
+//Last bytes of the server random when TLS 1.1 or below is negotiated
+const uint8_t tls13DowngradeTls11Sentinel[8] =
+{
+   0x44, 0x4F, 0x57, 0x4E, 0x47, 0x52, 0x44, 0x00
+};
+
+
+/**
+ * @brief HKDF-Expand-Label function
+ * @param[in] hash Hash function used by HKDF
+ * @param[in] secret Pointer to the secret
+ * @param[in] secretLength Length of the secret
+ * @param[in] label NULL-terminated label (without the "tls13 " prefix)
+ * @param[in] context Context value (may be NULL)
+ * @param[in] contextLength Length of the context value
+ * @param[out] output Buffer where to store the output keying material
+ * @param[in] outputLength Desired output length
+ * @return Error code
+ **/
+
+error_t tls13HkdfExpandLabel(const HashAlgo *hash, const uint8_t *secret,
+   size_t secretLength, const char_t *label, const uint8_t *context,
+   size_t contextLength, uint8_t *output, size_t outputLength)
+{
+   error_t error;
+   size_t n;
+   size_t labelLength;
+   uint8_t hkdfLabel[TLS13_MAX_HKDF_LABEL_SIZE];
+
+   //Compute the length of the label
+   labelLength = strlen(label);
+
+   //Make sure the HkdfLabel structure fits in the buffer
+   if((10 + labelLength + contextLength) > sizeof(hkdfLabel))
+      return ERROR_INVALID_PARAMETER;
+
+   //Length of the output keying material
+   STORE16BE(outputLength, hkdfLabel);
+   //All the labels are prefixed with the string "tls13 "
+   hkdfLabel[2] = (uint8_t) (6 + labelLength);
+   memcpy(hkdfLabel + 3, "tls13 ", 6);
+   memcpy(hkdfLabel + 9, label, labelLength);
+   n = 9 + labelLength;
+
+   //Append the context value
+   hkdfLabel[n++] = (uint8_t) contextLength;
+   if(contextLength > 0)
+      memcpy(hkdfLabel + n, context, contextLength);
+   n += contextLength;
+
+   //HKDF-Expand(Secret, HkdfLabel, Length)
+   error = hkdfExpand(hash, secret, secretLength, hkdfLabel, n,
+      output, outputLength);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Derive-Secret function
+ * @param[in] hash Hash function associated with the cipher suite
+ * @param[in] secret Pointer to the secret
+ * @param[in] label NULL-terminated label
+ * @param[in] messageHash Transcript hash of the messages, or NULL for an
+ *   empty transcript
+ * @param[out] output Buffer where to store the derived secret
+ * @return Error code
+ **/
+
+error_t tls13DeriveSecret(const HashAlgo *hash, const uint8_t *secret,
+   const char_t *label, const uint8_t *messageHash, uint8_t *output)
+{
+   error_t error;
+   uint8_t digest[MAX_HASH_DIGEST_SIZE];
+
+   //An empty transcript hashes to Hash("")
+   if(messageHash == NULL)
+   {
+      //Digest the empty string
+      error = hash->compute("", 0, digest);
+      //Any error to report?
+      if(error) return error;
+
+      //Point to the resulting digest
+      messageHash = digest;
+   }
+
+   //Derive-Secret(Secret, Label, Messages) =
+   //HKDF-Expand-Label(Secret, Label, Transcript-Hash(Messages), Hash.length)
+   return tls13HkdfExpandLabel(hash, secret, hash->digestSize, label,
+      messageHash, hash->digestSize, output, hash->digestSize);
+}
+
+
+/**
+ * @brief Compute the hash of the handshake messages exchanged so far
+ * @param[in] context Pointer to the TLS context
+ * @param[out] digest Buffer where to store the transcript hash
+ * @return Error code
+ **/
+
+error_t tls13GetTranscriptHash(TlsContext *context, uint8_t *digest)
+{
+   //The transcript hash uses the hash function of the cipher suite
+   return tlsFinalizeHandshakeHash(context, context->prfHashAlgo,
+      context->handshakeHashContext, "", digest);
+}
+
+
+/**
+ * @brief Replace the first ClientHello with its hash (HelloRetryRequest)
+ *
+ * When the server responds to a ClientHello with a HelloRetryRequest, the
+ * value of the first ClientHello is replaced with a special synthetic
+ * handshake message of type message_hash containing Hash(ClientHello1)
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13DigestClientHello(TlsContext *context)
+{
+   error_t error;
+   uint8_t header[4];
+   uint8_t digest[MAX_HASH_DIGEST_SIZE];
+
+   //Compute Hash(ClientHello1)
+   error = tls13GetTranscriptHash(context, digest);
+   //Any error to report?
+   if(error) return error;
+
+   //Format the header of the synthetic handshake message
+   header[0] = TLS_TYPE_MESSAGE_HASH;
+   STORE24BE(context->prfHashAlgo->digestSize, header + 1);
+
+   //Restart the transcript with the message_hash message
+   context->prfHashAlgo->init(context->handshakeHashContext);
+   context->prfHashAlgo->update(context->handshakeHashContext, header, sizeof(header));
+   context->prfHashAlgo->update(context->handshakeHashContext, digest,
+      context->prfHashAlgo->digestSize);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Compute the early secret
+ * @param[in] context Pointer to the TLS context
+ * @param[in] hash Hash function associated with the pre-shared key
+ * @param[in] psk Pre-shared key (NULL if no PSK is used)
+ * @param[in] pskLength Length of the pre-shared key
+ * @return Error code
+ **/
+
+error_t tls13GenerateEarlySecret(TlsContext *context, const HashAlgo *hash,
+   const uint8_t *psk, size_t pskLength)
+{
+   uint8_t zero[MAX_HASH_DIGEST_SIZE];
+
+   //A string of Hash.length zeroes is used when no PSK is available
+   if(psk == NULL)
+   {
+      memset(zero, 0, hash->digestSize);
+      psk = zero;
+      pskLength = hash->digestSize;
+   }
+
+   //Early Secret = HKDF-Extract(0, PSK)
+   return hkdfExtract(hash, psk, pskLength, NULL, 0, context->secret);
+}
+
+
+/**
+ * @brief Compute the handshake secret and the handshake traffic secrets
+ *
+ * This function must be called once the ServerHello message has been
+ * added to the transcript
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13GenerateHandshakeSecret(TlsContext *context)
+{
+   error_t error;
+   const HashAlgo *hash;
+   uint8_t derived[MAX_HASH_DIGEST_SIZE];
+   uint8_t digest[MAX_HASH_DIGEST_SIZE];
+
+   //Hash function associated with the cipher suite
+   hash = context->prfHashAlgo;
+
+   //Derive-Secret(Early Secret, "derived", "")
+   error = tls13DeriveSecret(hash, context->secret, "derived", NULL, derived);
+   //Any error to report?
+   if(error) return error;
+
+   //Handshake Secret = HKDF-Extract(derived, (EC)DHE shared secret)
+   error = hkdfExtract(hash, context->premasterSecret, context->premasterSecretLength,
+      derived, hash->digestSize, context->secret);
+   //Any error to report?
+   if(error) return error;
+
+   //The shared secret is no longer needed
+   memset(context->premasterSecret, 0, sizeof(context->premasterSecret));
+   context->premasterSecretLength = 0;
+
+   //Transcript-Hash(ClientHello...ServerHello)
+   error = tls13GetTranscriptHash(context, digest);
+   //Any error to report?
+   if(error) return error;
+
+   //client_handshake_traffic_secret
+   error = tls13DeriveSecret(hash, context->secret, "c hs traffic",
+      digest, context->clientHsTrafficSecret);
+   //Any error to report?
+   if(error) return error;
+
+   //server_handshake_traffic_secret
+   error = tls13DeriveSecret(hash, context->secret, "s hs traffic",
+      digest, context->serverHsTrafficSecret);
+   //Any error to report?
+   if(error) return error;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Compute the master secret and the application traffic secrets
+ *
+ * This function must be called once the server Finished message has been
+ * added to the transcript
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13GenerateMasterSecret(TlsContext *context)
+{
+   error_t error;
+   const HashAlgo *hash;
+   uint8_t derived[MAX_HASH_DIGEST_SIZE];
+   uint8_t digest[MAX_HASH_DIGEST_SIZE];
+
+   //Hash function associated with the cipher suite
+   hash = context->prfHashAlgo;
+
+   //Derive-Secret(Handshake Secret, "derived", "")
+   error = tls13DeriveSecret(hash, context->secret, "derived", NULL, derived);
+   //Any error to report?
+   if(error) return error;
+
+   //Master Secret = HKDF-Extract(derived, 0)
+   memset(digest, 0, hash->digestSize);
+   error = hkdfExtract(hash, digest, hash->digestSize, derived,
+      hash->digestSize, context->secret);
+   //Any error to report?
+   if(error) return error;
+
+   //Transcript-Hash(ClientHello...server Finished)
+   error = tls13GetTranscriptHash(context, digest);
+   //Any error to report?
+   if(error) return error;
+
+   //client_application_traffic_secret_0
+   error = tls13DeriveSecret(hash, context->secret, "c ap traffic",
+      digest, context->clientAppTrafficSecret);
+   //Any error to report?
+   if(error) return error;
+
+   //server_application_traffic_secret_0
+   error = tls13DeriveSecret(hash, context->secret, "s ap traffic",
+      digest, context->serverAppTrafficSecret);
+   //Any error to report?
+   if(error) return error;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Compute the resumption master secret
+ *
+ * This function must be called once the client Finished message has been
+ * added to the transcript
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13GenerateResumptionSecret(TlsContext *context)
+{
+   error_t error;
+   uint8_t digest[MAX_HASH_DIGEST_SIZE];
+
+   //Transcript-Hash(ClientHello...client Finished)
+   error = tls13GetTranscriptHash(context, digest);
+   //Any error to report?
+   if(error) return error;
+
+   //resumption_master_secret
+   return tls13DeriveSecret(context->prfHashAlgo, context->secret,
+      "res master", digest, context->resumptionMasterSecret);
+}
+
+
+/**
+ * @brief Derive the traffic keys from a traffic secret and install them
+ * @param[in] context Pointer to the TLS context
+ * @param[in] secret Traffic secret
+ * @param[in] sender Entity whose records are protected by the keys
+ * @return Error code
+ **/
+
+error_t tls13InstallTrafficKeys(TlsContext *context, const uint8_t *secret,
+   TlsConnectionEnd sender)
+{
+   error_t error;
+   uint8_t *key;
+   uint8_t *iv;
+   void **cipherContext;
+
+   //The write keys and the read keys occupy distinct parts of the key block
+   if(sender == context->entity)
+   {
+      key = context->keyBlock;
+      iv = context->keyBlock + 32;
+      cipherContext = &context->writeCipherContext;
+   }
+   else
+   {
+      key = context->keyBlock + 64;
+      iv = context->keyBlock + 96;
+      cipherContext = &context->readCipherContext;
+   }
+
+   //[sender]_write_key = HKDF-Expand-Label(Secret, "key", "", key_length)
+   error = tls13HkdfExpandLabel(context->prfHashAlgo, secret,
+      context->prfHashAlgo->digestSize, "key", NULL, 0, key, context->encKeyLength);
+   //Any error to report?
+   if(error) return error;
+
+   //[sender]_write_iv = HKDF-Expand-Label(Secret, "iv", "", iv_length)
+   error = tls13HkdfExpandLabel(context->prfHashAlgo, secret,
+      context->prfHashAlgo->digestSize, "iv", NULL, 0, iv, context->fixedIvLength);
+   //Any error to report?
+   if(error) return error;
+
+   //Allocate the cipher context the first time keys are installed
+   if(*cipherContext == NULL)
+   {
+      //Allocate a memory buffer to hold the encryption context
+      *cipherContext = osMemAlloc(context->cipherAlgo->contextSize);
+      //Failed to allocate memory?
+      if(*cipherContext == NULL) return ERROR_OUT_OF_MEMORY;
+   }
+
+   //Configure the encryption engine with the new key
+   error = context->cipherAlgo->init(*cipherContext, key, context->encKeyLength);
+   //Initialization failed?
+   if(error) return error;
+
+   //Each set of keys starts with a sequence number of zero
+   if(sender == context->entity)
+   {
+      context->writeEncKey = key;
+      context->writeIv = iv;
+      memset(context->writeSeqNum, 0, sizeof(TlsSequenceNumber));
+      context->changeCipherSpecSent = TRUE;
+   }
+   else
+   {
+      context->readEncKey = key;
+      context->readIv = iv;
+      memset(context->readSeqNum, 0, sizeof(TlsSequenceNumber));
+      context->changeCipherSpecReceived = TRUE;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release the cipher contexts
+ *
+ * The contexts must be released before a cipher suite with a different
+ * algorithm is selected (0-RTT data protected with a previous suite)
+ *
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tls13FreeTrafficKeys(TlsContext *context)
+{
+   //Release the encryption context
+   if(context->writeCipherContext != NULL)
+   {
+      memset(context->writeCipherContext, 0, context->cipherAlgo->contextSize);
+      osMemFree(context->writeCipherContext);
+      context->writeCipherContext = NULL;
+   }
+
+   //Release the decryption context
+   if(context->readCipherContext != NULL)
+   {
+      memset(context->readCipherContext, 0, context->cipherAlgo->contextSize);
+      osMemFree(context->readCipherContext);
+      context->readCipherContext = NULL;
+   }
+
+   //Subsequent records are not protected
+   context->changeCipherSpecSent = FALSE;
+   context->changeCipherSpecReceived = FALSE;
+}
+
+
+/**
+ * @brief Compute the next generation of an application traffic secret
+ * @param[in] context Pointer to the TLS context
+ * @param[in,out] secret Application traffic secret to be updated
+ * @return Error code
+ **/
+
+error_t tls13UpdateTrafficSecret(TlsContext *context, uint8_t *secret)
+{
+   uint8_t newSecret[MAX_HASH_DIGEST_SIZE];
+   error_t error;
+
+   //application_traffic_secret_N+1 = HKDF-Expand-Label(
+   //application_traffic_secret_N, "traffic upd", "", Hash.length)
+   error = tls13HkdfExpandLabel(context->prfHashAlgo, secret,
+      context->prfHashAlgo->digestSize, "traffic upd", NULL, 0,
+      newSecret, context->prfHashAlgo->digestSize);
+
+   //Check status code
+   if(!error)
+   {
+      //The previous secret is discarded
+      memcpy(secret, newSecret, context->prfHashAlgo->digestSize);
+   }
+
+   //Clear the temporary copy
+   memset(newSecret, 0, sizeof(newSecret));
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Compute the verify data of a Finished message
+ * @param[in] context Pointer to the TLS context
+ * @param[in] entity Entity sending the Finished message
+ * @return Error code
+ **/
+
+error_t tls13ComputeVerifyData(TlsContext *context, TlsConnectionEnd entity)
+{
+   error_t error;
+   const HashAlgo *hash;
+   const uint8_t *baseKey;
+   uint8_t finishedKey[MAX_HASH_DIGEST_SIZE];
+   uint8_t digest[MAX_HASH_DIGEST_SIZE];
+
+   //Hash function associated with the cipher suite
+   hash = context->prfHashAlgo;
+
+   //The base key is the handshake traffic secret of the sender
+   if(entity == TLS_CONNECTION_END_CLIENT)
+      baseKey = context->clientHsTrafficSecret;
+   else
+      baseKey = context->serverHsTrafficSecret;
+
+   //finished_key = HKDF-Expand-Label(BaseKey, "finished", "", Hash.length)
+   error = tls13HkdfExpandLabel(hash, baseKey, hash->digestSize,
+      "finished", NULL, 0, finishedKey, hash->digestSize);
+   //Any error to report?
+   if(error) return error;
+
+   //Transcript-Hash(Handshake Context, Certificate*, CertificateVerify*)
+   error = tls13GetTranscriptHash(context, digest);
+
+   //Check status code
+   if(!error)
+   {
+      //verify_data = HMAC(finished_key, Transcript-Hash(...))
+      error = hmacCompute(hash, finishedKey, hash->digestSize, digest,
+         hash->digestSize, context->verifyData);
+   }
+
+   //Clear the finished key
+   memset(finishedKey, 0, sizeof(finishedKey));
+   //Any error to report?
+   if(error) return error;
+
+   //The verify data is as long as the output of the hash function
+   context->verifyDataLength = hash->digestSize;
+
+   //Debug message
+   TRACE_DEBUG("Verify data:\r\n");
+   TRACE_DEBUG_ARRAY("  ", context->verifyData, context->verifyDataLength);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Compute the binder of a pre-shared key
+ *
+ * The binder is an HMAC over the transcript hash of a partial ClientHello
+ * that excludes the binders list. The early secret must have been computed
+ * from the pre-shared key beforehand
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] hash Hash function associated with the pre-shared key
+ * @param[in] clientHello Partial ClientHello message
+ * @param[in] length Length of the partial ClientHello message
+ * @param[out] binder Buffer where to store the binder (Hash.length bytes)
+ * @return Error code
+ **/
+
+error_t tls13ComputePskBinder(TlsContext *context, const HashAlgo *hash,
+   const void *clientHello, size_t length, uint8_t *binder)
+{
+   error_t error;
+   HashContext *hashContext;
+   uint8_t binderKey[MAX_HASH_DIGEST_SIZE];
+   uint8_t digest[MAX_HASH_DIGEST_SIZE];
+
+   //binder_key = Derive-Secret(Early Secret, "res binder", "")
+   error = tls13DeriveSecret(hash, context->secret, "res binder", NULL, binderKey);
+   //Any error to report?
+   if(error) return error;
+
+   //finished_key = HKDF-Expand-Label(binder_key, "finished", "", Hash.length)
+   error = tls13HkdfExpandLabel(hash, binderKey, hash->digestSize,
+      "finished", NULL, 0, binderKey, hash->digestSize);
+   //Any error to report?
+   if(error) return error;
+
+   //Allocate a temporary hash context
+   hashContext = osMemAlloc(hash->contextSize);
+   //Failed to allocate memory?
+   if(hashContext == NULL) return ERROR_OUT_OF_MEMORY;
+
+   //After a HelloRetryRequest, the transcript already contains the
+   //synthetic message_hash message and the HelloRetryRequest
+   if(context->handshakeHashContext != NULL)
+      memcpy(hashContext, context->handshakeHashContext, hash->contextSize);
+   else
+      hash->init(hashContext);
+
+   //Transcript-Hash(Truncate(ClientHello))
+   hash->update(hashContext, clientHello, length);
+   hash->final(hashContext, digest);
+
+   //Release the hash context
+   osMemFree(hashContext);
+
+   //binder = HMAC(finished_key, Transcript-Hash(Truncate(ClientHello)))
+   error = hmacCompute(hash, binderKey, hash->digestSize, digest,
+      hash->digestSize, binder);
+
+   //Clear the binder key
+   memset(binderKey, 0, sizeof(binderKey));
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Generate an ephemeral key pair for the specified group
+ * @param[in] context Pointer to the TLS context
+ * @param[in] namedGroup Named group
+ * @return Error code
+ **/
+
+error_t tls13GenerateKeyShare(TlsContext *context, uint16_t namedGroup)
+{
+   error_t error;
+   const EcCurveInfo *curveInfo;
+
+   //Retrieve the elliptic curve to be used
+   curveInfo = tlsGetCurveInfo(namedGroup);
+   //Make sure the group is supported
+   if(curveInfo == NULL)
+      return ERROR_ILLEGAL_PARAMETER;
+
+   //Discard the key pair generated for another group, if any
+   ecdhFree(&context->ecdhContext);
+   ecdhInit(&context->ecdhContext);
+
+   //Load EC domain parameters
+   error = ecLoadDomainParameters(&context->ecdhContext.params, curveInfo);
+   //Any error to report?
+   if(error) return error;
+
+   //Generate an ephemeral key pair
+   error = ecdhGenerateKeyPair(&context->ecdhContext,
+      context->prngAlgo, context->prngContext);
+   //Any error to report?
+   if(error) return error;
+
+   //Save the selected group
+   context->namedCurve = namedGroup;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Format a KeyShareEntry with the local ephemeral public key
+ * @param[in] context Pointer to the TLS context
+ * @param[out] entry Buffer where to format the KeyShareEntry
+ * @param[out] length Total number of bytes that have been written
+ * @return Error code
+ **/
+
+error_t tls13FormatKeyShareEntry(TlsContext *context,
+   TlsKeyShareEntry *entry, size_t *length)
+{
+   error_t error;
+   size_t n;
+
+   //Encode the public value (uncompressed point, or u-coordinate for X25519)
+   error = ecdhExportPublicKey(&context->ecdhContext, entry->keyExchange, &n);
+   //Any error to report?
+   if(error) return error;
+
+   //Fill in the header of the entry
+   entry->group = htons(context->namedCurve);
+   entry->length = htons(n);
+
+   //Return the total number of bytes that have been written
+   *length = sizeof(TlsKeyShareEntry) + n;
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Compute the (EC)DHE shared secret from the peer's key share
+ * @param[in] context Pointer to the TLS context
+ * @param[in] keyExchange Peer's public value (NULL if the value has
+ *   already been loaded in the ECDH context)
+ * @param[in] length Length of the public value
+ * @return Error code
+ **/
+
+error_t tls13ComputeSharedSecret(TlsContext *context,
+   const uint8_t *keyExchange, size_t length)
+{
+   error_t error;
+
+   //The server loads the public value of the client when it parses the
+   //ClientHello, but computes the shared secret after sending its own
+   if(keyExchange != NULL)
+   {
+      //Load the peer's public value and make sure it is valid
+      error = ecdhImportPeerPublicKey(&context->ecdhContext, keyExchange, length);
+      //Any error to report?
+      if(error) return ERROR_ILLEGAL_PARAMETER;
+   }
+
+   //Compute the shared secret
+   error = ecdhComputeSharedSecret(&context->ecdhContext, context->premasterSecret,
+      sizeof(context->premasterSecret), &context->premasterSecretLength);
+   //Any error to report?
+   if(error) return error;
+
+   //The ephemeral private key is no longer needed
+   ecdhFree(&context->ecdhContext);
+   ecdhInit(&context->ecdhContext);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Get the hash function associated with a TLS 1.3 cipher suite
+ * @param[in] identifier Cipher suite identifier
+ * @return Hash function (NULL if the cipher suite is not supported)
+ **/
+
+const HashAlgo *tls13GetCipherSuiteHash(uint16_t identifier)
+{
+   uint_t i;
+   uint_t n;
+
+   //Only TLS 1.3 cipher suites are considered
+   if(!TLS13_CIPHER_SUITE(identifier))
+      return NULL;
+
+   //Determine the number of supported cipher suites
+   n = tlsGetNumSupportedCipherSuites();
+
+   //Loop through the list of supported cipher suites
+   for(i = 0; i < n; i++)
+   {
+      //Compare cipher suite identifiers
+      if(tlsSupportedCipherSuites[i].identifier == identifier)
+         return tlsSupportedCipherSuites[i].prfHashAlgo;
+   }
+
+   //The cipher suite is not supported
+   return NULL;
+}
+
+#endif
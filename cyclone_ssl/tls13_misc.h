@@ -0,0 +1,81 @@
+/**
+ * @file tls13_misc.h
+ * @brief TLS 1.3 helper functions
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _TLS13_MISC_H
+#define _TLS13_MISC_H
+
+//Dependencies
+#include "tls.h"
+
+//Maximum size of the HkdfLabel structure
+#define TLS13_MAX_HKDF_LABEL_SIZE 96
+
+//TLS 1.3 related constants
+extern const uint8_t tls13HelloRetryRequestRandom[32];
+extern const uint8_t tls13DowngradeTls12Sentinel[8];
+extern const uint8_t tls13DowngradeTls11Sentinel[8];
+
+//TLS 1.3 related functions
+error_t tls13HkdfExpandLabel(const HashAlgo *hash, const uint8_t *secret,
+   size_t secretLength, const char_t *label, const uint8_t *context,
+   size_t contextLength, uint8_t *output, size_t outputLength);
+
+error_t tls13DeriveSecret(const HashAlgo *hash, const uint8_t *secret,
+   const char_t *label, const uint8_t *messageHash, uint8_t *output);
+
+error_t tls13GetTranscriptHash(TlsContext *context, uint8_t *digest);
+error_t tls13DigestClientHello(TlsContext *context);
+
+error_t tls13GenerateEarlySecret(TlsContext *context, const HashAlgo *hash,
+   const uint8_t *psk, size_t pskLength);
+
+error_t tls13GenerateHandshakeSecret(TlsContext *context);
+error_t tls13GenerateMasterSecret(TlsContext *context);
+error_t tls13GenerateResumptionSecret(TlsContext *context);
+
+error_t tls13InstallTrafficKeys(TlsContext *context, const uint8_t *secret,
+   TlsConnectionEnd sender);
+
+void tls13FreeTrafficKeys(TlsContext *context);
+error_t tls13UpdateTrafficSecret(TlsContext *context, uint8_t *secret);
+error_t tls13ComputeVerifyData(TlsContext *context, TlsConnectionEnd entity);
+
+error_t tls13ComputePskBinder(TlsContext *context, const HashAlgo *hash,
+   const void *clientHello, size_t length, uint8_t *binder);
+
+error_t tls13GenerateKeyShare(TlsContext *context, uint16_t namedGroup);
+
+error_t tls13FormatKeyShareEntry(TlsContext *context,
+   TlsKeyShareEntry *entry, size_t *length);
+
+error_t tls13ComputeSharedSecret(TlsContext *context,
+   const uint8_t *keyExchange, size_t length);
+
+const HashAlgo *tls13GetCipherSuiteHash(uint16_t identifier);
+
+#endif
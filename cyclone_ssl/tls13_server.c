@@ -0,0 +1,1483 @@
+/**
+ * @file tls13_server.c
+ * @brief TLS 1.3 server
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Server side of the TLS 1.3 handshake: ClientHello processing, key share
+ * negotiation, PSK resumption with session tickets and 0-RTT data. Refer
+ * to RFC 8446 for more details
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_cipher_suites.h"
+#include "tls_server.h"
+#include "tls_common.h"
+#include "tls_record.h"
+#include "tls_ticket.h"
+#include "tls_misc.h"
+#include "tls13_misc.h"
+#include "tls13_common.h"
+#include "tls13_server.h"
+#include "debug.h"
+
+//Check SSL library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_SERVER_SUPPORT == ENABLED && \
+   TLS_MAX_VERSION >= TLS_VERSION_1_3)
+
+
+/**
+ * @brief Process the current state of the TLS 1.3 server handshake
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13ServerHandshakeStep(TlsContext *context)
+{
+   error_t error;
+
+   //The TLS 1.3 handshake is implemented as a state machine
+   //representing the current location in the protocol
+   switch(context->state)
+   {
+   //Send HelloRetryRequest message?
+   case TLS_STATE_HELLO_RETRY_REQUEST:
+      //The ClientHello does not carry an acceptable key share
+      error = tls13SendHelloRetryRequest(context);
+      break;
+   //Send ServerHello message?
+   case TLS_STATE_SERVER_HELLO:
+      //The server selects the parameters of the connection
+      TLS_PROFILE_START(context, TLS_PROFILE_KEY_EXCHANGE);
+      error = tls13SendServerHello(context);
+      TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_EXCHANGE);
+      break;
+   //Send EncryptedExtensions message?
+   case TLS_STATE_ENCRYPTED_EXTENSIONS:
+      //This message is the first one protected with the
+      //handshake traffic keys
+      error = tls13SendEncryptedExtensions(context);
+      break;
+   //Send CertificateRequest message?
+   case TLS_STATE_CERTIFICATE_REQUEST:
+      //The server requests client authentication
+      error = tls13SendCertificateRequest(context);
+      break;
+   //Send Certificate message?
+   case TLS_STATE_SERVER_CERTIFICATE:
+      //The server sends its certificate chain unless a PSK is used
+      error = tls13SendCertificate(context);
+      break;
+   //Send CertificateVerify message?
+   case TLS_STATE_SERVER_CERTIFICATE_VERIFY:
+      //The server proves the possession of its private key
+      TLS_PROFILE_START(context, TLS_PROFILE_KEY_EXCHANGE);
+      error = tls13SendCertificateVerify(context);
+      TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_EXCHANGE);
+      break;
+   //Send Finished message?
+   case TLS_STATE_SERVER_FINISHED:
+      //The Finished message authenticates the handshake
+      error = tls13SendFinished(context);
+      break;
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //Send NewSessionTicket message?
+   case TLS_STATE_NEW_SESSION_TICKET:
+      //The ticket allows the client to resume the session
+      error = tls13SendNewSessionTicket(context);
+      break;
+#endif
+   //Wait for a message from the client?
+   case TLS_STATE_CLIENT_HELLO:
+   case TLS_STATE_END_OF_EARLY_DATA:
+   case TLS_STATE_CLIENT_CERTIFICATE:
+   case TLS_STATE_CERTIFICATE_VERIFY:
+   case TLS_STATE_CLIENT_FINISHED:
+      //Parse incoming handshake message
+      error = tls13ParseClientMessage(context);
+      break;
+   //A fatal error was encountered?
+   case TLS_STATE_FATAL_ERROR:
+      //Debug message
+      TRACE_WARNING("TLS handshake failure!\r\n");
+      //Terminate immediately the connection
+      error = ERROR_HANDSHAKE_FAILED;
+      break;
+   //Invalid state?
+   default:
+      //Report an error and exit immediately
+      error = ERROR_UNEXPECTED_STATE;
+      break;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Parse incoming handshake message (TLS 1.3)
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13ParseClientMessage(TlsContext *context)
+{
+   error_t error;
+   size_t length;
+   void *message;
+   TlsContentType contentType;
+
+   //A message can be fragmented across several records...
+   error = tlsReadProtocolData(context, &message, &length, &contentType);
+   //Any error to report?
+   if(error) return error;
+
+   //Handshake message received?
+   if(contentType == TLS_TYPE_HANDSHAKE)
+   {
+      //Check handshake message type
+      switch(((TlsHandshake *) message)->msgType)
+      {
+      //ClientHello message received?
+      case TLS_TYPE_CLIENT_HELLO:
+         //The client sends a second ClientHello in response
+         //to a HelloRetryRequest message
+         error = tlsParseClientHello(context, message, length);
+         break;
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+      //EndOfEarlyData message received?
+      case TLS_TYPE_END_OF_EARLY_DATA:
+         //The message terminates the 0-RTT data
+         error = tls13ParseEndOfEarlyData(context, message, length);
+         break;
+#endif
+      //Certificate message received?
+      case TLS_TYPE_CERTIFICATE:
+         //This message is only sent if the server requests a certificate
+         TLS_PROFILE_START(context, TLS_PROFILE_CERTIFICATE);
+         error = tlsParseCertificate(context, message, length);
+         TLS_PROFILE_STOP(context, TLS_PROFILE_CERTIFICATE);
+         break;
+      //CertificateVerify message received?
+      case TLS_TYPE_CERTIFICATE_VERIFY:
+         //The client proves the possession of its private key
+         TLS_PROFILE_START(context, TLS_PROFILE_KEY_EXCHANGE);
+         error = tls13ParseCertificateVerify(context, message, length);
+         TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_EXCHANGE);
+         break;
+      //Finished message received?
+      case TLS_TYPE_FINISHED:
+         //The Finished message concludes the handshake
+         error = tls13ParseFinished(context, message, length);
+         break;
+      //Invalid handshake message received?
+      default:
+         //Report an error
+         error = ERROR_UNEXPECTED_MESSAGE;
+         break;
+      }
+   }
+   //Alert message received?
+   else if(contentType == TLS_TYPE_ALERT)
+   {
+      //Parse Alert message
+      error = tlsParseAlert(context, message, length);
+   }
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   //0-RTT data received?
+   else if(contentType == TLS_TYPE_APPLICATION_DATA &&
+      context->state == TLS_STATE_END_OF_EARLY_DATA)
+   {
+      //The data are delivered to the application once the
+      //handshake is complete
+      error = tls13ParseEarlyData(context, message, length);
+   }
+#endif
+   //Application data received?
+   else
+   {
+      //The client cannot transmit application data
+      //before the handshake is completed
+      error = ERROR_UNEXPECTED_MESSAGE;
+   }
+
+   //Advance read index
+   context->rxBufferReadIndex += length;
+   //Number of bytes still pending in the receive buffer
+   context->rxBufferLength -= length;
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Check whether the client offers TLS 1.3
+ * @param[in] extension SupportedVersions extension (may be NULL)
+ * @return TRUE if TLS 1.3 is listed in the extension, else FALSE
+ **/
+
+bool_t tls13IsVersionOffered(const TlsExtension *extension)
+{
+   size_t i;
+   size_t n;
+
+   //The client does not support TLS 1.3 if the extension is absent
+   if(extension == NULL)
+      return FALSE;
+
+   //Retrieve the length of the extension
+   n = ntohs(extension->length);
+
+   //Malformed extension?
+   if(n < 1 || extension->value[0] != (n - 1))
+      return FALSE;
+
+   //Loop through the list of versions
+   for(i = 1; (i + 1) < n; i += 2)
+   {
+      //TLS 1.3 found?
+      if(LOAD16BE(extension->value + i) == TLS_VERSION_1_3)
+         return TRUE;
+   }
+
+   //TLS 1.3 is not offered
+   return FALSE;
+}
+
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+
+/**
+ * @brief Process the PreSharedKey extension of the ClientHello
+ *
+ * The ticket of the first identity is decrypted and the corresponding
+ * binder is verified. The early secret is derived from the PSK
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message ClientHello message
+ * @param[in] extensions List of extensions
+ * @param[in] extensionsLength Length of the list of extensions
+ * @param[out] ticketAge Age of the ticket, as reported by the client
+ * @param[out] ticketCipherSuite Cipher suite of the resumed session
+ * @return Error code
+ **/
+
+static error_t tls13ParsePreSharedKey(TlsContext *context,
+   const TlsClientHello *message, const uint8_t *extensions,
+   size_t extensionsLength, uint32_t *ticketAge, uint16_t *ticketCipherSuite)
+{
+   error_t error;
+   uint_t i;
+   size_t n;
+   size_t ticketLength;
+   uint16_t cipherSuite;
+   const uint8_t *p;
+   const uint8_t *ticket;
+   const uint8_t *binders;
+   const HashAlgo *hash;
+   const TlsExtension *extension;
+   uint8_t binder[MAX_HASH_DIGEST_SIZE];
+
+   //Search for the PreSharedKey extension
+   extension = tlsGetExtension(extensions, extensionsLength, TLS_EXT_PRE_SHARED_KEY);
+   //No PSK offered?
+   if(extension == NULL)
+      return ERROR_NOT_FOUND;
+
+   //The extension must be the last one of the ClientHello
+   if((extension->value + ntohs(extension->length)) !=
+      (extensions + 2 + LOAD16BE(extensions)))
+   {
+      //Report an error
+      return ERROR_ILLEGAL_PARAMETER;
+   }
+
+   //Point to the list of identities
+   p = extension->value;
+   n = ntohs(extension->length);
+
+   //Malformed extension?
+   if(n < 2 || n < (LOAD16BE(p) + 2u))
+      return ERROR_DECODING_FAILED;
+
+   //The binders follow the list of identities
+   binders = p + LOAD16BE(p) + 2;
+
+   //Malformed list of binders?
+   if((binders + 2) > (p + n) || (binders + 2 + LOAD16BE(binders)) != (p + n))
+      return ERROR_DECODING_FAILED;
+
+   //Only the first identity is considered
+   if(LOAD16BE(p) < 2 || LOAD16BE(p) < (LOAD16BE(p + 2) + 6u))
+      return ERROR_DECODING_FAILED;
+
+   //Point to the ticket
+   ticketLength = LOAD16BE(p + 2);
+   ticket = p + 4;
+   //Get the obfuscated age of the ticket
+   *ticketAge = LOAD32BE(ticket + ticketLength);
+
+   //The client must support the psk_dhe_ke mode, as the psk_ke
+   //mode would not provide forward secrecy
+   extension = tlsGetExtension(extensions, extensionsLength,
+      TLS_EXT_PSK_KEY_EXCHANGE_MODES);
+
+   //The PskKeyExchangeModes extension is mandatory
+   if(extension == NULL)
+      return ERROR_ILLEGAL_PARAMETER;
+   //Malformed extension?
+   if(ntohs(extension->length) < 1 || extension->value[0] != (ntohs(extension->length) - 1))
+      return ERROR_DECODING_FAILED;
+
+   //Look for the psk_dhe_ke mode
+   for(i = 0; i < extension->value[0]; i++)
+   {
+      if(extension->value[i + 1] == TLS_PSK_KEY_EXCH_MODE_PSK_DHE_KE)
+         break;
+   }
+
+   //The PSK cannot be used?
+   if(i >= extension->value[0])
+      return ERROR_NOT_FOUND;
+
+   //Save the cipher suite selected for the connection
+   cipherSuite = context->cipherSuite;
+   hash = context->prfHashAlgo;
+
+   //Decrypt the ticket and restore the state of the session
+   error = tlsDecryptTicket(context, ticket, ticketLength);
+
+   //The cipher suite of the session must use the same hash function
+   if(!error && context->prfHashAlgo != hash)
+      error = ERROR_HANDSHAKE_FAILED;
+
+   //Keep track of the cipher suite of the session (0-RTT data)
+   *ticketCipherSuite = context->cipherSuite;
+
+   //Restore the cipher suite selected for the connection
+   if(tlsSetCipherSuite(context, cipherSuite))
+      return ERROR_HANDSHAKE_FAILED;
+
+   //The server falls back to a full handshake if the ticket is invalid
+   if(error)
+      return ERROR_NOT_FOUND;
+
+   //Early Secret = HKDF-Extract(0, PSK)
+   error = tls13GenerateEarlySecret(context, hash,
+      context->masterSecret, hash->digestSize);
+   //Any error to report?
+   if(error) return error;
+
+   //Malformed binder?
+   if(LOAD16BE(binders) < (hash->digestSize + 1) || binders[2] != hash->digestSize)
+      return ERROR_DECODING_FAILED;
+
+   //The binder covers the message up to, but not including, the binders list
+   error = tls13ComputePskBinder(context, hash, message,
+      binders - (uint8_t *) message, binder);
+   //Any error to report?
+   if(error) return error;
+
+   //A server that fails to validate the binder must abort the handshake
+   if(memcmp(binder, binders + 3, hash->digestSize))
+      return ERROR_INVALID_SIGNATURE;
+
+   //The PSK is used to resume the session
+   return NO_ERROR;
+}
+
+#endif
+
+
+/**
+ * @brief Parse ClientHello message (TLS 1.3)
+ *
+ * This function is called by tlsParseClientHello() when the client
+ * offers TLS 1.3 in the SupportedVersions extension
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message Incoming ClientHello message to parse
+ * @param[in] length Message length
+ * @param[in] cipherSuites List of cipher suites offered by the client
+ * @param[in] compressionMethods List of compression methods
+ * @param[in] extensions List of extensions
+ * @param[in] extensionsLength Length of the list of extensions
+ * @return Error code
+ **/
+
+error_t tls13ParseClientHello(TlsContext *context, const TlsClientHello *message,
+   size_t length, const TlsCipherSuites *cipherSuites,
+   const TlsCompressionMethods *compressionMethods,
+   const uint8_t *extensions, size_t extensionsLength)
+{
+   error_t error;
+   uint_t i;
+   uint_t k;
+   size_t n;
+   uint16_t namedGroup;
+   uint16_t signScheme;
+   uint32_t ticketAge;
+   uint16_t ticketCipherSuite;
+   const uint8_t *p;
+   const TlsExtension *extension;
+   const TlsKeyShareEntry *keyShare;
+   const TlsSignHashAlgos *supportedSignAlgos;
+
+   //A second ClientHello must still offer TLS 1.3
+   extension = tlsGetExtension(extensions, extensionsLength, TLS_EXT_SUPPORTED_VERSIONS);
+   if(!tls13IsVersionOffered(extension))
+      return ERROR_ILLEGAL_PARAMETER;
+
+   //Compression is not supported by TLS 1.3
+   if(compressionMethods->length != 1 ||
+      compressionMethods->value[0] != TLS_COMPRESSION_METHOD_NULL)
+   {
+      //Report an error
+      return ERROR_ILLEGAL_PARAMETER;
+   }
+
+   //Get the legacy version field
+   context->clientVersion = ntohs(message->clientVersion);
+
+   //Select TLS 1.3
+   error = tlsSetVersion(context, TLS_VERSION_1_3);
+   //Any error to report?
+   if(error) return error;
+
+   error = tlsSetCompressionMethod(context, TLS_COMPRESSION_METHOD_NULL);
+   //Any error to report?
+   if(error) return error;
+
+   //Save client random value
+   context->clientRandom = message->random;
+
+   //The server echoes the legacy session ID of the client
+   memcpy(context->sessionId, message->sessionId.value, message->sessionId.length);
+   context->sessionIdLength = message->sessionId.length;
+
+   //Get the number of cipher suites offered by the client
+   k = ntohs(cipherSuites->length) / 2;
+
+   //The list is sorted by client preference
+   for(i = 0; i < k; i++)
+   {
+      //After a HelloRetryRequest, the cipher suite cannot change
+      if(context->helloRetryRequest)
+      {
+         if(ntohs(cipherSuites->value[i]) == context->cipherSuite)
+            break;
+      }
+      //Check whether the current cipher suite is supported
+      else if(TLS13_CIPHER_SUITE(ntohs(cipherSuites->value[i])))
+      {
+         if(!tlsSetCipherSuite(context, ntohs(cipherSuites->value[i])))
+            break;
+      }
+   }
+
+   //No acceptable cipher suite?
+   if(i >= k)
+   {
+      //The second ClientHello must offer the cipher suite
+      //of the HelloRetryRequest
+      if(context->helloRetryRequest)
+         return ERROR_ILLEGAL_PARAMETER;
+      else
+         return ERROR_HANDSHAKE_FAILED;
+   }
+
+#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+   //With TLS 1.3, the limit advertised by the client includes
+   //the content type byte
+   extension = tlsGetExtension(extensions, extensionsLength, TLS_EXT_RECORD_SIZE_LIMIT);
+
+   //RecordSizeLimit extension found?
+   if(extension != NULL)
+   {
+      //The extension has been checked by tlsParseClientHello()
+      context->recordSizeLimit = min(LOAD16BE(extension->value) - 1,
+         TLS_MAX_RECORD_LENGTH);
+   }
+#endif
+
+   //Start the transcript, if necessary
+   if(context->handshakeHashContext == NULL)
+   {
+      //Initialize handshake message hashing
+      error = tlsInitHandshakeHash(context);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //Search for the KeyShare extension
+   extension = tlsGetExtension(extensions, extensionsLength, TLS_EXT_KEY_SHARE);
+   //No acceptable key share so far
+   keyShare = NULL;
+
+   //KeyShare extension found?
+   if(extension != NULL)
+   {
+      //Point to the list of KeyShareEntry structures
+      p = extension->value;
+      n = ntohs(extension->length);
+
+      //Malformed extension?
+      if(n < 2 || n != (LOAD16BE(p) + 2u))
+         return ERROR_DECODING_FAILED;
+
+      //Point to the first entry
+      p += 2;
+      n -= 2;
+
+      //Loop through the entries
+      while(n > 0)
+      {
+         //Malformed entry?
+         if(n < sizeof(TlsKeyShareEntry))
+            return ERROR_DECODING_FAILED;
+
+         //Length of the current entry
+         k = sizeof(TlsKeyShareEntry) + ntohs(((TlsKeyShareEntry *) p)->length);
+
+         //Malformed entry?
+         if(n < k)
+            return ERROR_DECODING_FAILED;
+
+         //Retrieve the group of the entry
+         namedGroup = ntohs(((TlsKeyShareEntry *) p)->group);
+
+         //Select the first entry whose group is supported. The second
+         //ClientHello must use the group of the HelloRetryRequest
+         if(keyShare == NULL && tlsGetCurveInfo(namedGroup) != NULL &&
+            (!context->helloRetryRequest || namedGroup == context->namedCurve))
+         {
+            keyShare = (TlsKeyShareEntry *) p;
+         }
+
+         //Jump to the next entry
+         p += k;
+         n -= k;
+      }
+   }
+
+   //The server responds with a HelloRetryRequest if no acceptable
+   //key share is provided
+   if(keyShare == NULL)
+   {
+      //Only one HelloRetryRequest can be sent
+      if(context->helloRetryRequest)
+         return ERROR_ILLEGAL_PARAMETER;
+
+      //Search for the SupportedGroups extension
+      extension = tlsGetExtension(extensions, extensionsLength, TLS_EXT_ELLIPTIC_CURVES);
+
+      //The extension is mandatory when (EC)DHE is used
+      if(extension == NULL)
+         return ERROR_HANDSHAKE_FAILED;
+
+      //Malformed extension?
+      n = ntohs(extension->length);
+      if(n < 2 || n != (LOAD16BE(extension->value) + 2u))
+         return ERROR_DECODING_FAILED;
+
+      //The list is sorted by client preference
+      for(i = 2, namedGroup = TLS_EC_CURVE_NONE; (i + 1) < n; i += 2)
+      {
+         //Check whether the current group is supported
+         if(tlsGetCurveInfo(LOAD16BE(extension->value + i)) != NULL)
+         {
+            namedGroup = LOAD16BE(extension->value + i);
+            break;
+         }
+      }
+
+      //No common group?
+      if(namedGroup == TLS_EC_CURVE_NONE)
+         return ERROR_HANDSHAKE_FAILED;
+
+      //Update the hash value with the first ClientHello
+      tlsUpdateHandshakeHash(context, message, length);
+
+      //The first ClientHello is replaced with its hash
+      error = tls13DigestClientHello(context);
+      //Any error to report?
+      if(error) return error;
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+      //The 0-RTT data offered by the client are skipped
+      if(tlsGetExtension(extensions, extensionsLength, TLS_EXT_EARLY_DATA) != NULL)
+         context->earlyDataRejected = TRUE;
+#endif
+
+      //Ask the client for a key share in the selected group
+      context->namedCurve = namedGroup;
+      context->state = TLS_STATE_HELLO_RETRY_REQUEST;
+
+      //Successful processing
+      return NO_ERROR;
+   }
+
+   //Generate an ephemeral key pair in the group selected by the client
+   error = tls13GenerateKeyShare(context, ntohs(keyShare->group));
+   //Any error to report?
+   if(error) return error;
+
+   //Load the public value of the client. The shared secret is computed
+   //once the ServerHello has been sent
+   error = ecdhImportPeerPublicKey(&context->ecdhContext,
+      keyShare->keyExchange, ntohs(keyShare->length));
+   //Invalid public value?
+   if(error) return ERROR_ILLEGAL_PARAMETER;
+
+   //No PSK has been accepted so far
+   context->resume = FALSE;
+   ticketAge = 0;
+   ticketCipherSuite = 0;
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //Tickets are only accepted when a ticket context is available
+   if(context->ticketContext != NULL)
+   {
+      //Process the PreSharedKey extension
+      error = tls13ParsePreSharedKey(context, message, extensions,
+         extensionsLength, &ticketAge, &ticketCipherSuite);
+
+      //Check status code
+      if(!error)
+      {
+         //Resume the session
+         context->resume = TRUE;
+      }
+      else if(error != ERROR_NOT_FOUND)
+      {
+         //Report an error
+         return error;
+      }
+   }
+#endif
+
+   //Full handshake?
+   if(!context->resume)
+   {
+      //Early Secret = HKDF-Extract(0, 0)
+      error = tls13GenerateEarlySecret(context, context->prfHashAlgo, NULL, 0);
+      //Any error to report?
+      if(error) return error;
+
+      //Search for the SignatureAlgorithms extension
+      extension = tlsGetExtension(extensions, extensionsLength, TLS_EXT_SIGNATURE_ALGORITHMS);
+
+      //The extension is mandatory when a certificate is used
+      if(extension == NULL)
+         return ERROR_HANDSHAKE_FAILED;
+
+      //Point to the list of signature schemes
+      supportedSignAlgos = (TlsSignHashAlgos *) extension->value;
+
+      //Check the length of the list
+      if(ntohs(extension->length) < sizeof(TlsSignHashAlgos))
+         return ERROR_DECODING_FAILED;
+      if(ntohs(extension->length) != (sizeof(TlsSignHashAlgos) + ntohs(supportedSignAlgos->length)))
+         return ERROR_DECODING_FAILED;
+
+      //No suitable certificate has been found for the moment
+      context->cert = NULL;
+
+      //Loop through the list of available certificates
+      for(i = 0; i < context->numCerts; i++)
+      {
+         //The certificate can be used if its key matches one of the
+         //signature schemes supported by the client
+         signScheme = tls13SelectSignScheme(&context->certs[i], supportedSignAlgos);
+
+         //Suitable certificate found?
+         if(signScheme != 0)
+         {
+            context->cert = &context->certs[i];
+            context->signScheme = signScheme;
+            break;
+         }
+      }
+
+      //The server cannot authenticate itself?
+      if(context->cert == NULL)
+         return ERROR_HANDSHAKE_FAILED;
+   }
+
+   //Update the hash value with the incoming handshake message
+   tlsUpdateHandshakeHash(context, message, length);
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   //The early data of the first ClientHello have been skipped
+   context->earlyDataRejected = FALSE;
+
+   //Search for the EarlyData extension
+   extension = tlsGetExtension(extensions, extensionsLength, TLS_EXT_EARLY_DATA);
+
+   //The client offers 0-RTT data?
+   if(extension != NULL)
+   {
+      //The extension cannot appear in the second ClientHello
+      if(context->helloRetryRequest)
+         return ERROR_ILLEGAL_PARAMETER;
+
+      //The age of the ticket, as reported by the client, must be consistent
+      //with the time at which the ticket was issued (replay protection)
+      ticketAge -= context->ticketAgeAdd;
+      ticketAge -= (uint32_t) (osGetTickCount() - context->ticketTimestamp);
+
+      //0-RTT data are accepted if the session allows them and if the
+      //connection uses the cipher suite of the session
+      if(context->resume && context->maxEarlyDataSize > 0 &&
+         context->sessionMaxEarlyDataSize > 0 &&
+         ticketCipherSuite == context->cipherSuite &&
+         ((int32_t) ticketAge) <= TLS_EARLY_DATA_MAX_SKEW &&
+         ((int32_t) ticketAge) >= -TLS_EARLY_DATA_MAX_SKEW)
+      {
+         uint8_t digest[MAX_HASH_DIGEST_SIZE];
+
+#if (TLS_ALPN_SUPPORT == ENABLED)
+         //The application protocol of the session is not recorded
+         //in the ticket, so it cannot be checked
+         if(context->selectedProtocol != NULL)
+            context->earlyDataRejected = TRUE;
+         else
+#endif
+         {
+            //Transcript-Hash(ClientHello)
+            error = tls13GetTranscriptHash(context, digest);
+            //Any error to report?
+            if(error) return error;
+
+            //client_early_traffic_secret = Derive-Secret(Early Secret,
+            //"c e traffic", ClientHello). The handshake traffic secret is
+            //not known yet, so its buffer is borrowed
+            error = tls13DeriveSecret(context->prfHashAlgo, context->secret,
+               "c e traffic", digest, context->clientHsTrafficSecret);
+            //Any error to report?
+            if(error) return error;
+
+            //The 0-RTT data are protected with the early traffic keys
+            error = tls13InstallTrafficKeys(context, context->clientHsTrafficSecret,
+               TLS_CONNECTION_END_CLIENT);
+            //Any error to report?
+            if(error) return error;
+
+            //The amount of 0-RTT data is limited by both the current setting
+            //and the setting in force when the ticket was issued
+            context->sessionMaxEarlyDataSize = min(context->sessionMaxEarlyDataSize,
+               context->maxEarlyDataSize);
+
+            //Accept the 0-RTT data
+            context->earlyDataAccepted = TRUE;
+            context->earlyDataLength = 0;
+         }
+      }
+      else
+      {
+         //The 0-RTT data are skipped
+         context->earlyDataRejected = TRUE;
+      }
+   }
+#else
+   //0-RTT data are not supported
+   (void) ticketAge;
+   (void) ticketCipherSuite;
+#endif
+
+   //Prepare to send ServerHello message...
+   context->state = TLS_STATE_SERVER_HELLO;
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Format the header of a ServerHello or HelloRetryRequest message
+ * @param[in] context Pointer to the TLS context
+ * @param[out] message Buffer where to format the message
+ * @param[out] length Number of bytes that have been written
+ * @return Pointer to the list of extensions
+ **/
+
+static TlsExtensions *tls13FormatServerHelloHeader(TlsContext *context,
+   TlsServerHello *message, size_t *length)
+{
+   uint8_t *p;
+   TlsExtension *extension;
+   TlsExtensions *extensionList;
+
+   //Format message header
+   message->msgType = TLS_TYPE_SERVER_HELLO;
+   //TLS 1.3 is negotiated by the SupportedVersions extension
+   message->serverVersion = HTONS(TLS_VERSION_1_2);
+   message->random = context->serverRandom;
+
+   //The server echoes the legacy session ID of the client
+   memcpy(message->sessionId.value, context->sessionId, context->sessionIdLength);
+   message->sessionId.length = context->sessionIdLength;
+
+   //Point to the cipher suite
+   p = (uint8_t *) message + sizeof(TlsServerHello) + context->sessionIdLength;
+
+   //The single cipher suite selected by the server
+   STORE16BE(context->cipherSuite, p);
+   p += sizeof(TlsCipherSuite);
+
+   //The compression method is always null
+   *p = TLS_COMPRESSION_METHOD_NULL;
+   p += sizeof(TlsCompressionMethod);
+
+   //Point to the list of extensions
+   extensionList = (TlsExtensions *) p;
+   p += sizeof(TlsExtensions);
+
+   //The SupportedVersions extension contains the selected version
+   extension = (TlsExtension *) p;
+   extension->type = HTONS(TLS_EXT_SUPPORTED_VERSIONS);
+   extension->length = HTONS(sizeof(uint16_t));
+   STORE16BE(TLS_VERSION_1_3, extension->value);
+
+   //Length of the list of extensions
+   extensionList->length = sizeof(TlsExtension) + sizeof(uint16_t);
+
+   //Number of bytes that have been written
+   *length = p + extensionList->length - (uint8_t *) message;
+
+   //Return a pointer to the list of extensions
+   return extensionList;
+}
+
+
+/**
+ * @brief Send HelloRetryRequest message
+ *
+ * The server requests a key share for the group it has selected
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13SendHelloRetryRequest(TlsContext *context)
+{
+   error_t error;
+   size_t length;
+   TlsServerHello *message;
+   TlsExtensions *extensionList;
+   TlsExtension *extension;
+
+   //A HelloRetryRequest is a ServerHello with a special random value
+   memcpy(&context->serverRandom, tls13HelloRetryRequestRandom, 32);
+
+   //Point to the HelloRetryRequest message
+   message = (TlsServerHello *) (context->txBuffer + sizeof(TlsRecord));
+   //Format the header and the SupportedVersions extension
+   extensionList = tls13FormatServerHelloHeader(context, message, &length);
+
+   //The KeyShare extension contains the selected group
+   extension = (TlsExtension *) ((uint8_t *) message + length);
+   extension->type = HTONS(TLS_EXT_KEY_SHARE);
+   extension->length = HTONS(sizeof(uint16_t));
+   STORE16BE(context->namedCurve, extension->value);
+
+   //Fix the length of the list of extensions
+   extensionList->length += sizeof(TlsExtension) + sizeof(uint16_t);
+   length += sizeof(TlsExtension) + sizeof(uint16_t);
+   extensionList->length = htons(extensionList->length);
+
+   //Fix the length field
+   STORE24BE(length - sizeof(TlsHandshake), message->length);
+
+   //Debug message
+   TRACE_INFO("Sending HelloRetryRequest message (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //Send handshake message
+   error = tlsWriteProtocolData(context, length, TLS_TYPE_HANDSHAKE);
+   //Failed to send TLS record?
+   if(error) return error;
+
+   //Wait for the second ClientHello
+   context->helloRetryRequest = TRUE;
+   context->state = TLS_STATE_CLIENT_HELLO;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send ServerHello message (TLS 1.3)
+ *
+ * Once the message has been sent, the handshake traffic keys are
+ * installed
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13SendServerHello(TlsContext *context)
+{
+   error_t error;
+   size_t n;
+   size_t length;
+   TlsServerHello *message;
+   TlsExtensions *extensionList;
+   TlsExtension *extension;
+
+   //The 32 bytes of the server random are securely generated
+   error = context->prngAlgo->read(context->prngContext,
+      (uint8_t *) &context->serverRandom, sizeof(TlsRandom));
+   //Any error to report?
+   if(error) return error;
+
+   //Point to the ServerHello message
+   message = (TlsServerHello *) (context->txBuffer + sizeof(TlsRecord));
+   //Format the header and the SupportedVersions extension
+   extensionList = tls13FormatServerHelloHeader(context, message, &length);
+
+   //Add the KeyShare extension
+   extension = (TlsExtension *) ((uint8_t *) message + length);
+   extension->type = HTONS(TLS_EXT_KEY_SHARE);
+
+   //The extension contains the public value of the server
+   error = tls13FormatKeyShareEntry(context,
+      (TlsKeyShareEntry *) extension->value, &n);
+   //Any error to report?
+   if(error) return error;
+
+   //Fix the length of the extension
+   extension->length = htons(n);
+   extensionList->length += sizeof(TlsExtension) + n;
+   length += sizeof(TlsExtension) + n;
+
+   //The server accepted the PSK?
+   if(context->resume)
+   {
+      //The PreSharedKey extension contains the selected identity
+      extension = (TlsExtension *) ((uint8_t *) message + length);
+      extension->type = HTONS(TLS_EXT_PRE_SHARED_KEY);
+      extension->length = HTONS(sizeof(uint16_t));
+      STORE16BE(0, extension->value);
+
+      //Fix the length of the list of extensions
+      extensionList->length += sizeof(TlsExtension) + sizeof(uint16_t);
+      length += sizeof(TlsExtension) + sizeof(uint16_t);
+   }
+
+   //Convert the length of the extension list to network byte order
+   extensionList->length = htons(extensionList->length);
+   //Fix the length field
+   STORE24BE(length - sizeof(TlsHandshake), message->length);
+
+   //Debug message
+   TRACE_INFO("Sending ServerHello message (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //Send handshake message
+   error = tlsWriteProtocolData(context, length, TLS_TYPE_HANDSHAKE);
+   //Failed to send TLS record?
+   if(error) return error;
+
+   //Compute the (EC)DHE shared secret
+   error = tls13ComputeSharedSecret(context, NULL, 0);
+   //Any error to report?
+   if(error) return error;
+
+   //Compute the handshake traffic secrets
+   TLS_PROFILE_START(context, TLS_PROFILE_KEY_DERIVATION);
+   error = tls13GenerateHandshakeSecret(context);
+   TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_DERIVATION);
+   //Any error to report?
+   if(error) return error;
+
+   //The rest of the server's flight is protected
+   error = tls13InstallTrafficKeys(context, context->serverHsTrafficSecret,
+      TLS_CONNECTION_END_SERVER);
+   //Any error to report?
+   if(error) return error;
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   //The 0-RTT data remain protected with the early traffic keys
+   if(!context->earlyDataAccepted)
+#endif
+   {
+      //Records received from the client are protected with its
+      //handshake traffic keys
+      error = tls13InstallTrafficKeys(context, context->clientHsTrafficSecret,
+         TLS_CONNECTION_END_CLIENT);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //TLS 1.3 sessions are resumed with tickets only, so that the
+   //session cache must not record the legacy session ID
+   context->sessionIdLength = 0;
+
+   //Prepare to send an EncryptedExtensions message
+   context->state = TLS_STATE_ENCRYPTED_EXTENSIONS;
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send EncryptedExtensions message
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13SendEncryptedExtensions(TlsContext *context)
+{
+   error_t error;
+   size_t n;
+   size_t length;
+   uint8_t *p;
+   TlsHandshake *message;
+   TlsExtension *extension;
+
+   //Point to the EncryptedExtensions message
+   message = (TlsHandshake *) (context->txBuffer + sizeof(TlsRecord));
+   message->msgType = TLS_TYPE_ENCRYPTED_EXTENSIONS;
+
+   //Point to the first extension
+   p = message->data + 2;
+   length = 0;
+
+#if (TLS_MAX_FRAG_LENGTH_SUPPORT == ENABLED)
+   //The server echoes the maximum fragment length requested by the client
+   if(context->maxFragLength < TLS_MAX_RECORD_LENGTH)
+   {
+      //Format the MaxFragmentLength extension
+      extension = (TlsExtension *) p;
+      extension->type = HTONS(TLS_EXT_MAX_FRAGMENT_LENGTH);
+      extension->length = HTONS(1);
+
+      //The maximum fragment length is encoded as 2^(8 + n)
+      for(n = TLS_MAX_FRAG_LENGTH_512; (256U << n) < context->maxFragLength; n++);
+      //Copy the encoded value
+      extension->value[0] = (uint8_t) n;
+
+      //Advance data pointer
+      p += sizeof(TlsExtension) + 1;
+      length += sizeof(TlsExtension) + 1;
+   }
+#endif
+
+#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+   //The server replies with its own limit when the client has sent
+   //a RecordSizeLimit extension
+   if(context->recordSizeLimitExt)
+   {
+      //Format the RecordSizeLimit extension
+      extension = (TlsExtension *) p;
+      extension->type = HTONS(TLS_EXT_RECORD_SIZE_LIMIT);
+      extension->length = HTONS(sizeof(uint16_t));
+
+      //With TLS 1.3, the limit includes the content type byte
+      n = min(context->rxBufferSize, TLS_MAX_RECORD_LENGTH) + 1;
+      STORE16BE(n, extension->value);
+
+      //Advance data pointer
+      p += sizeof(TlsExtension) + sizeof(uint16_t);
+      length += sizeof(TlsExtension) + sizeof(uint16_t);
+   }
+#endif
+
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   //The server echoes the application protocol it has selected
+   if(context->selectedProtocol != NULL)
+   {
+      //Length of the protocol name
+      n = strlen(context->selectedProtocol);
+
+      //Format the ALPN extension
+      extension = (TlsExtension *) p;
+      extension->type = HTONS(TLS_EXT_ALPN);
+      extension->length = htons(n + 3);
+
+      //The ProtocolNameList contains exactly one name
+      STORE16BE(n + 1, extension->value);
+      extension->value[2] = (uint8_t) n;
+      memcpy(extension->value + 3, context->selectedProtocol, n);
+
+      //Advance data pointer
+      p += sizeof(TlsExtension) + n + 3;
+      length += sizeof(TlsExtension) + n + 3;
+   }
+#endif
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   //The server indicates that it accepted the 0-RTT data
+   if(context->earlyDataAccepted)
+   {
+      //Format an empty EarlyData extension
+      extension = (TlsExtension *) p;
+      extension->type = HTONS(TLS_EXT_EARLY_DATA);
+      extension->length = HTONS(0);
+
+      //Advance data pointer
+      p += sizeof(TlsExtension);
+      length += sizeof(TlsExtension);
+   }
+#endif
+
+   //Fix the length of the list of extensions
+   STORE16BE(length, message->data);
+   length += 2;
+
+   //Fix message header
+   STORE24BE(length, message->length);
+   //Length of the complete handshake message
+   length += sizeof(TlsHandshake);
+
+   //Debug message
+   TRACE_INFO("Sending EncryptedExtensions message (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //Send handshake message
+   error = tlsWriteProtocolData(context, length, TLS_TYPE_HANDSHAKE);
+   //Failed to send TLS record?
+   if(error) return error;
+
+   //A server authenticating with a PSK does not send its certificate
+   if(context->resume)
+      context->state = TLS_STATE_SERVER_FINISHED;
+   else if(context->clientAuthMode != TLS_CLIENT_AUTH_NONE)
+      context->state = TLS_STATE_CERTIFICATE_REQUEST;
+   else
+      context->state = TLS_STATE_SERVER_CERTIFICATE;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send CertificateRequest message (TLS 1.3)
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13SendCertificateRequest(TlsContext *context)
+{
+   error_t error;
+   uint_t n;
+   size_t length;
+   TlsHandshake *message;
+   TlsExtension *extension;
+   TlsSignHashAlgos *supportedSignAlgos;
+
+   //Point to the CertificateRequest message
+   message = (TlsHandshake *) (context->txBuffer + sizeof(TlsRecord));
+   message->msgType = TLS_TYPE_CERTIFICATE_REQUEST;
+
+   //The certificate_request_context is empty during the handshake
+   message->data[0] = 0;
+
+   //The SignatureAlgorithms extension is the only extension
+   extension = (TlsExtension *) (message->data + 3);
+   extension->type = HTONS(TLS_EXT_SIGNATURE_ALGORITHMS);
+
+   //Point to the list of signature schemes the server is able to verify
+   supportedSignAlgos = (TlsSignHashAlgos *) extension->value;
+
+   //Enumerate the signature schemes in descending order of preference
+   n = 0;
+
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+   //ecdsa_secp256r1_sha256 is always supported
+   supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_ECDSA;
+   supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_SHA256;
+#if (TLS_SHA384_SUPPORT == ENABLED)
+   //ecdsa_secp384r1_sha384 support is optional
+   supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_ECDSA;
+   supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_SHA384;
+#endif
+#if (TLS_SHA512_SUPPORT == ENABLED)
+   //ecdsa_secp521r1_sha512 support is optional
+   supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_ECDSA;
+   supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_SHA512;
+#endif
+#endif
+
+#if (TLS_RSA_SIGN_SUPPORT == ENABLED)
+   //rsa_pss_rsae_sha256 is always supported
+   supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA256;
+   supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_INTRINSIC;
+#if (TLS_SHA384_SUPPORT == ENABLED)
+   //rsa_pss_rsae_sha384 support is optional
+   supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA384;
+   supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_INTRINSIC;
+#endif
+#if (TLS_SHA512_SUPPORT == ENABLED)
+   //rsa_pss_rsae_sha512 support is optional
+   supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA512;
+   supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_INTRINSIC;
+#endif
+   //Certificates signed with rsa_pkcs1_sha256 are accepted
+   supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_RSA;
+   supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_SHA256;
+#endif
+
+   //Fix the length of the list and of the extension
+   n *= sizeof(TlsSignHashAlgo);
+   supportedSignAlgos->length = htons(n);
+   n += sizeof(TlsSignHashAlgos);
+   extension->length = htons(n);
+
+   //Fix the length of the list of extensions
+   n += sizeof(TlsExtension);
+   STORE16BE(n, message->data + 1);
+
+   //Fix message header
+   length = n + 3;
+   STORE24BE(length, message->length);
+   //Length of the complete handshake message
+   length += sizeof(TlsHandshake);
+
+   //Debug message
+   TRACE_INFO("Sending CertificateRequest message (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //Send handshake message
+   error = tlsWriteProtocolData(context, length, TLS_TYPE_HANDSHAKE);
+   //Failed to send TLS record?
+   if(error) return error;
+
+   //The client must send a Certificate message, even if it is empty
+   context->clientCertRequested = TRUE;
+   //Prepare to send a Certificate message
+   context->state = TLS_STATE_SERVER_CERTIFICATE;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+
+/**
+ * @brief Buffer the 0-RTT data sent by the client
+ *
+ * The data are delivered to the application by tlsRead() once the
+ * handshake is complete
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] data 0-RTT data
+ * @param[in] length Number of bytes received
+ * @return Error code
+ **/
+
+error_t tls13ParseEarlyData(TlsContext *context, const void *data, size_t length)
+{
+   //The client must not send more data than the ticket allows
+   if((context->earlyDataLength + length) > context->sessionMaxEarlyDataSize)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //Allocate a memory buffer to hold the data
+   if(context->earlyData == NULL)
+   {
+      //The buffer is sized for the whole 0-RTT data
+      context->earlyData = osMemAlloc(context->sessionMaxEarlyDataSize);
+      //Failed to allocate memory?
+      if(context->earlyData == NULL) return ERROR_OUT_OF_MEMORY;
+   }
+
+   //Copy the data
+   memcpy(context->earlyData + context->earlyDataLength, data, length);
+   context->earlyDataLength += length;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse EndOfEarlyData message
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message Incoming EndOfEarlyData message to parse
+ * @param[in] length Message length
+ * @return Error code
+ **/
+
+error_t tls13ParseEndOfEarlyData(TlsContext *context,
+   const TlsHandshake *message, size_t length)
+{
+   error_t error;
+
+   //Debug message
+   TRACE_INFO("EndOfEarlyData message received (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //Check current state
+   if(context->state != TLS_STATE_END_OF_EARLY_DATA)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //The message has an empty body
+   if(length != sizeof(TlsHandshake))
+      return ERROR_DECODING_FAILED;
+
+   //Update the hash value with the incoming handshake message
+   tlsUpdateHandshakeHash(context, message, length);
+
+   //The rest of the client's flight is protected with its
+   //handshake traffic keys
+   error = tls13InstallTrafficKeys(context, context->clientHsTrafficSecret,
+      TLS_CONNECTION_END_CLIENT);
+   //Any error to report?
+   if(error) return error;
+
+   //A client authenticating with a PSK does not send any certificate
+   context->state = TLS_STATE_CLIENT_FINISHED;
+   //Successful processing
+   return NO_ERROR;
+}
+
+#endif
+
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+
+/**
+ * @brief Send NewSessionTicket message (TLS 1.3)
+ *
+ * A single ticket is issued after the handshake. Its PSK is derived
+ * from the resumption master secret
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tls13SendNewSessionTicket(TlsContext *context)
+{
+   error_t error;
+   size_t n;
+   size_t length;
+   uint8_t *p;
+   uint8_t nonce;
+   TlsHandshake *message;
+   TlsExtension *extension;
+
+   //Generate the value used to obfuscate the age of the ticket
+   error = context->prngAlgo->read(context->prngContext,
+      (uint8_t *) &context->ticketAgeAdd, sizeof(uint32_t));
+   //Any error to report?
+   if(error) return error;
+
+   //The nonce must be unique among the tickets issued on the connection
+   nonce = 0;
+
+   //PSK = HKDF-Expand-Label(resumption_master_secret, "resumption",
+   //ticket_nonce, Hash.length)
+   error = tls13HkdfExpandLabel(context->prfHashAlgo, context->resumptionMasterSecret,
+      context->prfHashAlgo->digestSize, "resumption", &nonce, sizeof(nonce),
+      context->masterSecret, context->prfHashAlgo->digestSize);
+   //Any error to report?
+   if(error) return error;
+
+   //Point to the NewSessionTicket message
+   message = (TlsHandshake *) (context->txBuffer + sizeof(TlsRecord));
+   message->msgType = TLS_TYPE_NEW_SESSION_TICKET;
+
+   //Point to the body of the message
+   p = message->data;
+
+   //Lifetime of the ticket, in seconds (at most 7 days)
+   STORE32BE(min(TLS_TICKET_LIFETIME / 1000, 604800), p);
+   //Value used to obfuscate the age of the ticket
+   STORE32BE(context->ticketAgeAdd, p + 4);
+
+   //Ticket nonce
+   p[8] = sizeof(nonce);
+   p[9] = nonce;
+   p += 10;
+
+   //Encrypt the state of the session
+   error = tlsEncryptTicket(context, p + 2, &n);
+   //Any error to report?
+   if(error) return error;
+
+   //Fix the length of the ticket
+   STORE16BE(n, p);
+   p += n + 2;
+
+   //Length of the list of extensions
+   length = 0;
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   //Advertise the amount of 0-RTT data the client may send
+   if(context->maxEarlyDataSize > 0)
+   {
+      //Format the EarlyData extension
+      extension = (TlsExtension *) (p + 2);
+      extension->type = HTONS(TLS_EXT_EARLY_DATA);
+      extension->length = HTONS(sizeof(uint32_t));
+      STORE32BE(context->maxEarlyDataSize, extension->value);
+
+      //Adjust the length of the list
+      length += sizeof(TlsExtension) + sizeof(uint32_t);
+   }
+#else
+   //0-RTT data are not supported
+   (void) extension;
+#endif
+
+   //Fix the length of the list of extensions
+   STORE16BE(length, p);
+   p += length + 2;
+
+   //Fix message header
+   length = p - message->data;
+   STORE24BE(length, message->length);
+   //Length of the complete handshake message
+   length += sizeof(TlsHandshake);
+
+   //Debug message
+   TRACE_INFO("Sending NewSessionTicket message (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //Send handshake message
+   error = tlsWriteProtocolData(context, length, TLS_TYPE_HANDSHAKE);
+   //Failed to send TLS record?
+   if(error) return error;
+
+   //The handshake is complete
+   context->state = TLS_STATE_APPLICATION_DATA;
+   //Successful processing
+   return NO_ERROR;
+}
+
+#endif
+
+#endif
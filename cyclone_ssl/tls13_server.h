@@ -0,0 +1,58 @@
+/**
+ * @file tls13_server.h
+ * @brief TLS 1.3 server
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _TLS13_SERVER_H
+#define _TLS13_SERVER_H
+
+//Dependencies
+#include "tls.h"
+
+//TLS 1.3 server related functions
+error_t tls13ServerHandshakeStep(TlsContext *context);
+error_t tls13ParseClientMessage(TlsContext *context);
+
+bool_t tls13IsVersionOffered(const TlsExtension *extension);
+
+error_t tls13ParseClientHello(TlsContext *context, const TlsClientHello *message,
+   size_t length, const TlsCipherSuites *cipherSuites,
+   const TlsCompressionMethods *compressionMethods,
+   const uint8_t *extensions, size_t extensionsLength);
+
+error_t tls13SendHelloRetryRequest(TlsContext *context);
+error_t tls13SendServerHello(TlsContext *context);
+error_t tls13SendEncryptedExtensions(TlsContext *context);
+error_t tls13SendCertificateRequest(TlsContext *context);
+
+error_t tls13ParseEarlyData(TlsContext *context, const void *data, size_t length);
+
+error_t tls13ParseEndOfEarlyData(TlsContext *context,
+   const TlsHandshake *message, size_t length);
+
+error_t tls13SendNewSessionTicket(TlsContext *context);
+
+#endif
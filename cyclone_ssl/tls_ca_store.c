@@ -0,0 +1,281 @@
+/**
+ * @file tls_ca_store.c
+ * @brief Trusted CA store
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_ca_store.h"
+#include "x509.h"
+#include "pem.h"
+#include "debug.h"
+
+//Check SSL library configuration
+#if (TLS_SUPPORT == ENABLED)
+
+//Trusted CA store related local functions
+static uint_t tlsCaStoreHash(const TlsCaStore *caStore, const uint8_t *name, size_t length);
+
+
+/**
+ * @brief Trusted CA store initialization
+ *
+ * The PEM encoded list is decoded once for all. The resulting store
+ * does not reference the list, which can be discarded afterwards
+ *
+ * @param[in] trustedCaList List of trusted CA (PEM format)
+ * @param[in] length Total length of the list
+ * @return Handle referencing the fully initialized trusted CA store
+ **/
+
+TlsCaStore *tlsInitCaStore(const char_t *trustedCaList, size_t length)
+{
+   error_t error;
+   uint_t i;
+   uint_t k;
+   uint_t count;
+   size_t n;
+   size_t totalLength;
+   const char_t *p;
+   uint8_t *q;
+   uint8_t *derCert;
+   size_t derCertSize;
+   size_t derCertLength;
+   X509CertificateInfo *certInfo;
+   TlsCaStore *caStore;
+   TlsTrustedCa *ca;
+
+   //Check parameters
+   if(trustedCaList == NULL || length == 0)
+      return NULL;
+
+   //Allocate a memory buffer to store X.509 certificate info
+   certInfo = osMemAlloc(sizeof(X509CertificateInfo));
+   //Failed to allocate memory?
+   if(!certInfo) return NULL;
+
+   //DER encoded certificate
+   derCert = NULL;
+   derCertSize = 0;
+   derCertLength = 0;
+
+   //No store allocated so far
+   caStore = NULL;
+
+   //Start of exception handling block
+   do
+   {
+      //Point to the first trusted CA certificate
+      p = trustedCaList;
+      n = length;
+
+      //Count the certificates and the memory needed to hold them
+      for(count = 0, totalLength = 0; ; count++)
+      {
+         //Decode PEM certificate
+         error = pemReadCertificate(&p, &n, &derCert, &derCertSize, &derCertLength);
+         //End of list?
+         if(error) break;
+
+         //Update the memory needed
+         totalLength += derCertLength;
+      }
+
+      //Failed to decode the list?
+      if(error != ERROR_END_OF_FILE || count == 0)
+         break;
+
+      //The number of hash buckets is the smallest power of two
+      //greater than or equal to the number of certificates
+      for(k = 1; k < count; k <<= 1);
+
+      //Allocate a memory buffer to hold the whole store
+      caStore = osMemAlloc(sizeof(TlsCaStore) + count * sizeof(TlsTrustedCa) +
+         k * sizeof(TlsTrustedCa *) + totalLength);
+      //Failed to allocate memory?
+      if(!caStore) break;
+
+      //Initialize the store
+      caStore->count = count;
+      caStore->bucketCount = k;
+      caStore->buckets = (TlsTrustedCa **) &caStore->cas[count];
+
+      //Clear hash buckets
+      for(i = 0; i < k; i++)
+         caStore->buckets[i] = NULL;
+
+      //The DER encoded certificates follow the hash buckets
+      q = (uint8_t *) &caStore->buckets[k];
+
+      //Rewind to the first trusted CA certificate
+      p = trustedCaList;
+      n = length;
+
+      //Decode the certificates once again, parse and index them
+      for(i = 0; i < count; i++)
+      {
+         //Decode PEM certificate
+         error = pemReadCertificate(&p, &n, &derCert, &derCertSize, &derCertLength);
+         //Any error to report?
+         if(error) break;
+
+         //Point to the current entry
+         ca = &caStore->cas[i];
+
+         //Copy the DER encoded certificate
+         memcpy(q, derCert, derCertLength);
+         ca->derCert = q;
+         ca->derCertLength = derCertLength;
+         q += derCertLength;
+
+         //Parse X.509 certificate
+         error = x509ParseCertificate(ca->derCert, ca->derCertLength, certInfo);
+         //Failed to parse the X.509 certificate?
+         if(error) break;
+
+         //The subject name is the lookup key
+         ca->subject = certInfo->subject.rawData;
+         ca->subjectLength = certInfo->subject.rawDataLen;
+
+         //Insert the entry in the relevant hash bucket
+         k = tlsCaStoreHash(caStore, ca->subject, ca->subjectLength);
+         ca->next = caStore->buckets[k];
+         caStore->buckets[k] = ca;
+      }
+
+      //Any error to report?
+      if(error)
+      {
+         //Clean up side effects
+         osMemFree(caStore);
+         caStore = NULL;
+      }
+
+      //End of exception handling block
+   } while(0);
+
+   //Debug message
+   if(caStore != NULL)
+   {
+      TRACE_INFO("Trusted CA store created (%u certificates)\r\n", caStore->count);
+   }
+
+   //Release previously allocated memory
+   osMemFree(derCert);
+   osMemFree(certInfo);
+
+   //Return a pointer to the newly created store
+   return caStore;
+}
+
+
+/**
+ * @brief Validate a certificate against the trusted CA store
+ * @param[in] caStore Pointer to the trusted CA store
+ * @param[in] certInfo Certificate to be validated
+ * @param[out] issuerCertInfo Buffer where to parse the candidate CA certificates
+ * @return Error code
+ **/
+
+error_t tlsValidateWithCaStore(const TlsCaStore *caStore,
+   const X509CertificateInfo *certInfo, X509CertificateInfo *issuerCertInfo)
+{
+   error_t error;
+   const TlsTrustedCa *ca;
+
+   //Probe the hash bucket matching the issuer of the certificate
+   ca = caStore->buckets[tlsCaStoreHash(caStore,
+      certInfo->issuer.rawData, certInfo->issuer.rawDataLen)];
+
+   //Several trusted CA certificates may share the same subject name
+   for(error = ERROR_UNKNOWN_CA; ca != NULL; ca = ca->next)
+   {
+      //Skip the CA certificates whose subject does not match the issuer
+      if(ca->subjectLength != certInfo->issuer.rawDataLen ||
+         memcmp(ca->subject, certInfo->issuer.rawData, ca->subjectLength))
+      {
+         continue;
+      }
+
+      //Parse the candidate CA certificate
+      error = x509ParseCertificate(ca->derCert, ca->derCertLength, issuerCertInfo);
+      //Failed to parse the X.509 certificate?
+      if(error) break;
+
+      //Validate the certificate with the current trusted CA
+      error = x509ValidateCertificate(certInfo, issuerCertInfo);
+      //Certificate validation succeeded?
+      if(!error) break;
+   }
+
+   //The certificate could not be matched with a known, trusted CA?
+   if(ca == NULL)
+      error = ERROR_UNKNOWN_CA;
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Properly dispose a trusted CA store
+ * @param[in] caStore Pointer to the trusted CA store to be released
+ **/
+
+void tlsFreeCaStore(TlsCaStore *caStore)
+{
+   //Release previously allocated memory
+   osMemFree(caStore);
+}
+
+
+/**
+ * @brief Compute the hash bucket index of a distinguished name
+ * @param[in] caStore Pointer to the trusted CA store
+ * @param[in] name DER encoded distinguished name
+ * @param[in] length Length of the distinguished name
+ * @return Index of the hash bucket
+ **/
+
+static uint_t tlsCaStoreHash(const TlsCaStore *caStore, const uint8_t *name, size_t length)
+{
+   size_t i;
+   uint32_t h;
+
+   //Distinguished names often share a common prefix, so that
+   //all the bytes take part in the FNV-1a hash
+   for(h = 2166136261UL, i = 0; i < length; i++)
+      h = (h ^ name[i]) * 16777619UL;
+
+   //The number of buckets is a power of two
+   return h & (caStore->bucketCount - 1);
+}
+
+#endif
@@ -38,6 +38,14 @@
 //Check SSL library configuration
 #if (TLS_SUPPORT == ENABLED)
 
+//Session cache related local functions
+static uint32_t tlsCacheHash(const uint8_t *id, size_t length);
+static TlsCacheShard *tlsCacheGetShard(TlsCache *cache, uint32_t h);
+static TlsCacheEntry **tlsCacheGetBucket(const TlsCache *cache, TlsCacheShard *shard, uint32_t h);
+static TlsCacheEntry *tlsCacheLookup(TlsCache *cache, TlsCacheShard *shard, const uint8_t *id, size_t length);
+static void tlsCacheUnlink(TlsCache *cache, TlsCacheShard *shard, TlsCacheEntry *entry);
+static void tlsCacheTouch(TlsCacheShard *shard, TlsCacheEntry *entry);
+
 
 /**
  * @brief Session cache initialization
@@ -47,15 +55,39 @@
 
 TlsCache *tlsInitCache(uint_t size)
 {
+   uint_t i;
+   uint_t j;
+   uint_t k;
+   uint_t m;
+   uint_t shardCount;
    size_t n;
    TlsCache *cache;
+   TlsCacheShard *shard;
+   TlsCacheEntry *entry;
+   TlsCacheEntry **bucket;
 
    //Make sure the parameter is acceptable
    if(size < 1)
       return NULL;
 
-   //Size of the memory required
-   n = sizeof(TlsCache) + size * sizeof(TlsSession);
+   //Each shard holds at least one entry
+   shardCount = min(size, TLS_SESSION_CACHE_SHARDS);
+
+   //Size of the memory required by the entries
+   n = sizeof(TlsCache) + size * sizeof(TlsCacheEntry);
+
+   //Add the size of the hash buckets of each shard
+   for(i = 0; i < shardCount; i++)
+   {
+      //The entries are evenly distributed between the shards
+      m = size / shardCount + (i < (size % shardCount));
+      //The number of hash buckets is the smallest power of two
+      //greater than or equal to the number of entries
+      for(k = 1; k < m; k <<= 1);
+
+      //Update the size of the memory required
+      n += k * sizeof(TlsCacheEntry *);
+   }
 
    //Allocate a memory buffer to hold the session cache
    cache = osMemAlloc(n);
@@ -65,20 +97,52 @@ TlsCache *tlsInitCache(uint_t size)
    //Clear memory
    memset(cache, 0, n);
 
-   //Create a mutex to prevent simultaneous access to the cache
-   cache->mutex = osMutexCreate(FALSE);
+   //Save the maximum number of cache entries
+   cache->size = size;
+   cache->shardCount = shardCount;
+
+   //Point to the first entry
+   entry = cache->entries;
+   //The hash buckets are located right after the cache entries
+   bucket = (TlsCacheEntry **) &cache->entries[size];
 
-   //Out of ressources?
-   if(cache->mutex == OS_INVALID_HANDLE)
+   //Initialize shards
+   for(i = 0; i < shardCount; i++)
    {
-      //Clean up side effects
-      osMemFree(cache);
-      //Report an error
-      return NULL;
-   }
+      //Point to the current shard
+      shard = &cache->shards[i];
 
-   //Save the maximum number of cache entries
-   cache->size = size;
+      //Create a mutex to prevent simultaneous access to the shard
+      shard->mutex = osMutexCreateNamed(FALSE, "TlsCache");
+
+      //Out of ressources?
+      if(shard->mutex == OS_INVALID_HANDLE)
+      {
+         //Clean up side effects
+         while(i > 0)
+            osMutexClose(cache->shards[--i].mutex);
+
+         osMemFree(cache);
+         //Report an error
+         return NULL;
+      }
+
+      //Number of entries in the current shard
+      shard->size = size / shardCount + (i < (size % shardCount));
+
+      //Allocate the hash buckets of the shard
+      for(k = 1; k < shard->size; k <<= 1);
+      shard->bucketCount = k;
+      shard->buckets = bucket;
+      bucket += k;
+
+      //All the entries are initially unused
+      for(j = 0; j < shard->size; j++, entry++)
+      {
+         entry->hashNext = shard->freeList;
+         shard->freeList = entry;
+      }
+   }
 
    //Return a pointer to the newly created cache
    return cache;
@@ -87,6 +151,11 @@ TlsCache *tlsInitCache(uint_t size)
 
 /**
  * @brief Search the session cache for a given session ID
+ *
+ * The returned entry may be replaced as soon as the cache is updated by
+ * another task. tlsRestoreFromCache should be preferred when the session
+ * cache is shared by several connections
+ *
  * @param[in] cache Pointer to the session cache
  * @param[in] id Expected session ID
  * @param[in] length Length of the session ID
@@ -96,61 +165,75 @@ TlsCache *tlsInitCache(uint_t size)
 
 TlsSession *tlsFindCache(TlsCache *cache, const uint8_t *id, size_t length)
 {
-   uint_t i;
-   time_t time;
-   TlsSession *session;
+   TlsCacheShard *shard;
+   TlsCacheEntry *entry;
 
    //Check whether session caching is supported
    if(cache == NULL)
       return NULL;
    //Ensure the session ID is valid
-   if(id == NULL || length == 0)
+   if(id == NULL || length == 0 || length > 32)
       return NULL;
 
-   //Get current time
-   time = osGetTickCount();
+   //Select the shard holding the session ID
+   shard = tlsCacheGetShard(cache, tlsCacheHash(id, length));
 
-   //Acquire exclusive access to the session cache
-   osMutexAcquire(cache->mutex);
+   //Acquire exclusive access to the shard
+   osMutexAcquire(shard->mutex);
+   //Search the shard for the specified session ID
+   entry = tlsCacheLookup(cache, shard, id, length);
+   //Release exclusive access to the shard
+   osMutexRelease(shard->mutex);
 
-   //Flush expired entries
-   for(i = 0; i < cache->size; i++)
-   {
-      //Point to the current entry
-      session = &cache->sessions[i];
+   //Return session parameters, if any
+   return (entry != NULL) ? &entry->session : NULL;
+}
 
-      //Skip unused entries
-      if(session->idLength)
-      {
-         //Outdated entry?
-         if((time - session->timestamp) >= TLS_SESSION_CACHE_LIFETIME)
-         {
-            //This session is no more valid and should be removed from the cache
-            memset(session, 0, sizeof(TlsSession));
-         }
-      }
-   }
 
-   //Search the cache for the specified session ID
-   for(i = 0; i < cache->size; i++)
-   {
-      //Point to the current entry
-      session = &cache->sessions[i];
+/**
+ * @brief Restore a session from the cache
+ * @param[in] context TLS context
+ * @param[in] id Expected session ID
+ * @param[in] length Length of the session ID
+ * @return Error code
+ **/
 
-      //Check whether the current identifier matches the specified session ID
-      if(session->idLength == length && !memcmp(session->id, id, length))
-      {
-         //Release exclusive access to the session cache
-         osMutexRelease(cache->mutex);
-         //Return session parameters
-         return session;
-      }
-   }
+error_t tlsRestoreFromCache(TlsContext *context, const uint8_t *id, size_t length)
+{
+   error_t error;
+   TlsCacheShard *shard;
+   TlsCacheEntry *entry;
 
-   //Release exclusive access to the session cache
-   osMutexRelease(cache->mutex);
-   //No matching entry in session cache
-   return NULL;
+   //Check parameters
+   if(context == NULL)
+      return ERROR_INVALID_PARAMETER;
+   //Check whether session caching is supported
+   if(context->cache == NULL)
+      return ERROR_FAILURE;
+   //Ensure the session ID is valid
+   if(id == NULL || length == 0 || length > 32)
+      return ERROR_INVALID_PARAMETER;
+
+   //Select the shard holding the session ID
+   shard = tlsCacheGetShard(context->cache, tlsCacheHash(id, length));
+
+   //Acquire exclusive access to the shard
+   osMutexAcquire(shard->mutex);
+
+   //Search the shard for the specified session ID
+   entry = tlsCacheLookup(context->cache, shard, id, length);
+
+   //The session parameters are copied while the shard is locked,
+   //so that the entry cannot be replaced meanwhile
+   if(entry != NULL)
+      error = tlsRestoreSession(context, &entry->session);
+   else
+      error = ERROR_NOT_FOUND;
+
+   //Release exclusive access to the shard
+   osMutexRelease(shard->mutex);
+   //Return status code
+   return error;
 }
 
 
@@ -163,10 +246,10 @@ TlsSession *tlsFindCache(TlsCache *cache, const uint8_t *id, size_t length)
 error_t tlsSaveToCache(TlsContext *context)
 {
    error_t error;
-   uint_t i;
-   TlsSession *session;
-   TlsSession *firstFreeEntry;
-   TlsSession *oldestEntry;
+   uint32_t h;
+   TlsCacheShard *shard;
+   TlsCacheEntry *entry;
+   TlsCacheEntry **bucket;
 
    //Check parameters
    if(context == NULL)
@@ -178,56 +261,60 @@ error_t tlsSaveToCache(TlsContext *context)
    if(context->sessionIdLength == 0)
       return NO_ERROR;
 
-   //Acquire exclusive access to the session cache
-   osMutexAcquire(context->cache->mutex);
+   //Select the shard holding the session ID
+   h = tlsCacheHash(context->sessionId, context->sessionIdLength);
+   shard = tlsCacheGetShard(context->cache, h);
 
-   //Keep track of the first free entry
-   firstFreeEntry = NULL;
-   //Keep track of the oldest entry
-   oldestEntry = NULL;
+   //Acquire exclusive access to the shard
+   osMutexAcquire(shard->mutex);
 
-   //Search the cache for the specified session ID
-   for(i = 0; i < context->cache->size; i++)
+   //Search the shard for the specified session ID
+   entry = tlsCacheLookup(context->cache, shard,
+      context->sessionId, context->sessionIdLength);
+
+   //If the session ID already exists, we are done
+   if(entry != NULL)
+   {
+      //Do not write to session cache
+      error = NO_ERROR;
+   }
+   else
    {
-      //Point to the current entry
-      session = &context->cache->sessions[i];
+      //When the shard is full, the least recently used entry is replaced
+      if(shard->freeList == NULL)
+         tlsCacheUnlink(context->cache, shard, shard->lruTail);
 
-      //If the session ID already exists, we are done
-      if(session->idLength == context->sessionIdLength &&
-         !memcmp(session->id, context->sessionId, session->idLength))
-      {
-         //Do not write to session cache
-         firstFreeEntry = NULL;
-         oldestEntry = NULL;
-         //Exit immedialtely
-         break;
-      }
+      //Take an unused entry
+      entry = shard->freeList;
+      shard->freeList = entry->hashNext;
 
-      //Check whether current entry is free
-      if(!session->idLength)
+      //Save session parameters
+      error = tlsSaveSession(context, &entry->session);
+
+      //Check status code
+      if(!error)
       {
-         //Keep track of the first free entry
-         if(!firstFreeEntry)
-            firstFreeEntry = session;
+         //Insert the entry in the relevant hash bucket
+         bucket = tlsCacheGetBucket(context->cache, shard, h);
+         entry->hashNext = *bucket;
+         *bucket = entry;
+
+         //Link the entry as the most recently used one
+         entry->lruPrev = NULL;
+         entry->lruNext = NULL;
+         tlsCacheTouch(shard, entry);
       }
       else
       {
-         //Keep track of the oldest entry in the table
-         if(!oldestEntry || timeCompare(session->timestamp, oldestEntry->timestamp) < 0)
-            oldestEntry = session;
+         //Give the entry back
+         memset(&entry->session, 0, sizeof(TlsSession));
+         entry->hashNext = shard->freeList;
+         shard->freeList = entry;
       }
    }
 
-   //Add current session to cache if necessary
-   if(firstFreeEntry != NULL)
-      error = tlsSaveSession(context, firstFreeEntry);
-   else if(oldestEntry != NULL)
-      error = tlsSaveSession(context, oldestEntry);
-   else
-      error = NO_ERROR;
-
-   //Release exclusive access to the session cache
-   osMutexRelease(context->cache->mutex);
+   //Release exclusive access to the shard
+   osMutexRelease(shard->mutex);
    //Return status code
    return error;
 }
@@ -241,8 +328,8 @@ error_t tlsSaveToCache(TlsContext *context)
 
 error_t tlsRemoveFromCache(TlsContext *context)
 {
-   uint_t i;
-   TlsSession *session;
+   TlsCacheShard *shard;
+   TlsCacheEntry *entry;
 
    //Check parameters
    if(context == NULL)
@@ -255,26 +342,23 @@ error_t tlsRemoveFromCache(TlsContext *context)
    if(context->sessionIdLength == 0)
       return NO_ERROR;
 
-   //Acquire exclusive access to the session cache
-   osMutexAcquire(context->cache->mutex);
+   //Select the shard holding the session ID
+   shard = tlsCacheGetShard(context->cache,
+      tlsCacheHash(context->sessionId, context->sessionIdLength));
 
-   //Search the cache for the specified session ID
-   for(i = 0; i < context->cache->size; i++)
-   {
-      //Point to the current entry
-      session = &context->cache->sessions[i];
+   //Acquire exclusive access to the shard
+   osMutexAcquire(shard->mutex);
 
-      //Check whether the current identifier matches the specified session ID
-      if(session->idLength == context->sessionIdLength &&
-         !memcmp(session->id, context->sessionId, session->idLength))
-      {
-         //Drop current entry
-         memset(session, 0, sizeof(TlsSession));
-      }
-   }
+   //Search the shard for the specified session ID
+   entry = tlsCacheLookup(context->cache, shard,
+      context->sessionId, context->sessionIdLength);
+
+   //Drop the matching entry, if any
+   if(entry != NULL)
+      tlsCacheUnlink(context->cache, shard, entry);
 
-   //Release exclusive access to the session cache
-   osMutexRelease(context->cache->mutex);
+   //Release exclusive access to the shard
+   osMutexRelease(shard->mutex);
    //Successful processing
    return NO_ERROR;
 }
@@ -287,21 +371,215 @@ error_t tlsRemoveFromCache(TlsContext *context)
 
 void tlsFreeCache(TlsCache *cache)
 {
+   uint_t i;
    size_t n;
 
    //Invalid session cache?
    if(cache == NULL)
       return;
 
-   //Release previously allocated ressources
-   osMutexClose(cache->mutex);
-
    //Compute the number of bytes allocated for the session cache
-   n = sizeof(TlsCache) + cache->size * sizeof(TlsSession);
+   n = sizeof(TlsCache) + cache->size * sizeof(TlsCacheEntry);
+
+   //Loop through the shards
+   for(i = 0; i < cache->shardCount; i++)
+   {
+      //Release previously allocated ressources
+      osMutexClose(cache->shards[i].mutex);
+      //Take the hash buckets of the shard into account
+      n += cache->shards[i].bucketCount * sizeof(TlsCacheEntry *);
+   }
 
    //Clear the session cache before freeing memory
    memset(cache, 0, n);
    osMemFree(cache);
 }
 
+
+/**
+ * @brief Hash a session ID
+ * @param[in] id Session ID
+ * @param[in] length Length of the session ID
+ * @return Hash value
+ **/
+
+static uint32_t tlsCacheHash(const uint8_t *id, size_t length)
+{
+   size_t i;
+   uint32_t h;
+
+   //Session IDs are random values, a simple hash function is sufficient
+   for(h = 0, i = 0; i < length; i++)
+      h = (h * 31) + id[i];
+
+   //Return the resulting hash value
+   return h;
+}
+
+
+/**
+ * @brief Select the shard holding a given session ID
+ * @param[in] cache Pointer to the session cache
+ * @param[in] h Hash value of the session ID
+ * @return Pointer to the relevant shard
+ **/
+
+static TlsCacheShard *tlsCacheGetShard(TlsCache *cache, uint32_t h)
+{
+   //The low-order bits of the hash value select the hash bucket,
+   //so that the high-order bits are used to select the shard
+   return &cache->shards[(h >> 16) % cache->shardCount];
+}
+
+
+/**
+ * @brief Get the hash bucket of a given session ID
+ * @param[in] cache Pointer to the session cache
+ * @param[in] shard Shard holding the session ID
+ * @param[in] h Hash value of the session ID
+ * @return Pointer to the relevant hash bucket
+ **/
+
+static TlsCacheEntry **tlsCacheGetBucket(const TlsCache *cache, TlsCacheShard *shard, uint32_t h)
+{
+   //The number of buckets is a power of two
+   return &shard->buckets[h & (shard->bucketCount - 1)];
+}
+
+
+/**
+ * @brief Search a shard for a given session ID
+ *
+ * Outdated sessions are removed from the shard as they are found
+ *
+ * @param[in] cache Pointer to the session cache
+ * @param[in] shard Shard holding the session ID
+ * @param[in] id Expected session ID
+ * @param[in] length Length of the session ID
+ * @return Matching entry or NULL if the session ID could not be found
+ **/
+
+static TlsCacheEntry *tlsCacheLookup(TlsCache *cache, TlsCacheShard *shard, const uint8_t *id, size_t length)
+{
+   TlsCacheEntry *entry;
+
+   //Walk through the relevant hash bucket
+   entry = *tlsCacheGetBucket(cache, shard, tlsCacheHash(id, length));
+
+   //Loop through the entries sharing the same hash value
+   while(entry != NULL)
+   {
+      //Check whether the current identifier matches the specified session ID
+      if(entry->session.idLength == length && !memcmp(entry->session.id, id, length))
+         break;
+
+      //Next entry
+      entry = entry->hashNext;
+   }
+
+   //Any matching entry?
+   if(entry != NULL)
+   {
+      //Outdated entry?
+      if((osGetTickCount() - entry->session.timestamp) >= TLS_SESSION_CACHE_LIFETIME)
+      {
+         //This session is no more valid and should be removed from the cache
+         tlsCacheUnlink(cache, shard, entry);
+         entry = NULL;
+      }
+      else
+      {
+         //The entry becomes the most recently used one
+         tlsCacheTouch(shard, entry);
+      }
+   }
+
+   //Return the matching entry, if any
+   return entry;
+}
+
+
+/**
+ * @brief Remove an entry from the hash table and the LRU list
+ * @param[in] cache Pointer to the session cache
+ * @param[in] shard Shard holding the entry
+ * @param[in] entry Entry to be released
+ **/
+
+static void tlsCacheUnlink(TlsCache *cache, TlsCacheShard *shard, TlsCacheEntry *entry)
+{
+   TlsCacheEntry **p;
+
+   //Point to the relevant hash bucket
+   p = tlsCacheGetBucket(cache, shard,
+      tlsCacheHash(entry->session.id, entry->session.idLength));
+
+   //Remove the entry from the hash bucket
+   while(*p != NULL)
+   {
+      //Matching entry?
+      if(*p == entry)
+      {
+         *p = entry->hashNext;
+         break;
+      }
+
+      //Next entry
+      p = &(*p)->hashNext;
+   }
+
+   //Remove the entry from the LRU list
+   if(entry->lruPrev != NULL)
+      entry->lruPrev->lruNext = entry->lruNext;
+   else
+      shard->lruHead = entry->lruNext;
+
+   if(entry->lruNext != NULL)
+      entry->lruNext->lruPrev = entry->lruPrev;
+   else
+      shard->lruTail = entry->lruPrev;
+
+   //Clear session parameters
+   memset(entry, 0, sizeof(TlsCacheEntry));
+
+   //The entry is now unused
+   entry->hashNext = shard->freeList;
+   shard->freeList = entry;
+}
+
+
+/**
+ * @brief Move an entry to the head of the LRU list
+ * @param[in] shard Shard holding the entry
+ * @param[in] entry Entry that has just been used
+ **/
+
+static void tlsCacheTouch(TlsCacheShard *shard, TlsCacheEntry *entry)
+{
+   //Already the most recently used entry?
+   if(shard->lruHead == entry)
+      return;
+
+   //Detach the entry from its current position, if any
+   if(entry->lruPrev != NULL)
+      entry->lruPrev->lruNext = entry->lruNext;
+   if(entry->lruNext != NULL)
+      entry->lruNext->lruPrev = entry->lruPrev;
+   else if(shard->lruTail == entry)
+      shard->lruTail = entry->lruPrev;
+
+   //Insert the entry at the head of the list
+   entry->lruPrev = NULL;
+   entry->lruNext = shard->lruHead;
+
+   if(shard->lruHead != NULL)
+      shard->lruHead->lruPrev = entry;
+
+   shard->lruHead = entry;
+
+   //First entry in the list?
+   if(shard->lruTail == NULL)
+      shard->lruTail = entry;
+}
+
 #endif
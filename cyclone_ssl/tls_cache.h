@@ -35,6 +35,7 @@
 //Session cache management
 TlsCache *tlsInitCache(uint_t size);
 TlsSession *tlsFindCache(TlsCache *cache, const uint8_t *id, size_t length);
+error_t tlsRestoreFromCache(TlsContext *context, const uint8_t *id, size_t length);
 error_t tlsSaveToCache(TlsContext *context);
 error_t tlsRemoveFromCache(TlsContext *context);
 void tlsFreeCache(TlsCache *cache);
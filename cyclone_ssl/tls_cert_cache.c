@@ -0,0 +1,284 @@
+/**
+ * @file tls_cert_cache.c
+ * @brief Cache of validated certificate chains
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Verifying the signatures of the server certificate chain is one of the
+ * most expensive steps of a full handshake on the client side. The SHA-256
+ * digest of every certificate list that passed the PKIX path validation is
+ * recorded, together with the trusted CAs it was validated against. When
+ * the same list is presented again, the signature checks are skipped. The
+ * end entity certificate is still parsed and matched against the expected
+ * server name. Entries expire after TLS_CERT_CACHE_LIFETIME, and the
+ * application may flush the cache whenever its trust policy changes (for
+ * instance when a certificate is known to be revoked)
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_cert_cache.h"
+#include "debug.h"
+
+//Check SSL library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_CERT_CACHE_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Initialize the cache of validated certificate chains
+ * @param[in] size Maximum number of cache entries
+ * @return Handle referencing the fully initialized cache
+ **/
+
+TlsCertCache *tlsInitCertCache(uint_t size)
+{
+   size_t n;
+   TlsCertCache *certCache;
+
+   //Make sure the parameter is acceptable
+   if(size < 1)
+      return NULL;
+
+   //Size of the memory required
+   n = sizeof(TlsCertCache) + size * sizeof(TlsCertCacheEntry);
+
+   //Allocate a memory buffer to hold the cache
+   certCache = osMemAlloc(n);
+   //Failed to allocate memory?
+   if(certCache == NULL) return NULL;
+
+   //Clear memory
+   memset(certCache, 0, n);
+
+   //Create a mutex to prevent simultaneous access to the cache
+   certCache->mutex = osMutexCreateNamed(FALSE, "TlsCertCache");
+
+   //Out of ressources?
+   if(certCache->mutex == OS_INVALID_HANDLE)
+   {
+      //Clean up side effects
+      osMemFree(certCache);
+      //Report an error
+      return NULL;
+   }
+
+   //Save the maximum number of cache entries
+   certCache->size = size;
+
+   //Return a pointer to the newly created cache
+   return certCache;
+}
+
+
+/**
+ * @brief Check whether a certificate chain has already been validated
+ * @param[in] context Pointer to the TLS context
+ * @param[in] digest SHA-256 digest of the certificate list
+ * @return TRUE if the chain is known to be valid, else FALSE
+ **/
+
+bool_t tlsFindCertCache(TlsContext *context, const uint8_t *digest)
+{
+   uint_t i;
+   time_t time;
+   bool_t found;
+   TlsCertCache *certCache;
+   TlsCertCacheEntry *entry;
+
+   //Point to the cache
+   certCache = context->certCache;
+   //Get current time
+   time = osGetTickCount();
+   //No matching entry has been found yet
+   found = FALSE;
+
+   //Acquire exclusive access to the cache
+   osMutexAcquire(certCache->mutex);
+
+   //Loop through the cache entries
+   for(i = 0; i < certCache->size; i++)
+   {
+      //Point to the current entry
+      entry = &certCache->entries[i];
+
+      //Skip unused entries
+      if(!entry->valid)
+         continue;
+
+      //Outdated entry?
+      if((time - entry->timestamp) >= TLS_CERT_CACHE_LIFETIME)
+      {
+         //The chain must be validated again
+         entry->valid = FALSE;
+         continue;
+      }
+
+      //Compare the digests of the certificate lists
+      if(memcmp(entry->digest, digest, SHA256_DIGEST_SIZE))
+         continue;
+
+      //The chain must have been validated against the same trusted CAs
+      if(entry->trustedCaList == context->trustedCaList &&
+         entry->caStore == context->caStore)
+      {
+         //Keep track of the last use of the entry
+         entry->lastUsed = time;
+         //The certificate chain is known to be valid
+         found = TRUE;
+         break;
+      }
+   }
+
+   //Release exclusive access to the cache
+   osMutexRelease(certCache->mutex);
+
+   //Debug message
+   if(found)
+      TRACE_INFO("Certificate chain found in cache\r\n");
+
+   //Return TRUE if the chain has already been validated
+   return found;
+}
+
+
+/**
+ * @brief Record a certificate chain that has been successfully validated
+ * @param[in] context Pointer to the TLS context
+ * @param[in] digest SHA-256 digest of the certificate list
+ **/
+
+void tlsSaveToCertCache(TlsContext *context, const uint8_t *digest)
+{
+   uint_t i;
+   time_t time;
+   TlsCertCache *certCache;
+   TlsCertCacheEntry *entry;
+   TlsCertCacheEntry *oldestEntry;
+
+   //Point to the cache
+   certCache = context->certCache;
+   //Get current time
+   time = osGetTickCount();
+   //Keep track of the least recently used entry
+   oldestEntry = NULL;
+
+   //Acquire exclusive access to the cache
+   osMutexAcquire(certCache->mutex);
+
+   //Loop through the cache entries
+   for(i = 0; i < certCache->size; i++)
+   {
+      //Point to the current entry
+      entry = &certCache->entries[i];
+
+      //Unused entry found?
+      if(!entry->valid)
+      {
+         //Use this entry
+         oldestEntry = entry;
+         break;
+      }
+
+      //The same chain may have been validated against other trusted CAs
+      if(!memcmp(entry->digest, digest, SHA256_DIGEST_SIZE))
+      {
+         //Overwrite the existing entry
+         oldestEntry = entry;
+         break;
+      }
+
+      //Keep track of the least recently used entry
+      if(oldestEntry == NULL || (time - entry->lastUsed) > (time - oldestEntry->lastUsed))
+         oldestEntry = entry;
+   }
+
+   //Record the certificate chain
+   oldestEntry->valid = TRUE;
+   oldestEntry->timestamp = time;
+   oldestEntry->lastUsed = time;
+   memcpy(oldestEntry->digest, digest, SHA256_DIGEST_SIZE);
+   oldestEntry->trustedCaList = context->trustedCaList;
+   oldestEntry->caStore = context->caStore;
+
+   //Release exclusive access to the cache
+   osMutexRelease(certCache->mutex);
+}
+
+
+/**
+ * @brief Remove all the entries from the cache
+ *
+ * This function should be called whenever the trusted CAs or the
+ * revocation status of a certificate change
+ *
+ * @param[in] certCache Pointer to the cache
+ **/
+
+void tlsFlushCertCache(TlsCertCache *certCache)
+{
+   uint_t i;
+
+   //Invalid cache?
+   if(certCache == NULL)
+      return;
+
+   //Acquire exclusive access to the cache
+   osMutexAcquire(certCache->mutex);
+
+   //Invalidate all the entries
+   for(i = 0; i < certCache->size; i++)
+      certCache->entries[i].valid = FALSE;
+
+   //Release exclusive access to the cache
+   osMutexRelease(certCache->mutex);
+}
+
+
+/**
+ * @brief Release the cache of validated certificate chains
+ * @param[in] certCache Pointer to the cache
+ **/
+
+void tlsFreeCertCache(TlsCertCache *certCache)
+{
+   //Invalid cache?
+   if(certCache == NULL)
+      return;
+
+   //Release previously allocated ressources
+   osMutexClose(certCache->mutex);
+
+   //Clear the cache before freeing memory
+   memset(certCache, 0, sizeof(TlsCertCache) +
+      certCache->size * sizeof(TlsCertCacheEntry));
+   osMemFree(certCache);
+}
+
+#endif
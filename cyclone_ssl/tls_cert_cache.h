@@ -0,0 +1,42 @@
+/**
+ * @file tls_cert_cache.h
+ * @brief Cache of validated certificate chains
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _TLS_CERT_CACHE_H
+#define _TLS_CERT_CACHE_H
+
+//Dependencies
+#include "tls.h"
+
+//Certificate chain cache management
+TlsCertCache *tlsInitCertCache(uint_t size);
+bool_t tlsFindCertCache(TlsContext *context, const uint8_t *digest);
+void tlsSaveToCertCache(TlsContext *context, const uint8_t *digest);
+void tlsFlushCertCache(TlsCertCache *certCache);
+void tlsFreeCertCache(TlsCertCache *certCache);
+
+#endif
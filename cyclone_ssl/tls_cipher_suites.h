@@ -39,6 +39,9 @@
    {identifier, #identifier, keyExchMethod, cipherAlgo, cipherMode, hashAlgo, prfHashAlgo, \
    macKeyLength, encKeyLength, fixedIvLength, recordIvLength, authTagLength, verifyDataLength}
 
+//TLS 1.3 cipher suites only define the AEAD algorithm and the HKDF hash
+#define TLS13_CIPHER_SUITE(identifier) (((identifier) & 0xFF00) == 0x1300)
+
 
 /**
  * @brief Cipher suite list
@@ -126,6 +129,7 @@ typedef enum
    TLS_DHE_RSA_WITH_ARIA_256_CBC_SHA384         = 0xC045, //RFC 6209
    TLS_DHE_RSA_WITH_ARIA_128_GCM_SHA256         = 0xC052, //RFC 6209
    TLS_DHE_RSA_WITH_ARIA_256_GCM_SHA384         = 0xC053, //RFC 6209
+   TLS_DHE_RSA_WITH_CHACHA20_POLY1305_SHA256 = 0xCCAA, //RFC 7905
 
    TLS_DH_DSS_EXPORT_WITH_DES40_CBC_SHA         = 0x000B, //RFC 2246
    TLS_DH_DSS_WITH_DES_CBC_SHA                  = 0x000C, //RFC 2246
@@ -227,6 +231,7 @@ typedef enum
    TLS_ECDHE_RSA_WITH_ARIA_256_CBC_SHA384       = 0xC04D, //RFC 6209
    TLS_ECDHE_RSA_WITH_ARIA_128_GCM_SHA256       = 0xC060, //RFC 6209
    TLS_ECDHE_RSA_WITH_ARIA_256_GCM_SHA384       = 0xC061, //RFC 6209
+   TLS_ECDHE_RSA_WITH_CHACHA20_POLY1305_SHA256 = 0xCCA8, //RFC 7905
 
    TLS_ECDH_ECDSA_WITH_NULL_SHA                 = 0xC001, //RFC 4492
    TLS_ECDH_ECDSA_WITH_RC4_128_SHA              = 0xC002, //RFC 4492
@@ -263,6 +268,7 @@ typedef enum
    TLS_ECDHE_ECDSA_WITH_ARIA_256_CBC_SHA384     = 0xC049, //RFC 6209
    TLS_ECDHE_ECDSA_WITH_ARIA_128_GCM_SHA256     = 0xC05C, //RFC 6209
    TLS_ECDHE_ECDSA_WITH_ARIA_256_GCM_SHA384     = 0xC05D, //RFC 6209
+   TLS_ECDHE_ECDSA_WITH_CHACHA20_POLY1305_SHA256 = 0xCCA9, //RFC 7905
 
    TLS_ECDH_ANON_WITH_NULL_SHA                  = 0xC015, //RFC 4492
    TLS_ECDH_ANON_WITH_RC4_128_SHA               = 0xC016, //RFC 4492
@@ -293,6 +299,7 @@ typedef enum
    TLS_PSK_WITH_ARIA_256_CBC_SHA384             = 0xC065, //RFC 6209
    TLS_PSK_WITH_ARIA_128_GCM_SHA256             = 0xC06A, //RFC 6209
    TLS_PSK_WITH_ARIA_256_GCM_SHA384             = 0xC06B, //RFC 6209
+   TLS_PSK_WITH_CHACHA20_POLY1305_SHA256 = 0xCCAB, //RFC 7905
 
    TLS_RSA_PSK_WITH_NULL_SHA                    = 0x002E, //RFC 4785
    TLS_RSA_PSK_WITH_NULL_SHA256                 = 0x00B8, //RFC 5487
@@ -313,6 +320,7 @@ typedef enum
    TLS_RSA_PSK_WITH_ARIA_256_CBC_SHA384         = 0xC069, //RFC 6209
    TLS_RSA_PSK_WITH_ARIA_128_GCM_SHA256         = 0xC06E, //RFC 6209
    TLS_RSA_PSK_WITH_ARIA_256_GCM_SHA384         = 0xC06F, //RFC 6209
+   TLS_RSA_PSK_WITH_CHACHA20_POLY1305_SHA256 = 0xCCAE, //RFC 7905
 
    TLS_DHE_PSK_WITH_NULL_SHA                    = 0x002D, //RFC 4785
    TLS_DHE_PSK_WITH_NULL_SHA256                 = 0x00B4, //RFC 5487
@@ -337,6 +345,7 @@ typedef enum
    TLS_DHE_PSK_WITH_ARIA_256_CBC_SHA384         = 0xC067, //RFC 6209
    TLS_DHE_PSK_WITH_ARIA_128_GCM_SHA256         = 0xC06C, //RFC 6209
    TLS_DHE_PSK_WITH_ARIA_256_GCM_SHA384         = 0xC06D, //RFC 6209
+   TLS_DHE_PSK_WITH_CHACHA20_POLY1305_SHA256 = 0xCCAD, //RFC 7905
 
    TLS_ECDHE_PSK_WITH_NULL_SHA                  = 0xC039, //RFC 5489
    TLS_ECDHE_PSK_WITH_NULL_SHA256               = 0xC03A, //RFC 5489
@@ -351,6 +360,7 @@ typedef enum
    TLS_ECDHE_PSK_WITH_CAMELLIA_256_CBC_SHA384   = 0xC09B, //RFC 6367
    TLS_ECDHE_PSK_WITH_ARIA_128_CBC_SHA256       = 0xC070, //RFC 6209
    TLS_ECDHE_PSK_WITH_ARIA_256_CBC_SHA384       = 0xC071, //RFC 6209
+   TLS_ECDHE_PSK_WITH_CHACHA20_POLY1305_SHA256 = 0xCCAC, //RFC 7905
 
    TLS_KRB5_EXPORT_WITH_RC4_40_MD5              = 0x002B, //RFC 2712
    TLS_KRB5_EXPORT_WITH_RC4_40_SHA              = 0x0028, //RFC 2712
@@ -379,6 +389,12 @@ typedef enum
    TLS_SRP_SHA_DSS_WITH_AES_128_CBC_SHA         = 0xC01F, //RFC 5054
    TLS_SRP_SHA_DSS_WITH_AES_256_CBC_SHA         = 0xC022, //RFC 5054
 
+   TLS_AES_128_GCM_SHA256                       = 0x1301, //RFC 8446
+   TLS_AES_256_GCM_SHA384                       = 0x1302, //RFC 8446
+   TLS_CHACHA20_POLY1305_SHA256                 = 0x1303, //RFC 8446
+   TLS_AES_128_CCM_SHA256                       = 0x1304, //RFC 8446
+   TLS_AES_128_CCM_8_SHA256                     = 0x1305, //RFC 8446
+
    TLS_EMPTY_RENEGOTIATION_INFO_SCSV            = 0x00FF  //RFC 5746
 } TlsCipherSuiteList;
 
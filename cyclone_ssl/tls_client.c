@@ -42,7 +42,11 @@
 #include "tls_client.h"
 #include "tls_common.h"
 #include "tls_record.h"
+#include "tls_io.h"
 #include "tls_misc.h"
+#include "tls_client_cache.h"
+#include "tls13_misc.h"
+#include "tls13_client.h"
 #include "pem.h"
 #include "debug.h"
 
@@ -64,13 +68,71 @@ error_t tlsClientHandshake(TlsContext *context)
 {
    error_t error;
 
-   //The client initiates the TLS handshake by sending
-   //a ClientHello message to the server
-   context->state = TLS_STATE_CLIENT_HELLO;
+   //Initialize status code
+   error = NO_ERROR;
+
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+   //A handshake stopped by a would-block condition resumes where it stopped
+   if(context->handshakePending)
+      context->handshakePending = FALSE;
+   else
+#endif
+#if (TLS_FALSE_START_SUPPORT == ENABLED)
+   //A handshake left pending by False Start resumes where it stopped
+   if(context->falseStart)
+   {
+      //Wait for the last flight of the server
+   }
+   else
+#endif
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   //The ClientHello has already been sent along with 0-RTT data?
+   if(context->earlyDataEnabled && context->state == TLS_STATE_SERVER_HELLO)
+   {
+      //Start measuring the handshake duration
+      TLS_PROFILE_START(context, TLS_PROFILE_HANDSHAKE);
+   }
+   else
+#endif
+   {
+      //The client initiates the TLS handshake by sending
+      //a ClientHello message to the server
+      context->state = TLS_STATE_CLIENT_HELLO;
+      //Start measuring the handshake duration
+      TLS_PROFILE_START(context, TLS_PROFILE_HANDSHAKE);
+   }
 
    //Wait for the handshake to complete
    while(context->state != TLS_STATE_APPLICATION_DATA)
    {
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+      //Data the socket has not accepted yet must be sent before the TX
+      //buffer is reused or a response is awaited
+      error = tlsIoFlush(context, FALSE);
+
+      //The socket is not ready?
+      if(error == ERROR_WOULD_BLOCK)
+      {
+         //The next call resumes the handshake in the current state
+         context->handshakePending = TRUE;
+         break;
+      }
+      else if(error)
+      {
+         //Exit immediately
+         break;
+      }
+#endif
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+      //TLS 1.3 has its own set of handshake messages
+      if(context->version == TLS_VERSION_1_3)
+      {
+         //Process the current state of the TLS 1.3 handshake
+         error = tls13ClientHandshakeStep(context);
+      }
+      else
+#endif
       //The TLS handshake is implemented as a state machine
       //representing the current location in the protocol
       switch(context->state)
@@ -94,7 +156,9 @@ error_t tlsClientHandshake(TlsContext *context)
          //follow the client certificate message, if it is sent. Otherwise,
          //it must be the first message sent by the client after it receives
          //the ServerHelloDone message
+         TLS_PROFILE_START(context, TLS_PROFILE_KEY_EXCHANGE);
          error = tlsSendClientKeyExchange(context);
+         TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_EXCHANGE);
          break;
       //Send CertificateVerify message?
       case TLS_STATE_CERTIFICATE_VERIFY:
@@ -102,7 +166,9 @@ error_t tlsClientHandshake(TlsContext *context)
          //certificate. This message is only sent following a client certificate
          //that has signing capability. When sent, it must immediately follow
          //the clientKeyExchange message
+         TLS_PROFILE_START(context, TLS_PROFILE_KEY_EXCHANGE);
          error = tlsSendCertificateVerify(context);
+         TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_EXCHANGE);
          break;
       //Send ChangeCipherSpec message?
       case TLS_STATE_CLIENT_CHANGE_CIPHER_SPEC:
@@ -124,6 +190,7 @@ error_t tlsClientHandshake(TlsContext *context)
       case TLS_STATE_SERVER_KEY_EXCHANGE:
       case TLS_STATE_CERTIFICATE_REQUEST:
       case TLS_STATE_SERVER_HELLO_DONE:
+      case TLS_STATE_NEW_SESSION_TICKET:
       case TLS_STATE_SERVER_CHANGE_CIPHER_SPEC:
       case TLS_STATE_SERVER_FINISHED:
          //Parse incoming handshake message
@@ -146,12 +213,68 @@ error_t tlsClientHandshake(TlsContext *context)
       //Abort TLS handshake if an error was encountered
       if(error)
       {
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+         //The socket is not ready?
+         if(error == ERROR_WOULD_BLOCK)
+         {
+            //The next call resumes the handshake in the current state
+            context->handshakePending = TRUE;
+            break;
+         }
+#endif
          //Send an alert message to the server
          tlsProcessError(context, error);
          //Exit immediately
          break;
       }
+
+#if (TLS_FALSE_START_SUPPORT == ENABLED)
+      //Once its Finished message is sent, the client may send application
+      //data without waiting for the server's Finished message
+      if(!context->falseStart && tlsIsFalseStartAllowed(context))
+      {
+         //The handshake will be completed by the next call to tlsRead
+         context->falseStart = TRUE;
+         //Exit immediately
+         break;
+      }
+#endif
+   }
+
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+   //The handshake is not complete yet?
+   if(error == ERROR_WOULD_BLOCK)
+      return error;
+#endif
+
+#if (TLS_FALSE_START_SUPPORT == ENABLED)
+   //The handshake is either complete or has failed?
+   if(error || context->state == TLS_STATE_APPLICATION_DATA)
+      context->falseStart = FALSE;
+
+   //The handshake duration is measured once the server's Finished
+   //message has been received
+   if(!context->falseStart)
+#endif
+   {
+      //The handshake is either complete or has failed
+      TLS_PROFILE_STOP(context, TLS_PROFILE_HANDSHAKE);
+   }
+
+#if (TLS_CLIENT_CACHE_SUPPORT == ENABLED)
+   //Once the handshake is complete, the session can be resumed by the
+   //next connection to the same server. TLS 1.3 sessions are recorded
+   //when a NewSessionTicket message is received
+   if(!error && context->state == TLS_STATE_APPLICATION_DATA &&
+      context->version <= TLS_VERSION_1_2)
+   {
+      tlsSaveToClientCache(context);
    }
+#endif
+
+   //Only the record layer state is needed from now on
+   if(!error && context->state == TLS_STATE_APPLICATION_DATA)
+      tlsFreeHandshakeState(context);
 
    //Return status code
    return error;
@@ -199,14 +322,18 @@ error_t tlsParseServerMessage(TlsContext *context)
          //The server must send a Certificate message whenever the agreed-
          //upon key exchange method uses certificates for authentication. This
          //message will always immediately follow the ServerHello message
+         TLS_PROFILE_START(context, TLS_PROFILE_CERTIFICATE);
          error = tlsParseCertificate(context, message, length);
+         TLS_PROFILE_STOP(context, TLS_PROFILE_CERTIFICATE);
          break;
       //ServerKeyExchange message received?
       case TLS_TYPE_SERVER_KEY_EXCHANGE:
          //The ServerKeyExchange message is sent by the server only when the
          //server Certificate message (if sent) does not contain enough data
          //to allow the client to exchange a premaster secret
+         TLS_PROFILE_START(context, TLS_PROFILE_KEY_EXCHANGE);
          error = tlsParseServerKeyExchange(context, message, length);
+         TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_EXCHANGE);
          break;
       //CertificateRequest message received?
       case TLS_TYPE_CERTIFICATE_REQUEST:
@@ -221,6 +348,14 @@ error_t tlsParseServerMessage(TlsContext *context)
          //end of the ServerHello and associated messages
          error = tlsParseServerHelloDone(context, message, length);
          break;
+#if (TLS_TICKET_SUPPORT == ENABLED)
+      //NewSessionTicket message received?
+      case TLS_TYPE_NEW_SESSION_TICKET:
+         //The NewSessionTicket message is sent by the server just
+         //before its ChangeCipherSpec message
+         error = tlsParseNewSessionTicket(context, message, length);
+         break;
+#endif
       //Finished message received?
       case TLS_TYPE_FINISHED:
          //A Finished message is always sent immediately after a changeCipherSpec
@@ -290,19 +425,29 @@ error_t tlsSendClientHello(TlsContext *context)
    TlsCipherSuites *cipherSuites;
    TlsCompressionMethods *compressionMethods;
    TlsExtensions *extensionList;
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   size_t ticketLength;
+#endif
 
-   //Get the current time
-   uint32_t t = (uint32_t) osGetTime();
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //The second ClientHello sent in response to a HelloRetryRequest
+   //carries the same random value as the first one
+   if(!context->helloRetryRequest)
+#endif
+   {
+      //Get the current time
+      uint32_t t = (uint32_t) osGetTime();
 
-   //Generate the client random value. The first four bytes code
-   //the current time and date in standard Unix format
-   context->clientRandom.gmtUnixTime = htonl(t);
+      //Generate the client random value. The first four bytes code
+      //the current time and date in standard Unix format
+      context->clientRandom.gmtUnixTime = htonl(t);
 
-   //The last 28 bytes contain securely-generated random bytes
-   error = context->prngAlgo->read(context->prngContext,
-      context->clientRandom.randomBytes, 28);
-   //Any error to report?
-   if(error) return error;
+      //The last 28 bytes contain securely-generated random bytes
+      error = context->prngAlgo->read(context->prngContext,
+         context->clientRandom.randomBytes, 28);
+      //Any error to report?
+      if(error) return error;
+   }
 
    //Buffer where to format the message
    p = context->txBuffer + sizeof(TlsRecord);
@@ -311,9 +456,41 @@ error_t tlsSendClientHello(TlsContext *context)
    message = (TlsClientHello *) p;
    //Format message header
    message->msgType = TLS_TYPE_CLIENT_HELLO;
-   message->clientVersion = HTONS(TLS_MAX_VERSION);
+   //TLS 1.3 is negotiated by the SupportedVersions extension
+   message->clientVersion = HTONS(min(TLS_MAX_VERSION, TLS_VERSION_1_2));
    message->random = context->clientRandom;
 
+#if (TLS_CLIENT_CACHE_SUPPORT == ENABLED)
+   //Unless the application has restored a session, offer to resume
+   //the last session established with the server
+   if(context->sessionIdLength == 0 && !context->cipherSuite)
+      tlsRestoreFromClientCache(context);
+#endif
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //Tickets issued by a TLS 1.3 server are presented in the
+   //PreSharedKey extension instead
+   if(context->sessionVersion == TLS_VERSION_1_3)
+      ticketLength = 0;
+   else
+#endif
+      ticketLength = context->ticketLength;
+
+   //When presenting a ticket, the client generates a session ID so that
+   //it can tell whether the server accepted the ticket
+   if(ticketLength > 0 && context->sessionIdLength == 0)
+   {
+      //Generate a random session ID
+      error = context->prngAlgo->read(context->prngContext, context->sessionId, 32);
+      //Any error to report?
+      if(error) return error;
+
+      //Session ID is limited to 32 bytes
+      context->sessionIdLength = 32;
+   }
+#endif
+
 #if (TLS_SESSION_RESUME_SUPPORT == ENABLED)
    //The SessionID value identifies a session the client wishes
    //to reuse for this connection
@@ -448,8 +625,171 @@ error_t tlsSendClientHello(TlsContext *context)
    }
 #endif
 
-#if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
-   //Include the SignatureAlgorithms extension only if TLS 1.2 is supported
+#if (TLS_MAX_FRAG_LENGTH_SUPPORT == ENABLED)
+   //In order to negotiate smaller maximum fragment lengths, clients may
+   //include a MaxFragmentLength extension
+   if(context->maxFragLength < TLS_MAX_RECORD_LENGTH)
+   {
+      TlsExtension *extension;
+
+      //Add the MaxFragmentLength extension
+      extension = (TlsExtension *) p;
+      //Type of the extension
+      extension->type = HTONS(TLS_EXT_MAX_FRAGMENT_LENGTH);
+
+      //The maximum fragment length is encoded as 2^(8 + n)
+      for(n = TLS_MAX_FRAG_LENGTH_512; (256U << n) < context->maxFragLength; n++);
+
+      //Copy the encoded value
+      extension->value[0] = (uint8_t) n;
+      //Fix the length of the extension
+      extension->length = HTONS(1);
+
+      //Compute the length, in bytes, of the MaxFragmentLength extension
+      n = sizeof(TlsExtension) + 1;
+      //Fix the length of the extension list
+      extensionList->length += n;
+
+      //Point to the next field
+      p += n;
+      //Total length of the message
+      length += n;
+   }
+#endif
+
+#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+   //A client whose receive buffer cannot hold full-sized records advertises
+   //its limit. Clients should not send both MaxFragmentLength and
+   //RecordSizeLimit extensions
+   if(context->rxBufferSize < TLS_MAX_RECORD_LENGTH &&
+      context->maxFragLength == TLS_MAX_RECORD_LENGTH)
+   {
+      TlsExtension *extension;
+
+      //Add the RecordSizeLimit extension
+      extension = (TlsExtension *) p;
+      //Type of the extension
+      extension->type = HTONS(TLS_EXT_RECORD_SIZE_LIMIT);
+
+      //Maximum size of the records the client is willing to receive
+      STORE16BE(context->rxBufferSize, extension->value);
+      //Fix the length of the extension
+      extension->length = HTONS(sizeof(uint16_t));
+
+      //Compute the length, in bytes, of the RecordSizeLimit extension
+      n = sizeof(TlsExtension) + sizeof(uint16_t);
+      //Fix the length of the extension list
+      extensionList->length += n;
+
+      //Point to the next field
+      p += n;
+      //Total length of the message
+      length += n;
+   }
+#endif
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //The SessionTicket extension is empty if the client does not hold
+   //a ticket for the server
+   {
+      TlsExtension *extension;
+
+      //Add the SessionTicket extension
+      extension = (TlsExtension *) p;
+      //Type of the extension
+      extension->type = HTONS(TLS_EXT_SESSION_TICKET);
+
+      //Copy the ticket, if any
+      memcpy(extension->value, context->ticket, ticketLength);
+      //Fix the length of the extension
+      extension->length = htons(ticketLength);
+
+      //Compute the length, in bytes, of the SessionTicket extension
+      n = sizeof(TlsExtension) + ticketLength;
+      //Fix the length of the extension list
+      extensionList->length += n;
+
+      //Point to the next field
+      p += n;
+      //Total length of the message
+      length += n;
+   }
+#endif
+
+#if (TLS_ECDHE_RSA_SUPPORT == ENABLED || TLS_ECDHE_ECDSA_SUPPORT == ENABLED || \
+   TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //A client that proposes ECC cipher suites should include the
+   //EllipticCurves and EcPointFormats extensions (refer to RFC 4492).
+   //TLS 1.3 uses the same extension to list the supported groups
+   {
+      TlsExtension *extension;
+      TlsEllipticCurveList *curveList;
+      TlsEcPointFormatList *pointFormatList;
+
+      //Add the EllipticCurves extension
+      extension = (TlsExtension *) p;
+      //Type of the extension
+      extension->type = HTONS(TLS_EXT_ELLIPTIC_CURVES);
+
+      //Point to the list of supported elliptic curves
+      curveList = (TlsEllipticCurveList *) extension->value;
+
+      //Enumerate the named curves in descending order of preference
+      n = 0;
+      curveList->value[n++] = HTONS(TLS_EC_CURVE_ECDH_X25519);
+      curveList->value[n++] = HTONS(TLS_EC_CURVE_SECP256R1);
+      curveList->value[n++] = HTONS(TLS_EC_CURVE_SECP384R1);
+
+      //Compute the length, in bytes, of the list
+      n *= sizeof(uint16_t);
+      //Fix the length of the list
+      curveList->length = htons(n);
+
+      //Consider the 2-byte length field that precedes the list
+      n += sizeof(TlsEllipticCurveList);
+      //Fix the length of the extension
+      extension->length = htons(n);
+
+      //Compute the length, in bytes, of the EllipticCurves extension
+      n += sizeof(TlsExtension);
+      //Fix the length of the extension list
+      extensionList->length += n;
+
+      //Point to the next field
+      p += n;
+      //Total length of the message
+      length += n;
+
+      //Add the EcPointFormats extension
+      extension = (TlsExtension *) p;
+      //Type of the extension
+      extension->type = HTONS(TLS_EXT_EC_POINT_FORMATS);
+
+      //Point to the list of supported EC point formats
+      pointFormatList = (TlsEcPointFormatList *) extension->value;
+      //Only the uncompressed format is supported
+      pointFormatList->value[0] = TLS_EC_POINT_FORMAT_UNCOMPRESSED;
+      pointFormatList->length = 1;
+
+      //Fix the length of the extension
+      n = sizeof(TlsEcPointFormatList) + pointFormatList->length;
+      extension->length = htons(n);
+
+      //Compute the length, in bytes, of the EcPointFormats extension
+      n += sizeof(TlsExtension);
+      //Fix the length of the extension list
+      extensionList->length += n;
+
+      //Point to the next field
+      p += n;
+      //Total length of the message
+      length += n;
+   }
+#endif
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_2)
+   //Include the SignatureAlgorithms extension only if TLS 1.2
+   //or a later version is supported
    {
       TlsExtension *extension;
       TlsSignHashAlgos *supportedSignAlgos;
@@ -492,6 +832,21 @@ error_t tlsSendClientHello(TlsContext *context)
       supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_RSA;
       supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_SHA512;
 #endif
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+      //RSASSA-PSS with SHA-256 is always supported
+      supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA256;
+      supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_INTRINSIC;
+#if (TLS_SHA384_SUPPORT == ENABLED)
+      //RSASSA-PSS with SHA-384 support is optional
+      supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA384;
+      supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_INTRINSIC;
+#endif
+#if (TLS_SHA512_SUPPORT == ENABLED)
+      //RSASSA-PSS with SHA-512 support is optional
+      supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA512;
+      supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_INTRINSIC;
+#endif
+#endif
 #endif
 
 #if (TLS_DSA_SIGN_SUPPORT == ENABLED)
@@ -508,6 +863,30 @@ error_t tlsSendClientHello(TlsContext *context)
       supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_SHA256;
 #endif
 
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+      //ECDSA with SHA-1 is always supported
+      supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_ECDSA;
+      supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_SHA1;
+#if (TLS_SHA224_SUPPORT == ENABLED)
+      //ECDSA with SHA-224 support is optional
+      supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_ECDSA;
+      supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_SHA224;
+#endif
+      //ECDSA with SHA-256 is always supported
+      supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_ECDSA;
+      supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_SHA256;
+#if (TLS_SHA384_SUPPORT == ENABLED)
+      //ECDSA with SHA-384 support is optional
+      supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_ECDSA;
+      supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_SHA384;
+#endif
+#if (TLS_SHA512_SUPPORT == ENABLED)
+      //ECDSA with SHA-512 support is optional
+      supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_ECDSA;
+      supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_SHA512;
+#endif
+#endif
+
       //Compute the length, in bytes, of the list
       n *= sizeof(TlsSignHashAlgo);
       //Fix the length of the list
@@ -530,12 +909,40 @@ error_t tlsSendClientHello(TlsContext *context)
    }
 #endif
 
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //The PreSharedKey extension must be the last extension of the
+   //ClientHello, so the TLS 1.3 extensions come last
+   {
+      size_t written;
+
+      //Add the TLS 1.3 specific extensions
+      error = tls13FormatClientHelloExtensions(context, p, &written);
+      //Any error to report?
+      if(error) return error;
+
+      //Fix the length of the extension list
+      extensionList->length += written;
+
+      //Point to the next field
+      p += written;
+      //Total length of the message
+      length += written;
+   }
+#endif
+
    //Convert the length of the extension list to network byte order
    extensionList->length = htons(extensionList->length);
 
    //Fix the length field
    STORE24BE(length - sizeof(TlsHandshake), message->length);
 
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //The PSK binder is computed over the message, binders excluded
+   error = tls13ComputeClientHelloBinder(context, message, length);
+   //Any error to report?
+   if(error) return error;
+#endif
+
    //Debug message
    TRACE_INFO("Sending ClientHello message (%u bytes)...\r\n", length);
    TRACE_DEBUG_ARRAY("  ", message, length);
@@ -584,9 +991,9 @@ error_t tlsSendClientKeyExchange(TlsContext *context)
       //client generates a 48-byte premaster secret
       context->premasterSecretLength = 48;
 
-      //The first 2 bytes code the latest version supported by the client
-      context->premasterSecret[0] = MSB(TLS_MAX_VERSION);
-      context->premasterSecret[1] = LSB(TLS_MAX_VERSION);
+      //The first 2 bytes code the version offered in the ClientHello
+      context->premasterSecret[0] = MSB(min(TLS_MAX_VERSION, TLS_VERSION_1_2));
+      context->premasterSecret[1] = LSB(min(TLS_MAX_VERSION, TLS_VERSION_1_2));
 
       //The last 46 bytes contain securely-generated random bytes
       error = context->prngAlgo->read(context->prngContext, context->premasterSecret + 2, 46);
@@ -657,6 +1064,30 @@ error_t tlsSendClientKeyExchange(TlsContext *context)
       }
    }
    else
+#endif
+#if (TLS_ECDHE_RSA_SUPPORT == ENABLED || TLS_ECDHE_ECDSA_SUPPORT == ENABLED)
+   //ECDH key exchange method?
+   if(context->keyExchMethod == TLS_KEY_EXCH_ECDHE_RSA ||
+      context->keyExchMethod == TLS_KEY_EXCH_ECDHE_ECDSA)
+   {
+      //Generate an ephemeral key pair on the curve selected by the server
+      error = ecdhGenerateKeyPair(&context->ecdhContext, context->prngAlgo, context->prngContext);
+      //Any error to report?
+      if(error) return error;
+
+      //Encode the client's public value to an opaque vector
+      error = tlsWriteEcPoint(&context->ecdhContext, message->exchangeKeys, &length);
+      //Any error to report?
+      if(error) return error;
+
+      //The premaster secret is the x-coordinate of the shared point, leading
+      //zero bytes are preserved (refer to RFC 4492, section 5.10)
+      error = ecdhComputeSharedSecret(&context->ecdhContext, context->premasterSecret,
+         sizeof(context->premasterSecret), &context->premasterSecretLength);
+      //Any error to report?
+      if(error) return error;
+   }
+   else
 #endif
    //Invalid key exchange method?
    {
@@ -679,7 +1110,9 @@ error_t tlsSendClientKeyExchange(TlsContext *context)
    if(error) return error;
 
    //Derive session keys from the premaster secret
+   TLS_PROFILE_START(context, TLS_PROFILE_KEY_DERIVATION);
    error = tlsGenerateKeys(context);
+   TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_DERIVATION);
    //Unable to generate key material?
    if(error) return error;
 
@@ -713,7 +1146,8 @@ error_t tlsSendCertificateVerify(TlsContext *context)
    {
       //Check certificate type
       if(context->cert->type == TLS_CERT_RSA_SIGN ||
-         context->cert->type == TLS_CERT_DSS_SIGN)
+         context->cert->type == TLS_CERT_DSS_SIGN ||
+         context->cert->type == TLS_CERT_ECDSA_SIGN)
       {
          //Point to the CertificateVerify message
          message = (TlsCertificateVerify *) (context->txBuffer + sizeof(TlsRecord));
@@ -731,8 +1165,6 @@ error_t tlsSendCertificateVerify(TlsContext *context)
             //The client's certificate contains a valid RSA public key?
             if(context->cert->type == TLS_CERT_RSA_SIGN)
             {
-               RsaPrivateKey rsaPrivateKey;
-
                //Digest all the handshake messages starting at ClientHello (using MD5)
                error = tlsFinalizeHandshakeHash(context, MD5_HASH_ALGO,
                   context->handshakeMd5Context, "", context->verifyData);
@@ -745,21 +1177,9 @@ error_t tlsSendCertificateVerify(TlsContext *context)
                //Any error to report?
                if(error) return error;
 
-               //Initialize RSA private key
-               rsaInitPrivateKey(&rsaPrivateKey);
-
-               //Decode the PEM structure that holds the RSA private key
-               error = pemReadRsaPrivateKey(context->cert->privateKey,
-                  context->cert->privateKeyLength, &rsaPrivateKey);
-               //Any error to report?
-               if(error) return error;
-
                //Generate a RSA signature using the client's private key
-               error = tlsGenerateRsaSignature(&rsaPrivateKey,
+               error = tlsGenerateRsaSignature(&context->cert->rsaPrivateKey,
                   context->verifyData, signature->value, &length);
-
-               //Release previously allocated resources
-               rsaFreePrivateKey(&rsaPrivateKey);
             }
             else
 #endif
@@ -767,29 +1187,32 @@ error_t tlsSendCertificateVerify(TlsContext *context)
             //The client's certificate contains a valid DSA public key?
             if(context->cert->type == TLS_CERT_DSS_SIGN)
             {
-               DsaPrivateKey dsaPrivateKey;
-
                //Digest all the handshake messages starting at ClientHello
                error = tlsFinalizeHandshakeHash(context, SHA1_HASH_ALGO,
                   context->handshakeSha1Context, "", context->verifyData);
                //Any error to report?
                if(error) return error;
 
-               //Initialize DSA private key
-               dsaInitPrivateKey(&dsaPrivateKey);
-
-               //Decode the PEM structure that holds the DSA private key
-               error = pemReadDsaPrivateKey(context->cert->privateKey,
-                  context->cert->privateKeyLength, &dsaPrivateKey);
-               //Any error to report?
-               if(error) return error;
-
                //Generate a DSA signature using the client's private key
                error = tlsGenerateDsaSignature(context->prngAlgo, context->prngContext,
-                  &dsaPrivateKey, context->verifyData, SHA1_DIGEST_SIZE, signature->value, &length);
+                  &context->cert->dsaPrivateKey, context->verifyData, SHA1_DIGEST_SIZE, signature->value, &length);
+            }
+            else
+#endif
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+            //The client's certificate contains a valid EC public key?
+            if(context->cert->type == TLS_CERT_ECDSA_SIGN)
+            {
+               //Digest all the handshake messages starting at ClientHello
+               error = tlsFinalizeHandshakeHash(context, SHA1_HASH_ALGO,
+                  context->handshakeSha1Context, "", context->verifyData);
+               //Any error to report?
+               if(error) return error;
 
-               //Release previously allocated resources
-               dsaFreePrivateKey(&dsaPrivateKey);
+               //Generate an ECDSA signature using the client's private key
+               error = tlsGenerateEcdsaSignature(&context->cert->ecParams, context->prngAlgo,
+                  context->prngContext, &context->cert->ecPrivateKey, context->verifyData,
+                  SHA1_DIGEST_SIZE, signature->value, &length);
             }
             else
 #endif
@@ -819,7 +1242,7 @@ error_t tlsSendCertificateVerify(TlsContext *context)
             const HashAlgo *hashAlgo = tlsGetHashAlgo(context->signHashAlgo);
 
             //Digest all the handshake messages starting at ClientHello
-            if(hashAlgo == SHA1_HASH_ALGO)
+            if(hashAlgo == SHA1_HASH_ALGO && context->handshakeSha1Context != NULL)
             {
                //Use SHA-1 hash algorithm
                error = tlsFinalizeHandshakeHash(context, SHA1_HASH_ALGO,
@@ -844,27 +1267,13 @@ error_t tlsSendCertificateVerify(TlsContext *context)
             //The client's certificate contains a valid RSA public key?
             if(context->cert->type == TLS_CERT_RSA_SIGN)
             {
-               RsaPrivateKey rsaPrivateKey;
-
                //Set the relevant signature algorithm
                signature->algorithm.signature = TLS_SIGN_ALGO_RSA;
                signature->algorithm.hash = context->signHashAlgo;
 
-               //Initialize RSA private key
-               rsaInitPrivateKey(&rsaPrivateKey);
-
-               //Decode the PEM structure that holds the RSA private key
-               error = pemReadRsaPrivateKey(context->cert->privateKey,
-                  context->cert->privateKeyLength, &rsaPrivateKey);
-               //Any error to report?
-               if(error) return error;
-
                //Use the signature algorithm defined in PKCS #1 v1.5
-               error = rsassaPkcs1v15Sign(&rsaPrivateKey, hashAlgo,
+               error = rsassaPkcs1v15Sign(&context->cert->rsaPrivateKey, hashAlgo,
                   context->verifyData, signature->value, &length);
-
-               //Release previously allocated resources
-               rsaFreePrivateKey(&rsaPrivateKey);
             }
             else
 #endif
@@ -872,27 +1281,28 @@ error_t tlsSendCertificateVerify(TlsContext *context)
             //The client's certificate contains a valid DSA public key?
             if(context->cert->type == TLS_CERT_DSS_SIGN)
             {
-               DsaPrivateKey dsaPrivateKey;
-
                //Set the relevant signature algorithm
                signature->algorithm.signature = TLS_SIGN_ALGO_DSA;
                signature->algorithm.hash = context->signHashAlgo;
 
-               //Initialize DSA private key
-               dsaInitPrivateKey(&dsaPrivateKey);
-
-               //Decode the PEM structure that holds the DSA private key
-               error = pemReadDsaPrivateKey(context->cert->privateKey,
-                  context->cert->privateKeyLength, &dsaPrivateKey);
-               //Any error to report?
-               if(error) return error;
-
                //Generate a DSA signature using the client's private key
                error = tlsGenerateDsaSignature(context->prngAlgo, context->prngContext,
-                  &dsaPrivateKey, context->verifyData, hashAlgo->digestSize, signature->value, &length);
+                  &context->cert->dsaPrivateKey, context->verifyData, hashAlgo->digestSize, signature->value, &length);
+            }
+            else
+#endif
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+            //The client's certificate contains a valid EC public key?
+            if(context->cert->type == TLS_CERT_ECDSA_SIGN)
+            {
+               //Set the relevant signature algorithm
+               signature->algorithm.signature = TLS_SIGN_ALGO_ECDSA;
+               signature->algorithm.hash = context->signHashAlgo;
 
-               //Release previously allocated resources
-               dsaFreePrivateKey(&dsaPrivateKey);
+               //Generate an ECDSA signature using the client's private key
+               error = tlsGenerateEcdsaSignature(&context->cert->ecParams, context->prngAlgo,
+                  context->prngContext, &context->cert->ecPrivateKey, context->verifyData,
+                  hashAlgo->digestSize, signature->value, &length);
             }
             else
 #endif
@@ -963,6 +1373,9 @@ error_t tlsParseServerHello(TlsContext *context, const TlsServerHello *message,
    const uint8_t *p;
    TlsCipherSuite cipherSuite;
    TlsCompressionMethod compressionMethod;
+#if (TLS_MAX_FRAG_LENGTH_SUPPORT == ENABLED || TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+   const TlsExtension *extension;
+#endif
 
    //Debug message
    TRACE_INFO("ServerHello message received (%u bytes)...\r\n", length);
@@ -1010,6 +1423,95 @@ error_t tlsParseServerHello(TlsContext *context, const TlsServerHello *message,
    //Remaining bytes to process
    n -= sizeof(TlsCompressionMethod);
 
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //A server negotiating TLS 1.3 sends a SupportedVersions extension
+   if(tlsGetExtension(p, n, TLS_EXT_SUPPORTED_VERSIONS) != NULL)
+   {
+      //The rest of the message is processed by the TLS 1.3 code
+      return tls13ParseServerHello(context, message, length,
+         cipherSuite, compressionMethod, p, n);
+   }
+
+   //The server cannot select a prior version after a HelloRetryRequest
+   if(context->helloRetryRequest)
+      return ERROR_ILLEGAL_PARAMETER;
+   //TLS 1.3 cannot be negotiated through the legacy version field
+   if(ntohs(message->serverVersion) > TLS_VERSION_1_2)
+      return ERROR_VERSION_NOT_SUPPORTED;
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   //0-RTT data have been sent on the assumption that TLS 1.3 is used
+   if(context->earlyDataEnabled)
+      return ERROR_HANDSHAKE_FAILED;
+#endif
+
+   //A TLS 1.3 server negotiating a prior version sets the last bytes of
+   //its random value to a special value (downgrade protection)
+   if(!memcmp(message->random.randomBytes + 20, tls13DowngradeTls12Sentinel, 8) ||
+      !memcmp(message->random.randomBytes + 20, tls13DowngradeTls11Sentinel, 8))
+   {
+      //Report an error
+      return ERROR_ILLEGAL_PARAMETER;
+   }
+#endif
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //An empty SessionTicket extension indicates that
+   //the server will send a new ticket
+   context->newSessionTicket = (tlsGetExtension(p, n, TLS_EXT_SESSION_TICKET) != NULL);
+#endif
+
+#if (TLS_MAX_FRAG_LENGTH_SUPPORT == ENABLED)
+   //The client requested a maximum fragment length?
+   if(context->maxFragLength < TLS_MAX_RECORD_LENGTH)
+   {
+      //Search for the MaxFragmentLength extension
+      extension = tlsGetExtension(p, n, TLS_EXT_MAX_FRAGMENT_LENGTH);
+
+      //The server accepted the request?
+      if(extension != NULL)
+      {
+         //Malformed extension?
+         if(ntohs(extension->length) != 1)
+            return ERROR_DECODING_FAILED;
+
+         //The server must echo the value requested by the client
+         if(extension->value[0] < TLS_MAX_FRAG_LENGTH_512 ||
+            extension->value[0] > TLS_MAX_FRAG_LENGTH_4096 ||
+            (256U << extension->value[0]) != context->maxFragLength)
+         {
+            //Report an error
+            return ERROR_ILLEGAL_PARAMETER;
+         }
+      }
+      else
+      {
+         //The server will use full-sized records
+         context->maxFragLength = TLS_MAX_RECORD_LENGTH;
+      }
+   }
+#endif
+
+#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+   //The server may advertise the size of the largest record it is
+   //willing to receive
+   extension = tlsGetExtension(p, n, TLS_EXT_RECORD_SIZE_LIMIT);
+
+   //RecordSizeLimit extension found?
+   if(extension != NULL)
+   {
+      //Malformed extension?
+      if(ntohs(extension->length) != sizeof(uint16_t))
+         return ERROR_DECODING_FAILED;
+      //Endpoints must not advertise a limit smaller than 64 bytes
+      if(LOAD16BE(extension->value) < 64)
+         return ERROR_ILLEGAL_PARAMETER;
+
+      //Records sent to the server cannot exceed the advertised limit
+      context->recordSizeLimit = min(LOAD16BE(extension->value), TLS_MAX_RECORD_LENGTH);
+   }
+#endif
+
    //Server version
    TRACE_DEBUG("  serverVersion = 0x%04X (%s)\r\n", ntohs(message->serverVersion),
       tlsGetVersionName(ntohs(message->serverVersion)));
@@ -1050,6 +1552,10 @@ error_t tlsParseServerHello(TlsContext *context, const TlsServerHello *message,
    {
       //Perform a full handshake
       context->resume = FALSE;
+#if (TLS_TICKET_SUPPORT == ENABLED)
+      //The server did not accept the ticket
+      context->ticketLength = 0;
+#endif
    }
 
    //Save server random value
@@ -1087,10 +1593,18 @@ error_t tlsParseServerHello(TlsContext *context, const TlsServerHello *message,
    if(context->resume)
    {
       //Derive session keys from the master secret
+      TLS_PROFILE_START(context, TLS_PROFILE_KEY_DERIVATION);
       error = tlsGenerateKeys(context);
+      TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_DERIVATION);
       //Unable to generate key material?
       if(error) return error;
 
+#if (TLS_TICKET_SUPPORT == ENABLED)
+      //The server may renew the ticket of a resumed session
+      if(context->newSessionTicket)
+         context->state = TLS_STATE_NEW_SESSION_TICKET;
+      else
+#endif
       //At this point, both client and server must send ChangeCipherSpec
       //messages and proceed directly to Finished messages
       context->state = TLS_STATE_SERVER_CHANGE_CIPHER_SPEC;
@@ -1126,7 +1640,7 @@ error_t tlsParseServerHello(TlsContext *context, const TlsServerHello *message,
 error_t tlsParseServerKeyExchange(TlsContext *context, const TlsServerKeyExchange *message, size_t length)
 {
    error_t error;
-   uint_t n;
+   size_t n;
    const uint8_t *p;
 
    //Debug message
@@ -1144,17 +1658,17 @@ error_t tlsParseServerKeyExchange(TlsContext *context, const TlsServerKeyExchang
    //Update the hash value with the incoming handshake message
    tlsUpdateHandshakeHash(context, message, length);
 
+   //Point to the server's key exchange parameters
+   p = message->params;
+   //Remaining bytes to process
+   length -= sizeof(TlsServerKeyExchange);
+
 #if (TLS_DHE_RSA_SUPPORT == ENABLED || TLS_DHE_DSS_SUPPORT == ENABLED || TLS_DH_ANON_SUPPORT == ENABLED)
    //Diffie-Hellman key exchange method?
    if(context->keyExchMethod == TLS_KEY_EXCH_DHE_RSA ||
       context->keyExchMethod == TLS_KEY_EXCH_DHE_DSS ||
       context->keyExchMethod == TLS_KEY_EXCH_DH_ANON)
    {
-      //Point to the server's key exchange parameters
-      p = message->params;
-      //Remaining bytes to process
-      length -= sizeof(TlsServerKeyExchange);
-
       //Convert the prime modulus to a multiple precision integer
       error = tlsReadMpi(&context->dhParameters.p, p, length, &n);
       //Any error to report?
@@ -1190,8 +1704,11 @@ error_t tlsParseServerKeyExchange(TlsContext *context, const TlsServerKeyExchang
       //Weak public value?
       if(error) return error;
 
-      //Save the length of the server's Diffie-Hellman parameters
-      n = p - message->params;
+      //The same prime modulus is used to generate our key pair and
+      //to compute the shared secret
+      error = dhPrecomputeParameters(&context->dhParameters);
+      //Any error to report?
+      if(error) return error;
 
       //Debug message
       TRACE_DEBUG("Diffie-Hellman parameters:\r\n");
@@ -1201,177 +1718,292 @@ error_t tlsParseServerKeyExchange(TlsContext *context, const TlsServerKeyExchang
       TRACE_DEBUG_MPI("    ", &context->dhParameters.g);
       TRACE_DEBUG("  Server public value:\r\n");
       TRACE_DEBUG_MPI("    ", &context->dhParameters.yb);
+   }
+   else
+#endif
+#if (TLS_ECDHE_RSA_SUPPORT == ENABLED || TLS_ECDHE_ECDSA_SUPPORT == ENABLED)
+   //ECDH key exchange method?
+   if(context->keyExchMethod == TLS_KEY_EXCH_ECDHE_RSA ||
+      context->keyExchMethod == TLS_KEY_EXCH_ECDHE_ECDSA)
+   {
+      const EcCurveInfo *curveInfo;
 
-#if (TLS_DHE_RSA_SUPPORT == ENABLED || TLS_DHE_DSS_SUPPORT == ENABLED)
-      //For non-anonymous Diffie-Hellman key exchanges, the signature
-      //over the server's key exchange parameters shall be verified
-      if(context->keyExchMethod == TLS_KEY_EXCH_DHE_RSA ||
-         context->keyExchMethod == TLS_KEY_EXCH_DHE_DSS)
-      {
+      //The ECParameters structure is made of the curve type and the named curve
+      if(length < 3)
+         return ERROR_DECODING_FAILED;
+      //Only named curves are supported (explicit curves are deprecated)
+      if(p[0] != TLS_EC_CURVE_TYPE_NAMED_CURVE)
+         return ERROR_ILLEGAL_PARAMETER;
+
+      //Retrieve the curve selected by the server
+      context->namedCurve = LOAD16BE(p + 1);
+      //The server must pick one of the curves offered in the ClientHello
+      curveInfo = tlsGetCurveInfo(context->namedCurve);
+      //Unsupported elliptic curve?
+      if(curveInfo == NULL)
+         return ERROR_ILLEGAL_PARAMETER;
+
+      //Load EC domain parameters
+      error = ecLoadDomainParameters(&context->ecdhContext.params, curveInfo);
+      //Any error to report?
+      if(error) return error;
+
+      //Advance data pointer
+      p += 3;
+      //Remaining bytes to process
+      length -= 3;
+
+      //Read the server's ephemeral ECDH public value
+      error = tlsReadEcPoint(&context->ecdhContext, p, length, &n);
+      //Invalid point?
+      if(error) return error;
+
+      //Advance data pointer
+      p += n;
+      //Remaining bytes to process
+      length -= n;
+
+      //Debug message
+      TRACE_DEBUG("ECDH parameters (%s):\r\n", curveInfo->name);
+      TRACE_DEBUG("  Server public value:\r\n");
+      TRACE_DEBUG_MPI("    ", &context->ecdhContext.qb.x);
+   }
+   else
+#endif
+   //Invalid key exchange method?
+   {
+      //It is not legal to send the ServerKeyExchange message when a key
+      //exchange method other than DHE_DSS, DHE_RSA, DH_anon, ECDHE_RSA
+      //and ECDHE_ECDSA is selected
+      return ERROR_UNEXPECTED_MESSAGE;
+   }
+
+   //Save the length of the server's key exchange parameters
+   n = p - message->params;
+
+   //For non-anonymous key exchanges, the signature over the server's key
+   //exchange parameters shall be verified
+   if(context->keyExchMethod != TLS_KEY_EXCH_DH_ANON)
+   {
 #if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_1)
-         //SSL 3.0, TLS 1.0 or TLS 1.1 currently selected?
-         if(context->version <= TLS_VERSION_1_1)
+      //SSL 3.0, TLS 1.0 or TLS 1.1 currently selected?
+      if(context->version <= TLS_VERSION_1_1)
+      {
+         //Point to the digitally-signed element
+         TlsDigitalSignature *signature = (TlsDigitalSignature *) p;
+
+         //Check the length of the digitally-signed element
+         if(length < sizeof(TlsDigitalSignature))
+            return ERROR_DECODING_FAILED;
+         if(length < (sizeof(TlsDigitalSignature) + ntohs(signature->length)))
+            return ERROR_DECODING_FAILED;
+
+#if (TLS_DHE_RSA_SUPPORT == ENABLED || TLS_ECDHE_RSA_SUPPORT == ENABLED)
+         //Check whether DHE_RSA or ECDHE_RSA key exchange method is currently used
+         if(context->keyExchMethod == TLS_KEY_EXCH_DHE_RSA ||
+            context->keyExchMethod == TLS_KEY_EXCH_ECDHE_RSA)
          {
-            //Point to the digitally-signed element
-            TlsDigitalSignature *signature = (TlsDigitalSignature *) p;
+            Md5Context *md5Context;
+            Sha1Context *sha1Context;
 
-            //Check the length of the digitally-signed element
-            if(length < sizeof(TlsDigitalSignature))
-               return ERROR_DECODING_FAILED;
-            if(length < (sizeof(TlsDigitalSignature) + ntohs(signature->length)))
-               return ERROR_DECODING_FAILED;
+            //Allocate a memory buffer to hold the MD5 context
+            md5Context = osMemAlloc(sizeof(Md5Context));
+            //Failed to allocate memory?
+            if(!md5Context) return ERROR_OUT_OF_MEMORY;
 
-#if (TLS_DHE_RSA_SUPPORT == ENABLED)
-            //Check whether DHE_RSA key exchange method is currently used
-            if(context->keyExchMethod == TLS_KEY_EXCH_DHE_RSA)
-            {
-               Md5Context *md5Context;
-               Sha1Context *sha1Context;
-
-               //Allocate a memory buffer to hold the MD5 context
-               md5Context = osMemAlloc(sizeof(Md5Context));
-               //Failed to allocate memory?
-               if(!md5Context) return ERROR_OUT_OF_MEMORY;
-
-               //Compute MD5(ClientHello.random + ServerHello.random + ServerDhParams)
-               md5Init(md5Context);
-               md5Update(md5Context, context->random, 64);
-               md5Update(md5Context, message->params, n);
-               md5Final(md5Context, context->verifyData);
-               //Release previously allocated memory
-               osMemFree(md5Context);
-
-               //Allocate a memory buffer to hold the SHA-1 context
-               sha1Context = osMemAlloc(sizeof(Sha1Context));
-               //Failed to allocate memory?
-               if(!sha1Context) return ERROR_OUT_OF_MEMORY;
-
-               //Compute SHA(ClientHello.random + ServerHello.random + ServerDhParams)
-               sha1Init(sha1Context);
-               sha1Update(sha1Context, context->random, 64);
-               sha1Update(sha1Context, message->params, n);
-               sha1Final(sha1Context, context->verifyData + MD5_DIGEST_SIZE);
-               //Release previously allocated memory
-               osMemFree(sha1Context);
-
-               //RSA signature verification
-               error = tlsVerifyRsaSignature(&context->peerRsaPublicKey,
-                  context->verifyData, signature->value, ntohs(signature->length));
-            }
-            else
+            //Compute MD5(ClientHello.random + ServerHello.random + ServerParams)
+            md5Init(md5Context);
+            md5Update(md5Context, context->random, 64);
+            md5Update(md5Context, message->params, n);
+            md5Final(md5Context, context->verifyData);
+            //Release previously allocated memory
+            osMemFree(md5Context);
+
+            //Allocate a memory buffer to hold the SHA-1 context
+            sha1Context = osMemAlloc(sizeof(Sha1Context));
+            //Failed to allocate memory?
+            if(!sha1Context) return ERROR_OUT_OF_MEMORY;
+
+            //Compute SHA(ClientHello.random + ServerHello.random + ServerParams)
+            sha1Init(sha1Context);
+            sha1Update(sha1Context, context->random, 64);
+            sha1Update(sha1Context, message->params, n);
+            sha1Final(sha1Context, context->verifyData + MD5_DIGEST_SIZE);
+            //Release previously allocated memory
+            osMemFree(sha1Context);
+
+            //RSA signature verification
+            error = tlsVerifyRsaSignature(&context->peerRsaPublicKey,
+               context->verifyData, signature->value, ntohs(signature->length));
+         }
+         else
 #endif
+#if (TLS_DHE_DSS_SUPPORT == ENABLED || TLS_ECDHE_ECDSA_SUPPORT == ENABLED)
+         //Check whether DHE_DSS or ECDHE_ECDSA key exchange method is currently used
+         if(context->keyExchMethod == TLS_KEY_EXCH_DHE_DSS ||
+            context->keyExchMethod == TLS_KEY_EXCH_ECDHE_ECDSA)
+         {
+            //Allocate a memory buffer to hold the SHA-1 context
+            Sha1Context *sha1Context = osMemAlloc(sizeof(Sha1Context));
+            //Failed to allocate memory?
+            if(!sha1Context) return ERROR_OUT_OF_MEMORY;
+
+            //Compute SHA(ClientHello.random + ServerHello.random + ServerParams)
+            sha1Init(sha1Context);
+            sha1Update(sha1Context, context->random, 64);
+            sha1Update(sha1Context, message->params, n);
+            sha1Final(sha1Context, NULL);
+
 #if (TLS_DHE_DSS_SUPPORT == ENABLED)
-            //Check whether DHE_DSS key exchange method is currently used
+            //DSA signature?
             if(context->keyExchMethod == TLS_KEY_EXCH_DHE_DSS)
             {
-               //Allocate a memory buffer to hold the SHA-1 context
-               Sha1Context *sha1Context = osMemAlloc(sizeof(Sha1Context));
-               //Failed to allocate memory?
-               if(!sha1Context) return ERROR_OUT_OF_MEMORY;
-
-               //Compute SHA(ClientHello.random + ServerHello.random + ServerDhParams)
-               sha1Init(sha1Context);
-               sha1Update(sha1Context, context->random, 64);
-               sha1Update(sha1Context, message->params, n);
-               sha1Final(sha1Context, NULL);
-
                //DSA signature verification
                error = tlsVerifyDsaSignature(&context->peerDsaPublicKey, sha1Context->digest,
                   SHA1_DIGEST_SIZE, signature->value, ntohs(signature->length));
-
-               //Release previously allocated memory
-               osMemFree(sha1Context);
             }
             else
 #endif
-            //Invalid signature algorithm?
+#if (TLS_ECDHE_ECDSA_SUPPORT == ENABLED)
+            //ECDSA signature?
+            if(context->peerCertType == TLS_CERT_ECDSA_SIGN)
+            {
+               //ECDSA signature verification
+               error = tlsVerifyEcdsaSignature(&context->peerEcParams, &context->peerEcPublicKey,
+                  sha1Context->digest, SHA1_DIGEST_SIZE, signature->value, ntohs(signature->length));
+            }
+            else
+#endif
+            //The server's certificate does not match the key exchange method?
             {
                //Report an error
                error = ERROR_UNSUPPORTED_SIGNATURE_ALGO;
             }
+
+            //Release previously allocated memory
+            osMemFree(sha1Context);
          }
          else
 #endif
-#if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
-         //TLS 1.2 currently selected?
-         if(context->version == TLS_VERSION_1_2)
+         //Invalid signature algorithm?
          {
-            const HashAlgo *hashAlgo;
-            HashContext *hashContext;
-
-            //Point to the digitally-signed element
-            TlsDigitalSignature2 *signature = (TlsDigitalSignature2 *) p;
+            //Report an error
+            error = ERROR_UNSUPPORTED_SIGNATURE_ALGO;
+         }
+      }
+      else
+#endif
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+      //TLS 1.2 currently selected?
+      if(context->version == TLS_VERSION_1_2)
+      {
+         const HashAlgo *hashAlgo;
+         HashContext *hashContext;
 
-            //Check the length of the digitally-signed element
-            if(length < sizeof(TlsDigitalSignature2))
-               return ERROR_DECODING_FAILED;
-            if(length < (sizeof(TlsDigitalSignature2) + ntohs(signature->length)))
-               return ERROR_DECODING_FAILED;
+         //Point to the digitally-signed element
+         TlsDigitalSignature2 *signature = (TlsDigitalSignature2 *) p;
 
-            //Retrieve the hash algorithm used for signing
-            hashAlgo = tlsGetHashAlgo(signature->algorithm.hash);
-            //Hash algorithm not supported?
-            if(!hashAlgo) return ERROR_INVALID_SIGNATURE;
+         //Check the length of the digitally-signed element
+         if(length < sizeof(TlsDigitalSignature2))
+            return ERROR_DECODING_FAILED;
+         if(length < (sizeof(TlsDigitalSignature2) + ntohs(signature->length)))
+            return ERROR_DECODING_FAILED;
 
-            //Allocate a memory buffer to hold the hash context
-            hashContext = osMemAlloc(hashAlgo->contextSize);
-            //Failed to allocate memory?
-            if(!hashContext) return ERROR_OUT_OF_MEMORY;
-
-            //Compute SHA(ClientHello.random + ServerHello.random + ServerDhParams)
-            hashAlgo->init(hashContext);
-            hashAlgo->update(hashContext, context->random, 64);
-            hashAlgo->update(hashContext, message->params, n);
-            hashAlgo->final(hashContext, NULL);
-
-#if (TLS_DHE_RSA_SUPPORT == ENABLED)
-            //Check whether DHE_RSA key exchange method is currently used
-            if(context->keyExchMethod == TLS_KEY_EXCH_DHE_RSA &&
-               signature->algorithm.signature == TLS_SIGN_ALGO_RSA)
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+         //RSASSA-PSS signature schemes imply their hash algorithm
+         if(signature->algorithm.hash == TLS_HASH_ALGO_INTRINSIC)
+         {
+            if(signature->algorithm.signature >= TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA256 &&
+               signature->algorithm.signature <= TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA512)
             {
-               //Use the signature verification algorithm defined in PKCS #1 v1.5
-               error = rsassaPkcs1v15Verify(&context->peerRsaPublicKey, hashAlgo,
-                  hashContext->digest, signature->value, ntohs(signature->length));
+               hashAlgo = tlsGetPssHashAlgo(signature->algorithm.signature);
             }
             else
-#endif
-#if (TLS_DHE_DSS_SUPPORT == ENABLED)
-            //Check whether DHE_DSS key exchange method is currently used
-            if(context->keyExchMethod == TLS_KEY_EXCH_DHE_DSS &&
-               signature->algorithm.signature == TLS_SIGN_ALGO_DSA)
             {
-               //DSA signature verification
-               error = tlsVerifyDsaSignature(&context->peerDsaPublicKey, hashContext->digest,
-                  hashAlgo->digestSize, signature->value, ntohs(signature->length));
+               hashAlgo = NULL;
             }
-            else
+         }
+         else
 #endif
-            //Invalid signature algorithm?
-            {
-               //Report an error
-               error = ERROR_UNSUPPORTED_SIGNATURE_ALGO;
-            }
-
-            //Release previously allocated memory
-            osMemFree(hashContext);
-
+         //Retrieve the hash algorithm used for signing
+         hashAlgo = tlsGetHashAlgo(signature->algorithm.hash);
+         //Hash algorithm not supported?
+         if(!hashAlgo) return ERROR_INVALID_SIGNATURE;
+
+         //Allocate a memory buffer to hold the hash context
+         hashContext = osMemAlloc(hashAlgo->contextSize);
+         //Failed to allocate memory?
+         if(!hashContext) return ERROR_OUT_OF_MEMORY;
+
+         //Compute SHA(ClientHello.random + ServerHello.random + ServerParams)
+         hashAlgo->init(hashContext);
+         hashAlgo->update(hashContext, context->random, 64);
+         hashAlgo->update(hashContext, message->params, n);
+         hashAlgo->final(hashContext, NULL);
+
+#if (TLS_DHE_RSA_SUPPORT == ENABLED || TLS_ECDHE_RSA_SUPPORT == ENABLED)
+         //Check whether DHE_RSA or ECDHE_RSA key exchange method is currently used
+         if((context->keyExchMethod == TLS_KEY_EXCH_DHE_RSA ||
+            context->keyExchMethod == TLS_KEY_EXCH_ECDHE_RSA) &&
+            signature->algorithm.signature == TLS_SIGN_ALGO_RSA)
+         {
+            //Use the signature verification algorithm defined in PKCS #1 v1.5
+            error = rsassaPkcs1v15Verify(&context->peerRsaPublicKey, hashAlgo,
+               hashContext->digest, signature->value, ntohs(signature->length));
+         }
+         else
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+         //Check whether an RSASSA-PSS signature scheme is used
+         if((context->keyExchMethod == TLS_KEY_EXCH_DHE_RSA ||
+            context->keyExchMethod == TLS_KEY_EXCH_ECDHE_RSA) &&
+            signature->algorithm.hash == TLS_HASH_ALGO_INTRINSIC)
+         {
+            //The length of the salt is equal to the length of the digest
+            error = rsassaPssVerify(&context->peerRsaPublicKey, hashAlgo,
+               hashAlgo->digestSize, hashContext->digest, signature->value,
+               ntohs(signature->length));
          }
          else
 #endif
+#endif
+#if (TLS_DHE_DSS_SUPPORT == ENABLED)
+         //Check whether DHE_DSS key exchange method is currently used
+         if(context->keyExchMethod == TLS_KEY_EXCH_DHE_DSS &&
+            signature->algorithm.signature == TLS_SIGN_ALGO_DSA)
          {
-            //The negotiated TLS version is not valid
-            error = ERROR_INVALID_VERSION;
+            //DSA signature verification
+            error = tlsVerifyDsaSignature(&context->peerDsaPublicKey, hashContext->digest,
+               hashAlgo->digestSize, signature->value, ntohs(signature->length));
          }
-      }
+         else
 #endif
-   }
-   else
+#if (TLS_ECDHE_ECDSA_SUPPORT == ENABLED)
+         //Check whether ECDHE_ECDSA key exchange method is currently used
+         if(context->keyExchMethod == TLS_KEY_EXCH_ECDHE_ECDSA &&
+            context->peerCertType == TLS_CERT_ECDSA_SIGN &&
+            signature->algorithm.signature == TLS_SIGN_ALGO_ECDSA)
+         {
+            //ECDSA signature verification
+            error = tlsVerifyEcdsaSignature(&context->peerEcParams, &context->peerEcPublicKey,
+               hashContext->digest, hashAlgo->digestSize, signature->value, ntohs(signature->length));
+         }
+         else
 #endif
-   //Invalid key exchange method?
-   {
-      //It is not legal to send the ServerKeyExchange message when a key
-      //exchange method other than DHE_DSS, DHE_RSA and DH_anon is selected
-      error = ERROR_UNEXPECTED_MESSAGE;
+         //Invalid signature algorithm?
+         {
+            //Report an error
+            error = ERROR_UNSUPPORTED_SIGNATURE_ALGO;
+         }
+
+         //Release previously allocated memory
+         osMemFree(hashContext);
+      }
+      else
+#endif
+      {
+         //The negotiated TLS version is not valid
+         error = ERROR_INVALID_VERSION;
+      }
    }
 
    //Prepare to decode a CertificateRequest or a ServerHelloDone message
@@ -1508,7 +2140,7 @@ error_t tlsParseCertificateRequest(TlsContext *context, const TlsCertificateRequ
          //The hash and signature algorithms used in the signature of the
          //CertificateVerify message must be one of those present in the
          //SupportedSignatureAlgorithms field
-         if(tlsSelectSignHashAlgo(context, context->certs[i].signAlgo, supportedSignAlgos))
+         if(tlsSelectSignHashAlgo(context, tlsGetSignAlgo(context->certs[i].type), supportedSignAlgos))
             acceptable = FALSE;
       }
 #endif
@@ -1570,4 +2202,133 @@ error_t tlsParseServerHelloDone(TlsContext *context, const TlsServerHelloDone *m
    return NO_ERROR;
 }
 
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+
+/**
+ * @brief Parse NewSessionTicket message
+ *
+ * The NewSessionTicket message carries a ticket that the client
+ * presents later on to resume the session without any session
+ * state being kept by the server
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] message Incoming NewSessionTicket message to parse
+ * @param[in] length Message length
+ * @return Error code
+ **/
+
+error_t tlsParseNewSessionTicket(TlsContext *context, const TlsNewSessionTicket *message, size_t length)
+{
+   size_t n;
+
+   //Debug message
+   TRACE_INFO("NewSessionTicket message received (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //Check the length of the NewSessionTicket message
+   if(length < sizeof(TlsNewSessionTicket))
+      return ERROR_DECODING_FAILED;
+
+   //Check current state
+   if(context->state != TLS_STATE_NEW_SESSION_TICKET)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //Get the length of the ticket
+   n = ntohs(message->ticketLength);
+
+   //Malformed NewSessionTicket message?
+   if(length != (sizeof(TlsNewSessionTicket) + n))
+      return ERROR_DECODING_FAILED;
+
+   //The ticket is opaque to the client. Tickets that do not
+   //fit in the buffer are silently discarded
+   if(n <= TLS_MAX_TICKET_SIZE)
+   {
+      //Save the ticket
+      memcpy(context->ticket, message->ticket, n);
+      context->ticketLength = n;
+      //Number of seconds the ticket may be stored
+      context->ticketLifetime = ntohl(message->ticketLifetimeHint);
+   }
+   else
+   {
+      //The session cannot be resumed
+      context->ticketLength = 0;
+   }
+
+   //Update the hash value with the incoming handshake message
+   tlsUpdateHandshakeHash(context, message, length);
+
+   //Prepare to receive a ChangeCipherSpec message...
+   context->state = TLS_STATE_SERVER_CHANGE_CIPHER_SPEC;
+   //Successful processing
+   return NO_ERROR;
+}
+
+#endif
+
+
+/**
+ * @brief Check whether False Start can be used (RFC 7918)
+ *
+ * The client may send application data once its Finished message has been
+ * sent, provided that the application has opted in, the handshake is a full
+ * one, the key exchange offers forward secrecy and the negotiated cipher
+ * suite uses an AEAD cipher
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return TRUE if application data may be sent before the server's Finished
+ *   message, else FALSE
+ **/
+
+bool_t tlsIsFalseStartAllowed(const TlsContext *context)
+{
+#if (TLS_FALSE_START_SUPPORT == ENABLED)
+   //False Start must be explicitly enabled by the application
+   if(!context->falseStartEnabled)
+      return FALSE;
+#else
+   //False Start is not supported
+   return FALSE;
+#endif
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //False Start is only defined for TLS 1.2 and earlier versions
+   if(context->version >= TLS_VERSION_1_3)
+      return FALSE;
+#endif
+
+   //An abbreviated handshake ends with the client's Finished message
+   if(context->resume)
+      return FALSE;
+
+   //The client must be waiting for the last flight of the server
+   if(context->state != TLS_STATE_NEW_SESSION_TICKET &&
+      context->state != TLS_STATE_SERVER_CHANGE_CIPHER_SPEC)
+   {
+      return FALSE;
+   }
+
+   //The key exchange must provide forward secrecy
+   if(context->keyExchMethod != TLS_KEY_EXCH_DHE_RSA &&
+      context->keyExchMethod != TLS_KEY_EXCH_DHE_DSS &&
+      context->keyExchMethod != TLS_KEY_EXCH_ECDHE_RSA &&
+      context->keyExchMethod != TLS_KEY_EXCH_ECDHE_ECDSA)
+   {
+      return FALSE;
+   }
+
+   //Only AEAD ciphers are acceptable
+   if(context->cipherMode != CIPHER_MODE_CCM &&
+      context->cipherMode != CIPHER_MODE_GCM &&
+      context->cipherMode != CIPHER_MODE_CHACHA20_POLY1305)
+   {
+      return FALSE;
+   }
+
+   //False Start can be used
+   return TRUE;
+}
+
 #endif
@@ -44,5 +44,8 @@ error_t tlsParseServerHello(TlsContext *context, const TlsServerHello *message,
 error_t tlsParseServerKeyExchange(TlsContext *context, const TlsServerKeyExchange *message, size_t length);
 error_t tlsParseCertificateRequest(TlsContext *context, const TlsCertificateRequest *message, size_t length);
 error_t tlsParseServerHelloDone(TlsContext *context, const TlsServerHelloDone *message, size_t length);
+error_t tlsParseNewSessionTicket(TlsContext *context, const TlsNewSessionTicket *message, size_t length);
+
+bool_t tlsIsFalseStartAllowed(const TlsContext *context);
 
 #endif
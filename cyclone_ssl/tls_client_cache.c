@@ -0,0 +1,416 @@
+/**
+ * @file tls_client_cache.c
+ * @brief Client-side session cache
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Resuming a session requires the client to offer the identifier (or the
+ * ticket) of a previous session with the same server. Rather than relying
+ * on each application to save and restore its sessions, client contexts
+ * look up the session of the server they connect to, identified by its
+ * name and port, before sending the ClientHello message. The session is
+ * recorded again once the handshake completes. The most recently created
+ * cache is used by default by all the client contexts, so that protocols
+ * opening a new TLS context for each connection benefit from session
+ * resumption without any change
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_client_cache.h"
+#include "debug.h"
+
+//Check SSL library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_CLIENT_SUPPORT == ENABLED && \
+   TLS_CLIENT_CACHE_SUPPORT == ENABLED)
+
+//Default client-side session cache
+TlsClientCache *tlsDefaultClientCache = NULL;
+
+//Client-side session cache related local functions
+static error_t tlsClientCacheGetKey(TlsContext *context, char_t *host, uint16_t *port);
+static TlsClientCacheEntry *tlsClientCacheLookup(TlsClientCache *clientCache,
+   const char_t *host, uint16_t port);
+
+
+/**
+ * @brief Client-side session cache initialization
+ *
+ * The newly created cache becomes the default cache of the client
+ * contexts that are initialized afterwards
+ *
+ * @param[in] size Maximum number of cache entries
+ * @return Handle referencing the fully initialized session cache
+ **/
+
+TlsClientCache *tlsInitClientCache(uint_t size)
+{
+   size_t n;
+   TlsClientCache *clientCache;
+
+   //Make sure the parameter is acceptable
+   if(size < 1)
+      return NULL;
+
+   //Size of the memory required
+   n = sizeof(TlsClientCache) + size * sizeof(TlsClientCacheEntry);
+
+   //Allocate a memory buffer to hold the session cache
+   clientCache = osMemAlloc(n);
+   //Failed to allocate memory?
+   if(clientCache == NULL) return NULL;
+
+   //Clear memory
+   memset(clientCache, 0, n);
+
+   //Create a mutex to prevent simultaneous access to the cache
+   clientCache->mutex = osMutexCreateNamed(FALSE, "TlsClientCache");
+
+   //Out of ressources?
+   if(clientCache->mutex == OS_INVALID_HANDLE)
+   {
+      //Clean up side effects
+      osMemFree(clientCache);
+      //Report an error
+      return NULL;
+   }
+
+   //Save the maximum number of cache entries
+   clientCache->size = size;
+
+   //Client contexts will use this cache by default
+   tlsDefaultClientCache = clientCache;
+
+   //Return a pointer to the newly created cache
+   return clientCache;
+}
+
+
+/**
+ * @brief Restore the last session established with the server
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsRestoreFromClientCache(TlsContext *context)
+{
+   error_t error;
+   uint16_t port;
+   char_t host[TLS_CLIENT_CACHE_MAX_HOST_LEN + 1];
+   TlsClientCacheEntry *entry;
+
+   //Check whether the client-side session cache is used
+   if(context->clientCache == NULL)
+      return ERROR_FAILURE;
+
+   //Identify the server
+   error = tlsClientCacheGetKey(context, host, &port);
+   //The session cannot be looked up?
+   if(error) return error;
+
+   //Acquire exclusive access to the cache
+   osMutexAcquire(context->clientCache->mutex);
+
+   //Search the cache for the specified server
+   entry = tlsClientCacheLookup(context->clientCache, host, port);
+
+   //Any matching entry?
+   if(entry != NULL)
+   {
+      //Keep track of the last use of the entry
+      entry->lastUsed = osGetTickCount();
+      //Restore session parameters
+      error = tlsRestoreSession(context, &entry->session);
+   }
+   else
+   {
+      //No session can be resumed
+      error = ERROR_NOT_FOUND;
+   }
+
+   //Release exclusive access to the cache
+   osMutexRelease(context->clientCache->mutex);
+
+   //Debug message
+   if(!error)
+      TRACE_INFO("Resuming session with %s:%u...\r\n", host, port);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Record the session established with the server
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsSaveToClientCache(TlsContext *context)
+{
+   error_t error;
+   uint_t i;
+   time_t time;
+   uint16_t port;
+   char_t host[TLS_CLIENT_CACHE_MAX_HOST_LEN + 1];
+   TlsClientCache *clientCache;
+   TlsClientCacheEntry *entry;
+
+   //Point to the client-side session cache
+   clientCache = context->clientCache;
+
+   //Check whether the client-side session cache is used
+   if(clientCache == NULL)
+      return ERROR_FAILURE;
+
+   //Identify the server
+   error = tlsClientCacheGetKey(context, host, &port);
+   //The session cannot be recorded?
+   if(error) return error;
+
+   //Get current time
+   time = osGetTickCount();
+
+   //Acquire exclusive access to the cache
+   osMutexAcquire(clientCache->mutex);
+
+   //Only the last session established with a given server is kept
+   entry = tlsClientCacheLookup(clientCache, host, port);
+
+   //No existing entry?
+   if(entry == NULL)
+   {
+      //Loop through the cache entries
+      for(i = 0; i < clientCache->size; i++)
+      {
+         //Unused entry found?
+         if(!clientCache->entries[i].valid)
+         {
+            //Use this entry
+            entry = &clientCache->entries[i];
+            break;
+         }
+
+         //Keep track of the least recently used entry
+         if(entry == NULL || (time - clientCache->entries[i].lastUsed) >
+            (time - entry->lastUsed))
+         {
+            entry = &clientCache->entries[i];
+         }
+      }
+   }
+
+   //Save session parameters
+   error = tlsSaveSession(context, &entry->session);
+
+   //Check status code
+   if(!error)
+   {
+      //Index the session by server name and port
+      strcpy(entry->host, host);
+      entry->port = port;
+      entry->lastUsed = time;
+      entry->valid = TRUE;
+   }
+   else
+   {
+      //The session cannot be resumed
+      memset(entry, 0, sizeof(TlsClientCacheEntry));
+   }
+
+   //Release exclusive access to the cache
+   osMutexRelease(clientCache->mutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Forget the session established with the server
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsRemoveFromClientCache(TlsContext *context)
+{
+   error_t error;
+   uint16_t port;
+   char_t host[TLS_CLIENT_CACHE_MAX_HOST_LEN + 1];
+   TlsClientCacheEntry *entry;
+
+   //Check whether the client-side session cache is used
+   if(context->clientCache == NULL)
+      return;
+
+   //Identify the server
+   error = tlsClientCacheGetKey(context, host, &port);
+   //Unknown server?
+   if(error) return;
+
+   //Acquire exclusive access to the cache
+   osMutexAcquire(context->clientCache->mutex);
+
+   //Search the cache for the specified server
+   entry = tlsClientCacheLookup(context->clientCache, host, port);
+
+   //Clear the matching entry, if any
+   if(entry != NULL)
+      memset(entry, 0, sizeof(TlsClientCacheEntry));
+
+   //Release exclusive access to the cache
+   osMutexRelease(context->clientCache->mutex);
+}
+
+
+/**
+ * @brief Release client-side session cache
+ * @param[in] clientCache Pointer to the session cache
+ **/
+
+void tlsFreeClientCache(TlsClientCache *clientCache)
+{
+   //Invalid session cache?
+   if(clientCache == NULL)
+      return;
+
+   //The cache can no more be used by new client contexts
+   if(tlsDefaultClientCache == clientCache)
+      tlsDefaultClientCache = NULL;
+
+   //Release previously allocated ressources
+   osMutexClose(clientCache->mutex);
+
+   //Clear the session cache before freeing memory
+   memset(clientCache, 0, sizeof(TlsClientCache) +
+      clientCache->size * sizeof(TlsClientCacheEntry));
+   osMemFree(clientCache);
+}
+
+
+/**
+ * @brief Retrieve the name and the port of the server
+ * @param[in] context Pointer to the TLS context
+ * @param[out] host Server name (or IP address if no name has been set)
+ * @param[out] port Server port
+ * @return Error code
+ **/
+
+static error_t tlsClientCacheGetKey(TlsContext *context, char_t *host, uint16_t *port)
+{
+#if (TLS_BSD_SOCKET_SUPPORT == ENABLED)
+   struct sockaddr_in addr;
+   socklen_t length;
+
+   //Sessions are indexed by server name
+   if(context->serverName == NULL)
+      return ERROR_FAILURE;
+
+   //The port number is located at the same offset in IPv4
+   //and IPv6 socket addresses
+   length = sizeof(addr);
+
+   //Retrieve the address of the server
+   if(getpeername(context->socket, (struct sockaddr *) &addr, &length))
+      return ERROR_FAILURE;
+
+   //Save the port number
+   *port = ntohs(addr.sin_port);
+#else
+   //Make sure the socket is valid
+   if(context->socket == NULL)
+      return ERROR_FAILURE;
+
+   //Save the port number
+   *port = context->socket->remotePort;
+
+   //No server name has been specified?
+   if(context->serverName == NULL)
+   {
+      //The server is identified by its IP address
+      ipAddrToString(&context->socket->remoteIpAddr, host);
+      //Successful processing
+      return NO_ERROR;
+   }
+#endif
+
+   //Check the length of the server name
+   if(strlen(context->serverName) > TLS_CLIENT_CACHE_MAX_HOST_LEN)
+      return ERROR_FAILURE;
+
+   //Copy the server name
+   strcpy(host, context->serverName);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Search the cache for a given server
+ * @param[in] clientCache Pointer to the session cache
+ * @param[in] host Server name
+ * @param[in] port Server port
+ * @return Pointer to the matching entry, if any
+ **/
+
+static TlsClientCacheEntry *tlsClientCacheLookup(TlsClientCache *clientCache,
+   const char_t *host, uint16_t port)
+{
+   uint_t i;
+   TlsClientCacheEntry *entry;
+
+   //Loop through the cache entries
+   for(i = 0; i < clientCache->size; i++)
+   {
+      //Point to the current entry
+      entry = &clientCache->entries[i];
+
+      //Skip unused entries
+      if(!entry->valid)
+         continue;
+
+      //Outdated entry?
+      if((osGetTickCount() - entry->session.timestamp) >= TLS_SESSION_CACHE_LIFETIME)
+      {
+         //This session is no more valid and should be removed from the cache
+         memset(entry, 0, sizeof(TlsClientCacheEntry));
+         continue;
+      }
+
+      //Matching server?
+      if(entry->port == port && !strcmp(entry->host, host))
+         return entry;
+   }
+
+   //No matching entry
+   return NULL;
+}
+
+#endif
@@ -0,0 +1,45 @@
+/**
+ * @file tls_client_cache.h
+ * @brief Client-side session cache
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _TLS_CLIENT_CACHE_H
+#define _TLS_CLIENT_CACHE_H
+
+//Dependencies
+#include "tls.h"
+
+//Default client-side session cache
+extern TlsClientCache *tlsDefaultClientCache;
+
+//Client-side session cache management
+TlsClientCache *tlsInitClientCache(uint_t size);
+error_t tlsRestoreFromClientCache(TlsContext *context);
+error_t tlsSaveToClientCache(TlsContext *context);
+void tlsRemoveFromClientCache(TlsContext *context);
+void tlsFreeClientCache(TlsClientCache *clientCache);
+
+#endif
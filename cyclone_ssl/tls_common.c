@@ -36,8 +36,12 @@
 #include "tls_cipher_suites.h"
 #include "tls_common.h"
 #include "tls_record.h"
+#include "tls_io.h"
 #include "tls_cache.h"
 #include "tls_misc.h"
+#include "tls_ca_store.h"
+#include "tls_cert_cache.h"
+#include "tls_client_cache.h"
 #include "asn1.h"
 #include "x509.h"
 #include "pem.h"
@@ -57,13 +61,7 @@ error_t tlsSendCertificate(TlsContext *context)
 {
    error_t error;
    bool_t sendCert;
-   uint8_t *p;
    size_t length;
-   const char_t *pemCert;
-   size_t pemCertLength;
-   uint8_t *derCert;
-   size_t derCertSize;
-   size_t derCertLength;
    TlsCertificate *message;
 
    //TLS operates as a client or a server?
@@ -100,68 +98,32 @@ error_t tlsSendCertificate(TlsContext *context)
    //Check whether a Certificate message must be sent
    if(sendCert)
    {
-      //Buffer where to format the message
-      p = context->txBuffer + sizeof(TlsRecord);
-
       //Point to the Certificate message
-      message = (TlsCertificate *) p;
+      message = (TlsCertificate *) (context->txBuffer + sizeof(TlsRecord));
       //Format message header
       message->msgType = TLS_TYPE_CERTIFICATE;
 
-      //Point to the first certificate of the list
-      p = message->certificateList;
-      //Length of the certificate list in bytes
-      length = 0;
-
       //Check whether a certificate is available
       if(context->cert != NULL)
       {
-         //Point to the certificate chain
-         pemCert = context->cert->certChain;
-         //Get the total length, in bytes, of the certificate chain
-         pemCertLength = context->cert->certChainLength;
+         //The certificate list has been DER encoded when the
+         //certificate was loaded
+         length = context->cert->certListLength;
+
+         //Prevent the buffer from overflowing
+         if((length + sizeof(TlsCertificate)) > context->txBufferSize)
+            return ERROR_MESSAGE_TOO_LONG;
+
+         //Copy the certificate list
+         memcpy(message->certificateList, context->cert->certList, length);
       }
       else
       {
          //If no suitable certificate is available, the message
          //contains an empty certificate list
-         pemCert = NULL;
-         pemCertLength = 0;
-      }
-
-      //DER encoded certificate
-      derCert = NULL;
-      derCertSize = 0;
-      derCertLength = 0;
-
-      //Parse the certificate chain
-      while(pemCertLength > 0)
-      {
-         //Decode PEM certificate
-         error = pemReadCertificate(&pemCert, &pemCertLength,
-            &derCert, &derCertSize, &derCertLength);
-         //Any error to report?
-         if(error) break;
-
-         //Total length of the certificate list
-         length += derCertLength + 3;
-
-         //Prevent the buffer from overflowing
-         if((length + sizeof(TlsCertificate)) > TLS_MAX_PROTOCOL_DATA_LENGTH)
-            return ERROR_MESSAGE_TOO_LONG;
-
-         //Each certificate is preceded by a 3-byte length field
-         STORE24BE(derCertLength, p);
-         //Copy the current certificate
-         memcpy(p + 3, derCert, derCertLength);
-
-         //Advance data pointer
-         p += derCertLength + 3;
+         length = 0;
       }
 
-      //Free previously allocated memory
-      osMemFree(derCert);
-
       //A 3-byte length field shall precede the certificate list
       STORE24BE(length, message->certificateListLength);
       //Consider the 3-byte length field
@@ -301,6 +263,12 @@ error_t tlsSendFinished(TlsContext *context)
       //Use abbreviated or full handshake?
       if(context->resume)
          context->state = TLS_STATE_APPLICATION_DATA;
+#if (TLS_TICKET_SUPPORT == ENABLED)
+      //The server sends a NewSessionTicket message before its
+      //ChangeCipherSpec message
+      else if(context->newSessionTicket)
+         context->state = TLS_STATE_NEW_SESSION_TICKET;
+#endif
       else
          context->state = TLS_STATE_SERVER_CHANGE_CIPHER_SPEC;
    }
@@ -332,22 +300,34 @@ error_t tlsSendAlert(TlsContext *context, uint8_t level, uint8_t description)
    size_t length;
    TlsAlert *message;
 
-   //Point to the Alert message
-   message = (TlsAlert *) (context->txBuffer + sizeof(TlsRecord));
-   //Severity of the message
-   message->level = level;
-   //Description of the alert
-   message->description = description;
+   //The TX buffer may still hold the end of the previous record
+   error = tlsIoFlush(context, TRUE);
 
-   //The message of the Alert message
-   length = sizeof(TlsAlert);
+   //Check status code
+   if(!error)
+   {
+      //Point to the Alert message
+      message = (TlsAlert *) (context->txBuffer + sizeof(TlsRecord));
+      //Severity of the message
+      message->level = level;
+      //Description of the alert
+      message->description = description;
 
-   //Debug message
-   TRACE_INFO("Sending Alert message (%u bytes)...\r\n", length);
-   TRACE_INFO_ARRAY("  ", message, length);
+      //The message of the Alert message
+      length = sizeof(TlsAlert);
+
+      //Debug message
+      TRACE_INFO("Sending Alert message (%u bytes)...\r\n", length);
+      TRACE_INFO_ARRAY("  ", message, length);
+
+      //Send Alert message
+      error = tlsWriteProtocolData(context, length, TLS_TYPE_ALERT);
+   }
 
-   //Send Alert message
-   error = tlsWriteProtocolData(context, length, TLS_TYPE_ALERT);
+   //The connection is usually closed right after an alert, so the
+   //message must not be left in the TX buffer
+   if(!error)
+      error = tlsIoFlush(context, TRUE);
 
    //Alert messages with a level of fatal result in the immediate
    //termination of the connection
@@ -356,6 +336,10 @@ error_t tlsSendAlert(TlsContext *context, uint8_t level, uint8_t description)
       //Any connection terminated with a fatal alert must not be resumed
       if(context->entity == TLS_CONNECTION_END_SERVER)
          tlsRemoveFromCache(context);
+#if (TLS_CLIENT_CACHE_SUPPORT == ENABLED)
+      else
+         tlsRemoveFromClientCache(context);
+#endif
 
       //Servers and clients must forget any session identifiers
       memset(context->sessionId, 0, 32);
@@ -392,6 +376,13 @@ error_t tlsParseCertificate(TlsContext *context, const TlsCertificate *message,
    //X.509 certificates
    X509CertificateInfo *certInfo = NULL;
    X509CertificateInfo *issuerCertInfo = NULL;
+   X509CertificateInfo *tempCertInfo;
+   X509Name caSubject;
+
+#if (TLS_CERT_CACHE_SUPPORT == ENABLED)
+   bool_t certCached = FALSE;
+   uint8_t digest[SHA256_DIGEST_SIZE];
+#endif
 
    //Debug message
    TRACE_INFO("Certificate message received (%u bytes)...\r\n", length);
@@ -418,10 +409,33 @@ error_t tlsParseCertificate(TlsContext *context, const TlsCertificate *message,
    //Update the hash value with the incoming handshake message
    tlsUpdateHandshakeHash(context, message, length);
 
+   //Point to the body of the message
+   p = (const uint8_t *) message + sizeof(TlsHandshake);
+   //Remaining bytes to process
+   length -= sizeof(TlsHandshake);
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //TLS 1.3 currently selected?
+   if(context->version == TLS_VERSION_1_3)
+   {
+      //The certificate_request_context field is empty during the handshake
+      if(p[0] != 0)
+         return ERROR_ILLEGAL_PARAMETER;
+
+      //Skip the certificate_request_context field
+      p++;
+      length--;
+   }
+#endif
+
+   //Make sure the length field of the certificate list is present
+   if(length < 3)
+      return ERROR_DECODING_FAILED;
+
    //Get the size occupied by the certificate list
-   n = LOAD24BE(message->certificateListLength);
+   n = LOAD24BE(p);
    //Remaining bytes to process
-   length -= sizeof(TlsCertificate);
+   length -= 3;
 
    //Ensure that the chain of certificates is valid
    if(n > length)
@@ -431,7 +445,21 @@ error_t tlsParseCertificate(TlsContext *context, const TlsCertificate *message,
    length = n;
 
    //The sender's certificate must come first in the list
-   p = message->certificateList;
+   p += 3;
+
+#if (TLS_CERT_CACHE_SUPPORT == ENABLED)
+   //Check whether the server certificate chain has already been validated
+   if(context->entity == TLS_CONNECTION_END_CLIENT && context->certCache != NULL)
+   {
+      //Compute the digest of the certificate list
+      error = sha256Compute(p, length, digest);
+      //Any error to report?
+      if(error) return error;
+
+      //Search the cache for a matching chain
+      certCached = tlsFindCertCache(context, digest);
+   }
+#endif
 
    //Start of exception handling block
    do
@@ -458,6 +486,14 @@ error_t tlsParseCertificate(TlsContext *context, const TlsCertificate *message,
             //Check whether mutual authentication is required
             if(context->clientAuthMode == TLS_CLIENT_AUTH_REQUIRED)
             {
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+               //TLS 1.3 defines a dedicated alert for this situation
+               if(context->version == TLS_VERSION_1_3)
+               {
+                  error = ERROR_CERTIFICATE_REQUIRED;
+                  break;
+               }
+#endif
                //If client authentication is required by the server for the handshake
                //to continue, it may respond with a fatal handshake failure alert
                error = ERROR_HANDSHAKE_FAILED;
@@ -513,10 +549,18 @@ error_t tlsParseCertificate(TlsContext *context, const TlsCertificate *message,
          //Check if the hostname must be verified
          if(context->serverName != NULL)
          {
+            int_t i;
+            int_t j;
+
+            //Decode the attributes of the subject name
+            error = x509ParseNameAttributes(&certInfo->subject);
+            //Any error to report?
+            if(error) break;
+
             //Point to the last character of the common name
-            int_t i = certInfo->subject.commonNameLen - 1;
+            i = certInfo->subject.commonNameLen - 1;
             //Point to the last character of the hostname
-            int_t j = strlen(context->serverName) - 1;
+            j = strlen(context->serverName) - 1;
 
             //Check the common name in the server certificate against
             //the actual hostname that is being requested
@@ -575,6 +619,17 @@ error_t tlsParseCertificate(TlsContext *context, const TlsCertificate *message,
          //Save the certificate type
          context->peerCertType = TLS_CERT_DSS_SIGN;
       }
+      //The certificate contains a valid EC public key?
+      else if(certInfo->subjectPublicKey.namedCurve && certInfo->subjectPublicKey.ecPoint)
+      {
+         //Retrieve the EC domain parameters and the EC public key
+         error = x509ReadEcPublicKey(certInfo, &context->peerEcParams, &context->peerEcPublicKey);
+         //Any error to report
+         if(error) break;
+
+         //Save the certificate type
+         context->peerCertType = TLS_CERT_ECDSA_SIGN;
+      }
       //The certificate does not contain any valid public key?
       else
       {
@@ -587,6 +642,35 @@ error_t tlsParseCertificate(TlsContext *context, const TlsCertificate *message,
       p += n;
       length -= n;
 
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+      //With TLS 1.3, each certificate is followed by a list of extensions
+      if(context->version == TLS_VERSION_1_3)
+      {
+         //Malformed extension list?
+         if(length < 2 || length < (2 + LOAD16BE(p)))
+         {
+            //Report an error
+            error = ERROR_DECODING_FAILED;
+            break;
+         }
+
+         //The extensions of the certificate are ignored
+         n = 2 + LOAD16BE(p);
+         p += n;
+         length -= n;
+      }
+#endif
+
+#if (TLS_CERT_CACHE_SUPPORT == ENABLED)
+      //The signatures of a cached chain do not need to be verified again
+      if(certCached)
+      {
+         //The certificate chain is acceptable
+         error = NO_ERROR;
+         break;
+      }
+#endif
+
       //PKIX path validation
       while(length > 0)
       {
@@ -628,16 +712,46 @@ error_t tlsParseCertificate(TlsContext *context, const TlsCertificate *message,
          if(error) break;
 
          //Keep track of the issuer certificate
-         memcpy(certInfo, issuerCertInfo, sizeof(X509CertificateInfo));
+         tempCertInfo = certInfo;
+         certInfo = issuerCertInfo;
+         issuerCertInfo = tempCertInfo;
 
          //Next certificate
          p += n;
          length -= n;
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+         //Skip the extensions of the certificate (TLS 1.3)
+         if(context->version == TLS_VERSION_1_3)
+         {
+            //Malformed extension list?
+            if(length < 2 || length < (2 + LOAD16BE(p)))
+            {
+               //Report an error
+               error = ERROR_DECODING_FAILED;
+               break;
+            }
+
+            //The extensions of the certificate are ignored
+            n = 2 + LOAD16BE(p);
+            p += n;
+            length -= n;
+         }
+#endif
       }
 
       //Propagate exception if necessary...
       if(error) break;
 
+      //Check whether an indexed trusted CA store is available
+      if(context->caStore != NULL)
+      {
+         //Look for the issuer of the last certificate of the chain
+         error = tlsValidateWithCaStore(context->caStore, certInfo, issuerCertInfo);
+         //Exit immediately
+         break;
+      }
+
       //Point to the first trusted CA certificate
       pemCert = context->trustedCaList;
       //Get the total length, in bytes, of the trusted CA list
@@ -657,6 +771,20 @@ error_t tlsParseCertificate(TlsContext *context, const TlsCertificate *message,
          //Any error to report?
          if(error) break;
 
+         //Locate the subject name of the trusted CA certificate
+         error = x509ReadSubjectName(derCert, derCertLength, &caSubject);
+         //Failed to parse the X.509 certificate?
+         if(error) break;
+
+         //Skip the CA certificates whose subject does not match the issuer
+         if(caSubject.rawDataLen != certInfo->issuer.rawDataLen ||
+            memcmp(caSubject.rawData, certInfo->issuer.rawData, caSubject.rawDataLen))
+         {
+            //The certificate cannot be validated with the current CA
+            error = ERROR_BAD_CERTIFICATE;
+            continue;
+         }
+
          //Parse X.509 certificate
          error = x509ParseCertificate(derCert, derCertLength, issuerCertInfo);
          //Failed to parse the X.509 certificate?
@@ -682,14 +810,39 @@ error_t tlsParseCertificate(TlsContext *context, const TlsCertificate *message,
    osMemFree(certInfo);
    osMemFree(issuerCertInfo);
 
+#if (TLS_CERT_CACHE_SUPPORT == ENABLED)
+   //Record the certificate chain once it has been successfully validated
+   if(!error && !certCached && context->entity == TLS_CONNECTION_END_CLIENT &&
+      context->certCache != NULL)
+   {
+      tlsSaveToCertCache(context, digest);
+   }
+#endif
+
    //Clean up side effects
    if(error)
    {
       //Release multiple precision integers
       rsaFreePublicKey(&context->peerRsaPublicKey);
       dsaFreePublicKey(&context->peerDsaPublicKey);
+      ecFreeDomainParameters(&context->peerEcParams);
+      ecFree(&context->peerEcPublicKey);
    }
 
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //TLS 1.3 currently selected?
+   if(context->version == TLS_VERSION_1_3)
+   {
+      //A CertificateVerify message follows any non-empty Certificate message
+      if(context->entity == TLS_CONNECTION_END_CLIENT)
+         context->state = TLS_STATE_SERVER_CERTIFICATE_VERIFY;
+      else if(context->peerCertType != TLS_CERT_NONE)
+         context->state = TLS_STATE_CERTIFICATE_VERIFY;
+      else
+         context->state = TLS_STATE_CLIENT_FINISHED;
+   }
+   else
+#endif
    //TLS operates as a client or a server?
    if(context->entity == TLS_CONNECTION_END_CLIENT)
    {
@@ -838,6 +991,12 @@ error_t tlsParseFinished(TlsContext *context, const TlsFinished *message, size_t
       //Use abbreviated or full handshake?
       if(context->resume)
          context->state = TLS_STATE_APPLICATION_DATA;
+#if (TLS_TICKET_SUPPORT == ENABLED)
+      //The server sends a NewSessionTicket message before its
+      //ChangeCipherSpec message
+      else if(context->newSessionTicket)
+         context->state = TLS_STATE_NEW_SESSION_TICKET;
+#endif
       else
          context->state = TLS_STATE_SERVER_CHANGE_CIPHER_SPEC;
    }
@@ -885,6 +1044,10 @@ error_t tlsParseAlert(TlsContext *context, const TlsAlert *message, size_t lengt
       //Any connection terminated with a fatal alert must not be resumed
       if(context->entity == TLS_CONNECTION_END_SERVER)
          tlsRemoveFromCache(context);
+#if (TLS_CLIENT_CACHE_SUPPORT == ENABLED)
+      else
+         tlsRemoveFromClientCache(context);
+#endif
 
       //Servers and clients must forget any session identifiers
       memset(context->sessionId, 0, 32);
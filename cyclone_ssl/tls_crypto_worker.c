@@ -0,0 +1,303 @@
+/**
+ * @file tls_crypto_worker.c
+ * @brief Crypto worker tasks
+ *
+ * @section Description
+ *
+ * The RSA decryption, the signature generation and the Diffie-Hellman
+ * computations performed during the handshake are by far the most
+ * expensive operations of a TLS connection. When a crypto worker pool is
+ * attached to a TLS context, these operations are submitted to a queue
+ * and run by dedicated tasks, while the connection task waits for their
+ * completion. The worker tasks may then run at their own priority, the
+ * number of concurrent handshakes is bounded by the size of the pool and
+ * the time spent in public-key operations is measured separately from
+ * the record traffic
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_crypto_worker.h"
+#include "debug.h"
+
+//Check SSL library configuration
+#if (TLS_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Crypto worker pool initialization
+ * @return Handle referencing the fully initialized crypto worker pool
+ **/
+
+TlsCryptoWorker *tlsInitCryptoWorker(void)
+{
+#if (TLS_CRYPTO_WORKER_SUPPORT == ENABLED)
+   uint_t i;
+   TlsCryptoWorker *cryptoWorker;
+
+   //Allocate a memory buffer to hold the crypto worker pool
+   cryptoWorker = osMemAlloc(sizeof(TlsCryptoWorker));
+   //Failed to allocate memory?
+   if(cryptoWorker == NULL) return NULL;
+
+   //Clear memory
+   memset(cryptoWorker, 0, sizeof(TlsCryptoWorker));
+
+   //Create a mutex to protect the statistics
+   cryptoWorker->mutex = osMutexCreate(FALSE);
+   //Create the queue holding pending jobs
+   cryptoWorker->queue = osQueueCreate(TLS_CRYPTO_WORKER_QUEUE_SIZE, sizeof(TlsCryptoRequest *));
+
+   //Out of resources?
+   if(cryptoWorker->mutex == OS_INVALID_HANDLE ||
+      cryptoWorker->queue == OS_INVALID_HANDLE)
+   {
+      //Clean up side effects
+      tlsFreeCryptoWorker(cryptoWorker);
+      //Report an error
+      return NULL;
+   }
+
+   //Start the worker tasks
+   for(i = 0; i < TLS_CRYPTO_WORKER_COUNT; i++)
+   {
+      //Create a new task
+      cryptoWorker->tasks[i] = osTaskCreate("TLS Crypto Worker", tlsCryptoWorkerTask,
+         cryptoWorker, TLS_CRYPTO_WORKER_STACK_SIZE, TLS_CRYPTO_WORKER_PRIORITY);
+
+      //Unable to create the task?
+      if(cryptoWorker->tasks[i] == OS_INVALID_HANDLE)
+      {
+         //Clean up side effects
+         tlsFreeCryptoWorker(cryptoWorker);
+         //Report an error
+         return NULL;
+      }
+   }
+
+   //Return a pointer to the newly created crypto worker pool
+   return cryptoWorker;
+#else
+   //Crypto workers are not supported
+   return NULL;
+#endif
+}
+
+
+/**
+ * @brief Run a public-key operation on behalf of a TLS context
+ *
+ * The job is queued to the crypto worker pool attached to the TLS context,
+ * and the calling task blocks until it completes. If no pool is attached,
+ * the job is run directly in the context of the calling task
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] job Operation to run
+ * @param[in,out] data Job specific data
+ * @param[in,out] length Job specific length
+ * @return Error code
+ **/
+
+error_t tlsRunCryptoJob(TlsContext *context, TlsCryptoJob job, void *data, size_t *length)
+{
+#if (TLS_CRYPTO_WORKER_SUPPORT == ENABLED)
+   TlsCryptoRequest request;
+   TlsCryptoRequest *p;
+   TlsCryptoWorker *cryptoWorker;
+
+   //Point to the crypto worker pool
+   cryptoWorker = context->cryptoWorker;
+
+   //No pool attached to the TLS context?
+   if(cryptoWorker == NULL)
+      return job(context, data, length);
+
+   //Format the request
+   request.job = job;
+   request.context = context;
+   request.data = data;
+   request.length = length;
+   request.error = NO_ERROR;
+   request.timestamp = osGetTickCount();
+
+   //Make sure the event is in the non-signaled state
+   osEventReset(context->cryptoEvent);
+
+   //Point to the request
+   p = &request;
+
+   //Submit the request to the worker tasks. The handshake is rejected
+   //when the queue remains full for too long
+   if(!osQueueSend(cryptoWorker->queue, &p, TLS_CRYPTO_WORKER_TIMEOUT))
+   {
+      //Acquire exclusive access to the statistics
+      osMutexAcquire(cryptoWorker->mutex);
+      //Number of jobs rejected because the queue was full
+      cryptoWorker->stats.rejected++;
+      //Release exclusive access to the statistics
+      osMutexRelease(cryptoWorker->mutex);
+
+      //Debug message
+      TRACE_WARNING("Crypto worker queue is full!\r\n");
+      //Report an error
+      return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Wait for the job to complete
+   osEventWait(context->cryptoEvent, INFINITE_DELAY);
+
+   //Return status code
+   return request.error;
+#else
+   //Run the job in the context of the calling task
+   return job(context, data, length);
+#endif
+}
+
+
+/**
+ * @brief Retrieve crypto worker statistics
+ * @param[in] cryptoWorker Pointer to the crypto worker pool
+ * @param[out] stats Statistics collected since the pool was created
+ * @return Error code
+ **/
+
+error_t tlsGetCryptoWorkerStats(TlsCryptoWorker *cryptoWorker, TlsCryptoWorkerStats *stats)
+{
+#if (TLS_CRYPTO_WORKER_SUPPORT == ENABLED)
+   //Check parameters
+   if(cryptoWorker == NULL || stats == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Acquire exclusive access to the statistics
+   osMutexAcquire(cryptoWorker->mutex);
+   //Take a snapshot of the statistics
+   *stats = cryptoWorker->stats;
+   //Release exclusive access to the statistics
+   osMutexRelease(cryptoWorker->mutex);
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Crypto workers are not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Crypto worker task
+ * @param[in] param Pointer to the crypto worker pool
+ **/
+
+void tlsCryptoWorkerTask(void *param)
+{
+#if (TLS_CRYPTO_WORKER_SUPPORT == ENABLED)
+   time_t startTime;
+   time_t queueTime;
+   time_t runTime;
+   TlsCryptoRequest *request;
+   TlsCryptoWorker *cryptoWorker;
+
+   //Point to the crypto worker pool
+   cryptoWorker = (TlsCryptoWorker *) param;
+
+   //Process incoming requests
+   while(1)
+   {
+      //Wait for a new job
+      if(!osQueueReceive(cryptoWorker->queue, &request, INFINITE_DELAY))
+         continue;
+
+      //Save the time at which the processing starts
+      startTime = osGetTickCount();
+      //Time spent in the queue
+      queueTime = startTime - request->timestamp;
+
+      //Run the public-key operation
+      request->error = request->job(request->context, request->data, request->length);
+
+      //Processing time
+      runTime = osGetTickCount() - startTime;
+
+      //Acquire exclusive access to the statistics
+      osMutexAcquire(cryptoWorker->mutex);
+
+      //Update statistics
+      cryptoWorker->stats.jobs++;
+      cryptoWorker->stats.queueTime += queueTime;
+      cryptoWorker->stats.runTime += runTime;
+      cryptoWorker->stats.maxQueueTime = max(cryptoWorker->stats.maxQueueTime, queueTime);
+      cryptoWorker->stats.maxRunTime = max(cryptoWorker->stats.maxRunTime, runTime);
+
+      //Release exclusive access to the statistics
+      osMutexRelease(cryptoWorker->mutex);
+
+      //Notify the TLS context that the job is complete
+      osEventSet(request->context->cryptoEvent);
+   }
+#endif
+}
+
+
+/**
+ * @brief Release crypto worker pool
+ * @param[in] cryptoWorker Pointer to the crypto worker pool
+ **/
+
+void tlsFreeCryptoWorker(TlsCryptoWorker *cryptoWorker)
+{
+#if (TLS_CRYPTO_WORKER_SUPPORT == ENABLED)
+   uint_t i;
+
+   //Invalid pool?
+   if(cryptoWorker == NULL)
+      return;
+
+   //Stop the worker tasks
+   for(i = 0; i < TLS_CRYPTO_WORKER_COUNT; i++)
+   {
+      if(cryptoWorker->tasks[i] != NULL)
+         osTaskDelete(cryptoWorker->tasks[i]);
+   }
+
+   //Release the job queue
+   if(cryptoWorker->queue != NULL)
+      osQueueClose(cryptoWorker->queue);
+   //Release the mutex
+   if(cryptoWorker->mutex != NULL)
+      osMutexClose(cryptoWorker->mutex);
+
+   //Release the memory used by the pool
+   osMemFree(cryptoWorker);
+#endif
+}
+
+#endif
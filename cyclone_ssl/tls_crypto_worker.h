@@ -0,0 +1,65 @@
+/**
+ * @file tls_crypto_worker.h
+ * @brief Crypto worker tasks
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _TLS_CRYPTO_WORKER_H
+#define _TLS_CRYPTO_WORKER_H
+
+//Dependencies
+#include "tls.h"
+
+
+/**
+ * @brief Public-key operation run on behalf of a TLS context
+ **/
+
+typedef error_t (*TlsCryptoJob)(TlsContext *context, void *data, size_t *length);
+
+
+/**
+ * @brief Crypto job submitted to the worker tasks
+ **/
+
+typedef struct
+{
+   TlsCryptoJob job;     ///<Operation to run
+   TlsContext *context;  ///<TLS context on whose behalf the job is run
+   void *data;           ///<Job specific data
+   size_t *length;       ///<Job specific length
+   error_t error;        ///<Status code returned by the job
+   time_t timestamp;     ///<Time at which the job was submitted
+} TlsCryptoRequest;
+
+
+//Crypto worker related functions
+TlsCryptoWorker *tlsInitCryptoWorker(void);
+error_t tlsRunCryptoJob(TlsContext *context, TlsCryptoJob job, void *data, size_t *length);
+error_t tlsGetCryptoWorkerStats(TlsCryptoWorker *cryptoWorker, TlsCryptoWorkerStats *stats);
+void tlsCryptoWorkerTask(void *param);
+void tlsFreeCryptoWorker(TlsCryptoWorker *cryptoWorker);
+
+#endif
@@ -0,0 +1,344 @@
+/**
+ * @file tls_dh_key_pool.c
+ * @brief Precomputed Diffie-Hellman key pairs
+ *
+ * @section Description
+ *
+ * Generating the server's ephemeral key pair is one of the two modular
+ * exponentiations of a DHE handshake. A low-priority task fills a pool of
+ * key pairs in advance, so the ServerKeyExchange message can be sent
+ * without waiting for the key generation. A key pair is either used once
+ * or reused until its lifetime expires, depending on the value of the
+ * TLS_DH_KEY_POOL_LIFETIME parameter
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_dh_key_pool.h"
+#include "pem.h"
+#include "debug.h"
+
+//Check SSL library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_DH_KEY_POOL_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Diffie-Hellman key pool initialization
+ * @param[in] params PEM structure that holds Diffie-Hellman parameters
+ * @param[in] length Total length of the DER structure
+ * @param[in] prngAlgo Pseudo-random number generator to be used
+ * @param[in] prngContext Pointer to the PRNG context
+ * @return Handle referencing the fully initialized key pool
+ **/
+
+TlsDhKeyPool *tlsInitDhKeyPool(const char_t *params, size_t length,
+   const PrngAlgo *prngAlgo, void *prngContext)
+{
+   error_t error;
+   uint_t i;
+   TlsDhKeyPool *dhKeyPool;
+
+   //Check parameters
+   if(params == NULL || prngAlgo == NULL || prngContext == NULL)
+      return NULL;
+
+   //Allocate a memory buffer to hold the key pool
+   dhKeyPool = osMemAlloc(sizeof(TlsDhKeyPool));
+   //Failed to allocate memory?
+   if(dhKeyPool == NULL) return NULL;
+
+   //Clear memory
+   memset(dhKeyPool, 0, sizeof(TlsDhKeyPool));
+
+   //Save the PRNG to be used by the key generation task
+   dhKeyPool->prngAlgo = prngAlgo;
+   dhKeyPool->prngContext = prngContext;
+
+   //Initialize Diffie-Hellman parameters
+   dhInitParameters(&dhKeyPool->params);
+
+   //Initialize the key pairs
+   for(i = 0; i < TLS_DH_KEY_POOL_SIZE; i++)
+   {
+      mpiInit(&dhKeyPool->pairs[i].xa);
+      mpiInit(&dhKeyPool->pairs[i].ya);
+   }
+
+   //Decode the PEM structure that holds Diffie-Hellman parameters
+   error = pemReadDhParameters(params, length, &dhKeyPool->params);
+
+   //Check status code
+   if(!error)
+   {
+      //Create a mutex to prevent simultaneous access to the pool
+      dhKeyPool->mutex = osMutexCreate(FALSE);
+      //The event is initially set so that the pool is filled at startup
+      dhKeyPool->event = osEventCreate(FALSE, TRUE);
+
+      //Out of resources?
+      if(dhKeyPool->mutex == OS_INVALID_HANDLE ||
+         dhKeyPool->event == OS_INVALID_HANDLE)
+      {
+         //Report an error
+         error = ERROR_OUT_OF_RESOURCES;
+      }
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Start the key generation task
+      dhKeyPool->task = osTaskCreate("TLS DH Key Pool", tlsDhKeyPoolTask,
+         dhKeyPool, TLS_DH_KEY_POOL_STACK_SIZE, TLS_DH_KEY_POOL_PRIORITY);
+
+      //Unable to create the task?
+      if(dhKeyPool->task == OS_INVALID_HANDLE)
+         error = ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Any error to report?
+   if(error)
+   {
+      //Clean up side effects
+      tlsFreeDhKeyPool(dhKeyPool);
+      //Report an error
+      return NULL;
+   }
+
+   //Return a pointer to the newly created key pool
+   return dhKeyPool;
+}
+
+
+/**
+ * @brief Take the next precomputed key pair
+ *
+ * The key pair is copied to the Diffie-Hellman parameters of the TLS
+ * context. The pool can only be used when its parameters match the
+ * ones of the TLS context
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsGetDhKeyPair(TlsContext *context)
+{
+   error_t error;
+   uint_t i;
+   TlsDhKeyPool *dhKeyPool;
+   TlsDhKeyPair *pair;
+
+   //Point to the key pool
+   dhKeyPool = context->dhKeyPool;
+
+   //No pool attached to the TLS context?
+   if(dhKeyPool == NULL)
+      return ERROR_NOT_FOUND;
+
+   //The key pairs must have been generated using the same parameters
+   if(mpiComp(&dhKeyPool->params.p, &context->dhParameters.p) ||
+      mpiComp(&dhKeyPool->params.g, &context->dhParameters.g))
+   {
+      //The pool cannot be used
+      return ERROR_NOT_FOUND;
+   }
+
+   //No key pair found yet
+   error = ERROR_NOT_FOUND;
+
+   //Acquire exclusive access to the pool
+   osMutexAcquire(dhKeyPool->mutex);
+
+   //Loop through the key pairs, starting with the next one to use
+   for(i = 0; i < TLS_DH_KEY_POOL_SIZE; i++)
+   {
+      //Point to the current key pair
+      pair = &dhKeyPool->pairs[dhKeyPool->index];
+      //Advance index
+      dhKeyPool->index = (dhKeyPool->index + 1) % TLS_DH_KEY_POOL_SIZE;
+
+#if (TLS_DH_KEY_POOL_LIFETIME > 0)
+      //Discard the key pair once its lifetime has expired
+      if(pair->valid && (osGetTickCount() - pair->timestamp) >= TLS_DH_KEY_POOL_LIFETIME)
+         pair->valid = FALSE;
+#endif
+
+      //Valid key pair?
+      if(pair->valid)
+      {
+         //Copy the private and public values
+         error = mpiCopy(&context->dhParameters.xa, &pair->xa);
+         //Check status code
+         if(!error)
+            error = mpiCopy(&context->dhParameters.ya, &pair->ya);
+
+#if (TLS_DH_KEY_POOL_LIFETIME == 0)
+         //Each key pair is used only once
+         pair->valid = FALSE;
+#endif
+         //We are done
+         break;
+      }
+   }
+
+   //Release exclusive access to the pool
+   osMutexRelease(dhKeyPool->mutex);
+
+   //Let the key generation task refill the pool
+   osEventSet(dhKeyPool->event);
+
+   //Debug message
+   if(error == ERROR_NOT_FOUND)
+      TRACE_INFO("DH key pool is empty!\r\n");
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Key generation task
+ * @param[in] param Pointer to the Diffie-Hellman key pool
+ **/
+
+void tlsDhKeyPoolTask(void *param)
+{
+   error_t error;
+   uint_t i;
+   bool_t refill;
+   TlsDhKeyPool *dhKeyPool;
+   TlsDhKeyPair *pair;
+
+   //Point to the key pool
+   dhKeyPool = (TlsDhKeyPool *) param;
+
+   //Main loop
+   while(1)
+   {
+      //Wait for a key pair to be consumed. Reusable key pairs also need
+      //to be renewed periodically
+#if (TLS_DH_KEY_POOL_LIFETIME > 0)
+      osEventWait(dhKeyPool->event, TLS_DH_KEY_POOL_LIFETIME / 2);
+#else
+      osEventWait(dhKeyPool->event, INFINITE_DELAY);
+#endif
+
+      //Loop through the key pairs
+      for(i = 0; i < TLS_DH_KEY_POOL_SIZE; i++)
+      {
+         //Point to the current key pair
+         pair = &dhKeyPool->pairs[i];
+
+         //Acquire exclusive access to the pool
+         osMutexAcquire(dhKeyPool->mutex);
+#if (TLS_DH_KEY_POOL_LIFETIME > 0)
+         //Check whether the key pair is missing or about to expire
+         refill = !pair->valid ||
+            (osGetTickCount() - pair->timestamp) >= (TLS_DH_KEY_POOL_LIFETIME / 2);
+#else
+         //Check whether the key pair is missing
+         refill = !pair->valid;
+#endif
+         //Release exclusive access to the pool
+         osMutexRelease(dhKeyPool->mutex);
+
+         //Nothing to do?
+         if(!refill) continue;
+
+         //Generate a new key pair without holding the mutex
+         error = dhGenerateKeyPair(&dhKeyPool->params,
+            dhKeyPool->prngAlgo, dhKeyPool->prngContext);
+         //Key generation failed?
+         if(error) break;
+
+         //Acquire exclusive access to the pool
+         osMutexAcquire(dhKeyPool->mutex);
+
+         //Save the private and public values
+         error = mpiCopy(&pair->xa, &dhKeyPool->params.xa);
+         //Check status code
+         if(!error)
+            error = mpiCopy(&pair->ya, &dhKeyPool->params.ya);
+
+         //Check status code
+         if(!error)
+         {
+            //Save the time at which the key pair was generated
+            pair->timestamp = osGetTickCount();
+            //The key pair can now be used
+            pair->valid = TRUE;
+         }
+
+         //Release exclusive access to the pool
+         osMutexRelease(dhKeyPool->mutex);
+      }
+   }
+}
+
+
+/**
+ * @brief Release Diffie-Hellman key pool
+ * @param[in] dhKeyPool Pointer to the key pool
+ **/
+
+void tlsFreeDhKeyPool(TlsDhKeyPool *dhKeyPool)
+{
+   uint_t i;
+
+   //Invalid pool?
+   if(dhKeyPool == NULL)
+      return;
+
+   //Stop the key generation task
+   if(dhKeyPool->task != NULL)
+      osTaskDelete(dhKeyPool->task);
+
+   //Release the event and the mutex
+   if(dhKeyPool->event != NULL)
+      osEventClose(dhKeyPool->event);
+   if(dhKeyPool->mutex != NULL)
+      osMutexClose(dhKeyPool->mutex);
+
+   //Release the key pairs
+   for(i = 0; i < TLS_DH_KEY_POOL_SIZE; i++)
+   {
+      mpiFree(&dhKeyPool->pairs[i].xa);
+      mpiFree(&dhKeyPool->pairs[i].ya);
+   }
+
+   //Release Diffie-Hellman parameters
+   dhFreeParameters(&dhKeyPool->params);
+
+   //Clear the pool contents, then release memory
+   memset(dhKeyPool, 0, sizeof(TlsDhKeyPool));
+   osMemFree(dhKeyPool);
+}
+
+#endif
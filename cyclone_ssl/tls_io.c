@@ -37,6 +37,10 @@
 //Check SSL library configuration
 #if (TLS_SUPPORT == ENABLED)
 
+//TLS I/O related local functions
+static error_t tlsIoReceive(TlsContext *context, void *data,
+   size_t size, size_t *received, bool_t waitAll);
+
 
 /**
  * @brief Write data to the underlying socket
@@ -58,6 +62,27 @@ error_t tlsIoWrite(TlsContext *context, const void *data, size_t length)
    return NO_ERROR;
 #else
    error_t error;
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+   size_t n;
+
+   //Non-blocking mode?
+   if(context->nonBlocking)
+   {
+      //Send as much data as the socket can accept right now
+      error = socketSend(context->socket, data, length, &n, 0);
+      //Any error other than a full send buffer?
+      if(error && error != ERROR_TIMEOUT && error != ERROR_WOULD_BLOCK)
+         return ERROR_WRITE_FAILED;
+
+      //The remaining bytes stay in the TX buffer until tlsIoFlush()
+      //manages to send them
+      context->txPending = (const uint8_t *) data + n;
+      context->txPendingLength = length - n;
+
+      //The record is considered as sent
+      return NO_ERROR;
+   }
+#endif
 
    //Send the specified number of bytes
    error = socketSend(context->socket, data, length, NULL, 0);
@@ -70,8 +95,70 @@ error_t tlsIoWrite(TlsContext *context, const void *data, size_t length)
 }
 
 
+/**
+ * @brief Send the part of the last record the socket did not accept
+ *
+ * The TX buffer cannot be reused before this function succeeds. When
+ * told not to wait, it returns ERROR_WOULD_BLOCK as soon as the send
+ * buffer of the socket is full
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] wait Wait (up to TLS_FLUSH_TIMEOUT) for the socket to accept the data
+ * @return Error code
+ **/
+
+error_t tlsIoFlush(TlsContext *context, bool_t wait)
+{
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+   error_t error;
+   size_t n;
+   SocketEventDesc eventDesc;
+
+   //Send pending data
+   while(context->txPendingLength > 0)
+   {
+      //Send as much data as the socket can accept right now
+      error = socketSend(context->socket, context->txPending,
+         context->txPendingLength, &n, 0);
+      //Any error other than a full send buffer?
+      if(error && error != ERROR_TIMEOUT && error != ERROR_WOULD_BLOCK)
+         return ERROR_WRITE_FAILED;
+
+      //Advance data pointer
+      context->txPending += n;
+      //Number of bytes still pending
+      context->txPendingLength -= n;
+
+      //Exit immediately if all the data have been sent
+      if(context->txPendingLength == 0)
+         break;
+      //The caller will try again once the socket is writable
+      if(!wait)
+         return ERROR_WOULD_BLOCK;
+
+      //Wait for room in the send buffer
+      eventDesc.socket = context->socket;
+      eventDesc.eventMask = SOCKET_EVENT_TX_READY;
+
+      //The peer does not read the data?
+      if(socketPoll(&eventDesc, 1, NULL, TLS_FLUSH_TIMEOUT))
+         return ERROR_WRITE_FAILED;
+   }
+#endif
+
+   //No more pending data
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Read data from the underlying socket
+ *
+ * When read-ahead is enabled, small reads are served from a buffer that is
+ * refilled with as much data as the socket can deliver in a single call,
+ * so that a record header and the record that follows it are usually
+ * fetched together. Larger reads go straight to the destination buffer
+ *
  * @param[in] context Pointer to the TLS context
  * @param[out] data Buffer where to store the incoming data
  * @param[in] length Requested number of bytes to read
@@ -80,14 +167,50 @@ error_t tlsIoWrite(TlsContext *context, const void *data, size_t length)
 
 error_t tlsIoRead(TlsContext *context, void *data, size_t length)
 {
-#if (TLS_BSD_SOCKET_SUPPORT == ENABLED)
+   error_t error;
+   size_t n;
+
+#if (TLS_READ_AHEAD_SIZE > 0)
    //Read as much data as possible
    while(length > 0)
    {
-      //Read data
-      int_t n = recv(context->socket, data, length, 0);
-      //Any error to report?
-      if(n <= 0) break;
+      //Any data pending in the read-ahead buffer?
+      if(context->readAheadLength > 0)
+      {
+         //Limit the number of bytes to copy at a time
+         n = min(length, context->readAheadLength);
+         //Copy pending data
+         memcpy(data, context->readAhead + context->readAheadPos, n);
+
+         //Advance read position
+         context->readAheadPos += n;
+         //Number of bytes still pending in the read-ahead buffer
+         context->readAheadLength -= n;
+      }
+      //Large read operation?
+      else if(length >= TLS_READ_AHEAD_SIZE)
+      {
+         //Bypass the read-ahead buffer
+         error = tlsIoReceive(context, data, length, &n, TRUE);
+         //Any error to report?
+         if(error) return error;
+      }
+      else
+      {
+         //Fetch as much data as available with a single socket call
+         error = tlsIoReceive(context, context->readAhead,
+            TLS_READ_AHEAD_SIZE, &n, FALSE);
+         //Any error to report?
+         if(error) return error;
+
+         //Rewind to the beginning of the buffer
+         context->readAheadPos = 0;
+         //Number of bytes pending in the read-ahead buffer
+         context->readAheadLength = n;
+
+         //Serve the request from the read-ahead buffer
+         continue;
+      }
 
       //Advance data pointer
       data = (uint8_t *) data + n;
@@ -95,22 +218,150 @@ error_t tlsIoRead(TlsContext *context, void *data, size_t length)
       length -= n;
    }
 
-   //Make sure that the requested number of bytes have been read
-   if(length != 0) return ERROR_READ_FAILED;
-
    //Successful read operation
    return NO_ERROR;
 #else
+   //Read the requested number of bytes
+   error = tlsIoReceive(context, data, length, &n, TRUE);
+   //Return status code
+   return error;
+#endif
+}
+
+
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+
+/**
+ * @brief Read data from the underlying socket without blocking
+ *
+ * The function fills the buffer with whatever data is available and
+ * updates the caller's position, so that the same call can be repeated
+ * until the requested number of bytes have been read
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[out] data Buffer where to store the incoming data
+ * @param[in] length Requested number of bytes to read
+ * @param[in,out] pos Number of bytes already stored in the buffer
+ * @return Error code (ERROR_WOULD_BLOCK if some bytes are still missing)
+ **/
+
+error_t tlsIoReadPartial(TlsContext *context, void *data, size_t length, size_t *pos)
+{
    error_t error;
    size_t n;
+   uint8_t *p;
+
+   //Read as much data as possible
+   while(*pos < length)
+   {
+      //Point to the first missing byte
+      p = (uint8_t *) data + *pos;
+
+#if (TLS_READ_AHEAD_SIZE > 0)
+      //Any data pending in the read-ahead buffer?
+      if(context->readAheadLength > 0)
+      {
+         //Limit the number of bytes to copy at a time
+         n = min(length - *pos, context->readAheadLength);
+         //Copy pending data
+         memcpy(p, context->readAhead + context->readAheadPos, n);
+
+         //Advance read position
+         context->readAheadPos += n;
+         //Number of bytes still pending in the read-ahead buffer
+         context->readAheadLength -= n;
+      }
+      //Small read operation?
+      else if((length - *pos) < TLS_READ_AHEAD_SIZE)
+      {
+         //Fetch as much data as available with a single socket call
+         error = tlsIoReceive(context, context->readAhead,
+            TLS_READ_AHEAD_SIZE, &n, FALSE);
+         //Any error to report?
+         if(error) return error;
+
+         //Rewind to the beginning of the buffer
+         context->readAheadPos = 0;
+         //Number of bytes pending in the read-ahead buffer
+         context->readAheadLength = n;
+
+         //Serve the request from the read-ahead buffer
+         continue;
+      }
+      else
+#endif
+      {
+         //Read the data that are available
+         error = tlsIoReceive(context, p, length - *pos, &n, FALSE);
+         //Any error to report?
+         if(error) return error;
+      }
+
+      //Number of bytes stored in the buffer
+      *pos += n;
+   }
+
+   //The requested number of bytes have been read
+   return NO_ERROR;
+}
+
+#endif
+
+
+/**
+ * @brief Receive data from the underlying socket
+ * @param[in] context Pointer to the TLS context
+ * @param[out] data Buffer where to store the incoming data
+ * @param[in] size Maximum number of bytes to read
+ * @param[out] received Actual number of bytes that have been read
+ * @param[in] waitAll Wait for the specified number of bytes to be read
+ * @return Error code
+ **/
+
+static error_t tlsIoReceive(TlsContext *context, void *data,
+   size_t size, size_t *received, bool_t waitAll)
+{
+#if (TLS_BSD_SOCKET_SUPPORT == ENABLED)
+   int_t n;
+
+   //No data has been read yet
+   *received = 0;
+
+   //Read as much data as possible
+   while(*received < size)
+   {
+      //Read data
+      n = recv(context->socket, (uint8_t *) data + *received, size - *received, 0);
+      //Any error to report?
+      if(n <= 0) return ERROR_READ_FAILED;
+
+      //Total number of bytes that have been read
+      *received += n;
+
+      //Return as soon as some data is available, unless told otherwise
+      if(!waitAll) break;
+   }
+
+   //Successful read operation
+   return NO_ERROR;
+#else
+   error_t error;
 
    //Read data
-   error = socketReceive(context->socket, data, length, &n, SOCKET_FLAG_WAIT_ALL);
+   error = socketReceive(context->socket, data, size, received,
+      waitAll ? SOCKET_FLAG_WAIT_ALL : 0);
+
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+   //In non-blocking mode, a timeout means that no data is available yet
+   if(error == ERROR_TIMEOUT && context->nonBlocking)
+      return ERROR_WOULD_BLOCK;
+#endif
+
    //Any error to report?
    if(error) return ERROR_READ_FAILED;
 
    //Make sure that the requested number of bytes have been read
-   if(n != length) return ERROR_READ_FAILED;
+   if(waitAll && *received != size) return ERROR_READ_FAILED;
 
    //Successful read operation
    return NO_ERROR;
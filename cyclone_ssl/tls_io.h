@@ -34,6 +34,8 @@
 
 //I/O abstraction layer
 error_t tlsIoWrite(TlsContext *context, const void *data, size_t length);
+error_t tlsIoFlush(TlsContext *context, bool_t wait);
 error_t tlsIoRead(TlsContext *context, void *data, size_t length);
+error_t tlsIoReadPartial(TlsContext *context, void *data, size_t length, size_t *pos);
 
 #endif
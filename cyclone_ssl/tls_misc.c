@@ -40,6 +40,7 @@
 #include "asn1.h"
 #include "x509.h"
 #include "pem.h"
+#include "aes_ni.h"
 #include "debug.h"
 
 //Check SSL library configuration
@@ -61,6 +62,7 @@ void tlsProcessError(TlsContext *context, error_t errorCode)
    //I/O operation failed
    case ERROR_WRITE_FAILED:
    case ERROR_READ_FAILED:
+   case ERROR_WOULD_BLOCK:
       break;
    //An inappropriate message was received
    case ERROR_UNEXPECTED_MESSAGE:
@@ -110,6 +112,12 @@ void tlsProcessError(TlsContext *context, error_t errorCode)
    case ERROR_VERSION_NOT_SUPPORTED:
       tlsSendAlert(context, TLS_ALERT_LEVEL_FATAL, TLS_ALERT_PROTOCOL_VERSION);
       break;
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //The server requires client authentication but no certificate was sent
+   case ERROR_CERTIFICATE_REQUIRED:
+      tlsSendAlert(context, TLS_ALERT_LEVEL_FATAL, TLS_ALERT_CERTIFICATE_REQUIRED);
+      break;
+#endif
    //Internal error
    default:
       tlsSendAlert(context, TLS_ALERT_LEVEL_FATAL, TLS_ALERT_INTERNAL_ERROR);
@@ -204,6 +212,14 @@ error_t tlsSetCipherSuite(TlsContext *context, uint16_t identifier)
          acceptable = FALSE;
    }
 
+   //TLS 1.3 cipher suites cannot be used with previous versions of the
+   //protocol, and the legacy cipher suites cannot be used with TLS 1.3
+   if(acceptable)
+   {
+      if(TLS13_CIPHER_SUITE(identifier) != (context->version == TLS_VERSION_1_3))
+         acceptable = FALSE;
+   }
+
    //Ensure that the selected cipher suite matches all the criteria
    if(acceptable)
    {
@@ -215,6 +231,13 @@ error_t tlsSetCipherSuite(TlsContext *context, uint16_t identifier)
       //Set encryption algorithm and hash function
       context->cipherAlgo = cipherSuite->cipherAlgo;
       context->cipherMode = cipherSuite->cipherMode;
+
+#if (AES_NI_SUPPORT == ENABLED)
+      //Use the AES instructions of the processor when they are available.
+      //The software implementation remains the fallback
+      if(context->cipherAlgo == AES_CIPHER_ALGO && aesNiIsAvailable())
+         context->cipherAlgo = AES_NI_CIPHER_ALGO;
+#endif
       context->hashAlgo = cipherSuite->hashAlgo;
       context->prfHashAlgo = cipherSuite->prfHashAlgo;
 
@@ -363,13 +386,34 @@ error_t tlsSelectSignHashAlgo(TlsContext *context,
 
 error_t tlsInitHandshakeHash(TlsContext *context)
 {
-   //Allocate SHA-1 context
-   context->handshakeSha1Context = osMemAlloc(sizeof(Sha1Context));
-   //Failed to allocate memory?
-   if(!context->handshakeSha1Context) return ERROR_OUT_OF_MEMORY;
+   bool_t sha1Required;
 
-   //Initialize SHA-1 context
-   sha1Init(context->handshakeSha1Context);
+   //SSL 3.0, TLS 1.0 and 1.1 always use SHA-1 to compute verify data
+   if(context->version <= TLS_VERSION_1_1)
+      sha1Required = TRUE;
+   //TLS 1.3 only uses the hash algorithm associated with the cipher suite
+   else if(context->version == TLS_VERSION_1_3)
+      sha1Required = FALSE;
+   //With TLS 1.2, SHA-1 is only used when a CertificateVerify message is
+   //signed with SHA-1. The server can only receive such a message if it
+   //requests client authentication, and the client can only send one if
+   //it has a certificate to present
+   else if(context->entity == TLS_CONNECTION_END_SERVER)
+      sha1Required = (context->clientAuthMode != TLS_CLIENT_AUTH_NONE);
+   else
+      sha1Required = (context->numCerts > 0);
+
+   //SHA-1 transcript needed?
+   if(sha1Required)
+   {
+      //Allocate SHA-1 context
+      context->handshakeSha1Context = osMemAlloc(sizeof(Sha1Context));
+      //Failed to allocate memory?
+      if(!context->handshakeSha1Context) return ERROR_OUT_OF_MEMORY;
+
+      //Initialize SHA-1 context
+      sha1Init(context->handshakeSha1Context);
+   }
 
    //SSL 3.0, TLS 1.0 or 1.1 currently selected?
    if(context->version <= TLS_VERSION_1_1)
@@ -389,7 +433,7 @@ error_t tlsInitHandshakeHash(TlsContext *context)
       //Initialize MD5 context
       md5Init(context->handshakeMd5Context);
    }
-   //TLS 1.2 currently selected?
+   //TLS 1.2 or 1.3 currently selected?
    else
    {
       //Allocate a memory buffer to hold the hash algorithm context
@@ -417,7 +461,7 @@ error_t tlsInitHandshakeHash(TlsContext *context)
       size_t length = LOAD24BE(message->length);
 
       //Sanity check
-      if(length <= TLS_MAX_PROTOCOL_DATA_LENGTH)
+      if(length <= context->txBufferSize)
       {
          //Update the hash value with ClientHello message contents
          tlsUpdateHandshakeHash(context, message, length + sizeof(TlsHandshake));
@@ -449,7 +493,7 @@ void tlsUpdateHandshakeHash(TlsContext *context, const void *data, size_t length
       if(context->handshakeMd5Context)
          md5Update(context->handshakeMd5Context, data, length);
    }
-   //TLS 1.2 currently selected?
+   //TLS 1.2 or 1.3 currently selected?
    else
    {
       //Update hash value with message contents
@@ -516,9 +560,9 @@ error_t tlsFinalizeHandshakeHash(TlsContext *context, const HashAlgo *hash,
    }
    else
 #endif
-#if (TLS_MAX_VERSION >= TLS_VERSION_1_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
-   //TLS 1.0, TLS 1.1 or TLS 1.2 currently selected?
-   if(context->version >= TLS_VERSION_1_0 && context->version <= TLS_VERSION_1_2)
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_0 && TLS_MIN_VERSION <= TLS_VERSION_1_3)
+   //TLS 1.0, TLS 1.1, TLS 1.2 or TLS 1.3 currently selected?
+   if(context->version >= TLS_VERSION_1_0 && context->version <= TLS_VERSION_1_3)
    {
       //Compute hash(handshakeMessages)
       hash->final(tempHashContext, output);
@@ -648,6 +692,155 @@ error_t tlsComputeVerifyData(TlsContext *context, TlsConnectionEnd entity)
 }
 
 
+/**
+ * @brief Release the resources that are only needed during the handshake
+ *
+ * This function is called once the connection enters the application
+ * data phase. The handshake hash contexts, the key exchange parameters,
+ * the peer's public key and the decoded private keys are released, and
+ * the record buffers are shrunk to the largest record that can still
+ * be exchanged. Only the record layer state is kept
+ *
+ * @param[in] context Pointer to the TLS context
+ **/
+
+void tlsFreeHandshakeState(TlsContext *context)
+{
+   uint_t i;
+   size_t n;
+   uint8_t *buffer;
+
+   //Release the MD5 context used to compute verify data
+   if(context->handshakeMd5Context != NULL)
+   {
+      memset(context->handshakeMd5Context, 0, sizeof(Md5Context));
+      osMemFree(context->handshakeMd5Context);
+      context->handshakeMd5Context = NULL;
+   }
+
+   //Release the SHA-1 context used to compute verify data
+   if(context->handshakeSha1Context != NULL)
+   {
+      memset(context->handshakeSha1Context, 0, sizeof(Sha1Context));
+      osMemFree(context->handshakeSha1Context);
+      context->handshakeSha1Context = NULL;
+   }
+
+   //Release the hash context used to compute verify data (TLS 1.2)
+   if(context->handshakeHashContext != NULL)
+   {
+      memset(context->handshakeHashContext, 0, context->prfHashAlgo->contextSize);
+      osMemFree(context->handshakeHashContext);
+      context->handshakeHashContext = NULL;
+   }
+
+   //Release Diffie-Hellman parameters and ephemeral keys
+   dhFreeParameters(&context->dhParameters);
+   dhInitParameters(&context->dhParameters);
+   //Release ECDH context
+   ecdhFree(&context->ecdhContext);
+   ecdhInit(&context->ecdhContext);
+
+   //Release the public key of the peer
+   rsaFreePublicKey(&context->peerRsaPublicKey);
+   rsaInitPublicKey(&context->peerRsaPublicKey);
+   dsaFreePublicKey(&context->peerDsaPublicKey);
+   dsaInitPublicKey(&context->peerDsaPublicKey);
+   ecFreeDomainParameters(&context->peerEcParams);
+   ecInitDomainParameters(&context->peerEcParams);
+   ecFree(&context->peerEcPublicKey);
+   ecInit(&context->peerEcPublicKey);
+
+   //The private keys and the certificate lists are no longer needed
+   for(i = 0; i < context->numCerts; i++)
+   {
+      rsaFreePrivateKey(&context->certs[i].rsaPrivateKey);
+      rsaInitPrivateKey(&context->certs[i].rsaPrivateKey);
+      dsaFreePrivateKey(&context->certs[i].dsaPrivateKey);
+      dsaInitPrivateKey(&context->certs[i].dsaPrivateKey);
+      ecFreeDomainParameters(&context->certs[i].ecParams);
+      ecInitDomainParameters(&context->certs[i].ecParams);
+      mpiFree(&context->certs[i].ecPrivateKey);
+
+      //Release the DER encoded certificate list
+      osMemFree(context->certs[i].certList);
+      context->certs[i].certList = NULL;
+      context->certs[i].certListLength = 0;
+   }
+
+   //The premaster secret must not outlive the handshake
+   memset(context->premasterSecret, 0, sizeof(context->premasterSecret));
+   context->premasterSecretLength = 0;
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //The handshake secrets are no longer needed. The application traffic
+   //secrets and the resumption master secret are kept for KeyUpdate and
+   //NewSessionTicket messages
+   memset(context->secret, 0, sizeof(context->secret));
+   memset(context->clientHsTrafficSecret, 0, sizeof(context->clientHsTrafficSecret));
+   memset(context->serverHsTrafficSecret, 0, sizeof(context->serverHsTrafficSecret));
+
+   //Release the cookie received in a HelloRetryRequest
+   if(context->cookie != NULL)
+   {
+      osMemFree(context->cookie);
+      context->cookie = NULL;
+      context->cookieLength = 0;
+   }
+#endif
+
+   //Records sent from now on never exceed the fragment length limits
+   n = min(context->txBufferSize, context->maxFragLength);
+   n = min(n, context->recordSizeLimit);
+
+   //The send buffer can be shrunk?
+   if(n < context->txBufferSize && context->txBufferLength == 0)
+   {
+      //Allocate a smaller buffer
+      buffer = osMemAlloc(TLS_TX_BUFFER_SIZE(n));
+
+      //Keep the current buffer if memory is short
+      if(buffer != NULL)
+      {
+         //Release the previous buffer
+         memset(context->txBuffer, 0, TLS_TX_BUFFER_SIZE(context->txBufferSize));
+         osMemFree(context->txBuffer);
+
+         //Use the new buffer
+         memset(buffer, 0, TLS_TX_BUFFER_SIZE(n));
+         context->txBuffer = buffer;
+         context->txBufferSize = n;
+      }
+   }
+
+   //Handshake messages may span several records whereas application
+   //data only need room for a single record
+   n = min(context->rxBufferSize, context->maxFragLength);
+
+   //The receive buffer can be shrunk?
+   if(n < context->rxBufferSize && context->rxBufferLength == 0)
+   {
+      //Allocate a smaller buffer
+      buffer = osMemAlloc(TLS_RX_BUFFER_SIZE(n));
+
+      //Keep the current buffer if memory is short
+      if(buffer != NULL)
+      {
+         //Release the previous buffer
+         memset(context->rxBuffer, 0, TLS_RX_BUFFER_SIZE(context->rxBufferSize));
+         osMemFree(context->rxBuffer);
+
+         //Use the new buffer
+         memset(buffer, 0, TLS_RX_BUFFER_SIZE(n));
+         context->rxBuffer = buffer;
+         context->rxBufferSize = n;
+         context->rxBufferReadIndex = 0;
+         context->rxBufferWriteIndex = 0;
+      }
+   }
+}
+
+
 /**
  * @brief Encode a multiple precision integer to an opaque vector
  * @param[in] x Pointer to a multiple precision integer
@@ -716,6 +909,75 @@ error_t tlsReadMpi(Mpi *x, const uint8_t *data, size_t size, size_t *length)
 }
 
 
+/**
+ * @brief Encode an EC point to an opaque vector
+ *
+ * The point is preceded by a 1-byte length field (refer to RFC 4492,
+ * section 5.4)
+ *
+ * @param[in] context Pointer to the ECDH context holding the public value
+ * @param[out] data Buffer where to store the opaque vector
+ * @param[out] length Total number of bytes that have been written
+ * @return Error code
+ **/
+
+error_t tlsWriteEcPoint(EcdhContext *context, uint8_t *data, size_t *length)
+{
+   error_t error;
+   size_t n;
+
+   //Encode the public value (uncompressed point, or u-coordinate for X25519)
+   error = ecdhExportPublicKey(context, data + 1, &n);
+   //Any error to report?
+   if(error) return error;
+
+   //Set the length of the opaque vector
+   data[0] = (uint8_t) n;
+
+   //Return the total number of bytes that have been written
+   *length = n + 1;
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Read an EC point from an opaque vector
+ * @param[in] context Pointer to the ECDH context that receives the peer's public value
+ * @param[in] data Buffer where to read the opaque vector
+ * @param[in] size Total number of bytes available in the buffer
+ * @param[out] length Total number of bytes that have been read
+ * @return Error code
+ **/
+
+error_t tlsReadEcPoint(EcdhContext *context, const uint8_t *data, size_t size, size_t *length)
+{
+   error_t error;
+   size_t n;
+
+   //Buffer underrun?
+   if(size < 1)
+      return ERROR_DECODING_FAILED;
+
+   //Decode the length field
+   n = data[0];
+
+   //Buffer underrun?
+   if(size < (n + 1))
+      return ERROR_DECODING_FAILED;
+
+   //Load the peer's public value and make sure it is valid
+   error = ecdhImportPeerPublicKey(context, data + 1, n);
+   //Any error to report?
+   if(error) return error;
+
+   //Return the total number of bytes that have been read
+   *length = n + 1;
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Generate RSA signature (SSL 3.0, TLS 1.0 and TLS 1.1)
  * @param[in] key Signer's RSA private key
@@ -1014,6 +1276,86 @@ error_t tlsVerifyDsaSignature(const DsaPublicKey *key, const uint8_t *digest,
 }
 
 
+/**
+ * @brief Generate ECDSA signature
+ * @param[in] params EC domain parameters
+ * @param[in] prngAlgo PRNG algorithm
+ * @param[in] prngContext Pointer to the PRNG context
+ * @param[in] key Signer's ECDSA private key
+ * @param[in] digest Digest of the message to be signed
+ * @param[in] digestLength Length in octets of the digest
+ * @param[out] signature Resulting signature
+ * @param[out] signatureLength Length of the resulting signature
+ * @return Error code
+ **/
+
+error_t tlsGenerateEcdsaSignature(const EcDomainParameters *params, const PrngAlgo *prngAlgo,
+   void *prngContext, const Mpi *key, const uint8_t *digest, size_t digestLength,
+   uint8_t *signature, size_t *signatureLength)
+{
+   error_t error;
+   EcdsaSignature ecdsaSignature;
+
+   //Initialize ECDSA signature
+   ecdsaInitSignature(&ecdsaSignature);
+
+   //Generate ECDSA signature
+   error = ecdsaGenerateSignature(params, prngAlgo, prngContext,
+      key, digest, digestLength, &ecdsaSignature);
+
+   //Check status code
+   if(!error)
+   {
+      //Encode the resulting (R, S) integer pair using ASN.1
+      error = ecdsaWriteSignature(&ecdsaSignature, signature, signatureLength);
+   }
+
+   //Free previously allocated resources
+   ecdsaFreeSignature(&ecdsaSignature);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Verify ECDSA signature
+ * @param[in] params EC domain parameters
+ * @param[in] key Signer's ECDSA public key
+ * @param[in] digest Digest of the message whose signature is to be verified
+ * @param[in] digestLength Length in octets of the digest
+ * @param[in] signature Signature to be verified
+ * @param[in] signatureLength Length of the signature to be verified
+ * @return Error code
+ **/
+
+error_t tlsVerifyEcdsaSignature(const EcDomainParameters *params, const EcPoint *key,
+   const uint8_t *digest, size_t digestLength, const uint8_t *signature, size_t signatureLength)
+{
+   error_t error;
+   EcdsaSignature ecdsaSignature;
+
+   //Initialize ECDSA signature
+   ecdsaInitSignature(&ecdsaSignature);
+
+   //Read the ASN.1 encoded ECDSA signature
+   error = ecdsaReadSignature(signature, signatureLength, &ecdsaSignature);
+
+   //Check status code
+   if(!error)
+   {
+      //ECDSA signature verification
+      error = ecdsaVerifySignature(params, key, digest, digestLength, &ecdsaSignature);
+   }
+
+   //Free previously allocated resources
+   ecdsaFreeSignature(&ecdsaSignature);
+
+   //Return status code
+   return error;
+}
+
+
 /**
  * @brief Key generation
  * @param[in] context Pointer to the TLS context
@@ -1146,6 +1488,18 @@ error_t tlsGenerateKeys(TlsContext *context)
       context->writeIv = context->readIv + context->fixedIvLength;
    }
 
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_0 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   //TLS uses a HMAC construction for the record MAC
+   if(context->version >= TLS_VERSION_1_0 && context->macKeyLength > 0)
+   {
+      //Precompute the inner and outer pads once for the whole session
+      hmacInitKey(&context->writeHmacKey, context->hashAlgo,
+         context->writeMacKey, context->macKeyLength);
+      hmacInitKey(&context->readHmacKey, context->hashAlgo,
+         context->readMacKey, context->macKeyLength);
+   }
+#endif
+
    //Dump MAC keys for debugging purpose
    if(context->macKeyLength > 0)
    {
@@ -1202,12 +1556,24 @@ error_t tlsPrf(const uint8_t *secret, size_t secretLength, const char_t *label,
    size_t sLength;
    const uint8_t *s1;
    const uint8_t *s2;
+   HmacKey *key;
+   HmacContext *context;
    uint8_t a[SHA1_DIGEST_SIZE];
 
    //Allocate a memory buffer to hold the HMAC context
-   HmacContext *context = osMemAlloc(sizeof(HmacContext));
+   context = osMemAlloc(sizeof(HmacContext));
+   //Allocate a memory buffer to hold the precomputed key
+   key = osMemAlloc(sizeof(HmacKey));
+
    //Failed to allocate memory?
-   if(!context) return ERROR_OUT_OF_MEMORY;
+   if(!context || !key)
+   {
+      //Free previously allocated memory
+      osMemFree(context);
+      osMemFree(key);
+      //Report an error
+      return ERROR_OUT_OF_MEMORY;
+   }
 
    //Compute the length of the label
    labelLength = strlen(label);
@@ -1220,8 +1586,11 @@ error_t tlsPrf(const uint8_t *secret, size_t secretLength, const char_t *label,
    //S2 is taken from the second half
    s2 = secret + secretLength - sLength;
 
+   //Precompute the inner and outer pads for S1
+   hmacInitKey(key, MD5_HASH_ALGO, s1, sLength);
+
    //First compute A(1) = HMAC_MD5(S1, label + seed)
-   hmacInit(context, MD5_HASH_ALGO, s1, sLength);
+   hmacInitWithKey(context, key);
    hmacUpdate(context, label, labelLength);
    hmacUpdate(context, seed, seedLength);
    hmacFinal(context, a);
@@ -1230,7 +1599,7 @@ error_t tlsPrf(const uint8_t *secret, size_t secretLength, const char_t *label,
    for(i = 0; i < outputLength; )
    {
       //Compute HMAC_MD5(S1, A(i) + label + seed)
-      hmacInit(context, MD5_HASH_ALGO, s1, sLength);
+      hmacInitWithKey(context, key);
       hmacUpdate(context, a, MD5_DIGEST_SIZE);
       hmacUpdate(context, label, labelLength);
       hmacUpdate(context, seed, seedLength);
@@ -1241,13 +1610,16 @@ error_t tlsPrf(const uint8_t *secret, size_t secretLength, const char_t *label,
          output[i] = context->digest[j];
 
       //Compute A(i + 1) = HMAC_MD5(S1, A(i))
-      hmacInit(context, MD5_HASH_ALGO, s1, sLength);
+      hmacInitWithKey(context, key);
       hmacUpdate(context, a, MD5_DIGEST_SIZE);
       hmacFinal(context, a);
    }
 
+   //Precompute the inner and outer pads for S2
+   hmacInitKey(key, SHA1_HASH_ALGO, s2, sLength);
+
    //First compute A(1) = HMAC_SHA1(S2, label + seed)
-   hmacInit(context, SHA1_HASH_ALGO, s2, sLength);
+   hmacInitWithKey(context, key);
    hmacUpdate(context, label, labelLength);
    hmacUpdate(context, seed, seedLength);
    hmacFinal(context, a);
@@ -1256,7 +1628,7 @@ error_t tlsPrf(const uint8_t *secret, size_t secretLength, const char_t *label,
    for(i = 0; i < outputLength; )
    {
       //Compute HMAC_SHA1(S2, A(i) + label + seed)
-      hmacInit(context, SHA1_HASH_ALGO, s2, sLength);
+      hmacInitWithKey(context, key);
       hmacUpdate(context, a, SHA1_DIGEST_SIZE);
       hmacUpdate(context, label, labelLength);
       hmacUpdate(context, seed, seedLength);
@@ -1267,12 +1639,14 @@ error_t tlsPrf(const uint8_t *secret, size_t secretLength, const char_t *label,
          output[i] ^= context->digest[j];
 
       //Compute A(i + 1) = HMAC_SHA1(S2, A(i))
-      hmacInit(context, SHA1_HASH_ALGO, s2, sLength);
+      hmacInitWithKey(context, key);
       hmacUpdate(context, a, SHA1_DIGEST_SIZE);
       hmacFinal(context, a);
    }
 
-   //Free previously allocated memory
+   //Erase the precomputed key and free previously allocated memory
+   memset(key, 0, sizeof(HmacKey));
+   osMemFree(key);
    osMemFree(context);
    //Successful processing
    return NO_ERROR;
@@ -1303,18 +1677,33 @@ error_t tlsPrf2(const HashAlgo *hash, const uint8_t *secret, size_t secretLength
 {
    size_t n;
    size_t labelLength;
+   HmacKey *key;
+   HmacContext *context;
    uint8_t a[MAX_HASH_DIGEST_SIZE];
 
    //Allocate a memory buffer to hold the HMAC context
-   HmacContext *context = osMemAlloc(sizeof(HmacContext));
+   context = osMemAlloc(sizeof(HmacContext));
+   //Allocate a memory buffer to hold the precomputed key
+   key = osMemAlloc(sizeof(HmacKey));
+
    //Failed to allocate memory?
-   if(!context) return ERROR_OUT_OF_MEMORY;
+   if(!context || !key)
+   {
+      //Free previously allocated memory
+      osMemFree(context);
+      osMemFree(key);
+      //Report an error
+      return ERROR_OUT_OF_MEMORY;
+   }
 
    //Compute the length of the label
    labelLength = strlen(label);
 
+   //Precompute the inner and outer pads for the secret
+   hmacInitKey(key, hash, secret, secretLength);
+
    //First compute A(1) = HMAC_hash(secret, label + seed)
-   hmacInit(context, hash, secret, secretLength);
+   hmacInitWithKey(context, key);
    hmacUpdate(context, label, labelLength);
    hmacUpdate(context, seed, seedLength);
    hmacFinal(context, a);
@@ -1323,7 +1712,7 @@ error_t tlsPrf2(const HashAlgo *hash, const uint8_t *secret, size_t secretLength
    while(outputLength > 0)
    {
       //Compute HMAC_hash(secret, A(i) + label + seed)
-      hmacInit(context, hash, secret, secretLength);
+      hmacInitWithKey(context, key);
       hmacUpdate(context, a, hash->digestSize);
       hmacUpdate(context, label, labelLength);
       hmacUpdate(context, seed, seedLength);
@@ -1335,7 +1724,7 @@ error_t tlsPrf2(const HashAlgo *hash, const uint8_t *secret, size_t secretLength
       memcpy(output, context->digest, n);
 
       //Compute A(i + 1) = HMAC_hash(secret, A(i))
-      hmacInit(context, hash, secret, secretLength);
+      hmacInitWithKey(context, key);
       hmacUpdate(context, a, hash->digestSize);
       hmacFinal(context, a);
 
@@ -1345,7 +1734,9 @@ error_t tlsPrf2(const HashAlgo *hash, const uint8_t *secret, size_t secretLength
       outputLength -= n;
    }
 
-   //Free previously allocated memory
+   //Erase the precomputed key and free previously allocated memory
+   memset(key, 0, sizeof(HmacKey));
+   osMemFree(key);
    osMemFree(context);
    //Successful processing
    return NO_ERROR;
@@ -1371,7 +1762,7 @@ bool_t tlsIsCertificateAcceptable(const TlsCertDesc *cert, const uint8_t *certTy
    bool_t acceptable;
 
    //Make sure that a valid certificate has been loaded
-   if(!cert->certChain || !cert->certChainLength)
+   if(!cert->certList || !cert->certListLength)
       return FALSE;
 
    //This flag tells whether the certificate is acceptable
@@ -1422,14 +1813,7 @@ bool_t tlsIsCertificateAcceptable(const TlsCertDesc *cert, const uint8_t *certTy
       //may send any certificate of the appropriate type
       if(length > 0)
       {
-         error_t error;
          const uint8_t *p;
-         const char_t *pemCert;
-         size_t pemCertLength;
-         uint8_t *derCert;
-         size_t derCertSize;
-         size_t derCertLength;
-         X509CertificateInfo *certInfo;
 
          //The list of acceptable certificate authorities decribes the known roots CA
          acceptable = FALSE;
@@ -1437,76 +1821,34 @@ bool_t tlsIsCertificateAcceptable(const TlsCertDesc *cert, const uint8_t *certTy
          //Point to the first distinguished name
          p = certAuthorities->value;
 
-         //Point to the end entity certificate
-         pemCert = cert->certChain;
-         //Get the total length, in bytes, of the certificate chain
-         pemCertLength = cert->certChainLength;
-
-         //DER encoded certificate
-         derCert = NULL;
-         derCertSize = 0;
-         derCertLength = 0;
-
-         //Start of exception handling block
-         do
+         //Parse each distinguished name of the list
+         while(length > 0)
          {
-            //Allocate a memory buffer to store X.509 certificate info
-            certInfo = osMemAlloc(sizeof(X509CertificateInfo));
-            //Failed to allocate memory?
-            if(!certInfo) break;
-
-            //Point to the last certificate of the chain
-            do
-            {
-               //Read PEM certificates, one by one
-               error = pemReadCertificate(&pemCert, &pemCertLength,
-                  &derCert, &derCertSize, &derCertLength);
+            //Sanity check
+            if(length < 2)
+               break;
 
-               //Loop as long as necessary
-            } while(!error);
+            //Each distinguished name is preceded by a 2-byte length field
+            n = LOAD16BE(p);
 
-            //Any error to report?
-            if(error != ERROR_END_OF_FILE)
+            //Make sure the length field is valid
+            if(length < (n + 2))
                break;
 
-            //Parse the last certificate of the chain
-            error = x509ParseCertificate(derCert, derCertLength, certInfo);
-            //Failed to parse the X.509 certificate?
-            if(error) break;
-
-            //Parse each distinguished name of the list
-            while(length > 0)
+            //Check if the distinguished name matches the issuer of the last
+            //certificate of the chain, which has been retrieved when the
+            //certificate was loaded
+            if(n == cert->rootIssuerLength && !memcmp(p + 2, cert->rootIssuer, n))
             {
-               //Sanity check
-               if(length < 2)
-                  break;
-
-               //Each distinguished name is preceded by a 2-byte length field
-               n = LOAD16BE(p);
-
-               //Make sure the length field is valid
-               if(length < (n + 2))
-                  break;
-
-               //Check if the distinguished name matches the root CA
-               if(n == certInfo->issuer.rawDataLen && !memcmp(p + 2, certInfo->issuer.rawData, n))
-               {
-                  acceptable = TRUE;
-                  break;
-               }
-
-               //Advance data pointer
-               p += n + 2;
-               //Number of bytes left in the list
-               length -= n + 2;
+               acceptable = TRUE;
+               break;
             }
 
-            //End of exception handling block
-         } while(0);
-
-         //Release previously allocated memory
-         osMemFree(derCert);
-         osMemFree(certInfo);
+            //Advance data pointer
+            p += n + 2;
+            //Number of bytes left in the list
+            length -= n + 2;
+         }
       }
    }
 
@@ -1544,6 +1886,12 @@ error_t tlsGetCertificateType(const X509CertificateInfo *certInfo,
       //Save certificate type
       *certType = TLS_CERT_DSS_SIGN;
    }
+   //A valid EC public key has been found?
+   else if(certInfo->subjectPublicKey.namedCurve && certInfo->subjectPublicKey.ecPoint)
+   {
+      //Save certificate type
+      *certType = TLS_CERT_ECDSA_SIGN;
+   }
    //The certificate does not contain any valid public key...
    else
    {
@@ -1608,6 +1956,41 @@ error_t tlsGetCertificateType(const X509CertificateInfo *certInfo,
       *certSignAlgo = TLS_SIGN_ALGO_DSA;
       *certHashAlgo = TLS_HASH_ALGO_SHA256;
    }
+   else if(certInfo->signatureAlgoLen == sizeof(ECDSA_WITH_SHA1_OID) &&
+      !memcmp(certInfo->signatureAlgo, ECDSA_WITH_SHA1_OID, sizeof(ECDSA_WITH_SHA1_OID)))
+   {
+      //ECDSA with SHA-1 signature algorithm
+      *certSignAlgo = TLS_SIGN_ALGO_ECDSA;
+      *certHashAlgo = TLS_HASH_ALGO_SHA1;
+   }
+   else if(certInfo->signatureAlgoLen == sizeof(ECDSA_WITH_SHA224_OID) &&
+      !memcmp(certInfo->signatureAlgo, ECDSA_WITH_SHA224_OID, sizeof(ECDSA_WITH_SHA224_OID)))
+   {
+      //ECDSA with SHA-224 signature algorithm
+      *certSignAlgo = TLS_SIGN_ALGO_ECDSA;
+      *certHashAlgo = TLS_HASH_ALGO_SHA224;
+   }
+   else if(certInfo->signatureAlgoLen == sizeof(ECDSA_WITH_SHA256_OID) &&
+      !memcmp(certInfo->signatureAlgo, ECDSA_WITH_SHA256_OID, sizeof(ECDSA_WITH_SHA256_OID)))
+   {
+      //ECDSA with SHA-256 signature algorithm
+      *certSignAlgo = TLS_SIGN_ALGO_ECDSA;
+      *certHashAlgo = TLS_HASH_ALGO_SHA256;
+   }
+   else if(certInfo->signatureAlgoLen == sizeof(ECDSA_WITH_SHA384_OID) &&
+      !memcmp(certInfo->signatureAlgo, ECDSA_WITH_SHA384_OID, sizeof(ECDSA_WITH_SHA384_OID)))
+   {
+      //ECDSA with SHA-384 signature algorithm
+      *certSignAlgo = TLS_SIGN_ALGO_ECDSA;
+      *certHashAlgo = TLS_HASH_ALGO_SHA384;
+   }
+   else if(certInfo->signatureAlgoLen == sizeof(ECDSA_WITH_SHA512_OID) &&
+      !memcmp(certInfo->signatureAlgo, ECDSA_WITH_SHA512_OID, sizeof(ECDSA_WITH_SHA512_OID)))
+   {
+      //ECDSA with SHA-512 signature algorithm
+      *certSignAlgo = TLS_SIGN_ALGO_ECDSA;
+      *certHashAlgo = TLS_HASH_ALGO_SHA512;
+   }
    else
    {
       //The signature algorithm is not supported...
@@ -1619,6 +2002,24 @@ error_t tlsGetCertificateType(const X509CertificateInfo *certInfo,
 }
 
 
+/**
+ * @brief Get the signature algorithm that matches a given certificate type
+ * @param[in] certType Certificate type
+ * @return Signature algorithm that the certificate's key can produce
+ **/
+
+TlsSignatureAlgo tlsGetSignAlgo(TlsCertificateType certType)
+{
+   //Check certificate type
+   if(certType == TLS_CERT_DSS_SIGN)
+      return TLS_SIGN_ALGO_DSA;
+   else if(certType == TLS_CERT_ECDSA_SIGN)
+      return TLS_SIGN_ALGO_ECDSA;
+   else
+      return TLS_SIGN_ALGO_RSA;
+}
+
+
 /**
  * @brief Find the specified extension
  * @param[in] data Pointer to the list of extensions
@@ -1674,6 +2075,99 @@ const TlsExtension *tlsGetExtension(const uint8_t *data, size_t length, uint16_t
 }
 
 
+/**
+ * @brief Select an application protocol among those offered by the client
+ *
+ * The server's preferences prevail. No protocol is selected when none of
+ * the names offered by the client appear in the server's list
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] extension ALPN extension received from the client
+ * @return Error code
+ **/
+
+error_t tlsSelectAlpnProtocol(TlsContext *context, const TlsExtension *extension)
+{
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   size_t i;
+   size_t n;
+   size_t length;
+   const char_t *p;
+   const uint8_t *list;
+
+   //Retrieve the length of the extension
+   length = ntohs(extension->length);
+
+   //Malformed ProtocolNameList?
+   if(length < 2 || LOAD16BE(extension->value) != (length - 2))
+      return ERROR_DECODING_FAILED;
+
+   //Point to the list of protocol names
+   list = extension->value + 2;
+   length -= 2;
+
+   //The list must contain at least one non-empty name
+   if(length == 0)
+      return ERROR_DECODING_FAILED;
+
+   //Check the consistency of the list
+   for(i = 0; i < length; i += list[i] + 1)
+   {
+      //Empty names and truncated entries are not allowed
+      if(list[i] == 0 || (i + list[i] + 1) > length)
+         return ERROR_DECODING_FAILED;
+   }
+
+   //Forget the protocol negotiated during a previous handshake
+   osMemFree(context->selectedProtocol);
+   context->selectedProtocol = NULL;
+
+   //Nothing to negotiate?
+   if(context->protocolList == NULL)
+      return NO_ERROR;
+
+   //Walk through the server's list, by order of preference
+   for(p = context->protocolList; *p != '\0'; p += n)
+   {
+      //Skip separators
+      if(*p == ',')
+      {
+         n = 1;
+         continue;
+      }
+
+      //Length of the current protocol name
+      n = strcspn(p, ",");
+
+      //Search the client's list for the same name
+      for(i = 0; i < length; i += list[i] + 1)
+      {
+         //Matching protocol name?
+         if(list[i] == n && !memcmp(list + i + 1, p, n))
+         {
+            //Allocate a memory block to hold the name
+            context->selectedProtocol = osMemAlloc(n + 1);
+            //Failed to allocate memory?
+            if(!context->selectedProtocol) return ERROR_OUT_OF_MEMORY;
+
+            //Save the selected protocol
+            memcpy(context->selectedProtocol, p, n);
+            context->selectedProtocol[n] = '\0';
+
+            //Debug message
+            TRACE_INFO("ALPN protocol selected: %s\r\n", context->selectedProtocol);
+            //The server echoes its choice in the ServerHello
+            return NO_ERROR;
+         }
+      }
+   }
+#endif
+
+   //No common protocol
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Convert TLS version to string representation
  * @param[in] version Version number
@@ -1683,7 +2177,7 @@ const TlsExtension *tlsGetExtension(const uint8_t *data, size_t length, uint16_t
 const char_t *tlsGetVersionName(uint16_t version)
 {
    //TLS versions
-   static const char_t *label[] = {"SSL 3.0", "TLS 1.0", "TLS 1.1", "TLS 1.2", "Unknown"};
+   static const char_t *label[] = {"SSL 3.0", "TLS 1.0", "TLS 1.1", "TLS 1.2", "TLS 1.3", "Unknown"};
 
    //Check current version
    if(version == SSL_VERSION_3_0)
@@ -1694,8 +2188,10 @@ const char_t *tlsGetVersionName(uint16_t version)
       return label[2];
    else if(version == TLS_VERSION_1_2)
       return label[3];
-   else
+   else if(version == TLS_VERSION_1_3)
       return label[4];
+   else
+      return label[5];
 }
 
 
@@ -1730,4 +2226,50 @@ const HashAlgo *tlsGetHashAlgo(uint8_t hashAlgoId)
       return NULL;
 }
 
+
+/**
+ * @brief Get the hash algorithm implied by an RSASSA-PSS signature scheme
+ * @param[in] signAlgoId Signature algorithm identifier (rsa_pss_rsae_*)
+ * @return Cryptographic hash algorithm
+ **/
+
+const HashAlgo *tlsGetPssHashAlgo(uint8_t signAlgoId)
+{
+   //rsa_pss_rsae_sha256 signature scheme?
+   if(signAlgoId == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA256)
+      return SHA256_HASH_ALGO;
+   //rsa_pss_rsae_sha384 signature scheme?
+   else if(signAlgoId == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA384)
+      return SHA384_HASH_ALGO;
+   //rsa_pss_rsae_sha512 signature scheme?
+   else if(signAlgoId == TLS_SIGN_ALGO_RSA_PSS_RSAE_SHA512)
+      return SHA512_HASH_ALGO;
+   //Unknown signature scheme?
+   else
+      return NULL;
+}
+
+
+/**
+ * @brief Get the EC domain parameters that match the specified named curve
+ * @param[in] namedCurve Named curve identifier
+ * @return Elliptic curve domain parameters
+ **/
+
+const EcCurveInfo *tlsGetCurveInfo(uint16_t namedCurve)
+{
+   //secp256r1 elliptic curve?
+   if(namedCurve == TLS_EC_CURVE_SECP256R1)
+      return SECP256R1_CURVE;
+   //secp384r1 elliptic curve?
+   else if(namedCurve == TLS_EC_CURVE_SECP384R1)
+      return SECP384R1_CURVE;
+   //Curve25519 (X25519 key exchange)?
+   else if(namedCurve == TLS_EC_CURVE_ECDH_X25519)
+      return X25519_CURVE;
+   //Unknown curve identifier?
+   else
+      return NULL;
+}
+
 #endif
@@ -50,10 +50,14 @@ error_t tlsFinalizeHandshakeHash(TlsContext *context, const HashAlgo *hash,
    const void *hashContext, const char_t *label, uint8_t *output);
 
 error_t tlsComputeVerifyData(TlsContext *context, TlsConnectionEnd entity);
+void tlsFreeHandshakeState(TlsContext *context);
 
 error_t tlsWriteMpi(const Mpi *x, uint8_t *data, size_t *length);
 error_t tlsReadMpi(Mpi *x, const uint8_t *data, size_t size, size_t *length);
 
+error_t tlsWriteEcPoint(EcdhContext *context, uint8_t *data, size_t *length);
+error_t tlsReadEcPoint(EcdhContext *context, const uint8_t *data, size_t size, size_t *length);
+
 error_t tlsGenerateRsaSignature(const RsaPrivateKey *key,
    const uint8_t *digest, uint8_t *signature, size_t *signatureLength);
 
@@ -66,6 +70,13 @@ error_t tlsGenerateDsaSignature(const PrngAlgo *prngAlgo, void *prngContext, con
 error_t tlsVerifyDsaSignature(const DsaPublicKey *key, const uint8_t *digest,
    size_t digestLength, const uint8_t *signature, size_t signatureLength);
 
+error_t tlsGenerateEcdsaSignature(const EcDomainParameters *params, const PrngAlgo *prngAlgo,
+   void *prngContext, const Mpi *key, const uint8_t *digest, size_t digestLength,
+   uint8_t *signature, size_t *signatureLength);
+
+error_t tlsVerifyEcdsaSignature(const EcDomainParameters *params, const EcPoint *key,
+   const uint8_t *digest, size_t digestLength, const uint8_t *signature, size_t signatureLength);
+
 error_t tlsGenerateKeys(TlsContext *context);
 
 error_t tlsPrf(const uint8_t *secret, size_t secretLength, const char_t *label,
@@ -80,8 +91,13 @@ bool_t tlsIsCertificateAcceptable(const TlsCertDesc *cert, const uint8_t *certTy
 error_t tlsGetCertificateType(const X509CertificateInfo *certInfo,
    TlsCertificateType *certType, TlsSignatureAlgo *certSignAlgo, TlsHashAlgo *certHashAlgo);
 
+TlsSignatureAlgo tlsGetSignAlgo(TlsCertificateType certType);
+
 const TlsExtension *tlsGetExtension(const uint8_t *data, size_t length, uint16_t type);
+error_t tlsSelectAlpnProtocol(TlsContext *context, const TlsExtension *extension);
 const char_t *tlsGetVersionName(uint16_t version);
 const HashAlgo *tlsGetHashAlgo(uint8_t hashAlgoId);
+const HashAlgo *tlsGetPssHashAlgo(uint8_t signAlgoId);
+const EcCurveInfo *tlsGetCurveInfo(uint16_t namedCurve);
 
 #endif
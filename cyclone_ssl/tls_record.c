@@ -40,6 +40,8 @@
 #include "cipher_mode_cbc.h"
 #include "cipher_mode_ccm.h"
 #include "cipher_mode_gcm.h"
+#include "chacha20_poly1305.h"
+#include "probe.h"
 #include "debug.h"
 
 //Check SSL library configuration
@@ -59,19 +61,23 @@ error_t tlsWriteProtocolData(TlsContext *context,
 {
    error_t error;
    size_t n;
+   size_t maxFragLength;
    uint8_t *p;
 
    //Check the length of the data block
-   if(length > TLS_MAX_PROTOCOL_DATA_LENGTH)
+   if(length > context->txBufferSize)
       return ERROR_MESSAGE_TOO_LONG;
 
+   //The record length cannot exceed the negotiated limits
+   maxFragLength = min(context->maxFragLength, context->recordSizeLimit);
+
    //The hash value is updated for each handshake message,
    //except for HelloRequest messages
    if(contentType == TLS_TYPE_HANDSHAKE)
       tlsUpdateHandshakeHash(context, context->txBuffer + sizeof(TlsRecord), length);
 
    //All the data fits into a TLS single record?
-   if(length <= TLS_MAX_RECORD_LENGTH)
+   if(length <= maxFragLength)
    {
       //Send TLS record
       error = tlsWriteRecord(context, length, contentType);
@@ -88,8 +94,14 @@ error_t tlsWriteProtocolData(TlsContext *context,
       //Fragmentation process
       while(length > 0)
       {
-         //The record length cannot exceed 16384 bytes
-         n = min(length, TLS_MAX_RECORD_LENGTH);
+         //Limit the length of the current fragment
+         n = min(length, maxFragLength);
+
+         //The previous fragment must leave the TX buffer first
+         error = tlsIoFlush(context, TRUE);
+         //Any error to report?
+         if(error) return error;
+
          //Move current chunk of data to the beginning of the buffer
          memmove(context->txBuffer + sizeof(TlsRecord), p, n);
 
@@ -137,7 +149,8 @@ error_t tlsReadProtocolData(TlsContext *context,
       if(context->rxBufferLength == 0)
       {
          //Read a TLS record
-         error = tlsReadRecord(context, context->rxBuffer, TLS_RX_BUFFER_SIZE, &n, &type);
+         error = tlsReadRecord(context, context->rxBuffer,
+            TLS_RX_BUFFER_SIZE(context->rxBufferSize), &n, &type);
          //Any error to report?
          if(error) return error;
 
@@ -168,7 +181,7 @@ error_t tlsReadProtocolData(TlsContext *context,
 
          //Read a TLS record
          error = tlsReadRecord(context, context->rxBuffer + context->rxBufferWriteIndex,
-            TLS_RX_BUFFER_SIZE - context->rxBufferLength, &n, &type);
+            TLS_RX_BUFFER_SIZE(context->rxBufferSize) - context->rxBufferLength, &n, &type);
          //Any error to report?
          if(error) return error;
 
@@ -289,21 +302,128 @@ error_t tlsReadProtocolData(TlsContext *context,
 
 error_t tlsWriteRecord(TlsContext *context,
    size_t length, TlsContentType contentType)
+{
+   size_t n;
+   uint8_t *p;
+
+   //Instrumentation point
+   PROBE_ENTER(PROBE_TLS_WRITE_RECORD);
+
+   //Point to the record data
+   p = context->txBuffer + sizeof(TlsRecord);
+   //Length of the explicit IV that precedes the record data
+   n = tlsGetRecordIvLength(context);
+
+   //Make room for the explicit IV at the beginning of the data
+   if(n > 0)
+      memmove(p + n, p, length);
+
+   //Protect and send the record
+   return tlsWriteRecordData(context, p + n, length, contentType);
+}
+
+
+/**
+ * @brief Protect and send a TLS record whose data is held by the caller
+ *
+ * The record is built in the send buffer. Stream and AEAD ciphers read the
+ * plaintext directly from the caller's buffer, so that application data is
+ * never copied before being encrypted. When the data already lies at its
+ * final position in the send buffer, the record is protected in place
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] data Pointer to the record data
+ * @param[in] length Actual length of the record data
+ * @param[in] contentType Record type
+ * @return Error code
+ **/
+
+error_t tlsWriteRecordData(TlsContext *context, const void *data,
+   size_t length, TlsContentType contentType)
 {
    error_t error;
    uint_t i;
+   size_t n;
+   size_t macLength;
    size_t paddingLength;
+   uint8_t *p;
+   TlsRecord *record;
 
    //Point to the TLS record
-   TlsRecord *record = (TlsRecord *) context->txBuffer;
+   record = (TlsRecord *) context->txBuffer;
    //Format TLS record
    record->type = contentType;
-   record->version = htons(context->version);
+   record->version = htons(min(context->version, TLS_VERSION_1_2));
    record->length = htons(length);
 
+   //Length of the explicit IV that precedes the record data
+   n = tlsGetRecordIvLength(context);
+   //Point to the final location of the record data
+   p = record->data + n;
+   //No MAC appended so far
+   macLength = 0;
+
    //Debug message
    TRACE_DEBUG("Sending TLS record...\r\n");
-   TRACE_DEBUG_ARRAY("  ", record, length + sizeof(TlsRecord));
+   TRACE_DEBUG_ARRAY("  ", record, sizeof(TlsRecord));
+   TRACE_DEBUG_ARRAY("  ", data, length);
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //TLS 1.3 record protection?
+   if(context->changeCipherSpecSent && context->version == TLS_VERSION_1_3)
+   {
+      //Encrypt the record using the AEAD algorithm of the cipher suite
+      error = tls13EncryptRecord(context, record, data, length);
+      //Any error to report?
+      if(error) return error;
+
+      //Compute the length of the complete TLS record
+      length = ntohs(record->length) + sizeof(TlsRecord);
+      //Send TLS record
+      TLS_PROFILE_START(context, TLS_PROFILE_IO);
+      error = tlsIoWrite(context, record, length);
+      TLS_PROFILE_STOP(context, TLS_PROFILE_IO);
+
+      //Return status code
+      return error;
+   }
+#endif
+
+#if (TLS_CBC_CIPHER_SUPPORT == ENABLED && TLS_MAX_VERSION >= TLS_VERSION_1_0 && \
+   TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   //CBC block cipher combined with HMAC?
+   if(context->changeCipherSpecSent && context->cipherAlgo != NULL &&
+      context->cipherMode == CIPHER_MODE_CBC && context->hashAlgo != NULL &&
+      context->version >= TLS_VERSION_1_0)
+   {
+      //Compute the MAC and encrypt the record in a single pass
+      error = tlsEncryptCbcRecord(context, record, data, length);
+      //Any error to report?
+      if(error) return error;
+
+      //Compute the length of the complete TLS record
+      length = ntohs(record->length) + sizeof(TlsRecord);
+      //Send TLS record
+      TLS_PROFILE_START(context, TLS_PROFILE_IO);
+      error = tlsIoWrite(context, record, length);
+      TLS_PROFILE_STOP(context, TLS_PROFILE_IO);
+
+      //Return status code
+      return error;
+   }
+#endif
+
+   //Only stream and AEAD ciphers can read the plaintext from another buffer
+   if(!context->changeCipherSpecSent || context->cipherAlgo == NULL ||
+      context->cipherMode == CIPHER_MODE_CBC)
+   {
+      //Copy the data to their final location, if necessary
+      if(data != p)
+         memcpy(p, data, length);
+
+      //The record is protected in place
+      data = p;
+   }
 
    //Protect record payload?
    if(context->changeCipherSpecSent)
@@ -317,7 +437,7 @@ error_t tlsWriteRecord(TlsContext *context,
          {
             //SSL 3.0 uses an older obsolete version of the HMAC construction
             error = sslComputeMac(context, context->writeMacKey,
-               context->writeSeqNum, record, record->data, length, record->data + length);
+               context->writeSeqNum, record, data, length, p + length);
             //Any error to report?
             if(error) return error;
          }
@@ -328,13 +448,13 @@ error_t tlsWriteRecord(TlsContext *context,
          if(context->version >= TLS_VERSION_1_0)
          {
             //TLS uses a HMAC construction
-            hmacInit(&context->hmacContext, context->hashAlgo,
-               context->writeMacKey, context->macKeyLength);
+            hmacInitWithKey(&context->hmacContext, &context->writeHmacKey);
             //Compute MAC over the sequence number and the record contents
             hmacUpdate(&context->hmacContext, context->writeSeqNum, sizeof(TlsSequenceNumber));
-            hmacUpdate(&context->hmacContext, record, length + sizeof(TlsRecord));
+            hmacUpdate(&context->hmacContext, record, sizeof(TlsRecord));
+            hmacUpdate(&context->hmacContext, data, length);
             //Append the resulting MAC to the message
-            hmacFinal(&context->hmacContext, record->data + length);
+            hmacFinal(&context->hmacContext, p + length);
          }
          else
 #endif
@@ -348,12 +468,12 @@ error_t tlsWriteRecord(TlsContext *context,
          TRACE_DEBUG("Write sequence number:\r\n");
          TRACE_DEBUG_ARRAY("  ", context->writeSeqNum, sizeof(TlsSequenceNumber));
          TRACE_DEBUG("Computed MAC:\r\n");
-         TRACE_DEBUG_ARRAY("  ", record->data + length, context->hashAlgo->digestSize);
+         TRACE_DEBUG_ARRAY("  ", p + length, context->hashAlgo->digestSize);
 
-         //Adjust the length of the message
-         length += context->hashAlgo->digestSize;
+         //Length of the MAC
+         macLength = context->hashAlgo->digestSize;
          //Fix length field
-         record->length = htons(length);
+         record->length = htons(length + macLength);
 
          //Increment sequence number
          tlsIncSequenceNumber(context->writeSeqNum);
@@ -366,12 +486,15 @@ error_t tlsWriteRecord(TlsContext *context,
          //Stream cipher?
          if(context->cipherMode == CIPHER_MODE_STREAM)
          {
-            //Debug message
-            TRACE_DEBUG("Record before encryption:\r\n");
-            TRACE_DEBUG_ARRAY("  ", record, length + sizeof(TlsRecord));
             //Encrypt record contents
             context->cipherAlgo->encryptStream(context->writeCipherContext,
-               record->data, record->data, length);
+               data, p, length);
+            //Encrypt the MAC
+            context->cipherAlgo->encryptStream(context->writeCipherContext,
+               p + length, p + length, macLength);
+
+            //Adjust the length of the message
+            length += macLength;
          }
          else
 #endif
@@ -379,21 +502,21 @@ error_t tlsWriteRecord(TlsContext *context,
          //CBC block cipher?
          if(context->cipherMode == CIPHER_MODE_CBC)
          {
+            //Adjust the length of the message
+            length += macLength;
+
 #if (TLS_MAX_VERSION >= TLS_VERSION_1_1 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
             //TLS 1.1 and 1.2 use an explicit IV
-            if(context->version >= TLS_VERSION_1_1)
+            if(n > 0)
             {
-               //Make room for the IV at the beginning of the data
-               memmove(record->data + context->recordIvLength, record->data, length);
-
                //The initialization vector should be chosen at random
                error = context->prngAlgo->read(context->prngContext,
-                  record->data, context->recordIvLength);
+                  record->data, n);
                //Any error to report?
                if(error) return error;
 
                //Adjust the length of the message
-               length += context->recordIvLength;
+               length += n;
             }
 #endif
             //Get the actual amount of bytes in the last block
@@ -424,12 +547,13 @@ error_t tlsWriteRecord(TlsContext *context,
          }
          else
 #endif
-#if (TLS_CCM_CIPHER_SUPPORT == ENABLED || TLS_GCM_CIPHER_SUPPORT == ENABLED)
+#if (TLS_CCM_CIPHER_SUPPORT == ENABLED || TLS_GCM_CIPHER_SUPPORT == ENABLED || \
+   TLS_CHACHA20_POLY1305_SUPPORT == ENABLED)
          //AEAD cipher?
          if(context->cipherMode == CIPHER_MODE_CCM ||
-            context->cipherMode == CIPHER_MODE_GCM)
+            context->cipherMode == CIPHER_MODE_GCM ||
+            context->cipherMode == CIPHER_MODE_CHACHA20_POLY1305)
          {
-            uint8_t *data;
             uint8_t *tag;
             size_t nonceLength;
             uint8_t nonce[12];
@@ -440,14 +564,24 @@ error_t tlsWriteRecord(TlsContext *context,
             //The salt is the implicit part of the nonce and is not sent in the packet
             memcpy(nonce, context->writeIv, context->fixedIvLength);
 
-            //The explicit part of the nonce is chosen by the sender
-            error = context->prngAlgo->read(context->prngContext,
-               nonce + context->fixedIvLength, context->recordIvLength);
-            //Any error to report?
-            if(error) return error;
+#if (TLS_CHACHA20_POLY1305_SUPPORT == ENABLED)
+            //ChaCha20Poly1305 cipher mode?
+            if(context->cipherMode == CIPHER_MODE_CHACHA20_POLY1305)
+            {
+               //The nonce is formed by XORing the write IV with the
+               //sequence number, left-padded with zeroes (RFC 7905)
+               tlsXorSequenceNumber(nonce + 4, context->writeSeqNum);
+            }
+            else
+#endif
+            {
+               //The explicit part of the nonce is chosen by the sender
+               error = context->prngAlgo->read(context->prngContext,
+                  nonce + context->fixedIvLength, context->recordIvLength);
+               //Any error to report?
+               if(error) return error;
+            }
 
-            //Make room for the explicit nonce at the beginning of the record
-            memmove(record->data + context->recordIvLength, record->data, length);
             //The explicit part of the nonce is carried in each TLS record
             memcpy(record->data, nonce + context->fixedIvLength, context->recordIvLength);
 
@@ -455,10 +589,8 @@ error_t tlsWriteRecord(TlsContext *context,
             memcpy(a, context->writeSeqNum, sizeof(TlsSequenceNumber));
             memcpy(a + sizeof(TlsSequenceNumber), record, sizeof(TlsRecord));
 
-            //Plaintext data
-            data = record->data + context->recordIvLength;
             //Buffer where to store the authentication tag
-            tag = data + length;
+            tag = p + length;
 
 #if (TLS_CCM_CIPHER_SUPPORT == ENABLED)
             //CCM cipher mode?
@@ -466,7 +598,7 @@ error_t tlsWriteRecord(TlsContext *context,
             {
                //Authenticated encryption using CCM
                error = ccmEncrypt(context->cipherAlgo, context->writeCipherContext,
-                  nonce, nonceLength, a, 13, data, data, length, tag, context->authTagLength);
+                  nonce, nonceLength, a, 13, data, p, length, tag, context->authTagLength);
             }
             else
 #endif
@@ -476,7 +608,17 @@ error_t tlsWriteRecord(TlsContext *context,
             {
                //Authenticated encryption using GCM
                error = gcmEncrypt(context->cipherAlgo, context->writeCipherContext,
-                  nonce, nonceLength, a, 13, data, data, length, tag, context->authTagLength);
+                  nonce, nonceLength, a, 13, data, p, length, tag, context->authTagLength);
+            }
+            else
+#endif
+#if (TLS_CHACHA20_POLY1305_SUPPORT == ENABLED)
+            //ChaCha20Poly1305 cipher mode?
+            if(context->cipherMode == CIPHER_MODE_CHACHA20_POLY1305)
+            {
+               //Authenticated encryption using ChaCha20Poly1305
+               error = chacha20Poly1305Encrypt(context->writeEncKey, context->encKeyLength,
+                  nonce, nonceLength, a, 13, data, p, length, tag, context->authTagLength);
             }
             else
 #endif
@@ -509,12 +651,415 @@ error_t tlsWriteRecord(TlsContext *context,
          TRACE_DEBUG("Encrypted record:\r\n");
          TRACE_DEBUG_ARRAY("  ", record, length + sizeof(TlsRecord));
       }
+      else
+      {
+         //The MAC immediately follows the record data
+         length += macLength;
+      }
    }
 
    //Compute the length of the complete TLS record
    length += sizeof(TlsRecord);
    //Send TLS record
-   return tlsIoWrite(context, record, length);
+   TLS_PROFILE_START(context, TLS_PROFILE_IO);
+   error = tlsIoWrite(context, record, length);
+   TLS_PROFILE_STOP(context, TLS_PROFILE_IO);
+
+   //Return status code
+   return error;
+}
+
+
+#if (TLS_CBC_CIPHER_SUPPORT == ENABLED && TLS_MAX_VERSION >= TLS_VERSION_1_0 && \
+   TLS_MIN_VERSION <= TLS_VERSION_1_2)
+
+/**
+ * @brief Compute the MAC and encrypt a record in a single pass (CBC ciphers)
+ *
+ * The record data are processed one hash block at a time. Each chunk is
+ * authenticated and then encrypted while it is still in cache, instead of
+ * running the HMAC and the CBC encryption over the whole record one after
+ * the other
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in,out] record TLS record whose header has been formatted
+ * @param[in] data Plaintext to be protected
+ * @param[in] length Length of the plaintext, in bytes
+ * @return Error code
+ **/
+
+error_t tlsEncryptCbcRecord(TlsContext *context, TlsRecord *record,
+   const uint8_t *data, size_t length)
+{
+   error_t error;
+   size_t i;
+   size_t k;
+   size_t n;
+   size_t ivLength;
+   size_t macLength;
+   size_t blockSize;
+   size_t paddingLength;
+   uint8_t *p;
+
+   //Block size of the cipher
+   blockSize = context->cipherAlgo->blockSize;
+   //Length of the MAC
+   macLength = context->hashAlgo->digestSize;
+   //Length of the explicit IV that precedes the record data
+   ivLength = tlsGetRecordIvLength(context);
+   //Point to the final location of the record data
+   p = record->data + ivLength;
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_1)
+   //TLS 1.1 and 1.2 use an explicit IV
+   if(ivLength > 0)
+   {
+      //The initialization vector should be chosen at random
+      error = context->prngAlgo->read(context->prngContext,
+         record->data, ivLength);
+      //Any error to report?
+      if(error) return error;
+
+      //The explicit IV forms the first cipher block
+      error = cbcEncrypt(context->cipherAlgo, context->writeCipherContext,
+         context->writeIv, record->data, record->data, ivLength);
+      //Any error to report?
+      if(error) return error;
+   }
+#endif
+
+   //TLS uses a HMAC construction
+   hmacInitWithKey(&context->hmacContext, &context->writeHmacKey);
+   //Compute MAC over the sequence number and the record header
+   hmacUpdate(&context->hmacContext, context->writeSeqNum, sizeof(TlsSequenceNumber));
+   hmacUpdate(&context->hmacContext, record, sizeof(TlsRecord));
+
+   //Number of plaintext bytes that form complete cipher blocks
+   n = length - (length % blockSize);
+
+   //Process the plaintext one hash block at a time
+   for(i = 0; i < length; i += k)
+   {
+      //Size of the current chunk
+      k = min(length - i, context->hashAlgo->blockSize);
+
+      //Authenticate the chunk before it is overwritten by the ciphertext
+      hmacUpdate(&context->hmacContext, data + i, k);
+
+      //Encrypt the complete cipher blocks of the chunk
+      if(i < n)
+      {
+         //CBC encryption
+         error = cbcEncrypt(context->cipherAlgo, context->writeCipherContext,
+            context->writeIv, data + i, p + i, min(k, n - i));
+         //Any error to report?
+         if(error) return error;
+      }
+   }
+
+   //The last partial block is completed with the MAC and the padding
+   if(data != p)
+      memcpy(p + n, data + n, length - n);
+
+   //Append the resulting MAC to the message
+   hmacFinal(&context->hmacContext, p + length);
+
+   //Debug message
+   TRACE_DEBUG("Write sequence number:\r\n");
+   TRACE_DEBUG_ARRAY("  ", context->writeSeqNum, sizeof(TlsSequenceNumber));
+   TRACE_DEBUG("Computed MAC:\r\n");
+   TRACE_DEBUG_ARRAY("  ", p + length, macLength);
+
+   //Increment sequence number
+   tlsIncSequenceNumber(context->writeSeqNum);
+
+   //Length of the message, including the explicit IV and the MAC
+   length += ivLength + macLength;
+
+   //Get the actual amount of bytes in the last block
+   paddingLength = (length + 1) % blockSize;
+   //Padding is added to force the length of the plaintext to be
+   //an integral multiple of the cipher's block length
+   if(paddingLength > 0)
+      paddingLength = blockSize - paddingLength;
+
+   //Write padding bytes
+   for(i = 0; i <= paddingLength; i++)
+      record->data[length + i] = paddingLength;
+
+   //Compute the length of the resulting message
+   length += paddingLength + 1;
+   //Fix length field
+   record->length = htons(length);
+
+   //Encrypt the remaining blocks
+   error = cbcEncrypt(context->cipherAlgo, context->writeCipherContext,
+      context->writeIv, p + n, p + n, length - ivLength - n);
+   //Any error to report?
+   if(error) return error;
+
+   //Debug message
+   TRACE_DEBUG("Encrypted record:\r\n");
+   TRACE_DEBUG_ARRAY("  ", record, length + sizeof(TlsRecord));
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+#endif
+
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+
+/**
+ * @brief Protect a TLS 1.3 record
+ *
+ * The content type is appended to the plaintext, which is then encrypted
+ * using the AEAD algorithm of the cipher suite. The outer content type is
+ * always application_data (refer to RFC 8446, section 5.2)
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in,out] record TLS record whose header has been formatted
+ * @param[in] data Plaintext to be protected
+ * @param[in] length Length of the plaintext, in bytes
+ * @return Error code
+ **/
+
+error_t tls13EncryptRecord(TlsContext *context, TlsRecord *record,
+   const uint8_t *data, size_t length)
+{
+   error_t error;
+   uint8_t *tag;
+   uint8_t nonce[12];
+
+   //Copy the data to their final location, if necessary
+   if(data != record->data)
+      memcpy(record->data, data, length);
+
+   //The actual content type follows the record data
+   record->data[length++] = record->type;
+
+   //Format the header of the TLSCiphertext structure
+   record->type = TLS_TYPE_APPLICATION_DATA;
+   record->version = htons(TLS_VERSION_1_2);
+   record->length = htons(length + context->authTagLength);
+
+   //The nonce is formed by XORing the write IV with the
+   //sequence number, left-padded with zeroes
+   memcpy(nonce, context->writeIv, 12);
+   tlsXorSequenceNumber(nonce + 4, context->writeSeqNum);
+
+   //Buffer where to store the authentication tag
+   tag = record->data + length;
+
+#if (TLS_CCM_CIPHER_SUPPORT == ENABLED)
+   //CCM cipher mode?
+   if(context->cipherMode == CIPHER_MODE_CCM)
+   {
+      //Authenticated encryption using CCM. The record header is used
+      //as additional data
+      error = ccmEncrypt(context->cipherAlgo, context->writeCipherContext, nonce, 12,
+         (uint8_t *) record, sizeof(TlsRecord), record->data, record->data, length, tag, context->authTagLength);
+   }
+   else
+#endif
+#if (TLS_GCM_CIPHER_SUPPORT == ENABLED)
+   //GCM cipher mode?
+   if(context->cipherMode == CIPHER_MODE_GCM)
+   {
+      //Authenticated encryption using GCM. The record header is used
+      //as additional data
+      error = gcmEncrypt(context->cipherAlgo, context->writeCipherContext, nonce, 12,
+         (uint8_t *) record, sizeof(TlsRecord), record->data, record->data, length, tag, context->authTagLength);
+   }
+   else
+#endif
+#if (TLS_CHACHA20_POLY1305_SUPPORT == ENABLED)
+   //ChaCha20Poly1305 cipher mode?
+   if(context->cipherMode == CIPHER_MODE_CHACHA20_POLY1305)
+   {
+      //Authenticated encryption using ChaCha20Poly1305. The record header
+      //is used as additional data
+      error = chacha20Poly1305Encrypt(context->writeEncKey, context->encKeyLength, nonce, 12,
+         (uint8_t *) record, sizeof(TlsRecord), record->data, record->data, length, tag, context->authTagLength);
+   }
+   else
+#endif
+   //Invalid cipher mode?
+   {
+      //The specified cipher mode is not supported
+      error = ERROR_UNSUPPORTED_CIPHER_MODE;
+   }
+
+   //Failed to encrypt data?
+   if(error) return error;
+
+   //Debug message
+   TRACE_DEBUG("Encrypted record:\r\n");
+   TRACE_DEBUG_ARRAY("  ", record, ntohs(record->length) + sizeof(TlsRecord));
+
+   //Increment sequence number
+   tlsIncSequenceNumber(context->writeSeqNum);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Unprotect a TLS 1.3 record
+ *
+ * The record is decrypted in place. The padding is then removed and the
+ * actual content type is copied to the record header
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in,out] record TLS record header
+ * @param[in,out] data Record data
+ * @param[in,out] length Length of the record data (before and after processing)
+ * @return Error code
+ **/
+
+error_t tls13DecryptRecord(TlsContext *context, TlsRecord *record,
+   uint8_t *data, size_t *length)
+{
+   error_t error;
+   size_t n;
+   uint8_t *tag;
+   uint8_t nonce[12];
+
+   //Protected records always use the application_data outer type
+   if(record->type != TLS_TYPE_APPLICATION_DATA)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //Retrieve the length of the encrypted record
+   n = *length;
+
+   //Make sure the message length is acceptable
+   if(n < context->authTagLength)
+      return ERROR_DECODING_FAILED;
+
+   //Calculate the length of the ciphertext
+   n -= context->authTagLength;
+   //Point to the authentication tag
+   tag = data + n;
+
+   //The nonce is formed by XORing the read IV with the
+   //sequence number, left-padded with zeroes
+   memcpy(nonce, context->readIv, 12);
+   tlsXorSequenceNumber(nonce + 4, context->readSeqNum);
+
+#if (TLS_CCM_CIPHER_SUPPORT == ENABLED)
+   //CCM cipher mode?
+   if(context->cipherMode == CIPHER_MODE_CCM)
+   {
+      //Decryption and verification (using CCM)
+      error = ccmDecrypt(context->cipherAlgo, context->readCipherContext, nonce, 12,
+         (uint8_t *) record, sizeof(TlsRecord), data, data, n, tag, context->authTagLength);
+   }
+   else
+#endif
+#if (TLS_GCM_CIPHER_SUPPORT == ENABLED)
+   //GCM cipher mode?
+   if(context->cipherMode == CIPHER_MODE_GCM)
+   {
+      //Decryption and verification (using GCM)
+      error = gcmDecrypt(context->cipherAlgo, context->readCipherContext, nonce, 12,
+         (uint8_t *) record, sizeof(TlsRecord), data, data, n, tag, context->authTagLength);
+   }
+   else
+#endif
+#if (TLS_CHACHA20_POLY1305_SUPPORT == ENABLED)
+   //ChaCha20Poly1305 cipher mode?
+   if(context->cipherMode == CIPHER_MODE_CHACHA20_POLY1305)
+   {
+      //Decryption and verification (using ChaCha20Poly1305)
+      error = chacha20Poly1305Decrypt(context->readEncKey, context->encKeyLength, nonce, 12,
+         (uint8_t *) record, sizeof(TlsRecord), data, data, n, tag, context->authTagLength);
+   }
+   else
+#endif
+   //Invalid cipher mode?
+   {
+      //The specified cipher mode is not supported
+      return ERROR_UNSUPPORTED_CIPHER_MODE;
+   }
+
+   //Wrong authentication tag?
+   if(error)
+   {
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+      //The server skips the early data it has rejected, i.e. the records
+      //that cannot be decrypted with the handshake traffic keys
+      if(context->earlyDataRejected)
+         return ERROR_MESSAGE_DISCARDED;
+#endif
+      //Report an error
+      return ERROR_BAD_RECORD_MAC;
+   }
+
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+   //The first record protected with the handshake traffic keys marks
+   //the end of the rejected early data
+   context->earlyDataRejected = FALSE;
+#endif
+
+   //Increment sequence number
+   tlsIncSequenceNumber(context->readSeqNum);
+
+   //Remove the zero padding that may follow the content type
+   while(n > 0 && data[n - 1] == 0)
+      n--;
+
+   //Records without a non-zero content type must be rejected
+   if(n == 0)
+      return ERROR_UNEXPECTED_MESSAGE;
+
+   //Retrieve the actual content type
+   record->type = data[--n];
+   //Fix the length field of the TLS record
+   record->length = htons(n);
+
+   //Debug message
+   TRACE_DEBUG("Decrypted record (%u bytes):\r\n", n);
+   TRACE_DEBUG_ARRAY("  ", data, n);
+
+   //Actual length of the record data
+   *length = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+#endif
+
+
+/**
+ * @brief Get the length of the explicit IV carried in each outgoing record
+ * @param[in] context Pointer to the TLS context
+ * @return Length of the explicit IV, in bytes
+ **/
+
+size_t tlsGetRecordIvLength(TlsContext *context)
+{
+   //Record payload not protected yet?
+   if(!context->changeCipherSpecSent || context->cipherAlgo == NULL)
+      return 0;
+
+#if (TLS_CBC_CIPHER_SUPPORT == ENABLED)
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_1 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   //TLS 1.1 and 1.2 use an explicit IV with CBC block ciphers
+   if(context->cipherMode == CIPHER_MODE_CBC && context->version >= TLS_VERSION_1_1)
+      return context->recordIvLength;
+#endif
+#endif
+#if (TLS_CCM_CIPHER_SUPPORT == ENABLED || TLS_GCM_CIPHER_SUPPORT == ENABLED)
+   //The explicit part of the nonce is carried in each AEAD record
+   if(context->cipherMode == CIPHER_MODE_CCM || context->cipherMode == CIPHER_MODE_GCM)
+      return context->recordIvLength;
+#endif
+
+   //No explicit IV
+   return 0;
 }
 
 
@@ -532,29 +1077,125 @@ error_t tlsReadRecord(TlsContext *context, uint8_t *data,
    size_t size, size_t *length, TlsContentType *contentType)
 {
    error_t error;
-   size_t i;
-   size_t n;
-   size_t paddingLength;
    TlsRecord record;
 
-   //Read TLS record header
-   error = tlsIoRead(context, &record, sizeof(TlsRecord));
+   //Instrumentation point
+   PROBE_ENTER(PROBE_TLS_READ_RECORD);
+
+   //Records that must be ignored are silently dropped
+   do
+   {
+      //Read TLS record header
+      error = tlsReadRecordHeader(context, &record);
+
+      //Read record contents
+      if(!error)
+         error = tlsReadRecordData(context, &record, data, size, length);
+
+      //Read the next record if the current one has been discarded
+   } while(error == ERROR_MESSAGE_DISCARDED);
+
    //Any error to report?
    if(error) return error;
 
+   //Record type
+   *contentType = (TlsContentType) record.type;
+
+   //The TLS record has been successfully read
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Read the header of the next TLS record
+ * @param[in] context Pointer to the TLS context
+ * @param[out] record Buffer where to store the record header
+ * @return Error code
+ **/
+
+error_t tlsReadRecordHeader(TlsContext *context, TlsRecord *record)
+{
+   error_t error;
+
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+   //Non-blocking mode?
+   if(context->nonBlocking)
+   {
+      //The header is accumulated in the context across calls
+      if(context->rxRecordPos < sizeof(TlsRecord))
+      {
+         //Read the missing part of the header
+         TLS_PROFILE_START(context, TLS_PROFILE_IO);
+         error = tlsIoReadPartial(context, &context->rxRecord,
+            sizeof(TlsRecord), &context->rxRecordPos);
+         TLS_PROFILE_STOP(context, TLS_PROFILE_IO);
+         //Any error to report?
+         if(error) return error;
+      }
+
+      //Return the header of the current record
+      memcpy(record, &context->rxRecord, sizeof(TlsRecord));
+   }
+   else
+#endif
+   {
+      //Read TLS record header
+      TLS_PROFILE_START(context, TLS_PROFILE_IO);
+      error = tlsIoRead(context, record, sizeof(TlsRecord));
+      TLS_PROFILE_STOP(context, TLS_PROFILE_IO);
+      //Any error to report?
+      if(error) return error;
+   }
+
    //Debug message
    TRACE_DEBUG("Record header:\r\n");
-   TRACE_DEBUG_ARRAY("  ", &record, sizeof(record));
+   TRACE_DEBUG_ARRAY("  ", record, sizeof(TlsRecord));
 
    //Check current state
    if(context->state > TLS_STATE_SERVER_HELLO)
    {
       //Once the server has sent the ServerHello message, enforce
-      //incoming record versions
-      if(ntohs(record.version) != context->version)
+      //incoming record versions. TLS 1.3 records carry the legacy
+      //version number of TLS 1.2
+      if(ntohs(record->version) != min(context->version, TLS_VERSION_1_2))
          return ERROR_VERSION_NOT_SUPPORTED;
    }
 
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Read and unprotect the contents of a TLS record
+ *
+ * In non-blocking mode, a record may be received by several calls. The
+ * caller must then pass the same buffer until the function succeeds
+ *
+ * With TLS 1.3, the content type of a protected record is only known
+ * once the record has been decrypted. The type field of the header is
+ * then updated accordingly
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in,out] header Record header returned by tlsReadRecordHeader()
+ * @param[out] data Buffer where to store the record data
+ * @param[in] size Maximum acceptable size for the incoming record
+ * @param[out] length Actual length of the record data
+ * @return Error code
+ **/
+
+error_t tlsReadRecordData(TlsContext *context, TlsRecord *header,
+   uint8_t *data, size_t size, size_t *length)
+{
+   error_t error;
+   size_t i;
+   size_t n;
+   size_t paddingLength;
+   TlsRecord record;
+
+   //The length field is adjusted while the record is being processed
+   memcpy(&record, header, sizeof(TlsRecord));
+
    //Convert the length field to host byte order
    n = ntohs(record.length);
 
@@ -562,11 +1203,89 @@ error_t tlsReadRecord(TlsContext *context, uint8_t *data,
    if(n > size)
       return ERROR_RECORD_OVERFLOW;
 
-   //Read record contents
-   error = tlsIoRead(context, data, n);
-   //Any error to report?
-   if(error) return error;
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+   //Non-blocking mode?
+   if(context->nonBlocking)
+   {
+      //Number of bytes of the record data received by previous calls
+      i = context->rxRecordPos - sizeof(TlsRecord);
+
+      //Read the missing part of the record contents
+      TLS_PROFILE_START(context, TLS_PROFILE_IO);
+      error = tlsIoReadPartial(context, data, n, &i);
+      TLS_PROFILE_STOP(context, TLS_PROFILE_IO);
+
+      //Save the progress made so far
+      context->rxRecordPos = sizeof(TlsRecord) + i;
+      //Any error to report?
+      if(error) return error;
 
+      //The next call will start with a new record
+      context->rxRecordPos = 0;
+   }
+   else
+#endif
+   {
+      //Read record contents
+      TLS_PROFILE_START(context, TLS_PROFILE_IO);
+      error = tlsIoRead(context, data, n);
+      TLS_PROFILE_STOP(context, TLS_PROFILE_IO);
+      //Any error to report?
+      if(error) return error;
+   }
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //TLS 1.3 currently selected?
+   if(context->version == TLS_VERSION_1_3)
+   {
+      //ChangeCipherSpec records may be sent for middlebox compatibility
+      //and must be dropped (refer to RFC 8446, section 5)
+      if(record.type == TLS_TYPE_CHANGE_CIPHER_SPEC)
+      {
+         //The record must consist of the single byte value 0x01
+         if(n != 1 || data[0] != 0x01)
+            return ERROR_UNEXPECTED_MESSAGE;
+
+         //Discard the record
+         return ERROR_MESSAGE_DISCARDED;
+      }
+
+      //Record payload is protected?
+      if(context->changeCipherSpecReceived)
+      {
+         //Decrypt the record and retrieve its actual content type
+         error = tls13DecryptRecord(context, &record, data, &n);
+         //Any error to report?
+         if(error) return error;
+      }
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+      else if(context->earlyDataRejected &&
+         record.type == TLS_TYPE_APPLICATION_DATA)
+      {
+         //The server skips the early data it has rejected
+         return ERROR_MESSAGE_DISCARDED;
+      }
+#endif
+
+      //Return the actual content type of the record
+      header->type = record.type;
+   }
+   else
+#endif
+#if (TLS_CBC_CIPHER_SUPPORT == ENABLED && TLS_MAX_VERSION >= TLS_VERSION_1_0 && \
+   TLS_MIN_VERSION <= TLS_VERSION_1_2)
+   //CBC block cipher combined with HMAC?
+   if(context->changeCipherSpecReceived && context->cipherAlgo != NULL &&
+      context->cipherMode == CIPHER_MODE_CBC && context->hashAlgo != NULL &&
+      context->version >= TLS_VERSION_1_0)
+   {
+      //Decrypt the record and check its MAC in a single pass
+      error = tlsDecryptCbcRecord(context, &record, data, &n);
+      //Any error to report?
+      if(error) return error;
+   }
+   else
+#endif
    //Record payload is protected?
    if(context->changeCipherSpecReceived)
    {
@@ -649,10 +1368,12 @@ error_t tlsReadRecord(TlsContext *context, uint8_t *data,
          }
          else
 #endif
-#if (TLS_CCM_CIPHER_SUPPORT == ENABLED || TLS_GCM_CIPHER_SUPPORT == ENABLED)
+#if (TLS_CCM_CIPHER_SUPPORT == ENABLED || TLS_GCM_CIPHER_SUPPORT == ENABLED || \
+   TLS_CHACHA20_POLY1305_SUPPORT == ENABLED)
          //AEAD cipher?
          if(context->cipherMode == CIPHER_MODE_CCM ||
-            context->cipherMode == CIPHER_MODE_GCM)
+            context->cipherMode == CIPHER_MODE_GCM ||
+            context->cipherMode == CIPHER_MODE_CHACHA20_POLY1305)
          {
             uint8_t *ciphertext;
             uint8_t *tag;
@@ -671,6 +1392,16 @@ error_t tlsReadRecord(TlsContext *context, uint8_t *data,
             //The explicit part of the nonce is chosen by the sender
             memcpy(nonce + context->fixedIvLength, data, context->recordIvLength);
 
+#if (TLS_CHACHA20_POLY1305_SUPPORT == ENABLED)
+            //ChaCha20Poly1305 cipher mode?
+            if(context->cipherMode == CIPHER_MODE_CHACHA20_POLY1305)
+            {
+               //The nonce is formed by XORing the read IV with the
+               //sequence number, left-padded with zeroes (RFC 7905)
+               tlsXorSequenceNumber(nonce + 4, context->readSeqNum);
+            }
+#endif
+
             //Calculate the length of the ciphertext
             n -= context->recordIvLength + context->authTagLength;
             //Fix the length field of the TLS record
@@ -704,6 +1435,16 @@ error_t tlsReadRecord(TlsContext *context, uint8_t *data,
                   nonceLength, a, 13, ciphertext, ciphertext, n, tag, context->authTagLength);
             }
             else
+#endif
+#if (TLS_CHACHA20_POLY1305_SUPPORT == ENABLED)
+            //ChaCha20Poly1305 cipher mode?
+            if(context->cipherMode == CIPHER_MODE_CHACHA20_POLY1305)
+            {
+               //Decryption and verification (using ChaCha20Poly1305)
+               error = chacha20Poly1305Decrypt(context->readEncKey, context->encKeyLength, nonce,
+                  nonceLength, a, 13, ciphertext, ciphertext, n, tag, context->authTagLength);
+            }
+            else
 #endif
             //Invalid cipher mode?
             {
@@ -762,7 +1503,7 @@ error_t tlsReadRecord(TlsContext *context, uint8_t *data,
          if(context->version >= TLS_VERSION_1_0)
          {
             //TLS uses a HMAC construction
-            hmacInit(&context->hmacContext, context->hashAlgo, context->readMacKey, context->macKeyLength);
+            hmacInitWithKey(&context->hmacContext, &context->readHmacKey);
             //Compute MAC over the sequence number and the record contents
             hmacUpdate(&context->hmacContext, context->readSeqNum, sizeof(TlsSequenceNumber));
             hmacUpdate(&context->hmacContext, &record, sizeof(TlsRecord));
@@ -794,14 +1535,169 @@ error_t tlsReadRecord(TlsContext *context, uint8_t *data,
 
    //Actual length of the record data
    *length = n;
-   //Record type
-   *contentType = (TlsContentType) record.type;
 
-   //The TLS record has been successfully read
+   //The record contents have been successfully read
    return NO_ERROR;
 }
 
 
+#if (TLS_CBC_CIPHER_SUPPORT == ENABLED && TLS_MAX_VERSION >= TLS_VERSION_1_0 && \
+   TLS_MIN_VERSION <= TLS_VERSION_1_2)
+
+/**
+ * @brief Decrypt a record and check its MAC in a single pass (CBC ciphers)
+ *
+ * The last cipher block is decrypted first so that the padding length, and
+ * hence the length of the authenticated data, is known before the record is
+ * processed. Each chunk is then decrypted and immediately authenticated
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in,out] record TLS record header
+ * @param[in,out] data Record data
+ * @param[in,out] length Length of the record data (before and after processing)
+ * @return Error code
+ **/
+
+error_t tlsDecryptCbcRecord(TlsContext *context, TlsRecord *record,
+   uint8_t *data, size_t *length)
+{
+   error_t error;
+   size_t i;
+   size_t k;
+   size_t m;
+   size_t n;
+   size_t ivLength;
+   size_t macLength;
+   size_t blockSize;
+   size_t paddingLength;
+   uint8_t *c;
+   uint8_t block[16];
+
+   //Length of the record data
+   n = *length;
+   //Block size of the cipher
+   blockSize = context->cipherAlgo->blockSize;
+   //Length of the MAC
+   macLength = context->hashAlgo->digestSize;
+   //Length of the explicit IV
+   ivLength = 0;
+
+   //Debug message
+   TRACE_DEBUG("Encrypted record (%u bytes):\r\n", n);
+   TRACE_DEBUG_ARRAY("  ", data, n);
+
+   //The length of the data must be a multiple of the block size
+   if((n % blockSize) != 0)
+      return ERROR_DECODING_FAILED;
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_1)
+   //TLS 1.1 and 1.2 use an explicit IV
+   if(context->version >= TLS_VERSION_1_1)
+   {
+      //Make sure the message length is acceptable
+      if(n < context->recordIvLength)
+         return ERROR_DECODING_FAILED;
+
+      //The explicit IV is the chaining value for the first cipher block
+      ivLength = context->recordIvLength;
+      memcpy(context->readIv, data, ivLength);
+   }
+#endif
+
+   //Point to the ciphertext
+   c = data + ivLength;
+   //Length of the ciphertext
+   n -= ivLength;
+
+   //Make sure the message length is acceptable
+   if(n < blockSize)
+      return ERROR_DECODING_FAILED;
+
+   //Decrypt the last block to retrieve the padding length
+   context->cipherAlgo->decryptBlock(context->readCipherContext,
+      c + n - blockSize, block);
+
+   //The chaining value is either the previous cipher block or the IV
+   if(n > blockSize)
+      paddingLength = block[blockSize - 1] ^ c[n - blockSize - 1];
+   else
+      paddingLength = block[blockSize - 1] ^ context->readIv[blockSize - 1];
+
+   //Erroneous padding length?
+   if(paddingLength >= n)
+      return ERROR_BAD_RECORD_MAC;
+   //Make sure the message length is acceptable
+   if((n - paddingLength - 1) < macLength)
+      return ERROR_DECODING_FAILED;
+
+   //Length of the authenticated data
+   m = n - paddingLength - 1 - macLength;
+   //Fix the length field of the TLS record
+   record->length = htons(m);
+
+   //TLS uses a HMAC construction
+   hmacInitWithKey(&context->hmacContext, &context->readHmacKey);
+   //Compute MAC over the sequence number and the record header
+   hmacUpdate(&context->hmacContext, context->readSeqNum, sizeof(TlsSequenceNumber));
+   hmacUpdate(&context->hmacContext, record, sizeof(TlsRecord));
+
+   //Process the ciphertext one hash block at a time
+   for(i = 0; i < n; i += k)
+   {
+      //Size of the current chunk
+      k = min(n - i, context->hashAlgo->blockSize);
+
+      //CBC decryption (the explicit IV is discarded by writing the
+      //plaintext at the beginning of the buffer)
+      error = cbcDecrypt(context->cipherAlgo, context->readCipherContext,
+         context->readIv, c + i, data + i, k);
+      //Any error to report?
+      if(error) return error;
+
+      //Authenticate the decrypted data
+      if(i < m)
+         hmacUpdate(&context->hmacContext, data + i, min(k, m - i));
+   }
+
+   //Finalize the MAC computation
+   hmacFinal(&context->hmacContext, NULL);
+
+   //Debug message
+   TRACE_DEBUG("Decrypted record (%u bytes):\r\n", n);
+   TRACE_DEBUG_ARRAY("  ", data, n);
+
+   //The receiver must check the padding
+   for(i = 0; i <= paddingLength; i++)
+   {
+      //Each byte in the padding data must be filled
+      //with the padding length value
+      if(data[n - 1 - i] != paddingLength)
+         return ERROR_BAD_RECORD_MAC;
+   }
+
+   //Debug message
+   TRACE_DEBUG("Read sequence number:\r\n");
+   TRACE_DEBUG_ARRAY("  ", context->readSeqNum, sizeof(TlsSequenceNumber));
+   TRACE_DEBUG("Computed MAC:\r\n");
+   TRACE_DEBUG_ARRAY("  ", context->hmacContext.digest, macLength);
+
+   //Check the message authentication code
+   if(memcmp(data + m, context->hmacContext.digest, macLength))
+      return ERROR_BAD_RECORD_MAC;
+
+   //Increment sequence number
+   tlsIncSequenceNumber(context->readSeqNum);
+
+   //Actual length of the record data
+   *length = m;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+#endif
+
+
 /**
  * @brief Increment sequence number
  * @param[in] seqNum Sequence number to increment
@@ -822,4 +1718,20 @@ void tlsIncSequenceNumber(TlsSequenceNumber seqNum)
    }
 }
 
+
+/**
+ * @brief XOR a block of data with a sequence number
+ * @param[in,out] data Block of data (8 bytes)
+ * @param[in] seqNum Sequence number
+ **/
+
+void tlsXorSequenceNumber(uint8_t *data, const TlsSequenceNumber seqNum)
+{
+   uint_t i;
+
+   //Sequence numbers are stored MSB first
+   for(i = 0; i < sizeof(TlsSequenceNumber); i++)
+      data[i] ^= seqNum[i];
+}
+
 #endif
@@ -42,9 +42,31 @@ error_t tlsReadProtocolData(TlsContext *context,
 error_t tlsWriteRecord(TlsContext *context,
    size_t length, TlsContentType contentType);
 
+error_t tlsWriteRecordData(TlsContext *context, const void *data,
+   size_t length, TlsContentType contentType);
+
 error_t tlsReadRecord(TlsContext *context, uint8_t *data,
    size_t size, size_t *length, TlsContentType *contentType);
 
+error_t tlsReadRecordHeader(TlsContext *context, TlsRecord *record);
+
+error_t tlsReadRecordData(TlsContext *context, TlsRecord *header,
+   uint8_t *data, size_t size, size_t *length);
+
+error_t tlsEncryptCbcRecord(TlsContext *context, TlsRecord *record,
+   const uint8_t *data, size_t length);
+
+error_t tlsDecryptCbcRecord(TlsContext *context, TlsRecord *record,
+   uint8_t *data, size_t *length);
+
+error_t tls13EncryptRecord(TlsContext *context, TlsRecord *record,
+   const uint8_t *data, size_t length);
+
+error_t tls13DecryptRecord(TlsContext *context, TlsRecord *record,
+   uint8_t *data, size_t *length);
+
+size_t tlsGetRecordIvLength(TlsContext *context);
 void tlsIncSequenceNumber(TlsSequenceNumber seqNum);
+void tlsXorSequenceNumber(uint8_t *data, const TlsSequenceNumber seqNum);
 
 #endif
@@ -42,8 +42,14 @@
 #include "tls_server.h"
 #include "tls_common.h"
 #include "tls_record.h"
+#include "tls_io.h"
 #include "tls_cache.h"
+#include "tls_ticket.h"
 #include "tls_misc.h"
+#include "tls_crypto_worker.h"
+#include "tls_dh_key_pool.h"
+#include "tls13_misc.h"
+#include "tls13_server.h"
 #include "x509.h"
 #include "pem.h"
 #include "debug.h"
@@ -66,13 +72,51 @@ error_t tlsServerHandshake(TlsContext *context)
 {
    error_t error;
 
-   //The client initiates the TLS handshake by sending
-   //a ClientHello message to the server
-   context->state = TLS_STATE_CLIENT_HELLO;
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+   //A handshake stopped by a would-block condition resumes where it stopped
+   if(context->handshakePending)
+      context->handshakePending = FALSE;
+   else
+#endif
+   {
+      //The client initiates the TLS handshake by sending
+      //a ClientHello message to the server
+      context->state = TLS_STATE_CLIENT_HELLO;
+      //Start measuring the handshake duration
+      TLS_PROFILE_START(context, TLS_PROFILE_HANDSHAKE);
+   }
 
    //Wait for the handshake to complete
    while(context->state != TLS_STATE_APPLICATION_DATA)
    {
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+      //Data the socket has not accepted yet must be sent before the TX
+      //buffer is reused or a response is awaited
+      error = tlsIoFlush(context, FALSE);
+
+      //The socket is not ready?
+      if(error == ERROR_WOULD_BLOCK)
+      {
+         //The next call resumes the handshake in the current state
+         context->handshakePending = TRUE;
+         break;
+      }
+      else if(error)
+      {
+         //Exit immediately
+         break;
+      }
+#endif
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+      //TLS 1.3 has its own set of handshake messages
+      if(context->version == TLS_VERSION_1_3)
+      {
+         //Process the current state of the TLS 1.3 handshake
+         error = tls13ServerHandshakeStep(context);
+      }
+      else
+#endif
       //The TLS handshake is implemented as a state machine
       //representing the current location in the protocol
       switch(context->state)
@@ -95,7 +139,9 @@ error_t tlsServerHandshake(TlsContext *context)
          //The ServerKeyExchange message is sent by the server only when the
          //server Certificate message (if sent) does not contain enough data
          //to allow the client to exchange a premaster secret
+         TLS_PROFILE_START(context, TLS_PROFILE_KEY_EXCHANGE);
          error = tlsSendServerKeyExchange(context);
+         TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_EXCHANGE);
          break;
       //Send Certificate message?
       case TLS_STATE_CERTIFICATE_REQUEST:
@@ -110,6 +156,14 @@ error_t tlsServerHandshake(TlsContext *context)
          //end of the ServerHello and associated messages
          error = tlsSendServerHelloDone(context);
          break;
+#if (TLS_TICKET_SUPPORT == ENABLED)
+      //Send NewSessionTicket message?
+      case TLS_STATE_NEW_SESSION_TICKET:
+         //The NewSessionTicket message is sent by the server just before
+         //its ChangeCipherSpec message
+         error = tlsSendNewSessionTicket(context);
+         break;
+#endif
       //Send ChangeCipherSpec message?
       case TLS_STATE_SERVER_CHANGE_CIPHER_SPEC:
          //The ChangeCipherSpec message is sent by the server and to notify the
@@ -151,6 +205,15 @@ error_t tlsServerHandshake(TlsContext *context)
       //Abort TLS handshake if an error was encountered
       if(error)
       {
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+         //The socket is not ready?
+         if(error == ERROR_WOULD_BLOCK)
+         {
+            //The next call resumes the handshake in the current state
+            context->handshakePending = TRUE;
+            break;
+         }
+#endif
          //Send an alert message to the client
          tlsProcessError(context, error);
          //Exit immediately
@@ -158,11 +221,31 @@ error_t tlsServerHandshake(TlsContext *context)
       }
    }
 
+#if (TLS_NON_BLOCKING_SUPPORT == ENABLED)
+   //The handshake is not complete yet?
+   if(error == ERROR_WOULD_BLOCK)
+      return error;
+#endif
+
+   //The handshake is either complete or has failed
+   TLS_PROFILE_STOP(context, TLS_PROFILE_HANDSHAKE);
+
    //Successful TLS handshake?
    if(!error)
    {
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+      //TLS 1.3 sessions are only resumed with tickets
+      if(context->version <= TLS_VERSION_1_2)
+#endif
+#if (TLS_TICKET_SUPPORT == ENABLED)
+      //The state of a session is carried by its ticket
+      if(!context->newSessionTicket)
+#endif
       //Save current session in the session cache for further reuse
       tlsSaveToCache(context);
+
+      //Only the record layer state is needed from now on
+      tlsFreeHandshakeState(context);
    }
 
    //Return status code
@@ -205,7 +288,9 @@ error_t tlsParseClientMessage(TlsContext *context)
          //This is the first message the client can send after receiving a
          //ServerHelloDone message. This message is only sent if the server
          //requests a certificate
+         TLS_PROFILE_START(context, TLS_PROFILE_CERTIFICATE);
          error = tlsParseCertificate(context, message, length);
+         TLS_PROFILE_STOP(context, TLS_PROFILE_CERTIFICATE);
          break;
       //ClientKeyExchange message received?
       case TLS_TYPE_CLIENT_KEY_EXCHANGE:
@@ -213,7 +298,9 @@ error_t tlsParseClientMessage(TlsContext *context)
          //follow the client certificate message, if it is sent. Otherwise,
          //it must be the first message sent by the client after it receives
          //the ServerHelloDone message
+         TLS_PROFILE_START(context, TLS_PROFILE_KEY_EXCHANGE);
          error = tlsParseClientKeyExchange(context, message, length);
+         TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_EXCHANGE);
          break;
       //CertificateVerify message received?
       case TLS_TYPE_CERTIFICATE_VERIFY:
@@ -221,7 +308,9 @@ error_t tlsParseClientMessage(TlsContext *context)
          //certificate. This message is only sent following a client certificate
          //that has signing capability. When sent, it must immediately follow
          //the clientKeyExchange message
+         TLS_PROFILE_START(context, TLS_PROFILE_KEY_EXCHANGE);
          error = tlsParseCertificateVerify(context, message, length);
+         TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_EXCHANGE);
          break;
       //Finished message received?
       case TLS_TYPE_FINISHED:
@@ -284,9 +373,12 @@ error_t tlsParseClientMessage(TlsContext *context)
 error_t tlsSendServerHello(TlsContext *context)
 {
    error_t error;
+   size_t n;
    size_t length;
    uint8_t *p;
    TlsServerHello *message;
+   TlsExtensions *extensionList;
+   TlsExtension *extension;
 
    //Get the current time
    uint32_t t = (uint32_t) osGetTime();
@@ -301,6 +393,15 @@ error_t tlsSendServerHello(TlsContext *context)
    //Any error to report?
    if(error) return error;
 
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //A TLS 1.3 server that negotiates an older version signals the
+   //downgrade in the last eight bytes of its random value
+   if(context->version == TLS_VERSION_1_2)
+      memcpy(context->serverRandom.randomBytes + 20, tls13DowngradeTls12Sentinel, 8);
+   else
+      memcpy(context->serverRandom.randomBytes + 20, tls13DowngradeTls11Sentinel, 8);
+#endif
+
    //Point to the ServerHello message
    message = (TlsServerHello *) (context->txBuffer + sizeof(TlsRecord));
    //Format message header
@@ -351,6 +452,131 @@ error_t tlsSendServerHello(TlsContext *context)
    //Adjust the length of the message
    length += sizeof(TlsCompressionMethod);
 
+   //Point to the list of extensions
+   extensionList = (TlsExtensions *) p;
+   //Total length of the extension list
+   extensionList->length = 0;
+
+   //Point to the first extension
+   p += sizeof(TlsExtensions);
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //The server uses an empty SessionTicket extension to indicate
+   //that it will send a new ticket
+   if(context->newSessionTicket)
+   {
+      //Format the SessionTicket extension
+      extension = (TlsExtension *) p;
+      extension->type = HTONS(TLS_EXT_SESSION_TICKET);
+      extension->length = HTONS(0);
+
+      //Fix the length of the extension list
+      extensionList->length += sizeof(TlsExtension);
+      //Advance data pointer
+      p += sizeof(TlsExtension);
+   }
+#endif
+
+#if (TLS_MAX_FRAG_LENGTH_SUPPORT == ENABLED)
+   //The server echoes the maximum fragment length requested by the client
+   if(context->maxFragLength < TLS_MAX_RECORD_LENGTH)
+   {
+      //Format the MaxFragmentLength extension
+      extension = (TlsExtension *) p;
+      extension->type = HTONS(TLS_EXT_MAX_FRAGMENT_LENGTH);
+      extension->length = HTONS(1);
+
+      //The maximum fragment length is encoded as 2^(8 + n)
+      for(n = TLS_MAX_FRAG_LENGTH_512; (256U << n) < context->maxFragLength; n++);
+      //Copy the encoded value
+      extension->value[0] = (uint8_t) n;
+
+      //Fix the length of the extension list
+      extensionList->length += sizeof(TlsExtension) + 1;
+      //Advance data pointer
+      p += sizeof(TlsExtension) + 1;
+   }
+#endif
+
+#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+   //The server replies with its own limit when the client has sent
+   //a RecordSizeLimit extension
+   if(context->recordSizeLimitExt)
+   {
+      //Format the RecordSizeLimit extension
+      extension = (TlsExtension *) p;
+      extension->type = HTONS(TLS_EXT_RECORD_SIZE_LIMIT);
+      extension->length = HTONS(sizeof(uint16_t));
+
+      //Maximum size of the records the server is willing to receive
+      n = min(context->rxBufferSize, TLS_MAX_RECORD_LENGTH);
+      STORE16BE(n, extension->value);
+
+      //Fix the length of the extension list
+      extensionList->length += sizeof(TlsExtension) + sizeof(uint16_t);
+      //Advance data pointer
+      p += sizeof(TlsExtension) + sizeof(uint16_t);
+   }
+#endif
+
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   //The server echoes the application protocol it has selected
+   if(context->selectedProtocol != NULL)
+   {
+      //Length of the protocol name
+      n = strlen(context->selectedProtocol);
+
+      //Format the ALPN extension
+      extension = (TlsExtension *) p;
+      extension->type = HTONS(TLS_EXT_ALPN);
+      extension->length = htons(n + 3);
+
+      //The ProtocolNameList contains exactly one name
+      STORE16BE(n + 1, extension->value);
+      extension->value[2] = (uint8_t) n;
+      memcpy(extension->value + 3, context->selectedProtocol, n);
+
+      //Fix the length of the extension list
+      extensionList->length += sizeof(TlsExtension) + n + 3;
+      //Advance data pointer
+      p += sizeof(TlsExtension) + n + 3;
+   }
+#endif
+
+#if (TLS_ECDHE_RSA_SUPPORT == ENABLED || TLS_ECDHE_ECDSA_SUPPORT == ENABLED)
+   //A server that selects an ECC cipher suite appends the EcPointFormats
+   //extension to its ServerHello message (refer to RFC 4492, section 5.2)
+   if(context->keyExchMethod == TLS_KEY_EXCH_ECDHE_RSA ||
+      context->keyExchMethod == TLS_KEY_EXCH_ECDHE_ECDSA)
+   {
+      TlsEcPointFormatList *pointFormatList;
+
+      //Format the EcPointFormats extension
+      extension = (TlsExtension *) p;
+      extension->type = HTONS(TLS_EXT_EC_POINT_FORMATS);
+      extension->length = HTONS(sizeof(TlsEcPointFormatList) + 1);
+
+      //Only the uncompressed format is supported
+      pointFormatList = (TlsEcPointFormatList *) extension->value;
+      pointFormatList->length = 1;
+      pointFormatList->value[0] = TLS_EC_POINT_FORMAT_UNCOMPRESSED;
+
+      //Fix the length of the extension list
+      extensionList->length += sizeof(TlsExtension) + sizeof(TlsEcPointFormatList) + 1;
+      //Advance data pointer
+      p += sizeof(TlsExtension) + sizeof(TlsEcPointFormatList) + 1;
+   }
+#endif
+
+   //The extension list is omitted when empty
+   if(extensionList->length > 0)
+   {
+      //Adjust the length of the message
+      length += sizeof(TlsExtensions) + extensionList->length;
+      //Convert the length of the extension list to network byte order
+      extensionList->length = htons(extensionList->length);
+   }
+
    //Fix the length field
    STORE24BE(length - sizeof(TlsHandshake), message->length);
 
@@ -368,10 +594,18 @@ error_t tlsSendServerHello(TlsContext *context)
    if(context->resume)
    {
       //Derive session keys from the master secret
+      TLS_PROFILE_START(context, TLS_PROFILE_KEY_DERIVATION);
       error = tlsGenerateKeys(context);
+      TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_DERIVATION);
       //Unable to generate key material?
       if(error) return error;
 
+#if (TLS_TICKET_SUPPORT == ENABLED)
+      //The server may renew the ticket of a resumed session
+      if(context->newSessionTicket)
+         context->state = TLS_STATE_NEW_SESSION_TICKET;
+      else
+#endif
       //At this point, both client and server must send ChangeCipherSpec
       //messages and proceed directly to Finished messages
       context->state = TLS_STATE_SERVER_CHANGE_CIPHER_SPEC;
@@ -400,6 +634,65 @@ error_t tlsSendServerHello(TlsContext *context)
  **/
 
 error_t tlsSendServerKeyExchange(TlsContext *context)
+{
+   error_t error;
+   size_t length;
+   TlsServerKeyExchange *message;
+
+   //The ServerKeyExchange message is not sent when RSA is used for key agreement
+   if(context->keyExchMethod == TLS_KEY_EXCH_RSA)
+   {
+      //Prepare to send a CertificateRequest message...
+      context->state = TLS_STATE_CERTIFICATE_REQUEST;
+      //Successful processing
+      return NO_ERROR;
+   }
+
+   //Point to the ServerKeyExchange message
+   message = (TlsServerKeyExchange *) (context->txBuffer + sizeof(TlsRecord));
+
+   //Generate and sign the server's key exchange parameters
+   error = tlsRunCryptoJob(context, tlsFormatServerKeyExchange, message, &length);
+   //Any error to report?
+   if(error) return error;
+
+   //Format message header
+   message->msgType = TLS_TYPE_SERVER_KEY_EXCHANGE;
+   STORE24BE(length, message->length);
+   //Length of the complete handshake message
+   length += sizeof(TlsHandshake);
+
+   //Debug message
+   TRACE_INFO("Sending ServerKeyExchange message (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //Send handshake message
+   error = tlsWriteProtocolData(context, length, TLS_TYPE_HANDSHAKE);
+   //Failed to send TLS record?
+   if(error) return error;
+
+   //Prepare to send a CertificateRequest message...
+   context->state = TLS_STATE_CERTIFICATE_REQUEST;
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Format the body of the ServerKeyExchange message
+ *
+ * The server's ephemeral key pair is generated and the key exchange
+ * parameters are signed using the server's private key. This function
+ * holds the public-key operations of the message and may therefore be
+ * run by a crypto worker task
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[out] data Buffer where to format the ServerKeyExchange message
+ * @param[out] written Length of the message body, in bytes
+ * @return Error code
+ **/
+
+error_t tlsFormatServerKeyExchange(TlsContext *context, void *data, size_t *written)
 {
    error_t error;
    size_t length;
@@ -407,21 +700,29 @@ error_t tlsSendServerKeyExchange(TlsContext *context)
    uint8_t *p;
    TlsServerKeyExchange *message;
 
+   //Point to the ServerKeyExchange message
+   message = (TlsServerKeyExchange *) data;
+   //Point to the server's key exchange parameters
+   p = message->params;
+
 #if (TLS_DHE_RSA_SUPPORT == ENABLED || TLS_DHE_DSS_SUPPORT == ENABLED || TLS_DH_ANON_SUPPORT == ENABLED)
    //Diffie-Hellman key exchange method?
    if(context->keyExchMethod == TLS_KEY_EXCH_DHE_RSA ||
       context->keyExchMethod == TLS_KEY_EXCH_DHE_DSS ||
       context->keyExchMethod == TLS_KEY_EXCH_DH_ANON)
    {
-      //Point to the ServerKeyExchange message
-      message = (TlsServerKeyExchange *) (context->txBuffer + sizeof(TlsRecord));
-      //Format message header
-      message->msgType = TLS_TYPE_SERVER_KEY_EXCHANGE;
-
-      //Generate an ephemeral key pair
-      error = dhGenerateKeyPair(&context->dhParameters, context->prngAlgo, context->prngContext);
-      //Any error to report?
-      if(error) return error;
+#if (TLS_DH_KEY_POOL_SUPPORT == ENABLED)
+      //Take the next precomputed key pair, if any
+      error = tlsGetDhKeyPair(context);
+      //No key pair available?
+      if(error)
+#endif
+      {
+         //Generate an ephemeral key pair
+         error = dhGenerateKeyPair(&context->dhParameters, context->prngAlgo, context->prngContext);
+         //Any error to report?
+         if(error) return error;
+      }
 
       //Debug message
       TRACE_DEBUG("Diffie-Hellman parameters:\r\n");
@@ -432,9 +733,6 @@ error_t tlsSendServerKeyExchange(TlsContext *context)
       TRACE_DEBUG("  Server public value:\r\n");
       TRACE_DEBUG_MPI("    ", &context->dhParameters.ya);
 
-      //Point to the server's key exchange parameters
-      p = message->params;
-
       //Encode the prime modulus to an opaque vector
       error = tlsWriteMpi(&context->dhParameters.p, p, &n);
       //Any error to report?
@@ -464,259 +762,263 @@ error_t tlsSendServerKeyExchange(TlsContext *context)
       p += n;
       //Compute the total length of the key exchange parameters
       length += n;
-
-#if (TLS_DHE_RSA_SUPPORT == ENABLED || TLS_DHE_DSS_SUPPORT == ENABLED)
-      //For non-anonymous Diffie-Hellman key exchanges, the signature
-      //over the server's key exchange parameters shall be verified
-      if(context->keyExchMethod == TLS_KEY_EXCH_DHE_RSA ||
-         context->keyExchMethod == TLS_KEY_EXCH_DHE_DSS)
-      {
-#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_1)
-         //SSL 3.0, TLS 1.0 or TLS 1.1 currently selected?
-         if(context->version <= TLS_VERSION_1_1)
-         {
-            //Point to the digitally-signed element
-            TlsDigitalSignature *signature = (TlsDigitalSignature *) p;
-
-#if (TLS_DHE_RSA_SUPPORT == ENABLED)
-            //Check whether DHE_RSA key exchange method is currently used
-            if(context->keyExchMethod == TLS_KEY_EXCH_DHE_RSA)
-            {
-               Md5Context *md5Context;
-               Sha1Context *sha1Context;
-               RsaPrivateKey rsaPrivateKey;
-
-               //Allocate a memory buffer to hold the MD5 context
-               md5Context = osMemAlloc(sizeof(Md5Context));
-               //Failed to allocate memory?
-               if(!md5Context) return ERROR_OUT_OF_MEMORY;
-
-               //Compute MD5(ClientHello.random + ServerHello.random + ServerDhParams)
-               md5Init(md5Context);
-               md5Update(md5Context, context->random, 64);
-               md5Update(md5Context, message->params, length);
-               md5Final(md5Context, context->verifyData);
-               //Release previously allocated memory
-               osMemFree(md5Context);
-
-               //Allocate a memory buffer to hold the SHA-1 context
-               sha1Context = osMemAlloc(sizeof(Sha1Context));
-               //Failed to allocate memory?
-               if(!sha1Context) return ERROR_OUT_OF_MEMORY;
-
-               //Compute SHA(ClientHello.random + ServerHello.random + ServerDhParams)
-               sha1Init(sha1Context);
-               sha1Update(sha1Context, context->random, 64);
-               sha1Update(sha1Context, message->params, length);
-               sha1Final(sha1Context, context->verifyData + MD5_DIGEST_SIZE);
-               //Release previously allocated memory
-               osMemFree(sha1Context);
-
-               //Initialize RSA private key
-               rsaInitPrivateKey(&rsaPrivateKey);
-
-               //Decode the PEM structure that holds the RSA private key
-               error = pemReadRsaPrivateKey(context->cert->privateKey,
-                  context->cert->privateKeyLength, &rsaPrivateKey);
-
-               //Check status code
-               if(!error)
-               {
-                  //Sign the key exchange parameters using RSA
-                  error = tlsGenerateRsaSignature(&rsaPrivateKey,
-                     context->verifyData, signature->value, &n);
-               }
-
-               //Release previously allocated resources
-               rsaFreePrivateKey(&rsaPrivateKey);
-            }
-            else
+   }
+   else
 #endif
-#if (TLS_DHE_DSS_SUPPORT == ENABLED)
-            //Check whether DHE_DSS key exchange method is currently used
-            if(context->keyExchMethod == TLS_KEY_EXCH_DHE_DSS)
-            {
-               Sha1Context *sha1Context;
-               DsaPrivateKey dsaPrivateKey;
+#if (TLS_ECDHE_RSA_SUPPORT == ENABLED || TLS_ECDHE_ECDSA_SUPPORT == ENABLED)
+   //ECDH key exchange method?
+   if(context->keyExchMethod == TLS_KEY_EXCH_ECDHE_RSA ||
+      context->keyExchMethod == TLS_KEY_EXCH_ECDHE_ECDSA)
+   {
+      //Load the domain parameters of the curve selected during ClientHello processing
+      error = ecLoadDomainParameters(&context->ecdhContext.params,
+         tlsGetCurveInfo(context->namedCurve));
+      //Any error to report?
+      if(error) return error;
 
-               //Allocate a memory buffer to hold the SHA-1 context
-               sha1Context = osMemAlloc(sizeof(Sha1Context));
-               //Failed to allocate memory?
-               if(!sha1Context) return ERROR_OUT_OF_MEMORY;
+      //Generate an ephemeral key pair
+      error = ecdhGenerateKeyPair(&context->ecdhContext, context->prngAlgo, context->prngContext);
+      //Any error to report?
+      if(error) return error;
 
-               //Compute SHA(ClientHello.random + ServerHello.random + ServerDhParams)
-               sha1Init(sha1Context);
-               sha1Update(sha1Context, context->random, 64);
-               sha1Update(sha1Context, message->params, length);
-               sha1Final(sha1Context, NULL);
+      //Only named curves are used by this implementation
+      p[0] = TLS_EC_CURVE_TYPE_NAMED_CURVE;
+      //Identifier of the selected curve
+      STORE16BE(context->namedCurve, p + 1);
 
-               //Initialize DSA private key
-               dsaInitPrivateKey(&dsaPrivateKey);
+      //Advance data pointer
+      p += 3;
+      //Initialize byte counter
+      length = 3;
 
-               //Decode the PEM structure that holds the DSA private key
-               error = pemReadDsaPrivateKey(context->cert->privateKey,
-                  context->cert->privateKeyLength, &dsaPrivateKey);
+      //Encode the server's ephemeral ECDH public value to an opaque vector
+      error = tlsWriteEcPoint(&context->ecdhContext, p, &n);
+      //Any error to report?
+      if(error) return error;
 
-               //Check status code
-               if(!error)
-               {
-                  //Sign the key exchange parameters using DSA
-                  error = tlsGenerateDsaSignature(context->prngAlgo, context->prngContext,
-                     &dsaPrivateKey, sha1Context->digest, SHA1_DIGEST_SIZE, signature->value, &n);
-               }
+      //Advance data pointer
+      p += n;
+      //Compute the total length of the key exchange parameters
+      length += n;
 
-               //Release previously allocated memory
-               osMemFree(sha1Context);
-               dsaFreePrivateKey(&dsaPrivateKey);
-            }
-            else
+      //Debug message
+      TRACE_DEBUG("ECDH parameters (curve %u):\r\n", context->namedCurve);
+      TRACE_DEBUG("  Server public value:\r\n");
+      TRACE_DEBUG_MPI("    ", &context->ecdhContext.qa.x);
+   }
+   else
 #endif
-            //Invalid signature algorithm?
-            {
-               //Report an error
-               error = ERROR_UNSUPPORTED_SIGNATURE_ALGO;
-            }
+   //Invalid key exchange method?
+   {
+      //The specified key exchange method is not supported
+      return ERROR_UNSUPPORTED_KEY_EXCH_METHOD;
+   }
 
-            //Signature generation failed?
-            if(error) return error;
+   //For non-anonymous key exchanges, the server's key exchange
+   //parameters shall be signed
+   if(context->keyExchMethod != TLS_KEY_EXCH_DH_ANON)
+   {
+#if (TLS_MAX_VERSION >= SSL_VERSION_3_0 && TLS_MIN_VERSION <= TLS_VERSION_1_1)
+      //SSL 3.0, TLS 1.0 or TLS 1.1 currently selected?
+      if(context->version <= TLS_VERSION_1_1)
+      {
+         //Point to the digitally-signed element
+         TlsDigitalSignature *signature = (TlsDigitalSignature *) p;
 
-            //Fix the length of the digitally-signed element
-            signature->length = htons(n);
-            //Adjust the length of the message
-            length += sizeof(TlsDigitalSignature) + n;
-         }
-         else
-#endif
-#if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
-         //TLS 1.2 currently selected?
-         if(context->version == TLS_VERSION_1_2)
+#if (TLS_DHE_RSA_SUPPORT == ENABLED || TLS_ECDHE_RSA_SUPPORT == ENABLED)
+         //Check whether DHE_RSA or ECDHE_RSA key exchange method is currently used
+         if(context->keyExchMethod == TLS_KEY_EXCH_DHE_RSA ||
+            context->keyExchMethod == TLS_KEY_EXCH_ECDHE_RSA)
          {
-            const HashAlgo *hashAlgo;
-            HashContext *hashContext;
-
-            //Point to the digitally-signed element
-            TlsDigitalSignature2 *signature = (TlsDigitalSignature2 *) p;
+            Md5Context *md5Context;
+            Sha1Context *sha1Context;
 
-            //Retrieve the hash algorithm used for signing
-            hashAlgo = tlsGetHashAlgo(context->signHashAlgo);
-            //Hash algorithm not supported?
-            if(!hashAlgo) return ERROR_INVALID_SIGNATURE;
-
-            //Allocate a memory buffer to hold the hash context
-            hashContext = osMemAlloc(hashAlgo->contextSize);
+            //Allocate a memory buffer to hold the MD5 context
+            md5Context = osMemAlloc(sizeof(Md5Context));
             //Failed to allocate memory?
-            if(!hashContext) return ERROR_OUT_OF_MEMORY;
+            if(!md5Context) return ERROR_OUT_OF_MEMORY;
 
-            //Compute SHA(ClientHello.random + ServerHello.random + ServerDhParams)
-            hashAlgo->init(hashContext);
-            hashAlgo->update(hashContext, context->random, 64);
-            hashAlgo->update(hashContext, message->params, length);
-            hashAlgo->final(hashContext, NULL);
+            //Compute MD5(ClientHello.random + ServerHello.random + ServerParams)
+            md5Init(md5Context);
+            md5Update(md5Context, context->random, 64);
+            md5Update(md5Context, message->params, length);
+            md5Final(md5Context, context->verifyData);
+            //Release previously allocated memory
+            osMemFree(md5Context);
 
-#if (TLS_DHE_RSA_SUPPORT == ENABLED)
-            //Check whether DHE_RSA key exchange method is currently used
-            if(context->keyExchMethod == TLS_KEY_EXCH_DHE_RSA)
-            {
-               RsaPrivateKey rsaPrivateKey;
+            //Allocate a memory buffer to hold the SHA-1 context
+            sha1Context = osMemAlloc(sizeof(Sha1Context));
+            //Failed to allocate memory?
+            if(!sha1Context) return ERROR_OUT_OF_MEMORY;
 
-               //Set the relevant signature algorithm
-               signature->algorithm.signature = TLS_SIGN_ALGO_RSA;
-               signature->algorithm.hash = context->signHashAlgo;
+            //Compute SHA(ClientHello.random + ServerHello.random + ServerParams)
+            sha1Init(sha1Context);
+            sha1Update(sha1Context, context->random, 64);
+            sha1Update(sha1Context, message->params, length);
+            sha1Final(sha1Context, context->verifyData + MD5_DIGEST_SIZE);
+            //Release previously allocated memory
+            osMemFree(sha1Context);
 
-               //Initialize RSA private key
-               rsaInitPrivateKey(&rsaPrivateKey);
+            //Sign the key exchange parameters using RSA
+            error = tlsGenerateRsaSignature(&context->cert->rsaPrivateKey,
+               context->verifyData, signature->value, &n);
+         }
+         else
+#endif
+#if (TLS_DHE_DSS_SUPPORT == ENABLED || TLS_ECDHE_ECDSA_SUPPORT == ENABLED)
+         //Check whether DHE_DSS or ECDHE_ECDSA key exchange method is currently used
+         if(context->keyExchMethod == TLS_KEY_EXCH_DHE_DSS ||
+            context->keyExchMethod == TLS_KEY_EXCH_ECDHE_ECDSA)
+         {
+            Sha1Context *sha1Context;
 
-               //Decode the PEM structure that holds the RSA private key
-               error = pemReadRsaPrivateKey(context->cert->privateKey,
-                  context->cert->privateKeyLength, &rsaPrivateKey);
+            //Allocate a memory buffer to hold the SHA-1 context
+            sha1Context = osMemAlloc(sizeof(Sha1Context));
+            //Failed to allocate memory?
+            if(!sha1Context) return ERROR_OUT_OF_MEMORY;
 
-               //Check status code
-               if(!error)
-               {
-                  //Use the signature algorithm defined in PKCS #1 v1.5
-                  error = rsassaPkcs1v15Sign(&rsaPrivateKey, hashAlgo,
-                     hashContext->digest, signature->value, &n);
-               }
+            //Compute SHA(ClientHello.random + ServerHello.random + ServerParams)
+            sha1Init(sha1Context);
+            sha1Update(sha1Context, context->random, 64);
+            sha1Update(sha1Context, message->params, length);
+            sha1Final(sha1Context, NULL);
 
-               //Release previously allocated resources
-               rsaFreePrivateKey(&rsaPrivateKey);
-            }
-            else
-#endif
 #if (TLS_DHE_DSS_SUPPORT == ENABLED)
-            //Check whether DHE_DSS key exchange method is currently used
+            //DHE_DSS key exchange method?
             if(context->keyExchMethod == TLS_KEY_EXCH_DHE_DSS)
             {
-               DsaPrivateKey dsaPrivateKey;
-
-               //Set the relevant signature algorithm
-               signature->algorithm.signature = TLS_SIGN_ALGO_DSA;
-               signature->algorithm.hash = context->signHashAlgo;
-
-               //Initialize DSA private key
-               dsaInitPrivateKey(&dsaPrivateKey);
-
-               //Decode the PEM structure that holds the DSA private key
-               error = pemReadDsaPrivateKey(context->cert->privateKey,
-                  context->cert->privateKeyLength, &dsaPrivateKey);
-
-               //Check status code
-               if(!error)
-               {
-                  //Sign the key exchange parameters using DSA
-                  error = tlsGenerateDsaSignature(context->prngAlgo, context->prngContext,
-                     &dsaPrivateKey, hashContext->digest, hashAlgo->digestSize, signature->value, &n);
-               }
-
-               //Release previously allocated resources
-               dsaFreePrivateKey(&dsaPrivateKey);
+               //Sign the key exchange parameters using DSA
+               error = tlsGenerateDsaSignature(context->prngAlgo, context->prngContext,
+                  &context->cert->dsaPrivateKey, sha1Context->digest, SHA1_DIGEST_SIZE, signature->value, &n);
             }
             else
 #endif
-            //Invalid signature algorithm?
+            //ECDHE_ECDSA key exchange method?
             {
-               //Report an error
-               error = ERROR_UNSUPPORTED_SIGNATURE_ALGO;
+               //Sign the key exchange parameters using ECDSA
+               error = tlsGenerateEcdsaSignature(&context->cert->ecParams, context->prngAlgo,
+                  context->prngContext, &context->cert->ecPrivateKey, sha1Context->digest,
+                  SHA1_DIGEST_SIZE, signature->value, &n);
             }
 
             //Release previously allocated memory
-            osMemFree(hashContext);
-
-            //Fix the length of the digitally-signed element
-            signature->length = htons(n);
-            //Adjust the length of the message
-            length += sizeof(TlsDigitalSignature2) + n;
+            osMemFree(sha1Context);
          }
          else
 #endif
+         //Invalid signature algorithm?
          {
-            //The negotiated TLS version is not valid
-            error = ERROR_INVALID_VERSION;
+            //Report an error
+            error = ERROR_UNSUPPORTED_SIGNATURE_ALGO;
          }
+
+         //Signature generation failed?
+         if(error) return error;
+
+         //Fix the length of the digitally-signed element
+         signature->length = htons(n);
+         //Adjust the length of the message
+         length += sizeof(TlsDigitalSignature) + n;
       }
+      else
 #endif
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_2 && TLS_MIN_VERSION <= TLS_VERSION_1_2)
+      //TLS 1.2 currently selected?
+      if(context->version == TLS_VERSION_1_2)
+      {
+         const HashAlgo *hashAlgo;
+         HashContext *hashContext;
+
+         //Point to the digitally-signed element
+         TlsDigitalSignature2 *signature = (TlsDigitalSignature2 *) p;
+
+         //Retrieve the hash algorithm used for signing
+         hashAlgo = tlsGetHashAlgo(context->signHashAlgo);
+         //Hash algorithm not supported?
+         if(!hashAlgo) return ERROR_INVALID_SIGNATURE;
+
+         //Allocate a memory buffer to hold the hash context
+         hashContext = osMemAlloc(hashAlgo->contextSize);
+         //Failed to allocate memory?
+         if(!hashContext) return ERROR_OUT_OF_MEMORY;
+
+         //Compute SHA(ClientHello.random + ServerHello.random + ServerParams)
+         hashAlgo->init(hashContext);
+         hashAlgo->update(hashContext, context->random, 64);
+         hashAlgo->update(hashContext, message->params, length);
+         hashAlgo->final(hashContext, NULL);
+
+#if (TLS_DHE_RSA_SUPPORT == ENABLED || TLS_ECDHE_RSA_SUPPORT == ENABLED)
+         //Check whether DHE_RSA or ECDHE_RSA key exchange method is currently used
+         if(context->keyExchMethod == TLS_KEY_EXCH_DHE_RSA ||
+            context->keyExchMethod == TLS_KEY_EXCH_ECDHE_RSA)
+         {
+            //Set the relevant signature algorithm
+            signature->algorithm.signature = TLS_SIGN_ALGO_RSA;
+            signature->algorithm.hash = context->signHashAlgo;
 
-      //Signature generation failed?
-      if(error) return error;
+            //Use the signature algorithm defined in PKCS #1 v1.5
+            error = rsassaPkcs1v15Sign(&context->cert->rsaPrivateKey, hashAlgo,
+               hashContext->digest, signature->value, &n);
+         }
+         else
+#endif
+#if (TLS_DHE_DSS_SUPPORT == ENABLED)
+         //Check whether DHE_DSS key exchange method is currently used
+         if(context->keyExchMethod == TLS_KEY_EXCH_DHE_DSS)
+         {
+            //Set the relevant signature algorithm
+            signature->algorithm.signature = TLS_SIGN_ALGO_DSA;
+            signature->algorithm.hash = context->signHashAlgo;
 
-      //Fix message header
-      STORE24BE(length, message->length);
-      //Length of the complete handshake message
-      length += sizeof(TlsHandshake);
+            //Sign the key exchange parameters using DSA
+            error = tlsGenerateDsaSignature(context->prngAlgo, context->prngContext,
+               &context->cert->dsaPrivateKey, hashContext->digest, hashAlgo->digestSize, signature->value, &n);
+         }
+         else
+#endif
+#if (TLS_ECDHE_ECDSA_SUPPORT == ENABLED)
+         //Check whether ECDHE_ECDSA key exchange method is currently used
+         if(context->keyExchMethod == TLS_KEY_EXCH_ECDHE_ECDSA)
+         {
+            //Set the relevant signature algorithm
+            signature->algorithm.signature = TLS_SIGN_ALGO_ECDSA;
+            signature->algorithm.hash = context->signHashAlgo;
+
+            //Sign the key exchange parameters using ECDSA
+            error = tlsGenerateEcdsaSignature(&context->cert->ecParams, context->prngAlgo,
+               context->prngContext, &context->cert->ecPrivateKey, hashContext->digest,
+               hashAlgo->digestSize, signature->value, &n);
+         }
+         else
+#endif
+         //Invalid signature algorithm?
+         {
+            //Report an error
+            error = ERROR_UNSUPPORTED_SIGNATURE_ALGO;
+         }
 
-      //Debug message
-      TRACE_INFO("Sending ServerKeyExchange message (%u bytes)...\r\n", length);
-      TRACE_DEBUG_ARRAY("  ", message, length);
+         //Release previously allocated memory
+         osMemFree(hashContext);
 
-      //Send handshake message
-      error = tlsWriteProtocolData(context, length, TLS_TYPE_HANDSHAKE);
-      //Failed to send TLS record?
+         //Fix the length of the digitally-signed element
+         signature->length = htons(n);
+         //Adjust the length of the message
+         length += sizeof(TlsDigitalSignature2) + n;
+      }
+      else
+#endif
+      {
+         //The negotiated TLS version is not valid
+         error = ERROR_INVALID_VERSION;
+      }
+
+      //Signature generation failed?
       if(error) return error;
    }
-#endif
 
-   //Prepare to send a CertificateRequest message...
-   context->state = TLS_STATE_CERTIFICATE_REQUEST;
+   //Return the length of the key exchange parameters and their signature
+   *written = length;
    //Successful processing
    return NO_ERROR;
 }
@@ -736,6 +1038,7 @@ error_t tlsSendServerKeyExchange(TlsContext *context)
 error_t tlsSendCertificateRequest(TlsContext *context)
 {
    error_t error;
+   uint_t i;
    size_t n;
    size_t length;
    uint8_t *p;
@@ -747,8 +1050,9 @@ error_t tlsSendCertificateRequest(TlsContext *context)
    X509CertificateInfo *certInfo;
    TlsCertificateRequest *message;
    TlsCertAuthorities *certAuthorities;
+   const TlsTrustedCa *ca;
 
-#if (TLS_RSA_SIGN_SUPPORT == ENABLED || TLS_DSA_SIGN_SUPPORT == ENABLED)
+#if (TLS_RSA_SIGN_SUPPORT == ENABLED || TLS_DSA_SIGN_SUPPORT == ENABLED || TLS_ECDSA_SIGN_SUPPORT == ENABLED)
    //A server can optionally request a certificate from the client
    if(context->clientAuthMode != TLS_CLIENT_AUTH_NONE)
    {
@@ -768,6 +1072,10 @@ error_t tlsSendCertificateRequest(TlsContext *context)
       //Certificate containing a DSA key are supported
       message->certificateTypes.value[n++] = TLS_CERT_DSS_SIGN;
 #endif
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+      //Certificate containing an ECDSA key are supported
+      message->certificateTypes.value[n++] = TLS_CERT_ECDSA_SIGN;
+#endif
 
       //Set the length of the list
       message->certificateTypes.length = n;
@@ -819,6 +1127,27 @@ error_t tlsSendCertificateRequest(TlsContext *context)
             supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_DSA;
             supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_SHA256;
          }
+#endif
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+         //ECDSA with SHA-1 is always supported
+         supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_ECDSA;
+         supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_SHA1;
+
+         //The hash algorithm used for PRF operations can also be used for signing
+         if(context->prfHashAlgo == SHA256_HASH_ALGO)
+         {
+            //ECDSA with SHA-256 is supported
+            supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_ECDSA;
+            supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_SHA256;
+         }
+#if (TLS_SHA384_SUPPORT == ENABLED)
+         if(context->prfHashAlgo == SHA384_HASH_ALGO)
+         {
+            //ECDSA with SHA-384 is supported
+            supportedSignAlgos->value[n].signature = TLS_SIGN_ALGO_ECDSA;
+            supportedSignAlgos->value[n++].hash = TLS_HASH_ALGO_SHA384;
+         }
+#endif
 #endif
 
          //Fix the length of the list
@@ -839,10 +1168,44 @@ error_t tlsSendCertificateRequest(TlsContext *context)
       //Length of the list in bytes
       n = 0;
 
-      //Point to the first trusted CA certificate
-      pemCert = context->trustedCaList;
-      //Get the total length, in bytes, of the trusted CA list
-      pemCertLength = context->trustedCaListLength;
+      //Check whether an indexed trusted CA store is available
+      if(context->caStore != NULL)
+      {
+         //Loop through the list of trusted CA certificates
+         for(i = 0; i < context->caStore->count; i++)
+         {
+            //Point to the current trusted CA
+            ca = &context->caStore->cas[i];
+
+            //Total length of the message
+            length += ca->subjectLength + 2;
+
+            //Prevent the buffer from overflowing
+            if(length > context->txBufferSize)
+               return ERROR_MESSAGE_TOO_LONG;
+
+            //Each distinguished name is preceded by a 2-byte length field
+            STORE16BE(ca->subjectLength, p);
+            //The distinguished name shall be DER encoded
+            memcpy(p + 2, ca->subject, ca->subjectLength);
+
+            //Advance data pointer
+            p += ca->subjectLength + 2;
+            //Adjust the length of the list
+            n += ca->subjectLength + 2;
+         }
+
+         //The trusted CA list is not used
+         pemCert = NULL;
+         pemCertLength = 0;
+      }
+      else
+      {
+         //Point to the first trusted CA certificate
+         pemCert = context->trustedCaList;
+         //Get the total length, in bytes, of the trusted CA list
+         pemCertLength = context->trustedCaListLength;
+      }
 
       //DER encoded certificate
       derCert = NULL;
@@ -872,7 +1235,7 @@ error_t tlsSendCertificateRequest(TlsContext *context)
          length += certInfo->subject.rawDataLen + 2;
 
          //Prevent the buffer from overflowing
-         if(length > TLS_MAX_PROTOCOL_DATA_LENGTH)
+         if(length > context->txBufferSize)
             return ERROR_MESSAGE_TOO_LONG;
 
          //Each distinguished name is preceded by a 2-byte length field
@@ -961,6 +1324,64 @@ error_t tlsSendServerHelloDone(TlsContext *context)
 }
 
 
+#if (TLS_TICKET_SUPPORT == ENABLED)
+
+/**
+ * @brief Send NewSessionTicket message
+ *
+ * The NewSessionTicket message carries the encrypted session state
+ * that the client presents later on to resume the session. It is
+ * sent just before the ChangeCipherSpec message of the server
+ *
+ * @param[in] context Pointer to the TLS context
+ * @return Error code
+ **/
+
+error_t tlsSendNewSessionTicket(TlsContext *context)
+{
+   error_t error;
+   size_t n;
+   size_t length;
+   TlsNewSessionTicket *message;
+
+   //Point to the NewSessionTicket message
+   message = (TlsNewSessionTicket *) (context->txBuffer + sizeof(TlsRecord));
+   //Format message header
+   message->msgType = TLS_TYPE_NEW_SESSION_TICKET;
+
+   //Encrypt the current session state
+   error = tlsEncryptTicket(context, message->ticket, &n);
+   //Any error to report?
+   if(error) return error;
+
+   //Number of seconds the client should keep the ticket
+   message->ticketLifetimeHint = HTONL(TLS_TICKET_LIFETIME / 1000);
+   //Length of the ticket
+   message->ticketLength = htons(n);
+
+   //Length of the complete handshake message
+   length = sizeof(TlsNewSessionTicket) + n;
+   //Fix the length field
+   STORE24BE(length - sizeof(TlsHandshake), message->length);
+
+   //Debug message
+   TRACE_INFO("Sending NewSessionTicket message (%u bytes)...\r\n", length);
+   TRACE_DEBUG_ARRAY("  ", message, length);
+
+   //Send handshake message
+   error = tlsWriteProtocolData(context, length, TLS_TYPE_HANDSHAKE);
+   //Failed to send TLS record?
+   if(error) return error;
+
+   //Prepare to send a ChangeCipherSpec message...
+   context->state = TLS_STATE_SERVER_CHANGE_CIPHER_SPEC;
+   //Successful processing
+   return NO_ERROR;
+}
+
+#endif
+
+
 /**
  * @brief Parse ClientHello message
  *
@@ -990,6 +1411,9 @@ error_t tlsParseClientHello(TlsContext *context, const TlsClientHello *message,
    const TlsCompressionMethods *compressionMethods;
    const TlsExtension *extension;
    const TlsSignHashAlgos *supportedSignAlgos;
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   const TlsExtension *ticket;
+#endif
 
    //Debug message
    TRACE_INFO("ClientHello message received (%u bytes)...\r\n", length);
@@ -1077,6 +1501,84 @@ error_t tlsParseClientHello(TlsContext *context, const TlsClientHello *message,
    //Remaining bytes to process
    n -= compressionMethods->length;
 
+#if (TLS_RECORD_SIZE_LIMIT_SUPPORT == ENABLED)
+   //The client may advertise the size of the largest record it is
+   //willing to receive
+   extension = tlsGetExtension(p, n, TLS_EXT_RECORD_SIZE_LIMIT);
+
+   //RecordSizeLimit extension found?
+   if(extension != NULL)
+   {
+      //Malformed extension?
+      if(ntohs(extension->length) != sizeof(uint16_t))
+         return ERROR_DECODING_FAILED;
+      //Endpoints must not advertise a limit smaller than 64 bytes
+      if(LOAD16BE(extension->value) < 64)
+         return ERROR_ILLEGAL_PARAMETER;
+
+      //Records sent to the client cannot exceed the advertised limit
+      context->recordSizeLimit = min(LOAD16BE(extension->value), TLS_MAX_RECORD_LENGTH);
+      //The server will reply with its own limit
+      context->recordSizeLimitExt = TRUE;
+   }
+#endif
+
+#if (TLS_ALPN_SUPPORT == ENABLED)
+   //The client may offer a list of application protocols
+   extension = tlsGetExtension(p, n, TLS_EXT_ALPN);
+
+   //ALPN extension found?
+   if(extension != NULL)
+   {
+      //Select the protocol that will run over the secure connection
+      error = tlsSelectAlpnProtocol(context, extension);
+      //Any error to report?
+      if(error) return error;
+   }
+#endif
+
+#if (TLS_MAX_FRAG_LENGTH_SUPPORT == ENABLED)
+   //Full-sized records are used unless the client requests otherwise
+   context->maxFragLength = TLS_MAX_RECORD_LENGTH;
+
+   //Search for the MaxFragmentLength extension
+   extension = tlsGetExtension(p, n, TLS_EXT_MAX_FRAGMENT_LENGTH);
+
+   //A server that supports the RecordSizeLimit extension must ignore
+   //a MaxFragmentLength extension that appears along with it
+   if(extension != NULL && !context->recordSizeLimitExt)
+   {
+      //Malformed extension?
+      if(ntohs(extension->length) != 1)
+         return ERROR_DECODING_FAILED;
+      //The client requested a value that is not allowed?
+      if(extension->value[0] < TLS_MAX_FRAG_LENGTH_512 ||
+         extension->value[0] > TLS_MAX_FRAG_LENGTH_4096)
+      {
+         //Report an error
+         return ERROR_ILLEGAL_PARAMETER;
+      }
+
+      //Records exchanged in both directions cannot exceed 2^(8 + n) bytes
+      context->maxFragLength = 256U << extension->value[0];
+   }
+#endif
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+   //The SupportedVersions extension indicates which versions of TLS the
+   //client supports. A second ClientHello is always processed as TLS 1.3
+   extension = tlsGetExtension(p, n, TLS_EXT_SUPPORTED_VERSIONS);
+
+   //The client offers TLS 1.3?
+   if(tls13IsVersionOffered(extension) || context->helloRetryRequest)
+   {
+      //TLS 1.3 negotiates the cipher suite, the key shares and the PSK
+      //with a different set of extensions
+      return tls13ParseClientHello(context, message, length,
+         cipherSuites, compressionMethods, p, n);
+   }
+#endif
+
    //Parse the list of extensions offered by the client
    extension = tlsGetExtension(p, n, TLS_EXT_SIGNATURE_ALGORITHMS);
 
@@ -1098,36 +1600,112 @@ error_t tlsParseClientHello(TlsContext *context, const TlsClientHello *message,
       supportedSignAlgos = NULL;
    }
 
+#if (TLS_ECDHE_RSA_SUPPORT == ENABLED || TLS_ECDHE_ECDSA_SUPPORT == ENABLED)
+   //Search for the EllipticCurves extension
+   extension = tlsGetExtension(p, n, TLS_EXT_ELLIPTIC_CURVES);
+
+   //The EllipticCurves extension was found?
+   if(extension)
+   {
+      const TlsEllipticCurveList *curveList;
+
+      //Point to the list of curves supported by the client
+      curveList = (TlsEllipticCurveList *) extension->value;
+
+      //Check the length of the list
+      if(ntohs(extension->length) < sizeof(TlsEllipticCurveList))
+         return ERROR_DECODING_FAILED;
+      if(ntohs(extension->length) < (sizeof(TlsEllipticCurveList) + ntohs(curveList->length)))
+         return ERROR_DECODING_FAILED;
+
+      //ECC cipher suites cannot be negotiated unless a common curve is found
+      context->namedCurve = TLS_EC_CURVE_NONE;
+
+      //The list is ordered according to the client's preferences
+      for(i = 0; i < ntohs(curveList->length) / 2; i++)
+      {
+         //Check whether the current curve is supported
+         if(tlsGetCurveInfo(ntohs(curveList->value[i])) != NULL)
+         {
+            context->namedCurve = ntohs(curveList->value[i]);
+            break;
+         }
+      }
+   }
+   else
+   {
+      //A client that omits the extension is assumed to support secp256r1
+      context->namedCurve = TLS_EC_CURVE_SECP256R1;
+   }
+#endif
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //A client indicates that it supports session tickets by including
+   //a SessionTicket extension in the ClientHello
+   ticket = tlsGetExtension(p, n, TLS_EXT_SESSION_TICKET);
+#endif
+
    //Get the version the client wishes to use during this session
    context->clientVersion = ntohs(message->clientVersion);
 
    //If a TLS server receives a ClientHello containing a version number
    //greater than the highest version supported by the server, it must
    //reply according to the highest version supported by the server
-   error = tlsSetVersion(context, min(context->clientVersion, TLS_MAX_VERSION));
+   error = tlsSetVersion(context, min(context->clientVersion,
+      min(TLS_MAX_VERSION, TLS_VERSION_1_2)));
    //The specified TLS version is not supported?
    if(error) return error;
 
    //Save client random value
    context->clientRandom = message->random;
 
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //Session tickets are only defined for TLS. The server issues a ticket
+   //when the client supports the mechanism and ticket keys are available
+   context->newSessionTicket = (ticket != NULL && context->ticketContext != NULL &&
+      context->version >= TLS_VERSION_1_0);
+
+   //Check whether the client supports session tickets
+   if(context->newSessionTicket)
+   {
+      //A non-empty extension carries a ticket previously issued by the server
+      if(ntohs(ticket->length) > 0 &&
+         !tlsDecryptTicket(context, ticket->value, ntohs(ticket->length)))
+      {
+         //When presenting a ticket, the client may generate and include a
+         //session ID. The server must echo this session ID to indicate that
+         //it is resuming the session
+         memcpy(context->sessionId, message->sessionId.value, message->sessionId.length);
+         context->sessionIdLength = message->sessionId.length;
+
+         //Perform abbreviated handshake
+         context->resume = TRUE;
+      }
+      else
+      {
+         //The session state is carried by the new ticket, so that no
+         //session ID needs to be issued
+         context->sessionIdLength = 0;
+         //Perform a full handshake
+         context->resume = FALSE;
+      }
+   }
+   else
+#endif
 #if (TLS_SESSION_RESUME_SUPPORT == ENABLED)
    //Check whether session caching is supported
    if(context->cache != NULL)
    {
       //If the session ID was non-empty, the server will look in
-      //its session cache for a match
-      TlsSession *session = tlsFindCache(context->cache,
+      //its session cache for a match and restore session parameters
+      error = tlsRestoreFromCache(context,
          message->sessionId.value, message->sessionId.length);
 
       //Check wether a matching entry has been found in the cache
-      if(session != NULL)
+      if(!error)
       {
-         //Restore session parameters
-         tlsRestoreSession(context, session);
-
          //Select the relevant cipher suite
-         error = tlsSetCipherSuite(context, session->cipherSuite);
+         error = tlsSetCipherSuite(context, context->cipherSuite);
          //Any error to report?
          if(error) return error;
 
@@ -1175,9 +1753,10 @@ error_t tlsParseClientHello(TlsContext *context, const TlsClientHello *message,
             //The server requires a valid certificate whenever the agreed-upon
             //key exchange method uses certificates for authentication
             if(context->keyExchMethod == TLS_KEY_EXCH_RSA ||
-               context->keyExchMethod == TLS_KEY_EXCH_DHE_RSA)
+               context->keyExchMethod == TLS_KEY_EXCH_DHE_RSA ||
+               context->keyExchMethod == TLS_KEY_EXCH_ECDHE_RSA)
             {
-               //RSA and DHE_RSA key exchanges methods require a RSA certificate
+               //RSA, DHE_RSA and ECDHE_RSA key exchanges methods require a RSA certificate
                certType = TLS_CERT_RSA_SIGN;
             }
             else if(context->keyExchMethod == TLS_KEY_EXCH_DHE_DSS)
@@ -1185,12 +1764,30 @@ error_t tlsParseClientHello(TlsContext *context, const TlsClientHello *message,
                //DHE_DSS key exchanges method requires a DSA certificate
                certType = TLS_CERT_DSS_SIGN;
             }
+            else if(context->keyExchMethod == TLS_KEY_EXCH_ECDHE_ECDSA)
+            {
+               //ECDHE_ECDSA key exchanges method requires an ECDSA certificate
+               certType = TLS_CERT_ECDSA_SIGN;
+            }
             else
             {
                //DH_anon key exchanges method does not require any certificate
                certType = TLS_CERT_NONE;
             }
 
+#if (TLS_ECDHE_RSA_SUPPORT == ENABLED || TLS_ECDHE_ECDSA_SUPPORT == ENABLED)
+            //ECC cipher suites must not be negotiated when the client
+            //does not support any of the server's curves
+            if((context->keyExchMethod == TLS_KEY_EXCH_ECDHE_RSA ||
+               context->keyExchMethod == TLS_KEY_EXCH_ECDHE_ECDSA) &&
+               context->namedCurve == TLS_EC_CURVE_NONE)
+            {
+               //Process the remaining cipher suites
+               error = ERROR_HANDSHAKE_FAILED;
+               continue;
+            }
+#endif
+
             //Check whether a certificate is required
             if(certType != TLS_CERT_NONE)
             {
@@ -1211,7 +1808,7 @@ error_t tlsParseClientHello(TlsContext *context, const TlsClientHello *message,
                      //The hash algorithm to be used when generating signatures must be
                      //one of those present in the SignatureAlgorithms extension
                      error = tlsSelectSignHashAlgo(context,
-                        context->certs[j].signAlgo, supportedSignAlgos);
+                        tlsGetSignAlgo(context->certs[j].type), supportedSignAlgos);
 
                      //If all the requirements were met, the certificate can be
                      //used in conjunction with the selected cipher suite
@@ -1284,7 +1881,6 @@ error_t tlsParseClientKeyExchange(TlsContext *context, const TlsClientKeyExchang
 {
    error_t error;
    size_t n;
-   const uint8_t *p;
 
    //Debug message
    TRACE_INFO("ClientKeyExchange message received (%u bytes)...\r\n", length);
@@ -1311,17 +1907,64 @@ error_t tlsParseClientKeyExchange(TlsContext *context, const TlsClientKeyExchang
    //Update the hash value with the incoming handshake message
    tlsUpdateHandshakeHash(context, message, length);
 
+   //Length of the exchange keys
+   n = length - sizeof(TlsClientKeyExchange);
+
+   //Decrypt or compute the premaster secret
+   error = tlsRunCryptoJob(context, tlsComputePremasterSecret,
+      (void *) message->exchangeKeys, &n);
+   //Any error to report?
+   if(error) return error;
+
+   //Derive session keys from the premaster secret
+   TLS_PROFILE_START(context, TLS_PROFILE_KEY_DERIVATION);
+   error = tlsGenerateKeys(context);
+   TLS_PROFILE_STOP(context, TLS_PROFILE_KEY_DERIVATION);
+   //Unable to generate key material?
+   if(error) return error;
+
+   //Update FSM state
+   if(context->peerCertType != TLS_CERT_NONE)
+      context->state = TLS_STATE_CERTIFICATE_VERIFY;
+   else
+      context->state = TLS_STATE_CLIENT_CHANGE_CIPHER_SPEC;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Compute the premaster secret from the ClientKeyExchange message
+ *
+ * Depending on the key exchange method, the premaster secret is either
+ * decrypted using the server's RSA private key or computed from the
+ * client's Diffie-Hellman public value. This function holds the public-key
+ * operations of the message and may therefore be run by a crypto worker task
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] data Exchange keys sent by the client
+ * @param[in] size Length of the exchange keys, in bytes
+ * @return Error code
+ **/
+
+error_t tlsComputePremasterSecret(TlsContext *context, void *data, size_t *size)
+{
+   error_t error;
+   size_t n;
+   size_t length;
+   const uint8_t *p;
+
    //Point to the exchange keys
-   p = message->exchangeKeys;
-   //Remaining bytes to process
-   length -= sizeof(TlsClientKeyExchange);
+   p = (const uint8_t *) data;
+   //Length of the exchange keys
+   length = *size;
 
 #if (TLS_RSA_SUPPORT == ENABLED)
    //RSA key exchange method?
    if(context->keyExchMethod == TLS_KEY_EXCH_RSA)
    {
       uint16_t version;
-      RsaPrivateKey rsaPrivateKey;
 
       //The RSA-encrypted premaster secret in a ClientKeyExchange is preceded by
       //two length bytes. SSL 3.0 implementations do not include these bytes
@@ -1344,22 +1987,10 @@ error_t tlsParseClientKeyExchange(TlsContext *context, const TlsClientKeyExchang
          p += 2;
       }
 
-      //Initialize RSA private key
-      rsaInitPrivateKey(&rsaPrivateKey);
-
-      //Decode the PEM structure that holds the RSA private key
-      error = pemReadRsaPrivateKey(context->cert->privateKey,
-         context->cert->privateKeyLength, &rsaPrivateKey);
-      //Any error to report?
-      if(error) return error;
-
       //Decrypt the premaster secret using the server private key
-      error = rsaesPkcs1v15Decrypt(&rsaPrivateKey, p, length,
+      error = rsaesPkcs1v15Decrypt(&context->cert->rsaPrivateKey, p, length,
          context->premasterSecret, 48, &context->premasterSecretLength);
 
-      //Release RSA private key
-      rsaFreePrivateKey(&rsaPrivateKey);
-
       //Retrieve the latest version supported by the client. This is used
       //to detect version roll-back attacks
       version = LOAD16BE(context->premasterSecret);
@@ -1424,6 +2055,24 @@ error_t tlsParseClientKeyExchange(TlsContext *context, const TlsClientKeyExchang
       }
    }
    else
+#endif
+#if (TLS_ECDHE_RSA_SUPPORT == ENABLED || TLS_ECDHE_ECDSA_SUPPORT == ENABLED)
+   //ECDH key exchange method?
+   if(context->keyExchMethod == TLS_KEY_EXCH_ECDHE_RSA ||
+      context->keyExchMethod == TLS_KEY_EXCH_ECDHE_ECDSA)
+   {
+      //Read the client's ephemeral ECDH public value
+      error = tlsReadEcPoint(&context->ecdhContext, p, length, &n);
+      //Invalid point?
+      if(error) return error;
+
+      //The premaster secret is the x-coordinate of the shared point
+      error = ecdhComputeSharedSecret(&context->ecdhContext, context->premasterSecret,
+         sizeof(context->premasterSecret), &context->premasterSecretLength);
+      //Any error to report?
+      if(error) return error;
+   }
+   else
 #endif
    //Invalid key exchange method?
    {
@@ -1431,17 +2080,6 @@ error_t tlsParseClientKeyExchange(TlsContext *context, const TlsClientKeyExchang
       return ERROR_UNSUPPORTED_KEY_EXCH_METHOD;
    }
 
-   //Derive session keys from the premaster secret
-   error = tlsGenerateKeys(context);
-   //Unable to generate key material?
-   if(error) return error;
-
-   //Update FSM state
-   if(context->peerCertType != TLS_CERT_NONE)
-      context->state = TLS_STATE_CERTIFICATE_VERIFY;
-   else
-      context->state = TLS_STATE_CLIENT_CHANGE_CIPHER_SPEC;
-
    //Successful processing
    return NO_ERROR;
 }
@@ -1530,6 +2168,22 @@ error_t tlsParseCertificateVerify(TlsContext *context, const TlsCertificateVerif
             SHA1_DIGEST_SIZE, signature->value, ntohs(signature->length));
       }
       else
+#endif
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+      //The client's certificate contains a valid EC public key?
+      if(context->peerCertType == TLS_CERT_ECDSA_SIGN)
+      {
+         //Digest all the handshake messages starting at ClientHello
+         error = tlsFinalizeHandshakeHash(context, SHA1_HASH_ALGO,
+            context->handshakeSha1Context, "", context->verifyData);
+         //Any error to report?
+         if(error) return error;
+
+         //Verify ECDSA signature using client's public key
+         error = tlsVerifyEcdsaSignature(&context->peerEcParams, &context->peerEcPublicKey,
+            context->verifyData, SHA1_DIGEST_SIZE, signature->value, ntohs(signature->length));
+      }
+      else
 #endif
       //Invalid signature algorithm?
       {
@@ -1558,7 +2212,7 @@ error_t tlsParseCertificateVerify(TlsContext *context, const TlsCertificateVerif
       hashAlgo = tlsGetHashAlgo(signature->algorithm.hash);
 
       //Digest all the handshake messages starting at ClientHello
-      if(hashAlgo == SHA1_HASH_ALGO)
+      if(hashAlgo == SHA1_HASH_ALGO && context->handshakeSha1Context != NULL)
       {
          //Use SHA-1 hash algorithm
          error = tlsFinalizeHandshakeHash(context, SHA1_HASH_ALGO,
@@ -1598,6 +2252,17 @@ error_t tlsParseCertificateVerify(TlsContext *context, const TlsCertificateVerif
             hashAlgo->digestSize, signature->value, ntohs(signature->length));
       }
       else
+#endif
+#if (TLS_ECDSA_SIGN_SUPPORT == ENABLED)
+      //The client's certificate contains a valid EC public key?
+      if(signature->algorithm.signature == TLS_SIGN_ALGO_ECDSA &&
+         context->peerCertType == TLS_CERT_ECDSA_SIGN)
+      {
+         //Verify ECDSA signature using client's public key
+         error = tlsVerifyEcdsaSignature(&context->peerEcParams, &context->peerEcPublicKey,
+            context->verifyData, hashAlgo->digestSize, signature->value, ntohs(signature->length));
+      }
+      else
 #endif
       //Invalid signature algorithm?
       {
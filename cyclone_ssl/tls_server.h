@@ -38,11 +38,14 @@ error_t tlsParseClientMessage(TlsContext *context);
 
 error_t tlsSendServerHello(TlsContext *context);
 error_t tlsSendServerKeyExchange(TlsContext *context);
+error_t tlsFormatServerKeyExchange(TlsContext *context, void *data, size_t *written);
 error_t tlsSendCertificateRequest(TlsContext *context);
 error_t tlsSendServerHelloDone(TlsContext *context);
+error_t tlsSendNewSessionTicket(TlsContext *context);
 
 error_t tlsParseClientHello(TlsContext *context, const TlsClientHello *message, size_t length);
 error_t tlsParseClientKeyExchange(TlsContext *context, const TlsClientKeyExchange *message, size_t length);
+error_t tlsComputePremasterSecret(TlsContext *context, void *data, size_t *size);
 error_t tlsParseCertificateVerify(TlsContext *context, const TlsCertificateVerify *message, size_t length);
 
 #endif
@@ -0,0 +1,460 @@
+/**
+ * @file tls_ticket.c
+ * @brief Session tickets (RFC 5077)
+ *
+ * @section Description
+ *
+ * Session tickets let a server resume sessions without keeping any
+ * per-client state. The session state is encrypted with AES-128 in
+ * CBC mode and authenticated with HMAC-SHA-256, as recommended by
+ * RFC 5077, section 4. The ticket keys are renewed periodically and
+ * the previous key is retained so that outstanding tickets remain
+ * valid until they expire
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneSSL Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TLS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tls.h"
+#include "tls_ticket.h"
+#include "tls_misc.h"
+#include "aes.h"
+#include "cipher_mode_cbc.h"
+#include "hmac.h"
+#include "debug.h"
+
+//Check SSL library configuration
+#if (TLS_SUPPORT == ENABLED && TLS_TICKET_SUPPORT == ENABLED)
+
+//Ticket key related local functions
+static error_t tlsGenerateTicketKey(TlsContext *context, TlsTicketKey *key, time_t time);
+
+
+/**
+ * @brief Ticket context initialization
+ * @return Handle referencing the fully initialized ticket context
+ **/
+
+TlsTicketContext *tlsInitTicketContext(void)
+{
+   TlsTicketContext *ticketContext;
+
+   //Allocate a memory buffer to hold the ticket context
+   ticketContext = osMemAlloc(sizeof(TlsTicketContext));
+   //Failed to allocate memory?
+   if(ticketContext == NULL) return NULL;
+
+   //Clear memory. The first key is generated when the first ticket is issued
+   memset(ticketContext, 0, sizeof(TlsTicketContext));
+
+   //Create a mutex to prevent simultaneous access to the keys
+   ticketContext->mutex = osMutexCreate(FALSE);
+
+   //Out of ressources?
+   if(ticketContext->mutex == OS_INVALID_HANDLE)
+   {
+      //Clean up side effects
+      osMemFree(ticketContext);
+      //Report an error
+      return NULL;
+   }
+
+   //Return a pointer to the newly created ticket context
+   return ticketContext;
+}
+
+
+/**
+ * @brief Generate a new ticket key
+ * @param[in] context Pointer to the TLS context
+ * @param[out] key Buffer where to store the new key
+ * @param[in] time Current time
+ * @return Error code
+ **/
+
+static error_t tlsGenerateTicketKey(TlsContext *context, TlsTicketKey *key, time_t time)
+{
+   error_t error;
+
+   //The key name identifies the key used to protect a given ticket
+   error = context->prngAlgo->read(context->prngContext, key->name, sizeof(key->name));
+
+   //Generate the encryption key
+   if(!error)
+      error = context->prngAlgo->read(context->prngContext, key->encKey, sizeof(key->encKey));
+
+   //Generate the MAC key
+   if(!error)
+      error = context->prngAlgo->read(context->prngContext, key->macKey, sizeof(key->macKey));
+
+   //Check status code
+   if(!error)
+   {
+      //Save the time at which the key was generated
+      key->timestamp = time;
+      //The key can now be used
+      key->valid = TRUE;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Issue a ticket for the current session
+ * @param[in] context Pointer to the TLS context
+ * @param[out] ticket Buffer where to store the ticket (TLS_TICKET_SIZE bytes)
+ * @param[out] length Length of the ticket
+ * @return Error code
+ **/
+
+error_t tlsEncryptTicket(TlsContext *context, uint8_t *ticket, size_t *length)
+{
+   error_t error;
+   size_t n;
+   time_t time;
+   uint8_t *p;
+   uint8_t iv[TLS_TICKET_IV_SIZE];
+   TlsTicketKey key;
+   TlsTicketState *state;
+   TlsTicketContext *ticketContext;
+   AesContext *aesContext;
+
+   //Point to the ticket keys
+   ticketContext = context->ticketContext;
+   //Get current time
+   time = osGetTickCount();
+
+   //Acquire exclusive access to the ticket keys
+   osMutexAcquire(ticketContext->mutex);
+
+   //Point to the key used to protect new tickets
+   key = ticketContext->keys[ticketContext->current];
+
+   //The key is periodically renewed
+   if(!key.valid || (time - key.timestamp) >= TLS_TICKET_KEY_LIFETIME)
+   {
+      //Generate a new key
+      error = tlsGenerateTicketKey(context, &key, time);
+
+      //Check status code
+      if(!error)
+      {
+         //The new key replaces the oldest one. The other key is retained
+         //to decrypt the tickets issued before the rotation
+         ticketContext->current ^= 1;
+         ticketContext->keys[ticketContext->current] = key;
+      }
+   }
+   else
+   {
+      //The current key is still fresh
+      error = NO_ERROR;
+   }
+
+   //Release exclusive access to the ticket keys
+   osMutexRelease(ticketContext->mutex);
+
+   //Failed to generate a new key?
+   if(error)
+   {
+      //Clear the copy of the key
+      memset(&key, 0, sizeof(TlsTicketKey));
+      //Report an error
+      return error;
+   }
+
+   //The key name comes first
+   memcpy(ticket, key.name, TLS_TICKET_KEY_NAME_SIZE);
+   //Generate a random IV
+   error = context->prngAlgo->read(context->prngContext,
+      ticket + TLS_TICKET_KEY_NAME_SIZE, TLS_TICKET_IV_SIZE);
+
+   //Check status code
+   if(!error)
+   {
+      //Point to the session state
+      p = ticket + TLS_TICKET_KEY_NAME_SIZE + TLS_TICKET_IV_SIZE;
+      state = (TlsTicketState *) p;
+
+      //Format the session state
+      state->version = htons(context->version);
+      state->cipherSuite = htons(context->cipherSuite);
+      state->compressionMethod = context->compressionMethod;
+      memcpy(state->masterSecret, context->masterSecret, 48);
+      state->timestamp = htonl(time);
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+      //TLS 1.3 tickets also carry the value used to obfuscate their age
+      //and the amount of 0-RTT data the server accepts
+      state->ticketAgeAdd = htonl(context->ticketAgeAdd);
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+      state->maxEarlyDataSize = htonl(context->maxEarlyDataSize);
+#else
+      state->maxEarlyDataSize = 0;
+#endif
+#endif
+
+      //Pad the state to a multiple of the block size
+      n = TLS_TICKET_STATE_SIZE - sizeof(TlsTicketState);
+      memset(p + sizeof(TlsTicketState), n, n);
+
+      //Allocate a memory buffer to hold the encryption context
+      aesContext = osMemAlloc(sizeof(AesContext));
+
+      //Successful memory allocation?
+      if(aesContext != NULL)
+      {
+         //Initialize the encryption context
+         error = aesInit(aesContext, key.encKey, sizeof(key.encKey));
+
+         //Check status code
+         if(!error)
+         {
+            //The IV is updated by the CBC encryption routine
+            memcpy(iv, ticket + TLS_TICKET_KEY_NAME_SIZE, TLS_TICKET_IV_SIZE);
+            //Encrypt the session state
+            error = cbcEncrypt(AES_CIPHER_ALGO, aesContext, iv, p, p, TLS_TICKET_STATE_SIZE);
+         }
+
+         //Clear the encryption context before freeing memory
+         memset(aesContext, 0, sizeof(AesContext));
+         osMemFree(aesContext);
+      }
+      else
+      {
+         //Failed to allocate memory
+         error = ERROR_OUT_OF_MEMORY;
+      }
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //The MAC covers the key name, the IV and the encrypted state
+      n = TLS_TICKET_KEY_NAME_SIZE + TLS_TICKET_IV_SIZE + TLS_TICKET_STATE_SIZE;
+      //Append the MAC to the ticket
+      error = hmacCompute(SHA256_HASH_ALGO, key.macKey, sizeof(key.macKey), ticket, n, ticket + n);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Debug message
+      TRACE_DEBUG("Session ticket issued (%u bytes)\r\n", TLS_TICKET_SIZE);
+      //Return the length of the ticket
+      *length = TLS_TICKET_SIZE;
+   }
+
+   //Clear the copy of the key
+   memset(&key, 0, sizeof(TlsTicketKey));
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Decrypt a ticket presented by the client
+ *
+ * If the ticket is valid, the session parameters it holds are
+ * restored into the TLS context
+ *
+ * @param[in] context Pointer to the TLS context
+ * @param[in] ticket Pointer to the ticket
+ * @param[in] length Length of the ticket
+ * @return Error code
+ **/
+
+error_t tlsDecryptTicket(TlsContext *context, const uint8_t *ticket, size_t length)
+{
+   error_t error;
+   uint_t i;
+   size_t n;
+   time_t time;
+   uint8_t iv[TLS_TICKET_IV_SIZE];
+   uint8_t mac[TLS_TICKET_MAC_SIZE];
+   uint8_t buffer[TLS_TICKET_STATE_SIZE];
+   TlsTicketKey key;
+   TlsTicketState *state;
+   TlsTicketContext *ticketContext;
+   AesContext *aesContext;
+
+   //The server only accepts the tickets it has issued
+   if(length != TLS_TICKET_SIZE)
+      return ERROR_INVALID_LENGTH;
+
+   //Point to the ticket keys
+   ticketContext = context->ticketContext;
+   //Get current time
+   time = osGetTickCount();
+   //No matching key found so far
+   key.valid = FALSE;
+
+   //Acquire exclusive access to the ticket keys
+   osMutexAcquire(ticketContext->mutex);
+
+   //Search for the key that protects the ticket
+   for(i = 0; i < arraysize(ticketContext->keys); i++)
+   {
+      //Keys are no more needed once the last ticket they protect has expired
+      if(ticketContext->keys[i].valid &&
+         (time - ticketContext->keys[i].timestamp) < (TLS_TICKET_KEY_LIFETIME + TLS_TICKET_LIFETIME) &&
+         !memcmp(ticketContext->keys[i].name, ticket, TLS_TICKET_KEY_NAME_SIZE))
+      {
+         //Copy the matching key
+         key = ticketContext->keys[i];
+         break;
+      }
+   }
+
+   //Release exclusive access to the ticket keys
+   osMutexRelease(ticketContext->mutex);
+
+   //Unknown or outdated key?
+   if(!key.valid)
+      return ERROR_INVALID_KEY;
+
+   //Compute the MAC over the key name, the IV and the encrypted state
+   n = TLS_TICKET_KEY_NAME_SIZE + TLS_TICKET_IV_SIZE + TLS_TICKET_STATE_SIZE;
+   error = hmacCompute(SHA256_HASH_ALGO, key.macKey, sizeof(key.macKey), ticket, n, mac);
+
+   //The ticket must be authenticated before it is decrypted
+   if(!error && memcmp(mac, ticket + n, TLS_TICKET_MAC_SIZE))
+      error = ERROR_INVALID_MAC;
+
+   //Check status code
+   if(!error)
+   {
+      //Allocate a memory buffer to hold the decryption context
+      aesContext = osMemAlloc(sizeof(AesContext));
+
+      //Successful memory allocation?
+      if(aesContext != NULL)
+      {
+         //Initialize the decryption context
+         error = aesInit(aesContext, key.encKey, sizeof(key.encKey));
+
+         //Check status code
+         if(!error)
+         {
+            //The IV is updated by the CBC decryption routine
+            memcpy(iv, ticket + TLS_TICKET_KEY_NAME_SIZE, TLS_TICKET_IV_SIZE);
+            //Decrypt the session state
+            error = cbcDecrypt(AES_CIPHER_ALGO, aesContext, iv, ticket +
+               TLS_TICKET_KEY_NAME_SIZE + TLS_TICKET_IV_SIZE, buffer, TLS_TICKET_STATE_SIZE);
+         }
+
+         //Clear the decryption context before freeing memory
+         memset(aesContext, 0, sizeof(AesContext));
+         osMemFree(aesContext);
+      }
+      else
+      {
+         //Failed to allocate memory
+         error = ERROR_OUT_OF_MEMORY;
+      }
+   }
+
+   //Clear the copy of the key
+   memset(&key, 0, sizeof(TlsTicketKey));
+
+   //Check status code
+   if(!error)
+   {
+      //Point to the session state
+      state = (TlsTicketState *) buffer;
+
+      //Outdated ticket?
+      if((time - (time_t) ntohl(state->timestamp)) >= TLS_TICKET_LIFETIME)
+         error = ERROR_TIMEOUT;
+      //The session must be resumed with the negotiated version
+      else if(ntohs(state->version) != context->version)
+         error = ERROR_INVALID_VERSION;
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Select the cipher suite of the session
+      error = tlsSetCipherSuite(context, ntohs(state->cipherSuite));
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Select the compression method of the session
+      error = tlsSetCompressionMethod(context, state->compressionMethod);
+   }
+
+   //Check status code
+   if(!error)
+   {
+      //Restore master secret
+      memcpy(context->masterSecret, state->masterSecret, 48);
+
+#if (TLS_MAX_VERSION >= TLS_VERSION_1_3)
+      //The age of a TLS 1.3 ticket is checked against the time of issue
+      context->ticketAgeAdd = ntohl(state->ticketAgeAdd);
+      context->ticketTimestamp = (time_t) ntohl(state->timestamp);
+#if (TLS_EARLY_DATA_SUPPORT == ENABLED)
+      context->sessionMaxEarlyDataSize = ntohl(state->maxEarlyDataSize);
+#endif
+#endif
+      //Debug message
+      TRACE_DEBUG("Session ticket accepted\r\n");
+   }
+
+   //Clear the session state
+   memset(buffer, 0, sizeof(buffer));
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Properly dispose a ticket context
+ * @param[in] ticketContext Pointer to the ticket context to be released
+ **/
+
+void tlsFreeTicketContext(TlsTicketContext *ticketContext)
+{
+   //Invalid ticket context?
+   if(ticketContext == NULL)
+      return;
+
+   //Release previously allocated ressources
+   osMutexClose(ticketContext->mutex);
+
+   //Clear the ticket keys before freeing memory
+   memset(ticketContext, 0, sizeof(TlsTicketContext));
+   osMemFree(ticketContext);
+}
+
+#endif
@@ -43,6 +43,13 @@ const in6_addr in6addr_any =
 const in6_addr in6addr_loopback =
    {{0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01}};
 
+//BSD socket related local functions
+static error_t bsdParseSockAddr(const sockaddr *addr,
+   int_t addrlen, IpAddr *ipAddr, uint16_t *port);
+
+static error_t bsdFormatSockAddr(const IpAddr *ipAddr,
+   uint16_t port, sockaddr *addr, int_t *addrlen);
+
 
 /**
  * @brief Create a socket that is bound to a specific transport service provider
@@ -96,14 +103,14 @@ int_t bind(int_t s, const sockaddr *addr, int_t addrlen)
    Socket *socket;
 
    //Make sure the socket descriptor is valid
-   if(s < 0 || s >= SOCKET_MAX_COUNT)
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
    {
       socketError(NULL, ERROR_INVALID_SOCKET);
       return SOCKET_ERROR;
    }
 
    //Point to the socket structure
-   socket = &socketTable[s];
+   socket = socketTable[s];
 
    //Check the length of the address
    if(addrlen < sizeof(sockaddr))
@@ -198,14 +205,14 @@ int_t connect(int_t s, const sockaddr *addr, int_t addrlen)
    Socket *socket;
 
    //Make sure the socket descriptor is valid
-   if(s < 0 || s >= SOCKET_MAX_COUNT)
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
    {
       socketError(NULL, ERROR_INVALID_SOCKET);
       return SOCKET_ERROR;
    }
 
    //Point to the socket structure
-   socket = &socketTable[s];
+   socket = socketTable[s];
 
    //Check the length of the address
    if(addrlen < sizeof(sockaddr))
@@ -299,14 +306,14 @@ int_t listen(int_t s, int_t backlog)
    Socket *socket;
 
    //Make sure the socket descriptor is valid
-   if(s < 0 || s >= SOCKET_MAX_COUNT)
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
    {
       socketError(NULL, ERROR_INVALID_SOCKET);
       return SOCKET_ERROR;
    }
 
    //Point to the socket structure
-   socket = &socketTable[s];
+   socket = socketTable[s];
 
    //Place the socket in the listening state
    error = socketListen(socket);
@@ -340,14 +347,14 @@ int_t accept(int_t s, sockaddr *addr, int_t *addrlen)
    Socket *newSocket;
 
    //Make sure the socket descriptor is valid
-   if(s < 0 || s >= SOCKET_MAX_COUNT)
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
    {
       socketError(NULL, ERROR_INVALID_SOCKET);
       return SOCKET_ERROR;
    }
 
    //Point to the socket structure
-   socket = &socketTable[s];
+   socket = socketTable[s];
 
    //Permit an incoming connection attempt on a socket
    newSocket = socketAccept(socket, &ipAddr, &port);
@@ -424,14 +431,14 @@ int_t send(int_t s, const void *data, int_t length, int_t flags)
    Socket *socket;
 
    //Make sure the socket descriptor is valid
-   if(s < 0 || s >= SOCKET_MAX_COUNT)
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
    {
       socketError(NULL, ERROR_INVALID_SOCKET);
       return SOCKET_ERROR;
    }
 
    //Point to the socket structure
-   socket = &socketTable[s];
+   socket = socketTable[s];
 
    //Send data
    error = socketSend(socket, data, length, &written, flags << 8);
@@ -471,57 +478,22 @@ int_t sendto(int_t s, const void *data, int_t length,
    Socket *socket;
 
    //Make sure the socket descriptor is valid
-   if(s < 0 || s >= SOCKET_MAX_COUNT)
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
    {
       socketError(NULL, ERROR_INVALID_SOCKET);
       return SOCKET_ERROR;
    }
 
    //Point to the socket structure
-   socket = &socketTable[s];
-
-   //Check the length of the address
-   if(addrlen < sizeof(sockaddr))
-   {
-      //Report an error
-      socketError(socket, ERROR_INVALID_PARAMETER);
-      return SOCKET_ERROR;
-   }
-
-#if (IPV4_SUPPORT == ENABLED)
-   //IPv4 address?
-   if(addr->sa_family == AF_INET && addrlen == sizeof(sockaddr_in))
-   {
-      //Point to the IPv4 address information
-      sockaddr_in *sa = (sockaddr_in *) addr;
-
-      //Get port number
-      port = ntohs(sa->sin_port);
-      //Copy IPv4 address
-      ipAddr.length = sizeof(Ipv4Addr);
-      ipAddr.ipv4Addr = sa->sin_addr.s_addr;
-   }
-   else
-#endif
-#if (IPV6_SUPPORT == ENABLED)
-   //IPv6 address?
-   if(addr->sa_family == AF_INET6 && addrlen == sizeof(sockaddr_in6))
-   {
-      //Point to the IPv6 address information
-      sockaddr_in6 *sa = (sockaddr_in6 *) addr;
+   socket = socketTable[s];
 
-      //Get port number
-      port = ntohs(sa->sin6_port);
-      //Copy IPv6 address
-      ipAddr.length = sizeof(Ipv6Addr);
-      ipv6CopyAddr(&ipAddr.ipv6Addr, sa->sin6_addr.s6_addr);
-   }
-   else
-#endif
+   //Convert the destination address
+   error = bsdParseSockAddr(addr, addrlen, &ipAddr, &port);
    //Invalid address?
+   if(error)
    {
       //Report an error
-      socketError(socket, ERROR_INVALID_PARAMETER);
+      socketError(socket, error);
       return SOCKET_ERROR;
    }
 
@@ -558,14 +530,14 @@ int_t recv(int_t s, void *data, int_t size, int_t flags)
    Socket *socket;
 
    //Make sure the socket descriptor is valid
-   if(s < 0 || s >= SOCKET_MAX_COUNT)
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
    {
       socketError(NULL, ERROR_INVALID_SOCKET);
       return SOCKET_ERROR;
    }
 
    //Point to the socket structure
-   socket = &socketTable[s];
+   socket = socketTable[s];
 
    //Receive data
    error = socketReceive(socket, data, size, &received, flags << 8);
@@ -605,14 +577,14 @@ int_t recvfrom(int_t s, void *data, int_t size,
    Socket *socket;
 
    //Make sure the socket descriptor is valid
-   if(s < 0 || s >= SOCKET_MAX_COUNT)
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
    {
       socketError(NULL, ERROR_INVALID_SOCKET);
       return SOCKET_ERROR;
    }
 
    //Point to the socket structure
-   socket = &socketTable[s];
+   socket = socketTable[s];
 
    //Receive data
    error = socketReceiveFrom(socket, &ipAddr, &port, data, size, &received, flags << 8);
@@ -627,50 +599,300 @@ int_t recvfrom(int_t s, void *data, int_t size,
    //The address is optional
    if(addr != NULL && addrlen != NULL)
    {
-#if (IPV4_SUPPORT == ENABLED)
-      //IPv4 address?
-      if(ipAddr.length == sizeof(Ipv4Addr) && *addrlen >= sizeof(sockaddr_in))
+      //Return the address of the peer
+      error = bsdFormatSockAddr(&ipAddr, port, addr, addrlen);
+      //Any error to report?
+      if(error)
       {
-         //Point to the IPv4 address information
-         sockaddr_in *sa = (sockaddr_in *) addr;
+         socketError(socket, error);
+         return SOCKET_ERROR;
+      }
+   }
 
-         //Set address family and port number
-         sa->sin_family = AF_INET;
-         sa->sin_port = htons(port);
-         //Copy IPv4 address
-         sa->sin_addr.s_addr = ipAddr.ipv4Addr;
+   //Return the number of bytes received
+   return received;
+}
 
-         //Return the actual length of the address
-         *addrlen = sizeof(sockaddr_in);
+
+/**
+ * @brief Send several datagrams in a single call
+ * @param[in] s Descriptor that identifies a socket
+ * @param[in,out] msgvec Array of datagram descriptors
+ * @param[in] vlen Number of entries in the array
+ * @return If no error occurs, the function returns the number of datagrams
+ *   that have been sent. Otherwise, it returns SOCKET_ERROR
+ **/
+
+int_t sendmmsg(int_t s, mmsghdr *msgvec, uint_t vlen)
+{
+   error_t error;
+   error_t status;
+   uint_t i;
+   uint_t j;
+   uint_t n;
+   uint_t sent;
+   uint_t total;
+   Socket *socket;
+   SocketMessage messages[BSD_SOCKET_BATCH_SIZE];
+
+   //Make sure the socket descriptor is valid
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
+   {
+      socketError(NULL, ERROR_INVALID_SOCKET);
+      return SOCKET_ERROR;
+   }
+
+   //Point to the socket structure
+   socket = socketTable[s];
+
+   //Initialize status code
+   error = NO_ERROR;
+   //Number of datagrams sent so far
+   total = 0;
+
+   //Process datagrams by blocks
+   for(i = 0; i < vlen; i += n)
+   {
+      //Number of datagrams in the current block
+      n = min(vlen - i, BSD_SOCKET_BATCH_SIZE);
+
+      //Fill in the datagram descriptors
+      for(j = 0; j < n; j++)
+      {
+         //Convert the destination address
+         error = bsdParseSockAddr(msgvec[i + j].msg_name, msgvec[i + j].msg_namelen,
+            &messages[j].remoteIpAddr, &messages[j].remotePort);
+         //Invalid address?
+         if(error) break;
+
+         //Point to the payload
+         messages[j].data = msgvec[i + j].msg_data;
+         messages[j].size = msgvec[i + j].msg_size;
       }
-      else
-#endif
-#if (IPV6_SUPPORT == ENABLED)
-      //IPv6 address?
-      if(ipAddr.length == sizeof(Ipv6Addr) && *addrlen >= sizeof(sockaddr_in6))
+
+      //No datagram has been sent yet
+      sent = 0;
+
+      //Send the datagrams whose address is valid
+      if(j > 0)
       {
-         //Point to the IPv6 address information
-         sockaddr_in6 *sa = (sockaddr_in6 *) addr;
+         status = socketSendBatch(socket, messages, j, &sent);
+         //An error is only returned when no datagram could be sent
+         if(status) error = status;
+      }
 
-         //Set address family and port number
-         sa->sin6_family = AF_INET6;
-         sa->sin6_port = htons(port);
-         //Copy IPv6 address
-         ipv6CopyAddr(sa->sin6_addr.s6_addr, &ipAddr.ipv6Addr);
+      //Return the number of bytes sent for each datagram
+      for(j = 0; j < sent; j++)
+         msgvec[i + j].msg_len = messages[j].length;
 
-         //Return the actual length of the address
-         *addrlen = sizeof(sockaddr_in6);
+      //Update the number of datagrams sent so far
+      total += sent;
+
+      //Stop at the first datagram that cannot be sent
+      if(sent < n)
+      {
+         //Report an error only if no datagram could be sent
+         if(!total)
+         {
+            socketError(socket, error);
+            return SOCKET_ERROR;
+         }
+
+         //Exit immediately
+         break;
       }
-      else
-#endif
-      //Invalid address?
+   }
+
+   //Return the number of datagrams sent
+   return total;
+}
+
+
+/**
+ * @brief Receive several datagrams in a single call
+ *
+ * The function waits for the first datagram, then returns the datagrams
+ * that are already queued, up to BSD_SOCKET_BATCH_SIZE per call
+ *
+ * @param[in] s Descriptor that identifies a socket
+ * @param[in,out] msgvec Array of datagram descriptors
+ * @param[in] vlen Number of entries in the array
+ * @return If no error occurs, the function returns the number of datagrams
+ *   that have been received. Otherwise, it returns SOCKET_ERROR
+ **/
+
+int_t recvmmsg(int_t s, mmsghdr *msgvec, uint_t vlen)
+{
+   error_t error;
+   uint_t i;
+   uint_t n;
+   uint_t received;
+   Socket *socket;
+   SocketMessage messages[BSD_SOCKET_BATCH_SIZE];
+
+   //Make sure the socket descriptor is valid
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
+   {
+      socketError(NULL, ERROR_INVALID_SOCKET);
+      return SOCKET_ERROR;
+   }
+
+   //Point to the socket structure
+   socket = socketTable[s];
+
+   //Number of datagrams that can be received at once
+   n = min(vlen, BSD_SOCKET_BATCH_SIZE);
+   //Nothing to do?
+   if(!n) return 0;
+
+   //Fill in the datagram descriptors
+   for(i = 0; i < n; i++)
+   {
+      messages[i].data = msgvec[i].msg_data;
+      messages[i].size = msgvec[i].msg_size;
+   }
+
+   //Receive datagrams
+   error = socketReceiveBatch(socket, messages, n, &received);
+
+   //Any error to report?
+   if(error)
+   {
+      socketError(socket, error);
+      return SOCKET_ERROR;
+   }
+
+   //Loop through the datagrams that have been received
+   for(i = 0; i < received; i++)
+   {
+      //Return the number of bytes received
+      msgvec[i].msg_len = messages[i].length;
+
+      //The address is optional
+      if(msgvec[i].msg_name != NULL)
       {
-         //Report an error
-         socketError(socket, ERROR_INVALID_PARAMETER);
-         return SOCKET_ERROR;
+         //The datagram is already consumed, so an address that does
+         //not fit in the supplied buffer is simply not returned
+         if(bsdFormatSockAddr(&messages[i].remoteIpAddr, messages[i].remotePort,
+            msgvec[i].msg_name, &msgvec[i].msg_namelen))
+         {
+            msgvec[i].msg_namelen = 0;
+         }
       }
    }
 
+   //Return the number of datagrams received
+   return received;
+}
+
+
+/**
+ * @brief Send data gathered from several buffers
+ * @param[in] s Descriptor that identifies a connected socket
+ * @param[in] iov Array of buffers that hold the data to be sent
+ * @param[in] iovcnt Number of entries in the array (BSD_SOCKET_IOV_MAX at most)
+ * @return If no error occurs, writev returns the total number of bytes sent.
+ *   Otherwise, it returns SOCKET_ERROR
+ **/
+
+int_t writev(int_t s, const iovec *iov, int_t iovcnt)
+{
+   error_t error;
+   int_t i;
+   size_t written;
+   Socket *socket;
+   SocketIoVec vector[BSD_SOCKET_IOV_MAX];
+
+   //Make sure the socket descriptor is valid
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
+   {
+      socketError(NULL, ERROR_INVALID_SOCKET);
+      return SOCKET_ERROR;
+   }
+
+   //Point to the socket structure
+   socket = socketTable[s];
+
+   //Check the number of buffers
+   if(iovcnt < 0 || iovcnt > BSD_SOCKET_IOV_MAX)
+   {
+      socketError(socket, ERROR_INVALID_PARAMETER);
+      return SOCKET_ERROR;
+   }
+
+   //Fill in the I/O vector
+   for(i = 0; i < iovcnt; i++)
+   {
+      vector[i].data = iov[i].iov_base;
+      vector[i].length = iov[i].iov_len;
+   }
+
+   //Send data
+   error = socketSendv(socket, vector, iovcnt, &written, 0);
+
+   //Any error to report?
+   if(error)
+   {
+      socketError(socket, error);
+      return SOCKET_ERROR;
+   }
+
+   //Return the number of bytes transferred so far
+   return written;
+}
+
+
+/**
+ * @brief Receive data into several buffers
+ * @param[in] s Descriptor that identifies a connected socket
+ * @param[in] iov Array of buffers where to store the incoming data
+ * @param[in] iovcnt Number of entries in the array (BSD_SOCKET_IOV_MAX at most)
+ * @return If no error occurs, readv returns the total number of bytes
+ *   received. Otherwise, it returns SOCKET_ERROR
+ **/
+
+int_t readv(int_t s, const iovec *iov, int_t iovcnt)
+{
+   error_t error;
+   int_t i;
+   size_t received;
+   Socket *socket;
+   SocketIoVec vector[BSD_SOCKET_IOV_MAX];
+
+   //Make sure the socket descriptor is valid
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
+   {
+      socketError(NULL, ERROR_INVALID_SOCKET);
+      return SOCKET_ERROR;
+   }
+
+   //Point to the socket structure
+   socket = socketTable[s];
+
+   //Check the number of buffers
+   if(iovcnt < 0 || iovcnt > BSD_SOCKET_IOV_MAX)
+   {
+      socketError(socket, ERROR_INVALID_PARAMETER);
+      return SOCKET_ERROR;
+   }
+
+   //Fill in the I/O vector
+   for(i = 0; i < iovcnt; i++)
+   {
+      vector[i].data = iov[i].iov_base;
+      vector[i].length = iov[i].iov_len;
+   }
+
+   //Receive data
+   error = socketReceivev(socket, vector, iovcnt, &received, 0);
+
+   //Any error to report?
+   if(error)
+   {
+      socketError(socket, error);
+      return SOCKET_ERROR;
+   }
+
    //Return the number of bytes received
    return received;
 }
@@ -690,14 +912,14 @@ int_t getsockname(int_t s, sockaddr *addr, int_t *addrlen)
    Socket *socket;
 
    //Make sure the socket descriptor is valid
-   if(s < 0 || s >= SOCKET_MAX_COUNT)
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
    {
       socketError(NULL, ERROR_INVALID_SOCKET);
       return SOCKET_ERROR;
    }
 
    //Point to the socket structure
-   socket = &socketTable[s];
+   socket = socketTable[s];
 
    //The socket has not been bound to an address?
    if(!socket->localIpAddr.length)
@@ -768,14 +990,14 @@ int_t getpeername(int_t s, sockaddr *addr, int_t *addrlen)
    Socket *socket;
 
    //Make sure the socket descriptor is valid
-   if(s < 0 || s >= SOCKET_MAX_COUNT)
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
    {
       socketError(NULL, ERROR_INVALID_SOCKET);
       return SOCKET_ERROR;
    }
 
    //Point to the socket structure
-   socket = &socketTable[s];
+   socket = socketTable[s];
 
    //The socket has not been bound to an address?
    if(!socket->remoteIpAddr.length)
@@ -847,16 +1069,17 @@ int_t setsockopt(int_t s, int_t level, int_t optname, const void *optval, int_t
 {
    timeval *t;
    Socket *socket;
+   char_t name[16];
 
    //Make sure the socket descriptor is valid
-   if(s < 0 || s >= SOCKET_MAX_COUNT)
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
    {
       socketError(NULL, ERROR_INVALID_SOCKET);
       return SOCKET_ERROR;
    }
 
    //Point to the socket structure
-   socket = &socketTable[s];
+   socket = socketTable[s];
 
    //Make sure the option is valid
    if(!optval)
@@ -893,6 +1116,212 @@ int_t setsockopt(int_t s, int_t level, int_t optname, const void *optval, int_t
          //Successful processing
          break;
 
+      //Share the local port between several listening sockets?
+      case SO_REUSEPORT:
+         //Check option length
+         if(optlen < sizeof(int_t))
+         {
+            socketError(NULL, ERROR_INVALID_LENGTH);
+            return SOCKET_ERROR;
+         }
+
+         //Enable or disable the option
+         if(socketSetReusePort(socket, *((int_t *) optval) != 0))
+         {
+            socketError(socket, ERROR_INVALID_OPTION);
+            return SOCKET_ERROR;
+         }
+
+         //Successful processing
+         break;
+
+      //Priority of the outgoing traffic?
+      case SO_PRIORITY:
+         //Check option length
+         if(optlen < sizeof(int_t))
+         {
+            socketError(NULL, ERROR_INVALID_LENGTH);
+            return SOCKET_ERROR;
+         }
+
+         //Set the priority level
+         if(*((int_t *) optval) < 0 ||
+            socketSetPriority(socket, *((int_t *) optval)))
+         {
+            socketError(socket, ERROR_INVALID_OPTION);
+            return SOCKET_ERROR;
+         }
+
+         //Successful processing
+         break;
+
+      //Size of the send buffer?
+      case SO_SNDBUF:
+         //Check option length
+         if(optlen < sizeof(int_t))
+         {
+            socketError(NULL, ERROR_INVALID_LENGTH);
+            return SOCKET_ERROR;
+         }
+
+         //Adjust the size of the send buffer
+         if(*((int_t *) optval) <= 0 ||
+            socketSetTxBufferSize(socket, *((int_t *) optval)))
+         {
+            socketError(socket, ERROR_INVALID_OPTION);
+            return SOCKET_ERROR;
+         }
+
+         //Successful processing
+         break;
+
+      //Size of the receive buffer?
+      case SO_RCVBUF:
+         //Check option length
+         if(optlen < sizeof(int_t))
+         {
+            socketError(NULL, ERROR_INVALID_LENGTH);
+            return SOCKET_ERROR;
+         }
+
+         //Adjust the size of the receive buffer
+         if(*((int_t *) optval) <= 0 ||
+            socketSetRxBufferSize(socket, *((int_t *) optval)))
+         {
+            socketError(socket, ERROR_INVALID_OPTION);
+            return SOCKET_ERROR;
+         }
+
+         //Successful processing
+         break;
+
+      //Send low-watermark?
+      case SO_SNDLOWAT:
+         //Check option length
+         if(optlen < sizeof(int_t))
+         {
+            socketError(NULL, ERROR_INVALID_LENGTH);
+            return SOCKET_ERROR;
+         }
+
+         //Adjust the minimum amount of free space that makes the socket writable
+         if(*((int_t *) optval) <= 0 ||
+            socketSetTxLowWatermark(socket, *((int_t *) optval)))
+         {
+            socketError(socket, ERROR_INVALID_OPTION);
+            return SOCKET_ERROR;
+         }
+
+         //Successful processing
+         break;
+
+      //Receive low-watermark?
+      case SO_RCVLOWAT:
+         //Check option length
+         if(optlen < sizeof(int_t))
+         {
+            socketError(NULL, ERROR_INVALID_LENGTH);
+            return SOCKET_ERROR;
+         }
+
+         //Adjust the minimum amount of data that makes the socket readable
+         if(*((int_t *) optval) <= 0 ||
+            socketSetRxLowWatermark(socket, *((int_t *) optval)))
+         {
+            socketError(socket, ERROR_INVALID_OPTION);
+            return SOCKET_ERROR;
+         }
+
+         //Successful processing
+         break;
+
+      //Attach a packet filter?
+      case SO_ATTACH_FILTER:
+         //Check option length
+         if(optlen < sizeof(sock_fprog))
+         {
+            socketError(NULL, ERROR_INVALID_LENGTH);
+            return SOCKET_ERROR;
+         }
+
+         //Validate and attach the filter program
+         if(socketSetFilter(socket, ((sock_fprog *) optval)->filter,
+            ((sock_fprog *) optval)->len))
+         {
+            socketError(socket, ERROR_INVALID_OPTION);
+            return SOCKET_ERROR;
+         }
+
+         //Successful processing
+         break;
+
+      //Detach the current packet filter?
+      case SO_DETACH_FILTER:
+         //Remove the filter program
+         if(socketSetFilter(socket, NULL, 0))
+         {
+            socketError(socket, ERROR_INVALID_OPTION);
+            return SOCKET_ERROR;
+         }
+
+         //Successful processing
+         break;
+
+      //Unknown option?
+      default:
+         //Report an error
+         socketError(NULL, ERROR_INVALID_OPTION);
+         return SOCKET_ERROR;
+      }
+   }
+   //TCP level options
+   else if(level == IPPROTO_TCP)
+   {
+      //Check option type
+      switch(optname)
+      {
+      //Hold back partial segments?
+      case TCP_CORK:
+         //Check option length
+         if(optlen < sizeof(int_t))
+         {
+            socketError(NULL, ERROR_INVALID_LENGTH);
+            return SOCKET_ERROR;
+         }
+
+         //Cork or uncork the connection
+         if(socketSetCork(socket, *((int_t *) optval) ? TRUE : FALSE))
+         {
+            socketError(socket, ERROR_INVALID_OPTION);
+            return SOCKET_ERROR;
+         }
+
+         //Successful processing
+         break;
+
+      //Congestion control algorithm?
+      case TCP_CONGESTION:
+         //Check option length
+         if(optlen < 1 || optlen >= sizeof(name))
+         {
+            socketError(NULL, ERROR_INVALID_LENGTH);
+            return SOCKET_ERROR;
+         }
+
+         //The name is not necessarily NULL-terminated
+         memcpy(name, optval, optlen);
+         name[optlen] = '\0';
+
+         //Select the specified algorithm
+         if(socketSetCongestionControl(socket, name))
+         {
+            socketError(socket, ERROR_INVALID_OPTION);
+            return SOCKET_ERROR;
+         }
+
+         //Successful processing
+         break;
+
       //Unknown option?
       default:
          //Report an error
@@ -930,14 +1359,14 @@ int_t getsockopt(int_t s, int_t level, int_t optname, void *optval, int_t *optle
    Socket *socket;
 
    //Make sure the socket descriptor is valid
-   if(s < 0 || s >= SOCKET_MAX_COUNT)
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
    {
       socketError(NULL, ERROR_INVALID_SOCKET);
       return SOCKET_ERROR;
    }
 
    //Point to the socket structure
-   socket = &socketTable[s];
+   socket = socketTable[s];
 
    //Make sure the option is valid
    if(!optval)
@@ -997,6 +1426,102 @@ int_t getsockopt(int_t s, int_t level, int_t optname, void *optval, int_t *optle
          //Successful processing
          break;
 
+      //Priority of the outgoing traffic?
+      case SO_PRIORITY:
+         //Check option length
+         if(*optlen < sizeof(int_t))
+         {
+            socketError(NULL, ERROR_INVALID_LENGTH);
+            return SOCKET_ERROR;
+         }
+         //Copy priority level
+         *((int_t *) optval) = socket->priority;
+         //Return the actual length of the option
+         *optlen = sizeof(int_t);
+         //Successful processing
+         break;
+
+#if (TCP_SUPPORT == ENABLED)
+      //Send or receive low-watermark?
+      case SO_SNDLOWAT:
+      case SO_RCVLOWAT:
+         //Check option length
+         if(*optlen < sizeof(int_t))
+         {
+            socketError(NULL, ERROR_INVALID_LENGTH);
+            return SOCKET_ERROR;
+         }
+         //The option only applies to connection-oriented sockets
+         if(socket->type != SOCKET_TYPE_STREAM)
+         {
+            socketError(socket, ERROR_INVALID_OPTION);
+            return SOCKET_ERROR;
+         }
+         //Copy the watermark
+         if(optname == SO_SNDLOWAT)
+            *((int_t *) optval) = socket->txLowWat;
+         else
+            *((int_t *) optval) = socket->rxLowWat;
+         //Return the actual length of the option
+         *optlen = sizeof(int_t);
+         //Successful processing
+         break;
+#endif
+
+      //Unknown option?
+      default:
+         //Report an error
+         socketError(NULL, ERROR_INVALID_OPTION);
+         return SOCKET_ERROR;
+      }
+   }
+   else if(level == IPPROTO_TCP)
+   {
+      //Check option type
+      switch(optname)
+      {
+      //Connection state and statistics?
+      case TCP_INFO:
+         //Check option length
+         if(*optlen < sizeof(TcpInfo))
+         {
+            socketError(NULL, ERROR_INVALID_LENGTH);
+            return SOCKET_ERROR;
+         }
+         //Retrieve a snapshot of the connection
+         if(socketGetTcpInfo(socket, (TcpInfo *) optval))
+         {
+            socketError(socket, ERROR_INVALID_OPTION);
+            return SOCKET_ERROR;
+         }
+         //Return the actual length of the option
+         *optlen = sizeof(TcpInfo);
+         //Successful processing
+         break;
+
+#if (TCP_SUPPORT == ENABLED)
+      //Hold back partial segments?
+      case TCP_CORK:
+         //Check option length
+         if(*optlen < sizeof(int_t))
+         {
+            socketError(NULL, ERROR_INVALID_LENGTH);
+            return SOCKET_ERROR;
+         }
+         //The option only applies to connection-oriented sockets
+         if(socket->type != SOCKET_TYPE_STREAM)
+         {
+            socketError(socket, ERROR_INVALID_OPTION);
+            return SOCKET_ERROR;
+         }
+         //Copy the current setting
+         *((int_t *) optval) = socket->txCork;
+         //Return the actual length of the option
+         *optlen = sizeof(int_t);
+         //Successful processing
+         break;
+#endif
+
       //Unknown option?
       default:
          //Report an error
@@ -1031,14 +1556,14 @@ int_t shutdown(int_t s, int_t how)
    Socket *socket;
 
    //Make sure the socket descriptor is valid
-   if(s < 0 || s >= SOCKET_MAX_COUNT)
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
    {
       socketError(NULL, ERROR_INVALID_SOCKET);
       return SOCKET_ERROR;
    }
 
    //Point to the socket structure
-   socket = &socketTable[s];
+   socket = socketTable[s];
 
    //Shutdown socket
    error = socketShutdown(socket, how);
@@ -1067,14 +1592,14 @@ int_t closesocket(int_t s)
    Socket *socket;
 
    //Make sure the socket descriptor is valid
-   if(s < 0 || s >= SOCKET_MAX_COUNT)
+   if(s < 0 || s >= SOCKET_MAX_COUNT || socketTable[s] == NULL)
    {
       socketError(NULL, ERROR_INVALID_SOCKET);
       return SOCKET_ERROR;
    }
 
    //Point to the socket structure
-   socket = &socketTable[s];
+   socket = socketTable[s];
 
    //Close socket
    socketClose(socket);
@@ -1156,7 +1681,7 @@ int_t select(int_t nfds, fd_set *readfds, fd_set *writefds,
             //Get the descriptor associated with the current entry
             s = fds->fd_array[j];
             //Subscribe to the requested events
-            socketRegisterEvents(&socketTable[s], event, eventMask);
+            socketRegisterEvents(socketTable[s], event, eventMask);
          }
       }
    }
@@ -1205,9 +1730,9 @@ int_t select(int_t nfds, fd_set *readfds, fd_set *writefds,
             //Get the descriptor associated with the current entry
             s = fds->fd_array[j];
             //Retrieve event flags for the current socket
-            socketGetEvents(&socketTable[s], &eventFlags);
+            socketGetEvents(socketTable[s], &eventFlags);
             //Unsubscribe previously registered events
-            socketUnregisterEvents(&socketTable[s]);
+            socketUnregisterEvents(socketTable[s]);
 
             //Event flag is set?
             if(eventFlags & eventMask)
@@ -1384,3 +1909,119 @@ int_t gethostbyname(const char_t *name, hostent *info)
    //Successful processing
    return NO_ERROR;
 }
+
+
+/**
+ * @brief Convert a socket address to an IP address and a port number
+ * @param[in] addr Socket address
+ * @param[in] addrlen Length of the socket address
+ * @param[out] ipAddr IP address
+ * @param[out] port Port number
+ * @return Error code
+ **/
+
+static error_t bsdParseSockAddr(const sockaddr *addr,
+   int_t addrlen, IpAddr *ipAddr, uint16_t *port)
+{
+   //Check the length of the address
+   if(addr == NULL || addrlen < sizeof(sockaddr))
+      return ERROR_INVALID_PARAMETER;
+
+#if (IPV4_SUPPORT == ENABLED)
+   //IPv4 address?
+   if(addr->sa_family == AF_INET && addrlen == sizeof(sockaddr_in))
+   {
+      //Point to the IPv4 address information
+      sockaddr_in *sa = (sockaddr_in *) addr;
+
+      //Get port number
+      *port = ntohs(sa->sin_port);
+      //Copy IPv4 address
+      ipAddr->length = sizeof(Ipv4Addr);
+      ipAddr->ipv4Addr = sa->sin_addr.s_addr;
+   }
+   else
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 address?
+   if(addr->sa_family == AF_INET6 && addrlen == sizeof(sockaddr_in6))
+   {
+      //Point to the IPv6 address information
+      sockaddr_in6 *sa = (sockaddr_in6 *) addr;
+
+      //Get port number
+      *port = ntohs(sa->sin6_port);
+      //Copy IPv6 address
+      ipAddr->length = sizeof(Ipv6Addr);
+      ipv6CopyAddr(&ipAddr->ipv6Addr, sa->sin6_addr.s6_addr);
+   }
+   else
+#endif
+   //Invalid address?
+   {
+      //Report an error
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Convert an IP address and a port number to a socket address
+ * @param[in] ipAddr IP address
+ * @param[in] port Port number
+ * @param[out] addr Socket address
+ * @param[in,out] addrlen Size of the buffer on entry, actual length on return
+ * @return Error code
+ **/
+
+static error_t bsdFormatSockAddr(const IpAddr *ipAddr,
+   uint16_t port, sockaddr *addr, int_t *addrlen)
+{
+#if (IPV4_SUPPORT == ENABLED)
+   //IPv4 address?
+   if(ipAddr->length == sizeof(Ipv4Addr) && *addrlen >= sizeof(sockaddr_in))
+   {
+      //Point to the IPv4 address information
+      sockaddr_in *sa = (sockaddr_in *) addr;
+
+      //Set address family and port number
+      sa->sin_family = AF_INET;
+      sa->sin_port = htons(port);
+      //Copy IPv4 address
+      sa->sin_addr.s_addr = ipAddr->ipv4Addr;
+
+      //Return the actual length of the address
+      *addrlen = sizeof(sockaddr_in);
+   }
+   else
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 address?
+   if(ipAddr->length == sizeof(Ipv6Addr) && *addrlen >= sizeof(sockaddr_in6))
+   {
+      //Point to the IPv6 address information
+      sockaddr_in6 *sa = (sockaddr_in6 *) addr;
+
+      //Set address family and port number
+      sa->sin6_family = AF_INET6;
+      sa->sin6_port = htons(port);
+      //Copy IPv6 address
+      ipv6CopyAddr(sa->sin6_addr.s6_addr, &ipAddr->ipv6Addr);
+
+      //Return the actual length of the address
+      *addrlen = sizeof(sockaddr_in6);
+   }
+   else
+#endif
+   //Invalid address?
+   {
+      //Report an error
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
@@ -46,6 +46,20 @@
 #include "tcp_ip_stack.h"
 #include "socket.h"
 
+//Maximum number of datagrams handed to the socket layer at once
+#ifndef BSD_SOCKET_BATCH_SIZE
+   #define BSD_SOCKET_BATCH_SIZE 8
+#elif (BSD_SOCKET_BATCH_SIZE < 1)
+   #error BSD_SOCKET_BATCH_SIZE parameter is invalid
+#endif
+
+//Maximum number of buffers accepted by writev and readv
+#ifndef BSD_SOCKET_IOV_MAX
+   #define BSD_SOCKET_IOV_MAX 8
+#elif (BSD_SOCKET_IOV_MAX < 1)
+   #error BSD_SOCKET_IOV_MAX parameter is invalid
+#endif
+
 //Address families
 #define AF_INET  2
 #define AF_INET6 23
@@ -74,6 +88,7 @@
 #define MSG_PEEK      0x02
 #define MSG_DONTROUTE 0x04
 #define MSG_WAITALL   0x08
+#define MSG_MORE      0x80
 
 //Flags used by shutdown function
 #define SD_RECEIVE 0
@@ -84,18 +99,27 @@
 #define SO_REUSEADDR    0x0004
 #define SO_KEEPALIVE    0x0008
 #define SO_DONTROUTE    0x0010
+#define SO_REUSEPORT    0x0200
 #define SO_LINGER       0x0080
 #define SO_SNDBUF       0x1001
 #define SO_RCVBUF       0x1002
+#define SO_SNDLOWAT     0x1003
+#define SO_RCVLOWAT     0x1004
 #define SO_SNDTIMEO     0x1005
 #define SO_RCVTIMEO     0x1006
 #define SO_ERROR        0x1007
 #define SO_TYPE         0x1008
+#define SO_PRIORITY     0x100C
 #define SO_MAX_MSG_SIZE 0x2003
 #define SO_BINDTODEVICE 0x3000
+#define SO_ATTACH_FILTER 0x3001
+#define SO_DETACH_FILTER 0x3002
 
 //TCP level options
-#define TCP_NODELAY 0x0001
+#define TCP_NODELAY    0x0001
+#define TCP_CORK       0x0003
+#define TCP_INFO       0x000B
+#define TCP_CONGESTION 0x000D
 
 //Status codes
 #define SOCKET_SUCCESS 0
@@ -199,6 +223,42 @@ typedef struct hostent
 } hostent;
 
 
+/**
+ * @brief Datagram descriptor (sendmmsg/recvmmsg)
+ **/
+
+typedef struct mmsghdr
+{
+   void *msg_data;     ///<Pointer to the data buffer
+   int_t msg_size;     ///<Length of the data (send) or size of the buffer (receive)
+   sockaddr *msg_name; ///<Address of the peer
+   int_t msg_namelen;  ///<Length of the address
+   int_t msg_len;      ///<Number of bytes actually transmitted or received
+} mmsghdr;
+
+
+/**
+ * @brief I/O vector (writev/readv)
+ **/
+
+typedef struct iovec
+{
+   void *iov_base; ///<Pointer to the buffer
+   size_t iov_len; ///<Length of the buffer
+} iovec;
+
+
+/**
+ * @brief Packet filter program (SO_ATTACH_FILTER)
+ **/
+
+typedef struct sock_fprog
+{
+   uint16_t len;                      ///<Number of instructions
+   const RawSocketFilterInsn *filter; ///<Pointer to the instructions
+} sock_fprog;
+
+
 //BSD socket related constants
 extern const in6_addr in6addr_any;
 extern const in6_addr in6addr_loopback;
@@ -219,6 +279,12 @@ int_t recv(int_t s, void *data, int_t size, int_t flags);
 int_t recvfrom(int_t s, void *data, int_t size,
    int_t flags, sockaddr *addr, int_t *addrlen);
 
+int_t sendmmsg(int_t s, mmsghdr *msgvec, uint_t vlen);
+int_t recvmmsg(int_t s, mmsghdr *msgvec, uint_t vlen);
+
+int_t writev(int_t s, const iovec *iov, int_t iovcnt);
+int_t readv(int_t s, const iovec *iov, int_t iovcnt);
+
 int_t getsockname(int_t s, sockaddr *addr, int_t *addrlen);
 int_t getpeername(int_t s, sockaddr *addr, int_t *addrlen);
 int_t setsockopt(int_t s, int_t level, int_t optname, const void *optval, int_t optlen);
@@ -1,15 +1,30 @@
 CYCLONETCPSRC += $(CYCLONETCP)/cyclone_tcp/core/bsd_socket.c \
+				 $(CYCLONETCP)/cyclone_tcp/core/dns_cache.c \
 				 $(CYCLONETCP)/cyclone_tcp/core/dns_client.c \
 				 $(CYCLONETCP)/cyclone_tcp/core/ethernet.c \
 				 $(CYCLONETCP)/cyclone_tcp/core/ip.c \
+				 $(CYCLONETCP)/cyclone_tcp/core/ip_frag.c \
+				 $(CYCLONETCP)/cyclone_tcp/core/ip_pmtu.c \
+				 $(CYCLONETCP)/cyclone_tcp/core/ip_route.c \
+				 $(CYCLONETCP)/cyclone_tcp/core/ip_forward.c \
 				 $(CYCLONETCP)/cyclone_tcp/core/nic.c \
+				 $(CYCLONETCP)/cyclone_tcp/core/net_mib.c \
+				 $(CYCLONETCP)/cyclone_tcp/core/net_capture.c \
+				 $(CYCLONETCP)/cyclone_tcp/core/net_timer.c \
 				 $(CYCLONETCP)/cyclone_tcp/core/ping.c \
 				 $(CYCLONETCP)/cyclone_tcp/core/raw_socket.c \
+				 $(CYCLONETCP)/cyclone_tcp/core/raw_socket_filter.c \
 				 $(CYCLONETCP)/cyclone_tcp/core/tcp.c \
+				 $(CYCLONETCP)/cyclone_tcp/core/tcp_congestion.c \
 				 $(CYCLONETCP)/cyclone_tcp/core/tcp_fsm.c \
 				 $(CYCLONETCP)/cyclone_tcp/core/tcp_ip_stack.c \
 				 $(CYCLONETCP)/cyclone_tcp/core/tcp_ip_stack_mem.c \
 				 $(CYCLONETCP)/cyclone_tcp/core/tcp_misc.c \
+				 $(CYCLONETCP)/cyclone_tcp/core/tcp_syn_cookie.c \
+				 $(CYCLONETCP)/cyclone_tcp/core/tcp_time_wait.c \
+				 $(CYCLONETCP)/cyclone_tcp/core/tcp_fast_open.c \
+				 $(CYCLONETCP)/cyclone_tcp/core/tcp_rack.c \
+				 $(CYCLONETCP)/cyclone_tcp/core/tcp_pacing.c \
 				 $(CYCLONETCP)/cyclone_tcp/core/tcp_timer.c \
 				 $(CYCLONETCP)/cyclone_tcp/core/udp.c
 
@@ -0,0 +1,370 @@
+/**
+ * @file dns_cache.c
+ * @brief DNS resolver cache
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Resolved names are kept for the time to live of the answer, clamped
+ * to [DNS_CACHE_MIN_TTL, DNS_CACHE_MAX_TTL]. Failures (non-existent
+ * names, server failures and timeouts) are cached for DNS_CACHE_NEGATIVE_TTL
+ * so that a dead name does not trigger a query on every connection attempt.
+ * Concurrent lookups of the same name wait for the query already in
+ * progress instead of sending their own. Refer to RFC 1035 and RFC 2308
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL DNS_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "dns_client.h"
+#include "dns_cache.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (DNS_CACHE_SUPPORT == ENABLED)
+
+//Mutex preventing simultaneous access to the DNS cache
+static OsMutex *dnsCacheMutex;
+//DNS cache
+static DnsCacheEntry dnsCache[DNS_CACHE_SIZE];
+
+
+/**
+ * @brief DNS cache initialization
+ * @return Error code
+ **/
+
+error_t dnsCacheInit(void)
+{
+   uint_t i;
+
+   //Create a mutex to prevent simultaneous access to the DNS cache
+   dnsCacheMutex = osMutexCreateNamed(FALSE, "DnsCache");
+   //Any error to report?
+   if(dnsCacheMutex == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Clear the DNS cache
+   memset(dnsCache, 0, sizeof(dnsCache));
+
+   //Create the events used to wait for queries in progress
+   for(i = 0; i < DNS_CACHE_SIZE; i++)
+   {
+      //Manual-reset event, so that all the waiting tasks are woken up
+      dnsCache[i].event = osEventCreate(TRUE, FALSE);
+      //Any error to report?
+      if(dnsCache[i].event == OS_INVALID_HANDLE)
+         return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Remove all the resolved and negative entries
+ *
+ * This function should be called when the DNS server changes
+ *
+ **/
+
+void dnsCacheFlush(void)
+{
+   uint_t i;
+
+   //Acquire exclusive access to the DNS cache
+   osMutexAcquire(dnsCacheMutex);
+
+   //Loop through the cache
+   for(i = 0; i < DNS_CACHE_SIZE; i++)
+   {
+      //Queries in progress are left untouched
+      if(dnsCache[i].state != DNS_CACHE_STATE_IN_PROGRESS)
+         dnsCache[i].state = DNS_CACHE_STATE_NONE;
+   }
+
+   //Release exclusive access to the DNS cache
+   osMutexRelease(dnsCacheMutex);
+}
+
+
+/**
+ * @brief Resolve a host name, using the cache whenever possible
+ * @param[in] interface Underlying network interface (optional parameter)
+ * @param[in] name Name of the host to resolve
+ * @param[in] flags Address families to look for (see HostFlags)
+ * @param[out] ipAddrList List of IP addresses of the specified host
+ * @param[in] maxEntries Maximum number of IP addresses the list can contain
+ * @param[out] numEntries Actual number of IP addresses in the list
+ * @return Error code
+ **/
+
+error_t dnsCacheResolve(NetInterface *interface, const char_t *name, uint_t flags,
+   IpAddr *ipAddrList, size_t maxEntries, size_t *numEntries)
+{
+   error_t error;
+   bool_t ready;
+   uint32_t ttl;
+   OsEvent *event;
+   DnsCacheEntry *entry;
+
+   //Use default network interface?
+   if(!interface)
+      interface = tcpIpStackGetDefaultInterface();
+
+   //Names too long to be cached are resolved directly
+   if(strlen(name) > DNS_CACHE_MAX_NAME_LEN)
+      return dnsQuery(interface, name, flags, ipAddrList, maxEntries, numEntries, &ttl);
+
+   //Acquire exclusive access to the DNS cache
+   osMutexAcquire(dnsCacheMutex);
+
+   //Search the cache for the specified name
+   while(1)
+   {
+      //Look for a valid entry
+      entry = dnsCacheFindEntry(interface, name, flags);
+
+      //Cache miss?
+      if(entry == NULL)
+         break;
+
+      //The name has been resolved already (or the resolution failed)?
+      if(entry->state != DNS_CACHE_STATE_IN_PROGRESS)
+      {
+         //Debug message
+         TRACE_INFO("DNS cache hit for %s...\r\n", name);
+
+         //Retrieve the cached answer
+         *numEntries = min(entry->count, maxEntries);
+         memcpy(ipAddrList, entry->ipAddr, *numEntries * sizeof(IpAddr));
+         error = entry->error;
+
+         //Release exclusive access to the DNS cache
+         osMutexRelease(dnsCacheMutex);
+         //Return the cached answer
+         return error;
+      }
+
+      //Another task is already resolving the same name
+      event = entry->event;
+
+      //Release exclusive access to the DNS cache
+      osMutexRelease(dnsCacheMutex);
+      //Wait for the query in progress to complete
+      ready = osEventWait(event, DNS_MAX_RETRIES * DNS_REQUEST_TIMEOUT);
+
+      //The query is taking too long?
+      if(!ready)
+         return dnsQuery(interface, name, flags, ipAddrList, maxEntries, numEntries, &ttl);
+
+      //Acquire exclusive access to the DNS cache
+      osMutexAcquire(dnsCacheMutex);
+   }
+
+   //Create an entry for the query in progress, so that concurrent
+   //lookups of the same name do not send their own query
+   entry = dnsCacheCreateEntry(interface, name, flags);
+
+   //Any entry available?
+   if(entry != NULL)
+   {
+      //The waiting tasks will be woken up when the query completes
+      entry->state = DNS_CACHE_STATE_IN_PROGRESS;
+      osEventReset(entry->event);
+   }
+
+   //Release exclusive access to the DNS cache
+   osMutexRelease(dnsCacheMutex);
+
+   //No entry available?
+   if(entry == NULL)
+      return dnsQuery(interface, name, flags, ipAddrList, maxEntries, numEntries, &ttl);
+
+   //Query the DNS servers. The entry is not accessed by other tasks
+   //as long as the query is in progress
+   error = dnsQuery(interface, name, flags, entry->ipAddr,
+      DNS_MAX_ADDRESSES, &entry->count, &ttl);
+
+   //Return the addresses found
+   *numEntries = min(entry->count, maxEntries);
+   memcpy(ipAddrList, entry->ipAddr, *numEntries * sizeof(IpAddr));
+
+   //Acquire exclusive access to the DNS cache
+   osMutexAcquire(dnsCacheMutex);
+
+   //Successful resolution?
+   if(!error)
+   {
+      //Clamp the time to live of the answer
+      ttl = max(ttl, DNS_CACHE_MIN_TTL);
+      ttl = min(ttl, DNS_CACHE_MAX_TTL);
+
+      //Save the resolved addresses
+      entry->state = DNS_CACHE_STATE_RESOLVED;
+      entry->error = NO_ERROR;
+      entry->lifetime = ttl * 1000;
+   }
+   //The name does not exist or the server cannot be reached?
+   else if(error == ERROR_NOT_FOUND || error == ERROR_FAILURE || error == ERROR_TIMEOUT)
+   {
+      //Negative caching
+      entry->state = DNS_CACHE_STATE_FAILED;
+      entry->count = 0;
+      entry->error = error;
+      entry->lifetime = DNS_CACHE_NEGATIVE_TTL * 1000;
+   }
+   //Local failure (out of memory, for instance)?
+   else
+   {
+      //The entry is discarded
+      entry->state = DNS_CACHE_STATE_NONE;
+   }
+
+   //Save the time at which the entry was filled
+   entry->timestamp = osGetTickCount();
+
+   //Wake up the tasks waiting for this query
+   osEventSet(entry->event);
+
+   //Release exclusive access to the DNS cache
+   osMutexRelease(dnsCacheMutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Search the DNS cache for a given name
+ * @param[in] interface Underlying network interface
+ * @param[in] name Host name
+ * @param[in] flags Address families requested
+ * @return Pointer to the matching entry, or NULL if none
+ **/
+
+DnsCacheEntry *dnsCacheFindEntry(NetInterface *interface, const char_t *name, uint_t flags)
+{
+   uint_t i;
+   time_t time;
+   DnsCacheEntry *entry;
+
+   //Get current time
+   time = osGetTickCount();
+
+   //Loop through the cache
+   for(i = 0; i < DNS_CACHE_SIZE; i++)
+   {
+      //Point to the current entry
+      entry = &dnsCache[i];
+
+      //Unused entry?
+      if(entry->state == DNS_CACHE_STATE_NONE)
+         continue;
+
+      //Expired entry?
+      if(entry->state != DNS_CACHE_STATE_IN_PROGRESS &&
+         timeCompare(time, entry->timestamp + entry->lifetime) >= 0)
+      {
+         //Release the entry
+         entry->state = DNS_CACHE_STATE_NONE;
+         continue;
+      }
+
+      //Matching entry? (host names are case-insensitive)
+      if(entry->interface == interface && entry->flags == flags &&
+         !strcasecmp(entry->name, name))
+      {
+         return entry;
+      }
+   }
+
+   //No matching entry
+   return NULL;
+}
+
+
+/**
+ * @brief Allocate a DNS cache entry
+ *
+ * Unused entries are preferred. Otherwise the entry that expires first is
+ * recycled. Entries whose query is in progress are never recycled
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] name Host name
+ * @param[in] flags Address families requested
+ * @return Pointer to the new entry, or NULL if none is available
+ **/
+
+DnsCacheEntry *dnsCacheCreateEntry(NetInterface *interface, const char_t *name, uint_t flags)
+{
+   uint_t i;
+   DnsCacheEntry *entry;
+   DnsCacheEntry *oldestEntry;
+
+   //Keep track of the entry to recycle
+   oldestEntry = NULL;
+
+   //Loop through the cache
+   for(i = 0; i < DNS_CACHE_SIZE; i++)
+   {
+      //Point to the current entry
+      entry = &dnsCache[i];
+
+      //Unused entry?
+      if(entry->state == DNS_CACHE_STATE_NONE)
+      {
+         oldestEntry = entry;
+         break;
+      }
+      //Entry that expires first?
+      else if(entry->state != DNS_CACHE_STATE_IN_PROGRESS)
+      {
+         if(oldestEntry == NULL || timeCompare(entry->timestamp + entry->lifetime,
+            oldestEntry->timestamp + oldestEntry->lifetime) < 0)
+         {
+            oldestEntry = entry;
+         }
+      }
+   }
+
+   //Any entry available?
+   if(oldestEntry != NULL)
+   {
+      //Initialize the entry
+      oldestEntry->interface = interface;
+      oldestEntry->flags = flags;
+      strcpy(oldestEntry->name, name);
+   }
+
+   //Return a pointer to the entry
+   return oldestEntry;
+}
+
+#endif
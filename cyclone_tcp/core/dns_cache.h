@@ -0,0 +1,131 @@
+/**
+ * @file dns_cache.h
+ * @brief DNS resolver cache
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Resolved names are kept for the time to live of the answer, clamped
+ * to [DNS_CACHE_MIN_TTL, DNS_CACHE_MAX_TTL]. Failures (non-existent
+ * names, server failures and timeouts) are cached for DNS_CACHE_NEGATIVE_TTL
+ * so that a dead name does not trigger a query on every connection attempt.
+ * Concurrent lookups of the same name wait for the query already in
+ * progress instead of sending their own. Refer to RFC 1035 and RFC 2308
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _DNS_CACHE_H
+#define _DNS_CACHE_H
+
+//Dependencies
+#include "tcp_ip_stack.h"
+#include "ip.h"
+#include "dns_client.h"
+
+//DNS cache support
+#ifndef DNS_CACHE_SUPPORT
+   #define DNS_CACHE_SUPPORT DISABLED
+#elif (DNS_CACHE_SUPPORT != ENABLED && DNS_CACHE_SUPPORT != DISABLED)
+   #error DNS_CACHE_SUPPORT parameter is invalid
+#endif
+
+//Number of entries in the DNS cache
+#ifndef DNS_CACHE_SIZE
+   #define DNS_CACHE_SIZE 8
+#elif (DNS_CACHE_SIZE < 1)
+   #error DNS_CACHE_SIZE parameter is invalid
+#endif
+
+//Maximum length of the names kept in the cache
+#ifndef DNS_CACHE_MAX_NAME_LEN
+   #define DNS_CACHE_MAX_NAME_LEN 63
+#elif (DNS_CACHE_MAX_NAME_LEN < 1 || DNS_CACHE_MAX_NAME_LEN > 255)
+   #error DNS_CACHE_MAX_NAME_LEN parameter is invalid
+#endif
+
+//Minimum lifetime of a positive answer (in seconds)
+#ifndef DNS_CACHE_MIN_TTL
+   #define DNS_CACHE_MIN_TTL 30
+#elif (DNS_CACHE_MIN_TTL < 0)
+   #error DNS_CACHE_MIN_TTL parameter is invalid
+#endif
+
+//Maximum lifetime of a positive answer (in seconds)
+#ifndef DNS_CACHE_MAX_TTL
+   #define DNS_CACHE_MAX_TTL 3600
+#elif (DNS_CACHE_MAX_TTL < DNS_CACHE_MIN_TTL || DNS_CACHE_MAX_TTL > 86400)
+   #error DNS_CACHE_MAX_TTL parameter is invalid
+#endif
+
+//Lifetime of a failed resolution (in seconds)
+#ifndef DNS_CACHE_NEGATIVE_TTL
+   #define DNS_CACHE_NEGATIVE_TTL 10
+#elif (DNS_CACHE_NEGATIVE_TTL < 0 || DNS_CACHE_NEGATIVE_TTL > DNS_CACHE_MAX_TTL)
+   #error DNS_CACHE_NEGATIVE_TTL parameter is invalid
+#endif
+
+
+/**
+ * @brief DNS cache entry state
+ **/
+
+typedef enum
+{
+   DNS_CACHE_STATE_NONE        = 0, ///<Unused entry
+   DNS_CACHE_STATE_IN_PROGRESS = 1, ///<A query is in progress
+   DNS_CACHE_STATE_RESOLVED    = 2, ///<The name has been resolved
+   DNS_CACHE_STATE_FAILED      = 3  ///<The resolution failed (negative entry)
+} DnsCacheState;
+
+
+/**
+ * @brief DNS cache entry
+ **/
+
+typedef struct
+{
+   DnsCacheState state;                        ///<State of the entry
+   NetInterface *interface;                    ///<Interface the query was sent on
+   uint_t flags;                               ///<Address families requested
+   char_t name[DNS_CACHE_MAX_NAME_LEN + 1];    ///<Host name
+   IpAddr ipAddr[DNS_MAX_ADDRESSES];           ///<Resolved addresses
+   size_t count;                               ///<Number of resolved addresses
+   error_t error;                              ///<Cached error (negative entry)
+   time_t timestamp;                           ///<Time at which the entry was filled
+   time_t lifetime;                            ///<Lifetime of the entry
+   OsEvent *event;                             ///<Event signaled when the query completes
+} DnsCacheEntry;
+
+
+//DNS cache related functions
+error_t dnsCacheInit(void);
+void dnsCacheFlush(void);
+
+error_t dnsCacheResolve(NetInterface *interface, const char_t *name, uint_t flags,
+   IpAddr *ipAddrList, size_t maxEntries, size_t *numEntries);
+
+DnsCacheEntry *dnsCacheFindEntry(NetInterface *interface, const char_t *name, uint_t flags);
+DnsCacheEntry *dnsCacheCreateEntry(NetInterface *interface, const char_t *name, uint_t flags);
+
+#endif
@@ -38,8 +38,45 @@
 #include "socket.h"
 #include "ip.h"
 #include "ipv4.h"
+#include "dns_cache.h"
 #include "debug.h"
 
+#if (DNS_ASYNC_SUPPORT == ENABLED)
+
+//Pending asynchronous requests
+static OsQueue *dnsRequestQueue;
+
+#endif
+
+
+/**
+ * @brief DNS client initialization
+ * @return Error code
+ **/
+
+error_t dnsInit(void)
+{
+#if (DNS_ASYNC_SUPPORT == ENABLED)
+   OsTask *task;
+
+   //Create a queue to hold the asynchronous requests
+   dnsRequestQueue = osQueueCreate(DNS_ASYNC_QUEUE_SIZE, sizeof(DnsRequest));
+   //Any error to report?
+   if(dnsRequestQueue == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Create a task to process the asynchronous requests
+   task = osTaskCreate("DNS Resolver", dnsTask,
+      NULL, DNS_TASK_STACK_SIZE, DNS_TASK_PRIORITY);
+   //Unable to create the task?
+   if(task == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+#endif
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
 
 /**
  * @brief Resolve a host name into an IP address
@@ -50,14 +87,184 @@
  **/
 
 error_t dnsResolve(NetInterface *interface, const char_t *name, IpAddr *ipAddr)
+{
+   //Retrieve the preferred address of the host
+   return dnsResolveEx(interface, name, HOST_TYPE_DEFAULT, ipAddr, 1, NULL);
+}
+
+
+/**
+ * @brief Resolve a host name into a list of IP addresses
+ *
+ * A and AAAA queries are sent in parallel and the addresses of both
+ * families are interleaved, starting with the preferred one (RFC 6555)
+ *
+ * @param[in] interface Underlying network interface (optional parameter)
+ * @param[in] name Name of the host to resolve
+ * @param[in] flags Address families to look for (see HostFlags)
+ * @param[out] ipAddrList List of IP addresses of the specified host
+ * @param[in] maxEntries Maximum number of IP addresses the list can contain
+ * @param[out] numEntries Actual number of IP addresses in the list (optional parameter)
+ * @return Error code
+ **/
+
+error_t dnsResolveEx(NetInterface *interface, const char_t *name, uint_t flags,
+   IpAddr *ipAddrList, size_t maxEntries, size_t *numEntries)
+{
+   error_t error;
+   size_t n;
+#if (DNS_CACHE_SUPPORT == DISABLED)
+   uint32_t ttl;
+#endif
+
+   //Use default network interface?
+   if(!interface)
+      interface = tcpIpStackGetDefaultInterface();
+
+   //Look for all the address families supported by the stack?
+   if(!(flags & HOST_TYPE_MASK))
+   {
+#if (IPV4_SUPPORT == ENABLED)
+      flags |= HOST_TYPE_IPV4;
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+      flags |= HOST_TYPE_IPV6;
+#endif
+   }
+
+   //Discard irrelevant flags
+   flags &= HOST_TYPE_MASK | HOST_PREFER_IPV6;
+
+#if (DNS_CACHE_SUPPORT == ENABLED)
+   //Look up the DNS cache first
+   error = dnsCacheResolve(interface, name, flags, ipAddrList, maxEntries, &n);
+#else
+   //Query the DNS servers
+   error = dnsQuery(interface, name, flags, ipAddrList, maxEntries, &n, &ttl);
+#endif
+
+   //Return the number of addresses found
+   if(numEntries != NULL)
+      *numEntries = error ? 0 : n;
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Resolve a host name without blocking the calling task
+ *
+ * The request is processed by the resolver task, which invokes the
+ * callback once the resolution completes
+ *
+ * @param[in] interface Underlying network interface (optional parameter)
+ * @param[in] name Name of the host to resolve
+ * @param[in] flags Address families to look for (see HostFlags)
+ * @param[in] callback Function to call when the resolution completes
+ * @param[in] param Opaque pointer passed to the callback
+ * @return Error code
+ **/
+
+error_t dnsResolveAsync(NetInterface *interface, const char_t *name,
+   uint_t flags, DnsCallback callback, void *param)
+{
+#if (DNS_ASYNC_SUPPORT == ENABLED)
+   DnsRequest request;
+
+   //Check parameters
+   if(name == NULL || callback == NULL)
+      return ERROR_INVALID_PARAMETER;
+   //Make sure the name fits in the request
+   if(strlen(name) > DNS_ASYNC_MAX_NAME_LEN)
+      return ERROR_INVALID_LENGTH;
+
+   //Format the request
+   request.interface = interface;
+   strcpy(request.name, name);
+   request.flags = flags;
+   request.callback = callback;
+   request.param = param;
+
+   //Post the request to the resolver task
+   if(!osQueueSend(dnsRequestQueue, &request, 0))
+      return ERROR_OUT_OF_RESOURCES;
+
+   //The request is pending
+   return NO_ERROR;
+#else
+   //Asynchronous resolution is not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+#if (DNS_ASYNC_SUPPORT == ENABLED)
+
+/**
+ * @brief Resolver task
+ * @param[in] param Unused parameter
+ **/
+
+void dnsTask(void *param)
+{
+   error_t error;
+   size_t n;
+   DnsRequest request;
+   IpAddr ipAddrList[DNS_MAX_ADDRESSES];
+
+   //Main loop
+   while(1)
+   {
+      //Wait for a request
+      if(osQueueReceive(dnsRequestQueue, &request, INFINITE_DELAY))
+      {
+         //Resolve the host name
+         error = dnsResolveEx(request.interface, request.name,
+            request.flags, ipAddrList, DNS_MAX_ADDRESSES, &n);
+
+         //Report the result of the resolution
+         request.callback(error, request.name, ipAddrList, n, request.param);
+      }
+   }
+}
+
+#endif
+
+
+/**
+ * @brief Query the DNS servers
+ *
+ * The primary server is queried first. If it does not answer within
+ * DNS_SERVER_TIMEOUT, the next server is queried as well and the first
+ * conclusive response from any of them is used
+ *
+ * @param[in] interface Underlying network interface (optional parameter)
+ * @param[in] name Name of the host to resolve
+ * @param[in] flags Address families to look for (see HostFlags)
+ * @param[out] ipAddrList List of IP addresses of the specified host
+ * @param[in] maxEntries Maximum number of IP addresses the list can contain
+ * @param[out] numEntries Actual number of IP addresses in the list
+ * @param[out] ttl Time to live of the answer, in seconds
+ * @return Error code
+ **/
+
+error_t dnsQuery(NetInterface *interface, const char_t *name, uint_t flags,
+   IpAddr *ipAddrList, size_t maxEntries, size_t *numEntries, uint32_t *ttl)
 {
    error_t error;
    uint_t i;
-   size_t length;
-   uint16_t identifier;
-   IpAddr serverIpAddr;
+   uint_t j;
+   uint_t k;
+   size_t n;
+   bool_t done;
+   time_t timeout;
+   uint_t serverCount;
+   uint_t queryCount;
    Socket *socket;
    DnsHeader *dnsMessage;
+   IpAddr serverList[DNS_MAX_SERVERS];
+   DnsPendingQuery queries[2];
 
    //Debug message
    TRACE_INFO("Trying to resolve %s...\r\n", name);
@@ -66,6 +273,51 @@ error_t dnsResolve(NetInterface *interface, const char_t *name, IpAddr *ipAddr)
    if(!interface)
       interface = tcpIpStackGetDefaultInterface();
 
+   //No address found yet
+   *numEntries = 0;
+   *ttl = 0;
+
+   //Number of queries to send
+   queryCount = 0;
+
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 addresses are preferred?
+   if((flags & HOST_TYPE_IPV6) && (flags & HOST_PREFER_IPV6))
+      queries[queryCount++].type = DNS_RR_TYPE_AAAA;
+#endif
+#if (IPV4_SUPPORT == ENABLED)
+   //Look for IPv4 addresses?
+   if(flags & HOST_TYPE_IPV4)
+      queries[queryCount++].type = DNS_RR_TYPE_A;
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //Look for IPv6 addresses?
+   if((flags & HOST_TYPE_IPV6) && !(flags & HOST_PREFER_IPV6))
+      queries[queryCount++].type = DNS_RR_TYPE_AAAA;
+#endif
+
+   //No supported address family?
+   if(!queryCount)
+      return ERROR_INVALID_PARAMETER;
+
+   //Retrieve the DNS servers of the interface
+   serverCount = dnsGetServerList(interface, serverList);
+   //No DNS server configured?
+   if(!serverCount)
+      return ERROR_NO_ADDRESS;
+
+   //Initialize the queries
+   for(k = 0; k < queryCount; k++)
+   {
+      //An identifier is used by the client to match replies
+      //with corresponding requests
+      queries[k].identifier = rand();
+      queries[k].done = FALSE;
+      queries[k].error = ERROR_TIMEOUT;
+      queries[k].count = 0;
+      queries[k].ttl = 0;
+   }
+
    //Allocate a memory buffer to hold DNS messages
    dnsMessage = memPoolAlloc(DNS_MESSAGE_MAX_SIZE);
    //Failed to allocate memory?
@@ -84,88 +336,100 @@ error_t dnsResolve(NetInterface *interface, const char_t *name, IpAddr *ipAddr)
       return ERROR_OPEN_FAILED;
    }
 
-#if (IPV4_SUPPORT == ENABLED)
-   //IP address of the DNS server
-   serverIpAddr.length = sizeof(Ipv4Addr);
-   serverIpAddr.ipv4Addr = interface->ipv4Config.dnsServer[0];
-#elif (IPV6_SUPPORT == ENABLED)
-   //IP address of the DNS server
-   serverIpAddr.length = sizeof(Ipv6Addr);
-   serverIpAddr.ipv6Addr = interface->ipv6Config.dnsServer[0];
-#endif
-
-   //Associate the socket with the relevant interface
+   //Associate the socket with the relevant interface. The socket is left
+   //unconnected so that it can talk to all the servers at the same time
    error = socketBindToInterface(socket, interface);
 
-   //Any error to report?
-   if(error)
+   //Try to retransmit the DNS queries if the previous ones timed out
+   for(done = FALSE, i = 0; i < DNS_MAX_RETRIES && !done && !error; i++)
    {
-      //Free previously allocated memory
-      memPoolFree(dnsMessage);
-      //Close socket
-      socketClose(socket);
-      //Return status code
-      return error;
+      //Query the servers one after the other
+      for(j = 0; j < serverCount && !done && !error; j++)
+      {
+         //Send the pending queries to the current server
+         for(k = 0; k < queryCount && !error; k++)
+         {
+            if(!queries[k].done)
+            {
+               error = dnsSendQuery(socket, &serverList[j], dnsMessage,
+                  queries[k].identifier, name, queries[k].type);
+            }
+         }
+
+         //Failed to send message?
+         if(error) break;
+
+         //The last server of the round is given the rest of the request timeout
+         if(j < (serverCount - 1))
+            timeout = DNS_SERVER_TIMEOUT;
+         else if(DNS_REQUEST_TIMEOUT > (j + 1) * DNS_SERVER_TIMEOUT)
+            timeout = DNS_REQUEST_TIMEOUT - j * DNS_SERVER_TIMEOUT;
+         else
+            timeout = DNS_SERVER_TIMEOUT;
+
+         //Wait for the responses of any of the servers queried so far
+         done = dnsRaceServer(socket, dnsMessage, serverList,
+            serverCount, queries, queryCount, timeout);
+      }
    }
 
-   //Connect the newly created socket to the primary DNS server
-   error = socketConnect(socket, &serverIpAddr, DNS_PORT);
+   //Free previously allocated memory
+   memPoolFree(dnsMessage);
+   //Close socket
+   socketClose(socket);
 
-   //Failed to connect?
+   //Failed to send the queries?
    if(error)
    {
-      //Free previously allocated memory
-      memPoolFree(dnsMessage);
-      //Close socket
-      socketClose(socket);
+      //Report an error
+      TRACE_ERROR("DNS resolution failed!\r\n");
       //Return status code
       return error;
    }
 
-   //An identifier is used by the client to match replies
-   //with corresponding requests
-   identifier = rand();
-
-   //Try to retransmit the DNS message if the previous query timed out
-   for(i = 0; i < DNS_MAX_RETRIES; i++)
+   //Interleave the addresses of both families (RFC 6555)
+   for(n = 0, i = 0; i < DNS_MAX_ADDRESSES && n < maxEntries; i++)
    {
-      //Send DNS query message
-      error = dnsSendQuery(socket, dnsMessage, identifier, name);
-      //Failed to send message ?
-      if(error) break;
-
-      //Adjust receive timeout
-      error = socketSetTimeout(socket, DNS_REQUEST_TIMEOUT);
-      //Any error to report?
-      if(error) break;
-
-      //Wait for the server response
-      error = socketReceive(socket, dnsMessage, DNS_MESSAGE_MAX_SIZE, &length, 0);
-
-      //Any response from the specified DNS server?
-      if(!error)
+      for(k = 0; k < queryCount && n < maxEntries; k++)
       {
-         //Parse DNS response
-         error = dnsParseResponse(dnsMessage, length, identifier, ipAddr);
-         //DNS response successfully decoded?
-         if(!error) break;
+         if(i < queries[k].count)
+            ipAddrList[n++] = queries[k].ipAddr[i];
       }
    }
 
-   //The maximum number of retransmissions has been reached?
-   if(i >= DNS_MAX_RETRIES)
-      error = ERROR_TIMEOUT;
+   //Any address found?
+   if(n > 0)
+   {
+      //The answer is valid as long as all its records are
+      for(*ttl = UINT32_MAX, k = 0; k < queryCount; k++)
+      {
+         if(queries[k].count > 0)
+            *ttl = min(*ttl, queries[k].ttl);
+      }
 
-   //Free previously allocated memory
-   memPoolFree(dnsMessage);
-   //Close socket
-   socketClose(socket);
+      //Return the number of addresses
+      *numEntries = n;
+      //Successful resolution
+      error = NO_ERROR;
+   }
+   else
+   {
+      //A timeout takes precedence over a server failure, which in turn
+      //takes precedence over a non-existent name
+      for(error = ERROR_NOT_FOUND, k = 0; k < queryCount; k++)
+      {
+         if(queries[k].error == ERROR_TIMEOUT)
+            error = ERROR_TIMEOUT;
+         else if(queries[k].error == ERROR_FAILURE && error != ERROR_TIMEOUT)
+            error = ERROR_FAILURE;
+      }
+   }
 
    //Debug message
    if(!error)
    {
       //Name resolution succeeds
-      TRACE_INFO("Host name resolved to %s...\r\n", ipAddrToString(ipAddr, NULL));
+      TRACE_INFO("Host name resolved to %s...\r\n", ipAddrToString(ipAddrList, NULL));
    }
    else
    {
@@ -178,16 +442,196 @@ error_t dnsResolve(NetInterface *interface, const char_t *name, IpAddr *ipAddr)
 }
 
 
+/**
+ * @brief Retrieve the DNS servers configured on an interface
+ * @param[in] interface Underlying network interface
+ * @param[out] serverList List of DNS servers (DNS_MAX_SERVERS entries)
+ * @return Number of DNS servers
+ **/
+
+uint_t dnsGetServerList(NetInterface *interface, IpAddr *serverList)
+{
+   uint_t i;
+   uint_t n;
+
+   //Number of servers found
+   n = 0;
+
+#if (IPV4_SUPPORT == ENABLED)
+   //Loop through the IPv4 DNS servers
+   for(i = 0; i < interface->ipv4Config.dnsServerCount && i < IPV4_MAX_DNS_SERVERS; i++)
+   {
+      //Skip unspecified entries
+      if(interface->ipv4Config.dnsServer[i] == IPV4_UNSPECIFIED_ADDR)
+         continue;
+
+      //Add the server to the list
+      serverList[n].length = sizeof(Ipv4Addr);
+      serverList[n].ipv4Addr = interface->ipv4Config.dnsServer[i];
+      n++;
+   }
+#endif
+
+#if (IPV6_SUPPORT == ENABLED)
+   //Loop through the IPv6 DNS servers
+   for(i = 0; i < interface->ipv6Config.dnsServerCount && i < IPV6_MAX_DNS_SERVERS; i++)
+   {
+      //Skip unspecified entries
+      if(ipv6CompAddr(&interface->ipv6Config.dnsServer[i], &IPV6_UNSPECIFIED_ADDR))
+         continue;
+
+      //Add the server to the list
+      serverList[n].length = sizeof(Ipv6Addr);
+      serverList[n].ipv6Addr = interface->ipv6Config.dnsServer[i];
+      n++;
+   }
+#endif
+
+   //Return the number of servers
+   return n;
+}
+
+
+/**
+ * @brief Collect the responses to the pending queries
+ *
+ * Responses are accepted from any of the DNS servers. Once an address
+ * family has been resolved, the other one is only given
+ * DNS_RESOLUTION_DELAY to complete
+ *
+ * @param[in] socket Handle referencing the UDP socket
+ * @param[in] dnsMessage Buffer needed to hold incoming DNS messages
+ * @param[in] serverList List of DNS servers
+ * @param[in] serverCount Number of DNS servers
+ * @param[in,out] queries Pending queries
+ * @param[in] queryCount Number of queries
+ * @param[in] timeout Maximum time to wait
+ * @return TRUE if the resolution is complete, else FALSE
+ **/
+
+bool_t dnsRaceServer(Socket *socket, DnsHeader *dnsMessage, const IpAddr *serverList,
+   uint_t serverCount, DnsPendingQuery *queries, uint_t queryCount, time_t timeout)
+{
+   error_t error;
+   uint_t i;
+   size_t length;
+   bool_t done;
+   bool_t resolved;
+   time_t time;
+   time_t startTime;
+   uint16_t remotePort;
+   IpAddr remoteIpAddr;
+
+   //Save current time
+   startTime = osGetTickCount();
+
+   //Wait for the responses
+   while(1)
+   {
+      //Check the status of the queries
+      for(done = TRUE, resolved = FALSE, i = 0; i < queryCount; i++)
+      {
+         if(!queries[i].done)
+            done = FALSE;
+         else if(queries[i].count > 0)
+            resolved = TRUE;
+      }
+
+      //All the queries have completed?
+      if(done) break;
+
+      //Get current time
+      time = osGetTickCount();
+      //Timeout elapsed?
+      if(timeCompare(time, startTime + timeout) >= 0)
+         break;
+
+      //Adjust receive timeout
+      error = socketSetTimeout(socket, startTime + timeout - time);
+      //Any error to report?
+      if(error) break;
+
+      //Wait for a response
+      error = socketReceiveFrom(socket, &remoteIpAddr, &remotePort,
+         dnsMessage, DNS_MESSAGE_MAX_SIZE, &length, 0);
+      //Timeout error?
+      if(error) break;
+
+      //Discard datagrams that do not come from a DNS server
+      if(remotePort != DNS_PORT)
+         continue;
+
+      //Check the address of the sender
+      for(i = 0; i < serverCount; i++)
+      {
+         if(ipCompAddr(&remoteIpAddr, &serverList[i]))
+            break;
+      }
+
+      //Unknown server?
+      if(i >= serverCount)
+         continue;
+
+      //Match the response against the pending queries
+      for(i = 0; i < queryCount; i++)
+      {
+         //Skip the queries that have already completed
+         if(queries[i].done)
+            continue;
+
+         //Parse DNS response
+         error = dnsParseResponse(dnsMessage, length, queries[i].identifier,
+            queries[i].ipAddr, DNS_MAX_ADDRESSES, &queries[i].count, &queries[i].ttl);
+
+         //The response belongs to another query?
+         if(error == ERROR_WRONG_IDENTIFIER)
+            continue;
+
+         //Positive or negative answer?
+         if(!error || error == ERROR_NOT_FOUND)
+         {
+            //The query is complete
+            queries[i].error = error;
+            queries[i].done = TRUE;
+
+            //Do not wait too long for the other address family (RFC 6555)
+            if(!error && !resolved)
+            {
+               timeout = min(timeout, (time_t) (osGetTickCount() - startTime) +
+                  DNS_RESOLUTION_DELAY);
+            }
+         }
+         //Server failure?
+         else if(error == ERROR_FAILURE)
+         {
+            //The other servers may still be able to answer
+            queries[i].error = error;
+         }
+
+         //Process the next response
+         break;
+      }
+   }
+
+   //The resolution is complete when all the queries have completed
+   //or when an address has been found
+   return (done || resolved) ? TRUE : FALSE;
+}
+
+
 /**
  * @brief Send a DNS query message
  * @param[in] socket Handle referencing a socket
+ * @param[in] serverIpAddr IP address of the DNS server
  * @param[in] dnsMessage Buffer needed to format the DNS query message
  * @param[in] identifier Identifier used to match queries and responses
- * @param[out] name Host name to resolve
+ * @param[in] name Host name to resolve
+ * @param[in] type Query type (A or AAAA)
  * @return Error code
  **/
 
-error_t dnsSendQuery(Socket *socket, DnsHeader *dnsMessage, uint16_t identifier, const char_t *name)
+error_t dnsSendQuery(Socket *socket, const IpAddr *serverIpAddr, DnsHeader *dnsMessage,
+   uint16_t identifier, const char_t *name, uint16_t type)
 {
    size_t length;
    DnsQuestion *dnsQuestion;
@@ -208,38 +652,44 @@ error_t dnsSendQuery(Socket *socket, DnsHeader *dnsMessage, uint16_t identifier,
 
    //Query type and query class
    dnsQuestion = (DnsQuestion *) (dnsMessage->questions + length);
-   dnsQuestion->queryType = HTONS(DNS_RR_TYPE_A);
+   dnsQuestion->queryType = htons(type);
    dnsQuestion->queryClass = HTONS(DNS_RR_CLASS_IN);
 
    //Length of the complete message
    length += sizeof(DnsHeader) + sizeof(DnsQuestion);
 
    //Send DNS query message
-   return socketSend(socket, dnsMessage, length, NULL, 0);
+   return socketSendTo(socket, serverIpAddr, DNS_PORT, dnsMessage, length, NULL, 0);
 }
 
 
 /**
- * @brief Parse a DNS response message and retrieve host address
+ * @brief Parse a DNS response message and retrieve host addresses
  * @param[in] dnsMessage DNS response message to parse
  * @param[in] length Length of the DNS message
  * @param[in] identifier Identifier used to match queries and responses
- * @param[out] ipAddr Host IP address
+ * @param[out] ipAddrList Host IP addresses
+ * @param[in] maxEntries Maximum number of IP addresses the list can contain
+ * @param[out] numEntries Actual number of IP addresses in the list
+ * @param[out] ttl Lowest time to live of the address and alias records
  * @return Error code
  **/
 
-error_t dnsParseResponse(DnsHeader *dnsMessage, size_t length, uint16_t identifier, IpAddr *ipAddr)
+error_t dnsParseResponse(DnsHeader *dnsMessage, size_t length, uint16_t identifier,
+   IpAddr *ipAddrList, size_t maxEntries, size_t *numEntries, uint32_t *ttl)
 {
    char_t *name;
    uint_t i;
+   size_t n;
    size_t pos;
-   Ipv4Addr ipv4Addr;
    DnsQuestion *dnsQuestion;
    DnsResourceRecord *dnsResourceRecord;
 
-   //Clear host address
-   memset(ipAddr, 0, sizeof(IpAddr));
-
+   //No host address found yet
+   n = 0;
+   *numEntries = 0;
+   //Initialize the time to live
+   *ttl = UINT32_MAX;
    //Ensure the DNS header is valid
    if(length < sizeof(DnsHeader))
       return ERROR_INVALID_HEADER;
@@ -252,6 +702,9 @@ error_t dnsParseResponse(DnsHeader *dnsMessage, size_t length, uint16_t identifi
    //Make sure recursion is available
    if(!(dnsMessage->flags & DNS_FLAG_RA))
       return ERROR_INVALID_HEADER;
+   //The domain name referenced in the query does not exist?
+   if((dnsMessage->flags & DNS_RCODE_MASK) == DNS_RCODE_NAME_ERROR)
+      return ERROR_NOT_FOUND;
    //Check return code
    if(dnsMessage->flags & DNS_RCODE_MASK)
       return ERROR_FAILURE;
@@ -320,41 +773,46 @@ error_t dnsParseResponse(DnsHeader *dnsMessage, size_t length, uint16_t identifi
       switch(ntohs(dnsResourceRecord->type))
       {
       //IPv4 address record found?
+#if (IPV4_SUPPORT == ENABLED)
       case DNS_RR_TYPE_A:
          //Verify the length of the data field
          if(ntohs(dnsResourceRecord->dataLength) != sizeof(Ipv4Addr))
             break;
-         //Copy the IP address
-         ipv4CopyAddr(&ipv4Addr, dnsResourceRecord->data);
-         //Save the first IP address found in resource records
-         if(!ipAddr->length)
+         //Save the IP address if there is room left in the list
+         if(n < maxEntries)
          {
-            ipAddr->length = sizeof(Ipv4Addr);
-            ipAddr->ipv4Addr = ipv4Addr;
+            ipAddrList[n].length = sizeof(Ipv4Addr);
+            ipv4CopyAddr(&ipAddrList[n].ipv4Addr, dnsResourceRecord->data);
+            n++;
          }
-         //Debug message
-         TRACE_DEBUG("    data = %s\r\n", ipv4AddrToString(ipv4Addr, NULL));
+         //Keep track of the lowest time to live
+         *ttl = min(*ttl, ntohl(dnsResourceRecord->timeToLive));
          break;
+#endif
+#if (IPV6_SUPPORT == ENABLED)
       //IPv6 address record found?
-      /*case DNS_RR_TYPE_AAAA:
+      case DNS_RR_TYPE_AAAA:
          //Verify the length of the data field
          if(ntohs(dnsResourceRecord->dataLength) != sizeof(Ipv6Addr))
             break;
-         //Copy the IP address
-         //ipv4CopyAddr(&ipv4Addr, dnsResourceRecord->data);
-         //Save the first IP address found in resource records
-         if(!ipAddr->length)
+         //Save the IP address if there is room left in the list
+         if(n < maxEntries)
          {
-            ipAddr->length = sizeof(Ipv6Addr);
-            ipv6CopyAddr(&ipAddr->ipv6Addr, dnsResourceRecord->data);
+            ipAddrList[n].length = sizeof(Ipv6Addr);
+            ipv6CopyAddr(&ipAddrList[n].ipv6Addr, dnsResourceRecord->data);
+            n++;
          }
-         //Debug message
-         //TRACE_DEBUG("    data = %s\r\n", ipv4AddrToString(ipv4Addr, NULL));
-         break;*/
-      //Name server record found?
-      case DNS_RR_TYPE_NS:
+         //Keep track of the lowest time to live
+         *ttl = min(*ttl, ntohl(dnsResourceRecord->timeToLive));
+         break;
+#endif
       //Canonical name record found?
       case DNS_RR_TYPE_CNAME:
+         //The address cannot outlive the alias that leads to it
+         *ttl = min(*ttl, ntohl(dnsResourceRecord->timeToLive));
+         //Fall through
+      //Name server record found?
+      case DNS_RR_TYPE_NS:
       //Pointer record?
       case DNS_RR_TYPE_PTR:
          //Decode the canonical name
@@ -376,6 +834,14 @@ error_t dnsParseResponse(DnsHeader *dnsMessage, size_t length, uint16_t identifi
 
    //Free previously allocated memory
    memPoolFree(name);
+
+   //The response does not contain any address for the specified host?
+   if(!n)
+      return ERROR_NOT_FOUND;
+
+   //Return the number of addresses found
+   *numEntries = n;
+
    //DNS response successfully decoded
    return NO_ERROR;
 }
@@ -47,12 +47,70 @@
    #error DNS_REQUEST_TIMEOUT parameter is invalid
 #endif
 
+//Time to wait for a server before querying the next one
+#ifndef DNS_SERVER_TIMEOUT
+   #define DNS_SERVER_TIMEOUT 1000
+#elif (DNS_SERVER_TIMEOUT < 100 || DNS_SERVER_TIMEOUT > DNS_REQUEST_TIMEOUT)
+   #error DNS_SERVER_TIMEOUT parameter is invalid
+#endif
+
+//Time to wait for the second address family once the first one is resolved
+#ifndef DNS_RESOLUTION_DELAY
+   #define DNS_RESOLUTION_DELAY 50
+#elif (DNS_RESOLUTION_DELAY < 0 || DNS_RESOLUTION_DELAY > DNS_SERVER_TIMEOUT)
+   #error DNS_RESOLUTION_DELAY parameter is invalid
+#endif
+
+//Maximum number of addresses kept per host name
+#ifndef DNS_MAX_ADDRESSES
+   #define DNS_MAX_ADDRESSES 4
+#elif (DNS_MAX_ADDRESSES < 1)
+   #error DNS_MAX_ADDRESSES parameter is invalid
+#endif
+
+//Asynchronous name resolution
+#ifndef DNS_ASYNC_SUPPORT
+   #define DNS_ASYNC_SUPPORT DISABLED
+#elif (DNS_ASYNC_SUPPORT != ENABLED && DNS_ASYNC_SUPPORT != DISABLED)
+   #error DNS_ASYNC_SUPPORT parameter is invalid
+#endif
+
+//Number of pending asynchronous requests
+#ifndef DNS_ASYNC_QUEUE_SIZE
+   #define DNS_ASYNC_QUEUE_SIZE 4
+#elif (DNS_ASYNC_QUEUE_SIZE < 1)
+   #error DNS_ASYNC_QUEUE_SIZE parameter is invalid
+#endif
+
+//Maximum length of the names resolved asynchronously
+#ifndef DNS_ASYNC_MAX_NAME_LEN
+   #define DNS_ASYNC_MAX_NAME_LEN 63
+#elif (DNS_ASYNC_MAX_NAME_LEN < 1 || DNS_ASYNC_MAX_NAME_LEN > 255)
+   #error DNS_ASYNC_MAX_NAME_LEN parameter is invalid
+#endif
+
+//Stack size required to run the resolver task
+#ifndef DNS_TASK_STACK_SIZE
+   #define DNS_TASK_STACK_SIZE 550
+#elif (DNS_TASK_STACK_SIZE < 1)
+   #error DNS_TASK_STACK_SIZE parameter is invalid
+#endif
+
+//Priority at which the resolver task should run
+#ifndef DNS_TASK_PRIORITY
+   #define DNS_TASK_PRIORITY 1
+#elif (DNS_TASK_PRIORITY < 0)
+   #error DNS_TASK_PRIORITY parameter is invalid
+#endif
+
 //DNS port number
 #define DNS_PORT 53
 //Maximum size of DNS messages
 #define DNS_MESSAGE_MAX_SIZE 512
 //Maximum size of names
 #define DNS_NAME_MAX_SIZE 255
+//Maximum number of DNS servers per interface
+#define DNS_MAX_SERVERS (IPV4_MAX_DNS_SERVERS + IPV6_MAX_DNS_SERVERS)
 //Maximum size of labels
 #define DNS_LABEL_MAX_SIZE 63
 //Label compression tag
@@ -151,10 +209,70 @@ typedef __packed struct
 #endif
 
 
+/**
+ * @brief Query sent for a given address family
+ **/
+
+typedef struct
+{
+   uint16_t type;                     ///<Record type (A or AAAA)
+   uint16_t identifier;               ///<Identifier used to match the response
+   bool_t done;                       ///<A conclusive response has been received
+   error_t error;                     ///<Status of the query
+   size_t count;                      ///<Number of addresses found
+   IpAddr ipAddr[DNS_MAX_ADDRESSES];  ///<Addresses found
+   uint32_t ttl;                      ///<Time to live of the answer
+} DnsPendingQuery;
+
+
+/**
+ * @brief Completion callback of an asynchronous resolution
+ **/
+
+typedef void (*DnsCallback)(error_t error, const char_t *name,
+   const IpAddr *ipAddrList, size_t numEntries, void *param);
+
+
+/**
+ * @brief Asynchronous resolution request
+ **/
+
+typedef struct
+{
+   NetInterface *interface;                 ///<Underlying network interface
+   char_t name[DNS_ASYNC_MAX_NAME_LEN + 1]; ///<Name of the host to resolve
+   uint_t flags;                            ///<Address families to look for
+   DnsCallback callback;                    ///<Completion callback
+   void *param;                             ///<Opaque pointer passed to the callback
+} DnsRequest;
+
+
+//DNS client related functions
+error_t dnsInit(void);
+
 error_t dnsResolve(NetInterface *interface, const char_t *name, IpAddr *ipAddr);
 
-error_t dnsSendQuery(Socket *socket, DnsHeader *dnsMessage, uint16_t identifier, const char_t *name);
-error_t dnsParseResponse(DnsHeader *dnsMessage, size_t length, uint16_t identifier, IpAddr *ipAddr);
+error_t dnsResolveEx(NetInterface *interface, const char_t *name, uint_t flags,
+   IpAddr *ipAddrList, size_t maxEntries, size_t *numEntries);
+
+error_t dnsResolveAsync(NetInterface *interface, const char_t *name,
+   uint_t flags, DnsCallback callback, void *param);
+
+void dnsTask(void *param);
+
+error_t dnsQuery(NetInterface *interface, const char_t *name, uint_t flags,
+   IpAddr *ipAddrList, size_t maxEntries, size_t *numEntries, uint32_t *ttl);
+
+uint_t dnsGetServerList(NetInterface *interface, IpAddr *serverList);
+
+bool_t dnsRaceServer(Socket *socket, DnsHeader *dnsMessage, const IpAddr *serverList,
+   uint_t serverCount, DnsPendingQuery *queries, uint_t queryCount, time_t timeout);
+
+error_t dnsSendQuery(Socket *socket, const IpAddr *serverIpAddr, DnsHeader *dnsMessage,
+   uint16_t identifier, const char_t *name, uint16_t type);
+
+error_t dnsParseResponse(DnsHeader *dnsMessage, size_t length, uint16_t identifier,
+   IpAddr *ipAddrList, size_t maxEntries, size_t *numEntries, uint32_t *ttl);
 
 size_t dnsEncodeName(const char_t *src, uint8_t *dest);
 size_t dnsDecodeName(DnsHeader *dnsMessage, size_t length, size_t pos, char_t *dest);
@@ -39,6 +39,14 @@
    #error MAC_FILTER_MAX_SIZE parameter is invalid
 #endif
 
+//Size of the hash table used to look up the MAC filter table (must be a power of two)
+#ifndef MAC_FILTER_HASH_TABLE_SIZE
+   #define MAC_FILTER_HASH_TABLE_SIZE 8
+#elif (MAC_FILTER_HASH_TABLE_SIZE < 1 || MAC_FILTER_HASH_TABLE_SIZE > 64 || \
+   (MAC_FILTER_HASH_TABLE_SIZE & (MAC_FILTER_HASH_TABLE_SIZE - 1)))
+   #error MAC_FILTER_HASH_TABLE_SIZE parameter is invalid
+#endif
+
 //CRC32 calculation using pre-calculated lookup table
 #ifndef ETH_FAST_CRC_SUPPORT
    #define ETH_FAST_CRC_SUPPORT DISABLED
@@ -46,6 +54,20 @@
    #error ETH_FAST_CRC_SUPPORT parameter is invalid
 #endif
 
+//Number of bytes processed per step by the table-driven CRC (1, 4 or 8)
+#ifndef ETH_CRC_SLICE_SIZE
+   #define ETH_CRC_SLICE_SIZE 1
+#elif (ETH_CRC_SLICE_SIZE != 1 && ETH_CRC_SLICE_SIZE != 4 && ETH_CRC_SLICE_SIZE != 8)
+   #error ETH_CRC_SLICE_SIZE parameter is invalid
+#endif
+
+//CRC32 calculation using the CRC unit of the target device
+#ifndef ETH_HW_CRC_SUPPORT
+   #define ETH_HW_CRC_SUPPORT DISABLED
+#elif (ETH_HW_CRC_SUPPORT != ENABLED && ETH_HW_CRC_SUPPORT != DISABLED)
+   #error ETH_HW_CRC_SUPPORT parameter is invalid
+#endif
+
 //Minimum Ethernet frame size
 #define ETH_MIN_FRAME_SIZE 64
 //Maximum Ethernet frame size
@@ -127,10 +149,11 @@ typedef __packed struct
  * @brief MAC filter table entry
  **/
 
-typedef struct
+typedef struct _MacFilterEntry
 {
-   MacAddr addr;    ///<MAC address
-   uint_t refCount; ///<Reference count for the current entry
+   MacAddr addr;                     ///<MAC address
+   uint_t refCount;                  ///<Reference count for the current entry
+   struct _MacFilterEntry *hashNext; ///<Next entry in the same hash bucket
 } MacFilterEntry;
 
 
@@ -150,8 +173,18 @@ error_t ethCheckDestAddr(NetInterface *interface, const MacAddr *macAddr);
 error_t ethAcceptMulticastAddr(NetInterface *interface, const MacAddr *macAddr);
 error_t ethDropMulticastAddr(NetInterface *interface, const MacAddr *macAddr);
 
+MacFilterEntry *ethFindMacFilterEntry(NetInterface *interface, const MacAddr *macAddr);
+uint_t ethCalcMacFilterHash(const MacAddr *macAddr);
+void ethUpdateMacFilterHash(NetInterface *interface);
+
 uint32_t ethCalcCrc(const void *data, size_t length);
 uint32_t ethCalcCrcEx(const ChunkedBuffer *buffer, size_t offset, size_t length);
+uint32_t ethUpdateCrc(uint32_t crc, const void *data, size_t length);
+
+//Platform-specific CRC calculation (reflected 0x04C11DB7 polynomial)
+#if (ETH_HW_CRC_SUPPORT == ENABLED)
+   uint32_t ethHwUpdateCrc(uint32_t crc, const void *data, size_t length);
+#endif
 
 ChunkedBuffer *ethAllocBuffer(size_t length, size_t *offset);
 
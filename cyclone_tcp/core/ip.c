@@ -30,16 +30,30 @@
 #define TRACE_LEVEL IP_TRACE_LEVEL
 
 //Dependencies
+#include <string.h>
 #include "tcp_ip_stack.h"
 #include "ethernet.h"
 #include "ip.h"
 #include "ipv4.h"
 #include "ipv6.h"
+#include "probe.h"
 #include "debug.h"
 
+//SIMD intrinsics
+#if (IP_SIMD_CHECKSUM_SUPPORT == ENABLED && defined(__SSE2__))
+   #include <emmintrin.h>
+#elif (IP_SIMD_CHECKSUM_SUPPORT == ENABLED && defined(__ARM_NEON))
+   #include <arm_neon.h>
+#endif
+
 //Special IP address
 const IpAddr IP_ADDR_ANY = {0};
 
+//Block checksum routines
+static uint16_t ipCalcPartialChecksum(const void *data, size_t length);
+static uint16_t ipCopyPartialChecksum(void *dest, const void *src, size_t length);
+static uint64_t ipSumAlignedWords(const uint8_t *data, size_t length);
+
 
 /**
  * @brief Send an IP datagram
@@ -48,11 +62,13 @@ const IpAddr IP_ADDR_ANY = {0};
  * @param[in] buffer Multi-part buffer containing the payload
  * @param[in] offset Offset to the first payload byte
  * @param[in] timeToLive TTL value
+ * @param[in] tos Differentiated Services field (Traffic Class for IPv6)
+ * @param[in,out] cache Cached path to the destination (optional parameter)
  * @return Error code
  **/
 
 error_t ipSendDatagram(NetInterface *interface, IpPseudoHeader *pseudoHeader,
-   ChunkedBuffer *buffer, size_t offset, uint8_t timeToLive)
+   ChunkedBuffer *buffer, size_t offset, uint8_t timeToLive, uint8_t tos, IpPathCache *cache)
 {
    error_t error;
 
@@ -62,7 +78,7 @@ error_t ipSendDatagram(NetInterface *interface, IpPseudoHeader *pseudoHeader,
    {
       //Form an IPv4 packet and send it
       error = ipv4SendDatagram(interface, &pseudoHeader->ipv4Data,
-         buffer, offset, timeToLive);
+         buffer, offset, timeToLive, tos, cache);
    }
    else
 #endif
@@ -72,7 +88,7 @@ error_t ipSendDatagram(NetInterface *interface, IpPseudoHeader *pseudoHeader,
    {
       //Form an IPv6 packet and send it
       error = ipv6SendDatagram(interface, &pseudoHeader->ipv6Data,
-         buffer, offset, timeToLive);
+         buffer, offset, timeToLive, tos, cache);
    }
    else
 #endif
@@ -142,30 +158,8 @@ error_t ipSelectSourceAddr(NetInterface **interface,
 
 uint16_t ipCalcChecksum(const void *data, size_t length)
 {
-   //Checksum preset value
-   uint32_t checksum = 0x0000;
-
-   //Process all the data
-   while(length > 1)
-   {
-      //Update checksum value
-      checksum += *((uint16_t *) data);
-      //Point to the next 16-bit word
-      data = (uint16_t *) data + 1;
-      //Adjust the number of remaining words to process
-      length -= 2;
-   }
-
-   //Add left-over byte, if any
-   if(length > 0)
-      checksum += *((uint8_t *) data);
-
-   //Fold 32-bit sum to 16 bits
-   while(checksum >> 16)
-      checksum = (checksum & 0xFFFF) + (checksum >> 16);
-
    //Return 1's complement value
-   return checksum ^ 0xFFFF;
+   return ipCalcPartialChecksum(data, length) ^ 0xFFFF;
 }
 
 
@@ -182,10 +176,12 @@ uint16_t ipCalcChecksumEx(const ChunkedBuffer *buffer, size_t offset, size_t len
    uint_t i;
    uint_t m;
    uint_t n;
-   bool_t odd;
-   uint8_t *data;
+   uint32_t temp;
    uint32_t checksum;
 
+   //Instrumentation point
+   PROBE_ENTER(PROBE_IP_CALC_CHECKSUM);
+
    //Checksum preset value
    checksum = 0x0000;
    //Total number of bytes processed
@@ -197,105 +193,23 @@ uint16_t ipCalcChecksumEx(const ChunkedBuffer *buffer, size_t offset, size_t len
       //Is there any data to process in the current chunk?
       if(offset < buffer->chunk[i].length)
       {
-         //Check whether the total number of bytes already processed is odd
-         odd = (n & 1) ? TRUE : FALSE;
-
-         //Point to the first data byte
-         data = (uint8_t *) buffer->chunk[i].address + offset;
-
          //Number of bytes available in the current chunk
          m = buffer->chunk[i].length - offset;
          //Limit the number of byte to process
          m = min(m, length - n);
 
+         //Process the current chunk
+         temp = ipCalcPartialChecksum((uint8_t *) buffer->chunk[i].address + offset, m);
+
+         //A chunk starting at an odd position contributes byte-swapped words
+         if(n & 1)
+            temp = ((temp >> 8) | (temp << 8)) & 0xFFFF;
+
+         //Update checksum value
+         checksum += temp;
          //Now adjust the total length
          n += m;
 
-         //Data buffer is not aligned on 16-bit boundaries?
-         if((uint32_t) data & 1)
-         {
-            //The total number of bytes is even?
-            if(!odd)
-            {
-               //Fold 32-bit sum to 16 bits
-               while(checksum >> 16)
-                  checksum = (checksum & 0xFFFF) + (checksum >> 16);
-               //Swap checksum value
-               checksum = ((checksum >> 8) | (checksum << 8)) & 0xFFFF;
-            }
-
-            //Restore the alignment on 16-bit boundaries
-            if(m > 0)
-            {
-               //Update checksum value
-               checksum += *data << 8;
-               //Point to the next byte
-               data += 1;
-               m -= 1;
-            }
-
-            //Process the data 2 bytes at a time
-            while(m > 1)
-            {
-               //Update checksum value
-               checksum += *((uint16_t *) data);
-               //Point to the next 16-bit word
-               data += 2;
-               m -= 2;
-            }
-
-            //Add left-over byte, if any
-            if(m > 0)
-               checksum += *data;
-
-            //Restore checksum endianness
-            if(!odd)
-            {
-               //Fold 32-bit sum to 16 bits
-               while(checksum >> 16)
-                  checksum = (checksum & 0xFFFF) + (checksum >> 16);
-               //Swap checksum value
-               checksum = ((checksum >> 8) | (checksum << 8)) & 0xFFFF;
-            }
-         }
-         //Data buffer is aligned on 16-bit boundaries?
-         else
-         {
-            //The total number of bytes is odd?
-            if(odd)
-            {
-               //Fold 32-bit sum to 16 bits
-               while(checksum >> 16)
-                  checksum = (checksum & 0xFFFF) + (checksum >> 16);
-               //Swap checksum value
-               checksum = ((checksum >> 8) | (checksum << 8)) & 0xFFFF;
-            }
-
-            //Process the data 2 bytes at a time
-            while(m > 1)
-            {
-               //Update checksum value
-               checksum += *((uint16_t *) data);
-               //Point to the next 16-bit word
-               data += 2;
-               m -= 2;
-            }
-
-            //Add left-over byte, if any
-            if(m > 0)
-               checksum += *data;
-
-            //Restore checksum endianness
-            if(odd)
-            {
-               //Fold 32-bit sum to 16 bits
-               while(checksum >> 16)
-                  checksum = (checksum & 0xFFFF) + (checksum >> 16);
-               //Swap checksum value
-               checksum = ((checksum >> 8) | (checksum << 8)) & 0xFFFF;
-            }
-         }
-
          //Process the next block from the start
          offset = 0;
       }
@@ -316,45 +230,507 @@ uint16_t ipCalcChecksumEx(const ChunkedBuffer *buffer, size_t offset, size_t len
 
 
 /**
- * @brief Calculate IP upper-layer checksum
- * @param[in] pseudoHeader Pointer to the pseudo header
- * @param[in] pseudoHeaderLength Pseudo header length
- * @param[in] data Pointer to the upper-layer data
- * @param[in] dataLength Upper-layer data length
+ * @brief Copy data between multi-part buffers and calculate its checksum
+ *
+ * Each byte is summed while it is being copied, so that the data is
+ * walked only once. The return value is the same as ipCalcChecksumEx
+ * would give for the copied range
+ *
+ * @param[out] dest Pointer to the destination buffer
+ * @param[in] destOffset Write offset
+ * @param[in] src Pointer to the source buffer
+ * @param[in] srcOffset Read offset
+ * @param[in] length Number of bytes to be copied
  * @return Checksum value
  **/
 
-uint16_t ipCalcUpperLayerChecksum(const void *pseudoHeader,
-   size_t pseudoHeaderLength, const void *data, size_t dataLength)
+uint16_t ipCopyChecksumEx(ChunkedBuffer *dest, size_t destOffset,
+   const ChunkedBuffer *src, size_t srcOffset, size_t length)
 {
+   uint_t i;
+   uint_t j;
+   uint_t m;
+   uint_t n;
+   uint8_t *p;
+   uint8_t *q;
+   uint32_t temp;
+   uint32_t checksum;
+
    //Checksum preset value
-   uint32_t checksum = 0x0000;
+   checksum = 0x0000;
+   //Total number of bytes processed
+   n = 0;
 
-   //Process pseudo header
-   while(pseudoHeaderLength > 1)
+   //Skip the beginning of the destination data
+   for(i = 0; i < dest->chunkCount; i++)
+   {
+      //The data at the specified offset resides in the current chunk?
+      if(destOffset < dest->chunk[i].length)
+         break;
+
+      //Jump to the next chunk
+      destOffset -= dest->chunk[i].length;
+   }
+
+   //Skip the beginning of the source data
+   for(j = 0; j < src->chunkCount; j++)
    {
+      //The data at the specified offset resides in the current chunk?
+      if(srcOffset < src->chunk[j].length)
+         break;
+
+      //Jump to the next chunk
+      srcOffset -= src->chunk[j].length;
+   }
+
+   //Loop through data chunks
+   while(n < length && i < dest->chunkCount && j < src->chunkCount)
+   {
+      //Point to the first data byte
+      p = (uint8_t *) dest->chunk[i].address + destOffset;
+      q = (uint8_t *) src->chunk[j].address + srcOffset;
+
+      //Compute the number of bytes to copy
+      m = min(length - n, dest->chunk[i].length - destOffset);
+      m = min(m, src->chunk[j].length - srcOffset);
+
+      //Copy data and process it at the same time
+      temp = ipCopyPartialChecksum(p, q, m);
+
+      //A block starting at an odd position contributes byte-swapped words
+      if(n & 1)
+         temp = ((temp >> 8) | (temp << 8)) & 0xFFFF;
+
       //Update checksum value
-      checksum += *((uint16_t *) pseudoHeader);
+      checksum += temp;
+      //Now adjust the total length
+      n += m;
+
+      //Adjust offsets
+      destOffset += m;
+      srcOffset += m;
+
+      //Jump to the next chunks if necessary
+      if(destOffset >= dest->chunk[i].length)
+      {
+         destOffset = 0;
+         i++;
+      }
+      if(srcOffset >= src->chunk[j].length)
+      {
+         srcOffset = 0;
+         j++;
+      }
+   }
+
+   //Fold 32-bit sum to 16 bits
+   while(checksum >> 16)
+      checksum = (checksum & 0xFFFF) + (checksum >> 16);
+
+   //Return 1's complement value
+   return checksum ^ 0xFFFF;
+}
+
+
+/**
+ * @brief Combine the checksums of two adjacent blocks
+ * @param[in] checksum1 Checksum of the first block
+ * @param[in] checksum2 Checksum of the second block
+ * @param[in] length1 Length of the first block
+ * @return Checksum of the concatenated blocks
+ **/
+
+uint16_t ipCombineChecksum(uint16_t checksum1, uint16_t checksum2, size_t length1)
+{
+   uint32_t temp;
+   uint32_t checksum;
+
+   //Retrieve the sum of the second block
+   temp = checksum2 ^ 0xFFFF;
+
+   //The second block starts at an odd position?
+   if(length1 & 1)
+      temp = ((temp >> 8) | (temp << 8)) & 0xFFFF;
+
+   //Add the sums of both blocks
+   checksum = (checksum1 ^ 0xFFFF) + temp;
+
+   //Fold 32-bit sum to 16 bits
+   while(checksum >> 16)
+      checksum = (checksum & 0xFFFF) + (checksum >> 16);
+
+   //Return 1's complement value
+   return checksum ^ 0xFFFF;
+}
+
+
+/**
+ * @brief Incrementally update a checksum after a 16-bit field changed
+ *
+ * The update follows RFC 1624 (eqn. 3), so that the checksum does not
+ * need to be recalculated over the whole message. Both values must be
+ * given as they appear in the message
+ *
+ * @param[in] checksum Current checksum value
+ * @param[in] oldValue Previous value of the modified field
+ * @param[in] newValue New value of the modified field
+ * @return Updated checksum value
+ **/
+
+uint16_t ipUpdateChecksum(uint16_t checksum, uint16_t oldValue, uint16_t newValue)
+{
+   uint32_t temp;
+
+   //HC' = ~(~HC + ~m + m')
+   temp = (checksum ^ 0xFFFF) + (oldValue ^ 0xFFFF) + newValue;
+
+   //Fold 32-bit sum to 16 bits
+   while(temp >> 16)
+      temp = (temp & 0xFFFF) + (temp >> 16);
+
+   //Return 1's complement value
+   return temp ^ 0xFFFF;
+}
+
+
+/**
+ * @brief Calculate the 1's complement sum of a contiguous block
+ *
+ * The data is summed as if it started on a 16-bit boundary of the
+ * message, whatever its actual alignment in memory
+ *
+ * @param[in] data Pointer to the data over which to calculate the sum
+ * @param[in] length Number of bytes to process
+ * @return 16-bit 1's complement sum (not complemented)
+ **/
+
+static uint16_t ipCalcPartialChecksum(const void *data, size_t length)
+{
+   bool_t swapped;
+   uint64_t checksum;
+   const uint8_t *p;
+   union
+   {
+      uint16_t word;
+      uint8_t bytes[2];
+   } temp;
+
+   //Point to the data over which to calculate the checksum
+   p = (uint8_t *) data;
+   //Checksum preset value
+   checksum = 0;
+   //Data buffer is not aligned on 16-bit boundaries?
+   swapped = ((uintptr_t) p & 1) ? TRUE : FALSE;
+
+   //Restore the alignment on 16-bit boundaries
+   if(swapped && length > 0)
+   {
+      //The leading byte is summed as the second byte of a 16-bit word,
+      //which byte-swaps the running sum until it is restored below
+      temp.bytes[0] = 0;
+      temp.bytes[1] = *p;
+      checksum += temp.word;
+
+      //Point to the next byte
+      p++;
+      length--;
+   }
+
+   //Restore the alignment on 32-bit boundaries
+   if(((uintptr_t) p & 2) && length > 1)
+   {
+      //Update checksum value
+      checksum += *((uint16_t *) p);
       //Point to the next 16-bit word
-      pseudoHeader = (uint16_t *) pseudoHeader + 1;
-      //Adjust the number of remaining words to process
-      pseudoHeaderLength -= 2;
+      p += 2;
+      length -= 2;
    }
 
-   //Process upper-layer data
-   while(dataLength > 1)
+   //The bulk of the data is processed by the word-wide kernel
+   checksum += ipSumAlignedWords(p, length);
+   p += length & ~3;
+   length &= 3;
+
+   //Process the last 16-bit word, if any
+   if(length > 1)
    {
       //Update checksum value
-      checksum += *((uint16_t *) data);
+      checksum += *((uint16_t *) p);
       //Point to the next 16-bit word
-      data = (uint16_t *) data + 1;
-      //Adjust the number of remaining words to process
-      dataLength -= 2;
+      p += 2;
+      length -= 2;
    }
 
    //Add left-over byte, if any
-   if(dataLength > 0)
-      checksum += *((uint8_t *) data);
+   if(length > 0)
+   {
+      //Pad the byte with zero to form a 16-bit word
+      temp.bytes[0] = *p;
+      temp.bytes[1] = 0;
+      checksum += temp.word;
+   }
+
+   //Fold 64-bit sum to 16 bits
+   while(checksum >> 16)
+      checksum = (checksum & 0xFFFF) + (checksum >> 16);
+
+   //Restore checksum endianness
+   if(swapped)
+      checksum = ((checksum >> 8) | (checksum << 8)) & 0xFFFF;
+
+   //Return the resulting sum
+   return (uint16_t) checksum;
+}
+
+
+/**
+ * @brief Copy a contiguous block and calculate its 1's complement sum
+ *
+ * The loads are aligned on the source buffer. Stores go through memcpy,
+ * which lets the compiler emit unaligned accesses when the destination
+ * is not aligned the same way
+ *
+ * @param[out] dest Destination buffer
+ * @param[in] src Source buffer
+ * @param[in] length Number of bytes to copy
+ * @return 16-bit 1's complement sum (not complemented)
+ **/
+
+static uint16_t ipCopyPartialChecksum(void *dest, const void *src, size_t length)
+{
+   bool_t swapped;
+   uint16_t word;
+   uint32_t value;
+   uint64_t checksum;
+   uint8_t *p;
+   const uint8_t *q;
+   union
+   {
+      uint16_t word;
+      uint8_t bytes[2];
+   } temp;
+
+   //Point to the destination and source buffers
+   p = (uint8_t *) dest;
+   q = (uint8_t *) src;
+   //Checksum preset value
+   checksum = 0;
+   //Source buffer is not aligned on 16-bit boundaries?
+   swapped = ((uintptr_t) q & 1) ? TRUE : FALSE;
+
+   //Restore the alignment on 16-bit boundaries
+   if(swapped && length > 0)
+   {
+      //The leading byte is summed as the second byte of a 16-bit word,
+      //which byte-swaps the running sum until it is restored below
+      temp.bytes[0] = 0;
+      temp.bytes[1] = *q;
+      checksum += temp.word;
+
+      //Copy the leading byte
+      *(p++) = *(q++);
+      length--;
+   }
+
+   //Restore the alignment on 32-bit boundaries
+   if(((uintptr_t) q & 2) && length > 1)
+   {
+      //Copy a 16-bit word and update checksum value
+      word = *((uint16_t *) q);
+      memcpy(p, &word, 2);
+      checksum += word;
+
+      //Point to the next 16-bit word
+      p += 2;
+      q += 2;
+      length -= 2;
+   }
+
+   //Process the data 4 bytes at a time
+   while(length >= 4)
+   {
+      //Copy a 32-bit word and update checksum value
+      value = *((uint32_t *) q);
+      memcpy(p, &value, 4);
+      checksum += value;
+
+      //Point to the next 32-bit word
+      p += 4;
+      q += 4;
+      length -= 4;
+   }
+
+   //Process the last 16-bit word, if any
+   if(length > 1)
+   {
+      //Copy a 16-bit word and update checksum value
+      word = *((uint16_t *) q);
+      memcpy(p, &word, 2);
+      checksum += word;
+
+      //Point to the next 16-bit word
+      p += 2;
+      q += 2;
+      length -= 2;
+   }
+
+   //Process the left-over byte, if any
+   if(length > 0)
+   {
+      //Pad the byte with zero to form a 16-bit word
+      temp.bytes[0] = *q;
+      temp.bytes[1] = 0;
+      checksum += temp.word;
+
+      //Copy the left-over byte
+      *p = *q;
+   }
+
+   //Fold 64-bit sum to 16 bits
+   while(checksum >> 16)
+      checksum = (checksum & 0xFFFF) + (checksum >> 16);
+
+   //Restore checksum endianness
+   if(swapped)
+      checksum = ((checksum >> 8) | (checksum << 8)) & 0xFFFF;
+
+   //Return the resulting sum
+   return (uint16_t) checksum;
+}
+
+
+/**
+ * @brief Sum 32-bit words of a block aligned on a 32-bit boundary
+ *
+ * Trailing bytes beyond the last multiple of 4 are left to the caller.
+ * Carries are accumulated in the upper half of a 64-bit sum and folded
+ * by the caller once the whole block has been processed
+ *
+ * @param[in] data Pointer to the data (32-bit aligned)
+ * @param[in] length Number of bytes in the block
+ * @return Unfolded sum
+ **/
+
+static uint64_t ipSumAlignedWords(const uint8_t *data, size_t length)
+{
+   uint64_t checksum = 0;
+
+//SSE2 kernel
+#if (IP_SIMD_CHECKSUM_SUPPORT == ENABLED && defined(__SSE2__))
+   uint_t k;
+   uint32_t lanes[4];
+   __m128i sum;
+   __m128i v;
+   const __m128i zero = _mm_setzero_si128();
+
+   //Process the data 16 bytes at a time
+   while(length >= 16)
+   {
+      //Clear the 32-bit accumulators
+      sum = zero;
+
+      //Each lane gathers at most 2 words per step, so the accumulators
+      //must be flushed before they overflow
+      for(k = 0; k < 16384 && length >= 16; k++)
+      {
+         //Load 8 words and widen them to 32 bits
+         v = _mm_loadu_si128((const __m128i *) data);
+         sum = _mm_add_epi32(sum, _mm_unpacklo_epi16(v, zero));
+         sum = _mm_add_epi32(sum, _mm_unpackhi_epi16(v, zero));
+
+         //Next block
+         data += 16;
+         length -= 16;
+      }
+
+      //Flush the accumulators
+      _mm_storeu_si128((__m128i *) lanes, sum);
+      checksum += (uint64_t) lanes[0] + lanes[1] + lanes[2] + lanes[3];
+   }
+
+//NEON kernel
+#elif (IP_SIMD_CHECKSUM_SUPPORT == ENABLED && defined(__ARM_NEON))
+   uint_t k;
+   uint32x4_t sum;
+
+   //Process the data 16 bytes at a time
+   while(length >= 16)
+   {
+      //Clear the 32-bit accumulators
+      sum = vdupq_n_u32(0);
+
+      //Each lane gathers at most 2 words per step, so the accumulators
+      //must be flushed before they overflow
+      for(k = 0; k < 16384 && length >= 16; k++)
+      {
+         //Pairwise add 8 words into the 32-bit accumulators
+         sum = vpadalq_u16(sum, vld1q_u16((const uint16_t *) data));
+
+         //Next block
+         data += 16;
+         length -= 16;
+      }
+
+      //Flush the accumulators
+      checksum += (uint64_t) vgetq_lane_u32(sum, 0) + vgetq_lane_u32(sum, 1) +
+         vgetq_lane_u32(sum, 2) + vgetq_lane_u32(sum, 3);
+   }
+
+//Portable kernel
+#else
+   const uint32_t *p = (const uint32_t *) data;
+
+   //Process the data 16 bytes at a time
+   while(length >= 16)
+   {
+      //Unrolled loop
+      checksum += p[0];
+      checksum += p[1];
+      checksum += p[2];
+      checksum += p[3];
+
+      //Next block
+      p += 4;
+      length -= 16;
+   }
+
+   //Keep track of the current position
+   data = (const uint8_t *) p;
+#endif
+
+   //Process the remaining 32-bit words
+   while(length >= 4)
+   {
+      //Update checksum value
+      checksum += *((uint32_t *) data);
+      //Point to the next 32-bit word
+      data += 4;
+      length -= 4;
+   }
+
+   //Return the unfolded sum
+   return checksum;
+}
+
+
+/**
+ * @brief Calculate IP upper-layer checksum
+ * @param[in] pseudoHeader Pointer to the pseudo header
+ * @param[in] pseudoHeaderLength Pseudo header length
+ * @param[in] data Pointer to the upper-layer data
+ * @param[in] dataLength Upper-layer data length
+ * @return Checksum value
+ **/
+
+uint16_t ipCalcUpperLayerChecksum(const void *pseudoHeader,
+   size_t pseudoHeaderLength, const void *data, size_t dataLength)
+{
+   uint32_t checksum;
+
+   //Process pseudo header
+   checksum = ipCalcPartialChecksum(pseudoHeader, pseudoHeaderLength);
+   //Process upper-layer data
+   checksum += ipCalcPartialChecksum(data, dataLength);
 
    //Fold 32-bit sum to 16 bits
    while(checksum >> 16)
@@ -389,15 +765,7 @@ uint16_t ipCalcUpperLayerChecksumEx(const void *pseudoHeader,
    checksum = checksum ^ 0xFFFF;
 
    //Process pseudo header
-   while(pseudoHeaderLength > 1)
-   {
-      //Update checksum value
-      checksum += *((uint16_t *) pseudoHeader);
-      //Point to the next 16-bit word
-      pseudoHeader = (uint16_t *) pseudoHeader + 1;
-      //Adjust the number of remaining words to process
-      pseudoHeaderLength -= 2;
-   }
+   checksum += ipCalcPartialChecksum(pseudoHeader, pseudoHeaderLength);
 
    //Fold 32-bit sum to 16 bits
    while(checksum >> 16)
@@ -521,6 +889,90 @@ error_t ipLeaveMulticastGroup(NetInterface *interface, const IpAddr *groupAddr)
 }
 
 
+/**
+ * @brief Set the source filter of a host group
+ * @param[in] interface Underlying network interface (optional parameter)
+ * @param[in] groupAddr IP address identifying the host group
+ * @param[in] filterMode Filter mode (include or exclude)
+ * @param[in] srcAddr List of source addresses
+ * @param[in] srcAddrCount Number of source addresses
+ * @return Error code
+ **/
+
+error_t ipSetMulticastSourceFilter(NetInterface *interface, const IpAddr *groupAddr,
+   IpFilterMode filterMode, const IpAddr *srcAddr, uint_t srcAddrCount)
+{
+   //Use default network interface?
+   if(!interface)
+      interface = tcpIpStackGetDefaultInterface();
+
+   //Check parameters
+   if(srcAddrCount > 0 && srcAddr == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+#if (IPV4_SUPPORT == ENABLED && IPV4_MULTICAST_FILTER_SUPPORT == ENABLED)
+   //IPv4 multicast address?
+   if(groupAddr->length == sizeof(Ipv4Addr))
+   {
+      uint_t i;
+      Ipv4Addr ipv4SrcAddr[IPV4_MAX_MULTICAST_SRC_ADDRS];
+
+      //Check the number of source addresses
+      if(srcAddrCount > IPV4_MAX_MULTICAST_SRC_ADDRS)
+         return ERROR_INVALID_PARAMETER;
+
+      //Retrieve the list of source addresses
+      for(i = 0; i < srcAddrCount; i++)
+      {
+         //Sources and group must belong to the same address family
+         if(srcAddr[i].length != sizeof(Ipv4Addr))
+            return ERROR_INVALID_ADDRESS;
+
+         //Save current address
+         ipv4SrcAddr[i] = srcAddr[i].ipv4Addr;
+      }
+
+      //Set the source filter
+      return ipv4SetMulticastSourceFilter(interface, groupAddr->ipv4Addr,
+         filterMode, ipv4SrcAddr, srcAddrCount);
+   }
+   else
+#endif
+#if (IPV6_SUPPORT == ENABLED && IPV6_MULTICAST_FILTER_SUPPORT == ENABLED)
+   //IPv6 multicast address?
+   if(groupAddr->length == sizeof(Ipv6Addr))
+   {
+      uint_t i;
+      Ipv6Addr ipv6SrcAddr[IPV6_MAX_MULTICAST_SRC_ADDRS];
+
+      //Check the number of source addresses
+      if(srcAddrCount > IPV6_MAX_MULTICAST_SRC_ADDRS)
+         return ERROR_INVALID_PARAMETER;
+
+      //Retrieve the list of source addresses
+      for(i = 0; i < srcAddrCount; i++)
+      {
+         //Sources and group must belong to the same address family
+         if(srcAddr[i].length != sizeof(Ipv6Addr))
+            return ERROR_INVALID_ADDRESS;
+
+         //Save current address
+         ipv6SrcAddr[i] = srcAddr[i].ipv6Addr;
+      }
+
+      //Set the source filter
+      return ipv6SetMulticastSourceFilter(interface, &groupAddr->ipv6Addr,
+         filterMode, ipv6SrcAddr, srcAddrCount);
+   }
+   else
+#endif
+   //Invalid IP address?
+   {
+      return ERROR_INVALID_ADDRESS;
+   }
+}
+
+
 /**
  * @brief Compare an IP address against the unspecified address
  * @param[in] ipAddr IP address
@@ -554,6 +1006,40 @@ bool_t ipIsUnspecifiedAddr(const IpAddr *ipAddr)
 }
 
 
+/**
+ * @brief Compare IP addresses
+ * @param[in] ipAddr1 First IP address
+ * @param[in] ipAddr2 Second IP address
+ * @return TRUE if the IP addresses match, else FALSE
+ **/
+
+bool_t ipCompAddr(const IpAddr *ipAddr1, const IpAddr *ipAddr2)
+{
+#if (IPV4_SUPPORT == ENABLED)
+   //IPv4 addresses?
+   if(ipAddr1->length == sizeof(Ipv4Addr) && ipAddr2->length == sizeof(Ipv4Addr))
+   {
+      //Compare IPv4 addresses
+      return (ipAddr1->ipv4Addr == ipAddr2->ipv4Addr) ? TRUE : FALSE;
+   }
+   else
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 addresses?
+   if(ipAddr1->length == sizeof(Ipv6Addr) && ipAddr2->length == sizeof(Ipv6Addr))
+   {
+      //Compare IPv6 addresses
+      return ipv6CompAddr(&ipAddr1->ipv6Addr, &ipAddr2->ipv6Addr);
+   }
+   else
+#endif
+   //Different address families?
+   {
+      return FALSE;
+   }
+}
+
+
 /**
  * @brief Convert a string representation of an IP address to a binary IP address
  * @param[in] str NULL-terminated string representing the IP address
@@ -33,6 +33,23 @@
 #include "ipv4.h"
 #include "ipv6.h"
 
+//IP checksum calculation using SSE2 or NEON instructions
+#ifndef IP_SIMD_CHECKSUM_SUPPORT
+   #define IP_SIMD_CHECKSUM_SUPPORT DISABLED
+#elif (IP_SIMD_CHECKSUM_SUPPORT != ENABLED && IP_SIMD_CHECKSUM_SUPPORT != DISABLED)
+   #error IP_SIMD_CHECKSUM_SUPPORT parameter is invalid
+#endif
+
+//Highest priority level that can be assigned to outgoing traffic
+#define IP_MAX_PRIORITY 7
+//Network control traffic (Class Selector 6, refer to RFC 4594)
+#define IP_TOS_NETWORK_CONTROL 0xC0
+
+//Map a priority level to the corresponding Class Selector codepoint
+#define IP_PRIORITY_TO_TOS(priority) ((uint8_t) ((priority) << 5))
+//Extract the priority level (precedence) from a DS field
+#define IP_TOS_TO_PRIORITY(tos) ((uint_t) ((tos) >> 5))
+
 
 /**
  * @brief IP supported protocols
@@ -45,6 +62,17 @@ typedef enum
 } IpProtocol;
 
 
+/**
+ * @brief Multicast source filter mode
+ **/
+
+typedef enum
+{
+   IP_FILTER_MODE_EXCLUDE = 0, ///<Accept traffic from all sources but the listed ones
+   IP_FILTER_MODE_INCLUDE = 1  ///<Accept traffic from the listed sources only
+} IpFilterMode;
+
+
 /**
  * @brief IP network address
  **/
@@ -84,12 +112,32 @@ typedef struct
 } IpPseudoHeader;
 
 
+/**
+ * @brief Cached path to a remote host
+ *
+ * Connected sockets keep the outcome of the last route lookup and address
+ * resolution so that subsequent packets can skip both. The entry is only
+ * trusted while the neighbor cache generation of the interface is unchanged
+ *
+ **/
+
+struct _IpPathCache
+{
+   NetInterface *interface; ///<Interface the path has been resolved on
+   uint_t generation;       ///<Neighbor cache generation at resolution time
+   bool_t valid;            ///<The entry holds a resolved path
+   IpAddr destAddr;         ///<Destination address
+   IpAddr nextHop;          ///<Next-hop address (destination or router)
+   MacAddr macAddr;         ///<Link-layer address of the next hop
+};
+
+
 //IP related constants
 extern const IpAddr IP_ADDR_ANY;
 
 //IP related functions
 error_t ipSendDatagram(NetInterface *interface, IpPseudoHeader *pseudoHeader,
-   ChunkedBuffer *buffer, size_t offset, uint8_t timeToLive);
+   ChunkedBuffer *buffer, size_t offset, uint8_t timeToLive, uint8_t tos, IpPathCache *cache);
 
 error_t ipSelectSourceAddr(NetInterface **interface,
    const IpAddr *destAddr, IpAddr *srcAddr);
@@ -97,6 +145,12 @@ error_t ipSelectSourceAddr(NetInterface **interface,
 uint16_t ipCalcChecksum(const void *data, size_t length);
 uint16_t ipCalcChecksumEx(const ChunkedBuffer *buffer, size_t offset, size_t length);
 
+uint16_t ipCopyChecksumEx(ChunkedBuffer *dest, size_t destOffset,
+   const ChunkedBuffer *src, size_t srcOffset, size_t length);
+
+uint16_t ipCombineChecksum(uint16_t checksum1, uint16_t checksum2, size_t length1);
+uint16_t ipUpdateChecksum(uint16_t checksum, uint16_t oldValue, uint16_t newValue);
+
 uint16_t ipCalcUpperLayerChecksum(const void *pseudoHeader,
    size_t pseudoHeaderLength, const void *data, size_t dataLength);
 
@@ -108,7 +162,11 @@ ChunkedBuffer *ipAllocBuffer(size_t length, size_t *offset);
 error_t ipJoinMulticastGroup(NetInterface *interface, const IpAddr *groupAddr);
 error_t ipLeaveMulticastGroup(NetInterface *interface, const IpAddr *groupAddr);
 
+error_t ipSetMulticastSourceFilter(NetInterface *interface, const IpAddr *groupAddr,
+   IpFilterMode filterMode, const IpAddr *srcAddr, uint_t srcAddrCount);
+
 bool_t ipIsUnspecifiedAddr(const IpAddr *ipAddr);
+bool_t ipCompAddr(const IpAddr *ipAddr1, const IpAddr *ipAddr2);
 
 error_t ipStringToAddr(const char_t *str, IpAddr *ipAddr);
 char_t *ipAddrToString(const IpAddr *ipAddr, char_t *str);
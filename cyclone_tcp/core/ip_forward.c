@@ -0,0 +1,647 @@
+/**
+ * @file ip_forward.c
+ * @brief IPv4 and IPv6 forwarding
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * When forwarding is enabled on several interfaces, packets that are
+ * received on one of them and addressed to another host are sent over
+ * the interface leading to the destination. The TTL or hop limit is
+ * decremented, the IPv4 header checksum is updated incrementally and the
+ * packet is handed over to the outgoing driver straight from the receive
+ * buffer, without being copied. Forwarded packets are never fragmented
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL IP_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "ethernet.h"
+#include "ip.h"
+#include "ip_route.h"
+#include "ip_forward.h"
+#include "arp.h"
+#include "icmp.h"
+#include "ndp.h"
+#include "icmpv6.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (IP_FORWARD_SUPPORT == ENABLED)
+
+//IP forwarding related local functions
+#if (IPV4_SUPPORT == ENABLED)
+static NetInterface *ipv4ForwardSelectRoute(NetInterface *interface,
+   Ipv4Addr destAddr, Ipv4Addr *nextHop);
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+static NetInterface *ipv6ForwardSelectRoute(NetInterface *interface,
+   const Ipv6Addr *destAddr, Ipv6Addr *nextHop);
+#endif
+static error_t ipForwardSendFrame(NetInterface *interface, const MacAddr *destAddr,
+   uint8_t *packet, size_t length, uint16_t type);
+static ChunkedBuffer *ipForwardCopyPacket(const uint8_t *packet, size_t length, size_t *offset);
+
+
+/**
+ * @brief Enable or disable forwarding on an interface
+ *
+ * Packets received on an interface where forwarding is enabled and
+ * addressed to another host are forwarded through another interface
+ * where forwarding is enabled too
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] enable Enable or disable forwarding
+ * @return Error code
+ **/
+
+error_t ipForwardEnable(NetInterface *interface, bool_t enable)
+{
+   //Check parameters
+   if(interface == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Save the setting
+   interface->ipForwarding = enable;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+#if (IPV4_SUPPORT == ENABLED)
+
+/**
+ * @brief Forward an IPv4 packet addressed to another host
+ *
+ * The packet has been received by ethProcessFrame(), hence the Ethernet
+ * header of the incoming frame precedes it and can be overwritten when
+ * the packet is sent from the receive buffer
+ *
+ * @param[in] interface Interface on which the packet was received
+ * @param[in] packet Incoming IPv4 packet
+ * @param[in] length Packet length including header and payload
+ **/
+
+void ipv4ForwardPacket(NetInterface *interface, Ipv4Header *packet, size_t length)
+{
+   error_t error;
+   size_t offset;
+   uint32_t checksum;
+   Ipv4Addr nextHop;
+   MacAddr destMacAddr;
+   NetInterface *egress;
+   ChunkedBuffer *p;
+   ChunkedBuffer1 buffer;
+
+#if (NIC_LOOPBACK_SUPPORT == ENABLED)
+   //Packets sent by the local host are not forwarded
+   if(interface->nicRxLoopback)
+      return;
+#endif
+
+   //Multicast and limited broadcast packets are never forwarded, as well
+   //as packets whose source address is not valid
+   if(ipv4IsMulticastAddr(packet->destAddr) || packet->destAddr == IPV4_BROADCAST_ADDR ||
+      ipv4CheckSourceAddr(interface, packet->srcAddr))
+   {
+      //Update IP statistics
+      IPV4_MIB_INC(interface, ipInAddrErrors);
+      //Discard incoming packet
+      return;
+   }
+
+   //Verify the IP header checksum before altering the header
+   if(!(interface->nicRxChecksumFlags & NIC_RX_CHECKSUM_IP) &&
+      ipCalcChecksum(packet, packet->headerLength * 4) != 0x0000)
+   {
+      //Debug message
+      TRACE_WARNING("Wrong IP header checksum!\r\n");
+      //Update IP statistics
+      IPV4_MIB_INC(interface, ipInHdrErrors);
+      //Discard incoming packet
+      return;
+   }
+
+   //Convert the total length from network byte order
+   length = ntohs(packet->totalLength);
+
+   //The packet fits in a single chunk
+   buffer.chunkCount = 1;
+   buffer.maxChunkCount = 1;
+   buffer.chunk[0].address = packet;
+   buffer.chunk[0].length = length;
+   buffer.chunk[0].size = 0;
+   buffer.chunk[0].block = NULL;
+
+   //The TTL must be decremented before the packet is forwarded
+   if(packet->timeToLive <= 1)
+   {
+      //Notify the source that the packet has been discarded
+      icmpSendErrorMessage(interface, ICMP_TYPE_TIME_EXCEEDED,
+         ICMP_CODE_TTL_EXCEEDED, 0, (ChunkedBuffer *) &buffer);
+      //Update IP statistics
+      IPV4_MIB_INC(interface, ipInHdrErrors);
+      //Discard incoming packet
+      return;
+   }
+
+   //Select the outgoing interface and the next hop
+   egress = ipv4ForwardSelectRoute(interface, packet->destAddr, &nextHop);
+
+   //No route to the destination?
+   if(egress == NULL)
+   {
+      //Notify the source that the network is unreachable
+      icmpSendErrorMessage(interface, ICMP_TYPE_DEST_UNREACHABLE,
+         ICMP_CODE_NET_UNREACHABLE, 0, (ChunkedBuffer *) &buffer);
+      //Update IP statistics
+      IPV4_MIB_INC(interface, ipOutNoRoutes);
+      //Discard incoming packet
+      return;
+   }
+
+   //Outgoing packets are not fragmented by the forwarding path
+   if(length > egress->mtu)
+   {
+      //The source must lower the size of its packets
+      if(ntohs(packet->fragmentOffset) & IPV4_FLAG_DF)
+      {
+         icmpSendErrorMessage(interface, ICMP_TYPE_DEST_UNREACHABLE,
+            ICMP_CODE_FRAGMENTATION_NEEDED, 0, (ChunkedBuffer *) &buffer);
+      }
+
+      //Update IP statistics
+      IPV4_MIB_INC(interface, ipFragFails);
+      //Discard incoming packet
+      return;
+   }
+
+   //Decrement the TTL and update the header checksum incrementally,
+   //since the TTL is the upper byte of a 16-bit word (see RFC 1141)
+   packet->timeToLive--;
+   checksum = packet->headerChecksum + htons(0x0100);
+   packet->headerChecksum = checksum + (checksum >> 16);
+
+   //Debug message
+   TRACE_DEBUG("Forwarding IPv4 packet (%u bytes)...\r\n", length);
+
+   //Resolve the link-layer address of the next hop
+   error = arpResolve(egress, nextHop, &destMacAddr);
+
+   //Successful address resolution?
+   if(!error)
+   {
+      //Send the packet over the outgoing interface
+      error = ipForwardSendFrame(egress, &destMacAddr, (uint8_t *) packet,
+         length, ETH_TYPE_IPV4);
+   }
+   //Address resolution is in progress?
+   else if(error == ERROR_IN_PROGRESS)
+   {
+      //The receive buffer is about to be reused
+      p = ipForwardCopyPacket((uint8_t *) packet, length, &offset);
+
+      //Successful memory allocation?
+      if(p != NULL)
+      {
+         //Enqueue the packet until the address is resolved
+         error = arpEnqueuePacket(egress, nextHop, p, offset);
+         //Release our reference to the buffer
+         chunkedBufferFree(p);
+      }
+      else
+      {
+         //Memory allocation failed
+         error = ERROR_OUT_OF_MEMORY;
+      }
+   }
+
+   //Update IP statistics
+   if(!error)
+      IPV4_MIB_INC(interface, ipForwDatagrams);
+   else
+      IPV4_MIB_INC(egress, ipOutDiscards);
+}
+
+
+/**
+ * @brief Select the outgoing interface of a forwarded IPv4 packet
+ *
+ * Directly connected networks come first, then static routes, then
+ * the default gateway of the other interfaces. A packet is never sent
+ * back over the interface it was received on
+ *
+ * @param[in] interface Interface on which the packet was received
+ * @param[in] destAddr Destination IPv4 address
+ * @param[out] nextHop Next-hop IPv4 address
+ * @return Outgoing interface, or NULL if there is no route to the destination
+ **/
+
+static NetInterface *ipv4ForwardSelectRoute(NetInterface *interface,
+   Ipv4Addr destAddr, Ipv4Addr *nextHop)
+{
+   uint_t i;
+   NetInterface *egress;
+#if (IP_ROUTE_SUPPORT == ENABLED)
+   IpAddr ipAddr;
+   IpAddr routerAddr;
+#endif
+
+   //Loop through network interfaces
+   for(i = 0; i < NET_INTERFACE_COUNT; i++)
+   {
+      //Point to the current interface
+      egress = &netInterface[i];
+
+      //Skip the interfaces that do not take part in forwarding
+      if(egress == interface || !egress->ipForwarding || !egress->linkState)
+         continue;
+
+      //Destination host is in the subnet of the interface?
+      if(egress->ipv4Config.addr != IPV4_UNSPECIFIED_ADDR &&
+         ipv4IsInLocalSubnet(egress, destAddr))
+      {
+         //The next hop is the destination itself
+         *nextHop = destAddr;
+         return egress;
+      }
+   }
+
+#if (IP_ROUTE_SUPPORT == ENABLED)
+   //Copy the destination address
+   ipAddr.length = sizeof(Ipv4Addr);
+   ipAddr.ipv4Addr = destAddr;
+   //Consider the routes through any interface
+   egress = NULL;
+
+   //Use the most specific static route, if any
+   if(!ipRouteLookup(&ipAddr, &egress, &routerAddr))
+   {
+      //The route must lead to another forwarding interface
+      if(egress != interface && egress->ipForwarding)
+      {
+         //Return the next hop
+         *nextHop = routerAddr.ipv4Addr;
+         return egress;
+      }
+   }
+#endif
+
+   //Loop through network interfaces
+   for(i = 0; i < NET_INTERFACE_COUNT; i++)
+   {
+      //Point to the current interface
+      egress = &netInterface[i];
+
+      //Skip the interfaces that do not take part in forwarding
+      if(egress == interface || !egress->ipForwarding || !egress->linkState)
+         continue;
+
+      //Make sure the default gateway is properly set
+      if(egress->ipv4Config.defaultGateway != IPV4_UNSPECIFIED_ADDR)
+      {
+         //Use the default gateway to forward the packet
+         *nextHop = egress->ipv4Config.defaultGateway;
+         return egress;
+      }
+   }
+
+   //No route to the destination
+   return NULL;
+}
+
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+
+/**
+ * @brief Forward an IPv6 packet addressed to another host
+ *
+ * The packet has been received by ethProcessFrame(), hence it fits in
+ * a single chunk and the Ethernet header of the incoming frame
+ * precedes it
+ *
+ * @param[in] interface Interface on which the packet was received
+ * @param[in] buffer Multi-part buffer containing the incoming IPv6 packet
+ **/
+
+void ipv6ForwardPacket(NetInterface *interface, ChunkedBuffer *buffer)
+{
+   error_t error;
+   size_t offset;
+   size_t length;
+   Ipv6Addr nextHop;
+   MacAddr destMacAddr;
+   Ipv6Header *packet;
+   NetInterface *egress;
+   ChunkedBuffer *p;
+
+#if (NIC_LOOPBACK_SUPPORT == ENABLED)
+   //Packets sent by the local host are not forwarded
+   if(interface->nicRxLoopback)
+      return;
+#endif
+
+   //The packet must be contiguous in order to be altered in place
+   if(buffer->chunkCount != 1)
+   {
+      //Update IP statistics
+      IPV6_MIB_INC(interface, ipInAddrErrors);
+      //Discard incoming packet
+      return;
+   }
+
+   //Point to the IPv6 header
+   packet = chunkedBufferAt(buffer, 0);
+   //Sanity check
+   if(!packet) return;
+
+   //Multicast packets are never forwarded. Link-local addresses are
+   //only meaningful on the link they belong to (see RFC 4291 2.5.6)
+   if(ipv6IsMulticastAddr(&packet->destAddr) ||
+      ipv6IsLinkLocalUnicastAddr(&packet->destAddr) ||
+      ipv6IsLinkLocalUnicastAddr(&packet->srcAddr) ||
+      ipv6CheckSourceAddr(interface, &packet->srcAddr))
+   {
+      //Update IP statistics
+      IPV6_MIB_INC(interface, ipInAddrErrors);
+      //Discard incoming packet
+      return;
+   }
+
+   //Calculate the effective length of the IPv6 packet
+   length = sizeof(Ipv6Header) + ntohs(packet->payloadLength);
+   //Strip the padding of the Ethernet frame
+   chunkedBufferSetLength(buffer, length);
+
+   //The hop limit must be decremented before the packet is forwarded
+   if(packet->hopLimit <= 1)
+   {
+      //Notify the source that the packet has been discarded
+      icmpv6SendErrorMessage(interface, ICMPV6_TYPE_TIME_EXCEEDED,
+         ICMPV6_CODE_HOP_LIMIT_EXCEEDED, 0, buffer);
+      //Update IP statistics
+      IPV6_MIB_INC(interface, ipInHdrErrors);
+      //Discard incoming packet
+      return;
+   }
+
+   //Select the outgoing interface and the next hop
+   egress = ipv6ForwardSelectRoute(interface, &packet->destAddr, &nextHop);
+
+   //No route to the destination?
+   if(egress == NULL)
+   {
+      //Notify the source that there is no route to the destination
+      icmpv6SendErrorMessage(interface, ICMPV6_TYPE_DEST_UNREACHABLE,
+         ICMPV6_CODE_NO_ROUTE_TO_DEST, 0, buffer);
+      //Update IP statistics
+      IPV6_MIB_INC(interface, ipOutNoRoutes);
+      //Discard incoming packet
+      return;
+   }
+
+   //Routers never fragment IPv6 packets (see RFC 8200 section 5)
+   if(length > egress->mtu)
+   {
+      //Report the MTU of the next link to the source
+      icmpv6SendErrorMessage(interface, ICMPV6_TYPE_PACKET_TOO_BIG,
+         0, egress->mtu, buffer);
+      //Update IP statistics
+      IPV6_MIB_INC(interface, ipFragFails);
+      //Discard incoming packet
+      return;
+   }
+
+   //IPv6 has no header checksum to update
+   packet->hopLimit--;
+
+   //Debug message
+   TRACE_DEBUG("Forwarding IPv6 packet (%u bytes)...\r\n", length);
+
+   //Resolve the link-layer address of the next hop
+   error = ndpResolve(egress, &nextHop, &destMacAddr);
+
+   //Successful address resolution?
+   if(!error)
+   {
+      //Send the packet over the outgoing interface
+      error = ipForwardSendFrame(egress, &destMacAddr, (uint8_t *) packet,
+         length, ETH_TYPE_IPV6);
+   }
+   //Address resolution is in progress?
+   else if(error == ERROR_IN_PROGRESS)
+   {
+      //The receive buffer is about to be reused
+      p = ipForwardCopyPacket((uint8_t *) packet, length, &offset);
+
+      //Successful memory allocation?
+      if(p != NULL)
+      {
+         //Enqueue the packet until the address is resolved
+         error = ndpEnqueuePacket(egress, &nextHop, p, offset);
+         //Release our reference to the buffer
+         chunkedBufferFree(p);
+      }
+      else
+      {
+         //Memory allocation failed
+         error = ERROR_OUT_OF_MEMORY;
+      }
+   }
+
+   //Update IP statistics
+   if(!error)
+      IPV6_MIB_INC(interface, ipForwDatagrams);
+   else
+      IPV6_MIB_INC(egress, ipOutDiscards);
+}
+
+
+/**
+ * @brief Select the outgoing interface of a forwarded IPv6 packet
+ *
+ * On-link prefixes come first, then static routes, then the default
+ * router of the other interfaces. A packet is never sent back over the
+ * interface it was received on
+ *
+ * @param[in] interface Interface on which the packet was received
+ * @param[in] destAddr Destination IPv6 address
+ * @param[out] nextHop Next-hop IPv6 address
+ * @return Outgoing interface, or NULL if there is no route to the destination
+ **/
+
+static NetInterface *ipv6ForwardSelectRoute(NetInterface *interface,
+   const Ipv6Addr *destAddr, Ipv6Addr *nextHop)
+{
+   uint_t i;
+   NetInterface *egress;
+#if (IP_ROUTE_SUPPORT == ENABLED)
+   IpAddr ipAddr;
+   IpAddr routerAddr;
+#endif
+
+   //Loop through network interfaces
+   for(i = 0; i < NET_INTERFACE_COUNT; i++)
+   {
+      //Point to the current interface
+      egress = &netInterface[i];
+
+      //Skip the interfaces that do not take part in forwarding
+      if(egress == interface || !egress->ipForwarding || !egress->linkState)
+         continue;
+
+      //Destination host matches the on-link prefix of the interface?
+      if(egress->ipv6Config.prefixLength > 0 && ipv6CompPrefix(destAddr,
+         &egress->ipv6Config.prefix, egress->ipv6Config.prefixLength))
+      {
+         //The next hop is the destination itself
+         *nextHop = *destAddr;
+         return egress;
+      }
+   }
+
+#if (IP_ROUTE_SUPPORT == ENABLED)
+   //Copy the destination address
+   ipAddr.length = sizeof(Ipv6Addr);
+   ipAddr.ipv6Addr = *destAddr;
+   //Consider the routes through any interface
+   egress = NULL;
+
+   //Use the most specific static route, if any
+   if(!ipRouteLookup(&ipAddr, &egress, &routerAddr))
+   {
+      //The route must lead to another forwarding interface
+      if(egress != interface && egress->ipForwarding)
+      {
+         //Return the next hop
+         *nextHop = routerAddr.ipv6Addr;
+         return egress;
+      }
+   }
+#endif
+
+   //Loop through network interfaces
+   for(i = 0; i < NET_INTERFACE_COUNT; i++)
+   {
+      //Point to the current interface
+      egress = &netInterface[i];
+
+      //Skip the interfaces that do not take part in forwarding
+      if(egress == interface || !egress->ipForwarding || !egress->linkState)
+         continue;
+
+      //Make sure the default router is properly set
+      if(!ipv6CompAddr(&egress->ipv6Config.router, &IPV6_UNSPECIFIED_ADDR))
+      {
+         //Use the default router to forward the packet
+         *nextHop = egress->ipv6Config.router;
+         return egress;
+      }
+   }
+
+   //No route to the destination
+   return NULL;
+}
+
+#endif
+
+
+/**
+ * @brief Send a forwarded packet over the outgoing interface
+ * @param[in] interface Outgoing interface
+ * @param[in] destAddr MAC address of the next hop
+ * @param[in] packet IP packet, preceded by the Ethernet header of the incoming frame
+ * @param[in] length Length of the IP packet
+ * @param[in] type Ethernet type
+ * @return Error code
+ **/
+
+static error_t ipForwardSendFrame(NetInterface *interface, const MacAddr *destAddr,
+   uint8_t *packet, size_t length, uint16_t type)
+{
+#if (IP_FORWARD_ZERO_COPY_SUPPORT == ENABLED)
+   IpForwardBuffer buffer;
+
+   //The outgoing Ethernet header overwrites the incoming one
+   buffer.chunkCount = 1;
+   buffer.maxChunkCount = arraysize(buffer.chunk);
+   buffer.chunk[0].address = packet - sizeof(EthHeader);
+   buffer.chunk[0].length = sizeof(EthHeader) + length;
+   buffer.chunk[0].size = 0;
+   buffer.chunk[0].block = NULL;
+
+   //Hand the frame over to the driver without copying it
+   return ethSendFrame(interface, destAddr,
+      (ChunkedBuffer *) &buffer, sizeof(EthHeader), type);
+#else
+   error_t error;
+   size_t offset;
+   ChunkedBuffer *p;
+
+   //Copy the packet to a new buffer
+   p = ipForwardCopyPacket(packet, length, &offset);
+   //Failed to allocate memory?
+   if(!p) return ERROR_OUT_OF_MEMORY;
+
+   //Send Ethernet frame
+   error = ethSendFrame(interface, destAddr, p, offset, type);
+   //Free previously allocated memory
+   chunkedBufferFree(p);
+
+   //Return status code
+   return error;
+#endif
+}
+
+
+/**
+ * @brief Copy a forwarded packet to a new buffer
+ * @param[in] packet IP packet
+ * @param[in] length Length of the IP packet
+ * @param[out] offset Offset to the first byte of the IP packet
+ * @return Pointer to the newly allocated buffer, or NULL if there is
+ *   insufficient memory available
+ **/
+
+static ChunkedBuffer *ipForwardCopyPacket(const uint8_t *packet, size_t length, size_t *offset)
+{
+   ChunkedBuffer *buffer;
+
+   //Leave room for the Ethernet header
+   buffer = ethAllocBuffer(length, offset);
+
+   //Copy the IP packet
+   if(buffer != NULL)
+      chunkedBufferWrite(buffer, *offset, packet, length);
+
+   //Return a pointer to the newly allocated buffer
+   return buffer;
+}
+
+#endif
@@ -0,0 +1,78 @@
+/**
+ * @file ip_forward.h
+ * @brief IPv4 and IPv6 forwarding
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _IP_FORWARD_H
+#define _IP_FORWARD_H
+
+//Dependencies
+#include "tcp_ip_stack.h"
+
+//IP forwarding support
+#ifndef IP_FORWARD_SUPPORT
+   #define IP_FORWARD_SUPPORT DISABLED
+#elif (IP_FORWARD_SUPPORT != ENABLED && IP_FORWARD_SUPPORT != DISABLED)
+   #error IP_FORWARD_SUPPORT parameter is invalid
+#endif
+
+//Forward packets straight from the receive buffer
+#ifndef IP_FORWARD_ZERO_COPY_SUPPORT
+   #define IP_FORWARD_ZERO_COPY_SUPPORT ENABLED
+#elif (IP_FORWARD_ZERO_COPY_SUPPORT != ENABLED && IP_FORWARD_ZERO_COPY_SUPPORT != DISABLED)
+   #error IP_FORWARD_ZERO_COPY_SUPPORT parameter is invalid
+#endif
+
+
+/**
+ * @brief Frame forwarded straight from the receive buffer
+ *
+ * The first chunk covers the Ethernet header of the incoming frame and
+ * the IP packet. The other chunks leave room for the padding and the
+ * CRC that ethSendFrame() may append
+ *
+ **/
+
+typedef struct
+{
+   uint_t chunkCount;
+   uint_t maxChunkCount;
+   ChunkDesc chunk[3];
+} IpForwardBuffer;
+
+
+//IP forwarding related functions
+error_t ipForwardEnable(NetInterface *interface, bool_t enable);
+
+#if (IPV4_SUPPORT == ENABLED)
+void ipv4ForwardPacket(NetInterface *interface, Ipv4Header *packet, size_t length);
+#endif
+
+#if (IPV6_SUPPORT == ENABLED)
+void ipv6ForwardPacket(NetInterface *interface, ChunkedBuffer *buffer);
+#endif
+
+#endif
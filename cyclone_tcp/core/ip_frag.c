@@ -0,0 +1,749 @@
+/**
+ * @file ip_frag.c
+ * @brief IP fragment reassembly
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * IPv4 and IPv6 datagrams are reassembled by the same engine, so that both
+ * versions share one reassembly queue, one memory budget and one timer per
+ * interface. Each version only parses its own header and builds the final
+ * datagram. Refer to the following RFCs for complete details:
+ * - RFC 791: Internet Protocol specification
+ * - RFC 815: IP datagram reassembly algorithms
+ * - RFC 2460: Internet Protocol, Version 6 (IPv6) Specification
+ *
+ * Received fragments are copied once into reference-counted blocks that
+ * are linked, in offset order, into the reassembly buffer. The sorted list
+ * of chunks records which parts of the payload have been received, and
+ * the complete datagram is handed to the upper layer as a chain of those
+ * blocks. The memory held by the reassembly queue is capped by
+ * IP_MAX_FRAG_MEM_SIZE, the oldest datagrams being evicted first
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL IP_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "ip.h"
+#include "ip_frag.h"
+#include "icmp.h"
+#include "icmpv6.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (IP_FRAG_SUPPORT == ENABLED)
+
+//IP fragment reassembly related local functions
+static bool_t ipFragCompAddr(const IpAddr *ipAddr1, const IpAddr *ipAddr2);
+
+
+/**
+ * @brief Reassembly queue initialization
+ * @param[in] interface Underlying network interface
+ * @return Error code
+ **/
+
+error_t ipFragInit(NetInterface *interface)
+{
+   //Create a mutex to prevent simultaneous access to the reassembly queue
+   interface->ipFragQueueMutex = osMutexCreateNamed(FALSE, "IpFragQueue");
+   //Any error to report?
+   if(interface->ipFragQueueMutex == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Clear the reassembly queue
+   memset(interface->ipFragQueue, 0, sizeof(interface->ipFragQueue));
+   memset(interface->ipFragHashTable, 0, sizeof(interface->ipFragHashTable));
+   interface->ipFragMemSize = 0;
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Fragment reassembly timeout handler
+ *
+ * This routine must be periodically called by the TCP/IP stack to
+ * handle IPv4 and IPv6 fragment reassembly timeout
+ *
+ * @param[in] interface Underlying network interface
+ **/
+
+void ipFragTick(NetInterface *interface)
+{
+   error_t error;
+   uint_t i;
+   uint_t j;
+   time_t time;
+   time_t timeToLive;
+   size_t length;
+   IpFragDesc *frag;
+
+   //Acquire exclusive access to the reassembly queue
+   osMutexAcquire(interface->ipFragQueueMutex);
+
+   //Get current time
+   time = osGetTickCount();
+
+   //Loop through the reassembly queue
+   for(i = 0; i < IP_MAX_FRAG_DATAGRAMS; i++)
+   {
+      //Point to the current entry in the reassembly queue
+      frag = &interface->ipFragQueue[i];
+
+      //Make sure the entry is currently in use
+      if(!frag->buffer.chunkCount)
+         continue;
+
+      //Each IP version has its own reassembly timeout
+      timeToLive = (frag->srcAddr.length == sizeof(Ipv4Addr)) ?
+         IPV4_FRAG_TIME_TO_LIVE : IPV6_FRAG_TIME_TO_LIVE;
+
+      //If the timer runs out, the partially-reassembled datagram must be
+      //discarded and ICMP Time Exceeded message sent to the source host
+      if((time - frag->timestamp) < timeToLive)
+         continue;
+
+      //Debug message
+      TRACE_INFO("IP fragment reassembly timeout...\r\n");
+
+      //Update IP statistics
+      if(frag->srcAddr.length == sizeof(Ipv4Addr))
+         IPV4_MIB_INC(interface, ipReasmFails);
+      else
+         IPV6_MIB_INC(interface, ipReasmFails);
+
+      //Make sure the fragment zero has been received
+      //before sending an ICMP message
+      if(frag->headerLength != 0 && frag->buffer.chunkCount > 1 && frag->offset[1] == 0)
+      {
+         //Retrieve the length of the data received contiguously
+         for(length = 0, j = 1; j < frag->buffer.chunkCount &&
+            frag->offset[j] == length; j++)
+         {
+            length += frag->buffer.chunk[j].length;
+         }
+
+         //Fix the size of the reconstructed datagram
+         error = chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer,
+            frag->headerLength + length);
+
+         //Check status code
+         if(!error)
+         {
+#if (IPV4_SUPPORT == ENABLED && IPV4_FRAG_SUPPORT == ENABLED)
+            //IPv4 datagram?
+            if(frag->srcAddr.length == sizeof(Ipv4Addr))
+            {
+               //Dump IP header contents for debugging purpose
+               ipv4DumpHeader(frag->buffer.chunk[0].address);
+
+               //Send an ICMP Time Exceeded message
+               icmpSendErrorMessage(interface, ICMP_TYPE_TIME_EXCEEDED,
+                  ICMP_CODE_REASSEMBLY_TIME_EXCEEDED, 0, (ChunkedBuffer *) &frag->buffer);
+            }
+#endif
+#if (IPV6_SUPPORT == ENABLED && IPV6_FRAG_SUPPORT == ENABLED)
+            //IPv6 datagram?
+            if(frag->srcAddr.length == sizeof(Ipv6Addr))
+            {
+               //Dump IP header contents for debugging purpose
+               ipv6DumpHeader(frag->buffer.chunk[0].address);
+
+               //Send an ICMPv6 Time Exceeded message
+               icmpv6SendErrorMessage(interface, ICMPV6_TYPE_TIME_EXCEEDED,
+                  ICMPV6_CODE_REASSEMBLY_TIME_EXCEEDED, 0, (ChunkedBuffer *) &frag->buffer);
+            }
+#endif
+         }
+      }
+
+      //Drop the partially reconstructed datagram
+      ipDeleteFragDesc(interface, frag);
+   }
+
+   //Release exclusive access to the reassembly queue
+   osMutexRelease(interface->ipFragQueueMutex);
+}
+
+
+/**
+ * @brief Search for a matching datagram in the reassembly queue
+ *
+ * Datagrams are located through a hash table. When the queue is full,
+ * the oldest datagram is evicted to make room for the new one
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] srcAddr Source address
+ * @param[in] destAddr Destination address
+ * @param[in] identification Identification field
+ * @param[in] protocol Protocol field (IPv4 only)
+ * @return Matching fragment descriptor
+ **/
+
+IpFragDesc *ipSearchFragQueue(NetInterface *interface, const IpAddr *srcAddr,
+   const IpAddr *destAddr, uint32_t identification, uint8_t protocol)
+{
+   uint_t i;
+   uint_t h;
+   IpFragDesc *frag;
+
+   //Point to the hash bucket the datagram maps to
+   h = ipFragHash(srcAddr, destAddr, identification, protocol);
+
+   //Search for a matching IP datagram being reassembled
+   for(frag = interface->ipFragHashTable[h]; frag != NULL; frag = frag->hashNext)
+   {
+      //Check source and destination addresses
+      if(!ipFragCompAddr(&frag->srcAddr, srcAddr))
+         continue;
+      if(!ipFragCompAddr(&frag->destAddr, destAddr))
+         continue;
+      //Compare identification and protocol fields
+      if(frag->identification != identification)
+         continue;
+      if(frag->protocol != protocol)
+         continue;
+
+      //A matching entry has been found in the reassembly queue
+      return frag;
+   }
+
+   //If the current packet does not match an existing entry
+   //in the reassembly queue, then create a new entry
+   for(i = 0; i < IP_MAX_FRAG_DATAGRAMS; i++)
+   {
+      //The current entry is free?
+      if(!interface->ipFragQueue[i].buffer.chunkCount)
+         break;
+   }
+
+   //The reassembly queue is full?
+   if(i >= IP_MAX_FRAG_DATAGRAMS)
+   {
+      //Drop the oldest datagram rather than the new one
+      if(!ipEvictFragDesc(interface, NULL))
+         return NULL;
+
+      //Look for the entry that has just been released
+      for(i = 0; i < IP_MAX_FRAG_DATAGRAMS; i++)
+      {
+         if(!interface->ipFragQueue[i].buffer.chunkCount)
+            break;
+      }
+   }
+
+   //Point to the free entry
+   frag = &interface->ipFragQueue[i];
+
+   //Save the fields that identify the datagram
+   frag->srcAddr = *srcAddr;
+   frag->destAddr = *destAddr;
+   frag->identification = identification;
+   frag->protocol = protocol;
+
+   //Nothing has been received yet
+   frag->headerLength = 0;
+   frag->dataLength = 0;
+   frag->receivedLength = 0;
+   frag->memSize = 0;
+
+   //The first chunk is reserved for the IP header
+   frag->buffer.maxChunkCount = arraysize(frag->buffer.chunk);
+   frag->buffer.chunkCount = 1;
+   frag->buffer.chunk[0].address = NULL;
+   frag->buffer.chunk[0].length = 0;
+   frag->buffer.chunk[0].size = 0;
+   frag->buffer.chunk[0].block = NULL;
+   frag->offset[0] = 0;
+
+   //Save current time
+   frag->timestamp = osGetTickCount();
+
+   //Insert the entry in the hash table
+   frag->hashNext = interface->ipFragHashTable[h];
+   interface->ipFragHashTable[h] = frag;
+
+   //Return the matching fragment descriptor
+   return frag;
+}
+
+
+/**
+ * @brief Flush the reassembly queue
+ * @param[in] interface Underlying network interface
+ **/
+
+void ipFlushFragQueue(NetInterface *interface)
+{
+   uint_t i;
+
+   //Acquire exclusive access to the reassembly queue
+   osMutexAcquire(interface->ipFragQueueMutex);
+
+   //Loop through the reassembly queue
+   for(i = 0; i < IP_MAX_FRAG_DATAGRAMS; i++)
+   {
+      //Drop any partially reconstructed datagram
+      if(interface->ipFragQueue[i].buffer.chunkCount > 0)
+         ipDeleteFragDesc(interface, &interface->ipFragQueue[i]);
+   }
+
+   //Release exclusive access to the reassembly queue
+   osMutexRelease(interface->ipFragQueueMutex);
+}
+
+
+/**
+ * @brief Save the header of the first fragment
+ *
+ * The header (IPv4 header or unfragmentable part of an IPv6 packet) is
+ * copied into the first chunk of the reassembly buffer
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] frag Fragment descriptor
+ * @param[in] buffer Multi-part buffer containing the first fragment
+ * @param[in] length Length of the header
+ * @return Error code
+ **/
+
+error_t ipInsertFragHeader(NetInterface *interface, IpFragDesc *frag,
+   const ChunkedBuffer *buffer, size_t length)
+{
+   ChunkDesc *chunk;
+
+   //The header must fit in a single block
+   if(length == 0 || length > CHUNK_BLOCK_DATA_SIZE)
+      return ERROR_INVALID_LENGTH;
+
+   //Point to the chunk that holds the header
+   chunk = &frag->buffer.chunk[0];
+
+   //Make room for the header, evicting older datagrams if necessary
+   while((interface->ipFragMemSize + MEM_POOL_BUFFER_SIZE) > IP_MAX_FRAG_MEM_SIZE)
+   {
+      //No other datagram to evict?
+      if(!ipEvictFragDesc(interface, frag))
+         return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Allocate a block for the header
+   chunk->block = chunkBlockAlloc();
+   //Failed to allocate memory?
+   if(chunk->block == NULL)
+      return ERROR_OUT_OF_MEMORY;
+
+   //Always take the header from the first fragment
+   chunk->address = chunk->block + 1;
+   chunk->length = length;
+   chunk->size = 0;
+   chunkedBufferRead(chunk->address, buffer, 0, length);
+
+   //Update memory usage
+   frag->memSize += MEM_POOL_BUFFER_SIZE;
+   interface->ipFragMemSize += MEM_POOL_BUFFER_SIZE;
+   //Save the length of the header
+   frag->headerLength = length;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Add the payload of a fragment to a datagram being reassembled
+ *
+ * The data is copied once out of the receive buffer into reference-counted
+ * blocks, which are then linked in the reassembly buffer at the right
+ * position. Data that has already been received is ignored, and fragments
+ * entirely covered by the new one are replaced
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] frag Fragment descriptor
+ * @param[in] dataFirst Offset of the first byte of the fragment
+ * @param[in] dataLast Offset immediately following the last byte
+ * @param[in] lastFragment The fragment is the last one of the datagram
+ * @param[in] buffer Multi-part buffer containing the fragment
+ * @param[in] offset Offset to the payload of the fragment
+ * @return Error code
+ **/
+
+error_t ipInsertFragment(NetInterface *interface, IpFragDesc *frag, size_t dataFirst,
+   size_t dataLast, bool_t lastFragment, const ChunkedBuffer *buffer, size_t offset)
+{
+   uint_t i;
+   uint_t j;
+   uint_t k;
+   size_t n;
+   size_t start;
+   ChunkDesc *chunk;
+   IpReassemblyBuffer *reassemblyBuffer;
+
+   //Point to the reassembly buffer
+   reassemblyBuffer = &frag->buffer;
+   //Offset of the first byte of the fragment data
+   start = dataFirst;
+
+   //The last fragment determines the length of the datagram
+   if(lastFragment)
+   {
+      //Inconsistent length, or data already received beyond the end?
+      if(frag->dataLength != 0 && frag->dataLength != dataLast)
+         return ERROR_INVALID_LENGTH;
+      if(reassemblyBuffer->chunkCount > 1 && dataLast <
+         (frag->offset[reassemblyBuffer->chunkCount - 1] +
+         reassemblyBuffer->chunk[reassemblyBuffer->chunkCount - 1].length))
+      {
+         return ERROR_INVALID_LENGTH;
+      }
+
+      //Actual length of the payload
+      frag->dataLength = dataLast;
+   }
+   //The fragment lies beyond the end of the datagram?
+   else if(frag->dataLength != 0 && dataLast > frag->dataLength)
+   {
+      //Report an error
+      return ERROR_INVALID_LENGTH;
+   }
+
+   //Skip the chunks that end before the fragment
+   for(i = 1; i < reassemblyBuffer->chunkCount &&
+      (frag->offset[i] + reassemblyBuffer->chunk[i].length) <= dataFirst; i++);
+
+   //The beginning of the fragment has already been received?
+   if(i < reassemblyBuffer->chunkCount && frag->offset[i] <= dataFirst)
+   {
+      //Ignore the overlapping part
+      dataFirst = frag->offset[i] + reassemblyBuffer->chunk[i].length;
+      i++;
+   }
+
+   //Remove the chunks that the fragment entirely covers
+   while(i < reassemblyBuffer->chunkCount &&
+      (frag->offset[i] + reassemblyBuffer->chunk[i].length) <= dataLast)
+   {
+      //Drop the reference to the underlying block
+      chunkBlockRelease(reassemblyBuffer->chunk[i].block);
+
+      //Update statistics
+      frag->receivedLength -= reassemblyBuffer->chunk[i].length;
+      frag->memSize -= MEM_POOL_BUFFER_SIZE;
+      interface->ipFragMemSize -= MEM_POOL_BUFFER_SIZE;
+
+      //Remove the chunk from the list
+      for(j = i + 1; j < reassemblyBuffer->chunkCount; j++)
+      {
+         reassemblyBuffer->chunk[j - 1] = reassemblyBuffer->chunk[j];
+         frag->offset[j - 1] = frag->offset[j];
+      }
+
+      //Update the number of chunks
+      reassemblyBuffer->chunkCount--;
+   }
+
+   //The end of the fragment has already been received?
+   if(i < reassemblyBuffer->chunkCount && frag->offset[i] < dataLast)
+      dataLast = frag->offset[i];
+
+   //Duplicate fragment?
+   if(dataFirst >= dataLast)
+      return NO_ERROR;
+
+   //Number of chunks needed to hold the new data
+   k = (dataLast - dataFirst + CHUNK_BLOCK_DATA_SIZE - 1) / CHUNK_BLOCK_DATA_SIZE;
+
+   //Too many chunks?
+   if((reassemblyBuffer->chunkCount + k) > reassemblyBuffer->maxChunkCount)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Enforce the memory budget by evicting older datagrams
+   while((interface->ipFragMemSize + k * MEM_POOL_BUFFER_SIZE) > IP_MAX_FRAG_MEM_SIZE)
+   {
+      //No other datagram to evict?
+      if(!ipEvictFragDesc(interface, frag))
+         return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Make room for the new chunks
+   for(j = reassemblyBuffer->chunkCount; j > i; j--)
+   {
+      reassemblyBuffer->chunk[j + k - 1] = reassemblyBuffer->chunk[j - 1];
+      frag->offset[j + k - 1] = frag->offset[j - 1];
+   }
+
+   //Update the number of chunks
+   reassemblyBuffer->chunkCount += k;
+
+   //Copy the data that has not been received yet
+   for(j = i; j < (i + k); j++)
+   {
+      //Point to the current chunk
+      chunk = &reassemblyBuffer->chunk[j];
+      //Number of bytes held by the chunk
+      n = min(dataLast - dataFirst, CHUNK_BLOCK_DATA_SIZE);
+
+      //Allocate a new block
+      chunk->block = chunkBlockAlloc();
+
+      //Failed to allocate memory?
+      if(chunk->block == NULL)
+      {
+         //Mark the remaining chunks as empty, so that the
+         //descriptor can be safely released
+         for(; j < (i + k); j++)
+         {
+            reassemblyBuffer->chunk[j].address = NULL;
+            reassemblyBuffer->chunk[j].length = 0;
+            reassemblyBuffer->chunk[j].size = 0;
+            reassemblyBuffer->chunk[j].block = NULL;
+            frag->offset[j] = dataFirst;
+         }
+
+         //Report an error
+         return ERROR_OUT_OF_MEMORY;
+      }
+
+      //Copy the fragment data
+      chunk->address = chunk->block + 1;
+      chunk->length = n;
+      chunk->size = 0;
+      chunkedBufferRead(chunk->address, buffer, offset + (dataFirst - start), n);
+      frag->offset[j] = dataFirst;
+
+      //Update statistics
+      frag->receivedLength += n;
+      frag->memSize += MEM_POOL_BUFFER_SIZE;
+      interface->ipFragMemSize += MEM_POOL_BUFFER_SIZE;
+
+      //Next chunk
+      dataFirst += n;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Check whether a datagram has been entirely received
+ * @param[in] frag Fragment descriptor
+ * @return TRUE if the header and all the payload have been received
+ **/
+
+bool_t ipIsFragComplete(const IpFragDesc *frag)
+{
+   //The reassembly process is complete once all the payload has been received
+   return (frag->headerLength != 0 && frag->dataLength != 0 &&
+      frag->receivedLength == frag->dataLength);
+}
+
+
+/**
+ * @brief Release a fragment descriptor
+ * @param[in] interface Underlying network interface
+ * @param[in] frag Fragment descriptor
+ **/
+
+void ipDeleteFragDesc(NetInterface *interface, IpFragDesc *frag)
+{
+   IpFragDesc **p;
+
+   //Look for the link pointing to the descriptor
+   for(p = &interface->ipFragHashTable[ipFragHash(&frag->srcAddr, &frag->destAddr,
+      frag->identification, frag->protocol)]; *p != NULL; p = &(*p)->hashNext)
+   {
+      //Unlink the descriptor
+      if(*p == frag)
+      {
+         *p = frag->hashNext;
+         break;
+      }
+   }
+
+   //Update memory usage
+   interface->ipFragMemSize -= frag->memSize;
+
+   //Drop any partially reconstructed datagram
+   chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
+
+   //The descriptor is now free
+   frag->hashNext = NULL;
+   frag->buffer.chunkCount = 0;
+   frag->memSize = 0;
+}
+
+
+/**
+ * @brief Drop the oldest datagram being reassembled
+ *
+ * IPv4 and IPv6 datagrams compete for the same queue and memory budget,
+ * so the oldest one is selected regardless of its IP version
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] frag Descriptor that must not be evicted (may be NULL)
+ * @return TRUE if a datagram has been dropped, else FALSE
+ **/
+
+bool_t ipEvictFragDesc(NetInterface *interface, const IpFragDesc *frag)
+{
+   uint_t i;
+   IpFragDesc *entry;
+   IpFragDesc *oldest;
+
+   //Keep track of the oldest datagram
+   oldest = NULL;
+
+   //Loop through the reassembly queue
+   for(i = 0; i < IP_MAX_FRAG_DATAGRAMS; i++)
+   {
+      //Point to the current entry
+      entry = &interface->ipFragQueue[i];
+
+      //Skip free entries and the datagram being processed
+      if(!entry->buffer.chunkCount || entry == frag)
+         continue;
+
+      //Compare timestamps
+      if(oldest == NULL || timeCompare(entry->timestamp, oldest->timestamp) < 0)
+         oldest = entry;
+   }
+
+   //No datagram can be evicted?
+   if(oldest == NULL)
+      return FALSE;
+
+   //Debug message
+   TRACE_INFO("Evicting datagram from the reassembly queue...\r\n");
+
+   //Drop the datagram
+   ipDeleteFragDesc(interface, oldest);
+   //A datagram has been dropped
+   return TRUE;
+}
+
+
+/**
+ * @brief Compute the hash bucket of a datagram being reassembled
+ * @param[in] srcAddr Source address
+ * @param[in] destAddr Destination address
+ * @param[in] identification Identification field
+ * @param[in] protocol Protocol field
+ * @return Index of the hash bucket
+ **/
+
+uint_t ipFragHash(const IpAddr *srcAddr, const IpAddr *destAddr,
+   uint32_t identification, uint8_t protocol)
+{
+   uint32_t h;
+
+   //The identification field carries most of the entropy
+   h = identification ^ protocol;
+
+#if (IPV4_SUPPORT == ENABLED)
+   //IPv4 addresses?
+   if(srcAddr->length == sizeof(Ipv4Addr))
+   {
+      h ^= srcAddr->ipv4Addr ^ destAddr->ipv4Addr;
+   }
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 addresses?
+   if(srcAddr->length == sizeof(Ipv6Addr))
+   {
+      h ^= srcAddr->ipv6Addr.dw[0] ^ srcAddr->ipv6Addr.dw[1] ^
+         srcAddr->ipv6Addr.dw[2] ^ srcAddr->ipv6Addr.dw[3];
+      h ^= destAddr->ipv6Addr.dw[0] ^ destAddr->ipv6Addr.dw[1] ^
+         destAddr->ipv6Addr.dw[2] ^ destAddr->ipv6Addr.dw[3];
+   }
+#endif
+
+   //Fold the value
+   h ^= h >> 16;
+   h ^= h >> 8;
+
+   //Return the index of the hash bucket
+   return h & (IP_FRAG_HASH_TABLE_SIZE - 1);
+}
+
+
+/**
+ * @brief Compare IP addresses
+ * @param[in] ipAddr1 First IP address
+ * @param[in] ipAddr2 Second IP address
+ * @return TRUE if the addresses are identical, else FALSE
+ **/
+
+static bool_t ipFragCompAddr(const IpAddr *ipAddr1, const IpAddr *ipAddr2)
+{
+   //The addresses must belong to the same family
+   if(ipAddr1->length != ipAddr2->length)
+      return FALSE;
+
+#if (IPV4_SUPPORT == ENABLED)
+   //IPv4 addresses?
+   if(ipAddr1->length == sizeof(Ipv4Addr))
+      return (ipAddr1->ipv4Addr == ipAddr2->ipv4Addr);
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 addresses?
+   if(ipAddr1->length == sizeof(Ipv6Addr))
+      return ipv6CompAddr(&ipAddr1->ipv6Addr, &ipAddr2->ipv6Addr);
+#endif
+
+   //Unknown address family
+   return FALSE;
+}
+
+
+/**
+ * @brief Dump the list of received fragments
+ * @param[in] frag Fragment descriptor
+ **/
+
+void ipDumpFragList(const IpFragDesc *frag)
+{
+//Check debugging level
+#if (TRACE_LEVEL >= TRACE_LEVEL_DEBUG)
+   uint_t i;
+
+   //Debug message
+   TRACE_DEBUG("Received data:\r\n");
+
+   //Loop through the chunks that hold the payload
+   for(i = 1; i < frag->buffer.chunkCount; i++)
+   {
+      //Display current chunk
+      TRACE_DEBUG("  %u - %u\r\n", frag->offset[i],
+         frag->offset[i] + frag->buffer.chunk[i].length);
+   }
+#endif
+}
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * @file ip_frag.h
+ * @brief IP fragment reassembly
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _IP_FRAG_H
+#define _IP_FRAG_H
+
+//Dependencies
+#include "tcp_ip_stack.h"
+#include "ip.h"
+#include "ipv4_frag.h"
+#include "ipv6_frag.h"
+
+//Datagram reassembly is required as soon as one IP version supports it
+#if ((IPV4_SUPPORT == ENABLED && IPV4_FRAG_SUPPORT == ENABLED) || \
+   (IPV6_SUPPORT == ENABLED && IPV6_FRAG_SUPPORT == ENABLED))
+   #define IP_FRAG_SUPPORT ENABLED
+#else
+   #define IP_FRAG_SUPPORT DISABLED
+#endif
+
+//Reassembly algorithm tick interval
+#ifndef IP_FRAG_TICK_INTERVAL
+   #define IP_FRAG_TICK_INTERVAL 1000
+#elif (IP_FRAG_TICK_INTERVAL < 100)
+   #error IP_FRAG_TICK_INTERVAL parameter is invalid
+#endif
+
+//Number of datagrams the reassembly queue can hold (IPv4 and IPv6
+//datagrams share the queue)
+#ifndef IP_MAX_FRAG_DATAGRAMS
+   #if (IPV4_SUPPORT == ENABLED && IPV4_FRAG_SUPPORT == ENABLED && \
+      IPV6_SUPPORT == ENABLED && IPV6_FRAG_SUPPORT == ENABLED)
+      #define IP_MAX_FRAG_DATAGRAMS (IPV4_MAX_FRAG_DATAGRAMS + IPV6_MAX_FRAG_DATAGRAMS)
+   #elif (IPV4_SUPPORT == ENABLED && IPV4_FRAG_SUPPORT == ENABLED)
+      #define IP_MAX_FRAG_DATAGRAMS IPV4_MAX_FRAG_DATAGRAMS
+   #else
+      #define IP_MAX_FRAG_DATAGRAMS IPV6_MAX_FRAG_DATAGRAMS
+   #endif
+#elif (IP_MAX_FRAG_DATAGRAMS < 1)
+   #error IP_MAX_FRAG_DATAGRAMS parameter is invalid
+#endif
+
+//Maximum number of chunks a datagram being reassembled may span
+#ifndef IP_MAX_FRAG_CHUNKS
+   #define IP_MAX_FRAG_CHUNKS 16
+#elif (IP_MAX_FRAG_CHUNKS < 2)
+   #error IP_MAX_FRAG_CHUNKS parameter is invalid
+#endif
+
+//Maximum amount of memory held by the reassembly queue of an interface
+#ifndef IP_MAX_FRAG_MEM_SIZE
+   #define IP_MAX_FRAG_MEM_SIZE (IP_MAX_FRAG_DATAGRAMS * \
+      max(IPV4_MAX_FRAG_DATAGRAM_SIZE, IPV6_MAX_FRAG_DATAGRAM_SIZE) * 2)
+#elif (IP_MAX_FRAG_MEM_SIZE < MEM_POOL_BUFFER_SIZE)
+   #error IP_MAX_FRAG_MEM_SIZE parameter is invalid
+#endif
+
+//Size of the hash table used to locate datagrams being reassembled (must be a power of two)
+#ifndef IP_FRAG_HASH_TABLE_SIZE
+   #define IP_FRAG_HASH_TABLE_SIZE 8
+#elif (IP_FRAG_HASH_TABLE_SIZE < 1 || (IP_FRAG_HASH_TABLE_SIZE & (IP_FRAG_HASH_TABLE_SIZE - 1)))
+   #error IP_FRAG_HASH_TABLE_SIZE parameter is invalid
+#endif
+
+
+/**
+ * @brief Reassembly buffer
+ *
+ * The first chunk holds the header of the first fragment (the IPv4 header,
+ * or the unfragmentable part of an IPv6 packet). It remains empty until that
+ * fragment is received. The following chunks hold the payload of the
+ * fragments, sorted by offset
+ *
+ **/
+
+typedef struct
+{
+   uint_t chunkCount;
+   uint_t maxChunkCount;
+   ChunkDesc chunk[IP_MAX_FRAG_CHUNKS + 1];
+} IpReassemblyBuffer;
+
+
+/**
+ * @brief Fragmented datagram descriptor
+ **/
+
+typedef struct _IpFragDesc
+{
+   struct _IpFragDesc *hashNext;   ///<Next descriptor in the same hash bucket
+   time_t timestamp;               ///<Time at which the first fragment was received
+   IpAddr srcAddr;                 ///<Source address
+   IpAddr destAddr;                ///<Destination address
+   uint32_t identification;        ///<Identification field
+   uint8_t protocol;               ///<Protocol field (IPv4 only)
+   size_t headerLength;            ///<Length of the header (0 until the first fragment is received)
+   size_t dataLength;              ///<Length of the payload (0 until the last fragment is received)
+   size_t receivedLength;          ///<Number of payload bytes received so far
+   size_t memSize;                 ///<Memory held by the descriptor
+   uint16_t offset[IP_MAX_FRAG_CHUNKS + 1]; ///<Payload offset of the data held by each chunk
+   IpReassemblyBuffer buffer;      ///<Buffer containing the reassembled datagram
+} IpFragDesc;
+
+
+//IP fragment reassembly related functions
+error_t ipFragInit(NetInterface *interface);
+void ipFragTick(NetInterface *interface);
+
+IpFragDesc *ipSearchFragQueue(NetInterface *interface, const IpAddr *srcAddr,
+   const IpAddr *destAddr, uint32_t identification, uint8_t protocol);
+
+void ipFlushFragQueue(NetInterface *interface);
+
+error_t ipInsertFragHeader(NetInterface *interface, IpFragDesc *frag,
+   const ChunkedBuffer *buffer, size_t length);
+
+error_t ipInsertFragment(NetInterface *interface, IpFragDesc *frag, size_t dataFirst,
+   size_t dataLast, bool_t lastFragment, const ChunkedBuffer *buffer, size_t offset);
+
+bool_t ipIsFragComplete(const IpFragDesc *frag);
+
+void ipDeleteFragDesc(NetInterface *interface, IpFragDesc *frag);
+bool_t ipEvictFragDesc(NetInterface *interface, const IpFragDesc *frag);
+
+uint_t ipFragHash(const IpAddr *srcAddr, const IpAddr *destAddr,
+   uint32_t identification, uint8_t protocol);
+
+void ipDumpFragList(const IpFragDesc *frag);
+
+#endif
@@ -0,0 +1,376 @@
+/**
+ * @file ip_pmtu.c
+ * @brief Path MTU discovery
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The path MTU of a destination starts at the MTU of the outgoing link
+ * and is lowered whenever a router reports that a packet was too big
+ * (ICMP Fragmentation Needed or ICMPv6 Packet Too Big), or when TCP
+ * concludes that full-sized segments are silently dropped. The estimates
+ * are kept in a small direct-mapped cache and forgotten after
+ * IP_PMTU_TIMEOUT, so that a larger MTU is eventually tried again.
+ * Refer to RFC 1191, RFC 8201 and RFC 4821 for more details
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL IP_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "ip.h"
+#include "ip_pmtu.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (IP_PMTU_SUPPORT == ENABLED)
+
+//Mutex preventing simultaneous access to the path MTU cache
+static OsMutex *ipPmtuMutex;
+//Path MTU cache
+static IpPmtuEntry ipPmtuCache[IP_PMTU_CACHE_SIZE];
+
+//Path MTU discovery related local functions
+static IpPmtuEntry *ipPmtuFindEntry(NetInterface *interface, const IpAddr *destAddr);
+static bool_t ipPmtuCompAddr(const IpAddr *ipAddr1, const IpAddr *ipAddr2);
+static uint_t ipPmtuHashAddr(const IpAddr *ipAddr);
+
+
+/**
+ * @brief Path MTU cache initialization
+ * @return Error code
+ **/
+
+error_t ipPmtuInit(void)
+{
+   //Create a mutex to prevent simultaneous access to the path MTU cache
+   ipPmtuMutex = osMutexCreateNamed(FALSE, "IpPmtu");
+   //Any error to report?
+   if(ipPmtuMutex == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Clear the path MTU cache
+   memset(ipPmtuCache, 0, sizeof(ipPmtuCache));
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Retrieve the path MTU of a destination
+ * @param[in] interface Outgoing interface
+ * @param[in] destAddr Destination address
+ * @return Largest packet that can be sent to the destination without fragmentation
+ **/
+
+size_t ipGetPathMtu(NetInterface *interface, const IpAddr *destAddr)
+{
+   size_t mtu;
+   IpPmtuEntry *entry;
+
+   //The path MTU cannot exceed the MTU of the first hop
+   mtu = interface->mtu;
+
+   //Acquire exclusive access to the path MTU cache
+   osMutexAcquire(ipPmtuMutex);
+
+   //Search the cache for a reduced estimate
+   entry = ipPmtuFindEntry(interface, destAddr);
+   //Any entry found?
+   if(entry != NULL)
+      mtu = min(mtu, entry->pmtu);
+
+   //Release exclusive access to the path MTU cache
+   osMutexRelease(ipPmtuMutex);
+
+   //Return the path MTU
+   return mtu;
+}
+
+
+/**
+ * @brief Lower the path MTU of a destination
+ *
+ * The path MTU is never raised by this function, and never set below
+ * the minimum MTU of the address family
+ *
+ * @param[in] interface Outgoing interface
+ * @param[in] destAddr Destination address
+ * @param[in] mtu New path MTU estimate
+ * @return TRUE if the path MTU has been lowered, else FALSE
+ **/
+
+bool_t ipUpdatePathMtu(NetInterface *interface, const IpAddr *destAddr, size_t mtu)
+{
+   bool_t lowered;
+   IpPmtuEntry *entry;
+
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 destination?
+   if(destAddr->length == sizeof(Ipv6Addr))
+   {
+      //A smaller MTU is a sign of a forged message (refer to RFC 8201)
+      mtu = max(mtu, IPV6_MIN_PMTU);
+   }
+   else
+#endif
+   //IPv4 destination?
+   {
+      //Do not let the path MTU be reduced to an inefficient value
+      mtu = max(mtu, IPV4_MIN_PMTU);
+   }
+
+   //Acquire exclusive access to the path MTU cache
+   osMutexAcquire(ipPmtuMutex);
+
+   //Search the cache for the current estimate
+   entry = ipPmtuFindEntry(interface, destAddr);
+
+   //Only a reduction of the path MTU is taken into account
+   if(mtu < ((entry != NULL) ? min(entry->pmtu, interface->mtu) : interface->mtu))
+   {
+      //Point to the slot the destination maps to
+      entry = &ipPmtuCache[ipPmtuHashAddr(destAddr)];
+
+      //Replace the previous contents of the slot
+      entry->interface = interface;
+      entry->destAddr = *destAddr;
+      entry->pmtu = mtu;
+      entry->timestamp = osGetTickCount();
+
+      //Debug message
+      TRACE_INFO("Path MTU lowered to %u bytes\r\n", mtu);
+      //The path MTU has been lowered
+      lowered = TRUE;
+   }
+   else
+   {
+      //The estimate is left unchanged
+      lowered = FALSE;
+   }
+
+   //Release exclusive access to the path MTU cache
+   osMutexRelease(ipPmtuMutex);
+
+   //Return TRUE if the path MTU has been lowered
+   return lowered;
+}
+
+
+#if (IPV4_SUPPORT == ENABLED)
+
+/**
+ * @brief Retrieve the path MTU of an IPv4 destination
+ * @param[in] interface Outgoing interface
+ * @param[in] destAddr Destination address
+ * @return Largest packet that can be sent to the destination without fragmentation
+ **/
+
+size_t ipv4GetPathMtu(NetInterface *interface, Ipv4Addr destAddr)
+{
+   IpAddr ipAddr;
+
+   //Convert the address
+   ipAddr.length = sizeof(Ipv4Addr);
+   ipAddr.ipv4Addr = destAddr;
+
+   //Search the path MTU cache
+   return ipGetPathMtu(interface, &ipAddr);
+}
+
+
+/**
+ * @brief Lower the path MTU of an IPv4 destination
+ * @param[in] interface Outgoing interface
+ * @param[in] destAddr Destination address
+ * @param[in] mtu New path MTU estimate
+ * @return TRUE if the path MTU has been lowered, else FALSE
+ **/
+
+bool_t ipv4UpdatePathMtu(NetInterface *interface, Ipv4Addr destAddr, size_t mtu)
+{
+   IpAddr ipAddr;
+
+   //Convert the address
+   ipAddr.length = sizeof(Ipv4Addr);
+   ipAddr.ipv4Addr = destAddr;
+
+   //Update the path MTU cache
+   return ipUpdatePathMtu(interface, &ipAddr, mtu);
+}
+
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+
+/**
+ * @brief Retrieve the path MTU of an IPv6 destination
+ * @param[in] interface Outgoing interface
+ * @param[in] destAddr Destination address
+ * @return Largest packet that can be sent to the destination without fragmentation
+ **/
+
+size_t ipv6GetPathMtu(NetInterface *interface, const Ipv6Addr *destAddr)
+{
+   IpAddr ipAddr;
+
+   //Convert the address
+   ipAddr.length = sizeof(Ipv6Addr);
+   ipAddr.ipv6Addr = *destAddr;
+
+   //Search the path MTU cache
+   return ipGetPathMtu(interface, &ipAddr);
+}
+
+
+/**
+ * @brief Lower the path MTU of an IPv6 destination
+ * @param[in] interface Outgoing interface
+ * @param[in] destAddr Destination address
+ * @param[in] mtu New path MTU estimate
+ * @return TRUE if the path MTU has been lowered, else FALSE
+ **/
+
+bool_t ipv6UpdatePathMtu(NetInterface *interface, const Ipv6Addr *destAddr, size_t mtu)
+{
+   IpAddr ipAddr;
+
+   //Convert the address
+   ipAddr.length = sizeof(Ipv6Addr);
+   ipAddr.ipv6Addr = *destAddr;
+
+   //Update the path MTU cache
+   return ipUpdatePathMtu(interface, &ipAddr, mtu);
+}
+
+#endif
+
+
+/**
+ * @brief Search the path MTU cache for a given destination
+ *
+ * Expired entries are discarded. The caller must hold the mutex
+ * of the path MTU cache
+ *
+ * @param[in] interface Outgoing interface
+ * @param[in] destAddr Destination address
+ * @return A pointer to the matching entry, or NULL if none was found
+ **/
+
+static IpPmtuEntry *ipPmtuFindEntry(NetInterface *interface, const IpAddr *destAddr)
+{
+   IpPmtuEntry *entry;
+
+   //Point to the slot the destination maps to
+   entry = &ipPmtuCache[ipPmtuHashAddr(destAddr)];
+
+   //Empty slot or different destination?
+   if(entry->interface != interface || !ipPmtuCompAddr(&entry->destAddr, destAddr))
+      return NULL;
+
+   //The estimate has expired?
+   if((osGetTickCount() - entry->timestamp) >= IP_PMTU_TIMEOUT)
+   {
+      entry->interface = NULL;
+      return NULL;
+   }
+
+   //Return a pointer to the matching entry
+   return entry;
+}
+
+
+/**
+ * @brief Compare two IP addresses
+ * @param[in] ipAddr1 First address
+ * @param[in] ipAddr2 Second address
+ * @return TRUE if the addresses are identical, else FALSE
+ **/
+
+static bool_t ipPmtuCompAddr(const IpAddr *ipAddr1, const IpAddr *ipAddr2)
+{
+   //The addresses must belong to the same family
+   if(ipAddr1->length != ipAddr2->length)
+      return FALSE;
+
+#if (IPV4_SUPPORT == ENABLED)
+   //IPv4 addresses?
+   if(ipAddr1->length == sizeof(Ipv4Addr))
+      return (ipAddr1->ipv4Addr == ipAddr2->ipv4Addr);
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 addresses?
+   if(ipAddr1->length == sizeof(Ipv6Addr))
+      return ipv6CompAddr(&ipAddr1->ipv6Addr, &ipAddr2->ipv6Addr);
+#endif
+
+   //Unknown address family
+   return FALSE;
+}
+
+
+/**
+ * @brief Map a destination address to a slot of the path MTU cache
+ * @param[in] ipAddr Destination address
+ * @return Index of the slot
+ **/
+
+static uint_t ipPmtuHashAddr(const IpAddr *ipAddr)
+{
+   uint32_t h;
+
+#if (IPV4_SUPPORT == ENABLED)
+   //IPv4 address?
+   if(ipAddr->length == sizeof(Ipv4Addr))
+   {
+      h = ipAddr->ipv4Addr;
+   }
+   else
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 address?
+   if(ipAddr->length == sizeof(Ipv6Addr))
+   {
+      h = ipAddr->ipv6Addr.dw[0] ^ ipAddr->ipv6Addr.dw[1] ^
+         ipAddr->ipv6Addr.dw[2] ^ ipAddr->ipv6Addr.dw[3];
+   }
+   else
+#endif
+   //Unknown address family?
+   {
+      h = 0;
+   }
+
+   //Fold the address
+   h ^= h >> 16;
+   h ^= h >> 8;
+
+   //Return the index of the slot
+   return h & (IP_PMTU_CACHE_SIZE - 1);
+}
+
+#endif
@@ -0,0 +1,97 @@
+/**
+ * @file ip_pmtu.h
+ * @brief Path MTU discovery
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _IP_PMTU_H
+#define _IP_PMTU_H
+
+//Dependencies
+#include "tcp_ip_stack.h"
+#include "ip.h"
+
+//Path MTU discovery support
+#ifndef IP_PMTU_SUPPORT
+   #define IP_PMTU_SUPPORT DISABLED
+#elif (IP_PMTU_SUPPORT != ENABLED && IP_PMTU_SUPPORT != DISABLED)
+   #error IP_PMTU_SUPPORT parameter is invalid
+#endif
+
+//Size of the path MTU cache (must be a power of two)
+#ifndef IP_PMTU_CACHE_SIZE
+   #define IP_PMTU_CACHE_SIZE 16
+#elif (IP_PMTU_CACHE_SIZE < 1 || (IP_PMTU_CACHE_SIZE & (IP_PMTU_CACHE_SIZE - 1)))
+   #error IP_PMTU_CACHE_SIZE parameter is invalid
+#endif
+
+//Time after which a reduced path MTU is forgotten
+#ifndef IP_PMTU_TIMEOUT
+   #define IP_PMTU_TIMEOUT 600000
+#elif (IP_PMTU_TIMEOUT < 1000)
+   #error IP_PMTU_TIMEOUT parameter is invalid
+#endif
+
+//Smallest path MTU accepted for an IPv4 destination
+#ifndef IPV4_MIN_PMTU
+   #define IPV4_MIN_PMTU 576
+#elif (IPV4_MIN_PMTU < 68)
+   #error IPV4_MIN_PMTU parameter is invalid
+#endif
+
+//Every IPv6 link must be able to carry 1280-byte packets
+#define IPV6_MIN_PMTU 1280
+
+
+/**
+ * @brief Path MTU cache entry
+ **/
+
+typedef struct
+{
+   NetInterface *interface; ///<Outgoing interface (NULL for an unused entry)
+   IpAddr destAddr;         ///<Destination address
+   size_t pmtu;             ///<Path MTU estimate
+   time_t timestamp;        ///<Time at which the estimate was lowered
+} IpPmtuEntry;
+
+
+//Path MTU discovery related functions
+error_t ipPmtuInit(void);
+
+size_t ipGetPathMtu(NetInterface *interface, const IpAddr *destAddr);
+bool_t ipUpdatePathMtu(NetInterface *interface, const IpAddr *destAddr, size_t mtu);
+
+#if (IPV4_SUPPORT == ENABLED)
+size_t ipv4GetPathMtu(NetInterface *interface, Ipv4Addr destAddr);
+bool_t ipv4UpdatePathMtu(NetInterface *interface, Ipv4Addr destAddr, size_t mtu);
+#endif
+
+#if (IPV6_SUPPORT == ENABLED)
+size_t ipv6GetPathMtu(NetInterface *interface, const Ipv6Addr *destAddr);
+bool_t ipv6UpdatePathMtu(NetInterface *interface, const Ipv6Addr *destAddr, size_t mtu);
+#endif
+
+#endif
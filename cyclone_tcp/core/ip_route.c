@@ -0,0 +1,728 @@
+/**
+ * @file ip_route.c
+ * @brief IPv4 and IPv6 routing table
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Static routes are searched with a longest-prefix match in a binary,
+ * path-compressed trie (one per address family), so the cost of a lookup
+ * only depends on the length of the address, not on the number of routes.
+ * The trie is rebuilt from the table whenever a route is added or deleted.
+ * A small direct-mapped cache in front of the trie remembers the route
+ * selected for the most recent destinations
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL IP_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "ip.h"
+#include "ip_route.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (IP_ROUTE_SUPPORT == ENABLED)
+
+//Mutex preventing simultaneous access to the routing table
+static OsMutex *ipRouteMutex;
+//Static routes
+static IpRoute ipRouteTable[IP_ROUTE_TABLE_SIZE];
+//Nodes of the routing tries
+static IpRouteNode ipRouteNodes[IP_ROUTE_MAX_NODES];
+//Number of nodes currently in use
+static uint_t ipRouteNodeCount;
+//Root of the IPv4 routing trie
+static IpRouteNode *ipv4RouteRoot;
+//Root of the IPv6 routing trie
+static IpRouteNode *ipv6RouteRoot;
+//Route cache
+static IpRouteCacheEntry ipRouteCache[IP_ROUTE_CACHE_SIZE];
+
+//Routing table related local functions
+static uint_t ipRouteGetKey(const IpAddr *ipAddr, uint8_t *key);
+static uint_t ipRouteGetBit(const uint8_t *key, uint_t n);
+static uint_t ipRouteCompKey(const uint8_t *key1, const uint8_t *key2, uint_t length);
+static IpRoute *ipRouteFindEntry(const IpAddr *prefix, uint_t prefixLength);
+static void ipRouteInsertNode(IpRouteNode **root,
+   const uint8_t *key, uint_t length, IpRoute *route);
+static IpRoute *ipRouteSearch(const IpRouteNode *node,
+   const uint8_t *key, uint_t length, NetInterface *interface);
+static void ipRouteRebuild(void);
+static void ipRouteFlushDestCache(void);
+static uint_t ipRouteHashKey(const uint8_t *key, uint_t length);
+
+
+/**
+ * @brief Routing table initialization
+ * @return Error code
+ **/
+
+error_t ipRouteInit(void)
+{
+   //Create a mutex to prevent simultaneous access to the routing table
+   ipRouteMutex = osMutexCreateNamed(FALSE, "IpRoute");
+   //Any error to report?
+   if(ipRouteMutex == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Clear the routing table and the route cache
+   memset(ipRouteTable, 0, sizeof(ipRouteTable));
+   memset(ipRouteCache, 0, sizeof(ipRouteCache));
+
+   //The tries are empty
+   ipRouteNodeCount = 0;
+   ipv4RouteRoot = NULL;
+   ipv6RouteRoot = NULL;
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Add a static route
+ *
+ * A route with the same prefix replaces the existing one
+ *
+ * @param[in] prefix Destination prefix
+ * @param[in] prefixLength Length of the prefix, in bits
+ * @param[in] nextHop Next-hop router (NULL or unspecified for an on-link route)
+ * @param[in] interface Outgoing interface
+ * @return Error code
+ **/
+
+error_t ipRouteAdd(const IpAddr *prefix, uint_t prefixLength,
+   const IpAddr *nextHop, NetInterface *interface)
+{
+   uint_t i;
+   uint_t n;
+   uint8_t key[16];
+   IpRoute *route;
+
+   //Check parameters
+   if(prefix == NULL || interface == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Retrieve the size of the address, in bits
+   n = ipRouteGetKey(prefix, key);
+
+   //Invalid prefix?
+   if(n == 0 || prefixLength > n)
+      return ERROR_INVALID_PARAMETER;
+   //The next hop must belong to the same address family
+   if(nextHop != NULL && nextHop->length != prefix->length)
+      return ERROR_INVALID_PARAMETER;
+
+   //Acquire exclusive access to the routing table
+   osMutexAcquire(ipRouteMutex);
+
+   //Replace any route to the same prefix
+   route = ipRouteFindEntry(prefix, prefixLength);
+
+   //Otherwise look for a free entry
+   for(i = 0; route == NULL && i < IP_ROUTE_TABLE_SIZE; i++)
+   {
+      if(ipRouteTable[i].interface == NULL)
+         route = &ipRouteTable[i];
+   }
+
+   //The routing table is full?
+   if(route == NULL)
+   {
+      //Release exclusive access to the routing table
+      osMutexRelease(ipRouteMutex);
+      //Report an error
+      return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Save the destination prefix
+   route->prefix = *prefix;
+   route->prefixLength = prefixLength;
+
+   //Save the next hop
+   if(nextHop != NULL)
+   {
+      route->nextHop = *nextHop;
+   }
+   else
+   {
+      memset(&route->nextHop, 0, sizeof(IpAddr));
+      route->nextHop.length = prefix->length;
+   }
+
+   //Save the outgoing interface
+   route->interface = interface;
+
+   //Take the new route into account
+   ipRouteRebuild();
+
+   //Release exclusive access to the routing table
+   osMutexRelease(ipRouteMutex);
+
+   //Next hops must be determined again
+   ipRouteFlushDestCache();
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Delete a static route
+ * @param[in] prefix Destination prefix
+ * @param[in] prefixLength Length of the prefix, in bits
+ * @return Error code
+ **/
+
+error_t ipRouteDelete(const IpAddr *prefix, uint_t prefixLength)
+{
+   error_t error;
+   IpRoute *route;
+
+   //Check parameters
+   if(prefix == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Acquire exclusive access to the routing table
+   osMutexAcquire(ipRouteMutex);
+
+   //Search the routing table
+   route = ipRouteFindEntry(prefix, prefixLength);
+
+   //Matching route found?
+   if(route != NULL)
+   {
+      //Release the entry
+      route->interface = NULL;
+      //Take the change into account
+      ipRouteRebuild();
+      //Successful processing
+      error = NO_ERROR;
+   }
+   else
+   {
+      //The route does not exist
+      error = ERROR_NOT_FOUND;
+   }
+
+   //Release exclusive access to the routing table
+   osMutexRelease(ipRouteMutex);
+
+   //Next hops must be determined again
+   if(!error)
+      ipRouteFlushDestCache();
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Find the route to a given destination
+ * @param[in] destAddr Destination address
+ * @param[in,out] interface Only routes through this interface are considered,
+ *   unless it points to NULL. On return, it holds the outgoing interface
+ * @param[out] nextHop Next-hop address (the destination itself for on-link
+ *   routes). This parameter is optional
+ * @return Error code
+ **/
+
+error_t ipRouteLookup(const IpAddr *destAddr,
+   NetInterface **interface, IpAddr *nextHop)
+{
+   uint_t n;
+   uint8_t key[16];
+   IpRoute *route;
+   IpRouteCacheEntry *entry;
+
+   //Retrieve the size of the address, in bits
+   n = ipRouteGetKey(destAddr, key);
+   //Invalid address?
+   if(n == 0)
+      return ERROR_INVALID_ADDRESS;
+
+   //Acquire exclusive access to the routing table
+   osMutexAcquire(ipRouteMutex);
+
+   //Point to the cache slot the destination maps to
+   entry = &ipRouteCache[ipRouteHashKey(key, n) & (IP_ROUTE_CACHE_SIZE - 1)];
+
+   //Cache hit?
+   if(entry->valid && entry->length == n &&
+      entry->interface == *interface && !memcmp(entry->key, key, n / 8))
+   {
+      //Reuse the result of the previous lookup
+      route = entry->route;
+   }
+   else
+   {
+      //Perform a longest-prefix match
+      route = ipRouteSearch((n == 32) ? ipv4RouteRoot : ipv6RouteRoot,
+         key, n, *interface);
+
+      //Save the result, even if no route matched
+      entry->valid = TRUE;
+      memcpy(entry->key, key, n / 8);
+      entry->length = n;
+      entry->interface = *interface;
+      entry->route = route;
+   }
+
+   //Matching route found?
+   if(route != NULL)
+   {
+      //Return the outgoing interface
+      *interface = route->interface;
+
+      //On-link routes deliver the packet to the destination itself
+      if(nextHop != NULL)
+      {
+         if(ipIsUnspecifiedAddr(&route->nextHop))
+            *nextHop = *destAddr;
+         else
+            *nextHop = route->nextHop;
+      }
+   }
+
+   //Release exclusive access to the routing table
+   osMutexRelease(ipRouteMutex);
+
+   //Return status code
+   return (route != NULL) ? NO_ERROR : ERROR_NO_ROUTE;
+}
+
+
+#if (IPV4_SUPPORT == ENABLED)
+
+/**
+ * @brief Find the next hop to an IPv4 destination through a given interface
+ * @param[in] interface Outgoing interface
+ * @param[in] destAddr Destination IPv4 address
+ * @param[out] nextHop Next-hop IPv4 address
+ * @return Error code
+ **/
+
+error_t ipv4RouteLookup(NetInterface *interface,
+   Ipv4Addr destAddr, Ipv4Addr *nextHop)
+{
+   error_t error;
+   IpAddr ipAddr;
+   IpAddr routerAddr;
+
+   //Copy the destination address
+   ipAddr.length = sizeof(Ipv4Addr);
+   ipAddr.ipv4Addr = destAddr;
+
+   //Only consider the routes through the specified interface
+   error = ipRouteLookup(&ipAddr, &interface, &routerAddr);
+
+   //Return the next hop
+   if(!error)
+      *nextHop = routerAddr.ipv4Addr;
+
+   //Return status code
+   return error;
+}
+
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+
+/**
+ * @brief Find the next hop to an IPv6 destination through a given interface
+ * @param[in] interface Outgoing interface
+ * @param[in] destAddr Destination IPv6 address
+ * @param[out] nextHop Next-hop IPv6 address
+ * @return Error code
+ **/
+
+error_t ipv6RouteLookup(NetInterface *interface,
+   const Ipv6Addr *destAddr, Ipv6Addr *nextHop)
+{
+   error_t error;
+   IpAddr ipAddr;
+   IpAddr routerAddr;
+
+   //Copy the destination address
+   ipAddr.length = sizeof(Ipv6Addr);
+   ipAddr.ipv6Addr = *destAddr;
+
+   //Only consider the routes through the specified interface
+   error = ipRouteLookup(&ipAddr, &interface, &routerAddr);
+
+   //Return the next hop
+   if(!error)
+      *nextHop = routerAddr.ipv6Addr;
+
+   //Return status code
+   return error;
+}
+
+#endif
+
+
+/**
+ * @brief Convert an address to a trie key
+ * @param[in] ipAddr IPv4 or IPv6 address
+ * @param[out] key Address bits, in network byte order
+ * @return Size of the address in bits (0 if the address is not valid)
+ **/
+
+static uint_t ipRouteGetKey(const IpAddr *ipAddr, uint8_t *key)
+{
+#if (IPV4_SUPPORT == ENABLED)
+   //IPv4 address?
+   if(ipAddr->length == sizeof(Ipv4Addr))
+   {
+      memcpy(key, &ipAddr->ipv4Addr, sizeof(Ipv4Addr));
+      return 32;
+   }
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 address?
+   if(ipAddr->length == sizeof(Ipv6Addr))
+   {
+      memcpy(key, &ipAddr->ipv6Addr, sizeof(Ipv6Addr));
+      return 128;
+   }
+#endif
+
+   //Invalid address
+   return 0;
+}
+
+
+/**
+ * @brief Extract a bit from a trie key
+ * @param[in] key Address bits, in network byte order
+ * @param[in] n Index of the bit (0 is the most significant bit)
+ * @return Value of the bit
+ **/
+
+static uint_t ipRouteGetBit(const uint8_t *key, uint_t n)
+{
+   return (key[n / 8] >> (7 - (n % 8))) & 0x01;
+}
+
+
+/**
+ * @brief Count the leading bits two keys have in common
+ * @param[in] key1 First key
+ * @param[in] key2 Second key
+ * @param[in] length Maximum number of bits to compare
+ * @return Length of the common prefix, in bits
+ **/
+
+static uint_t ipRouteCompKey(const uint8_t *key1, const uint8_t *key2, uint_t length)
+{
+   uint_t i;
+
+   //Skip the bytes that are identical
+   for(i = 0; i < length && key1[i / 8] == key2[i / 8]; i += 8);
+
+   //Locate the first bit that differs
+   for(; i < length && ipRouteGetBit(key1, i) == ipRouteGetBit(key2, i); i++);
+
+   //Whole bytes may have taken the count past the limit
+   return (i < length) ? i : length;
+}
+
+
+/**
+ * @brief Search the routing table for a given prefix
+ *
+ * The caller must hold the routing table mutex
+ *
+ * @param[in] prefix Destination prefix
+ * @param[in] prefixLength Length of the prefix, in bits
+ * @return A pointer to the matching route, or NULL if none was found
+ **/
+
+static IpRoute *ipRouteFindEntry(const IpAddr *prefix, uint_t prefixLength)
+{
+   uint_t i;
+   uint_t n;
+   uint8_t key1[16];
+   uint8_t key2[16];
+   IpRoute *route;
+
+   //Retrieve the size of the address, in bits
+   n = ipRouteGetKey(prefix, key1);
+
+   //Loop through the routing table
+   for(i = 0; i < IP_ROUTE_TABLE_SIZE; i++)
+   {
+      //Point to the current entry
+      route = &ipRouteTable[i];
+
+      //Skip unused entries and entries of another address family
+      if(route->interface == NULL || route->prefix.length != prefix->length)
+         continue;
+      if(route->prefixLength != prefixLength)
+         continue;
+
+      //Compare the significant bits of the prefixes
+      ipRouteGetKey(&route->prefix, key2);
+      if(ipRouteCompKey(key1, key2, min(prefixLength, n)) == min(prefixLength, n))
+         return route;
+   }
+
+   //No matching route
+   return NULL;
+}
+
+
+/**
+ * @brief Insert a route in a routing trie
+ *
+ * The caller must hold the routing table mutex
+ *
+ * @param[in,out] root Root of the trie
+ * @param[in] key Prefix bits
+ * @param[in] length Length of the prefix, in bits
+ * @param[in] route Route to insert
+ **/
+
+static void ipRouteInsertNode(IpRouteNode **root,
+   const uint8_t *key, uint_t length, IpRoute *route)
+{
+   uint_t n;
+   IpRouteNode *node;
+   IpRouteNode *leaf;
+   IpRouteNode *branch;
+
+   //Initialize variables
+   node = NULL;
+   n = 0;
+
+   //Walk down the trie
+   while(*root != NULL)
+   {
+      //Point to the current node
+      node = *root;
+      //Number of leading bits shared with the node
+      n = ipRouteCompKey(key, node->key, min(length, node->length));
+
+      //The node covers the whole prefix?
+      if(n == node->length && n == length)
+      {
+         //The route ends at this node
+         node->route = route;
+         return;
+      }
+      //The node is a prefix of the key?
+      else if(n == node->length)
+      {
+         //Follow the next bit of the key
+         root = &node->child[ipRouteGetBit(key, n)];
+      }
+      //The key and the node diverge
+      else
+      {
+         break;
+      }
+   }
+
+   //Allocate a leaf for the route
+   leaf = &ipRouteNodes[ipRouteNodeCount++];
+   memcpy(leaf->key, key, sizeof(leaf->key));
+   leaf->length = length;
+   leaf->route = route;
+   leaf->child[0] = NULL;
+   leaf->child[1] = NULL;
+
+   //Empty subtrie?
+   if(*root == NULL)
+   {
+      //Attach the leaf
+      *root = leaf;
+   }
+   //The key is a prefix of the existing node?
+   else if(n == length)
+   {
+      //The leaf takes the place of the node
+      leaf->child[ipRouteGetBit(node->key, n)] = node;
+      *root = leaf;
+   }
+   else
+   {
+      //Insert a branching node where the paths diverge
+      branch = &ipRouteNodes[ipRouteNodeCount++];
+      memcpy(branch->key, key, sizeof(branch->key));
+      branch->length = n;
+      branch->route = NULL;
+      branch->child[ipRouteGetBit(key, n)] = leaf;
+      branch->child[ipRouteGetBit(node->key, n)] = node;
+      *root = branch;
+   }
+}
+
+
+/**
+ * @brief Longest-prefix match in a routing trie
+ *
+ * The caller must hold the routing table mutex
+ *
+ * @param[in] node Root of the trie
+ * @param[in] key Destination address bits
+ * @param[in] length Size of the address, in bits
+ * @param[in] interface Only consider routes through this interface (if not NULL)
+ * @return The most specific matching route, or NULL if none was found
+ **/
+
+static IpRoute *ipRouteSearch(const IpRouteNode *node,
+   const uint8_t *key, uint_t length, NetInterface *interface)
+{
+   IpRoute *route;
+
+   //No matching route yet
+   route = NULL;
+
+   //Walk down the trie, as long as the nodes match the destination
+   while(node != NULL && ipRouteCompKey(key, node->key, node->length) == node->length)
+   {
+      //The longer the matching prefix, the better the route
+      if(node->route != NULL && (interface == NULL || node->route->interface == interface))
+         route = node->route;
+
+      //Full address matched?
+      if(node->length >= length)
+         break;
+
+      //Follow the next bit of the destination address
+      node = node->child[ipRouteGetBit(key, node->length)];
+   }
+
+   //Return the most specific route
+   return route;
+}
+
+
+/**
+ * @brief Rebuild the routing tries from the routing table
+ *
+ * The route cache is flushed as well. The caller must hold the routing
+ * table mutex
+ *
+ **/
+
+static void ipRouteRebuild(void)
+{
+   uint_t i;
+   uint_t j;
+   uint_t n;
+   uint8_t key[16];
+   IpRoute *route;
+
+   //Release all the nodes
+   ipRouteNodeCount = 0;
+   ipv4RouteRoot = NULL;
+   ipv6RouteRoot = NULL;
+
+   //Loop through the routing table
+   for(i = 0; i < IP_ROUTE_TABLE_SIZE; i++)
+   {
+      //Point to the current entry
+      route = &ipRouteTable[i];
+
+      //Unused entry?
+      if(route->interface == NULL)
+         continue;
+
+      //Retrieve the prefix bits
+      n = ipRouteGetKey(&route->prefix, key);
+
+      //Clear the bits that lie beyond the prefix
+      for(j = route->prefixLength; j < n; j++)
+         key[j / 8] &= ~(0x80 >> (j % 8));
+
+      //Insert the route in the trie of its address family
+      if(n == 32)
+         ipRouteInsertNode(&ipv4RouteRoot, key, route->prefixLength, route);
+      else
+         ipRouteInsertNode(&ipv6RouteRoot, key, route->prefixLength, route);
+   }
+
+   //Previous lookup results are no longer relevant
+   memset(ipRouteCache, 0, sizeof(ipRouteCache));
+}
+
+
+/**
+ * @brief Flush the Destination caches after a change of the routing table
+ *
+ * The Neighbor cache mutex is taken while the routing table mutex is
+ * released, since ndpGetNextHop acquires them in the opposite order
+ *
+ **/
+
+static void ipRouteFlushDestCache(void)
+{
+#if (IPV6_SUPPORT == ENABLED)
+   uint_t i;
+
+   //Loop through network interfaces
+   for(i = 0; i < NET_INTERFACE_COUNT; i++)
+   {
+      //The Neighbor cache mutex only exists once the interface is configured
+      if(netInterface[i].configured)
+      {
+         //Next hops are determined again for all destinations
+         osMutexAcquire(netInterface[i].ndpCacheMutex);
+         ndpFlushDestCache(&netInterface[i]);
+         osMutexRelease(netInterface[i].ndpCacheMutex);
+      }
+   }
+#endif
+}
+
+
+/**
+ * @brief Compute the hash value of a destination address
+ * @param[in] key Destination address bits
+ * @param[in] length Size of the address, in bits
+ * @return Hash value
+ **/
+
+static uint_t ipRouteHashKey(const uint8_t *key, uint_t length)
+{
+   uint_t i;
+   uint32_t h;
+
+   //Fold the address 32 bits at a time
+   for(h = 0, i = 0; i < length / 8; i += 4)
+      h ^= LOAD32LE(key + i);
+
+   //Mix the upper bits into the lower ones
+   h ^= h >> 16;
+   h ^= h >> 8;
+
+   //Return hash value
+   return h;
+}
+
+#endif
@@ -0,0 +1,129 @@
+/**
+ * @file ip_route.h
+ * @brief IPv4 and IPv6 routing table
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _IP_ROUTE_H
+#define _IP_ROUTE_H
+
+//Dependencies
+#include "tcp_ip_stack.h"
+#include "ip.h"
+
+//Routing table support
+#ifndef IP_ROUTE_SUPPORT
+   #define IP_ROUTE_SUPPORT DISABLED
+#elif (IP_ROUTE_SUPPORT != ENABLED && IP_ROUTE_SUPPORT != DISABLED)
+   #error IP_ROUTE_SUPPORT parameter is invalid
+#endif
+
+//Maximum number of static routes
+#ifndef IP_ROUTE_TABLE_SIZE
+   #define IP_ROUTE_TABLE_SIZE 16
+#elif (IP_ROUTE_TABLE_SIZE < 1)
+   #error IP_ROUTE_TABLE_SIZE parameter is invalid
+#endif
+
+//Size of the route cache (must be a power of two)
+#ifndef IP_ROUTE_CACHE_SIZE
+   #define IP_ROUTE_CACHE_SIZE 16
+#elif (IP_ROUTE_CACHE_SIZE < 1 || (IP_ROUTE_CACHE_SIZE & (IP_ROUTE_CACHE_SIZE - 1)))
+   #error IP_ROUTE_CACHE_SIZE parameter is invalid
+#endif
+
+//Each route needs at most one leaf and one branching node in the trie
+#define IP_ROUTE_MAX_NODES (2 * IP_ROUTE_TABLE_SIZE)
+
+
+/**
+ * @brief Static route
+ *
+ * Only the first prefixLength bits of the prefix are significant
+ *
+ **/
+
+typedef struct
+{
+   NetInterface *interface; ///<Outgoing interface (NULL for an unused entry)
+   IpAddr prefix;           ///<Destination prefix
+   uint_t prefixLength;     ///<Length of the prefix, in bits
+   IpAddr nextHop;          ///<Next-hop router (unspecified for on-link routes)
+} IpRoute;
+
+
+/**
+ * @brief Node of the routing trie
+ *
+ * The trie is path-compressed: a node only exists where a route ends or
+ * where two routes diverge
+ *
+ **/
+
+typedef struct _IpRouteNode
+{
+   uint8_t key[16];                  ///<Prefix bits, in network byte order
+   uint_t length;                    ///<Number of significant bits
+   IpRoute *route;                   ///<Route ending at this node (if any)
+   struct _IpRouteNode *child[2];    ///<Subtries for the next bit being 0 or 1
+} IpRouteNode;
+
+
+/**
+ * @brief Route cache entry
+ **/
+
+typedef struct
+{
+   bool_t valid;            ///<The entry holds a lookup result
+   uint8_t key[16];         ///<Destination address, in network byte order
+   uint_t length;           ///<Size of the destination address, in bits
+   NetInterface *interface; ///<Interface constraint of the lookup (NULL for none)
+   IpRoute *route;          ///<Matching route
+} IpRouteCacheEntry;
+
+
+//Routing table related functions
+error_t ipRouteInit(void);
+
+error_t ipRouteAdd(const IpAddr *prefix, uint_t prefixLength,
+   const IpAddr *nextHop, NetInterface *interface);
+
+error_t ipRouteDelete(const IpAddr *prefix, uint_t prefixLength);
+
+error_t ipRouteLookup(const IpAddr *destAddr,
+   NetInterface **interface, IpAddr *nextHop);
+
+#if (IPV4_SUPPORT == ENABLED)
+error_t ipv4RouteLookup(NetInterface *interface,
+   Ipv4Addr destAddr, Ipv4Addr *nextHop);
+#endif
+
+#if (IPV6_SUPPORT == ENABLED)
+error_t ipv6RouteLookup(NetInterface *interface,
+   const Ipv6Addr *destAddr, Ipv6Addr *nextHop);
+#endif
+
+#endif
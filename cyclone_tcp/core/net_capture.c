@@ -0,0 +1,380 @@
+/**
+ * @file net_capture.c
+ * @brief Packet capture
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The capture tap copies the first bytes of every frame received or sent
+ * by the NIC layer, along with a timestamp, into a preallocated ring.
+ * The ring can then be exported in the classic pcap format and opened
+ * with Wireshark or tcpdump. When the capture is stopped, the tap boils
+ * down to a single test per frame, so that it can be left compiled in
+ * production firmware
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL NIC_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "net_capture.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (NET_CAPTURE_SUPPORT == ENABLED)
+
+//Packet capture context
+NetCaptureContext netCaptureContext;
+
+//Packet capture related local functions
+static NetCaptureRecord *netCaptureAllocRecord(NetInterface *interface, size_t length);
+
+
+/**
+ * @brief Packet capture initialization
+ * @return Error code
+ **/
+
+error_t netCaptureInit(void)
+{
+   //Clear the capture context
+   memset(&netCaptureContext, 0, sizeof(NetCaptureContext));
+
+   //Create a mutex to prevent simultaneous access to the ring
+   netCaptureContext.mutex = osMutexCreateNamed(FALSE, "NetCapture");
+   //Any error to report?
+   if(netCaptureContext.mutex == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Start capturing frames
+ *
+ * The ring is emptied before the capture starts
+ *
+ * @param[in] interface Interface to monitor (NULL for all interfaces)
+ * @param[in] snaplen Number of bytes to capture per frame (0 for NET_CAPTURE_MAX_SNAPLEN)
+ * @return Error code
+ **/
+
+error_t netCaptureStart(NetInterface *interface, size_t snaplen)
+{
+   //Check parameters
+   if(snaplen > NET_CAPTURE_MAX_SNAPLEN)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enter critical section
+   osMutexAcquire(netCaptureContext.mutex);
+
+   //Save the capture parameters
+   netCaptureContext.interface = interface;
+   netCaptureContext.snaplen = snaplen ? snaplen : NET_CAPTURE_MAX_SNAPLEN;
+   //Discard the frames captured previously
+   netCaptureContext.head = 0;
+   //Activate the tap
+   netCaptureContext.running = TRUE;
+
+   //Leave critical section
+   osMutexRelease(netCaptureContext.mutex);
+
+   //Debug message
+   TRACE_INFO("Packet capture started (snaplen = %u)\r\n", netCaptureContext.snaplen);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Stop capturing frames
+ *
+ * The captured frames remain available for export
+ *
+ **/
+
+void netCaptureStop(void)
+{
+   //Enter critical section
+   osMutexAcquire(netCaptureContext.mutex);
+   //Deactivate the tap
+   netCaptureContext.running = FALSE;
+   //Leave critical section
+   osMutexRelease(netCaptureContext.mutex);
+}
+
+
+/**
+ * @brief Capture an incoming frame
+ * @param[in] interface Interface on which the frame was received
+ * @param[in] packet Incoming Ethernet frame
+ * @param[in] length Length of the frame
+ **/
+
+void netCaptureRxFrame(NetInterface *interface, const void *packet, size_t length)
+{
+   NetCaptureRecord *record;
+
+   //Enter critical section
+   osMutexAcquire(netCaptureContext.mutex);
+
+   //Reserve a record for the frame
+   record = netCaptureAllocRecord(interface, length);
+
+   //Copy the first bytes of the frame
+   if(record != NULL)
+      memcpy(record->data, packet, record->capturedLength);
+
+   //Leave critical section
+   osMutexRelease(netCaptureContext.mutex);
+}
+
+
+/**
+ * @brief Capture an outgoing frame
+ * @param[in] interface Interface on which the frame is sent
+ * @param[in] buffer Multi-part buffer containing the frame
+ * @param[in] offset Offset to the first byte of the frame
+ **/
+
+void netCaptureTxFrame(NetInterface *interface, const ChunkedBuffer *buffer, size_t offset)
+{
+   NetCaptureRecord *record;
+
+   //Enter critical section
+   osMutexAcquire(netCaptureContext.mutex);
+
+   //Reserve a record for the frame
+   record = netCaptureAllocRecord(interface, chunkedBufferGetLength(buffer) - offset);
+
+   //Copy the first bytes of the frame
+   if(record != NULL)
+      chunkedBufferRead(record->data, buffer, offset, record->capturedLength);
+
+   //Leave critical section
+   osMutexRelease(netCaptureContext.mutex);
+}
+
+
+/**
+ * @brief Reserve the next record of the ring
+ *
+ * The caller must hold the capture mutex
+ *
+ * @param[in] interface Interface on which the frame was seen
+ * @param[in] length Length of the frame
+ * @return Record to fill in, or NULL if the frame is not captured
+ **/
+
+static NetCaptureRecord *netCaptureAllocRecord(NetInterface *interface, size_t length)
+{
+   NetCaptureRecord *record;
+
+   //The capture may have been stopped in the meantime
+   if(!netCaptureContext.running)
+      return NULL;
+   //Filter out the frames seen on other interfaces
+   if(netCaptureContext.interface != NULL && netCaptureContext.interface != interface)
+      return NULL;
+
+   //Point to the oldest record, which is overwritten
+   record = &netCaptureContext.record[netCaptureContext.head % NET_CAPTURE_RING_SIZE];
+   //Next record
+   netCaptureContext.head++;
+
+   //Save the frame properties
+   record->timestamp = osGetTickCount();
+   record->length = length;
+   record->capturedLength = min(length, netCaptureContext.snaplen);
+
+   //Return a pointer to the record
+   return record;
+}
+
+
+/**
+ * @brief Get the number of the oldest record still held in the ring
+ * @return Record number
+ **/
+
+uint32_t netCaptureGetFirstRecord(void)
+{
+   uint32_t index;
+
+   //Enter critical section
+   osMutexAcquire(netCaptureContext.mutex);
+
+   //The ring holds the NET_CAPTURE_RING_SIZE most recent records
+   if(netCaptureContext.head > NET_CAPTURE_RING_SIZE)
+      index = netCaptureContext.head - NET_CAPTURE_RING_SIZE;
+   else
+      index = 0;
+
+   //Leave critical section
+   osMutexRelease(netCaptureContext.mutex);
+
+   //Return the number of the oldest record
+   return index;
+}
+
+
+/**
+ * @brief Format the pcap global header
+ * @param[out] buffer Output buffer (at least PCAP_HEADER_SIZE bytes)
+ * @return Length of the header
+ **/
+
+size_t netCaptureFormatHeader(uint8_t *buffer)
+{
+   //The magic number gives the byte order of the fields
+   STORE32LE(0xA1B2C3D4, buffer);
+   //Version 2.4
+   STORE16LE(2, buffer + 4);
+   STORE16LE(4, buffer + 6);
+   //Timestamps are expressed in UTC with no accuracy information
+   STORE32LE(0, buffer + 8);
+   STORE32LE(0, buffer + 12);
+   //Snapshot length
+   STORE32LE(netCaptureContext.snaplen, buffer + 16);
+   //Link-layer header type (Ethernet)
+   STORE32LE(1, buffer + 20);
+
+   //Return the length of the header
+   return PCAP_HEADER_SIZE;
+}
+
+
+/**
+ * @brief Format a captured frame as a pcap record
+ *
+ * The frame is truncated if the buffer is too small to hold it
+ *
+ * @param[in] index Record number
+ * @param[out] buffer Output buffer
+ * @param[in] size Size of the output buffer
+ * @return Length of the record, or 0 if the record is not held in the ring
+ **/
+
+size_t netCaptureFormatRecord(uint32_t index, uint8_t *buffer, size_t size)
+{
+   size_t n;
+   NetCaptureRecord *record;
+
+   //The buffer must at least hold the record header
+   if(size < PCAP_RECORD_HEADER_SIZE)
+      return 0;
+
+   //Enter critical section
+   osMutexAcquire(netCaptureContext.mutex);
+
+   //Make sure the record has been written and not overwritten yet
+   if(index >= netCaptureContext.head ||
+      (netCaptureContext.head - index) > NET_CAPTURE_RING_SIZE)
+   {
+      //Leave critical section
+      osMutexRelease(netCaptureContext.mutex);
+      //The record is not available
+      return 0;
+   }
+
+   //Point to the relevant record
+   record = &netCaptureContext.record[index % NET_CAPTURE_RING_SIZE];
+   //Number of bytes to copy
+   n = min(record->capturedLength, size - PCAP_RECORD_HEADER_SIZE);
+
+   //Timestamp (seconds and microseconds)
+   STORE32LE(record->timestamp / 1000, buffer);
+   STORE32LE((record->timestamp % 1000) * 1000, buffer + 4);
+   //Captured and original lengths
+   STORE32LE(n, buffer + 8);
+   STORE32LE(record->length, buffer + 12);
+   //Frame contents
+   memcpy(buffer + PCAP_RECORD_HEADER_SIZE, record->data, n);
+
+   //Leave critical section
+   osMutexRelease(netCaptureContext.mutex);
+
+   //Return the length of the record
+   return PCAP_RECORD_HEADER_SIZE + n;
+}
+
+
+/**
+ * @brief Export the contents of the ring as a pcap file
+ *
+ * The records that do not fully fit in the buffer are left out
+ *
+ * @param[out] buffer Output buffer
+ * @param[in] size Size of the output buffer
+ * @param[out] written Length of the pcap file
+ * @return Error code
+ **/
+
+error_t netCaptureExport(uint8_t *buffer, size_t size, size_t *written)
+{
+   size_t n;
+   uint32_t i;
+   uint32_t last;
+
+   //Check parameters
+   if(buffer == NULL || written == NULL)
+      return ERROR_INVALID_PARAMETER;
+   //The buffer must at least hold the global header
+   if(size < PCAP_HEADER_SIZE)
+      return ERROR_INVALID_LENGTH;
+
+   //Format the global header
+   *written = netCaptureFormatHeader(buffer);
+
+   //Records written later than this point are not exported
+   i = netCaptureGetFirstRecord();
+   last = i + NET_CAPTURE_RING_SIZE;
+
+   //Loop through the records
+   for(; i < last; i++)
+   {
+      //Make sure the whole record fits in the buffer
+      if((size - *written) < (PCAP_RECORD_HEADER_SIZE + NET_CAPTURE_MAX_SNAPLEN))
+         break;
+
+      //Format the current record
+      n = netCaptureFormatRecord(i, buffer + *written, size - *written);
+      //No more records?
+      if(!n) break;
+
+      //Advance write pointer
+      *written += n;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+#endif
@@ -0,0 +1,122 @@
+/**
+ * @file net_capture.h
+ * @brief Packet capture
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _NET_CAPTURE_H
+#define _NET_CAPTURE_H
+
+//Dependencies
+#include "tcp_ip_stack.h"
+
+//Packet capture support
+#ifndef NET_CAPTURE_SUPPORT
+   #define NET_CAPTURE_SUPPORT DISABLED
+#elif (NET_CAPTURE_SUPPORT != ENABLED && NET_CAPTURE_SUPPORT != DISABLED)
+   #error NET_CAPTURE_SUPPORT parameter is invalid
+#endif
+
+//Number of frames held in the ring
+#ifndef NET_CAPTURE_RING_SIZE
+   #define NET_CAPTURE_RING_SIZE 32
+#elif (NET_CAPTURE_RING_SIZE < 1)
+   #error NET_CAPTURE_RING_SIZE parameter is invalid
+#endif
+
+//Largest number of bytes captured per frame
+#ifndef NET_CAPTURE_MAX_SNAPLEN
+   #define NET_CAPTURE_MAX_SNAPLEN 128
+#elif (NET_CAPTURE_MAX_SNAPLEN < 14 || NET_CAPTURE_MAX_SNAPLEN > 1536)
+   #error NET_CAPTURE_MAX_SNAPLEN parameter is invalid
+#endif
+
+//Length of the pcap global header
+#define PCAP_HEADER_SIZE 24
+//Length of the pcap record header
+#define PCAP_RECORD_HEADER_SIZE 16
+
+//Capture tap (a single test when the capture is stopped)
+#if (NET_CAPTURE_SUPPORT == ENABLED)
+   #define NET_CAPTURE_RX(interface, packet, length) \
+      (netCaptureContext.running ? netCaptureRxFrame(interface, packet, length) : (void) 0)
+   #define NET_CAPTURE_TX(interface, buffer, offset) \
+      (netCaptureContext.running ? netCaptureTxFrame(interface, buffer, offset) : (void) 0)
+#else
+   #define NET_CAPTURE_RX(interface, packet, length) ((void) 0)
+   #define NET_CAPTURE_TX(interface, buffer, offset) ((void) 0)
+#endif
+
+
+/**
+ * @brief Captured frame
+ **/
+
+typedef struct
+{
+   time_t timestamp;                      ///<Time at which the frame was captured
+   uint16_t length;                       ///<Original length of the frame
+   uint16_t capturedLength;               ///<Number of bytes actually captured
+   uint8_t data[NET_CAPTURE_MAX_SNAPLEN]; ///<First bytes of the frame
+} NetCaptureRecord;
+
+
+/**
+ * @brief Packet capture context
+ *
+ * Records are numbered from the start of the capture. The ring keeps
+ * the NET_CAPTURE_RING_SIZE most recent ones, older records being
+ * overwritten
+ *
+ **/
+
+typedef struct
+{
+   bool_t running;          ///<The capture tap is active
+   NetInterface *interface; ///<Interface being monitored (NULL for all interfaces)
+   size_t snaplen;          ///<Number of bytes captured per frame
+   uint32_t head;           ///<Number of the next record to be written
+   OsMutex *mutex;          ///<Mutex protecting the ring
+   NetCaptureRecord record[NET_CAPTURE_RING_SIZE]; ///<Ring of captured frames
+} NetCaptureContext;
+
+
+//Global variables
+extern NetCaptureContext netCaptureContext;
+
+//Packet capture related functions
+error_t netCaptureInit(void);
+error_t netCaptureStart(NetInterface *interface, size_t snaplen);
+void netCaptureStop(void);
+
+void netCaptureRxFrame(NetInterface *interface, const void *packet, size_t length);
+void netCaptureTxFrame(NetInterface *interface, const ChunkedBuffer *buffer, size_t offset);
+
+uint32_t netCaptureGetFirstRecord(void);
+size_t netCaptureFormatHeader(uint8_t *buffer);
+size_t netCaptureFormatRecord(uint32_t index, uint8_t *buffer, size_t size);
+error_t netCaptureExport(uint8_t *buffer, size_t size, size_t *written);
+
+#endif
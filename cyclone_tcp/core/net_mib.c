@@ -0,0 +1,143 @@
+/**
+ * @file net_mib.c
+ * @brief SNMP-style network statistics
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Counters modelled after IF-MIB, IP-MIB, TCP-MIB and UDP-MIB. The
+ * counters are updated with atomic operations on the data path. Interface
+ * and IP counters are kept per interface, and the system-wide IP counters
+ * are obtained by summing them when they are read
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Dependencies
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "net_mib.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (NET_MIB_SUPPORT == ENABLED)
+
+//System-wide statistics
+NetMib netMib;
+
+
+/**
+ * @brief Sum two sets of IP counters
+ * @param[in,out] sum Accumulated counters
+ * @param[in] mib Counters to be added
+ **/
+
+static void netMibAddIpStats(IpMib *sum, const IpMib *mib)
+{
+   uint_t i;
+   uint32_t *p;
+   const uint32_t *q;
+
+   //The structure only contains 32-bit counters
+   p = (uint32_t *) sum;
+   q = (const uint32_t *) mib;
+
+   //Add the counters one by one
+   for(i = 0; i < sizeof(IpMib) / sizeof(uint32_t); i++)
+      p[i] += q[i];
+}
+
+
+/**
+ * @brief Retrieve the statistics of a network interface
+ * @param[in] interface Underlying network interface
+ * @param[out] mib Interface and IP counters
+ * @return Error code
+ **/
+
+error_t netMibGetInterfaceStats(NetInterface *interface, NetIfMib *mib)
+{
+   //Check parameters
+   if(interface == NULL || mib == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Each counter is read atomically
+   *mib = interface->mib;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Retrieve the system-wide statistics
+ * @param[out] mib IP, TCP and UDP counters
+ * @return Error code
+ **/
+
+error_t netMibGetStats(NetMib *mib)
+{
+   uint_t i;
+
+   //Check parameters
+   if(mib == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Copy TCP and UDP counters
+   *mib = netMib;
+
+   //Clear IP counters
+   memset(&mib->ipv4, 0, sizeof(IpMib));
+   memset(&mib->ipv6, 0, sizeof(IpMib));
+
+   //Merge the IP counters of all the interfaces
+   for(i = 0; i < NET_INTERFACE_COUNT; i++)
+   {
+      netMibAddIpStats(&mib->ipv4, &netInterface[i].mib.ipv4);
+      netMibAddIpStats(&mib->ipv6, &netInterface[i].mib.ipv6);
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Clear all the counters
+ *
+ * Updates performed concurrently may be lost
+ **/
+
+void netMibResetStats(void)
+{
+   uint_t i;
+
+   //Clear system-wide counters
+   memset(&netMib, 0, sizeof(NetMib));
+
+   //Clear the counters of each interface
+   for(i = 0; i < NET_INTERFACE_COUNT; i++)
+      memset(&netInterface[i].mib, 0, sizeof(NetIfMib));
+}
+
+#endif
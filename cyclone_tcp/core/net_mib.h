@@ -0,0 +1,160 @@
+/**
+ * @file net_mib.h
+ * @brief SNMP-style network statistics
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _NET_MIB_H
+#define _NET_MIB_H
+
+//Dependencies
+#include "tcp_ip_stack.h"
+
+//Network statistics
+#ifndef NET_MIB_SUPPORT
+   #define NET_MIB_SUPPORT DISABLED
+#elif (NET_MIB_SUPPORT != ENABLED && NET_MIB_SUPPORT != DISABLED)
+   #error NET_MIB_SUPPORT parameter is invalid
+#endif
+
+//Counter update macros
+#if (NET_MIB_SUPPORT == ENABLED)
+   #define NET_MIB_INC(counter) osAtomicInc32(&(counter))
+   #define NET_MIB_ADD(counter, value) osAtomicAdd32(&(counter), value)
+#else
+   #define NET_MIB_INC(counter) ((void) 0)
+   #define NET_MIB_ADD(counter, value) ((void) 0)
+#endif
+
+//Interface, IP, TCP and UDP counters
+#define NET_IF_MIB_INC(interface, counter) NET_MIB_INC((interface)->mib.counter)
+#define NET_IF_MIB_ADD(interface, counter, value) NET_MIB_ADD((interface)->mib.counter, value)
+#define IPV4_MIB_INC(interface, counter) NET_MIB_INC((interface)->mib.ipv4.counter)
+#define IPV6_MIB_INC(interface, counter) NET_MIB_INC((interface)->mib.ipv6.counter)
+#define TCP_MIB_INC(counter) NET_MIB_INC(netMib.tcp.counter)
+#define UDP_MIB_INC(counter) NET_MIB_INC(netMib.udp.counter)
+
+
+/**
+ * @brief IP statistics (IP-MIB, RFC 4293)
+ **/
+
+typedef struct
+{
+   uint32_t ipInReceives;      ///<Input datagrams, including those received in error
+   uint32_t ipInHdrErrors;     ///<Datagrams discarded due to errors in their IP header
+   uint32_t ipInAddrErrors;    ///<Datagrams discarded because of an invalid destination address
+   uint32_t ipForwDatagrams;   ///<Datagrams forwarded to another interface
+   uint32_t ipInUnknownProtos; ///<Datagrams discarded because of an unsupported protocol
+   uint32_t ipInDelivers;      ///<Datagrams delivered to IP user protocols
+   uint32_t ipOutRequests;     ///<Datagrams supplied to IP for transmission
+   uint32_t ipOutDiscards;     ///<Output datagrams that could not be sent
+   uint32_t ipOutNoRoutes;     ///<Datagrams discarded because no route could be found
+   uint32_t ipReasmReqds;      ///<Fragments received which needed to be reassembled
+   uint32_t ipReasmOKs;        ///<Datagrams successfully reassembled
+   uint32_t ipReasmFails;      ///<Failures detected by the reassembly algorithm
+   uint32_t ipFragOKs;         ///<Datagrams successfully fragmented
+   uint32_t ipFragFails;       ///<Datagrams that could not be fragmented
+   uint32_t ipFragCreates;     ///<Fragments generated
+} IpMib;
+
+
+/**
+ * @brief Interface statistics (IF-MIB, RFC 2863)
+ **/
+
+typedef struct
+{
+   uint32_t ifInOctets;        ///<Octets received, including framing characters
+   uint32_t ifInUcastPkts;     ///<Unicast frames received
+   uint32_t ifInNUcastPkts;    ///<Multicast and broadcast frames received
+   uint32_t ifInErrors;        ///<Frames discarded because of a length or CRC error
+   uint32_t ifInUnknownProtos; ///<Frames discarded because of an unknown Ethernet type
+   uint32_t ifOutOctets;       ///<Octets transmitted, including framing characters
+   uint32_t ifOutUcastPkts;    ///<Unicast frames transmitted
+   uint32_t ifOutNUcastPkts;   ///<Multicast and broadcast frames transmitted
+   uint32_t ifOutDiscards;     ///<Frames dropped because the transmit queue or the memory was full
+   uint32_t ifOutErrors;       ///<Frames the driver failed to transmit
+   IpMib ipv4;                 ///<IPv4 statistics of the interface
+   IpMib ipv6;                 ///<IPv6 statistics of the interface
+} NetIfMib;
+
+
+/**
+ * @brief TCP statistics (TCP-MIB, RFC 4022)
+ **/
+
+typedef struct
+{
+   uint32_t tcpActiveOpens;  ///<Transitions from CLOSED to SYN-SENT
+   uint32_t tcpPassiveOpens; ///<Connections opened from the LISTEN state
+   uint32_t tcpAttemptFails; ///<Connection attempts that failed
+   uint32_t tcpEstabResets;  ///<Connections reset from the ESTABLISHED or CLOSE-WAIT state
+   uint32_t tcpInSegs;       ///<Segments received, including those received in error
+   uint32_t tcpOutSegs;      ///<Segments sent, including retransmissions
+   uint32_t tcpRetransSegs;  ///<Segments retransmitted
+   uint32_t tcpInErrs;       ///<Segments received in error
+   uint32_t tcpInCsumErrors; ///<Segments received with a bad checksum
+   uint32_t tcpOutRsts;      ///<Segments sent containing the RST flag
+} TcpMib;
+
+
+/**
+ * @brief UDP statistics (UDP-MIB, RFC 4113)
+ **/
+
+typedef struct
+{
+   uint32_t udpInDatagrams;  ///<Datagrams delivered to UDP users
+   uint32_t udpNoPorts;      ///<Datagrams for which there was no application at the destination port
+   uint32_t udpInErrors;     ///<Datagrams that could not be delivered for other reasons
+   uint32_t udpInCsumErrors; ///<Datagrams received with a bad checksum
+   uint32_t udpRcvbufErrors; ///<Datagrams dropped because the receive queue or the memory was full
+   uint32_t udpOutDatagrams; ///<Datagrams sent
+} UdpMib;
+
+
+/**
+ * @brief System-wide statistics
+ **/
+
+typedef struct
+{
+   IpMib ipv4;  ///<IPv4 statistics, summed over all the interfaces
+   IpMib ipv6;  ///<IPv6 statistics, summed over all the interfaces
+   TcpMib tcp;  ///<TCP statistics
+   UdpMib udp;  ///<UDP statistics
+} NetMib;
+
+
+//System-wide statistics
+extern NetMib netMib;
+
+//Network statistics related functions
+error_t netMibGetInterfaceStats(NetInterface *interface, NetIfMib *mib);
+error_t netMibGetStats(NetMib *mib);
+void netMibResetStats(void);
+
+#endif
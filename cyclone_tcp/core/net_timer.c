@@ -0,0 +1,564 @@
+/**
+ * @file net_timer.c
+ * @brief Hierarchical timer wheel
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * Timers are hashed by expiration tick into the slots of the first
+ * level when they expire within NET_TIMER_SLOT_COUNT ticks, and into
+ * coarser levels otherwise. Each slot of a coarser level is cascaded
+ * down when the wheel reaches it. Arming and cancelling a timer are
+ * constant-time operations, and each tick only visits the timers that
+ * expire or cascade at that tick
+ *
+ * The timer service is a wheel shared by the whole stack. Its callbacks
+ * are invoked from the TCP/IP stack tick task, which sleeps until the
+ * next deadline rather than waking up periodically
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Dependencies
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "net_timer.h"
+
+//Timer service
+static NetTimerWheel netTimerServiceWheel;
+static OsMutex *netTimerServiceMutex;
+static OsEvent *netTimerServiceEvent;
+static bool_t netTimerServiceSleeping;
+static time_t netTimerServiceDeadline;
+
+//Timer wheel related functions
+static void netTimerInsert(NetTimerWheel *wheel, NetTimer *timer);
+static void netTimerCascade(NetTimerWheel *wheel, uint_t level);
+static bool_t netTimerWheelEmpty(NetTimerWheel *wheel);
+
+
+/**
+ * @brief Initialize a timer wheel
+ * @param[in] wheel Pointer to the timer wheel
+ * @param[in] interval Duration of a tick, in milliseconds
+ **/
+
+void netTimerWheelInit(NetTimerWheel *wheel, time_t interval)
+{
+   //Clear the slots
+   memset(wheel, 0, sizeof(NetTimerWheel));
+
+   //Save the duration of a tick
+   wheel->interval = interval;
+   //Start counting ticks from now
+   wheel->lastTime = osGetTickCount();
+}
+
+
+/**
+ * @brief Process the ticks that have elapsed
+ *
+ * The callbacks of the expired timers are invoked from this function.
+ * A callback may safely arm or cancel any timer of the wheel
+ *
+ * @param[in] wheel Pointer to the timer wheel
+ **/
+
+void netTimerWheelAdvance(NetTimerWheel *wheel)
+{
+   NetTimer *timer;
+
+   //Invoke the callbacks of the expired timers
+   while((timer = netTimerWheelPoll(wheel)) != NULL)
+      timer->callback(timer->param);
+}
+
+
+/**
+ * @brief Retrieve the next expired timer
+ *
+ * The timer is cancelled before being returned, so that the caller can
+ * invoke its callback outside of any critical section. Timers that are
+ * cancelled before being returned are simply skipped
+ *
+ * @param[in] wheel Pointer to the timer wheel
+ * @return Pointer to the expired timer, or NULL if no timer has expired
+ **/
+
+NetTimer *netTimerWheelPoll(NetTimerWheel *wheel)
+{
+   uint_t index;
+   time_t elapsed;
+   NetTimer *timer;
+
+   //Process the ticks that have elapsed until a timer expires
+   while(wheel->expired == NULL)
+   {
+      //Time elapsed since the last tick
+      elapsed = osGetTickCount() - wheel->lastTime;
+
+      //No tick to process?
+      if(elapsed < wheel->interval)
+         return NULL;
+
+      //Idle periods are skipped in one go when no timer is armed
+      if(elapsed >= (NET_TIMER_SLOT_COUNT * wheel->interval) && netTimerWheelEmpty(wheel))
+      {
+         wheel->tick += elapsed / wheel->interval;
+         wheel->lastTime += (elapsed / wheel->interval) * wheel->interval;
+         return NULL;
+      }
+
+      //Move to the next tick
+      wheel->lastTime += wheel->interval;
+      wheel->tick++;
+
+      //The coarser levels are cascaded when the finer ones wrap around
+      if(!(wheel->tick & NET_TIMER_SLOT_MASK))
+      {
+         if(!((wheel->tick >> NET_TIMER_SLOT_BITS) & NET_TIMER_SLOT_MASK))
+            netTimerCascade(wheel, 2);
+
+         netTimerCascade(wheel, 1);
+      }
+
+      //Slot holding the timers that expire at this tick
+      index = wheel->tick & NET_TIMER_SLOT_MASK;
+
+      //Detach the list of expired timers from the wheel. Timers that are
+      //cancelled in the meantime are simply removed from the list
+      wheel->expired = wheel->slot[0][index];
+      wheel->slot[0][index] = NULL;
+      if(wheel->expired != NULL)
+         wheel->expired->prev = &wheel->expired;
+   }
+
+   //Remove the first expired timer from the list
+   timer = wheel->expired;
+   netTimerStop(timer);
+
+   //Return the expired timer
+   return timer;
+}
+
+
+/**
+ * @brief Get the time left before the next tick that has work to do
+ * @param[in] wheel Pointer to the timer wheel
+ * @return Delay in milliseconds, or INFINITE_DELAY if no timer is armed
+ **/
+
+time_t netTimerWheelGetDelay(NetTimerWheel *wheel)
+{
+   uint_t i;
+   uint_t level;
+   uint32_t ticks;
+   time_t elapsed;
+
+   //Callbacks are still pending?
+   if(wheel->expired != NULL)
+      return 0;
+
+   //Timers of the first level are hashed by their exact expiration tick
+   for(ticks = 0, i = 1; i < NET_TIMER_SLOT_COUNT; i++)
+   {
+      if(wheel->slot[0][(wheel->tick + i) & NET_TIMER_SLOT_MASK] != NULL)
+      {
+         ticks = i;
+         break;
+      }
+   }
+
+   //The coarser levels must be cascaded at the next wrap around
+   for(level = 1; level < NET_TIMER_LEVEL_COUNT; level++)
+   {
+      for(i = 0; i < NET_TIMER_SLOT_COUNT; i++)
+      {
+         if(wheel->slot[level][i] != NULL)
+            break;
+      }
+
+      //Any timer found?
+      if(i < NET_TIMER_SLOT_COUNT)
+      {
+         //Number of ticks before the next cascade
+         i = NET_TIMER_SLOT_COUNT - (wheel->tick & NET_TIMER_SLOT_MASK);
+         //Keep the earliest event
+         if(!ticks || i < ticks)
+            ticks = i;
+         break;
+      }
+   }
+
+   //No timer is armed?
+   if(!ticks)
+      return INFINITE_DELAY;
+
+   //Time elapsed since the last tick
+   elapsed = osGetTickCount() - wheel->lastTime;
+
+   //Return the time left before the relevant tick
+   if(elapsed >= (ticks * wheel->interval))
+      return 0;
+   else
+      return ticks * wheel->interval - elapsed;
+}
+
+
+/**
+ * @brief Arm a timer
+ *
+ * A timer that is already armed is rescheduled
+ *
+ * @param[in] wheel Pointer to the timer wheel
+ * @param[in] timer Pointer to the timer entry
+ * @param[in] delay Time before expiration, in milliseconds
+ * @param[in] callback Function called upon expiration
+ * @param[in] param Callback parameter
+ **/
+
+void netTimerStart(NetTimerWheel *wheel, NetTimer *timer,
+   time_t delay, NetTimerCallback callback, void *param)
+{
+   uint32_t ticks;
+
+   //Remove the timer from its current slot, if any
+   netTimerStop(timer);
+
+   //The timer must not expire before the requested delay, although the
+   //current tick has already started
+   ticks = (osGetTickCount() - wheel->lastTime + delay + wheel->interval - 1) / wheel->interval;
+
+   //Save timer parameters
+   timer->expiry = wheel->tick + max(ticks, 1);
+   timer->callback = callback;
+   timer->param = param;
+
+   //Hash the timer into the appropriate slot
+   netTimerInsert(wheel, timer);
+}
+
+
+/**
+ * @brief Cancel a timer
+ * @param[in] timer Pointer to the timer entry
+ **/
+
+void netTimerStop(NetTimer *timer)
+{
+   //Make sure the timer is armed
+   if(timer->prev != NULL)
+   {
+      //Unlink the entry
+      *timer->prev = timer->next;
+      if(timer->next != NULL)
+         timer->next->prev = timer->prev;
+
+      //The timer is no longer armed
+      timer->next = NULL;
+      timer->prev = NULL;
+   }
+}
+
+
+/**
+ * @brief Check whether a timer is armed
+ * @param[in] timer Pointer to the timer entry
+ * @return TRUE if the timer is armed, else FALSE
+ **/
+
+bool_t netTimerRunning(NetTimer *timer)
+{
+   return (timer->prev != NULL) ? TRUE : FALSE;
+}
+
+
+/**
+ * @brief Hash a timer into the appropriate slot
+ * @param[in] wheel Pointer to the timer wheel
+ * @param[in] timer Pointer to the timer entry
+ **/
+
+static void netTimerInsert(NetTimerWheel *wheel, NetTimer *timer)
+{
+   uint_t level;
+   uint32_t ticks;
+   uint32_t expiry;
+   NetTimer **slot;
+
+   //Number of ticks before expiration
+   ticks = timer->expiry - wheel->tick;
+   expiry = timer->expiry;
+
+   //Timers beyond the range of the wheel are parked in the last slot
+   //to be visited, and rehashed when that slot is cascaded
+   if(ticks >= NET_TIMER_MAX_TICKS)
+      expiry = wheel->tick + NET_TIMER_MAX_TICKS - 1;
+
+   //Select the finest level that can hold the timer
+   if(ticks < NET_TIMER_SLOT_COUNT)
+      level = 0;
+   else if(ticks < (NET_TIMER_SLOT_COUNT * NET_TIMER_SLOT_COUNT))
+      level = 1;
+   else
+      level = 2;
+
+   //Point to the relevant slot
+   slot = &wheel->slot[level][(expiry >> (level * NET_TIMER_SLOT_BITS)) & NET_TIMER_SLOT_MASK];
+
+   //Insert the timer at the head of the list
+   timer->next = *slot;
+   timer->prev = slot;
+   if(*slot != NULL)
+      (*slot)->prev = &timer->next;
+   *slot = timer;
+}
+
+
+/**
+ * @brief Move the timers of the current slot of a level to finer levels
+ * @param[in] wheel Pointer to the timer wheel
+ * @param[in] level Level to be cascaded
+ **/
+
+static void netTimerCascade(NetTimerWheel *wheel, uint_t level)
+{
+   uint_t index;
+   NetTimer *list;
+   NetTimer *timer;
+
+   //Current slot of the specified level
+   index = (wheel->tick >> (level * NET_TIMER_SLOT_BITS)) & NET_TIMER_SLOT_MASK;
+
+   //Detach the list of timers from the wheel
+   list = wheel->slot[level][index];
+   wheel->slot[level][index] = NULL;
+
+   //Rehash each timer according to the time left
+   while(list != NULL)
+   {
+      timer = list;
+      list = timer->next;
+      netTimerInsert(wheel, timer);
+   }
+}
+
+
+/**
+ * @brief Check whether a wheel holds no timer
+ * @param[in] wheel Pointer to the timer wheel
+ * @return TRUE if no timer is armed, else FALSE
+ **/
+
+static bool_t netTimerWheelEmpty(NetTimerWheel *wheel)
+{
+   uint_t i;
+   uint_t level;
+
+   //Loop through the slots
+   for(level = 0; level < NET_TIMER_LEVEL_COUNT; level++)
+   {
+      for(i = 0; i < NET_TIMER_SLOT_COUNT; i++)
+      {
+         if(wheel->slot[level][i] != NULL)
+            return FALSE;
+      }
+   }
+
+   //No timer is armed
+   return TRUE;
+}
+
+
+/**
+ * @brief Timer service initialization
+ * @param[in] event Event used to wake up the task running the service
+ *   (NULL to create a dedicated event)
+ * @return Error code
+ **/
+
+error_t netTimerServiceInit(OsEvent *event)
+{
+   //Initialize the wheel shared by the whole stack
+   netTimerWheelInit(&netTimerServiceWheel, NET_TIMER_SERVICE_TICK_INTERVAL);
+
+   //Create a mutex to serialize access to the wheel
+   netTimerServiceMutex = osMutexCreateNamed(FALSE, "NetTimerService");
+   //Out of resources?
+   if(netTimerServiceMutex == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //The task may also wait for other events on the same object
+   if(event != NULL)
+      netTimerServiceEvent = event;
+   else
+      netTimerServiceEvent = osEventCreateSingleWaiter(FALSE);
+
+   //Out of resources?
+   if(netTimerServiceEvent == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //The tick task is not sleeping yet
+   netTimerServiceSleeping = FALSE;
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Arm a timer of the timer service
+ *
+ * This function may be called from any task. The callback is invoked
+ * from the TCP/IP stack tick task, outside of any critical section of
+ * the timer service
+ *
+ * @param[in] timer Pointer to the timer entry
+ * @param[in] delay Time before expiration, in milliseconds
+ * @param[in] callback Function called upon expiration
+ * @param[in] param Callback parameter
+ **/
+
+void netTimerServiceStart(NetTimer *timer, time_t delay,
+   NetTimerCallback callback, void *param)
+{
+   //Enter critical section
+   osMutexAcquire(netTimerServiceMutex);
+
+   //Arm the timer
+   netTimerStart(&netTimerServiceWheel, timer, delay, callback, param);
+
+   //Wake up the tick task if it sleeps beyond the new deadline
+   if(netTimerServiceSleeping && (netTimerServiceDeadline == INFINITE_DELAY ||
+      timeCompare(osGetTickCount() + delay, netTimerServiceDeadline) < 0))
+   {
+      //The tick task will compute a new deadline
+      netTimerServiceSleeping = FALSE;
+      osEventSet(netTimerServiceEvent);
+   }
+
+   //Leave critical section
+   osMutexRelease(netTimerServiceMutex);
+}
+
+
+/**
+ * @brief Cancel a timer of the timer service
+ *
+ * A callback that has already been retrieved by the tick task may still
+ * be invoked once
+ *
+ * @param[in] timer Pointer to the timer entry
+ **/
+
+void netTimerServiceStop(NetTimer *timer)
+{
+   //Enter critical section
+   osMutexAcquire(netTimerServiceMutex);
+   //Cancel the timer
+   netTimerStop(timer);
+   //Leave critical section
+   osMutexRelease(netTimerServiceMutex);
+}
+
+
+/**
+ * @brief Sleep until the next timer of the timer service expires
+ **/
+
+void netTimerServiceWait(void)
+{
+   time_t delay;
+
+   //Enter critical section
+   osMutexAcquire(netTimerServiceMutex);
+
+   //Time left before the next deadline
+   delay = netTimerWheelGetDelay(&netTimerServiceWheel);
+
+   //Save the deadline so that earlier timers can wake up the task
+   netTimerServiceSleeping = TRUE;
+
+   //No timer is armed?
+   if(delay == INFINITE_DELAY)
+      netTimerServiceDeadline = INFINITE_DELAY;
+   else
+      netTimerServiceDeadline = osGetTickCount() + delay;
+
+   //Leave critical section
+   osMutexRelease(netTimerServiceMutex);
+
+   //Wait for the deadline or for a timer to be armed earlier
+   if(delay > 0)
+      osEventWait(netTimerServiceEvent, delay);
+
+   //Enter critical section
+   osMutexAcquire(netTimerServiceMutex);
+   //The task is now awake
+   netTimerServiceSleeping = FALSE;
+   //Leave critical section
+   osMutexRelease(netTimerServiceMutex);
+}
+
+
+/**
+ * @brief Invoke the callbacks of the expired timers of the timer service
+ *
+ * This function is called by the TCP/IP stack tick task. Callbacks may
+ * arm or cancel any timer of the timer service
+ *
+ **/
+
+void netTimerServiceRun(void)
+{
+   NetTimer *timer;
+   NetTimerCallback callback;
+   void *param;
+
+   //Process the expired timers one at a time
+   while(1)
+   {
+      //Enter critical section
+      osMutexAcquire(netTimerServiceMutex);
+
+      //Retrieve the next expired timer
+      timer = netTimerWheelPoll(&netTimerServiceWheel);
+
+      //Save the callback before leaving the critical section
+      if(timer != NULL)
+      {
+         callback = timer->callback;
+         param = timer->param;
+      }
+
+      //Leave critical section
+      osMutexRelease(netTimerServiceMutex);
+
+      //No more expired timer?
+      if(timer == NULL)
+         break;
+
+      //Invoke the callback outside of the critical section
+      callback(param);
+   }
+}
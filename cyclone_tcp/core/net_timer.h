@@ -0,0 +1,114 @@
+/**
+ * @file net_timer.h
+ * @brief Hierarchical timer wheel
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _NET_TIMER_H
+#define _NET_TIMER_H
+
+//Dependencies
+#include "os.h"
+
+//Number of slots per level (expressed as a power of two)
+#define NET_TIMER_SLOT_BITS 6
+#define NET_TIMER_SLOT_COUNT (1 << NET_TIMER_SLOT_BITS)
+#define NET_TIMER_SLOT_MASK (NET_TIMER_SLOT_COUNT - 1)
+
+//Number of levels of the wheel
+#define NET_TIMER_LEVEL_COUNT 3
+
+//Longest delay, in ticks, that the wheel can represent
+#define NET_TIMER_MAX_TICKS (1UL << (NET_TIMER_SLOT_BITS * NET_TIMER_LEVEL_COUNT))
+
+//Resolution of the timer service
+#ifndef NET_TIMER_SERVICE_TICK_INTERVAL
+   #define NET_TIMER_SERVICE_TICK_INTERVAL 10
+#elif (NET_TIMER_SERVICE_TICK_INTERVAL < 1)
+   #error NET_TIMER_SERVICE_TICK_INTERVAL parameter is invalid
+#endif
+
+
+/**
+ * @brief Timer expiration callback
+ **/
+
+typedef void (*NetTimerCallback)(void *param);
+
+
+/**
+ * @brief Timer entry
+ **/
+
+typedef struct _NetTimer
+{
+   struct _NetTimer *next;    ///<Next entry in the same slot
+   struct _NetTimer **prev;   ///<Link that references this entry (NULL if the timer is not armed)
+   uint32_t expiry;           ///<Tick at which the timer expires
+   NetTimerCallback callback; ///<Function called upon expiration
+   void *param;               ///<Callback parameter
+} NetTimer;
+
+
+/**
+ * @brief Timer wheel
+ *
+ * The wheel does not protect itself against concurrent access. All
+ * the operations on a given wheel must be serialized by the owner
+ **/
+
+typedef struct
+{
+   time_t interval;   ///<Duration of a tick
+   time_t lastTime;   ///<Time at which the last tick was processed
+   uint32_t tick;     ///<Last processed tick
+   NetTimer *expired; ///<Expired timers whose callbacks have not been invoked yet
+   NetTimer *slot[NET_TIMER_LEVEL_COUNT][NET_TIMER_SLOT_COUNT]; ///<Pending timers
+} NetTimerWheel;
+
+
+//Timer wheel related functions
+void netTimerWheelInit(NetTimerWheel *wheel, time_t interval);
+void netTimerWheelAdvance(NetTimerWheel *wheel);
+NetTimer *netTimerWheelPoll(NetTimerWheel *wheel);
+time_t netTimerWheelGetDelay(NetTimerWheel *wheel);
+
+void netTimerStart(NetTimerWheel *wheel, NetTimer *timer,
+   time_t delay, NetTimerCallback callback, void *param);
+
+void netTimerStop(NetTimer *timer);
+bool_t netTimerRunning(NetTimer *timer);
+
+//Timer service related functions
+error_t netTimerServiceInit(OsEvent *event);
+
+void netTimerServiceStart(NetTimer *timer, time_t delay,
+   NetTimerCallback callback, void *param);
+
+void netTimerServiceStop(NetTimer *timer);
+void netTimerServiceWait(void);
+void netTimerServiceRun(void);
+
+#endif
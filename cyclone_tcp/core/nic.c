@@ -35,11 +35,28 @@
 #include "socket.h"
 #include "igmp.h"
 #include "mld.h"
+#include "slaac.h"
 #include "tcp_misc.h"
 #include "udp.h"
 #include "raw_socket.h"
+#include "probe.h"
 #include "debug.h"
 
+//Hand a frame over to the driver
+static error_t nicTransmit(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset);
+
+//Transmitter locking
+static void nicTxAcquire(NetInterface *interface);
+static void nicTxRelease(NetInterface *interface);
+
+#if (NIC_TX_QUEUE_SUPPORT == ENABLED)
+//Transmit queue related functions
+static error_t nicEnqueuePacket(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset);
+static uint_t nicGetTxPriority(const ChunkedBuffer *buffer, size_t offset);
+#endif
+
 
 /**
  * @brief Ethernet controller timer handler
@@ -55,13 +72,13 @@ void nicTick(NetInterface *interface)
    //Get exclusive access to the device
    osMutexAcquire(interface->nicDriverMutex);
    //Disable interrupts
-   interface->nicDriver->disableIrq(interface);
+   nicDriverDisableIrq(interface);
 
    //Handle periodic operations
-   interface->nicDriver->tick(interface);
+   nicDriverTick(interface);
 
    //Re-enable interrupts
-   interface->nicDriver->enableIrq(interface);
+   nicDriverEnableIrq(interface);
    //Release exclusive access to the device
    osMutexRelease(interface->nicDriverMutex);
 }
@@ -80,13 +97,13 @@ error_t nicSetMacFilter(NetInterface *interface)
    //Get exclusive access to the device
    osMutexAcquire(interface->nicDriverMutex);
    //Disable interrupts
-   interface->nicDriver->disableIrq(interface);
+   nicDriverDisableIrq(interface);
 
    //Update MAC filter table
-   error = interface->nicDriver->setMacFilter(interface);
+   error = nicDriverSetMacFilter(interface);
 
    //Re-enable interrupts
-   interface->nicDriver->enableIrq(interface);
+   nicDriverEnableIrq(interface);
    //Release exclusive access to the device
    osMutexRelease(interface->nicDriverMutex);
 
@@ -116,29 +133,561 @@ error_t nicSendPacket(NetInterface *interface, const ChunkedBuffer *buffer, size
    TRACE_DEBUG_CHUNKED_BUFFER("  ", buffer, offset, length);
 #endif
 
+   //Instrumentation point
+   PROBE_ENTER(PROBE_NIC_SEND_PACKET);
+   //Capture tap
+   NET_CAPTURE_TX(interface, buffer, offset);
+
+#if (NIC_TX_QUEUE_SUPPORT == ENABLED)
+   //Send the frame right away or defer it to the TX task
+   error = nicEnqueuePacket(interface, buffer, offset);
+#else
    //Wait for the transmitter to be ready to send
    osEventWait(interface->nicTxEvent, INFINITE_DELAY);
 
-   //Get exclusive access to the device
-   osMutexAcquire(interface->nicDriverMutex);
-   //Disable interrupts
-   interface->nicDriver->disableIrq(interface);
-
+   //Get exclusive access to the transmitter
+   nicTxAcquire(interface);
    //Send Ethernet frame
-   error = interface->nicDriver->sendPacket(interface, buffer, offset);
+   error = nicTransmit(interface, buffer, offset);
+   //Release exclusive access to the transmitter
+   nicTxRelease(interface);
+#endif
 
-   //Re-enable interrupts
-   interface->nicDriver->enableIrq(interface);
-   //Release exclusive access to the device
-   osMutexRelease(interface->nicDriverMutex);
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Hand a frame over to the driver
+ *
+ * The caller must hold the TX lock of the interface. Drivers whose
+ * transmit path is independent from the RX path are not shielded from
+ * their own interrupts, since the RX task may be using them concurrently
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] buffer Multi-part buffer containing the data to send
+ * @param[in] offset Offset to the first data byte
+ * @return Error code
+ **/
+
+static error_t nicTransmit(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset)
+{
+   error_t error;
+
+   //Separate TX and RX locking domains?
+   if(interface->nicDriver->splitTxRxLocking)
+   {
+      //Send Ethernet frame
+      error = nicDriverSendPacket(interface, buffer, offset);
+   }
+   else
+   {
+      //Disable interrupts
+      nicDriverDisableIrq(interface);
+      //Send Ethernet frame
+      error = nicDriverSendPacket(interface, buffer, offset);
+      //Re-enable interrupts
+      nicDriverEnableIrq(interface);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Get exclusive access to the transmitter
+ * @param[in] interface Underlying network interface
+ **/
+
+static void nicTxAcquire(NetInterface *interface)
+{
+#if (NIC_TX_BATCH_SUPPORT == ENABLED)
+   //The task sending a train of frames already holds the lock
+   if(interface->nicTxBatchOwner == osTaskGetHandle())
+      return;
+#endif
+
+   //Get exclusive access to the transmitter
+   osMutexAcquire(interface->nicTxMutex);
+}
+
+
+/**
+ * @brief Release exclusive access to the transmitter
+ * @param[in] interface Underlying network interface
+ **/
+
+static void nicTxRelease(NetInterface *interface)
+{
+#if (NIC_TX_BATCH_SUPPORT == ENABLED)
+   //The lock is kept until the end of the train
+   if(interface->nicTxBatchOwner == osTaskGetHandle())
+      return;
+#endif
+
+   //Release exclusive access to the transmitter
+   osMutexRelease(interface->nicTxMutex);
+}
+
+
+/**
+ * @brief Start sending a train of frames
+ *
+ * The transmitter is locked once for the whole train. Frames sent by
+ * the calling task are handed back to back to the driver until
+ * nicEndTxBatch is called. Batches cannot be nested
+ *
+ * @param[in] interface Underlying network interface
+ **/
+
+void nicBeginTxBatch(NetInterface *interface)
+{
+#if (NIC_TX_BATCH_SUPPORT == ENABLED)
+   //Get exclusive access to the transmitter
+   osMutexAcquire(interface->nicTxMutex);
+   //Subsequent frames sent by this task do not take the lock again
+   interface->nicTxBatchOwner = osTaskGetHandle();
+#endif
+}
+
+
+/**
+ * @brief Finish sending a train of frames
+ * @param[in] interface Underlying network interface
+ **/
+
+void nicEndTxBatch(NetInterface *interface)
+{
+#if (NIC_TX_BATCH_SUPPORT == ENABLED)
+   //The train is complete
+   interface->nicTxBatchOwner = NULL;
+   //Release exclusive access to the transmitter
+   osMutexRelease(interface->nicTxMutex);
+#endif
+}
+
+
+#if (NIC_TX_QUEUE_SUPPORT == ENABLED)
+
+/**
+ * @brief Send a frame without waiting for the transmitter
+ *
+ * The frame is handed to the driver immediately when the transmitter is
+ * ready and no other frame is pending. Otherwise a copy of the frame is
+ * appended to the transmit queue matching its priority and sent later
+ * on by the TX task
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] buffer Multi-part buffer containing the data to send
+ * @param[in] offset Offset to the first data byte
+ * @return Error code
+ **/
+
+static error_t nicEnqueuePacket(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset)
+{
+   error_t error;
+   uint_t i;
+   size_t length;
+   ChunkedBuffer *frame;
+
+   //Retrieve the length of the frame
+   length = chunkedBufferGetLength(buffer) - offset;
+
+   //Get exclusive access to the transmitter
+   nicTxAcquire(interface);
+
+   //Send the frame right away if the transmitter is ready and no
+   //other frame is queued ahead of it
+   if(interface->nicTxQueueCount == 0 && osEventWait(interface->nicTxEvent, 0))
+   {
+      //Send Ethernet frame
+      error = nicTransmit(interface, buffer, offset);
+
+      //Release exclusive access to the transmitter
+      nicTxRelease(interface);
+      //Return status code
+      return error;
+   }
+
+#if (NIC_TX_QUEUE_BLOCKING == ENABLED)
+   //Application tasks wait for room in the transmit queue, whereas the
+   //RX and tick tasks of the stack never block
+   while(interface->nicTxQueueCount >= NIC_TX_QUEUE_SIZE &&
+      osTaskGetHandle() != interface->rxTask && osTaskGetHandle() != interface->tickTask)
+   {
+#if (NIC_TX_BATCH_SUPPORT == ENABLED)
+      //The TX task cannot make progress while a train is being sent
+      if(interface->nicTxBatchOwner == osTaskGetHandle())
+         break;
+#endif
+
+      //Release exclusive access to the transmitter
+      osMutexRelease(interface->nicTxMutex);
+      //Wait for the TX task to send some of the pending frames
+      osEventWait(interface->nicTxQueueSpaceEvent, INFINITE_DELAY);
+      //Get exclusive access to the transmitter
+      osMutexAcquire(interface->nicTxMutex);
+   }
+#endif
+
+   //The transmit queue is full?
+   if(interface->nicTxQueueCount >= NIC_TX_QUEUE_SIZE)
+   {
+      //Release exclusive access to the transmitter
+      nicTxRelease(interface);
+      //Debug message
+      TRACE_WARNING("Transmit queue full, frame dropped!\r\n");
+      //The frame is dropped
+      return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //The caller releases the buffer as soon as the function returns,
+   //so keep a private reference to the frame
+   frame = chunkedBufferClone(buffer, offset, length);
+
+   //Successful memory allocation?
+   if(frame != NULL)
+   {
+      //Select the queue matching the priority of the frame
+      i = nicGetTxPriority(frame, 0);
+
+      //Append the frame to the selected queue. Since the queues share
+      //the same budget, none of them can overflow
+      interface->nicTxQueue[i][(interface->nicTxQueueHead[i] +
+         interface->nicTxQueueLength[i]) % NIC_TX_QUEUE_SIZE] = frame;
+      interface->nicTxQueueLength[i]++;
+      interface->nicTxQueueCount++;
+
+      //Notify the TX task
+      osEventSet(interface->nicTxQueueEvent);
+      //Successful processing
+      error = NO_ERROR;
+   }
+   else
+   {
+      //Not enough memory to queue the frame
+      error = ERROR_OUT_OF_MEMORY;
+   }
+
+   //Release exclusive access to the transmitter
+   nicTxRelease(interface);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send the frames pending in the transmit queue
+ *
+ * This function is called by the TX task. It waits for the transmitter
+ * to be ready before handing each queued frame to the driver. Queues
+ * are served in strict priority order, and frames of a given priority
+ * are sent in order
+ *
+ * @param[in] interface Underlying network interface
+ **/
+
+void nicProcessTxQueue(NetInterface *interface)
+{
+   uint_t i;
+   uint_t count;
+   ChunkedBuffer *frame;
+
+   //Send the pending frames
+   while(1)
+   {
+      //Get exclusive access to the transmitter
+      osMutexAcquire(interface->nicTxMutex);
+      //Check whether the transmit queue is empty
+      count = interface->nicTxQueueCount;
+      //Release exclusive access to the transmitter
+      osMutexRelease(interface->nicTxMutex);
+
+      //No more frames to send?
+      if(count == 0) break;
+
+      //Wait for the transmitter to be ready to send. No other task can
+      //consume the event while the queue is not empty
+      osEventWait(interface->nicTxEvent, INFINITE_DELAY);
+
+      //Get exclusive access to the transmitter
+      osMutexAcquire(interface->nicTxMutex);
+
+      //Select the highest priority queue that holds a frame. A frame
+      //queued while waiting for the transmitter overtakes lower priority
+      //frames
+      for(i = NIC_TX_PRIORITY_COUNT - 1; i > 0 && !interface->nicTxQueueLength[i]; i--);
+
+      //Remove the frame from the head of the selected queue
+      frame = interface->nicTxQueue[i][interface->nicTxQueueHead[i]];
+      interface->nicTxQueueHead[i] = (interface->nicTxQueueHead[i] + 1) % NIC_TX_QUEUE_SIZE;
+      interface->nicTxQueueLength[i]--;
+      interface->nicTxQueueCount--;
+
+      //Send Ethernet frame
+      nicTransmit(interface, frame, 0);
+
+      //Release exclusive access to the transmitter
+      osMutexRelease(interface->nicTxMutex);
+
+      //Drop the reference to the frame
+      chunkedBufferFree(frame);
+
+#if (NIC_TX_QUEUE_BLOCKING == ENABLED)
+      //Room is now available in the transmit queue
+      osEventSet(interface->nicTxQueueSpaceEvent);
+#endif
+   }
+}
+
+
+/**
+ * @brief Determine the priority of an outgoing frame
+ *
+ * The priority is derived from the precedence bits of the DS field
+ * (IPv4 Type of Service or IPv6 Traffic Class). ARP messages are sent
+ * with the highest priority since they are needed to deliver any other
+ * traffic
+ *
+ * @param[in] buffer Multi-part buffer containing the frame
+ * @param[in] offset Offset to the first byte of the frame
+ * @return Index of the transmit queue, from 0 (lowest priority)
+ *   to NIC_TX_PRIORITY_COUNT - 1 (highest priority)
+ **/
+
+static uint_t nicGetTxPriority(const ChunkedBuffer *buffer, size_t offset)
+{
+#if (NIC_TX_PRIORITY_COUNT > 1)
+   uint8_t tos;
+   uint16_t type;
+   uint8_t header[2];
+
+   //Retrieve the EtherType field
+   if(chunkedBufferRead(&type, buffer, offset + offsetof(EthHeader, type), sizeof(type)) != sizeof(type))
+      return 0;
+   //Read the first bytes of the encapsulated packet
+   if(chunkedBufferRead(header, buffer, offset + sizeof(EthHeader), sizeof(header)) != sizeof(header))
+      return 0;
+
+   //Check the type of the encapsulated packet
+   switch(ntohs(type))
+   {
+   //ARP message?
+   case ETH_TYPE_ARP:
+      //Address resolution precedes any other traffic
+      return NIC_TX_PRIORITY_COUNT - 1;
+   //IPv4 packet?
+   case ETH_TYPE_IPV4:
+      //The Type of Service field follows the Version/IHL byte
+      tos = header[1];
+      break;
+   //IPv6 packet?
+   case ETH_TYPE_IPV6:
+      //The Traffic Class field straddles the first two bytes
+      tos = (header[0] << 4) | (header[1] >> 4);
+      break;
+   //Unknown protocol?
+   default:
+      //Best effort traffic
+      return 0;
+   }
+
+   //Spread the 8 precedence levels over the available queues
+   return (IP_TOS_TO_PRIORITY(tos) * NIC_TX_PRIORITY_COUNT) / (IP_MAX_PRIORITY + 1);
+#else
+   //A single queue is used
+   return 0;
+#endif
+}
+
+#endif
+
+
+#if (NIC_LOOPBACK_SUPPORT == ENABLED)
+
+/**
+ * @brief Send a packet to the local host
+ *
+ * The packet bypasses the network controller. It is appended to the
+ * loopback queue and delivered later on by the RX task, since the caller
+ * may hold locks that the receive path needs to acquire
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] buffer Multi-part buffer containing the IP packet
+ * @param[in] offset Offset to the first byte of the IP header
+ * @return Error code
+ **/
+
+error_t nicLoopbackSendPacket(NetInterface *interface, const ChunkedBuffer *buffer, size_t offset)
+{
+   error_t error;
+   size_t length;
+   ChunkedBuffer *packet;
+
+   //Retrieve the length of the packet
+   length = chunkedBufferGetLength(buffer) - offset;
+
+   //Get exclusive access to the loopback queue
+   osMutexAcquire(interface->nicLoopbackMutex);
+
+   //The loopback queue is full?
+   if(interface->nicLoopbackQueueCount >= NIC_LOOPBACK_QUEUE_SIZE)
+   {
+      //Release exclusive access to the loopback queue
+      osMutexRelease(interface->nicLoopbackMutex);
+      //Debug message
+      TRACE_WARNING("Loopback queue full, packet dropped!\r\n");
+      //The packet is dropped
+      return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //The caller releases the buffer as soon as the function returns,
+   //so keep a private reference to the packet
+   packet = chunkedBufferClone(buffer, offset, length);
+
+   //Successful memory allocation?
+   if(packet != NULL)
+   {
+      //Append the packet to the loopback queue
+      interface->nicLoopbackQueue[(interface->nicLoopbackQueueHead +
+         interface->nicLoopbackQueueCount) % NIC_LOOPBACK_QUEUE_SIZE] = packet;
+      interface->nicLoopbackQueueCount++;
+
+      //Notify the RX task
+      osEventSet(interface->nicRxEvent);
+      //Successful processing
+      error = NO_ERROR;
+   }
+   else
+   {
+      //Not enough memory to queue the packet
+      error = ERROR_OUT_OF_MEMORY;
+   }
+
+   //Release exclusive access to the loopback queue
+   osMutexRelease(interface->nicLoopbackMutex);
 
    //Return status code
    return error;
 }
 
 
+/**
+ * @brief Deliver the packets pending in the loopback queue
+ *
+ * This function is called by the RX task. Looped back packets never
+ * left the host, so their checksums need not be verified
+ *
+ * @param[in] interface Underlying network interface
+ **/
+
+void nicProcessLoopbackQueue(NetInterface *interface)
+{
+   size_t length;
+   uint8_t *version;
+   ChunkedBuffer *packet;
+
+   //Deliver the pending packets in order
+   while(1)
+   {
+      //Get exclusive access to the loopback queue
+      osMutexAcquire(interface->nicLoopbackMutex);
+
+      //Check whether the loopback queue is empty
+      if(interface->nicLoopbackQueueCount > 0)
+      {
+         //Remove the packet from the head of the queue
+         packet = interface->nicLoopbackQueue[interface->nicLoopbackQueueHead];
+         interface->nicLoopbackQueueHead = (interface->nicLoopbackQueueHead + 1) % NIC_LOOPBACK_QUEUE_SIZE;
+         interface->nicLoopbackQueueCount--;
+      }
+      else
+      {
+         //No more packets to deliver
+         packet = NULL;
+      }
+
+      //Release exclusive access to the loopback queue
+      osMutexRelease(interface->nicLoopbackMutex);
+
+      //The queue is empty?
+      if(packet == NULL) break;
+
+      //Retrieve the length of the packet
+      length = chunkedBufferGetLength(packet);
+      //Point to the version field
+      version = chunkedBufferAt(packet, 0);
+
+      //Debug message
+      TRACE_DEBUG("Loopback packet received (%u bytes)...\r\n", length);
+
+      //The packet was generated by the local host
+      interface->nicRxChecksumFlags = NIC_RX_CHECKSUM_IP | NIC_RX_CHECKSUM_PAYLOAD;
+      interface->nicRxLoopback = TRUE;
+
+#if (IPV4_SUPPORT == ENABLED)
+      //IPv4 packet?
+      if(version != NULL && (*version >> 4) == IPV4_VERSION)
+      {
+         //The IPv4 layer expects the packet to be contiguous
+         if(packet->chunkCount == 1)
+         {
+            //Process IPv4 packet in place
+            ipv4ProcessPacket(interface, &interface->macAddr,
+               packet->chunk[0].address, length);
+         }
+         else if(length <= sizeof(interface->ethFrame))
+         {
+            //The frame buffer is not used by the RX task at this point
+            chunkedBufferRead(interface->ethFrame, packet, 0, length);
+            //Process IPv4 packet
+            ipv4ProcessPacket(interface, &interface->macAddr,
+               (Ipv4Header *) interface->ethFrame, length);
+         }
+      }
+      else
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+      //IPv6 packet?
+      if(version != NULL && (*version >> 4) == IPV6_VERSION)
+      {
+         //Process IPv6 packet
+         ipv6ProcessPacket(interface, &interface->macAddr, packet);
+      }
+      else
+#endif
+      //Unknown packet type?
+      {
+         //Debug message
+         TRACE_WARNING("Unknown loopback packet type!\r\n");
+      }
+
+      //Restore the default settings for the next frame
+      interface->nicRxChecksumFlags = 0;
+      interface->nicRxLoopback = FALSE;
+
+      //Drop the reference to the packet
+      chunkedBufferFree(packet);
+   }
+}
+
+#endif
+
+
 /**
  * @brief Handle a packet received by the network controller
+ *
+ * The packet may reside directly in the receive buffer of the DMA
+ * controller. The buffer is only loaned to the stack for the duration
+ * of the call, so any data that must outlive it has to be copied.
+ * Drivers that verify checksums in hardware report the outcome for the
+ * frame through the nicRxChecksumFlags field before calling this function
+ *
  * @param[in] interface Underlying network interface
  * @param[in] packet Incoming packet to process
  * @param[in] length Total packet length
@@ -147,7 +696,7 @@ error_t nicSendPacket(NetInterface *interface, const ChunkedBuffer *buffer, size
 void nicProcessPacket(NetInterface *interface, void *packet, size_t length)
 {
    //Re-enable interrupts
-   interface->nicDriver->enableIrq(interface);
+   nicDriverEnableIrq(interface);
    //Release exclusive access to the device
    osMutexRelease(interface->nicDriverMutex);
 
@@ -155,13 +704,17 @@ void nicProcessPacket(NetInterface *interface, void *packet, size_t length)
    TRACE_DEBUG("Packet received (%u bytes)...\r\n", length);
    TRACE_DEBUG_ARRAY("  ", packet, length);
 
+   //Capture tap
+   NET_CAPTURE_RX(interface, packet, length);
    //Process incoming Ethernet frame
    ethProcessFrame(interface, packet, length);
+   //The checksum status only applies to the current frame
+   interface->nicRxChecksumFlags = 0;
 
    //Get exclusive access to the device
    osMutexAcquire(interface->nicDriverMutex);
    //Disable interrupts
-   interface->nicDriver->disableIrq(interface);
+   nicDriverDisableIrq(interface);
 }
 
 
@@ -176,7 +729,7 @@ void nicNotifyLinkChange(NetInterface *interface)
    Socket *socket;
 
    //Re-enable interrupts
-   interface->nicDriver->enableIrq(interface);
+   nicDriverEnableIrq(interface);
    //Release exclusive access to the device
    osMutexRelease(interface->nicDriverMutex);
 
@@ -185,11 +738,6 @@ void nicNotifyLinkChange(NetInterface *interface)
    arpFlushCache(interface);
 #endif
 
-#if (IPV4_SUPPORT == ENABLED && IPV4_FRAG_SUPPORT == ENABLED)
-   //Flush the reassembly queue
-   ipv4FlushFragQueue(interface);
-#endif
-
 #if (IPV4_SUPPORT == ENABLED && IGMP_SUPPORT == ENABLED)
    //Notify IGMP of link state changes
    igmpLinkChangeEvent(interface);
@@ -200,9 +748,9 @@ void nicNotifyLinkChange(NetInterface *interface)
    ndpFlushCache(interface);
 #endif
 
-#if (IPV6_SUPPORT == ENABLED && IPV6_FRAG_SUPPORT == ENABLED)
+#if (IP_FRAG_SUPPORT == ENABLED)
    //Flush the reassembly queue
-   ipv6FlushFragQueue(interface);
+   ipFlushFragQueue(interface);
 #endif
 
 #if (IPV6_SUPPORT == ENABLED && MLD_SUPPORT == ENABLED)
@@ -210,11 +758,19 @@ void nicNotifyLinkChange(NetInterface *interface)
    mldLinkChangeEvent(interface);
 #endif
 
+#if (IPV6_SUPPORT == ENABLED)
+   //Restart DAD and solicit routers when the link comes up
+   slaacLinkChangeEvent(interface);
+#endif
+
    //Loop through opened sockets
    for(i = 0; i < SOCKET_MAX_COUNT; i++)
    {
       //Point to the current socket
-      socket = socketTable + i;
+      socket = socketTable[i];
+      //Skip unallocated descriptors
+      if(socket == NULL)
+         continue;
 
 #if (TCP_SUPPORT == ENABLED)
       //Connection-oriented socket?
@@ -236,5 +792,112 @@ void nicNotifyLinkChange(NetInterface *interface)
    //Get exclusive access to the device
    osMutexAcquire(interface->nicDriverMutex);
    //Disable interrupts
-   interface->nicDriver->disableIrq(interface);
+   nicDriverDisableIrq(interface);
+}
+
+
+/**
+ * @brief Initialize a descriptor ring
+ * @param[in] ring Pointer to the descriptor ring
+ * @param[in] loan Array that tracks the blocks loaned to the hardware
+ *   (one entry per descriptor, may be NULL if nothing is ever loaned)
+ * @param[in] size Number of descriptors in the ring
+ **/
+
+void nicRingInit(NicRing *ring, ChunkBlock **loan, uint_t size)
+{
+   uint_t i;
+
+   //Initialize ring state
+   ring->size = size;
+   ring->head = 0;
+   ring->tail = 0;
+   ring->count = 0;
+   ring->loan = loan;
+
+   //No block is loaned to the hardware yet
+   if(loan != NULL)
+   {
+      for(i = 0; i < size; i++)
+         loan[i] = NULL;
+   }
+}
+
+
+/**
+ * @brief Claim the next descriptor of a ring
+ *
+ * The caller must first make sure that a descriptor is available. The
+ * block holding the data, if any, is retained until the descriptor
+ * is reclaimed, so that the hardware can read it in place
+ *
+ * @param[in] ring Pointer to the descriptor ring
+ * @param[in] block Block referenced by the descriptor (NULL if the
+ *   descriptor points to a private buffer of the driver)
+ * @return Index of the descriptor to fill
+ **/
+
+uint_t nicRingProduce(NicRing *ring, ChunkBlock *block)
+{
+   uint_t index;
+
+   //Index of the descriptor to fill
+   index = ring->head;
+
+   //Keep the block alive while the hardware uses it
+   if(block != NULL)
+   {
+      chunkBlockRetain(block);
+      ring->loan[index] = block;
+   }
+
+   //Advance the producer index
+   ring->head = nicRingNext(ring, index);
+   ring->count++;
+
+   //Return the index of the descriptor
+   return index;
+}
+
+
+/**
+ * @brief Reclaim the descriptors the hardware is done with
+ *
+ * Descriptors are reclaimed in order, starting from the oldest one,
+ * and the blocks they loaned to the hardware are released in a batch
+ *
+ * @param[in] ring Pointer to the descriptor ring
+ * @param[in] isDone Callback that checks the ownership of a descriptor
+ * @return Number of descriptors that have been reclaimed
+ **/
+
+uint_t nicRingReclaim(NicRing *ring, NicRingDescDone isDone)
+{
+   uint_t n;
+   uint_t index;
+
+   //Walk the descriptors in flight from the oldest one
+   for(n = 0; ring->count > 0; n++)
+   {
+      //Index of the oldest descriptor
+      index = ring->tail;
+
+      //The hardware still owns the descriptor?
+      if(!isDone(index))
+         break;
+
+      //Drop the reference to the loaned block
+      if(ring->loan != NULL && ring->loan[index] != NULL)
+      {
+         chunkBlockRelease(ring->loan[index]);
+         ring->loan[index] = NULL;
+      }
+
+      //Advance the consumer index
+      ring->tail = nicRingNext(ring, index);
+      ring->count--;
+   }
+
+   //Return the number of reclaimed descriptors
+   return n;
 }
@@ -39,6 +39,62 @@
    #error NIC_TICK_INTERVAL parameter is invalid
 #endif
 
+//Maximum number of frames processed per RX event
+#ifndef NIC_RX_BUDGET
+   #define NIC_RX_BUDGET 8
+#elif (NIC_RX_BUDGET < 1)
+   #error NIC_RX_BUDGET parameter is invalid
+#endif
+
+//Software transmit queue support
+#ifndef NIC_TX_QUEUE_SUPPORT
+   #define NIC_TX_QUEUE_SUPPORT DISABLED
+#elif (NIC_TX_QUEUE_SUPPORT != ENABLED && NIC_TX_QUEUE_SUPPORT != DISABLED)
+   #error NIC_TX_QUEUE_SUPPORT parameter is invalid
+#endif
+
+//Maximum number of frames held in the transmit queue
+#ifndef NIC_TX_QUEUE_SIZE
+   #define NIC_TX_QUEUE_SIZE 8
+#elif (NIC_TX_QUEUE_SIZE < 1)
+   #error NIC_TX_QUEUE_SIZE parameter is invalid
+#endif
+
+//Number of priority levels of the transmit queue
+#ifndef NIC_TX_PRIORITY_COUNT
+   #define NIC_TX_PRIORITY_COUNT 1
+#elif (NIC_TX_PRIORITY_COUNT < 1 || NIC_TX_PRIORITY_COUNT > 8)
+   #error NIC_TX_PRIORITY_COUNT parameter is invalid
+#endif
+
+//Block application tasks when the transmit queue is full
+#ifndef NIC_TX_QUEUE_BLOCKING
+   #define NIC_TX_QUEUE_BLOCKING DISABLED
+#elif (NIC_TX_QUEUE_BLOCKING != ENABLED && NIC_TX_QUEUE_BLOCKING != DISABLED)
+   #error NIC_TX_QUEUE_BLOCKING parameter is invalid
+#endif
+
+//Allow a task to send a train of frames under a single lock
+#ifndef NIC_TX_BATCH_SUPPORT
+   #define NIC_TX_BATCH_SUPPORT DISABLED
+#elif (NIC_TX_BATCH_SUPPORT != ENABLED && NIC_TX_BATCH_SUPPORT != DISABLED)
+   #error NIC_TX_BATCH_SUPPORT parameter is invalid
+#endif
+
+//Loopback support for packets sent to the local host
+#ifndef NIC_LOOPBACK_SUPPORT
+   #define NIC_LOOPBACK_SUPPORT ENABLED
+#elif (NIC_LOOPBACK_SUPPORT != ENABLED && NIC_LOOPBACK_SUPPORT != DISABLED)
+   #error NIC_LOOPBACK_SUPPORT parameter is invalid
+#endif
+
+//Maximum number of packets held in the loopback queue
+#ifndef NIC_LOOPBACK_QUEUE_SIZE
+   #define NIC_LOOPBACK_QUEUE_SIZE 8
+#elif (NIC_LOOPBACK_QUEUE_SIZE < 1)
+   #error NIC_LOOPBACK_QUEUE_SIZE parameter is invalid
+#endif
+
 //Size of the NIC driver context
 #ifndef NIC_CONTEXT_SIZE
    #define NIC_CONTEXT_SIZE 8
@@ -46,6 +102,35 @@
    #error NIC_CONTEXT_SIZE parameter is invalid
 #endif
 
+//Bind the NIC driver at compile time
+#ifndef NIC_STATIC_DRIVER_SUPPORT
+   #define NIC_STATIC_DRIVER_SUPPORT DISABLED
+#elif (NIC_STATIC_DRIVER_SUPPORT != ENABLED && NIC_STATIC_DRIVER_SUPPORT != DISABLED)
+   #error NIC_STATIC_DRIVER_SUPPORT parameter is invalid
+#endif
+
+//Prefix of the statically bound NIC driver (e.g. stm32f4x7Eth)
+#if (NIC_STATIC_DRIVER_SUPPORT == ENABLED && !defined(NIC_STATIC_DRIVER))
+   #error NIC_STATIC_DRIVER parameter is not defined
+#endif
+
+//Bind the PHY driver at compile time
+#ifndef PHY_STATIC_DRIVER_SUPPORT
+   #define PHY_STATIC_DRIVER_SUPPORT DISABLED
+#elif (PHY_STATIC_DRIVER_SUPPORT != ENABLED && PHY_STATIC_DRIVER_SUPPORT != DISABLED)
+   #error PHY_STATIC_DRIVER_SUPPORT parameter is invalid
+#endif
+
+//Prefix of the statically bound PHY driver (e.g. lan8720)
+#if (PHY_STATIC_DRIVER_SUPPORT == ENABLED && !defined(PHY_STATIC_DRIVER))
+   #error PHY_STATIC_DRIVER parameter is not defined
+#endif
+
+//A single driver can be bound when only one interface is present
+#if (NIC_STATIC_DRIVER_SUPPORT == ENABLED && NET_INTERFACE_COUNT > 1)
+   #error NIC_STATIC_DRIVER_SUPPORT requires NET_INTERFACE_COUNT to be 1
+#endif
+
 //NIC abstraction layer
 typedef error_t (*NicInit)(NetInterface *interface);
 typedef void (*NicTick)(NetInterface *interface);
@@ -83,9 +168,46 @@ typedef struct
    bool_t autoPadding;
    bool_t autoCrcGen;
    bool_t autoCrcCheck;
+   bool_t autoChecksumGen;
+   bool_t autoChecksumCheck;
+   bool_t splitTxRxLocking;
+   size_t mtu;
 } NicDriver;
 
 
+/**
+ * @brief Descriptor ring
+ *
+ * Producer/consumer bookkeeping shared by the DMA-based drivers. The
+ * descriptors themselves keep the layout imposed by each controller;
+ * the ring only tracks which of them are in flight and which pool
+ * blocks are loaned to the hardware through them
+ **/
+
+typedef struct
+{
+   uint_t size;        ///<Number of descriptors in the ring
+   uint_t head;        ///<Next descriptor to be filled by the producer
+   uint_t tail;        ///<Oldest descriptor that has not been reclaimed yet
+   uint_t count;       ///<Number of descriptors in flight
+   ChunkBlock **loan;  ///<Block loaned to the hardware by each descriptor
+} NicRing;
+
+
+//Tell whether the hardware is done with a descriptor
+typedef bool_t (*NicRingDescDone)(uint_t index);
+
+//Index of the descriptor that follows the specified one
+#define nicRingNext(ring, index) (((index) + 1 < (ring)->size) ? (index) + 1 : 0)
+//Number of descriptors available to the producer
+#define nicRingGetFreeCount(ring) ((ring)->size - (ring)->count)
+
+
+//Checksums verified by the network controller on reception
+#define NIC_RX_CHECKSUM_IP      0x01
+#define NIC_RX_CHECKSUM_PAYLOAD 0x02
+
+
 /**
  * @brief PHY driver
  **/
@@ -100,11 +222,90 @@ typedef struct
 } PhyDriver;
 
 
+//Build the name of a driver entry point from its prefix
+#define NIC_STATIC_NAME(prefix, name) NIC_STATIC_NAME_(prefix, name)
+#define NIC_STATIC_NAME_(prefix, name) prefix##name
+
+#if (NIC_STATIC_DRIVER_SUPPORT == ENABLED)
+
+//Entry points of the statically bound NIC driver
+extern const NicDriver NIC_STATIC_NAME(NIC_STATIC_DRIVER, Driver);
+error_t NIC_STATIC_NAME(NIC_STATIC_DRIVER, Init)(NetInterface *interface);
+void NIC_STATIC_NAME(NIC_STATIC_DRIVER, Tick)(NetInterface *interface);
+void NIC_STATIC_NAME(NIC_STATIC_DRIVER, EnableIrq)(NetInterface *interface);
+void NIC_STATIC_NAME(NIC_STATIC_DRIVER, DisableIrq)(NetInterface *interface);
+void NIC_STATIC_NAME(NIC_STATIC_DRIVER, RxEventHandler)(NetInterface *interface);
+error_t NIC_STATIC_NAME(NIC_STATIC_DRIVER, SetMacFilter)(NetInterface *interface);
+error_t NIC_STATIC_NAME(NIC_STATIC_DRIVER, SendPacket)(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset);
+
+//Direct calls to the NIC driver
+#define nicDriverInit(interface) NIC_STATIC_NAME(NIC_STATIC_DRIVER, Init)(interface)
+#define nicDriverTick(interface) NIC_STATIC_NAME(NIC_STATIC_DRIVER, Tick)(interface)
+#define nicDriverEnableIrq(interface) NIC_STATIC_NAME(NIC_STATIC_DRIVER, EnableIrq)(interface)
+#define nicDriverDisableIrq(interface) NIC_STATIC_NAME(NIC_STATIC_DRIVER, DisableIrq)(interface)
+#define nicDriverRxEventHandler(interface) NIC_STATIC_NAME(NIC_STATIC_DRIVER, RxEventHandler)(interface)
+#define nicDriverSetMacFilter(interface) NIC_STATIC_NAME(NIC_STATIC_DRIVER, SetMacFilter)(interface)
+#define nicDriverSendPacket(interface, buffer, offset) \
+   NIC_STATIC_NAME(NIC_STATIC_DRIVER, SendPacket)(interface, buffer, offset)
+
+#else
+
+//Calls through the NIC driver table
+#define nicDriverInit(interface) (interface)->nicDriver->init(interface)
+#define nicDriverTick(interface) (interface)->nicDriver->tick(interface)
+#define nicDriverEnableIrq(interface) (interface)->nicDriver->enableIrq(interface)
+#define nicDriverDisableIrq(interface) (interface)->nicDriver->disableIrq(interface)
+#define nicDriverRxEventHandler(interface) (interface)->nicDriver->rxEventHandler(interface)
+#define nicDriverSetMacFilter(interface) (interface)->nicDriver->setMacFilter(interface)
+#define nicDriverSendPacket(interface, buffer, offset) \
+   (interface)->nicDriver->sendPacket(interface, buffer, offset)
+
+#endif
+
+#if (PHY_STATIC_DRIVER_SUPPORT == ENABLED)
+
+//Entry points of the statically bound PHY driver
+extern const PhyDriver NIC_STATIC_NAME(PHY_STATIC_DRIVER, PhyDriver);
+error_t NIC_STATIC_NAME(PHY_STATIC_DRIVER, Init)(NetInterface *interface);
+void NIC_STATIC_NAME(PHY_STATIC_DRIVER, Tick)(NetInterface *interface);
+void NIC_STATIC_NAME(PHY_STATIC_DRIVER, EnableIrq)(NetInterface *interface);
+void NIC_STATIC_NAME(PHY_STATIC_DRIVER, DisableIrq)(NetInterface *interface);
+bool_t NIC_STATIC_NAME(PHY_STATIC_DRIVER, EventHandler)(NetInterface *interface);
+
+//Direct calls to the PHY driver
+#define phyDriverInit(interface) NIC_STATIC_NAME(PHY_STATIC_DRIVER, Init)(interface)
+#define phyDriverTick(interface) NIC_STATIC_NAME(PHY_STATIC_DRIVER, Tick)(interface)
+#define phyDriverEnableIrq(interface) NIC_STATIC_NAME(PHY_STATIC_DRIVER, EnableIrq)(interface)
+#define phyDriverDisableIrq(interface) NIC_STATIC_NAME(PHY_STATIC_DRIVER, DisableIrq)(interface)
+#define phyDriverEventHandler(interface) NIC_STATIC_NAME(PHY_STATIC_DRIVER, EventHandler)(interface)
+
+#else
+
+//Calls through the PHY driver table
+#define phyDriverInit(interface) (interface)->phyDriver->init(interface)
+#define phyDriverTick(interface) (interface)->phyDriver->tick(interface)
+#define phyDriverEnableIrq(interface) (interface)->phyDriver->enableIrq(interface)
+#define phyDriverDisableIrq(interface) (interface)->phyDriver->disableIrq(interface)
+#define phyDriverEventHandler(interface) (interface)->phyDriver->eventHandler(interface)
+
+#endif
+
+
 //NIC abstraction layer
 void nicTick(NetInterface *interface);
 error_t nicSetMacFilter(NetInterface *interface);
 error_t nicSendPacket(NetInterface *interface, const ChunkedBuffer *buffer, size_t offset);
 void nicProcessPacket(NetInterface *interface, void *packet, size_t length);
+void nicProcessTxQueue(NetInterface *interface);
+void nicBeginTxBatch(NetInterface *interface);
+void nicEndTxBatch(NetInterface *interface);
+error_t nicLoopbackSendPacket(NetInterface *interface, const ChunkedBuffer *buffer, size_t offset);
+void nicProcessLoopbackQueue(NetInterface *interface);
 void nicNotifyLinkChange(NetInterface *interface);
 
+void nicRingInit(NicRing *ring, ChunkBlock **loan, uint_t size);
+uint_t nicRingProduce(NicRing *ring, ChunkBlock *block);
+uint_t nicRingReclaim(NicRing *ring, NicRingDescDone isDone);
+
 #endif
@@ -44,6 +44,9 @@
 //Check TCP/IP stack configuration
 #if (RAW_SOCKET_SUPPORT == ENABLED)
 
+//Raw sockets indexed by their protocol
+static Socket *rawSocketHashTable[RAW_SOCKET_HASH_TABLE_SIZE];
+
 
 /**
  * @brief Process incoming raw datagram
@@ -58,25 +61,51 @@ error_t rawSocketProcessDatagram(NetInterface *interface,
    IpPseudoHeader *pseudoHeader, const ChunkedBuffer *buffer, size_t offset)
 {
    uint_t i;
+   uint8_t protocol;
    size_t length;
    Socket *socket;
    SocketQueueItem *queueItem;
    ChunkedBuffer *p;
+#if (RAW_SOCKET_FILTER_SUPPORT == ENABLED)
+   uint32_t n;
+   bool_t filtered;
+
+   //No packet filter has been applied yet
+   filtered = FALSE;
+#endif
 
    //Retrieve the length of the raw datagram
    length = chunkedBufferGetLength(buffer) - offset;
 
+#if (IPV4_SUPPORT == ENABLED)
+   //An IPv4 packet was received?
+   if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
+      protocol = pseudoHeader->ipv4Data.protocol;
+   else
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //An IPv6 packet was received?
+   if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
+      protocol = pseudoHeader->ipv6Data.nextHeader;
+   else
+#endif
+   //An invalid packet was received?
+   {
+      //This should never occur...
+      return ERROR_PROTOCOL_UNREACHABLE;
+   }
+
    //Enter critical section
    osMutexAcquire(socketMutex);
 
-   //Loop through opened sockets
-   for(i = 0; i < SOCKET_MAX_COUNT; i++)
-   {
-      //Point to the current socket
-      socket = socketTable + i;
+   //Point to the relevant hash bucket
+   socket = rawSocketHashTable[protocol & (RAW_SOCKET_HASH_TABLE_SIZE - 1)];
 
-      //Raw socket found?
-      if(socket->type != SOCKET_TYPE_RAW)
+   //Walk through the sockets sharing the same hash value
+   for(; socket != NULL; socket = socket->hashNext)
+   {
+      //Check protocol field
+      if(socket->protocol != protocol)
          continue;
       //Check whether the socket is bound to a particular interface
       if(socket->interface && socket->interface != interface)
@@ -86,9 +115,6 @@ error_t rawSocketProcessDatagram(NetInterface *interface,
       //An IPv4 packet was received?
       if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
       {
-         //Check protocol field
-         if(socket->protocol != pseudoHeader->ipv4Data.protocol)
-            continue;
          //Destination IP address filtering
          if(socket->localIpAddr.length)
          {
@@ -116,9 +142,6 @@ error_t rawSocketProcessDatagram(NetInterface *interface,
       //An IPv6 packet was received?
       if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
       {
-         //Check protocol field
-         if(socket->protocol != pseudoHeader->ipv6Data.nextHeader)
-            continue;
          //Destination IP address filtering
          if(socket->localIpAddr.length)
          {
@@ -148,19 +171,55 @@ error_t rawSocketProcessDatagram(NetInterface *interface,
          continue;
       }
 
+#if (RAW_SOCKET_FILTER_SUPPORT == ENABLED)
+      //Any packet filter attached to the socket?
+      if(socket->filter != NULL)
+      {
+         //Run the filter before allocating any memory
+         n = rawSocketFilterRun(socket->filter, socket->filterLength,
+            buffer, offset, length);
+
+         //The packet is rejected by the filter?
+         if(n == 0)
+         {
+            //The protocol is not unreachable though
+            filtered = TRUE;
+            continue;
+         }
+
+         //The filter may truncate the packet
+         length = min(length, n);
+      }
+#endif
+
       //The current socket meets all the criteria
       break;
    }
 
    //Drop incoming packet if no matching socket was found
-   if(i >= SOCKET_MAX_COUNT)
+   if(!socket)
    {
       //Leave critical section
       osMutexRelease(socketMutex);
+
+#if (RAW_SOCKET_FILTER_SUPPORT == ENABLED)
+      //The packet was silently discarded by a filter?
+      if(filtered)
+         return NO_ERROR;
+#endif
       //Unreachable protocol...
       return ERROR_PROTOCOL_UNREACHABLE;
    }
 
+   //A socket that holds too much memory does not get any more
+   if(socketMemCharge(socket, sizeof(SocketQueueItem) + length))
+   {
+      //Leave critical section
+      osMutexRelease(socketMutex);
+      //Notify the calling function that the queue is full
+      return ERROR_RECEIVE_QUEUE_FULL;
+   }
+
    //Empty receive queue?
    if(!socket->receiveQueue)
    {
@@ -193,6 +252,8 @@ error_t rawSocketProcessDatagram(NetInterface *interface,
       //Make sure the receive queue is not full
       if(i >= RAW_SOCKET_RX_QUEUE_SIZE)
       {
+         //The packet is not queued
+         socketMemUncharge(socket, sizeof(SocketQueueItem) + length);
          //Leave critical section
          osMutexRelease(socketMutex);
          //Notify the calling function that the queue is full
@@ -221,6 +282,8 @@ error_t rawSocketProcessDatagram(NetInterface *interface,
    //Failed to allocate memory?
    if(!queueItem)
    {
+      //The packet is not queued
+      socketMemUncharge(socket, sizeof(SocketQueueItem) + length);
       //Leave critical section
       osMutexRelease(socketMutex);
       //Return error code
@@ -360,7 +423,8 @@ error_t rawSocketSendDatagram(Socket *socket, const IpAddr *destIpAddr,
       }
 
       //Send raw datagram
-      error = ipSendDatagram(interface, &pseudoHeader, buffer, offset, timeToLive);
+      error = ipSendDatagram(interface, &pseudoHeader, buffer, offset,
+         timeToLive, IP_PRIORITY_TO_TOS(socket->priority), NULL);
       //Failed to send data?
       if(error) break;
 
@@ -432,6 +496,8 @@ error_t rawSocketReceiveDatagram(Socket *socket, IpAddr *remoteIpAddr,
    {
       //Remove the item from the receive queue
       socket->receiveQueue = queueItem->next;
+      //The memory is no longer held by the socket
+      socketMemUncharge(socket, chunkedBufferGetLength(queueItem->buffer));
       //Deallocate memory buffer
       chunkedBufferFree(queueItem->buffer);
    }
@@ -444,6 +510,19 @@ error_t rawSocketReceiveDatagram(Socket *socket, IpAddr *remoteIpAddr,
 }
 
 
+/**
+ * @brief Index a raw socket under its protocol
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void rawSocketHashSocket(Socket *socket)
+{
+   //Link the socket into the relevant hash bucket
+   socketHashInsert(&rawSocketHashTable[socket->protocol &
+      (RAW_SOCKET_HASH_TABLE_SIZE - 1)], socket);
+}
+
+
 /**
  * @brief Update event state for raw sockets
  * @param[in] socket Handle referencing the socket
@@ -464,6 +543,12 @@ void rawSocketUpdateEvents(Socket *socket)
    else
       socket->eventFlags |= SOCKET_EVENT_LINK_DOWN;
 
+#if (SOCKET_EVENT_SET_SUPPORT == ENABLED)
+   //Push the events into the event set the socket belongs to
+   if(socket->eventSet != NULL)
+      socketEventSetNotify(socket, socket->eventFlags);
+#endif
+
    //Mask unused events
    socket->eventFlags &= socket->eventMask;
 
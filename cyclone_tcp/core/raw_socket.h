@@ -48,6 +48,13 @@
    #error RAW_SOCKET_RX_QUEUE_SIZE parameter is invalid
 #endif
 
+//Size of the protocol hash table
+#ifndef RAW_SOCKET_HASH_TABLE_SIZE
+   #define RAW_SOCKET_HASH_TABLE_SIZE 4
+#elif (RAW_SOCKET_HASH_TABLE_SIZE < 1 || (RAW_SOCKET_HASH_TABLE_SIZE & (RAW_SOCKET_HASH_TABLE_SIZE - 1)))
+   #error RAW_SOCKET_HASH_TABLE_SIZE parameter is invalid
+#endif
+
 //Raw socket related functions
 error_t rawSocketProcessDatagram(NetInterface *interface,
    IpPseudoHeader *pseudoHeader, const ChunkedBuffer *buffer, size_t offset);
@@ -58,6 +65,7 @@ error_t rawSocketSendDatagram(Socket *socket, const IpAddr *destIpAddr,
 error_t rawSocketReceiveDatagram(Socket *socket, IpAddr *remoteIpAddr,
    void *data, size_t size, size_t *received, uint_t flags);
 
+void rawSocketHashSocket(Socket *socket);
 void rawSocketUpdateEvents(Socket *socket);
 
 #endif
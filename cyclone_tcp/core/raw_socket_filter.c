@@ -0,0 +1,321 @@
+/**
+ * @file raw_socket_filter.c
+ * @brief Packet filtering for raw sockets
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL RAW_SOCKET_TRACE_LEVEL
+
+//Dependencies
+#include "tcp_ip_stack.h"
+#include "raw_socket_filter.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (RAW_SOCKET_FILTER_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Validate a filter program
+ *
+ * Only forward jumps are allowed and the last instruction must be a
+ * return, which guarantees that every program terminates within
+ * count steps
+ *
+ * @param[in] program Pointer to the filter instructions
+ * @param[in] count Number of instructions
+ * @return Error code
+ **/
+
+error_t rawSocketFilterCheck(const RawSocketFilterInsn *program, uint_t count)
+{
+   uint_t i;
+   uint_t remaining;
+   const RawSocketFilterInsn *insn;
+
+   //Check parameters
+   if(program == NULL || count == 0 || count > RAW_SOCKET_FILTER_MAX_SIZE)
+      return ERROR_INVALID_PARAMETER;
+
+   //Check each instruction in turn
+   for(i = 0; i < count; i++)
+   {
+      //Point to the current instruction
+      insn = &program[i];
+      //Number of instructions following the current one
+      remaining = count - i - 1;
+
+      //Check opcode
+      switch(insn->code)
+      {
+      //Supported load, ALU and return instructions
+      case RSF_LD | RSF_W | RSF_ABS:
+      case RSF_LD | RSF_H | RSF_ABS:
+      case RSF_LD | RSF_B | RSF_ABS:
+      case RSF_LD | RSF_W | RSF_IND:
+      case RSF_LD | RSF_H | RSF_IND:
+      case RSF_LD | RSF_B | RSF_IND:
+      case RSF_LD | RSF_W | RSF_LEN:
+      case RSF_LD | RSF_IMM:
+      case RSF_LDX | RSF_W | RSF_IMM:
+      case RSF_LDX | RSF_W | RSF_LEN:
+      case RSF_LDX | RSF_B | RSF_MSH:
+      case RSF_ALU | RSF_ADD | RSF_K:
+      case RSF_ALU | RSF_SUB | RSF_K:
+      case RSF_ALU | RSF_AND | RSF_K:
+      case RSF_ALU | RSF_ADD | RSF_X:
+      case RSF_ALU | RSF_SUB | RSF_X:
+      case RSF_ALU | RSF_AND | RSF_X:
+      case RSF_MISC | RSF_TAX:
+      case RSF_MISC | RSF_TXA:
+      case RSF_RET | RSF_K:
+      case RSF_RET | RSF_A:
+         break;
+      //Shift instructions?
+      case RSF_ALU | RSF_LSH | RSF_K:
+      case RSF_ALU | RSF_RSH | RSF_K:
+         //Reject meaningless shift amounts
+         if(insn->k >= 32)
+            return ERROR_INVALID_PARAMETER;
+         break;
+      //Unconditional jump?
+      case RSF_JMP | RSF_JA:
+         //The target must lie within the program
+         if(insn->k >= remaining)
+            return ERROR_INVALID_PARAMETER;
+         break;
+      //Conditional jumps?
+      case RSF_JMP | RSF_JEQ | RSF_K:
+      case RSF_JMP | RSF_JGT | RSF_K:
+      case RSF_JMP | RSF_JGE | RSF_K:
+      case RSF_JMP | RSF_JSET | RSF_K:
+      case RSF_JMP | RSF_JEQ | RSF_X:
+      case RSF_JMP | RSF_JGT | RSF_X:
+      case RSF_JMP | RSF_JGE | RSF_X:
+      case RSF_JMP | RSF_JSET | RSF_X:
+         //Both targets must lie within the program
+         if(insn->jt >= remaining || insn->jf >= remaining)
+            return ERROR_INVALID_PARAMETER;
+         break;
+      //Unsupported instruction?
+      default:
+         //Debug message
+         TRACE_WARNING("Unsupported filter opcode 0x%04" PRIX16 "\r\n", insn->code);
+         //Report an error
+         return ERROR_INVALID_PARAMETER;
+      }
+   }
+
+   //The program must not fall through past its end
+   if((program[count - 1].code & 0x07) != RSF_RET)
+      return ERROR_INVALID_PARAMETER;
+
+   //The program is valid
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Run a filter program against an incoming packet
+ *
+ * The program must have been validated by rawSocketFilterCheck().
+ * Loads beyond the end of the packet abort the program and reject
+ * the packet
+ *
+ * @param[in] program Pointer to the filter instructions
+ * @param[in] count Number of instructions
+ * @param[in] buffer Multi-part buffer containing the packet
+ * @param[in] offset Offset to the first byte of the IP payload
+ * @param[in] length Length of the IP payload
+ * @return Number of bytes to accept (0 means the packet is dropped)
+ **/
+
+uint32_t rawSocketFilterRun(const RawSocketFilterInsn *program, uint_t count,
+   const ChunkedBuffer *buffer, size_t offset, size_t length)
+{
+   uint_t i;
+   uint_t n;
+   uint32_t a;
+   uint32_t x;
+   uint32_t k;
+   uint8_t data[4];
+   const RawSocketFilterInsn *insn;
+
+   //Clear registers
+   a = 0;
+   x = 0;
+
+   //Execute the program
+   for(i = 0; i < count; i++)
+   {
+      //Point to the current instruction
+      insn = &program[i];
+      //Retrieve the generic operand
+      k = insn->k;
+
+      //Check instruction class
+      switch(insn->code & 0x07)
+      {
+      //Load into the accumulator?
+      case RSF_LD:
+         //Immediate value or packet length?
+         if((insn->code & 0xE0) == RSF_IMM)
+         {
+            a = k;
+            break;
+         }
+         else if((insn->code & 0xE0) == RSF_LEN)
+         {
+            a = length;
+            break;
+         }
+
+         //Indirect addressing adds the index register to the offset
+         if((insn->code & 0xE0) == RSF_IND)
+         {
+            //Check for overflow
+            if((k + x) < k)
+               return 0;
+            //Compute the effective offset
+            k += x;
+         }
+
+         //Number of bytes to load
+         n = ((insn->code & 0x18) == RSF_W) ? 4 : ((insn->code & 0x18) == RSF_H) ? 2 : 1;
+
+         //Out-of-bounds access?
+         if(k > length || n > (length - k))
+            return 0;
+
+         //Copy the relevant bytes
+         chunkedBufferRead(data, buffer, offset + k, n);
+
+         //Fields are stored in network byte order
+         if(n == 4)
+            a = LOAD32BE(data);
+         else if(n == 2)
+            a = LOAD16BE(data);
+         else
+            a = data[0];
+         break;
+
+      //Load into the index register?
+      case RSF_LDX:
+         //Immediate value?
+         if((insn->code & 0xE0) == RSF_IMM)
+         {
+            x = k;
+         }
+         //Packet length?
+         else if((insn->code & 0xE0) == RSF_LEN)
+         {
+            x = length;
+         }
+         //Header length of an encapsulated IPv4 packet?
+         else
+         {
+            //Out-of-bounds access?
+            if(k >= length)
+               return 0;
+            //Copy the relevant byte
+            chunkedBufferRead(data, buffer, offset + k, 1);
+            //Multiply the IHL field by 4
+            x = (data[0] & 0x0F) << 2;
+         }
+         break;
+
+      //Arithmetic and logic instructions?
+      case RSF_ALU:
+         //Select the second operand
+         if(insn->code & RSF_X)
+            k = x;
+
+         //Check operation
+         switch(insn->code & 0xF0)
+         {
+         case RSF_ADD:
+            a += k;
+            break;
+         case RSF_SUB:
+            a -= k;
+            break;
+         case RSF_AND:
+            a &= k;
+            break;
+         case RSF_LSH:
+            a <<= k;
+            break;
+         default:
+            a >>= k;
+            break;
+         }
+         break;
+
+      //Jump instructions?
+      case RSF_JMP:
+         //Unconditional jump?
+         if((insn->code & 0xF0) == RSF_JA)
+         {
+            i += k;
+            break;
+         }
+
+         //Select the second operand
+         if(insn->code & RSF_X)
+            k = x;
+
+         //Evaluate the condition
+         if((insn->code & 0xF0) == RSF_JEQ)
+            i += (a == k) ? insn->jt : insn->jf;
+         else if((insn->code & 0xF0) == RSF_JGT)
+            i += (a > k) ? insn->jt : insn->jf;
+         else if((insn->code & 0xF0) == RSF_JGE)
+            i += (a >= k) ? insn->jt : insn->jf;
+         else
+            i += (a & k) ? insn->jt : insn->jf;
+         break;
+
+      //Register transfers?
+      case RSF_MISC:
+         //Copy the accumulator to the index register or the other way round
+         if(insn->code & RSF_TXA)
+            a = x;
+         else
+            x = a;
+         break;
+
+      //Return instruction?
+      default:
+         //Return the number of bytes to accept
+         return (insn->code & RSF_A) ? a : k;
+      }
+   }
+
+   //This should never occur if the program has been validated
+   return 0;
+}
+
+#endif
@@ -0,0 +1,128 @@
+/**
+ * @file raw_socket_filter.h
+ * @brief Packet filtering for raw sockets
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * A compact filter program can be attached to each raw socket. The
+ * program is a subset of classic BPF and is evaluated before any memory
+ * is allocated for the incoming packet, so that unwanted traffic is
+ * dropped at the cost of a few instructions
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _RAW_SOCKET_FILTER_H
+#define _RAW_SOCKET_FILTER_H
+
+//Dependencies
+#include "tcp_ip_stack.h"
+
+//Raw socket filter support
+#ifndef RAW_SOCKET_FILTER_SUPPORT
+   #define RAW_SOCKET_FILTER_SUPPORT DISABLED
+#elif (RAW_SOCKET_FILTER_SUPPORT != ENABLED && RAW_SOCKET_FILTER_SUPPORT != DISABLED)
+   #error RAW_SOCKET_FILTER_SUPPORT parameter is invalid
+#endif
+
+//Maximum number of instructions in a filter program
+#ifndef RAW_SOCKET_FILTER_MAX_SIZE
+   #define RAW_SOCKET_FILTER_MAX_SIZE 32
+#elif (RAW_SOCKET_FILTER_MAX_SIZE < 1 || RAW_SOCKET_FILTER_MAX_SIZE > 256)
+   #error RAW_SOCKET_FILTER_MAX_SIZE parameter is invalid
+#endif
+
+//Instruction classes
+#define RSF_LD   0x00
+#define RSF_LDX  0x01
+#define RSF_ALU  0x04
+#define RSF_JMP  0x05
+#define RSF_RET  0x06
+#define RSF_MISC 0x07
+
+//Load sizes
+#define RSF_W    0x00
+#define RSF_H    0x08
+#define RSF_B    0x10
+
+//Addressing modes
+#define RSF_IMM  0x00
+#define RSF_ABS  0x20
+#define RSF_IND  0x40
+#define RSF_LEN  0x80
+#define RSF_MSH  0xA0
+
+//ALU operations
+#define RSF_ADD  0x00
+#define RSF_SUB  0x10
+#define RSF_AND  0x50
+#define RSF_LSH  0x60
+#define RSF_RSH  0x70
+
+//Jump conditions
+#define RSF_JA   0x00
+#define RSF_JEQ  0x10
+#define RSF_JGT  0x20
+#define RSF_JGE  0x30
+#define RSF_JSET 0x40
+
+//Operand source
+#define RSF_K    0x00
+#define RSF_X    0x08
+#define RSF_A    0x10
+
+//Register transfers
+#define RSF_TAX  0x00
+#define RSF_TXA  0x80
+
+//Helper macros to build filter programs
+#define RSF_STMT(code, k) {(uint16_t) (code), 0, 0, (uint32_t) (k)}
+#define RSF_JUMP(code, k, jt, jf) {(uint16_t) (code), (jt), (jf), (uint32_t) (k)}
+
+
+/**
+ * @brief Filter instruction
+ *
+ * The layout and the opcode values match classic BPF, so that
+ * programs written for tcpdump-like tools can be reused as long as
+ * they stick to the supported subset. Offsets are relative to the
+ * first byte of the IP payload
+ **/
+
+typedef struct
+{
+   uint16_t code; ///<Opcode
+   uint8_t jt;    ///<Forward offset if the condition is true
+   uint8_t jf;    ///<Forward offset if the condition is false
+   uint32_t k;    ///<Generic operand
+} RawSocketFilterInsn;
+
+
+//Raw socket filter related functions
+error_t rawSocketFilterCheck(const RawSocketFilterInsn *program, uint_t count);
+
+uint32_t rawSocketFilterRun(const RawSocketFilterInsn *program, uint_t count,
+   const ChunkedBuffer *buffer, size_t offset, size_t length);
+
+#endif
@@ -30,6 +30,8 @@
 #define TRACE_LEVEL SOCKET_TRACE_LEVEL
 
 //Dependencies
+#include <stddef.h>
+#include <stdlib.h>
 #include <string.h>
 #include "tcp_ip_stack.h"
 #include "socket.h"
@@ -37,14 +39,67 @@
 #include "udp.h"
 #include "tcp.h"
 #include "tcp_misc.h"
+#include "tcp_congestion.h"
+#include "probe.h"
 #include "debug.h"
 
 //Ephemeral ports are used for dynamic port assignment
 static uint_t ephemeralPort;
+//Sockets indexed by local port
+static Socket *socketPortHashTable[SOCKET_PORT_HASH_TABLE_SIZE];
 //Mutex preventing simultaneous access to the socket table
 OsMutex *socketMutex;
-//Socket table
-Socket socketTable[SOCKET_MAX_COUNT];
+//Socket table (maps descriptors to socket control blocks)
+Socket *socketTable[SOCKET_MAX_COUNT];
+
+#if (SOCKET_DYNAMIC_ALLOC_SUPPORT == DISABLED)
+//Statically allocated socket control blocks
+static Socket socketPool[SOCKET_MAX_COUNT];
+#endif
+
+#if (SOCKET_CALLBACK_SUPPORT == ENABLED)
+//Sockets whose events are dispatched to callbacks
+static SocketEventSet socketCallbackSet;
+#endif
+
+#if (SOCKET_MEM_ACCOUNTING_SUPPORT == ENABLED)
+
+//Memory footprint of a buffer, in bytes
+#if (MEM_POOL_SUPPORT == ENABLED)
+   #define SOCKET_MEM_FOOTPRINT(size) (N(size) * MEM_POOL_BUFFER_SIZE)
+#else
+   #define SOCKET_MEM_FOOTPRINT(size) (size)
+#endif
+
+//Memory held by each class of sockets (indexed by socket type)
+static size_t socketMemClassUsage[SOCKET_TYPE_RAW + 1];
+//Memory held by all the sockets
+static size_t socketMemTotalUsage;
+//Event signaled whenever memory is given back
+static OsEvent *socketMemEvent;
+
+//Memory that each class of sockets may hold (indexed by socket type)
+static const size_t socketMemClassBudget[SOCKET_TYPE_RAW + 1] =
+{
+   0,
+   SOCKET_MEM_TCP_BUDGET,
+   SOCKET_MEM_UDP_BUDGET,
+   SOCKET_MEM_RAW_BUDGET
+};
+
+#endif
+
+//Socket related local functions
+static Socket *socketAllocate(uint_t descriptor, uint_t type);
+static void socketUpdateEvents(Socket *socket);
+static uint16_t socketGetEphemeralPort(uint8_t protocol);
+static bool_t socketPortInUse(uint8_t protocol, uint16_t port);
+
+#if (SOCKET_EVENT_SET_SUPPORT == ENABLED)
+static void socketEventSetQueue(SocketEventSet *set, Socket *socket);
+static void socketEventSetDetach(Socket *socket);
+static uint_t socketEventSetCollect(SocketEventSet *set, SocketEventDesc *eventDesc, uint_t size);
+#endif
 
 
 /**
@@ -55,32 +110,47 @@ Socket socketTable[SOCKET_MAX_COUNT];
 error_t socketInit(void)
 {
    uint_t i;
+#if (SOCKET_DYNAMIC_ALLOC_SUPPORT == DISABLED)
    uint_t j;
+#endif
+#if (SOCKET_CALLBACK_SUPPORT == ENABLED)
+   error_t error;
+   OsTask *task;
+#endif
 
-   //Default dynamic port to use
-   ephemeralPort = SOCKET_EPHEMERAL_PORT_MIN;
+   //Offset of the next dynamic port within the ephemeral range
+   ephemeralPort = 0;
+   //No local port is in use
+   memset(socketPortHashTable, 0, sizeof(socketPortHashTable));
 
    //Create a mutex to prevent simultaneous access to sockets
-   socketMutex = osMutexCreate(FALSE);
+   socketMutex = osMutexCreateNamed(FALSE, "Socket");
    //Any error to report?
    if(socketMutex == OS_INVALID_HANDLE)
       return ERROR_OUT_OF_RESOURCES;
 
+#if (SOCKET_DYNAMIC_ALLOC_SUPPORT == ENABLED)
+   //Socket control blocks are allocated when sockets are opened
+   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+      socketTable[i] = NULL;
+#else
    //Initialize socket related data
-   memset(socketTable, 0, sizeof(socketTable));
+   memset(socketPool, 0, sizeof(socketPool));
 
    //Loop through socket descriptors
    for(i = 0; i < SOCKET_MAX_COUNT; i++)
    {
+      //Each descriptor is bound to a statically allocated socket
+      socketTable[i] = socketPool + i;
       //Create an event object to track socket events
-      socketTable[i].event = osEventCreate(FALSE, FALSE);
+      socketPool[i].event = osEventCreate(FALSE, FALSE);
 
       //Out of resources?
-      if(socketTable[i].event == OS_INVALID_HANDLE)
+      if(socketPool[i].event == OS_INVALID_HANDLE)
       {
          //Clean up side effects
          for(j = 0; j < i; j++)
-            osEventClose(socketTable[j].event);
+            osEventClose(socketPool[j].event);
 
          //Close mutex
          osMutexClose(socketMutex);
@@ -89,6 +159,33 @@ error_t socketInit(void)
          return ERROR_OUT_OF_RESOURCES;
       }
    }
+#endif
+
+#if (SOCKET_MEM_ACCOUNTING_SUPPORT == ENABLED)
+   //No memory is held by sockets
+   memset(socketMemClassUsage, 0, sizeof(socketMemClassUsage));
+   socketMemTotalUsage = 0;
+
+   //Create an event object to wake up the tasks waiting for memory
+   socketMemEvent = osEventCreate(TRUE, FALSE);
+   //Any error to report?
+   if(socketMemEvent == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+#endif
+
+#if (SOCKET_CALLBACK_SUPPORT == ENABLED)
+   //Initialize the event set shared by the sockets that use callbacks
+   error = socketEventSetInit(&socketCallbackSet);
+   //Any error to report?
+   if(error) return error;
+
+   //Create a task to dispatch socket callbacks
+   task = osTaskCreate("Socket Callbacks", socketCallbackTask,
+      NULL, SOCKET_CALLBACK_STACK_SIZE, SOCKET_CALLBACK_PRIORITY);
+   //Unable to create the task?
+   if(task == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+#endif
 
    //Successful initialization
    return NO_ERROR;
@@ -106,7 +203,6 @@ Socket *socketOpen(uint_t type, uint8_t protocol)
 {
    uint_t i;
    Socket *socket;
-   OsEvent *event;
 
    //Check input parameters
    if(type == SOCKET_TYPE_STREAM)
@@ -123,31 +219,57 @@ Socket *socketOpen(uint_t type, uint8_t protocol)
    for(i = 0, socket = NULL; i < SOCKET_MAX_COUNT; i++)
    {
       //Unused socket found?
-      if(socketTable[i].type == SOCKET_TYPE_UNUSED)
+      if(socketTable[i] == NULL || socketTable[i]->type == SOCKET_TYPE_UNUSED)
       {
-         //Shortcut to the current socket
-         socket = socketTable + i;
-         //Save event object instance
-         event = socket->event;
-
-         //Clear associated structure
-         memset(socket, 0, sizeof(Socket));
-
-         //Reuse event objects and avoid recreating them whenever possible
-         socket->event = event;
+         //Get a cleared control block for the new socket
+         socket = socketAllocate(i, type);
+         //Out of resources?
+         if(!socket)
+            break;
 
          //Save socket characteristics
          socket->descriptor = i;
          socket->type = type;
          socket->protocol = protocol;
-         socket->localPort = ephemeralPort;
          socket->timeout = INFINITE_DELAY;
-         socket->txBufferSize = TCP_DEFAULT_TX_BUFFER_SIZE;
-         socket->rxBufferSize = TCP_DEFAULT_RX_BUFFER_SIZE;
+#if (SOCKET_MEM_ACCOUNTING_SUPPORT == ENABLED)
+         socket->memBudget = SOCKET_MEM_DEFAULT_BUDGET;
+#endif
 
-         //Next dynamic port to use
-         if(ephemeralPort++ >= SOCKET_EPHEMERAL_PORT_MAX)
-            ephemeralPort = SOCKET_EPHEMERAL_PORT_MIN;
+         //Only connection-oriented sockets carry a TCP control block
+         if(type == SOCKET_TYPE_STREAM)
+         {
+            socket->txBufferSize = TCP_DEFAULT_TX_BUFFER_SIZE;
+            socket->rxBufferSize = TCP_DEFAULT_RX_BUFFER_SIZE;
+            socket->congestionAlgo = TCP_DEFAULT_CONGESTION_ALGO;
+            socket->minRto = TCP_MIN_RTO;
+            socket->txLowWat = 1;
+            socket->rxLowWat = 1;
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+            socket->txAutoTune = TRUE;
+            socket->rxAutoTune = TRUE;
+#endif
+         }
+
+         //TCP and UDP sockets are given a dynamic port
+         if(type != SOCKET_TYPE_RAW)
+         {
+            //Pick a port that no other socket of the same protocol uses
+            socket->localPort = socketGetEphemeralPort(protocol);
+            //Keep track of the ports in use
+            socketPortInsert(socket);
+         }
+
+#if (UDP_SUPPORT == ENABLED)
+         //Connectionless sockets are indexed by their local port
+         if(type == SOCKET_TYPE_DGRAM)
+            udpHashSocket(socket);
+#endif
+#if (RAW_SOCKET_SUPPORT == ENABLED)
+         //Raw sockets are indexed by their protocol
+         if(type == SOCKET_TYPE_RAW)
+            rawSocketHashSocket(socket);
+#endif
 
          //Socket is successfully initialized
          break;
@@ -183,20 +305,28 @@ error_t socketSetTimeout(Socket *socket, time_t timeout)
 
 
 /**
- * @brief Bind a socket to a particular network interface
+ * @brief Set the priority of the traffic sent through a socket
+ *
+ * The priority is carried in the Differentiated Services field of the
+ * outgoing IP packets (Class Selector codepoints) and determines the
+ * transmit queue used when NIC_TX_PRIORITY_COUNT is greater than 1
+ *
  * @param[in] socket Handle to a socket
- * @param[in] interface Network interface to be used
+ * @param[in] priority Priority level, from 0 (best effort) to IP_MAX_PRIORITY
  * @return Error code
  **/
 
-error_t socketBindToInterface(Socket *socket, NetInterface *interface)
+error_t socketSetPriority(Socket *socket, uint_t priority)
 {
-   //Check input parameters
-   if(!socket || !interface)
+   //Make sure the socket handle is valid
+   if(!socket)
+      return ERROR_INVALID_PARAMETER;
+   //Check the priority level
+   if(priority > IP_MAX_PRIORITY)
       return ERROR_INVALID_PARAMETER;
 
-   //Explicitly associate the socket with the specified interface
-   socket->interface = interface;
+   //Record the priority level
+   socket->priority = priority;
 
    //No error to report
    return NO_ERROR;
@@ -204,25 +334,32 @@ error_t socketBindToInterface(Socket *socket, NetInterface *interface)
 
 
 /**
- * @brief Associate a local address with a socket
+ * @brief Allow several listening sockets to share the same local port
+ *
+ * Connections that arrive on the port are distributed across every
+ * listening socket that has the option enabled, so that several tasks
+ * can accept connections in parallel
+ *
  * @param[in] socket Handle to a socket
- * @param[in] localIpAddr Local address to assign to the bound socket
- * @param[in] localPort Local port number to assign to the bound socket
+ * @param[in] enable Enable or disable the option
  * @return Error code
  **/
 
-error_t socketBind(Socket *socket, const IpAddr *localIpAddr, uint16_t localPort)
+error_t socketSetReusePort(Socket *socket, bool_t enable)
 {
-   //Check input parameters
-   if(!socket || !localIpAddr)
+   //Make sure the socket handle is valid
+   if(!socket)
       return ERROR_INVALID_PARAMETER;
-   //Make sure the socket type is correct
-   if(socket->type != SOCKET_TYPE_STREAM && socket->type != SOCKET_TYPE_DGRAM)
+   //The option only applies to connection-oriented sockets
+   if(socket->type != SOCKET_TYPE_STREAM)
       return ERROR_INVALID_SOCKET;
 
-   //Associate the specified IP address and port number
-   socket->localIpAddr = *localIpAddr;
-   socket->localPort = localPort;
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+   //Save the option
+   socket->reusePortFlag = enable;
+   //Leave critical section
+   osMutexRelease(socketMutex);
 
    //No error to report
    return NO_ERROR;
@@ -230,88 +367,116 @@ error_t socketBind(Socket *socket, const IpAddr *localIpAddr, uint16_t localPort
 
 
 /**
- * @brief Establish a connection to a specified socket
- * @param[in] socket Handle to an unconnected socket
- * @param[in] remoteIpAddr IP address of the remote host
- * @param[in] remotePort Remote port number that will be used to establish the connection
+ * @brief Enable TCP Fast Open on a socket
+ *
+ * A listening socket accepts the data carried by SYN segments that
+ * present a valid cookie, and hands out cookies to the clients that
+ * request one. A client socket requests a cookie from the server even
+ * when no initial data is supplied to socketConnect()
+ *
+ * @param[in] socket Handle to a socket
+ * @param[in] enable Enable or disable the option
  * @return Error code
  **/
 
-error_t socketConnect(Socket *socket, const IpAddr *remoteIpAddr, uint16_t remotePort)
+error_t socketSetFastOpen(Socket *socket, bool_t enable)
 {
-   error_t error;
-
-   //Check input parameters
-   if(!socket || !remoteIpAddr)
+#if (TCP_SUPPORT == ENABLED && TCP_FAST_OPEN_SUPPORT == ENABLED)
+   //Make sure the socket handle is valid
+   if(!socket)
       return ERROR_INVALID_PARAMETER;
+   //The option only applies to connection-oriented sockets
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return ERROR_INVALID_SOCKET;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+   //Save the option
+   socket->fastOpenFlag = enable;
+   //Leave critical section
+   osMutexRelease(socketMutex);
 
+   //No error to report
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Specify the size of the send buffer
+ *
+ * The buffer is allocated when the connection is established, hence
+ * the size must be set before socketConnect() or socketListen() is
+ * called. Accepted sockets inherit the setting of the listening socket
+ *
+ * @param[in] socket Handle to a socket
+ * @param[in] size Desired buffer size in bytes
+ * @return Error code
+ **/
+
+error_t socketSetTxBufferSize(Socket *socket, size_t size)
+{
 #if (TCP_SUPPORT == ENABLED)
-   //Connection-oriented socket?
-   if(socket->type == SOCKET_TYPE_STREAM)
-   {
-      //Save port number and IP address of the remote host
-      socket->remoteIpAddr = *remoteIpAddr;
-      socket->remotePort = remotePort;
+   error_t error;
 
-      //Select the source address and the relevant network interface
-      //to use when establishing the connection
-      error = ipSelectSourceAddr(&socket->interface,
-         &socket->remoteIpAddr, &socket->localIpAddr);
-      //Any error to report?
-      if(error) return error;
+   //Make sure the socket handle is valid
+   if(!socket)
+      return ERROR_INVALID_PARAMETER;
+   //The option only applies to connection-oriented sockets
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return ERROR_INVALID_SOCKET;
+   //Check the value of the parameter
+   if(size < 1 || size > TCP_MAX_TX_BUFFER_SIZE)
+      return ERROR_INVALID_PARAMETER;
 
-      //Make sure the source address is valid
-      if(ipIsUnspecifiedAddr(&socket->localIpAddr))
-         return ERROR_NOT_CONFIGURED;
+   //Enter critical section
+   osMutexAcquire(socketMutex);
 
-      //Enter critical section
-      osMutexAcquire(socketMutex);
-      //Establish TCP connection
-      error = tcpConnect(socket);
-      //Leave critical section
-      osMutexRelease(socketMutex);
-   }
-   else
-#endif
-   //Connectionless socket?
-   if(socket->type == SOCKET_TYPE_DGRAM)
-   {
-      //Save port number and IP address of the remote host
-      socket->remoteIpAddr = *remoteIpAddr;
-      socket->remotePort = remotePort;
-      //No error to report
-      error = NO_ERROR;
-   }
-   //Raw socket?
-   else if(socket->type == SOCKET_TYPE_RAW)
+   //The buffer cannot be resized once the connection is being established
+   if(socket->state == TCP_STATE_CLOSED || socket->state == TCP_STATE_LISTEN)
    {
-      //Save the IP address of the remote host
-      socket->remoteIpAddr = *remoteIpAddr;
-      //No error to report
+      //Save the buffer size
+      socket->txBufferSize = size;
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+      //An explicit size disables automatic tuning
+      socket->txAutoTune = FALSE;
+#endif
+      //Successful processing
       error = NO_ERROR;
    }
-   //Socket type not supported...
    else
    {
-      //Invalid socket type
-      error = ERROR_INVALID_SOCKET;
+      //Report an error
+      error = ERROR_WRONG_STATE;
    }
 
+   //Leave critical section
+   osMutexRelease(socketMutex);
+
    //Return status code
    return error;
+#else
+   return ERROR_NOT_IMPLEMENTED;
+#endif
 }
 
 
 /**
- * @brief Place a socket in the listening state
+ * @brief Specify the size of the receive buffer
  *
- * Place a socket in a state in which it is listening for an incoming connection
+ * The buffer is allocated when the connection is established, hence
+ * the size must be set before socketConnect() or socketListen() is
+ * called. Accepted sockets inherit the setting of the listening socket
  *
- * @param[in] socket Socket to place in the listening state
+ * @param[in] socket Handle to a socket
+ * @param[in] size Desired buffer size in bytes
  * @return Error code
  **/
 
-error_t socketListen(Socket *socket)
+error_t socketSetRxBufferSize(Socket *socket, size_t size)
 {
 #if (TCP_SUPPORT == ENABLED)
    error_t error;
@@ -319,14 +484,34 @@ error_t socketListen(Socket *socket)
    //Make sure the socket handle is valid
    if(!socket)
       return ERROR_INVALID_PARAMETER;
-   //This function shall be used with connection-oriented socket types
+   //The option only applies to connection-oriented sockets
    if(socket->type != SOCKET_TYPE_STREAM)
       return ERROR_INVALID_SOCKET;
+   //Check the value of the parameter
+   if(size < 1 || size > TCP_MAX_RX_BUFFER_SIZE)
+      return ERROR_INVALID_PARAMETER;
 
    //Enter critical section
    osMutexAcquire(socketMutex);
-   //Start listening for an incoming connection
-   error = tcpListen(socket);
+
+   //The buffer cannot be resized once the connection is being established
+   if(socket->state == TCP_STATE_CLOSED || socket->state == TCP_STATE_LISTEN)
+   {
+      //Save the buffer size
+      socket->rxBufferSize = size;
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+      //An explicit size disables automatic tuning
+      socket->rxAutoTune = FALSE;
+#endif
+      //Successful processing
+      error = NO_ERROR;
+   }
+   else
+   {
+      //Report an error
+      error = ERROR_WRONG_STATE;
+   }
+
    //Leave critical section
    osMutexRelease(socketMutex);
 
@@ -339,263 +524,1300 @@ error_t socketListen(Socket *socket)
 
 
 /**
- * @brief Permit an incoming connection attempt on a socket
- * @param[in] socket Handle to a socket previously placed in a listening state
- * @param[out] clientIpAddr IP address of the client
- * @param[out] clientPort Port number used by the client
- * @return Handle to the socket in which the actual connection is made
+ * @brief Set the send low-watermark
+ *
+ * The socket is reported as writable only once the specified amount of
+ * space is free in the send buffer, so that the writer wakes up when it
+ * can queue a meaningful block of data. Accepted sockets inherit the
+ * setting of the listening socket
+ *
+ * @param[in] socket Handle to a socket
+ * @param[in] size Minimum amount of free space, in bytes
+ * @return Error code
  **/
 
-Socket *socketAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort)
+error_t socketSetTxLowWatermark(Socket *socket, size_t size)
 {
 #if (TCP_SUPPORT == ENABLED)
-   Socket *newSocket;
-
    //Make sure the socket handle is valid
    if(!socket)
-      return NULL;
-   //This function shall be used with connection-oriented socket types
+      return ERROR_INVALID_PARAMETER;
+   //The option only applies to connection-oriented sockets
    if(socket->type != SOCKET_TYPE_STREAM)
-      return NULL;
+      return ERROR_INVALID_SOCKET;
+   //Check the value of the parameter
+   if(size < 1)
+      return ERROR_INVALID_PARAMETER;
 
-   //Accept an incoming connection attempt
-   newSocket = tcpAccept(socket, clientIpAddr, clientPort);
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+   //Save the new watermark
+   socket->txLowWat = size;
+   //The writability of the socket may have changed
+   tcpUpdateEvents(socket);
+   //Leave critical section
+   osMutexRelease(socketMutex);
 
-   //Return a handle to the newly created socket
-   return newSocket;
+   //No error to report
+   return NO_ERROR;
 #else
-   return NULL;
+   return ERROR_NOT_IMPLEMENTED;
 #endif
 }
 
 
 /**
- * @brief Send data to a connected socket
- * @param[in] socket Handle that identifies a connected socket
- * @param[in] data Pointer to a buffer containing the data to be transmitted
- * @param[in] length Number of data bytes to send
- * @param[out] written Actual number of bytes written (optional parameter)
- * @param[in] flags Set of flags that influences the behavior of this function
+ * @brief Set the receive low-watermark
+ *
+ * The socket is reported as readable only once the specified amount of
+ * data has been received, so that tasks parsing fixed-size records do
+ * not wake up for every segment. The end of the stream and connection
+ * errors are still reported immediately. Accepted sockets inherit the
+ * setting of the listening socket
+ *
+ * @param[in] socket Handle to a socket
+ * @param[in] size Minimum amount of data, in bytes
  * @return Error code
  **/
 
-error_t socketSend(Socket *socket, const void *data,
-   size_t length, size_t *written, uint_t flags)
+error_t socketSetRxLowWatermark(Socket *socket, size_t size)
 {
-   //Use default remote IP address for connectionless or raw sockets
-   return socketSendTo(socket, &socket->remoteIpAddr,
-      socket->remotePort, data, length, written, flags);
+#if (TCP_SUPPORT == ENABLED)
+   //Make sure the socket handle is valid
+   if(!socket)
+      return ERROR_INVALID_PARAMETER;
+   //The option only applies to connection-oriented sockets
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return ERROR_INVALID_SOCKET;
+   //Check the value of the parameter
+   if(size < 1)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+   //Save the new watermark
+   socket->rxLowWat = size;
+   //The readability of the socket may have changed
+   tcpUpdateEvents(socket);
+   //Leave critical section
+   osMutexRelease(socketMutex);
+
+   //No error to report
+   return NO_ERROR;
+#else
+   return ERROR_NOT_IMPLEMENTED;
+#endif
 }
 
 
 /**
- * @brief Send a datagram to a specific destination
- * @param[in] socket Handle that identifies a socket
- * @param[in] remoteIpAddr IP address of the target host
- * @param[in] remotePort Target port number
- * @param[in] data Pointer to a buffer containing the data to be transmitted
- * @param[in] length Number of data bytes to send
- * @param[out] written Actual number of bytes written (optional parameter)
- * @param[in] flags Set of flags that influences the behavior of this function
+ * @brief Cork or uncork a connection
+ *
+ * While the socket is corked, only full-sized segments are sent and
+ * partial segments are held back until the cork is released. The
+ * override timer still forces the pending data out eventually. The
+ * SOCKET_FLAG_MORE flag has the same effect for a single write
+ *
+ * @param[in] socket Handle to a socket
+ * @param[in] enable Cork (TRUE) or uncork (FALSE) the connection
  * @return Error code
  **/
 
-error_t socketSendTo(Socket *socket, const IpAddr *remoteIpAddr, uint16_t remotePort,
-   const void *data, size_t length, size_t *written, uint_t flags)
+error_t socketSetCork(Socket *socket, bool_t enable)
 {
-   error_t error;
-
-   //No data has been transmitted yet
-   if(written)
-      *written = 0;
-
+#if (TCP_SUPPORT == ENABLED)
    //Make sure the socket handle is valid
    if(!socket)
       return ERROR_INVALID_PARAMETER;
+   //The option only applies to connection-oriented sockets
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return ERROR_INVALID_SOCKET;
 
-#if (TCP_SUPPORT == ENABLED)
-   //Connection-oriented socket?
-   if(socket->type == SOCKET_TYPE_STREAM)
-   {
-      //Enter critical section
-      osMutexAcquire(socketMutex);
-      //For connection-oriented sockets, target address is ignored
-      error = tcpSend(socket, data, length, written, flags);
-      //Leave critical section
-      osMutexRelease(socketMutex);
-   }
-   else
-#endif
-#if (UDP_SUPPORT == ENABLED)
-   //Connectionless socket?
-   if(socket->type == SOCKET_TYPE_DGRAM)
-   {
-      //Send UDP datagram
-      error = udpSendDatagram(socket, remoteIpAddr,
-         remotePort, data, length, written);
-   }
-   else
-#endif
-#if (RAW_SOCKET_SUPPORT == ENABLED)
-   //Raw socket?
-   if(socket->type == SOCKET_TYPE_RAW)
-   {
-      //Send raw datagram
-      error = rawSocketSendDatagram(socket,
-         remoteIpAddr, data, length, written);
-   }
-   else
-#endif
-   //Socket type not supported...
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+   //Save the new setting
+   socket->txCork = enable;
+
+   //Releasing the cork sends the partial segment right away
+   if(!enable)
    {
-      //Invalid socket type
-      error = ERROR_INVALID_SOCKET;
+      //A pending SOCKET_FLAG_MORE hint no longer applies
+      socket->txMore = FALSE;
+
+      //Flush the pending data
+      if(socket->state == TCP_STATE_ESTABLISHED || socket->state == TCP_STATE_CLOSE_WAIT)
+         tcpNagleAlgo(socket);
    }
 
-   //Return status code
-   return error;
+   //Leave critical section
+   osMutexRelease(socketMutex);
+
+   //No error to report
+   return NO_ERROR;
+#else
+   return ERROR_NOT_IMPLEMENTED;
+#endif
 }
 
 
 /**
- * @brief Receive data from a connected socket
- * @param[in] socket Handle that identifies a connected socket
- * @param[out] data Buffer where to store the incoming data
- * @param[in] size Maximum number of bytes that can be received
- * @param[out] received Number of bytes that have been received
- * @param[in] flags Set of flags that influences the behavior of this function
+ * @brief Set the amount of memory a socket may hold
+ *
+ * The budget covers the receive queue of UDP and raw sockets, and the
+ * send and receive buffers of TCP sockets. Incoming datagrams exceeding
+ * the budget are dropped, and writers block until memory is given back.
+ * Accepted sockets inherit the setting of the listening socket
+ *
+ * @param[in] socket Handle to a socket
+ * @param[in] size Memory budget, in bytes (0 for no per-socket limit)
  * @return Error code
  **/
 
-error_t socketReceive(Socket *socket, void *data,
-   size_t size, size_t *received, uint_t flags)
+error_t socketSetMemBudget(Socket *socket, size_t size)
 {
-   //For connection-oriented sockets, remote address is ignored
-   return socketReceiveFrom(socket, NULL, NULL, data, size, received, flags);
+#if (SOCKET_MEM_ACCOUNTING_SUPPORT == ENABLED)
+   //Make sure the socket handle is valid
+   if(!socket)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+   //Save the new budget
+   socket->memBudget = size;
+   //Leave critical section
+   osMutexRelease(socketMutex);
+
+   //No error to report
+   return NO_ERROR;
+#else
+   return ERROR_NOT_IMPLEMENTED;
+#endif
 }
 
 
 /**
- * @brief Receive a datagram
- * @param[in] socket Handle that identifies a socket
- * @param[out] remoteIpAddr IP address of the remote host (optional)
- * @param[out] remotePort Port number used by the remote host (optional)
- * @param[out] data Buffer where to store the incoming data
- * @param[in] size Maximum number of bytes that can be received
- * @param[out] received Number of bytes that have been received
- * @param[in] flags Set of flags that influences the behavior of this function
+ * @brief Enable or disable TCP pacing
+ *
+ * Paced connections spread their segments over the round-trip time
+ * instead of sending a whole window at once, which avoids overflowing
+ * the buffers of slow links. Accepted sockets inherit the setting of
+ * the listening socket
+ *
+ * @param[in] socket Handle to a socket
+ * @param[in] enable Enable or disable pacing
+ * @param[in] maxRate Maximum rate, in bytes per second (0 to only
+ *   derive the rate from the congestion window and the round-trip time)
  * @return Error code
  **/
 
-error_t socketReceiveFrom(Socket *socket, IpAddr *remoteIpAddr,
-   uint16_t *remotePort, void *data, size_t size, size_t *received, uint_t flags)
+error_t socketSetPacing(Socket *socket, bool_t enable, uint32_t maxRate)
 {
-   error_t error;
-
+#if (TCP_SUPPORT == ENABLED && TCP_PACING_SUPPORT == ENABLED)
    //Make sure the socket handle is valid
    if(!socket)
       return ERROR_INVALID_PARAMETER;
+   //The option only applies to connection-oriented sockets
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return ERROR_INVALID_SOCKET;
 
    //Enter critical section
    osMutexAcquire(socketMutex);
 
-#if (TCP_SUPPORT == ENABLED)
-   //Connection-oriented socket?
-   if(socket->type == SOCKET_TYPE_STREAM)
-   {
-      //Receive data
-      error = tcpReceive(socket, data, size, received, flags);
+   //Save the pacing settings
+   socket->pacingEnabled = enable;
+   socket->pacingMaxRate = maxRate;
+   //The next segment may be sent right away
+   socket->pacingNextTime = osGetTickCount();
+   socket->pacingRemainder = 0;
 
-      //Output parameters
-      if(remoteIpAddr)
-         *remoteIpAddr = socket->remoteIpAddr;
-      if(remotePort)
-         *remotePort = socket->remotePort;
-   }
-   else
+   //The pacing timer is no longer needed
+   if(!enable)
+      osTimerStop(&socket->pacingTimer);
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+
+   //No error to report
+   return NO_ERROR;
+#else
+   return ERROR_NOT_IMPLEMENTED;
 #endif
-#if (UDP_SUPPORT == ENABLED)
-   //Connectionless socket?
-   if(socket->type == SOCKET_TYPE_DGRAM)
-   {
-      //Receive UDP datagram
-      error = udpReceiveDatagram(socket, remoteIpAddr,
-         remotePort, data, size, received, flags);
-   }
-   else
+}
+
+
+/**
+ * @brief Set the lower bound of the retransmission timeout
+ *
+ * The default floor of TCP_MIN_RTO suits the Internet. On a local
+ * network with sub-millisecond round-trip times, a lower value lets
+ * the connection recover from a loss within a few round-trips.
+ * Accepted sockets inherit the setting of the listening socket
+ *
+ * @param[in] socket Handle to a socket
+ * @param[in] minRto Minimum retransmission timeout, in milliseconds
+ * @return Error code
+ **/
+
+error_t socketSetMinRto(Socket *socket, time_t minRto)
+{
+#if (TCP_SUPPORT == ENABLED)
+   //Check parameters
+   if(!socket || minRto < TCP_TICK_INTERVAL || minRto > TCP_MAX_RTO)
+      return ERROR_INVALID_PARAMETER;
+   //The option only applies to connection-oriented sockets
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return ERROR_INVALID_SOCKET;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+   //Save the new bound
+   socket->minRto = minRto;
+   //The current RTO must honor it
+   socket->rto = max(socket->rto, minRto);
+   //Leave critical section
+   osMutexRelease(socketMutex);
+
+   //No error to report
+   return NO_ERROR;
+#else
+   return ERROR_NOT_IMPLEMENTED;
 #endif
-#if (RAW_SOCKET_SUPPORT == ENABLED)
-   //Raw socket?
-   if(socket->type == SOCKET_TYPE_RAW)
+}
+
+
+/**
+ * @brief Select the congestion control algorithm of a socket
+ * @param[in] socket Handle to a socket
+ * @param[in] name Name of the algorithm ("newreno" or "cubic")
+ * @return Error code
+ **/
+
+error_t socketSetCongestionControl(Socket *socket, const char_t *name)
+{
+#if (TCP_SUPPORT == ENABLED)
+   error_t error;
+   const TcpCongestionAlgo *algo;
+
+   //Check parameters
+   if(!socket || !name)
+      return ERROR_INVALID_PARAMETER;
+   //The option only applies to connection-oriented sockets
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return ERROR_INVALID_SOCKET;
+
+   //Search for the specified algorithm
+   algo = tcpGetCongestionAlgo(name);
+   //Not available?
+   if(!algo)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+   //The algorithm cannot be changed once the connection is being established
+   if(socket->state == TCP_STATE_CLOSED || socket->state == TCP_STATE_LISTEN)
    {
-      //Receive raw data
-      error = rawSocketReceiveDatagram(socket,
-         remoteIpAddr, data, size, received, flags);
+      //Save the algorithm
+      socket->congestionAlgo = algo;
+      //Successful processing
+      error = NO_ERROR;
    }
    else
-#endif
-   //Socket type not supported...
    {
-      //No data can be read
-      *received = 0;
-      //Invalid socket type
-      error = ERROR_INVALID_SOCKET;
+      //Report an error
+      error = ERROR_WRONG_STATE;
    }
 
    //Leave critical section
    osMutexRelease(socketMutex);
+
    //Return status code
    return error;
+#else
+   return ERROR_NOT_IMPLEMENTED;
+#endif
 }
 
 
 /**
- * @brief Retrieves the local address for a given socket
- * @param[in] socket Handle that identifies a socket
- * @param[out] localIpAddr Local IP address (optional)
- * @param[out] localPort Local port number (optional)
+ * @brief Attach a packet filter to a raw socket
+ *
+ * The program is evaluated against each incoming packet before any
+ * memory is allocated for it. The instructions are not copied, hence
+ * the array must remain valid as long as the filter is attached
+ *
+ * @param[in] socket Handle to a socket
+ * @param[in] program Pointer to the filter instructions (NULL to detach the current filter)
+ * @param[in] count Number of instructions
  * @return Error code
  **/
 
-error_t socketGetLocalAddr(Socket *socket, IpAddr *localIpAddr, uint16_t *localPort)
+error_t socketSetFilter(Socket *socket, const RawSocketFilterInsn *program, uint_t count)
 {
+#if (RAW_SOCKET_SUPPORT == ENABLED && RAW_SOCKET_FILTER_SUPPORT == ENABLED)
+   error_t error;
+
    //Make sure the socket handle is valid
    if(!socket)
       return ERROR_INVALID_PARAMETER;
+   //The option only applies to raw sockets
+   if(socket->type != SOCKET_TYPE_RAW)
+      return ERROR_INVALID_SOCKET;
 
-   //Retrieve local IP address
-   if(localIpAddr != NULL)
-      *localIpAddr = socket->localIpAddr;
+   //Validate the program before attaching it
+   if(program != NULL)
+   {
+      //Reject programs that could misbehave
+      error = rawSocketFilterCheck(program, count);
+      //Any error to report?
+      if(error)
+         return error;
+   }
+   else
+   {
+      //Detach the current filter
+      count = 0;
+   }
 
-   //Retrieve local port number
-   if(localPort != NULL)
-      *localPort = socket->localPort;
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+   //Save the filter program
+   socket->filter = program;
+   socket->filterLength = count;
+   //Leave critical section
+   osMutexRelease(socketMutex);
 
-   //Successful processing
+   //No error to report
    return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
 }
 
 
 /**
- * @brief Retrieves the address of the peer to which a socket is connected
- * @param[in] socket Handle that identifies a socket
- * @param[out] remoteIpAddr IP address of the remote host (optional)
- * @param[out] remotePort Remote port number (optional)
+ * @brief Select the sources a socket receives multicast traffic from
+ *
+ * The filter applies to the group membership held by the interface the
+ * socket is bound to (or the default interface). The group must have been
+ * joined with ipJoinMulticastGroup beforehand. The filter is shared by all
+ * the sockets receiving traffic for that group on the interface
+ *
+ * @param[in] socket Handle to a socket
+ * @param[in] groupAddr IP address identifying the host group
+ * @param[in] filterMode Filter mode (include or exclude)
+ * @param[in] srcAddr List of source addresses
+ * @param[in] srcAddrCount Number of source addresses
  * @return Error code
  **/
 
-error_t socketGetRemoteAddr(Socket *socket, IpAddr *remoteIpAddr, uint16_t *remotePort)
+error_t socketSetMulticastSourceFilter(Socket *socket, const IpAddr *groupAddr,
+   IpFilterMode filterMode, const IpAddr *srcAddr, uint_t srcAddrCount)
 {
    //Make sure the socket handle is valid
-   if(!socket)
+   if(!socket || !groupAddr)
       return ERROR_INVALID_PARAMETER;
+   //The option only applies to connectionless and raw sockets
+   if(socket->type == SOCKET_TYPE_STREAM)
+      return ERROR_INVALID_SOCKET;
 
-   //Retrieve local IP address
-   if(remoteIpAddr != NULL)
-      *remoteIpAddr = socket->remoteIpAddr;
+   //Update the source filter of the group on the relevant interface
+   return ipSetMulticastSourceFilter(socket->interface, groupAddr,
+      filterMode, srcAddr, srcAddrCount);
+}
 
-   //Retrieve local port number
-   if(remotePort != NULL)
+
+/**
+ * @brief Bind a socket to a particular network interface
+ * @param[in] socket Handle to a socket
+ * @param[in] interface Network interface to be used
+ * @return Error code
+ **/
+
+error_t socketBindToInterface(Socket *socket, NetInterface *interface)
+{
+   //Check input parameters
+   if(!socket || !interface)
+      return ERROR_INVALID_PARAMETER;
+
+   //Explicitly associate the socket with the specified interface
+   socket->interface = interface;
+
+   //No error to report
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Associate a local address with a socket
+ * @param[in] socket Handle to a socket
+ * @param[in] localIpAddr Local address to assign to the bound socket
+ * @param[in] localPort Local port number to assign to the bound socket
+ * @return Error code
+ **/
+
+error_t socketBind(Socket *socket, const IpAddr *localIpAddr, uint16_t localPort)
+{
+   //Check input parameters
+   if(!socket || !localIpAddr)
+      return ERROR_INVALID_PARAMETER;
+   //Make sure the socket type is correct
+   if(socket->type != SOCKET_TYPE_STREAM && socket->type != SOCKET_TYPE_DGRAM)
+      return ERROR_INVALID_SOCKET;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+   //Associate the specified IP address and port number
+   socket->localIpAddr = *localIpAddr;
+   socket->localPort = localPort;
+
+   //Index the socket under its new port
+   socketPortInsert(socket);
+
+#if (TCP_SUPPORT == ENABLED)
+   //A listening or connected socket must be indexed under its new port
+   if(socket->type == SOCKET_TYPE_STREAM && socket->hashBucket != NULL)
+      tcpHashSocket(socket);
+#endif
+#if (UDP_SUPPORT == ENABLED)
+   //Connectionless sockets are indexed by their local port
+   if(socket->type == SOCKET_TYPE_DGRAM)
+      udpHashSocket(socket);
+#endif
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+
+   //No error to report
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Establish a connection to a specified socket
+ * @param[in] socket Handle to an unconnected socket
+ * @param[in] remoteIpAddr IP address of the remote host
+ * @param[in] remotePort Remote port number that will be used to establish the connection
+ * @return Error code
+ **/
+
+error_t socketConnect(Socket *socket, const IpAddr *remoteIpAddr, uint16_t remotePort)
+{
+   error_t error;
+
+   //Check input parameters
+   if(!socket || !remoteIpAddr)
+      return ERROR_INVALID_PARAMETER;
+
+#if (TCP_SUPPORT == ENABLED)
+   //Connection-oriented socket?
+   if(socket->type == SOCKET_TYPE_STREAM)
+   {
+      //Save port number and IP address of the remote host
+      socket->remoteIpAddr = *remoteIpAddr;
+      socket->remotePort = remotePort;
+
+      //Select the source address and the relevant network interface
+      //to use when establishing the connection
+      error = ipSelectSourceAddr(&socket->interface,
+         &socket->remoteIpAddr, &socket->localIpAddr);
+      //Any error to report?
+      if(error) return error;
+
+      //Make sure the source address is valid
+      if(ipIsUnspecifiedAddr(&socket->localIpAddr))
+         return ERROR_NOT_CONFIGURED;
+
+      //Enter critical section
+      osMutexAcquire(socketMutex);
+      //Establish TCP connection
+      error = tcpConnect(socket, NULL, 0, NULL);
+      //Leave critical section
+      osMutexRelease(socketMutex);
+   }
+   else
+#endif
+   //Connectionless socket?
+   if(socket->type == SOCKET_TYPE_DGRAM)
+   {
+      //Save port number and IP address of the remote host
+      socket->remoteIpAddr = *remoteIpAddr;
+      socket->remotePort = remotePort;
+      //No error to report
+      error = NO_ERROR;
+   }
+   //Raw socket?
+   else if(socket->type == SOCKET_TYPE_RAW)
+   {
+      //Save the IP address of the remote host
+      socket->remoteIpAddr = *remoteIpAddr;
+      //No error to report
+      error = NO_ERROR;
+   }
+   //Socket type not supported...
+   else
+   {
+      //Invalid socket type
+      error = ERROR_INVALID_SOCKET;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Establish a connection and send the initial data in the SYN
+ *
+ * The data is carried by the SYN when a TCP Fast Open cookie has been
+ * obtained from the server, and sent once the connection is established
+ * otherwise. At most one segment worth of data is queued; the remaining
+ * data must be sent with socketSend()
+ *
+ * @param[in] socket Handle to an unconnected socket
+ * @param[in] remoteIpAddr IP address of the remote host
+ * @param[in] remotePort Remote port number that will be used to establish the connection
+ * @param[in] data Pointer to the initial data
+ * @param[in] length Length of the initial data
+ * @param[out] written Actual number of bytes queued (optional parameter)
+ * @return Error code
+ **/
+
+error_t socketFastOpen(Socket *socket, const IpAddr *remoteIpAddr,
+   uint16_t remotePort, const void *data, size_t length, size_t *written)
+{
+   error_t error;
+
+   //Check input parameters
+   if(!socket || !remoteIpAddr || (!data && length))
+      return ERROR_INVALID_PARAMETER;
+   //Fast Open only applies to connection-oriented sockets
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return ERROR_INVALID_SOCKET;
+
+#if (TCP_SUPPORT == ENABLED && TCP_FAST_OPEN_SUPPORT == ENABLED)
+   //Save port number and IP address of the remote host
+   socket->remoteIpAddr = *remoteIpAddr;
+   socket->remotePort = remotePort;
+
+   //Select the source address and the relevant network interface
+   //to use when establishing the connection
+   error = ipSelectSourceAddr(&socket->interface,
+      &socket->remoteIpAddr, &socket->localIpAddr);
+   //Any error to report?
+   if(error) return error;
+
+   //Make sure the source address is valid
+   if(ipIsUnspecifiedAddr(&socket->localIpAddr))
+      return ERROR_NOT_CONFIGURED;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+   //Establish TCP connection
+   error = tcpConnect(socket, data, length, written);
+   //Leave critical section
+   osMutexRelease(socketMutex);
+#else
+   //Establish the connection first
+   error = socketConnect(socket, remoteIpAddr, remotePort);
+   //Then send the initial data
+   if(!error)
+      error = socketSend(socket, data, length, written, 0);
+#endif
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Place a socket in the listening state
+ *
+ * Place a socket in a state in which it is listening for an incoming connection
+ *
+ * @param[in] socket Socket to place in the listening state
+ * @return Error code
+ **/
+
+error_t socketListen(Socket *socket)
+{
+#if (TCP_SUPPORT == ENABLED)
+   error_t error;
+
+   //Make sure the socket handle is valid
+   if(!socket)
+      return ERROR_INVALID_PARAMETER;
+   //This function shall be used with connection-oriented socket types
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return ERROR_INVALID_SOCKET;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+   //Start listening for an incoming connection
+   error = tcpListen(socket);
+   //Leave critical section
+   osMutexRelease(socketMutex);
+
+   //Return status code
+   return error;
+#else
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Permit an incoming connection attempt on a socket
+ * @param[in] socket Handle to a socket previously placed in a listening state
+ * @param[out] clientIpAddr IP address of the client
+ * @param[out] clientPort Port number used by the client
+ * @return Handle to the socket in which the actual connection is made
+ **/
+
+Socket *socketAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort)
+{
+#if (TCP_SUPPORT == ENABLED)
+   Socket *newSocket;
+
+   //Make sure the socket handle is valid
+   if(!socket)
+      return NULL;
+   //This function shall be used with connection-oriented socket types
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return NULL;
+
+   //Accept an incoming connection attempt
+   newSocket = tcpAccept(socket, clientIpAddr, clientPort);
+
+   //Return a handle to the newly created socket
+   return newSocket;
+#else
+   return NULL;
+#endif
+}
+
+
+/**
+ * @brief Send data to a connected socket
+ * @param[in] socket Handle that identifies a connected socket
+ * @param[in] data Pointer to a buffer containing the data to be transmitted
+ * @param[in] length Number of data bytes to send
+ * @param[out] written Actual number of bytes written (optional parameter)
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t socketSend(Socket *socket, const void *data,
+   size_t length, size_t *written, uint_t flags)
+{
+   //Instrumentation point
+   PROBE_ENTER(PROBE_SOCKET_SEND);
+
+   //Use default remote IP address for connectionless or raw sockets
+   return socketSendTo(socket, &socket->remoteIpAddr,
+      socket->remotePort, data, length, written, flags);
+}
+
+
+/**
+ * @brief Send immutable data without copying it
+ *
+ * On TCP sockets, the data is referenced by the send buffer rather than
+ * copied into it. The memory must remain valid and unchanged until the
+ * data has been acknowledged (resource blobs or constant tables, for
+ * instance). SOCKET_FLAG_WAIT_ACK can be used for volatile memory
+ *
+ * @param[in] socket Handle that identifies a connected socket
+ * @param[in] data Pointer to a buffer containing the data to be transmitted
+ * @param[in] length Number of data bytes to send
+ * @param[out] written Actual number of bytes written (optional parameter)
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t socketSendFile(Socket *socket, const void *data,
+   size_t length, size_t *written, uint_t flags)
+{
+   //Send data without staging it through the send buffer
+   return socketSend(socket, data, length, written, flags | SOCKET_FLAG_NO_COPY);
+}
+
+
+/**
+ * @brief Send a datagram to a specific destination
+ * @param[in] socket Handle that identifies a socket
+ * @param[in] remoteIpAddr IP address of the target host
+ * @param[in] remotePort Target port number
+ * @param[in] data Pointer to a buffer containing the data to be transmitted
+ * @param[in] length Number of data bytes to send
+ * @param[out] written Actual number of bytes written (optional parameter)
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t socketSendTo(Socket *socket, const IpAddr *remoteIpAddr, uint16_t remotePort,
+   const void *data, size_t length, size_t *written, uint_t flags)
+{
+   error_t error;
+
+   //No data has been transmitted yet
+   if(written)
+      *written = 0;
+
+   //Make sure the socket handle is valid
+   if(!socket)
+      return ERROR_INVALID_PARAMETER;
+
+#if (TCP_SUPPORT == ENABLED)
+   //Connection-oriented socket?
+   if(socket->type == SOCKET_TYPE_STREAM)
+   {
+      //Enter critical section
+      osMutexAcquire(socketMutex);
+      //For connection-oriented sockets, target address is ignored
+      error = tcpSend(socket, data, length, written, flags);
+      //Leave critical section
+      osMutexRelease(socketMutex);
+   }
+   else
+#endif
+#if (UDP_SUPPORT == ENABLED)
+   //Connectionless socket?
+   if(socket->type == SOCKET_TYPE_DGRAM)
+   {
+      //Send UDP datagram
+      error = udpSendDatagram(socket, remoteIpAddr,
+         remotePort, data, length, written);
+   }
+   else
+#endif
+#if (RAW_SOCKET_SUPPORT == ENABLED)
+   //Raw socket?
+   if(socket->type == SOCKET_TYPE_RAW)
+   {
+      //Send raw datagram
+      error = rawSocketSendDatagram(socket,
+         remoteIpAddr, data, length, written);
+   }
+   else
+#endif
+   //Socket type not supported...
+   {
+      //Invalid socket type
+      error = ERROR_INVALID_SOCKET;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Receive data from a connected socket
+ * @param[in] socket Handle that identifies a connected socket
+ * @param[out] data Buffer where to store the incoming data
+ * @param[in] size Maximum number of bytes that can be received
+ * @param[out] received Number of bytes that have been received
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t socketReceive(Socket *socket, void *data,
+   size_t size, size_t *received, uint_t flags)
+{
+   //Instrumentation point
+   PROBE_ENTER(PROBE_SOCKET_RECEIVE);
+
+   //For connection-oriented sockets, remote address is ignored
+   return socketReceiveFrom(socket, NULL, NULL, data, size, received, flags);
+}
+
+
+/**
+ * @brief Receive a datagram
+ * @param[in] socket Handle that identifies a socket
+ * @param[out] remoteIpAddr IP address of the remote host (optional)
+ * @param[out] remotePort Port number used by the remote host (optional)
+ * @param[out] data Buffer where to store the incoming data
+ * @param[in] size Maximum number of bytes that can be received
+ * @param[out] received Number of bytes that have been received
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t socketReceiveFrom(Socket *socket, IpAddr *remoteIpAddr,
+   uint16_t *remotePort, void *data, size_t size, size_t *received, uint_t flags)
+{
+   error_t error;
+
+   //Make sure the socket handle is valid
+   if(!socket)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+#if (TCP_SUPPORT == ENABLED)
+   //Connection-oriented socket?
+   if(socket->type == SOCKET_TYPE_STREAM)
+   {
+      //Receive data
+      error = tcpReceive(socket, data, size, received, flags);
+
+      //Output parameters
+      if(remoteIpAddr)
+         *remoteIpAddr = socket->remoteIpAddr;
+      if(remotePort)
+         *remotePort = socket->remotePort;
+   }
+   else
+#endif
+#if (UDP_SUPPORT == ENABLED)
+   //Connectionless socket?
+   if(socket->type == SOCKET_TYPE_DGRAM)
+   {
+      //Receive UDP datagram
+      error = udpReceiveDatagram(socket, remoteIpAddr,
+         remotePort, data, size, received, flags);
+   }
+   else
+#endif
+#if (RAW_SOCKET_SUPPORT == ENABLED)
+   //Raw socket?
+   if(socket->type == SOCKET_TYPE_RAW)
+   {
+      //Receive raw data
+      error = rawSocketReceiveDatagram(socket,
+         remoteIpAddr, data, size, received, flags);
+   }
+   else
+#endif
+   //Socket type not supported...
+   {
+      //No data can be read
+      *received = 0;
+      //Invalid socket type
+      error = ERROR_INVALID_SOCKET;
+   }
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send data gathered from several buffers (connected socket)
+ *
+ * The buffers are queued in the send buffer as a single write operation,
+ * so that segment boundaries do not depend on the way the data is split
+ *
+ * @param[in] socket Handle that identifies a connected socket
+ * @param[in] iov Array of buffers that hold the data to be sent
+ * @param[in] count Number of entries in the array
+ * @param[out] written Actual number of bytes written (optional parameter)
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t socketSendv(Socket *socket, const SocketIoVec *iov,
+   uint_t count, size_t *written, uint_t flags)
+{
+#if (TCP_SUPPORT == ENABLED)
+   error_t error;
+   uint_t i;
+   size_t n;
+   size_t total;
+
+   //No data has been transmitted yet
+   if(written)
+      *written = 0;
+
+   //Check parameters
+   if(!socket || (!iov && count))
+      return ERROR_INVALID_PARAMETER;
+   //Gather operations are only supported by connection-oriented sockets
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return ERROR_INVALID_SOCKET;
+
+   //Initialize status code
+   error = NO_ERROR;
+   //Number of bytes written so far
+   total = 0;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+   //Loop through the buffers
+   for(i = 0; i < count; i++)
+   {
+      //tcpSend leaves the byte count untouched when it fails early
+      n = 0;
+
+      //Partial segments are held back until the last buffer is queued
+      if(i < (count - 1))
+         error = tcpSend(socket, iov[i].data, iov[i].length, &n,
+            (flags | SOCKET_FLAG_MORE) & ~SOCKET_FLAG_WAIT_ACK);
+      else
+         error = tcpSend(socket, iov[i].data, iov[i].length, &n, flags);
+
+      //Total number of bytes written
+      total += n;
+
+      //Any error to report?
+      if(error)
+      {
+         //Restore the hint requested by the caller
+         socket->txMore = (flags & SOCKET_FLAG_MORE) ? TRUE : FALSE;
+
+         //The data already queued must not be held back
+         if(socket->state == TCP_STATE_ESTABLISHED || socket->state == TCP_STATE_CLOSE_WAIT)
+            tcpNagleAlgo(socket);
+
+         //Exit immediately
+         break;
+      }
+   }
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+
+   //Return the actual number of bytes written
+   if(written)
+      *written = total;
+
+   //Return status code
+   return error;
+#else
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Receive data into several buffers (connected socket)
+ *
+ * The buffers are filled in order. The function returns as soon as
+ * the data that is already queued has been delivered, unless the
+ * SOCKET_FLAG_WAIT_ALL flag is specified
+ *
+ * @param[in] socket Handle that identifies a connected socket
+ * @param[in] iov Array of buffers where to store the incoming data
+ * @param[in] count Number of entries in the array
+ * @param[out] received Number of bytes that have been received
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t socketReceivev(Socket *socket, const SocketIoVec *iov,
+   uint_t count, size_t *received, uint_t flags)
+{
+#if (TCP_SUPPORT == ENABLED)
+   error_t error;
+   uint_t i;
+   size_t n;
+   size_t total;
+
+   //No data has been received yet
+   *received = 0;
+
+   //Check parameters
+   if(!socket || (!iov && count))
+      return ERROR_INVALID_PARAMETER;
+   //Scatter operations are only supported by connection-oriented sockets
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return ERROR_INVALID_SOCKET;
+
+   //A break character would split the stream across buffers arbitrarily
+   flags &= ~(SOCKET_FLAG_BREAK_CHAR | 0xFF);
+
+   //Initialize status code
+   error = NO_ERROR;
+   //Number of bytes received so far
+   total = 0;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+   //Loop through the buffers
+   for(i = 0; i < count; i++)
+   {
+      //Skip empty buffers
+      if(!iov[i].length)
+         continue;
+
+      //Do not wait for more data once some bytes have been delivered
+      if(total > 0 && !(flags & SOCKET_FLAG_WAIT_ALL) && !socket->rcvUser)
+         break;
+
+      //Receive data
+      error = tcpReceive(socket, iov[i].data, iov[i].length, &n, flags);
+
+      //Total number of bytes received
+      total += n;
+
+      //Any error to report?
+      if(error)
+      {
+         //The end of the stream is reported by the next call
+         if(total > 0 && error == ERROR_END_OF_STREAM)
+            error = NO_ERROR;
+
+         //Exit immediately
+         break;
+      }
+
+      //The buffer could not be filled entirely?
+      if(n < iov[i].length)
+         break;
+      //Peeked data is not consumed, so only the first buffer can be filled
+      if(flags & SOCKET_FLAG_PEEK)
+         break;
+   }
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+
+   //Return the actual number of bytes received
+   *received = total;
+
+   //Return status code
+   return error;
+#else
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Send a batch of datagrams (UDP or raw sockets)
+ *
+ * Datagrams are sent in order. The function stops at the first
+ * datagram that cannot be sent
+ *
+ * @param[in] socket Handle to a socket
+ * @param[in,out] messages Array of datagram descriptors
+ * @param[in] count Number of datagrams to send
+ * @param[out] sent Number of datagrams actually sent
+ * @return Error code
+ **/
+
+error_t socketSendBatch(Socket *socket, SocketMessage *messages, uint_t count, uint_t *sent)
+{
+   uint_t i;
+   error_t error;
+
+   //Check input parameters
+   if(!socket || !messages || !sent)
+      return ERROR_INVALID_PARAMETER;
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Loop through datagram descriptors
+   for(i = 0; i < count && !error; i++)
+   {
+      //No data has been transmitted yet
+      messages[i].length = 0;
+
+#if (UDP_SUPPORT == ENABLED)
+      //Connectionless socket?
+      if(socket->type == SOCKET_TYPE_DGRAM)
+      {
+         //Send UDP datagram
+         error = udpSendDatagram(socket, &messages[i].remoteIpAddr, messages[i].remotePort,
+            messages[i].data, messages[i].size, &messages[i].length);
+      }
+      else
+#endif
+#if (RAW_SOCKET_SUPPORT == ENABLED)
+      //Raw socket?
+      if(socket->type == SOCKET_TYPE_RAW)
+      {
+         //Send raw datagram
+         error = rawSocketSendDatagram(socket, &messages[i].remoteIpAddr,
+            messages[i].data, messages[i].size, &messages[i].length);
+      }
+      else
+#endif
+      //Socket type not supported...
+      {
+         //Invalid socket type
+         error = ERROR_INVALID_SOCKET;
+      }
+   }
+
+   //Number of datagrams actually sent
+   *sent = error ? i - 1 : i;
+
+   //Report an error only if no datagram could be sent
+   return *sent ? NO_ERROR : error;
+}
+
+
+/**
+ * @brief Receive a batch of datagrams (UDP only)
+ *
+ * The function waits for the first datagram, then returns every
+ * datagram that is already queued, up to the size of the array
+ *
+ * @param[in] socket Handle to a socket
+ * @param[in,out] messages Array of datagram descriptors
+ * @param[in] count Number of entries in the array
+ * @param[out] received Number of datagrams actually received
+ * @return Error code
+ **/
+
+error_t socketReceiveBatch(Socket *socket, SocketMessage *messages, uint_t count, uint_t *received)
+{
+   error_t error;
+
+   //Check input parameters
+   if(!socket || !messages || !count || !received)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+#if (UDP_SUPPORT == ENABLED)
+   //Connectionless socket?
+   if(socket->type == SOCKET_TYPE_DGRAM)
+   {
+      //Dequeue as many UDP datagrams as possible
+      error = udpReceiveDatagramBatch(socket, messages, count, received);
+   }
+   else
+#endif
+   //Socket type not supported...
+   {
+      //No datagram can be read
+      *received = 0;
+      //Invalid socket type
+      error = ERROR_INVALID_SOCKET;
+   }
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Receive a datagram without copying it (UDP only)
+ *
+ * Ownership of the queued buffer is transferred to the caller. The
+ * payload starts at queueItem->offset within queueItem->buffer. The
+ * datagram must be given back with socketReleaseDatagram
+ *
+ * @param[in] socket Handle to a socket
+ * @param[out] queueItem Receive queue item describing the datagram
+ * @return Error code
+ **/
+
+error_t socketReceiveDatagram(Socket *socket, SocketQueueItem **queueItem)
+{
+   error_t error;
+
+   //Check input parameters
+   if(!socket || !queueItem)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+#if (UDP_SUPPORT == ENABLED)
+   //Connectionless socket?
+   if(socket->type == SOCKET_TYPE_DGRAM)
+   {
+      //Dequeue the next UDP datagram
+      error = udpReceiveDatagramEx(socket, queueItem);
+   }
+   else
+#endif
+   //Socket type not supported...
+   {
+      //No datagram can be read
+      *queueItem = NULL;
+      //Invalid socket type
+      error = ERROR_INVALID_SOCKET;
+   }
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Release a datagram obtained with socketReceiveDatagram
+ * @param[in] queueItem Receive queue item describing the datagram
+ **/
+
+void socketReleaseDatagram(SocketQueueItem *queueItem)
+{
+   //Make sure the pointer is valid
+   if(!queueItem) return;
+
+#if (UDP_SUPPORT == ENABLED)
+   //Free the memory used by the datagram
+   udpReleaseDatagram(queueItem);
+#endif
+}
+
+
+/**
+ * @brief Retrieves the local address for a given socket
+ * @param[in] socket Handle that identifies a socket
+ * @param[out] localIpAddr Local IP address (optional)
+ * @param[out] localPort Local port number (optional)
+ * @return Error code
+ **/
+
+error_t socketGetLocalAddr(Socket *socket, IpAddr *localIpAddr, uint16_t *localPort)
+{
+   //Make sure the socket handle is valid
+   if(!socket)
+      return ERROR_INVALID_PARAMETER;
+
+   //Retrieve local IP address
+   if(localIpAddr != NULL)
+      *localIpAddr = socket->localIpAddr;
+
+   //Retrieve local port number
+   if(localPort != NULL)
+      *localPort = socket->localPort;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Retrieves the address of the peer to which a socket is connected
+ * @param[in] socket Handle that identifies a socket
+ * @param[out] remoteIpAddr IP address of the remote host (optional)
+ * @param[out] remotePort Remote port number (optional)
+ * @return Error code
+ **/
+
+error_t socketGetRemoteAddr(Socket *socket, IpAddr *remoteIpAddr, uint16_t *remotePort)
+{
+   //Make sure the socket handle is valid
+   if(!socket)
+      return ERROR_INVALID_PARAMETER;
+
+   //Retrieve local IP address
+   if(remoteIpAddr != NULL)
+      *remoteIpAddr = socket->remoteIpAddr;
+
+   //Retrieve local port number
+   if(remotePort != NULL)
       *remotePort = socket->remotePort;
 
    //Successful processing
@@ -604,272 +1826,1225 @@ error_t socketGetRemoteAddr(Socket *socket, IpAddr *remoteIpAddr, uint16_t *remo
 
 
 /**
- * @brief Disable reception, transmission, or both
- *
- * Note that socketShutdown() does not close the socket, and resources attached
- * to the socket will not be freed until socketClose() is invoked
- *
+ * @brief Retrieve the state and statistics of a TCP connection
+ * @param[in] socket Handle that identifies a socket
+ * @param[out] info Connection state and statistics
+ * @return Error code
+ **/
+
+error_t socketGetTcpInfo(Socket *socket, TcpInfo *info)
+{
+   //Make sure the socket handle is valid
+   if(!socket || !info)
+      return ERROR_INVALID_PARAMETER;
+
+#if (TCP_SUPPORT == ENABLED)
+   //This function shall be used with connection-oriented socket types
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return ERROR_INVALID_SOCKET;
+
+   //Retrieve a snapshot of the connection
+   return tcpGetInfo(socket, info);
+#else
+   //TCP support is disabled
+   return ERROR_INVALID_SOCKET;
+#endif
+}
+
+
+/**
+ * @brief Disable reception, transmission, or both
+ *
+ * Note that socketShutdown() does not close the socket, and resources attached
+ * to the socket will not be freed until socketClose() is invoked
+ *
+ * @param[in] socket Handle to a socket
+ * @param[in] how Flag that describes what types of operation will no longer be allowed
+ * @return Error code
+ **/
+
+error_t socketShutdown(Socket *socket, uint_t how)
+{
+#if (TCP_SUPPORT == ENABLED)
+   error_t error;
+
+   //Make sure the socket handle is valid
+   if(!socket)
+      return ERROR_INVALID_PARAMETER;
+   //Make sure the socket type is correct
+   if(socket->type != SOCKET_TYPE_STREAM)
+      return ERROR_INVALID_SOCKET;
+   //Check flags
+   if((how != SOCKET_SD_SEND) && (how != SOCKET_SD_RECEIVE) && (how != SOCKET_SD_BOTH))
+      return ERROR_INVALID_PARAMETER;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+   //Graceful shutdown
+   error = tcpShutdown(socket, how);
+   //Leave critical section
+   osMutexRelease(socketMutex);
+
+   //Return status code
+   return error;
+#else
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Close an existing socket
+ * @param[in] socket Handle identifying the socket to close
+ **/
+
+void socketClose(Socket *socket)
+{
+   //Make sure the socket handle is valid
+   if(!socket) return;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+#if (SOCKET_EVENT_SET_SUPPORT == ENABLED)
+   //A closed socket is no longer monitored
+   socketEventSetDetach(socket);
+#endif
+
+#if (TCP_SUPPORT == ENABLED)
+   //Connection-oriented socket?
+   if(socket->type == SOCKET_TYPE_STREAM)
+   {
+      //Abort the current TCP connection
+      tcpAbort(socket);
+   }
+   else
+#endif
+   //Connectionless socket or raw socket?
+   {
+      //Point to the first item in the receive queue
+      SocketQueueItem *queueItem = socket->receiveQueue;
+
+      //Stop delivering incoming datagrams to the socket
+      socketHashRemove(socket);
+
+      //Purge the receive queue
+      while(queueItem)
+      {
+         //Keep track of the next item in the queue
+         SocketQueueItem *nextQueueItem = queueItem->next;
+         //The memory is no longer held by the socket
+         socketMemUncharge(socket, chunkedBufferGetLength(queueItem->buffer));
+         //Free previously allocated memory
+         chunkedBufferFree(queueItem->buffer);
+         //Point to the next item
+         queueItem = nextQueueItem;
+      }
+
+      //Mark the socket as closed
+      socketRelease(socket);
+   }
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+}
+
+
+/**
+ * @brief Get a cleared control block for a new socket
+ * @param[in] descriptor Socket descriptor
+ * @param[in] type Type specification for the new socket
+ * @return Pointer to the control block or NULL if out of resources
+ **/
+
+static Socket *socketAllocate(uint_t descriptor, uint_t type)
+{
+   Socket *socket;
+
+#if (SOCKET_DYNAMIC_ALLOC_SUPPORT == ENABLED)
+   size_t size;
+
+   //UDP and raw sockets do not need the TCP control block
+   if(type == SOCKET_TYPE_STREAM)
+      size = sizeof(Socket);
+   else
+      size = SOCKET_CONNECTIONLESS_SIZE;
+
+   //Allocate a new control block
+   socket = osMemAlloc(size);
+   //Failed to allocate memory?
+   if(!socket)
+      return NULL;
+
+   //Clear associated structure
+   memset(socket, 0, size);
+
+   //Create an event object to track socket events
+   socket->event = osEventCreate(FALSE, FALSE);
+
+   //Out of resources?
+   if(socket->event == OS_INVALID_HANDLE)
+   {
+      //Clean up side effects
+      osMemFree(socket);
+      //Report an error
+      return NULL;
+   }
+
+   //Bind the control block to the descriptor
+   socketTable[descriptor] = socket;
+#else
+   OsEvent *event;
+
+   //Point to the statically allocated control block
+   socket = socketTable[descriptor];
+   //Save event object instance
+   event = socket->event;
+
+   //Clear associated structure
+   memset(socket, 0, sizeof(Socket));
+
+   //Reuse event objects and avoid recreating them whenever possible
+   socket->event = event;
+#endif
+
+   //Return a pointer to the control block
+   return socket;
+}
+
+
+/**
+ * @brief Release a socket once it is no longer referenced
+ *
+ * The caller must hold the socket mutex. When dynamic allocation is
+ * enabled, the socket handle must not be used after this call
+ *
+ * @param[in] socket Handle to the socket to release
+ **/
+
+void socketRelease(Socket *socket)
+{
+#if (SOCKET_MEM_ACCOUNTING_SUPPORT == ENABLED)
+   //Whatever the socket still holds is given back to its class
+   if(socket->memUsage > 0)
+   {
+      socketMemClassUsage[socket->type] -= socket->memUsage;
+      socketMemTotalUsage -= socket->memUsage;
+      socket->memUsage = 0;
+      //Wake up the tasks waiting for memory
+      osEventSet(socketMemEvent);
+   }
+#endif
+
+#if (SOCKET_EVENT_SET_SUPPORT == ENABLED)
+   //Remove the socket from the event set it belongs to
+   socketEventSetDetach(socket);
+#endif
+
+#if (TCP_SUPPORT == ENABLED)
+   //Remove the connection from the timer wheel
+   if(socket->type == SOCKET_TYPE_STREAM)
+      netTimerStop(&socket->timer);
+#endif
+
+   //The local port is no longer in use
+   socketPortRemove(socket);
+
+   //Mark the socket as closed
+   socket->type = SOCKET_TYPE_UNUSED;
+
+#if (SOCKET_DYNAMIC_ALLOC_SUPPORT == ENABLED)
+   //The descriptor can be reused
+   socketTable[socket->descriptor] = NULL;
+   //Delete the event object
+   osEventClose(socket->event);
+   //Free the control block
+   osMemFree(socket);
+#endif
+}
+
+
+/**
+ * @brief Wait for one of a set of sockets to become ready to perform I/O
+ *
+ * The socketPoll function determines the status of one or more sockets,
+ * waiting if necessary, to perform synchronous I/O
+ *
+ * @param[in,out] eventDesc Set of entries specifying the events the user is interested in
+ * @param[in] size Number of entries in the descriptor set
+ * @param[in] extEvent External event that can abort the wait if necessary (optional)
+ * @param[in] timeout Maximum time to wait before returning
+ * @return Error code
+ **/
+
+error_t socketPoll(SocketEventDesc *eventDesc, uint_t size, OsEvent *extEvent, time_t timeout)
+{
+   uint_t i;
+   bool_t status;
+   OsEvent *event;
+
+   //Check parameters
+   if(!eventDesc || !size)
+      return ERROR_INVALID_PARAMETER;
+
+   //Try to use the supplied event object to receive notifications
+   event = extEvent;
+
+   //Create an event object only if necessary
+   if(!event)
+   {
+      //Create an event object
+      event = osEventCreate(FALSE, FALSE);
+      //Any error to report?
+      if(event == OS_INVALID_HANDLE)
+         return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Loop through descriptors
+   for(i = 0; i < size; i++)
+   {
+      //Clear event flags
+      eventDesc[i].eventFlags = 0;
+      //Subscribe to the requested events
+      socketRegisterEvents(eventDesc[i].socket, event, eventDesc[i].eventMask);
+   }
+
+   //Block the current task until an event occurs
+   status = osEventWait(event, timeout);
+
+   //Any socket event is in the signaled state?
+   if(status)
+   {
+      //Loop through descriptors
+      for(i = 0; i < size; i++)
+      {
+         //Retrieve event flags for the current socket
+         socketGetEvents(eventDesc[i].socket, &eventDesc[i].eventFlags);
+         //Clear unnecessary flags
+         eventDesc[i].eventFlags &= eventDesc[i].eventMask;
+      }
+   }
+
+   //Unsubscribe previously registered events
+   for(i = 0; i < size; i++)
+      socketUnregisterEvents(eventDesc[i].socket);
+
+   //Reset event object before exiting...
+   osEventReset(event);
+
+   //Release previously allocated resources
+   if(!extEvent)
+      osEventClose(event);
+
+   //Return status code
+   return status ? NO_ERROR : ERROR_TIMEOUT;
+}
+
+
+/**
+ * @brief Subscribe to the specified socket events
+ * @param[in] socket Handle that identifies a socket
+ * @param[in] event Event object used to receive notifications
+ * @param[in] eventMask Logic OR of the requested socket events
+ * @return Error code
+ **/
+
+error_t socketRegisterEvents(Socket *socket, OsEvent *event, uint_t eventMask)
+{
+   //Make sure the socket handle is valid
+   if(!socket)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+   //An user event may have been previously registered...
+   if(socket->userEvent != NULL)
+      socket->eventMask |= eventMask;
+   else
+      socket->eventMask = eventMask;
+
+   //Suscribe to get notified of events
+   socket->userEvent = event;
+   //Evaluate the current state of the socket
+   socketUpdateEvents(socket);
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Unsubscribe previously registered events
+ * @param[in] socket Handle that identifies a socket
+ * @return Error code
+ **/
+
+error_t socketUnregisterEvents(Socket *socket)
+{
+   //Make sure the socket handle is valid
+   if(!socket)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+   //Unsuscribe socket events
+   socket->userEvent = NULL;
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Retrieve event flags for a specified socket
+ * @param[in] socket Handle that identifies a socket
+ * @param[out] eventFlags Logic OR of events in the signaled state
+ * @return Error code
+ **/
+
+error_t socketGetEvents(Socket *socket, uint_t *eventFlags)
+{
+   //Make sure the socket handle is valid
+   if(!socket)
+   {
+      //Always return a valid value
+      *eventFlags = 0;
+      //Report an error
+      return ERROR_INVALID_PARAMETER;
+   }
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+   //Read event flags for the specified socket
+   *eventFlags = socket->eventFlags;
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Evaluate the events of a socket
+ *
+ * The caller must hold the socket mutex
+ *
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void socketUpdateEvents(Socket *socket)
+{
+#if (TCP_SUPPORT == ENABLED)
+   //Handle TCP specific events
+   if(socket->type == SOCKET_TYPE_STREAM)
+      tcpUpdateEvents(socket);
+#endif
+#if (UDP_SUPPORT == ENABLED)
+   //Handle UDP specific events
+   if(socket->type == SOCKET_TYPE_DGRAM)
+      udpUpdateEvents(socket);
+#endif
+#if (RAW_SOCKET_SUPPORT == ENABLED)
+   //Handle events that are specific to raw sockets
+   if(socket->type == SOCKET_TYPE_RAW)
+      rawSocketUpdateEvents(socket);
+#endif
+}
+
+
+#if (SOCKET_EVENT_SET_SUPPORT == ENABLED)
+
+/**
+ * @brief Initialize an event set
+ * @param[in] set Pointer to the event set
+ * @return Error code
+ **/
+
+error_t socketEventSetInit(SocketEventSet *set)
+{
+   //Check parameters
+   if(!set)
+      return ERROR_INVALID_PARAMETER;
+
+   //The ready list is initially empty
+   set->readyHead = NULL;
+   set->readyTail = NULL;
+   set->readyCount = 0;
+
+   //The event object remains signaled as long as a socket is ready
+   set->event = osEventCreate(TRUE, FALSE);
+   //Any error to report?
+   if(set->event == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release an event set
+ *
+ * Sockets that are still registered are removed from the set
+ *
+ * @param[in] set Pointer to the event set
+ **/
+
+void socketEventSetDeinit(SocketEventSet *set)
+{
+   uint_t i;
+
+   //Make sure the event set is valid
+   if(!set) return;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+   //Loop through socket descriptors
+   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+   {
+      //Detach the sockets that belong to this set
+      if(socketTable[i] != NULL && socketTable[i]->eventSet == set)
+         socketEventSetDetach(socketTable[i]);
+   }
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+
+   //Delete the event object
+   osEventClose(set->event);
+}
+
+
+/**
+ * @brief Register a socket with an event set
+ *
+ * The registration persists until the socket is removed or closed.
+ * Registering the socket again updates its event mask and trigger mode
+ *
+ * @param[in] set Pointer to the event set
+ * @param[in] socket Handle referencing the socket to monitor
+ * @param[in] eventMask Events the set is interested in
+ * @param[in] mode Trigger mode (SOCKET_EVENT_SET_LEVEL or SOCKET_EVENT_SET_EDGE)
+ * @return Error code
+ **/
+
+error_t socketEventSetAdd(SocketEventSet *set, Socket *socket, uint_t eventMask, uint_t mode)
+{
+   //Check parameters
+   if(!set || !socket)
+      return ERROR_INVALID_PARAMETER;
+   //Check trigger mode
+   if(mode != SOCKET_EVENT_SET_LEVEL && mode != SOCKET_EVENT_SET_EDGE)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+   //A socket can only belong to a single event set
+   if(socket->eventSet != NULL && socket->eventSet != set)
+   {
+      //Leave critical section
+      osMutexRelease(socketMutex);
+      //Report an error
+      return ERROR_UNEXPECTED_STATE;
+   }
+
+   //Discard any previous registration
+   socketEventSetDetach(socket);
+
+   //Save registration parameters
+   socket->eventSet = set;
+   socket->eventSetMask = eventMask;
+   socket->eventSetMode = mode;
+   socket->eventSetFlags = 0;
+   socket->eventSetPending = 0;
+
+   //Events that are already signaled are reported immediately
+   socketUpdateEvents(socket);
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Unregister a socket from an event set
+ * @param[in] set Pointer to the event set
+ * @param[in] socket Handle referencing the socket
+ * @return Error code
+ **/
+
+error_t socketEventSetRemove(SocketEventSet *set, Socket *socket)
+{
+   error_t error;
+
+   //Check parameters
+   if(!set || !socket)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+   //Make sure the socket belongs to the specified set
+   if(socket->eventSet == set)
+   {
+      //Stop monitoring the socket
+      socketEventSetDetach(socket);
+      //Successful processing
+      error = NO_ERROR;
+   }
+   else
+   {
+      //The socket is not registered with this set
+      error = ERROR_NOT_FOUND;
+   }
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Wait for registered sockets to become ready
+ * @param[in] set Pointer to the event set
+ * @param[out] eventDesc Array receiving the sockets that are ready
+ * @param[in] size Maximum number of entries in the array
+ * @param[out] count Number of entries actually returned
+ * @param[in] timeout Maximum time to wait
+ * @return Error code
+ **/
+
+error_t socketEventSetWait(SocketEventSet *set, SocketEventDesc *eventDesc,
+   uint_t size, uint_t *count, time_t timeout)
+{
+   uint_t n;
+
+   //Check parameters
+   if(!set || !eventDesc || !size || !count)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+   //Retrieve the sockets that are already ready
+   n = socketEventSetCollect(set, eventDesc, size);
+   //Leave critical section
+   osMutexRelease(socketMutex);
+
+   //Nothing to report yet?
+   if(!n && timeout)
+   {
+      //Block the current task until a socket becomes ready
+      if(osEventWait(set->event, timeout))
+      {
+         //Enter critical section
+         osMutexAcquire(socketMutex);
+         //Retrieve the sockets that are ready
+         n = socketEventSetCollect(set, eventDesc, size);
+         //Leave critical section
+         osMutexRelease(socketMutex);
+      }
+   }
+
+   //Return the number of sockets that are ready
+   *count = n;
+   //Return status code
+   return n ? NO_ERROR : ERROR_TIMEOUT;
+}
+
+
+/**
+ * @brief Push the events of a socket into its event set
+ *
+ * This function is called by the protocol layers whenever the events
+ * of a registered socket are evaluated. The caller must hold the
+ * socket mutex
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] eventFlags Events that are currently signaled
+ **/
+
+void socketEventSetNotify(Socket *socket, uint_t eventFlags)
+{
+   //Keep only the events the set is interested in
+   eventFlags &= socket->eventSetMask;
+
+   //Edge-triggered mode?
+   if(socket->eventSetMode == SOCKET_EVENT_SET_EDGE)
+   {
+      //Only events that have just become signaled are reported
+      socket->eventSetPending |= eventFlags & ~socket->eventSetFlags;
+      socket->eventSetFlags = eventFlags;
+
+      //Any new event?
+      if(socket->eventSetPending)
+         socketEventSetQueue(socket->eventSet, socket);
+   }
+   else
+   {
+      //Save the current events
+      socket->eventSetFlags = eventFlags;
+
+      //The socket is ready as long as an event is signaled
+      if(eventFlags)
+         socketEventSetQueue(socket->eventSet, socket);
+   }
+}
+
+
+/**
+ * @brief Append a socket to the ready list of an event set
+ * @param[in] set Pointer to the event set
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void socketEventSetQueue(SocketEventSet *set, Socket *socket)
+{
+   //The socket is queued at most once
+   if(!socket->eventSetReady)
+   {
+      //Append the socket to the ready list
+      socket->eventSetNext = NULL;
+
+      if(set->readyTail != NULL)
+         set->readyTail->eventSetNext = socket;
+      else
+         set->readyHead = socket;
+
+      set->readyTail = socket;
+      set->readyCount++;
+      socket->eventSetReady = TRUE;
+   }
+
+   //Wake up the tasks waiting on the set
+   osEventSet(set->event);
+}
+
+
+/**
+ * @brief Remove a socket from the event set it belongs to
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void socketEventSetDetach(Socket *socket)
+{
+   Socket *prev;
+   Socket **p;
+   SocketEventSet *set;
+
+   //Point to the event set
+   set = socket->eventSet;
+   //The socket is not registered?
+   if(set == NULL)
+      return;
+
+   //Unlink the socket from the ready list
+   if(socket->eventSetReady)
+   {
+      //Locate the socket in the ready list
+      for(prev = NULL, p = &set->readyHead; *p != socket; p = &(*p)->eventSetNext)
+         prev = *p;
+
+      //Remove the socket
+      *p = socket->eventSetNext;
+
+      //Update the tail of the list
+      if(set->readyTail == socket)
+         set->readyTail = prev;
+
+      //Update the number of ready sockets
+      set->readyCount--;
+
+      //No more socket to report?
+      if(set->readyHead == NULL)
+         osEventReset(set->event);
+   }
+
+   //The socket is no longer monitored
+   socket->eventSet = NULL;
+   socket->eventSetNext = NULL;
+   socket->eventSetReady = FALSE;
+}
+
+
+/**
+ * @brief Retrieve the sockets that are ready
+ *
+ * Only the sockets that are queued on entry are visited. Level-triggered
+ * sockets that remain ready are queued again at the tail of the list.
+ * The caller must hold the socket mutex
+ *
+ * @param[in] set Pointer to the event set
+ * @param[out] eventDesc Array receiving the sockets that are ready
+ * @param[in] size Maximum number of entries in the array
+ * @return Number of entries returned
+ **/
+
+static uint_t socketEventSetCollect(SocketEventSet *set, SocketEventDesc *eventDesc, uint_t size)
+{
+   uint_t i;
+   uint_t n;
+   uint_t eventFlags;
+   Socket *socket;
+
+   //Loop through the sockets that are currently ready
+   for(i = set->readyCount, n = 0; i > 0 && n < size; i--)
+   {
+      //Remove the first socket from the ready list
+      socket = set->readyHead;
+      set->readyHead = socket->eventSetNext;
+
+      //Update the tail of the list
+      if(set->readyHead == NULL)
+         set->readyTail = NULL;
+
+      socket->eventSetNext = NULL;
+      socket->eventSetReady = FALSE;
+      set->readyCount--;
+
+      //Edge-triggered mode?
+      if(socket->eventSetMode == SOCKET_EVENT_SET_EDGE)
+      {
+         //Report the events that have become signaled
+         eventFlags = socket->eventSetPending;
+         socket->eventSetPending = 0;
+      }
+      else
+      {
+         //Evaluate the events again, since data may have been consumed
+         socketUpdateEvents(socket);
+         //Report the events that are still signaled
+         eventFlags = socket->eventSetFlags;
+      }
+
+      //Any event to report?
+      if(eventFlags)
+      {
+         eventDesc[n].socket = socket;
+         eventDesc[n].eventMask = socket->eventSetMask;
+         eventDesc[n].eventFlags = eventFlags;
+         n++;
+      }
+   }
+
+   //Reset the event object once the ready list is empty
+   if(set->readyHead == NULL)
+      osEventReset(set->event);
+
+   //Return the number of entries
+   return n;
+}
+
+#endif
+
+
+#if (SOCKET_CALLBACK_SUPPORT == ENABLED)
+
+/**
+ * @brief Register a callback to be notified of socket events
+ *
+ * The socket is switched to non-blocking mode, so that I/O functions
+ * return immediately: ERROR_TIMEOUT means that the operation is still
+ * in progress, and its completion is reported to the callback. Events
+ * are edge-triggered, so the callback should read all pending data.
+ * The callbacks are invoked by the socket callback task, which should
+ * be the only task that handles the registered sockets
+ *
+ * @param[in] socket Handle to a socket
+ * @param[in] callback Function to invoke when an event occurs
+ * @param[in] param Opaque parameter passed to the callback
+ * @param[in] eventMask Events the callback is interested in
+ *   (SOCKET_EVENT_CONNECTED, SOCKET_EVENT_RX_READY,
+ *   SOCKET_EVENT_TX_READY or SOCKET_EVENT_CLOSED, for instance)
+ * @return Error code
+ **/
+
+error_t socketRegisterCallback(Socket *socket,
+   SocketCallback callback, void *param, uint_t eventMask)
+{
+   //Check parameters
+   if(!socket || !callback)
+      return ERROR_INVALID_PARAMETER;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+   //Save callback function
+   socket->callback = callback;
+   socket->callbackParam = param;
+   //Callbacks must never block
+   socket->timeout = 0;
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+
+   //Start monitoring the socket
+   return socketEventSetAdd(&socketCallbackSet, socket,
+      eventMask, SOCKET_EVENT_SET_EDGE);
+}
+
+
+/**
+ * @brief Stop the notification of socket events
  * @param[in] socket Handle to a socket
- * @param[in] how Flag that describes what types of operation will no longer be allowed
  * @return Error code
  **/
 
-error_t socketShutdown(Socket *socket, uint_t how)
+error_t socketUnregisterCallback(Socket *socket)
 {
-#if (TCP_SUPPORT == ENABLED)
-   error_t error;
-
    //Make sure the socket handle is valid
    if(!socket)
       return ERROR_INVALID_PARAMETER;
-   //Make sure the socket type is correct
-   if(socket->type != SOCKET_TYPE_STREAM)
-      return ERROR_INVALID_SOCKET;
-   //Check flags
-   if((how != SOCKET_SD_SEND) && (how != SOCKET_SD_RECEIVE) && (how != SOCKET_SD_BOTH))
-      return ERROR_INVALID_PARAMETER;
+
+   //Stop monitoring the socket
+   socketEventSetRemove(&socketCallbackSet, socket);
 
    //Enter critical section
    osMutexAcquire(socketMutex);
-   //Graceful shutdown
-   error = tcpShutdown(socket, how);
+   //Unregister callback function
+   socket->callback = NULL;
    //Leave critical section
    osMutexRelease(socketMutex);
 
-   //Return status code
-   return error;
-#else
-   return ERROR_NOT_IMPLEMENTED;
-#endif
+   //Successful processing
+   return NO_ERROR;
 }
 
 
 /**
- * @brief Close an existing socket
- * @param[in] socket Handle identifying the socket to close
+ * @brief Dispatch socket events to the registered callbacks
+ *
+ * Sockets are retrieved one at a time, so that a callback may safely
+ * close any socket before the next one is dispatched
+ *
+ * @param[in] param Unused parameter
  **/
 
-void socketClose(Socket *socket)
+void socketCallbackTask(void *param)
 {
-   //Make sure the socket handle is valid
-   if(!socket) return;
-
-   //Enter critical section
-   osMutexAcquire(socketMutex);
+   uint_t n;
+   SocketEventDesc eventDesc;
 
-#if (TCP_SUPPORT == ENABLED)
-   //Connection-oriented socket?
-   if(socket->type == SOCKET_TYPE_STREAM)
+   //Main loop
+   while(1)
    {
-      //Abort the current TCP connection
-      tcpAbort(socket);
+      //Wait for a registered socket to become ready
+      socketEventSetWait(&socketCallbackSet, &eventDesc, 1, &n, INFINITE_DELAY);
+
+      //Invoke the callback outside of the critical section
+      if(n > 0 && eventDesc.socket->callback != NULL)
+      {
+         eventDesc.socket->callback(eventDesc.socket,
+            eventDesc.eventFlags, eventDesc.socket->callbackParam);
+      }
    }
-   else
+}
+
 #endif
-   //Connectionless socket or raw socket?
-   {
-      //Point to the first item in the receive queue
-      SocketQueueItem *queueItem = socket->receiveQueue;
 
-      //Purge the receive queue
-      while(queueItem)
+
+/**
+ * @brief Link a socket into a hash bucket
+ *
+ * The socket is appended to the bucket, so that sockets sharing the
+ * same key are still looked up in the order they were created
+ *
+ * @param[in] bucket Hash bucket the socket is to be linked into
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void socketHashInsert(Socket **bucket, Socket *socket)
+{
+   Socket **p;
+
+   //Remove the socket from its current bucket, if any
+   socketHashRemove(socket);
+
+   //Reach the end of the bucket
+   for(p = bucket; *p != NULL; p = &(*p)->hashNext);
+
+   //Append the socket
+   socket->hashNext = NULL;
+   socket->hashBucket = bucket;
+   *p = socket;
+}
+
+
+/**
+ * @brief Unlink a socket from its hash bucket
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void socketHashRemove(Socket *socket)
+{
+   Socket **p;
+
+   //The socket is not indexed?
+   if(socket->hashBucket == NULL)
+      return;
+
+   //Look for the link pointing to the socket
+   for(p = socket->hashBucket; *p != NULL; p = &(*p)->hashNext)
+   {
+      //Unlink the socket
+      if(*p == socket)
       {
-         //Keep track of the next item in the queue
-         SocketQueueItem *nextQueueItem = queueItem->next;
-         //Free previously allocated memory
-         memPoolFree(queueItem);
-         //Point to the next item
-         queueItem = nextQueueItem;
+         *p = socket->hashNext;
+         break;
       }
-
-      //Mark the socket as closed
-      socket->type = SOCKET_TYPE_UNUSED;
    }
 
-   //Leave critical section
-   osMutexRelease(socketMutex);
+   //The socket is no longer indexed
+   socket->hashNext = NULL;
+   socket->hashBucket = NULL;
 }
 
 
 /**
- * @brief Wait for one of a set of sockets to become ready to perform I/O
+ * @brief Add a socket to the local port index
  *
- * The socketPoll function determines the status of one or more sockets,
- * waiting if necessary, to perform synchronous I/O
+ * The index lets the dynamic port allocator detect collisions without
+ * walking the socket table. It must be updated whenever the local port
+ * of a TCP or UDP socket changes
  *
- * @param[in,out] eventDesc Set of entries specifying the events the user is interested in
- * @param[in] size Number of entries in the descriptor set
- * @param[in] extEvent External event that can abort the wait if necessary (optional)
- * @param[in] timeout Maximum time to wait before returning
- * @return Error code
+ * @param[in] socket Handle referencing the socket
  **/
 
-error_t socketPoll(SocketEventDesc *eventDesc, uint_t size, OsEvent *extEvent, time_t timeout)
+void socketPortInsert(Socket *socket)
 {
-   uint_t i;
-   bool_t status;
-   OsEvent *event;
+   Socket **bucket;
 
-   //Check parameters
-   if(!eventDesc || !size)
-      return ERROR_INVALID_PARAMETER;
+   //Remove the socket from its current bucket, if any
+   socketPortRemove(socket);
 
-   //Try to use the supplied event object to receive notifications
-   event = extEvent;
+   //Point to the relevant hash bucket
+   bucket = &socketPortHashTable[socket->localPort &
+      (SOCKET_PORT_HASH_TABLE_SIZE - 1)];
 
-   //Create an event object only if necessary
-   if(!event)
-   {
-      //Create an event object
-      event = osEventCreate(FALSE, FALSE);
-      //Any error to report?
-      if(event == OS_INVALID_HANDLE)
-         return ERROR_OUT_OF_RESOURCES;
-   }
+   //Insert the socket at the head of the bucket
+   socket->portNext = *bucket;
+   socket->portBucket = bucket;
+   *bucket = socket;
+}
 
-   //Loop through descriptors
-   for(i = 0; i < size; i++)
-   {
-      //Clear event flags
-      eventDesc[i].eventFlags = 0;
-      //Subscribe to the requested events
-      socketRegisterEvents(eventDesc[i].socket, event, eventDesc[i].eventMask);
-   }
 
-   //Block the current task until an event occurs
-   status = osEventWait(event, timeout);
+/**
+ * @brief Remove a socket from the local port index
+ * @param[in] socket Handle referencing the socket
+ **/
 
-   //Any socket event is in the signaled state?
-   if(status)
+void socketPortRemove(Socket *socket)
+{
+   Socket **p;
+
+   //The socket is not indexed?
+   if(socket->portBucket == NULL)
+      return;
+
+   //Look for the link pointing to the socket
+   for(p = socket->portBucket; *p != NULL; p = &(*p)->portNext)
    {
-      //Loop through descriptors
-      for(i = 0; i < size; i++)
+      //Unlink the socket
+      if(*p == socket)
       {
-         //Retrieve event flags for the current socket
-         socketGetEvents(eventDesc[i].socket, &eventDesc[i].eventFlags);
-         //Clear unnecessary flags
-         eventDesc[i].eventFlags &= eventDesc[i].eventMask;
+         *p = socket->portNext;
+         break;
       }
    }
 
-   //Unsubscribe previously registered events
-   for(i = 0; i < size; i++)
-      socketUnregisterEvents(eventDesc[i].socket);
+   //The socket is no longer indexed
+   socket->portNext = NULL;
+   socket->portBucket = NULL;
+}
 
-   //Reset event object before exiting...
-   osEventReset(event);
 
-   //Release previously allocated resources
-   if(!extEvent)
-      osEventClose(event);
+/**
+ * @brief Check whether a local port is already in use
+ * @param[in] protocol Transport protocol (TCP or UDP)
+ * @param[in] port Port number
+ * @return TRUE if a socket of the same protocol is bound to the port
+ **/
 
-   //Return status code
-   return status ? NO_ERROR : ERROR_TIMEOUT;
+static bool_t socketPortInUse(uint8_t protocol, uint16_t port)
+{
+   Socket *socket;
+
+   //Walk through the sockets sharing the same hash value
+   for(socket = socketPortHashTable[port & (SOCKET_PORT_HASH_TABLE_SIZE - 1)];
+      socket != NULL; socket = socket->portNext)
+   {
+      //Matching socket?
+      if(socket->localPort == port && socket->protocol == protocol)
+         return TRUE;
+   }
+
+   //The port is free
+   return FALSE;
 }
 
 
 /**
- * @brief Subscribe to the specified socket events
- * @param[in] socket Handle that identifies a socket
- * @param[in] event Event object used to receive notifications
- * @param[in] eventMask Logic OR of the requested socket events
- * @return Error code
+ * @brief Select a dynamic port for a new socket
+ *
+ * The position in the ephemeral range advances by a random increment
+ * for each allocation (RFC 6056, algorithm 5), which makes the port
+ * numbers hard to guess while keeping successive allocations apart.
+ * Since no more than SOCKET_MAX_COUNT ports can be in use, a free port
+ * is always found within a bounded number of probes
+ *
+ * @param[in] protocol Transport protocol (TCP or UDP)
+ * @return Port number
  **/
 
-error_t socketRegisterEvents(Socket *socket, OsEvent *event, uint_t eventMask)
+static uint16_t socketGetEphemeralPort(uint8_t protocol)
 {
-   //Make sure the socket handle is valid
-   if(!socket)
-      return ERROR_INVALID_PARAMETER;
+   uint_t i;
+   uint16_t port;
 
-   //Enter critical section
-   osMutexAcquire(socketMutex);
+   //Advance by a random increment
+   ephemeralPort += (rand() % SOCKET_EPHEMERAL_PORT_STEP) + 1;
 
-   //An user event may have been previously registered...
-   if(socket->userEvent != NULL)
-      socket->eventMask |= eventMask;
-   else
-      socket->eventMask = eventMask;
+   //Probe successive ports until a free one is found
+   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+   {
+      //Map the offset to the ephemeral range
+      ephemeralPort %= SOCKET_EPHEMERAL_PORT_MAX - SOCKET_EPHEMERAL_PORT_MIN + 1;
+      port = SOCKET_EPHEMERAL_PORT_MIN + ephemeralPort;
 
-   //Suscribe to get notified of events
-   socket->userEvent = event;
+      //Free port?
+      if(!socketPortInUse(protocol, port))
+         break;
 
-#if (TCP_SUPPORT == ENABLED)
-   //Handle TCP specific events
-   if(socket->type == SOCKET_TYPE_STREAM)
-      tcpUpdateEvents(socket);
-#endif
-#if (UDP_SUPPORT == ENABLED)
-   //Handle UDP specific events
-   if(socket->type == SOCKET_TYPE_DGRAM)
-      udpUpdateEvents(socket);
-#endif
-#if (RAW_SOCKET_SUPPORT == ENABLED)
-   //Handle events that are specific to raw sockets
-   if(socket->type == SOCKET_TYPE_RAW)
-      rawSocketUpdateEvents(socket);
-#endif
+      //Try the next port
+      ephemeralPort++;
+   }
 
-   //Leave critical section
-   osMutexRelease(socketMutex);
-   //Successful processing
-   return NO_ERROR;
+   //Return the selected port
+   return port;
 }
 
 
 /**
- * @brief Unsubscribe previously registered events
- * @param[in] socket Handle that identifies a socket
+ * @brief Charge memory to a socket
+ *
+ * The caller must hold the socket mutex. The request is denied when it
+ * would exceed the budget of the socket, the budget of its class, or
+ * the memory that all the sockets may hold together
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] size Number of bytes about to be allocated
  * @return Error code
  **/
 
-error_t socketUnregisterEvents(Socket *socket)
+error_t socketMemCharge(Socket *socket, size_t size)
 {
-   //Make sure the socket handle is valid
-   if(!socket)
-      return ERROR_INVALID_PARAMETER;
-
-   //Enter critical section
-   osMutexAcquire(socketMutex);
-
-   //Unsuscribe socket events
-   socket->userEvent = NULL;
+#if (SOCKET_MEM_ACCOUNTING_SUPPORT == ENABLED)
+   size_t n;
+
+   //Number of bytes actually drawn from the memory pool
+   n = SOCKET_MEM_FOOTPRINT(size);
+
+   //Check the budget of the socket
+   if(socket->memBudget > 0 && (socket->memUsage + n) > socket->memBudget)
+      return ERROR_WOULD_BLOCK;
+   //Check the budget of the class the socket belongs to
+   if((socketMemClassUsage[socket->type] + n) > socketMemClassBudget[socket->type])
+      return ERROR_WOULD_BLOCK;
+   //Keep the remainder of the pool for the control traffic of the stack
+   if((socketMemTotalUsage + n) > SOCKET_MEM_TOTAL_BUDGET)
+      return ERROR_WOULD_BLOCK;
+
+   //Update memory usage
+   socket->memUsage += n;
+   socketMemClassUsage[socket->type] += n;
+   socketMemTotalUsage += n;
+#endif
 
-   //Leave critical section
-   osMutexRelease(socketMutex);
    //Successful processing
    return NO_ERROR;
 }
 
 
 /**
- * @brief Retrieve event flags for a specified socket
- * @param[in] socket Handle that identifies a socket
- * @param[out] eventFlags Logic OR of events in the signaled state
- * @return Error code
+ * @brief Give back memory previously charged to a socket
+ *
+ * The caller must hold the socket mutex
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] size Number of bytes that have been released
  **/
 
-error_t socketGetEvents(Socket *socket, uint_t *eventFlags)
+void socketMemUncharge(Socket *socket, size_t size)
 {
-   //Make sure the socket handle is valid
-   if(!socket)
+#if (SOCKET_MEM_ACCOUNTING_SUPPORT == ENABLED)
+   size_t n;
+
+   //Number of bytes given back to the memory pool
+   n = SOCKET_MEM_FOOTPRINT(size);
+   //Sanity check
+   n = min(n, socket->memUsage);
+
+   //Any memory given back?
+   if(n > 0)
    {
-      //Always return a valid value
-      *eventFlags = 0;
-      //Report an error
-      return ERROR_INVALID_PARAMETER;
+      //Update memory usage
+      socket->memUsage -= n;
+      socketMemClassUsage[socket->type] -= n;
+      socketMemTotalUsage -= n;
+
+      //Wake up the tasks waiting for memory
+      osEventSet(socketMemEvent);
    }
+#endif
+}
 
-   //Enter critical section
-   osMutexAcquire(socketMutex);
 
-   //Read event flags for the specified socket
-   *eventFlags = socket->eventFlags;
+/**
+ * @brief Wait for sockets to give memory back
+ *
+ * The caller must hold the socket mutex, which is released while waiting
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] timeout Maximum time to wait
+ * @return TRUE if some memory has been given back, else FALSE
+ **/
+
+bool_t socketMemWait(Socket *socket, time_t timeout)
+{
+#if (SOCKET_MEM_ACCOUNTING_SUPPORT == ENABLED)
+   bool_t ret;
+
+   //Non-blocking socket?
+   if(timeout == 0)
+      return FALSE;
 
+   //Reset the event object
+   osEventReset(socketMemEvent);
    //Leave critical section
    osMutexRelease(socketMutex);
-   //Successful processing
-   return NO_ERROR;
+   //Wait until another socket releases some memory
+   ret = osEventWait(socketMemEvent, timeout);
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+   //Return status
+   return ret;
+#else
+   //The memory held by sockets is not tracked
+   return FALSE;
+#endif
 }
 
 
@@ -918,7 +3093,7 @@ error_t socketGetLastError(Socket *socket)
  * @param[out] ipAddrList List of IP addresses that are associated with the specified host
  * @param[in] maxEntries Maximum number of IP addresses the list can contain
  * @param[out] numEntries Actual number of IP addresses in the list (optional parameter)
- * @param[in] flags Set of flags that influences the behavior of this function
+ * @param[in] flags Set of flags that influences the behavior of this function (see HostFlags)
  * @return Error code
  **/
 
@@ -926,6 +3101,7 @@ error_t getHostByName(NetInterface *interface, const char_t *name,
    IpAddr *ipAddrList, size_t maxEntries, size_t *numEntries, uint_t flags)
 {
    error_t error;
+   size_t n;
 
    //Check parameters
    if(name == NULL || ipAddrList == NULL || maxEntries < 1)
@@ -934,11 +3110,16 @@ error_t getHostByName(NetInterface *interface, const char_t *name,
    //The specified name can be either an IP or a host name
    error = ipStringToAddr(name, ipAddrList);
 
-   //Perform DNS name resolution if necessary
-   if(error)
+   //Valid IP address?
+   if(!error)
+   {
+      //The list contains a single entry
+      n = 1;
+   }
+   else
    {
-      //Send a DNS query
-      error = dnsResolve(interface, name, ipAddrList);
+      //Perform DNS name resolution
+      error = dnsResolveEx(interface, name, flags, ipAddrList, maxEntries, &n);
    }
 
    //Failed to resolve host name?
@@ -948,9 +3129,9 @@ error_t getHostByName(NetInterface *interface, const char_t *name,
       return error;
    }
 
-   //At this time, only one IP address is supported...
+   //Return the number of IP addresses in the list
    if(numEntries != NULL)
-      *numEntries = 1;
+      *numEntries = n;
 
    //Successful processing
    return NO_ERROR;
@@ -37,6 +37,7 @@ struct _Socket;
 #include "tcp_ip_stack.h"
 #include "ip.h"
 #include "tcp.h"
+#include "raw_socket_filter.h"
 
 //Number of sockets that can be opened simultaneously
 #ifndef SOCKET_MAX_COUNT
@@ -45,6 +46,43 @@ struct _Socket;
    #error SOCKET_MAX_COUNT parameter is invalid
 #endif
 
+//Allocate socket control blocks on demand
+#ifndef SOCKET_DYNAMIC_ALLOC_SUPPORT
+   #define SOCKET_DYNAMIC_ALLOC_SUPPORT DISABLED
+#elif (SOCKET_DYNAMIC_ALLOC_SUPPORT != ENABLED && SOCKET_DYNAMIC_ALLOC_SUPPORT != DISABLED)
+   #error SOCKET_DYNAMIC_ALLOC_SUPPORT parameter is invalid
+#endif
+
+//Persistent event sets (epoll-style notification)
+#ifndef SOCKET_EVENT_SET_SUPPORT
+   #define SOCKET_EVENT_SET_SUPPORT DISABLED
+#elif (SOCKET_EVENT_SET_SUPPORT != ENABLED && SOCKET_EVENT_SET_SUPPORT != DISABLED)
+   #error SOCKET_EVENT_SET_SUPPORT parameter is invalid
+#endif
+
+//Callback-driven socket API
+#ifndef SOCKET_CALLBACK_SUPPORT
+   #define SOCKET_CALLBACK_SUPPORT DISABLED
+#elif (SOCKET_CALLBACK_SUPPORT != ENABLED && SOCKET_CALLBACK_SUPPORT != DISABLED)
+   #error SOCKET_CALLBACK_SUPPORT parameter is invalid
+#elif (SOCKET_CALLBACK_SUPPORT == ENABLED && SOCKET_EVENT_SET_SUPPORT != ENABLED)
+   #error SOCKET_CALLBACK_SUPPORT requires SOCKET_EVENT_SET_SUPPORT
+#endif
+
+//Stack size required to run the socket callback task
+#ifndef SOCKET_CALLBACK_STACK_SIZE
+   #define SOCKET_CALLBACK_STACK_SIZE 550
+#elif (SOCKET_CALLBACK_STACK_SIZE < 1)
+   #error SOCKET_CALLBACK_STACK_SIZE parameter is invalid
+#endif
+
+//Priority at which the socket callback task should run
+#ifndef SOCKET_CALLBACK_PRIORITY
+   #define SOCKET_CALLBACK_PRIORITY 1
+#elif (SOCKET_CALLBACK_PRIORITY < 0)
+   #error SOCKET_CALLBACK_PRIORITY parameter is invalid
+#endif
+
 //Dynamic port range (lower limit)
 #ifndef SOCKET_EPHEMERAL_PORT_MIN
    #define SOCKET_EPHEMERAL_PORT_MIN 49152
@@ -57,6 +95,69 @@ struct _Socket;
    #define SOCKET_EPHEMERAL_PORT_MAX 65535
 #elif (SOCKET_EPHEMERAL_PORT_MAX <= SOCKET_EPHEMERAL_PORT_MIN || SOCKET_EPHEMERAL_PORT_MAX > 65535)
    #error SOCKET_EPHEMERAL_PORT_MAX parameter is invalid
+#elif (SOCKET_EPHEMERAL_PORT_MAX - SOCKET_EPHEMERAL_PORT_MIN < SOCKET_MAX_COUNT)
+   #error SOCKET_EPHEMERAL_PORT_MAX parameter is invalid
+#endif
+
+//Upper bound of the random increment between two dynamic ports
+#ifndef SOCKET_EPHEMERAL_PORT_STEP
+   #define SOCKET_EPHEMERAL_PORT_STEP 500
+#elif (SOCKET_EPHEMERAL_PORT_STEP < 1)
+   #error SOCKET_EPHEMERAL_PORT_STEP parameter is invalid
+#endif
+
+//Size of the local port hash table
+#ifndef SOCKET_PORT_HASH_TABLE_SIZE
+   #define SOCKET_PORT_HASH_TABLE_SIZE 16
+#elif (SOCKET_PORT_HASH_TABLE_SIZE < 1 || (SOCKET_PORT_HASH_TABLE_SIZE & (SOCKET_PORT_HASH_TABLE_SIZE - 1)))
+   #error SOCKET_PORT_HASH_TABLE_SIZE parameter is invalid
+#endif
+
+//Per-socket memory accounting
+#ifndef SOCKET_MEM_ACCOUNTING_SUPPORT
+   #define SOCKET_MEM_ACCOUNTING_SUPPORT DISABLED
+#elif (SOCKET_MEM_ACCOUNTING_SUPPORT != ENABLED && SOCKET_MEM_ACCOUNTING_SUPPORT != DISABLED)
+   #error SOCKET_MEM_ACCOUNTING_SUPPORT parameter is invalid
+#endif
+
+//Memory that all the sockets may hold together. The remainder of the
+//memory pool is kept for the control traffic of the stack
+#ifndef SOCKET_MEM_TOTAL_BUDGET
+   #if (MEM_POOL_SUPPORT == ENABLED)
+      #define SOCKET_MEM_TOTAL_BUDGET (MEM_POOL_BUFFER_COUNT * MEM_POOL_BUFFER_SIZE * 3 / 4)
+   #else
+      #define SOCKET_MEM_TOTAL_BUDGET 65536
+   #endif
+#elif (SOCKET_MEM_TOTAL_BUDGET < 1)
+   #error SOCKET_MEM_TOTAL_BUDGET parameter is invalid
+#endif
+
+//Memory that all the TCP sockets may hold together
+#ifndef SOCKET_MEM_TCP_BUDGET
+   #define SOCKET_MEM_TCP_BUDGET SOCKET_MEM_TOTAL_BUDGET
+#elif (SOCKET_MEM_TCP_BUDGET < 1)
+   #error SOCKET_MEM_TCP_BUDGET parameter is invalid
+#endif
+
+//Memory that all the UDP sockets may hold together
+#ifndef SOCKET_MEM_UDP_BUDGET
+   #define SOCKET_MEM_UDP_BUDGET (SOCKET_MEM_TOTAL_BUDGET / 2)
+#elif (SOCKET_MEM_UDP_BUDGET < 1)
+   #error SOCKET_MEM_UDP_BUDGET parameter is invalid
+#endif
+
+//Memory that all the raw sockets may hold together
+#ifndef SOCKET_MEM_RAW_BUDGET
+   #define SOCKET_MEM_RAW_BUDGET (SOCKET_MEM_TOTAL_BUDGET / 4)
+#elif (SOCKET_MEM_RAW_BUDGET < 1)
+   #error SOCKET_MEM_RAW_BUDGET parameter is invalid
+#endif
+
+//Memory that a single socket may hold by default (0 for no limit)
+#ifndef SOCKET_MEM_DEFAULT_BUDGET
+   #define SOCKET_MEM_DEFAULT_BUDGET (SOCKET_MEM_TOTAL_BUDGET / 4)
+#elif (SOCKET_MEM_DEFAULT_BUDGET < 0)
+   #error SOCKET_MEM_DEFAULT_BUDGET parameter is invalid
 #endif
 
 
@@ -98,7 +199,9 @@ typedef enum
    SOCKET_FLAG_WAIT_ALL   = 0x0800,
    SOCKET_FLAG_BREAK_CHAR = 0x1000,
    SOCKET_FLAG_BREAK_CRLF = 0x100A,
-   SOCKET_FLAG_WAIT_ACK   = 0x2000
+   SOCKET_FLAG_WAIT_ACK   = 0x2000,
+   SOCKET_FLAG_NO_COPY    = 0x4000,
+   SOCKET_FLAG_MORE       = 0x8000
 } SocketFlags;
 
 
@@ -119,6 +222,21 @@ typedef enum
 } SocketShutdownFlags;
 
 
+/**
+ * @brief Flags used by getHostByName function
+ **/
+
+typedef enum
+{
+   HOST_TYPE_DEFAULT = 0x00, ///<All the address families supported by the stack
+   HOST_TYPE_IPV4    = 0x01, ///<IPv4 addresses (A records)
+   HOST_TYPE_IPV6    = 0x02, ///<IPv6 addresses (AAAA records)
+   HOST_TYPE_ANY     = 0x03, ///<IPv4 and IPv6 addresses
+   HOST_TYPE_MASK    = 0x03,
+   HOST_PREFER_IPV6  = 0x04  ///<List IPv6 addresses first
+} HostFlags;
+
+
 /**
  * @brief Socket events
  **/
@@ -138,6 +256,28 @@ typedef enum
 } SocketEvent;
 
 
+/**
+ * @brief Event set trigger modes
+ **/
+
+typedef enum
+{
+   SOCKET_EVENT_SET_LEVEL = 0, ///<Report events as long as they are signaled
+   SOCKET_EVENT_SET_EDGE  = 1  ///<Report events only when they become signaled
+} SocketEventSetMode;
+
+
+//Forward declaration of SocketEventSet structure
+struct _SocketEventSet;
+
+
+/**
+ * @brief Socket callback
+ **/
+
+typedef void (*SocketCallback)(Socket *socket, uint_t eventFlags, void *param);
+
+
 /**
  * @brief Receive queue item
  **/
@@ -167,18 +307,54 @@ struct _Socket
    IpAddr remoteIpAddr;
    uint16_t remotePort;
    time_t timeout;
+   uint_t priority;
    error_t lastError;
    OsEvent *event;
    uint_t eventMask;
    uint_t eventFlags;
    OsEvent *userEvent;
-   //TCP specific variables
-   TcpControlBlock;
+   //Demultiplexing
+   struct _Socket *hashNext;
+   struct _Socket **hashBucket;
+   //Local port index
+   struct _Socket *portNext;
+   struct _Socket **portBucket;
+#if (SOCKET_EVENT_SET_SUPPORT == ENABLED)
+   //Event set membership
+   struct _SocketEventSet *eventSet;
+   uint_t eventSetMask;
+   uint_t eventSetMode;
+   uint_t eventSetFlags;
+   uint_t eventSetPending;
+   bool_t eventSetReady;
+   struct _Socket *eventSetNext;
+#endif
+#if (SOCKET_CALLBACK_SUPPORT == ENABLED)
+   //Asynchronous notifications
+   SocketCallback callback;
+   void *callbackParam;
+#endif
+#if (SOCKET_MEM_ACCOUNTING_SUPPORT == ENABLED)
+   //Memory accounting
+   size_t memUsage;
+   size_t memBudget;
+#endif
    //UDP specific variables
    SocketQueueItem *receiveQueue;
+#if (RAW_SOCKET_FILTER_SUPPORT == ENABLED)
+   //Raw socket specific variables
+   const RawSocketFilterInsn *filter;
+   uint_t filterLength;
+#endif
+   //TCP specific variables (must be the last member)
+   TcpControlBlock;
 };
 
 
+//Connectionless and raw sockets do not carry the TCP control block
+#define SOCKET_CONNECTIONLESS_SIZE offsetof(Socket, state)
+
+
 /**
  * @brief Structure describing socket events
  **/
@@ -191,9 +367,47 @@ typedef struct
 } SocketEventDesc;
 
 
+/**
+ * @brief Datagram descriptor used by batched I/O operations
+ **/
+
+typedef struct
+{
+   IpAddr remoteIpAddr; ///<IP address of the peer
+   uint16_t remotePort; ///<Port number of the peer
+   void *data;          ///<Pointer to the payload
+   size_t size;         ///<Payload length (send) or buffer size (receive)
+   size_t length;       ///<Number of bytes actually transmitted or received
+} SocketMessage;
+
+
+/**
+ * @brief I/O vector used by scatter/gather operations
+ **/
+
+typedef struct
+{
+   void *data;    ///<Pointer to the buffer
+   size_t length; ///<Length of the buffer
+} SocketIoVec;
+
+
+/**
+ * @brief Persistent set of monitored sockets
+ **/
+
+typedef struct _SocketEventSet
+{
+   OsEvent *event;    ///<Event object used to wake up waiting tasks
+   Socket *readyHead; ///<First socket in the ready list
+   Socket *readyTail; ///<Last socket in the ready list
+   uint_t readyCount; ///<Number of sockets in the ready list
+} SocketEventSet;
+
+
 //Global variables
 extern OsMutex *socketMutex;
-extern Socket socketTable[SOCKET_MAX_COUNT];
+extern Socket *socketTable[SOCKET_MAX_COUNT];
 
 //Socket related functions
 error_t socketInit(void);
@@ -201,15 +415,38 @@ error_t socketInit(void);
 Socket *socketOpen(uint_t type, uint8_t protocol);
 
 error_t socketSetTimeout(Socket *socket, time_t timeout);
+error_t socketSetPriority(Socket *socket, uint_t priority);
+error_t socketSetReusePort(Socket *socket, bool_t enable);
+error_t socketSetFastOpen(Socket *socket, bool_t enable);
+error_t socketSetTxBufferSize(Socket *socket, size_t size);
+error_t socketSetRxBufferSize(Socket *socket, size_t size);
+error_t socketSetTxLowWatermark(Socket *socket, size_t size);
+error_t socketSetRxLowWatermark(Socket *socket, size_t size);
+error_t socketSetCork(Socket *socket, bool_t enable);
+error_t socketSetMemBudget(Socket *socket, size_t size);
+error_t socketSetMinRto(Socket *socket, time_t minRto);
+error_t socketSetPacing(Socket *socket, bool_t enable, uint32_t maxRate);
+error_t socketSetCongestionControl(Socket *socket, const char_t *name);
+error_t socketSetFilter(Socket *socket, const RawSocketFilterInsn *program, uint_t count);
+
+error_t socketSetMulticastSourceFilter(Socket *socket, const IpAddr *groupAddr,
+   IpFilterMode filterMode, const IpAddr *srcAddr, uint_t srcAddrCount);
 error_t socketBindToInterface(Socket *socket, NetInterface *interface);
 error_t socketBind(Socket *socket, const IpAddr *localIpAddr, uint16_t localPort);
 error_t socketConnect(Socket *socket, const IpAddr *remoteIpAddr, uint16_t remotePort);
+
+error_t socketFastOpen(Socket *socket, const IpAddr *remoteIpAddr,
+   uint16_t remotePort, const void *data, size_t length, size_t *written);
+
 error_t socketListen(Socket *socket);
 Socket *socketAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort);
 
 error_t socketSend(Socket *socket, const void *data,
    size_t length, size_t *written, uint_t flags);
 
+error_t socketSendFile(Socket *socket, const void *data,
+   size_t length, size_t *written, uint_t flags);
+
 error_t socketSendTo(Socket *socket, const IpAddr *remoteIpAddr, uint16_t remotePort,
    const void *data, size_t length, size_t *written, uint_t flags);
 
@@ -219,17 +456,54 @@ error_t socketReceive(Socket *socket, void *data,
 error_t socketReceiveFrom(Socket *socket, IpAddr *remoteIpAddr,
    uint16_t *remotePort, void *data, size_t size, size_t *received, uint_t flags);
 
+error_t socketSendv(Socket *socket, const SocketIoVec *iov,
+   uint_t count, size_t *written, uint_t flags);
+error_t socketReceivev(Socket *socket, const SocketIoVec *iov,
+   uint_t count, size_t *received, uint_t flags);
+
+error_t socketSendBatch(Socket *socket, SocketMessage *messages, uint_t count, uint_t *sent);
+error_t socketReceiveBatch(Socket *socket, SocketMessage *messages, uint_t count, uint_t *received);
+
+error_t socketReceiveDatagram(Socket *socket, SocketQueueItem **queueItem);
+void socketReleaseDatagram(SocketQueueItem *queueItem);
+
 error_t socketGetLocalAddr(Socket *socket, IpAddr *localIpAddr, uint16_t *localPort);
 error_t socketGetRemoteAddr(Socket *socket, IpAddr *remoteIpAddr, uint16_t *remotePort);
 
+error_t socketGetTcpInfo(Socket *socket, TcpInfo *info);
+
 error_t socketShutdown(Socket *socket, uint_t how);
 void socketClose(Socket *socket);
+void socketRelease(Socket *socket);
 
 error_t socketPoll(SocketEventDesc *eventDesc, uint_t size, OsEvent *extEvent, time_t timeout);
 error_t socketRegisterEvents(Socket *socket, OsEvent *event, uint_t eventMask);
 error_t socketUnregisterEvents(Socket *socket);
 error_t socketGetEvents(Socket *socket, uint_t *eventFlags);
 
+error_t socketEventSetInit(SocketEventSet *set);
+void socketEventSetDeinit(SocketEventSet *set);
+error_t socketEventSetAdd(SocketEventSet *set, Socket *socket, uint_t eventMask, uint_t mode);
+error_t socketEventSetRemove(SocketEventSet *set, Socket *socket);
+error_t socketEventSetWait(SocketEventSet *set, SocketEventDesc *eventDesc,
+   uint_t size, uint_t *count, time_t timeout);
+void socketEventSetNotify(Socket *socket, uint_t eventFlags);
+
+error_t socketRegisterCallback(Socket *socket,
+   SocketCallback callback, void *param, uint_t eventMask);
+error_t socketUnregisterCallback(Socket *socket);
+void socketCallbackTask(void *param);
+
+void socketHashInsert(Socket **bucket, Socket *socket);
+void socketHashRemove(Socket *socket);
+
+void socketPortInsert(Socket *socket);
+void socketPortRemove(Socket *socket);
+
+error_t socketMemCharge(Socket *socket, size_t size);
+void socketMemUncharge(Socket *socket, size_t size);
+bool_t socketMemWait(Socket *socket, time_t timeout);
+
 error_t socketError(Socket *socket, error_t error);
 error_t socketGetLastError(Socket *socket);
 
@@ -36,6 +36,9 @@
 #include "socket.h"
 #include "tcp.h"
 #include "tcp_misc.h"
+#include "tcp_timer.h"
+#include "tcp_time_wait.h"
+#include "tcp_fast_open.h"
 #include "debug.h"
 
 //Check TCP/IP stack configuration
@@ -44,14 +47,27 @@
 
 /**
  * @brief Establish a TCP connection
+ *
+ * When TCP Fast Open is enabled, the initial data is carried by the SYN
+ * if a cookie has been obtained from the server, and sent as soon as the
+ * connection is established otherwise
+ *
  * @param[in] socket Handle to an unconnected socket
+ * @param[in] data Pointer to the initial data (may be NULL)
+ * @param[in] length Length of the initial data
+ * @param[out] written Actual number of bytes queued (optional parameter)
  * @return Error code
  **/
 
-error_t tcpConnect(Socket *socket)
+error_t tcpConnect(Socket *socket, const uint8_t *data, size_t length, size_t *written)
 {
    error_t error;
    uint_t event;
+   size_t n;
+
+   //No data has been queued yet
+   if(written != NULL)
+      *written = 0;
 
    //Socket already connected?
    if(socket->state != TCP_STATE_CLOSED)
@@ -64,11 +80,25 @@ error_t tcpConnect(Socket *socket)
    socket->txBuffer.maxChunkCount = arraysize(socket->txBuffer.chunk);
    socket->rxBuffer.maxChunkCount = arraysize(socket->rxBuffer.chunk);
 
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+   //The buffers are allocated when data is actually queued or received
+   error = NO_ERROR;
+#if (TCP_FAST_OPEN_SUPPORT == ENABLED)
+   //The initial data is queued right away
+   if(length > 0)
+      error = tcpAllocTxBuffer(socket);
+#endif
+#else
    //Allocate transmit buffer
-   error = chunkedBufferSetLength((ChunkedBuffer *) &socket->txBuffer, socket->txBufferSize);
+   error = tcpAllocBuffer(socket, (ChunkedBuffer *) &socket->txBuffer, socket->txBufferSize);
    //Allocate receive buffer
    if(!error)
-      error = chunkedBufferSetLength((ChunkedBuffer *) &socket->rxBuffer, socket->rxBufferSize);
+      error = tcpAllocBuffer(socket, (ChunkedBuffer *) &socket->rxBuffer, socket->rxBufferSize);
+#endif
+
+   //The connection cannot be opened within the memory budget
+   if(error == ERROR_WOULD_BLOCK)
+      error = ERROR_OUT_OF_MEMORY;
 
    //Failed to allocate memory?
    if(error)
@@ -86,13 +116,45 @@ error_t tcpConnect(Socket *socket)
    //Initialize TCP control block
    socket->sndUna = socket->iss;
    socket->sndNxt = socket->iss + 1;
+   socket->recover = socket->iss;
    socket->rcvUser = 0;
    socket->rcvWnd = socket->rxBufferSize;
    //Default retransmission timeout
    socket->rto = TCP_INITIAL_RTO;
 
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+   //Offer the Window Scale option in the SYN segment
+   socket->wndScaleFlag = TRUE;
+   socket->rcvWndShift = tcpGetWindowShift(socket->rxBufferSize);
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+   //Leave room for the receive buffer to grow
+   if(socket->rxAutoTune)
+      socket->rcvWndShift = tcpGetWindowShift(TCP_MAX_RX_BUFFER_SIZE);
+#endif
+#endif
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   //Offer the Timestamps option in the SYN segment
+   socket->tsFlag = TRUE;
+#endif
+
+   //Amount of data carried by the SYN
+   n = 0;
+
+#if (TCP_FAST_OPEN_SUPPORT == ENABLED)
+   //Any initial data?
+   if(length > 0)
+   {
+      //Queue the data and present the cookie of the server, if any
+      n = tcpFastOpenPrepareSyn(socket, data, length);
+      //Number of bytes that have been queued
+      if(written != NULL)
+         *written = n + socket->sndUser;
+   }
+#endif
+
    //Send a SYN segment
-   error = tcpSendSegment(socket, TCP_FLAG_SYN, socket->iss, 0, 0, TRUE);
+   error = tcpSendSegment(socket, TCP_FLAG_SYN, socket->iss, 0, n, TRUE);
    //Failed to send TCP segment?
    if(error) return error;
 
@@ -205,9 +267,7 @@ Socket *tcpAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort)
          TRACE_WARNING("Cannot accept TCP connection!\r\n");
 
          //Remove the item from the SYN queue
-         socket->synQueue = queueItem->next;
-         //Deallocate memory buffer
-         memPoolFree(queueItem);
+         tcpRemoveSynQueueItem(socket, queueItem);
          //Wait for the next connection attempt
          continue;
       }
@@ -217,16 +277,29 @@ Socket *tcpAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort)
 
       //The user owns the socket
       newSocket->ownedFlag = TRUE;
+      //The new socket inherits the buffer sizes of the listening socket
+      newSocket->priority = socket->priority;
+      newSocket->txBufferSize = socket->txBufferSize;
+      newSocket->rxBufferSize = socket->rxBufferSize;
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+      newSocket->txAutoTune = socket->txAutoTune;
+      newSocket->rxAutoTune = socket->rxAutoTune;
+#endif
 
       //Number of chunks that comprise the TX and the RX buffers
       newSocket->txBuffer.maxChunkCount = arraysize(newSocket->txBuffer.chunk);
       newSocket->rxBuffer.maxChunkCount = arraysize(newSocket->rxBuffer.chunk);
 
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+      //The buffers are allocated when data is actually queued or received
+      error = NO_ERROR;
+#else
       //Allocate transmit buffer
-      error = chunkedBufferSetLength((ChunkedBuffer *) &newSocket->txBuffer, newSocket->txBufferSize);
+      error = tcpAllocBuffer(newSocket, (ChunkedBuffer *) &newSocket->txBuffer, newSocket->txBufferSize);
       //Allocate receive buffer
       if(!error)
-         error = chunkedBufferSetLength((ChunkedBuffer *) &newSocket->rxBuffer, newSocket->rxBufferSize);
+         error = tcpAllocBuffer(newSocket, (ChunkedBuffer *) &newSocket->rxBuffer, newSocket->rxBufferSize);
+#endif
 
       //Failed to allocate memory?
       if(error)
@@ -237,9 +310,7 @@ Socket *tcpAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort)
          //Properly close the socket
          tcpAbort(newSocket);
          //Remove the item from the SYN queue
-         socket->synQueue = queueItem->next;
-         //Deallocate memory buffer
-         memPoolFree(queueItem);
+         tcpRemoveSynQueueItem(socket, queueItem);
          //Wait for the next connection attempt
          continue;
       }
@@ -249,6 +320,8 @@ Socket *tcpAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort)
       //Bind the socket to the specified address
       newSocket->localIpAddr = queueItem->destAddr;
       newSocket->localPort = socket->localPort;
+      //The socket shares the port of the listening socket
+      socketPortInsert(newSocket);
       //Save the port number and the IP address of the remote host
       newSocket->remoteIpAddr = queueItem->srcAddr;
       newSocket->remotePort = queueItem->srcPort;
@@ -260,16 +333,97 @@ Socket *tcpAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort)
       newSocket->irs = queueItem->isn;
       newSocket->sndUna = newSocket->iss;
       newSocket->sndNxt = newSocket->iss + 1;
+      newSocket->recover = newSocket->iss;
       newSocket->rcvNxt = newSocket->irs + 1;
       newSocket->rcvUser = 0;
       newSocket->rcvWnd = newSocket->rxBufferSize;
 
+      //Selective acknowledgments are used only if the client offered them
+      newSocket->sackPermitted = queueItem->sackPermitted;
+
+      //Window scaling is used only if the client offered it
+      if(queueItem->wndScaleFlag)
+      {
+         newSocket->wndScaleFlag = TRUE;
+         newSocket->sndWndShift = queueItem->wndShift;
+         newSocket->rcvWndShift = tcpGetWindowShift(newSocket->rxBufferSize);
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+         //Leave room for the receive buffer to grow
+         if(newSocket->rxAutoTune)
+            newSocket->rcvWndShift = tcpGetWindowShift(TCP_MAX_RX_BUFFER_SIZE);
+#endif
+      }
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+      //Timestamps are used only if the client offered them
+      if(queueItem->tsFlag)
+      {
+         newSocket->tsFlag = TRUE;
+         newSocket->tsRecent = queueItem->tsVal;
+         //Leave room for the Timestamps option in every segment
+         newSocket->mss -= TCP_TIMESTAMP_OVERHEAD;
+      }
+#endif
+
       //Default retransmission timeout
       newSocket->rto = TCP_INITIAL_RTO;
-      //Initial congestion window
-      newSocket->cwnd = min(TCP_INITIAL_WINDOW * newSocket->mss, newSocket->txBufferSize);
-      //Slow start threshold should be set arbitrarily high
-      newSocket->ssthresh = UINT16_MAX;
+      //The new connection uses the congestion control algorithm
+      //of the listening socket
+      newSocket->congestionAlgo = socket->congestionAlgo;
+      //The RTO floor is inherited from the listening socket as well
+      newSocket->minRto = socket->minRto;
+      //So are the low-watermarks
+      newSocket->txLowWat = socket->txLowWat;
+      newSocket->rxLowWat = socket->rxLowWat;
+#if (SOCKET_MEM_ACCOUNTING_SUPPORT == ENABLED)
+      //And the memory budget
+      newSocket->memBudget = socket->memBudget;
+#endif
+#if (TCP_PACING_SUPPORT == ENABLED)
+      //So are the pacing settings
+      newSocket->pacingEnabled = socket->pacingEnabled;
+      newSocket->pacingMaxRate = socket->pacingMaxRate;
+      newSocket->pacingNextTime = osGetTickCount();
+#endif
+      //Initial congestion window and slow start threshold
+      newSocket->congestionAlgo->init(newSocket);
+
+#if (TCP_SYN_COOKIE_SUPPORT == ENABLED)
+      //The handshake has already been completed with a SYN cookie?
+      if(queueItem->cookieFlag)
+      {
+         //The SYN ACK carried the cookie as initial sequence number
+         newSocket->iss = queueItem->iss;
+         newSocket->sndUna = newSocket->iss + 1;
+         newSocket->sndNxt = newSocket->iss + 1;
+         newSocket->recover = newSocket->iss;
+
+         //Window advertised by the final ACK of the handshake
+         newSocket->sndWnd = queueItem->wnd;
+         newSocket->maxSndWnd = queueItem->wnd;
+         newSocket->sndWl1 = newSocket->irs + 1;
+         newSocket->sndWl2 = newSocket->sndUna;
+
+         //Remove the item from the SYN queue
+         tcpRemoveSynQueueItem(socket, queueItem);
+         //Update the state of events
+         tcpUpdateEvents(socket);
+
+         //The connection is established
+         tcpChangeState(newSocket, TCP_STATE_ESTABLISHED);
+
+         //Leave critical section
+         osMutexRelease(socketMutex);
+         //Return a handle to the newly created socket
+         return newSocket;
+      }
+#endif
+
+#if (TCP_FAST_OPEN_SUPPORT == ENABLED)
+      //Hand out a cookie and deliver the data carried by the SYN, if any.
+      //The SYN ACK acknowledges that data
+      tcpFastOpenAccept(newSocket, queueItem);
+#endif
 
       //Send a SYN ACK control segment
       error = tcpSendSegment(newSocket, TCP_FLAG_SYN | TCP_FLAG_ACK,
@@ -283,17 +437,13 @@ Socket *tcpAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort)
          //Close previously created socket
          tcpAbort(newSocket);
          //Remove the item from the SYN queue
-         socket->synQueue = queueItem->next;
-         //Deallocate memory buffer
-         memPoolFree(queueItem);
+         tcpRemoveSynQueueItem(socket, queueItem);
          //Wait for the next connection attempt
          continue;
       }
 
       //Remove the item from the SYN queue
-      socket->synQueue = queueItem->next;
-      //Deallocate memory buffer
-      memPoolFree(queueItem);
+      tcpRemoveSynQueueItem(socket, queueItem);
       //Update the state of events
       tcpUpdateEvents(socket);
 
@@ -321,19 +471,31 @@ Socket *tcpAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort)
 error_t tcpSend(Socket *socket, const uint8_t *data,
    size_t length, size_t *written, uint_t flags)
 {
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+   error_t error;
+#endif
    uint_t n;
    uint_t totalLength;
    uint_t event;
+   uint32_t seqNum;
 
    //Check whether the socket is in the listening state
    if(socket->state == TCP_STATE_LISTEN)
       return ERROR_NOT_CONNECTED;
 
+   //The SOCKET_FLAG_MORE flag holds back partial segments until the
+   //data of a subsequent write completes them
+   socket->txMore = (flags & SOCKET_FLAG_MORE) ? TRUE : FALSE;
+
    //Send as much data as possible
    for(totalLength = 0; totalLength < length; )
    {
+      //The send low-watermark does not apply to the tail of the data
+      socket->txWaitSize = length - totalLength;
       //Wait until there is more room in the send buffer
       event = tcpWaitForEvents(socket, SOCKET_EVENT_TX_READY, socket->timeout);
+      //The writer is no longer blocked
+      socket->txWaitSize = 0;
 
       //A timeout exception occurred?
       if(event != SOCKET_EVENT_TX_READY)
@@ -348,6 +510,17 @@ error_t tcpSend(Socket *socket, const uint8_t *data,
          //The send buffer is now available for writing
          break;
 
+#if (TCP_FAST_OPEN_SUPPORT == ENABLED)
+      //SYN-RECEIVED state?
+      case TCP_STATE_SYN_RECEIVED:
+         //A Fast Open server may respond to the data carried by the SYN
+         //before the handshake completes
+         if(socket->fastOpenDataFlag)
+            break;
+         //Otherwise, the connection is not established yet
+         return ERROR_NOT_CONNECTED;
+#endif
+
       //LAST-ACK, FIN-WAIT-1, FIN-WAIT-2, CLOSING or TIME-WAIT state?
       case TCP_STATE_LAST_ACK:
       case TCP_STATE_FIN_WAIT_1:
@@ -363,6 +536,26 @@ error_t tcpSend(Socket *socket, const uint8_t *data,
          return (socket->resetFlag) ? ERROR_CONNECTION_RESET : ERROR_NOT_CONNECTED;
       }
 
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+      //The send buffer is allocated when data is queued
+      error = tcpAllocTxBuffer(socket);
+
+      //The memory budget is exhausted?
+      if(error == ERROR_WOULD_BLOCK)
+      {
+         //Non-blocking sockets report the condition to the caller, whereas
+         //blocking sockets wait for other connections to release memory
+         if(!socketMemWait(socket, socket->timeout))
+            return (socket->timeout == 0) ? ERROR_WOULD_BLOCK : ERROR_TIMEOUT;
+
+         //Check the state of the connection again
+         continue;
+      }
+
+      //Failed to allocate memory?
+      if(error) return error;
+#endif
+
       //Determine the actual number of bytes in the send buffer
       n = socket->sndUser + socket->sndNxt - socket->sndUna;
       //Exit immediately if the transmission buffer is full (sanity check)
@@ -373,9 +566,41 @@ error_t tcpSend(Socket *socket, const uint8_t *data,
       n = socket->txBufferSize - n;
       //Calculate the number of bytes to copy at a time
       n = min(n, length - totalLength);
+      //Sequence number of the first byte to write
+      seqNum = socket->sndNxt + socket->sndUser;
+
+#if (TCP_SEND_FILE_SUPPORT == ENABLED)
+      //Immutable data is referenced instead of being copied, as long
+      //as a region is available
+      if(!(flags & SOCKET_FLAG_NO_COPY) ||
+         tcpAddTxRegion(socket, seqNum, data, n))
+#endif
+      {
+         //The stack does not access this area of the send buffer until
+         //sndUser is updated, so the copy is made without holding the
+         //global mutex. Other connections can make progress meanwhile
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+         socket->txBufferBusy = TRUE;
+#endif
+         osMutexRelease(socketMutex);
+         //Copy user data to send buffer
+         tcpWriteTxBuffer(socket, seqNum, data, n);
+         //Enter critical section
+         osMutexAcquire(socketMutex);
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+         socket->txBufferBusy = FALSE;
+#endif
 
-      //Copy user data to send buffer
-      tcpWriteTxBuffer(socket, socket->sndNxt + socket->sndUser, data, n);
+         //The connection may have been closed while copying data
+         if(socket->state != TCP_STATE_ESTABLISHED &&
+#if (TCP_FAST_OPEN_SUPPORT == ENABLED)
+            socket->state != TCP_STATE_SYN_RECEIVED &&
+#endif
+            socket->state != TCP_STATE_CLOSE_WAIT)
+         {
+            continue;
+         }
+      }
 
       //Update the number of data buffered but not yet sent
       socket->sndUser += n;
@@ -393,7 +618,7 @@ error_t tcpSend(Socket *socket, const uint8_t *data,
       //transmission of data, overriding the SWS avoidance algorithm. In
       //practice, this timeout should seldom occur (see RFC 1122 4.2.3.4)
       if(socket->sndUser == n)
-         osTimerStart(&socket->overrideTimer, TCP_OVERRIDE_TIMEOUT);
+         tcpStartTimer(socket, &socket->overrideTimer, TCP_OVERRIDE_TIMEOUT);
 
       //The Nagle algorithm should be implemented to coalesce
       //short segments (refer to RFC 1122 4.2.3.4)
@@ -451,8 +676,12 @@ error_t tcpReceive(Socket *socket, uint8_t *data,
    //Read as much data as possible
    while(*received < size)
    {
+      //The receive low-watermark does not apply beyond the requested size
+      socket->rxWaitSize = size - *received;
       //Wait for data to be available for reading
       event = tcpWaitForEvents(socket, SOCKET_EVENT_RX_READY, socket->timeout);
+      //The reader is no longer blocked
+      socket->rxWaitSize = 0;
 
       //A timeout exception occurred?
       if(event != SOCKET_EVENT_RX_READY)
@@ -465,6 +694,10 @@ error_t tcpReceive(Socket *socket, uint8_t *data,
       case TCP_STATE_ESTABLISHED:
       case TCP_STATE_FIN_WAIT_1:
       case TCP_STATE_FIN_WAIT_2:
+#if (TCP_FAST_OPEN_SUPPORT == ENABLED)
+      //Data carried by the SYN may be read before the handshake completes
+      case TCP_STATE_SYN_RECEIVED:
+#endif
          //Sequence number of the first byte to read
          seqNum = socket->rcvNxt - socket->rcvUser;
          //Data is available in the receive buffer
@@ -519,8 +752,14 @@ error_t tcpReceive(Socket *socket, uint8_t *data,
 
       //Calculate the number of bytes to read at a time
       n = min(socket->rcvUser, size - *received);
+
+      //The stack does not overwrite data that has not been consumed yet,
+      //so the copy is made without holding the global mutex
+      osMutexRelease(socketMutex);
       //Copy data from circular buffer
       tcpReadRxBuffer(socket, seqNum, data, n);
+      //Enter critical section
+      osMutexAcquire(socketMutex);
 
       //Read data until a break character is encountered?
       if(flags & SOCKET_FLAG_BREAK_CHAR)
@@ -536,6 +775,11 @@ error_t tcpReceive(Socket *socket, uint8_t *data,
       //Remaining data still available in the receive buffer
       socket->rcvUser -= n;
 
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+      //Give the receive buffer back to the pool once it has been drained
+      tcpReleaseRxBuffer(socket);
+#endif
+
       //Update the receive window
       tcpUpdateReceiveWindow(socket);
       //Update RX event state
@@ -583,6 +827,17 @@ error_t tcpShutdown(Socket *socket, uint_t how)
    //Disable transmission?
    if(how == SOCKET_SD_SEND || how == SOCKET_SD_BOTH)
    {
+      //The data held back by the cork must be sent before the FIN
+      if(socket->txCork || socket->txMore)
+      {
+         socket->txCork = FALSE;
+         socket->txMore = FALSE;
+
+         //Flush the pending data
+         if(socket->state == TCP_STATE_ESTABLISHED || socket->state == TCP_STATE_CLOSE_WAIT)
+            tcpNagleAlgo(socket);
+      }
+
       //Check current state
       switch(socket->state)
       {
@@ -722,7 +977,7 @@ error_t tcpAbort(Socket *socket)
       //Delete TCB
       tcpDeleteControlBlock(socket);
       //Mark the socket as closed
-      socket->type = SOCKET_TYPE_UNUSED;
+      socketRelease(socket);
       //Return status code
       return error;
 
@@ -730,6 +985,12 @@ error_t tcpAbort(Socket *socket)
    case TCP_STATE_TIME_WAIT:
       //The user doe not own the socket anymore...
       socket->ownedFlag = FALSE;
+#if (TCP_COMPACT_TIME_WAIT_SUPPORT == ENABLED)
+      //Release the socket right now if the connection can be moved
+      //to the compact TIME-WAIT table
+      if(!tcpCompactTimeWait(socket))
+         return NO_ERROR;
+#endif
       //TCB will be deleted and socket will be closed
       //when the 2MSL timer will elapse
       return NO_ERROR;
@@ -741,7 +1002,7 @@ error_t tcpAbort(Socket *socket)
       //Delete TCB
       tcpDeleteControlBlock(socket);
       //Mark the socket as closed
-      socket->type = SOCKET_TYPE_UNUSED;
+      socketRelease(socket);
       //No error to report
       return NO_ERROR;
    }
@@ -769,4 +1030,59 @@ TcpState tcpGetState(Socket *socket)
    return state;
 }
 
+
+/**
+ * @brief Retrieve a snapshot of the state of a TCP connection
+ * @param[in] socket Handle referencing the socket
+ * @param[out] info Connection state and statistics
+ * @return Error code
+ **/
+
+error_t tcpGetInfo(Socket *socket, TcpInfo *info)
+{
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+   //Current state of the TCP FSM
+   info->state = socket->state;
+   info->mss = socket->mss;
+   //Round-trip time estimates
+   info->srtt = socket->srtt;
+   info->rttvar = socket->rttvar;
+   info->rto = socket->rto;
+   //Congestion control variables
+   info->cwnd = socket->cwnd;
+   info->ssthresh = socket->ssthresh;
+   //Send and receive windows
+   info->sndWnd = socket->sndWnd;
+   info->rcvWnd = socket->rcvWnd;
+   //Loss recovery
+   info->retransmitCount = socket->retransmitCount;
+   info->dupAckCount = socket->dupAckCount;
+
+   //Amount of data held in the send buffer (sent but not yet
+   //acknowledged, plus data not yet sent)
+   if(socket->state == TCP_STATE_CLOSED || socket->state == TCP_STATE_LISTEN)
+      info->txQueued = 0;
+   else
+      info->txQueued = (socket->sndNxt - socket->sndUna) + socket->sndUser;
+
+   //Amount of data received but not yet consumed
+   info->rxQueued = socket->rcvUser;
+
+#if (TCP_INFO_SUPPORT == ENABLED)
+   //Per-connection counters
+   info->stats = socket->stats;
+#else
+   //Statistics are not collected
+   memset(&info->stats, 0, sizeof(TcpStats));
+#endif
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
 #endif
@@ -32,6 +32,7 @@
 //Dependencies
 #include "tcp_ip_stack_config.h"
 #include "ip.h"
+#include "net_timer.h"
 
 //TCP support
 #ifndef TCP_SUPPORT
@@ -40,13 +41,38 @@
    #error TCP_SUPPORT parameter is invalid
 #endif
 
-//TCP tick interval
+//High-resolution TCP timers (dedicated timer task)
+#ifndef TCP_FAST_TIMER_SUPPORT
+   #define TCP_FAST_TIMER_SUPPORT DISABLED
+#elif (TCP_FAST_TIMER_SUPPORT != ENABLED && TCP_FAST_TIMER_SUPPORT != DISABLED)
+   #error TCP_FAST_TIMER_SUPPORT parameter is invalid
+#endif
+
+//TCP tick interval (may be as low as 1 ms with high-resolution timers)
 #ifndef TCP_TICK_INTERVAL
-   #define TCP_TICK_INTERVAL 100
-#elif (TCP_TICK_INTERVAL < 100)
+   #if (TCP_FAST_TIMER_SUPPORT == ENABLED)
+      #define TCP_TICK_INTERVAL 1
+   #else
+      #define TCP_TICK_INTERVAL 100
+   #endif
+#elif (TCP_TICK_INTERVAL < 1 || (TCP_TICK_INTERVAL < 100 && TCP_FAST_TIMER_SUPPORT == DISABLED))
    #error TCP_TICK_INTERVAL parameter is invalid
 #endif
 
+//Stack size required to run the TCP timer task
+#ifndef TCP_TIMER_STACK_SIZE
+   #define TCP_TIMER_STACK_SIZE 550
+#elif (TCP_TIMER_STACK_SIZE < 1)
+   #error TCP_TIMER_STACK_SIZE parameter is invalid
+#endif
+
+//Priority at which the TCP timer task should run
+#ifndef TCP_TIMER_PRIORITY
+   #define TCP_TIMER_PRIORITY 3
+#elif (TCP_TIMER_PRIORITY < 0)
+   #error TCP_TIMER_PRIORITY parameter is invalid
+#endif
+
 //Maximum segment size
 #ifndef TCP_MAX_MSS
    #define TCP_MAX_MSS 1430
@@ -89,13 +115,62 @@
    #error TCP_MAX_RX_BUFFER_SIZE parameter is invalid
 #endif
 
+//On-demand allocation and automatic sizing of the socket buffers
+#ifndef TCP_BUFFER_AUTOTUNE_SUPPORT
+   #define TCP_BUFFER_AUTOTUNE_SUPPORT DISABLED
+#elif (TCP_BUFFER_AUTOTUNE_SUPPORT != ENABLED && TCP_BUFFER_AUTOTUNE_SUPPORT != DISABLED)
+   #error TCP_BUFFER_AUTOTUNE_SUPPORT parameter is invalid
+#endif
+
 //SYN queue size for listening sockets
 #ifndef TCP_SYN_QUEUE_SIZE
-   #define TCP_SYN_QUEUE_SIZE 4
+   #define TCP_SYN_QUEUE_SIZE 8
 #elif (TCP_SYN_QUEUE_SIZE < 1)
    #error TCP_SYN_QUEUE_SIZE parameter is invalid
 #endif
 
+//Number of SYN queue entries shared by all the listening sockets
+#ifndef TCP_SYN_QUEUE_TABLE_SIZE
+   #define TCP_SYN_QUEUE_TABLE_SIZE 16
+#elif (TCP_SYN_QUEUE_TABLE_SIZE < 1)
+   #error TCP_SYN_QUEUE_TABLE_SIZE parameter is invalid
+#endif
+
+//SYN cookies support
+#ifndef TCP_SYN_COOKIE_SUPPORT
+   #define TCP_SYN_COOKIE_SUPPORT DISABLED
+#elif (TCP_SYN_COOKIE_SUPPORT != ENABLED && TCP_SYN_COOKIE_SUPPORT != DISABLED)
+   #error TCP_SYN_COOKIE_SUPPORT parameter is invalid
+#endif
+
+//TCP Fast Open support
+#ifndef TCP_FAST_OPEN_SUPPORT
+   #define TCP_FAST_OPEN_SUPPORT DISABLED
+#elif (TCP_FAST_OPEN_SUPPORT != ENABLED && TCP_FAST_OPEN_SUPPORT != DISABLED)
+   #error TCP_FAST_OPEN_SUPPORT parameter is invalid
+#endif
+
+//Number of servers whose Fast Open cookie is cached
+#ifndef TCP_FAST_OPEN_CACHE_SIZE
+   #define TCP_FAST_OPEN_CACHE_SIZE 4
+#elif (TCP_FAST_OPEN_CACHE_SIZE < 1)
+   #error TCP_FAST_OPEN_CACHE_SIZE parameter is invalid
+#endif
+
+//Compact TIME-WAIT state support
+#ifndef TCP_COMPACT_TIME_WAIT_SUPPORT
+   #define TCP_COMPACT_TIME_WAIT_SUPPORT DISABLED
+#elif (TCP_COMPACT_TIME_WAIT_SUPPORT != ENABLED && TCP_COMPACT_TIME_WAIT_SUPPORT != DISABLED)
+   #error TCP_COMPACT_TIME_WAIT_SUPPORT parameter is invalid
+#endif
+
+//Number of connections that can be held in the compact TIME-WAIT state
+#ifndef TCP_TIME_WAIT_TABLE_SIZE
+   #define TCP_TIME_WAIT_TABLE_SIZE 16
+#elif (TCP_TIME_WAIT_TABLE_SIZE < 1)
+   #error TCP_TIME_WAIT_TABLE_SIZE parameter is invalid
+#endif
+
 //Maximum number of retransmissions
 #ifndef TCP_MAX_RETRIES
    #define TCP_MAX_RETRIES 5
@@ -103,6 +178,13 @@
    #error TCP_MAX_RETRIES parameter is invalid
 #endif
 
+//Size of the retransmission queue (maximum number of segments in flight)
+#ifndef TCP_RETRANSMIT_QUEUE_SIZE
+   #define TCP_RETRANSMIT_QUEUE_SIZE 32
+#elif (TCP_RETRANSMIT_QUEUE_SIZE < 4)
+   #error TCP_RETRANSMIT_QUEUE_SIZE parameter is invalid
+#endif
+
 //Initial retransmission timeout
 #ifndef TCP_INITIAL_RTO
    #define TCP_INITIAL_RTO 1000
@@ -110,10 +192,10 @@
    #error TCP_INITIAL_RTO parameter is invalid
 #endif
 
-//Minimum retransmission timeout
+//Default minimum retransmission timeout (may be changed per socket)
 #ifndef TCP_MIN_RTO
    #define TCP_MIN_RTO 1000
-#elif (TCP_MIN_RTO < 100)
+#elif (TCP_MIN_RTO < TCP_TICK_INTERVAL)
    #error TCP_MIN_RTO parameter is invalid
 #endif
 
@@ -180,6 +262,34 @@
    #error TCP_2MSL_TIMER parameter is invalid
 #endif
 
+//Delayed ACK support
+#ifndef TCP_DELAYED_ACK_SUPPORT
+   #define TCP_DELAYED_ACK_SUPPORT DISABLED
+#elif (TCP_DELAYED_ACK_SUPPORT != ENABLED && TCP_DELAYED_ACK_SUPPORT != DISABLED)
+   #error TCP_DELAYED_ACK_SUPPORT parameter is invalid
+#endif
+
+//Coalesce the RX notifications of the segments processed in one batch
+#ifndef TCP_RX_COALESCING_SUPPORT
+   #define TCP_RX_COALESCING_SUPPORT DISABLED
+#elif (TCP_RX_COALESCING_SUPPORT != ENABLED && TCP_RX_COALESCING_SUPPORT != DISABLED)
+   #error TCP_RX_COALESCING_SUPPORT parameter is invalid
+#endif
+
+//Header prediction (fast path for in-order data and pure ACKs)
+#ifndef TCP_HEADER_PREDICTION_SUPPORT
+   #define TCP_HEADER_PREDICTION_SUPPORT ENABLED
+#elif (TCP_HEADER_PREDICTION_SUPPORT != ENABLED && TCP_HEADER_PREDICTION_SUPPORT != DISABLED)
+   #error TCP_HEADER_PREDICTION_SUPPORT parameter is invalid
+#endif
+
+//Delayed ACK timeout (must not exceed 500 ms)
+#ifndef TCP_DELAYED_ACK_TIMEOUT
+   #define TCP_DELAYED_ACK_TIMEOUT 200
+#elif (TCP_DELAYED_ACK_TIMEOUT < TCP_TICK_INTERVAL || TCP_DELAYED_ACK_TIMEOUT > 500)
+   #error TCP_DELAYED_ACK_TIMEOUT parameter is invalid
+#endif
+
 //Selective acknowledgment support
 #ifndef TCP_SACK_SUPPORT
    #define TCP_SACK_SUPPORT DISABLED
@@ -194,11 +304,134 @@
    #error TCP_MAX_SACK_BLOCKS parameter is invalid
 #endif
 
+//RACK-TLP loss detection support
+#ifndef TCP_RACK_SUPPORT
+   #define TCP_RACK_SUPPORT DISABLED
+#elif (TCP_RACK_SUPPORT != ENABLED && TCP_RACK_SUPPORT != DISABLED)
+   #error TCP_RACK_SUPPORT parameter is invalid
+#endif
+
+//Worst case delayed ACK time accounted for by the tail loss probe timeout
+#ifndef TCP_RACK_MAX_ACK_DELAY
+   #define TCP_RACK_MAX_ACK_DELAY 200
+#elif (TCP_RACK_MAX_ACK_DELAY < 0)
+   #error TCP_RACK_MAX_ACK_DELAY parameter is invalid
+#endif
+
+//TCP pacing support
+#ifndef TCP_PACING_SUPPORT
+   #define TCP_PACING_SUPPORT DISABLED
+#elif (TCP_PACING_SUPPORT != ENABLED && TCP_PACING_SUPPORT != DISABLED)
+   #error TCP_PACING_SUPPORT parameter is invalid
+#endif
+
+//Pacing gain during slow start (percentage of cwnd/SRTT)
+#ifndef TCP_PACING_SS_GAIN
+   #define TCP_PACING_SS_GAIN 200
+#elif (TCP_PACING_SS_GAIN < 100)
+   #error TCP_PACING_SS_GAIN parameter is invalid
+#endif
+
+//Pacing gain during congestion avoidance (percentage of cwnd/SRTT)
+#ifndef TCP_PACING_CA_GAIN
+   #define TCP_PACING_CA_GAIN 120
+#elif (TCP_PACING_CA_GAIN < 100)
+   #error TCP_PACING_CA_GAIN parameter is invalid
+#endif
+
+//Black hole detection (packetization layer path MTU discovery)
+#ifndef TCP_PLPMTUD_SUPPORT
+   #define TCP_PLPMTUD_SUPPORT DISABLED
+#elif (TCP_PLPMTUD_SUPPORT != ENABLED && TCP_PLPMTUD_SUPPORT != DISABLED)
+   #error TCP_PLPMTUD_SUPPORT parameter is invalid
+#endif
+
+//Segment size used once full-sized segments appear to be black-holed
+#ifndef TCP_PLPMTUD_BASE_MSS
+   #define TCP_PLPMTUD_BASE_MSS 1024
+#elif (TCP_PLPMTUD_BASE_MSS < TCP_MIN_MSS)
+   #error TCP_PLPMTUD_BASE_MSS parameter is invalid
+#endif
+
+//Number of consecutive timeouts after which a black hole is assumed
+#ifndef TCP_PLPMTUD_RTO_THRESHOLD
+   #define TCP_PLPMTUD_RTO_THRESHOLD 2
+#elif (TCP_PLPMTUD_RTO_THRESHOLD < 1 || TCP_PLPMTUD_RTO_THRESHOLD > TCP_MAX_RETRIES)
+   #error TCP_PLPMTUD_RTO_THRESHOLD parameter is invalid
+#endif
+
+//Window scaling support
+#ifndef TCP_WINDOW_SCALE_SUPPORT
+   #define TCP_WINDOW_SCALE_SUPPORT DISABLED
+#elif (TCP_WINDOW_SCALE_SUPPORT != ENABLED && TCP_WINDOW_SCALE_SUPPORT != DISABLED)
+   #error TCP_WINDOW_SCALE_SUPPORT parameter is invalid
+#endif
+
+//Maximum shift count allowed by the Window Scale option
+#define TCP_MAX_WINDOW_SHIFT 14
+
+//Timestamps option support
+#ifndef TCP_TIMESTAMP_SUPPORT
+   #define TCP_TIMESTAMP_SUPPORT DISABLED
+#elif (TCP_TIMESTAMP_SUPPORT != ENABLED && TCP_TIMESTAMP_SUPPORT != DISABLED)
+   #error TCP_TIMESTAMP_SUPPORT parameter is invalid
+#endif
+
+//Room taken by the Timestamps option (including padding) in every segment
+#define TCP_TIMESTAMP_OVERHEAD 12
+
+//CUBIC congestion control support
+#ifndef TCP_CUBIC_SUPPORT
+   #define TCP_CUBIC_SUPPORT DISABLED
+#elif (TCP_CUBIC_SUPPORT != ENABLED && TCP_CUBIC_SUPPORT != DISABLED)
+   #error TCP_CUBIC_SUPPORT parameter is invalid
+#endif
+
+//Zero-copy transmission of immutable data
+#ifndef TCP_SEND_FILE_SUPPORT
+   #define TCP_SEND_FILE_SUPPORT DISABLED
+#elif (TCP_SEND_FILE_SUPPORT != ENABLED && TCP_SEND_FILE_SUPPORT != DISABLED)
+   #error TCP_SEND_FILE_SUPPORT parameter is invalid
+#endif
+
+//Number of memory regions that can be referenced by the send buffer
+#ifndef TCP_MAX_TX_REGIONS
+   #define TCP_MAX_TX_REGIONS 4
+#elif (TCP_MAX_TX_REGIONS < 1)
+   #error TCP_MAX_TX_REGIONS parameter is invalid
+#endif
+
+//Per-connection statistics
+#ifndef TCP_INFO_SUPPORT
+   #define TCP_INFO_SUPPORT DISABLED
+#elif (TCP_INFO_SUPPORT != ENABLED && TCP_INFO_SUPPORT != DISABLED)
+   #error TCP_INFO_SUPPORT parameter is invalid
+#endif
+
+//Size of the connection hash table
+#ifndef TCP_HASH_TABLE_SIZE
+   #define TCP_HASH_TABLE_SIZE 16
+#elif (TCP_HASH_TABLE_SIZE < 1 || (TCP_HASH_TABLE_SIZE & (TCP_HASH_TABLE_SIZE - 1)))
+   #error TCP_HASH_TABLE_SIZE parameter is invalid
+#endif
+
+//Size of the listening socket hash table
+#ifndef TCP_LISTEN_HASH_TABLE_SIZE
+   #define TCP_LISTEN_HASH_TABLE_SIZE 4
+#elif (TCP_LISTEN_HASH_TABLE_SIZE < 1 || (TCP_LISTEN_HASH_TABLE_SIZE & (TCP_LISTEN_HASH_TABLE_SIZE - 1)))
+   #error TCP_LISTEN_HASH_TABLE_SIZE parameter is invalid
+#endif
+
 //Maximum TCP header length
 #define TCP_MAX_HEADER_LENGTH 60
 //Default maximum segment size
 #define TCP_DEFAULT_MSS 536
 
+//Length of the Fast Open cookies generated by the server
+#define TCP_FAST_OPEN_COOKIE_SIZE 8
+//Maximum length of a Fast Open cookie (refer to RFC 7413)
+#define TCP_FAST_OPEN_MAX_COOKIE_SIZE 16
+
 //Sequence number comparison macro
 #define TCP_CMP_SEQ(a, b) ((int32_t) ((a) - (b)))
 
@@ -250,7 +483,8 @@ typedef enum
    TCP_OPTION_WINDOW_SCALE_FACTOR = 3,
    TCP_OPTION_SACK_PERMITTED      = 4,
    TCP_OPTION_SACK                = 5,
-   TCP_OPTION_TIMESTAMP           = 8
+   TCP_OPTION_TIMESTAMP           = 8,
+   TCP_OPTION_FAST_OPEN_COOKIE    = 34
 } TcpOptionKind;
 
 
@@ -301,20 +535,25 @@ typedef __packed struct
 
 /**
  * @brief Retransmission queue item
+ *
+ * The data of the segment is still held in the send buffer, and
+ * the header is rebuilt when the segment is retransmitted. The checksum
+ * of the data is kept, so that only the new header has to be summed
  **/
 
-typedef struct _TcpQueueItem
+typedef struct
 {
-   struct _TcpQueueItem *next;
-   uint_t length;
-   uint_t sacked;
-   union
-   {
-      TcpHeader header;
-      uint8_t b[TCP_MAX_HEADER_LENGTH];
-   };
-   IpPseudoHeader pseudoHeader;
-   uint8_t timeToLive;
+   uint32_t seqNum;      ///<Sequence number of the segment
+   uint16_t length;      ///<Number of data bytes
+   uint16_t checksum;    ///<Checksum of the data
+   bool_t checksumValid; ///<The checksum of the data has been calculated
+   uint8_t flags;        ///<Control flags
+   bool_t sacked;        ///<The segment has been selectively acknowledged
+   bool_t retransmitted; ///<The segment has been retransmitted during loss recovery
+#if (TCP_RACK_SUPPORT == ENABLED)
+   time_t xmitTime;      ///<Time of the most recent transmission
+   uint_t xmitCount;     ///<Number of transmissions
+#endif
 } TcpQueueItem;
 
 
@@ -325,12 +564,30 @@ typedef struct _TcpQueueItem
 typedef struct _TcpSynQueueItem
 {
    struct _TcpSynQueueItem *next;
+   struct _TcpSynQueueItem *hashNext;
+   Socket *socket;
    NetInterface *interface;
    IpAddr srcAddr;
    uint16_t srcPort;
    IpAddr destAddr;
    uint32_t isn;
    uint16_t mss;
+   bool_t wndScaleFlag;
+   uint8_t wndShift;
+   bool_t sackPermitted;
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   bool_t tsFlag;
+   uint32_t tsVal;
+#endif
+   uint16_t wnd;
+#if (TCP_SYN_COOKIE_SUPPORT == ENABLED)
+   bool_t cookieFlag;
+   uint32_t iss;
+#endif
+#if (TCP_FAST_OPEN_SUPPORT == ENABLED)
+   bool_t fastOpenCookieFlag;
+   ChunkedBuffer *fastOpenData;
+#endif
 } TcpSynQueueItem;
 
 
@@ -345,6 +602,61 @@ typedef struct
 } TcpSackBlock;
 
 
+/**
+ * @brief Immutable memory region referenced by the send buffer
+ **/
+
+typedef struct
+{
+   uint32_t seqNum;     ///<Sequence number of the first byte
+   const uint8_t *data; ///<Pointer to the data
+   size_t length;       ///<Length of the region
+} TcpTxRegion;
+
+
+/**
+ * @brief Per-connection statistics
+ **/
+
+typedef struct
+{
+   uint32_t segmentsIn;       ///<Number of segments received
+   uint32_t segmentsOut;      ///<Number of segments sent, including retransmissions
+   uint32_t retransmits;      ///<Number of retransmitted segments
+   uint32_t fastRetransmits;  ///<Number of fast retransmissions
+   uint32_t timeouts;         ///<Number of retransmission timer expirations
+   uint32_t tailLossProbes;   ///<Number of tail loss probes sent
+   uint32_t zeroWindowEvents; ///<Number of times the peer advertised a zero window
+   uint32_t bytesAcked;       ///<Number of bytes acknowledged by the peer
+   time_t lastDataSent;       ///<Time at which data was last sent
+   time_t lastDataRecv;       ///<Time at which data was last received
+   time_t lastAckRecv;        ///<Time at which an acceptable ACK was last received
+} TcpStats;
+
+
+/**
+ * @brief Snapshot of the state of a TCP connection
+ **/
+
+typedef struct
+{
+   TcpState state;         ///<Current state of the TCP finite state machine
+   uint16_t mss;           ///<Maximum segment size
+   time_t srtt;            ///<Smoothed round-trip time
+   time_t rttvar;          ///<Round-trip time variation
+   time_t rto;             ///<Retransmission timeout
+   uint32_t cwnd;          ///<Congestion window
+   uint32_t ssthresh;      ///<Slow start threshold
+   uint32_t sndWnd;        ///<Size of the send window
+   uint32_t rcvWnd;        ///<Receive window
+   uint_t retransmitCount; ///<Number of retransmissions of the current segment
+   uint_t dupAckCount;     ///<Number of consecutive duplicate ACKs
+   size_t txQueued;        ///<Data buffered in the send buffer (sent or not)
+   size_t rxQueued;        ///<Data received but not yet consumed
+   TcpStats stats;         ///<Per-connection counters
+} TcpInfo;
+
+
 /**
  * @brief Transmit buffer
  **/
@@ -369,6 +681,35 @@ typedef struct
 } TcpRxBuffer;
 
 
+/**
+ * @brief Congestion control algorithm
+ **/
+
+typedef struct
+{
+   const char_t *name;                                        ///<Name of the algorithm
+   void (*init)(Socket *socket);                              ///<Connection synchronized
+   void (*ackReceived)(Socket *socket, uint32_t ackNum, uint_t n); ///<New data acknowledged
+   void (*lossDetected)(Socket *socket);                      ///<Entering loss recovery
+   void (*timeout)(Socket *socket);                           ///<Retransmission timeout
+   void (*idleRestart)(Socket *socket);                       ///<Transmission restarts after an idle period
+} TcpCongestionAlgo;
+
+
+/**
+ * @brief CUBIC state
+ **/
+
+typedef struct
+{
+   uint32_t wMax;        ///<Window size just before the last reduction
+   uint32_t k;           ///<Time period to reach wMax (in milliseconds)
+   uint32_t originPoint; ///<Origin point of the cubic function
+   time_t epochStart;    ///<Beginning of the current congestion avoidance epoch
+   uint32_t accumulator; ///<Fractional window increase carried over between ACKs
+} TcpCubicContext;
+
+
 /**
  * @brief TCP Control Block (TCP)
  **/
@@ -379,22 +720,38 @@ typedef struct
    bool_t ownedFlag;              ///<The user is the owner of the TCP socket
    bool_t closedFlag;             ///<The connection has been closed properly
    bool_t resetFlag;              ///<The connection has been reset
+   bool_t reusePortFlag;          ///<Several listening sockets may share the local port
 
    uint16_t mss;                  ///<Maximum segment size
    uint32_t iss;                  ///<Initial send sequence number
    uint32_t irs;                  ///<Initial receive sequence number
 
+   bool_t wndScaleFlag;           ///<Window Scale option in use on the connection
+   uint8_t sndWndShift;           ///<Shift count applied to the windows advertised by the peer
+   uint8_t rcvWndShift;           ///<Shift count applied to the windows we advertise
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   bool_t tsFlag;                 ///<Timestamps option in use on the connection
+   uint32_t tsRecent;             ///<Timestamp to be echoed in the next segment
+   uint32_t tsLastAckSent;        ///<Acknowledgment number carried by the last ACK sent
+   bool_t tsRtoFlag;              ///<Check whether the last retransmission timeout was spurious
+   uint32_t tsRtoVal;             ///<Time at which the retransmission timer expired
+   uint32_t tsPrevCwnd;           ///<Congestion window before the retransmission timeout
+   uint32_t tsPrevSsthresh;       ///<Slow start threshold before the retransmission timeout
+#endif
+
    uint32_t sndUna;               ///<Data that have been sent but not yet acknowledged
    uint32_t sndNxt;               ///<Sequence number of the next byte to be sent
-   uint16_t sndUser;              ///<Amount of data buffered but not yet sent
-   uint16_t sndWnd;               ///<Size of the send window
-   uint16_t maxSndWnd;            ///<Maximum send window it has seen so far on the connection
+   uint32_t sndUser;              ///<Amount of data buffered but not yet sent
+   uint32_t sndWnd;               ///<Size of the send window
+   uint32_t maxSndWnd;            ///<Maximum send window it has seen so far on the connection
    uint32_t sndWl1;               ///<Segment sequence number used for last window update
    uint32_t sndWl2;               ///<Segment acknowledgment number used for last window update
 
    uint32_t rcvNxt;               ///<Receive next
-   uint16_t rcvUser;              ///<Number of data received but not yet consumed
-   uint16_t rcvWnd;               ///<Receive window
+   uint32_t rcvUser;              ///<Number of data received but not yet consumed
+   uint32_t rcvWnd;               ///<Receive window
+   size_t rxPrecopied;            ///<In-order data copied while verifying the checksum
 
    bool_t rttBusy;                ///<RTT measurement is being performed
    uint32_t rttSeqNum;            ///<Sequence number identifying a TCP segment
@@ -402,22 +759,52 @@ typedef struct
    time_t srtt;                   ///<Smoothed round-trip time
    time_t rttvar;                 ///<Round-trip time variation
    time_t rto;                    ///<Retransmission timeout
+   time_t minRto;                 ///<Lower bound of the retransmission timeout
 
-   uint16_t cwnd;                 ///<Congestion window
-   uint16_t ssthresh;             ///<Slow start threshold
+   uint32_t cwnd;                 ///<Congestion window
+   uint32_t ssthresh;             ///<Slow start threshold
    uint_t dupAckCount;            ///<Number of consecutive duplicate ACKs
    uint_t n;                      ///<Number of bytes acknowledged during the whole round-trip
+   bool_t fastRecovery;           ///<Loss recovery is in progress
+   uint32_t recover;              ///<Highest sequence number sent when loss recovery started
+   const TcpCongestionAlgo *congestionAlgo; ///<Congestion control algorithm
+   time_t lastTxTime;             ///<Time at which data was last sent
+#if (TCP_CUBIC_SUPPORT == ENABLED)
+   TcpCubicContext cubic;         ///<CUBIC state
+#endif
 
    TcpTxBuffer txBuffer;          ///<Send buffer
    size_t txBufferSize;           ///<Size of the send buffer
+#if (TCP_SEND_FILE_SUPPORT == ENABLED)
+   TcpTxRegion txRegion[TCP_MAX_TX_REGIONS]; ///<Regions sent without being copied
+   uint_t txRegionCount;                     ///<Number of referenced regions
+#endif
    TcpRxBuffer rxBuffer;          ///<Receive buffer
    size_t rxBufferSize;           ///<Size of the receive buffer
+   size_t txLowWat;               ///<Free space in the send buffer that makes the socket writable
+   size_t rxLowWat;               ///<Amount of received data that makes the socket readable
+   size_t txWaitSize;             ///<Number of bytes the blocked writer still has to queue
+   size_t rxWaitSize;             ///<Number of bytes the blocked reader still expects
+   bool_t txCork;                 ///<Partial segments are held back until the cork is released
+   bool_t txMore;                 ///<The last write announced that more data is coming
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+   bool_t txAutoTune;             ///<The size of the send buffer is adjusted automatically
+   bool_t rxAutoTune;             ///<The size of the receive buffer is adjusted automatically
+   bool_t txBufferBusy;           ///<User data is being copied to the send buffer
+   uint32_t txBdp;                ///<Number of bytes acknowledged during the last round-trip
+   uint32_t rxBdp;                ///<Largest number of bytes received during a round-trip
+   uint32_t rxRttBytes;           ///<Number of bytes received during the current round-trip
+   time_t rxRttStart;             ///<Start time of the current round-trip
+#endif
 
-   TcpQueueItem *retransmitQueue; ///<Retransmission queue
+   TcpQueueItem retransmitQueue[TCP_RETRANSMIT_QUEUE_SIZE]; ///<Retransmission queue (ring of segment descriptors)
+   uint_t retransmitQueueHead;    ///<Index of the earliest unacknowledged segment
+   uint_t retransmitQueueCount;   ///<Number of segments in the retransmission queue
    OsTimer retransmitTimer;       ///<Retransmission timer
    uint_t retransmitCount;        ///<Number of retransmissions
 
    TcpSynQueueItem *synQueue;     ///<SYN queue for listening sockets
+   uint_t synQueueLength;         ///<Number of pending connection requests
 
    uint_t wndProbeCount;          ///<Zero window probe counter
    time_t wndProbeInterval;       ///<Interval between successive probes
@@ -426,15 +813,59 @@ typedef struct
    OsTimer overrideTimer;         ///<Override timer
    OsTimer finWait2Timer;         ///<FIN-WAIT-2 timer
    OsTimer timeWaitTimer;         ///<2MSL timer
+   NetTimer timer;                ///<Entry of the connection in the timer wheel
+   time_t timerDeadline;          ///<Expiration time of the earliest timer
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+   OsTimer delayedAckTimer;       ///<Delayed ACK timer
+   bool_t ackDelayed;             ///<An ACK is being delayed
+   uint_t ackDelayedBytes;        ///<Number of bytes received since the last ACK was sent
+#endif
+
+#if (TCP_RX_COALESCING_SUPPORT == ENABLED)
+   bool_t rxEventPending;         ///<The reader is notified at the end of the current RX batch
+#endif
+
+#if (TCP_RACK_SUPPORT == ENABLED)
+   bool_t rackDelivered;          ///<At least one segment has been delivered
+   time_t rackXmitTime;           ///<Transmission time of the most recently sent segment that has been delivered
+   uint32_t rackEndSeq;           ///<Ending sequence number of that segment
+   time_t rackRtt;                ///<RTT measured on that segment
+   time_t rackMinRtt;             ///<Minimum RTT measured on the connection
+   OsTimer tlpTimer;              ///<Tail loss probe timer
+   bool_t tlpInFlight;            ///<A tail loss probe is outstanding
+   uint32_t tlpEndSeq;            ///<Value of SND.NXT when the probe was sent
+#endif
+
+#if (TCP_PACING_SUPPORT == ENABLED)
+   bool_t pacingEnabled;          ///<Transmissions are paced
+   uint32_t pacingMaxRate;        ///<Maximum pacing rate, in bytes per second (0 for no limit)
+   time_t pacingNextTime;         ///<Earliest time at which the next segment may be sent
+   uint_t pacingRemainder;        ///<Fraction of a millisecond carried over, in microseconds
+   OsTimer pacingTimer;           ///<Pacing timer
+#endif
+
+#if (TCP_FAST_OPEN_SUPPORT == ENABLED)
+   bool_t fastOpenFlag;           ///<The Fast Open option is sent in the SYN or the SYN ACK
+   bool_t fastOpenDataFlag;       ///<Data carried by the SYN has been accepted
+   uint8_t fastOpenCookie[TCP_FAST_OPEN_MAX_COOKIE_SIZE]; ///<Fast Open cookie
+   uint_t fastOpenCookieLength;   ///<Length of the Fast Open cookie
+#endif
+
+   IpPathCache pathCache;                       ///<Next hop and link-layer address of the remote host
 
    bool_t sackPermitted;                        ///<SACK Permitted option received
    TcpSackBlock sackBlock[TCP_MAX_SACK_BLOCKS]; ///<List of non-contiguous blocks that have been received
    uint_t sackBlockCount;                       ///<Number of non-contiguous blocks that have been received
+
+#if (TCP_INFO_SUPPORT == ENABLED)
+   TcpStats stats;                ///<Per-connection statistics
+#endif
 } TcpControlBlock;
 
 
 //TCP related functions
-error_t tcpConnect(Socket *socket);
+error_t tcpConnect(Socket *socket, const uint8_t *data,
+   size_t length, size_t *written);
 error_t tcpListen(Socket *socket);
 Socket *tcpAccept(Socket *socket, IpAddr *clientIpAddr, uint16_t *clientPort);
 
@@ -447,5 +878,6 @@ error_t tcpReceive(Socket *socket, uint8_t *data,
 error_t tcpShutdown(Socket *socket, uint_t how);
 error_t tcpAbort(Socket *socket);
 TcpState tcpGetState(Socket *socket);
+error_t tcpGetInfo(Socket *socket, TcpInfo *info);
 
 #endif
@@ -0,0 +1,392 @@
+/**
+ * @file tcp_congestion.c
+ * @brief TCP congestion control algorithms
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The congestion control algorithm of a connection is selected through
+ * a table of handlers. The stack invokes the handlers when the connection
+ * is synchronized, when new data is acknowledged outside loss recovery,
+ * when a loss is detected, upon a retransmission timeout and when the
+ * transmission restarts after an idle period. Loss recovery itself
+ * (NewReno or SACK-based) is common to all the algorithms
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TCP_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "socket.h"
+#include "tcp.h"
+#include "tcp_congestion.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (TCP_SUPPORT == ENABLED)
+
+//NewReno handlers
+static void tcpNewRenoInit(Socket *socket);
+static void tcpNewRenoAckReceived(Socket *socket, uint32_t ackNum, uint_t n);
+static void tcpNewRenoLossDetected(Socket *socket);
+static void tcpNewRenoTimeout(Socket *socket);
+static void tcpNewRenoIdleRestart(Socket *socket);
+
+//CUBIC handlers
+#if (TCP_CUBIC_SUPPORT == ENABLED)
+static void tcpCubicInit(Socket *socket);
+static void tcpCubicAckReceived(Socket *socket, uint32_t ackNum, uint_t n);
+static void tcpCubicLossDetected(Socket *socket);
+static void tcpCubicTimeout(Socket *socket);
+static void tcpCubicIdleRestart(Socket *socket);
+static uint32_t tcpCubicRoot(uint64_t x);
+#endif
+
+//NewReno congestion control (refer to RFC 5681 and RFC 6582)
+const TcpCongestionAlgo tcpNewRenoAlgo =
+{
+   "newreno",
+   tcpNewRenoInit,
+   tcpNewRenoAckReceived,
+   tcpNewRenoLossDetected,
+   tcpNewRenoTimeout,
+   tcpNewRenoIdleRestart
+};
+
+#if (TCP_CUBIC_SUPPORT == ENABLED)
+
+//CUBIC congestion control (refer to RFC 8312)
+const TcpCongestionAlgo tcpCubicAlgo =
+{
+   "cubic",
+   tcpCubicInit,
+   tcpCubicAckReceived,
+   tcpCubicLossDetected,
+   tcpCubicTimeout,
+   tcpCubicIdleRestart
+};
+
+#endif
+
+//List of available algorithms
+static const TcpCongestionAlgo *tcpCongestionAlgoTable[] =
+{
+   &tcpNewRenoAlgo,
+#if (TCP_CUBIC_SUPPORT == ENABLED)
+   &tcpCubicAlgo,
+#endif
+};
+
+
+/**
+ * @brief Find a congestion control algorithm by name
+ * @param[in] name Name of the algorithm (e.g. "newreno" or "cubic")
+ * @return Pointer to the algorithm, or NULL if it is not available
+ **/
+
+const TcpCongestionAlgo *tcpGetCongestionAlgo(const char_t *name)
+{
+   uint_t i;
+
+   //Loop through the available algorithms
+   for(i = 0; i < arraysize(tcpCongestionAlgoTable); i++)
+   {
+      //Matching name?
+      if(!strcmp(tcpCongestionAlgoTable[i]->name, name))
+         return tcpCongestionAlgoTable[i];
+   }
+
+   //The specified algorithm is not available
+   return NULL;
+}
+
+
+/**
+ * @brief NewReno initialization
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void tcpNewRenoInit(Socket *socket)
+{
+   //Initial congestion window
+   socket->cwnd = min(TCP_INITIAL_WINDOW * socket->mss, socket->txBufferSize);
+   //Slow start threshold should be set arbitrarily high
+   socket->ssthresh = UINT32_MAX;
+}
+
+
+/**
+ * @brief NewReno window growth
+ * @param[in] socket Handle referencing the socket
+ * @param[in] ackNum Acknowledgment number of the incoming ACK
+ * @param[in] n Number of bytes acknowledged by the incoming ACK
+ **/
+
+static void tcpNewRenoAckReceived(Socket *socket, uint32_t ackNum, uint_t n)
+{
+   //Slow start algorithm is used when cwnd is lower than ssthresh
+   if(socket->cwnd < socket->ssthresh)
+   {
+      //During slow start, TCP increments cwnd by at most SMSS bytes
+      //for each ACK received that cumulatively acknowledges new data
+      socket->cwnd += min(n, socket->mss);
+   }
+   //Congestion avoidance algorithm is used when cwnd exceeds ssthres
+   else
+   {
+      //Congestion window is updated once per RTT
+      if(socket->rttBusy && TCP_CMP_SEQ(ackNum, socket->rttSeqNum) > 0)
+      {
+         //TCP must not increment cwnd by more than SMSS bytes
+         socket->cwnd += min(socket->n, socket->mss);
+      }
+   }
+}
+
+
+/**
+ * @brief NewReno reaction to a loss
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void tcpNewRenoLossDetected(Socket *socket)
+{
+   //Amount of data that has been sent but not yet acknowledged
+   uint_t flightSize = socket->sndNxt - socket->sndUna;
+   //Adjust ssthresh value
+   socket->ssthresh = max(flightSize / 2, 2 * socket->mss);
+}
+
+
+/**
+ * @brief NewReno reaction to a retransmission timeout
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void tcpNewRenoTimeout(Socket *socket)
+{
+   //Upon a timeout cwnd must be set to no more than the loss
+   //window, LW, which equals 1 full-sized segment
+   socket->cwnd = min(TCP_LOSS_WINDOW * socket->mss, socket->txBufferSize);
+}
+
+
+/**
+ * @brief NewReno restart after an idle period
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void tcpNewRenoIdleRestart(Socket *socket)
+{
+   //cwnd is reduced to the restart window, which equals the
+   //initial window (refer to RFC 5681 section 4.1)
+   socket->cwnd = min(socket->cwnd, TCP_INITIAL_WINDOW * socket->mss);
+}
+
+#if (TCP_CUBIC_SUPPORT == ENABLED)
+
+/**
+ * @brief CUBIC initialization
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void tcpCubicInit(Socket *socket)
+{
+   //Initial congestion window and slow start threshold
+   tcpNewRenoInit(socket);
+   //Clear CUBIC state
+   memset(&socket->cubic, 0, sizeof(TcpCubicContext));
+}
+
+
+/**
+ * @brief CUBIC window growth
+ * @param[in] socket Handle referencing the socket
+ * @param[in] ackNum Acknowledgment number of the incoming ACK
+ * @param[in] n Number of bytes acknowledged by the incoming ACK
+ **/
+
+static void tcpCubicAckReceived(Socket *socket, uint32_t ackNum, uint_t n)
+{
+   int64_t d;
+   int64_t target;
+   uint64_t inc;
+   uint32_t rtt;
+   uint32_t elapsed;
+   uint32_t wEst;
+   time_t time;
+   TcpCubicContext *context;
+
+   //Slow start is the same as for standard TCP
+   if(socket->cwnd < socket->ssthresh)
+   {
+      tcpNewRenoAckReceived(socket, ackNum, n);
+      return;
+   }
+
+   //Point to the CUBIC state
+   context = &socket->cubic;
+   //Current time
+   time = osGetTickCount();
+   //Smoothed round-trip time
+   rtt = socket->srtt ? socket->srtt : socket->rto;
+
+   //Beginning of a new congestion avoidance epoch?
+   if(!context->epochStart)
+   {
+      context->epochStart = time;
+      context->accumulator = 0;
+
+      //Below the window size where the last reduction occurred?
+      if(socket->cwnd < context->wMax)
+      {
+         //Time period to reach wMax, K = cubic_root((Wmax - cwnd) / C),
+         //with C = 0.4 and K expressed in milliseconds
+         context->k = tcpCubicRoot((uint64_t) (context->wMax - socket->cwnd) *
+            2500000000ULL / socket->mss);
+         context->originPoint = context->wMax;
+      }
+      else
+      {
+         context->k = 0;
+         context->originPoint = socket->cwnd;
+      }
+   }
+
+   //Time elapsed since the beginning of the epoch
+   elapsed = time - context->epochStart;
+
+   //Window expected one RTT later, W(t) = C * (t - K)^3 + Wmax
+   d = (int64_t) elapsed + rtt - context->k;
+   d = max(d, -1000000);
+   d = min(d, 1000000);
+   target = context->originPoint + (d * d * d / 1000000) * socket->mss / 2500;
+
+   //The window must not grow by more than half of its size per RTT
+   target = min(target, (int64_t) socket->cwnd + socket->cwnd / 2);
+
+   //Window that standard TCP would reach, W_est = Wmax * beta +
+   //3 * (1 - beta) / (1 + beta) * t / RTT, with beta = 0.7
+   wEst = context->wMax * 7 / 10 + (uint32_t) ((uint64_t) 9 * socket->mss * elapsed / (17 * rtt));
+
+   //CUBIC must be at least as aggressive as standard TCP
+   target = max(target, (int64_t) wEst);
+
+   //cwnd grows by (target - cwnd) / cwnd for each acknowledged segment
+   if(target > socket->cwnd)
+   {
+      //Amount of increase, with the remainder kept for the next ACK
+      inc = context->accumulator + (uint64_t) (target - socket->cwnd) * n;
+      socket->cwnd += (uint32_t) (inc / socket->cwnd);
+      context->accumulator = (uint32_t) (inc % socket->cwnd);
+   }
+}
+
+
+/**
+ * @brief CUBIC reaction to a loss
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void tcpCubicLossDetected(Socket *socket)
+{
+   //Point to the CUBIC state
+   TcpCubicContext *context = &socket->cubic;
+
+   //Fast convergence: release bandwidth when the window is still
+   //below the size where the previous reduction occurred
+   if(socket->cwnd < context->wMax)
+      context->wMax = socket->cwnd * 17 / 20;
+   else
+      context->wMax = socket->cwnd;
+
+   //Multiplicative decrease with beta = 0.7
+   socket->ssthresh = max(socket->cwnd * 7 / 10, 2 * socket->mss);
+   //Start a new epoch
+   context->epochStart = 0;
+}
+
+
+/**
+ * @brief CUBIC reaction to a retransmission timeout
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void tcpCubicTimeout(Socket *socket)
+{
+   //The window collapses to the loss window
+   tcpNewRenoTimeout(socket);
+   //Start a new epoch
+   socket->cubic.epochStart = 0;
+}
+
+
+/**
+ * @brief CUBIC restart after an idle period
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void tcpCubicIdleRestart(Socket *socket)
+{
+   //Apply the restart window
+   tcpNewRenoIdleRestart(socket);
+   //The cubic function must not account for the idle period
+   socket->cubic.epochStart = 0;
+}
+
+
+/**
+ * @brief Integer cube root
+ * @param[in] x Input value
+ * @return Largest integer whose cube does not exceed x
+ **/
+
+static uint32_t tcpCubicRoot(uint64_t x)
+{
+   int_t s;
+   uint64_t b;
+   uint64_t y = 0;
+
+   //Compute one bit of the result at a time
+   for(s = 63; s >= 0; s -= 3)
+   {
+      y <<= 1;
+      b = 3 * y * (y + 1) + 1;
+
+      if((x >> s) >= b)
+      {
+         x -= b << s;
+         y++;
+      }
+   }
+
+   //Return the cube root
+   return (uint32_t) y;
+}
+
+#endif
+#endif
@@ -0,0 +1,383 @@
+/**
+ * @file tcp_fast_open.c
+ * @brief TCP Fast Open
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * TCP Fast Open allows data to be carried in the SYN and the SYN ACK
+ * segments, saving one round-trip on connections to servers that have
+ * been contacted before. The server hands out a cookie bound to the IP
+ * address of the client, which the client presents in later SYNs to
+ * have their data accepted. Refer to RFC 7413
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TCP_TRACE_LEVEL
+
+//Dependencies
+#include <stdlib.h>
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "socket.h"
+#include "tcp.h"
+#include "tcp_misc.h"
+#include "tcp_fast_open.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (TCP_SUPPORT == ENABLED && TCP_FAST_OPEN_SUPPORT == ENABLED)
+
+//Cookies obtained from the servers
+static TcpFastOpenCacheEntry tcpFastOpenCache[TCP_FAST_OPEN_CACHE_SIZE];
+//Secret key used to generate the cookies
+static uint32_t tcpFastOpenSecret[2];
+
+//TCP Fast Open helpers
+static TcpFastOpenCacheEntry *tcpFastOpenFindEntry(const IpAddr *serverIpAddr);
+static void tcpFastOpenGenerateCookie(const IpAddr *clientIpAddr, uint8_t *cookie);
+static uint32_t tcpFastOpenHash(uint32_t key, const IpAddr *ipAddr);
+
+
+/**
+ * @brief Prepare the Fast Open option of the SYN sent by a client
+ *
+ * The initial data is queued in the send buffer. It is carried by
+ * the SYN when a cookie has been obtained from the server, and sent
+ * once the connection is established otherwise
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] data Pointer to the initial data
+ * @param[in] length Length of the initial data
+ * @return Number of bytes to be carried by the SYN
+ **/
+
+size_t tcpFastOpenPrepareSyn(Socket *socket, const uint8_t *data, size_t length)
+{
+   size_t n;
+   TcpFastOpenCacheEntry *entry;
+
+   //The Fast Open option is sent in the SYN
+   socket->fastOpenFlag = TRUE;
+   socket->fastOpenCookieLength = 0;
+
+   //Look for a cookie previously obtained from the server
+   entry = tcpFastOpenFindEntry(&socket->remoteIpAddr);
+
+   //The data in the SYN must fit in one segment, option space aside
+   if(entry != NULL)
+      n = entry->mss - (TCP_MAX_HEADER_LENGTH - sizeof(TcpHeader));
+   else
+      n = TCP_DEFAULT_MSS - (TCP_MAX_HEADER_LENGTH - sizeof(TcpHeader));
+
+   //Limit the amount of initial data
+   n = min(n, length);
+   n = min(n, socket->txBufferSize);
+
+   //Copy the initial data to the send buffer
+   tcpWriteTxBuffer(socket, socket->iss + 1, data, n);
+
+   //No cookie available?
+   if(entry == NULL)
+   {
+      //Request a cookie with an empty option. The data will be sent
+      //after the handshake completes
+      socket->sndUser = n;
+      return 0;
+   }
+
+   //Present the cookie to the server
+   memcpy(socket->fastOpenCookie, entry->cookie, entry->cookieLength);
+   socket->fastOpenCookieLength = entry->cookieLength;
+   //Refresh the entry
+   entry->timestamp = osGetTickCount();
+
+   //The data is carried by the SYN
+   socket->sndNxt += n;
+   return n;
+}
+
+
+/**
+ * @brief Process the Fast Open option of the SYN ACK received by a client
+ * @param[in] socket Handle referencing the socket
+ * @param[in] segment Incoming SYN ACK segment
+ **/
+
+void tcpFastOpenProcessSynAck(Socket *socket, TcpHeader *segment)
+{
+   uint_t i;
+   time_t time;
+   TcpOption *option;
+   TcpFastOpenCacheEntry *entry;
+
+   //Get the Fast Open option
+   option = tcpGetOption(segment, TCP_OPTION_FAST_OPEN_COOKIE);
+
+   //The server has sent a new cookie?
+   if(option != NULL && option->length >= 6 &&
+      option->length <= (2 + TCP_FAST_OPEN_MAX_COOKIE_SIZE))
+   {
+      //Look for an existing entry
+      entry = tcpFastOpenFindEntry(&socket->remoteIpAddr);
+
+      //Otherwise, replace the least recently used entry
+      if(entry == NULL)
+      {
+         time = osGetTickCount();
+         entry = &tcpFastOpenCache[0];
+
+         for(i = 0; i < TCP_FAST_OPEN_CACHE_SIZE; i++)
+         {
+            //Unused entry?
+            if(!tcpFastOpenCache[i].cookieLength)
+            {
+               entry = &tcpFastOpenCache[i];
+               break;
+            }
+
+            //Keep track of the oldest entry
+            if(timeCompare(tcpFastOpenCache[i].timestamp, time) < 0)
+            {
+               time = tcpFastOpenCache[i].timestamp;
+               entry = &tcpFastOpenCache[i];
+            }
+         }
+      }
+
+      //Save the cookie and the MSS of the server
+      entry->serverIpAddr = socket->remoteIpAddr;
+      entry->mss = socket->mss;
+      entry->cookieLength = option->length - 2;
+      memcpy(entry->cookie, option->value, entry->cookieLength);
+      entry->timestamp = osGetTickCount();
+   }
+
+   //The data carried by the SYN has not been acknowledged?
+   if(socket->sndNxt != socket->sndUna)
+   {
+      //The data is sent again once the connection is established
+      socket->sndUser += socket->sndNxt - socket->sndUna;
+      socket->sndNxt = socket->sndUna;
+      //Forget about the SYN
+      tcpFlushRetransmitQueue(socket);
+      socket->rttBusy = FALSE;
+   }
+
+   //The option is only sent in the SYN
+   socket->fastOpenFlag = FALSE;
+}
+
+
+/**
+ * @brief Process the Fast Open option of a SYN received by a server
+ * @param[in] socket Handle referencing the listening socket
+ * @param[in] queueItem SYN queue entry
+ * @param[in] segment Incoming SYN segment
+ * @param[in] buffer Multi-part buffer containing the incoming segment
+ * @param[in] offset Offset to the first data byte
+ * @param[in] length Length of the segment data
+ **/
+
+void tcpFastOpenProcessSyn(Socket *socket, TcpSynQueueItem *queueItem,
+   TcpHeader *segment, const ChunkedBuffer *buffer, size_t offset, size_t length)
+{
+   TcpOption *option;
+   uint8_t cookie[TCP_FAST_OPEN_COOKIE_SIZE];
+
+   //Get the Fast Open option
+   option = tcpGetOption(segment, TCP_OPTION_FAST_OPEN_COOKIE);
+   //The client does not use Fast Open?
+   if(option == NULL)
+      return;
+
+   //Compute the cookie expected from the client
+   tcpFastOpenGenerateCookie(&queueItem->srcAddr, cookie);
+
+   //Valid cookie?
+   if(option->length == (2 + TCP_FAST_OPEN_COOKIE_SIZE) &&
+      !memcmp(option->value, cookie, TCP_FAST_OPEN_COOKIE_SIZE))
+   {
+      //The data carried by the SYN is kept until the connection is
+      //accepted. Otherwise, the client will send it again later
+      if(length > 0 && length <= socket->rxBufferSize)
+         queueItem->fastOpenData = chunkedBufferClone(buffer, offset, length);
+   }
+   else
+   {
+      //Cookie request or invalid cookie. A valid cookie is sent in the
+      //SYN ACK and the data, if any, is ignored
+      queueItem->fastOpenCookieFlag = TRUE;
+   }
+}
+
+
+/**
+ * @brief Complete the Fast Open processing of an accepted connection
+ * @param[in] newSocket Handle referencing the new connection
+ * @param[in] queueItem SYN queue entry
+ **/
+
+void tcpFastOpenAccept(Socket *newSocket, TcpSynQueueItem *queueItem)
+{
+   size_t n;
+
+   //The client asked for a cookie?
+   if(queueItem->fastOpenCookieFlag)
+   {
+      //The cookie is sent in the SYN ACK
+      tcpFastOpenGenerateCookie(&newSocket->remoteIpAddr, newSocket->fastOpenCookie);
+      newSocket->fastOpenCookieLength = TCP_FAST_OPEN_COOKIE_SIZE;
+      newSocket->fastOpenFlag = TRUE;
+   }
+
+   //No data has been carried by the SYN?
+   if(queueItem->fastOpenData == NULL)
+      return;
+
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+   //The receive buffer must be allocated before the data is stored.
+   //Otherwise, the client will send the data again later
+   if(tcpAllocRxBuffer(newSocket))
+      return;
+#endif
+
+   //Length of the data
+   n = chunkedBufferGetLength(queueItem->fastOpenData);
+
+   //Store the data in the receive buffer. It is acknowledged by the SYN ACK
+   tcpWriteRxBuffer(newSocket, newSocket->rcvNxt, queueItem->fastOpenData, 0, n);
+   newSocket->rcvNxt += n;
+   newSocket->rcvUser += n;
+   newSocket->rcvWnd -= n;
+
+   //The server may respond before the handshake completes, within
+   //the window advertised by the SYN (which is never scaled)
+   newSocket->sndWnd = queueItem->wnd;
+   newSocket->maxSndWnd = queueItem->wnd;
+   newSocket->sndWl1 = newSocket->irs;
+   newSocket->sndWl2 = newSocket->iss;
+   newSocket->fastOpenDataFlag = TRUE;
+}
+
+
+/**
+ * @brief Find the cached cookie of a server
+ * @param[in] serverIpAddr IP address of the server
+ * @return Pointer to the matching entry, or NULL if there is none
+ **/
+
+static TcpFastOpenCacheEntry *tcpFastOpenFindEntry(const IpAddr *serverIpAddr)
+{
+   uint_t i;
+   TcpFastOpenCacheEntry *entry;
+
+   //Loop through the cache
+   for(i = 0; i < TCP_FAST_OPEN_CACHE_SIZE; i++)
+   {
+      //Point to the current entry
+      entry = &tcpFastOpenCache[i];
+
+      //Skip unused entries
+      if(!entry->cookieLength)
+         continue;
+      //Check the IP address of the server
+      if(entry->serverIpAddr.length != serverIpAddr->length)
+         continue;
+      if(memcmp(&entry->serverIpAddr.ipv4Addr, &serverIpAddr->ipv4Addr, serverIpAddr->length))
+         continue;
+
+      //A matching entry has been found
+      return entry;
+   }
+
+   //No cookie for this server
+   return NULL;
+}
+
+
+/**
+ * @brief Generate the cookie of a client
+ * @param[in] clientIpAddr IP address of the client
+ * @param[out] cookie Cookie of TCP_FAST_OPEN_COOKIE_SIZE bytes
+ **/
+
+static void tcpFastOpenGenerateCookie(const IpAddr *clientIpAddr, uint8_t *cookie)
+{
+   uint32_t value[2];
+
+   //Generate the secret key on first use
+   if(!tcpFastOpenSecret[0] && !tcpFastOpenSecret[1])
+   {
+      tcpFastOpenSecret[0] = ((uint32_t) rand() << 16) ^ rand() ^ osGetTickCount();
+      tcpFastOpenSecret[1] = ((uint32_t) rand() << 16) ^ rand();
+   }
+
+   //The cookie is a keyed hash of the client address
+   value[0] = tcpFastOpenHash(tcpFastOpenSecret[0], clientIpAddr);
+   value[1] = tcpFastOpenHash(tcpFastOpenSecret[1], clientIpAddr);
+
+   //Copy the resulting cookie
+   memcpy(cookie, value, TCP_FAST_OPEN_COOKIE_SIZE);
+}
+
+
+/**
+ * @brief Keyed hash of an IP address
+ * @param[in] key Secret key
+ * @param[in] ipAddr IP address
+ * @return Hash value
+ **/
+
+static uint32_t tcpFastOpenHash(uint32_t key, const IpAddr *ipAddr)
+{
+   uint_t i;
+   uint32_t h;
+   uint32_t x;
+
+   //Start with the secret key
+   h = key;
+
+   //Mix in each 32-bit word of the address
+   for(i = 0; i < ipAddr->length; i += 4)
+   {
+      memcpy(&x, (const uint8_t *) &ipAddr->ipv4Addr + i, 4);
+      h ^= x;
+      h *= 0x9E3779B1;
+      h ^= h >> 15;
+   }
+
+   //Final avalanche
+   h ^= key;
+   h *= 0x85EBCA6B;
+   h ^= h >> 13;
+   h *= 0xC2B2AE35;
+   h ^= h >> 16;
+
+   //Return the hash value
+   return h;
+}
+
+#endif
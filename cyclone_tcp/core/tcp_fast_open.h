@@ -0,0 +1,59 @@
+/**
+ * @file tcp_fast_open.h
+ * @brief TCP Fast Open
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _TCP_FAST_OPEN_H
+#define _TCP_FAST_OPEN_H
+
+//Dependencies
+#include "tcp.h"
+
+
+/**
+ * @brief Fast Open cookie obtained from a server
+ **/
+
+typedef struct
+{
+   IpAddr serverIpAddr;  ///<IP address of the server
+   uint16_t mss;         ///<MSS of the server
+   uint8_t cookie[TCP_FAST_OPEN_MAX_COOKIE_SIZE]; ///<Cookie
+   uint_t cookieLength;  ///<Length of the cookie (0 if the entry is unused)
+   time_t timestamp;     ///<Time at which the entry was last used
+} TcpFastOpenCacheEntry;
+
+
+//TCP Fast Open related functions
+size_t tcpFastOpenPrepareSyn(Socket *socket, const uint8_t *data, size_t length);
+void tcpFastOpenProcessSynAck(Socket *socket, TcpHeader *segment);
+
+void tcpFastOpenProcessSyn(Socket *socket, TcpSynQueueItem *queueItem,
+   TcpHeader *segment, const ChunkedBuffer *buffer, size_t offset, size_t length);
+
+void tcpFastOpenAccept(Socket *newSocket, TcpSynQueueItem *queueItem);
+
+#endif
@@ -49,11 +49,20 @@
 #include "tcp.h"
 #include "tcp_fsm.h"
 #include "tcp_misc.h"
+#include "tcp_timer.h"
+#include "tcp_syn_cookie.h"
+#include "tcp_time_wait.h"
+#include "tcp_fast_open.h"
+#include "probe.h"
 #include "debug.h"
 
 //Check TCP/IP stack configuration
 #if (TCP_SUPPORT == ENABLED)
 
+//SYN queue helper
+static error_t tcpInitSynQueueItem(TcpSynQueueItem *queueItem,
+   NetInterface *interface, IpPseudoHeader *pseudoHeader, TcpHeader *segment);
+
 
 /**
  * @brief Incoming TCP segment processing
@@ -66,12 +75,16 @@
 void tcpProcessSegment(NetInterface *interface,
    IpPseudoHeader *pseudoHeader, const ChunkedBuffer *buffer, size_t offset)
 {
-   uint_t i;
    size_t length;
    Socket *socket;
-   Socket *passiveSocket;
    TcpHeader *segment;
 
+   //Instrumentation point
+   PROBE_ENTER(PROBE_TCP_PROCESS_SEGMENT);
+
+   //Update TCP statistics
+   TCP_MIB_INC(tcpInSegs);
+
    //A TCP implementation must silently discard an incoming
    //segment that is addressed to a broadcast or multicast
    //address (see RFC 1122 4.2.3.10)
@@ -114,6 +127,8 @@ void tcpProcessSegment(NetInterface *interface,
    {
       //Debug message
       TRACE_WARNING("TCP segment length is invalid!\r\n");
+      //Update TCP statistics
+      TCP_MIB_INC(tcpInErrs);
       //Exit immediately
       return;
    }
@@ -122,116 +137,36 @@ void tcpProcessSegment(NetInterface *interface,
    {
       //Debug message
       TRACE_WARNING("TCP header length is invalid!\r\n");
+      //Update TCP statistics
+      TCP_MIB_INC(tcpInErrs);
       //Exit immediately
       return;
    }
-   //Verify TCP checksum
-   if(ipCalcUpperLayerChecksumEx(pseudoHeader->data,
-      pseudoHeader->length, buffer, offset, length) != 0xFFFF)
-   {
-      //Debug message
-      TRACE_WARNING("Wrong TCP header checksum!\r\n");
-      //Exit immediately
-      return;
-   }
-
    //Enter critical section
    osMutexAcquire(socketMutex);
 
-   //No matching socket in the LISTEN state for the moment
-   passiveSocket = NULL;
+   //Look for the connection the segment belongs to, or else for a
+   //socket listening on the destination port
+   socket = tcpLookupSocket(interface, pseudoHeader, segment);
 
-   //Look through opened sockets
-   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+   //Verify TCP checksum, unless the hardware already did it
+   if(!(interface->nicRxChecksumFlags & NIC_RX_CHECKSUM_PAYLOAD))
    {
-      //Point to the current socket
-      socket = socketTable + i;
-
-      //TCP socket found?
-      if(socket->type != SOCKET_TYPE_STREAM)
-         continue;
-      //Check whether the socket is bound to a particular interface
-      if(socket->interface && socket->interface != interface)
-         continue;
-      //Check destination port number
-      if(socket->localPort != ntohs(segment->destPort))
-         continue;
-
-#if (IPV4_SUPPORT == ENABLED)
-      //An IPv4 packet was received?
-      if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
+      //In-order data may be copied to the receive buffer at the same time
+      if(tcpVerifyChecksum(socket, pseudoHeader, buffer, offset, length))
       {
-         //Destination IP address filtering
-         if(socket->localIpAddr.length)
-         {
-            //An IPv4 address is expected
-            if(socket->localIpAddr.length != sizeof(Ipv4Addr))
-               continue;
-            //Filter out non-matching addresses
-            if(socket->localIpAddr.ipv4Addr != pseudoHeader->ipv4Data.destAddr)
-               continue;
-         }
-         //Source IP address filtering
-         if(socket->remoteIpAddr.length)
-         {
-            //An IPv4 address is expected
-            if(socket->remoteIpAddr.length != sizeof(Ipv4Addr))
-               continue;
-            //Filter out non-matching addresses
-            if(socket->remoteIpAddr.ipv4Addr != pseudoHeader->ipv4Data.srcAddr)
-               continue;
-         }
-      }
-      else
-#endif
-#if (IPV6_SUPPORT == ENABLED)
-      //An IPv6 packet was received?
-      if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
-      {
-         //Destination IP address filtering
-         if(socket->localIpAddr.length)
-         {
-            //An IPv6 address is expected
-            if(socket->localIpAddr.length != sizeof(Ipv6Addr))
-               continue;
-            //Filter out non-matching addresses
-            if(!ipv6CompAddr(&socket->localIpAddr.ipv6Addr, &pseudoHeader->ipv6Data.destAddr))
-               continue;
-         }
-         //Source IP address filtering
-         if(socket->remoteIpAddr.length)
-         {
-            //An IPv6 address is expected
-            if(socket->remoteIpAddr.length != sizeof(Ipv6Addr))
-               continue;
-            //Filter out non-matching addresses
-            if(!ipv6CompAddr(&socket->remoteIpAddr.ipv6Addr, &pseudoHeader->ipv6Data.srcAddr))
-               continue;
-         }
-      }
-      else
-#endif
-      //An invalid packet was received?
-      {
-         //This should never occur...
-         continue;
+         //Leave critical section
+         osMutexRelease(socketMutex);
+         //Debug message
+         TRACE_WARNING("Wrong TCP header checksum!\r\n");
+         //Update TCP statistics
+         TCP_MIB_INC(tcpInErrs);
+         TCP_MIB_INC(tcpInCsumErrors);
+         //Exit immediately
+         return;
       }
-
-      //Keep track of the first matching socket in the LISTEN state
-      if(socket->state == TCP_STATE_LISTEN && !passiveSocket)
-         passiveSocket = socket;
-      //Source port filtering
-      if(socket->remotePort != ntohs(segment->srcPort))
-         continue;
-
-      //A matching socket has been found
-      break;
    }
 
-   //If no matching socket has been found then try to
-   //use the first matching socket in the LISTEN state
-   if(i >= SOCKET_MAX_COUNT) socket = passiveSocket;
-
    //Offset to the first data byte
    offset += segment->dataOffset * 4;
    //Calculate the length of the data
@@ -255,6 +190,21 @@ void tcpProcessSegment(NetInterface *interface,
    segment->window = ntohs(segment->window);
    segment->urgentPointer = ntohs(segment->urgentPointer);
 
+#if (TCP_COMPACT_TIME_WAIT_SUPPORT == ENABLED)
+   //The segment may belong to a connection in the compact TIME-WAIT state
+   if(!socket || socket->state == TCP_STATE_LISTEN)
+   {
+      //Process the segment on behalf of the connection
+      if(tcpProcessTimeWaitSegment(interface, pseudoHeader, segment, length))
+      {
+         //Leave critical section
+         osMutexRelease(socketMutex);
+         //Return immediately
+         return;
+      }
+   }
+#endif
+
    //Specified port is unreachable?
    if(!socket)
    {
@@ -268,6 +218,14 @@ void tcpProcessSegment(NetInterface *interface,
       return;
    }
 
+#if (TCP_INFO_SUPPORT == ENABLED)
+   //Number of segments received on this connection
+   socket->stats.segmentsIn++;
+   //Record the time at which data was last received
+   if(length > 0)
+      socket->stats.lastDataRecv = osGetTickCount();
+#endif
+
    //Check current state
    switch(socket->state)
    {
@@ -281,7 +239,7 @@ void tcpProcessSegment(NetInterface *interface,
    case TCP_STATE_LISTEN:
       //A device (normally a server) is waiting to receive a synchronize (SYN)
       //message from a client. It has not yet sent its own SYN message
-      tcpStateListen(socket, interface, pseudoHeader, segment, length);
+      tcpStateListen(socket, interface, pseudoHeader, segment, buffer, offset, length);
       break;
    //Process SYN_SENT state
    case TCP_STATE_SYN_SENT:
@@ -339,6 +297,8 @@ void tcpProcessSegment(NetInterface *interface,
       //for waiting to ensure the ACK is received and prevent potential overlap
       //with new connections
       tcpStateTimeWait(socket, segment, length);
+      //The socket may have been released
+      socket = NULL;
       break;
    //Invalid state...
    default:
@@ -348,6 +308,20 @@ void tcpProcessSegment(NetInterface *interface,
       break;
    }
 
+   //Data copied ahead of time only applies to the current segment
+   if(socket != NULL)
+      socket->rxPrecopied = 0;
+
+#if (TCP_COMPACT_TIME_WAIT_SUPPORT == ENABLED)
+   //The connection has just entered the TIME-WAIT state after the user
+   //closed the socket?
+   if(socket != NULL && socket->state == TCP_STATE_TIME_WAIT && !socket->ownedFlag)
+   {
+      //Release the socket as soon as possible
+      tcpCompactTimeWait(socket);
+   }
+#endif
+
    //Leave critical section
    osMutexRelease(socketMutex);
 }
@@ -388,15 +362,20 @@ void tcpStateClosed(NetInterface *interface,
  * @param[in] interface Underlying network interface
  * @param[in] pseudoHeader TCP pseudo header
  * @param[in] segment Incoming TCP segment
+ * @param[in] buffer Multi-part buffer containing the incoming TCP segment
+ * @param[in] offset Offset to the first data byte
  * @param[in] length Length of the segment data
  **/
 
 void tcpStateListen(Socket *socket, NetInterface *interface,
-   IpPseudoHeader *pseudoHeader, TcpHeader *segment, size_t length)
+   IpPseudoHeader *pseudoHeader, TcpHeader *segment,
+   const ChunkedBuffer *buffer, size_t offset, size_t length)
 {
-   uint_t i;
    TcpOption *option;
    TcpSynQueueItem *queueItem;
+#if (TCP_SYN_COOKIE_SUPPORT == ENABLED)
+   uint16_t mss;
+#endif
 
    //Debug message
    TRACE_DEBUG("TCP FSM: LISTEN state\r\n");
@@ -405,10 +384,50 @@ void tcpStateListen(Socket *socket, NetInterface *interface,
    if(segment->flags & TCP_FLAG_RST)
       return;
 
+   //Look for a pending connection request from the same client
+   queueItem = tcpFindSynQueueItem(socket, interface, pseudoHeader, segment);
+
    //Any acknowledgment is bad if it arrives on a connection
    //still in the LISTEN state
    if(segment->flags & TCP_FLAG_ACK)
    {
+#if (TCP_SYN_COOKIE_SUPPORT == ENABLED)
+      //The handshake has already been completed with a SYN cookie?
+      if(queueItem != NULL && queueItem->cookieFlag)
+         return;
+
+      //Final ACK of a handshake that used a SYN cookie?
+      if(!(segment->flags & TCP_FLAG_SYN) &&
+         !tcpCheckSynCookie(interface, pseudoHeader, segment, &mss))
+      {
+         //Allocate an entry to hold the connection until it is accepted.
+         //If none is available, the ACK is dropped and the client will
+         //retransmit it along with its data
+         queueItem = tcpAllocSynQueueItem(socket);
+         if(!queueItem)
+            return;
+
+         //Save the addresses and the port number of the client
+         if(tcpInitSynQueueItem(queueItem, interface, pseudoHeader, segment))
+            return;
+
+         //The connection is already synchronized
+         queueItem->cookieFlag = TRUE;
+         queueItem->isn = segment->seqNum - 1;
+         queueItem->iss = segment->ackNum - 1;
+         queueItem->wnd = segment->window;
+         //MSS decoded from the cookie
+         queueItem->mss = max(mss, TCP_MIN_MSS);
+
+         //Add the connection to the queue
+         tcpAddSynQueueItem(socket, queueItem);
+         //Notify user that a connection request is pending
+         tcpUpdateEvents(socket);
+         //Return immediately
+         return;
+      }
+#endif
+
       //A reset segment should be formed for any arriving ACK-bearing segment
       tcpSendResetSegment(interface, pseudoHeader, segment, length);
       //Return immediately
@@ -418,79 +437,39 @@ void tcpStateListen(Socket *socket, NetInterface *interface,
    //Check the SYN bit
    if(segment->flags & TCP_FLAG_SYN)
    {
-      //The SYN queue is empty?
-      if(!socket->synQueue)
-      {
-         //Allocate memory to save incoming data
-         queueItem = memPoolAlloc(sizeof(TcpSynQueueItem));
-         //Add the newly created item to the queue
-         socket->synQueue = queueItem;
-      }
-      else
-      {
-         //Point to the very first item
-         queueItem = socket->synQueue;
-
-         //Reach the last item in the receive queue
-         for(i = 1; queueItem->next; i++)
-            queueItem = queueItem->next;
+      //Retransmitted SYN for a connection request that is already queued?
+      if(queueItem != NULL)
+         return;
 
-         //Make sure the receive queue is not full
-         if(i >= TCP_SYN_QUEUE_SIZE)
-            return;
+      //Get a free entry
+      queueItem = tcpAllocSynQueueItem(socket);
 
-         //Allocate memory to save incoming data
-         queueItem->next = memPoolAlloc(sizeof(TcpSynQueueItem));
-         //Point to the newly created item
-         queueItem = queueItem->next;
-      }
-
-      //Failed to allocate memory?
+      //The SYN queue is full?
       if(!queueItem)
-         return;
-
-#if (IPV4_SUPPORT == ENABLED)
-      //IPv4 is currently used?
-      if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
       {
-         //Save the source IPv4 address
-         queueItem->srcAddr.length = sizeof(Ipv4Addr);
-         queueItem->srcAddr.ipv4Addr = pseudoHeader->ipv4Data.srcAddr;
-         //Save the destination IPv4 address
-         queueItem->destAddr.length = sizeof(Ipv4Addr);
-         queueItem->destAddr.ipv4Addr = pseudoHeader->ipv4Data.destAddr;
-      }
-      else
+#if (TCP_SYN_COOKIE_SUPPORT == ENABLED)
+         //Answer with a SYN cookie rather than dropping the request
+         tcpSendSynCookie(socket, interface, pseudoHeader, segment);
 #endif
-#if (IPV6_SUPPORT == ENABLED)
-      //IPv6 is currently used?
-      if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
-      {
-         //Save the source IPv6 address
-         queueItem->srcAddr.length = sizeof(Ipv6Addr);
-         queueItem->srcAddr.ipv6Addr = pseudoHeader->ipv6Data.srcAddr;
-         //Save the destination IPv6 address
-         queueItem->destAddr.length = sizeof(Ipv6Addr);
-         queueItem->destAddr.ipv6Addr = pseudoHeader->ipv6Data.destAddr;
-      }
-      else
-#endif
-      //Invalid pseudo header?
-      {
-         //This should never occur...
+         //Return immediately
          return;
       }
 
-      //Initialize next field
-      queueItem->next = NULL;
-      //Underlying network interface
-      queueItem->interface = interface;
-      //Save the port number of the client
-      queueItem->srcPort = segment->srcPort;
+      //Save the addresses and the port number of the client
+      if(tcpInitSynQueueItem(queueItem, interface, pseudoHeader, segment))
+         return;
+
       //Save the initial sequence number
       queueItem->isn = segment->seqNum;
+      //Save the window advertised by the client (never scaled in a SYN)
+      queueItem->wnd = segment->window;
       //Default MSS value
       queueItem->mss = min(TCP_DEFAULT_MSS, TCP_MAX_MSS);
+      //Window scaling is not used unless the client offers it
+      queueItem->wndScaleFlag = FALSE;
+      queueItem->wndShift = 0;
+      //Selective acknowledgments are not used unless the client offers them
+      queueItem->sackPermitted = FALSE;
 
       //Get the maximum segment size
       option = tcpGetOption(segment, TCP_OPTION_MAX_SEGMENT_SIZE);
@@ -504,10 +483,57 @@ void tcpStateListen(Socket *socket, NetInterface *interface,
          //Debug message
          TRACE_DEBUG("Remote host MSS = %u\r\n", queueItem->mss);
          //Make sure that the MSS advertised by the peer is acceptable
-         queueItem->mss = min(queueItem->mss, TCP_MAX_MSS);
+         queueItem->mss = min(queueItem->mss, tcpGetMaxMss(interface, &queueItem->srcAddr));
          queueItem->mss = max(queueItem->mss, TCP_MIN_MSS);
       }
 
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+      //Get the window scale factor
+      option = tcpGetOption(segment, TCP_OPTION_WINDOW_SCALE_FACTOR);
+      //Specified option found?
+      if(option && option->length == 3)
+      {
+         //The client is willing to scale windows
+         queueItem->wndScaleFlag = TRUE;
+         //Shift counts greater than 14 must be treated as 14
+         queueItem->wndShift = min(option->value[0], TCP_MAX_WINDOW_SHIFT);
+      }
+#endif
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+      //The client is willing to receive selective acknowledgments?
+      if(tcpGetOption(segment, TCP_OPTION_SACK_PERMITTED) != NULL)
+         queueItem->sackPermitted = TRUE;
+#endif
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+      //Get the Timestamps option
+      option = tcpGetOption(segment, TCP_OPTION_TIMESTAMP);
+      //Specified option found?
+      if(option && option->length == 10)
+      {
+         //The client is willing to use timestamps
+         queueItem->tsFlag = TRUE;
+         //Save TSval
+         memcpy(&queueItem->tsVal, option->value, 4);
+         //Convert from network byte order to host byte order
+         queueItem->tsVal = ntohl(queueItem->tsVal);
+      }
+      else
+      {
+         //Timestamps are not used
+         queueItem->tsFlag = FALSE;
+      }
+#endif
+
+#if (TCP_FAST_OPEN_SUPPORT == ENABLED)
+      //Validate the Fast Open cookie and keep the data carried by the SYN
+      if(socket->fastOpenFlag)
+         tcpFastOpenProcessSyn(socket, queueItem, segment, buffer, offset, length);
+#endif
+
+      //Add the request to the queue
+      tcpAddSynQueueItem(socket, queueItem);
       //Notify user that a connection request is pending
       tcpUpdateEvents(socket);
 
@@ -517,6 +543,60 @@ void tcpStateListen(Socket *socket, NetInterface *interface,
 }
 
 
+/**
+ * @brief Save the addresses and the port number of a client
+ * @param[in] queueItem SYN queue entry
+ * @param[in] interface Underlying network interface
+ * @param[in] pseudoHeader TCP pseudo header
+ * @param[in] segment Incoming TCP segment
+ * @return Error code
+ **/
+
+static error_t tcpInitSynQueueItem(TcpSynQueueItem *queueItem,
+   NetInterface *interface, IpPseudoHeader *pseudoHeader, TcpHeader *segment)
+{
+#if (IPV4_SUPPORT == ENABLED)
+   //IPv4 is currently used?
+   if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
+   {
+      //Save the source IPv4 address
+      queueItem->srcAddr.length = sizeof(Ipv4Addr);
+      queueItem->srcAddr.ipv4Addr = pseudoHeader->ipv4Data.srcAddr;
+      //Save the destination IPv4 address
+      queueItem->destAddr.length = sizeof(Ipv4Addr);
+      queueItem->destAddr.ipv4Addr = pseudoHeader->ipv4Data.destAddr;
+   }
+   else
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 is currently used?
+   if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
+   {
+      //Save the source IPv6 address
+      queueItem->srcAddr.length = sizeof(Ipv6Addr);
+      queueItem->srcAddr.ipv6Addr = pseudoHeader->ipv6Data.srcAddr;
+      //Save the destination IPv6 address
+      queueItem->destAddr.length = sizeof(Ipv6Addr);
+      queueItem->destAddr.ipv6Addr = pseudoHeader->ipv6Data.destAddr;
+   }
+   else
+#endif
+   //Invalid pseudo header?
+   {
+      //This should never occur...
+      return ERROR_INVALID_ADDRESS;
+   }
+
+   //Underlying network interface
+   queueItem->interface = interface;
+   //Save the port number of the client
+   queueItem->srcPort = segment->srcPort;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief SYN-SENT state
  *
@@ -538,8 +618,10 @@ void tcpStateSynSent(Socket *socket, TcpHeader *segment, size_t length)
    //Check the ACK bit
    if(segment->flags & TCP_FLAG_ACK)
    {
-      //Make sure the acknowledgment number is valid
-      if(segment->ackNum != socket->sndNxt)
+      //Make sure the acknowledgment number is valid (SND.UNA < SEG.ACK =< SND.NXT).
+      //A Fast Open server may acknowledge the SYN but not the data it carries
+      if(TCP_CMP_SEQ(segment->ackNum, socket->sndUna) <= 0 ||
+         TCP_CMP_SEQ(segment->ackNum, socket->sndNxt) > 0)
       {
          //Send a reset segment unless the RST bit is set
          if(!(segment->flags & TCP_FLAG_RST))
@@ -574,6 +656,33 @@ void tcpStateSynSent(Socket *socket, TcpHeader *segment, size_t length)
       if(segment->flags & TCP_FLAG_ACK)
          socket->sndUna = segment->ackNum;
 
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+      //Get the Timestamps option
+      option = tcpGetOption(segment, TCP_OPTION_TIMESTAMP);
+      //Timestamps are used only if both sides send the option
+      if(socket->tsFlag && option && option->length == 10)
+      {
+         uint32_t tsEcr;
+
+         //Save TSval as TS.Recent
+         memcpy(&socket->tsRecent, option->value, 4);
+         socket->tsRecent = ntohl(socket->tsRecent);
+
+         //Retrieve TSecr
+         memcpy(&tsEcr, option->value + 4, 4);
+         tsEcr = ntohl(tsEcr);
+
+         //Take an RTT sample from the SYN ACK
+         if((segment->flags & TCP_FLAG_ACK) && tsEcr != 0)
+            tcpUpdateRto(socket, (uint32_t) osGetTickCount() - tsEcr);
+      }
+      else
+      {
+         //Timestamps are not in use
+         socket->tsFlag = FALSE;
+      }
+#endif
+
       //Compute retransmission timeout
       tcpComputeRto(socket);
 
@@ -593,18 +702,55 @@ void tcpStateSynSent(Socket *socket, TcpHeader *segment, size_t length)
          //Debug message
          TRACE_DEBUG("Remote host MSS = %u\r\n", socket->mss);
          //Make sure that the MSS advertised by the peer is acceptable
-         socket->mss = min(socket->mss, TCP_MAX_MSS);
+         socket->mss = min(socket->mss, tcpGetMaxMss(socket->interface, &socket->remoteIpAddr));
          socket->mss = max(socket->mss, TCP_MIN_MSS);
       }
 
-      //Initial congestion window
-      socket->cwnd = min(TCP_INITIAL_WINDOW * socket->mss, socket->txBufferSize);
-      //Slow start threshold should be set arbitrarily high
-      socket->ssthresh = UINT16_MAX;
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+      //Leave room for the Timestamps option in every segment
+      if(socket->tsFlag)
+         socket->mss -= TCP_TIMESTAMP_OVERHEAD;
+#endif
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+      //Selective acknowledgments are used only if both sides
+      //send the SACK Permitted option
+      if(tcpGetOption(segment, TCP_OPTION_SACK_PERMITTED) != NULL)
+         socket->sackPermitted = TRUE;
+      else
+         socket->sackPermitted = FALSE;
+#endif
+
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+      //Get the window scale factor
+      option = tcpGetOption(segment, TCP_OPTION_WINDOW_SCALE_FACTOR);
+      //Window scaling is enabled only if both sides send the option
+      if(socket->wndScaleFlag && option && option->length == 3)
+      {
+         //Shift counts greater than 14 must be treated as 14
+         socket->sndWndShift = min(option->value[0], TCP_MAX_WINDOW_SHIFT);
+      }
+      else
+      {
+         //Window scaling is not in use
+         socket->wndScaleFlag = FALSE;
+         socket->sndWndShift = 0;
+         socket->rcvWndShift = 0;
+      }
+#endif
+
+      //Initial congestion window and slow start threshold
+      socket->congestionAlgo->init(socket);
 
       //Check whether our SYN has been acknowledged (SND.UNA > ISS)
       if(TCP_CMP_SEQ(socket->sndUna, socket->iss) > 0)
       {
+#if (TCP_FAST_OPEN_SUPPORT == ENABLED)
+         //Save the cookie sent by the server and queue the data that the
+         //SYN could not deliver
+         if(socket->fastOpenFlag)
+            tcpFastOpenProcessSynAck(socket, segment);
+#endif
          //Update the send window before entering ESTABLISHED state (see RFC 1122 4.2.2.20)
          socket->sndWnd = segment->window;
          socket->sndWl1 = segment->seqNum;
@@ -615,6 +761,12 @@ void tcpStateSynSent(Socket *socket, TcpHeader *segment, size_t length)
          tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
          //Switch to the ESTABLISHED state
          tcpChangeState(socket, TCP_STATE_ESTABLISHED);
+
+#if (TCP_FAST_OPEN_SUPPORT == ENABLED)
+         //Send the initial data that has not been carried by the SYN
+         if(socket->sndUser > 0)
+            tcpNagleAlgo(socket);
+#endif
       }
       else
       {
@@ -667,8 +819,10 @@ void tcpStateSynReceived(Socket *socket, TcpHeader *segment,
    if(!(segment->flags & TCP_FLAG_ACK))
       return;
 
-   //Make sure the acknowledgment number is valid
-   if(segment->ackNum != socket->sndNxt)
+   //Make sure the acknowledgment number is valid (SND.UNA < SEG.ACK =< SND.NXT).
+   //A Fast Open server may already have sent data beyond its SYN
+   if(TCP_CMP_SEQ(segment->ackNum, socket->sndUna) <= 0 ||
+      TCP_CMP_SEQ(segment->ackNum, socket->sndNxt) > 0)
    {
       //If the segment acknowledgment is not acceptable,
       //form a reset segment and send it
@@ -678,11 +832,11 @@ void tcpStateSynReceived(Socket *socket, TcpHeader *segment,
    }
 
    //Update the send window before entering ESTABLISHED state (see RFC 1122 4.2.2.20)
-   socket->sndWnd = segment->window;
+   socket->sndWnd = tcpGetSendWindow(socket, segment);
    socket->sndWl1 = segment->seqNum;
    socket->sndWl2 = segment->ackNum;
    //Maximum send window it has seen so far on the connection
-   socket->maxSndWnd = segment->window;
+   socket->maxSndWnd = socket->sndWnd;
 
    //Enter ESTABLISHED state
    tcpChangeState(socket, TCP_STATE_ESTABLISHED);
@@ -710,6 +864,12 @@ void tcpStateEstablished(Socket *socket, TcpHeader *segment,
    //Debug message
    TRACE_DEBUG("TCP FSM: ESTABLISHED state\r\n");
 
+#if (TCP_HEADER_PREDICTION_SUPPORT == ENABLED)
+   //In-order data and pure ACKs take a shorter path
+   if(!tcpPredictHeader(socket, segment, buffer, offset, length))
+      return;
+#endif
+
    //First check sequence number
    if(tcpCheckSequenceNumber(socket, segment, length))
       return;
@@ -888,7 +1048,7 @@ void tcpStateFinWait1(Socket *socket, TcpHeader *segment,
    {
       //Start the FIN-WAIT-2 timer to prevent the connection
       //from staying in the FIN-WAIT-2 state forever
-      osTimerStart(&socket->finWait2Timer, TCP_FIN_WAIT_2_TIMER);
+      tcpStartTimer(socket, &socket->finWait2Timer, TCP_FIN_WAIT_2_TIMER);
       //enter FIN-WAIT-2 and continue processing in that state
       tcpChangeState(socket, TCP_STATE_FIN_WAIT_2);
    }
@@ -912,7 +1072,7 @@ void tcpStateFinWait1(Socket *socket, TcpHeader *segment,
          if(segment->ackNum == socket->sndNxt)
          {
             //Start the 2MSL timer
-            osTimerStart(&socket->timeWaitTimer , TCP_2MSL_TIMER);
+            tcpStartTimer(socket, &socket->timeWaitTimer, TCP_2MSL_TIMER);
             //Switch to the TIME-WAIT state
             tcpChangeState(socket, TCP_STATE_TIME_WAIT);
          }
@@ -980,7 +1140,7 @@ void tcpStateFinWait2(Socket *socket, TcpHeader *segment,
          //Send an acknowledgement for the FIN
          tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
          //Start the 2MSL timer
-         osTimerStart(&socket->timeWaitTimer , TCP_2MSL_TIMER);
+         tcpStartTimer(socket, &socket->timeWaitTimer, TCP_2MSL_TIMER);
          //Switch to the TIME_WAIT state
          tcpChangeState(socket, TCP_STATE_TIME_WAIT);
       }
@@ -1029,7 +1189,7 @@ void tcpStateClosing(Socket *socket, TcpHeader *segment, size_t length)
    if(segment->ackNum == socket->sndNxt)
    {
       //Start the 2MSL timer
-      osTimerStart(&socket->timeWaitTimer , TCP_2MSL_TIMER);
+      tcpStartTimer(socket, &socket->timeWaitTimer, TCP_2MSL_TIMER);
       //Switch to the TIME-WAIT state
       tcpChangeState(socket, TCP_STATE_TIME_WAIT);
    }
@@ -1070,7 +1230,7 @@ void tcpStateTimeWait(Socket *socket, TcpHeader *segment, size_t length)
          //Delete the TCB
          tcpDeleteControlBlock(socket);
          //Mark the socket as closed
-         socket->type = SOCKET_TYPE_UNUSED;
+         socketRelease(socket);
       }
 
       //Return immediately
@@ -1091,7 +1251,7 @@ void tcpStateTimeWait(Socket *socket, TcpHeader *segment, size_t length)
       //Send an acknowledgement for the FIN
       tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
       //Restart the 2MSL timer
-      osTimerStart(&socket->timeWaitTimer , TCP_2MSL_TIMER);
+      tcpStartTimer(socket, &socket->timeWaitTimer, TCP_2MSL_TIMER);
    }
 }
 
@@ -40,7 +40,8 @@ void tcpStateClosed(NetInterface *interface,
    IpPseudoHeader *pseudoHeader, TcpHeader *segment, size_t length);
 
 void tcpStateListen(Socket *socket, NetInterface *interface,
-   IpPseudoHeader *pseudoHeader, TcpHeader *segment, size_t length);
+   IpPseudoHeader *pseudoHeader, TcpHeader *segment,
+   const ChunkedBuffer *buffer, size_t offset, size_t length);
 
 void tcpStateSynSent(Socket *socket, TcpHeader *segment, size_t length);
 
@@ -33,6 +33,7 @@
 #include "tcp_ip_stack.h"
 #include "socket.h"
 #include "tcp_timer.h"
+#include "tcp_misc.h"
 #include "ethernet.h"
 #include "arp.h"
 #include "ipv4.h"
@@ -40,11 +41,50 @@
 #include "ipv6.h"
 #include "mld.h"
 #include "ndp.h"
+#include "slaac.h"
+#include "ip_route.h"
+#include "ip_pmtu.h"
+#include "dns_cache.h"
+#include "ip_frag.h"
 #include "debug.h"
 
+//Check configuration
+#if (TCP_IP_BARE_METAL_SUPPORT == ENABLED && TCP_SUPPORT == ENABLED && TCP_FAST_TIMER_SUPPORT == ENABLED)
+   #error TCP_FAST_TIMER_SUPPORT requires a dedicated task
+#endif
+
 //Global variables
 NetInterface netInterface[NET_INTERFACE_COUNT];
 
+#if (TCP_IP_SINGLE_TASK_SUPPORT == ENABLED)
+//Event shared by the NIC drivers, the timer service and the request queue
+static OsEvent *tcpIpStackEvent;
+//Requests posted by the application
+static OsQueue *tcpIpStackRequestQueue;
+#endif
+
+//Periodic operations
+static TcpIpStackPeriodicOp tcpIpStackPeriodicOps[] =
+{
+   {{NULL}, NIC_TICK_INTERVAL, nicTick},
+#if (IP_FRAG_SUPPORT == ENABLED)
+   {{NULL}, IP_FRAG_TICK_INTERVAL, ipFragTick},
+#endif
+#if (IPV4_SUPPORT == ENABLED)
+   {{NULL}, ARP_TICK_INTERVAL, arpTick},
+#endif
+#if (IPV4_SUPPORT == ENABLED && IGMP_SUPPORT == ENABLED)
+   {{NULL}, IGMP_TICK_INTERVAL, igmpTick},
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   {{NULL}, NDP_TICK_INTERVAL, ndpTick},
+   {{NULL}, NDP_TICK_INTERVAL, slaacTick},
+#endif
+#if (IPV6_SUPPORT == ENABLED && MLD_SUPPORT == ENABLED)
+   {{NULL}, MLD_TICK_INTERVAL, mldTick},
+#endif
+};
+
 
 /**
  * @brief TCP/IP stack initialization
@@ -79,12 +119,95 @@ error_t tcpIpStackInit(void)
    //Any error to report?
    if(error) return error;
 
+#if (NET_CAPTURE_SUPPORT == ENABLED)
+   //Packet capture initialization
+   error = netCaptureInit();
+   //Any error to report?
+   if(error) return error;
+#endif
+
+#if (IP_ROUTE_SUPPORT == ENABLED)
+   //Routing table initialization
+   error = ipRouteInit();
+   //Any error to report?
+   if(error) return error;
+#endif
+
+#if (IP_PMTU_SUPPORT == ENABLED)
+   //Path MTU cache initialization
+   error = ipPmtuInit();
+   //Any error to report?
+   if(error) return error;
+#endif
+
+#if (DNS_ASYNC_SUPPORT == ENABLED)
+   //DNS client initialization
+   error = dnsInit();
+   //Any error to report?
+   if(error) return error;
+#endif
+
+#if (DNS_CACHE_SUPPORT == ENABLED)
+   //DNS cache initialization
+   error = dnsCacheInit();
+   //Any error to report?
+   if(error) return error;
+#endif
+
+#if (TCP_IP_SINGLE_TASK_SUPPORT == ENABLED)
+   //Create the event that wakes up the stack task
+   tcpIpStackEvent = osEventCreateSingleWaiter(FALSE);
+   //Out of resources?
+   if(tcpIpStackEvent == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Create the queue of application requests
+   tcpIpStackRequestQueue = osQueueCreate(TCP_IP_REQUEST_QUEUE_SIZE, sizeof(TcpIpStackRequest));
+   //Out of resources?
+   if(tcpIpStackRequestQueue == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //The timer service wakes up the stack task through the same event
+   error = netTimerServiceInit(tcpIpStackEvent);
+#else
+   //Timer service initialization
+   error = netTimerServiceInit(NULL);
+#endif
+   //Any error to report?
+   if(error) return error;
+
+   //Schedule periodic operations
+   for(i = 0; i < arraysize(tcpIpStackPeriodicOps); i++)
+   {
+      netTimerServiceStart(&tcpIpStackPeriodicOps[i].timer, tcpIpStackPeriodicOps[i].interval,
+         tcpIpStackPeriodicHandler, &tcpIpStackPeriodicOps[i]);
+   }
+
+#if (TCP_SUPPORT == ENABLED)
+   //TCP timer initialization
+   error = tcpTimerInit();
+   //Any error to report?
+   if(error) return error;
+#endif
+
+#if (TCP_IP_BARE_METAL_SUPPORT == ENABLED)
+   //No task is created. The application calls tcpIpStackPoll from its
+   //main loop instead
+   task = NULL;
+#else
+#if (TCP_IP_SINGLE_TASK_SUPPORT == ENABLED)
+   //Create the task that handles incoming frames, timers and requests
+   task = osTaskCreate("TCP/IP Stack", tcpIpStackTask,
+      NULL, TCP_IP_RX_STACK_SIZE, TCP_IP_RX_PRIORITY);
+#else
    //Create task to handle periodic operations
    task = osTaskCreate("TCP/IP Stack (Tick)", tcpIpStackTickTask,
       NULL, TCP_IP_TICK_STACK_SIZE, TCP_IP_TICK_PRIORITY);
+#endif
    //Unable to create the task?
    if(task == OS_INVALID_HANDLE)
       return ERROR_OUT_OF_RESOURCES;
+#endif
 
    //The handle can be used for further referencing
    for(i = 0; i < NET_INTERFACE_COUNT; i++)
@@ -110,8 +233,23 @@ error_t tcpIpStackConfigInterface(NetInterface *interface)
    Ipv6Addr solicitedNodeAddr;
 #endif
 
+#if (NIC_STATIC_DRIVER_SUPPORT == ENABLED)
+   //The capabilities of the driver are still read from its table
+   if(interface->nicDriver == NULL)
+      interface->nicDriver = &NIC_STATIC_NAME(NIC_STATIC_DRIVER, Driver);
+#endif
+
+#if (PHY_STATIC_DRIVER_SUPPORT == ENABLED)
+   //Bind the PHY driver selected at compile time
+   if(interface->phyDriver == NULL)
+      interface->phyDriver = &NIC_STATIC_NAME(PHY_STATIC_DRIVER, PhyDriver);
+#endif
+
    //Disable Ethernet controller interrupts
-   interface->nicDriver->disableIrq(interface);
+   nicDriverDisableIrq(interface);
+
+   //The MTU is advertised by the driver
+   interface->mtu = interface->nicDriver->mtu;
 
    //Start of exception handling block
    do
@@ -127,9 +265,14 @@ error_t tcpIpStackConfigInterface(NetInterface *interface)
          break;
       }
 
+#if (TCP_IP_SINGLE_TASK_SUPPORT == ENABLED)
+      //The NIC driver wakes up the stack task directly
+      interface->nicRxEvent = tcpIpStackEvent;
+#else
       //Receive notifications when a Ethernet frame has been received,
       //or the link status has changed
-      interface->nicRxEvent = osEventCreate(FALSE, FALSE);
+      interface->nicRxEvent = osEventCreateSingleWaiter(FALSE);
+#endif
       //Out of resources?
       if(interface->nicRxEvent == OS_INVALID_HANDLE)
       {
@@ -140,7 +283,7 @@ error_t tcpIpStackConfigInterface(NetInterface *interface)
       }
 
       //Create a mutex to prevent simultaneous access to the NIC driver
-      interface->nicDriverMutex = osMutexCreate(FALSE);
+      interface->nicDriverMutex = osMutexCreateNamed(FALSE, "NicDriver");
       //Out of resources?
       if(interface->nicDriverMutex == OS_INVALID_HANDLE)
       {
@@ -150,8 +293,63 @@ error_t tcpIpStackConfigInterface(NetInterface *interface)
          break;
       }
 
+      //Drivers with independent TX and RX paths get a dedicated TX lock,
+      //so that sending does not wait for the RX task and vice versa
+      if(interface->nicDriver->splitTxRxLocking)
+         interface->nicTxMutex = osMutexCreateNamed(FALSE, "NicTx");
+      else
+         interface->nicTxMutex = interface->nicDriverMutex;
+
+      //Out of resources?
+      if(interface->nicTxMutex == OS_INVALID_HANDLE)
+      {
+         //Report an error
+         error = ERROR_OUT_OF_RESOURCES;
+         //Stop immediately
+         break;
+      }
+
+#if (NIC_TX_QUEUE_SUPPORT == ENABLED)
+      //Receive notifications when frames are added to the transmit queue
+      interface->nicTxQueueEvent = osEventCreateSingleWaiter(FALSE);
+      //Out of resources?
+      if(interface->nicTxQueueEvent == OS_INVALID_HANDLE)
+      {
+         //Report an error
+         error = ERROR_OUT_OF_RESOURCES;
+         //Stop immediately
+         break;
+      }
+
+#if (NIC_TX_QUEUE_BLOCKING == ENABLED)
+      //Receive notifications when room is made in the transmit queue
+      interface->nicTxQueueSpaceEvent = osEventCreate(FALSE, FALSE);
+      //Out of resources?
+      if(interface->nicTxQueueSpaceEvent == OS_INVALID_HANDLE)
+      {
+         //Report an error
+         error = ERROR_OUT_OF_RESOURCES;
+         //Stop immediately
+         break;
+      }
+#endif
+#endif
+
+#if (NIC_LOOPBACK_SUPPORT == ENABLED)
+      //Create a mutex to prevent simultaneous access to the loopback queue
+      interface->nicLoopbackMutex = osMutexCreate(FALSE);
+      //Out of resources?
+      if(interface->nicLoopbackMutex == OS_INVALID_HANDLE)
+      {
+         //Report an error
+         error = ERROR_OUT_OF_RESOURCES;
+         //Stop immediately
+         break;
+      }
+#endif
+
       //Ethernet controller configuration
-      error = interface->nicDriver->init(interface);
+      error = nicDriverInit(interface);
       //Any error to report?
       if(error) break;
 
@@ -160,6 +358,13 @@ error_t tcpIpStackConfigInterface(NetInterface *interface)
       //Any error to report?
       if(error) break;
 
+#if (IP_FRAG_SUPPORT == ENABLED)
+      //Reassembly queue initialization (shared by IPv4 and IPv6)
+      error = ipFragInit(interface);
+      //Any error to report?
+      if(error) break;
+#endif
+
 //IPv4 specific initialization
 #if (IPV4_SUPPORT == ENABLED)
       //Network layer initialization
@@ -219,13 +424,33 @@ error_t tcpIpStackConfigInterface(NetInterface *interface)
       if(error) break;
 #endif
 
+#if (TCP_IP_SINGLE_TASK_SUPPORT == ENABLED)
+      //Incoming frames are processed by the stack task
+      interface->rxTask = interface->tickTask;
+#else
       //Create a task to process incoming frames
       interface->rxTask = osTaskCreate("TCP/IP Stack (RX)", tcpIpStackRxTask,
          interface, TCP_IP_RX_STACK_SIZE, TCP_IP_RX_PRIORITY);
 
       //Unable to create the task?
       if(interface->rxTask == OS_INVALID_HANDLE)
+      {
+         //Report an error
+         error = ERROR_OUT_OF_RESOURCES;
+         //Stop immediately
+         break;
+      }
+#endif
+
+#if (NIC_TX_QUEUE_SUPPORT == ENABLED && TCP_IP_BARE_METAL_SUPPORT == DISABLED)
+      //Create a task to drain the transmit queue
+      interface->txTask = osTaskCreate("TCP/IP Stack (TX)", tcpIpStackTxTask,
+         interface, TCP_IP_TX_STACK_SIZE, TCP_IP_TX_PRIORITY);
+
+      //Unable to create the task?
+      if(interface->txTask == OS_INVALID_HANDLE)
          error = ERROR_OUT_OF_RESOURCES;
+#endif
 
       //End of exception handling block
    } while(0);
@@ -236,14 +461,27 @@ error_t tcpIpStackConfigInterface(NetInterface *interface)
       //Successful interface configuration
       interface->configured = TRUE;
       //Interrupts can be safely enabled
-      interface->nicDriver->enableIrq(interface);
+      nicDriverEnableIrq(interface);
    }
    else
    {
       //Clean up side effects before returning
       osEventClose(interface->nicTxEvent);
+#if (TCP_IP_SINGLE_TASK_SUPPORT == DISABLED)
       osEventClose(interface->nicRxEvent);
+#endif
       osMutexClose(interface->nicDriverMutex);
+      if(interface->nicTxMutex != interface->nicDriverMutex)
+         osMutexClose(interface->nicTxMutex);
+#if (NIC_TX_QUEUE_SUPPORT == ENABLED)
+      osEventClose(interface->nicTxQueueEvent);
+#if (NIC_TX_QUEUE_BLOCKING == ENABLED)
+      osEventClose(interface->nicTxQueueSpaceEvent);
+#endif
+#endif
+#if (NIC_LOOPBACK_SUPPORT == ENABLED)
+      osMutexClose(interface->nicLoopbackMutex);
+#endif
    }
 
    //Return status code
@@ -253,229 +491,276 @@ error_t tcpIpStackConfigInterface(NetInterface *interface)
 
 /**
  * @brief Task responsible for handling periodic operations
+ *
+ * The task sleeps until the next timer of the timer service expires,
+ * and then invokes the relevant callbacks
+ *
  **/
 
 void tcpIpStackTickTask(void *param)
+{
+   //Attach a private cache of free blocks to the current task
+   memPoolCacheRegister();
+
+   //Main loop
+   while(1)
+   {
+      //Wait for the next deadline
+      netTimerServiceWait();
+      //Invoke the callbacks of the expired timers
+      netTimerServiceRun();
+   }
+}
+
+
+/**
+ * @brief Timer service callback common to all periodic operations
+ * @param[in] param Pointer to the periodic operation
+ **/
+
+void tcpIpStackPeriodicHandler(void *param)
 {
    uint_t i;
+   TcpIpStackPeriodicOp *op;
 
-   //Initialize prescalers
-   uint_t nicTickPrescaler = 0;
-#if (IPV4_SUPPORT == ENABLED)
-   uint_t arpTickPrescaler = 0;
-#endif
-#if (IPV4_SUPPORT == ENABLED && IPV4_FRAG_SUPPORT == ENABLED)
-   uint_t ipv4FragTickPrescaler = 0;
-#endif
-#if (IPV4_SUPPORT == ENABLED && IGMP_SUPPORT == ENABLED)
-   uint_t igmpTickPrescaler = 0;
-#endif
-#if (IPV6_SUPPORT == ENABLED)
-   uint_t ndpTickPrescaler = 0;
-#endif
-#if (IPV6_SUPPORT == ENABLED && IPV6_FRAG_SUPPORT == ENABLED)
-   uint_t ipv6FragTickPrescaler = 0;
+   //Point to the periodic operation
+   op = (TcpIpStackPeriodicOp *) param;
+
+   //Loop through network interfaces
+   for(i = 0; i < NET_INTERFACE_COUNT; i++)
+   {
+      //Make sure the interface has been properly configured
+      if(netInterface[i].configured)
+         op->handler(&netInterface[i]);
+   }
+
+   //Schedule the next run
+   netTimerServiceStart(&op->timer, op->interval, tcpIpStackPeriodicHandler, op);
+}
+
+
+/**
+ * @brief Task in charge of processing incoming frames
+ * @param[in] param Underlying network interface
+ **/
+
+void tcpIpStackRxTask(void *param)
+{
+   //Point to the structure describing the network interface
+   NetInterface *interface = (NetInterface *) param;
+
+   //Attach a private cache of free blocks to the current task
+   memPoolCacheRegister();
+
+   //Main loop
+   while(1)
+   {
+      //Receive notifications when a Ethernet frame has been received,
+      //or the link status has changed
+      osEventWait(interface->nicRxEvent, INFINITE_DELAY);
+      //Handle incoming packets and link state changes
+      tcpIpStackProcessRxEvent(interface);
+   }
+}
+
+
+/**
+ * @brief Handle incoming packets and link state changes
+ * @param[in] interface Underlying network interface
+ **/
+
+void tcpIpStackProcessRxEvent(NetInterface *interface)
+{
+#if (TCP_SUPPORT == ENABLED)
+   //The readers are woken once for all the segments drained below
+   tcpBeginRxBatch();
 #endif
-#if (IPV6_SUPPORT == ENABLED && MLD_SUPPORT == ENABLED)
-   uint_t mldTickPrescaler = 0;
+
+   //Get exclusive access to the device
+   osMutexAcquire(interface->nicDriverMutex);
+   //Disable Ethernet controller interrupts
+   nicDriverDisableIrq(interface);
+
+   //Handle incoming packets and link state changes
+   nicDriverRxEventHandler(interface);
+
+   //Re-enable Ethernet controller interrupts
+   nicDriverEnableIrq(interface);
+   //Release exclusive access to the device
+   osMutexRelease(interface->nicDriverMutex);
+
+#if (NIC_LOOPBACK_SUPPORT == ENABLED)
+   //Deliver the packets sent to the local host
+   nicProcessLoopbackQueue(interface);
 #endif
+
 #if (TCP_SUPPORT == ENABLED)
-   uint_t tcpTickPrescaler = 0;
+   //Notify the readers of the data received during the batch
+   tcpEndRxBatch();
 #endif
+}
+
+
+#if (TCP_IP_SINGLE_TASK_SUPPORT == ENABLED)
+
+/**
+ * @brief Stack task (single task mode)
+ *
+ * A single event loop handles incoming frames for all the interfaces,
+ * the timer service and the requests posted by the application, hence
+ * no context switch between RX and timer processing
+ *
+ * @param[in] param Unused parameter
+ **/
+
+void tcpIpStackTask(void *param)
+{
+   uint_t i;
+   TcpIpStackRequest request;
+
+   //Attach a private cache of free blocks to the current task
+   memPoolCacheRegister();
 
    //Main loop
    while(1)
    {
-      //Wait for the TCP/IP stack tick interval
-      osDelay(TCP_IP_TICK_INTERVAL);
+      //Wait for a NIC event, a request or the next timer deadline
+      netTimerServiceWait();
 
-      //Update prescaler
-      nicTickPrescaler += TCP_IP_TICK_INTERVAL;
-
-      //Handle periodic operations such as polling the link state
-      if(nicTickPrescaler >= NIC_TICK_INTERVAL)
+      //Loop through network interfaces
+      for(i = 0; i < NET_INTERFACE_COUNT; i++)
       {
-         //Loop through network interfaces
-         for(i = 0; i < NET_INTERFACE_COUNT; i++)
-         {
-            //Make sure the interface has been properly configured
-            if(netInterface[i].configured)
-               nicTick(&netInterface[i]);
-         }
-
-         //Clear prescaler
-         nicTickPrescaler = 0;
+         //The event does not tell which interface needs servicing,
+         //so every configured interface is polled
+         if(netInterface[i].configured)
+            tcpIpStackProcessRxEvent(&netInterface[i]);
       }
 
-#if (IPV4_SUPPORT == ENABLED)
-      //Update prescaler
-      arpTickPrescaler += TCP_IP_TICK_INTERVAL;
+      //Process the pending requests
+      while(osQueueReceive(tcpIpStackRequestQueue, &request, 0))
+         request.callback(request.param);
 
-      //Manage ARP cache
-      if(arpTickPrescaler >= ARP_TICK_INTERVAL)
-      {
-         //Loop through network interfaces
-         for(i = 0; i < NET_INTERFACE_COUNT; i++)
-         {
-            //Make sure the interface has been properly configured
-            if(netInterface[i].configured)
-               arpTick(&netInterface[i]);
-         }
-
-         //Clear prescaler
-         arpTickPrescaler = 0;
-      }
-#endif
+      //Invoke the callbacks of the expired timers
+      netTimerServiceRun();
+   }
+}
 
-#if (IPV4_SUPPORT == ENABLED && IPV4_FRAG_SUPPORT == ENABLED)
-      //Update prescaler
-      ipv4FragTickPrescaler += TCP_IP_TICK_INTERVAL;
 
-      //Handle IPv4 fragment reassembly timeout
-      if(ipv4FragTickPrescaler >= IPV4_FRAG_TICK_INTERVAL)
-      {
-         //Loop through network interfaces
-         for(i = 0; i < NET_INTERFACE_COUNT; i++)
-         {
-            //Make sure the interface has been properly configured
-            if(netInterface[i].configured)
-               ipv4FragTick(&netInterface[i]);
-         }
-
-         //Clear prescaler
-         ipv4FragTickPrescaler = 0;
-      }
-#endif
+/**
+ * @brief Run a function in the context of the stack task
+ *
+ * The callback is invoked by the stack task, serialized with the
+ * receive path and the timers. This function does not wait for the
+ * callback to complete
+ *
+ * @param[in] callback Function to be invoked
+ * @param[in] param Callback parameter
+ * @return Error code
+ **/
 
-#if (IPV4_SUPPORT == ENABLED && IGMP_SUPPORT == ENABLED)
-      //Update prescaler
-      igmpTickPrescaler += TCP_IP_TICK_INTERVAL;
+error_t tcpIpStackPostRequest(TcpIpStackRequestCallback callback, void *param)
+{
+   TcpIpStackRequest request;
 
-      //Handle IGMP related timers
-      if(igmpTickPrescaler >= IGMP_TICK_INTERVAL)
-      {
-         //Loop through network interfaces
-         for(i = 0; i < NET_INTERFACE_COUNT; i++)
-         {
-            //Make sure the interface has been properly configured
-            if(netInterface[i].configured)
-               igmpTick(&netInterface[i]);
-         }
-
-         //Clear prescaler
-         igmpTickPrescaler = 0;
-      }
-#endif
+   //Check parameters
+   if(!callback)
+      return ERROR_INVALID_PARAMETER;
 
-#if (IPV6_SUPPORT == ENABLED)
-      //Update prescaler
-      ndpTickPrescaler += TCP_IP_TICK_INTERVAL;
+   //Format request
+   request.callback = callback;
+   request.param = param;
 
-      //Manage Neighbor cache
-      if(ndpTickPrescaler >= NDP_TICK_INTERVAL)
-      {
-         //Loop through network interfaces
-         for(i = 0; i < NET_INTERFACE_COUNT; i++)
-         {
-            //Make sure the interface has been properly configured
-            if(netInterface[i].configured)
-               ndpTick(&netInterface[i]);
-         }
-
-         //Clear prescaler
-         ndpTickPrescaler = 0;
-      }
-#endif
+   //Queue the request
+   if(!osQueueSend(tcpIpStackRequestQueue, &request, 0))
+      return ERROR_WOULD_BLOCK;
 
-#if (IPV6_SUPPORT == ENABLED && IPV6_FRAG_SUPPORT == ENABLED)
-      //Update prescaler
-      ipv6FragTickPrescaler += TCP_IP_TICK_INTERVAL;
+   //Wake up the stack task
+   osEventSet(tcpIpStackEvent);
+
+   //Successful processing
+   return NO_ERROR;
+}
 
-      //Handle IPv4 fragment reassembly timeout
-      if(ipv6FragTickPrescaler >= IPV6_FRAG_TICK_INTERVAL)
-      {
-         //Loop through network interfaces
-         for(i = 0; i < NET_INTERFACE_COUNT; i++)
-         {
-            //Make sure the interface has been properly configured
-            if(netInterface[i].configured)
-               ipv6FragTick(&netInterface[i]);
-         }
-
-         //Clear prescaler
-         ipv6FragTickPrescaler = 0;
-      }
 #endif
 
-#if (IPV6_SUPPORT == ENABLED && MLD_SUPPORT == ENABLED)
-      //Update prescaler
-      mldTickPrescaler += TCP_IP_TICK_INTERVAL;
 
-      //Handle MLD related timers
-      if(mldTickPrescaler >= MLD_TICK_INTERVAL)
-      {
-         //Loop through network interfaces
-         for(i = 0; i < NET_INTERFACE_COUNT; i++)
-         {
-            //Make sure the interface has been properly configured
-            if(netInterface[i].configured)
-               mldTick(&netInterface[i]);
-         }
-
-         //Clear prescaler
-         mldTickPrescaler = 0;
-      }
-#endif
+#if (TCP_IP_BARE_METAL_SUPPORT == ENABLED)
 
-#if (TCP_SUPPORT == ENABLED)
-      //Update TCP tick prescaler
-      tcpTickPrescaler += TCP_IP_TICK_INTERVAL;
+/**
+ * @brief Run the TCP/IP stack from the application main loop
+ *
+ * This function never blocks. It handles the pending NIC events and
+ * requests, drains the transmit queues and invokes the callbacks of
+ * the expired timers. It must be called as often as possible
+ *
+ **/
+
+void tcpIpStackPoll(void)
+{
+   uint_t i;
+   TcpIpStackRequest request;
 
-      //Manage TCP related timers
-      if(tcpTickPrescaler >= TCP_TICK_INTERVAL)
+   //Any NIC event or request pending?
+   if(osEventWait(tcpIpStackEvent, 0))
+   {
+      //Loop through network interfaces
+      for(i = 0; i < NET_INTERFACE_COUNT; i++)
       {
-         //TCP timer handler
-         tcpTick();
-         //Clear prescaler
-         tcpTickPrescaler = 0;
+         //The event does not tell which interface needs servicing,
+         //so every configured interface is polled
+         if(netInterface[i].configured)
+            tcpIpStackProcessRxEvent(&netInterface[i]);
       }
-#endif
    }
+
+   //Process the pending requests
+   while(osQueueReceive(tcpIpStackRequestQueue, &request, 0))
+      request.callback(request.param);
+
+#if (NIC_TX_QUEUE_SUPPORT == ENABLED)
+   //Loop through network interfaces
+   for(i = 0; i < NET_INTERFACE_COUNT; i++)
+   {
+      //Send the frames queued since the last call
+      if(netInterface[i].configured && osEventWait(netInterface[i].nicTxQueueEvent, 0))
+         nicProcessTxQueue(&netInterface[i]);
+   }
+#endif
+
+   //Invoke the callbacks of the expired timers
+   netTimerServiceRun();
 }
 
+#endif
+
+
+#if (NIC_TX_QUEUE_SUPPORT == ENABLED)
 
 /**
- * @brief Task in charge of processing incoming frames
+ * @brief Task in charge of draining the transmit queue
  * @param[in] param Underlying network interface
  **/
 
-void tcpIpStackRxTask(void *param)
+void tcpIpStackTxTask(void *param)
 {
    //Point to the structure describing the network interface
    NetInterface *interface = (NetInterface *) param;
 
+   //Attach a private cache of free blocks to the current task
+   memPoolCacheRegister();
+
    //Main loop
    while(1)
    {
-      //Receive notifications when a Ethernet frame has been received,
-      //or the link status has changed
-      osEventWait(interface->nicRxEvent, INFINITE_DELAY);
-
-      //Get exclusive access to the device
-      osMutexAcquire(interface->nicDriverMutex);
-      //Disable Ethernet controller interrupts
-      interface->nicDriver->disableIrq(interface);
-
-      //Handle incoming packets and link state changes
-      interface->nicDriver->rxEventHandler(interface);
-
-      //Re-enable Ethernet controller interrupts
-      interface->nicDriver->enableIrq(interface);
-      //Release exclusive access to the device
-      osMutexRelease(interface->nicDriverMutex);
+      //Receive notifications when frames have been queued
+      osEventWait(interface->nicTxQueueEvent, INFINITE_DELAY);
+      //Send the pending frames as the transmitter becomes ready
+      nicProcessTxQueue(interface);
    }
 }
 
+#endif
+
 
 /**
  * @brief Get default network interface
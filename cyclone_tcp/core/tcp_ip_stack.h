@@ -33,6 +33,10 @@
 struct _NetInterface;
 #define NetInterface struct _NetInterface
 
+//Forward declaration of IpPathCache structure
+struct _IpPathCache;
+#define IpPathCache struct _IpPathCache
+
 #ifdef _WIN32
    #undef interface
 #endif
@@ -49,9 +53,14 @@ struct _NetInterface;
 #include "ipv4_frag.h"
 #include "ipv6.h"
 #include "ipv6_frag.h"
+#include "ip_frag.h"
 #include "arp.h"
 #include "ndp.h"
 #include "dns_client.h"
+#include "net_timer.h"
+#include "net_mib.h"
+#include "net_capture.h"
+#include "ip_forward.h"
 
 //Number of network adapters
 #ifndef NET_INTERFACE_COUNT
@@ -60,6 +69,39 @@ struct _NetInterface;
    #error NET_INTERFACE_COUNT parameter is invalid
 #endif
 
+//Largest MTU supported by the network interfaces
+#ifndef NET_INTERFACE_MAX_MTU
+   #define NET_INTERFACE_MAX_MTU 1500
+#elif (NET_INTERFACE_MAX_MTU < 1500)
+   #error NET_INTERFACE_MAX_MTU parameter is invalid
+#endif
+
+//Bare-metal mode (no RTOS, the application polls the stack)
+#ifndef TCP_IP_BARE_METAL_SUPPORT
+   #define TCP_IP_BARE_METAL_SUPPORT DISABLED
+#elif (TCP_IP_BARE_METAL_SUPPORT != ENABLED && TCP_IP_BARE_METAL_SUPPORT != DISABLED)
+   #error TCP_IP_BARE_METAL_SUPPORT parameter is invalid
+#endif
+
+//Single task mode (RX processing and timers handled by the same task)
+#ifndef TCP_IP_SINGLE_TASK_SUPPORT
+   #define TCP_IP_SINGLE_TASK_SUPPORT TCP_IP_BARE_METAL_SUPPORT
+#elif (TCP_IP_SINGLE_TASK_SUPPORT != ENABLED && TCP_IP_SINGLE_TASK_SUPPORT != DISABLED)
+   #error TCP_IP_SINGLE_TASK_SUPPORT parameter is invalid
+#endif
+
+//Bare-metal mode relies on the event loop of the single task mode
+#if (TCP_IP_BARE_METAL_SUPPORT == ENABLED && TCP_IP_SINGLE_TASK_SUPPORT == DISABLED)
+   #error TCP_IP_BARE_METAL_SUPPORT requires TCP_IP_SINGLE_TASK_SUPPORT
+#endif
+
+//Size of the queue of requests posted to the stack task
+#ifndef TCP_IP_REQUEST_QUEUE_SIZE
+   #define TCP_IP_REQUEST_QUEUE_SIZE 8
+#elif (TCP_IP_REQUEST_QUEUE_SIZE < 1)
+   #error TCP_IP_REQUEST_QUEUE_SIZE parameter is invalid
+#endif
+
 //Stack size required to run the TCP/IP tick task
 #ifndef TCP_IP_TICK_STACK_SIZE
    #define TCP_IP_TICK_STACK_SIZE 550
@@ -74,13 +116,6 @@ struct _NetInterface;
    #error TCP_IP_TICK_PRIORITY parameter is invalid
 #endif
 
-//TCP/IP stack tick interval
-#ifndef TCP_IP_TICK_INTERVAL
-   #define TCP_IP_TICK_INTERVAL 100
-#elif (TCP_IP_TICK_INTERVAL < 100)
-   #error TCP_IP_TICK_INTERVAL parameter is invalid
-#endif
-
 //Stack size required to run the TCP/IP RX task
 #ifndef TCP_IP_RX_STACK_SIZE
    #define TCP_IP_RX_STACK_SIZE 550
@@ -95,6 +130,20 @@ struct _NetInterface;
    #error TCP_IP_RX_PRIORITY parameter is invalid
 #endif
 
+//Stack size required to run the TCP/IP TX task
+#ifndef TCP_IP_TX_STACK_SIZE
+   #define TCP_IP_TX_STACK_SIZE 550
+#elif (TCP_IP_TX_STACK_SIZE < 1)
+   #error TCP_IP_TX_STACK_SIZE parameter is invalid
+#endif
+
+//Priority at which the TCP/IP TX task should run
+#ifndef TCP_IP_TX_PRIORITY
+   #define TCP_IP_TX_PRIORITY 2
+#elif (TCP_IP_TX_PRIORITY < 0)
+   #error TCP_IP_TX_PRIORITY parameter is invalid
+#endif
+
 
 /**
  * @brief Structure describing a network interface
@@ -108,14 +157,40 @@ struct _NetInterface
    OsMutex *macFilterMutex;                             ///<Mutex preventing simultaneous access to the MAC filter table
    MacFilterEntry macFilter[MAC_FILTER_MAX_SIZE];       ///<MAC filter table
    uint_t macFilterSize;                                ///<Number of entries in the MAC filter table
-   uint8_t ethFrame[1534 /*ETH_MAX_FRAME_SIZE*/];       ///<Incoming Ethernet frame
+   uint32_t macFilterHash[2];                           ///<Hash table of the multicast addresses to accept
+   MacFilterEntry *macFilterHashTable[MAC_FILTER_HASH_TABLE_SIZE]; ///<MAC filter entries indexed by address
+   uint8_t ethFrame[NET_INTERFACE_MAX_MTU + 34];        ///<Incoming Ethernet frame
    OsTask *tickTask;                                    ///<Handle to the task that manages periodic operations
    OsTask *rxTask;                                      ///<Handle to the task that handles incoming frames
+#if (NIC_TX_QUEUE_SUPPORT == ENABLED)
+   OsTask *txTask;                                      ///<Handle to the task that drains the transmit queue
+   OsEvent *nicTxQueueEvent;                            ///<Frames are pending in the transmit queue
+#if (NIC_TX_QUEUE_BLOCKING == ENABLED)
+   OsEvent *nicTxQueueSpaceEvent;                       ///<Room is available in the transmit queue
+#endif
+   ChunkedBuffer *nicTxQueue[NIC_TX_PRIORITY_COUNT][NIC_TX_QUEUE_SIZE]; ///<Software transmit queue (one ring per priority level)
+   uint_t nicTxQueueHead[NIC_TX_PRIORITY_COUNT];        ///<Index of the oldest frame of each priority level
+   uint_t nicTxQueueLength[NIC_TX_PRIORITY_COUNT];      ///<Number of frames queued at each priority level
+   uint_t nicTxQueueCount;                              ///<Total number of frames in the transmit queue
+#endif
    OsEvent *nicTxEvent;                                 ///<Network controller TX event
    OsEvent *nicRxEvent;                                 ///<Network controller RX event
    bool_t phyEvent;                                     ///<A PHY event is pending
    OsMutex *nicDriverMutex;                             ///<Mutex preventing simultaneous access to the NIC driver
+   OsMutex *nicTxMutex;                                 ///<Mutex serializing the transmit path of the NIC driver
+#if (NIC_TX_BATCH_SUPPORT == ENABLED)
+   OsTask *nicTxBatchOwner;                             ///<Task holding the transmitter for a train of frames
+#endif
    const NicDriver *nicDriver;                          ///<NIC driver
+   size_t mtu;                                          ///<Maximum transmission unit
+   uint_t nicRxChecksumFlags;                           ///<Checksums verified by the NIC for the incoming frame
+#if (NIC_LOOPBACK_SUPPORT == ENABLED)
+   OsMutex *nicLoopbackMutex;                           ///<Mutex preventing simultaneous access to the loopback queue
+   ChunkedBuffer *nicLoopbackQueue[NIC_LOOPBACK_QUEUE_SIZE]; ///<Packets sent to the local host
+   uint_t nicLoopbackQueueHead;                         ///<Index of the oldest packet in the loopback queue
+   uint_t nicLoopbackQueueCount;                        ///<Number of packets in the loopback queue
+   bool_t nicRxLoopback;                                ///<The incoming packet was sent by the local host
+#endif
    const PhyDriver *phyDriver;                          ///<PHY driver
    uint8_t nicContext[NIC_CONTEXT_SIZE];                ///<Driver specific context
    uint_t spiChipSelect;                                ///<SPI chip select
@@ -125,22 +200,40 @@ struct _NetInterface
    bool_t speed100;                                     ///<Link speed
    bool_t fullDuplex;                                   ///<Duplex mode
    bool_t configured;                                   ///<Configuration done
+   uint_t neighborCacheGen;                             ///<Bumped whenever a neighbor cache entry changes
+#if (NET_MIB_SUPPORT == ENABLED)
+   NetIfMib mib;                                        ///<Interface and IP statistics
+#endif
+#if (IP_FORWARD_SUPPORT == ENABLED)
+   bool_t ipForwarding;                                 ///<Packets addressed to other hosts are forwarded
+#endif
+
+#if (IP_FRAG_SUPPORT == ENABLED)
+   OsMutex *ipFragQueueMutex;                           ///<Mutex preventing simultaneous access to reassembly queue
+   IpFragDesc ipFragQueue[IP_MAX_FRAG_DATAGRAMS];       ///<IPv4 and IPv6 fragment reassembly queue
+   IpFragDesc *ipFragHashTable[IP_FRAG_HASH_TABLE_SIZE]; ///<Datagrams being reassembled, indexed by identification
+   size_t ipFragMemSize;                                ///<Memory held by the reassembly queue
+#endif
 
 #if (IPV4_SUPPORT == ENABLED)
    Ipv4Config ipv4Config;                               ///<IPv4 configuration
    uint16_t ipv4Identification;                         ///<IPv4 fragment identification field
-#if (IPV4_FRAG_SUPPORT == ENABLED)
-   OsMutex *ipv4FragQueueMutex;                         ///<Mutex preventing simultaneous access to reassembly queue
-   Ipv4FragDesc ipv4FragQueue[IPV4_MAX_FRAG_DATAGRAMS]; ///<IPv4 fragment reassembly queue
-#endif
    OsMutex *arpCacheMutex;                              ///<Mutex preventing simultaneous access to ARP cache
    ArpCacheEntry arpCache[ARP_CACHE_SIZE];              ///<ARP cache
+   ArpCacheEntry *arpHashTable[ARP_HASH_TABLE_SIZE];    ///<ARP cache entries indexed by IPv4 address
+   ArpCacheEntry *arpLruHead;                           ///<Most recently used ARP cache entry
+   ArpCacheEntry *arpLruTail;                           ///<Least recently used (or free) ARP cache entry
    OsMutex *ipv4FilterMutex;                            ///<Mutex preventing simultaneous access to the IPv4 filter table
    Ipv4FilterEntry ipv4Filter[IPV4_FILTER_MAX_SIZE];    ///<IPv4 filter table
    uint_t ipv4FilterSize;                               ///<Number of entries in the IPv4 filter table
+   Ipv4FilterEntry *ipv4FilterHashTable[IPV4_FILTER_HASH_TABLE_SIZE]; ///<IPv4 filter entries indexed by address
 #if (IGMP_SUPPORT == ENABLED)
    time_t igmpv1RouterPresentTimer;                     ///<IGMPv1 router present timer
    bool_t igmpv1RouterPresent;                          ///<An IGMPv1 query has been recently heard
+#if (IPV4_MULTICAST_FILTER_SUPPORT == ENABLED)
+   time_t igmpv2RouterPresentTimer;                     ///<IGMPv2 router present timer
+   bool_t igmpv2RouterPresent;                          ///<An IGMPv2 query has been recently heard
+#endif
 #endif
 #endif
 
@@ -148,18 +241,55 @@ struct _NetInterface
    Ipv6Config ipv6Config;                               ///<IPv6 configuration
 #if (IPV6_FRAG_SUPPORT == ENABLED)
    uint32_t ipv6Identification;                         ///<IPv6 Fragment identification field
-   OsMutex *ipv6FragQueueMutex;                         ///<Mutex preventing simultaneous access to reassembly queue
-   Ipv6FragDesc ipv6FragQueue[IPV6_MAX_FRAG_DATAGRAMS]; ///<IPv6 fragment reassembly queue
 #endif
    OsMutex *ndpCacheMutex;                              ///<Mutex preventing simultaneous access to Neighbor cache
    NdpCacheEntry ndpCache[NDP_CACHE_SIZE];              ///<Neighbor cache
+   NdpCacheEntry *ndpHashTable[NDP_HASH_TABLE_SIZE];    ///<Neighbor cache entries indexed by IPv6 address
+   NdpCacheEntry *ndpLruHead;                           ///<Most recently used Neighbor cache entry
+   NdpCacheEntry *ndpLruTail;                           ///<Least recently used (or free) Neighbor cache entry
+   NdpDestCacheEntry ndpDestCache[NDP_DEST_CACHE_SIZE]; ///<Destination cache
    OsMutex *ipv6FilterMutex;                            ///<Mutex preventing simultaneous access to the IPv6 filter table
    Ipv6FilterEntry ipv6Filter[IPV6_FILTER_MAX_SIZE];    ///<IPv6 filter table
    uint_t ipv6FilterSize;                               ///<Number of entries in the IPv6 filter table
+   Ipv6FilterEntry *ipv6FilterHashTable[IPV6_FILTER_HASH_TABLE_SIZE]; ///<IPv6 filter entries indexed by address
+#if (IPV6_MULTICAST_FILTER_SUPPORT == ENABLED)
+   time_t mldv1QuerierPresentTimer;                     ///<MLDv1 querier present timer
+   bool_t mldv1QuerierPresent;                          ///<An MLDv1 query has been recently heard
+#endif
 #endif
 };
 
 
+/**
+ * @brief Request callback
+ **/
+
+typedef void (*TcpIpStackRequestCallback)(void *param);
+
+
+/**
+ * @brief Request posted to the stack task
+ **/
+
+typedef struct
+{
+   TcpIpStackRequestCallback callback; ///<Function to be invoked by the stack task
+   void *param;                        ///<Callback parameter
+} TcpIpStackRequest;
+
+
+/**
+ * @brief Periodic operation driven by the timer service
+ **/
+
+typedef struct
+{
+   NetTimer timer;                           ///<Timer service entry
+   time_t interval;                          ///<Period, in milliseconds
+   void (*handler)(NetInterface *interface); ///<Function called for each configured interface
+} TcpIpStackPeriodicOp;
+
+
 //Network interfaces
 extern NetInterface netInterface[NET_INTERFACE_COUNT];
 
@@ -168,7 +298,18 @@ error_t tcpIpStackInit(void);
 error_t tcpIpStackConfigInterface(NetInterface *interface);
 
 void tcpIpStackTickTask(void *param);
+void tcpIpStackPeriodicHandler(void *param);
 void tcpIpStackRxTask(void *param);
+void tcpIpStackProcessRxEvent(NetInterface *interface);
+
+#if (TCP_IP_SINGLE_TASK_SUPPORT == ENABLED)
+void tcpIpStackTask(void *param);
+error_t tcpIpStackPostRequest(TcpIpStackRequestCallback callback, void *param);
+#endif
+#if (TCP_IP_BARE_METAL_SUPPORT == ENABLED)
+void tcpIpStackPoll(void);
+#endif
+void tcpIpStackTxTask(void *param);
 
 NetInterface *tcpIpStackGetDefaultInterface(void);
 
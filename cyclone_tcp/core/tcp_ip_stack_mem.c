@@ -43,18 +43,118 @@
    #define MAX_CHUNK_COUNT (N(IPV6_MAX_FRAG_DATAGRAM_SIZE) + 3)
 #endif
 
+//Number of spare descriptors reserved in addition to the requested length
+#define SPARE_CHUNK_COUNT 3
+
+//Size of the buffer descriptor that lies at the front of the first block
+#define CHUNK_DESC_AREA_SIZE(n) (sizeof(ChunkedBuffer) + (n) * sizeof(ChunkDesc))
+
 //Use fixed-size blocks allocation?
 #if (MEM_POOL_SUPPORT == ENABLED)
 
+/**
+ * @brief Size class of the memory pool
+ **/
+
+typedef struct
+{
+   uint8_t *pool;        ///<Memory blocks
+   size_t blockSize;     ///<Size of each block
+   uint_t blockCount;    ///<Number of blocks
+   bool_t *allocTable;   ///<Allocation table
+   uint_t *freeList;     ///<Stack of free block indexes
+   uint_t freeCount;     ///<Number of entries in the free list
+   uint_t inUse;         ///<Number of blocks taken from the free list
+   uint_t peakInUse;     ///<Highest number of blocks taken from the free list
+   uint_t allocCount;    ///<Number of successful allocations
+   uint_t allocFailures; ///<Number of failed allocations
+} MemPoolClass;
+
 //Mutex preventing simultaneous access to the memory pool
 static OsMutex *memPoolMutex;
+//Number of requests larger than the biggest block size
+static uint_t memPoolOversizedRequests;
+
+#if (MEM_POOL_SMALL_BUFFER_COUNT > 0)
+//Small blocks
+static uint8_t memPoolSmall[MEM_POOL_SMALL_BUFFER_COUNT][MEM_POOL_SMALL_BUFFER_SIZE];
+static bool_t memPoolSmallAllocTable[MEM_POOL_SMALL_BUFFER_COUNT];
+static uint_t memPoolSmallFreeList[MEM_POOL_SMALL_BUFFER_COUNT];
+#endif
+
+#if (MEM_POOL_MEDIUM_BUFFER_COUNT > 0)
+//Medium blocks
+static uint8_t memPoolMedium[MEM_POOL_MEDIUM_BUFFER_COUNT][MEM_POOL_MEDIUM_BUFFER_SIZE];
+static bool_t memPoolMediumAllocTable[MEM_POOL_MEDIUM_BUFFER_COUNT];
+static uint_t memPoolMediumFreeList[MEM_POOL_MEDIUM_BUFFER_COUNT];
+#endif
+
 //Memory pool
 static uint8_t memPool[MEM_POOL_BUFFER_COUNT][MEM_POOL_BUFFER_SIZE];
 //Allocation table
 static bool_t memPoolAllocTable[MEM_POOL_BUFFER_COUNT];
+//Stack of free block indexes
+static uint_t memPoolFreeList[MEM_POOL_BUFFER_COUNT];
+
+//Size classes, sorted by increasing block size
+static MemPoolClass memPoolClass[] =
+{
+#if (MEM_POOL_SMALL_BUFFER_COUNT > 0)
+   {memPoolSmall[0], MEM_POOL_SMALL_BUFFER_SIZE, MEM_POOL_SMALL_BUFFER_COUNT,
+      memPoolSmallAllocTable, memPoolSmallFreeList, 0, 0, 0, 0, 0},
+#endif
+#if (MEM_POOL_MEDIUM_BUFFER_COUNT > 0)
+   {memPoolMedium[0], MEM_POOL_MEDIUM_BUFFER_SIZE, MEM_POOL_MEDIUM_BUFFER_COUNT,
+      memPoolMediumAllocTable, memPoolMediumFreeList, 0, 0, 0, 0, 0},
+#endif
+   {memPool[0], MEM_POOL_BUFFER_SIZE, MEM_POOL_BUFFER_COUNT,
+      memPoolAllocTable, memPoolFreeList, 0, 0, 0, 0, 0}
+};
+
+//Number of size classes
+#define MEM_POOL_CLASS_COUNT arraysize(memPoolClass)
+
+//Check the number of size classes
+#if ((MEM_POOL_SMALL_BUFFER_COUNT > 0) + (MEM_POOL_MEDIUM_BUFFER_COUNT > 0) + 1) > MEM_POOL_MAX_CLASS_COUNT
+   #error MEM_POOL_MAX_CLASS_COUNT parameter is invalid
+#endif
+
+//Per-task caches?
+#if (MEM_POOL_CACHE_SUPPORT == ENABLED)
+
+/**
+ * @brief Per-task cache of free blocks
+ **/
+
+typedef struct
+{
+   OsTask *volatile owner;                                       ///<Task that owns the cache
+   uint_t count[MEM_POOL_CLASS_COUNT];                           ///<Number of cached blocks per size class
+   uint_t allocCount[MEM_POOL_CLASS_COUNT];                      ///<Number of allocations served by the cache
+   uint_t index[MEM_POOL_CLASS_COUNT][MEM_POOL_CACHE_SIZE];      ///<Indexes of the cached blocks
+} MemPoolCache;
+
+//Per-task caches
+static MemPoolCache memPoolCache[MEM_POOL_CACHE_COUNT];
 
 #endif
 
+//Memory pool related functions
+static void memPoolClassPush(MemPoolClass *sizeClass, uint_t index);
+static bool_t memPoolClassPop(MemPoolClass *sizeClass, uint_t *index);
+static void memPoolRecordFailure(size_t size);
+
+#if (MEM_POOL_CACHE_SUPPORT == ENABLED)
+   static MemPoolCache *memPoolCacheGet(void);
+#endif
+
+#endif
+
+//Chunk block management
+static ChunkedBuffer *chunkedBufferCreate(uint_t chunkCount, size_t length);
+static bool_t chunkedBufferExtend(ChunkedBuffer *buffer, uint_t chunkCount);
+static bool_t chunkIsExclusive(const ChunkedBuffer *buffer, const ChunkDesc *chunk);
+
 
 /**
  * @brief Memory pool initialization
@@ -65,14 +165,45 @@ error_t memPoolInit(void)
 {
 //Use fixed-size blocks allocation?
 #if (MEM_POOL_SUPPORT == ENABLED)
+   uint_t i;
+   uint_t j;
+   MemPoolClass *sizeClass;
+
    //Create a mutex to prevent simultaneous access to the memory pool
-   memPoolMutex = osMutexCreate(FALSE);
+   memPoolMutex = osMutexCreateNamed(FALSE, "MemPool");
    //Any error to report?
    if(memPoolMutex == OS_INVALID_HANDLE)
       return ERROR_OUT_OF_RESOURCES;
 
-   //Clear allocation table
-   memset(memPoolAllocTable, 0, sizeof(memPoolAllocTable));
+   //Loop through size classes
+   for(i = 0; i < MEM_POOL_CLASS_COUNT; i++)
+   {
+      //Point to the current size class
+      sizeClass = &memPoolClass[i];
+
+      //Clear allocation table
+      memset(sizeClass->allocTable, 0, sizeClass->blockCount * sizeof(bool_t));
+
+      //Initially, all the blocks are free
+      for(j = 0; j < sizeClass->blockCount; j++)
+         sizeClass->freeList[j] = sizeClass->blockCount - 1 - j;
+
+      //Number of free blocks
+      sizeClass->freeCount = sizeClass->blockCount;
+      //Clear statistics
+      sizeClass->inUse = 0;
+      sizeClass->peakInUse = 0;
+      sizeClass->allocCount = 0;
+      sizeClass->allocFailures = 0;
+   }
+
+   //Clear statistics
+   memPoolOversizedRequests = 0;
+
+#if (MEM_POOL_CACHE_SUPPORT == ENABLED)
+   //No task owns a cache for the moment
+   memset(memPoolCache, 0, sizeof(memPoolCache));
+#endif
 #endif
 
    //Successful initialization
@@ -90,6 +221,13 @@ void *memPoolAlloc(size_t size)
 {
 #if (MEM_POOL_SUPPORT == ENABLED)
    uint_t i;
+   uint_t j;
+   bool_t found;
+   MemPoolClass *sizeClass;
+#if (MEM_POOL_CACHE_SUPPORT == ENABLED)
+   uint_t k;
+   MemPoolCache *cache;
+#endif
 #endif
 
    //Pointer to the allocated memory block
@@ -100,30 +238,101 @@ void *memPoolAlloc(size_t size)
 
 //Use fixed-size blocks allocation?
 #if (MEM_POOL_SUPPORT == ENABLED)
-   //Acquire exclusive access to the memory pool
-   osMutexAcquire(memPoolMutex);
+#if (MEM_POOL_CACHE_SUPPORT == ENABLED)
+   //Retrieve the cache owned by the calling task, if any
+   cache = memPoolCacheGet();
 
-   //Enforce block size
-   if(size <= MEM_POOL_BUFFER_SIZE)
+   //The calling task owns a cache?
+   if(cache != NULL)
    {
-      //Loop through allocation table
-      for(i = 0; i < MEM_POOL_BUFFER_COUNT; i++)
+      //Loop through size classes
+      for(i = 0; i < MEM_POOL_CLASS_COUNT; i++)
       {
-         //Check whether the current block is free
-         if(!memPoolAllocTable[i])
+         //Skip size classes that are too small
+         if(size > memPoolClass[i].blockSize)
+            continue;
+
+         //The cache is empty?
+         if(!cache->count[i])
          {
-            //Mark the current entry as used
-            memPoolAllocTable[i] = TRUE;
+            //Acquire exclusive access to the memory pool
+            osMutexAcquire(memPoolMutex);
+
+            //Refill half of the cache in a single batch
+            for(k = 0; k < (MEM_POOL_CACHE_SIZE / 2); k++)
+            {
+               //Take a free block from the global pool
+               if(!memPoolClassPop(&memPoolClass[i], &j))
+                  break;
+
+               //Cached blocks are not held by the application
+               memPoolClass[i].allocTable[j] = FALSE;
+               //Add the block to the cache
+               cache->index[i][cache->count[i]++] = j;
+            }
+
+            //Release exclusive access to the memory pool
+            osMutexRelease(memPoolMutex);
+         }
+
+         //Any block available in the cache?
+         if(cache->count[i])
+         {
+            //Take the most recently cached block
+            j = cache->index[i][--cache->count[i]];
+            //The block is now held by the application
+            memPoolClass[i].allocTable[j] = TRUE;
+            //Update statistics
+            cache->allocCount[i]++;
             //Point to the corresponding memory block
-            p = memPool[i];
-            //Exit immediately
+            p = memPoolClass[i].pool + j * memPoolClass[i].blockSize;
+            //The request is satisfied without further locking
             break;
          }
       }
    }
+   else
+#endif
+   {
+      //Acquire exclusive access to the memory pool
+      osMutexAcquire(memPoolMutex);
 
-   //Release exclusive access to the memory pool
-   osMutexRelease(memPoolMutex);
+      //Use the smallest size class that can satisfy the request. Larger
+      //classes are used as a fallback when the best fit is exhausted
+      for(i = 0; i < MEM_POOL_CLASS_COUNT; i++)
+      {
+         //Point to the current size class
+         sizeClass = &memPoolClass[i];
+
+         //Enforce block size
+         if(size <= sizeClass->blockSize)
+         {
+            //Pop the index of a free block from the free list
+            found = memPoolClassPop(sizeClass, &j);
+
+            //Any free block available?
+            if(found)
+            {
+               //Update statistics
+               sizeClass->allocCount++;
+               //Point to the corresponding memory block
+               p = sizeClass->pool + j * sizeClass->blockSize;
+               //Exit immediately
+               break;
+            }
+         }
+      }
+
+      //Release exclusive access to the memory pool
+      osMutexRelease(memPoolMutex);
+   }
+
+   //Failed to allocate memory?
+   if(!p)
+   {
+      //Update statistics
+      memPoolRecordFailure(size);
+   }
 #else
    //Allocate a memory block
    p = osMemAlloc(size);
@@ -151,31 +360,429 @@ void memPoolFree(void *p)
 //Use fixed-size blocks allocation?
 #if (MEM_POOL_SUPPORT == ENABLED)
    uint_t i;
+   uint_t j;
+   size_t offset;
+   MemPoolClass *sizeClass;
+#if (MEM_POOL_CACHE_SUPPORT == ENABLED)
+   uint_t k;
+   MemPoolCache *cache;
+#endif
+
+   //Loop through size classes
+   for(i = 0; i < MEM_POOL_CLASS_COUNT; i++)
+   {
+      //Point to the current size class
+      sizeClass = &memPoolClass[i];
+
+      //Check whether the pointer refers to a block of the current class
+      if((uint8_t *) p >= sizeClass->pool &&
+         (uint8_t *) p < (sizeClass->pool + sizeClass->blockCount * sizeClass->blockSize))
+         break;
+   }
+
+   //The pointer does not belong to the memory pool?
+   if(i >= MEM_POOL_CLASS_COUNT)
+      return;
+
+   //Compute the offset of the block from the beginning of the pool
+   offset = (uint8_t *) p - sizeClass->pool;
+
+   //The pointer must match the start of a block
+   if(offset % sizeClass->blockSize)
+      return;
+
+   //Retrieve the index of the block
+   j = offset / sizeClass->blockSize;
+
+#if (MEM_POOL_CACHE_SUPPORT == ENABLED)
+   //Retrieve the cache owned by the calling task, if any
+   cache = memPoolCacheGet();
+
+   //The calling task owns a cache?
+   if(cache != NULL)
+   {
+      //Reject blocks that are already free or cached (double release)
+      if(!sizeClass->allocTable[j])
+         return;
+
+      //The block is no longer held by the application
+      sizeClass->allocTable[j] = FALSE;
+
+      //The cache is full?
+      if(cache->count[i] >= MEM_POOL_CACHE_SIZE)
+      {
+         //Acquire exclusive access to the memory pool
+         osMutexAcquire(memPoolMutex);
+
+         //Drain half of the cache in a single batch
+         for(k = 0; k < (MEM_POOL_CACHE_SIZE / 2); k++)
+            memPoolClassPush(sizeClass, cache->index[i][--cache->count[i]]);
+
+         //Release exclusive access to the memory pool
+         osMutexRelease(memPoolMutex);
+      }
+
+      //Keep the block in the cache for later reuse
+      cache->index[i][cache->count[i]++] = j;
+      //The block is released without further locking
+      return;
+   }
+#endif
+
+   //Acquire exclusive access to the memory pool
+   osMutexAcquire(memPoolMutex);
+
+   //Protect the free list against double release
+   if(sizeClass->allocTable[j])
+   {
+      //Mark the current block as free
+      sizeClass->allocTable[j] = FALSE;
+      //Return the block to the global pool
+      memPoolClassPush(sizeClass, j);
+   }
+
+   //Release exclusive access to the memory pool
+   osMutexRelease(memPoolMutex);
+#else
+   //Release memory block
+   osMemFree(p);
+#endif
+}
+
+
+//Use fixed-size blocks allocation?
+#if (MEM_POOL_SUPPORT == ENABLED)
+
+/**
+ * @brief Take a free block from a size class
+ * @param[in] sizeClass Size class
+ * @param[out] index Index of the block
+ * @return TRUE if a free block was available, else FALSE
+ **/
+
+static bool_t memPoolClassPop(MemPoolClass *sizeClass, uint_t *index)
+{
+   //No free block?
+   if(!sizeClass->freeCount)
+      return FALSE;
+
+   //Pop the index of a free block from the free list
+   *index = sizeClass->freeList[--sizeClass->freeCount];
+   //Mark the current entry as used
+   sizeClass->allocTable[*index] = TRUE;
+
+   //Keep track of the highest number of blocks in use
+   sizeClass->inUse++;
+   sizeClass->peakInUse = max(sizeClass->peakInUse, sizeClass->inUse);
+
+   //A free block has been found
+   return TRUE;
+}
+
+
+/**
+ * @brief Return a block to a size class
+ *
+ * The caller is responsible for checking that the block is neither free
+ * nor cached, and for clearing the corresponding allocation table entry
+ *
+ * @param[in] sizeClass Size class
+ * @param[in] index Index of the block
+ **/
+
+static void memPoolClassPush(MemPoolClass *sizeClass, uint_t index)
+{
+   //Push the index of the block onto the free list
+   sizeClass->freeList[sizeClass->freeCount++] = index;
+   //Update the number of blocks taken from the free list
+   sizeClass->inUse--;
+}
+
+
+/**
+ * @brief Record an allocation failure
+ * @param[in] size Requested size
+ **/
+
+static void memPoolRecordFailure(size_t size)
+{
+   uint_t i;
 
    //Acquire exclusive access to the memory pool
    osMutexAcquire(memPoolMutex);
 
-   //Loop through allocation table
-   for(i = 0; i < MEM_POOL_BUFFER_COUNT; i++)
+   //Find the best fit size class
+   for(i = 0; i < MEM_POOL_CLASS_COUNT; i++)
    {
-      if(memPool[i] == p)
+      if(size <= memPoolClass[i].blockSize)
+         break;
+   }
+
+   //Requests that do not fit in any block are counted separately
+   if(i < MEM_POOL_CLASS_COUNT)
+      memPoolClass[i].allocFailures++;
+   else
+      memPoolOversizedRequests++;
+
+   //Release exclusive access to the memory pool
+   osMutexRelease(memPoolMutex);
+}
+
+#endif
+
+
+/**
+ * @brief Attach a cache of free blocks to the calling task
+ *
+ * Once registered, the calling task allocates and releases blocks through
+ * its private cache. The global pool is only locked when the cache needs
+ * to be refilled or drained
+ *
+ * @return Error code
+ **/
+
+error_t memPoolCacheRegister(void)
+{
+#if (MEM_POOL_SUPPORT == ENABLED && MEM_POOL_CACHE_SUPPORT == ENABLED)
+   uint_t i;
+   OsTask *task;
+   error_t error;
+
+   //Get a handle to the calling task
+   task = osTaskGetHandle();
+   //The underlying RTOS cannot identify the calling task?
+   if(task == OS_INVALID_HANDLE)
+      return ERROR_NOT_IMPLEMENTED;
+
+   //The calling task already owns a cache?
+   if(memPoolCacheGet() != NULL)
+      return NO_ERROR;
+
+   //Initialize status code
+   error = ERROR_OUT_OF_RESOURCES;
+
+   //Acquire exclusive access to the memory pool
+   osMutexAcquire(memPoolMutex);
+
+   //Loop through the caches
+   for(i = 0; i < MEM_POOL_CACHE_COUNT; i++)
+   {
+      //Unused cache?
+      if(memPoolCache[i].owner == NULL)
       {
-         //Mark the current block as free
-         memPoolAllocTable[i] = FALSE;
-         //Exit immediately
+         //Initialize the cache before it becomes visible to its owner
+         memset(&memPoolCache[i], 0, sizeof(MemPoolCache));
+         MEM_POOL_MEMORY_BARRIER();
+         //Attach the cache to the calling task
+         memPoolCache[i].owner = task;
+         //Successful registration
+         error = NO_ERROR;
          break;
       }
    }
 
    //Release exclusive access to the memory pool
    osMutexRelease(memPoolMutex);
+
+   //Return status code
+   return error;
 #else
-   //Release memory block
-   osMemFree(p);
+   //Per-task caches are not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Detach the cache owned by the calling task
+ *
+ * Cached blocks are returned to the global pool. This function must be
+ * called before a registered task is deleted
+ *
+ **/
+
+void memPoolCacheUnregister(void)
+{
+#if (MEM_POOL_SUPPORT == ENABLED && MEM_POOL_CACHE_SUPPORT == ENABLED)
+   uint_t i;
+   MemPoolCache *cache;
+
+   //Retrieve the cache owned by the calling task
+   cache = memPoolCacheGet();
+   //No cache?
+   if(cache == NULL)
+      return;
+
+   //Acquire exclusive access to the memory pool
+   osMutexAcquire(memPoolMutex);
+
+   //Return all the cached blocks to the global pool
+   for(i = 0; i < MEM_POOL_CLASS_COUNT; i++)
+   {
+      while(cache->count[i] > 0)
+         memPoolClassPush(&memPoolClass[i], cache->index[i][--cache->count[i]]);
+   }
+
+   //The cache is now available
+   cache->owner = NULL;
+
+   //Release exclusive access to the memory pool
+   osMutexRelease(memPoolMutex);
+#endif
+}
+
+
+/**
+ * @brief Retrieve memory pool statistics
+ *
+ * Blocks held in per-task caches have been taken from the global pool and
+ * are therefore counted as in use. They are also reported as cached blocks
+ *
+ * @param[out] stats Pointer to the structure where to store the statistics
+ * @return Error code
+ **/
+
+error_t memPoolGetStats(MemPoolStats *stats)
+{
+#if (MEM_POOL_SUPPORT == ENABLED)
+   uint_t i;
+   MemPoolClass *sizeClass;
+#if (MEM_POOL_CACHE_SUPPORT == ENABLED)
+   uint_t j;
+#endif
+
+   //Check parameters
+   if(stats == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Clear statistics
+   memset(stats, 0, sizeof(MemPoolStats));
+
+   //Acquire exclusive access to the memory pool
+   osMutexAcquire(memPoolMutex);
+
+   //Number of size classes
+   stats->classCount = MEM_POOL_CLASS_COUNT;
+
+   //Loop through size classes
+   for(i = 0; i < MEM_POOL_CLASS_COUNT; i++)
+   {
+      //Point to the current size class
+      sizeClass = &memPoolClass[i];
+
+      //Save statistics
+      stats->sizeClass[i].blockSize = sizeClass->blockSize;
+      stats->sizeClass[i].blockCount = sizeClass->blockCount;
+      stats->sizeClass[i].inUse = sizeClass->inUse;
+      stats->sizeClass[i].peakInUse = sizeClass->peakInUse;
+      stats->sizeClass[i].allocCount = sizeClass->allocCount;
+      stats->sizeClass[i].allocFailures = sizeClass->allocFailures;
+
+#if (MEM_POOL_CACHE_SUPPORT == ENABLED)
+      //Take into account the blocks held in per-task caches
+      for(j = 0; j < MEM_POOL_CACHE_COUNT; j++)
+      {
+         if(memPoolCache[j].owner != NULL)
+         {
+            stats->sizeClass[i].cached += memPoolCache[j].count[i];
+            stats->sizeClass[i].allocCount += memPoolCache[j].allocCount[i];
+         }
+      }
+#endif
+   }
+
+   //Requests larger than the biggest block size
+   stats->oversizedRequests = memPoolOversizedRequests;
+
+   //Release exclusive access to the memory pool
+   osMutexRelease(memPoolMutex);
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Statistics are only available for fixed-size blocks allocation
+   return ERROR_NOT_IMPLEMENTED;
 #endif
 }
 
 
+/**
+ * @brief Reset memory pool statistics
+ *
+ * Peak usage is set back to the current usage and the counters are cleared
+ *
+ **/
+
+void memPoolResetStats(void)
+{
+#if (MEM_POOL_SUPPORT == ENABLED)
+   uint_t i;
+
+   //Acquire exclusive access to the memory pool
+   osMutexAcquire(memPoolMutex);
+
+   //Loop through size classes
+   for(i = 0; i < MEM_POOL_CLASS_COUNT; i++)
+   {
+      memPoolClass[i].peakInUse = memPoolClass[i].inUse;
+      memPoolClass[i].allocCount = 0;
+      memPoolClass[i].allocFailures = 0;
+   }
+
+#if (MEM_POOL_CACHE_SUPPORT == ENABLED)
+   //Clear the counters maintained by per-task caches
+   for(i = 0; i < MEM_POOL_CACHE_COUNT; i++)
+      memset(memPoolCache[i].allocCount, 0, sizeof(memPoolCache[i].allocCount));
+#endif
+
+   //Clear counter
+   memPoolOversizedRequests = 0;
+
+   //Release exclusive access to the memory pool
+   osMutexRelease(memPoolMutex);
+#endif
+}
+
+
+#if (MEM_POOL_SUPPORT == ENABLED && MEM_POOL_CACHE_SUPPORT == ENABLED)
+
+/**
+ * @brief Retrieve the cache owned by the calling task
+ * @return Pointer to the cache or NULL if the task has not registered one
+ **/
+
+static MemPoolCache *memPoolCacheGet(void)
+{
+   uint_t i;
+   OsTask *task;
+
+   //Get a handle to the calling task
+   task = osTaskGetHandle();
+
+   //Valid handle?
+   if(task != OS_INVALID_HANDLE)
+   {
+      //Only the owner accesses its own cache, so no locking is needed
+      for(i = 0; i < MEM_POOL_CACHE_COUNT; i++)
+      {
+         //The owner is published last when a cache is registered
+         if(memPoolCache[i].owner == task)
+         {
+            //Make sure the contents of the cache are not read beforehand
+            MEM_POOL_MEMORY_BARRIER();
+            //Return the cache owned by the calling task
+            return &memPoolCache[i];
+         }
+      }
+   }
+
+   //The calling task does not own any cache
+   return NULL;
+}
+
+#endif
+
+
 /**
  * @brief Allocate a multi-part buffer
  * @param[in] length Desired length
@@ -185,25 +792,40 @@ void memPoolFree(void *p)
 
 ChunkedBuffer *chunkedBufferAlloc(size_t length)
 {
-   error_t error;
+   uint_t chunkCount;
+
+   //Only reserve the descriptors needed to hold the requested length. The
+   //array can be extended later on if more chunks are concatenated
+   chunkCount = min(N(length) + SPARE_CHUNK_COUNT, MAX_CHUNK_COUNT);
+
+   //Allocate the multi-part buffer
+   return chunkedBufferCreate(chunkCount, length);
+}
+
+
+/**
+ * @brief Allocate a multi-part buffer with reserved headroom
+ *
+ * The headroom lies in front of the first data byte, so that lower layers
+ * can later prepend their headers in place using chunkedBufferPush
+ *
+ * @param[in] headroom Number of bytes to reserve in front of the data
+ * @param[in] length Desired length
+ * @return Pointer to the allocated buffer or NULL if there is
+ *   insufficient memory available
+ **/
+
+ChunkedBuffer *chunkedBufferAllocEx(size_t headroom, size_t length)
+{
    ChunkedBuffer *buffer;
 
-   //Allocate memory to hold the multi-part buffer
-   buffer = memPoolAlloc(MEM_POOL_BUFFER_SIZE);
+   //Allocate a buffer large enough to hold the headroom and the data
+   buffer = chunkedBufferAlloc(headroom + length);
    //Failed to allocate memory?
    if(!buffer) return NULL;
 
-   //The multi-part buffer consists of a single chunk
-   buffer->chunkCount = 1;
-   buffer->maxChunkCount = MAX_CHUNK_COUNT;
-   buffer->chunk[0].address = (uint8_t *) buffer + MAX_CHUNK_COUNT * sizeof(ChunkDesc);
-   buffer->chunk[0].length = MEM_POOL_BUFFER_SIZE - MAX_CHUNK_COUNT * sizeof(ChunkDesc);
-   buffer->chunk[0].size = 0;
-
-   //Adjust the length of the buffer
-   error = chunkedBufferSetLength(buffer, length);
-   //Any error to report?
-   if(error)
+   //The headroom must fit in the first chunk
+   if(headroom > 0 && !chunkedBufferPull(buffer, headroom))
    {
       //Clean up side effects
       chunkedBufferFree(buffer);
@@ -218,6 +840,10 @@ ChunkedBuffer *chunkedBufferAlloc(size_t length)
 
 /**
  * @brief Dispose a multi-part buffer
+ *
+ * Chunks that are still referenced by other buffers remain valid
+ * until the last reference is dropped
+ *
  * @param[in] buffer Pointer to the multi-part buffer to be released
  **/
 
@@ -226,7 +852,50 @@ void chunkedBufferFree(ChunkedBuffer *buffer)
    //Properly dispose data chunks
    chunkedBufferSetLength(buffer, 0);
    //Release multi-part buffer
-   memPoolFree(buffer);
+   chunkBlockRelease((ChunkBlock *) buffer - 1);
+}
+
+
+/**
+ * @brief Create a multi-part buffer that shares data with another buffer
+ *
+ * The chunks of the source buffer are referenced rather than copied.
+ * Data borrowed by the source buffer is copied since its lifetime is
+ * not guaranteed. Shared chunks must be treated as read-only: in
+ * particular, a buffer handed to a lower layer must not be rewritten
+ * once the call returns, since the lower layer may have cloned it
+ *
+ * @param[in] src Pointer to the source buffer
+ * @param[in] srcOffset Read offset
+ * @param[in] length Number of bytes to reference
+ * @return Pointer to the newly created buffer or NULL if there is
+ *   insufficient memory available
+ **/
+
+ChunkedBuffer *chunkedBufferClone(const ChunkedBuffer *src,
+   size_t srcOffset, size_t length)
+{
+   error_t error;
+   ChunkedBuffer *buffer;
+
+   //The first block only holds descriptors, so reserve as many as possible
+   buffer = chunkedBufferCreate(MAX_CHUNK_COUNT, 0);
+   //Failed to allocate memory?
+   if(!buffer) return NULL;
+
+   //Reference the data of the source buffer
+   error = chunkedBufferConcatRef(buffer, src, srcOffset, length);
+   //Any error to report?
+   if(error)
+   {
+      //Clean up side effects
+      chunkedBufferFree(buffer);
+      //Report an failure
+      return NULL;
+   }
+
+   //Successful processing
+   return buffer;
 }
 
 
@@ -300,14 +969,15 @@ error_t chunkedBufferSetLength(ChunkedBuffer *buffer, size_t length)
          //Point to the chunk descriptor;
          chunk = &buffer->chunk[i];
 
-         //Release previously allocated memory
-         if(chunk->size > 0)
-            memPoolFree(chunk->address);
+         //Drop the reference to the underlying block
+         if(chunk->block != NULL)
+            chunkBlockRelease(chunk->block);
 
          //Mark the current chunk as free
          chunk->address = NULL;
          chunk->length = 0;
          chunk->size = 0;
+         chunk->block = NULL;
 
          //Next chunk
          i++;
@@ -317,20 +987,22 @@ error_t chunkedBufferSetLength(ChunkedBuffer *buffer, size_t length)
    else
    {
       //Add as many chunks as necessary
-      while(i < buffer->maxChunkCount && length > 0)
+      while(length > 0 && (i < buffer->maxChunkCount || chunkedBufferExtend(buffer, i + 1)))
       {
          //Point to the chunk descriptor;
          chunk = &buffer->chunk[i];
 
          //Allocate memory to hold a new chunk
-         chunk->address = memPoolAlloc(MEM_POOL_BUFFER_SIZE);
+         chunk->block = chunkBlockAlloc();
          //Failed to allocate memory?
-         if(!chunk->address) return ERROR_OUT_OF_MEMORY;
+         if(!chunk->block) return ERROR_OUT_OF_MEMORY;
 
+         //Point to the data area of the block
+         chunk->address = chunk->block + 1;
          //Allocated memory
-         chunk->size = MEM_POOL_BUFFER_SIZE;
+         chunk->size = CHUNK_BLOCK_DATA_SIZE;
          //Actual length of the data chunk
-         chunk->length = min(length, MEM_POOL_BUFFER_SIZE);
+         chunk->length = min(length, CHUNK_BLOCK_DATA_SIZE);
 
          //Prepare to process next chunk
          length -= chunk->length;
@@ -351,23 +1023,154 @@ error_t chunkedBufferSetLength(ChunkedBuffer *buffer, size_t length)
  * @return Pointer the data at the specified position
  **/
 
-void *chunkedBufferAt(const ChunkedBuffer *buffer, size_t offset)
-{
-   uint_t i;
+void *chunkedBufferAt(const ChunkedBuffer *buffer, size_t offset)
+{
+   uint_t i;
+
+   //Loop through data chunks
+   for(i = 0; i < buffer->chunkCount; i++)
+   {
+      //The data at the specified offset resides in the current chunk?
+      if(offset < buffer->chunk[i].length)
+         return (uint8_t *) buffer->chunk[i].address + offset;
+
+      //Jump to the next chunk
+      offset -= buffer->chunk[i].length;
+   }
+
+   //Invalid offset...
+   return NULL;
+}
+
+
+/**
+ * @brief Get the number of bytes available in front of the data
+ * @param[in] buffer Pointer to a multi-part buffer
+ * @return Headroom in bytes
+ **/
+
+size_t chunkedBufferGetHeadroom(const ChunkedBuffer *buffer)
+{
+   uint8_t *start;
+   const ChunkDesc *chunk;
+
+   //Empty buffer?
+   if(!buffer->chunkCount)
+      return 0;
+
+   //Point to the first chunk
+   chunk = &buffer->chunk[0];
+
+   //Memory in front of a shared or borrowed chunk cannot be used
+   if(!chunkIsExclusive(buffer, chunk))
+      return 0;
+
+   //The block may also hold the buffer descriptor
+   if(chunk->block == (ChunkBlock *) buffer - 1)
+      start = (uint8_t *) buffer + CHUNK_DESC_AREA_SIZE(buffer->maxChunkCount);
+   else
+      start = (uint8_t *) (chunk->block + 1);
+
+   //Return the number of bytes that can be prepended
+   return (uint8_t *) chunk->address - start;
+}
+
+
+/**
+ * @brief Get the number of bytes available after the data
+ * @param[in] buffer Pointer to a multi-part buffer
+ * @return Tailroom in bytes
+ **/
+
+size_t chunkedBufferGetTailroom(const ChunkedBuffer *buffer)
+{
+   const ChunkDesc *chunk;
+
+   //Empty buffer?
+   if(!buffer->chunkCount)
+      return 0;
+
+   //Point to the last chunk
+   chunk = &buffer->chunk[buffer->chunkCount - 1];
+
+   //Memory after a shared or borrowed chunk cannot be used
+   if(!chunkIsExclusive(buffer, chunk) || chunk->size <= chunk->length)
+      return 0;
+
+   //Return the number of bytes by which the last chunk can grow
+   return chunk->size - chunk->length;
+}
+
+
+/**
+ * @brief Prepend room for a header at the beginning of a multi-part buffer
+ * @param[in] buffer Pointer to a multi-part buffer
+ * @param[in] length Number of bytes to prepend
+ * @return Pointer to the first byte of the buffer or NULL if there is
+ *   not enough headroom
+ **/
+
+void *chunkedBufferPush(ChunkedBuffer *buffer, size_t length)
+{
+   ChunkDesc *chunk;
+
+   //Make sure there is enough headroom
+   if(length > chunkedBufferGetHeadroom(buffer))
+      return NULL;
+
+   //Point to the first chunk
+   chunk = &buffer->chunk[0];
+
+   //Extend the first chunk towards the beginning of the block
+   chunk->address = (uint8_t *) chunk->address - length;
+   chunk->length += length;
+
+   //Keep track of the allocated memory
+   if(chunk->size > 0)
+      chunk->size += length;
+
+   //Return a pointer to the new beginning of the buffer
+   return chunk->address;
+}
+
+
+/**
+ * @brief Strip bytes from the beginning of a multi-part buffer
+ *
+ * The memory is kept as headroom and can be reclaimed later on
+ * using chunkedBufferPush
+ *
+ * @param[in] buffer Pointer to a multi-part buffer
+ * @param[in] length Number of bytes to remove
+ * @return Pointer to the first byte of the buffer or NULL if the
+ *   first chunk is too short
+ **/
+
+void *chunkedBufferPull(ChunkedBuffer *buffer, size_t length)
+{
+   ChunkDesc *chunk;
+
+   //Empty buffer?
+   if(!buffer->chunkCount)
+      return NULL;
+
+   //Point to the first chunk
+   chunk = &buffer->chunk[0];
 
-   //Loop through data chunks
-   for(i = 0; i < buffer->chunkCount; i++)
-   {
-      //The data at the specified offset resides in the current chunk?
-      if(offset < buffer->chunk[i].length)
-         return (uint8_t *) buffer->chunk[i].address + offset;
+   //The bytes to remove must reside in the first chunk
+   if(length > chunk->length)
+      return NULL;
 
-      //Jump to the next chunk
-      offset -= buffer->chunk[i].length;
-   }
+   //Shrink the first chunk from the beginning
+   chunk->address = (uint8_t *) chunk->address + length;
+   chunk->length -= length;
 
-   //Invalid offset...
-   return NULL;
+   //Keep track of the allocated memory
+   if(chunk->size > 0)
+      chunk->size -= min(chunk->size, length);
+
+   //Return a pointer to the new beginning of the buffer
+   return chunk->address;
 }
 
 
@@ -405,12 +1208,14 @@ error_t chunkedBufferConcat(ChunkedBuffer *dest,
    i = dest->chunkCount;
 
    //Copy data blocks
-   while(length > 0 && i < dest->maxChunkCount && j < src->chunkCount)
+   while(length > 0 && j < src->chunkCount &&
+      (i < dest->maxChunkCount || chunkedBufferExtend(dest, i + 1)))
    {
       //Copy current block
       dest->chunk[i].address = (uint8_t *) src->chunk[j].address + srcOffset;
       dest->chunk[i].length = src->chunk[j].length - srcOffset;
       dest->chunk[i].size = 0;
+      dest->chunk[i].block = NULL;
 
       //Limit the number of bytes to copy
       if(length < dest->chunk[i].length)
@@ -432,6 +1237,108 @@ error_t chunkedBufferConcat(ChunkedBuffer *dest,
 }
 
 
+/**
+ * @brief Concatenate two multi-part buffers by reference
+ *
+ * Unlike chunkedBufferConcat, the destination buffer holds a reference
+ * on each source chunk, so that the data remains valid once the source
+ * buffer has been released. Borrowed source data is copied instead
+ *
+ * @param[out] dest Pointer to the destination buffer
+ * @param[in] src Pointer to the source buffer
+ * @param[in] srcOffset Read offset
+ * @param[in] length Number of bytes to read from the source buffer
+ * @return Error code
+ **/
+
+error_t chunkedBufferConcatRef(ChunkedBuffer *dest,
+   const ChunkedBuffer *src, size_t srcOffset, size_t length)
+{
+   uint_t i;
+   uint_t j;
+   size_t n;
+   ChunkDesc *chunk;
+
+   //Nothing to do?
+   if(!length)
+      return NO_ERROR;
+
+   //Skip the beginning of the source data
+   for(j = 0; j < src->chunkCount; j++)
+   {
+      //The data at the specified offset resides in the current chunk?
+      if(srcOffset < src->chunk[j].length)
+         break;
+
+      //Jump to the next chunk
+      srcOffset -= src->chunk[j].length;
+   }
+
+   //Invalid offset?
+   if(j >= src->chunkCount)
+      return ERROR_INVALID_PARAMETER;
+
+   //Position to the end of the destination data
+   i = dest->chunkCount;
+
+   //Reference data blocks
+   while(length > 0 && j < src->chunkCount &&
+      (i < dest->maxChunkCount || chunkedBufferExtend(dest, i + 1)))
+   {
+      //Point to the destination chunk descriptor
+      chunk = &dest->chunk[i];
+      //Compute the number of bytes to reference
+      n = min(length, src->chunk[j].length - srcOffset);
+
+      //The source data is held by a reference-counted block?
+      if(src->chunk[j].block != NULL)
+      {
+         //Take a reference on the block
+         osAtomicInc32(&src->chunk[j].block->refCount);
+         //Point to the shared data
+         chunk->block = src->chunk[j].block;
+         chunk->address = (uint8_t *) src->chunk[j].address + srcOffset;
+      }
+      else
+      {
+         //Borrowed data must be copied
+         n = min(n, CHUNK_BLOCK_DATA_SIZE);
+
+         //Allocate a new block
+         chunk->block = chunkBlockAlloc();
+         //Failed to allocate memory?
+         if(!chunk->block) return ERROR_OUT_OF_MEMORY;
+
+         //Copy data
+         chunk->address = chunk->block + 1;
+         memcpy(chunk->address, (uint8_t *) src->chunk[j].address + srcOffset, n);
+      }
+
+      //Shared chunks cannot grow
+      chunk->length = n;
+      chunk->size = 0;
+
+      //Increment the number of chunks
+      dest->chunkCount++;
+      i++;
+
+      //Adjust variables
+      length -= n;
+      srcOffset += n;
+
+      //Jump to the next source chunk if necessary
+      if(srcOffset >= src->chunk[j].length)
+      {
+         srcOffset = 0;
+         j++;
+      }
+   }
+
+   //Return status code
+   return (length > 0) ? ERROR_FAILURE : NO_ERROR;
+}
+
+
 /**
  * @brief Copy data between multi-part buffers
  * @param[out] dest Pointer to the destination buffer
@@ -539,6 +1446,7 @@ error_t chunkedBufferAppend(ChunkedBuffer *dest, const void *src, size_t length)
    dest->chunk[i].address = (void *) src;
    dest->chunk[i].length = length;
    dest->chunk[i].size = 0;
+   dest->chunk[i].block = NULL;
 
    //Increment the number of chunks
    dest->chunkCount++;
@@ -652,3 +1560,342 @@ size_t chunkedBufferRead(void *dest, const ChunkedBuffer *src,
    //Return the actual number of bytes copied
    return totalLength;
 }
+
+
+
+/**
+ * @brief Initialize a cursor
+ *
+ * A cursor remembers the chunk holding the current position, so that a
+ * buffer can be walked sequentially without restarting from the first
+ * chunk on every access
+ *
+ * @param[out] cursor Cursor to initialize
+ * @param[in] buffer Pointer to a multi-part buffer
+ **/
+
+void chunkedBufferCursorInit(ChunkedBufferCursor *cursor, const ChunkedBuffer *buffer)
+{
+   //Position the cursor at the beginning of the buffer
+   cursor->buffer = buffer;
+   cursor->chunk = 0;
+   cursor->chunkOffset = 0;
+   cursor->offset = 0;
+}
+
+
+/**
+ * @brief Move a cursor to the specified position
+ *
+ * Moving forward only walks the chunks located between the current and
+ * the new position. Moving backward restarts from the first chunk
+ *
+ * @param[in,out] cursor Cursor
+ * @param[in] offset Offset from the beginning of the buffer
+ * @return Pointer the data at the specified position or NULL if the
+ *   offset lies outside the buffer
+ **/
+
+void *chunkedBufferCursorSeek(ChunkedBufferCursor *cursor, size_t offset)
+{
+   const ChunkedBuffer *buffer;
+
+   //Point to the multi-part buffer
+   buffer = cursor->buffer;
+
+   //Backward seek?
+   if(offset < cursor->offset)
+   {
+      //Restart from the beginning of the buffer
+      cursor->chunk = 0;
+      cursor->chunkOffset = 0;
+      cursor->offset = 0;
+   }
+
+   //Number of bytes to skip from the current position
+   cursor->chunkOffset += offset - cursor->offset;
+   cursor->offset = offset;
+
+   //Loop through data chunks
+   while(cursor->chunk < buffer->chunkCount)
+   {
+      //The data at the specified offset resides in the current chunk?
+      if(cursor->chunkOffset < buffer->chunk[cursor->chunk].length)
+         return (uint8_t *) buffer->chunk[cursor->chunk].address + cursor->chunkOffset;
+
+      //Jump to the next chunk
+      cursor->chunkOffset -= buffer->chunk[cursor->chunk].length;
+      cursor->chunk++;
+   }
+
+   //Invalid offset...
+   return NULL;
+}
+
+
+/**
+ * @brief Advance a cursor
+ * @param[in,out] cursor Cursor
+ * @param[in] length Number of bytes to skip
+ * @return Pointer the data at the new position or NULL if the
+ *   position lies outside the buffer
+ **/
+
+void *chunkedBufferCursorSkip(ChunkedBufferCursor *cursor, size_t length)
+{
+   //Move forward
+   return chunkedBufferCursorSeek(cursor, cursor->offset + length);
+}
+
+
+/**
+ * @brief Read data at the position of a cursor
+ *
+ * The cursor is advanced by the number of bytes actually copied
+ *
+ * @param[in,out] cursor Cursor
+ * @param[out] dest Pointer to the buffer where to return the data
+ * @param[in] length Number of bytes to copy
+ * @return Actual number of bytes copied
+ **/
+
+size_t chunkedBufferCursorRead(ChunkedBufferCursor *cursor, void *dest, size_t length)
+{
+   size_t n;
+   size_t totalLength;
+   uint8_t *p;
+   const ChunkDesc *chunk;
+
+   //Make sure the cursor points to valid data
+   if(!chunkedBufferCursorSeek(cursor, cursor->offset))
+      return 0;
+
+   //Total number of bytes copied
+   totalLength = 0;
+
+   //Loop through data chunks
+   while(totalLength < length && cursor->chunk < cursor->buffer->chunkCount)
+   {
+      //Point to the current chunk
+      chunk = &cursor->buffer->chunk[cursor->chunk];
+
+      //Point to the first byte to be read
+      p = (uint8_t *) chunk->address + cursor->chunkOffset;
+      //Compute the number of bytes to copy at a time
+      n = min(length - totalLength, chunk->length - cursor->chunkOffset);
+
+      //Copy data
+      memcpy(dest, p, n);
+
+      //Advance write pointer
+      dest = (uint8_t *) dest + n;
+      //Total number of bytes copied
+      totalLength += n;
+
+      //Advance the cursor
+      cursor->offset += n;
+      cursor->chunkOffset += n;
+
+      //End of the current chunk?
+      if(cursor->chunkOffset >= chunk->length)
+      {
+         cursor->chunkOffset = 0;
+         cursor->chunk++;
+      }
+   }
+
+   //Return the actual number of bytes copied
+   return totalLength;
+}
+
+/**
+ * @brief Allocate a reference-counted chunk block
+ * @return Pointer to the allocated block or NULL if there is
+ *   insufficient memory available
+ **/
+
+ChunkBlock *chunkBlockAlloc(void)
+{
+   ChunkBlock *block;
+
+   //Allocate a memory block
+   block = memPoolAlloc(MEM_POOL_BUFFER_SIZE);
+
+   //Successful memory allocation?
+   if(block != NULL)
+   {
+      //The caller holds the only reference
+      block->refCount = 1;
+      block->reserved = 0;
+   }
+
+   //Return a pointer to the allocated block
+   return block;
+}
+
+
+/**
+ * @brief Take an additional reference to a chunk block
+ *
+ * This allows a network driver to keep the data of a chunk alive until
+ * the DMA is done with it, even after the buffer has been released
+ *
+ * @param[in] block Pointer to the chunk block
+ **/
+
+void chunkBlockRetain(ChunkBlock *block)
+{
+   //Increment the reference count
+   osAtomicInc32(&block->refCount);
+}
+
+
+/**
+ * @brief Drop a reference to a chunk block
+ * @param[in] block Pointer to the chunk block
+ **/
+
+void chunkBlockRelease(ChunkBlock *block)
+{
+   //Release the memory when the last reference is dropped
+   if(!osAtomicDec32(&block->refCount))
+      memPoolFree(block);
+}
+
+
+/**
+ * @brief Allocate a multi-part buffer with a given number of descriptors
+ *
+ * The descriptors and the first chunk share the same block. Memory left
+ * over in that block is kept in front of the data, so that the descriptor
+ * array can later grow in place without moving the data
+ *
+ * @param[in] chunkCount Number of chunk descriptors to reserve
+ * @param[in] length Desired length
+ * @return Pointer to the allocated buffer or NULL if there is
+ *   insufficient memory available
+ **/
+
+static ChunkedBuffer *chunkedBufferCreate(uint_t chunkCount, size_t length)
+{
+   error_t error;
+   size_t size;
+   size_t headroom;
+   ChunkBlock *block;
+   ChunkedBuffer *buffer;
+
+   //Allocate memory to hold the multi-part buffer
+   block = chunkBlockAlloc();
+   //Failed to allocate memory?
+   if(!block) return NULL;
+
+   //The first chunk shares the block with the buffer descriptor, which
+   //holds its own reference on the block
+   block->refCount = 2;
+   //Point to the multi-part buffer
+   buffer = (ChunkedBuffer *) (block + 1);
+
+   //Memory available for the first chunk
+   size = CHUNK_BLOCK_DATA_SIZE - CHUNK_DESC_AREA_SIZE(chunkCount);
+
+   //Memory that the descriptor array would need to reach its maximum size
+   if(chunkCount < MAX_CHUNK_COUNT)
+      headroom = (MAX_CHUNK_COUNT - chunkCount) * sizeof(ChunkDesc);
+   else
+      headroom = 0;
+
+   //Payload always takes precedence over spare descriptors
+   if(length < size)
+      headroom = min(headroom, size - length);
+   else
+      headroom = 0;
+
+   //The multi-part buffer consists of a single chunk
+   buffer->chunkCount = 1;
+   buffer->maxChunkCount = chunkCount;
+   buffer->chunk[0].address = (uint8_t *) buffer + CHUNK_DESC_AREA_SIZE(chunkCount) + headroom;
+   buffer->chunk[0].length = size - headroom;
+   buffer->chunk[0].size = buffer->chunk[0].length;
+   buffer->chunk[0].block = block;
+
+   //Adjust the length of the buffer
+   error = chunkedBufferSetLength(buffer, length);
+   //Any error to report?
+   if(error)
+   {
+      //Clean up side effects
+      chunkedBufferFree(buffer);
+      //Report an failure
+      return NULL;
+   }
+
+   //Successful memory allocation
+   return buffer;
+}
+
+
+/**
+ * @brief Extend the descriptor array of a multi-part buffer
+ *
+ * The array can only grow over the unused memory that lies between the
+ * descriptors and the data of the first chunk
+ *
+ * @param[in] buffer Pointer to the multi-part buffer
+ * @param[in] chunkCount Desired number of chunk descriptors
+ * @return TRUE if the buffer can hold the requested number of chunks,
+ *   else FALSE
+ **/
+
+static bool_t chunkedBufferExtend(ChunkedBuffer *buffer, uint_t chunkCount)
+{
+   size_t n;
+
+   //The array is already large enough?
+   if(chunkCount <= buffer->maxChunkCount)
+      return TRUE;
+
+   //Do not exceed the size of a dynamically allocated buffer
+   if(chunkCount > MAX_CHUNK_COUNT || !buffer->chunkCount)
+      return FALSE;
+
+   //Statically allocated buffers and buffers whose first chunk has been
+   //released cannot be extended
+   if(buffer->chunk[0].block != (ChunkBlock *) buffer - 1)
+      return FALSE;
+
+   //Amount of memory needed by the new descriptors
+   n = (chunkCount - buffer->maxChunkCount) * sizeof(ChunkDesc);
+
+   //The new descriptors must fit in front of the data
+   if(n > chunkedBufferGetHeadroom(buffer))
+      return FALSE;
+
+   //Initialize the new descriptors
+   memset(&buffer->chunk[buffer->maxChunkCount], 0, n);
+   //Adjust the size of the array
+   buffer->maxChunkCount = chunkCount;
+
+   //Successful processing
+   return TRUE;
+}
+
+
+/**
+ * @brief Check whether a chunk is the only user of its block
+ * @param[in] buffer Pointer to the multi-part buffer
+ * @param[in] chunk Pointer to a chunk of the buffer
+ * @return TRUE if the memory around the chunk data can be reused, else FALSE
+ **/
+
+static bool_t chunkIsExclusive(const ChunkedBuffer *buffer, const ChunkDesc *chunk)
+{
+   //Borrowed data
+   if(chunk->block == NULL)
+      return FALSE;
+
+   //The buffer descriptor holds an extra reference on its own block
+   if(chunk->block == (ChunkBlock *) buffer - 1)
+      return (chunk->block->refCount == 2) ? TRUE : FALSE;
+   else
+      return (chunk->block->refCount == 1) ? TRUE : FALSE;
+}
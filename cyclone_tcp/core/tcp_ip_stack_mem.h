@@ -55,8 +55,112 @@
    #error MEM_POOL_BUFFER_SIZE parameter is invalid
 #endif
 
+//Number of small buffers (set to 0 to disable the small size class)
+#ifndef MEM_POOL_SMALL_BUFFER_COUNT
+   #define MEM_POOL_SMALL_BUFFER_COUNT 0
+#elif (MEM_POOL_SMALL_BUFFER_COUNT < 0)
+   #error MEM_POOL_SMALL_BUFFER_COUNT parameter is invalid
+#endif
+
+//Size of the small buffers
+#ifndef MEM_POOL_SMALL_BUFFER_SIZE
+   #define MEM_POOL_SMALL_BUFFER_SIZE 64
+#elif (MEM_POOL_SMALL_BUFFER_SIZE < 16 || (MEM_POOL_SMALL_BUFFER_SIZE % 4) != 0)
+   #error MEM_POOL_SMALL_BUFFER_SIZE parameter is invalid
+#endif
+
+//Number of medium buffers (set to 0 to disable the medium size class)
+#ifndef MEM_POOL_MEDIUM_BUFFER_COUNT
+   #define MEM_POOL_MEDIUM_BUFFER_COUNT 0
+#elif (MEM_POOL_MEDIUM_BUFFER_COUNT < 0)
+   #error MEM_POOL_MEDIUM_BUFFER_COUNT parameter is invalid
+#endif
+
+//Size of the medium buffers
+#ifndef MEM_POOL_MEDIUM_BUFFER_SIZE
+   #define MEM_POOL_MEDIUM_BUFFER_SIZE 256
+#elif (MEM_POOL_MEDIUM_BUFFER_SIZE <= MEM_POOL_SMALL_BUFFER_SIZE || \
+   MEM_POOL_MEDIUM_BUFFER_SIZE >= MEM_POOL_BUFFER_SIZE || (MEM_POOL_MEDIUM_BUFFER_SIZE % 4) != 0)
+   #error MEM_POOL_MEDIUM_BUFFER_SIZE parameter is invalid
+#endif
+
+//Per-task caches in front of the memory pool
+#ifndef MEM_POOL_CACHE_SUPPORT
+   #define MEM_POOL_CACHE_SUPPORT DISABLED
+#elif (MEM_POOL_CACHE_SUPPORT != ENABLED && MEM_POOL_CACHE_SUPPORT != DISABLED)
+   #error MEM_POOL_CACHE_SUPPORT parameter is invalid
+#endif
+
+//Maximum number of tasks that can own a cache
+#ifndef MEM_POOL_CACHE_COUNT
+   #define MEM_POOL_CACHE_COUNT 4
+#elif (MEM_POOL_CACHE_COUNT < 1)
+   #error MEM_POOL_CACHE_COUNT parameter is invalid
+#endif
+
+//Number of blocks each cache can hold per size class
+#ifndef MEM_POOL_CACHE_SIZE
+   #define MEM_POOL_CACHE_SIZE 8
+#elif (MEM_POOL_CACHE_SIZE < 2)
+   #error MEM_POOL_CACHE_SIZE parameter is invalid
+#endif
+
+//Memory barrier used when publishing the owner of a cache
+#ifndef MEM_POOL_MEMORY_BARRIER
+   #if defined(__GNUC__)
+      #define MEM_POOL_MEMORY_BARRIER() __sync_synchronize()
+   #else
+      #define MEM_POOL_MEMORY_BARRIER()
+   #endif
+#endif
+
+//Maximum number of size classes
+#define MEM_POOL_MAX_CLASS_COUNT 3
+
+//Amount of data that fits in a single chunk block
+#define CHUNK_BLOCK_DATA_SIZE (MEM_POOL_BUFFER_SIZE - sizeof(ChunkBlock))
+
 //Miscellaneous macro declarations
-#define N(size) (((size) + MEM_POOL_BUFFER_SIZE - 1) / MEM_POOL_BUFFER_SIZE)
+#define N(size) (((size) + CHUNK_BLOCK_DATA_SIZE - 1) / CHUNK_BLOCK_DATA_SIZE)
+
+
+/**
+ * @brief Usage statistics of a size class
+ **/
+
+typedef struct
+{
+   size_t blockSize;    ///<Size of each block
+   uint_t blockCount;   ///<Number of blocks
+   uint_t inUse;        ///<Number of blocks taken from the pool, including cached blocks
+   uint_t cached;       ///<Number of free blocks held in per-task caches
+   uint_t peakInUse;    ///<Highest number of blocks taken from the pool simultaneously
+   uint_t allocCount;   ///<Number of successful allocations
+   uint_t allocFailures; ///<Number of allocation requests that could not be satisfied
+} MemPoolClassStats;
+
+
+/**
+ * @brief Memory pool statistics
+ **/
+
+typedef struct
+{
+   uint_t classCount;                                     ///<Number of size classes
+   MemPoolClassStats sizeClass[MEM_POOL_MAX_CLASS_COUNT]; ///<Per size class statistics
+   uint_t oversizedRequests;                              ///<Requests larger than the biggest block size
+} MemPoolStats;
+
+
+/**
+ * @brief Header of a reference-counted block holding chunk data
+ **/
+
+typedef struct
+{
+   uint32_t refCount; ///<Number of references to the block
+   uint32_t reserved; ///<Keeps the data properly aligned
+} ChunkBlock;
 
 
 /**
@@ -68,6 +172,7 @@ typedef struct
    void *address;
    uint16_t length;
    uint16_t size;
+   ChunkBlock *block; ///<Block holding the data (NULL if the data is borrowed)
 } ChunkDesc;
 
 
@@ -91,12 +196,32 @@ typedef struct
 } ChunkedBuffer1;
 
 
+/**
+ * @brief Cursor for sequential access to a multi-part buffer
+ **/
+
+typedef struct
+{
+   const ChunkedBuffer *buffer; ///<Multi-part buffer
+   uint_t chunk;                ///<Index of the current chunk
+   size_t chunkOffset;          ///<Offset within the current chunk
+   size_t offset;               ///<Offset from the beginning of the buffer
+} ChunkedBufferCursor;
+
+
 //Memory management functions
 error_t memPoolInit(void);
 void *memPoolAlloc(size_t size);
 void memPoolFree(void *p);
 
+error_t memPoolCacheRegister(void);
+void memPoolCacheUnregister(void);
+
+error_t memPoolGetStats(MemPoolStats *stats);
+void memPoolResetStats(void);
+
 ChunkedBuffer *chunkedBufferAlloc(size_t length);
+ChunkedBuffer *chunkedBufferAllocEx(size_t headroom, size_t length);
 void chunkedBufferFree(ChunkedBuffer *buffer);
 
 size_t chunkedBufferGetLength(const ChunkedBuffer *buffer);
@@ -104,9 +229,21 @@ error_t chunkedBufferSetLength(ChunkedBuffer *buffer, size_t length);
 
 void *chunkedBufferAt(const ChunkedBuffer *buffer, size_t offset);
 
+size_t chunkedBufferGetHeadroom(const ChunkedBuffer *buffer);
+size_t chunkedBufferGetTailroom(const ChunkedBuffer *buffer);
+
+void *chunkedBufferPush(ChunkedBuffer *buffer, size_t length);
+void *chunkedBufferPull(ChunkedBuffer *buffer, size_t length);
+
+ChunkedBuffer *chunkedBufferClone(const ChunkedBuffer *src,
+   size_t srcOffset, size_t length);
+
 error_t chunkedBufferConcat(ChunkedBuffer *dest,
    const ChunkedBuffer *src, size_t srcOffset, size_t length);
 
+error_t chunkedBufferConcatRef(ChunkedBuffer *dest,
+   const ChunkedBuffer *src, size_t srcOffset, size_t length);
+
 error_t chunkedBufferCopy(ChunkedBuffer *dest, size_t destOffset,
    const ChunkedBuffer *src, size_t srcOffset, size_t length);
 
@@ -118,4 +255,13 @@ size_t chunkedBufferWrite(ChunkedBuffer *dest,
 size_t chunkedBufferRead(void *dest, const ChunkedBuffer *src,
    size_t srcOffset, size_t length);
 
+void chunkedBufferCursorInit(ChunkedBufferCursor *cursor, const ChunkedBuffer *buffer);
+void *chunkedBufferCursorSeek(ChunkedBufferCursor *cursor, size_t offset);
+void *chunkedBufferCursorSkip(ChunkedBufferCursor *cursor, size_t length);
+size_t chunkedBufferCursorRead(ChunkedBufferCursor *cursor, void *dest, size_t length);
+
+ChunkBlock *chunkBlockAlloc(void);
+void chunkBlockRetain(ChunkBlock *block);
+void chunkBlockRelease(ChunkBlock *block);
+
 #endif
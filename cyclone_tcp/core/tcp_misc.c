@@ -36,13 +36,57 @@
 #include "socket.h"
 #include "tcp.h"
 #include "tcp_misc.h"
+#include "tcp_timer.h"
+#include "tcp_congestion.h"
+#include "tcp_rack.h"
+#include "tcp_pacing.h"
 #include "ip.h"
 #include "ipv4.h"
+#include "ip_pmtu.h"
 #include "debug.h"
 
 //Check TCP/IP stack configuration
 #if (TCP_SUPPORT == ENABLED)
 
+//Connections indexed by their 4-tuple
+static Socket *tcpHashTable[TCP_HASH_TABLE_SIZE];
+//Listening sockets indexed by their local port
+static Socket *tcpListenHashTable[TCP_LISTEN_HASH_TABLE_SIZE];
+
+#if (TCP_RX_COALESCING_SUPPORT == ENABLED)
+//Number of RX batches currently being processed
+static uint_t tcpRxBatchCount;
+#endif
+
+//SYN queue entries shared by all the listening sockets
+static TcpSynQueueItem tcpSynQueueTable[TCP_SYN_QUEUE_TABLE_SIZE];
+//Pending connection requests indexed by their 4-tuple
+static TcpSynQueueItem *tcpSynHashTable[TCP_HASH_TABLE_SIZE];
+
+//Demultiplexing helpers
+static uint_t tcpHashTuple(uint16_t localPort,
+   const IpAddr *remoteIpAddr, uint16_t remotePort);
+static bool_t tcpMatchSocket(Socket *socket,
+   NetInterface *interface, const IpPseudoHeader *pseudoHeader);
+
+//Checksum helper
+static uint16_t tcpCalcSegmentChecksum(const void *pseudoHeader,
+   size_t pseudoHeaderLength, const ChunkedBuffer *buffer, size_t offset,
+   size_t headerLength, uint16_t dataChecksum);
+
+//Send buffer helpers
+static error_t tcpReadTxRing(Socket *socket, uint32_t seqNum,
+   ChunkedBuffer *buffer, size_t length);
+#if (TCP_SEND_FILE_SUPPORT == ENABLED)
+static void tcpFlushTxRegions(Socket *socket);
+#endif
+
+//SACK-based loss recovery helpers
+#if (TCP_SACK_SUPPORT == ENABLED)
+static bool_t tcpIsSegmentLost(Socket *socket, TcpQueueItem *queueItem);
+static uint_t tcpComputePipe(Socket *socket);
+#endif
+
 
 /**
  * @brief Send a TCP segment
@@ -57,18 +101,45 @@
 
 error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
    uint32_t ackNum, size_t length, bool_t addToQueue)
+{
+   //The checksum of the data is not known yet
+   return tcpSendSegmentEx(socket, flags, seqNum, ackNum, length, addToQueue, NULL);
+}
+
+
+/**
+ * @brief Send a TCP segment whose data checksum may already be known
+ *
+ * The header and the data are summed separately. When the same data is
+ * sent again, its checksum is taken from the retransmission queue and
+ * only the rebuilt header has to be summed
+ *
+ * @param[in] socket Handle referencing a socket
+ * @param[in] flags Value that contains bitwise OR of flags (see #TcpFlags enumeration)
+ * @param[in] seqNum Sequence number
+ * @param[in] ackNum Acknowledgment number
+ * @param[in] length Length of the segment data
+ * @param[in] addToQueue Add the segment to retransmission queue
+ * @param[in] dataChecksum Checksum of the data (NULL if not known)
+ * @return Error code
+ **/
+
+error_t tcpSendSegmentEx(Socket *socket, uint8_t flags, uint32_t seqNum,
+   uint32_t ackNum, size_t length, bool_t addToQueue, const uint16_t *dataChecksum)
 {
    error_t error;
    size_t offset;
+   size_t headerLength;
    size_t totalLength;
+   uint16_t checksum;
+   bool_t checksumValid;
    uint_t timeToLive;
    ChunkedBuffer *buffer;
    TcpHeader *segment;
    TcpQueueItem *queueItem;
    IpPseudoHeader pseudoHeader;
 
-   //Maximum segment size
-   const uint16_t mss = HTONS(TCP_MAX_MSS);
+   uint16_t mss;
 
    //Allocate a memory buffer to hold the TCP segment
    buffer = ipAllocBuffer(TCP_MAX_HEADER_LENGTH, &offset);
@@ -87,21 +158,97 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
    segment->dataOffset = 5;
    segment->flags = flags;
    segment->reserved2 = 0;
-   segment->window = htons(socket->rcvWnd);
+   segment->window = htons(tcpGetAdvertisedWindow(socket, flags));
    segment->checksum = 0;
    segment->urgentPointer = 0;
 
    //SYN flag set?
    if(flags & TCP_FLAG_SYN)
    {
+      //Largest segment that fits in the MTU of the interface
+      mss = htons(tcpGetMaxMss(socket->interface, &socket->remoteIpAddr));
       //Append MSS option
       tcpAddOption(segment, TCP_OPTION_MAX_SEGMENT_SIZE, &mss, sizeof(mss));
 
 #if (TCP_SACK_SUPPORT == ENABLED)
-      //Append SACK Permitted option
-      tcpAddOption(segment, TCP_OPTION_SACK_PERMITTED, NULL, 0);
+      //The SACK Permitted option is offered in the initial SYN and is
+      //only echoed in a SYN ACK when the peer offered it
+      if(!(flags & TCP_FLAG_ACK) || socket->sackPermitted)
+      {
+         //Append SACK Permitted option
+         tcpAddOption(segment, TCP_OPTION_SACK_PERMITTED, NULL, 0);
+      }
+#endif
+
+#if (TCP_WINDOW_SCALE_SUPPORT == ENABLED)
+      //The Window Scale option is offered in the initial SYN and is only
+      //echoed in a SYN ACK when the peer offered it (refer to RFC 7323)
+      if(socket->wndScaleFlag)
+      {
+         //Shift count applied to the windows we advertise
+         uint8_t shift = socket->rcvWndShift;
+         //Append Window Scale option
+         tcpAddOption(segment, TCP_OPTION_WINDOW_SCALE_FACTOR, &shift, sizeof(shift));
+      }
+#endif
+
+#if (TCP_FAST_OPEN_SUPPORT == ENABLED)
+      //The Fast Open option carries either a cookie or an empty
+      //cookie request (refer to RFC 7413)
+      if(socket->fastOpenFlag)
+      {
+         //Append Fast Open option
+         tcpAddOption(segment, TCP_OPTION_FAST_OPEN_COOKIE,
+            socket->fastOpenCookie, socket->fastOpenCookieLength);
+      }
+#endif
+   }
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   //The Timestamps option is offered in the initial SYN and, once both
+   //sides agreed to use it, is sent in every segment (refer to RFC 7323)
+   if(socket->tsFlag)
+   {
+      uint32_t value[2];
+
+      //TSval is taken from the system tick counter, TSecr echoes TS.Recent
+      value[0] = htonl((uint32_t) osGetTickCount());
+      value[1] = htonl(socket->tsRecent);
+      //Append Timestamps option
+      tcpAddOption(segment, TCP_OPTION_TIMESTAMP, value, sizeof(value));
+
+      //Record the acknowledgment number (Last.ACK.sent)
+      if(flags & TCP_FLAG_ACK)
+         socket->tsLastAckSent = ackNum;
+   }
 #endif
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+   //Report the non-contiguous blocks that have been received
+   if((flags & TCP_FLAG_ACK) && !(flags & TCP_FLAG_SYN) &&
+      socket->sackPermitted && socket->sackBlockCount > 0)
+   {
+      uint_t i;
+      uint_t n;
+      uint32_t value[2 * TCP_MAX_SACK_BLOCKS];
+
+      //Number of blocks that fit in the remaining option space
+      //(two padding bytes and the option header)
+      n = (TCP_MAX_HEADER_LENGTH - segment->dataOffset * 4 - 4) / 8;
+      n = min(n, socket->sackBlockCount);
+
+      //The first block reports the most recently received segment
+      for(i = 0; i < n; i++)
+      {
+         value[2 * i] = htonl(socket->sackBlock[i].leftEdge);
+         value[2 * i + 1] = htonl(socket->sackBlock[i].rightEdge);
+      }
+
+      //Append SACK option
+      if(n > 0)
+         tcpAddOption(segment, TCP_OPTION_SACK, value, n * 8);
    }
+#endif
 
    //Adjust the length of the multi-part buffer
    chunkedBufferSetLength(buffer, offset + segment->dataOffset * 4);
@@ -110,7 +257,9 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
    if(length > 0)
    {
       //Copy data
-      error = tcpReadTxBuffer(socket, seqNum, buffer, length);
+      //The SYN occupies the first sequence number
+      error = tcpReadTxBuffer(socket, (flags & TCP_FLAG_SYN) ?
+         seqNum + 1 : seqNum, buffer, length);
       //Any error to report?
       if(error)
       {
@@ -122,7 +271,12 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
    }
 
    //Calculate the length of the complete TCP segment
-   totalLength = segment->dataOffset * 4 + length;
+   headerLength = segment->dataOffset * 4;
+   totalLength = headerLength + length;
+
+   //The checksum of the data may be known from a previous transmission
+   checksum = (dataChecksum != NULL) ? *dataChecksum : 0;
+   checksumValid = (dataChecksum != NULL) ? TRUE : FALSE;
 
 #if (IPV4_SUPPORT == ENABLED)
    //Destination address is an IPv4 address?
@@ -136,9 +290,21 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
       pseudoHeader.ipv4Data.protocol = IPV4_PROTOCOL_TCP;
       pseudoHeader.ipv4Data.length = htons(totalLength);
 
-      //Calculate TCP header checksum
-      segment->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader.ipv4Data,
-         sizeof(Ipv4PseudoHeader), buffer, offset, totalLength);
+      //Calculate TCP header checksum, unless the hardware inserts it
+      if(!ipv4IsChecksumOffloaded(socket->interface,
+         pseudoHeader.ipv4Data.destAddr, totalLength))
+      {
+         //The data is only summed if its checksum is not known yet
+         if(!checksumValid)
+         {
+            checksum = ipCalcChecksumEx(buffer, offset + headerLength, length);
+            checksumValid = TRUE;
+         }
+
+         //Combine the checksum of the data with the pseudo header and the header
+         segment->checksum = tcpCalcSegmentChecksum(&pseudoHeader.ipv4Data,
+            sizeof(Ipv4PseudoHeader), buffer, offset, headerLength, checksum);
+      }
 
       //Set TTL value
       timeToLive = IPV4_DEFAULT_TTL;
@@ -157,9 +323,20 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
       pseudoHeader.ipv6Data.reserved = 0;
       pseudoHeader.ipv6Data.nextHeader = IPV6_TCP_HEADER;
 
-      //Calculate TCP header checksum
-      segment->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader.ipv6Data,
-         sizeof(Ipv6PseudoHeader), buffer, offset, totalLength);
+      //Calculate TCP header checksum, unless the segment is sent to the local host
+      if(!ipv6IsLocalHostAddr(socket->interface, &pseudoHeader.ipv6Data.destAddr))
+      {
+         //The data is only summed if its checksum is not known yet
+         if(!checksumValid)
+         {
+            checksum = ipCalcChecksumEx(buffer, offset + headerLength, length);
+            checksumValid = TRUE;
+         }
+
+         //Combine the checksum of the data with the pseudo header and the header
+         segment->checksum = tcpCalcSegmentChecksum(&pseudoHeader.ipv6Data,
+            sizeof(Ipv6PseudoHeader), buffer, offset, headerLength, checksum);
+      }
 
       //Set Hop Limit value
       timeToLive = IPV6_DEFAULT_HOP_LIMIT;
@@ -177,45 +354,41 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
    //Add current segment to retransmission queue?
    if(addToQueue)
    {
-      //Empty retransmission queue?
-      if(!socket->retransmitQueue)
-      {
-         //Create a new item
-         queueItem = memPoolAlloc(sizeof(TcpQueueItem));
-         //Add the newly created item to the queue
-         socket->retransmitQueue = queueItem;
-      }
-      else
-      {
-         //Point to the very first item
-         queueItem = socket->retransmitQueue;
-         //Reach the last item of the retransmission queue
-         while(queueItem->next) queueItem = queueItem->next;
-         //Create a new item
-         queueItem->next = memPoolAlloc(sizeof(TcpQueueItem));
-         //Point to the newly created item
-         queueItem = queueItem->next;
-      }
-
-      //Failed to allocate memory?
-      if(!queueItem)
+      //The retransmission queue is full?
+      if(socket->retransmitQueueCount >= TCP_RETRANSMIT_QUEUE_SIZE)
       {
          //Free previously allocated memory
          chunkedBufferFree(buffer);
          //Return status
-         return ERROR_OUT_OF_MEMORY;
+         return ERROR_OUT_OF_RESOURCES;
       }
 
-      //Retransmission mechanism requires additional information
-      queueItem->next = NULL;
+      //Append a descriptor at the tail of the ring
+      queueItem = &socket->retransmitQueue[(socket->retransmitQueueHead +
+         socket->retransmitQueueCount) % TCP_RETRANSMIT_QUEUE_SIZE];
+      socket->retransmitQueueCount++;
+
+      //The data remains in the send buffer until it is acknowledged
+      queueItem->seqNum = seqNum;
       queueItem->length = length;
+      queueItem->flags = flags;
+      //Save the checksum of the data for later retransmissions
+      queueItem->checksum = checksum;
+      queueItem->checksumValid = checksumValid;
       queueItem->sacked = FALSE;
-      //Save TCP header
-      memcpy(&queueItem->header, segment, segment->dataOffset * 4);
-      //Save pseudo header
-      queueItem->pseudoHeader = pseudoHeader;
-      //Save TTL value
-      queueItem->timeToLive = timeToLive;
+      queueItem->retransmitted = FALSE;
+
+#if (TCP_RACK_SUPPORT == ENABLED)
+      //Record the transmission time of the segment
+      queueItem->xmitCount = 0;
+      tcpRackOnTransmit(socket, queueItem);
+#endif
+
+#if (TCP_PACING_SUPPORT == ENABLED)
+      //Schedule the release of the next data segment
+      if(length > 0)
+         tcpPacingOnTransmit(socket, length);
+#endif
 
       //Take one RTT measurement at a time
       if(!socket->rttBusy)
@@ -235,10 +408,15 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
       {
          //If the timer is not running, start it running so that
          //it will expire after RTO seconds
-         osTimerStart(&socket->retransmitTimer, socket->rto);
+         tcpStartTimer(socket, &socket->retransmitTimer, socket->rto);
          //Reset retransmission counter
          socket->retransmitCount = 0;
       }
+
+#if (TCP_RACK_SUPPORT == ENABLED)
+      //The probe timeout is measured from the most recent transmission
+      tcpRackArmTlp(socket);
+#endif
    }
 
    //Debug message
@@ -248,8 +426,46 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
    //Dump TCP header contents for debugging purpose
    tcpDumpHeader(segment, length, socket->iss, socket->irs);
 
-   //Send TCP segment
-   error = ipSendDatagram(socket->interface, &pseudoHeader, buffer, offset, timeToLive);
+   //Send TCP segment, reusing the path resolved for the previous ones
+   error = ipSendDatagram(socket->interface, &pseudoHeader,
+      buffer, offset, timeToLive, IP_PRIORITY_TO_TOS(socket->priority), &socket->pathCache);
+
+   //Record the time at which data was last sent, so that the congestion
+   //window can be validated after an idle period
+   if(!error && length > 0)
+      socket->lastTxTime = osGetTickCount();
+
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+   //Any ACK acknowledges all the data received so far, so that
+   //a pending delayed ACK is piggybacked on this segment
+   if(!error && (flags & TCP_FLAG_ACK))
+   {
+      socket->ackDelayed = FALSE;
+      socket->ackDelayedBytes = 0;
+   }
+#endif
+
+   //Successful transmission?
+   if(!error)
+   {
+      //Update TCP statistics
+      TCP_MIB_INC(tcpOutSegs);
+      //Count the resets sent
+      if(flags & TCP_FLAG_RST)
+         TCP_MIB_INC(tcpOutRsts);
+   }
+
+#if (TCP_INFO_SUPPORT == ENABLED)
+   //Successful transmission?
+   if(!error)
+   {
+      //Number of segments sent on this connection
+      socket->stats.segmentsOut++;
+      //Record the time at which data was last sent
+      if(length > 0)
+         socket->stats.lastDataSent = osGetTickCount();
+   }
+#endif
 
    //Free previously allocated memory
    chunkedBufferFree(buffer);
@@ -258,6 +474,35 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
 }
 
 
+/**
+ * @brief Calculate the checksum of an outgoing segment
+ * @param[in] pseudoHeader Pointer to the pseudo header
+ * @param[in] pseudoHeaderLength Pseudo header length
+ * @param[in] buffer Multi-part buffer containing the segment
+ * @param[in] offset Offset to the TCP header
+ * @param[in] headerLength Length of the TCP header
+ * @param[in] dataChecksum Checksum of the data that follows the header
+ * @return Checksum value
+ **/
+
+static uint16_t tcpCalcSegmentChecksum(const void *pseudoHeader,
+   size_t pseudoHeaderLength, const ChunkedBuffer *buffer, size_t offset,
+   size_t headerLength, uint16_t dataChecksum)
+{
+   uint16_t checksum;
+
+   //Combine the checksums of the header and of the data
+   checksum = ipCombineChecksum(ipCalcChecksumEx(buffer, offset, headerLength),
+      dataChecksum, headerLength);
+   //Account for the pseudo header
+   checksum = ipCombineChecksum(ipCalcChecksum(pseudoHeader, pseudoHeaderLength),
+      checksum, pseudoHeaderLength);
+
+   //A null checksum field means that the checksum has not been calculated
+   return (checksum == 0x0000) ? 0xFFFF : checksum;
+}
+
+
 /**
  * @brief Send a TCP reset in response to an invalid segment
  * @param[in] interface Underlying network interface
@@ -270,15 +515,9 @@ error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
 error_t tcpSendResetSegment(NetInterface *interface,
    IpPseudoHeader *pseudoHeader, TcpHeader *segment, size_t length)
 {
-   error_t error;
-   size_t offset;
-   uint_t timeToLive;
    uint8_t flags;
    uint32_t seqNum;
    uint32_t ackNum;
-   ChunkedBuffer *buffer;
-   TcpHeader *segment2;
-   IpPseudoHeader pseudoHeader2;
 
    //Check whether the ACK bit is set
    if(segment->flags & TCP_FLAG_ACK)
@@ -304,8 +543,45 @@ error_t tcpSendResetSegment(NetInterface *interface,
          ackNum++;
    }
 
-   //Allocate a memory buffer to hold the reset segment
-   buffer = ipAllocBuffer(sizeof(TcpHeader), &offset);
+   //Debug message
+   TRACE_DEBUG("%s: Sending TCP reset segment...\r\n", timeFormat(osGetTickCount()));
+
+   //Send the reset segment
+   return tcpSendReplySegment(interface, pseudoHeader,
+      segment, flags, seqNum, ackNum, 0, 0);
+}
+
+
+/**
+ * @brief Send a control segment without any connection state
+ *
+ * The segment is addressed to the sender of an incoming segment
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] pseudoHeader TCP pseudo header describing the incoming segment
+ * @param[in] segment Incoming TCP segment
+ * @param[in] flags Value that contains bitwise OR of flags (see #TcpFlags enumeration)
+ * @param[in] seqNum Sequence number
+ * @param[in] ackNum Acknowledgment number
+ * @param[in] window Advertised window
+ * @param[in] mss Value of the MSS option (0 to omit the option)
+ * @return Error code
+ **/
+
+error_t tcpSendReplySegment(NetInterface *interface, IpPseudoHeader *pseudoHeader,
+   TcpHeader *segment, uint8_t flags, uint32_t seqNum, uint32_t ackNum,
+   uint16_t window, uint16_t mss)
+{
+   error_t error;
+   size_t offset;
+   size_t length;
+   uint_t timeToLive;
+   ChunkedBuffer *buffer;
+   TcpHeader *segment2;
+   IpPseudoHeader pseudoHeader2;
+
+   //Allocate a memory buffer to hold the segment
+   buffer = ipAllocBuffer(TCP_MAX_HEADER_LENGTH, &offset);
    //Failed to allocate memory?
    if(!buffer) return ERROR_OUT_OF_MEMORY;
 
@@ -321,10 +597,22 @@ error_t tcpSendResetSegment(NetInterface *interface,
    segment2->dataOffset = 5;
    segment2->flags = flags;
    segment2->reserved2 = 0;
-   segment2->window = 0;
+   segment2->window = htons(window);
    segment2->checksum = 0;
    segment2->urgentPointer = 0;
 
+   //Append the MSS option, if any
+   if(mss)
+   {
+      mss = htons(mss);
+      tcpAddOption(segment2, TCP_OPTION_MAX_SEGMENT_SIZE, &mss, sizeof(mss));
+   }
+
+   //Length of the resulting segment
+   length = segment2->dataOffset * 4;
+   //Adjust the length of the multi-part buffer
+   chunkedBufferSetLength(buffer, offset + length);
+
 #if (IPV4_SUPPORT == ENABLED)
    //Destination address is an IPv4 address?
    if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
@@ -335,11 +623,15 @@ error_t tcpSendResetSegment(NetInterface *interface,
       pseudoHeader2.ipv4Data.destAddr = pseudoHeader->ipv4Data.srcAddr;
       pseudoHeader2.ipv4Data.reserved = 0;
       pseudoHeader2.ipv4Data.protocol = IPV4_PROTOCOL_TCP;
-      pseudoHeader2.ipv4Data.length = HTONS(sizeof(TcpHeader));
+      pseudoHeader2.ipv4Data.length = htons(length);
 
-      //Calculate TCP header checksum
-      segment2->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader2.ipv4Data,
-         sizeof(Ipv4PseudoHeader), buffer, offset, sizeof(TcpHeader));
+      //Calculate TCP header checksum, unless the hardware inserts it
+      if(!ipv4IsChecksumOffloaded(interface,
+         pseudoHeader2.ipv4Data.destAddr, length))
+      {
+         segment2->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader2.ipv4Data,
+            sizeof(Ipv4PseudoHeader), buffer, offset, length);
+      }
 
       //Set TTL value
       timeToLive = IPV4_DEFAULT_TTL;
@@ -354,13 +646,16 @@ error_t tcpSendResetSegment(NetInterface *interface,
       pseudoHeader2.length = sizeof(Ipv6PseudoHeader);
       pseudoHeader2.ipv6Data.srcAddr = pseudoHeader->ipv6Data.destAddr;
       pseudoHeader2.ipv6Data.destAddr = pseudoHeader->ipv6Data.srcAddr;
-      pseudoHeader2.ipv6Data.length = HTONL(sizeof(TcpHeader));
+      pseudoHeader2.ipv6Data.length = htonl(length);
       pseudoHeader2.ipv6Data.reserved = 0;
       pseudoHeader2.ipv6Data.nextHeader = IPV6_TCP_HEADER;
 
-      //Calculate TCP header checksum
-      segment2->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader2.ipv6Data,
-         sizeof(Ipv6PseudoHeader), buffer, offset, sizeof(TcpHeader));
+      //Calculate TCP header checksum, unless the segment is sent to the local host
+      if(!ipv6IsLocalHostAddr(interface, &pseudoHeader2.ipv6Data.destAddr))
+      {
+         segment2->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader2.ipv6Data,
+            sizeof(Ipv6PseudoHeader), buffer, offset, length);
+      }
 
       //Set Hop Limit value
       timeToLive = IPV6_DEFAULT_HOP_LIMIT;
@@ -375,13 +670,21 @@ error_t tcpSendResetSegment(NetInterface *interface,
       return ERROR_INVALID_ADDRESS;
    }
 
-   //Debug message
-   TRACE_DEBUG("%s: Sending TCP reset segment...\r\n", timeFormat(osGetTickCount()));
    //Dump TCP header contents for debugging purpose
-   tcpDumpHeader(segment2, length, 0, 0);
+   tcpDumpHeader(segment2, 0, 0, 0);
 
    //Send TCP segment
-   error = ipSendDatagram(interface, &pseudoHeader2, buffer, offset, timeToLive);
+   error = ipSendDatagram(interface, &pseudoHeader2, buffer, offset, timeToLive, 0, NULL);
+
+   //Successful transmission?
+   if(!error)
+   {
+      //Update TCP statistics
+      TCP_MIB_INC(tcpOutSegs);
+      //Count the resets sent
+      if(flags & TCP_FLAG_RST)
+         TCP_MIB_INC(tcpOutRsts);
+   }
 
    //Free previously allocated memory
    chunkedBufferFree(buffer);
@@ -390,6 +693,50 @@ error_t tcpSendResetSegment(NetInterface *interface,
 }
 
 
+/**
+ * @brief Get the largest segment size that fits in the MTU
+ *
+ * When path MTU discovery is enabled, the path MTU of the remote
+ * host is used instead of the MTU of the interface
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] remoteIpAddr IP address of the remote host
+ * @return Maximum segment size, never larger than TCP_MAX_MSS
+ **/
+
+uint_t tcpGetMaxMss(NetInterface *interface, const IpAddr *remoteIpAddr)
+{
+   size_t mtu;
+   size_t headerLength;
+
+   //The interface is not known yet?
+   if(interface == NULL)
+      return TCP_MAX_MSS;
+
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 is used?
+   if(remoteIpAddr->length == sizeof(Ipv6Addr))
+      headerLength = sizeof(Ipv6Header) + sizeof(TcpHeader);
+   else
+#endif
+   //IPv4 is used?
+   {
+      headerLength = sizeof(Ipv4Header) + sizeof(TcpHeader);
+   }
+
+#if (IP_PMTU_SUPPORT == ENABLED)
+   //Largest packet that can reach the remote host
+   mtu = ipGetPathMtu(interface, remoteIpAddr);
+#else
+   //Largest packet that can be sent on the interface
+   mtu = interface->mtu;
+#endif
+
+   //Subtract the size of the fixed headers from the MTU
+   return min(TCP_MAX_MSS, mtu - headerLength);
+}
+
+
 /**
  * @brief Append an option to a TCP segment
  * @param[in] segment Pointer to the TCP header
@@ -494,6 +841,164 @@ TcpOption *tcpGetOption(TcpHeader *segment, uint8_t kind)
 }
 
 
+/**
+ * @brief Compute the window shift count for a given receive buffer
+ * @param[in] bufferSize Size of the receive buffer
+ * @return Smallest shift count that lets the whole buffer be advertised
+ **/
+
+uint_t tcpGetWindowShift(size_t bufferSize)
+{
+   uint_t shift = 0;
+
+   //The window field is limited to 16 bits
+   while(shift < TCP_MAX_WINDOW_SHIFT && (bufferSize >> shift) > UINT16_MAX)
+      shift++;
+
+   //Return the shift count
+   return shift;
+}
+
+
+/**
+ * @brief Compute the value of the window field of an outgoing segment
+ * @param[in] socket Handle referencing the socket
+ * @param[in] flags Control flags of the segment
+ * @return Window value, in host byte order
+ **/
+
+uint16_t tcpGetAdvertisedWindow(Socket *socket, uint8_t flags)
+{
+   uint32_t window;
+
+   //The window field in a SYN segment is never scaled
+   if(flags & TCP_FLAG_SYN)
+      window = socket->rcvWnd;
+   else
+      window = socket->rcvWnd >> socket->rcvWndShift;
+
+   //Make sure the value fits in the window field
+   return (uint16_t) min(window, UINT16_MAX);
+}
+
+
+/**
+ * @brief Retrieve the send window carried by an incoming segment
+ * @param[in] socket Handle referencing the socket
+ * @param[in] segment Incoming TCP segment (host byte order)
+ * @return Send window, in bytes
+ **/
+
+uint32_t tcpGetSendWindow(Socket *socket, const TcpHeader *segment)
+{
+   //The window field in a SYN segment is never scaled
+   if(segment->flags & TCP_FLAG_SYN)
+      return segment->window;
+   else
+      return (uint32_t) segment->window << socket->sndWndShift;
+}
+
+
+/**
+ * @brief Verify the checksum of an incoming segment
+ *
+ * When the segment carries the next in-order data of a synchronized
+ * connection, the payload is copied to the receive buffer while the
+ * checksum is being calculated. The copy lies beyond RCV.NXT, so it is
+ * harmless until the segment is accepted by tcpProcessSegmentData
+ *
+ * @param[in] socket Handle referencing the matching socket (may be NULL)
+ * @param[in] pseudoHeader TCP pseudo header
+ * @param[in] buffer Multi-part buffer that holds the incoming TCP segment
+ * @param[in] offset Offset to the first byte of the TCP header
+ * @param[in] length Length of the TCP segment
+ * @return Error code
+ **/
+
+error_t tcpVerifyChecksum(Socket *socket, IpPseudoHeader *pseudoHeader,
+   const ChunkedBuffer *buffer, size_t offset, size_t length)
+{
+   size_t n;
+   size_t headerLength;
+   size_t dataLength;
+   uint16_t checksum;
+   uint16_t temp;
+   TcpHeader *segment;
+
+   //Point to the TCP header
+   segment = chunkedBufferAt(buffer, offset);
+
+   //Length of the TCP header and of the segment data
+   headerLength = segment->dataOffset * 4;
+   dataLength = length - headerLength;
+
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+   //The receive buffer is allocated when data actually arrives
+   if(socket != NULL && socket->state == TCP_STATE_ESTABLISHED && dataLength > 0)
+   {
+      //Do not copy the payload ahead of time if memory is short
+      if(tcpAllocRxBuffer(socket))
+         socket = NULL;
+   }
+#endif
+
+   //Check whether the payload can be copied ahead of time
+   if(socket != NULL && socket->state == TCP_STATE_ESTABLISHED &&
+      dataLength > 0 && dataLength <= socket->rcvWnd &&
+      ntohl(segment->seqNum) == socket->rcvNxt && !socket->sackBlockCount)
+   {
+      //Offset of the first byte to write in the circular buffer
+      n = (socket->rcvNxt - socket->irs - 1) % socket->rxBufferSize;
+
+      //Check whether the specified data crosses buffer boundaries
+      if((n + dataLength) <= socket->rxBufferSize)
+      {
+         //Copy the payload and calculate its checksum
+         checksum = ipCopyChecksumEx((ChunkedBuffer *) &socket->rxBuffer, n,
+            buffer, offset + headerLength, dataLength);
+      }
+      else
+      {
+         //Copy the first part of the payload
+         checksum = ipCopyChecksumEx((ChunkedBuffer *) &socket->rxBuffer, n,
+            buffer, offset + headerLength, socket->rxBufferSize - n);
+         //Wrap around to the beginning of the circular buffer
+         temp = ipCopyChecksumEx((ChunkedBuffer *) &socket->rxBuffer, 0,
+            buffer, offset + headerLength + socket->rxBufferSize - n,
+            dataLength - socket->rxBufferSize + n);
+
+         //Combine the checksums of both parts
+         checksum = ipCombineChecksum(checksum, temp, socket->rxBufferSize - n);
+      }
+
+      //Add the TCP header and the pseudo header
+      checksum = ipCombineChecksum(ipCalcChecksumEx(buffer,
+         offset, headerLength), checksum, headerLength);
+      checksum = ipCombineChecksum(ipCalcChecksum(pseudoHeader->data,
+         pseudoHeader->length), checksum, pseudoHeader->length);
+
+      //The 1's complement sum of a valid segment is 0xFFFF
+      if(checksum != 0x0000)
+         return ERROR_WRONG_CHECKSUM;
+
+      //The payload does not need to be copied again
+      socket->rxPrecopied = dataLength;
+   }
+   else
+   {
+      //Verify TCP checksum
+      if(ipCalcUpperLayerChecksumEx(pseudoHeader->data,
+         pseudoHeader->length, buffer, offset, length) != 0xFFFF)
+      {
+         return ERROR_WRONG_CHECKSUM;
+      }
+   }
+
+   //Successful verification
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Test the sequence number of an incoming segment
  * @param[in] socket Handle referencing the current socket
@@ -507,6 +1012,45 @@ error_t tcpCheckSequenceNumber(Socket *socket, TcpHeader *segment, size_t length
    //Acceptability test for an incoming segment
    bool_t acceptable = FALSE;
 
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   uint32_t tsVal = 0;
+   TcpOption *option = NULL;
+
+   //Timestamps in use on this connection?
+   if(socket->tsFlag)
+   {
+      //Get the Timestamps option
+      option = tcpGetOption(segment, TCP_OPTION_TIMESTAMP);
+
+      //Specified option found?
+      if(option && option->length == 10)
+      {
+         //Retrieve TSval
+         memcpy(&tsVal, option->value, 4);
+         //Convert from network byte order to host byte order
+         tsVal = ntohl(tsVal);
+
+         //PAWS: a segment whose TSval is older than TS.Recent is a duplicate
+         //from an earlier wrap of the sequence space. RST segments are
+         //acceptable regardless of their timestamp (refer to RFC 7323 5.3)
+         if(!(segment->flags & TCP_FLAG_RST) && TCP_CMP_SEQ(tsVal, socket->tsRecent) < 0)
+         {
+            //Debug message
+            TRACE_WARNING("Segment rejected by PAWS!\r\n");
+            //Send an acknowledgment in reply
+            tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
+            //Drop the segment
+            return ERROR_FAILURE;
+         }
+      }
+      else
+      {
+         //The option is not present
+         option = NULL;
+      }
+   }
+#endif
+
    //Case where both segment length and receive window are zero
    if(!length && !socket->rcvWnd)
    {
@@ -548,6 +1092,16 @@ error_t tcpCheckSequenceNumber(Socket *socket, TcpHeader *segment, size_t length
       return ERROR_FAILURE;
    }
 
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   //TS.Recent is updated from segments that cover Last.ACK.sent
+   //(refer to RFC 7323 section 4.3)
+   if(option && TCP_CMP_SEQ(tsVal, socket->tsRecent) >= 0 &&
+      TCP_CMP_SEQ(segment->seqNum, socket->tsLastAckSent) <= 0)
+   {
+      socket->tsRecent = tsVal;
+   }
+#endif
+
    //Sequence number is acceptable
    return NO_ERROR;
 }
@@ -616,17 +1170,30 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
    //be updated (see RFC 1122 4.2.2.20)
    else
    {
+      //Window advertised by the peer, once scaled
+      uint32_t window = tcpGetSendWindow(socket, segment);
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+      //Record the segments that the peer reports as received
+      if(socket->sackPermitted)
+         tcpUpdateScoreboard(socket, segment);
+#endif
       //Check whether the SYN bit or the FIN bit is set
       if(segment->flags & (TCP_FLAG_SYN | TCP_FLAG_FIN))
          length++;
 
+#if (TCP_INFO_SUPPORT == ENABLED)
+      //Record the time at which an acceptable ACK was last received
+      socket->stats.lastAckRecv = osGetTickCount();
+#endif
+
       //An acknowledgment is considered a duplicate when the receiver of the
       //ACK has outstanding data, the incoming acknowledgment carries no data,
       //the SYN and FIN bits are both off, the acknowledgment number is equal
       //to the greatest acknowledgment received on the given connection and the
       //advertised window in the incoming acknowledgment equals the advertised
       //window in the last incoming acknowledgment (refer to RFC 5681 section 2)
-      if(socket->retransmitQueue && !length && segment->ackNum == socket->sndUna)
+      if(socket->retransmitQueueCount > 0 && !length && segment->ackNum == socket->sndUna)
          socket->dupAckCount++;
       else
          socket->dupAckCount = 0;
@@ -637,15 +1204,15 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
          //TCP may ignore a window update with a smaller window than
          //previously offered if neither the sequence number nor the
          //acknowledgment number is increased (see RFC 1122 4.2.2.16)
-         if(segment->window > socket->sndWnd)
+         if(window > socket->sndWnd)
          {
             //Update the send window and record the sequence number and
             //the acknowledgment number used to update SND.WND
-            socket->sndWnd = segment->window;
+            socket->sndWnd = window;
             socket->sndWl1 = segment->seqNum;
             socket->sndWl2 = segment->ackNum;
             //Maximum send window it has seen so far on the connection
-            socket->maxSndWnd = max(socket->maxSndWnd, segment->window);
+            socket->maxSndWnd = max(socket->maxSndWnd, window);
 
             //Reset duplicate ACK counter since the advertised window
             //has changed (refer to RFC 5681 section 2)
@@ -657,21 +1224,25 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
          TCP_CMP_SEQ(segment->ackNum, socket->sndWl2) >= 0)
       {
          //The remote host advertises a zero window?
-         if(!segment->window && socket->sndWnd)
+         if(!window && socket->sndWnd)
          {
+#if (TCP_INFO_SUPPORT == ENABLED)
+            //Number of times the peer closed its window
+            socket->stats.zeroWindowEvents++;
+#endif
             //Start the persist timer
             socket->wndProbeCount = 0;
             socket->wndProbeInterval = TCP_DEFAULT_PROBE_INTERVAL;
-            osTimerStart(&socket->persistTimer, socket->wndProbeInterval);
+            tcpStartTimer(socket, &socket->persistTimer, socket->wndProbeInterval);
          }
 
          //Update the send window and record the sequence number and
          //the acknowledgment number used to update SND.WND
-         socket->sndWnd = segment->window;
+         socket->sndWnd = window;
          socket->sndWl1 = segment->seqNum;
          socket->sndWl2 = segment->ackNum;
          //Maximum send window it has seen so far on the connection
-         socket->maxSndWnd = max(socket->maxSndWnd, segment->window);
+         socket->maxSndWnd = max(socket->maxSndWnd, window);
 
          //Reset duplicate ACK counter since the advertised window
          //has changed (refer to RFC 5681 section 2)
@@ -681,40 +1252,27 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
       //The incoming ACK segment acknowledges new data?
       if(TCP_CMP_SEQ(segment->ackNum, socket->sndUna) > 0)
       {
-         //Compute the number of bytes acknowledged by the incoming ACK
-         uint_t n = segment->ackNum - socket->sndUna;
-         //Total number of bytes acknowledged during the whole round-trip
-         socket->n += n;
+         //No timestamp echoed so far
+         uint32_t tsEcr = 0;
 
-         //Slow start algorithm is used when cwnd is lower than ssthresh
-         if(socket->cwnd < socket->ssthresh)
-         {
-            //During slow start, TCP increments cwnd by at most SMSS bytes
-            //for each ACK received that cumulatively acknowledges new data
-            socket->cwnd += min(n, socket->mss);
-         }
-         //Congestion avoidance algorithm is used when cwnd exceeds ssthres
-         else
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+         //Timestamps in use on this connection?
+         if(socket->tsFlag)
          {
-            //Congestion window is updated once per RTT
-            if(socket->rttBusy && TCP_CMP_SEQ(segment->ackNum, socket->rttSeqNum) > 0)
+            //Get the Timestamps option
+            TcpOption *option = tcpGetOption(segment, TCP_OPTION_TIMESTAMP);
+
+            //Retrieve TSecr
+            if(option && option->length == 10)
             {
-               //TCP must not increment cwnd by more than SMSS bytes
-               socket->cwnd += min(socket->n, socket->mss);
+               memcpy(&tsEcr, option->value + 4, 4);
+               tsEcr = ntohl(tsEcr);
             }
          }
+#endif
 
-         //Limit the size of the congestion window
-         socket->cwnd = min(socket->cwnd, socket->txBufferSize);
-         //Update SND.UNA pointer
-         socket->sndUna = segment->ackNum;
-
-         //Compute retransmission timeout
-         tcpComputeRto(socket);
-
-         //Any segments on the retransmission queue which are thereby
-         //entirely acknowledged are removed
-         tcpUpdateRetransmitQueue(socket);
+         //Update SND.UNA and the congestion state
+         tcpProcessNewAck(socket, segment->ackNum, tsEcr);
       }
       //The incoming ACK segment does not acknowledge new data?
       else
@@ -725,17 +1283,36 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
             TRACE_INFO("TCP duplicate ACK #%u\r\n", socket->dupAckCount);
          }
 
-         //Check the number of duplicate ACKs that have been received
-         if(socket->dupAckCount == TCP_FAST_RETRANSMIT_THRES)
+#if (TCP_SACK_SUPPORT == ENABLED)
+         //SACK-based loss recovery (refer to RFC 6675)
+         if(socket->sackPermitted)
+         {
+            //Repair the holes reported by the peer
+            tcpSackRecovery(socket);
+         }
+         else
+#endif
+         //Check the number of duplicate ACKs that have been received. Fast
+         //retransmit is not invoked again for the same window of data, as
+         //long as the ACK does not cover more than the recovery point
+         if(socket->dupAckCount == TCP_FAST_RETRANSMIT_THRES && !socket->fastRecovery &&
+            TCP_CMP_SEQ(segment->ackNum, socket->recover) > 0)
          {
-            //Amount of data that has been sent but not yet acknowledged
-            uint_t flightSize = socket->sndNxt - socket->sndUna;
             //After receiving 3 duplicate ACKs, ssthresh must be adjusted
-            socket->ssthresh = max(flightSize / 2, 2 * socket->mss);
+            socket->congestionAlgo->lossDetected(socket);
+            //Record the highest sequence number transmitted so far
+            socket->recover = socket->sndNxt;
+            //Enter fast recovery (refer to RFC 6582)
+            socket->fastRecovery = TRUE;
 
             //Debug message
             TRACE_INFO("%s: TCP fast retransmit...\r\n", timeFormat(osGetTickCount()));
 
+#if (TCP_INFO_SUPPORT == ENABLED)
+            //Number of fast retransmissions
+            socket->stats.fastRetransmits++;
+#endif
+
             //TCP performs a retransmission of what appears to be the missing
             //segment, without waiting for the retransmission timer to expire
             tcpRetransmitSegment(socket);
@@ -745,9 +1322,9 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
             //left the network and which the receiver has buffered
             socket->cwnd = socket->ssthresh + TCP_FAST_RETRANSMIT_THRES * socket->mss;
          }
-         else if(socket->dupAckCount > TCP_FAST_RETRANSMIT_THRES)
+         else if(socket->fastRecovery)
          {
-            //For each additional duplicate ACK received (after the third),
+            //For each additional duplicate ACK received during fast recovery,
             //cwnd must be incremented by SMSS. This artificially inflates
             //the congestion window in order to reflect the additional
             //segment that has left the network
@@ -758,6 +1335,11 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
          socket->cwnd = min(socket->cwnd, socket->txBufferSize);
       }
 
+#if (TCP_RACK_SUPPORT == ENABLED)
+      //Schedule a tail loss probe for the remaining flight
+      tcpRackProcessAck(socket);
+#endif
+
       //Update TX events
       tcpUpdateEvents(socket);
    }
@@ -767,6 +1349,295 @@ error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length)
 }
 
 
+/**
+ * @brief Process an ACK that acknowledges new data
+ * @param[in] socket Handle referencing the current socket
+ * @param[in] ackNum Acknowledgment number (SND.UNA < SEG.ACK <= SND.NXT)
+ * @param[in] tsEcr Timestamp echoed by the peer (0 if not available)
+ **/
+
+void tcpProcessNewAck(Socket *socket, uint32_t ackNum, uint32_t tsEcr)
+{
+   uint_t n;
+
+   //Compute the number of bytes acknowledged by the incoming ACK
+   n = ackNum - socket->sndUna;
+   //Total number of bytes acknowledged during the whole round-trip
+   socket->n += n;
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   //Timestamps in use on this connection?
+   if(socket->tsFlag)
+   {
+      //Valid echoed timestamp?
+      if(tsEcr != 0)
+      {
+         //An ACK that echoes a timestamp older than the retransmission
+         //was triggered by the original segment, hence the timeout
+         //was spurious (refer to RFC 3522)
+         if(socket->tsRtoFlag && TCP_CMP_SEQ(tsEcr, socket->tsRtoVal) < 0)
+         {
+            //Debug message
+            TRACE_INFO("%s: TCP spurious retransmission detected...\r\n",
+               timeFormat(osGetTickCount()));
+
+            //Restore the congestion state prior to the timeout
+            socket->cwnd = socket->tsPrevCwnd;
+            socket->ssthresh = socket->tsPrevSsthresh;
+         }
+
+         //Every ACK that acknowledges new data yields an RTT sample
+         tcpUpdateRto(socket, (uint32_t) osGetTickCount() - tsEcr);
+      }
+
+      //The timeout has been confirmed or ruled out
+      socket->tsRtoFlag = FALSE;
+   }
+#endif
+
+#if (TCP_INFO_SUPPORT == ENABLED)
+   //Number of bytes acknowledged by the peer
+   socket->stats.bytesAcked += n;
+#endif
+
+   //The congestion window is not increased during loss recovery
+   if(!socket->fastRecovery)
+   {
+      //Let the congestion control algorithm grow the window
+      socket->congestionAlgo->ackReceived(socket, ackNum, n);
+   }
+
+   //Limit the size of the congestion window
+   socket->cwnd = min(socket->cwnd, socket->txBufferSize);
+   //Update SND.UNA pointer
+   socket->sndUna = ackNum;
+
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+   //Give the send buffer back to the pool once all the data
+   //has been acknowledged
+   tcpReleaseTxBuffer(socket);
+#endif
+
+   //Compute retransmission timeout
+   tcpComputeRto(socket);
+
+   //Any segments on the retransmission queue which are thereby
+   //entirely acknowledged are removed
+   tcpUpdateRetransmitQueue(socket);
+
+#if (TCP_SACK_SUPPORT == ENABLED)
+   //Repair the holes reported by the peer
+   if(socket->sackPermitted)
+   {
+      tcpSackRecovery(socket);
+   }
+   else
+#endif
+   //NewReno fast recovery in progress?
+   if(socket->fastRecovery)
+   {
+      //Full acknowledgment?
+      if(TCP_CMP_SEQ(ackNum, socket->recover) >= 0)
+      {
+         //Amount of data that has been sent but not yet acknowledged
+         uint_t flightSize = socket->sndNxt - socket->sndUna;
+
+         //Deflate the congestion window (refer to RFC 6582 3.2 step 3)
+         socket->cwnd = min(socket->ssthresh, max(flightSize, socket->mss) + socket->mss);
+         //Exit fast recovery
+         socket->fastRecovery = FALSE;
+
+         //Debug message
+         TRACE_INFO("%s: TCP fast recovery complete...\r\n", timeFormat(osGetTickCount()));
+      }
+      //Partial acknowledgment?
+      else
+      {
+         //Debug message
+         TRACE_INFO("%s: TCP partial ACK...\r\n", timeFormat(osGetTickCount()));
+
+         //The first unacknowledged segment is lost as well, and is
+         //retransmitted without waiting for the retransmission timer
+         tcpRetransmitSegment(socket);
+
+         //Deflate the congestion window by the amount of new data
+         //acknowledged, then add back one SMSS if that amount is at
+         //least SMSS (refer to RFC 6582 3.2 step 3)
+         socket->cwnd = (socket->cwnd > n) ? (socket->cwnd - n) : 0;
+         if(n >= socket->mss)
+            socket->cwnd += socket->mss;
+
+         //Make sure the congestion window is not empty
+         socket->cwnd = max(socket->cwnd, socket->mss);
+      }
+   }
+}
+
+
+#if (TCP_HEADER_PREDICTION_SUPPORT == ENABLED)
+
+/**
+ * @brief Header prediction
+ *
+ * On an established connection, most segments are either the next
+ * in-order data segment or a pure ACK for new data, with an unchanged
+ * window and no option but the Timestamps option. Such segments skip the
+ * generic processing (sequence number acceptability test, RST/SYN checks,
+ * option parsing, duplicate ACK and window update logic)
+ *
+ * @param[in] socket Handle referencing the current socket
+ * @param[in] segment Incoming TCP segment
+ * @param[in] buffer Multi-part buffer containing the incoming TCP segment
+ * @param[in] offset Offset to the first data byte
+ * @param[in] length Length of the segment data
+ * @return NO_ERROR if the segment has been processed, ERROR_FAILURE if
+ *   the segment must go through the generic processing
+ **/
+
+error_t tcpPredictHeader(Socket *socket, TcpHeader *segment,
+   const ChunkedBuffer *buffer, size_t offset, size_t length)
+{
+   uint32_t tsEcr;
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   uint32_t tsVal = 0;
+#endif
+
+   //Only the ACK flag (and optionally the PSH flag) may be set
+   if((segment->flags & ~TCP_FLAG_PSH) != TCP_FLAG_ACK)
+      return ERROR_FAILURE;
+   //The segment must start with the next sequence number expected
+   if(segment->seqNum != socket->rcvNxt)
+      return ERROR_FAILURE;
+   //Loss recovery is handled by the generic processing
+   if(socket->fastRecovery)
+      return ERROR_FAILURE;
+
+   //No timestamp echoed so far
+   tsEcr = 0;
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   //Timestamps in use on this connection?
+   if(socket->tsFlag)
+   {
+      //The Timestamps option is expected alone, in the layout recommended
+      //by RFC 7323 appendix A (two NOP options followed by the option)
+      if(segment->dataOffset != 8 ||
+         segment->options[0] != TCP_OPTION_NOP ||
+         segment->options[1] != TCP_OPTION_NOP ||
+         segment->options[2] != TCP_OPTION_TIMESTAMP ||
+         segment->options[3] != 10)
+      {
+         return ERROR_FAILURE;
+      }
+
+      //Retrieve TSval and TSecr
+      memcpy(&tsVal, segment->options + 4, 4);
+      memcpy(&tsEcr, segment->options + 8, 4);
+      tsVal = ntohl(tsVal);
+      tsEcr = ntohl(tsEcr);
+
+      //Segments rejected by PAWS are handled by the generic processing
+      if(TCP_CMP_SEQ(tsVal, socket->tsRecent) < 0)
+         return ERROR_FAILURE;
+      //So are ACKs that may reveal a spurious timeout
+      if(socket->tsRtoFlag)
+         return ERROR_FAILURE;
+   }
+   else
+#endif
+   {
+      //No option is expected
+      if(segment->dataOffset != 5)
+         return ERROR_FAILURE;
+   }
+
+   //The window advertised by the peer must not change
+   if(tcpGetSendWindow(socket, segment) != socket->sndWnd)
+      return ERROR_FAILURE;
+   //The segment must be more recent than the last window update
+   if(TCP_CMP_SEQ(segment->seqNum, socket->sndWl1) < 0 ||
+      TCP_CMP_SEQ(segment->ackNum, socket->sndWl2) < 0)
+   {
+      return ERROR_FAILURE;
+   }
+
+   //Pure ACK?
+   if(length == 0)
+   {
+      //The ACK must acknowledge new data (SND.UNA < SEG.ACK <= SND.NXT),
+      //which rules out duplicate ACKs
+      if(TCP_CMP_SEQ(segment->ackNum, socket->sndUna) <= 0 ||
+         TCP_CMP_SEQ(segment->ackNum, socket->sndNxt) > 0)
+      {
+         return ERROR_FAILURE;
+      }
+   }
+   //In-order data?
+   else
+   {
+      //No data must be in flight, and no out-of-order data queued
+      if(segment->ackNum != socket->sndUna || socket->retransmitQueueCount > 0 ||
+         socket->sackBlockCount > 0)
+      {
+         return ERROR_FAILURE;
+      }
+
+      //The data must fit in the receive window
+      if(length > socket->rcvWnd)
+         return ERROR_FAILURE;
+   }
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   //TS.Recent is updated from segments that cover Last.ACK.sent
+   //(refer to RFC 7323 section 4.3)
+   if(socket->tsFlag && TCP_CMP_SEQ(segment->seqNum, socket->tsLastAckSent) <= 0)
+      socket->tsRecent = tsVal;
+#endif
+
+   //Record the sequence number and the acknowledgment number
+   //used to update SND.WND
+   socket->sndWl1 = segment->seqNum;
+   socket->sndWl2 = segment->ackNum;
+
+   //The segment is not a duplicate ACK
+   socket->dupAckCount = 0;
+
+#if (TCP_INFO_SUPPORT == ENABLED)
+   //Record the time at which an acceptable ACK was last received
+   socket->stats.lastAckRecv = osGetTickCount();
+#endif
+
+   //Pure ACK?
+   if(length == 0)
+   {
+      //Update SND.UNA and the congestion state
+      tcpProcessNewAck(socket, segment->ackNum, tsEcr);
+
+#if (TCP_RACK_SUPPORT == ENABLED)
+      //Schedule a tail loss probe for the remaining flight
+      tcpRackProcessAck(socket);
+#endif
+
+      //Update TX events
+      tcpUpdateEvents(socket);
+
+      //The acknowledged data leave room for more data to be sent
+      tcpNagleAlgo(socket);
+   }
+   //In-order data?
+   else
+   {
+      //Append the data to the receive buffer
+      tcpProcessSegmentData(socket, segment, buffer, offset, length);
+   }
+
+   //The segment has been processed
+   return NO_ERROR;
+}
+
+#endif
+
+
 /**
  * @brief Process the segment text
  * @param[in] socket Handle referencing the current socket
@@ -783,6 +1654,20 @@ void tcpProcessSegmentData(Socket *socket, TcpHeader *segment,
    uint32_t leftEdge = segment->seqNum;
    //Sequence number immediately following the incoming segment
    uint32_t rightEdge = segment->seqNum + length;
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+   //Number of out-of-order blocks queued before this segment
+   uint_t blockCount = socket->sackBlockCount;
+#endif
+
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+   //Make sure the receive buffer is available. Otherwise the segment
+   //is dropped and the remote host will retransmit it
+   if(tcpAllocRxBuffer(socket))
+   {
+      socket->rxPrecopied = 0;
+      return;
+   }
+#endif
 
    //Check whether some data falls outside the receive window
    if(TCP_CMP_SEQ(leftEdge, socket->rcvNxt) < 0)
@@ -798,8 +1683,13 @@ void tcpProcessSegmentData(Socket *socket, TcpHeader *segment,
       rightEdge = socket->rcvNxt + socket->rcvWnd;
    }
 
-   //Copy the incoming data to the receive buffer
-   tcpWriteRxBuffer(socket, leftEdge, buffer, offset, rightEdge - leftEdge);
+   //Copy the incoming data to the receive buffer, unless this was
+   //already done while the checksum was being verified
+   if(leftEdge != segment->seqNum || (rightEdge - leftEdge) > socket->rxPrecopied)
+      tcpWriteRxBuffer(socket, leftEdge, buffer, offset, rightEdge - leftEdge);
+
+   //The data has been consumed
+   socket->rxPrecopied = 0;
 
    //Update the list of non-contiguous blocks of data that
    //have been received and queued
@@ -824,8 +1714,54 @@ void tcpProcessSegmentData(Socket *socket, TcpHeader *segment,
       //Update the receive window
       socket->rcvWnd -= length;
 
-      //Acknowledge the received data (delayed ACK not supported)
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+      //Number of bytes received during the current round-trip
+      socket->rxRttBytes += length;
+
+      //Measure the amount of data the peer delivers per round-trip
+      if((osGetTickCount() - socket->rxRttStart) >= (socket->srtt ? socket->srtt : socket->rto))
+      {
+         socket->rxBdp = max(socket->rxBdp, socket->rxRttBytes);
+         socket->rxRttStart = osGetTickCount();
+         socket->rxRttBytes = 0;
+      }
+#endif
+
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+      //Number of bytes received since the last ACK was sent
+      socket->ackDelayedBytes += length;
+
+      //An ACK should be generated for at least every second full-sized
+      //segment, and immediately when the segment fills in all or part
+      //of a gap in the sequence space (refer to RFC 5681 section 4.2)
+      if(socket->ackDelayedBytes >= (2 * socket->mss) || blockCount > 0)
+      {
+         //Acknowledge the received data
+         tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
+      }
+      else if(!socket->ackDelayed)
+      {
+         //Delay the ACK, hoping that it can be piggybacked on outgoing data
+         socket->ackDelayed = TRUE;
+         tcpStartTimer(socket, &socket->delayedAckTimer, TCP_DELAYED_ACK_TIMEOUT);
+      }
+#else
+      //Acknowledge the received data
       tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
+#endif
+
+#if (TCP_RX_COALESCING_SUPPORT == ENABLED)
+      //Segments received back to back wake the reader only once, at the
+      //end of the batch, unless the sender asked the data to be pushed
+      if(tcpRxBatchCount > 0 && !(segment->flags & TCP_FLAG_PSH))
+      {
+         socket->rxEventPending = TRUE;
+         return;
+      }
+
+      //The reader is being notified
+      socket->rxEventPending = FALSE;
+#endif
       //Notify user task that data is available
       tcpUpdateEvents(socket);
    }
@@ -846,10 +1782,10 @@ void tcpDeleteControlBlock(Socket *socket)
    tcpFlushSynQueue(socket);
 
    //Release transmit buffer
-   chunkedBufferSetLength((ChunkedBuffer *) &socket->txBuffer, 0);
+   tcpFreeBuffer(socket, (ChunkedBuffer *) &socket->txBuffer);
 
    //Release receive buffer
-   chunkedBufferSetLength((ChunkedBuffer *) &socket->rxBuffer, 0);
+   tcpFreeBuffer(socket, (ChunkedBuffer *) &socket->rxBuffer);
 }
 
 
@@ -861,96 +1797,116 @@ void tcpDeleteControlBlock(Socket *socket)
 void tcpUpdateRetransmitQueue(Socket *socket)
 {
    size_t length;
+   TcpQueueItem *queueItem;
 
-   //Point to the first item of the retransmission queue
-   TcpQueueItem *prevQueueItem = NULL;
-   TcpQueueItem *queueItem = socket->retransmitQueue;
-
-   //Loop through retransmission queue
-   while(queueItem != NULL)
+   //Segments are acknowledged in order, hence only the head of
+   //the ring needs to be checked
+   while(socket->retransmitQueueCount > 0)
    {
-      //SYN segment?
-      if(queueItem->header.flags & TCP_FLAG_SYN)
-         length = 1;
-      //FIN segment?
-      else if(queueItem->header.flags & TCP_FLAG_FIN)
+      //Point to the earliest unacknowledged segment
+      queueItem = &socket->retransmitQueue[socket->retransmitQueueHead];
+
+      //SYN or FIN segment? (a SYN may carry data when Fast Open is used)
+      if(queueItem->flags & (TCP_FLAG_SYN | TCP_FLAG_FIN))
          length = queueItem->length + 1;
       //Segment containing data?
       else
          length = queueItem->length;
 
+      //Stop at the first segment that is not entirely acknowledged
+      if(TCP_CMP_SEQ(socket->sndUna, queueItem->seqNum + length) < 0)
+         break;
+
+#if (TCP_RACK_SUPPORT == ENABLED)
+      //Selectively acknowledged segments have already been accounted for
+      if(!queueItem->sacked)
+         tcpRackOnDelivery(socket, queueItem);
+#endif
+
       //If an acknowledgment is received for a segment before its timer
       //expires, the segment is removed from the retransmission queue
-      if(TCP_CMP_SEQ(socket->sndUna, ntohl(queueItem->header.seqNum) + length) >= 0)
-      {
-         //First item of the queue?
-         if(prevQueueItem == NULL)
-         {
-            //Remove the current item from the queue
-            socket->retransmitQueue = queueItem->next;
-            //The item can now be safely deleted
-            memPoolFree(queueItem);
-            //Point to the next item
-            queueItem = socket->retransmitQueue;
-         }
-         else
-         {
-            //Remove the current item from the queue
-            prevQueueItem->next = queueItem->next;
-            //The item can now be safely deleted
-            memPoolFree(queueItem);
-            //Point to the next item
-            queueItem = prevQueueItem->next;
-         }
-
-         //When an ACK is received that acknowledges new data, restart the
-         //retransmission timer so that it will expire after RTO seconds
-         osTimerStart(&socket->retransmitTimer, socket->rto);
-         //Reset retransmission counter
-         socket->retransmitCount = 0;
-      }
-      //No acknowledgment received for the current segment...
-      else
-      {
-         //Point to the next item
-         prevQueueItem = queueItem;
-         queueItem = queueItem->next;
-      }
+      socket->retransmitQueueHead = (socket->retransmitQueueHead + 1) % TCP_RETRANSMIT_QUEUE_SIZE;
+      socket->retransmitQueueCount--;
+
+      //When an ACK is received that acknowledges new data, restart the
+      //retransmission timer so that it will expire after RTO seconds
+      tcpStartTimer(socket, &socket->retransmitTimer, socket->rto);
+      //Reset retransmission counter
+      socket->retransmitCount = 0;
    }
 
    //When all outstanding data has been acknowledged,
    //turn off the retransmission timer
-   if(socket->retransmitQueue == NULL)
+   if(!socket->retransmitQueueCount)
+   {
       osTimerStop(&socket->retransmitTimer);
+#if (TCP_RACK_SUPPORT == ENABLED)
+      osTimerStop(&socket->tlpTimer);
+#endif
+   }
 }
 
 
 /**
- * @brief Flush retransmission queue
+ * @brief Get the earliest segment of the retransmission queue
  * @param[in] socket Handle referencing the socket
+ * @return Pointer to the first item, or NULL if the queue is empty
  **/
 
-void tcpFlushRetransmitQueue(Socket *socket)
+TcpQueueItem *tcpFirstQueueItem(Socket *socket)
 {
-   //Point to the first item in the retransmission queue
-   TcpQueueItem *queueItem = socket->retransmitQueue;
+   //Empty retransmission queue?
+   if(!socket->retransmitQueueCount)
+      return NULL;
 
-   //Loop through retransmission queue
-   while(queueItem != NULL)
-   {
-      //Keep track of the next item in the queue
-      TcpQueueItem *nextQueueItem = queueItem->next;
-      //Free previously allocated memory
-      memPoolFree(queueItem);
-      //Point to the next item
-      queueItem = nextQueueItem;
-   }
+   //Return a pointer to the head of the ring
+   return &socket->retransmitQueue[socket->retransmitQueueHead];
+}
+
+
+/**
+ * @brief Get the segment that follows a given one in the retransmission queue
+ * @param[in] socket Handle referencing the socket
+ * @param[in] queueItem Current item
+ * @return Pointer to the next item, or NULL if the end of the queue is reached
+ **/
+
+TcpQueueItem *tcpNextQueueItem(Socket *socket, TcpQueueItem *queueItem)
+{
+   uint_t i;
+
+   //Position of the current item relative to the head of the ring
+   i = (queueItem - socket->retransmitQueue + TCP_RETRANSMIT_QUEUE_SIZE -
+      socket->retransmitQueueHead) % TCP_RETRANSMIT_QUEUE_SIZE;
+
+   //Last item of the queue?
+   if((i + 1) >= socket->retransmitQueueCount)
+      return NULL;
 
+   //Return a pointer to the next item
+   return &socket->retransmitQueue[(socket->retransmitQueueHead + i + 1) %
+      TCP_RETRANSMIT_QUEUE_SIZE];
+}
+
+
+/**
+ * @brief Flush retransmission queue
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpFlushRetransmitQueue(Socket *socket)
+{
    //The retransmission queue is now flushed
-   socket->retransmitQueue = NULL;
+   socket->retransmitQueueHead = 0;
+   socket->retransmitQueueCount = 0;
 
    //Turn off the retransmission timer
    osTimerStop(&socket->retransmitTimer);
+#if (TCP_RACK_SUPPORT == ENABLED)
+   //Turn off the tail loss probe timer
+   osTimerStop(&socket->tlpTimer);
+   socket->tlpInFlight = FALSE;
+#endif
 }
 
 
@@ -961,62 +1917,245 @@ void tcpFlushRetransmitQueue(Socket *socket)
 
 void tcpFlushSynQueue(Socket *socket)
 {
-   //Point to the first item in the SYN queue
-   TcpSynQueueItem *queueItem = socket->synQueue;
-
-   //Loop through SYN queue
-   while(queueItem != NULL)
-   {
-      //Keep track of the next item in the queue
-      TcpSynQueueItem *nextQueueItem = queueItem->next;
-      //Free previously allocated memory
-      memPoolFree(queueItem);
-      //Point to the next item
-      queueItem = nextQueueItem;
-   }
-
-   //SYN queue was successfully flushed
-   socket->synQueue = NULL;
+   //Release the pending connection requests one by one
+   while(socket->synQueue != NULL)
+      tcpRemoveSynQueueItem(socket, socket->synQueue);
 }
 
 
 /**
- * @brief Update the list of non-contiguous blocks that have been received
- * @param[in] socket Handle referencing the socket
- * @param[in,out] leftEdge First sequence number occupied by the incoming data
- * @param[in,out] rightEdge Sequence number immediately following the incoming data
+ * @brief Get a free SYN queue entry
+ *
+ * The entry is only claimed when tcpAddSynQueueItem() is called
+ *
+ * @param[in] socket Handle referencing the listening socket
+ * @return Pointer to the entry, or NULL if the SYN queue is full
  **/
 
-void tcpUpdateSackBlocks(Socket *socket, uint32_t *leftEdge, uint32_t *rightEdge)
+TcpSynQueueItem *tcpAllocSynQueueItem(Socket *socket)
 {
-   uint_t i = 0;
+   uint_t i;
 
-   //Loop through the blocks
-   while(i < socket->sackBlockCount)
+   //Make sure the SYN queue of the listening socket is not full
+   if(socket->synQueueLength >= TCP_SYN_QUEUE_SIZE)
+      return NULL;
+
+   //Loop through the shared table
+   for(i = 0; i < TCP_SYN_QUEUE_TABLE_SIZE; i++)
    {
-      //Find each block that overlaps the specified one
-      if(TCP_CMP_SEQ(*rightEdge, socket->sackBlock[i].leftEdge) >= 0 &&
-         TCP_CMP_SEQ(*leftEdge, socket->sackBlock[i].rightEdge) <= 0)
+      //Unused entry?
+      if(tcpSynQueueTable[i].socket == NULL)
       {
-         //Merge blocks to form a contiguous one
-         *leftEdge = min(*leftEdge, socket->sackBlock[i].leftEdge);
-         *rightEdge = max(*rightEdge, socket->sackBlock[i].rightEdge);
-         //Delete current block
-         memcpy(socket->sackBlock + i, socket->sackBlock + i + 1,
-            (TCP_MAX_SACK_BLOCKS - i - 1) * sizeof(TcpSackBlock));
-         //Decrement the number of non-contiguous blocks
-         socket->sackBlockCount--;
-         continue;
+         //Clear the entry before use
+         memset(&tcpSynQueueTable[i], 0, sizeof(TcpSynQueueItem));
+         //Return a pointer to the entry
+         return &tcpSynQueueTable[i];
       }
-      //Point to the next block
-      i++;
    }
 
-   //Check whether the incoming segment was received out of order
-   if(TCP_CMP_SEQ(*leftEdge, socket->rcvNxt) > 0)
-   {
-      //Make room for the new non-contiguous block
-      memcpy(socket->sackBlock + 1, socket->sackBlock,
+   //All the entries are in use
+   return NULL;
+}
+
+
+/**
+ * @brief Append a connection request to the SYN queue
+ * @param[in] socket Handle referencing the listening socket
+ * @param[in] queueItem Entry previously returned by tcpAllocSynQueueItem()
+ **/
+
+void tcpAddSynQueueItem(Socket *socket, TcpSynQueueItem *queueItem)
+{
+   uint_t i;
+   TcpSynQueueItem **p;
+
+   //The entry now belongs to the listening socket
+   queueItem->socket = socket;
+   queueItem->next = NULL;
+
+   //Connection requests are accepted in the order they were received
+   for(p = &socket->synQueue; *p != NULL; p = &(*p)->next);
+   *p = queueItem;
+   socket->synQueueLength++;
+
+   //Index the request by its 4-tuple
+   i = tcpHashTuple(socket->localPort, &queueItem->srcAddr, queueItem->srcPort);
+   queueItem->hashNext = tcpSynHashTable[i];
+   tcpSynHashTable[i] = queueItem;
+}
+
+
+/**
+ * @brief Remove a connection request from the SYN queue
+ * @param[in] socket Handle referencing the listening socket
+ * @param[in] queueItem Entry to be removed
+ **/
+
+void tcpRemoveSynQueueItem(Socket *socket, TcpSynQueueItem *queueItem)
+{
+   uint_t i;
+   TcpSynQueueItem **p;
+
+   //Unlink the entry from the SYN queue of the listening socket
+   for(p = &socket->synQueue; *p != NULL; p = &(*p)->next)
+   {
+      if(*p == queueItem)
+      {
+         *p = queueItem->next;
+         socket->synQueueLength--;
+         break;
+      }
+   }
+
+   //Unlink the entry from its hash bucket
+   i = tcpHashTuple(socket->localPort, &queueItem->srcAddr, queueItem->srcPort);
+
+   for(p = &tcpSynHashTable[i]; *p != NULL; p = &(*p)->hashNext)
+   {
+      if(*p == queueItem)
+      {
+         *p = queueItem->hashNext;
+         break;
+      }
+   }
+
+#if (TCP_FAST_OPEN_SUPPORT == ENABLED)
+   //Release the data carried by the SYN, if any
+   if(queueItem->fastOpenData != NULL)
+   {
+      chunkedBufferFree(queueItem->fastOpenData);
+      queueItem->fastOpenData = NULL;
+   }
+#endif
+
+   //Release the entry
+   queueItem->socket = NULL;
+}
+
+
+/**
+ * @brief Find the pending connection request an incoming segment belongs to
+ * @param[in] socket Handle referencing the listening socket
+ * @param[in] interface Underlying network interface
+ * @param[in] pseudoHeader TCP pseudo header
+ * @param[in] segment Incoming TCP segment
+ * @return Pointer to the matching entry, or NULL if there is none
+ **/
+
+TcpSynQueueItem *tcpFindSynQueueItem(Socket *socket, NetInterface *interface,
+   const IpPseudoHeader *pseudoHeader, const TcpHeader *segment)
+{
+   IpAddr srcIpAddr;
+   TcpSynQueueItem *queueItem;
+
+#if (IPV4_SUPPORT == ENABLED)
+   //IPv4 packet received?
+   if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
+   {
+      //Retrieve the source IPv4 address
+      srcIpAddr.length = sizeof(Ipv4Addr);
+      srcIpAddr.ipv4Addr = pseudoHeader->ipv4Data.srcAddr;
+   }
+   else
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 packet received?
+   if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
+   {
+      //Retrieve the source IPv6 address
+      srcIpAddr.length = sizeof(Ipv6Addr);
+      srcIpAddr.ipv6Addr = pseudoHeader->ipv6Data.srcAddr;
+   }
+   else
+#endif
+   //An invalid packet was received?
+   {
+      //This should never occur...
+      return NULL;
+   }
+
+   //Walk through the requests sharing the same hash value
+   for(queueItem = tcpSynHashTable[tcpHashTuple(segment->destPort, &srcIpAddr,
+      segment->srcPort)]; queueItem != NULL; queueItem = queueItem->hashNext)
+   {
+      //Check the listening socket, the interface and the port number
+      if(queueItem->socket != socket || queueItem->interface != interface ||
+         queueItem->srcPort != segment->srcPort)
+      {
+         continue;
+      }
+
+      //Check IP addresses
+      if(queueItem->srcAddr.length != srcIpAddr.length)
+         continue;
+
+#if (IPV4_SUPPORT == ENABLED)
+      if(srcIpAddr.length == sizeof(Ipv4Addr))
+      {
+         if(queueItem->srcAddr.ipv4Addr != srcIpAddr.ipv4Addr ||
+            queueItem->destAddr.ipv4Addr != pseudoHeader->ipv4Data.destAddr)
+         {
+            continue;
+         }
+      }
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+      if(srcIpAddr.length == sizeof(Ipv6Addr))
+      {
+         if(!ipv6CompAddr(&queueItem->srcAddr.ipv6Addr, &srcIpAddr.ipv6Addr) ||
+            !ipv6CompAddr(&queueItem->destAddr.ipv6Addr, &pseudoHeader->ipv6Data.destAddr))
+         {
+            continue;
+         }
+      }
+#endif
+
+      //A matching request has been found
+      return queueItem;
+   }
+
+   //No matching request
+   return NULL;
+}
+
+
+/**
+ * @brief Update the list of non-contiguous blocks that have been received
+ * @param[in] socket Handle referencing the socket
+ * @param[in,out] leftEdge First sequence number occupied by the incoming data
+ * @param[in,out] rightEdge Sequence number immediately following the incoming data
+ **/
+
+void tcpUpdateSackBlocks(Socket *socket, uint32_t *leftEdge, uint32_t *rightEdge)
+{
+   uint_t i = 0;
+
+   //Loop through the blocks
+   while(i < socket->sackBlockCount)
+   {
+      //Find each block that overlaps the specified one
+      if(TCP_CMP_SEQ(*rightEdge, socket->sackBlock[i].leftEdge) >= 0 &&
+         TCP_CMP_SEQ(*leftEdge, socket->sackBlock[i].rightEdge) <= 0)
+      {
+         //Merge blocks to form a contiguous one
+         *leftEdge = min(*leftEdge, socket->sackBlock[i].leftEdge);
+         *rightEdge = max(*rightEdge, socket->sackBlock[i].rightEdge);
+         //Delete current block
+         memcpy(socket->sackBlock + i, socket->sackBlock + i + 1,
+            (TCP_MAX_SACK_BLOCKS - i - 1) * sizeof(TcpSackBlock));
+         //Decrement the number of non-contiguous blocks
+         socket->sackBlockCount--;
+         continue;
+      }
+      //Point to the next block
+      i++;
+   }
+
+   //Check whether the incoming segment was received out of order
+   if(TCP_CMP_SEQ(*leftEdge, socket->rcvNxt) > 0)
+   {
+      //Make room for the new non-contiguous block
+      memcpy(socket->sackBlock + 1, socket->sackBlock,
          (TCP_MAX_SACK_BLOCKS - 1) * sizeof(TcpSackBlock));
       //Insert the element in the list
       socket->sackBlock[0].leftEdge = *leftEdge;
@@ -1027,86 +2166,514 @@ void tcpUpdateSackBlocks(Socket *socket, uint32_t *leftEdge, uint32_t *rightEdge
    }
 }
 
+#if (TCP_SACK_SUPPORT == ENABLED)
+
+/**
+ * @brief Update the scoreboard with the SACK blocks of an incoming ACK
+ * @param[in] socket Handle referencing the socket
+ * @param[in] segment Incoming TCP segment (host byte order)
+ **/
+
+void tcpUpdateScoreboard(Socket *socket, TcpHeader *segment)
+{
+   uint_t i;
+   uint_t n;
+   uint32_t seqNum;
+   uint32_t leftEdge;
+   uint32_t rightEdge;
+   TcpOption *option;
+   TcpQueueItem *queueItem;
+
+   //Get the SACK option
+   option = tcpGetOption(segment, TCP_OPTION_SACK);
+   //Specified option not found?
+   if(!option || option->length < 10)
+      return;
+
+   //Number of blocks in the option
+   n = (option->length - sizeof(TcpOption)) / 8;
+
+   //Loop through the blocks
+   for(i = 0; i < n; i++)
+   {
+      //Retrieve the edges of the current block
+      memcpy(&leftEdge, option->value + i * 8, 4);
+      memcpy(&rightEdge, option->value + i * 8 + 4, 4);
+      leftEdge = ntohl(leftEdge);
+      rightEdge = ntohl(rightEdge);
+
+      //Ignore blocks that do not lie between SND.UNA and SND.NXT
+      if(TCP_CMP_SEQ(leftEdge, socket->sndUna) < 0 ||
+         TCP_CMP_SEQ(rightEdge, socket->sndNxt) > 0 ||
+         TCP_CMP_SEQ(leftEdge, rightEdge) >= 0)
+         continue;
+
+      //Mark the segments that are entirely covered by the block
+      for(queueItem = tcpFirstQueueItem(socket); queueItem != NULL;
+         queueItem = tcpNextQueueItem(socket, queueItem))
+      {
+         //First sequence number of the segment
+         seqNum = queueItem->seqNum;
+
+         //Segments that carry no data are never selectively acknowledged
+         if(queueItem->length > 0 && TCP_CMP_SEQ(seqNum, leftEdge) >= 0 &&
+            TCP_CMP_SEQ(seqNum + queueItem->length, rightEdge) <= 0)
+         {
+#if (TCP_RACK_SUPPORT == ENABLED)
+            //Newly delivered segment?
+            if(!queueItem->sacked)
+               tcpRackOnDelivery(socket, queueItem);
+#endif
+            queueItem->sacked = TRUE;
+         }
+      }
+   }
+}
+
+
+/**
+ * @brief Discard the scoreboard
+ *
+ * The receiver may discard data it has selectively acknowledged, hence
+ * the SACK information is ignored after a retransmission timeout
+ *
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpClearScoreboard(Socket *socket)
+{
+   TcpQueueItem *queueItem;
+
+   //Loop through the retransmission queue
+   for(queueItem = tcpFirstQueueItem(socket); queueItem != NULL;
+      queueItem = tcpNextQueueItem(socket, queueItem))
+   {
+      queueItem->sacked = FALSE;
+      queueItem->retransmitted = FALSE;
+   }
+
+   //Leave loss recovery
+   socket->fastRecovery = FALSE;
+}
+
+
+/**
+ * @brief SACK-based loss recovery
+ *
+ * Called for every acceptable ACK once the scoreboard has been updated.
+ * Enters loss recovery when a segment is deemed lost, then retransmits
+ * the holes as long as the estimated amount of data in flight allows
+ * (refer to RFC 6675)
+ *
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpSackRecovery(Socket *socket)
+{
+   uint_t pipe;
+   TcpQueueItem *queueItem;
+
+   //Loss recovery in progress?
+   if(socket->fastRecovery)
+   {
+      //Recovery ends when all the data outstanding at the time it
+      //started has been acknowledged
+      if(TCP_CMP_SEQ(socket->sndUna, socket->recover) >= 0)
+      {
+         //Debug message
+         TRACE_INFO("%s: TCP loss recovery complete...\r\n", timeFormat(osGetTickCount()));
+         //Leave loss recovery
+         socket->fastRecovery = FALSE;
+         return;
+      }
+   }
+   else
+   {
+      //Nothing to recover?
+      if(!socket->retransmitQueueCount)
+         return;
+
+      //Loss recovery is entered upon the receipt of DupThresh duplicate
+      //ACKs, or as soon as the first unacknowledged segment is deemed lost
+      if(socket->dupAckCount < TCP_FAST_RETRANSMIT_THRES &&
+         !tcpIsSegmentLost(socket, tcpFirstQueueItem(socket)))
+         return;
+
+      //Adjust ssthresh and cwnd
+      socket->congestionAlgo->lossDetected(socket);
+      socket->cwnd = socket->ssthresh;
+      //Highest sequence number transmitted so far
+      socket->recover = socket->sndNxt;
+      //Enter loss recovery
+      socket->fastRecovery = TRUE;
+
+      //Debug message
+      TRACE_INFO("%s: TCP SACK loss recovery...\r\n", timeFormat(osGetTickCount()));
+
+#if (TCP_INFO_SUPPORT == ENABLED)
+      //Number of fast retransmissions
+      socket->stats.fastRetransmits++;
+#endif
+
+      //The first segment that has not been selectively acknowledged
+      //is retransmitted without waiting for the pipe to drain
+      for(queueItem = tcpFirstQueueItem(socket); queueItem != NULL;
+         queueItem = tcpNextQueueItem(socket, queueItem))
+      {
+         if(!queueItem->sacked)
+         {
+            tcpRetransmitQueueItem(socket, queueItem);
+            queueItem->retransmitted = TRUE;
+            break;
+         }
+      }
+   }
+
+   //Estimate the amount of data still in the network
+   pipe = tcpComputePipe(socket);
+
+   //Retransmit every lost segment, as long as cwnd allows
+   for(queueItem = tcpFirstQueueItem(socket); queueItem != NULL;
+      queueItem = tcpNextQueueItem(socket, queueItem))
+   {
+      //Make sure the pipe has room for another segment
+      if((pipe + socket->mss) > socket->cwnd)
+         break;
+
+      //Hole that has not been repaired yet?
+      if(!queueItem->sacked && !queueItem->retransmitted &&
+         tcpIsSegmentLost(socket, queueItem))
+      {
+         //Retransmit the segment
+         if(tcpRetransmitQueueItem(socket, queueItem))
+            break;
+
+         //The segment is in flight again
+         queueItem->retransmitted = TRUE;
+         pipe += queueItem->length;
+      }
+   }
+}
+
+
+/**
+ * @brief Determine whether a segment is deemed lost
+ *
+ * A segment is considered lost when more than (DupThresh - 1) * SMSS
+ * bytes above it have been selectively acknowledged
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] queueItem Segment to check
+ * @return TRUE if the segment is deemed lost, else FALSE
+ **/
+
+static bool_t tcpIsSegmentLost(Socket *socket, TcpQueueItem *queueItem)
+{
+   uint_t n;
+   uint_t count;
+
+   //A selectively acknowledged segment is not lost
+   if(queueItem->sacked)
+      return FALSE;
+
+#if (TCP_RACK_SUPPORT == ENABLED)
+   //A segment sent before a delivered one is lost once the
+   //reordering window has elapsed (refer to RFC 8985)
+   if(tcpRackIsLost(socket, queueItem))
+      return TRUE;
+#endif
+
+   //Number of bytes and segments selectively acknowledged above this one
+   n = 0;
+   count = 0;
+
+   //Loop through the subsequent segments
+   for(queueItem = tcpNextQueueItem(socket, queueItem); queueItem != NULL;
+      queueItem = tcpNextQueueItem(socket, queueItem))
+   {
+      if(queueItem->sacked)
+      {
+         n += queueItem->length;
+         count++;
+      }
+   }
+
+   //Apply the IsLost() rule of RFC 6675
+   if(count >= TCP_FAST_RETRANSMIT_THRES)
+      return TRUE;
+   else if(n > (TCP_FAST_RETRANSMIT_THRES - 1) * socket->mss)
+      return TRUE;
+   else
+      return FALSE;
+}
+
+
+/**
+ * @brief Estimate the number of bytes still in the network
+ * @param[in] socket Handle referencing the socket
+ * @return Value of the pipe variable (refer to RFC 6675 SetPipe)
+ **/
+
+static uint_t tcpComputePipe(Socket *socket)
+{
+   uint_t pipe = 0;
+   TcpQueueItem *queueItem;
+
+   //Loop through the retransmission queue
+   for(queueItem = tcpFirstQueueItem(socket); queueItem != NULL;
+      queueItem = tcpNextQueueItem(socket, queueItem))
+   {
+      //Selectively acknowledged segments have left the network
+      if(queueItem->sacked)
+         continue;
+
+      //The original transmission is still in flight unless it is lost
+      if(!tcpIsSegmentLost(socket, queueItem))
+         pipe += queueItem->length;
+      //A retransmission is in flight as well
+      if(queueItem->retransmitted)
+         pipe += queueItem->length;
+   }
+
+   //Return the amount of data in flight
+   return pipe;
+}
+
+#endif
+
 
 /**
  * @brief Update receive window so as to avoid Silly Window Syndrome
  * @param[in] socket Handle referencing the socket
  **/
 
-void tcpUpdateReceiveWindow(Socket *socket)
+void tcpUpdateReceiveWindow(Socket *socket)
+{
+   //Space available but not yet advertised
+   uint32_t reduction = socket->rxBufferSize - socket->rcvUser - socket->rcvWnd;
+
+   //To avoid SWS, the receiver should not advertise small windows
+   if((socket->rcvWnd + reduction) >= min(socket->mss, socket->rxBufferSize / 2))
+   {
+      //Check whether a window update should be sent
+      if(socket->rcvWnd < min(socket->mss, socket->rxBufferSize / 2))
+      {
+         //Debug message
+         TRACE_INFO("%s: TCP sending window update...\r\n",
+            timeFormat(osGetTickCount()));
+
+         //Update the receive window
+         socket->rcvWnd += reduction;
+         //Send an ACK segment to advertise the new window size
+         tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
+      }
+      else
+      {
+         //The receive window can be updated
+         socket->rcvWnd += reduction;
+      }
+   }
+}
+
+
+/**
+ * @brief Compute retransmission timeout
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpComputeRto(Socket *socket)
+{
+   //Ensure the incoming ACK number covers the expected sequence number
+   if(socket->rttBusy && TCP_CMP_SEQ(socket->sndUna, socket->rttSeqNum) > 0)
+   {
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+      //When timestamps are used, RTT samples are taken from every ACK
+      if(!socket->tsFlag)
+         tcpUpdateRto(socket, osGetTickCount() - socket->rttStartTime);
+#else
+      //Update the RTO using the new measurement
+      tcpUpdateRto(socket, osGetTickCount() - socket->rttStartTime);
+#endif
+
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+      //Amount of data acknowledged during the round-trip
+      socket->txBdp = socket->n;
+#endif
+
+      //RTT measurement is complete
+      socket->rttBusy = FALSE;
+   }
+}
+
+
+/**
+ * @brief Update the RTO with a new RTT sample
+ * @param[in] socket Handle referencing the socket
+ * @param[in] r Round-trip time measurement
+ **/
+
+void tcpUpdateRto(Socket *socket, time_t r)
+{
+   //First RTT measurement?
+   if(!socket->srtt && !socket->rttvar)
+   {
+      //Initialize RTO calculation algorithm
+      socket->srtt = r;
+      socket->rttvar = r / 2;
+   }
+   else
+   {
+      //Calculate the difference between the measured value and the current RTT estimator
+      time_t delta = (r > socket->srtt) ? (r - socket->srtt) : (socket->srtt - r);
+      //Implement Van Jacobson's algorithm (as specified in RFC 6298 2.3)
+      socket->rttvar = (3 * socket->rttvar + delta) / 4;
+      socket->srtt = (7 * socket->srtt + r) / 8;
+   }
+
+   //Calculate the next retransmission timeout
+   socket->rto = socket->srtt + 4 * socket->rttvar;
+   //Whenever RTO is computed, if it is less than 1 second, then
+   //the RTO should be rounded up to 1 second
+   socket->rto = max(socket->rto, socket->minRto);
+   //A maximum value may be placed on RTO provided it is at least 60 seconds
+   socket->rto = min(socket->rto, TCP_MAX_RTO);
+
+   //Debug message
+   TRACE_DEBUG("R=%u, SRTT=%u, RTTVAR=%u, RTO=%u\r\n", r, socket->srtt, socket->rttvar, socket->rto);
+}
+
+
+#if (IP_PMTU_SUPPORT == ENABLED)
+
+/**
+ * @brief Adjust the segment size of a connection to a lower path MTU
+ *
+ * The connection is identified by the beginning of the offending
+ * segment, embedded in the ICMP error. The sequence number must refer
+ * to data in flight, which makes it harder for a forged message to
+ * shrink the segment size (refer to RFC 5927)
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] pseudoHeader Addresses of the connection, as seen by incoming segments
+ * @param[in] localPort Local port number
+ * @param[in] remotePort Remote port number
+ * @param[in] seqNum Sequence number of the segment that was too big
+ **/
+
+void tcpUpdatePathMtu(NetInterface *interface, const IpPseudoHeader *pseudoHeader,
+   uint16_t localPort, uint16_t remotePort, uint32_t seqNum)
 {
-   //Space available but not yet advertised
-   uint16_t reduction = socket->rxBufferSize - socket->rcvUser - socket->rcvWnd;
+   uint_t mss;
+   Socket *socket;
+   TcpHeader segment;
 
-   //To avoid SWS, the receiver should not advertise small windows
-   if((socket->rcvWnd + reduction) >= min(socket->mss, socket->rxBufferSize / 2))
+   //The embedded header is viewed as the one of an incoming segment
+   segment.srcPort = htons(remotePort);
+   segment.destPort = htons(localPort);
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+   //Look for the connection the segment belongs to
+   socket = tcpLookupSocket(interface, pseudoHeader, &segment);
+
+   //Synchronized connection with the segment still in flight?
+   if(socket != NULL && socket->state >= TCP_STATE_ESTABLISHED &&
+      TCP_CMP_SEQ(seqNum, socket->sndUna) >= 0 &&
+      TCP_CMP_SEQ(seqNum, socket->sndNxt) < 0)
    {
-      //Check whether a window update should be sent
-      if(socket->rcvWnd < min(socket->mss, socket->rxBufferSize / 2))
+      //Largest segment that fits in the path MTU
+      mss = tcpGetMaxMss(socket->interface, &socket->remoteIpAddr);
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+      //Leave room for the Timestamps option in every segment
+      if(socket->tsFlag)
+         mss -= TCP_TIMESTAMP_OVERHEAD;
+#endif
+
+      //Make sure the segment size is actually reduced
+      if(mss < socket->mss)
       {
          //Debug message
-         TRACE_INFO("%s: TCP sending window update...\r\n",
-            timeFormat(osGetTickCount()));
+         TRACE_INFO("TCP MSS reduced to %u bytes\r\n", mss);
 
-         //Update the receive window
-         socket->rcvWnd += reduction;
-         //Send an ACK segment to advertise the new window size
-         tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
-      }
-      else
-      {
-         //The receive window can be updated
-         socket->rcvWnd += reduction;
+         //Send smaller segments from now on
+         socket->mss = max(mss, TCP_MIN_MSS);
+
+         //The segment was dropped rather than lost because of congestion,
+         //hence it is resent at once without reducing the congestion window
+         tcpRetransmitSegment(socket);
       }
    }
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
 }
 
+#endif
+#if (TCP_PLPMTUD_SUPPORT == ENABLED)
 
 /**
- * @brief Compute retransmission timeout
+ * @brief Lower the segment size when full-sized segments are black-holed
+ *
+ * Some paths silently drop packets that exceed their MTU, because the
+ * ICMP errors are never sent or filtered out. When the earliest segment
+ * in flight is larger than TCP_PLPMTUD_BASE_MSS and times out repeatedly,
+ * the connection falls back to the base segment size (refer to RFC 4821
+ * section 7.2). The finding is shared with the other connections to the
+ * same host through the path MTU cache
+ *
  * @param[in] socket Handle referencing the socket
  **/
 
-void tcpComputeRto(Socket *socket)
+void tcpDetectBlackHole(Socket *socket)
 {
-   //Ensure the incoming ACK number covers the expected sequence number
-   if(socket->rttBusy && TCP_CMP_SEQ(socket->sndUna, socket->rttSeqNum) > 0)
-   {
-      //Calculate round-time trip
-      time_t r = osGetTickCount() - socket->rttStartTime;
+#if (IP_PMTU_SUPPORT == ENABLED)
+   size_t headerLength;
+#endif
 
-      //First RTT measurement?
-      if(!socket->srtt && !socket->rttvar)
-      {
-         //Initialize RTO calculation algorithm
-         socket->srtt = r;
-         socket->rttvar = r / 2;
-      }
-      else
-      {
-         //Calculate the difference between the measured value and the current RTT estimator
-         time_t delta = (r > socket->srtt) ? (r - socket->srtt) : (socket->srtt - r);
-         //Implement Van Jacobson's algorithm (as specified in RFC 6298 2.3)
-         socket->rttvar = (3 * socket->rttvar + delta) / 4;
-         socket->srtt = (7 * socket->srtt + r) / 8;
-      }
+   //Timeouts of the handshake are not related to the path MTU
+   if(socket->state < TCP_STATE_ESTABLISHED || !socket->retransmitQueueCount)
+      return;
+   //Only full-sized segments are affected by a black hole
+   if(socket->mss <= TCP_PLPMTUD_BASE_MSS ||
+      tcpFirstQueueItem(socket)->length <= TCP_PLPMTUD_BASE_MSS)
+   {
+      return;
+   }
 
-      //Calculate the next retransmission timeout
-      socket->rto = socket->srtt + 4 * socket->rttvar;
-      //Whenever RTO is computed, if it is less than 1 second, then
-      //the RTO should be rounded up to 1 second
-      socket->rto = max(socket->rto, TCP_MIN_RTO);
-      //A maximum value may be placed on RTO provided it is at least 60 seconds
-      socket->rto = min(socket->rto, TCP_MAX_RTO);
+   //Debug message
+   TRACE_INFO("TCP black hole detected (MSS = %u bytes)\r\n", socket->mss);
 
-      //Debug message
-      TRACE_DEBUG("R=%u, SRTT=%u, RTTVAR=%u, RTO=%u\r\n", r, socket->srtt, socket->rttvar, socket->rto);
+   //Fall back to the base segment size
+   socket->mss = TCP_PLPMTUD_BASE_MSS;
 
-      //RTT measurement is complete
-      socket->rttBusy = FALSE;
+#if (IP_PMTU_SUPPORT == ENABLED)
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 connection?
+   if(socket->remoteIpAddr.length == sizeof(Ipv6Addr))
+      headerLength = sizeof(Ipv6Header) + sizeof(TcpHeader);
+   else
+#endif
+   //IPv4 connection?
+   {
+      headerLength = sizeof(Ipv4Header) + sizeof(TcpHeader);
    }
+
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+   //Account for the Timestamps option
+   if(socket->tsFlag)
+      headerLength += TCP_TIMESTAMP_OVERHEAD;
+#endif
+
+   //Record the new estimate of the path MTU
+   ipUpdatePathMtu(socket->interface, &socket->remoteIpAddr,
+      TCP_PLPMTUD_BASE_MSS + headerLength);
+#endif
 }
 
+#endif
+
 
 /**
  * @brief TCP segment retransmission
@@ -1116,48 +2683,90 @@ void tcpComputeRto(Socket *socket)
 
 error_t tcpRetransmitSegment(Socket *socket)
 {
-   error_t error;
-   size_t offset;
-   ChunkedBuffer *buffer;
-   TcpQueueItem *queueItem;
-
    //Make sure the retransmission queue is not empty
-   if(!socket->retransmitQueue)
+   if(!socket->retransmitQueueCount)
       return NO_ERROR;
 
-   //Point to the segment to be retransmitted
-   queueItem = socket->retransmitQueue;
+   //Retransmit the earliest segment that has not been acknowledged
+   return tcpRetransmitQueueItem(socket, tcpFirstQueueItem(socket));
+}
 
-   //Allocate a memory buffer to hold the TCP segment
-   buffer = ipAllocBuffer(0, &offset);
-   //Failed to allocate memory?
-   if(!buffer) return ERROR_OUT_OF_MEMORY;
 
-   //Start of exception handling block
+/**
+ * @brief Retransmit a given segment of the retransmission queue
+ * @param[in] socket Handle referencing the socket
+ * @param[in] queueItem Segment to be retransmitted
+ * @return Error code
+ **/
+
+error_t tcpRetransmitQueueItem(Socket *socket, TcpQueueItem *queueItem)
+{
+   error_t error;
+   uint8_t flags;
+   uint32_t ackNum;
+   uint32_t seqNum;
+   size_t length;
+   size_t n;
+
+   //The retransmitted segment carries the current acknowledgment number.
+   //The receive window and the options are refreshed as well, and the
+   //data is read again from the send buffer
+   ackNum = (queueItem->flags & TCP_FLAG_ACK) ? socket->rcvNxt : 0;
+
+   //First byte and length of the data to be resent
+   seqNum = queueItem->seqNum;
+   length = queueItem->length;
+
+   //A segment that was sent before the MSS was lowered is split into
+   //several segments. SYN segments are always resent as they are
    do
    {
-      //Copy TCP header
-      error = chunkedBufferAppend(buffer, &queueItem->header, queueItem->header.dataOffset * 4);
-      //Any error to report?
-      if(error) break;
+      //Data that does not fit in a single segment?
+      if(!(queueItem->flags & TCP_FLAG_SYN) && length > socket->mss)
+      {
+         //Send a full-sized segment
+         n = socket->mss;
+         //The FIN and PSH flags belong to the last segment only
+         flags = queueItem->flags & ~(TCP_FLAG_FIN | TCP_FLAG_PSH);
+      }
+      else
+      {
+         //Send the remaining data
+         n = length;
+         flags = queueItem->flags;
+      }
 
-      //Copy data from send buffer
-      error = tcpReadTxBuffer(socket, ntohl(queueItem->header.seqNum), buffer, queueItem->length);
-      //Any error to report?
-      if(error) break;
+      //Retransmit the lost segment without waiting for the retransmission
+      //timer to expire. The saved checksum only covers the whole data
+      error = tcpSendSegmentEx(socket, flags, seqNum, ackNum, n, FALSE,
+         (n == queueItem->length && queueItem->checksumValid) ? &queueItem->checksum : NULL);
 
-      //Dump TCP header contents for debugging purpose
-      tcpDumpHeader(&queueItem->header, queueItem->length, socket->iss, socket->irs);
+      //Update TCP statistics
+      if(!error)
+         TCP_MIB_INC(tcpRetransSegs);
 
-      //Retransmit the lost segment without waiting for the retransmission timer to expire
-      error = ipSendDatagram(socket->interface, &queueItem->pseudoHeader,
-         buffer, offset, queueItem->timeToLive);
+      //Advance data pointer
+      seqNum += n;
+      length -= n;
 
-      //End of exception handling block
-   } while(0);
+      //Loop until all the data has been resent
+   } while(!error && length > 0);
+
+#if (TCP_RACK_SUPPORT == ENABLED)
+   //Record the transmission time of the segment
+   if(!error)
+      tcpRackOnTransmit(socket, queueItem);
+#endif
+
+#if (TCP_INFO_SUPPORT == ENABLED)
+   //Successful transmission?
+   if(!error)
+   {
+      //Update statistics
+      socket->stats.retransmits++;
+   }
+#endif
 
-   //Free previously allocated memory
-   chunkedBufferFree(buffer);
    //Return status code
    return error;
 }
@@ -1174,6 +2783,17 @@ error_t tcpNagleAlgo(Socket *socket)
    error_t error;
    uint_t n;
    uint_t u;
+#if (NIC_TX_BATCH_SUPPORT == ENABLED)
+   bool_t batch;
+#endif
+
+   //When TCP has not sent data in an interval exceeding the retransmission
+   //timeout, cwnd must be reduced before transmission restarts
+   if(socket->sndNxt == socket->sndUna && socket->sndUser > 0 &&
+      (osGetTickCount() - socket->lastTxTime) > socket->rto)
+   {
+      socket->congestionAlgo->idleRestart(socket);
+   }
 
    //The amount of data that can be sent at any given time is
    //limited by the receiver window and the congestion window
@@ -1188,10 +2808,33 @@ error_t tcpNagleAlgo(Socket *socket)
    //the usable window to become negative
    if((int_t) u < 0) return NO_ERROR;
 
+#if (NIC_TX_BATCH_SUPPORT == ENABLED)
+   //When several segments can leave at once, hand them to the
+   //interface as a train instead of locking the transmitter each time
+   batch = (socket->interface != NULL && min(socket->sndUser, u) > socket->mss);
+   //Lock the transmitter for the whole train
+   if(batch)
+      nicBeginTxBatch(socket->interface);
+#endif
+
+   //Initialize status code
+   error = NO_ERROR;
+
    //The Nagle algorithm discourages sending tiny segments when
    //the data to be sent increases in small increments
    while(socket->sndUser > 0)
    {
+      //Each segment in flight takes a slot of the retransmission queue.
+      //The last slot is kept for the FIN
+      if(socket->retransmitQueueCount >= (TCP_RETRANSMIT_QUEUE_SIZE - 1))
+         break;
+
+#if (TCP_PACING_SUPPORT == ENABLED)
+      //The next segment is not due yet?
+      if(!tcpPacingCheck(socket))
+         break;
+#endif
+
       //Calculate the number of bytes to send at a time
       n = min(u, socket->sndUser);
       n = min(n, socket->mss);
@@ -1203,7 +2846,12 @@ error_t tcpNagleAlgo(Socket *socket)
          error = tcpSendSegment(socket, TCP_FLAG_PSH | TCP_FLAG_ACK,
             socket->sndNxt, socket->rcvNxt, n, TRUE);
          //Failed to send TCP segment?
-         if(error) return error;
+         if(error) break;
+      }
+      //Partial segments are held back while the socket is corked
+      else if(socket->txCork || socket->txMore)
+      {
+         break;
       }
       //Or if all queued data can be sent now
       else if(socket->sndNxt == socket->sndUna && socket->sndUser <= u)
@@ -1212,36 +2860,321 @@ error_t tcpNagleAlgo(Socket *socket)
          error = tcpSendSegment(socket, TCP_FLAG_PSH | TCP_FLAG_ACK,
             socket->sndNxt, socket->rcvNxt, n, TRUE);
          //Failed to send TCP segment?
-         if(error) return error;
+         if(error) break;
       }
       //Or if at least a fraction of the maximum window can be sent
       else if(min(socket->sndUser, u) >= (socket->maxSndWnd / 2))
       {
-         //Send TCP segment
-         error = tcpSendSegment(socket, TCP_FLAG_PSH | TCP_FLAG_ACK,
-            socket->sndNxt, socket->rcvNxt, n, TRUE);
-         //Failed to send TCP segment?
-         if(error) return error;
+         //Send TCP segment
+         error = tcpSendSegment(socket, TCP_FLAG_PSH | TCP_FLAG_ACK,
+            socket->sndNxt, socket->rcvNxt, n, TRUE);
+         //Failed to send TCP segment?
+         if(error) break;
+      }
+      else
+      {
+         //Prevent the sender from sending tiny segments...
+         break;
+      }
+
+      //Advance SND.NXT pointer
+      socket->sndNxt += n;
+      //Update the number of data buffered but not yet sent
+      socket->sndUser -= n;
+      //Update the size of the usable window
+      u -= n;
+   }
+
+#if (NIC_TX_BATCH_SUPPORT == ENABLED)
+   //End of the train
+   if(batch)
+      nicEndTxBatch(socket->interface);
+#endif
+
+   //Failed to send TCP segment?
+   if(error) return error;
+
+   //Check whether the transmitter can accept more data
+   tcpUpdateEvents(socket);
+
+   //No error to report
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Find the socket an incoming segment is addressed to
+ *
+ * The connection table is searched first. When no connection matches,
+ * the first socket listening on the destination port is returned
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] pseudoHeader TCP pseudo header
+ * @param[in] segment Incoming TCP segment (network byte order)
+ * @return Handle referencing the matching socket, or NULL if none was found
+ **/
+
+Socket *tcpLookupSocket(NetInterface *interface,
+   const IpPseudoHeader *pseudoHeader, const TcpHeader *segment)
+{
+   uint_t i;
+   uint_t n;
+   uint_t hash;
+   uint16_t srcPort;
+   uint16_t destPort;
+   IpAddr srcIpAddr;
+   Socket *socket;
+
+   //Convert port numbers to host byte order
+   srcPort = ntohs(segment->srcPort);
+   destPort = ntohs(segment->destPort);
+
+#if (IPV4_SUPPORT == ENABLED)
+   //An IPv4 packet was received?
+   if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
+   {
+      //Retrieve the address of the remote host
+      srcIpAddr.length = sizeof(Ipv4Addr);
+      srcIpAddr.ipv4Addr = pseudoHeader->ipv4Data.srcAddr;
+   }
+   else
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //An IPv6 packet was received?
+   if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
+   {
+      //Retrieve the address of the remote host
+      srcIpAddr.length = sizeof(Ipv6Addr);
+      srcIpAddr.ipv6Addr = pseudoHeader->ipv6Data.srcAddr;
+   }
+   else
+#endif
+   //An invalid packet was received?
+   {
+      //This should never occur...
+      return NULL;
+   }
+
+   //Point to the relevant hash bucket
+   hash = tcpHashTuple(destPort, &srcIpAddr, srcPort);
+
+   //Walk through the connections sharing the same hash value
+   for(socket = tcpHashTable[hash]; socket != NULL; socket = socket->hashNext)
+   {
+      //Check port numbers
+      if(socket->localPort != destPort || socket->remotePort != srcPort)
+         continue;
+      //Check interface and IP addresses
+      if(!tcpMatchSocket(socket, interface, pseudoHeader))
+         continue;
+
+      //A matching connection has been found
+      return socket;
+   }
+
+   //Point to the relevant hash bucket
+   i = destPort & (TCP_LISTEN_HASH_TABLE_SIZE - 1);
+
+   //Walk through the listening sockets sharing the same hash value
+   for(n = 0, socket = tcpListenHashTable[i]; socket != NULL; socket = socket->hashNext)
+   {
+      //Check destination port number
+      if(socket->localPort != destPort)
+         continue;
+      //Check interface and IP addresses
+      if(!tcpMatchSocket(socket, interface, pseudoHeader))
+         continue;
+
+      //A matching socket in the LISTEN state has been found
+      if(!socket->reusePortFlag)
+         return socket;
+
+      //Count the listening sockets that share the port
+      n++;
+   }
+
+   //No matching socket?
+   if(!n)
+      return NULL;
+
+   //Incoming connections are spread across the listening sockets. The
+   //choice only depends on the remote host, so that retransmitted SYN
+   //segments reach the same SYN queue
+   n = hash % n;
+
+   //Walk through the listening sockets again
+   for(socket = tcpListenHashTable[i]; socket != NULL; socket = socket->hashNext)
+   {
+      //Skip the sockets that do not match
+      if(socket->localPort != destPort)
+         continue;
+      if(!tcpMatchSocket(socket, interface, pseudoHeader))
+         continue;
+
+      //Selected socket?
+      if(!n--)
+         break;
+   }
+
+   //Return the selected listening socket
+   return socket;
+}
+
+
+/**
+ * @brief Add a socket to the demultiplexing tables
+ *
+ * Listening sockets are indexed by local port. Any other socket is
+ * indexed by its 4-tuple, which must not change until it is removed
+ *
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpHashSocket(Socket *socket)
+{
+   //Select the relevant table
+   if(socket->state == TCP_STATE_LISTEN)
+   {
+      socketHashInsert(&tcpListenHashTable[socket->localPort &
+         (TCP_LISTEN_HASH_TABLE_SIZE - 1)], socket);
+   }
+   else
+   {
+      socketHashInsert(&tcpHashTable[tcpHashTuple(socket->localPort,
+         &socket->remoteIpAddr, socket->remotePort)], socket);
+   }
+}
+
+
+/**
+ * @brief Hash the 4-tuple of a connection
+ *
+ * The local address is left out, since it is implied by the interface
+ * in most configurations and is checked while walking the bucket
+ *
+ * @param[in] localPort Local port number
+ * @param[in] remoteIpAddr IP address of the remote host
+ * @param[in] remotePort Port number used by the remote host
+ * @return Index of the hash bucket
+ **/
+
+static uint_t tcpHashTuple(uint16_t localPort,
+   const IpAddr *remoteIpAddr, uint16_t remotePort)
+{
+   uint32_t h;
+
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 address?
+   if(remoteIpAddr->length == sizeof(Ipv6Addr))
+   {
+      //The interface identifier carries most of the entropy
+      h = remoteIpAddr->ipv6Addr.dw[2] ^ remoteIpAddr->ipv6Addr.dw[3];
+   }
+   else
+#endif
+#if (IPV4_SUPPORT == ENABLED)
+   //IPv4 address?
+   if(remoteIpAddr->length == sizeof(Ipv4Addr))
+   {
+      //Use the address as is
+      h = remoteIpAddr->ipv4Addr;
+   }
+   else
+#endif
+   //Unspecified address?
+   {
+      h = 0;
+   }
+
+   //Mix in the port numbers
+   h ^= ((uint32_t) localPort << 16) | remotePort;
+
+   //Fold the upper bits into the bucket index
+   h ^= h >> 16;
+   h ^= h >> 8;
+
+   //Return the index of the hash bucket
+   return h & (TCP_HASH_TABLE_SIZE - 1);
+}
+
+
+/**
+ * @brief Check whether a socket accepts a segment received on an interface
+ * @param[in] socket Handle referencing the socket
+ * @param[in] interface Underlying network interface
+ * @param[in] pseudoHeader TCP pseudo header
+ * @return TRUE if the socket interface and addresses match, else FALSE
+ **/
+
+static bool_t tcpMatchSocket(Socket *socket,
+   NetInterface *interface, const IpPseudoHeader *pseudoHeader)
+{
+   //Check whether the socket is bound to a particular interface
+   if(socket->interface && socket->interface != interface)
+      return FALSE;
+
+#if (IPV4_SUPPORT == ENABLED)
+   //An IPv4 packet was received?
+   if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
+   {
+      //Destination IP address filtering
+      if(socket->localIpAddr.length)
+      {
+         //An IPv4 address is expected
+         if(socket->localIpAddr.length != sizeof(Ipv4Addr))
+            return FALSE;
+         //Filter out non-matching addresses
+         if(socket->localIpAddr.ipv4Addr != pseudoHeader->ipv4Data.destAddr)
+            return FALSE;
+      }
+      //Source IP address filtering
+      if(socket->remoteIpAddr.length)
+      {
+         //An IPv4 address is expected
+         if(socket->remoteIpAddr.length != sizeof(Ipv4Addr))
+            return FALSE;
+         //Filter out non-matching addresses
+         if(socket->remoteIpAddr.ipv4Addr != pseudoHeader->ipv4Data.srcAddr)
+            return FALSE;
+      }
+   }
+   else
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //An IPv6 packet was received?
+   if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
+   {
+      //Destination IP address filtering
+      if(socket->localIpAddr.length)
+      {
+         //An IPv6 address is expected
+         if(socket->localIpAddr.length != sizeof(Ipv6Addr))
+            return FALSE;
+         //Filter out non-matching addresses
+         if(!ipv6CompAddr(&socket->localIpAddr.ipv6Addr, &pseudoHeader->ipv6Data.destAddr))
+            return FALSE;
       }
-      else
+      //Source IP address filtering
+      if(socket->remoteIpAddr.length)
       {
-         //Prevent the sender from sending tiny segments...
-         break;
+         //An IPv6 address is expected
+         if(socket->remoteIpAddr.length != sizeof(Ipv6Addr))
+            return FALSE;
+         //Filter out non-matching addresses
+         if(!ipv6CompAddr(&socket->remoteIpAddr.ipv6Addr, &pseudoHeader->ipv6Data.srcAddr))
+            return FALSE;
       }
-
-      //Advance SND.NXT pointer
-      socket->sndNxt += n;
-      //Update the number of data buffered but not yet sent
-      socket->sndUser -= n;
-      //Update the size of the usable window
-      u -= n;
+   }
+   else
+#endif
+   //An invalid packet was received?
+   {
+      //This should never occur...
+      return FALSE;
    }
 
-   //Check whether the transmitter can accept more data
-   tcpUpdateEvents(socket);
-
-   //No error to report
-   return NO_ERROR;
+   //The socket meets all the criteria
+   return TRUE;
 }
 
 
@@ -1253,6 +3186,24 @@ error_t tcpNagleAlgo(Socket *socket)
 
 void tcpChangeState(Socket *socket, TcpState newState)
 {
+#if (NET_MIB_SUPPORT == ENABLED)
+   //Active open?
+   if(socket->state == TCP_STATE_CLOSED && newState == TCP_STATE_SYN_SENT)
+      TCP_MIB_INC(tcpActiveOpens);
+   //Connection accepted on behalf of a listening socket?
+   else if(socket->state == TCP_STATE_CLOSED &&
+      (newState == TCP_STATE_SYN_RECEIVED || newState == TCP_STATE_ESTABLISHED))
+      TCP_MIB_INC(tcpPassiveOpens);
+   //Failed connection attempt?
+   else if(newState == TCP_STATE_CLOSED && (socket->state == TCP_STATE_SYN_SENT ||
+      socket->state == TCP_STATE_SYN_RECEIVED))
+      TCP_MIB_INC(tcpAttemptFails);
+   //Established connection reset?
+   else if(newState == TCP_STATE_CLOSED && (socket->state == TCP_STATE_ESTABLISHED ||
+      socket->state == TCP_STATE_CLOSE_WAIT))
+      TCP_MIB_INC(tcpEstabResets);
+#endif
+
    //Enter CLOSED state?
    if(newState == TCP_STATE_CLOSED)
    {
@@ -1272,6 +3223,13 @@ void tcpChangeState(Socket *socket, TcpState newState)
 
    //Enter the desired state
    socket->state = newState;
+
+   //Keep the demultiplexing tables up to date
+   if(newState == TCP_STATE_CLOSED)
+      socketHashRemove(socket);
+   else if(newState == TCP_STATE_LISTEN || socket->hashBucket == NULL)
+      tcpHashSocket(socket);
+
    //Update TCP related events
    tcpUpdateEvents(socket);
 }
@@ -1284,9 +3242,28 @@ void tcpChangeState(Socket *socket, TcpState newState)
 
 void tcpUpdateEvents(Socket *socket)
 {
+   size_t txUsed;
+   size_t txThreshold;
+   size_t rxThreshold;
+
    //Clear event flags
    socket->eventFlags = 0;
 
+   //Number of bytes held in the send buffer
+   txUsed = socket->sndUser + socket->sndNxt - socket->sndUna;
+
+   //Free space that makes the socket writable. A blocked writer does not
+   //wait for more room than it needs to queue its remaining data
+   txThreshold = min(socket->txLowWat, socket->txBufferSize);
+   if(socket->txWaitSize > 0)
+      txThreshold = min(txThreshold, socket->txWaitSize);
+
+   //Amount of data that makes the socket readable. A blocked reader does
+   //not wait for more data than it has asked for
+   rxThreshold = min(socket->rxLowWat, socket->rxBufferSize);
+   if(socket->rxWaitSize > 0)
+      rxThreshold = min(rxThreshold, socket->rxWaitSize);
+
    //Check current TCP state
    switch(socket->state)
    {
@@ -1319,6 +3296,21 @@ void tcpUpdateEvents(Socket *socket)
       break;
    }
 
+#if (TCP_FAST_OPEN_SUPPORT == ENABLED)
+   //The data carried by the SYN can be read and answered before
+   //the handshake completes (refer to RFC 7413, section 4.2)
+   if(socket->state == TCP_STATE_SYN_RECEIVED && socket->fastOpenDataFlag)
+   {
+      //Check whether the send buffer is full or not
+      if((socket->sndUser + socket->sndNxt - socket->sndUna) < socket->txBufferSize)
+         socket->eventFlags |= SOCKET_EVENT_TX_READY;
+
+      //Data is available for reading?
+      if(socket->rcvUser > 0)
+         socket->eventFlags |= SOCKET_EVENT_RX_READY;
+   }
+   else
+#endif
    //Handle TX specific events
    if(socket->state == TCP_STATE_SYN_SENT ||
       socket->state == TCP_STATE_SYN_RECEIVED)
@@ -1329,8 +3321,8 @@ void tcpUpdateEvents(Socket *socket)
    else if(socket->state == TCP_STATE_ESTABLISHED ||
       socket->state == TCP_STATE_CLOSE_WAIT)
    {
-      //Check whether the send buffer is full or not
-      if((socket->sndUser + socket->sndNxt - socket->sndUna) < socket->txBufferSize)
+      //Check whether enough room is available in the send buffer
+      if(txUsed < socket->txBufferSize && (socket->txBufferSize - txUsed) >= txThreshold)
          socket->eventFlags |= SOCKET_EVENT_TX_READY;
 
       //Notify user task that all the data in the send buffer
@@ -1350,8 +3342,8 @@ void tcpUpdateEvents(Socket *socket)
       socket->state == TCP_STATE_FIN_WAIT_1 ||
       socket->state == TCP_STATE_FIN_WAIT_2)
    {
-      //Data is available for reading?
-      if(socket->rcvUser > 0)
+      //Enough data is available for reading?
+      if(socket->rcvUser > 0 && socket->rcvUser >= rxThreshold)
          socket->eventFlags |= SOCKET_EVENT_RX_READY;
    }
    else if(socket->state == TCP_STATE_LISTEN)
@@ -1375,6 +3367,12 @@ void tcpUpdateEvents(Socket *socket)
    else
       socket->eventFlags |= SOCKET_EVENT_LINK_DOWN;
 
+#if (SOCKET_EVENT_SET_SUPPORT == ENABLED)
+   //Push the events into the event set the socket belongs to
+   if(socket->eventSet != NULL)
+      socketEventSetNotify(socket, socket->eventFlags);
+#endif
+
    //Mask unused events
    socket->eventFlags &= socket->eventMask;
 
@@ -1391,6 +3389,64 @@ void tcpUpdateEvents(Socket *socket)
 }
 
 
+/**
+ * @brief Start processing a batch of incoming segments
+ *
+ * Sockets receiving in-order data before tcpEndRxBatch is called are
+ * notified once at the end of the batch rather than for every segment
+ **/
+
+void tcpBeginRxBatch(void)
+{
+#if (TCP_RX_COALESCING_SUPPORT == ENABLED)
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+   //A new batch is being processed
+   tcpRxBatchCount++;
+   //Leave critical section
+   osMutexRelease(socketMutex);
+#endif
+}
+
+
+/**
+ * @brief Finish processing a batch of incoming segments
+ **/
+
+void tcpEndRxBatch(void)
+{
+#if (TCP_RX_COALESCING_SUPPORT == ENABLED)
+   uint_t i;
+   Socket *socket;
+
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+
+   //The batch is complete
+   if(tcpRxBatchCount > 0)
+      tcpRxBatchCount--;
+
+   //Loop through opened sockets
+   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+   {
+      //Point to the current socket
+      socket = socketTable[i];
+
+      //Notify the readers whose wakeup has been deferred
+      if(socket != NULL && socket->type == SOCKET_TYPE_STREAM &&
+         socket->rxEventPending)
+      {
+         socket->rxEventPending = FALSE;
+         tcpUpdateEvents(socket);
+      }
+   }
+
+   //Leave critical section
+   osMutexRelease(socketMutex);
+#endif
+}
+
+
 /**
  * @brief Wait for a particular TCP event
  * @param[in] socket Handle referencing the socket
@@ -1424,6 +3480,192 @@ uint_t tcpWaitForEvents(Socket *socket, uint_t eventMask, time_t timeout)
 }
 
 
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == ENABLED)
+
+/**
+ * @brief Allocate the send buffer before data is queued
+ *
+ * When automatic tuning is enabled, the size of the buffer is
+ * chosen to hold twice the amount of data acknowledged during the
+ * last round-trip, which tracks the bandwidth-delay product
+ *
+ * @param[in] socket Handle referencing the socket
+ * @return Error code
+ **/
+
+error_t tcpAllocTxBuffer(Socket *socket)
+{
+   error_t error;
+   size_t size;
+
+   //The send buffer is already available?
+   if(socket->txBuffer.chunkCount > 0)
+      return NO_ERROR;
+
+   //Current size of the buffer
+   size = socket->txBufferSize;
+
+   //Adjust the size of the buffer to the measured bandwidth-delay product
+   if(socket->txAutoTune)
+   {
+      size = max(2 * socket->txBdp, TCP_DEFAULT_TX_BUFFER_SIZE);
+      size = min(size, TCP_MAX_TX_BUFFER_SIZE);
+   }
+
+   //Allocate the chunks that make up the buffer
+   error = tcpAllocBuffer(socket, (ChunkedBuffer *) &socket->txBuffer, size);
+
+   //A larger buffer does not fit in the memory budget of the socket?
+   if(error == ERROR_WOULD_BLOCK && size > TCP_DEFAULT_TX_BUFFER_SIZE && socket->txAutoTune)
+   {
+      //Fall back to the default size
+      size = TCP_DEFAULT_TX_BUFFER_SIZE;
+      error = tcpAllocBuffer(socket, (ChunkedBuffer *) &socket->txBuffer, size);
+   }
+
+   //Save the actual size of the buffer
+   if(!error)
+      socket->txBufferSize = size;
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Release the send buffer once all the data has been acknowledged
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpReleaseTxBuffer(Socket *socket)
+{
+   //The buffer must not be released while the user is writing to it, or
+   //while it still holds data that has not been acknowledged
+   if(!socket->txBufferBusy && !socket->sndUser && socket->sndNxt == socket->sndUna)
+      tcpFreeBuffer(socket, (ChunkedBuffer *) &socket->txBuffer);
+}
+
+
+/**
+ * @brief Allocate the receive buffer before data is stored
+ *
+ * The receive buffer may only grow, since the right edge of the
+ * window already advertised to the peer must not be withdrawn
+ *
+ * @param[in] socket Handle referencing the socket
+ * @return Error code
+ **/
+
+error_t tcpAllocRxBuffer(Socket *socket)
+{
+   error_t error;
+   size_t size;
+
+   //The receive buffer is already available?
+   if(socket->rxBuffer.chunkCount > 0)
+      return NO_ERROR;
+
+   //Current size of the buffer. The buffer never shrinks, since the
+   //peer may rely on the window that has already been advertised
+   size = socket->rxBufferSize;
+
+   //Adjust the size of the buffer to the measured bandwidth-delay product
+   if(socket->rxAutoTune)
+   {
+      size = min(2 * socket->rxBdp, TCP_MAX_RX_BUFFER_SIZE);
+      //There is no point in a buffer larger than the maximum window
+      size = min(size, (size_t) UINT16_MAX << socket->rcvWndShift);
+      size = max(size, socket->rxBufferSize);
+   }
+
+   //Allocate the chunks that make up the buffer
+   error = tcpAllocBuffer(socket, (ChunkedBuffer *) &socket->rxBuffer, size);
+
+   //A larger buffer does not fit in the memory budget of the socket?
+   if(error == ERROR_WOULD_BLOCK && size > socket->rxBufferSize)
+   {
+      //Keep the current size
+      size = socket->rxBufferSize;
+      error = tcpAllocBuffer(socket, (ChunkedBuffer *) &socket->rxBuffer, size);
+   }
+
+   //Save the actual size of the buffer
+   if(!error)
+      socket->rxBufferSize = size;
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Release the receive buffer once it has been drained
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpReleaseRxBuffer(Socket *socket)
+{
+   //Out-of-order data is kept until the gaps are filled
+   if(!socket->rcvUser && !socket->sackBlockCount)
+      tcpFreeBuffer(socket, (ChunkedBuffer *) &socket->rxBuffer);
+}
+
+#endif
+
+
+/**
+ * @brief Allocate the send or the receive buffer of a connection
+ *
+ * The memory is charged to the socket. ERROR_WOULD_BLOCK is returned
+ * when the memory budget of the socket or of its class is exhausted
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] buffer Send or receive buffer
+ * @param[in] size Size of the buffer
+ * @return Error code
+ **/
+
+error_t tcpAllocBuffer(Socket *socket, ChunkedBuffer *buffer, size_t size)
+{
+   error_t error;
+
+   //Make sure the socket is allowed to hold that much memory
+   error = socketMemCharge(socket, size);
+   //Budget exhausted?
+   if(error) return error;
+
+   //Allocate the chunks that make up the buffer
+   error = chunkedBufferSetLength(buffer, size);
+
+   //Failed to allocate memory?
+   if(error)
+   {
+      //Release the chunks that could be allocated
+      chunkedBufferSetLength(buffer, 0);
+      //The memory is not held by the socket
+      socketMemUncharge(socket, size);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Release the send or the receive buffer of a connection
+ * @param[in] socket Handle referencing the socket
+ * @param[in] buffer Send or receive buffer
+ **/
+
+void tcpFreeBuffer(Socket *socket, ChunkedBuffer *buffer)
+{
+   //The memory is no longer held by the socket
+   socketMemUncharge(socket, chunkedBufferGetLength(buffer));
+   //Release the chunks that make up the buffer
+   chunkedBufferSetLength(buffer, 0);
+}
+
+
 /**
  * @brief Copy incoming data to the send buffer
  * @param[in] socket Handle referencing the socket
@@ -1457,8 +3699,68 @@ void tcpWriteTxBuffer(Socket *socket, uint32_t seqNum,
 }
 
 
+/**
+ * @brief Queue a reference to immutable data in the send buffer
+ *
+ * The data is not copied. The memory must remain valid and unchanged
+ * until the corresponding sequence numbers have been acknowledged
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] seqNum First sequence number occupied by the data
+ * @param[in] data Pointer to the data
+ * @param[in] length Number of bytes
+ * @return Error code
+ **/
+
+error_t tcpAddTxRegion(Socket *socket, uint32_t seqNum,
+   const uint8_t *data, size_t length)
+{
+#if (TCP_SEND_FILE_SUPPORT == ENABLED)
+   TcpTxRegion *region;
+
+   //Regions that have been acknowledged are no longer needed
+   tcpFlushTxRegions(socket);
+
+   //Any region already referenced?
+   if(socket->txRegionCount > 0)
+   {
+      //Point to the last region
+      region = &socket->txRegion[socket->txRegionCount - 1];
+
+      //Contiguous data can be merged with the last region
+      if((region->seqNum + region->length) == seqNum &&
+         (region->data + region->length) == data)
+      {
+         region->length += length;
+         return NO_ERROR;
+      }
+   }
+
+   //No more region available?
+   if(socket->txRegionCount >= TCP_MAX_TX_REGIONS)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Append a new region
+   region = &socket->txRegion[socket->txRegionCount++];
+   region->seqNum = seqNum;
+   region->data = data;
+   region->length = length;
+
+   //Successful processing
+   return NO_ERROR;
+#else
+   //Not implemented
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
 /**
  * @brief Copy data from the send buffer
+ *
+ * Data held by the circular buffer is referenced chunk by chunk,
+ * whereas immutable regions are referenced in place
+ *
  * @param[in] socket Handle referencing the socket
  * @param[in] seqNum Sequence number of the first data to read
  * @param[out] buffer Pointer to the output buffer
@@ -1468,6 +3770,87 @@ void tcpWriteTxBuffer(Socket *socket, uint32_t seqNum,
 
 error_t tcpReadTxBuffer(Socket *socket, uint32_t seqNum,
    ChunkedBuffer *buffer, size_t length)
+{
+#if (TCP_SEND_FILE_SUPPORT == ENABLED)
+   uint_t i;
+   size_t n;
+   error_t error;
+   TcpTxRegion *region;
+
+   //Regions that have been acknowledged are no longer needed
+   tcpFlushTxRegions(socket);
+
+   //Initialize status code
+   error = NO_ERROR;
+
+   //Gather the requested data
+   while(length > 0 && !error)
+   {
+      //Number of bytes to read at a time
+      n = length;
+      //No region found yet
+      region = NULL;
+
+      //Regions are sorted in sequence order
+      for(i = 0; i < socket->txRegionCount; i++)
+      {
+         //The region starts beyond the current sequence number?
+         if(TCP_CMP_SEQ(socket->txRegion[i].seqNum, seqNum) > 0)
+         {
+            //Read the circular buffer up to the start of the region
+            n = min(n, socket->txRegion[i].seqNum - seqNum);
+            break;
+         }
+
+         //The current sequence number falls in the region?
+         if(TCP_CMP_SEQ(seqNum, socket->txRegion[i].seqNum + socket->txRegion[i].length) < 0)
+         {
+            region = &socket->txRegion[i];
+            break;
+         }
+      }
+
+      //Immutable data?
+      if(region != NULL)
+      {
+         //Offset of the first byte within the region
+         size_t offset = seqNum - region->seqNum;
+         //Do not read past the end of the region
+         n = min(n, region->length - offset);
+         //Reference the data in place
+         error = chunkedBufferAppend(buffer, region->data + offset, n);
+      }
+      else
+      {
+         //Reference the data held by the circular buffer
+         error = tcpReadTxRing(socket, seqNum, buffer, n);
+      }
+
+      //Next data to read
+      seqNum += n;
+      length -= n;
+   }
+
+   //Return status code
+   return error;
+#else
+   //Read data from the circular buffer
+   return tcpReadTxRing(socket, seqNum, buffer, length);
+#endif
+}
+
+
+/**
+ * @brief Reference data held by the circular send buffer
+ * @param[in] socket Handle referencing the socket
+ * @param[in] seqNum Sequence number of the first data to read
+ * @param[out] buffer Pointer to the output buffer
+ * @param[in] length Number of data to read
+ * @return Error code
+ **/
+
+static error_t tcpReadTxRing(Socket *socket, uint32_t seqNum,
+   ChunkedBuffer *buffer, size_t length)
 {
    error_t error;
 
@@ -1501,6 +3884,29 @@ error_t tcpReadTxBuffer(Socket *socket, uint32_t seqNum,
 }
 
 
+#if (TCP_SEND_FILE_SUPPORT == ENABLED)
+
+/**
+ * @brief Release the regions that have been acknowledged
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void tcpFlushTxRegions(Socket *socket)
+{
+   //Check whether the oldest region has been fully acknowledged
+   while(socket->txRegionCount > 0 && TCP_CMP_SEQ(socket->txRegion[0].seqNum +
+      socket->txRegion[0].length, socket->sndUna) <= 0)
+   {
+      //Remove the region from the list
+      socket->txRegionCount--;
+      memmove(socket->txRegion, socket->txRegion + 1,
+         socket->txRegionCount * sizeof(TcpTxRegion));
+   }
+}
+
+#endif
+
+
 /**
  * @brief Copy incoming data to the receive buffer
  * @param[in] socket Handle referencing the socket
@@ -36,15 +36,35 @@
 error_t tcpSendSegment(Socket *socket, uint8_t flags, uint32_t seqNum,
    uint32_t ackNum, size_t length, bool_t addToQueue);
 
+error_t tcpSendSegmentEx(Socket *socket, uint8_t flags, uint32_t seqNum,
+   uint32_t ackNum, size_t length, bool_t addToQueue, const uint16_t *dataChecksum);
+
 error_t tcpSendResetSegment(NetInterface *interface,
    IpPseudoHeader *pseudoHeader, TcpHeader *segment, size_t length);
 
+error_t tcpSendReplySegment(NetInterface *interface, IpPseudoHeader *pseudoHeader,
+   TcpHeader *segment, uint8_t flags, uint32_t seqNum, uint32_t ackNum,
+   uint16_t window, uint16_t mss);
+
 error_t tcpAddOption(TcpHeader *segment, uint8_t kind, const void *value, uint8_t length);
 TcpOption *tcpGetOption(TcpHeader *segment, uint8_t kind);
 
+uint_t tcpGetMaxMss(NetInterface *interface, const IpAddr *remoteIpAddr);
+
+uint_t tcpGetWindowShift(size_t bufferSize);
+uint16_t tcpGetAdvertisedWindow(Socket *socket, uint8_t flags);
+uint32_t tcpGetSendWindow(Socket *socket, const TcpHeader *segment);
+
+error_t tcpVerifyChecksum(Socket *socket, IpPseudoHeader *pseudoHeader,
+   const ChunkedBuffer *buffer, size_t offset, size_t length);
+
 error_t tcpCheckSequenceNumber(Socket *socket, TcpHeader *segment, size_t length);
 error_t tcpCheckSyn(Socket *socket, TcpHeader *segment, size_t length);
 error_t tcpCheckAck(Socket *socket, TcpHeader *segment, size_t length);
+void tcpProcessNewAck(Socket *socket, uint32_t ackNum, uint32_t tsEcr);
+
+error_t tcpPredictHeader(Socket *socket, TcpHeader *segment,
+   const ChunkedBuffer *buffer, size_t offset, size_t length);
 
 void tcpProcessSegmentData(Socket *socket, TcpHeader *segment,
    const ChunkedBuffer *buffer, size_t offset, size_t length);
@@ -55,22 +75,59 @@ void tcpUpdateRetransmitQueue(Socket *socket);
 void tcpFlushRetransmitQueue(Socket *socket);
 
 void tcpFlushSynQueue(Socket *socket);
+TcpSynQueueItem *tcpAllocSynQueueItem(Socket *socket);
+void tcpAddSynQueueItem(Socket *socket, TcpSynQueueItem *queueItem);
+void tcpRemoveSynQueueItem(Socket *socket, TcpSynQueueItem *queueItem);
+
+TcpSynQueueItem *tcpFindSynQueueItem(Socket *socket, NetInterface *interface,
+   const IpPseudoHeader *pseudoHeader, const TcpHeader *segment);
 
 void tcpUpdateSackBlocks(Socket *socket, uint32_t *leftEdge, uint32_t *rightEdge);
+void tcpUpdateScoreboard(Socket *socket, TcpHeader *segment);
+void tcpClearScoreboard(Socket *socket);
+void tcpSackRecovery(Socket *socket);
 void tcpUpdateReceiveWindow(Socket *socket);
 
 void tcpComputeRto(Socket *socket);
+void tcpUpdateRto(Socket *socket, time_t r);
+TcpQueueItem *tcpFirstQueueItem(Socket *socket);
+TcpQueueItem *tcpNextQueueItem(Socket *socket, TcpQueueItem *queueItem);
+
+void tcpUpdatePathMtu(NetInterface *interface, const IpPseudoHeader *pseudoHeader,
+   uint16_t localPort, uint16_t remotePort, uint32_t seqNum);
+
+void tcpDetectBlackHole(Socket *socket);
+
 error_t tcpRetransmitSegment(Socket *socket);
+error_t tcpRetransmitQueueItem(Socket *socket, TcpQueueItem *queueItem);
 error_t tcpNagleAlgo(Socket *socket);
 
+Socket *tcpLookupSocket(NetInterface *interface,
+   const IpPseudoHeader *pseudoHeader, const TcpHeader *segment);
+
+void tcpHashSocket(Socket *socket);
+
 void tcpChangeState(Socket *socket, TcpState newState);
 
 void tcpUpdateEvents(Socket *socket);
+void tcpBeginRxBatch(void);
+void tcpEndRxBatch(void);
 uint_t tcpWaitForEvents(Socket *socket, uint_t eventMask, time_t timeout);
 
+error_t tcpAllocTxBuffer(Socket *socket);
+void tcpReleaseTxBuffer(Socket *socket);
+error_t tcpAllocRxBuffer(Socket *socket);
+void tcpReleaseRxBuffer(Socket *socket);
+
+error_t tcpAllocBuffer(Socket *socket, ChunkedBuffer *buffer, size_t size);
+void tcpFreeBuffer(Socket *socket, ChunkedBuffer *buffer);
+
 void tcpWriteTxBuffer(Socket *socket, uint32_t seqNum,
    const uint8_t *data, size_t length);
 
+error_t tcpAddTxRegion(Socket *socket, uint32_t seqNum,
+   const uint8_t *data, size_t length);
+
 error_t tcpReadTxBuffer(Socket *socket, uint32_t seqNum,
    ChunkedBuffer *buffer, size_t length);
 
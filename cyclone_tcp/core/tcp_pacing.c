@@ -0,0 +1,187 @@
+/**
+ * @file tcp_pacing.c
+ * @brief TCP send pacing
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * When the congestion window opens up, a whole window of data would
+ * otherwise leave at line rate and overflow the shallow buffers of slow
+ * links. Pacing spreads the segments over the round-trip time, at a rate
+ * derived from cwnd/SRTT or capped by the user. The resolution of the
+ * pacing timer is TCP_TICK_INTERVAL, so the fast TCP timers should be
+ * enabled along with this feature
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TCP_TRACE_LEVEL
+
+//Dependencies
+#include "tcp_ip_stack.h"
+#include "socket.h"
+#include "tcp.h"
+#include "tcp_misc.h"
+#include "tcp_timer.h"
+#include "tcp_pacing.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (TCP_SUPPORT == ENABLED && TCP_PACING_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Compute the current pacing rate
+ *
+ * The rate is cwnd/SRTT scaled by a gain, which is larger during slow
+ * start so that the window can still double every round-trip. The limit
+ * set by the user applies on top of it
+ *
+ * @param[in] socket Handle referencing the socket
+ * @return Pacing rate in bytes per second (0 if no pacing applies)
+ **/
+
+static uint32_t tcpPacingGetRate(Socket *socket)
+{
+   uint_t gain;
+   uint64_t rate;
+
+   //No RTT sample has been taken yet?
+   if(!socket->srtt)
+   {
+      //Only the limit set by the user applies
+      return socket->pacingMaxRate;
+   }
+
+   //Select the pacing gain
+   if(socket->cwnd < socket->ssthresh)
+      gain = TCP_PACING_SS_GAIN;
+   else
+      gain = TCP_PACING_CA_GAIN;
+
+   //Rate at which a window is sent over a round-trip
+   rate = (uint64_t) socket->cwnd * gain * 10 / socket->srtt;
+
+   //Apply the limit set by the user
+   if(socket->pacingMaxRate && rate > socket->pacingMaxRate)
+      rate = socket->pacingMaxRate;
+
+   //Return the pacing rate
+   return (uint32_t) max(rate, 1);
+}
+
+
+/**
+ * @brief Check whether a segment may be sent now
+ *
+ * When the segment must be delayed, the pacing timer is started so
+ * that the transmission resumes on time
+ *
+ * @param[in] socket Handle referencing the socket
+ * @return TRUE if the segment can be sent, else FALSE
+ **/
+
+bool_t tcpPacingCheck(Socket *socket)
+{
+   time_t delay;
+
+   //Pacing is not used on this connection?
+   if(!socket->pacingEnabled)
+      return TRUE;
+
+   //Time before the next segment may be sent
+   delay = socket->pacingNextTime - osGetTickCount();
+
+   //The release time has been reached? A delay longer than any single
+   //interval can only result from a stale release time
+   if((int_t) delay <= 0 || delay > TCP_MAX_RTO)
+      return TRUE;
+
+   //Resume the transmission when the release time is reached
+   if(!osTimerRunning(&socket->pacingTimer))
+      tcpStartTimer(socket, &socket->pacingTimer, delay);
+
+   //The segment must wait
+   return FALSE;
+}
+
+
+/**
+ * @brief Account for a data segment that has just been sent
+ * @param[in] socket Handle referencing the socket
+ * @param[in] length Number of data bytes in the segment
+ **/
+
+void tcpPacingOnTransmit(Socket *socket, uint_t length)
+{
+   time_t time;
+   uint32_t rate;
+   uint64_t interval;
+
+   //Pacing is not used on this connection?
+   if(!socket->pacingEnabled)
+      return;
+
+   //Retrieve the current pacing rate
+   rate = tcpPacingGetRate(socket);
+   //No pacing applies yet?
+   if(!rate)
+      return;
+
+   //Interval between this segment and the next one, in microseconds.
+   //The remainder of the previous interval is carried over so that
+   //the rounding to the tick does not bias the rate
+   interval = (uint64_t) length * 1000000 / rate + socket->pacingRemainder;
+   //A single segment is never delayed for longer than TCP_MAX_RTO
+   interval = min(interval, (uint64_t) TCP_MAX_RTO * 1000);
+
+   //Current time
+   time = osGetTickCount();
+
+   //After an idle period, the schedule restarts from the current time
+   if(timeCompare(socket->pacingNextTime, time) < 0)
+      socket->pacingNextTime = time;
+
+   //Compute the release time of the next segment
+   socket->pacingNextTime += (time_t) (interval / 1000);
+   socket->pacingRemainder = (uint_t) (interval % 1000);
+}
+
+
+/**
+ * @brief Resume a paced transmission
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpPacingTimeout(Socket *socket)
+{
+   //Stop the pacing timer
+   osTimerStop(&socket->pacingTimer);
+
+   //Send the segments whose release time has been reached
+   if(socket->state == TCP_STATE_ESTABLISHED || socket->state == TCP_STATE_CLOSE_WAIT)
+      tcpNagleAlgo(socket);
+}
+
+#endif
@@ -0,0 +1,295 @@
+/**
+ * @file tcp_rack.c
+ * @brief RACK-TLP loss detection
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * RACK detects losses from the transmission time of the segments: a
+ * segment is deemed lost once a segment sent after it has been delivered
+ * and enough time has elapsed to rule out reordering. The Tail Loss Probe
+ * sends a probe when the tail of a flight goes unacknowledged, so that
+ * the losses are detected from the resulting ACK instead of waiting for
+ * the retransmission timeout. Refer to RFC 8985
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TCP_TRACE_LEVEL
+
+//Dependencies
+#include "tcp_ip_stack.h"
+#include "socket.h"
+#include "tcp.h"
+#include "tcp_misc.h"
+#include "tcp_timer.h"
+#include "tcp_rack.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (TCP_SUPPORT == ENABLED && TCP_RACK_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Record the transmission of a segment
+ * @param[in] socket Handle referencing the socket
+ * @param[in] queueItem Segment that has been sent or retransmitted
+ **/
+
+void tcpRackOnTransmit(Socket *socket, TcpQueueItem *queueItem)
+{
+   //Save the transmission time of the segment
+   queueItem->xmitTime = osGetTickCount();
+   //Number of transmissions
+   queueItem->xmitCount++;
+}
+
+
+/**
+ * @brief Update the RACK state when a segment is delivered
+ *
+ * Called for every segment that is newly acknowledged, either
+ * cumulatively or selectively
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] queueItem Segment that has been delivered
+ **/
+
+void tcpRackOnDelivery(Socket *socket, TcpQueueItem *queueItem)
+{
+   time_t rtt;
+   uint32_t endSeq;
+
+   //Time elapsed since the last transmission of the segment
+   rtt = osGetTickCount() - queueItem->xmitTime;
+   //Ending sequence number of the segment
+   endSeq = queueItem->seqNum + queueItem->length;
+
+   //An ACK that arrives sooner than the minimum RTT after a retransmission
+   //was triggered by the original transmission, hence the sample is ambiguous
+   if(queueItem->xmitCount > 1 && rtt < socket->rackMinRtt)
+      return;
+
+   //Keep track of the minimum RTT
+   if(!socket->rackMinRtt || rtt < socket->rackMinRtt)
+      socket->rackMinRtt = max(rtt, 1);
+
+   //Record the most recently sent segment that has been delivered
+   if(!socket->rackDelivered ||
+      timeCompare(queueItem->xmitTime, socket->rackXmitTime) > 0 ||
+      (queueItem->xmitTime == socket->rackXmitTime &&
+      TCP_CMP_SEQ(endSeq, socket->rackEndSeq) > 0))
+   {
+      socket->rackXmitTime = queueItem->xmitTime;
+      socket->rackEndSeq = endSeq;
+      socket->rackRtt = rtt;
+      socket->rackDelivered = TRUE;
+   }
+}
+
+
+/**
+ * @brief Determine whether RACK deems a segment lost
+ * @param[in] socket Handle referencing the socket
+ * @param[in] queueItem Segment to check
+ * @return TRUE if the segment is deemed lost, else FALSE
+ **/
+
+bool_t tcpRackIsLost(Socket *socket, TcpQueueItem *queueItem)
+{
+   time_t reoWnd;
+
+   //No segment has been delivered yet?
+   if(!socket->rackDelivered)
+      return FALSE;
+
+   //Only the segments sent before the most recently delivered one
+   //can be deemed lost
+   if(timeCompare(queueItem->xmitTime, socket->rackXmitTime) > 0)
+      return FALSE;
+   if(queueItem->xmitTime == socket->rackXmitTime &&
+      TCP_CMP_SEQ(queueItem->seqNum + queueItem->length, socket->rackEndSeq) >= 0)
+      return FALSE;
+
+   //The reordering window allows for a quarter of the minimum RTT
+   reoWnd = socket->rackMinRtt / 4;
+   if(socket->srtt)
+      reoWnd = min(reoWnd, socket->srtt);
+
+   //The segment is lost once it has been outstanding for longer
+   //than the RTT of the delivered segment plus the reordering window
+   if((osGetTickCount() - queueItem->xmitTime) >= (socket->rackRtt + reoWnd))
+      return TRUE;
+   else
+      return FALSE;
+}
+
+
+/**
+ * @brief Update the tail loss probe state upon an acceptable ACK
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpRackProcessAck(Socket *socket)
+{
+   //The probe episode ends once the data sent up to the probe
+   //has been acknowledged
+   if(socket->tlpInFlight && TCP_CMP_SEQ(socket->sndUna, socket->tlpEndSeq) >= 0)
+      socket->tlpInFlight = FALSE;
+
+   //Schedule a probe for the remaining flight
+   tcpRackArmTlp(socket);
+}
+
+
+/**
+ * @brief Arm the tail loss probe timer
+ *
+ * The probe timeout is two smoothed RTTs, plus the worst case
+ * delayed ACK time when a single segment is in flight. It never
+ * exceeds the retransmission timeout
+ *
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpRackArmTlp(Socket *socket)
+{
+   time_t pto;
+   time_t rto;
+
+   //Nothing is in flight?
+   if(!socket->retransmitQueueCount)
+   {
+      osTimerStop(&socket->tlpTimer);
+      return;
+   }
+
+   //A probe is already outstanding, or losses are being repaired?
+   if(socket->tlpInFlight || socket->fastRecovery)
+      return;
+   //The connection is not synchronized yet, or no RTT sample is available?
+   if(socket->state == TCP_STATE_SYN_SENT ||
+      socket->state == TCP_STATE_SYN_RECEIVED || !socket->srtt)
+      return;
+
+   //Compute the probe timeout
+   pto = 2 * socket->srtt;
+
+   //A single segment in flight may be acknowledged after a delay
+   if((socket->sndNxt - socket->sndUna) <= socket->mss)
+      pto += TCP_RACK_MAX_ACK_DELAY;
+
+   //The probe must be sent before the retransmission timer expires
+   if(osTimerRunning(&socket->retransmitTimer))
+   {
+      rto = socket->retransmitTimer.startTime + socket->retransmitTimer.interval -
+         osGetTickCount();
+
+      if(timeCompare(rto, 0) <= 0)
+         return;
+
+      pto = min(pto, rto);
+   }
+
+   //Start the tail loss probe timer
+   tcpStartTimer(socket, &socket->tlpTimer, max(pto, TCP_TICK_INTERVAL));
+}
+
+
+/**
+ * @brief Send a tail loss probe
+ *
+ * New data is sent if the windows allow it. Otherwise the last
+ * segment of the retransmission queue is retransmitted
+ *
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void tcpRackTlpTimeout(Socket *socket)
+{
+   uint_t n;
+   uint_t u;
+   error_t error;
+   TcpQueueItem *queueItem;
+
+   //Stop the tail loss probe timer
+   osTimerStop(&socket->tlpTimer);
+
+   //Nothing to probe?
+   if(!socket->retransmitQueueCount || socket->fastRecovery)
+      return;
+
+   //Debug message
+   TRACE_INFO("%s: TCP tail loss probe...\r\n", timeFormat(osGetTickCount()));
+
+   //No other probe is sent until this one is acknowledged
+   socket->tlpInFlight = TRUE;
+
+   //Size of the usable window
+   n = min(socket->sndWnd, socket->cwnd);
+   u = (n > (socket->sndNxt - socket->sndUna)) ? n - (socket->sndNxt - socket->sndUna) : 0;
+   //Number of bytes of new data that can be sent
+   n = min(u, socket->sndUser);
+   n = min(n, socket->mss);
+
+   //Prefer sending new data, which elicits an ACK just as well
+   if(n > 0 && socket->retransmitQueueCount < (TCP_RETRANSMIT_QUEUE_SIZE - 1))
+   {
+      //Send TCP segment
+      error = tcpSendSegment(socket, TCP_FLAG_PSH | TCP_FLAG_ACK,
+         socket->sndNxt, socket->rcvNxt, n, TRUE);
+
+      //Successful transmission?
+      if(!error)
+      {
+         //Advance SND.NXT pointer
+         socket->sndNxt += n;
+         //Update the number of data buffered but not yet sent
+         socket->sndUser -= n;
+      }
+   }
+   else
+   {
+      //Point to the last segment of the retransmission queue
+      queueItem = &socket->retransmitQueue[(socket->retransmitQueueHead +
+         socket->retransmitQueueCount - 1) % TCP_RETRANSMIT_QUEUE_SIZE];
+
+      //Retransmit the segment
+      error = tcpRetransmitQueueItem(socket, queueItem);
+   }
+
+   //Record the extent of the flight covered by the probe
+   socket->tlpEndSeq = socket->sndNxt;
+
+#if (TCP_INFO_SUPPORT == ENABLED)
+   //Number of tail loss probes
+   if(!error)
+      socket->stats.tailLossProbes++;
+#endif
+
+   //The retransmission timer is restarted after the probe
+   tcpStartTimer(socket, &socket->retransmitTimer, socket->rto);
+}
+
+#endif
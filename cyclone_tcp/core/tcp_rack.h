@@ -0,0 +1,44 @@
+/**
+ * @file tcp_rack.h
+ * @brief RACK-TLP loss detection
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _TCP_RACK_H
+#define _TCP_RACK_H
+
+//Dependencies
+#include "tcp.h"
+
+//RACK-TLP related functions
+void tcpRackOnTransmit(Socket *socket, TcpQueueItem *queueItem);
+void tcpRackOnDelivery(Socket *socket, TcpQueueItem *queueItem);
+bool_t tcpRackIsLost(Socket *socket, TcpQueueItem *queueItem);
+
+void tcpRackProcessAck(Socket *socket);
+void tcpRackArmTlp(Socket *socket);
+void tcpRackTlpTimeout(Socket *socket);
+
+#endif
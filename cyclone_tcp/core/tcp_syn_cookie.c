@@ -0,0 +1,295 @@
+/**
+ * @file tcp_syn_cookie.c
+ * @brief SYN cookies
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * When the SYN queue of a listening socket is full, the SYN ACK is sent
+ * without keeping any state. The initial sequence number carries the
+ * connection parameters instead:
+ * - Bits 31-27: counter incremented every TCP_SYN_COOKIE_PERIOD
+ * - Bits 26-24: index of the peer MSS in a table of common values
+ * - Bits 23-0: keyed hash of the 4-tuple, the ISN of the peer, the
+ *   counter and the MSS index
+ *
+ * The final ACK of the handshake is accepted if it acknowledges a cookie
+ * issued during the current or the previous period. Since the Window
+ * Scale, SACK Permitted and Timestamps options cannot be encoded, they
+ * are not used on such connections. Refer to RFC 4987, section 3.6
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TCP_TRACE_LEVEL
+
+//Dependencies
+#include <stdlib.h>
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "socket.h"
+#include "tcp.h"
+#include "tcp_misc.h"
+#include "tcp_syn_cookie.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (TCP_SUPPORT == ENABLED && TCP_SYN_COOKIE_SUPPORT == ENABLED)
+
+//MSS values that can be encoded in a cookie
+static const uint16_t tcpSynCookieMssTable[8] =
+{
+   536, 1200, 1300, 1360, 1400, 1440, 1460, 8960
+};
+
+//Secret key
+static uint32_t tcpSynCookieSecret[2];
+
+//SYN cookie helpers
+static uint32_t tcpSynCookieHash(const IpPseudoHeader *pseudoHeader,
+   const TcpHeader *segment, uint32_t isn, uint32_t counter, uint_t index);
+static uint32_t tcpSynCookieMix(uint32_t h, uint32_t x);
+
+
+/**
+ * @brief Answer a SYN with a SYN cookie
+ * @param[in] socket Handle referencing the listening socket
+ * @param[in] interface Underlying network interface
+ * @param[in] pseudoHeader TCP pseudo header
+ * @param[in] segment Incoming SYN segment
+ * @return Error code
+ **/
+
+error_t tcpSendSynCookie(Socket *socket, NetInterface *interface,
+   IpPseudoHeader *pseudoHeader, TcpHeader *segment)
+{
+   uint_t i;
+   uint16_t mss;
+   uint32_t counter;
+   uint32_t cookie;
+   IpAddr srcIpAddr;
+   TcpOption *option;
+
+#if (IPV4_SUPPORT == ENABLED)
+   //IPv4 packet received?
+   if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
+   {
+      //Retrieve the source IPv4 address
+      srcIpAddr.length = sizeof(Ipv4Addr);
+      srcIpAddr.ipv4Addr = pseudoHeader->ipv4Data.srcAddr;
+   }
+   else
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 packet received?
+   if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
+   {
+      //Retrieve the source IPv6 address
+      srcIpAddr.length = sizeof(Ipv6Addr);
+      srcIpAddr.ipv6Addr = pseudoHeader->ipv6Data.srcAddr;
+   }
+   else
+#endif
+   //An invalid packet was received?
+   {
+      //This should never occur...
+      return ERROR_INVALID_ADDRESS;
+   }
+
+   //Generate the secret key on first use
+   if(!tcpSynCookieSecret[0] && !tcpSynCookieSecret[1])
+   {
+      tcpSynCookieSecret[0] = ((uint32_t) rand() << 16) ^ rand() ^ osGetTickCount();
+      tcpSynCookieSecret[1] = ((uint32_t) rand() << 16) ^ rand();
+   }
+
+   //Default MSS value
+   mss = TCP_DEFAULT_MSS;
+
+   //Get the maximum segment size
+   option = tcpGetOption(segment, TCP_OPTION_MAX_SEGMENT_SIZE);
+   //Specified option found?
+   if(option && option->length == 4)
+   {
+      //Retrieve MSS value
+      memcpy(&mss, option->value, 2);
+      //Convert from network byte order to host byte order
+      mss = ntohs(mss);
+   }
+
+   //Make sure that the MSS advertised by the peer is acceptable
+   mss = min(mss, tcpGetMaxMss(interface, &srcIpAddr));
+
+   //Select the largest value of the table that does not exceed the MSS
+   for(i = arraysize(tcpSynCookieMssTable) - 1; i > 0; i--)
+   {
+      if(tcpSynCookieMssTable[i] <= mss)
+         break;
+   }
+
+   //Current value of the counter
+   counter = osGetTickCount() / TCP_SYN_COOKIE_PERIOD;
+
+   //Format the cookie
+   cookie = (counter & 0x1F) << 27;
+   cookie |= (uint32_t) i << 24;
+   cookie |= tcpSynCookieHash(pseudoHeader, segment,
+      segment->seqNum, counter, i) & 0x00FFFFFF;
+
+   //Debug message
+   TRACE_DEBUG("%s: Sending TCP SYN cookie...\r\n", timeFormat(osGetTickCount()));
+
+   //Send a SYN ACK whose sequence number is the cookie
+   return tcpSendReplySegment(interface, pseudoHeader, segment,
+      TCP_FLAG_SYN | TCP_FLAG_ACK, cookie, segment->seqNum + 1,
+      min(socket->rxBufferSize, UINT16_MAX), tcpGetMaxMss(interface, &srcIpAddr));
+}
+
+
+/**
+ * @brief Check whether an incoming ACK completes a handshake that used a SYN cookie
+ * @param[in] interface Underlying network interface
+ * @param[in] pseudoHeader TCP pseudo header
+ * @param[in] segment Incoming ACK segment
+ * @param[out] mss MSS of the peer, decoded from the cookie
+ * @return Error code
+ **/
+
+error_t tcpCheckSynCookie(NetInterface *interface,
+   const IpPseudoHeader *pseudoHeader, const TcpHeader *segment, uint16_t *mss)
+{
+   uint_t i;
+   uint_t index;
+   uint32_t counter;
+   uint32_t cookie;
+
+   //No cookie has been issued so far?
+   if(!tcpSynCookieSecret[0] && !tcpSynCookieSecret[1])
+      return ERROR_FAILURE;
+
+   //The acknowledgment number covers the cookie and the SYN
+   cookie = segment->ackNum - 1;
+   //Retrieve the index of the MSS value
+   index = (cookie >> 24) & 0x07;
+
+   //Current value of the counter
+   counter = osGetTickCount() / TCP_SYN_COOKIE_PERIOD;
+
+   //The cookie may have been issued during the current or the previous period
+   for(i = 0; i < 2; i++, counter--)
+   {
+      //Check the counter bits
+      if((cookie >> 27) != (counter & 0x1F))
+         continue;
+
+      //Check the hash bits
+      if((cookie & 0x00FFFFFF) == (tcpSynCookieHash(pseudoHeader, segment,
+         segment->seqNum - 1, counter, index) & 0x00FFFFFF))
+      {
+         //Decode the MSS of the peer
+         *mss = tcpSynCookieMssTable[index];
+         //The cookie is valid
+         return NO_ERROR;
+      }
+   }
+
+   //The ACK does not match any cookie
+   return ERROR_FAILURE;
+}
+
+
+/**
+ * @brief Compute the keyed hash encoded in a cookie
+ * @param[in] pseudoHeader TCP pseudo header
+ * @param[in] segment Segment sent by the peer
+ * @param[in] isn Initial sequence number of the peer
+ * @param[in] counter Counter value
+ * @param[in] index Index of the MSS value
+ * @return Hash value
+ **/
+
+static uint32_t tcpSynCookieHash(const IpPseudoHeader *pseudoHeader,
+   const TcpHeader *segment, uint32_t isn, uint32_t counter, uint_t index)
+{
+   uint_t i;
+   uint32_t h;
+
+   //Start with the secret key
+   h = tcpSynCookieSecret[0];
+
+#if (IPV4_SUPPORT == ENABLED)
+   //IPv4 packet?
+   if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
+   {
+      //Mix in the IPv4 addresses
+      h = tcpSynCookieMix(h, pseudoHeader->ipv4Data.srcAddr);
+      h = tcpSynCookieMix(h, pseudoHeader->ipv4Data.destAddr);
+   }
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+   //IPv6 packet?
+   if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
+   {
+      //Mix in the IPv6 addresses
+      for(i = 0; i < 4; i++)
+      {
+         h = tcpSynCookieMix(h, pseudoHeader->ipv6Data.srcAddr.dw[i]);
+         h = tcpSynCookieMix(h, pseudoHeader->ipv6Data.destAddr.dw[i]);
+      }
+   }
+#endif
+
+   //Mix in the port numbers, the ISN of the peer and the encoded values
+   h = tcpSynCookieMix(h, ((uint32_t) segment->srcPort << 16) | segment->destPort);
+   h = tcpSynCookieMix(h, isn);
+   h = tcpSynCookieMix(h, (counter << 3) | index);
+   h = tcpSynCookieMix(h, tcpSynCookieSecret[1]);
+
+   //Final avalanche
+   h ^= h >> 13;
+   h *= 0x85EBCA6B;
+   h ^= h >> 16;
+
+   //Return the hash value
+   return h;
+}
+
+
+/**
+ * @brief Mix a 32-bit word into a hash value
+ * @param[in] h Current hash value
+ * @param[in] x Word to be mixed in
+ * @return Updated hash value
+ **/
+
+static uint32_t tcpSynCookieMix(uint32_t h, uint32_t x)
+{
+   h ^= x;
+   h *= 0x9E3779B1;
+   h ^= h >> 15;
+
+   return h;
+}
+
+#endif
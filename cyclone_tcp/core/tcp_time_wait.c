@@ -0,0 +1,274 @@
+/**
+ * @file tcp_time_wait.c
+ * @brief Compact TIME-WAIT state
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * A connection that enters the TIME-WAIT state after the user has
+ * closed the socket only needs its 4-tuple and its sequence numbers.
+ * They are moved to a small table and the socket is released at once,
+ * so that the number of sockets does not limit the rate at which
+ * connections can be closed. The entries expire on their own when
+ * the 2MSL time has elapsed
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL TCP_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "socket.h"
+#include "tcp.h"
+#include "tcp_misc.h"
+#include "tcp_time_wait.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (TCP_SUPPORT == ENABLED && TCP_COMPACT_TIME_WAIT_SUPPORT == ENABLED)
+
+//Connections in the compact TIME-WAIT state
+static TcpTimeWaitEntry tcpTimeWaitTable[TCP_TIME_WAIT_TABLE_SIZE];
+
+//Compact TIME-WAIT helpers
+static TcpTimeWaitEntry *tcpFindTimeWaitEntry(NetInterface *interface,
+   const IpPseudoHeader *pseudoHeader, const TcpHeader *segment);
+static bool_t tcpIsTimeWaitEntryExpired(TcpTimeWaitEntry *entry);
+
+
+/**
+ * @brief Move a connection in the TIME-WAIT state to the compact table
+ *
+ * On success, the TCB is deleted and the socket is released
+ *
+ * @param[in] socket Handle referencing a socket the user does not own anymore
+ * @return Error code
+ **/
+
+error_t tcpCompactTimeWait(Socket *socket)
+{
+   uint_t i;
+   TcpTimeWaitEntry *entry;
+
+   //Loop through the table
+   for(i = 0; i < TCP_TIME_WAIT_TABLE_SIZE; i++)
+   {
+      //Point to the current entry
+      entry = &tcpTimeWaitTable[i];
+
+      //Free entry?
+      if(!entry->used || tcpIsTimeWaitEntryExpired(entry))
+         break;
+   }
+
+   //The table is full?
+   if(i >= TCP_TIME_WAIT_TABLE_SIZE)
+   {
+      //The socket stays in the TIME-WAIT state until the 2MSL timer elapses
+      return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Save the 4-tuple and the sequence numbers
+   entry->used = TRUE;
+   entry->interface = socket->interface;
+   entry->localIpAddr = socket->localIpAddr;
+   entry->localPort = socket->localPort;
+   entry->remoteIpAddr = socket->remoteIpAddr;
+   entry->remotePort = socket->remotePort;
+   entry->sndNxt = socket->sndNxt;
+   entry->rcvNxt = socket->rcvNxt;
+   //The remaining TIME-WAIT period is preserved
+   entry->timestamp = socket->timeWaitTimer.startTime;
+
+   //Debug message
+   TRACE_DEBUG("TCP connection moved to the compact TIME-WAIT table (socket %u)\r\n",
+      socket->descriptor);
+
+   //Enter CLOSED state
+   tcpChangeState(socket, TCP_STATE_CLOSED);
+   //Delete the TCB
+   tcpDeleteControlBlock(socket);
+   //Mark the socket as closed
+   socketRelease(socket);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Process a segment addressed to a connection in the compact TIME-WAIT state
+ * @param[in] interface Underlying network interface
+ * @param[in] pseudoHeader TCP pseudo header
+ * @param[in] segment Incoming TCP segment
+ * @param[in] length Length of the segment data
+ * @return TRUE if the segment has been consumed, else FALSE
+ **/
+
+bool_t tcpProcessTimeWaitSegment(NetInterface *interface,
+   IpPseudoHeader *pseudoHeader, TcpHeader *segment, size_t length)
+{
+   TcpTimeWaitEntry *entry;
+
+   //Look for a matching entry
+   entry = tcpFindTimeWaitEntry(interface, pseudoHeader, segment);
+   //No connection in the TIME-WAIT state?
+   if(entry == NULL)
+      return FALSE;
+
+   //Debug message
+   TRACE_DEBUG("TCP FSM: compact TIME-WAIT state\r\n");
+
+   //Check the RST bit
+   if(segment->flags & TCP_FLAG_RST)
+   {
+      //The connection is closed
+      if(segment->seqNum == entry->rcvNxt)
+         entry->used = FALSE;
+
+      //Drop the segment
+      return TRUE;
+   }
+
+   //A new SYN with a higher sequence number may reopen the connection
+   //(refer to RFC 1122 4.2.2.13)
+   if((segment->flags & TCP_FLAG_SYN) && !(segment->flags & TCP_FLAG_ACK) &&
+      TCP_CMP_SEQ(segment->seqNum, entry->rcvNxt) > 0)
+   {
+      //Release the entry and let the listening socket handle the SYN
+      entry->used = FALSE;
+      return FALSE;
+   }
+
+   //A retransmission of the remote FIN restarts the 2MSL timeout
+   if(segment->flags & TCP_FLAG_FIN)
+      entry->timestamp = osGetTickCount();
+
+   //Acknowledge the segment
+   tcpSendReplySegment(interface, pseudoHeader, segment,
+      TCP_FLAG_ACK, entry->sndNxt, entry->rcvNxt, 0, 0);
+
+   //The segment has been consumed
+   return TRUE;
+}
+
+
+/**
+ * @brief Find the compact TIME-WAIT entry an incoming segment belongs to
+ * @param[in] interface Underlying network interface
+ * @param[in] pseudoHeader TCP pseudo header
+ * @param[in] segment Incoming TCP segment
+ * @return Pointer to the matching entry, or NULL if there is none
+ **/
+
+static TcpTimeWaitEntry *tcpFindTimeWaitEntry(NetInterface *interface,
+   const IpPseudoHeader *pseudoHeader, const TcpHeader *segment)
+{
+   uint_t i;
+   TcpTimeWaitEntry *entry;
+
+   //Loop through the table
+   for(i = 0; i < TCP_TIME_WAIT_TABLE_SIZE; i++)
+   {
+      //Point to the current entry
+      entry = &tcpTimeWaitTable[i];
+
+      //Skip unused entries
+      if(!entry->used)
+         continue;
+      //Check interface and port numbers
+      if(entry->interface != interface || entry->localPort != segment->destPort ||
+         entry->remotePort != segment->srcPort)
+      {
+         continue;
+      }
+
+#if (IPV4_SUPPORT == ENABLED)
+      //IPv4 packet received?
+      if(pseudoHeader->length == sizeof(Ipv4PseudoHeader))
+      {
+         //Check IPv4 addresses
+         if(entry->remoteIpAddr.length != sizeof(Ipv4Addr) ||
+            entry->remoteIpAddr.ipv4Addr != pseudoHeader->ipv4Data.srcAddr ||
+            entry->localIpAddr.ipv4Addr != pseudoHeader->ipv4Data.destAddr)
+         {
+            continue;
+         }
+      }
+      else
+#endif
+#if (IPV6_SUPPORT == ENABLED)
+      //IPv6 packet received?
+      if(pseudoHeader->length == sizeof(Ipv6PseudoHeader))
+      {
+         //Check IPv6 addresses
+         if(entry->remoteIpAddr.length != sizeof(Ipv6Addr) ||
+            !ipv6CompAddr(&entry->remoteIpAddr.ipv6Addr, &pseudoHeader->ipv6Data.srcAddr) ||
+            !ipv6CompAddr(&entry->localIpAddr.ipv6Addr, &pseudoHeader->ipv6Data.destAddr))
+         {
+            continue;
+         }
+      }
+      else
+#endif
+      //Invalid pseudo header?
+      {
+         continue;
+      }
+
+      //The 2MSL time has elapsed?
+      if(tcpIsTimeWaitEntryExpired(entry))
+      {
+         //Release the entry
+         entry->used = FALSE;
+         return NULL;
+      }
+
+      //A matching entry has been found
+      return entry;
+   }
+
+   //No matching entry
+   return NULL;
+}
+
+
+/**
+ * @brief Check whether the 2MSL time of a compact TIME-WAIT entry has elapsed
+ * @param[in] entry Pointer to the entry
+ * @return TRUE if the entry has expired, else FALSE
+ **/
+
+static bool_t tcpIsTimeWaitEntryExpired(TcpTimeWaitEntry *entry)
+{
+   //Compare the elapsed time with the 2MSL timeout
+   if(timeCompare(osGetTickCount(), entry->timestamp + TCP_2MSL_TIMER) >= 0)
+      return TRUE;
+   else
+      return FALSE;
+}
+
+#endif
@@ -0,0 +1,60 @@
+/**
+ * @file tcp_time_wait.h
+ * @brief Compact TIME-WAIT state
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _TCP_TIME_WAIT_H
+#define _TCP_TIME_WAIT_H
+
+//Dependencies
+#include "tcp.h"
+
+
+/**
+ * @brief Connection in the compact TIME-WAIT state
+ **/
+
+typedef struct
+{
+   bool_t used;             ///<The entry is in use
+   NetInterface *interface; ///<Underlying network interface
+   IpAddr localIpAddr;      ///<Local IP address
+   uint16_t localPort;      ///<Local port number
+   IpAddr remoteIpAddr;     ///<IP address of the remote host
+   uint16_t remotePort;     ///<Port number used by the remote host
+   uint32_t sndNxt;         ///<Sequence number following our FIN
+   uint32_t rcvNxt;         ///<Sequence number following the FIN of the peer
+   time_t timestamp;        ///<Time at which the 2MSL timer was last started
+} TcpTimeWaitEntry;
+
+
+//Compact TIME-WAIT related functions
+error_t tcpCompactTimeWait(Socket *socket);
+
+bool_t tcpProcessTimeWaitSegment(NetInterface *interface,
+   IpPseudoHeader *pseudoHeader, TcpHeader *segment, size_t length);
+
+#endif
@@ -34,6 +34,10 @@
 #include "socket.h"
 #include "tcp.h"
 #include "tcp_misc.h"
+#include "tcp_congestion.h"
+#include "tcp_rack.h"
+#include "tcp_pacing.h"
+#include "tcp_timer.h"
 #include "ipv4.h"
 #include "debug.h"
 
@@ -41,212 +45,542 @@
 #if (TCP_SUPPORT == ENABLED)
 
 
+//Timer wheel shared by all the connections
+static NetTimerWheel tcpTimerWheel;
+
+#if (TCP_FAST_TIMER_SUPPORT == ENABLED)
+//Event used to wake up the timer task
+static OsEvent *tcpTimerEvent;
+#else
+//Timer service entry that drives the wheel
+static NetTimer tcpServiceTimer;
+#endif
+
+//TCP timer related functions
+static void tcpTimerHandler(void *param);
+static void tcpScheduleTimer(Socket *socket);
+
+#if (TCP_FAST_TIMER_SUPPORT == DISABLED)
+static void tcpServiceTimerHandler(void *param);
+static void tcpScheduleTick(void);
+#endif
+
+
+/**
+ * @brief TCP timer initialization
+ * @return Error code
+ **/
+
+error_t tcpTimerInit(void)
+{
+#if (TCP_FAST_TIMER_SUPPORT == ENABLED)
+   OsTask *task;
+#endif
+
+   //The wheel advances at the rate of tcpTick calls
+   netTimerWheelInit(&tcpTimerWheel, TCP_TICK_INTERVAL);
+
+#if (TCP_FAST_TIMER_SUPPORT == ENABLED)
+   //Create the event that paces the timer task
+   tcpTimerEvent = osEventCreateSingleWaiter(FALSE);
+   //Out of resources?
+   if(tcpTimerEvent == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //The TCP timers are handled by a dedicated task rather than
+   //by the coarse periodic task of the stack
+   task = osTaskCreate("TCP/IP Stack (TCP Timer)", tcpTimerTask,
+      NULL, TCP_TIMER_STACK_SIZE, TCP_TIMER_PRIORITY);
+   //Unable to create the task?
+   if(task == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+#endif
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
 /**
  * @brief TCP timer handler
  *
  * This routine must be periodically called by the TCP/IP stack to
- * handle retransmissions and TCP related timers (persist timer,
- * FIN-WAIT-2 timer and TIME-WAIT timer)
+ * handle retransmissions and TCP related timers. Only the connections
+ * whose earliest timer is due are visited
  *
  **/
 
 void tcpTick(void)
 {
-   error_t error;
+   //Enter critical section
+   osMutexAcquire(socketMutex);
+   //Process the connections whose timers have expired
+   netTimerWheelAdvance(&tcpTimerWheel);
+#if (TCP_FAST_TIMER_SUPPORT == DISABLED)
+   //Sleep until the next connection is due
+   tcpScheduleTick();
+#endif
+   //Leave critical section
+   osMutexRelease(socketMutex);
+}
+
+
+#if (TCP_FAST_TIMER_SUPPORT == ENABLED)
+
+/**
+ * @brief Task in charge of the high-resolution TCP timers
+ *
+ * The task wakes up every TCP_TICK_INTERVAL. When the resolution of
+ * the OS tick is too coarse, a hardware timer can wake it up at the
+ * desired rate by calling tcpTimerIrqHandler()
+ *
+ * @param[in] param Unused parameter
+ **/
+
+void tcpTimerTask(void *param)
+{
+   //Attach a private cache of free blocks to the current task
+   memPoolCacheRegister();
+
+   //Main loop
+   while(1)
+   {
+      //Wait for the next tick
+      osEventWait(tcpTimerEvent, TCP_TICK_INTERVAL);
+      //Process the connections whose timers have expired
+      tcpTick();
+   }
+}
+
+
+/**
+ * @brief Hardware timer interrupt hook
+ *
+ * This routine may be called from the interrupt service routine of a
+ * hardware timer running at the rate of TCP_TICK_INTERVAL
+ *
+ * @return TRUE if a higher priority task must be woken. Else FALSE is returned
+ **/
+
+bool_t tcpTimerIrqHandler(void)
+{
+   //Wake up the timer task
+   return osEventSetFromIrq(tcpTimerEvent);
+}
+
+#else
+
+/**
+ * @brief Timer service callback
+ * @param[in] param Unused parameter
+ **/
+
+static void tcpServiceTimerHandler(void *param)
+{
+   //Process the connections whose timers have expired
+   tcpTick();
+}
+
+
+/**
+ * @brief Arm the timer service for the next tick that has work to do
+ *
+ * The wheel is only advanced when a connection is due, so that idle
+ * connections do not wake up the TCP/IP stack tick task
+ *
+ **/
+
+static void tcpScheduleTick(void)
+{
+   time_t delay;
+
+   //Time left before the earliest connection is due
+   delay = netTimerWheelGetDelay(&tcpTimerWheel);
+
+   //Any connection to wake up?
+   if(delay != INFINITE_DELAY)
+      netTimerServiceStart(&tcpServiceTimer, delay, tcpServiceTimerHandler, NULL);
+   else
+      netTimerServiceStop(&tcpServiceTimer);
+}
+
+#endif
+
+
+/**
+ * @brief Start one of the timers of a connection
+ *
+ * The connection is scheduled on the timer wheel if the new timer
+ * expires before the ones that are already running
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in] timer Timer to be started
+ * @param[in] delay Time before expiration
+ **/
+
+void tcpStartTimer(Socket *socket, OsTimer *timer, time_t delay)
+{
+   //Start the timer
+   osTimerStart(timer, delay);
+
+   //Wake up the connection earlier if necessary
+   if(!netTimerRunning(&socket->timer) ||
+      timeCompare(timer->startTime + delay, socket->timerDeadline) < 0)
+   {
+      socket->timerDeadline = timer->startTime + delay;
+      netTimerStart(&tcpTimerWheel, &socket->timer, delay, tcpTimerHandler, socket);
+
+#if (TCP_FAST_TIMER_SUPPORT == DISABLED)
+      //The timer service may have to wake up earlier
+      tcpScheduleTick();
+#endif
+   }
+}
+
+
+/**
+ * @brief Schedule a connection for its earliest pending timer
+ * @param[in] socket Handle referencing the socket
+ **/
+
+static void tcpScheduleTimer(Socket *socket)
+{
    uint_t i;
+   time_t time;
+   time_t deadline;
+   bool_t pending;
+   OsTimer *timer[8];
+
+   //Timers of the connection
+   timer[0] = &socket->retransmitTimer;
+   timer[1] = &socket->persistTimer;
+   timer[2] = &socket->overrideTimer;
+   timer[3] = &socket->finWait2Timer;
+   timer[4] = &socket->timeWaitTimer;
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+   timer[5] = &socket->delayedAckTimer;
+#else
+   timer[5] = NULL;
+#endif
+#if (TCP_RACK_SUPPORT == ENABLED)
+   timer[6] = &socket->tlpTimer;
+#else
+   timer[6] = NULL;
+#endif
+#if (TCP_PACING_SUPPORT == ENABLED)
+   timer[7] = &socket->pacingTimer;
+#else
+   timer[7] = NULL;
+#endif
+
+   //Current time
+   time = osGetTickCount();
+   //No timer is pending yet
+   pending = FALSE;
+   deadline = 0;
+
+   //Find the earliest timer that has not expired yet. Expired timers
+   //whose condition did not hold are left alone, since they are always
+   //restarted before their condition can hold again
+   for(i = 0; i < arraysize(timer); i++)
+   {
+      if(timer[i] != NULL && osTimerRunning(timer[i]) &&
+         timeCompare(timer[i]->startTime + timer[i]->interval, time) > 0)
+      {
+         if(!pending || timeCompare(timer[i]->startTime + timer[i]->interval, deadline) < 0)
+            deadline = timer[i]->startTime + timer[i]->interval;
+
+         pending = TRUE;
+      }
+   }
+
+   //Schedule the connection on the timer wheel
+   if(pending)
+   {
+      socket->timerDeadline = deadline;
+      netTimerStart(&tcpTimerWheel, &socket->timer, deadline - time, tcpTimerHandler, socket);
+   }
+   else
+   {
+      netTimerStop(&socket->timer);
+   }
+}
+
+
+/**
+ * @brief Handle the expired timers of a connection
+ *
+ * This routine is invoked from the timer wheel when the earliest
+ * timer of the connection is due. It takes care of retransmissions
+ * and TCP related timers (persist timer, override timer, delayed ACK
+ * timer, FIN-WAIT-2 timer and TIME-WAIT timer)
+ *
+ * @param[in] param Handle referencing the socket
+ **/
+
+static void tcpTimerHandler(void *param)
+{
+   error_t error;
    uint_t n;
    uint_t u;
+   Socket *socket;
 
-   //Enter critical section
-   osMutexAcquire(socketMutex);
+   //Point to the socket
+   socket = (Socket *) param;
 
-   //Loop through opened sockets
-   for(i = 0; i < SOCKET_MAX_COUNT; i++)
+   //Check socket type and the state of the TCP state machine
+   if(socket->type != SOCKET_TYPE_STREAM || socket->state == TCP_STATE_CLOSED)
+      return;
+
+   //Is there any packet in the retransmission queue?
+   if(socket->retransmitQueueCount > 0)
    {
-      //Shortcut to the current socket
-      Socket *socket = socketTable + i;
-      //Check socket type
-      if(socket->type != SOCKET_TYPE_STREAM)
-         continue;
-      //Check the current state of the TCP state machine
-      if(socket->state == TCP_STATE_CLOSED)
-         continue;
-
-      //Is there any packet in the retransmission queue?
-      if(socket->retransmitQueue != NULL)
+      //Retransmission timeout?
+      if(osTimerElapsed(&socket->retransmitTimer))
       {
-         //Retransmission timeout?
-         if(osTimerElapsed(&socket->retransmitTimer))
+         //When a TCP sender detects segment loss using the retransmission
+         //timer and the given segment has not yet been resent by way of
+         //the retransmission timer, the value of ssthresh must be updated
+         if(!socket->retransmitCount)
          {
-            //When a TCP sender detects segment loss using the retransmission
-            //timer and the given segment has not yet been resent by way of
-            //the retransmission timer, the value of ssthresh must be updated
-            if(!socket->retransmitCount)
+#if (TCP_TIMESTAMP_SUPPORT == ENABLED)
+            //Save the congestion state so that it can be restored if
+            //the timeout turns out to be spurious (refer to RFC 3522)
+            if(socket->tsFlag)
             {
-               //Amount of data that has been sent but not yet acknowledged
-               uint_t flightSize = socket->sndNxt - socket->sndUna;
-               //Adjust ssthresh value
-               socket->ssthresh = max(flightSize / 2, 2 * socket->mss);
+               socket->tsRtoFlag = TRUE;
+               socket->tsRtoVal = (uint32_t) osGetTickCount();
+               socket->tsPrevCwnd = socket->cwnd;
+               socket->tsPrevSsthresh = socket->ssthresh;
             }
+#endif
+
+            //Adjust ssthresh value
+            socket->congestionAlgo->lossDetected(socket);
+         }
 
-            //Furthermore, upon a timeout cwnd must be set to no more than
-            //the loss window, LW, which equals 1 full-sized segment
-            socket->cwnd = min(TCP_LOSS_WINDOW * socket->mss, socket->txBufferSize);
+         //Furthermore, upon a timeout cwnd must be set to no more than
+         //the loss window, LW, which equals 1 full-sized segment
+         socket->congestionAlgo->timeout(socket);
 
-            //Make sure the maximum number of retransmissions has not been reached
-            if(socket->retransmitCount < TCP_MAX_RETRIES)
-            {
-               //Debug message
-               TRACE_INFO("%s: TCP segment retransmission #%u (%u data bytes)...\r\n",
-                  timeFormat(osGetTickCount()), socket->retransmitCount + 1, socket->retransmitQueue->length);
-
-               //Retransmit the earliest segment that has not been
-               //acknowledged by the TCP receiver
-               tcpRetransmitSegment(socket);
-
-               //Use exponential back-off algorithm to calculate the new RTO
-               socket->rto = min(socket->rto * 2, TCP_MAX_RTO);
-               //Restart retransmission timer
-               osTimerStart(&socket->retransmitTimer, socket->rto);
-               //Increment retransmission counter
-               socket->retransmitCount++;
-            }
-            else
-            {
-               //The maximum number of retransmissions has been exceeded
-               tcpChangeState(socket, TCP_STATE_CLOSED);
-               //Turn off the retransmission timer
-               osTimerStop(&socket->retransmitTimer);
-            }
+#if (TCP_SACK_SUPPORT == ENABLED)
+         //SACK information is not relied upon after a timeout
+         tcpClearScoreboard(socket);
+#endif
+
+         //Leave fast recovery and record the highest sequence number
+         //transmitted so far (refer to RFC 6582 section 3.2 step 4)
+         socket->fastRecovery = FALSE;
+         socket->recover = socket->sndNxt;
+
+#if (TCP_RACK_SUPPORT == ENABLED)
+         //The timeout supersedes any outstanding tail loss probe
+         osTimerStop(&socket->tlpTimer);
+         socket->tlpInFlight = FALSE;
+#endif
+
+#if (TCP_PLPMTUD_SUPPORT == ENABLED)
+         //Full-sized segments that keep timing out may be dropped by
+         //a router that does not report the MTU of the path
+         if((socket->retransmitCount + 1) == TCP_PLPMTUD_RTO_THRESHOLD)
+            tcpDetectBlackHole(socket);
+#endif
+
+         //Make sure the maximum number of retransmissions has not been reached
+         if(socket->retransmitCount < TCP_MAX_RETRIES)
+         {
+            //Debug message
+            TRACE_INFO("%s: TCP segment retransmission #%u (%u data bytes)...\r\n",
+               timeFormat(osGetTickCount()), socket->retransmitCount + 1, tcpFirstQueueItem(socket)->length);
+
+#if (TCP_INFO_SUPPORT == ENABLED)
+            //Number of retransmission timer expirations
+            socket->stats.timeouts++;
+#endif
+            //Retransmit the earliest segment that has not been
+            //acknowledged by the TCP receiver
+            tcpRetransmitSegment(socket);
 
-            //TCP must use Karn's algorithm for taking RTT samples. That is, RTT
-            //samples must not be made using segments that were retransmitted
-            socket->rttBusy = FALSE;
+            //Use exponential back-off algorithm to calculate the new RTO
+            socket->rto = min(socket->rto * 2, TCP_MAX_RTO);
+            //Restart retransmission timer
+            osTimerStart(&socket->retransmitTimer, socket->rto);
+            //Increment retransmission counter
+            socket->retransmitCount++;
+         }
+         else
+         {
+            //The maximum number of retransmissions has been exceeded
+            tcpChangeState(socket, TCP_STATE_CLOSED);
+            //Turn off the retransmission timer
+            osTimerStop(&socket->retransmitTimer);
          }
+
+         //TCP must use Karn's algorithm for taking RTT samples. That is, RTT
+         //samples must not be made using segments that were retransmitted
+         socket->rttBusy = FALSE;
       }
+   }
 
-      //Check the current state of the TCP state machine
-      if(socket->state == TCP_STATE_CLOSED)
-         continue;
+   //Check the current state of the TCP state machine
+   if(socket->state == TCP_STATE_CLOSED)
+      return;
 
-      //The persist timer is used when the remote host advertises
-      //a window size of zero
-      if(!socket->sndWnd && socket->wndProbeInterval)
+#if (TCP_RACK_SUPPORT == ENABLED)
+   //The tail of the flight has not been acknowledged within the probe timeout?
+   if(osTimerElapsed(&socket->tlpTimer))
+      tcpRackTlpTimeout(socket);
+#endif
+
+#if (TCP_PACING_SUPPORT == ENABLED)
+   //The release time of the next paced segment has been reached?
+   if(osTimerElapsed(&socket->pacingTimer))
+      tcpPacingTimeout(socket);
+#endif
+
+   //The persist timer is used when the remote host advertises
+   //a window size of zero
+   if(!socket->sndWnd && socket->wndProbeInterval)
+   {
+      //Time to send a new probe?
+      if(osTimerElapsed(&socket->persistTimer))
       {
-         //Time to send a new probe?
-         if(osTimerElapsed(&socket->persistTimer))
+         //Make sure the maximum number of retransmissions has not been reached
+         if(socket->wndProbeCount < TCP_MAX_RETRIES)
          {
-            //Make sure the maximum number of retransmissions has not been reached
-            if(socket->wndProbeCount < TCP_MAX_RETRIES)
-            {
-               //Debug message
-               TRACE_INFO("%s: TCP zero window probe #%u...\r\n",
-                  timeFormat(osGetTickCount()), socket->wndProbeCount + 1);
-
-               //Zero window probes usually have the sequence number one less than expected
-               tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt - 1, socket->rcvNxt, 0, FALSE);
-               //The interval between successive probes should be increased exponentially
-               socket->wndProbeInterval = min(socket->wndProbeInterval * 2, TCP_MAX_PROBE_INTERVAL);
-               //Restart the persist timer
-               osTimerStart(&socket->persistTimer, socket->wndProbeInterval);
-               //Increment window probe counter
-               socket->wndProbeCount++;
-            }
-            else
-            {
-               //Enter CLOSED state
-               tcpChangeState(socket, TCP_STATE_CLOSED);
-            }
+            //Debug message
+            TRACE_INFO("%s: TCP zero window probe #%u...\r\n",
+               timeFormat(osGetTickCount()), socket->wndProbeCount + 1);
+
+            //Zero window probes usually have the sequence number one less than expected
+            tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt - 1, socket->rcvNxt, 0, FALSE);
+            //The interval between successive probes should be increased exponentially
+            socket->wndProbeInterval = min(socket->wndProbeInterval * 2, TCP_MAX_PROBE_INTERVAL);
+            //Restart the persist timer
+            osTimerStart(&socket->persistTimer, socket->wndProbeInterval);
+            //Increment window probe counter
+            socket->wndProbeCount++;
+         }
+         else
+         {
+            //Enter CLOSED state
+            tcpChangeState(socket, TCP_STATE_CLOSED);
          }
       }
+   }
 
-      //To avoid a deadlock, it is necessary to have a timeout to force
-      //transmission of data, overriding the SWS avoidance algorithm. In
-      //practice, this timeout should seldom occur (see RFC 1122 4.2.3.4)
-      if(socket->state == TCP_STATE_ESTABLISHED || socket->state == TCP_STATE_CLOSE_WAIT)
+   //To avoid a deadlock, it is necessary to have a timeout to force
+   //transmission of data, overriding the SWS avoidance algorithm. In
+   //practice, this timeout should seldom occur (see RFC 1122 4.2.3.4)
+   if(socket->state == TCP_STATE_ESTABLISHED || socket->state == TCP_STATE_CLOSE_WAIT)
+   {
+      //The override timeout occurred?
+      if(socket->sndUser && osTimerElapsed(&socket->overrideTimer))
       {
-         //The override timeout occurred?
-         if(socket->sndUser && osTimerElapsed(&socket->overrideTimer))
-         {
-            //The amount of data that can be sent at any given time is
-            //limited by the receiver window and the congestion window
-            n = min(socket->sndWnd, socket->cwnd);
-            n = min(n, socket->txBufferSize);
+         //The amount of data that can be sent at any given time is
+         //limited by the receiver window and the congestion window
+         n = min(socket->sndWnd, socket->cwnd);
+         n = min(n, socket->txBufferSize);
 
-            //Retrieve the size of the usable window
-            u = n - (socket->sndNxt - socket->sndUna);
+         //Retrieve the size of the usable window
+         u = n - (socket->sndNxt - socket->sndUna);
 
-            //Send as much data as possible
-            while(socket->sndUser > 0)
-            {
-               //The usable window size may become zero or negative,
-               //preventing packet transmission
-               if((int_t) u <= 0) break;
-
-               //Calculate the number of bytes to send at a time
-               n = min(u, socket->sndUser);
-               n = min(n, socket->mss);
-
-               //Send TCP segment
-               error = tcpSendSegment(socket, TCP_FLAG_PSH | TCP_FLAG_ACK,
-                  socket->sndNxt, socket->rcvNxt, n, TRUE);
-               //Failed to send TCP segment?
-               if(error) break;
-
-               //Advance SND.NXT pointer
-               socket->sndNxt += n;
-               //Adjust the number of bytes buffered but not yet sent
-               socket->sndUser -= n;
-            }
+         //Send as much data as possible
+         while(socket->sndUser > 0)
+         {
+            //The usable window size may become zero or negative,
+            //preventing packet transmission
+            if((int_t) u <= 0) break;
+            //Keep the last slot of the retransmission queue for the FIN
+            if(socket->retransmitQueueCount >= (TCP_RETRANSMIT_QUEUE_SIZE - 1)) break;
+#if (TCP_PACING_SUPPORT == ENABLED)
+            //The next segment is not due yet?
+            if(!tcpPacingCheck(socket)) break;
+#endif
+
+            //Calculate the number of bytes to send at a time
+            n = min(u, socket->sndUser);
+            n = min(n, socket->mss);
 
-            //Check whether the transmitter can accept more data
-            tcpUpdateEvents(socket);
+            //Send TCP segment
+            error = tcpSendSegment(socket, TCP_FLAG_PSH | TCP_FLAG_ACK,
+               socket->sndNxt, socket->rcvNxt, n, TRUE);
+            //Failed to send TCP segment?
+            if(error) break;
 
-            //Restart override timer if necessary
-            if(socket->sndUser > 0)
-               osTimerStart(&socket->overrideTimer, TCP_OVERRIDE_TIMEOUT);
+            //Advance SND.NXT pointer
+            socket->sndNxt += n;
+            //Adjust the number of bytes buffered but not yet sent
+            socket->sndUser -= n;
          }
+
+         //Check whether the transmitter can accept more data
+         tcpUpdateEvents(socket);
+
+         //Restart override timer if necessary
+         if(socket->sndUser > 0)
+            osTimerStart(&socket->overrideTimer, TCP_OVERRIDE_TIMEOUT);
       }
+   }
 
-      //The FIN-WAIT-2 timer prevents the connection
-      //from staying in the FIN-WAIT-2 state forever
-      if(socket->state == TCP_STATE_FIN_WAIT_2)
+#if (TCP_DELAYED_ACK_SUPPORT == ENABLED)
+   //An ACK is being delayed?
+   if(socket->ackDelayed)
+   {
+      //The ACK cannot be delayed any longer?
+      if(osTimerElapsed(&socket->delayedAckTimer))
       {
-         //Maximum FIN-WAIT-2 time has elapsed?
-         if(osTimerElapsed(&socket->finWait2Timer))
-         {
-            //Debug message
-            TRACE_WARNING("TCP FIN-WAIT-2 timer elapsed...\r\n");
-            //Enter CLOSED state
-            tcpChangeState(socket, TCP_STATE_CLOSED);
-         }
+         //Acknowledge the data received so far
+         error = tcpSendSegment(socket, TCP_FLAG_ACK, socket->sndNxt, socket->rcvNxt, 0, FALSE);
+         //Try again at the next tick if the ACK could not be sent
+         if(error)
+            osTimerStart(&socket->delayedAckTimer, TCP_TICK_INTERVAL);
       }
+   }
+#endif
 
-      //TIME-WAIT timer
-      if(socket->state == TCP_STATE_TIME_WAIT)
+   //The FIN-WAIT-2 timer prevents the connection
+   //from staying in the FIN-WAIT-2 state forever
+   if(socket->state == TCP_STATE_FIN_WAIT_2)
+   {
+      //Maximum FIN-WAIT-2 time has elapsed?
+      if(osTimerElapsed(&socket->finWait2Timer))
       {
-         //2MSL time has elapsed?
-         if(osTimerElapsed(&socket->timeWaitTimer))
-         {
-            //Debug message
-            TRACE_WARNING("TCP 2MSL timer elapsed (socket %u)...\r\n", i);
-            //Enter CLOSED state
-            tcpChangeState(socket, TCP_STATE_CLOSED);
+         //Debug message
+         TRACE_WARNING("TCP FIN-WAIT-2 timer elapsed...\r\n");
+         //Enter CLOSED state
+         tcpChangeState(socket, TCP_STATE_CLOSED);
+      }
+   }
 
-            //Dispose the socket if the user does not have the ownership anymore
-            if(!socket->ownedFlag)
-            {
-               //Delete the TCB
-               tcpDeleteControlBlock(socket);
-               //Mark the socket as closed
-               socket->type = SOCKET_TYPE_UNUSED;
-            }
+   //TIME-WAIT timer
+   if(socket->state == TCP_STATE_TIME_WAIT)
+   {
+      //2MSL time has elapsed?
+      if(osTimerElapsed(&socket->timeWaitTimer))
+      {
+         //Debug message
+         TRACE_WARNING("TCP 2MSL timer elapsed (socket %u)...\r\n", socket->descriptor);
+         //Enter CLOSED state
+         tcpChangeState(socket, TCP_STATE_CLOSED);
+
+         //Dispose the socket if the user does not have the ownership anymore
+         if(!socket->ownedFlag)
+         {
+            //Delete the TCB
+            tcpDeleteControlBlock(socket);
+            //Mark the socket as closed
+            socketRelease(socket);
          }
+
+         //No more timers are used by the connection
+         return;
       }
    }
 
-   //Leave critical section
-   osMutexRelease(socketMutex);
+   //Wait for the next timer to expire
+   if(socket->state != TCP_STATE_CLOSED)
+      tcpScheduleTimer(socket);
 }
 
 #endif
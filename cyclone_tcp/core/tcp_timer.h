@@ -30,6 +30,14 @@
 #define _TCP_TIMER_H
 
 //TCP timer related functions
+error_t tcpTimerInit(void);
 void tcpTick(void);
 
+#if (TCP_FAST_TIMER_SUPPORT == ENABLED)
+void tcpTimerTask(void *param);
+bool_t tcpTimerIrqHandler(void);
+#endif
+
+void tcpStartTimer(Socket *socket, OsTimer *timer, time_t delay);
+
 #endif
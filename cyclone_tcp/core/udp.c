@@ -37,11 +37,15 @@
 #include "ipv6.h"
 #include "udp.h"
 #include "socket.h"
+#include "probe.h"
 #include "debug.h"
 
 //Check TCP/IP stack configuration
 #if (UDP_SUPPORT == ENABLED)
 
+//Connectionless sockets indexed by their local port
+static Socket *udpHashTable[UDP_HASH_TABLE_SIZE];
+
 
 /**
  * @brief Incoming UDP datagram processing
@@ -57,11 +61,17 @@ error_t udpProcessDatagram(NetInterface *interface,
 {
    uint_t i;
    size_t length;
+   bool_t verify;
+   uint16_t checksum;
    UdpHeader *header;
    Socket *socket;
    SocketQueueItem *queueItem;
+   SocketQueueItem *lastItem;
    ChunkedBuffer *p;
 
+   //Instrumentation point
+   PROBE_ENTER(PROBE_UDP_PROCESS_DATAGRAM);
+
    //Retrieve the length of the UDP datagram
    length = chunkedBufferGetLength(buffer) - offset;
 
@@ -70,6 +80,8 @@ error_t udpProcessDatagram(NetInterface *interface,
    {
       //Debug message
       TRACE_WARNING("UDP datagram length is invalid!\r\n");
+      //Update UDP statistics
+      UDP_MIB_INC(udpInErrors);
       //Report an error
       return ERROR_INVALID_HEADER;
    }
@@ -84,32 +96,25 @@ error_t udpProcessDatagram(NetInterface *interface,
    //Dump UDP header contents for debugging purpose
    udpDumpHeader(header);
 
+   //The checksum may already have been verified by the hardware
+   if(interface->nicRxChecksumFlags & NIC_RX_CHECKSUM_PAYLOAD)
+      verify = FALSE;
    //When UDP runs over IPv6, the checksum is mandatory
-   if(header->checksum || pseudoHeader->length == sizeof(Ipv6PseudoHeader))
-   {
-      //Verify UDP checksum
-      if(ipCalcUpperLayerChecksumEx(pseudoHeader->data,
-         pseudoHeader->length, buffer, offset, length) != 0xFFFF)
-      {
-         //Debug message
-         TRACE_WARNING("Wrong UDP header checksum!\r\n");
-         //Report an error
-         return ERROR_WRONG_CHECKSUM;
-      }
-   }
+   else if(header->checksum || pseudoHeader->length == sizeof(Ipv6PseudoHeader))
+      verify = TRUE;
+   //The sender did not generate a checksum
+   else
+      verify = FALSE;
 
    //Enter critical section
    osMutexAcquire(socketMutex);
 
-   //Loop through opened sockets
-   for(i = 0; i < SOCKET_MAX_COUNT; i++)
-   {
-      //Point to the current socket
-      socket = socketTable + i;
+   //Point to the relevant hash bucket
+   socket = udpHashTable[ntohs(header->destPort) & (UDP_HASH_TABLE_SIZE - 1)];
 
-      //UDP socket found?
-      if(socket->type != SOCKET_TYPE_DGRAM)
-         continue;
+   //Walk through the sockets sharing the same hash value
+   for(; socket != NULL; socket = socket->hashNext)
+   {
       //Check whether the socket is bound to a particular interface
       if(socket->interface && socket->interface != interface)
          continue;
@@ -185,10 +190,26 @@ error_t udpProcessDatagram(NetInterface *interface,
    }
 
    //Drop incoming packet if no matching socket was found
-   if(i >= SOCKET_MAX_COUNT)
+   if(!socket)
    {
       //Leave critical section
       osMutexRelease(socketMutex);
+
+      //A corrupted datagram must not trigger an ICMP error message
+      if(verify && ipCalcUpperLayerChecksumEx(pseudoHeader->data,
+         pseudoHeader->length, buffer, offset, length) != 0xFFFF)
+      {
+         //Debug message
+         TRACE_WARNING("Wrong UDP header checksum!\r\n");
+         //Update UDP statistics
+         UDP_MIB_INC(udpInErrors);
+         UDP_MIB_INC(udpInCsumErrors);
+         //Report an error
+         return ERROR_WRONG_CHECKSUM;
+      }
+
+      //Update UDP statistics
+      UDP_MIB_INC(udpNoPorts);
       //Unreachable protocol...
       return ERROR_PROTOCOL_UNREACHABLE;
    }
@@ -197,72 +218,56 @@ error_t udpProcessDatagram(NetInterface *interface,
    offset += sizeof(UdpHeader);
    length -= sizeof(UdpHeader);
 
-   //Empty receive queue?
-   if(!socket->receiveQueue)
-   {
-      //Allocate a memory buffer to hold the data and the associated descriptor
-      p = chunkedBufferAlloc(sizeof(SocketQueueItem) + length);
+   //Reach the last item in the receive queue
+   lastItem = socket->receiveQueue;
+   for(i = 1; lastItem && lastItem->next; i++)
+      lastItem = lastItem->next;
 
-      //Successful memory allocation?
-      if(p != NULL)
-      {
-         //Point to the newly created item
-         queueItem = chunkedBufferAt(p, 0);
-         queueItem->buffer = p;
-         //Add the newly created item to the queue
-         socket->receiveQueue = queueItem;
-      }
-      else
-      {
-         //Memory allocation failed
-         queueItem = NULL;
-      }
-   }
-   else
+   //Make sure the receive queue is not full
+   if(lastItem && i >= UDP_RX_QUEUE_SIZE)
    {
-      //Point to the very first item
-      queueItem = socket->receiveQueue;
-      //Reach the last item in the receive queue
-      for(i = 1; queueItem->next; i++)
-         queueItem = queueItem->next;
-
-      //Make sure the receive queue is not full
-      if(i >= UDP_RX_QUEUE_SIZE)
-      {
-         //Leave critical section
-         osMutexRelease(socketMutex);
-         //Notify the calling function that the queue is full
-         return ERROR_RECEIVE_QUEUE_FULL;
-      }
-
-      //Allocate a memory buffer to hold the data and the associated descriptor
-      p = chunkedBufferAlloc(sizeof(SocketQueueItem) + length);
+      //Leave critical section
+      osMutexRelease(socketMutex);
+      //Update UDP statistics
+      UDP_MIB_INC(udpInErrors);
+      UDP_MIB_INC(udpRcvbufErrors);
+      //Notify the calling function that the queue is full
+      return ERROR_RECEIVE_QUEUE_FULL;
+   }
 
-      //Successful memory allocation?
-      if(p != NULL)
-      {
-         //Add the newly created item to the queue
-         queueItem->next = chunkedBufferAt(p, 0);
-         //Point to the newly created item
-         queueItem = queueItem->next;
-         queueItem->buffer = p;
-      }
-      else
-      {
-         //Memory allocation failed
-         queueItem = NULL;
-      }
+   //A socket that holds too much memory does not get any more
+   if(socketMemCharge(socket, sizeof(SocketQueueItem) + length))
+   {
+      //Leave critical section
+      osMutexRelease(socketMutex);
+      //Update UDP statistics
+      UDP_MIB_INC(udpInErrors);
+      UDP_MIB_INC(udpRcvbufErrors);
+      //Notify the calling function that the queue is full
+      return ERROR_RECEIVE_QUEUE_FULL;
    }
 
+   //Allocate a memory buffer to hold the data and the associated descriptor
+   p = chunkedBufferAlloc(sizeof(SocketQueueItem) + length);
+
    //Failed to allocate memory?
-   if(!queueItem)
+   if(!p)
    {
+      //The datagram is not queued
+      socketMemUncharge(socket, sizeof(SocketQueueItem) + length);
       //Leave critical section
       osMutexRelease(socketMutex);
+      //Update UDP statistics
+      UDP_MIB_INC(udpInErrors);
+      UDP_MIB_INC(udpRcvbufErrors);
       //Return error code
       return ERROR_OUT_OF_MEMORY;
    }
 
+   //Point to the newly created item
+   queueItem = chunkedBufferAt(p, 0);
+   queueItem->buffer = p;
+
    //Initialize next field
    queueItem->next = NULL;
    //Record the source port number
@@ -289,14 +294,60 @@ error_t udpProcessDatagram(NetInterface *interface,
 
    //Offset to the payload
    queueItem->offset = sizeof(SocketQueueItem);
-   //Copy the payload
-   chunkedBufferCopy(queueItem->buffer, queueItem->offset, buffer, offset, length);
+
+   //Checksum verification required?
+   if(verify)
+   {
+      //Copy the payload and calculate its checksum at the same time
+      checksum = ipCopyChecksumEx(queueItem->buffer, queueItem->offset,
+         buffer, offset, length);
+
+      //Add the UDP header and the pseudo header
+      checksum = ipCombineChecksum(ipCalcChecksumEx(buffer,
+         offset - sizeof(UdpHeader), sizeof(UdpHeader)), checksum, sizeof(UdpHeader));
+      checksum = ipCombineChecksum(ipCalcChecksum(pseudoHeader->data,
+         pseudoHeader->length), checksum, pseudoHeader->length);
+
+      //The 1's complement sum of a valid datagram is 0xFFFF
+      if(checksum != 0x0000)
+      {
+         //The datagram is not queued
+         socketMemUncharge(socket, sizeof(SocketQueueItem) + length);
+         //Leave critical section
+         osMutexRelease(socketMutex);
+         //Discard the datagram
+         chunkedBufferFree(p);
+
+         //Debug message
+         TRACE_WARNING("Wrong UDP header checksum!\r\n");
+         //Update UDP statistics
+         UDP_MIB_INC(udpInErrors);
+         UDP_MIB_INC(udpInCsumErrors);
+         //Report an error
+         return ERROR_WRONG_CHECKSUM;
+      }
+   }
+   else
+   {
+      //Copy the payload
+      chunkedBufferCopy(queueItem->buffer, queueItem->offset, buffer, offset, length);
+   }
+
+   //Add the newly created item to the queue
+   if(lastItem)
+      lastItem->next = queueItem;
+   else
+      socket->receiveQueue = queueItem;
 
    //Notify user that data is available
    udpUpdateEvents(socket);
 
    //Leave critical section
    osMutexRelease(socketMutex);
+
+   //Update UDP statistics
+   UDP_MIB_INC(udpInDatagrams);
+
    //Successful processing
    return NO_ERROR;
 }
@@ -380,9 +431,12 @@ error_t udpSendDatagram(Socket *socket, const IpAddr *destIpAddr,
          pseudoHeader.ipv4Data.protocol = IPV4_PROTOCOL_UDP;
          pseudoHeader.ipv4Data.length = htons(length);
 
-         //Calculate UDP header checksum
-         header->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader.ipv4Data,
-            sizeof(Ipv4PseudoHeader), buffer, offset, length);
+         //Calculate UDP header checksum, unless the hardware inserts it
+         if(!ipv4IsChecksumOffloaded(interface, destIpAddr->ipv4Addr, length))
+         {
+            header->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader.ipv4Data,
+               sizeof(Ipv4PseudoHeader), buffer, offset, length);
+         }
 
          //Set TTL value
          timeToLive = IPV4_DEFAULT_TTL;
@@ -407,9 +461,12 @@ error_t udpSendDatagram(Socket *socket, const IpAddr *destIpAddr,
          pseudoHeader.ipv6Data.reserved = 0;
          pseudoHeader.ipv6Data.nextHeader = IPV6_UDP_HEADER;
 
-         //Calculate UDP header checksum
-         header->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader.ipv6Data,
-            sizeof(Ipv6PseudoHeader), buffer, offset, length);
+         //Calculate UDP header checksum, unless the datagram is sent to the local host
+         if(!ipv6IsLocalHostAddr(interface, &destIpAddr->ipv6Addr))
+         {
+            header->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader.ipv6Data,
+               sizeof(Ipv6PseudoHeader), buffer, offset, length);
+         }
 
          //Set Hop Limit value
          timeToLive = IPV6_DEFAULT_HOP_LIMIT;
@@ -430,10 +487,14 @@ error_t udpSendDatagram(Socket *socket, const IpAddr *destIpAddr,
       udpDumpHeader(header);
 
       //Send UDP datagram
-      error = ipSendDatagram(interface, &pseudoHeader, buffer, offset, timeToLive);
+      error = ipSendDatagram(interface, &pseudoHeader, buffer, offset,
+         timeToLive, IP_PRIORITY_TO_TOS(socket->priority), NULL);
       //Failed to send datagram?
       if(error) break;
 
+      //Update UDP statistics
+      UDP_MIB_INC(udpOutDatagrams);
+
       //Total number of data bytes successfully transmitted
       if(written != NULL) *written = length;
 
@@ -464,20 +525,8 @@ error_t udpReceiveDatagram(Socket *socket, IpAddr *remoteIpAddr,
 {
    SocketQueueItem *queueItem;
 
-   //The receive queue is empty?
-   if(!socket->receiveQueue)
-   {
-      //Set the events the application is interested in
-      socket->eventMask = SOCKET_EVENT_RX_READY;
-      //Reset the event object
-      osEventReset(socket->event);
-      //Leave critical section
-      osMutexRelease(socketMutex);
-      //Wait until an event is triggered
-      osEventWait(socket->event, socket->timeout);
-      //Enter critical section
-      osMutexAcquire(socketMutex);
-   }
+   //Wait for an incoming datagram
+   udpWaitForDatagram(socket);
 
    //Check whether the read operation timed out
    if(!socket->receiveQueue)
@@ -490,8 +539,6 @@ error_t udpReceiveDatagram(Socket *socket, IpAddr *remoteIpAddr,
 
    //Point to the first item in the receive queue
    queueItem = socket->receiveQueue;
-   //Copy data to user buffer
-   *received = chunkedBufferRead(data, queueItem->buffer, queueItem->offset, size);
 
    //Save the IP address of the peer and the corresponding port number
    if(remoteIpAddr)
@@ -501,14 +548,88 @@ error_t udpReceiveDatagram(Socket *socket, IpAddr *remoteIpAddr,
 
    //If the SOCKET_FLAG_PEEK flag is set, the data is copied
    //into the buffer but is not removed from the input queue
-   if(!(flags & SOCKET_FLAG_PEEK))
+   if(flags & SOCKET_FLAG_PEEK)
+   {
+      //Copy data to user buffer
+      *received = chunkedBufferRead(data, queueItem->buffer, queueItem->offset, size);
+   }
+   else
+   {
+      //Remove the item from the receive queue
+      socket->receiveQueue = queueItem->next;
+      //The memory is no longer held by the socket
+      socketMemUncharge(socket, chunkedBufferGetLength(queueItem->buffer));
+
+      //The item now belongs to the caller, so the copy is made
+      //without holding the global mutex
+      osMutexRelease(socketMutex);
+      //Copy data to user buffer
+      *received = chunkedBufferRead(data, queueItem->buffer, queueItem->offset, size);
+      //Deallocate memory buffer
+      chunkedBufferFree(queueItem->buffer);
+      //Enter critical section
+      osMutexAcquire(socketMutex);
+   }
+
+   //Update the state of events
+   udpUpdateEvents(socket);
+
+   //Successful read operation
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Receive a batch of UDP datagrams
+ *
+ * Signaling and locking are paid once for the whole batch.
+ * The caller must hold the socket mutex
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[in,out] messages Array of datagram descriptors
+ * @param[in] count Number of entries in the array
+ * @param[out] received Number of datagrams actually received
+ * @return Error code
+ **/
+
+error_t udpReceiveDatagramBatch(Socket *socket, SocketMessage *messages,
+   uint_t count, uint_t *received)
+{
+   uint_t n;
+   SocketQueueItem *queueItem;
+
+   //Wait for the first datagram
+   udpWaitForDatagram(socket);
+
+   //Dequeue the datagrams that are pending
+   for(n = 0; n < count && socket->receiveQueue != NULL; n++)
    {
+      //Point to the first item in the receive queue
+      queueItem = socket->receiveQueue;
+
+      //Copy data to user buffer
+      messages[n].length = chunkedBufferRead(messages[n].data,
+         queueItem->buffer, queueItem->offset, messages[n].size);
+
+      //Save the IP address of the peer and the corresponding port number
+      messages[n].remoteIpAddr = queueItem->remoteIpAddr;
+      messages[n].remotePort = queueItem->remotePort;
+
       //Remove the item from the receive queue
       socket->receiveQueue = queueItem->next;
+      //The memory is no longer held by the socket
+      socketMemUncharge(socket, chunkedBufferGetLength(queueItem->buffer));
       //Deallocate memory buffer
       chunkedBufferFree(queueItem->buffer);
    }
 
+   //Number of datagrams actually received
+   *received = n;
+
+   //Check whether the read operation timed out
+   if(!n)
+      return ERROR_TIMEOUT;
+
    //Update the state of events
    udpUpdateEvents(socket);
 
@@ -517,6 +638,101 @@ error_t udpReceiveDatagram(Socket *socket, IpAddr *remoteIpAddr,
 }
 
 
+/**
+ * @brief Receive a UDP datagram without copying it
+ *
+ * The queued buffer is handed over to the caller, together with the
+ * offset of the payload and the address of the peer. The caller must
+ * give it back with udpReleaseDatagram once the datagram is processed
+ *
+ * @param[in] socket Handle referencing the socket
+ * @param[out] queueItem Receive queue item describing the datagram
+ * @return Error code
+ **/
+
+error_t udpReceiveDatagramEx(Socket *socket, SocketQueueItem **queueItem)
+{
+   //Wait for an incoming datagram
+   udpWaitForDatagram(socket);
+
+   //Check whether the read operation timed out
+   if(!socket->receiveQueue)
+   {
+      //No datagram can be read
+      *queueItem = NULL;
+      //Report a timeout error
+      return ERROR_TIMEOUT;
+   }
+
+   //Remove the first item from the receive queue
+   *queueItem = socket->receiveQueue;
+   socket->receiveQueue = (*queueItem)->next;
+   //The memory is no longer charged to the socket, although the caller
+   //keeps the datagram until it is released
+   socketMemUncharge(socket, chunkedBufferGetLength((*queueItem)->buffer));
+   //The item does not belong to the queue anymore
+   (*queueItem)->next = NULL;
+
+   //Update the state of events
+   udpUpdateEvents(socket);
+
+   //Successful read operation
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release a datagram obtained with udpReceiveDatagramEx
+ * @param[in] queueItem Receive queue item describing the datagram
+ **/
+
+void udpReleaseDatagram(SocketQueueItem *queueItem)
+{
+   //The item lives in the same memory as the datagram
+   chunkedBufferFree(queueItem->buffer);
+}
+
+
+/**
+ * @brief Wait for a datagram to be queued
+ *
+ * The caller must hold the socket mutex
+ *
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void udpWaitForDatagram(Socket *socket)
+{
+   //The receive queue is empty?
+   if(!socket->receiveQueue)
+   {
+      //Set the events the application is interested in
+      socket->eventMask = SOCKET_EVENT_RX_READY;
+      //Reset the event object
+      osEventReset(socket->event);
+      //Leave critical section
+      osMutexRelease(socketMutex);
+      //Wait until an event is triggered
+      osEventWait(socket->event, socket->timeout);
+      //Enter critical section
+      osMutexAcquire(socketMutex);
+   }
+}
+
+
+/**
+ * @brief Index a UDP socket under its local port
+ * @param[in] socket Handle referencing the socket
+ **/
+
+void udpHashSocket(Socket *socket)
+{
+   //Link the socket into the relevant hash bucket
+   socketHashInsert(&udpHashTable[socket->localPort &
+      (UDP_HASH_TABLE_SIZE - 1)], socket);
+}
+
+
 /**
  * @brief Update UDP related events
  * @param[in] socket Handle referencing the socket
@@ -537,6 +753,12 @@ void udpUpdateEvents(Socket *socket)
    else
       socket->eventFlags |= SOCKET_EVENT_LINK_DOWN;
 
+#if (SOCKET_EVENT_SET_SUPPORT == ENABLED)
+   //Push the events into the event set the socket belongs to
+   if(socket->eventSet != NULL)
+      socketEventSetNotify(socket, socket->eventFlags);
+#endif
+
    //Mask unused events
    socket->eventFlags &= socket->eventMask;
 
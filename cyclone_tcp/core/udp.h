@@ -47,6 +47,13 @@
    #error UDP_RX_QUEUE_SIZE parameter is invalid
 #endif
 
+//Size of the port hash table
+#ifndef UDP_HASH_TABLE_SIZE
+   #define UDP_HASH_TABLE_SIZE 16
+#elif (UDP_HASH_TABLE_SIZE < 1 || (UDP_HASH_TABLE_SIZE & (UDP_HASH_TABLE_SIZE - 1)))
+   #error UDP_HASH_TABLE_SIZE parameter is invalid
+#endif
+
 #if (defined(__GNUC__) || defined(_WIN32))
    #define __packed
    #pragma pack(push, 1)
@@ -83,6 +90,14 @@ error_t udpSendDatagram(Socket *socket, const IpAddr *destIpAddr,
 error_t udpReceiveDatagram(Socket *socket, IpAddr *remoteIpAddr,
    uint16_t *remotePort, void *data, size_t size, size_t *received, uint_t flags);
 
+error_t udpReceiveDatagramBatch(Socket *socket, SocketMessage *messages,
+   uint_t count, uint_t *received);
+
+error_t udpReceiveDatagramEx(Socket *socket, SocketQueueItem **queueItem);
+void udpReleaseDatagram(SocketQueueItem *queueItem);
+void udpWaitForDatagram(Socket *socket);
+
+void udpHashSocket(Socket *socket);
 void udpUpdateEvents(Socket *socket);
 void udpDumpHeader(const UdpHeader *datagram);
 
@@ -48,6 +48,17 @@
 //Check TCP/IP stack configuration
 #if (IPV4_SUPPORT == ENABLED)
 
+//Requested DHCP options
+static const uint8_t dhcpOptionList[] =
+{
+   DHCP_OPT_SUBNET_MASK,
+   DHCP_OPT_ROUTER,
+   DHCP_OPT_DNS_SERVER,
+   DHCP_OPT_IP_ADDRESS_LEASE_TIME,
+   DHCP_OPT_RENEWAL_TIME_VALUE,
+   DHCP_OPT_REBINDING_TIME_VALUE
+};
+
 
 /**
  * @brief Start DHCP client
@@ -78,6 +89,9 @@ error_t dhcpClientStart(DhcpClientCtx *context, const DhcpClientSettings *settin
    context->interface = settings->interface;
    //Check whether rapid commit is allowed
    context->rapidCommit = settings->rapidCommit;
+   //Callbacks used to keep the lease across resets
+   context->loadLease = settings->loadLease;
+   context->saveLease = settings->saveLease;
 
    //Open a UDP socket
    context->socket = socketOpen(SOCKET_TYPE_DGRAM, SOCKET_PROTOCOL_UDP);
@@ -153,8 +167,13 @@ void dhcpClientTask(void *param)
 {
    //Point to the DHCP client context
    DhcpClientCtx *context = (DhcpClientCtx *) param;
-   //Initialize DHCP client state
-   context->state = DHCP_STATE_INIT;
+
+   //A lease saved before the last reset can be reused through the
+   //INIT-REBOOT state, which skips the DHCPDISCOVER-DHCPOFFER exchange
+   if(!dhcpLoadLease(context))
+      context->state = DHCP_STATE_INIT_REBOOT;
+   else
+      context->state = DHCP_STATE_INIT;
 
    //DHCP client finite state machine
    while(1)
@@ -286,6 +305,8 @@ void dhcpStateSelecting(DhcpClientCtx *context)
    //A transaction identifier is used by the client to
    //match incoming DHCP messages with pending requests
    context->transactionId = rand();
+   //No DHCPACK received yet
+   context->rapidCommitAck = FALSE;
    //Initial timeout value
    timeout = DHCP_DISCOVER_INIT_TIMEOUT;
 
@@ -299,8 +320,22 @@ void dhcpStateSelecting(DhcpClientCtx *context)
       error = dhcpWaitForResponse(context, dhcpParseOffer,
          timeout + dhcpRandRange(-DHCP_RAND_FACTOR, DHCP_RAND_FACTOR));
 
+      //DHCPACK message received in response to the DHCPDISCOVER?
+      if(!error && context->rapidCommitAck)
+      {
+         //Save the time a which the lease was obtained
+         context->leaseStartTime = osGetTickCount();
+         //Dump current DHCP configuration for debugging purpose
+         dhcpDumpConfig(context);
+         //Keep the lease across resets
+         dhcpSaveLease(context);
+         //The server committed the lease right away (RFC 4039)
+         context->state = DHCP_STATE_BOUND;
+         //Exit immediately
+         return;
+      }
       //DHCPOFFER message received?
-      if(!error)
+      else if(!error)
       {
          //Switch to the REQUESTING state
          context->state = DHCP_STATE_REQUESTING;
@@ -363,6 +398,8 @@ void dhcpStateRequesting(DhcpClientCtx *context)
          context->leaseStartTime = osGetTickCount();
          //Dump current DHCP configuration for debugging purpose
          dhcpDumpConfig(context);
+         //Keep the lease across resets
+         dhcpSaveLease(context);
          //The client transitions to the BOUND state
          context->state = DHCP_STATE_BOUND;
          //Exit immediately
@@ -374,6 +411,8 @@ void dhcpStateRequesting(DhcpClientCtx *context)
          //The IPv4 address cannot be used on the link
          context->interface->ipv4Config.addr = IPV4_UNSPECIFIED_ADDR;
          context->interface->ipv4Config.subnetMask = IPV4_UNSPECIFIED_ADDR;
+         //The saved lease must not be used anymore
+         dhcpDiscardLease(context);
          //Restart DHCP configuration
          context->state = DHCP_STATE_INIT;
          //Exit immediately
@@ -483,6 +522,8 @@ void dhcpStateRebooting(DhcpClientCtx *context)
          context->leaseStartTime = osGetTickCount();
          //Dump current DHCP configuration for debugging purpose
          dhcpDumpConfig(context);
+         //Keep the lease across resets
+         dhcpSaveLease(context);
          //The client transitions to the BOUND state
          context->state = DHCP_STATE_BOUND;
          //Exit immediately
@@ -495,6 +536,8 @@ void dhcpStateRebooting(DhcpClientCtx *context)
          //to which the client is connected
          context->interface->ipv4Config.addr = IPV4_UNSPECIFIED_ADDR;
          context->interface->ipv4Config.subnetMask = IPV4_UNSPECIFIED_ADDR;
+         //The saved lease must not be used anymore
+         dhcpDiscardLease(context);
          //Restart DHCP configuration
          context->state = DHCP_STATE_INIT;
          //Exit immediately
@@ -643,6 +686,8 @@ void dhcpStateRenewing(DhcpClientCtx *context)
          context->leaseStartTime = osGetTickCount();
          //Dump current DHCP configuration for debugging purpose
          dhcpDumpConfig(context);
+         //Keep the lease across resets
+         dhcpSaveLease(context);
          //The client transitions to the BOUND state
          context->state = DHCP_STATE_BOUND;
          //Exit immediately
@@ -654,6 +699,8 @@ void dhcpStateRenewing(DhcpClientCtx *context)
          //The address is no longer valid
          context->interface->ipv4Config.addr = IPV4_UNSPECIFIED_ADDR;
          context->interface->ipv4Config.subnetMask = IPV4_UNSPECIFIED_ADDR;
+         //The saved lease must not be used anymore
+         dhcpDiscardLease(context);
          //Restart DHCP configuration
          context->state = DHCP_STATE_INIT;
          //Exit immediately
@@ -724,6 +771,8 @@ void dhcpStateRebinding(DhcpClientCtx *context)
          context->leaseStartTime = osGetTickCount();
          //Dump current DHCP configuration for debugging purpose
          dhcpDumpConfig(context);
+         //Keep the lease across resets
+         dhcpSaveLease(context);
          //The client transitions to the BOUND state
          context->state = DHCP_STATE_BOUND;
          //Exit immediately
@@ -735,6 +784,8 @@ void dhcpStateRebinding(DhcpClientCtx *context)
          //The address is no longer valid
          context->interface->ipv4Config.addr = IPV4_UNSPECIFIED_ADDR;
          context->interface->ipv4Config.subnetMask = IPV4_UNSPECIFIED_ADDR;
+         //The saved lease must not be used anymore
+         dhcpDiscardLease(context);
          //Restart DHCP configuration
          context->state = DHCP_STATE_INIT;
          //Exit immediately
@@ -753,6 +804,9 @@ void dhcpStateRebinding(DhcpClientCtx *context)
       time = osGetTickCount();
    }
 
+   //The lease has expired
+   dhcpDiscardLease(context);
+
    //If the lease expires before the client receives
    //a DHCPACK, the client moves to INIT state
    context->state = DHCP_STATE_INIT;
@@ -869,6 +923,11 @@ error_t dhcpSendDiscover(DhcpClientCtx *context)
       dhcpAddOption(message, DHCP_OPT_RAPID_COMMIT, NULL, 0);
    }
 
+   //Parameter Request List option. The DHCPACK sent in response to a
+   //Rapid Commit must carry the whole configuration
+   dhcpAddOption(message, DHCP_OPT_PARAM_REQUEST_LIST,
+      dhcpOptionList, sizeof(dhcpOptionList));
+
    //Set destination IP address
    ipAddr.length = sizeof(Ipv4Addr);
    ipAddr.ipv4Addr = IPV4_BROADCAST_ADDR;
@@ -899,17 +958,6 @@ error_t dhcpSendRequest(DhcpClientCtx *context)
    //DHCP message type
    const uint8_t messageType = DHCP_MESSAGE_TYPE_REQUEST;
 
-   //Requested DHCP options
-   const uint8_t optionList[] =
-   {
-      DHCP_OPT_SUBNET_MASK,
-      DHCP_OPT_ROUTER,
-      DHCP_OPT_DNS_SERVER,
-      DHCP_OPT_IP_ADDRESS_LEASE_TIME,
-      DHCP_OPT_RENEWAL_TIME_VALUE,
-      DHCP_OPT_REBINDING_TIME_VALUE
-   };
-
    //Point to buffer where the DHCP message will be formatted
    message = (DhcpMessage *) context->buffer;
    //Clear memory buffer contents
@@ -964,7 +1012,7 @@ error_t dhcpSendRequest(DhcpClientCtx *context)
 
    //Parameter Request List option
    dhcpAddOption(message, DHCP_OPT_PARAM_REQUEST_LIST,
-      optionList, sizeof(optionList));
+      dhcpOptionList, sizeof(dhcpOptionList));
 
    //IP address is being renewed?
    if(context->state == DHCP_STATE_RENEWING)
@@ -1061,6 +1109,7 @@ error_t dhcpSendDecline(DhcpClientCtx *context)
 
 error_t dhcpParseOffer(DhcpClientCtx *context, size_t length)
 {
+   error_t error;
    DhcpMessage *message;
    DhcpOption *option;
 
@@ -1103,6 +1152,34 @@ error_t dhcpParseOffer(DhcpClientCtx *context, size_t length)
    //Failed to retrieve specified option?
    if(!option || option->length != 1)
       return ERROR_INVALID_MESSAGE;
+   //A server that supports Rapid Commit may answer with a DHCPACK
+   if(option->value[0] == DHCP_MESSAGE_TYPE_ACK && context->rapidCommit)
+   {
+      //The DHCPACK must include the Rapid Commit option (RFC 4039)
+      if(!dhcpGetOption(message, length, DHCP_OPT_RAPID_COMMIT))
+         return ERROR_INVALID_MESSAGE;
+
+      //Retrieve Server Identifier option
+      option = dhcpGetOption(message, length, DHCP_OPT_SERVER_IDENTIFIER);
+      //Failed to retrieve specified option?
+      if(!option || option->length != 4)
+         return ERROR_INVALID_MESSAGE;
+
+      //Record the DHCP server IP address
+      ipv4CopyAddr(&context->serverIpAddr, option->value);
+      //Record the IP address assigned to the client
+      context->requestedIpAddr = message->yiaddr;
+
+      //Parse the lease carried by the DHCPACK
+      error = dhcpParseAckNak(context, length);
+      //The lease is committed?
+      if(!error)
+         context->rapidCommitAck = TRUE;
+
+      //Return status code
+      return error;
+   }
+
    //Check message type
    if(option->value[0] != DHCP_MESSAGE_TYPE_OFFER)
       return ERROR_INVALID_MESSAGE;
@@ -1183,9 +1260,20 @@ error_t dhcpParseAckNak(DhcpClientCtx *context, size_t length)
    //Failed to retrieve specified option?
    if(!option || option->length != 4)
       return ERROR_INVALID_MESSAGE;
+
+   //In REBOOTING and REBINDING states, the DHCPREQUEST is broadcast
+   //and any server may answer
+   if(context->state == DHCP_STATE_REBOOTING ||
+      context->state == DHCP_STATE_REBINDING)
+   {
+      //Record the DHCP server IP address
+      ipv4CopyAddr(&context->serverIpAddr, option->value);
+   }
    //Unexpected server identifier?
-   if(!ipv4CompAddr(option->value, &context->serverIpAddr))
+   else if(!ipv4CompAddr(option->value, &context->serverIpAddr))
+   {
       return ERROR_INVALID_MESSAGE;
+   }
 
    //Retrieve IP Address Lease Time option
    option = dhcpGetOption(message, length, DHCP_OPT_IP_ADDRESS_LEASE_TIME);
@@ -1283,6 +1371,102 @@ error_t dhcpParseAckNak(DhcpClientCtx *context, size_t length)
 }
 
 
+/**
+ * @brief Retrieve the lease saved before the last reset
+ * @param[in] context Pointer to the DHCP client context
+ * @return Error code
+ **/
+
+error_t dhcpLoadLease(DhcpClientCtx *context)
+{
+   error_t error;
+   DhcpLease lease;
+
+   //No storage callback?
+   if(context->loadLease == NULL)
+      return ERROR_NOT_FOUND;
+
+   //Read the lease from non-volatile storage
+   error = context->loadLease(context->interface, &lease);
+   //Any error to report?
+   if(error) return error;
+
+   //The lease must have been granted to this interface
+   if(!macCompAddr(&lease.macAddr, &context->interface->macAddr))
+      return ERROR_INVALID_MESSAGE;
+   //Make sure the saved address is valid
+   if(lease.addr == IPV4_UNSPECIFIED_ADDR)
+      return ERROR_INVALID_MESSAGE;
+
+   //The client requests its previously allocated address
+   context->requestedIpAddr = lease.addr;
+   context->serverIpAddr = lease.serverIpAddr;
+   context->leaseTime = lease.leaseTime;
+   context->t1 = lease.t1;
+   context->t2 = lease.t2;
+
+   //Debug message
+   TRACE_INFO("DHCP lease loaded (%s)...\r\n", ipv4AddrToString(lease.addr, NULL));
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Save the current lease to non-volatile storage
+ * @param[in] context Pointer to the DHCP client context
+ **/
+
+void dhcpSaveLease(DhcpClientCtx *context)
+{
+   uint_t n;
+   DhcpLease lease;
+   Ipv4Config *config;
+
+   //No storage callback?
+   if(context->saveLease == NULL)
+      return;
+
+   //Point to the IPv4 configuration of the interface
+   config = &context->interface->ipv4Config;
+
+   //Clear the lease (padding bytes are saved too)
+   memset(&lease, 0, sizeof(DhcpLease));
+
+   //Format the lease
+   lease.macAddr = context->interface->macAddr;
+   lease.addr = config->addr;
+   lease.subnetMask = config->subnetMask;
+   lease.defaultGateway = config->defaultGateway;
+   lease.serverIpAddr = context->serverIpAddr;
+   lease.leaseTime = context->leaseTime;
+   lease.t1 = context->t1;
+   lease.t2 = context->t2;
+
+   //Save DNS servers
+   n = min(config->dnsServerCount, IPV4_MAX_DNS_SERVERS);
+   memcpy(lease.dnsServer, config->dnsServer, n * sizeof(Ipv4Addr));
+   lease.dnsServerCount = n;
+
+   //Write the lease to non-volatile storage
+   context->saveLease(context->interface, &lease);
+}
+
+
+/**
+ * @brief Discard the lease kept in non-volatile storage
+ * @param[in] context Pointer to the DHCP client context
+ **/
+
+void dhcpDiscardLease(DhcpClientCtx *context)
+{
+   //Invalidate the saved lease, if any
+   if(context->saveLease != NULL)
+      context->saveLease(context->interface, NULL);
+}
+
+
 /**
  * @brief Compute the appropriate secs field
  *
@@ -82,14 +82,41 @@ typedef enum
 } DhcpState;
 
 
+/**
+ * @brief Lease kept in non-volatile storage
+ **/
+
+typedef struct
+{
+   MacAddr macAddr;                             ///<Hardware address the lease was granted to
+   Ipv4Addr addr;                               ///<Assigned IPv4 address
+   Ipv4Addr subnetMask;                         ///<Subnet mask
+   Ipv4Addr defaultGateway;                     ///<Default gateway
+   Ipv4Addr dnsServer[IPV4_MAX_DNS_SERVERS];    ///<DNS servers
+   uint_t dnsServerCount;                       ///<Number of DNS servers
+   Ipv4Addr serverIpAddr;                       ///<DHCP server that granted the lease
+   uint32_t leaseTime;                          ///<Lease time
+   uint32_t t1;                                 ///<Renewal time
+   uint32_t t2;                                 ///<Rebinding time
+} DhcpLease;
+
+
+//Callback function to retrieve the last lease from non-volatile storage
+typedef error_t (*DhcpLoadLeaseCallback)(NetInterface *interface, DhcpLease *lease);
+//Callback function to save (or discard, if lease is NULL) the current lease
+typedef void (*DhcpSaveLeaseCallback)(NetInterface *interface, const DhcpLease *lease);
+
+
 /**
  * @brief DHCP client settings
  **/
 
 typedef struct
 {
-   NetInterface *interface; ///<Network interface to configure
-   bool_t rapidCommit;      ///<Quick configuration using rapid commit
+   NetInterface *interface;         ///<Network interface to configure
+   bool_t rapidCommit;              ///<Quick configuration using rapid commit
+   DhcpLoadLeaseCallback loadLease; ///<Retrieve the lease saved before the last reset (optional)
+   DhcpSaveLeaseCallback saveLease; ///<Save the current lease (optional)
 } DhcpClientSettings;
 
 
@@ -101,6 +128,9 @@ typedef struct
 {
    NetInterface *interface;           ///<Underlying network interface
    bool_t rapidCommit;                ///<Quick configuration using rapid commit
+   bool_t rapidCommitAck;             ///<DHCPDISCOVER was answered with a DHCPACK
+   DhcpLoadLeaseCallback loadLease;   ///<Retrieve the saved lease
+   DhcpSaveLeaseCallback saveLease;   ///<Save the current lease
    Socket *socket;                    ///<Pointer to the datagram socket
    DhcpState state;                   ///<Current state
    Ipv4Addr serverIpAddr;             ///<DHCP server IPv4 address
@@ -142,6 +172,10 @@ error_t dhcpSendDecline(DhcpClientCtx *context);
 error_t dhcpParseOffer(DhcpClientCtx *context, size_t length);
 error_t dhcpParseAckNak(DhcpClientCtx *context, size_t length);
 
+error_t dhcpLoadLease(DhcpClientCtx *context);
+void dhcpSaveLease(DhcpClientCtx *context);
+void dhcpDiscardLease(DhcpClientCtx *context);
+
 uint16_t dhcpComputeElapsedTime(DhcpClientCtx *context);
 
 int32_t dhcpRandRange(int32_t min, int32_t max);
@@ -87,6 +87,11 @@ error_t dhcpv6ClientStart(Dhcpv6ClientCtx *context, const Dhcpv6ClientSettings *
    context->interface = settings->interface;
    //Check whether rapid commit is allowed
    context->rapidCommit = settings->rapidCommit;
+   //Stateless or stateful DHCPv6?
+   context->stateless = settings->stateless;
+   //Callback functions used to keep the lease across resets
+   context->loadLease = settings->loadLease;
+   context->saveLease = settings->saveLease;
 
    //Point to the client DUID
    duid = (Dhcpv6DuidLl *) context->clientId;
@@ -187,8 +192,17 @@ void dhcpv6ClientTask(void *param)
    //At this point the global address is not yet valid
    context->interface->ipv6Config.globalAddrState = IPV6_ADDR_STATE_INVALID;
    context->interface->ipv6Config.globalAddr = IPV6_UNSPECIFIED_ADDR;
-   //Initialize DHCPv6 client state
-   context->state = DHCPV6_STATE_SOLICIT;
+
+   //Stateless DHCPv6 only obtains other configuration parameters
+   if(context->stateless)
+      context->state = DHCPV6_STATE_INFO_REQUEST;
+   //A client that has a lease from before the last reset confirms it
+   //with a single Confirm/Reply exchange (RFC 3315 18.1.2)
+   else if(!dhcpv6LoadLease(context))
+      context->state = DHCPV6_STATE_CONFIRM;
+   //Otherwise the client locates a server
+   else
+      context->state = DHCPV6_STATE_SOLICIT;
 
    //DHCPv6 client finite state machine
    while(1)
@@ -235,6 +249,16 @@ void dhcpv6ClientTask(void *param)
          //receives no response to a Renew message
          dhcpv6StateRebind(context);
          break;
+      //Process DECLINE state
+      case DHCPV6_STATE_DECLINE:
+         //The client informs the server that the address is already in use
+         dhcpv6StateDecline(context);
+         break;
+      //Process INFO-REQUEST state
+      case DHCPV6_STATE_INFO_REQUEST:
+         //The client requests configuration parameters without addresses
+         dhcpv6StateInfoRequest(context);
+         break;
       //Invalid state...
       default:
          //Switch to the default state
@@ -314,16 +338,10 @@ void dhcpv6StateSolicit(Dhcpv6ClientCtx *context)
    //Rapid commit procedure is complete?
    else
    {
-      //Address uniqueness on the link is being verified...
-      context->interface->ipv6Config.globalAddrState = IPV6_ADDR_STATE_TENTATIVE;
-{
-Ipv6Addr solicitedNodeAddr;
-ipv6ComputeSolicitedNodeAddr(&context->interface->ipv6Config.globalAddr, &solicitedNodeAddr);
-ipv6JoinMulticastGroup(context->interface, &solicitedNodeAddr);
-}
       //The client should perform duplicate address detection on the address it
       //receives in the Reply message before using that address for traffic
-      error = slaacDetectDuplicateAddr(&context->interface->ipv6Config.globalAddr);
+      error = slaacDetectDuplicateAddr(context->interface,
+         &context->interface->ipv6Config.globalAddr);
 
       //Check if the address is found to be in use on the link
       if(error)
@@ -336,8 +354,8 @@ ipv6JoinMulticastGroup(context->interface, &solicitedNodeAddr);
       }
       else
       {
-         //The use of the global address is now unrestricted
-         context->interface->ipv6Config.globalAddrState = IPV6_ADDR_STATE_PREFERRED;
+         //Save the lease to non-volatile storage
+         dhcpv6SaveLease(context);
          //Dump current DHCPv6 configuration for debugging purpose
          dhcpv6DumpConfig(context);
          //Enter the BOUND state
@@ -364,7 +382,6 @@ void dhcpv6StateRequest(Dhcpv6ClientCtx *context)
 
    //Debug message
    TRACE_INFO("\r\n%s: DHCPv6 client REQUEST state\r\n", timeFormat(osGetTickCount()));
-osDelay(1500);
 
    //Adjust retransmission parameters
    context->irt = DHCPV6_REQ_TIMEOUT;
@@ -387,16 +404,10 @@ osDelay(1500);
       return;
    }
 
-   //Address uniqueness on the link is being verified...
-   context->interface->ipv6Config.globalAddrState = IPV6_ADDR_STATE_TENTATIVE;
-{
-Ipv6Addr solicitedNodeAddr;
-ipv6ComputeSolicitedNodeAddr(&context->interface->ipv6Config.globalAddr, &solicitedNodeAddr);
-ipv6JoinMulticastGroup(context->interface, &solicitedNodeAddr);
-}
    //The client should perform duplicate address detection on the address it
    //receives in the Reply message before using that address for traffic
-   error = slaacDetectDuplicateAddr(&context->interface->ipv6Config.globalAddr);
+   error = slaacDetectDuplicateAddr(context->interface,
+      &context->interface->ipv6Config.globalAddr);
 
    //Check if the address is found to be in use on the link
    if(error)
@@ -409,8 +420,8 @@ ipv6JoinMulticastGroup(context->interface, &solicitedNodeAddr);
    }
    else
    {
-      //The use of the global address is now unrestricted
-      context->interface->ipv6Config.globalAddrState = IPV6_ADDR_STATE_PREFERRED;
+      //Save the lease to non-volatile storage
+      dhcpv6SaveLease(context);
       //Dump current DHCPv6 configuration for debugging purpose
       dhcpv6DumpConfig(context);
       //Enter the BOUND state
@@ -473,10 +484,38 @@ void dhcpv6StateConfirm(Dhcpv6ClientCtx *context)
    //to use any other previously obtained configuration parameters
    if(error == NO_ERROR || error == ERROR_TIMEOUT)
    {
-      //Dump current DHCPv6 configuration for debugging purpose
-      dhcpv6DumpConfig(context);
-      //Switch to the BOUND state
-      context->state = DHCPV6_STATE_BOUND;
+      //The address loaded from non-volatile storage has not been
+      //checked for uniqueness yet
+      if(context->interface->ipv6Config.globalAddrState == IPV6_ADDR_STATE_INVALID)
+      {
+         //Perform duplicate address detection before using the address
+         error = slaacDetectDuplicateAddr(context->interface,
+            &context->interface->ipv6Config.globalAddr);
+      }
+      else
+      {
+         //The address is already in use on this interface
+         error = NO_ERROR;
+      }
+
+      //Check if the address is found to be in use on the link
+      if(error)
+      {
+         //The global address cannot be used on the link
+         context->interface->ipv6Config.globalAddrState = IPV6_ADDR_STATE_INVALID;
+         context->interface->ipv6Config.globalAddr = IPV6_UNSPECIFIED_ADDR;
+         //Switch to the DECLINE state
+         context->state = DHCPV6_STATE_DECLINE;
+      }
+      else
+      {
+         //Save the lease to non-volatile storage
+         dhcpv6SaveLease(context);
+         //Dump current DHCPv6 configuration for debugging purpose
+         dhcpv6DumpConfig(context);
+         //Switch to the BOUND state
+         context->state = DHCPV6_STATE_BOUND;
+      }
    }
    //Link is down?
    else if(error == ERROR_LINK_DOWN)
@@ -491,6 +530,8 @@ void dhcpv6StateConfirm(Dhcpv6ClientCtx *context)
       //to which the client is connected
       context->interface->ipv6Config.globalAddrState = IPV6_ADDR_STATE_INVALID;
       context->interface->ipv6Config.globalAddr = IPV6_UNSPECIFIED_ADDR;
+      //Discard the saved lease
+      dhcpv6DiscardLease(context);
       //Perform DHCPv6 server solicitation
       context->state = DHCPV6_STATE_SOLICIT;
    }
@@ -529,8 +570,11 @@ void dhcpv6StateBound(Dhcpv6ClientCtx *context)
       //Link is down?
       if(!error)
       {
-         //Back to CONFIRM state
-         context->state = DHCPV6_STATE_CONFIRM;
+         //Check the configuration again when the link comes back up
+         if(context->stateless)
+            context->state = DHCPV6_STATE_INFO_REQUEST;
+         else
+            context->state = DHCPV6_STATE_CONFIRM;
       }
       //Any failure to report?
       else
@@ -592,7 +636,6 @@ void dhcpv6StateRenew(Dhcpv6ClientCtx *context)
 
    //Debug message
    TRACE_INFO("\r\n%s: DHCPv6 client RENEW state\r\n", timeFormat(osGetTickCount()));
-osDelay(1500);
 
    //A client will never attempt to use a Rebind message to locate a different server
    //to extend the lifetime of any address in an IA with T2 set to 0xFFFFFFFF
@@ -640,12 +683,16 @@ osDelay(1500);
       //The address is no longer valid
       context->interface->ipv6Config.globalAddrState = IPV6_ADDR_STATE_INVALID;
       context->interface->ipv6Config.globalAddr = IPV6_UNSPECIFIED_ADDR;
+      //Discard the saved lease
+      dhcpv6DiscardLease(context);
       //Initiate a new server solicitation
       context->state = DHCPV6_STATE_SOLICIT;
    }
    //The address was successfully renewed
    else
    {
+      //Save the lease to non-volatile storage
+      dhcpv6SaveLease(context);
       //Dump current DHCPv6 configuration for debugging purpose
       dhcpv6DumpConfig(context);
       //Switch to the BOUND state
@@ -713,12 +760,16 @@ void dhcpv6StateRebind(Dhcpv6ClientCtx *context)
       //The address is no longer valid
       context->interface->ipv6Config.globalAddrState = IPV6_ADDR_STATE_INVALID;
       context->interface->ipv6Config.globalAddr = IPV6_UNSPECIFIED_ADDR;
+      //Discard the saved lease
+      dhcpv6DiscardLease(context);
       //Initiate a new server solicitation
       context->state = DHCPV6_STATE_SOLICIT;
    }
    //The address was successfully renewed
    else
    {
+      //Save the lease to non-volatile storage
+      dhcpv6SaveLease(context);
       //Dump current DHCPv6 configuration for debugging purpose
       dhcpv6DumpConfig(context);
       //Switch to the BOUND state
@@ -751,11 +802,82 @@ void dhcpv6StateDecline(Dhcpv6ClientCtx *context)
    //Perform a Decline/Reply message exchange
    dhcpv6MessageExchange(context, dhcpv6FormatDecline, dhcpv6ParseReply);
 
+   //The declined address must not be reused after a reset
+   dhcpv6DiscardLease(context);
+
    //Update DHCPv6 client state
    context->state = DHCPV6_STATE_SOLICIT;
 }
 
 
+/**
+ * @brief INFO-REQUEST state
+ *
+ * When addresses are obtained by other means (stateless address
+ * autoconfiguration), the client only needs other configuration
+ * parameters such as DNS servers. A single Information-Request/Reply
+ * exchange is then performed (RFC 3736)
+ *
+ * @param[in] context Pointer to the DHCPv6 client context
+ **/
+
+void dhcpv6StateInfoRequest(Dhcpv6ClientCtx *context)
+{
+   error_t error;
+   SocketEventDesc eventDesc;
+
+   //Specify the events the application is interested in
+   eventDesc.socket = context->socket;
+   eventDesc.eventMask = SOCKET_EVENT_LINK_UP;
+
+   //Wait for the link to be up before sending out the first message
+   error = socketPoll(&eventDesc, 1, context->event, INFINITE_DELAY);
+
+   //Any error to report?
+   if(error)
+   {
+      //Stay in INFO-REQUEST state
+      context->state = DHCPV6_STATE_INFO_REQUEST;
+      //Exit immediately
+      return;
+   }
+
+   //Debug message
+   TRACE_INFO("\r\n%s: DHCPv6 client INFO-REQUEST state\r\n", timeFormat(osGetTickCount()));
+
+   //The first Information-Request message from the client on the interface
+   //must be delayed by a random amount of time between 0 and INF_MAX_DELAY
+   osDelay(dhcpv6RandRange(0, DHCPV6_INF_MAX_DELAY));
+
+   //Adjust retransmission parameters
+   context->irt = DHCPV6_INF_TIMEOUT;
+   context->mrt = DHCPV6_INF_MAX_RT;
+   context->mrc = 0;
+   context->mrd = 0;
+
+   //Perform an Information-Request/Reply message exchange
+   error = dhcpv6MessageExchange(context, dhcpv6FormatInfoRequest, dhcpv6ParseReply);
+
+   //Configuration parameters successfully obtained?
+   if(!error)
+   {
+      //No lease to manage. The parameters are refreshed when the link comes back up
+      context->leaseStartTime = osGetTickCount();
+      context->t1 = DHCPV6_INFINITE_TIME;
+      context->t2 = DHCPV6_INFINITE_TIME;
+      //Dump current DHCPv6 configuration for debugging purpose
+      dhcpv6DumpConfig(context);
+      //Switch to the BOUND state
+      context->state = DHCPV6_STATE_BOUND;
+   }
+   else
+   {
+      //Try again
+      context->state = DHCPV6_STATE_INFO_REQUEST;
+   }
+}
+
+
 /**
  * @brief Client-initiated message exchange
  *
@@ -1321,6 +1443,47 @@ error_t dhcpv6FormatDecline(Dhcpv6ClientCtx *context, Dhcpv6Message *message, si
 }
 
 
+/**
+ * @brief Format Information-Request message
+ * @param[in] context Pointer to the DHCPv6 client context
+ * @param[out] message Buffer where to format the Information-Request message
+ * @param[out] length Length of the resulting Information-Request message
+ * @return Error code
+ **/
+
+error_t dhcpv6FormatInfoRequest(Dhcpv6ClientCtx *context, Dhcpv6Message *message, size_t *length)
+{
+   Dhcpv6ElapsedTimeOption elapsedTimeOption;
+
+   //Format the Information-Request message
+   message->msgType = DHCPV6_MSG_TYPE_INFO_REQUEST;
+   //The transaction ID is chosen by the client
+   STORE24BE(context->transactionId, message->transactionId);
+   //Size of the Information-Request message
+   *length = sizeof(Dhcpv6Message);
+
+   //The client should include a Client Identifier option
+   //to identify itself to the server
+   dhcpv6AddOption(message, length, DHCPV6_OPTION_CLIENTID,
+      context->clientId, context->clientIdLength);
+
+   //The client must include an Option Request option to indicate
+   //the options the client is interested in receiving
+   dhcpv6AddOption(message, length, DHCPV6_OPTION_ORO,
+      &dhcpv6OptionList, sizeof(dhcpv6OptionList));
+
+   //Compute the time elapsed since the client sent the first message
+   elapsedTimeOption.value = dhcpv6ComputeElapsedTime(context);
+   //The client must include an Elapsed Time option in messages to indicate
+   //how long the client has been trying to complete a DHCP message exchange
+   dhcpv6AddOption(message, length, DHCPV6_OPTION_ELAPSED_TIME,
+      &elapsedTimeOption, sizeof(Dhcpv6ElapsedTimeOption));
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Parse Advertise message
  * @param[in] context Pointer to the DHCPv6 client context
@@ -1428,7 +1591,6 @@ error_t dhcpv6ParseReply(Dhcpv6ClientCtx *context, const Dhcpv6Message *message,
 {
    error_t error;
    uint_t i;
-   uint_t n;
    Dhcpv6Option *option;
    Dhcpv6Option *serverIdOption;
 
@@ -1481,8 +1643,9 @@ error_t dhcpv6ParseReply(Dhcpv6ClientCtx *context, const Dhcpv6Message *message,
       //Save the server DUID
       memcpy(context->serverId, serverIdOption->value, context->serverIdLength);
    }
-   //The Reply message is received in response to a Request or a Renew message?
-   else if(context->state == DHCPV6_STATE_REQUEST || context->state == DHCPV6_STATE_RENEW)
+   //The Reply message is received in response to a Request, a Renew or a Decline message?
+   else if(context->state == DHCPV6_STATE_REQUEST || context->state == DHCPV6_STATE_RENEW ||
+      context->state == DHCPV6_STATE_DECLINE)
    {
       //Compare DUID lengths
       if(ntohs(serverIdOption->length) != context->serverIdLength)
@@ -1491,11 +1654,13 @@ error_t dhcpv6ParseReply(Dhcpv6ClientCtx *context, const Dhcpv6Message *message,
       if(memcmp(serverIdOption->value, context->serverId, context->serverIdLength))
          return ERROR_INVALID_MESSAGE;
    }
-   //The Reply message is received in response to a Confirm or a Rebind message?
+   //The Reply message is received in response to a Confirm, a Rebind
+   //or an Information-Request message?
    else
    {
       //Do not check the server DUID when the Reply message is
-      //received in response to a Confirm or a Rebind message
+      //received in response to a Confirm, a Rebind or an
+      //Information-Request message
    }
 
    //Search for the Status Code option
@@ -1503,6 +1668,19 @@ error_t dhcpv6ParseReply(Dhcpv6ClientCtx *context, const Dhcpv6Message *message,
    //Check the status code returned by the server
    if(error) return error;
 
+   //Replies to Confirm, Decline and Information-Request messages do not
+   //carry any IA. A Success status completes the message exchange
+   if(context->state == DHCPV6_STATE_CONFIRM || context->state == DHCPV6_STATE_DECLINE ||
+      context->state == DHCPV6_STATE_INFO_REQUEST)
+   {
+      //Record the DNS servers provided along with the reply
+      if(context->state != DHCPV6_STATE_DECLINE)
+         dhcpv6ParseDnsServersOption(context, message->options, length);
+
+      //The Reply message was successfully parsed
+      return NO_ERROR;
+   }
+
    //Loop through DHCPv6 options
    for(i = 0; i < length; i += sizeof(Dhcpv6Option) + ntohs(option->length))
    {
@@ -1525,20 +1703,8 @@ error_t dhcpv6ParseReply(Dhcpv6ClientCtx *context, const Dhcpv6Message *message,
          //Save the server DUID
          memcpy(context->serverId, serverIdOption->value, context->serverIdLength);
 
-         //Search for DNS Servers option
-         option = dhcpv6GetOption(message->options, length, DHCPV6_OPTION_DNS_SERVERS);
-         //Check whether the message includes a DNS Servers option
-         if(option && !(ntohs(option->length) % sizeof(Ipv6Addr)))
-         {
-            //Get the number of addresses provided in the response
-            n = ntohs(option->length) / sizeof(Ipv6Addr);
-            //Only a limited set of DNS servers is supported
-            n = min(n, IPV6_MAX_DNS_SERVERS);
-            //Record DNS server addresses
-            memcpy(context->interface->ipv6Config.dnsServer, option->value, n * sizeof(Ipv6Addr));
-            //Save the number of DNS servers
-            context->interface->ipv6Config.dnsServerCount = n;
-         }
+         //Record the DNS servers, if any
+         dhcpv6ParseDnsServersOption(context, message->options, length);
 
          //The Reply message is received in response to a Solicit message?
          if(context->state == DHCPV6_STATE_SOLICIT)
@@ -1638,6 +1804,154 @@ error_t dhcpv6ParseIaNaOption(Dhcpv6ClientCtx *context, const Dhcpv6Option *opti
 }
 
 
+/**
+ * @brief Parse DNS Servers option
+ * @param[in] context Pointer to the DHCPv6 client context
+ * @param[in] options Pointer to the Options field
+ * @param[in] length Length of the Options field
+ **/
+
+void dhcpv6ParseDnsServersOption(Dhcpv6ClientCtx *context, const uint8_t *options, size_t length)
+{
+   uint_t n;
+   Dhcpv6Option *option;
+
+   //Search for DNS Servers option
+   option = dhcpv6GetOption(options, length, DHCPV6_OPTION_DNS_SERVERS);
+   //Check whether the message includes a DNS Servers option
+   if(option && !(ntohs(option->length) % sizeof(Ipv6Addr)))
+   {
+      //Get the number of addresses provided in the response
+      n = ntohs(option->length) / sizeof(Ipv6Addr);
+      //Only a limited set of DNS servers is supported
+      n = min(n, IPV6_MAX_DNS_SERVERS);
+      //Record DNS server addresses
+      memcpy(context->interface->ipv6Config.dnsServer, option->value, n * sizeof(Ipv6Addr));
+      //Save the number of DNS servers
+      context->interface->ipv6Config.dnsServerCount = n;
+   }
+}
+
+
+/**
+ * @brief Retrieve the lease saved before the last reset
+ * @param[in] context Pointer to the DHCPv6 client context
+ * @return Error code
+ **/
+
+error_t dhcpv6LoadLease(Dhcpv6ClientCtx *context)
+{
+   error_t error;
+   uint_t n;
+   Dhcpv6Lease lease;
+   Ipv6Config *config;
+
+   //No storage callback?
+   if(context->loadLease == NULL)
+      return ERROR_NOT_FOUND;
+
+   //Read the lease from non-volatile storage
+   error = context->loadLease(context->interface, &lease);
+   //Any error to report?
+   if(error) return error;
+
+   //The lease must have been granted to this interface (the client DUID
+   //is derived from the MAC address)
+   if(!macCompAddr(&lease.macAddr, &context->interface->macAddr))
+      return ERROR_INVALID_MESSAGE;
+   //Make sure the saved address is valid
+   if(ipv6CompAddr(&lease.addr, &IPV6_UNSPECIFIED_ADDR))
+      return ERROR_INVALID_MESSAGE;
+   //Check the length of the server DUID
+   if(!lease.serverIdLength || lease.serverIdLength >= DHCPV6_MAX_DUID_SIZE)
+      return ERROR_INVALID_MESSAGE;
+
+   //Point to the IPv6 configuration of the interface
+   config = &context->interface->ipv6Config;
+
+   //Restore the address. DAD is performed once the lease has been confirmed
+   config->globalAddrState = IPV6_ADDR_STATE_INVALID;
+   config->globalAddr = lease.addr;
+
+   //Restore DNS servers
+   n = min(lease.dnsServerCount, IPV6_MAX_DNS_SERVERS);
+   memcpy(config->dnsServer, lease.dnsServer, n * sizeof(Ipv6Addr));
+   config->dnsServerCount = n;
+
+   //Restore the server DUID, so that the lease can be renewed
+   context->serverIdLength = lease.serverIdLength;
+   memcpy(context->serverId, lease.serverId, lease.serverIdLength);
+
+   //The time elapsed since the lease was saved is unknown. The lifetimes
+   //are counted from now on, and refreshed by the next Renew message
+   context->leaseStartTime = osGetTickCount();
+   context->t1 = lease.t1;
+   context->t2 = lease.t2;
+   context->preferredLifetime = lease.preferredLifetime;
+   context->validLifetime = lease.validLifetime;
+
+   //Debug message
+   TRACE_INFO("DHCPv6 lease loaded (%s)...\r\n", ipv6AddrToString(&lease.addr, NULL));
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Save the current lease to non-volatile storage
+ * @param[in] context Pointer to the DHCPv6 client context
+ **/
+
+void dhcpv6SaveLease(Dhcpv6ClientCtx *context)
+{
+   uint_t n;
+   Dhcpv6Lease lease;
+   Ipv6Config *config;
+
+   //No storage callback?
+   if(context->saveLease == NULL)
+      return;
+
+   //Point to the IPv6 configuration of the interface
+   config = &context->interface->ipv6Config;
+
+   //Clear the lease (padding bytes are saved too)
+   memset(&lease, 0, sizeof(Dhcpv6Lease));
+
+   //Format the lease
+   lease.macAddr = context->interface->macAddr;
+   lease.addr = config->globalAddr;
+   lease.serverIdLength = context->serverIdLength;
+   memcpy(lease.serverId, context->serverId, context->serverIdLength);
+   lease.t1 = context->t1;
+   lease.t2 = context->t2;
+   lease.preferredLifetime = context->preferredLifetime;
+   lease.validLifetime = context->validLifetime;
+
+   //Save DNS servers
+   n = min(config->dnsServerCount, IPV6_MAX_DNS_SERVERS);
+   memcpy(lease.dnsServer, config->dnsServer, n * sizeof(Ipv6Addr));
+   lease.dnsServerCount = n;
+
+   //Write the lease to non-volatile storage
+   context->saveLease(context->interface, &lease);
+}
+
+
+/**
+ * @brief Discard the lease kept in non-volatile storage
+ * @param[in] context Pointer to the DHCPv6 client context
+ **/
+
+void dhcpv6DiscardLease(Dhcpv6ClientCtx *context)
+{
+   //Invalidate the saved lease, if any
+   if(context->saveLease != NULL)
+      context->saveLease(context->interface, NULL);
+}
+
+
 /**
  * @brief Compute the time elapsed since the client sent the first message
  * @param[in] context Pointer to the DHCPv6 client context
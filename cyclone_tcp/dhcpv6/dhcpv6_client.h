@@ -85,18 +85,47 @@ typedef enum
    DHCPV6_STATE_BOUND   = 3,
    DHCPV6_STATE_RENEW   = 4,
    DHCPV6_STATE_REBIND  = 5,
-   DHCPV6_STATE_DECLINE = 6
+   DHCPV6_STATE_DECLINE = 6,
+   DHCPV6_STATE_INFO_REQUEST = 7
 } Dhcpv6State;
 
 
+/**
+ * @brief Lease kept in non-volatile storage
+ **/
+
+typedef struct
+{
+   MacAddr macAddr;                             ///<Hardware address the lease was granted to
+   Ipv6Addr addr;                               ///<Assigned IPv6 global address
+   Ipv6Addr dnsServer[IPV6_MAX_DNS_SERVERS];    ///<DNS servers
+   uint_t dnsServerCount;                       ///<Number of DNS servers
+   uint8_t serverId[DHCPV6_MAX_DUID_SIZE];      ///<DUID of the server that granted the lease
+   size_t serverIdLength;                       ///<Length of the server DUID
+   uint32_t t1;                                 ///<T1 parameter
+   uint32_t t2;                                 ///<T2 parameter
+   uint32_t preferredLifetime;                  ///<Preferred lifetime
+   uint32_t validLifetime;                      ///<Valid lifetime
+} Dhcpv6Lease;
+
+
+//Callback function to retrieve the last lease from non-volatile storage
+typedef error_t (*Dhcpv6LoadLeaseCallback)(NetInterface *interface, Dhcpv6Lease *lease);
+//Callback function to save (or discard, if lease is NULL) the current lease
+typedef void (*Dhcpv6SaveLeaseCallback)(NetInterface *interface, const Dhcpv6Lease *lease);
+
+
 /**
  * @brief DHCPv6 client settings
  **/
 
 typedef struct
 {
-   NetInterface *interface; ///<Network interface to configure
-   bool_t rapidCommit;      ///<Quick configuration using rapid commit
+   NetInterface *interface;           ///<Network interface to configure
+   bool_t rapidCommit;                ///<Quick configuration using rapid commit
+   bool_t stateless;                  ///<Only request other configuration parameters (no address)
+   Dhcpv6LoadLeaseCallback loadLease; ///<Retrieve the lease saved before the last reset (optional)
+   Dhcpv6SaveLeaseCallback saveLease; ///<Save the current lease (optional)
 } Dhcpv6ClientSettings;
 
 
@@ -109,6 +138,9 @@ typedef struct
    NetInterface *interface;                ///<Underlying network interface
    bool_t rapidCommit;                     ///<Quick configuration using rapid commit
    bool_t rapidCommitDone;                 ///<Rapid commit procedure done
+   bool_t stateless;                       ///<Stateless DHCPv6 (Information-Request only)
+   Dhcpv6LoadLeaseCallback loadLease;      ///<Retrieve the saved lease
+   Dhcpv6SaveLeaseCallback saveLease;      ///<Save the current lease
    Socket *socket;                         ///<Pointer to the datagram socket
    Dhcpv6State state;                      ///<Current state
    int_t serverPreference;                 ///<Preference value for the server
@@ -154,6 +186,7 @@ void dhcpv6StateBound(Dhcpv6ClientCtx *context);
 void dhcpv6StateRenew(Dhcpv6ClientCtx *context);
 void dhcpv6StateRebind(Dhcpv6ClientCtx *context);
 void dhcpv6StateDecline(Dhcpv6ClientCtx *context);
+void dhcpv6StateInfoRequest(Dhcpv6ClientCtx *context);
 
 error_t dhcpv6MessageExchange(Dhcpv6ClientCtx *context,
    Dhcpv6FormatCallback formatRequest, Dhcpv6ParseCallback parseResponse);
@@ -167,11 +200,17 @@ error_t dhcpv6FormatConfirm(Dhcpv6ClientCtx *context, Dhcpv6Message *message, si
 error_t dhcpv6FormatRenew(Dhcpv6ClientCtx *context, Dhcpv6Message *message, size_t *length);
 error_t dhcpv6FormatRebind(Dhcpv6ClientCtx *context, Dhcpv6Message *message, size_t *length);
 error_t dhcpv6FormatDecline(Dhcpv6ClientCtx *context, Dhcpv6Message *message, size_t *length);
+error_t dhcpv6FormatInfoRequest(Dhcpv6ClientCtx *context, Dhcpv6Message *message, size_t *length);
 
 error_t dhcpv6ParseAdvertise(Dhcpv6ClientCtx *context, const Dhcpv6Message *message, size_t length);
 error_t dhcpv6ParseReply(Dhcpv6ClientCtx *context, const Dhcpv6Message *message, size_t length);
 
 error_t dhcpv6ParseIaNaOption(Dhcpv6ClientCtx *context, const Dhcpv6Option *option);
+void dhcpv6ParseDnsServersOption(Dhcpv6ClientCtx *context, const uint8_t *options, size_t length);
+
+error_t dhcpv6LoadLease(Dhcpv6ClientCtx *context);
+void dhcpv6SaveLease(Dhcpv6ClientCtx *context);
+void dhcpv6DiscardLease(Dhcpv6ClientCtx *context);
 
 uint16_t dhcpv6ComputeElapsedTime(Dhcpv6ClientCtx *context);
 
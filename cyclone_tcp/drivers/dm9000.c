@@ -36,9 +36,6 @@
 #include "dm9000.h"
 #include "debug.h"
 
-//Transmit buffer
-static uint8_t txBuffer[1536] __attribute__((aligned(2)));
-
 
 /**
  * @brief DM9000 driver
@@ -57,7 +54,11 @@ const NicDriver dm9000Driver =
    NULL,
    TRUE,
    TRUE,
-   TRUE
+   TRUE,
+   FALSE,
+   FALSE,
+   FALSE,
+   ETH_MTU
 };
 
 
@@ -141,6 +142,9 @@ error_t dm9000Init(NetInterface *interface)
    //Check chip revision
    if(chipRevision != DM9000A_CHIP_REV && chipRevision != DM9000B_CHIP_REV)
       return ERROR_WRONG_IDENTIFIER;
+   //The FIFO routines expect the data port to operate in 16-bit mode
+   if(dm9000ReadReg(DM9000_REG_ISR) & ISR_IOMODE)
+      return ERROR_WRONG_IDENTIFIER;
 
    //Power up the internal PHY by clearing PHYPD
    dm9000WriteReg(DM9000_REG_GPR, 0x00);
@@ -428,6 +432,97 @@ error_t dm9000SetMacFilter(NetInterface *interface)
 }
 
 
+/**
+ * @brief Write the contents of a multi-part buffer to the TX FIFO
+ *
+ * Each chunk is streamed straight to the data port. A byte left over at
+ * the end of a chunk is paired with the first byte of the next one
+ *
+ * @param[in] buffer Multi-part buffer containing the data to send
+ * @param[in] offset Offset to the first data byte
+ **/
+
+static void dm9000WriteFifo(const ChunkedBuffer *buffer, size_t offset)
+{
+   uint_t i;
+   size_t n;
+   bool_t odd;
+   uint16_t carry;
+   const uint8_t *p;
+   const uint16_t *q;
+
+   //No pending byte
+   odd = FALSE;
+   carry = 0;
+
+   //Loop through the chunks
+   for(i = 0; i < buffer->chunkCount; i++)
+   {
+      //Skip the data that precede the frame
+      if(buffer->chunk[i].length <= offset)
+      {
+         offset -= buffer->chunk[i].length;
+         continue;
+      }
+
+      //Point to the data to be sent
+      p = (uint8_t *) buffer->chunk[i].address + offset;
+      n = buffer->chunk[i].length - offset;
+      //Process the next chunk
+      offset = 0;
+
+      //Complete the 16-bit word started by the previous chunk
+      if(odd)
+      {
+         *DM9000_DATA_REG = carry | (*(p++) << 8);
+         n--;
+         odd = FALSE;
+      }
+
+      //Properly aligned data?
+      if(!((uint_t) p & 1))
+      {
+         //Point to the current 16-bit word
+         q = (uint16_t *) p;
+
+         //Write data to the FIFO using 16-bit mode (4 words per iteration)
+         for(; n >= 8; n -= 8)
+         {
+            *DM9000_DATA_REG = q[0];
+            *DM9000_DATA_REG = q[1];
+            *DM9000_DATA_REG = q[2];
+            *DM9000_DATA_REG = q[3];
+            q += 4;
+         }
+
+         //Write the remaining words
+         for(; n >= 2; n -= 2)
+            *DM9000_DATA_REG = *(q++);
+
+         //Point to the last byte, if any
+         p = (uint8_t *) q;
+      }
+      else
+      {
+         //Unaligned halfword accesses are not supported by the core
+         for(; n >= 2; n -= 2, p += 2)
+            *DM9000_DATA_REG = p[0] | (p[1] << 8);
+      }
+
+      //Odd number of bytes in the current chunk?
+      if(n > 0)
+      {
+         carry = *p;
+         odd = TRUE;
+      }
+   }
+
+   //Write the last byte of the frame
+   if(odd)
+      *DM9000_DATA_REG = carry;
+}
+
+
 /**
  * @brief Send a packet to DM9000
  * @param[in] interface Underlying network interface
@@ -439,9 +534,6 @@ error_t dm9000SetMacFilter(NetInterface *interface)
 error_t dm9000SendPacket(NetInterface *interface,
    const ChunkedBuffer *buffer, size_t offset)
 {
-   size_t i;
-   uint16_t *p;
-
    //Point to the driver context
    Dm9000Context *context = (Dm9000Context *) interface->nicContext;
 
@@ -457,24 +549,13 @@ error_t dm9000SendPacket(NetInterface *interface,
       return ERROR_INVALID_LENGTH;
    }
 
-   //Copy user data
-   chunkedBufferRead(txBuffer, buffer, offset, length);
-
    //A dummy write is required before accessing FIFO
    dm9000WriteReg(DM9000_REG_MWCMDX, 0);
    //Select MWCMD register
    *DM9000_INDEX_REG = DM9000_REG_MWCMD;
 
-   //Point to the beginning of the buffer
-   p = (uint16_t *) txBuffer;
-
-   //Write data to the FIFO using 16-bit mode
-   for(i = length; i > 1; i -= 2)
-      *DM9000_DATA_REG = *(p++);
-
-   //Odd number of bytes?
-   if(i > 0)
-      *DM9000_DATA_REG = *((uint8_t *) p);
+   //Copy user data directly to the FIFO
+   dm9000WriteFifo(buffer, offset);
 
    //Write the number of bytes to send
    dm9000WriteReg(DM9000_REG_TXPLL, LSB(length));
@@ -551,7 +632,18 @@ uint_t dm9000ReceivePacket(NetInterface *interface,
    //Initialize byte counter
    i = 0;
 
-   //Read data from FIFO using 16-bit mode
+   //Read data from FIFO using 16-bit mode (4 words per iteration)
+   while((i + 7) < size)
+   {
+      p[0] = *DM9000_DATA_REG;
+      p[1] = *DM9000_DATA_REG;
+      p[2] = *DM9000_DATA_REG;
+      p[3] = *DM9000_DATA_REG;
+      p += 4;
+      i += 8;
+   }
+
+   //Read the remaining words
    while((i + 1) < size)
    {
       *(p++) = *DM9000_DATA_REG;
@@ -74,7 +74,11 @@ const NicDriver k60EthDriver =
    k60EthReadPhyReg,
    TRUE,
    TRUE,
-   TRUE
+   TRUE,
+   FALSE,
+   FALSE,
+   FALSE,
+   ETH_MTU
 };
 
 
@@ -136,7 +140,7 @@ error_t k60EthInit(NetInterface *interface)
    ENET->MSCR = ENET_MSCR_MII_SPEED(19);
 
    //PHY transceiver initialization
-   error = interface->phyDriver->init(interface);
+   error = phyDriverInit(interface);
    //Failed to initialize PHY transceiver?
    if(error) return error;
 
@@ -269,7 +273,7 @@ void k60EthInitBufferDesc(NetInterface *interface)
 void k60EthTick(NetInterface *interface)
 {
    //Handle periodic operations
-   interface->phyDriver->tick(interface);
+   phyDriverTick(interface);
 }
 
 
@@ -285,7 +289,7 @@ void k60EthEnableIrq(NetInterface *interface)
    NVIC_EnableIRQ(ENET_Receive_IRQn);
    NVIC_EnableIRQ(ENET_Error_IRQn);
    //Enable Ethernet PHY interrupts
-   interface->phyDriver->enableIrq(interface);
+   phyDriverEnableIrq(interface);
 }
 
 
@@ -301,7 +305,7 @@ void k60EthDisableIrq(NetInterface *interface)
    NVIC_DisableIRQ(ENET_Receive_IRQn);
    NVIC_DisableIRQ(ENET_Error_IRQn);
    //Disable Ethernet PHY interrupts
-   interface->phyDriver->disableIrq(interface);
+   phyDriverDisableIrq(interface);
 }
 
 
@@ -425,7 +429,7 @@ void k60EthRxEventHandler(NetInterface *interface)
       //Acknowledge the event by clearing the flag
       interface->phyEvent = FALSE;
       //Handle PHY specific events
-      linkStateChange = interface->phyDriver->eventHandler(interface);
+      linkStateChange = phyDriverEventHandler(interface);
 
       //Check whether the link state has changed?
       if(linkStateChange)
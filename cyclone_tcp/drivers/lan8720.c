@@ -47,6 +47,11 @@
 #include "lan8720.h"
 #include "debug.h"
 
+//Time elapsed since the link state was last polled
+#if (LAN8720_INT_SUPPORT == ENABLED)
+   static uint_t lan8720PollTimer;
+#endif
+
 
 /**
  * @brief LAN8720 Ethernet PHY driver
@@ -141,6 +146,16 @@ error_t lan8720Init(NetInterface *interface)
    //Dump PHY registers for debugging purpose
    lan8720DumpPhyReg(interface);
 
+#if (LAN8720_INT_SUPPORT == ENABLED)
+   //Read status register to clear any pending interrupt
+   lan8720ReadPhyReg(interface, LAN8720_PHY_REG_ISR);
+   //The nINT pin is asserted when the link goes up or down
+   lan8720WritePhyReg(interface, LAN8720_PHY_REG_IMR, IMR_AN_COMPLETE | IMR_LINK_DOWN);
+
+   //Restart the safety net timer
+   lan8720PollTimer = 0;
+#endif
+
    //Successful initialization
    return NO_ERROR;
 }
@@ -158,6 +173,17 @@ void lan8720Tick(NetInterface *interface)
    uint16_t value;
    bool_t linkState;
 
+#if (LAN8720_INT_SUPPORT == ENABLED)
+   //Link state changes are reported by the nINT pin, so the PHY
+   //is only polled from time to time in case an event is missed
+   lan8720PollTimer += NIC_TICK_INTERVAL;
+   //The polling period has not elapsed yet?
+   if(lan8720PollTimer < LAN8720_LINK_POLL_INTERVAL)
+      return;
+   //Restart the timer
+   lan8720PollTimer = 0;
+#endif
+
    //Read basic status register
    value = lan8720ReadPhyReg(interface, LAN8720_PHY_REG_BMSR);
    //Retrieve current link state
@@ -190,6 +216,10 @@ void lan8720Tick(NetInterface *interface)
 
 void lan8720EnableIrq(NetInterface *interface)
 {
+#if (LAN8720_INT_SUPPORT == ENABLED)
+   //Enable PHY transceiver interrupts
+   NVIC_EnableIRQ(LAN8720_INT_IRQn);
+#endif
 }
 
 
@@ -200,15 +230,41 @@ void lan8720EnableIrq(NetInterface *interface)
 
 void lan8720DisableIrq(NetInterface *interface)
 {
+#if (LAN8720_INT_SUPPORT == ENABLED)
+   //Disable PHY transceiver interrupts
+   NVIC_DisableIRQ(LAN8720_INT_IRQn);
+#endif
 }
 
 
 /**
  * @brief LAN8720 interrupt service routine
+ *
+ * This routine must be called by the handler of the external interrupt
+ * line the nINT pin is connected to, once the pending flag is cleared
+ *
  **/
 
 void lan8720Interrupt(void)
 {
+#if (LAN8720_INT_SUPPORT == ENABLED)
+   bool_t flag;
+
+   //Point to the structure describing the network interface
+   NetInterface *interface = &netInterface[0];
+
+   //A PHY event is pending...
+   interface->phyEvent = TRUE;
+   //Notify the user that the link state has changed
+   flag = osEventSetFromIrq(interface->nicRxEvent);
+
+   //The unblocked task has a priority higher than the currently running task?
+   if(flag)
+   {
+      //Force a context switch
+      osTaskSwitchFromIrq();
+   }
+#endif
 }
 
 
@@ -225,6 +281,11 @@ bool_t lan8720EventHandler(NetInterface *interface)
    uint16_t value;
    bool_t linkState;
 
+#if (LAN8720_INT_SUPPORT == ENABLED)
+   //Read status register to acknowledge the interrupt
+   lan8720ReadPhyReg(interface, LAN8720_PHY_REG_ISR);
+#endif
+
    //Read basic status register
    value = lan8720ReadPhyReg(interface, LAN8720_PHY_REG_BMSR);
    //Retrieve current link state
@@ -40,6 +40,25 @@
    #define LAN8720_PHY_ADDR 0
 #endif
 
+//Interrupt-driven link monitoring (nINT pin)
+#ifndef LAN8720_INT_SUPPORT
+   #define LAN8720_INT_SUPPORT DISABLED
+#elif (LAN8720_INT_SUPPORT != ENABLED && LAN8720_INT_SUPPORT != DISABLED)
+   #error LAN8720_INT_SUPPORT parameter is not valid
+#endif
+
+//Interrupt line the nINT pin is connected to
+#if (LAN8720_INT_SUPPORT == ENABLED && !defined(LAN8720_INT_IRQn))
+   #error LAN8720_INT_IRQn parameter must be defined
+#endif
+
+//Link state polling period when interrupts are used (safety net, in ms)
+#ifndef LAN8720_LINK_POLL_INTERVAL
+   #define LAN8720_LINK_POLL_INTERVAL 10000
+#elif (LAN8720_LINK_POLL_INTERVAL < NIC_TICK_INTERVAL)
+   #error LAN8720_LINK_POLL_INTERVAL parameter is not valid
+#endif
+
 //LAN8720 registers
 #define LAN8720_PHY_REG_BMCR        0x00
 #define LAN8720_PHY_REG_BMSR        0x01
@@ -199,6 +218,7 @@ void lan8720Tick(NetInterface *interface);
 
 void lan8720EnableIrq(NetInterface *interface);
 void lan8720DisableIrq(NetInterface *interface);
+void lan8720Interrupt(void);
 bool_t lan8720EventHandler(NetInterface *interface);
 
 void lan8720WritePhyReg(NetInterface *interface, uint8_t address, uint16_t data);
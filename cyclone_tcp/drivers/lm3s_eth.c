@@ -69,7 +69,11 @@ const NicDriver lm3sEthDriver =
    NULL,
    TRUE,
    TRUE,
-   TRUE
+   TRUE,
+   FALSE,
+   FALSE,
+   FALSE,
+   ETH_MTU
 };
 
 
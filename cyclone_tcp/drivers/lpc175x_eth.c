@@ -66,7 +66,11 @@ const NicDriver lpc175xEthDriver =
    lpc175xEthReadPhyReg,
    TRUE,
    TRUE,
-   TRUE
+   TRUE,
+   FALSE,
+   FALSE,
+   FALSE,
+   ETH_MTU
 };
 
 
@@ -122,7 +126,7 @@ error_t lpc175xEthInit(NetInterface *interface)
    LPC_EMAC->Command = COMMAND_RMII;
 
    //PHY transceiver initialization
-   error = interface->phyDriver->init(interface);
+   error = phyDriverInit(interface);
    //Failed to initialize PHY transceiver?
    if(error) return error;
 
@@ -230,7 +234,7 @@ void lpc175xEthInitDesc(NetInterface *interface)
 void lpc175xEthTick(NetInterface *interface)
 {
    //Handle periodic operations
-   interface->phyDriver->tick(interface);
+   phyDriverTick(interface);
 }
 
 
@@ -244,7 +248,7 @@ void lpc175xEthEnableIrq(NetInterface *interface)
    //Enable Ethernet MAC interrupts
    NVIC_EnableIRQ(ENET_IRQn);
    //Enable Ethernet PHY interrupts
-   interface->phyDriver->enableIrq(interface);
+   phyDriverEnableIrq(interface);
 }
 
 
@@ -258,7 +262,7 @@ void lpc175xEthDisableIrq(NetInterface *interface)
    //Disable Ethernet MAC interrupts
    NVIC_DisableIRQ(ENET_IRQn);
    //Disable Ethernet PHY interrupts
-   interface->phyDriver->disableIrq(interface);
+   phyDriverDisableIrq(interface);
 }
 
 
@@ -332,7 +336,7 @@ void lpc175xEthRxEventHandler(NetInterface *interface)
       //Acknowledge the event by clearing the flag
       interface->phyEvent = FALSE;
       //Handle PHY specific events
-      linkStateChange = interface->phyDriver->eventHandler(interface);
+      linkStateChange = phyDriverEventHandler(interface);
 
       //Check whether the link state has changed?
       if(linkStateChange)
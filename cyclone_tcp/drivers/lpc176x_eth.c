@@ -66,7 +66,11 @@ const NicDriver lpc176xEthDriver =
    lpc176xEthReadPhyReg,
    TRUE,
    TRUE,
-   TRUE
+   TRUE,
+   FALSE,
+   FALSE,
+   FALSE,
+   ETH_MTU
 };
 
 
@@ -123,7 +127,7 @@ error_t lpc176xEthInit(NetInterface *interface)
    LPC_EMAC->MCFG &= ~MCFG_RESET_MII_MGMT;
 
    //PHY transceiver initialization
-   error = interface->phyDriver->init(interface);
+   error = phyDriverInit(interface);
    //Failed to initialize PHY transceiver?
    if(error) return error;
 
@@ -231,7 +235,7 @@ void lpc176xEthInitDesc(NetInterface *interface)
 void lpc176xEthTick(NetInterface *interface)
 {
    //Handle periodic operations
-   interface->phyDriver->tick(interface);
+   phyDriverTick(interface);
 }
 
 
@@ -245,7 +249,7 @@ void lpc176xEthEnableIrq(NetInterface *interface)
    //Enable Ethernet MAC interrupts
    NVIC_EnableIRQ(ENET_IRQn);
    //Enable Ethernet PHY interrupts
-   interface->phyDriver->enableIrq(interface);
+   phyDriverEnableIrq(interface);
 }
 
 
@@ -259,7 +263,7 @@ void lpc176xEthDisableIrq(NetInterface *interface)
    //Disable Ethernet MAC interrupts
    NVIC_DisableIRQ(ENET_IRQn);
    //Disable Ethernet PHY interrupts
-   interface->phyDriver->disableIrq(interface);
+   phyDriverDisableIrq(interface);
 }
 
 
@@ -333,7 +337,7 @@ void lpc176xEthRxEventHandler(NetInterface *interface)
       //Acknowledge the event by clearing the flag
       interface->phyEvent = FALSE;
       //Handle PHY specific events
-      linkStateChange = interface->phyDriver->eventHandler(interface);
+      linkStateChange = phyDriverEventHandler(interface);
 
       //Check whether the link state has changed?
       if(linkStateChange)
@@ -66,7 +66,11 @@ const NicDriver lpc18xxEthDriver =
    lpc18xxEthReadPhyReg,
    TRUE,
    TRUE,
-   TRUE
+   TRUE,
+   FALSE,
+   FALSE,
+   TRUE,
+   ETH_MTU
 };
 
 
@@ -140,7 +144,7 @@ error_t lpc18xxEthInit(NetInterface *interface)
    LPC_ETHERNET->MAC_MII_ADDR = ETHERNET_MAC_MII_ADDR_CR_DIV62;
 
    //PHY transceiver initialization
-   error = interface->phyDriver->init(interface);
+   error = phyDriverInit(interface);
    //Failed to initialize PHY transceiver?
    if(error) return error;
 
@@ -274,7 +278,7 @@ void lpc18xxEthInitDmaDesc(NetInterface *interface)
 void lpc18xxEthTick(NetInterface *interface)
 {
    //Handle periodic operations
-   interface->phyDriver->tick(interface);
+   phyDriverTick(interface);
 }
 
 
@@ -288,7 +292,7 @@ void lpc18xxEthEnableIrq(NetInterface *interface)
    //Enable Ethernet MAC interrupts
    NVIC_EnableIRQ(ETHERNET_IRQn);
    //Enable Ethernet PHY interrupts
-   interface->phyDriver->enableIrq(interface);
+   phyDriverEnableIrq(interface);
 }
 
 
@@ -302,7 +306,7 @@ void lpc18xxEthDisableIrq(NetInterface *interface)
    //Disable Ethernet MAC interrupts
    NVIC_DisableIRQ(ETHERNET_IRQn);
    //Disable Ethernet PHY interrupts
-   interface->phyDriver->disableIrq(interface);
+   phyDriverDisableIrq(interface);
 }
 
 
@@ -363,7 +367,8 @@ void ETH_IRQHandler(void)
 
 void lpc18xxEthRxEventHandler(NetInterface *interface)
 {
-   size_t length;
+   uint_t n;
+   error_t error;
    bool_t linkStateChange;
 
    //PHY event is pending?
@@ -372,7 +377,7 @@ void lpc18xxEthRxEventHandler(NetInterface *interface)
       //Acknowledge the event by clearing the flag
       interface->phyEvent = FALSE;
       //Handle PHY specific events
-      linkStateChange = interface->phyDriver->eventHandler(interface);
+      linkStateChange = phyDriverEventHandler(interface);
 
       //Check whether the link state has changed?
       if(linkStateChange)
@@ -409,23 +414,33 @@ void lpc18xxEthRxEventHandler(NetInterface *interface)
    {
       //Clear interrupt flag
       LPC_ETHERNET->DMA_STAT = ETHERNET_DMA_STAT_RI_Msk;
+   }
 
-      //Process all the pending packets
-      while(1)
-      {
-         //Check whether a packet has been received
-         length = lpc18xxEthReceivePacket(interface, interface->ethFrame, ETH_MAX_FRAME_SIZE);
-         //No packet is pending in the receive buffer?
-         if(!length) break;
+   //Process the pending packets, within the limits of the RX budget
+   n = 0;
+   do
+   {
+      //Read incoming packet
+      error = lpc18xxEthReceivePacket(interface);
+      //No more data in the receive buffer?
+   } while(error != ERROR_BUFFER_EMPTY && ++n < NIC_RX_BUDGET);
 
-         //Pass the packet to the upper layer
-         nicProcessPacket(interface, interface->ethFrame, length);
-      }
+   //The budget is exhausted while packets are still pending?
+   if(error != ERROR_BUFFER_EMPTY)
+   {
+      //Keep the RX interrupt masked and poll the receive ring again later,
+      //so that the device can be accessed by other tasks meanwhile
+      osEventSet(interface->nicRxEvent);
+      //Re-enable DMA interrupts, except the RX interrupt
+      LPC_ETHERNET->DMA_INT_EN |= ETHERNET_DMA_INT_EN_NIE_Msk |
+         ETHERNET_DMA_INT_EN_TIE_Msk;
+   }
+   else
+   {
+      //Re-enable DMA interrupts
+      LPC_ETHERNET->DMA_INT_EN |= ETHERNET_DMA_INT_EN_NIE_Msk |
+         ETHERNET_DMA_INT_EN_RIE_Msk | ETHERNET_DMA_INT_EN_TIE_Msk;
    }
-
-   //Re-enable DMA interrupts
-   LPC_ETHERNET->DMA_INT_EN |= ETHERNET_DMA_INT_EN_NIE_Msk |
-      ETHERNET_DMA_INT_EN_RIE_Msk | ETHERNET_DMA_INT_EN_TIE_Msk;
 }
 
 
@@ -537,17 +552,19 @@ error_t lpc18xxEthSendPacket(NetInterface *interface,
 
 /**
  * @brief Receive a packet
+ *
+ * The frame is processed in place, directly from the receive buffer
+ * of the current DMA descriptor. The ownership of the descriptor is
+ * given back to the DMA once the upper layers are done with it
+ *
  * @param[in] interface Underlying network interface
- * @param[out] buffer Buffer where to store the incoming data
- * @param[in] size Maximum number of bytes that can be received
- * @return Number of bytes that have been received
+ * @return Error code
  **/
 
-size_t lpc18xxEthReceivePacket(NetInterface *interface,
-   uint8_t *buffer, size_t size)
+error_t lpc18xxEthReceivePacket(NetInterface *interface)
 {
-   //Total number of bytes received
-   uint_t length = 0;
+   error_t error;
+   size_t length;
 
    //The current buffer is available for reading?
    if(!(rxCurDmaDesc->rdes0 & ETH_RDES0_OWN))
@@ -561,10 +578,23 @@ size_t lpc18xxEthReceivePacket(NetInterface *interface,
             //Retrieve the length of the frame
             length = (rxCurDmaDesc->rdes0 & ETH_RDES0_FL) >> 16;
             //Limit the number of data to read
-            length = min(length, size);
-            //Copy data from the receive buffer
-            memcpy(buffer, (uint8_t *) rxCurDmaDesc->rdes2, length);
+            length = min(length, ETH_MAX_FRAME_SIZE);
+
+            //Pass the packet to the upper layer without copying it
+            nicProcessPacket(interface, (uint8_t *) rxCurDmaDesc->rdes2, length);
+            //Valid packet received
+            error = NO_ERROR;
          }
+         else
+         {
+            //The received packet contains an error
+            error = ERROR_INVALID_PACKET;
+         }
+      }
+      else
+      {
+         //The packet is not valid
+         error = ERROR_INVALID_PACKET;
       }
 
       //Give the ownership of the descriptor back to the DMA
@@ -572,6 +602,11 @@ size_t lpc18xxEthReceivePacket(NetInterface *interface,
       //Point to the next descriptor in the list
       rxCurDmaDesc = (Lpc18xxRxDmaDesc *) rxCurDmaDesc->rdes3;
    }
+   else
+   {
+      //No more data in the receive buffer
+      error = ERROR_BUFFER_EMPTY;
+   }
 
    //Reception process is suspended?
    if(LPC_ETHERNET->DMA_STAT & ETHERNET_DMA_STAT_RU_Msk)
@@ -582,8 +617,8 @@ size_t lpc18xxEthReceivePacket(NetInterface *interface,
       LPC_ETHERNET->DMA_REC_POLL_DEMAND = 0;
    }
 
-   //Return the number of bytes that have been received
-   return length;
+   //Return status code
+   return error;
 }
 
 
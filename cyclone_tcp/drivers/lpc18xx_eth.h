@@ -205,8 +205,7 @@ error_t lpc18xxEthSetMacFilter(NetInterface *interface);
 error_t lpc18xxEthSendPacket(NetInterface *interface,
    const ChunkedBuffer *buffer, size_t offset);
 
-size_t lpc18xxEthReceivePacket(NetInterface *interface,
-   uint8_t *buffer, size_t size);
+error_t lpc18xxEthReceivePacket(NetInterface *interface);
 
 void lpc18xxEthWritePhyReg(uint8_t phyAddr, uint8_t regAddr, uint16_t data);
 uint16_t lpc18xxEthReadPhyReg(uint8_t phyAddr, uint8_t regAddr);
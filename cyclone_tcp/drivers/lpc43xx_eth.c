@@ -66,7 +66,11 @@ const NicDriver lpc43xxEthDriver =
    lpc43xxEthReadPhyReg,
    TRUE,
    TRUE,
-   TRUE
+   TRUE,
+   FALSE,
+   FALSE,
+   TRUE,
+   ETH_MTU
 };
 
 
@@ -140,7 +144,7 @@ error_t lpc43xxEthInit(NetInterface *interface)
    LPC_ETHERNET->MAC_MII_ADDR = ETHERNET_MAC_MII_ADDR_CR_DIV62;
 
    //PHY transceiver initialization
-   error = interface->phyDriver->init(interface);
+   error = phyDriverInit(interface);
    //Failed to initialize PHY transceiver?
    if(error) return error;
 
@@ -170,6 +174,19 @@ error_t lpc43xxEthInit(NetInterface *interface)
    //Initialize DMA descriptor lists
    lpc43xxEthInitDmaDesc(interface);
 
+#if (LPC43XX_ETH_M0_OFFLOAD == ENABLED)
+   //No frame has been posted by the M0 core yet
+   LPC43XX_ETH_IPC->rxHead = 0;
+   LPC43XX_ETH_IPC->rxTail = 0;
+   LPC43XX_ETH_IPC->rxStalled = FALSE;
+   LPC43XX_ETH_IPC->rxDropped = 0;
+
+   //Make sure the indexes are up to date before the M0 core starts
+   __DMB();
+   //The M0 core can now take over the reception of frames
+   LPC43XX_ETH_IPC->rxDmaDesc = rxDmaDesc;
+#endif
+
    //Disable MAC interrupts
    LPC_ETHERNET->MAC_INTR_MASK = 0;
    //Configure DMA interrupts as desired
@@ -178,8 +195,15 @@ error_t lpc43xxEthInit(NetInterface *interface)
 
    //Set priority grouping (2 bits for pre-emption priority, 2 bits for subpriority)
    NVIC_SetPriorityGrouping(5);
+
+#if (LPC43XX_ETH_M0_OFFLOAD == ENABLED)
+   //The Ethernet interrupt is serviced by the M0 core, which in turn
+   //signals the M4 core through the inter-core interrupt
+   NVIC_SetPriority(M0CORE_IRQn, NVIC_EncodePriority(5, 2, 0));
+#else
    //Configure Ethernet interrupt priority
    NVIC_SetPriority(ETHERNET_IRQn, NVIC_EncodePriority(5, 2, 0));
+#endif
 
    //Enable MAC transmission and reception
    LPC_ETHERNET->MAC_CONFIG |= ETHERNET_MAC_CONFIG_TE_Msk | ETHERNET_MAC_CONFIG_RE_Msk;
@@ -274,7 +298,7 @@ void lpc43xxEthInitDmaDesc(NetInterface *interface)
 void lpc43xxEthTick(NetInterface *interface)
 {
    //Handle periodic operations
-   interface->phyDriver->tick(interface);
+   phyDriverTick(interface);
 }
 
 
@@ -285,10 +309,15 @@ void lpc43xxEthTick(NetInterface *interface)
 
 void lpc43xxEthEnableIrq(NetInterface *interface)
 {
+#if (LPC43XX_ETH_M0_OFFLOAD == ENABLED)
+   //Enable the interrupt raised by the M0 core
+   NVIC_EnableIRQ(M0CORE_IRQn);
+#else
    //Enable Ethernet MAC interrupts
    NVIC_EnableIRQ(ETHERNET_IRQn);
+#endif
    //Enable Ethernet PHY interrupts
-   interface->phyDriver->enableIrq(interface);
+   phyDriverEnableIrq(interface);
 }
 
 
@@ -299,10 +328,15 @@ void lpc43xxEthEnableIrq(NetInterface *interface)
 
 void lpc43xxEthDisableIrq(NetInterface *interface)
 {
+#if (LPC43XX_ETH_M0_OFFLOAD == ENABLED)
+   //Disable the interrupt raised by the M0 core
+   NVIC_DisableIRQ(M0CORE_IRQn);
+#else
    //Disable Ethernet MAC interrupts
    NVIC_DisableIRQ(ETHERNET_IRQn);
+#endif
    //Disable Ethernet PHY interrupts
-   interface->phyDriver->disableIrq(interface);
+   phyDriverDisableIrq(interface);
 }
 
 
@@ -356,6 +390,52 @@ void ETH_IRQHandler(void)
 }
 
 
+#if (LPC43XX_ETH_M0_OFFLOAD == ENABLED)
+
+/**
+ * @brief Inter-core interrupt service routine (M0 to M4)
+ *
+ * The M0 core raises this interrupt when frames have been posted
+ * or when a frame has been transmitted
+ *
+ **/
+
+void M0CORE_IRQHandler(void)
+{
+   //Point to the structure describing the network interface
+   NetInterface *interface = &netInterface[0];
+
+   //This flag will be set if a higher priority task must be woken
+   bool_t flag = FALSE;
+
+   //Clear the event sent by the M0 core
+   LPC_CREG->M0TXEVENT = 0;
+
+   //Check whether the TX buffer is available for writing
+   if(!(txCurDmaDesc->tdes0 & ETH_TDES0_OWN))
+   {
+      //Notify the user that the transmitter is ready to send
+      flag |= osEventSetFromIrq(interface->nicTxEvent);
+   }
+
+   //Frames have been posted by the M0 core?
+   if(LPC43XX_ETH_IPC->rxHead != LPC43XX_ETH_IPC->rxTail)
+   {
+      //Notify the user that a packet has been received
+      flag |= osEventSetFromIrq(interface->nicRxEvent);
+   }
+
+   //The unblocked task has a priority higher than the currently running task?
+   if(flag)
+   {
+      //Force a context switch
+      osTaskSwitchFromIrq();
+   }
+}
+
+#endif
+
+
 /**
  * @brief LPC43xx Ethernet MAC event handler
  * @param[in] interface Underlying network interface
@@ -363,7 +443,8 @@ void ETH_IRQHandler(void)
 
 void lpc43xxEthRxEventHandler(NetInterface *interface)
 {
-   size_t length;
+   uint_t n;
+   error_t error;
    bool_t linkStateChange;
 
    //PHY event is pending?
@@ -372,7 +453,7 @@ void lpc43xxEthRxEventHandler(NetInterface *interface)
       //Acknowledge the event by clearing the flag
       interface->phyEvent = FALSE;
       //Handle PHY specific events
-      linkStateChange = interface->phyDriver->eventHandler(interface);
+      linkStateChange = phyDriverEventHandler(interface);
 
       //Check whether the link state has changed?
       if(linkStateChange)
@@ -404,28 +485,50 @@ void lpc43xxEthRxEventHandler(NetInterface *interface)
       }
    }
 
+#if (LPC43XX_ETH_M0_OFFLOAD == DISABLED)
    //Packet received?
    if(LPC_ETHERNET->DMA_STAT & ETHERNET_DMA_STAT_RI_Msk)
    {
       //Clear interrupt flag
       LPC_ETHERNET->DMA_STAT = ETHERNET_DMA_STAT_RI_Msk;
-
-      //Process all the pending packets
-      while(1)
-      {
-         //Check whether a packet has been received
-         length = lpc43xxEthReceivePacket(interface, interface->ethFrame, ETH_MAX_FRAME_SIZE);
-         //No packet is pending in the receive buffer?
-         if(!length) break;
-
-         //Pass the packet to the upper layer
-         nicProcessPacket(interface, interface->ethFrame, length);
-      }
    }
+#endif
 
-   //Re-enable DMA interrupts
-   LPC_ETHERNET->DMA_INT_EN |= ETHERNET_DMA_INT_EN_NIE_Msk |
-      ETHERNET_DMA_INT_EN_RIE_Msk | ETHERNET_DMA_INT_EN_TIE_Msk;
+   //Process the pending packets, within the limits of the RX budget
+   n = 0;
+   do
+   {
+      //Read incoming packet
+      error = lpc43xxEthReceivePacket(interface);
+      //No more data in the receive buffer?
+   } while(error != ERROR_BUFFER_EMPTY && ++n < NIC_RX_BUDGET);
+
+#if (LPC43XX_ETH_M0_OFFLOAD == ENABLED)
+   //The budget is exhausted while packets are still pending?
+   if(error != ERROR_BUFFER_EMPTY)
+   {
+      //Poll the shared ring again later, so that the device can be
+      //accessed by other tasks meanwhile
+      osEventSet(interface->nicRxEvent);
+   }
+#else
+   //The budget is exhausted while packets are still pending?
+   if(error != ERROR_BUFFER_EMPTY)
+   {
+      //Keep the RX interrupt masked and poll the receive ring again later,
+      //so that the device can be accessed by other tasks meanwhile
+      osEventSet(interface->nicRxEvent);
+      //Re-enable DMA interrupts, except the RX interrupt
+      LPC_ETHERNET->DMA_INT_EN |= ETHERNET_DMA_INT_EN_NIE_Msk |
+         ETHERNET_DMA_INT_EN_TIE_Msk;
+   }
+   else
+   {
+      //Re-enable DMA interrupts
+      LPC_ETHERNET->DMA_INT_EN |= ETHERNET_DMA_INT_EN_NIE_Msk |
+         ETHERNET_DMA_INT_EN_RIE_Msk | ETHERNET_DMA_INT_EN_TIE_Msk;
+   }
+#endif
 }
 
 
@@ -537,18 +640,79 @@ error_t lpc43xxEthSendPacket(NetInterface *interface,
 
 /**
  * @brief Receive a packet
+ *
+ * The frame is processed in place, directly from the receive buffer
+ * of the current DMA descriptor. The ownership of the descriptor is
+ * given back to the DMA once the upper layers are done with it
+ *
  * @param[in] interface Underlying network interface
- * @param[out] buffer Buffer where to store the incoming data
- * @param[in] size Maximum number of bytes that can be received
- * @return Number of bytes that have been received
+ * @return Error code
  **/
 
-size_t lpc43xxEthReceivePacket(NetInterface *interface,
-   uint8_t *buffer, size_t size)
+error_t lpc43xxEthReceivePacket(NetInterface *interface)
 {
-   //Total number of bytes received
-   uint_t length = 0;
+   error_t error;
+   size_t length;
+
+#if (LPC43XX_ETH_M0_OFFLOAD == ENABLED)
+   uint_t i;
+
+   //Point to the shared memory area
+   Lpc43xxEthIpc *ipc = LPC43XX_ETH_IPC;
+
+   //A frame has been posted by the M0 core?
+   if(ipc->rxTail != ipc->rxHead)
+   {
+      //Read the slot only once the index has been observed
+      __DMB();
+      //Index of the slot
+      i = ipc->rxTail % LPC43XX_RX_BUFFER_COUNT;
+      //Retrieve the length of the frame
+      length = ipc->rxLength[i];
+
+      //Frames containing errors are flagged by a zero length
+      if(length > 0)
+      {
+         //Limit the number of data to read
+         length = min(length, ETH_MAX_FRAME_SIZE);
+         //Frames with a wrong checksum have already been dropped by the M0 core
+         interface->nicRxChecksumFlags = ipc->rxChecksumFlags[i];
+
+         //Pass the packet to the upper layer without copying it
+         nicProcessPacket(interface, (uint8_t *) rxCurDmaDesc->rdes2, length);
+         //Valid packet received
+         error = NO_ERROR;
+      }
+      else
+      {
+         //The received packet contains an error
+         error = ERROR_INVALID_PACKET;
+      }
+
+      //Give the ownership of the descriptor back to the DMA
+      rxCurDmaDesc->rdes0 = ETH_RDES0_OWN;
+      //Point to the next descriptor in the list
+      rxCurDmaDesc = (Lpc43xxRxDmaDesc *) rxCurDmaDesc->rdes3;
+
+      //The descriptor must be released before the slot
+      __DMB();
+      //Release the slot
+      ipc->rxTail = LPC43XX_ETH_IPC_NEXT(ipc->rxTail);
 
+      //The M0 core is waiting for a free slot?
+      if(ipc->rxStalled)
+      {
+         //Wake up the M0 core
+         __DSB();
+         __SEV();
+      }
+   }
+   else
+   {
+      //No more data in the receive buffer
+      error = ERROR_BUFFER_EMPTY;
+   }
+#else
    //The current buffer is available for reading?
    if(!(rxCurDmaDesc->rdes0 & ETH_RDES0_OWN))
    {
@@ -561,17 +725,36 @@ size_t lpc43xxEthReceivePacket(NetInterface *interface,
             //Retrieve the length of the frame
             length = (rxCurDmaDesc->rdes0 & ETH_RDES0_FL) >> 16;
             //Limit the number of data to read
-            length = min(length, size);
-            //Copy data from the receive buffer
-            memcpy(buffer, (uint8_t *) rxCurDmaDesc->rdes2, length);
+            length = min(length, ETH_MAX_FRAME_SIZE);
+
+            //Pass the packet to the upper layer without copying it
+            nicProcessPacket(interface, (uint8_t *) rxCurDmaDesc->rdes2, length);
+            //Valid packet received
+            error = NO_ERROR;
+         }
+         else
+         {
+            //The received packet contains an error
+            error = ERROR_INVALID_PACKET;
          }
       }
+      else
+      {
+         //The packet is not valid
+         error = ERROR_INVALID_PACKET;
+      }
 
       //Give the ownership of the descriptor back to the DMA
       rxCurDmaDesc->rdes0 = ETH_RDES0_OWN;
       //Point to the next descriptor in the list
       rxCurDmaDesc = (Lpc43xxRxDmaDesc *) rxCurDmaDesc->rdes3;
    }
+   else
+   {
+      //No more data in the receive buffer
+      error = ERROR_BUFFER_EMPTY;
+   }
+#endif
 
    //Reception process is suspended?
    if(LPC_ETHERNET->DMA_STAT & ETHERNET_DMA_STAT_RU_Msk)
@@ -582,8 +765,8 @@ size_t lpc43xxEthReceivePacket(NetInterface *interface,
       LPC_ETHERNET->DMA_REC_POLL_DEMAND = 0;
    }
 
-   //Return the number of bytes that have been received
-   return length;
+   //Return status code
+   return error;
 }
 
 
@@ -39,6 +39,23 @@
 #define LPC43XX_RX_BUFFER_COUNT 6
 #define LPC43XX_RX_BUFFER_SIZE 1536
 
+//Reception handled by the Cortex-M0 co-processor
+#ifndef LPC43XX_ETH_M0_OFFLOAD
+   #define LPC43XX_ETH_M0_OFFLOAD DISABLED
+#elif (LPC43XX_ETH_M0_OFFLOAD != ENABLED && LPC43XX_ETH_M0_OFFLOAD != DISABLED)
+   #error LPC43XX_ETH_M0_OFFLOAD parameter is not valid
+#endif
+
+//Address of the memory area shared by both cores
+#ifndef LPC43XX_ETH_IPC_ADDR
+   #define LPC43XX_ETH_IPC_ADDR 0x2000FF00
+#endif
+
+//Shared memory area
+#define LPC43XX_ETH_IPC ((Lpc43xxEthIpc *) LPC43XX_ETH_IPC_ADDR)
+//Index of the RX slot that follows the specified one (range 0 to 2N-1)
+#define LPC43XX_ETH_IPC_NEXT(index) (((index) + 1) % (2 * LPC43XX_RX_BUFFER_COUNT))
+
 //CREG6 register
 #define CREG6_ETHMODE_MII  (0 << CREG_CREG6_ETHMODE_Pos)
 #define CREG6_ETHMODE_RMII (4 << CREG_CREG6_ETHMODE_Pos)
@@ -187,6 +204,28 @@ typedef struct
 } Lpc43xxRxDmaDesc;
 
 
+/**
+ * @brief Memory area shared by the Cortex-M4 and Cortex-M0 cores
+ *
+ * The M0 core posts the frames it has validated and the M4 core releases
+ * them once processed. Each index is written by a single core, so that
+ * no lock is needed. Both indexes run from 0 to 2N-1 in order to tell
+ * a full ring from an empty one
+ *
+ **/
+
+typedef struct
+{
+   Lpc43xxRxDmaDesc *volatile rxDmaDesc;                      ///<RX descriptor list (NULL until the M4 core is ready)
+   volatile uint32_t rxHead;                                  ///<Next slot to be posted (written by the M0 core)
+   volatile uint32_t rxTail;                                  ///<Next slot to be released (written by the M4 core)
+   volatile uint32_t rxStalled;                               ///<The M0 core waits for a slot to be released
+   volatile uint32_t rxDropped;                               ///<Number of frames discarded by the M0 core
+   volatile uint16_t rxLength[LPC43XX_RX_BUFFER_COUNT];       ///<Length of each frame (0 if the frame is not valid)
+   volatile uint8_t rxChecksumFlags[LPC43XX_RX_BUFFER_COUNT]; ///<Checksums verified by the M0 core
+} Lpc43xxEthIpc;
+
+
 //LPC43xx Ethernet MAC driver
 extern const NicDriver lpc43xxEthDriver;
 
@@ -205,12 +244,16 @@ error_t lpc43xxEthSetMacFilter(NetInterface *interface);
 error_t lpc43xxEthSendPacket(NetInterface *interface,
    const ChunkedBuffer *buffer, size_t offset);
 
-size_t lpc43xxEthReceivePacket(NetInterface *interface,
-   uint8_t *buffer, size_t size);
+error_t lpc43xxEthReceivePacket(NetInterface *interface);
 
 void lpc43xxEthWritePhyReg(uint8_t phyAddr, uint8_t regAddr, uint16_t data);
 uint16_t lpc43xxEthReadPhyReg(uint8_t phyAddr, uint8_t regAddr);
 
 uint32_t lpc43xxEthCalcCrc(const void *data, size_t length);
 
+//Cortex-M0 related functions
+void lpc43xxEthM0Init(void);
+void lpc43xxEthM0IrqHandler(void);
+void lpc43xxEthM0IpcIrqHandler(void);
+
 #endif
@@ -0,0 +1,346 @@
+/**
+ * @file lpc43xx_eth_m0.c
+ * @brief LPC4300 Ethernet MAC controller (Cortex-M0 co-processor side)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL NIC_TRACE_LEVEL
+
+//Dependencies
+#include "lpc43xx.h"
+#include "tcp_ip_stack.h"
+#include "lpc43xx_eth.h"
+#include "debug.h"
+
+//Check configuration (this file is part of the M0 firmware)
+#if (LPC43XX_ETH_M0_OFFLOAD == ENABLED && defined(CORE_M0))
+
+//Forward declaration of functions
+static bool_t lpc43xxEthM0ProcessRx(Lpc43xxEthIpc *ipc);
+static bool_t lpc43xxEthM0CheckFrame(const uint8_t *frame, size_t length, uint8_t *flags);
+static uint32_t lpc43xxEthM0Sum(const uint8_t *data, size_t length, uint32_t sum);
+
+
+/**
+ * @brief Initialize the M0 side of the Ethernet driver
+ *
+ * The M0 firmware must route the Ethernet interrupt to lpc43xxEthM0IrqHandler
+ * and the M4 core interrupt to lpc43xxEthM0IpcIrqHandler, then enable both
+ * of them once this function returns
+ *
+ **/
+
+void lpc43xxEthM0Init(void)
+{
+   //Clear any event previously sent by the M4 core
+   LPC_CREG->M4TXEVENT = 0;
+}
+
+
+/**
+ * @brief Ethernet interrupt service routine (M0 core)
+ **/
+
+void lpc43xxEthM0IrqHandler(void)
+{
+   bool_t notify;
+   uint32_t status;
+
+   //No event to report to the M4 core yet
+   notify = FALSE;
+
+   //Read DMA status register
+   status = LPC_ETHERNET->DMA_STAT;
+
+   //A packet has been transmitted?
+   if(status & ETHERNET_DMA_STAT_TI_Msk)
+   {
+      //Clear TI interrupt flag
+      LPC_ETHERNET->DMA_STAT = ETHERNET_DMA_STAT_TI_Msk;
+      //The M4 core may be waiting for a free TX buffer
+      notify = TRUE;
+   }
+   //A packet has been received?
+   if(status & ETHERNET_DMA_STAT_RI_Msk)
+   {
+      //Clear RI interrupt flag
+      LPC_ETHERNET->DMA_STAT = ETHERNET_DMA_STAT_RI_Msk;
+
+      //Validate the incoming frames and post them to the M4 core
+      if(lpc43xxEthM0ProcessRx(LPC43XX_ETH_IPC))
+         notify = TRUE;
+   }
+
+   //Clear NIS interrupt flag
+   LPC_ETHERNET->DMA_STAT = ETHERNET_DMA_STAT_NIS_Msk;
+
+   //Any event to report?
+   if(notify)
+   {
+      //Raise the inter-core interrupt on the M4 side
+      __DSB();
+      __SEV();
+   }
+}
+
+
+/**
+ * @brief Inter-core interrupt service routine (M4 to M0)
+ *
+ * The M4 core raises this interrupt when it releases a slot while
+ * the M0 core is waiting for one
+ *
+ **/
+
+void lpc43xxEthM0IpcIrqHandler(void)
+{
+   //Clear the event sent by the M4 core
+   LPC_CREG->M4TXEVENT = 0;
+
+   //Post the frames that could not be posted so far
+   if(lpc43xxEthM0ProcessRx(LPC43XX_ETH_IPC))
+   {
+      //Raise the inter-core interrupt on the M4 side
+      __DSB();
+      __SEV();
+   }
+}
+
+
+/**
+ * @brief Post the frames received by the DMA to the M4 core
+ * @param[in] ipc Pointer to the shared memory area
+ * @return TRUE if at least one frame has been posted
+ **/
+
+static bool_t lpc43xxEthM0ProcessRx(Lpc43xxEthIpc *ipc)
+{
+   uint_t i;
+   uint32_t head;
+   size_t length;
+   uint8_t flags;
+   bool_t posted;
+   Lpc43xxRxDmaDesc *desc;
+
+   //The M4 core has not initialized the descriptor list yet?
+   if(ipc->rxDmaDesc == NULL)
+      return FALSE;
+
+   //No frame posted yet
+   posted = FALSE;
+   //Next slot to be posted
+   head = ipc->rxHead;
+
+   //Process the pending frames
+   while(1)
+   {
+      //All the slots are in use?
+      if(head == (ipc->rxTail + LPC43XX_RX_BUFFER_COUNT) % (2 * LPC43XX_RX_BUFFER_COUNT))
+      {
+         //Ask the M4 core to send an event when a slot is released
+         ipc->rxStalled = TRUE;
+         __DMB();
+
+         //Make sure no slot has been released in the meantime
+         if(head == (ipc->rxTail + LPC43XX_RX_BUFFER_COUNT) % (2 * LPC43XX_RX_BUFFER_COUNT))
+            break;
+      }
+
+      //A slot is available
+      ipc->rxStalled = FALSE;
+
+      //Point to the corresponding descriptor
+      i = head % LPC43XX_RX_BUFFER_COUNT;
+      desc = &ipc->rxDmaDesc[i];
+
+      //The descriptor is still owned by the DMA?
+      if(desc->rdes0 & ETH_RDES0_OWN)
+         break;
+
+      //FS and LS flags should be set and no error should have occurred
+      if((desc->rdes0 & (ETH_RDES0_FS | ETH_RDES0_LS | ETH_RDES0_ES)) ==
+         (ETH_RDES0_FS | ETH_RDES0_LS))
+      {
+         //Retrieve the length of the frame
+         length = (desc->rdes0 & ETH_RDES0_FL) >> 16;
+         //Limit the number of data to read
+         length = min(length, ETH_MAX_FRAME_SIZE);
+
+         //Verify the checksums on behalf of the M4 core
+         if(!lpc43xxEthM0CheckFrame((uint8_t *) desc->rdes2, length, &flags))
+            length = 0;
+      }
+      else
+      {
+         //The received packet contains an error
+         length = 0;
+         flags = 0;
+      }
+
+      //Invalid frames are flagged by a zero length, so that the M4 core
+      //can give the descriptors back to the DMA in order
+      if(!length)
+         ipc->rxDropped++;
+
+      //Fill in the slot
+      ipc->rxLength[i] = length;
+      ipc->rxChecksumFlags[i] = flags;
+
+      //The slot must be filled before it is posted
+      __DMB();
+      //Post the frame
+      head = LPC43XX_ETH_IPC_NEXT(head);
+      ipc->rxHead = head;
+      posted = TRUE;
+   }
+
+   //Return TRUE if the M4 core has something to process
+   return posted;
+}
+
+
+/**
+ * @brief Verify the IPv4 checksums of an incoming frame
+ * @param[in] frame Pointer to the Ethernet frame
+ * @param[in] length Length of the frame
+ * @param[out] flags Checksums that have been verified
+ * @return FALSE if the frame contains a wrong checksum and must be dropped
+ **/
+
+static bool_t lpc43xxEthM0CheckFrame(const uint8_t *frame, size_t length, uint8_t *flags)
+{
+   uint32_t sum;
+   size_t headerLength;
+   size_t totalLength;
+   const uint8_t *p;
+
+   //No checksum verified yet
+   *flags = 0;
+
+   //Only untagged IPv4 frames are processed (the EtherType field
+   //immediately follows the destination and source addresses)
+   if(length < 34 || frame[12] != 0x08 || frame[13] != 0x00)
+      return TRUE;
+
+   //Point to the IPv4 header
+   p = frame + 14;
+   length -= 14;
+
+   //Check version and header length
+   headerLength = (p[0] & 0x0F) * 4;
+   if((p[0] >> 4) != 4 || headerLength < 20 || headerLength > length)
+      return TRUE;
+
+   //Retrieve the total length of the packet
+   totalLength = (p[2] << 8) | p[3];
+   //Malformed packets are left to the IPv4 layer
+   if(totalLength < headerLength || totalLength > length)
+      return TRUE;
+
+   //Verify the header checksum
+   sum = lpc43xxEthM0Sum(p, headerLength, 0);
+   //Fold the 32-bit sum to 16 bits
+   while(sum >> 16)
+      sum = (sum & 0xFFFF) + (sum >> 16);
+
+   //Wrong header checksum?
+   if(sum != 0xFFFF)
+      return FALSE;
+
+   //The header checksum is valid
+   *flags |= NIC_RX_CHECKSUM_IP;
+
+   //Fragments are verified once reassembled (MF flag and offset field)
+   if((p[6] & 0x3F) || p[7])
+      return TRUE;
+
+   //Check the protocol of the payload
+   if(p[9] == 6 || p[9] == 17)
+   {
+      //A zero UDP checksum means that no checksum was computed
+      if(p[9] == 17 && totalLength >= (headerLength + 8) &&
+         !p[headerLength + 6] && !p[headerLength + 7])
+      {
+         return TRUE;
+      }
+
+      //The TCP and UDP checksums cover a pseudo header
+      sum = lpc43xxEthM0Sum(p + 12, 8, 0);
+      sum += p[9];
+      sum += totalLength - headerLength;
+   }
+   else if(p[9] == 1)
+   {
+      //The ICMP checksum only covers the message
+      sum = 0;
+   }
+   else
+   {
+      //The checksum of other protocols is not verified
+      return TRUE;
+   }
+
+   //Add the contents of the message
+   sum = lpc43xxEthM0Sum(p + headerLength, totalLength - headerLength, sum);
+   //Fold the 32-bit sum to 16 bits
+   while(sum >> 16)
+      sum = (sum & 0xFFFF) + (sum >> 16);
+
+   //Wrong checksum?
+   if(sum != 0xFFFF)
+      return FALSE;
+
+   //The checksum of the payload is valid
+   *flags |= NIC_RX_CHECKSUM_PAYLOAD;
+
+   //The frame can be passed to the M4 core
+   return TRUE;
+}
+
+
+/**
+ * @brief Add data to a one's complement sum
+ * @param[in] data Pointer to the data
+ * @param[in] length Number of bytes to process
+ * @param[in] sum Current value of the sum
+ * @return Updated sum (not folded)
+ **/
+
+static uint32_t lpc43xxEthM0Sum(const uint8_t *data, size_t length, uint32_t sum)
+{
+   //Process the data 16 bits at a time, in network byte order
+   for(; length > 1; length -= 2, data += 2)
+      sum += (data[0] << 8) | data[1];
+
+   //Odd number of bytes?
+   if(length > 0)
+      sum += data[0] << 8;
+
+   //Return the updated sum
+   return sum;
+}
+
+#endif
@@ -67,7 +67,11 @@ const NicDriver pic32EthDriver =
    pic32EthReadPhyReg,
    TRUE,
    TRUE,
-   TRUE
+   TRUE,
+   FALSE,
+   FALSE,
+   FALSE,
+   ETH_MTU
 };
 
 
@@ -120,7 +124,7 @@ error_t pic32EthInit(NetInterface *interface)
    EMAC1MCFG = _EMAC1MCFG_CLKSEL_DIV40;
 
    //PHY transceiver initialization
-   error = interface->phyDriver->init(interface);
+   error = phyDriverInit(interface);
    //Failed to initialize PHY transceiver?
    if(error) return error;
 
@@ -250,7 +254,7 @@ void pic32EthInitBufferDesc(NetInterface *interface)
 void pic32EthTick(NetInterface *interface)
 {
    //Handle periodic operations
-   interface->phyDriver->tick(interface);
+   phyDriverTick(interface);
 }
 
 
@@ -264,7 +268,7 @@ void pic32EthEnableIrq(NetInterface *interface)
    //Enable Ethernet MAC interrupts
    IEC1SET = _IEC1_ETHIE_MASK;
    //Enable Ethernet PHY interrupts
-   interface->phyDriver->enableIrq(interface);
+   phyDriverEnableIrq(interface);
 }
 
 
@@ -278,7 +282,7 @@ void pic32EthDisableIrq(NetInterface *interface)
    //Disable Ethernet MAC interrupts
    IEC1CLR = _IEC1_ETHIE_MASK;
    //Disable Ethernet PHY interrupts
-   interface->phyDriver->disableIrq(interface);
+   phyDriverDisableIrq(interface);
 }
 
 
@@ -348,7 +352,7 @@ void pic32EthRxEventHandler(NetInterface *interface)
       //Acknowledge the event by clearing the flag
       interface->phyEvent = FALSE;
       //Handle PHY specific events
-      linkStateChange = interface->phyDriver->eventHandler(interface);
+      linkStateChange = phyDriverEventHandler(interface);
 
       //Check whether the link state has changed?
       if(linkStateChange)
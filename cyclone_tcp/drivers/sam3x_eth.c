@@ -67,7 +67,11 @@ const NicDriver sam3xEthDriver =
    sam3xEthReadPhyReg,
    TRUE,
    TRUE,
-   TRUE
+   TRUE,
+   FALSE,
+   FALSE,
+   FALSE,
+   ETH_MTU
 };
 
 
@@ -107,7 +111,7 @@ error_t sam3xEthInit(NetInterface *interface)
    EMAC->EMAC_NCR |= EMAC_NCR_MPE;
 
    //PHY transceiver initialization
-   error = interface->phyDriver->init(interface);
+   error = phyDriverInit(interface);
    //Failed to initialize PHY transceiver?
    if(error) return error;
 
@@ -220,7 +224,7 @@ void sam3xEthInitBufferDesc(NetInterface *interface)
 void sam3xEthTick(NetInterface *interface)
 {
    //Handle periodic operations
-   interface->phyDriver->tick(interface);
+   phyDriverTick(interface);
 }
 
 
@@ -234,7 +238,7 @@ void sam3xEthEnableIrq(NetInterface *interface)
    //Enable Ethernet MAC interrupts
    NVIC_EnableIRQ(EMAC_IRQn);
    //Enable Ethernet PHY interrupts
-   interface->phyDriver->enableIrq(interface);
+   phyDriverEnableIrq(interface);
 }
 
 
@@ -248,7 +252,7 @@ void sam3xEthDisableIrq(NetInterface *interface)
    //Disable Ethernet MAC interrupts
    NVIC_DisableIRQ(EMAC_IRQn);
    //Disable Ethernet PHY interrupts
-   interface->phyDriver->disableIrq(interface);
+   phyDriverDisableIrq(interface);
 }
 
 
@@ -320,7 +324,7 @@ void sam3xEthRxEventHandler(NetInterface *interface)
       //Acknowledge the event by clearing the flag
       interface->phyEvent = FALSE;
       //Handle PHY specific events
-      linkStateChange = interface->phyDriver->eventHandler(interface);
+      linkStateChange = phyDriverEventHandler(interface);
 
       //Check whether the link state has changed?
       if(linkStateChange)
@@ -67,7 +67,11 @@ const NicDriver sam4eEthDriver =
    sam4eEthReadPhyReg,
    TRUE,
    TRUE,
-   TRUE
+   TRUE,
+   FALSE,
+   FALSE,
+   TRUE,
+   ETH_MTU
 };
 
 
@@ -108,7 +112,7 @@ error_t sam4eEthInit(NetInterface *interface)
    GMAC->GMAC_NCR |= GMAC_NCR_MPE;
 
    //PHY transceiver initialization
-   error = interface->phyDriver->init(interface);
+   error = phyDriverInit(interface);
    //Failed to initialize PHY transceiver?
    if(error) return error;
 
@@ -221,7 +225,7 @@ void sam4eEthInitBufferDesc(NetInterface *interface)
 void sam4eEthTick(NetInterface *interface)
 {
    //Handle periodic operations
-   interface->phyDriver->tick(interface);
+   phyDriverTick(interface);
 }
 
 
@@ -235,7 +239,7 @@ void sam4eEthEnableIrq(NetInterface *interface)
    //Enable Ethernet MAC interrupts
    NVIC_EnableIRQ(GMAC_IRQn);
    //Enable Ethernet PHY interrupts
-   interface->phyDriver->enableIrq(interface);
+   phyDriverEnableIrq(interface);
 }
 
 
@@ -249,7 +253,7 @@ void sam4eEthDisableIrq(NetInterface *interface)
    //Disable Ethernet MAC interrupts
    NVIC_DisableIRQ(GMAC_IRQn);
    //Disable Ethernet PHY interrupts
-   interface->phyDriver->disableIrq(interface);
+   phyDriverDisableIrq(interface);
 }
 
 
@@ -321,7 +325,7 @@ void sam4eEthRxEventHandler(NetInterface *interface)
       //Acknowledge the event by clearing the flag
       interface->phyEvent = FALSE;
       //Handle PHY specific events
-      linkStateChange = interface->phyDriver->eventHandler(interface);
+      linkStateChange = phyDriverEventHandler(interface);
 
       //Check whether the link state has changed?
       if(linkStateChange)
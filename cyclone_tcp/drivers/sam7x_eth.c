@@ -67,7 +67,11 @@ const NicDriver sam7xEthDriver =
    sam7xEthReadPhyReg,
    TRUE,
    TRUE,
-   TRUE
+   TRUE,
+   FALSE,
+   FALSE,
+   FALSE,
+   ETH_MTU
 };
 
 
@@ -107,7 +111,7 @@ error_t sam7xEthInit(NetInterface *interface)
    AT91C_BASE_EMAC->EMAC_NCR |= AT91C_EMAC_MPE;
 
    //PHY transceiver initialization
-   error = interface->phyDriver->init(interface);
+   error = phyDriverInit(interface);
    //Failed to initialize PHY transceiver?
    if(error) return error;
 
@@ -221,7 +225,7 @@ void sam7xEthInitBufferDesc(NetInterface *interface)
 void sam7xEthTick(NetInterface *interface)
 {
    //Handle periodic operations
-   interface->phyDriver->tick(interface);
+   phyDriverTick(interface);
 }
 
 
@@ -235,7 +239,7 @@ void sam7xEthEnableIrq(NetInterface *interface)
    //Enable Ethernet MAC interrupts
    AT91C_BASE_AIC->AIC_IECR = (1 << AT91C_ID_EMAC);
    //Enable Ethernet PHY interrupts
-   interface->phyDriver->enableIrq(interface);
+   phyDriverEnableIrq(interface);
 }
 
 
@@ -249,7 +253,7 @@ void sam7xEthDisableIrq(NetInterface *interface)
    //Disable Ethernet MAC interrupts
    AT91C_BASE_AIC->AIC_IDCR = (1 << AT91C_ID_EMAC);
    //Disable Ethernet PHY interrupts
-   interface->phyDriver->disableIrq(interface);
+   phyDriverDisableIrq(interface);
 }
 
 
@@ -314,7 +318,7 @@ void sam7xEthRxEventHandler(NetInterface *interface)
       //Acknowledge the event by clearing the flag
       interface->phyEvent = FALSE;
       //Handle PHY specific events
-      linkStateChange = interface->phyDriver->eventHandler(interface);
+      linkStateChange = phyDriverEventHandler(interface);
 
       //Check whether the link state has changed?
       if(linkStateChange)
@@ -67,7 +67,11 @@ const NicDriver sam9263EthDriver =
    sam9263EthReadPhyReg,
    TRUE,
    TRUE,
-   TRUE
+   TRUE,
+   FALSE,
+   FALSE,
+   FALSE,
+   ETH_MTU
 };
 
 
@@ -111,7 +115,7 @@ error_t sam9263EthInit(NetInterface *interface)
    AT91C_BASE_EMAC->EMAC_NCR |= AT91C_EMAC_MPE;
 
    //PHY transceiver initialization
-   error = interface->phyDriver->init(interface);
+   error = phyDriverInit(interface);
    //Failed to initialize PHY transceiver?
    if(error) return error;
 
@@ -225,7 +229,7 @@ void sam9263EthInitBufferDesc(NetInterface *interface)
 void sam9263EthTick(NetInterface *interface)
 {
    //Handle periodic operations
-   interface->phyDriver->tick(interface);
+   phyDriverTick(interface);
 }
 
 
@@ -239,7 +243,7 @@ void sam9263EthEnableIrq(NetInterface *interface)
    //Enable Ethernet MAC interrupts
    AT91C_BASE_AIC->AIC_IECR = (1 << AT91C_ID_EMAC);
    //Enable Ethernet PHY interrupts
-   interface->phyDriver->enableIrq(interface);
+   phyDriverEnableIrq(interface);
 }
 
 
@@ -253,7 +257,7 @@ void sam9263EthDisableIrq(NetInterface *interface)
    //Disable Ethernet MAC interrupts
    AT91C_BASE_AIC->AIC_IDCR = (1 << AT91C_ID_EMAC);
    //Disable Ethernet PHY interrupts
-   interface->phyDriver->disableIrq(interface);
+   phyDriverDisableIrq(interface);
 }
 
 
@@ -318,7 +322,7 @@ void sam9263EthRxEventHandler(NetInterface *interface)
       //Acknowledge the event by clearing the flag
       interface->phyEvent = FALSE;
       //Handle PHY specific events
-      linkStateChange = interface->phyDriver->eventHandler(interface);
+      linkStateChange = phyDriverEventHandler(interface);
 
       //Check whether the link state has changed?
       if(linkStateChange)
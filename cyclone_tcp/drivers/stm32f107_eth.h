@@ -143,8 +143,7 @@ error_t stm32f107EthSetMacFilter(NetInterface *interface);
 error_t stm32f107EthSendPacket(NetInterface *interface,
    const ChunkedBuffer *buffer, size_t offset);
 
-size_t stm32f107EthReceivePacket(NetInterface *interface,
-   uint8_t *buffer, size_t size);
+error_t stm32f107EthReceivePacket(NetInterface *interface);
 
 void stm32f107EthWritePhyReg(uint8_t phyAddr, uint8_t regAddr, uint16_t data);
 uint16_t stm32f107EthReadPhyReg(uint8_t phyAddr, uint8_t regAddr);
@@ -68,7 +68,11 @@ const NicDriver stm32f2x7EthDriver =
    stm32f2x7EthReadPhyReg,
    TRUE,
    TRUE,
-   TRUE
+   TRUE,
+   FALSE,
+   FALSE,
+   TRUE,
+   ETH_MTU
 };
 
 
@@ -166,7 +170,7 @@ error_t stm32f2x7EthInit(NetInterface *interface)
    ETH->MACMIIAR = ETH_MACMIIAR_CR_Div62;
 
    //PHY transceiver initialization
-   error = interface->phyDriver->init(interface);
+   error = phyDriverInit(interface);
    //Failed to initialize PHY transceiver?
    if(error) return error;
 
@@ -298,7 +302,7 @@ void stm32f2x7EthInitDmaDesc(NetInterface *interface)
 void stm32f2x7EthTick(NetInterface *interface)
 {
    //Handle periodic operations
-   interface->phyDriver->tick(interface);
+   phyDriverTick(interface);
 }
 
 
@@ -312,7 +316,7 @@ void stm32f2x7EthEnableIrq(NetInterface *interface)
    //Enable Ethernet MAC interrupts
    NVIC_EnableIRQ(ETH_IRQn);
    //Enable Ethernet PHY interrupts
-   interface->phyDriver->enableIrq(interface);
+   phyDriverEnableIrq(interface);
 }
 
 
@@ -326,7 +330,7 @@ void stm32f2x7EthDisableIrq(NetInterface *interface)
    //Disable Ethernet MAC interrupts
    NVIC_DisableIRQ(ETH_IRQn);
    //Disable Ethernet PHY interrupts
-   interface->phyDriver->disableIrq(interface);
+   phyDriverDisableIrq(interface);
 }
 
 
@@ -387,7 +391,8 @@ void ETH_IRQHandler(void)
 
 void stm32f2x7EthRxEventHandler(NetInterface *interface)
 {
-   size_t length;
+   uint_t n;
+   error_t error;
    bool_t linkStateChange;
 
    //PHY event is pending?
@@ -396,7 +401,7 @@ void stm32f2x7EthRxEventHandler(NetInterface *interface)
       //Acknowledge the event by clearing the flag
       interface->phyEvent = FALSE;
       //Handle PHY specific events
-      linkStateChange = interface->phyDriver->eventHandler(interface);
+      linkStateChange = phyDriverEventHandler(interface);
 
       //Check whether the link state has changed?
       if(linkStateChange)
@@ -433,22 +438,31 @@ void stm32f2x7EthRxEventHandler(NetInterface *interface)
    {
       //Clear interrupt flag
       ETH->DMASR = ETH_DMASR_RS;
+   }
 
-      //Process all the pending packets
-      while(1)
-      {
-         //Check whether a packet has been received
-         length = stm32f2x7EthReceivePacket(interface, interface->ethFrame, ETH_MAX_FRAME_SIZE);
-         //No packet is pending in the receive buffer?
-         if(!length) break;
+   //Process the pending packets, within the limits of the RX budget
+   n = 0;
+   do
+   {
+      //Read incoming packet
+      error = stm32f2x7EthReceivePacket(interface);
+      //No more data in the receive buffer?
+   } while(error != ERROR_BUFFER_EMPTY && ++n < NIC_RX_BUDGET);
 
-         //Pass the packet to the upper layer
-         nicProcessPacket(interface, interface->ethFrame, length);
-      }
+   //The budget is exhausted while packets are still pending?
+   if(error != ERROR_BUFFER_EMPTY)
+   {
+      //Keep the RX interrupt masked and poll the receive ring again later,
+      //so that the device can be accessed by other tasks meanwhile
+      osEventSet(interface->nicRxEvent);
+      //Re-enable DMA interrupts, except the RX interrupt
+      ETH->DMAIER |= ETH_DMAIER_NISE | ETH_DMAIER_TIE;
+   }
+   else
+   {
+      //Re-enable DMA interrupts
+      ETH->DMAIER |= ETH_DMAIER_NISE | ETH_DMAIER_RIE | ETH_DMAIER_TIE;
    }
-
-   //Re-enable DMA interrupts
-   ETH->DMAIER |= ETH_DMAIER_NISE | ETH_DMAIER_RIE | ETH_DMAIER_TIE;
 }
 
 
@@ -560,17 +574,19 @@ error_t stm32f2x7EthSendPacket(NetInterface *interface,
 
 /**
  * @brief Receive a packet
+ *
+ * The frame is processed in place, directly from the receive buffer
+ * of the current DMA descriptor. The ownership of the descriptor is
+ * given back to the DMA once the upper layers are done with it
+ *
  * @param[in] interface Underlying network interface
- * @param[out] buffer Buffer where to store the incoming data
- * @param[in] size Maximum number of bytes that can be received
- * @return Number of bytes that have been received
+ * @return Error code
  **/
 
-size_t stm32f2x7EthReceivePacket(NetInterface *interface,
-   uint8_t *buffer, size_t size)
+error_t stm32f2x7EthReceivePacket(NetInterface *interface)
 {
-   //Total number of bytes received
-   uint_t length = 0;
+   error_t error;
+   size_t length;
 
    //The current buffer is available for reading?
    if(!(rxCurDmaDesc->rdes0 & ETH_RDES0_OWN))
@@ -584,10 +600,23 @@ size_t stm32f2x7EthReceivePacket(NetInterface *interface,
             //Retrieve the length of the frame
             length = (rxCurDmaDesc->rdes0 & ETH_RDES0_FL) >> 16;
             //Limit the number of data to read
-            length = min(length, size);
-            //Copy data from the receive buffer
-            memcpy(buffer, (uint8_t *) rxCurDmaDesc->rdes2, length);
+            length = min(length, ETH_MAX_FRAME_SIZE);
+
+            //Pass the packet to the upper layer without copying it
+            nicProcessPacket(interface, (uint8_t *) rxCurDmaDesc->rdes2, length);
+            //Valid packet received
+            error = NO_ERROR;
          }
+         else
+         {
+            //The received packet contains an error
+            error = ERROR_INVALID_PACKET;
+         }
+      }
+      else
+      {
+         //The packet is not valid
+         error = ERROR_INVALID_PACKET;
       }
 
       //Give the ownership of the descriptor back to the DMA
@@ -595,6 +624,11 @@ size_t stm32f2x7EthReceivePacket(NetInterface *interface,
       //Point to the next descriptor in the list
       rxCurDmaDesc = (Stm32f2x7RxDmaDesc *) rxCurDmaDesc->rdes3;
    }
+   else
+   {
+      //No more data in the receive buffer
+      error = ERROR_BUFFER_EMPTY;
+   }
 
    //Reception process is suspended?
    if(ETH->DMASR & ETH_DMASR_RBUS)
@@ -605,8 +639,8 @@ size_t stm32f2x7EthReceivePacket(NetInterface *interface,
       ETH->DMARPDR = 0;
    }
 
-   //Return the number of bytes that have been received
-   return length;
+   //Return status code
+   return error;
 }
 
 
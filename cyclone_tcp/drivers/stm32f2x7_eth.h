@@ -164,8 +164,7 @@ error_t stm32f2x7EthSetMacFilter(NetInterface *interface);
 error_t stm32f2x7EthSendPacket(NetInterface *interface,
    const ChunkedBuffer *buffer, size_t offset);
 
-size_t stm32f2x7EthReceivePacket(NetInterface *interface,
-   uint8_t *buffer, size_t size);
+error_t stm32f2x7EthReceivePacket(NetInterface *interface);
 
 void stm32f2x7EthWritePhyReg(uint8_t phyAddr, uint8_t regAddr, uint16_t data);
 uint16_t stm32f2x7EthReadPhyReg(uint8_t phyAddr, uint8_t regAddr);
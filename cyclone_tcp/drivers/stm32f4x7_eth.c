@@ -45,11 +45,24 @@ static uint8_t rxBuffer[STM32F4X7_RX_BUFFER_COUNT][STM32F4X7_RX_BUFFER_SIZE] __a
 static Stm32f4x7TxDmaDesc txDmaDesc[STM32F4X7_TX_BUFFER_COUNT] __attribute__((aligned(4)));
 //Receive DMA descriptors
 static Stm32f4x7RxDmaDesc rxDmaDesc[STM32F4X7_RX_BUFFER_COUNT] __attribute__((aligned(4)));
-//Pointer to the current TX DMA descriptor
-static Stm32f4x7TxDmaDesc *txCurDmaDesc;
+//TX descriptor ring
+static NicRing txRing;
 //Pointer to the current RX DMA descriptor
 static Stm32f4x7RxDmaDesc *rxCurDmaDesc;
 
+//Get the checksums verified by the hardware
+static uint_t stm32f4x7EthGetRxChecksumFlags(uint32_t status);
+//Check whether the DMA is done with a TX descriptor
+static bool_t stm32f4x7EthTxDescDone(uint_t index);
+
+#if (STM32F4X7_SCATTER_GATHER_SUPPORT == ENABLED)
+//Chunk blocks loaned to the DMA through the TX descriptors
+static ChunkBlock *txChunkBlock[STM32F4X7_TX_BUFFER_COUNT];
+
+//Scatter-gather related functions
+static bool_t stm32f4x7EthMapTxChunks(const ChunkedBuffer *buffer, size_t offset);
+#endif
+
 
 /**
  * @brief STM32F407/417/427/437 Ethernet MAC driver
@@ -68,7 +81,11 @@ const NicDriver stm32f4x7EthDriver =
    stm32f4x7EthReadPhyReg,
    TRUE,
    TRUE,
-   TRUE
+   TRUE,
+   TRUE,
+   TRUE,
+   TRUE,
+   STM32F4X7_MTU
 };
 
 
@@ -202,12 +219,18 @@ error_t stm32f4x7EthInit(NetInterface *interface)
    ETH->MACMIIAR = ETH_MACMIIAR_CR_Div102;
 
    //PHY transceiver initialization
-   error = interface->phyDriver->init(interface);
+   error = phyDriverInit(interface);
    //Failed to initialize PHY transceiver?
    if(error) return error;
 
    //Use default MAC configuration
-   ETH->MACCR = ETH_MACCR_ROD;
+   ETH->MACCR = ETH_MACCR_ROD | ETH_MACCR_IPCO;
+
+#if (STM32F4X7_MTU > 1500)
+   //Disable the watchdog and the jabber timer so that the MAC can
+   //receive and transmit jumbo frames
+   ETH->MACCR |= ETH_MACCR_WD | ETH_MACCR_JD;
+#endif
 
    //Set the MAC address
    ETH->MACA0LR = interface->macAddr.w[0] | (interface->macAddr.w[1] << 16);
@@ -270,7 +293,7 @@ void stm32f4x7EthInitDmaDesc(NetInterface *interface)
    for(i = 0; i < STM32F4X7_TX_BUFFER_COUNT; i++)
    {
       //Use chain structure rather than ring structure
-      txDmaDesc[i].tdes0 = ETH_TDES0_IC | ETH_TDES0_TCH;
+      txDmaDesc[i].tdes0 = ETH_TDES0_IC | ETH_TDES0_TCH | ETH_TDES0_CIC;
       //Initialize transmit buffer size
       txDmaDesc[i].tdes1 = 0;
       //Transmit buffer address
@@ -287,8 +310,13 @@ void stm32f4x7EthInitDmaDesc(NetInterface *interface)
 
    //The last descriptor is chained to the first entry
    txDmaDesc[i - 1].tdes3 = (uint32_t) &txDmaDesc[0];
-   //Point to the very first descriptor
-   txCurDmaDesc = &txDmaDesc[0];
+
+   //The driver walks the TX descriptors by index
+#if (STM32F4X7_SCATTER_GATHER_SUPPORT == ENABLED)
+   nicRingInit(&txRing, txChunkBlock, STM32F4X7_TX_BUFFER_COUNT);
+#else
+   nicRingInit(&txRing, NULL, STM32F4X7_TX_BUFFER_COUNT);
+#endif
 
    //Initialize RX DMA descriptor list
    for(i = 0; i < STM32F4X7_RX_BUFFER_COUNT; i++)
@@ -334,7 +362,7 @@ void stm32f4x7EthInitDmaDesc(NetInterface *interface)
 void stm32f4x7EthTick(NetInterface *interface)
 {
    //Handle periodic operations
-   interface->phyDriver->tick(interface);
+   phyDriverTick(interface);
 }
 
 
@@ -348,7 +376,7 @@ void stm32f4x7EthEnableIrq(NetInterface *interface)
    //Enable Ethernet MAC interrupts
    NVIC_EnableIRQ(ETH_IRQn);
    //Enable Ethernet PHY interrupts
-   interface->phyDriver->enableIrq(interface);
+   phyDriverEnableIrq(interface);
 }
 
 
@@ -362,7 +390,7 @@ void stm32f4x7EthDisableIrq(NetInterface *interface)
    //Disable Ethernet MAC interrupts
    NVIC_DisableIRQ(ETH_IRQn);
    //Disable Ethernet PHY interrupts
-   interface->phyDriver->disableIrq(interface);
+   phyDriverDisableIrq(interface);
 }
 
 
@@ -388,7 +416,7 @@ void ETH_IRQHandler(void)
       ETH->DMASR = ETH_DMASR_TS;
 
       //Check whether the TX buffer is available for writing
-      if(!(txCurDmaDesc->tdes0 & ETH_TDES0_OWN))
+      if(!(txDmaDesc[txRing.head].tdes0 & ETH_TDES0_OWN))
       {
          //Notify the user that the transmitter is ready to send
          flag |= osEventSetFromIrq(interface->nicTxEvent);
@@ -423,7 +451,8 @@ void ETH_IRQHandler(void)
 
 void stm32f4x7EthRxEventHandler(NetInterface *interface)
 {
-   size_t length;
+   uint_t n;
+   error_t error;
    bool_t linkStateChange;
 
    //PHY event is pending?
@@ -432,7 +461,7 @@ void stm32f4x7EthRxEventHandler(NetInterface *interface)
       //Acknowledge the event by clearing the flag
       interface->phyEvent = FALSE;
       //Handle PHY specific events
-      linkStateChange = interface->phyDriver->eventHandler(interface);
+      linkStateChange = phyDriverEventHandler(interface);
 
       //Check whether the link state has changed?
       if(linkStateChange)
@@ -469,22 +498,31 @@ void stm32f4x7EthRxEventHandler(NetInterface *interface)
    {
       //Clear interrupt flag
       ETH->DMASR = ETH_DMASR_RS;
+   }
 
-      //Process all the pending packets
-      while(1)
-      {
-         //Check whether a packet has been received
-         length = stm32f4x7EthReceivePacket(interface, interface->ethFrame, ETH_MAX_FRAME_SIZE);
-         //No packet is pending in the receive buffer?
-         if(!length) break;
+   //Process the pending packets, within the limits of the RX budget
+   n = 0;
+   do
+   {
+      //Read incoming packet
+      error = stm32f4x7EthReceivePacket(interface);
+      //No more data in the receive buffer?
+   } while(error != ERROR_BUFFER_EMPTY && ++n < NIC_RX_BUDGET);
 
-         //Pass the packet to the upper layer
-         nicProcessPacket(interface, interface->ethFrame, length);
-      }
+   //The budget is exhausted while packets are still pending?
+   if(error != ERROR_BUFFER_EMPTY)
+   {
+      //Keep the RX interrupt masked and poll the receive ring again later,
+      //so that the device can be accessed by other tasks meanwhile
+      osEventSet(interface->nicRxEvent);
+      //Re-enable DMA interrupts, except the RX interrupt
+      ETH->DMAIER |= ETH_DMAIER_NISE | ETH_DMAIER_TIE;
+   }
+   else
+   {
+      //Re-enable DMA interrupts
+      ETH->DMAIER |= ETH_DMAIER_NISE | ETH_DMAIER_RIE | ETH_DMAIER_TIE;
    }
-
-   //Re-enable DMA interrupts
-   ETH->DMAIER |= ETH_DMAIER_NISE | ETH_DMAIER_RIE | ETH_DMAIER_TIE;
 }
 
 
@@ -556,19 +594,36 @@ error_t stm32f4x7EthSendPacket(NetInterface *interface,
       return ERROR_INVALID_LENGTH;
    }
 
+   //Reclaim the descriptors of the frames that have already been sent
+   nicRingReclaim(&txRing, stm32f4x7EthTxDescDone);
+
    //Make sure the current buffer is available for writing
-   if(txCurDmaDesc->tdes0 & ETH_TDES0_OWN)
+   if(nicRingGetFreeCount(&txRing) == 0)
       return ERROR_FAILURE;
 
-   //Copy user data to the transmit buffer
-   chunkedBufferRead((uint8_t *) txCurDmaDesc->tdes2, buffer, offset, length);
+#if (STM32F4X7_SCATTER_GATHER_SUPPORT == ENABLED)
+   //Try to map each chunk of the frame to its own descriptor
+   if(!stm32f4x7EthMapTxChunks(buffer, offset))
+#endif
+   {
+      uint_t i;
+
+      //Claim the next descriptor
+      i = nicRingProduce(&txRing, NULL);
 
-   //Write the number of bytes to send
-   txCurDmaDesc->tdes1 = length & ETH_TDES1_TBS1;
-   //Set LS and FS flags as the data fits in a single buffer
-   txCurDmaDesc->tdes0 |= ETH_TDES0_LS | ETH_TDES0_FS;
-   //Give the ownership of the descriptor to the DMA
-   txCurDmaDesc->tdes0 |= ETH_TDES0_OWN;
+      //Copy user data to the transmit buffer
+      chunkedBufferRead(txBuffer[i], buffer, offset, length);
+
+      //The descriptor may previously have pointed to a chunk
+      txDmaDesc[i].tdes2 = (uint32_t) txBuffer[i];
+      //Write the number of bytes to send
+      txDmaDesc[i].tdes1 = length & ETH_TDES1_TBS1;
+      //Set LS and FS flags as the data fits in a single buffer
+      txDmaDesc[i].tdes0 = ETH_TDES0_IC | ETH_TDES0_TCH | ETH_TDES0_CIC |
+         ETH_TDES0_LS | ETH_TDES0_FS;
+      //Give the ownership of the descriptor to the DMA
+      txDmaDesc[i].tdes0 |= ETH_TDES0_OWN;
+   }
 
    //Transmission is currently suspended?
    if(ETH->DMASR & ETH_DMASR_TBUS)
@@ -579,11 +634,8 @@ error_t stm32f4x7EthSendPacket(NetInterface *interface,
       ETH->DMATPDR = 0;
    }
 
-   //Point to the next descriptor in the list
-   txCurDmaDesc = (Stm32f4x7TxDmaDesc *) txCurDmaDesc->tdes3;
-
    //Check whether the next buffer is available for writing
-   if(!(txCurDmaDesc->tdes0 & ETH_TDES0_OWN))
+   if(!(txDmaDesc[txRing.head].tdes0 & ETH_TDES0_OWN))
    {
       //The transmitter can accept another packet
       osEventSet(interface->nicTxEvent);
@@ -594,19 +646,154 @@ error_t stm32f4x7EthSendPacket(NetInterface *interface,
 }
 
 
+/**
+ * @brief Check whether the DMA is done with a TX descriptor
+ * @param[in] index Index of the descriptor
+ * @return TRUE if the descriptor can be reclaimed, else FALSE
+ **/
+
+static bool_t stm32f4x7EthTxDescDone(uint_t index)
+{
+   //The DMA clears the OWN bit once the buffer has been sent
+   return (txDmaDesc[index].tdes0 & ETH_TDES0_OWN) ? FALSE : TRUE;
+}
+
+
+#if (STM32F4X7_SCATTER_GATHER_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Map the chunks of a frame to consecutive TX DMA descriptors
+ *
+ * Each chunk is given its own descriptor, so that the payload is
+ * transmitted from where it has been built. A reference only keeps a
+ * pool block from being freed, not from being rewritten, so the first
+ * chunk, which holds the headers that the stack writes in place, is always
+ * copied to the buffer of the descriptor, like borrowed data. The following
+ * chunks are read by the DMA in place and must not be modified until they
+ * are released by the driver (refer to chunkedBufferClone)
+ *
+ * @param[in] buffer Multi-part buffer containing the data to send
+ * @param[in] offset Offset to the first data byte
+ * @return TRUE if the frame has been queued, FALSE if it has to be copied
+ **/
+
+static bool_t stm32f4x7EthMapTxChunks(const ChunkedBuffer *buffer, size_t offset)
+{
+   uint_t i;
+   uint_t j;
+   uint_t k;
+   uint_t n;
+   uint_t first;
+   size_t length;
+   bool_t copy;
+   uint8_t *p;
+   ChunkDesc *chunk;
+
+   //Skip the chunks that precede the frame
+   for(i = 0; i < buffer->chunkCount; i++)
+   {
+      if(offset < buffer->chunk[i].length)
+         break;
+      offset -= buffer->chunk[i].length;
+   }
+
+   //Count the number of descriptors that are needed
+   for(n = 0, j = i; j < buffer->chunkCount; j++)
+   {
+      if(buffer->chunk[j].length > 0)
+         n++;
+   }
+
+   //A single chunk is sent using the regular path
+   if(n < 2)
+      return FALSE;
+
+   //Make sure enough descriptors are available for writing
+   if(n > nicRingGetFreeCount(&txRing))
+      return FALSE;
+
+   //Save the first descriptor of the frame
+   first = txRing.head;
+
+   //Map each chunk to a descriptor
+   for(j = 0; i < buffer->chunkCount; i++)
+   {
+      //Point to the current chunk
+      chunk = (ChunkDesc *) &buffer->chunk[i];
+      //Skip empty chunks
+      if(chunk->length <= offset)
+         continue;
+
+      //Point to the data to be sent
+      p = (uint8_t *) chunk->address + offset;
+      length = chunk->length - offset;
+      //Process the next chunk
+      offset = 0;
+
+      //The headers may be rewritten by the stack and borrowed data may
+      //no longer be valid once the function returns
+      copy = (j == 0 || chunk->block == NULL) ? TRUE : FALSE;
+
+      //Claim the next descriptor. A chunk that is read in place is kept
+      //alive until it has been transmitted
+      k = nicRingProduce(&txRing, copy ? NULL : chunk->block);
+
+      //Copy the data?
+      if(copy)
+      {
+         //Copy the data to the buffer of the descriptor
+         memcpy(txBuffer[k], p, length);
+         txDmaDesc[k].tdes2 = (uint32_t) txBuffer[k];
+      }
+      else
+      {
+         //The DMA reads the data directly from the chunk
+         txDmaDesc[k].tdes2 = (uint32_t) p;
+      }
+
+      //Write the number of bytes to send
+      txDmaDesc[k].tdes1 = length & ETH_TDES1_TBS1;
+      //Reset descriptor flags
+      txDmaDesc[k].tdes0 = ETH_TDES0_IC | ETH_TDES0_TCH | ETH_TDES0_CIC;
+
+      //First buffer of the frame?
+      if(j == 0)
+         txDmaDesc[k].tdes0 |= ETH_TDES0_FS;
+      //Last buffer of the frame?
+      if(++j == n)
+         txDmaDesc[k].tdes0 |= ETH_TDES0_LS;
+
+      //The DMA must not start before the whole frame is described
+      if(k != first)
+         txDmaDesc[k].tdes0 |= ETH_TDES0_OWN;
+   }
+
+   //Give the ownership of the first descriptor to the DMA
+   txDmaDesc[first].tdes0 |= ETH_TDES0_OWN;
+
+   //The frame is ready to be transmitted
+   return TRUE;
+}
+
+#endif
+
+
 /**
  * @brief Receive a packet
+ *
+ * The frame is processed in place, directly from the receive buffer
+ * of the current DMA descriptor. The ownership of the descriptor is
+ * given back to the DMA once the upper layers are done with it
+ *
  * @param[in] interface Underlying network interface
- * @param[out] buffer Buffer where to store the incoming data
- * @param[in] size Maximum number of bytes that can be received
- * @return Number of bytes that have been received
+ * @return Error code
  **/
 
-size_t stm32f4x7EthReceivePacket(NetInterface *interface,
-   uint8_t *buffer, size_t size)
+error_t stm32f4x7EthReceivePacket(NetInterface *interface)
 {
-   //Total number of bytes received
-   uint_t length = 0;
+   error_t error;
+   size_t length;
 
    //The current buffer is available for reading?
    if(!(rxCurDmaDesc->rdes0 & ETH_RDES0_OWN))
@@ -620,10 +807,28 @@ size_t stm32f4x7EthReceivePacket(NetInterface *interface,
             //Retrieve the length of the frame
             length = (rxCurDmaDesc->rdes0 & ETH_RDES0_FL) >> 16;
             //Limit the number of data to read
-            length = min(length, size);
-            //Copy data from the receive buffer
-            memcpy(buffer, (uint8_t *) rxCurDmaDesc->rdes2, length);
+            length = min(length, interface->mtu + sizeof(EthHeader) + ETH_CRC_SIZE);
+
+            //Frames with a wrong checksum have already been dropped, so
+            //only check which checksums were verified by the hardware
+            if(rxCurDmaDesc->rdes0 & ETH_RDES0_ESA)
+               interface->nicRxChecksumFlags = stm32f4x7EthGetRxChecksumFlags(rxCurDmaDesc->rdes4);
+
+            //Pass the packet to the upper layer without copying it
+            nicProcessPacket(interface, (uint8_t *) rxCurDmaDesc->rdes2, length);
+            //Valid packet received
+            error = NO_ERROR;
          }
+         else
+         {
+            //The received packet contains an error
+            error = ERROR_INVALID_PACKET;
+         }
+      }
+      else
+      {
+         //The packet is not valid
+         error = ERROR_INVALID_PACKET;
       }
 
       //Give the ownership of the descriptor back to the DMA
@@ -631,6 +836,11 @@ size_t stm32f4x7EthReceivePacket(NetInterface *interface,
       //Point to the next descriptor in the list
       rxCurDmaDesc = (Stm32f4x7RxDmaDesc *) rxCurDmaDesc->rdes3;
    }
+   else
+   {
+      //No more data in the receive buffer
+      error = ERROR_BUFFER_EMPTY;
+   }
 
    //Reception process is suspended?
    if(ETH->DMASR & ETH_DMASR_RBUS)
@@ -641,8 +851,35 @@ size_t stm32f4x7EthReceivePacket(NetInterface *interface,
       ETH->DMARPDR = 0;
    }
 
-   //Return the number of bytes that have been received
-   return length;
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Get the checksums verified by the receive checksum offload engine
+ * @param[in] status Extended status of the RX DMA descriptor
+ * @return Checksum status flags
+ **/
+
+static uint_t stm32f4x7EthGetRxChecksumFlags(uint32_t status)
+{
+   uint_t flags = 0;
+
+   //IPv4 packet?
+   if(status & ETH_RDES4_IPV4PR)
+   {
+      //Valid IPv4 header checksum?
+      if(!(status & ETH_RDES4_IPHE))
+         flags |= NIC_RX_CHECKSUM_IP;
+
+      //The payload is a TCP, UDP or ICMP message whose checksum has been checked?
+      if(!(status & (ETH_RDES4_IPCB | ETH_RDES4_IPPE)) && (status & ETH_RDES4_IPPT) != 0)
+         flags |= NIC_RX_CHECKSUM_PAYLOAD;
+   }
+
+   //Return checksum status flags
+   return flags;
 }
 
 
@@ -32,12 +32,47 @@
 //Dependencies
 #include "nic.h"
 
-//TX buffers
-#define STM32F4X7_TX_BUFFER_COUNT 2
-#define STM32F4X7_TX_BUFFER_SIZE 1536
-//RX buffers
-#define STM32F4X7_RX_BUFFER_COUNT 6
-#define STM32F4X7_RX_BUFFER_SIZE 1536
+//Scatter-gather transmit support
+#ifndef STM32F4X7_SCATTER_GATHER_SUPPORT
+   #define STM32F4X7_SCATTER_GATHER_SUPPORT DISABLED
+#elif (STM32F4X7_SCATTER_GATHER_SUPPORT != ENABLED && STM32F4X7_SCATTER_GATHER_SUPPORT != DISABLED)
+   #error STM32F4X7_SCATTER_GATHER_SUPPORT parameter is not valid
+#endif
+
+//Number of TX buffers
+#ifndef STM32F4X7_TX_BUFFER_COUNT
+   #define STM32F4X7_TX_BUFFER_COUNT 2
+#elif (STM32F4X7_TX_BUFFER_COUNT < 1)
+   #error STM32F4X7_TX_BUFFER_COUNT parameter is not valid
+#endif
+
+//Maximum transmission unit (jumbo frames require larger buffers)
+#ifndef STM32F4X7_MTU
+   #define STM32F4X7_MTU 1500
+#elif (STM32F4X7_MTU < 1500 || STM32F4X7_MTU > 8000)
+   #error STM32F4X7_MTU parameter is not valid
+#endif
+
+//TX buffer size
+#ifndef STM32F4X7_TX_BUFFER_SIZE
+   #define STM32F4X7_TX_BUFFER_SIZE 1536
+#elif (STM32F4X7_TX_BUFFER_SIZE < (STM32F4X7_MTU + 18) || STM32F4X7_TX_BUFFER_SIZE > 8188)
+   #error STM32F4X7_TX_BUFFER_SIZE parameter is not valid
+#endif
+
+//Number of RX buffers
+#ifndef STM32F4X7_RX_BUFFER_COUNT
+   #define STM32F4X7_RX_BUFFER_COUNT 6
+#elif (STM32F4X7_RX_BUFFER_COUNT < 1)
+   #error STM32F4X7_RX_BUFFER_COUNT parameter is not valid
+#endif
+
+//RX buffer size (a frame must fit in a single buffer)
+#ifndef STM32F4X7_RX_BUFFER_SIZE
+   #define STM32F4X7_RX_BUFFER_SIZE 1536
+#elif (STM32F4X7_RX_BUFFER_SIZE < (STM32F4X7_MTU + 18) || STM32F4X7_RX_BUFFER_SIZE > 8188)
+   #error STM32F4X7_RX_BUFFER_SIZE parameter is not valid
+#endif
 
 //Transmit DMA descriptor flags
 #define ETH_TDES0_OWN    0x80000000
@@ -92,6 +127,7 @@
 #define ETH_RDES0_DBE    0x00000004
 #define ETH_RDES0_CE     0x00000002
 #define ETH_RDES0_PCE    0x00000001
+#define ETH_RDES0_ESA    0x00000001
 #define ETH_RDES1_DIC    0x80000000
 #define ETH_RDES1_RBS2   0x1FFF0000
 #define ETH_RDES1_RER    0x00008000
@@ -164,8 +200,7 @@ error_t stm32f4x7EthSetMacFilter(NetInterface *interface);
 error_t stm32f4x7EthSendPacket(NetInterface *interface,
    const ChunkedBuffer *buffer, size_t offset);
 
-size_t stm32f4x7EthReceivePacket(NetInterface *interface,
-   uint8_t *buffer, size_t size);
+error_t stm32f4x7EthReceivePacket(NetInterface *interface);
 
 void stm32f4x7EthWritePhyReg(uint8_t phyAddr, uint8_t regAddr, uint16_t data);
 uint16_t stm32f4x7EthReadPhyReg(uint8_t phyAddr, uint8_t regAddr);
@@ -0,0 +1,382 @@
+/**
+ * @file tap_eth.c
+ * @brief Linux TAP virtual Ethernet interface
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * This driver attaches the TCP/IP stack to a TAP device of the Linux
+ * host, so that the stack can be run and profiled as a regular process.
+ * The TAP device has to be created beforehand, for instance with
+ * "ip tuntap add dev tap0 mode tap user <name>", and brought up with
+ * an address of the same subnet as the one assigned to the stack
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL NIC_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+#include "tcp_ip_stack.h"
+#include "tap_eth.h"
+#include "debug.h"
+
+//File descriptor of the TAP device
+static int tapFd = -1;
+//Handle to the task that watches the TAP device
+static OsTask *readerTask;
+//The RX event handler has drained the TAP device
+static OsEvent *rxDoneEvent;
+//Transmit buffer
+static uint8_t txBuffer[TAP_ETH_TX_BUFFER_SIZE];
+
+
+/**
+ * @brief TAP driver
+ **/
+
+const NicDriver tapEthDriver =
+{
+   tapEthInit,
+   tapEthTick,
+   tapEthEnableIrq,
+   tapEthDisableIrq,
+   tapEthRxEventHandler,
+   tapEthSetMacFilter,
+   tapEthSendPacket,
+   NULL,
+   NULL,
+   TRUE,
+   TRUE,
+   TRUE,
+   FALSE,
+   FALSE,
+   TRUE,
+   ETH_MTU
+};
+
+
+/**
+ * @brief TAP interface initialization
+ * @param[in] interface Underlying network interface
+ * @return Error code
+ **/
+
+error_t tapEthInit(NetInterface *interface)
+{
+   int flags;
+   struct ifreq ifr;
+
+   //Debug message
+   TRACE_INFO("Initializing TAP interface (%s)...\r\n", TAP_ETH_DEVICE_NAME);
+
+   //Open the clone device
+   tapFd = open("/dev/net/tun", O_RDWR);
+   //Failed to open the device?
+   if(tapFd < 0)
+   {
+      //Debug message
+      TRACE_ERROR("Failed to open /dev/net/tun (errno = %d)!\r\n", errno);
+      //Report an error
+      return ERROR_FAILURE;
+   }
+
+   //Attach to the TAP device. Frames are exchanged without packet
+   //information header
+   memset(&ifr, 0, sizeof(ifr));
+   ifr.ifr_flags = IFF_TAP | IFF_NO_PI;
+   strncpy(ifr.ifr_name, TAP_ETH_DEVICE_NAME, IFNAMSIZ - 1);
+
+   //Configure the TAP device
+   if(ioctl(tapFd, TUNSETIFF, &ifr) < 0)
+   {
+      //Debug message
+      TRACE_ERROR("Failed to attach to %s (errno = %d)!\r\n", TAP_ETH_DEVICE_NAME, errno);
+      //Clean up side effects
+      close(tapFd);
+      tapFd = -1;
+      //Report an error
+      return ERROR_FAILURE;
+   }
+
+   //Reads must never block the RX task
+   flags = fcntl(tapFd, F_GETFL, 0);
+   fcntl(tapFd, F_SETFL, flags | O_NONBLOCK);
+
+   //The reader task waits for this event before polling the device again
+   rxDoneEvent = osEventCreate(FALSE, TRUE);
+   //Out of resources?
+   if(rxDoneEvent == OS_INVALID_HANDLE)
+   {
+      //Clean up side effects
+      close(tapFd);
+      tapFd = -1;
+      //Report an error
+      return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //Create a task that plays the role of the receive interrupt
+   readerTask = osTaskCreate("TAP Reader", tapEthReaderTask,
+      interface, TAP_ETH_READER_STACK_SIZE, TAP_ETH_READER_PRIORITY);
+
+   //Unable to create the task?
+   if(readerTask == OS_INVALID_HANDLE)
+   {
+      //Clean up side effects
+      osEventClose(rxDoneEvent);
+      close(tapFd);
+      tapFd = -1;
+      //Report an error
+      return ERROR_OUT_OF_RESOURCES;
+   }
+
+   //The virtual link is always up
+   interface->phyEvent = TRUE;
+   osEventSet(interface->nicRxEvent);
+
+   //The TAP device is ready to send
+   osEventSet(interface->nicTxEvent);
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief TAP interface timer handler
+ * @param[in] interface Underlying network interface
+ **/
+
+void tapEthTick(NetInterface *interface)
+{
+}
+
+
+/**
+ * @brief Enable interrupts
+ * @param[in] interface Underlying network interface
+ **/
+
+void tapEthEnableIrq(NetInterface *interface)
+{
+}
+
+
+/**
+ * @brief Disable interrupts
+ * @param[in] interface Underlying network interface
+ **/
+
+void tapEthDisableIrq(NetInterface *interface)
+{
+}
+
+
+/**
+ * @brief TAP reader task
+ *
+ * The task sleeps until a frame is available on the TAP device, notifies
+ * the RX task, and then waits for the RX event handler to drain the
+ * device, much like a receive interrupt that is masked until serviced
+ *
+ * @param[in] param Pointer to the network interface
+ **/
+
+void tapEthReaderTask(void *param)
+{
+   struct pollfd fds;
+
+   //Point to the structure describing the network interface
+   NetInterface *interface = (NetInterface *) param;
+
+   //Main loop
+   while(1)
+   {
+      //Wait for the previous frames to be processed
+      osEventWait(rxDoneEvent, INFINITE_DELAY);
+
+      //Wait for a frame to be received
+      fds.fd = tapFd;
+      fds.events = POLLIN;
+      fds.revents = 0;
+
+      //Restart the wait if it was interrupted by a signal
+      while(poll(&fds, 1, -1) < 0 && errno == EINTR);
+
+      //Notify the user that a packet has been received
+      osEventSet(interface->nicRxEvent);
+   }
+}
+
+
+/**
+ * @brief TAP interface event handler
+ * @param[in] interface Underlying network interface
+ **/
+
+void tapEthRxEventHandler(NetInterface *interface)
+{
+   uint_t n;
+   uint_t length;
+
+   //Link state change event?
+   if(interface->phyEvent)
+   {
+      //Acknowledge the event by clearing the flag
+      interface->phyEvent = FALSE;
+
+      //The virtual link is always up and running at full speed
+      interface->linkState = TRUE;
+      interface->speed100 = TRUE;
+      interface->fullDuplex = TRUE;
+
+      //Display link state
+      TRACE_INFO("Link is up (%s)...\r\n", interface->name);
+
+      //Process link state change event
+      nicNotifyLinkChange(interface);
+   }
+
+   //Process the pending packets, up to the RX budget
+   for(n = 0; n < NIC_RX_BUDGET; n++)
+   {
+      //Check whether a packet has been received
+      length = tapEthReceivePacket(interface, interface->ethFrame, ETH_MAX_FRAME_SIZE);
+      //No more packet to process?
+      if(!length) break;
+
+      //Pass the packet to the upper layer
+      nicProcessPacket(interface, interface->ethFrame, length);
+   }
+
+   //Frames are still pending?
+   if(n >= NIC_RX_BUDGET)
+   {
+      //Yield to the other tasks before processing the remaining frames
+      osEventSet(interface->nicRxEvent);
+   }
+   else
+   {
+      //Let the reader task watch the TAP device again
+      osEventSet(rxDoneEvent);
+   }
+}
+
+
+/**
+ * @brief Configure multicast MAC address filtering
+ *
+ * The TAP device delivers every frame of the virtual link, so that
+ * multicast filtering is left to the Ethernet layer of the stack
+ *
+ * @param[in] interface Underlying network interface
+ * @return Error code
+ **/
+
+error_t tapEthSetMacFilter(NetInterface *interface)
+{
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send a packet
+ * @param[in] interface Underlying network interface
+ * @param[in] buffer Multi-part buffer containing the data to send
+ * @param[in] offset Offset to the first data byte
+ * @return Error code
+ **/
+
+error_t tapEthSendPacket(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset)
+{
+   ssize_t n;
+
+   //Retrieve the length of the packet
+   size_t length = chunkedBufferGetLength(buffer) - offset;
+
+   //Check the frame length
+   if(length > TAP_ETH_TX_BUFFER_SIZE)
+   {
+      //The transmitter can accept another packet
+      osEventSet(interface->nicTxEvent);
+      //Report an error
+      return ERROR_INVALID_LENGTH;
+   }
+
+   //Copy user data to the transmit buffer
+   chunkedBufferRead(txBuffer, buffer, offset, length);
+
+   //Write the frame to the TAP device
+   n = write(tapFd, txBuffer, length);
+
+   //The transmitter can accept another packet
+   osEventSet(interface->nicTxEvent);
+
+   //Check status code
+   if(n != (ssize_t) length)
+   {
+      //Debug message
+      TRACE_WARNING("Failed to write to %s (errno = %d)!\r\n", TAP_ETH_DEVICE_NAME, errno);
+      //Report an error
+      return ERROR_FAILURE;
+   }
+
+   //Successful write operation
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Receive a packet
+ * @param[in] interface Underlying network interface
+ * @param[out] buffer Buffer where to store the incoming data
+ * @param[in] size Maximum number of bytes that can be received
+ * @return Number of bytes that have been received
+ **/
+
+uint_t tapEthReceivePacket(NetInterface *interface,
+   uint8_t *buffer, uint_t size)
+{
+   ssize_t n;
+
+   //Read the next frame from the TAP device, if any
+   n = read(tapFd, buffer, size);
+
+   //No packet is pending?
+   if(n <= 0)
+      return 0;
+
+   //Return the number of bytes that have been received
+   return n;
+}
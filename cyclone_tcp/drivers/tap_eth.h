@@ -0,0 +1,83 @@
+/**
+ * @file tap_eth.h
+ * @brief Linux TAP virtual Ethernet interface
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _TAP_ETH_H
+#define _TAP_ETH_H
+
+//Dependencies
+#include "nic.h"
+
+//Name of the TAP device to attach to
+#ifndef TAP_ETH_DEVICE_NAME
+   #define TAP_ETH_DEVICE_NAME "tap0"
+#endif
+
+//TX buffer size
+#ifndef TAP_ETH_TX_BUFFER_SIZE
+   #define TAP_ETH_TX_BUFFER_SIZE 1536
+#elif (TAP_ETH_TX_BUFFER_SIZE < 1536)
+   #error TAP_ETH_TX_BUFFER_SIZE parameter is invalid
+#endif
+
+//Stack size required to run the TAP reader task
+#ifndef TAP_ETH_READER_STACK_SIZE
+   #define TAP_ETH_READER_STACK_SIZE 550
+#elif (TAP_ETH_READER_STACK_SIZE < 1)
+   #error TAP_ETH_READER_STACK_SIZE parameter is invalid
+#endif
+
+//Priority at which the TAP reader task should run
+#ifndef TAP_ETH_READER_PRIORITY
+   #define TAP_ETH_READER_PRIORITY 3
+#elif (TAP_ETH_READER_PRIORITY < 0)
+   #error TAP_ETH_READER_PRIORITY parameter is invalid
+#endif
+
+
+//TAP driver
+extern const NicDriver tapEthDriver;
+
+//TAP related functions
+error_t tapEthInit(NetInterface *interface);
+
+void tapEthTick(NetInterface *interface);
+
+void tapEthEnableIrq(NetInterface *interface);
+void tapEthDisableIrq(NetInterface *interface);
+void tapEthReaderTask(void *param);
+void tapEthRxEventHandler(NetInterface *interface);
+
+error_t tapEthSetMacFilter(NetInterface *interface);
+
+error_t tapEthSendPacket(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset);
+
+uint_t tapEthReceivePacket(NetInterface *interface,
+   uint8_t *buffer, uint_t size);
+
+#endif
@@ -227,8 +227,7 @@ error_t xmc4500EthSetMacFilter(NetInterface *interface);
 error_t xmc4500EthSendPacket(NetInterface *interface,
    const ChunkedBuffer *buffer, size_t offset);
 
-size_t xmc4500EthReceivePacket(NetInterface *interface,
-   uint8_t *buffer, size_t size);
+error_t xmc4500EthReceivePacket(NetInterface *interface);
 
 void xmc4500EthWritePhyReg(uint8_t phyAddr, uint8_t regAddr, uint16_t data);
 uint16_t xmc4500EthReadPhyReg(uint8_t phyAddr, uint8_t regAddr);
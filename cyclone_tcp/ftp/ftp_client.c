@@ -609,6 +609,28 @@ error_t ftpRemoveDir(FtpClientContext *context, const char_t *path)
  **/
 
 error_t ftpOpenFile(FtpClientContext *context, const char_t *path, uint_t flags)
+{
+   //Start the transfer at the beginning of the file
+   return ftpOpenFileEx(context, path, 0, flags);
+}
+
+
+/**
+ * @brief Open a file, starting the transfer at the specified offset
+ *
+ * A non-zero offset is sent in a REST command, so that an interrupted
+ * transfer can be resumed (RFC 3659). The FTP_BULK_TRANSFER flag sizes
+ * the data connection for throughput rather than for memory footprint
+ *
+ * @param[in] context Pointer to the FTP client context
+ * @param[in] path Path to the file to be be opened
+ * @param[in] offset Position in the file at which the transfer starts
+ * @param[in] flags Access mode
+ * @return Error code
+ **/
+
+error_t ftpOpenFileEx(FtpClientContext *context,
+   const char_t *path, uint32_t offset, uint_t flags)
 {
    error_t error;
    uint16_t port;
@@ -641,6 +663,23 @@ error_t ftpOpenFile(FtpClientContext *context, const char_t *path, uint_t flags)
       //Any error to report?
       if(error) break;
 
+#if (TCP_BUFFER_AUTOTUNE_SUPPORT == DISABLED)
+      //Bulk transfer?
+      if(flags & FTP_BULK_TRANSFER)
+      {
+         //Size the buffer in the direction of the transfer so that the window
+         //can cover the bandwidth-delay product of the path. When automatic
+         //tuning is enabled, the buffers already grow to that size
+         if(flags & (FTP_FOR_WRITING | FTP_FOR_APPENDING))
+            error = socketSetTxBufferSize(context->dataSocket, FTP_CLIENT_BULK_TX_BUFFER_SIZE);
+         else
+            error = socketSetRxBufferSize(context->dataSocket, FTP_CLIENT_BULK_RX_BUFFER_SIZE);
+
+         //Any error to report?
+         if(error) break;
+      }
+#endif
+
       //Set representation type
       if(flags & FTP_TEXT_TYPE)
       {
@@ -696,6 +735,26 @@ error_t ftpOpenFile(FtpClientContext *context, const char_t *path, uint_t flags)
          if(error) break;
       }
 
+      //Resume an interrupted transfer?
+      if(offset > 0)
+      {
+         //Format the REST command
+         sprintf(context->buffer, "REST %lu\r\n", (unsigned long) offset);
+
+         //Send the command to the server
+         error = ftpSendCommand(context, context->buffer, &replyCode);
+         //Any error to report?
+         if(error) break;
+
+         //The server must answer with a 350 reply
+         if(!FTP_REPLY_CODE_3YZ(replyCode))
+         {
+            //Report an error
+            error = ERROR_UNEXPECTED_RESPONSE;
+            break;
+         }
+      }
+
       //Format the command
       if(flags & FTP_FOR_WRITING)
          sprintf(context->buffer, "STOR %s\r\n", path);
@@ -837,6 +896,187 @@ error_t ftpCloseFile(FtpClientContext *context)
 }
 
 
+/**
+ * @brief Upload a file
+ *
+ * The contents of the file are supplied block by block by the callback
+ * function. With FTP_FLAG_NO_COPY, the blocks are referenced by the TCP send
+ * buffer instead of being copied into it. The memory must then remain valid
+ * until the transfer completes (resource data held in flash, for instance)
+ *
+ * @param[in] context Pointer to the FTP client context
+ * @param[in] path Path to the remote file
+ * @param[in] offset Position at which the upload starts (0 for a new file)
+ * @param[in] callback Function that provides the contents of the file
+ * @param[in] param Opaque parameter passed to the callback function
+ * @param[in] flags Access mode (FTP_FOR_APPENDING, FTP_TEXT_TYPE,
+ *   FTP_BULK_TRANSFER) and FTP_FLAG_NO_COPY
+ * @return Error code
+ **/
+
+error_t ftpPutFile(FtpClientContext *context, const char_t *path,
+   uint32_t offset, FtpReadCallback callback, void *param, uint_t flags)
+{
+   error_t error;
+   error_t status;
+   size_t length;
+   const void *data;
+
+   //Check parameters
+   if(context == NULL || path == NULL || callback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The file is opened for writing unless appending is requested
+   if(!(flags & FTP_FOR_APPENDING))
+      flags |= FTP_FOR_WRITING;
+
+   //Open the remote file
+   error = ftpOpenFileEx(context, path, offset, flags);
+   //Any error to report?
+   if(error) return error;
+
+   //Send the file block by block
+   while(1)
+   {
+      //Retrieve the next block of data
+      error = callback(param, offset, &data, &length);
+      //End of file or error?
+      if(error || !length) break;
+
+      //Transmit data to the FTP server
+      error = ftpWriteFile(context, data, length, flags & FTP_FLAG_NO_COPY);
+      //Any error to report?
+      if(error) break;
+
+      //Advance data pointer
+      offset += length;
+   }
+
+   //Close the data connection and check the transfer status
+   status = ftpCloseFile(context);
+
+   //Return status code
+   return error ? error : status;
+}
+
+
+/**
+ * @brief Download a file
+ * @param[in] context Pointer to the FTP client context
+ * @param[in] path Path to the remote file
+ * @param[in] offset Position at which the download starts (0 for the whole file)
+ * @param[in] callback Function that stores the contents of the file
+ * @param[in] param Opaque parameter passed to the callback function
+ * @param[in] flags Access mode (FTP_TEXT_TYPE, FTP_BULK_TRANSFER)
+ * @return Error code
+ **/
+
+error_t ftpGetFile(FtpClientContext *context, const char_t *path,
+   uint32_t offset, FtpWriteCallback callback, void *param, uint_t flags)
+{
+   error_t error;
+   error_t status;
+   size_t length;
+
+   //Check parameters
+   if(context == NULL || path == NULL || callback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The file is opened for reading
+   flags &= ~(FTP_FOR_WRITING | FTP_FOR_APPENDING);
+
+   //Open the remote file
+   error = ftpOpenFileEx(context, path, offset, flags);
+   //Any error to report?
+   if(error) return error;
+
+   //Receive the file until the server closes the data connection
+   while(1)
+   {
+      //Read as much data as available
+      error = ftpReadFile(context, context->buffer,
+         FTP_CLIENT_BUFFER_SIZE, &length, 0);
+
+      //The end of the file has been reached?
+      if(error == ERROR_END_OF_STREAM)
+      {
+         //The transfer is complete
+         error = NO_ERROR;
+         break;
+      }
+      //Any other error to report?
+      else if(error)
+      {
+         break;
+      }
+
+      //Store the data
+      error = callback(param, offset, context->buffer, length);
+      //Any error to report?
+      if(error) break;
+
+      //Advance data pointer
+      offset += length;
+   }
+
+   //Close the data connection and check the transfer status
+   status = ftpCloseFile(context);
+
+   //Return status code
+   return error ? error : status;
+}
+
+
+/**
+ * @brief Retrieve the size of a remote file
+ *
+ * The size is typically used to resume an interrupted upload
+ * at the right offset (RFC 3659)
+ *
+ * @param[in] context Pointer to the FTP client context
+ * @param[in] path Path to the remote file
+ * @param[out] size Size of the file, in bytes
+ * @return Error code
+ **/
+
+error_t ftpGetFileSize(FtpClientContext *context, const char_t *path, uint32_t *size)
+{
+   error_t error;
+   uint_t replyCode;
+
+   //Check parameters
+   if(context == NULL || path == NULL || size == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The size reported by the server depends on the representation type
+   error = ftpSetType(context, 'I');
+   //Any error to report?
+   if(error) return error;
+
+   //Format the SIZE command
+   sprintf(context->buffer, "SIZE %s\r\n", path);
+
+   //Send the command to the server
+   error = ftpSendCommand(context, context->buffer, &replyCode);
+   //Any error to report?
+   if(error) return error;
+
+   //Check FTP response code
+   if(!FTP_REPLY_CODE_2YZ(replyCode))
+      return ERROR_UNEXPECTED_RESPONSE;
+
+   //The size follows the 213 reply code
+   if(strlen(context->buffer) < 5)
+      return ERROR_INVALID_SYNTAX;
+
+   //Convert the resulting string
+   *size = strtoul(context->buffer + 4, NULL, 10);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Rename a remote file
  * @param[in] context Pointer to the FTP client context
@@ -54,6 +54,20 @@
    #error FTP_CLIENT_BUFFER_SIZE parameter is invalid
 #endif
 
+//Size of the send buffer used by bulk uploads
+#ifndef FTP_CLIENT_BULK_TX_BUFFER_SIZE
+   #define FTP_CLIENT_BULK_TX_BUFFER_SIZE TCP_MAX_TX_BUFFER_SIZE
+#elif (FTP_CLIENT_BULK_TX_BUFFER_SIZE < 1 || FTP_CLIENT_BULK_TX_BUFFER_SIZE > TCP_MAX_TX_BUFFER_SIZE)
+   #error FTP_CLIENT_BULK_TX_BUFFER_SIZE parameter is invalid
+#endif
+
+//Size of the receive buffer used by bulk downloads
+#ifndef FTP_CLIENT_BULK_RX_BUFFER_SIZE
+   #define FTP_CLIENT_BULK_RX_BUFFER_SIZE TCP_MAX_RX_BUFFER_SIZE
+#elif (FTP_CLIENT_BULK_RX_BUFFER_SIZE < 1 || FTP_CLIENT_BULK_RX_BUFFER_SIZE > TCP_MAX_RX_BUFFER_SIZE)
+   #error FTP_CLIENT_BULK_RX_BUFFER_SIZE parameter is invalid
+#endif
+
 //Test macros for FTP response codes
 #define FTP_REPLY_CODE_1YZ(code) ((code) >= 100 && (code) < 200)
 #define FTP_REPLY_CODE_2YZ(code) ((code) >= 200 && (code) < 300)
@@ -86,7 +100,8 @@ typedef enum
    FTP_FOR_WRITING   = 1,
    FTP_FOR_APPENDING = 2,
    FTP_BINARY_TYPE   = 0,
-   FTP_TEXT_TYPE     = 4
+   FTP_TEXT_TYPE     = 4,
+   FTP_BULK_TRANSFER = 8
 } FtpFileOpeningFlags;
 
 
@@ -100,10 +115,20 @@ typedef enum
    FTP_FLAG_WAIT_ALL   = 0x0800,
    FTP_FLAG_BREAK_CHAR = 0x1000,
    FTP_FLAG_BREAK_CRLF = 0x100A,
-   FTP_FLAG_WAIT_ACK   = 0x2000
+   FTP_FLAG_WAIT_ACK   = 0x2000,
+   FTP_FLAG_NO_COPY    = 0x4000
 } FtpFlags;
 
 
+//Callback function that provides the next block of a file being uploaded
+typedef error_t (*FtpReadCallback)(void *param, uint32_t offset,
+   const void **data, size_t *length);
+
+//Callback function that stores the next block of a file being downloaded
+typedef error_t (*FtpWriteCallback)(void *param, uint32_t offset,
+   const void *data, size_t length);
+
+
 /**
  * @brief FTP client context
  **/
@@ -135,6 +160,9 @@ error_t ftpRemoveDir(FtpClientContext *context, const char_t *path);
 
 error_t ftpOpenFile(FtpClientContext *context, const char_t *path, uint_t flags);
 
+error_t ftpOpenFileEx(FtpClientContext *context,
+   const char_t *path, uint32_t offset, uint_t flags);
+
 error_t ftpWriteFile(FtpClientContext *context,
    const void *data, size_t length, uint_t flags);
 
@@ -143,6 +171,14 @@ error_t ftpReadFile(FtpClientContext *context,
 
 error_t ftpCloseFile(FtpClientContext *context);
 
+error_t ftpPutFile(FtpClientContext *context, const char_t *path,
+   uint32_t offset, FtpReadCallback callback, void *param, uint_t flags);
+
+error_t ftpGetFile(FtpClientContext *context, const char_t *path,
+   uint32_t offset, FtpWriteCallback callback, void *param, uint_t flags);
+
+error_t ftpGetFileSize(FtpClientContext *context, const char_t *path, uint32_t *size);
+
 error_t ftpRenameFile(FtpClientContext *context,
    const char_t *oldName, const char_t *newName);
 
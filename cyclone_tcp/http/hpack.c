@@ -0,0 +1,834 @@
+/**
+ * @file hpack.c
+ * @brief HPACK header compression for HTTP/2 (RFC 7541)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * HPACK encodes the header fields of HTTP/2 requests and responses by
+ * reference to a static table of common fields and to a dynamic table
+ * filled by the previous header blocks of the connection. Literal strings
+ * may be compressed with a static Huffman code
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+//Switch to the appropriate trace level
+#define TRACE_LEVEL HTTP_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "http_server.h"
+#include "hpack.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Static table (refer to RFC 7541, appendix A)
+ **/
+
+static const HpackStaticEntry hpackStaticTable[HPACK_STATIC_TABLE_SIZE] =
+{
+   {":authority", ""},
+   {":method", "GET"},
+   {":method", "POST"},
+   {":path", "/"},
+   {":path", "/index.html"},
+   {":scheme", "http"},
+   {":scheme", "https"},
+   {":status", "200"},
+   {":status", "204"},
+   {":status", "206"},
+   {":status", "304"},
+   {":status", "400"},
+   {":status", "404"},
+   {":status", "500"},
+   {"accept-charset", ""},
+   {"accept-encoding", "gzip, deflate"},
+   {"accept-language", ""},
+   {"accept-ranges", ""},
+   {"accept", ""},
+   {"access-control-allow-origin", ""},
+   {"age", ""},
+   {"allow", ""},
+   {"authorization", ""},
+   {"cache-control", ""},
+   {"content-disposition", ""},
+   {"content-encoding", ""},
+   {"content-language", ""},
+   {"content-length", ""},
+   {"content-location", ""},
+   {"content-range", ""},
+   {"content-type", ""},
+   {"cookie", ""},
+   {"date", ""},
+   {"etag", ""},
+   {"expect", ""},
+   {"expires", ""},
+   {"from", ""},
+   {"host", ""},
+   {"if-match", ""},
+   {"if-modified-since", ""},
+   {"if-none-match", ""},
+   {"if-range", ""},
+   {"if-unmodified-since", ""},
+   {"last-modified", ""},
+   {"link", ""},
+   {"location", ""},
+   {"max-forwards", ""},
+   {"proxy-authenticate", ""},
+   {"proxy-authorization", ""},
+   {"range", ""},
+   {"referer", ""},
+   {"refresh", ""},
+   {"retry-after", ""},
+   {"server", ""},
+   {"set-cookie", ""},
+   {"strict-transport-security", ""},
+   {"transfer-encoding", ""},
+   {"user-agent", ""},
+   {"vary", ""},
+   {"via", ""},
+   {"www-authenticate", ""}
+};
+
+
+/**
+ * @brief Number of Huffman codes of each length (refer to RFC 7541, appendix B)
+ *
+ * The Huffman code is canonical: the codes of a given length are consecutive
+ * and follow the numerical order of the symbols, so the code can be decoded
+ * from the number of codes of each length and from the list of symbols
+ * sorted by code length. EOS is the last code of length 30
+ *
+ **/
+
+static const uint8_t hpackHuffmanCount[31] =
+{
+   0, 0, 0, 0, 0, 10, 26, 32, 6, 0, 5, 3, 2, 6, 2, 3, 0, 0, 0, 3, 8, 13, 26, 29, 12, 4, 15, 19, 29, 0, 4
+};
+
+
+/**
+ * @brief Huffman symbols sorted by code length
+ **/
+
+static const uint8_t hpackHuffmanSymbol[256] =
+{
+   0x30, 0x31, 0x32, 0x61, 0x63, 0x65, 0x69, 0x6F, 0x73, 0x74, 0x20, 0x25,
+   0x2D, 0x2E, 0x2F, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3D, 0x41,
+   0x5F, 0x62, 0x64, 0x66, 0x67, 0x68, 0x6C, 0x6D, 0x6E, 0x70, 0x72, 0x75,
+   0x3A, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x4B, 0x4C,
+   0x4D, 0x4E, 0x4F, 0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x59,
+   0x6A, 0x6B, 0x71, 0x76, 0x77, 0x78, 0x79, 0x7A, 0x26, 0x2A, 0x2C, 0x3B,
+   0x58, 0x5A, 0x21, 0x22, 0x28, 0x29, 0x3F, 0x27, 0x2B, 0x7C, 0x23, 0x3E,
+   0x00, 0x24, 0x40, 0x5B, 0x5D, 0x7E, 0x5E, 0x7D, 0x3C, 0x60, 0x7B, 0x5C,
+   0xC3, 0xD0, 0x80, 0x82, 0x83, 0xA2, 0xB8, 0xC2, 0xE0, 0xE2, 0x99, 0xA1,
+   0xA7, 0xAC, 0xB0, 0xB1, 0xB3, 0xD1, 0xD8, 0xD9, 0xE3, 0xE5, 0xE6, 0x81,
+   0x84, 0x85, 0x86, 0x88, 0x92, 0x9A, 0x9C, 0xA0, 0xA3, 0xA4, 0xA9, 0xAA,
+   0xAD, 0xB2, 0xB5, 0xB9, 0xBA, 0xBB, 0xBD, 0xBE, 0xC4, 0xC6, 0xE4, 0xE8,
+   0xE9, 0x01, 0x87, 0x89, 0x8A, 0x8B, 0x8C, 0x8D, 0x8F, 0x93, 0x95, 0x96,
+   0x97, 0x98, 0x9B, 0x9D, 0x9E, 0xA5, 0xA6, 0xA8, 0xAE, 0xAF, 0xB4, 0xB6,
+   0xB7, 0xBC, 0xBF, 0xC5, 0xE7, 0xEF, 0x09, 0x8E, 0x90, 0x91, 0x94, 0x9F,
+   0xAB, 0xCE, 0xD7, 0xE1, 0xEC, 0xED, 0xC7, 0xCF, 0xEA, 0xEB, 0xC0, 0xC1,
+   0xC8, 0xC9, 0xCA, 0xCD, 0xD2, 0xD5, 0xDA, 0xDB, 0xEE, 0xF0, 0xF2, 0xF3,
+   0xFF, 0xCB, 0xCC, 0xD3, 0xD4, 0xD6, 0xDD, 0xDE, 0xDF, 0xF1, 0xF4, 0xF5,
+   0xF6, 0xF7, 0xF8, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0x02, 0x03, 0x04, 0x05,
+   0x06, 0x07, 0x08, 0x0B, 0x0C, 0x0E, 0x0F, 0x10, 0x11, 0x12, 0x13, 0x14,
+   0x15, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x7F, 0xDC,
+   0xF9, 0x0A, 0x0D, 0x16
+};
+
+/**
+ * @brief Initialize an HPACK decoder
+ * @param[in] decoder Pointer to the HPACK decoder
+ * @param[in] limit Maximum size of the dynamic table announced to the peer
+ **/
+
+void hpackInitDecoder(HpackDecoder *decoder, size_t limit)
+{
+   //The dynamic table cannot exceed the size of the entry buffer
+   decoder->limit = min(limit, HPACK_TABLE_SIZE);
+   decoder->maxSize = decoder->limit;
+
+   //The dynamic table is initially empty
+   decoder->size = 0;
+   decoder->count = 0;
+   decoder->length = 0;
+}
+
+
+/**
+ * @brief Decode a header block
+ *
+ * The header fields are reported one at a time through the specified
+ * callback. Fields longer than HPACK_MAX_FIELD_SIZE are skipped, except
+ * those that would have to be added to the dynamic table, in which case
+ * the header block cannot be decoded
+ *
+ * @param[in] decoder Pointer to the HPACK decoder
+ * @param[in] data Pointer to the header block
+ * @param[in] length Length of the header block
+ * @param[in] callback Function invoked for each header field
+ * @param[in] param Opaque parameter passed to the callback
+ * @return Error code (ERROR_DECODING_FAILED if the compression context
+ *   can no longer be maintained)
+ **/
+
+error_t hpackDecodeHeaderBlock(HpackDecoder *decoder, const uint8_t *data,
+   size_t length, HpackFieldCallback callback, void *param)
+{
+   error_t error;
+   uint_t prefix;
+   uint32_t index;
+   size_t nameLength;
+   size_t valueLength;
+   const char_t *name;
+   const char_t *value;
+   const uint8_t *end;
+
+   //Point to the end of the header block
+   end = data + length;
+
+   //Process the header field representations
+   while(data < end)
+   {
+      //Dynamic table size update?
+      if((data[0] & 0xE0) == 0x20)
+      {
+         //Decode the new maximum size
+         error = hpackDecodeInteger(&data, end, 5, &index);
+         //Any error to report?
+         if(error) return error;
+
+         //The new size cannot exceed the limit set by the decoder
+         if(index > decoder->limit)
+            return ERROR_DECODING_FAILED;
+
+         //Evict the entries that no longer fit
+         hpackEvictEntries(decoder, index);
+         decoder->maxSize = index;
+         //Process the next representation
+         continue;
+      }
+
+      //Indexed header field?
+      if(data[0] & 0x80)
+      {
+         //Decode the index of the entry
+         error = hpackDecodeInteger(&data, end, 7, &index);
+         //Any error to report?
+         if(error) return error;
+
+         //Retrieve the name and the value of the entry
+         error = hpackGetEntry(decoder, index, &name, &nameLength, &value, &valueLength);
+         //Invalid index?
+         if(error) return error;
+
+         //Fields that are too long are skipped
+         if((nameLength + valueLength) > HPACK_MAX_FIELD_SIZE)
+            continue;
+
+         //Copy the header field
+         memcpy(decoder->field, name, nameLength);
+         memcpy(decoder->field + nameLength + 1, value, valueLength);
+      }
+      else
+      {
+         //Literal with incremental indexing (6-bit prefix), without
+         //indexing or never indexed (4-bit prefix)
+         prefix = (data[0] & 0x40) ? 6 : 4;
+
+         //Decode the index of the name
+         error = hpackDecodeInteger(&data, end, prefix, &index);
+         //Any error to report?
+         if(error) return error;
+
+         //Indexed name?
+         if(index != 0)
+         {
+            //Retrieve the name of the entry
+            error = hpackGetEntry(decoder, index, &name, &nameLength, &value, &valueLength);
+            //Invalid index?
+            if(error) return error;
+
+            //Copy the name
+            memcpy(decoder->field, name, min(nameLength, HPACK_MAX_FIELD_SIZE));
+         }
+         else
+         {
+            //Decode the literal name
+            error = hpackDecodeString(&data, end, decoder->field,
+               HPACK_MAX_FIELD_SIZE, &nameLength);
+            //Any error to report?
+            if(error) return error;
+         }
+
+         //Decode the literal value
+         if(nameLength < HPACK_MAX_FIELD_SIZE)
+         {
+            error = hpackDecodeString(&data, end, decoder->field + nameLength + 1,
+               HPACK_MAX_FIELD_SIZE - nameLength, &valueLength);
+         }
+         else
+         {
+            error = hpackDecodeString(&data, end, NULL, 0, &valueLength);
+         }
+
+         //Any error to report?
+         if(error) return error;
+
+         //Literal header field with incremental indexing?
+         if(prefix == 6)
+         {
+            //A field that was skipped cannot be added to the dynamic table
+            if((nameLength + valueLength) > HPACK_MAX_FIELD_SIZE &&
+               (HPACK_ENTRY_OVERHEAD + nameLength + valueLength) <= decoder->maxSize)
+            {
+               //Debug message
+               TRACE_WARNING("HPACK: header field too long to be indexed!\r\n");
+               //The compression context is lost
+               return ERROR_DECODING_FAILED;
+            }
+
+            //Insert the field into the dynamic table
+            hpackAddEntry(decoder, decoder->field, nameLength,
+               decoder->field + nameLength + 1, valueLength);
+         }
+
+         //Fields that are too long are skipped
+         if((nameLength + valueLength) > HPACK_MAX_FIELD_SIZE)
+            continue;
+      }
+
+      //Properly terminate the name and the value
+      decoder->field[nameLength] = '\0';
+      decoder->field[nameLength + 1 + valueLength] = '\0';
+
+      //Report the header field
+      error = callback(param, decoder->field, decoder->field + nameLength + 1);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Decode an integer
+ * @param[in,out] data Pointer to the current position in the header block
+ * @param[in] end Pointer to the end of the header block
+ * @param[in] prefixLength Number of bits of the first byte used by the integer
+ * @param[out] value Decoded value
+ * @return Error code
+ **/
+
+error_t hpackDecodeInteger(const uint8_t **data, const uint8_t *end,
+   uint_t prefixLength, uint32_t *value)
+{
+   uint_t m;
+   uint8_t b;
+   uint8_t mask;
+   const uint8_t *p;
+
+   //Point to the current position
+   p = *data;
+
+   //Malformed header block?
+   if(p >= end)
+      return ERROR_DECODING_FAILED;
+
+   //The value is first encoded in the prefix of the first byte
+   mask = (1 << prefixLength) - 1;
+   *value = *(p++) & mask;
+
+   //Values that do not fit in the prefix are continued on the next bytes
+   if(*value == mask)
+   {
+      //Seven bits are carried by each subsequent byte
+      for(m = 0; ; m += 7)
+      {
+         //Truncated integer or value too large?
+         if(p >= end || m > 21)
+            return ERROR_DECODING_FAILED;
+
+         //Accumulate the next 7 bits
+         b = *(p++);
+         *value += (b & 0x7F) << m;
+
+         //The most significant bit is cleared on the last byte
+         if(!(b & 0x80))
+            break;
+      }
+   }
+
+   //Advance data pointer
+   *data = p;
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Decode a string literal
+ * @param[in,out] data Pointer to the current position in the header block
+ * @param[in] end Pointer to the end of the header block
+ * @param[out] buffer Output buffer
+ * @param[in] size Size of the output buffer
+ * @param[out] length Length of the decoded string, which may exceed
+ *   the size of the output buffer
+ * @return Error code
+ **/
+
+error_t hpackDecodeString(const uint8_t **data, const uint8_t *end,
+   char_t *buffer, size_t size, size_t *length)
+{
+   error_t error;
+   bool_t huffman;
+   uint32_t n;
+
+   //Malformed header block?
+   if(*data >= end)
+      return ERROR_DECODING_FAILED;
+
+   //The H bit indicates whether the string is Huffman-encoded
+   huffman = (**data & 0x80) ? TRUE : FALSE;
+
+   //Decode the length of the string
+   error = hpackDecodeInteger(data, end, 7, &n);
+   //Any error to report?
+   if(error) return error;
+
+   //Truncated string?
+   if(n > (size_t) (end - *data))
+      return ERROR_DECODING_FAILED;
+
+   //Huffman-encoded string?
+   if(huffman)
+   {
+      //Decode the string
+      error = hpackHuffmanDecode(*data, n, buffer, size, length);
+      //Any error to report?
+      if(error) return error;
+   }
+   else
+   {
+      //Copy as much data as possible
+      memcpy(buffer, *data, min(n, size));
+      //Length of the string
+      *length = n;
+   }
+
+   //Advance data pointer
+   *data += n;
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Decode a Huffman-encoded string
+ * @param[in] data Pointer to the encoded string
+ * @param[in] length Length of the encoded string
+ * @param[out] buffer Output buffer
+ * @param[in] size Size of the output buffer
+ * @param[out] written Length of the decoded string, which may exceed
+ *   the size of the output buffer
+ * @return Error code
+ **/
+
+error_t hpackHuffmanDecode(const uint8_t *data, size_t length,
+   char_t *buffer, size_t size, size_t *written)
+{
+   size_t i;
+   uint_t j;
+   uint_t n;
+   uint_t index;
+   uint_t count;
+   uint32_t code;
+   uint32_t first;
+   bool_t padding;
+
+   //Start with an empty code
+   code = 0;
+   first = 0;
+   index = 0;
+   n = 0;
+   padding = TRUE;
+
+   //No symbol has been decoded yet
+   *written = 0;
+
+   //Process the string bit by bit, most significant bit first
+   for(i = 0; i < length; i++)
+   {
+      for(j = 0; j < 8; j++)
+      {
+         //Append the next bit to the current code
+         if(data[i] & (0x80 >> j))
+            code |= 1;
+         else
+            padding = FALSE;
+
+         //Number of codes of the current length
+         count = hpackHuffmanCount[++n];
+
+         //The current code is a complete code of that length?
+         if((code - first) < count)
+         {
+            //Retrieve the index of the symbol
+            index += code - first;
+
+            //EOS must not appear in the string
+            if(index >= arraysize(hpackHuffmanSymbol))
+               return ERROR_DECODING_FAILED;
+
+            //Save the symbol, as long as it fits in the output buffer
+            if(*written < size)
+               buffer[*written] = hpackHuffmanSymbol[index];
+            (*written)++;
+
+            //Decode the next symbol
+            code = 0;
+            first = 0;
+            index = 0;
+            n = 0;
+            padding = TRUE;
+         }
+         //The longest code is 30 bits long
+         else if(n >= 30)
+         {
+            return ERROR_DECODING_FAILED;
+         }
+         else
+         {
+            //Skip the codes of the current length
+            index += count;
+            first = (first + count) << 1;
+            code <<= 1;
+         }
+      }
+   }
+
+   //The string must be padded with the most significant bits of EOS,
+   //and the padding cannot be longer than 7 bits
+   if(n > 7 || !padding)
+      return ERROR_DECODING_FAILED;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Retrieve an entry of the static or of the dynamic table
+ * @param[in] decoder Pointer to the HPACK decoder
+ * @param[in] index Index of the entry
+ * @param[out] name Name of the entry (not NULL-terminated)
+ * @param[out] nameLength Length of the name
+ * @param[out] value Value of the entry (not NULL-terminated)
+ * @param[out] valueLength Length of the value
+ * @return Error code
+ **/
+
+error_t hpackGetEntry(HpackDecoder *decoder, uint_t index, const char_t **name,
+   size_t *nameLength, const char_t **value, size_t *valueLength)
+{
+   uint_t i;
+   uint8_t *p;
+
+   //Index 0 is not used
+   if(index == 0)
+      return ERROR_DECODING_FAILED;
+
+   //Static table entry?
+   if(index <= HPACK_STATIC_TABLE_SIZE)
+   {
+      //Point to the entry
+      *name = hpackStaticTable[index - 1].name;
+      *value = hpackStaticTable[index - 1].value;
+      //Retrieve the length of the name and of the value
+      *nameLength = strlen(*name);
+      *valueLength = strlen(*value);
+
+      //Successful processing
+      return NO_ERROR;
+   }
+
+   //The dynamic table is indexed from the newest entry
+   index -= HPACK_STATIC_TABLE_SIZE + 1;
+
+   //Invalid index?
+   if(index >= decoder->count)
+      return ERROR_DECODING_FAILED;
+
+   //The entries are stored oldest first
+   p = decoder->entries;
+
+   //Skip the older entries
+   for(i = decoder->count - 1; i > index; i--)
+      p += 4 + LOAD16BE(p) + LOAD16BE(p + 2);
+
+   //Retrieve the length of the name and of the value
+   *nameLength = LOAD16BE(p);
+   *valueLength = LOAD16BE(p + 2);
+   //Point to the name and to the value
+   *name = (char_t *) p + 4;
+   *value = (char_t *) p + 4 + *nameLength;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Add an entry to the dynamic table
+ * @param[in] decoder Pointer to the HPACK decoder
+ * @param[in] name Name of the header field
+ * @param[in] nameLength Length of the name
+ * @param[in] value Value of the header field
+ * @param[in] valueLength Length of the value
+ **/
+
+void hpackAddEntry(HpackDecoder *decoder, const char_t *name,
+   size_t nameLength, const char_t *value, size_t valueLength)
+{
+   size_t n;
+   uint8_t *p;
+
+   //Size of the new entry
+   n = HPACK_ENTRY_OVERHEAD + nameLength + valueLength;
+
+   //An entry larger than the maximum size empties the table
+   if(n > decoder->maxSize)
+   {
+      //Evict all the entries
+      hpackEvictEntries(decoder, 0);
+      //The entry is not added
+      return;
+   }
+
+   //Make room for the new entry
+   hpackEvictEntries(decoder, decoder->maxSize - n);
+
+   //Point to the end of the entry buffer
+   p = decoder->entries + decoder->length;
+
+   //Format the entry
+   STORE16BE(nameLength, p);
+   STORE16BE(valueLength, p + 2);
+   memcpy(p + 4, name, nameLength);
+   memcpy(p + 4 + nameLength, value, valueLength);
+
+   //Update the dynamic table
+   decoder->length += 4 + nameLength + valueLength;
+   decoder->size += n;
+   decoder->count++;
+}
+
+
+/**
+ * @brief Evict the oldest entries of the dynamic table
+ * @param[in] decoder Pointer to the HPACK decoder
+ * @param[in] maxSize Size the dynamic table must not exceed
+ **/
+
+void hpackEvictEntries(HpackDecoder *decoder, size_t maxSize)
+{
+   size_t n;
+   size_t offset;
+   uint8_t *p;
+
+   //Number of bytes occupied by the evicted entries
+   offset = 0;
+
+   //Evict entries until the table is small enough
+   while(decoder->size > maxSize)
+   {
+      //Point to the oldest entry
+      p = decoder->entries + offset;
+      //Length of the name and of the value
+      n = LOAD16BE(p) + LOAD16BE(p + 2);
+
+      //Remove the entry
+      decoder->size -= HPACK_ENTRY_OVERHEAD + n;
+      decoder->count--;
+      offset += 4 + n;
+   }
+
+   //Any entry evicted?
+   if(offset > 0)
+   {
+      //Move the remaining entries to the beginning of the buffer
+      memmove(decoder->entries, decoder->entries + offset, decoder->length - offset);
+      decoder->length -= offset;
+   }
+}
+
+
+/**
+ * @brief Encode an integer
+ * @param[out] p Output buffer
+ * @param[in] value Value to be encoded
+ * @param[in] prefixLength Number of bits of the first byte used by the integer
+ * @param[in] flags Bits that precede the prefix in the first byte
+ * @return Number of bytes written
+ **/
+
+size_t hpackEncodeInteger(uint8_t *p, uint32_t value, uint_t prefixLength, uint8_t flags)
+{
+   size_t n;
+   uint8_t mask;
+
+   //Maximum value of the prefix
+   mask = (1 << prefixLength) - 1;
+
+   //Small values fit in the prefix
+   if(value < mask)
+   {
+      p[0] = flags | value;
+      return 1;
+   }
+
+   //The prefix is filled with ones
+   p[0] = flags | mask;
+   value -= mask;
+
+   //The rest of the value is encoded 7 bits at a time
+   for(n = 1; value >= 0x80; n++)
+   {
+      p[n] = (value & 0x7F) | 0x80;
+      value >>= 7;
+   }
+
+   //Last byte
+   p[n++] = value;
+
+   //Return the number of bytes written
+   return n;
+}
+
+
+/**
+ * @brief Encode an indexed header field
+ * @param[out] p Output buffer
+ * @param[in] index Index of the entry in the static table
+ * @return Number of bytes written
+ **/
+
+size_t hpackEncodeIndexedField(uint8_t *p, uint_t index)
+{
+   //The index is encoded with a 7-bit prefix
+   return hpackEncodeInteger(p, index, 7, 0x80);
+}
+
+
+/**
+ * @brief Encode a literal header field without indexing
+ *
+ * The encoder does not maintain any dynamic table, so that the peer's
+ * decoder state is never modified
+ *
+ * @param[out] p Output buffer
+ * @param[in] nameIndex Index of the name in the static table (0 for a literal name)
+ * @param[in] name Literal name (used when nameIndex is 0)
+ * @param[in] value Value of the header field
+ * @return Number of bytes written
+ **/
+
+size_t hpackEncodeLiteralField(uint8_t *p, uint_t nameIndex, const char_t *name, const char_t *value)
+{
+   size_t n;
+
+   //The index of the name is encoded with a 4-bit prefix
+   n = hpackEncodeInteger(p, nameIndex, 4, 0x00);
+
+   //Literal name?
+   if(nameIndex == 0)
+      n += hpackEncodeString(p + n, name);
+
+   //Encode the value
+   n += hpackEncodeString(p + n, value);
+
+   //Return the number of bytes written
+   return n;
+}
+
+
+/**
+ * @brief Encode a string literal (no Huffman coding)
+ * @param[out] p Output buffer
+ * @param[in] s NULL-terminated string
+ * @return Number of bytes written
+ **/
+
+size_t hpackEncodeString(uint8_t *p, const char_t *s)
+{
+   size_t n;
+   size_t length;
+
+   //Length of the string
+   length = strlen(s);
+
+   //The length is encoded with a 7-bit prefix
+   n = hpackEncodeInteger(p, length, 7, 0x00);
+   //Copy the string
+   memcpy(p + n, s, length);
+
+   //Return the number of bytes written
+   return n + length;
+}
+
+
+/**
+ * @brief Search the static table for a header field
+ * @param[in] name Name of the header field
+ * @param[in] value Value of the header field
+ * @return Index of the matching entry, or 0 if none was found
+ **/
+
+uint_t hpackFindStaticEntry(const char_t *name, const char_t *value)
+{
+   uint_t i;
+
+   //Loop through the static table
+   for(i = 0; i < HPACK_STATIC_TABLE_SIZE; i++)
+   {
+      //Matching entry?
+      if(!strcmp(hpackStaticTable[i].name, name) &&
+         !strcmp(hpackStaticTable[i].value, value))
+      {
+         return i + 1;
+      }
+   }
+
+   //No matching entry
+   return 0;
+}
+
+#endif
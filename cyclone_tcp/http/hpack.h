@@ -0,0 +1,150 @@
+/**
+ * @file hpack.h
+ * @brief HPACK header compression for HTTP/2 (RFC 7541)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * HPACK encodes the header fields of HTTP/2 requests and responses by
+ * reference to a static table of common fields and to a dynamic table
+ * filled by the previous header blocks of the connection. Literal strings
+ * may be compressed with a static Huffman code
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+#ifndef _HPACK_H
+#define _HPACK_H
+
+//Dependencies
+#include "os.h"
+
+//Maximum size of the dynamic table maintained by the decoder
+#ifndef HPACK_TABLE_SIZE
+   #define HPACK_TABLE_SIZE 4096
+#elif (HPACK_TABLE_SIZE < 256 || HPACK_TABLE_SIZE > 65535)
+   #error HPACK_TABLE_SIZE parameter is invalid
+#endif
+
+//Maximum length of a decoded header field (name and value)
+#ifndef HPACK_MAX_FIELD_SIZE
+   #define HPACK_MAX_FIELD_SIZE 1024
+#elif (HPACK_MAX_FIELD_SIZE < 128)
+   #error HPACK_MAX_FIELD_SIZE parameter is invalid
+#endif
+
+//Number of entries in the static table
+#define HPACK_STATIC_TABLE_SIZE 61
+//Overhead accounted for each entry of the dynamic table
+#define HPACK_ENTRY_OVERHEAD 32
+
+
+/**
+ * @brief Static table indexes used by the encoder
+ **/
+
+typedef enum
+{
+   HPACK_INDEX_STATUS           = 8,
+   HPACK_INDEX_ACCEPT_RANGES    = 18,
+   HPACK_INDEX_CACHE_CONTROL    = 24,
+   HPACK_INDEX_CONTENT_ENCODING = 26,
+   HPACK_INDEX_CONTENT_LENGTH   = 28,
+   HPACK_INDEX_CONTENT_RANGE    = 30,
+   HPACK_INDEX_CONTENT_TYPE     = 31,
+   HPACK_INDEX_ETAG             = 34,
+   HPACK_INDEX_SERVER           = 54,
+   HPACK_INDEX_VARY             = 59
+} HpackStaticIndex;
+
+
+/**
+ * @brief Static table entry
+ **/
+
+typedef struct
+{
+   const char_t *name;
+   const char_t *value;
+} HpackStaticEntry;
+
+
+/**
+ * @brief Callback invoked for each decoded header field
+ **/
+
+typedef error_t (*HpackFieldCallback)(void *param, const char_t *name, const char_t *value);
+
+
+/**
+ * @brief HPACK decoder
+ *
+ * The entries of the dynamic table are stored oldest first, each one
+ * being made of the 16-bit lengths of the name and of the value followed
+ * by the name and the value themselves. An entry occupies less memory
+ * than the 32-byte overhead it is accounted for, so that a table of
+ * HPACK_TABLE_SIZE bytes always fits in the buffer
+ *
+ **/
+
+typedef struct
+{
+   size_t limit;                          ///<Maximum table size allowed by the settings
+   size_t maxSize;                        ///<Maximum table size selected by the encoder
+   size_t size;                           ///<Current table size
+   uint_t count;                          ///<Number of entries in the dynamic table
+   size_t length;                         ///<Number of bytes used in the entry buffer
+   uint8_t entries[HPACK_TABLE_SIZE];     ///<Dynamic table entries
+   char_t field[HPACK_MAX_FIELD_SIZE + 2]; ///<Header field being decoded
+} HpackDecoder;
+
+
+//HPACK related functions
+void hpackInitDecoder(HpackDecoder *decoder, size_t limit);
+
+error_t hpackDecodeHeaderBlock(HpackDecoder *decoder, const uint8_t *data,
+   size_t length, HpackFieldCallback callback, void *param);
+
+error_t hpackDecodeInteger(const uint8_t **data, const uint8_t *end,
+   uint_t prefixLength, uint32_t *value);
+
+error_t hpackDecodeString(const uint8_t **data, const uint8_t *end,
+   char_t *buffer, size_t size, size_t *length);
+
+error_t hpackHuffmanDecode(const uint8_t *data, size_t length,
+   char_t *buffer, size_t size, size_t *written);
+
+error_t hpackGetEntry(HpackDecoder *decoder, uint_t index, const char_t **name,
+   size_t *nameLength, const char_t **value, size_t *valueLength);
+
+void hpackAddEntry(HpackDecoder *decoder, const char_t *name,
+   size_t nameLength, const char_t *value, size_t valueLength);
+
+void hpackEvictEntries(HpackDecoder *decoder, size_t maxSize);
+
+size_t hpackEncodeInteger(uint8_t *p, uint32_t value, uint_t prefixLength, uint8_t flags);
+size_t hpackEncodeIndexedField(uint8_t *p, uint_t index);
+size_t hpackEncodeLiteralField(uint8_t *p, uint_t nameIndex, const char_t *name, const char_t *value);
+size_t hpackEncodeString(uint8_t *p, const char_t *s);
+uint_t hpackFindStaticEntry(const char_t *name, const char_t *value);
+
+#endif
@@ -1,5 +1,9 @@
 CYCLONETCPSRC += $(CYCLONETCP)/cyclone_tcp/http/http_server.c \
+				 $(CYCLONETCP)/cyclone_tcp/http/http_client.c \
+				 $(CYCLONETCP)/cyclone_tcp/http/http2.c \
+				 $(CYCLONETCP)/cyclone_tcp/http/hpack.c \
 				 $(CYCLONETCP)/cyclone_tcp/http/mime.c \
 				 $(CYCLONETCP)/cyclone_tcp/http/ssl.c \
+				 $(CYCLONETCP)/cyclone_tcp/http/web_socket.c \
 
 CYCLONETCPINC += $(CYCLONETCP)/cyclone_tcp/http/
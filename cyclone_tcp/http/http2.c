@@ -0,0 +1,2080 @@
+/**
+ * @file http2.c
+ * @brief HTTP/2 server (RFC 7540)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The server accepts HTTP/2 connections negotiated through the ALPN
+ * extension of the TLS handshake. Each request is translated into its
+ * HTTP/1.1 equivalent and handed over to the regular request handlers, so
+ * that routes, SSI scripts and static resources are served unchanged.
+ * The request handlers run one at a time, by order of stream creation, but
+ * the responses are multiplexed: each stream keeps the data generated by its
+ * handler, and DATA frames are interleaved across the open streams within
+ * the limits of their flow-control windows. Static resources are referenced
+ * rather than copied, so a large or slowly consumed resource does not delay
+ * the responses on the other streams. Requests with a body are only accepted
+ * when they can be processed immediately; they are refused otherwise so that
+ * the client may retry them
+ *
+ * Only the connection-per-task model is supported. The event-driven engine
+ * serves HTTP/1.1 over plain TCP connections
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+//Switch to the appropriate trace level
+#define TRACE_LEVEL HTTP_TRACE_LEVEL
+
+//Dependencies
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include "tcp_ip_stack.h"
+#include "http_server.h"
+#include "http2.h"
+#include "hpack.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+
+
+/**
+ * @brief Check whether HTTP/2 has been negotiated during the TLS handshake
+ * @param[in] connection Structure representing an HTTP connection
+ * @return TRUE if the client selected HTTP/2, else FALSE
+ **/
+
+bool_t http2IsNegotiated(HttpConnection *connection)
+{
+   const char_t *protocol;
+
+   //Retrieve the protocol selected through ALPN
+   protocol = tlsGetAlpnProtocol(connection->tlsContext);
+
+   //Clients that do not support ALPN keep using HTTP/1.1
+   if(protocol == NULL)
+      return FALSE;
+
+   //Check the protocol identifier
+   return !strcmp(protocol, HTTP2_ALPN_PROTOCOL) ? TRUE : FALSE;
+}
+
+
+/**
+ * @brief Serve an HTTP/2 connection
+ *
+ * The function returns when the client closes the connection, when a
+ * connection error occurs or when the maximum number of requests has
+ * been reached
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t http2ProcessConnection(HttpConnection *connection)
+{
+   error_t error;
+   Http2Context *context;
+
+   //Allocate the HTTP/2 connection state
+   context = osMemAlloc(sizeof(Http2Context));
+   //Failed to allocate memory?
+   if(!context) return ERROR_OUT_OF_MEMORY;
+
+   //Initialize the connection state
+   memset(context, 0, sizeof(Http2Context));
+   hpackInitDecoder(&context->decoder, HPACK_TABLE_SIZE);
+
+   //Initial flow-control parameters
+   context->peerWindowSize = HTTP2_DEFAULT_WINDOW_SIZE;
+   context->peerMaxFrameSize = HTTP2_DEFAULT_MAX_FRAME_SIZE;
+   context->txConnWindow = HTTP2_DEFAULT_WINDOW_SIZE;
+
+   //Attach the state to the connection
+   connection->http2 = context;
+
+   //The client connection preface starts with a fixed sequence
+   error = http2ReadPayload(connection, context->rxFrame, HTTP2_PREFACE_SIZE);
+
+   //Check the connection preface
+   if(!error && memcmp(context->rxFrame, HTTP2_PREFACE, HTTP2_PREFACE_SIZE))
+      error = http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+   //The server connection preface consists of a SETTINGS frame
+   if(!error)
+      error = http2SendSettings(connection);
+
+   //Process incoming frames
+   while(!error)
+   {
+      //Any request waiting to be processed?
+      if(http2GetQueuedStream(context) != NULL)
+      {
+         //Run the request handler of the oldest stream
+         error = http2ProcessStream(connection);
+      }
+      //Any data that can be sent? Incoming frames are processed first, so
+      //that new requests are not delayed by the responses in progress
+      else if(http2IsAnyStreamReady(context) && !http2IsInputPending(connection))
+      {
+         //Send a DATA frame on each stream that has data to send
+         error = http2SendPending(connection);
+      }
+      //No more requests can be accepted?
+      else if((context->goAway || context->requestCount >= HTTP_SERVER_MAX_REQUESTS) &&
+         !http2HasOpenStreams(context))
+      {
+         break;
+      }
+      else
+      {
+         //Wait for the next frame
+         error = http2ReceiveFrame(connection);
+      }
+   }
+
+   //The connection is still usable?
+   if(!context->failure || context->failure == ERROR_INVALID_REQUEST)
+   {
+      //Inform the client that no more streams will be processed
+      http2SendGoAway(connection);
+   }
+
+   //Debug message
+   TRACE_INFO("HTTP/2 connection closed (%u requests)...\r\n", context->requestCount);
+
+   //Release the connection state
+   connection->http2 = NULL;
+   osMemFree(context);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Run the request handler of the oldest queued stream
+ *
+ * The response is kept by the stream. Once the handler has completed, the
+ * stream is closed as soon as the rest of the response has been sent
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code (connection-level errors only)
+ **/
+
+error_t http2ProcessStream(HttpConnection *connection)
+{
+   error_t error;
+   Http2Context *context;
+   Http2Stream *stream;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+   //Point to the oldest queued stream
+   stream = http2GetQueuedStream(context);
+
+   //The stream becomes the active stream
+   stream->state = HTTP2_STREAM_STATE_ACTIVE;
+   stream->headerSent = FALSE;
+   context->active = stream;
+   context->rxStreamConsumed = 0;
+
+   //The input and output buffers are initially empty
+   connection->rxOffset = 0;
+   connection->rxLength = 0;
+   connection->txOffset = 0;
+   connection->txLength = 0;
+
+   //Translate the header fields
+   error = http2ParseRequest(connection, stream);
+
+   //Number of requests processed on this connection
+   context->requestCount++;
+
+   //Check status code
+   if(!error)
+   {
+      //Debug message
+      TRACE_INFO("Processing HTTP/2 request on stream %u...\r\n", stream->id);
+      //Generate the response
+      error = httpProcessRequest(connection);
+   }
+
+   //Send an error page if necessary. The connection itself is not affected
+   //by the outcome of the request
+   httpTerminateRequest(connection, error);
+
+   //The client is still waiting for the end of the response?
+   if(!context->failure && !stream->reset)
+   {
+      //Complete response?
+      if(stream->headerSent && (!error || error == ERROR_NOT_FOUND ||
+         error == ERROR_INVALID_REQUEST))
+      {
+         //Move the data left in the output buffer to the stream
+         error = httpFlushStream(connection);
+      }
+      else
+      {
+         //The request handler failed to generate a response
+         error = ERROR_FAILURE;
+      }
+
+      //Check status code
+      if(!error)
+      {
+         //The stream is closed once the response has been entirely sent
+         stream->state = HTTP2_STREAM_STATE_CLOSING;
+         //The rest of the request body is no longer needed
+         stream->discardBody = !stream->endStream;
+      }
+      else if(!stream->reset && !context->failure)
+      {
+         //The response cannot be completed
+         http2SendRstStream(connection, stream->id, HTTP2_ERROR_INTERNAL_ERROR);
+         //The stream is now closed
+         stream->reset = TRUE;
+      }
+   }
+
+   //Discard the data left in the output buffer
+   connection->txOffset = 0;
+   connection->txLength = 0;
+
+   //Skip the unread part of the current DATA frame
+   if(!context->failure)
+      http2DiscardData(connection);
+
+   //The stream is closed if no more data can be sent
+   if(stream->state != HTTP2_STREAM_STATE_CLOSING)
+      stream->state = HTTP2_STREAM_STATE_IDLE;
+
+   //No request handler is running
+   context->active = NULL;
+
+   //Only connection-level errors are reported
+   return context->failure;
+}
+
+
+/**
+ * @brief Translate the header fields of a stream into an HTTP/1.1 request
+ *
+ * The pseudo-header fields are turned into a Request-Line, so that the
+ * request is parsed and processed exactly as an HTTP/1.1 request
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] stream Stream carrying the request
+ * @return Error code
+ **/
+
+error_t http2ParseRequest(HttpConnection *connection, Http2Stream *stream)
+{
+   error_t error;
+   size_t n;
+   char_t *p;
+   char_t *name;
+   char_t *value;
+   char_t *method;
+   char_t *path;
+
+   //Default properties, used when the request is badly formed
+   connection->request.method = HTTP_METHOD_GET;
+   connection->request.version = HTTP_VERSION_1_1;
+   connection->request.keepAlive = TRUE;
+
+   //Search for the :method and :path pseudo-header fields
+   method = NULL;
+   path = NULL;
+
+   //Loop through the header fields
+   for(p = stream->fields; p < stream->fields + stream->length; p = value + strlen(value) + 1)
+   {
+      //Each name is followed by its value
+      name = p;
+      value = name + strlen(name) + 1;
+
+      //Pseudo-header field?
+      if(!strcmp(name, ":method"))
+         method = value;
+      else if(!strcmp(name, ":path"))
+         path = value;
+   }
+
+   //Both fields are mandatory
+   if(method == NULL || path == NULL)
+      return ERROR_INVALID_REQUEST;
+
+   //Format the equivalent Request-Line
+   n = snprintf(connection->buffer, HTTP_SERVER_BUFFER_SIZE,
+      "%s %s HTTP/1.1", method, path);
+
+   //The Request-Line must fit in the buffer
+   if(n >= HTTP_SERVER_BUFFER_SIZE)
+      return ERROR_INVALID_REQUEST;
+
+   //Parse the Request-Line
+   error = httpParseRequestLine(connection, connection->buffer);
+   //Any error to report?
+   if(error) return error;
+
+   //Loop through the header fields
+   for(p = stream->fields; p < stream->fields + stream->length; p = value + strlen(value) + 1)
+   {
+      //Each name is followed by its value
+      name = p;
+      value = name + strlen(name) + 1;
+
+      //Pseudo-header fields have already been processed
+      if(name[0] == ':')
+         continue;
+
+      //Format the equivalent header field
+      n = snprintf(connection->buffer, HTTP_SERVER_BUFFER_SIZE,
+         "%s: %s", name, value);
+
+      //Fields that do not fit in the buffer are ignored
+      if(n < HTTP_SERVER_BUFFER_SIZE)
+      {
+         //Parse the header field
+         httpParseHeaderField(connection, connection->buffer);
+      }
+   }
+
+   //HTTP/2 has its own framing and does not support protocol upgrades
+   connection->request.chunkedEncoding = FALSE;
+#if (HTTP_SERVER_WEB_SOCKET_SUPPORT == ENABLED)
+   connection->request.upgradeWebSocket = FALSE;
+#endif
+
+   //Prepare to read the request body
+   httpInitRequestBody(connection);
+
+   //The request has no body?
+   if(stream->endStream)
+      connection->request.byteCount = 0;
+   //The content-length header field is optional
+   else if(!connection->request.contentLength)
+      connection->request.byteCount = UINT_MAX;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Search for an open stream
+ * @param[in] context Pointer to the HTTP/2 connection state
+ * @param[in] id Stream identifier
+ * @return Pointer to the matching stream or NULL if the stream is not open
+ **/
+
+Http2Stream *http2FindStream(Http2Context *context, uint32_t id)
+{
+   uint_t i;
+
+   //Loop through the streams
+   for(i = 0; i < HTTP2_SERVER_MAX_STREAMS; i++)
+   {
+      //Matching stream?
+      if(context->streams[i].state != HTTP2_STREAM_STATE_IDLE &&
+         context->streams[i].id == id)
+      {
+         return &context->streams[i];
+      }
+   }
+
+   //The stream is not open
+   return NULL;
+}
+
+
+/**
+ * @brief Get the oldest stream whose request waits to be processed
+ * @param[in] context Pointer to the HTTP/2 connection state
+ * @return Pointer to the oldest queued stream or NULL if there is none
+ **/
+
+Http2Stream *http2GetQueuedStream(Http2Context *context)
+{
+   uint_t i;
+   Http2Stream *stream;
+
+   //Stream identifiers increase monotonically
+   stream = NULL;
+
+   //Loop through the streams
+   for(i = 0; i < HTTP2_SERVER_MAX_STREAMS; i++)
+   {
+      //Keep track of the queued stream with the lowest identifier
+      if(context->streams[i].state == HTTP2_STREAM_STATE_QUEUED)
+      {
+         if(stream == NULL || context->streams[i].id < stream->id)
+            stream = &context->streams[i];
+      }
+   }
+
+   //Return the oldest queued stream
+   return stream;
+}
+
+
+/**
+ * @brief Check whether any stream is open
+ * @param[in] context Pointer to the HTTP/2 connection state
+ * @return TRUE if at least one stream is open, else FALSE
+ **/
+
+bool_t http2HasOpenStreams(Http2Context *context)
+{
+   uint_t i;
+
+   //Loop through the streams
+   for(i = 0; i < HTTP2_SERVER_MAX_STREAMS; i++)
+   {
+      //Open stream?
+      if(context->streams[i].state != HTTP2_STREAM_STATE_IDLE)
+         return TRUE;
+   }
+
+   //All the streams are closed
+   return FALSE;
+}
+
+
+/**
+ * @brief Check whether a frame can be sent on a stream
+ * @param[in] context Pointer to the HTTP/2 connection state
+ * @param[in] stream Pointer to the stream
+ * @return TRUE if a DATA frame can be sent right away, else FALSE
+ **/
+
+bool_t http2IsStreamReady(Http2Context *context, Http2Stream *stream)
+{
+   //Only the streams whose request has been processed carry data
+   if(stream->state != HTTP2_STREAM_STATE_ACTIVE &&
+      stream->state != HTTP2_STREAM_STATE_CLOSING)
+   {
+      return FALSE;
+   }
+
+   //The stream has been reset?
+   if(stream->reset)
+      return FALSE;
+
+   //Any data waiting to be sent?
+   if(stream->txOffset < stream->txLength || stream->dataLength > 0)
+   {
+      //The data is subject to flow control
+      return (context->txConnWindow > 0 && stream->txWindow > 0) ? TRUE : FALSE;
+   }
+
+   //The end of a complete response is signaled by an empty DATA frame
+   return (stream->state == HTTP2_STREAM_STATE_CLOSING) ? TRUE : FALSE;
+}
+
+
+/**
+ * @brief Check whether a frame can be sent on any stream
+ * @param[in] context Pointer to the HTTP/2 connection state
+ * @return TRUE if a DATA frame can be sent right away, else FALSE
+ **/
+
+bool_t http2IsAnyStreamReady(Http2Context *context)
+{
+   uint_t i;
+
+   //Loop through the streams
+   for(i = 0; i < HTTP2_SERVER_MAX_STREAMS; i++)
+   {
+      //Can a frame be sent on the current stream?
+      if(http2IsStreamReady(context, &context->streams[i]))
+         return TRUE;
+   }
+
+   //No frame can be sent for the moment
+   return FALSE;
+}
+
+
+/**
+ * @brief Check whether incoming data can be read without blocking
+ * @param[in] connection Structure representing an HTTP connection
+ * @return TRUE if some data is waiting to be read, else FALSE
+ **/
+
+bool_t http2IsInputPending(HttpConnection *connection)
+{
+   uint_t eventFlags;
+
+   //Data already decrypted by the TLS layer?
+   if(tlsIsRxReady(connection->tlsContext))
+      return TRUE;
+
+   //Retrieve the current state of the socket
+   socketGetEvents(connection->socket, &eventFlags);
+
+   //Any data waiting in the receive buffer of the socket?
+   return (eventFlags & SOCKET_EVENT_RX_READY) ? TRUE : FALSE;
+}
+
+
+/**
+ * @brief Store a header field of a queued request
+ * @param[in] param Pointer to the stream
+ * @param[in] name Name of the header field
+ * @param[in] value Value of the header field
+ * @return Error code
+ **/
+
+error_t http2StoreField(void *param, const char_t *name, const char_t *value)
+{
+   size_t n;
+   size_t m;
+   Http2Stream *stream;
+
+   //Point to the stream
+   stream = (Http2Stream *) param;
+
+   //Length of the name and of the value
+   n = strlen(name) + 1;
+   m = strlen(value) + 1;
+
+   //Not enough room to store the field?
+   if((stream->length + n + m) > HTTP2_SERVER_HEADER_LIST_SIZE)
+   {
+      //Debug message
+      TRACE_WARNING("HTTP/2 header field %s dropped...\r\n", name);
+      //The field is ignored
+      return NO_ERROR;
+   }
+
+   //Append the field to the list
+   memcpy(stream->fields + stream->length, name, n);
+   memcpy(stream->fields + stream->length + n, value, m);
+   stream->length += n + m;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Ignore a header field
+ *
+ * Used for the header blocks that do not start a request (trailers,
+ * refused streams). They must be decoded anyway to keep the HPACK
+ * decoder synchronized with the client
+ *
+ * @param[in] param Unused parameter
+ * @param[in] name Name of the header field
+ * @param[in] value Value of the header field
+ * @return Error code
+ **/
+
+error_t http2DiscardField(void *param, const char_t *name, const char_t *value)
+{
+   //The field is ignored
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Receive and process a frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t http2ReceiveFrame(HttpConnection *connection)
+{
+   error_t error;
+   Http2Context *context;
+   Http2FrameHeader header;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+
+   //The connection is no longer usable?
+   if(context->failure)
+      return context->failure;
+
+   //Skip the unread part of the previous DATA frame
+   error = http2DiscardData(connection);
+   //Any error to report?
+   if(error) return error;
+
+   //Read the frame header
+   error = http2ReadFrameHeader(connection, &header);
+   //Any error to report?
+   if(error) return error;
+
+   //The server never announces a larger SETTINGS_MAX_FRAME_SIZE
+   if(header.length > HTTP2_DEFAULT_MAX_FRAME_SIZE)
+      return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+
+   //Check frame type
+   switch(header.type)
+   {
+   //DATA frame?
+   case HTTP2_FRAME_DATA:
+      error = http2ProcessData(connection, &header);
+      break;
+   //HEADERS frame?
+   case HTTP2_FRAME_HEADERS:
+      error = http2ProcessHeaders(connection, &header);
+      break;
+   //RST_STREAM frame?
+   case HTTP2_FRAME_RST_STREAM:
+      error = http2ProcessRstStream(connection, &header);
+      break;
+   //SETTINGS frame?
+   case HTTP2_FRAME_SETTINGS:
+      error = http2ProcessSettings(connection, &header);
+      break;
+   //PING frame?
+   case HTTP2_FRAME_PING:
+      error = http2ProcessPing(connection, &header);
+      break;
+   //GOAWAY frame?
+   case HTTP2_FRAME_GOAWAY:
+      error = http2ProcessGoAway(connection, &header);
+      break;
+   //WINDOW_UPDATE frame?
+   case HTTP2_FRAME_WINDOW_UPDATE:
+      error = http2ProcessWindowUpdate(connection, &header);
+      break;
+   //Clients cannot push streams, and CONTINUATION frames must
+   //immediately follow a HEADERS frame
+   case HTTP2_FRAME_PUSH_PROMISE:
+   case HTTP2_FRAME_CONTINUATION:
+      error = http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+      break;
+   //PRIORITY frame or unknown frame type?
+   default:
+      //Streams are processed in order of creation and share the
+      //bandwidth equally, so the prioritization scheme is ignored
+      error = http2ReadPayload(connection, NULL, header.length);
+      break;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Process a DATA frame
+ *
+ * Only the frame header and the padding length are read here. The data
+ * itself is read by the request handler through http2ReceiveData()
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] header Frame header
+ * @return Error code
+ **/
+
+error_t http2ProcessData(HttpConnection *connection, const Http2FrameHeader *header)
+{
+   error_t error;
+   size_t n;
+   uint8_t padLength;
+   Http2Context *context;
+   Http2Stream *stream;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+
+   //DATA frames must be associated with a stream
+   if(!header->streamId)
+      return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+   //Length of the data
+   n = header->length;
+   padLength = 0;
+
+   //Padded frame?
+   if(header->flags & HTTP2_FLAG_PADDED)
+   {
+      //Malformed frame?
+      if(!n)
+         return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+      //Read the padding length
+      error = http2ReadPayload(connection, &padLength, 1);
+      //Any error to report?
+      if(error) return error;
+
+      //The padding cannot exceed the remaining payload
+      if(padLength >= n)
+         return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+      //Length of the data
+      n -= padLength + 1;
+   }
+
+   //Point to the stream whose request handler is running
+   stream = context->active;
+
+   //Request body of the active stream?
+   if(stream != NULL && header->streamId == stream->id &&
+      !stream->endStream && !stream->reset)
+   {
+      //The padding counts against the flow-control windows
+      error = http2ConsumeData(connection, header->length - n, TRUE);
+      //Any error to report?
+      if(error) return error;
+
+      //The data is read by the request handler
+      context->rxDataLength = n;
+      context->rxPadding = padLength;
+
+      //Last frame of the request?
+      if(header->flags & HTTP2_FLAG_END_STREAM)
+         stream->endStream = TRUE;
+   }
+   //Stream that has not been opened yet?
+   else if(header->streamId > context->lastStreamId)
+   {
+      //Report a connection error
+      return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+   }
+   else
+   {
+      //The data counts against the connection flow-control window
+      error = http2ConsumeData(connection, header->length, FALSE);
+      //Any error to report?
+      if(error) return error;
+
+      //Discard the data
+      error = http2ReadPayload(connection, NULL, n + padLength);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Process a HEADERS frame and the CONTINUATION frames that follow
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] header Frame header
+ * @return Error code
+ **/
+
+error_t http2ProcessHeaders(HttpConnection *connection, const Http2FrameHeader *header)
+{
+   error_t error;
+   uint_t i;
+   size_t n;
+   size_t length;
+   uint8_t flags;
+   uint8_t *p;
+   Http2Context *context;
+   Http2Stream *stream;
+   Http2FrameHeader continuation;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+
+   //The header block must fit in the receive buffer
+   if(header->length > HTTP2_SERVER_RX_FRAME_SIZE)
+      return http2ConnectionError(connection, HTTP2_ERROR_COMPRESSION_ERROR);
+
+   //Read the frame payload
+   error = http2ReadPayload(connection, context->rxFrame, header->length);
+   //Any error to report?
+   if(error) return error;
+
+   //Point to the header block fragment
+   p = context->rxFrame;
+   n = header->length;
+
+   //Padded frame?
+   if(header->flags & HTTP2_FLAG_PADDED)
+   {
+      //The padding cannot exceed the remaining payload
+      if(!n || p[0] >= n)
+         return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+      //Strip the padding
+      n -= p[0] + 1;
+      p++;
+   }
+
+   //Priority information present?
+   if(header->flags & HTTP2_FLAG_PRIORITY)
+   {
+      //Malformed frame?
+      if(n < 5)
+         return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+      //Streams are processed in order of creation and share the
+      //bandwidth equally, so the prioritization scheme is ignored
+      n -= 5;
+      p += 5;
+   }
+
+   //Move the header block fragment to the beginning of the buffer
+   memmove(context->rxFrame, p, n);
+   length = n;
+   flags = header->flags;
+
+   //The header block may be split into several frames
+   while(!(flags & HTTP2_FLAG_END_HEADERS))
+   {
+      //Read the next frame header
+      error = http2ReadFrameHeader(connection, &continuation);
+      //Any error to report?
+      if(error) return error;
+
+      //No other frame can be interleaved with the header block
+      if(continuation.type != HTTP2_FRAME_CONTINUATION ||
+         continuation.streamId != header->streamId)
+      {
+         return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+      }
+
+      //The header block must fit in the receive buffer
+      if((length + continuation.length) > HTTP2_SERVER_RX_FRAME_SIZE)
+         return http2ConnectionError(connection, HTTP2_ERROR_COMPRESSION_ERROR);
+
+      //Read the header block fragment
+      error = http2ReadPayload(connection, context->rxFrame + length, continuation.length);
+      //Any error to report?
+      if(error) return error;
+
+      //Total length of the header block
+      length += continuation.length;
+      flags |= continuation.flags & HTTP2_FLAG_END_HEADERS;
+   }
+
+   //Point to the stream whose request handler is running
+   stream = context->active;
+
+   //Trailers of the active stream?
+   if(stream != NULL && header->streamId == stream->id)
+   {
+      //Trailers are only allowed at the end of the request body
+      if(stream->endStream || !(header->flags & HTTP2_FLAG_END_STREAM))
+         return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+      //Trailer fields are not used
+      error = hpackDecodeHeaderBlock(&context->decoder, context->rxFrame,
+         length, http2DiscardField, NULL);
+
+      //The request body is complete
+      stream->endStream = TRUE;
+   }
+   //New stream?
+   else if((header->streamId & 1) && header->streamId > context->lastStreamId)
+   {
+      //Stream identifiers must increase monotonically
+      context->lastStreamId = header->streamId;
+
+      //Search for a free entry
+      for(i = 0; i < HTTP2_SERVER_MAX_STREAMS; i++)
+      {
+         if(context->streams[i].state == HTTP2_STREAM_STATE_IDLE)
+            break;
+      }
+
+      //Requests with a body are only accepted when they can be processed
+      //immediately, as the client would otherwise block while waiting for
+      //the stream to be served
+      if(i < HTTP2_SERVER_MAX_STREAMS && ((header->flags & HTTP2_FLAG_END_STREAM) ||
+         (context->active == NULL && http2GetQueuedStream(context) == NULL)))
+      {
+         //Point to the free entry
+         stream = &context->streams[i];
+
+         //Initialize the stream
+         stream->id = header->streamId;
+         stream->endStream = (header->flags & HTTP2_FLAG_END_STREAM) ? TRUE : FALSE;
+         stream->reset = FALSE;
+         stream->headerSent = FALSE;
+         stream->discardBody = FALSE;
+         stream->txWindow = context->peerWindowSize;
+         stream->length = 0;
+         stream->txOffset = 0;
+         stream->txLength = 0;
+         stream->data = NULL;
+         stream->dataLength = 0;
+
+         //Decode the header fields
+         error = hpackDecodeHeaderBlock(&context->decoder, context->rxFrame,
+            length, http2StoreField, stream);
+
+         //Add the stream to the queue
+         if(!error)
+            stream->state = HTTP2_STREAM_STATE_QUEUED;
+      }
+      else
+      {
+         //The header block must be decoded anyway
+         error = hpackDecodeHeaderBlock(&context->decoder, context->rxFrame,
+            length, http2DiscardField, NULL);
+
+         //The client may retry the request later
+         if(!error)
+            error = http2SendRstStream(connection, header->streamId, HTTP2_ERROR_REFUSED_STREAM);
+      }
+   }
+   //Stream that has been closed or refused?
+   else if((header->streamId & 1) && header->streamId != 0)
+   {
+      //Keep the HPACK decoder synchronized
+      error = hpackDecodeHeaderBlock(&context->decoder, context->rxFrame,
+         length, http2DiscardField, NULL);
+   }
+   else
+   {
+      //Streams initiated by the client use odd identifiers
+      return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+   }
+
+   //The compression context can no longer be maintained?
+   if(error == ERROR_DECODING_FAILED)
+      error = http2ConnectionError(connection, HTTP2_ERROR_COMPRESSION_ERROR);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Process a RST_STREAM frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] header Frame header
+ * @return Error code
+ **/
+
+error_t http2ProcessRstStream(HttpConnection *connection, const Http2FrameHeader *header)
+{
+   error_t error;
+   uint8_t payload[4];
+   Http2Context *context;
+   Http2Stream *stream;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+
+   //Check the length of the frame
+   if(header->length != sizeof(payload))
+      return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+   //RST_STREAM frames must be associated with a stream
+   if(!header->streamId)
+      return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+   //Read the error code
+   error = http2ReadPayload(connection, payload, sizeof(payload));
+   //Any error to report?
+   if(error) return error;
+
+   //Debug message
+   TRACE_INFO("HTTP/2 stream %u reset (error 0x%X)...\r\n",
+      header->streamId, LOAD32BE(payload));
+
+   //Search for the stream
+   stream = http2FindStream(context, header->streamId);
+
+   //Open stream?
+   if(stream != NULL)
+   {
+      //The request handler of the active stream is notified when it
+      //writes data. Other streams are closed immediately
+      if(stream == context->active)
+      {
+         //The response is abandoned
+         stream->reset = TRUE;
+         stream->endStream = TRUE;
+      }
+      else
+      {
+         //The stream is closed
+         stream->state = HTTP2_STREAM_STATE_IDLE;
+      }
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Process a SETTINGS frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] header Frame header
+ * @return Error code
+ **/
+
+error_t http2ProcessSettings(HttpConnection *connection, const Http2FrameHeader *header)
+{
+   error_t error;
+   size_t i;
+   uint_t j;
+   uint16_t id;
+   uint32_t value;
+   int32_t delta;
+   uint8_t payload[6];
+   Http2Context *context;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+
+   //SETTINGS frames apply to the whole connection
+   if(header->streamId)
+      return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+   //Acknowledgment of the server's settings?
+   if(header->flags & HTTP2_FLAG_ACK)
+   {
+      //An acknowledgment has an empty payload
+      if(header->length)
+         return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+      //Nothing else to do
+      return NO_ERROR;
+   }
+
+   //The payload is a list of 6-byte parameters
+   if(header->length % sizeof(payload))
+      return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+
+   //Process the parameters
+   for(i = 0; i < header->length; i += sizeof(payload))
+   {
+      //Read the current parameter
+      error = http2ReadPayload(connection, payload, sizeof(payload));
+      //Any error to report?
+      if(error) return error;
+
+      //Get the identifier and the value of the parameter
+      id = LOAD16BE(payload);
+      value = LOAD32BE(payload + 2);
+
+      //SETTINGS_ENABLE_PUSH parameter?
+      if(id == HTTP2_SETTINGS_ENABLE_PUSH)
+      {
+         //The server never pushes streams, but the value must be valid
+         if(value > 1)
+            return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+      }
+      //SETTINGS_INITIAL_WINDOW_SIZE parameter?
+      else if(id == HTTP2_SETTINGS_INITIAL_WINDOW_SIZE)
+      {
+         //Check the window size
+         if(value > HTTP2_MAX_WINDOW_SIZE)
+            return http2ConnectionError(connection, HTTP2_ERROR_FLOW_CONTROL_ERROR);
+
+         //The change applies to the windows of all the open streams
+         delta = (int32_t) value - (int32_t) context->peerWindowSize;
+
+         //Loop through the streams
+         for(j = 0; j < HTTP2_SERVER_MAX_STREAMS; j++)
+         {
+            //Skip unused entries
+            if(context->streams[j].state == HTTP2_STREAM_STATE_IDLE)
+               continue;
+
+            //The resulting window cannot exceed the maximum size
+            if(delta > 0 && context->streams[j].txWindow > (int32_t) (HTTP2_MAX_WINDOW_SIZE - delta))
+               return http2ConnectionError(connection, HTTP2_ERROR_FLOW_CONTROL_ERROR);
+
+            //Adjust the window of the current stream
+            context->streams[j].txWindow += delta;
+         }
+
+         //Save the new initial window size
+         context->peerWindowSize = value;
+      }
+      //SETTINGS_MAX_FRAME_SIZE parameter?
+      else if(id == HTTP2_SETTINGS_MAX_FRAME_SIZE)
+      {
+         //Check the frame size
+         if(value < HTTP2_DEFAULT_MAX_FRAME_SIZE || value > HTTP2_MAX_FRAME_SIZE)
+            return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+         //Save the largest frame size accepted by the client
+         context->peerMaxFrameSize = value;
+      }
+
+      //The other parameters do not apply (the encoder does not use
+      //the dynamic table and the server never initiates streams)
+   }
+
+   //Acknowledge the settings
+   return http2SendFrame(connection, HTTP2_FRAME_SETTINGS, HTTP2_FLAG_ACK, 0, 0);
+}
+
+
+/**
+ * @brief Process a PING frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] header Frame header
+ * @return Error code
+ **/
+
+error_t http2ProcessPing(HttpConnection *connection, const Http2FrameHeader *header)
+{
+   error_t error;
+   Http2Context *context;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+
+   //Check the length of the frame
+   if(header->length != 8)
+      return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+   //PING frames apply to the whole connection
+   if(header->streamId)
+      return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+   //The opaque data is copied to the response
+   error = http2ReadPayload(connection, context->txFrame + HTTP2_FRAME_HEADER_SIZE, 8);
+   //Any error to report?
+   if(error) return error;
+
+   //The server never sends PING requests
+   if(header->flags & HTTP2_FLAG_ACK)
+      return NO_ERROR;
+
+   //Send the PING response
+   return http2SendFrame(connection, HTTP2_FRAME_PING, HTTP2_FLAG_ACK, 0, 8);
+}
+
+
+/**
+ * @brief Process a GOAWAY frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] header Frame header
+ * @return Error code
+ **/
+
+error_t http2ProcessGoAway(HttpConnection *connection, const Http2FrameHeader *header)
+{
+   //Check the length of the frame
+   if(header->length < 8)
+      return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+   //GOAWAY frames apply to the whole connection
+   if(header->streamId)
+      return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+
+   //Debug message
+   TRACE_INFO("HTTP/2 GOAWAY frame received...\r\n");
+
+   //The connection is closed once the open streams have been processed
+   connection->http2->goAway = TRUE;
+
+   //The payload is not used
+   return http2ReadPayload(connection, NULL, header->length);
+}
+
+
+/**
+ * @brief Process a WINDOW_UPDATE frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] header Frame header
+ * @return Error code
+ **/
+
+error_t http2ProcessWindowUpdate(HttpConnection *connection, const Http2FrameHeader *header)
+{
+   error_t error;
+   uint32_t increment;
+   uint8_t payload[4];
+   Http2Context *context;
+   Http2Stream *stream;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+
+   //Check the length of the frame
+   if(header->length != sizeof(payload))
+      return http2ConnectionError(connection, HTTP2_ERROR_FRAME_SIZE_ERROR);
+
+   //Read the window size increment
+   error = http2ReadPayload(connection, payload, sizeof(payload));
+   //Any error to report?
+   if(error) return error;
+
+   //The most significant bit is reserved
+   increment = LOAD32BE(payload) & HTTP2_MAX_WINDOW_SIZE;
+
+   //Connection-level window?
+   if(!header->streamId)
+   {
+      //The increment cannot be zero
+      if(!increment)
+         return http2ConnectionError(connection, HTTP2_ERROR_PROTOCOL_ERROR);
+      //The window cannot exceed the maximum size
+      if(context->txConnWindow > (int32_t) (HTTP2_MAX_WINDOW_SIZE - increment))
+         return http2ConnectionError(connection, HTTP2_ERROR_FLOW_CONTROL_ERROR);
+
+      //Update the connection-level window
+      context->txConnWindow += increment;
+   }
+   else
+   {
+      //Search for the stream
+      stream = http2FindStream(context, header->streamId);
+
+      //Window of an open stream?
+      if(stream != NULL && !stream->reset)
+      {
+         //Invalid increment?
+         if(!increment || stream->txWindow > (int32_t) (HTTP2_MAX_WINDOW_SIZE - increment))
+         {
+            //Only the stream is affected
+            if(stream == context->active)
+            {
+               stream->reset = TRUE;
+               stream->endStream = TRUE;
+            }
+            else
+            {
+               stream->state = HTTP2_STREAM_STATE_IDLE;
+            }
+
+            //Report a stream error
+            return http2SendRstStream(connection, header->streamId, increment ?
+               HTTP2_ERROR_FLOW_CONTROL_ERROR : HTTP2_ERROR_PROTOCOL_ERROR);
+         }
+
+         //Update the stream-level window
+         stream->txWindow += increment;
+      }
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send the response header in a HEADERS frame
+ *
+ * The HTTP/1.1 header fields are translated into their HTTP/2 equivalents.
+ * Connection-specific fields (Connection, Keep-Alive, Transfer-Encoding)
+ * are not allowed and the response body is delimited by the END_STREAM flag
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t http2WriteHeader(HttpConnection *connection)
+{
+   uint_t i;
+   size_t n;
+   uint8_t *p;
+   char_t s[48];
+   Http2Context *context;
+   Http2Stream *stream;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+   //Point to the stream whose request handler is running
+   stream = context->active;
+
+   //The response body is delimited by the end of the stream
+   if(connection->response.chunkedEncoding)
+   {
+      //Chunked encoding is not allowed
+      connection->response.chunkedEncoding = FALSE;
+      //The size of the response body is not limited
+      connection->response.byteCount = UINT_MAX;
+   }
+   else
+   {
+      //Limit the size of the response body
+      connection->response.byteCount = connection->response.contentLength;
+   }
+
+   //The connection is no longer usable?
+   if(context->failure)
+      return context->failure;
+   //The stream has been reset by the client?
+   if(stream == NULL || stream->reset)
+      return ERROR_CONNECTION_RESET;
+
+   //The header block is built in the frame buffer
+   p = context->txFrame + HTTP2_FRAME_HEADER_SIZE;
+   n = 0;
+
+   //Format the status code
+   sprintf(s, "%u", connection->response.statusCode);
+   //Common status codes are found in the static table
+   i = hpackFindStaticEntry(":status", s);
+
+   //Encode the :status pseudo-header field
+   if(i != 0)
+      n += hpackEncodeIndexedField(p + n, i);
+   else
+      n += hpackEncodeLiteralField(p + n, HPACK_INDEX_STATUS, NULL, s);
+
+   //The Server response-header field contains information about the
+   //software used by the origin server to handle the request
+   n += hpackEncodeLiteralField(p + n, HPACK_INDEX_SERVER, NULL,
+      "Oryx Embedded HTTP Server");
+
+   //Prevent the client from using cache?
+   if(connection->response.noCache)
+   {
+      //Set Pragma field
+      n += hpackEncodeLiteralField(p + n, 0, "pragma", "no-cache");
+      //Set Cache-Control field
+      n += hpackEncodeLiteralField(p + n, HPACK_INDEX_CACHE_CONTROL, NULL,
+         "no-store, no-cache, must-revalidate, post-check=0, pre-check=0");
+   }
+
+   //Static resource?
+   if(connection->response.etag[0] != '\0')
+   {
+      //Set ETag field
+      n += hpackEncodeLiteralField(p + n, HPACK_INDEX_ETAG, NULL,
+         connection->response.etag);
+
+      //Set Cache-Control field
+      sprintf(s, "max-age=%u", HTTP_SERVER_MAX_AGE);
+      n += hpackEncodeLiteralField(p + n, HPACK_INDEX_CACHE_CONTROL, NULL, s);
+   }
+
+   //Byte ranges are supported for this resource?
+   if(connection->response.acceptRanges)
+   {
+      //Set Accept-Ranges field
+      n += hpackEncodeLiteralField(p + n, HPACK_INDEX_ACCEPT_RANGES, NULL, "bytes");
+   }
+
+   //Partial content?
+   if(connection->response.statusCode == 206)
+   {
+      //Set Content-Range field
+      sprintf(s, "bytes %u-%u/%u", connection->response.rangeFirst,
+         connection->response.rangeLast, connection->response.resourceLength);
+      n += hpackEncodeLiteralField(p + n, HPACK_INDEX_CONTENT_RANGE, NULL, s);
+   }
+   //Unsatisfiable byte range?
+   else if(connection->response.statusCode == 416)
+   {
+      //Set Content-Range field
+      sprintf(s, "bytes */%u", connection->response.resourceLength);
+      n += hpackEncodeLiteralField(p + n, HPACK_INDEX_CONTENT_RANGE, NULL, s);
+   }
+
+   //Content type
+   n += hpackEncodeLiteralField(p + n, HPACK_INDEX_CONTENT_TYPE, NULL,
+      connection->response.contentType);
+
+   //Compressed content?
+   if(connection->response.contentEncoding != NULL)
+   {
+      //Set Content-Encoding field
+      n += hpackEncodeLiteralField(p + n, HPACK_INDEX_CONTENT_ENCODING, NULL,
+         connection->response.contentEncoding);
+      //The representation depends on the Accept-Encoding field of the request
+      n += hpackEncodeLiteralField(p + n, HPACK_INDEX_VARY, NULL, "accept-encoding");
+   }
+
+   //The length of the body is known? (a 304 response never contains a body)
+   if(connection->response.byteCount != UINT_MAX &&
+      connection->response.statusCode != 304)
+   {
+      //Set Content-Length field
+      sprintf(s, "%u", connection->response.contentLength);
+      n += hpackEncodeLiteralField(p + n, HPACK_INDEX_CONTENT_LENGTH, NULL, s);
+   }
+
+   //Debug message
+   TRACE_DEBUG("HTTP/2 response header on stream %u (%u bytes)\r\n",
+      stream->id, n);
+
+   //The response header has been generated
+   stream->headerSent = TRUE;
+
+   //Send the HEADERS frame. The END_STREAM flag is carried by the last
+   //DATA frame
+   return http2SendFrame(connection, HTTP2_FRAME_HEADERS,
+      HTTP2_FLAG_END_HEADERS, stream->id, n);
+}
+
+
+/**
+ * @brief Queue response data on the active stream
+ *
+ * The data is copied to the output buffer of the stream. Immutable data
+ * (SOCKET_FLAG_NO_COPY) is referenced instead, so that the request handler
+ * completes right away. When the stream cannot accept more data, DATA
+ * frames are sent on all the open streams until room is available
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] data Pointer to the data to be transmitted
+ * @param[in] length Number of bytes to be transmitted
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t http2SendData(HttpConnection *connection, const void *data, size_t length, uint_t flags)
+{
+   error_t error;
+   size_t n;
+   Http2Context *context;
+   Http2Stream *stream;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+   //Point to the stream whose request handler is running
+   stream = context->active;
+
+   //The connection is no longer usable?
+   if(context->failure)
+      return context->failure;
+   //The stream has been reset by the client?
+   if(stream == NULL || stream->reset)
+      return ERROR_CONNECTION_RESET;
+
+   //The response to a HEAD request does not contain any body
+   if(connection->request.method == HTTP_METHOD_HEAD)
+      return NO_ERROR;
+
+   //Queue the data
+   while(length > 0)
+   {
+      //Referenced data must be sent before any other data can be queued
+      if(!stream->dataLength)
+      {
+         //Immutable data?
+         if(flags & SOCKET_FLAG_NO_COPY)
+         {
+            //The data is sent after the contents of the output buffer
+            stream->data = data;
+            stream->dataLength = length;
+            break;
+         }
+
+         //Move the pending data to the beginning of the output buffer
+         if(stream->txOffset > 0)
+         {
+            memmove(stream->txBuffer, stream->txBuffer + stream->txOffset,
+               stream->txLength - stream->txOffset);
+
+            stream->txLength -= stream->txOffset;
+            stream->txOffset = 0;
+         }
+
+         //Number of bytes that can be added to the output buffer
+         n = min(length, HTTP2_SERVER_STREAM_BUFFER_SIZE - stream->txLength);
+
+         //Any room left?
+         if(n > 0)
+         {
+            //Copy the data to the output buffer
+            memcpy(stream->txBuffer + stream->txLength, data, n);
+            stream->txLength += n;
+
+            //Advance data pointer
+            data = (uint8_t *) data + n;
+            length -= n;
+            continue;
+         }
+      }
+
+      //Any frame that can be sent?
+      if(http2IsAnyStreamReady(context) && !http2IsInputPending(connection))
+      {
+         //Send a DATA frame on each stream that has data to send
+         error = http2SendPending(connection);
+      }
+      else
+      {
+         //Wait for the client to open the flow-control windows. The part
+         //of the request body that has not been read yet is discarded
+         error = http2ReceiveFrame(connection);
+      }
+
+      //Any error to report?
+      if(error) return error;
+
+      //The stream has been reset by the client?
+      if(stream->reset)
+         return ERROR_CONNECTION_RESET;
+   }
+
+   //Send a round of DATA frames, so that the response is not delayed
+   //until the output buffer is full
+   if(http2IsAnyStreamReady(context))
+      return http2SendPending(connection);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send a round of DATA frames
+ *
+ * A single DATA frame is sent on each stream that has data to send, so
+ * that the bandwidth is shared by the open streams. The stream served
+ * first rotates from one round to the next
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t http2SendPending(HttpConnection *connection)
+{
+   error_t error;
+   uint_t i;
+   Http2Context *context;
+   Http2Stream *stream;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+
+   //Loop through the streams
+   for(i = 0; i < HTTP2_SERVER_MAX_STREAMS; i++)
+   {
+      //Point to the current stream
+      stream = &context->streams[(context->nextStream + i) % HTTP2_SERVER_MAX_STREAMS];
+
+      //Can a frame be sent on the current stream?
+      if(http2IsStreamReady(context, stream))
+      {
+         //Send a DATA frame
+         error = http2SendStreamData(connection, stream);
+         //Any error to report?
+         if(error) return error;
+      }
+   }
+
+   //The next round starts with another stream
+   context->nextStream = (context->nextStream + 1) % HTTP2_SERVER_MAX_STREAMS;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send a DATA frame on a given stream
+ *
+ * The payload is limited by the maximum frame size and by the flow-control
+ * windows. The END_STREAM flag is set on the frame that carries the last
+ * byte of a complete response, and the stream is then closed
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] stream Pointer to the stream
+ * @return Error code
+ **/
+
+error_t http2SendStreamData(HttpConnection *connection, Http2Stream *stream)
+{
+   error_t error;
+   size_t n;
+   uint8_t flags;
+   const uint8_t *p;
+   Http2Context *context;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+
+   //Buffered data is sent first
+   if(stream->txOffset < stream->txLength)
+   {
+      p = stream->txBuffer + stream->txOffset;
+      n = stream->txLength - stream->txOffset;
+   }
+   else
+   {
+      p = stream->data;
+      n = stream->dataLength;
+   }
+
+   //Any data to send?
+   if(n > 0)
+   {
+      //Limit the size of the frame
+      n = min(n, HTTP_SERVER_TX_BUFFER_SIZE);
+      n = min(n, context->peerMaxFrameSize);
+      n = min(n, (size_t) context->txConnWindow);
+      n = min(n, (size_t) stream->txWindow);
+
+      //Copy the data to the frame buffer
+      memcpy(context->txFrame + HTTP2_FRAME_HEADER_SIZE, p, n);
+
+      //Consume the data
+      if(stream->txOffset < stream->txLength)
+      {
+         stream->txOffset += n;
+      }
+      else
+      {
+         stream->data += n;
+         stream->dataLength -= n;
+      }
+
+      //Update the flow-control windows
+      context->txConnWindow -= n;
+      stream->txWindow -= n;
+   }
+
+   //Last frame of a complete response?
+   if(stream->state == HTTP2_STREAM_STATE_CLOSING &&
+      stream->txOffset >= stream->txLength && !stream->dataLength)
+   {
+      flags = HTTP2_FLAG_END_STREAM;
+   }
+   else
+   {
+      flags = 0;
+   }
+
+   //Send the DATA frame
+   error = http2SendFrame(connection, HTTP2_FRAME_DATA, flags, stream->id, n);
+   //Any error to report?
+   if(error) return error;
+
+   //End of the response?
+   if(flags & HTTP2_FLAG_END_STREAM)
+   {
+      //The rest of the request body is no longer needed
+      if(stream->discardBody)
+         error = http2SendRstStream(connection, stream->id, HTTP2_ERROR_NO_ERROR);
+
+      //The stream is closed
+      stream->state = HTTP2_STREAM_STATE_IDLE;
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Read the request body from DATA frames
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[out] data Buffer where to store the incoming data
+ * @param[in] size Maximum number of bytes that can be received
+ * @param[out] received Number of bytes that have been received
+ * @return Error code
+ **/
+
+error_t http2ReceiveData(HttpConnection *connection, void *data, size_t size, size_t *received)
+{
+   error_t error;
+   size_t n;
+   Http2Context *context;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+
+   //No data has been read yet
+   *received = 0;
+
+   //Wait for data to be available
+   while(1)
+   {
+      //The connection is no longer usable?
+      if(context->failure)
+         return context->failure;
+
+      //Any data left in the current DATA frame?
+      if(context->rxDataLength > 0)
+      {
+         //Limit the number of bytes to read
+         n = min(size, context->rxDataLength);
+
+         //Read the data
+         error = http2ReadPayload(connection, data, n);
+         //Any error to report?
+         if(error) return error;
+
+         //Update the length of the unread data
+         context->rxDataLength -= n;
+         *received = n;
+
+         //The client can send more data
+         return http2ConsumeData(connection, n, TRUE);
+      }
+
+      //No request handler is running?
+      if(context->active == NULL)
+         return ERROR_END_OF_STREAM;
+      //The stream has been reset by the client?
+      if(context->active->reset)
+         return ERROR_CONNECTION_RESET;
+      //End of the request body?
+      if(context->active->endStream)
+         return ERROR_END_OF_STREAM;
+
+      //Wait for the next frame
+      error = http2ReceiveFrame(connection);
+      //Any error to report?
+      if(error) return error;
+   }
+}
+
+
+/**
+ * @brief Credit received data to the flow-control windows
+ *
+ * WINDOW_UPDATE frames are sent once a sufficient amount of data has been
+ * consumed, so that the client is not flooded with small updates
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] length Number of bytes that have been consumed
+ * @param[in] stream The data belongs to the request body of the active stream
+ * @return Error code
+ **/
+
+error_t http2ConsumeData(HttpConnection *connection, size_t length, bool_t stream)
+{
+   error_t error;
+   Http2Context *context;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+
+   //Connection-level window
+   context->rxConnConsumed += length;
+
+   //Time to open the window?
+   if(context->rxConnConsumed >= HTTP2_WINDOW_UPDATE_THRESHOLD)
+   {
+      //Send a WINDOW_UPDATE frame
+      error = http2SendWindowUpdate(connection, 0, context->rxConnConsumed);
+      //Any error to report?
+      if(error) return error;
+
+      //The window has been restored
+      context->rxConnConsumed = 0;
+   }
+
+   //The client is still sending the request body?
+   if(stream && context->active != NULL && !context->active->endStream)
+   {
+      //Stream-level window
+      context->rxStreamConsumed += length;
+
+      //Time to open the window?
+      if(context->rxStreamConsumed >= HTTP2_WINDOW_UPDATE_THRESHOLD)
+      {
+         //Send a WINDOW_UPDATE frame
+         error = http2SendWindowUpdate(connection, context->active->id,
+            context->rxStreamConsumed);
+         //Any error to report?
+         if(error) return error;
+
+         //The window has been restored
+         context->rxStreamConsumed = 0;
+      }
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Skip the unread part of the current DATA frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t http2DiscardData(HttpConnection *connection)
+{
+   error_t error;
+   size_t n;
+   Http2Context *context;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+
+   //Nothing to skip?
+   if(!context->rxDataLength && !context->rxPadding)
+      return NO_ERROR;
+
+   //Number of bytes to skip
+   n = context->rxDataLength + context->rxPadding;
+
+   //The data that has not been read still counts against the
+   //connection-level window
+   error = http2ConsumeData(connection, context->rxDataLength, FALSE);
+   //Any error to report?
+   if(error) return error;
+
+   //The rest of the frame is discarded
+   context->rxDataLength = 0;
+   context->rxPadding = 0;
+
+   //Skip the data and the padding
+   return http2ReadPayload(connection, NULL, n);
+}
+
+
+/**
+ * @brief Read a frame header
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[out] header Frame header
+ * @return Error code
+ **/
+
+error_t http2ReadFrameHeader(HttpConnection *connection, Http2FrameHeader *header)
+{
+   error_t error;
+   uint8_t buffer[HTTP2_FRAME_HEADER_SIZE];
+
+   //Read the frame header
+   error = http2ReadPayload(connection, buffer, HTTP2_FRAME_HEADER_SIZE);
+   //Any error to report?
+   if(error) return error;
+
+   //Parse the frame header
+   header->length = LOAD24BE(buffer);
+   header->type = buffer[3];
+   header->flags = buffer[4];
+   //The most significant bit of the stream identifier is reserved
+   header->streamId = LOAD32BE(buffer + 5) & 0x7FFFFFFF;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Read data from the TLS connection
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[out] data Buffer where to store the data (NULL to discard it)
+ * @param[in] length Number of bytes to read
+ * @return Error code
+ **/
+
+error_t http2ReadPayload(HttpConnection *connection, void *data, size_t length)
+{
+   error_t error;
+   size_t n;
+   size_t received;
+   uint8_t *p;
+   Http2Context *context;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+
+   //Read the requested number of bytes
+   while(length > 0)
+   {
+      //Discarded data is read into the receive buffer
+      if(data == NULL)
+      {
+         p = context->rxFrame;
+         n = min(length, HTTP2_SERVER_RX_FRAME_SIZE);
+      }
+      else
+      {
+         p = data;
+         n = length;
+      }
+
+      //Read data
+      error = tlsRead(connection->tlsContext, p, n, &received, TLS_FLAG_WAIT_ALL);
+
+      //The client has closed the connection?
+      if(!error && !received)
+         error = ERROR_END_OF_STREAM;
+
+      //Any error to report?
+      if(error)
+      {
+         //The connection is no longer usable
+         context->failure = error;
+         return error;
+      }
+
+      //Advance data pointer
+      if(data != NULL)
+         data = (uint8_t *) data + received;
+
+      //Number of bytes left to read
+      length -= received;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send a frame
+ *
+ * The payload must have been written to the frame buffer, right after
+ * the room reserved for the frame header
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] type Frame type
+ * @param[in] flags Frame flags
+ * @param[in] streamId Stream identifier
+ * @param[in] length Length of the payload
+ * @return Error code
+ **/
+
+error_t http2SendFrame(HttpConnection *connection, uint8_t type,
+   uint8_t flags, uint32_t streamId, size_t length)
+{
+   error_t error;
+   Http2Context *context;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+
+   //Format the frame header
+   STORE24BE(length, context->txFrame);
+   context->txFrame[3] = type;
+   context->txFrame[4] = flags;
+   STORE32BE(streamId, context->txFrame + 5);
+
+   //Send the frame header and the payload at once
+   error = tlsWrite(connection->tlsContext, context->txFrame,
+      HTTP2_FRAME_HEADER_SIZE + length, 0);
+
+   //The connection is no longer usable if the frame could not be sent
+   if(error)
+      context->failure = error;
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send the server's settings
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t http2SendSettings(HttpConnection *connection)
+{
+   uint8_t *p;
+
+   //Point to the frame payload
+   p = connection->http2->txFrame + HTTP2_FRAME_HEADER_SIZE;
+
+   //Size of the HPACK dynamic table used by the decoder
+   STORE16BE(HTTP2_SETTINGS_HEADER_TABLE_SIZE, p);
+   STORE32BE(HPACK_TABLE_SIZE, p + 2);
+   //Number of streams that can be open at the same time
+   STORE16BE(HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS, p + 6);
+   STORE32BE(HTTP2_SERVER_MAX_STREAMS, p + 8);
+   //Maximum length of the header fields of a request
+   STORE16BE(HTTP2_SETTINGS_MAX_HEADER_LIST_SIZE, p + 12);
+   STORE32BE(HTTP2_SERVER_HEADER_LIST_SIZE, p + 14);
+
+   //Send the SETTINGS frame
+   return http2SendFrame(connection, HTTP2_FRAME_SETTINGS, 0, 0, 18);
+}
+
+
+/**
+ * @brief Send a RST_STREAM frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] streamId Stream identifier
+ * @param[in] errorCode Error code
+ * @return Error code
+ **/
+
+error_t http2SendRstStream(HttpConnection *connection, uint32_t streamId, uint32_t errorCode)
+{
+   //Format the error code
+   STORE32BE(errorCode, connection->http2->txFrame + HTTP2_FRAME_HEADER_SIZE);
+   //Send the RST_STREAM frame
+   return http2SendFrame(connection, HTTP2_FRAME_RST_STREAM, 0, streamId, 4);
+}
+
+
+/**
+ * @brief Send a WINDOW_UPDATE frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] streamId Stream identifier (0 for the connection-level window)
+ * @param[in] increment Window size increment
+ * @return Error code
+ **/
+
+error_t http2SendWindowUpdate(HttpConnection *connection, uint32_t streamId, uint32_t increment)
+{
+   //Format the window size increment
+   STORE32BE(increment, connection->http2->txFrame + HTTP2_FRAME_HEADER_SIZE);
+   //Send the WINDOW_UPDATE frame
+   return http2SendFrame(connection, HTTP2_FRAME_WINDOW_UPDATE, 0, streamId, 4);
+}
+
+
+/**
+ * @brief Send a GOAWAY frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t http2SendGoAway(HttpConnection *connection)
+{
+   uint8_t *p;
+   Http2Context *context;
+
+   //Point to the HTTP/2 connection state
+   context = connection->http2;
+   //Point to the frame payload
+   p = context->txFrame + HTTP2_FRAME_HEADER_SIZE;
+
+   //Last stream that may have been processed
+   STORE32BE(context->lastStreamId, p);
+   //Reason for closing the connection
+   STORE32BE(context->errorCode, p + 4);
+
+   //Send the GOAWAY frame
+   return http2SendFrame(connection, HTTP2_FRAME_GOAWAY, 0, 0, 8);
+}
+
+
+/**
+ * @brief Report a connection error
+ *
+ * The error code is sent in the GOAWAY frame that closes the connection
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] errorCode Error code
+ * @return Error code
+ **/
+
+error_t http2ConnectionError(HttpConnection *connection, uint32_t errorCode)
+{
+   //Debug message
+   TRACE_WARNING("HTTP/2 connection error 0x%X...\r\n", errorCode);
+
+   //Save the error code
+   connection->http2->errorCode = errorCode;
+   //No more frames are processed
+   connection->http2->failure = ERROR_INVALID_REQUEST;
+
+   //Return status code
+   return ERROR_INVALID_REQUEST;
+}
+
+#endif
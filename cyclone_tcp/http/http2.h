@@ -0,0 +1,308 @@
+/**
+ * @file http2.h
+ * @brief HTTP/2 server (RFC 7540)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * HTTP/2 is negotiated through the ALPN extension of the TLS handshake.
+ * Requests and responses are carried by streams multiplexed over a single
+ * connection, their header fields being compressed with HPACK, and the
+ * amount of data in flight being regulated by flow-control windows
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+#ifndef _HTTP2_H
+#define _HTTP2_H
+
+//Dependencies
+#include "os.h"
+#include "http_server.h"
+#include "hpack.h"
+
+//HTTP/2 is negotiated through the ALPN extension
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED && TLS_ALPN_SUPPORT == DISABLED)
+   #error HTTP_SERVER_HTTP2_SUPPORT requires TLS_ALPN_SUPPORT
+#endif
+
+//A response header must fit in a single frame
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED && HTTP_SERVER_TX_BUFFER_SIZE < 512)
+   #error HTTP_SERVER_HTTP2_SUPPORT requires HTTP_SERVER_TX_BUFFER_SIZE >= 512
+#endif
+
+//Maximum number of streams open on a connection
+#ifndef HTTP2_SERVER_MAX_STREAMS
+   #define HTTP2_SERVER_MAX_STREAMS 4
+#elif (HTTP2_SERVER_MAX_STREAMS < 1)
+   #error HTTP2_SERVER_MAX_STREAMS parameter is invalid
+#endif
+
+//Maximum length of the header fields kept for each queued stream
+#ifndef HTTP2_SERVER_HEADER_LIST_SIZE
+   #define HTTP2_SERVER_HEADER_LIST_SIZE 768
+#elif (HTTP2_SERVER_HEADER_LIST_SIZE < 128)
+   #error HTTP2_SERVER_HEADER_LIST_SIZE parameter is invalid
+#endif
+
+//Size of the output buffer of each stream
+#ifndef HTTP2_SERVER_STREAM_BUFFER_SIZE
+   #define HTTP2_SERVER_STREAM_BUFFER_SIZE 1024
+#elif (HTTP2_SERVER_STREAM_BUFFER_SIZE < 128)
+   #error HTTP2_SERVER_STREAM_BUFFER_SIZE parameter is invalid
+#endif
+
+//Size of the buffer holding header blocks
+#ifndef HTTP2_SERVER_RX_FRAME_SIZE
+   #define HTTP2_SERVER_RX_FRAME_SIZE 2048
+#elif (HTTP2_SERVER_RX_FRAME_SIZE < 256)
+   #error HTTP2_SERVER_RX_FRAME_SIZE parameter is invalid
+#endif
+
+//Protocol identifier used by ALPN
+#define HTTP2_ALPN_PROTOCOL "h2"
+//Connection preface sent by the client
+#define HTTP2_PREFACE "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+//Length of the connection preface
+#define HTTP2_PREFACE_SIZE 24
+//Length of the frame header
+#define HTTP2_FRAME_HEADER_SIZE 9
+//Initial flow-control window size
+#define HTTP2_DEFAULT_WINDOW_SIZE 65535
+//Largest flow-control window size
+#define HTTP2_MAX_WINDOW_SIZE 0x7FFFFFFF
+//Default maximum frame payload length
+#define HTTP2_DEFAULT_MAX_FRAME_SIZE 16384
+//Largest frame payload length that can be announced
+#define HTTP2_MAX_FRAME_SIZE 16777215
+//Received bytes that trigger a WINDOW_UPDATE frame
+#define HTTP2_WINDOW_UPDATE_THRESHOLD (HTTP2_DEFAULT_WINDOW_SIZE / 2)
+
+
+/**
+ * @brief Frame types
+ **/
+
+typedef enum
+{
+   HTTP2_FRAME_DATA          = 0x00,
+   HTTP2_FRAME_HEADERS       = 0x01,
+   HTTP2_FRAME_PRIORITY      = 0x02,
+   HTTP2_FRAME_RST_STREAM    = 0x03,
+   HTTP2_FRAME_SETTINGS      = 0x04,
+   HTTP2_FRAME_PUSH_PROMISE  = 0x05,
+   HTTP2_FRAME_PING          = 0x06,
+   HTTP2_FRAME_GOAWAY        = 0x07,
+   HTTP2_FRAME_WINDOW_UPDATE = 0x08,
+   HTTP2_FRAME_CONTINUATION  = 0x09
+} Http2FrameType;
+
+
+/**
+ * @brief Frame flags
+ **/
+
+typedef enum
+{
+   HTTP2_FLAG_END_STREAM  = 0x01,
+   HTTP2_FLAG_ACK         = 0x01,
+   HTTP2_FLAG_END_HEADERS = 0x04,
+   HTTP2_FLAG_PADDED      = 0x08,
+   HTTP2_FLAG_PRIORITY    = 0x20
+} Http2FrameFlags;
+
+
+/**
+ * @brief Settings parameters
+ **/
+
+typedef enum
+{
+   HTTP2_SETTINGS_HEADER_TABLE_SIZE      = 0x01,
+   HTTP2_SETTINGS_ENABLE_PUSH            = 0x02,
+   HTTP2_SETTINGS_MAX_CONCURRENT_STREAMS = 0x03,
+   HTTP2_SETTINGS_INITIAL_WINDOW_SIZE    = 0x04,
+   HTTP2_SETTINGS_MAX_FRAME_SIZE         = 0x05,
+   HTTP2_SETTINGS_MAX_HEADER_LIST_SIZE   = 0x06
+} Http2Settings;
+
+
+/**
+ * @brief Error codes carried by RST_STREAM and GOAWAY frames
+ **/
+
+typedef enum
+{
+   HTTP2_ERROR_NO_ERROR            = 0x00,
+   HTTP2_ERROR_PROTOCOL_ERROR      = 0x01,
+   HTTP2_ERROR_INTERNAL_ERROR      = 0x02,
+   HTTP2_ERROR_FLOW_CONTROL_ERROR  = 0x03,
+   HTTP2_ERROR_SETTINGS_TIMEOUT    = 0x04,
+   HTTP2_ERROR_STREAM_CLOSED       = 0x05,
+   HTTP2_ERROR_FRAME_SIZE_ERROR    = 0x06,
+   HTTP2_ERROR_REFUSED_STREAM      = 0x07,
+   HTTP2_ERROR_CANCEL              = 0x08,
+   HTTP2_ERROR_COMPRESSION_ERROR   = 0x09,
+   HTTP2_ERROR_CONNECT_ERROR       = 0x0A,
+   HTTP2_ERROR_ENHANCE_YOUR_CALM   = 0x0B,
+   HTTP2_ERROR_INADEQUATE_SECURITY = 0x0C,
+   HTTP2_ERROR_HTTP_1_1_REQUIRED   = 0x0D
+} Http2ErrorCode;
+
+
+/**
+ * @brief Stream states
+ **/
+
+typedef enum
+{
+   HTTP2_STREAM_STATE_IDLE    = 0, ///<The entry is not used
+   HTTP2_STREAM_STATE_QUEUED  = 1, ///<The request waits to be processed
+   HTTP2_STREAM_STATE_ACTIVE  = 2, ///<The request handler is running
+   HTTP2_STREAM_STATE_CLOSING = 3  ///<The rest of the response is being sent
+} Http2StreamState;
+
+
+/**
+ * @brief Frame header
+ **/
+
+typedef struct
+{
+   size_t length;     ///<Length of the frame payload
+   uint8_t type;      ///<Frame type
+   uint8_t flags;     ///<Frame flags
+   uint32_t streamId; ///<Stream identifier
+} Http2FrameHeader;
+
+
+/**
+ * @brief Stream
+ *
+ * The header fields are decoded as soon as the header block is received,
+ * since HPACK requires the header blocks to be processed in order. They
+ * are stored as consecutive pairs of NULL-terminated names and values.
+ *
+ * The response body is either copied to the output buffer of the stream
+ * or, for immutable resource data, referenced. Buffered data is always
+ * sent before referenced data
+ *
+ **/
+
+typedef struct
+{
+   Http2StreamState state;                              ///<Stream state
+   uint32_t id;                                         ///<Stream identifier
+   bool_t endStream;                                    ///<The client has finished sending the request
+   bool_t reset;                                        ///<The stream has been reset
+   bool_t headerSent;                                   ///<The response header has been sent
+   bool_t discardBody;                                  ///<The rest of the request body is not needed
+   int32_t txWindow;                                    ///<Stream-level send window
+   size_t length;                                       ///<Length of the header fields
+   char_t fields[HTTP2_SERVER_HEADER_LIST_SIZE];        ///<Header fields
+   size_t txOffset;                                     ///<Offset of the first byte to be sent
+   size_t txLength;                                     ///<Length of the buffered data
+   uint8_t txBuffer[HTTP2_SERVER_STREAM_BUFFER_SIZE];   ///<Output buffer
+   const uint8_t *data;                                 ///<Referenced data to be sent after the buffered data
+   size_t dataLength;                                   ///<Length of the referenced data
+} Http2Stream;
+
+
+/**
+ * @brief HTTP/2 connection state
+ *
+ * The request handlers run one at a time, by order of stream creation.
+ * A response is not sent while it is being generated: its data is kept
+ * by the stream, and DATA frames are interleaved across the open streams
+ * in a round-robin fashion, within the limits of their flow-control
+ * windows. A stream whose handler has completed keeps sending its data
+ * while the next request is processed
+ *
+ **/
+
+typedef struct _Http2Context
+{
+   HpackDecoder decoder;                          ///<HPACK decoder
+   error_t failure;                               ///<Error that terminates the connection
+   uint32_t errorCode;                            ///<Error code reported in the GOAWAY frame
+   uint32_t lastStreamId;                         ///<Highest stream identifier used by the client
+   uint_t requestCount;                           ///<Number of requests processed so far
+   bool_t goAway;                                 ///<The client has sent a GOAWAY frame
+   uint32_t peerWindowSize;                       ///<Initial stream window size announced by the client
+   size_t peerMaxFrameSize;                       ///<Largest frame payload the client accepts
+   int32_t txConnWindow;                          ///<Connection-level send window
+   size_t rxConnConsumed;                         ///<Received bytes not yet credited to the connection
+   Http2Stream *active;                           ///<Stream whose request handler is running (if any)
+   size_t rxStreamConsumed;                       ///<Received bytes not yet credited to the active stream
+   size_t rxDataLength;                           ///<Unread payload of the current DATA frame
+   size_t rxPadding;                              ///<Padding that follows the unread payload
+   uint_t nextStream;                             ///<Stream served first by the next round of DATA frames
+   Http2Stream streams[HTTP2_SERVER_MAX_STREAMS]; ///<Streams
+   uint8_t rxFrame[HTTP2_SERVER_RX_FRAME_SIZE];   ///<Header block being received
+   uint8_t txFrame[HTTP2_FRAME_HEADER_SIZE + HTTP_SERVER_TX_BUFFER_SIZE]; ///<Frame being sent
+} Http2Context;
+
+
+//HTTP/2 related functions
+bool_t http2IsNegotiated(HttpConnection *connection);
+error_t http2ProcessConnection(HttpConnection *connection);
+error_t http2ProcessStream(HttpConnection *connection);
+error_t http2ParseRequest(HttpConnection *connection, Http2Stream *stream);
+Http2Stream *http2FindStream(Http2Context *context, uint32_t id);
+Http2Stream *http2GetQueuedStream(Http2Context *context);
+bool_t http2HasOpenStreams(Http2Context *context);
+bool_t http2IsStreamReady(Http2Context *context, Http2Stream *stream);
+bool_t http2IsAnyStreamReady(Http2Context *context);
+bool_t http2IsInputPending(HttpConnection *connection);
+
+error_t http2StoreField(void *param, const char_t *name, const char_t *value);
+error_t http2DiscardField(void *param, const char_t *name, const char_t *value);
+
+error_t http2ReceiveFrame(HttpConnection *connection);
+error_t http2ProcessData(HttpConnection *connection, const Http2FrameHeader *header);
+error_t http2ProcessHeaders(HttpConnection *connection, const Http2FrameHeader *header);
+error_t http2ProcessRstStream(HttpConnection *connection, const Http2FrameHeader *header);
+error_t http2ProcessSettings(HttpConnection *connection, const Http2FrameHeader *header);
+error_t http2ProcessPing(HttpConnection *connection, const Http2FrameHeader *header);
+error_t http2ProcessGoAway(HttpConnection *connection, const Http2FrameHeader *header);
+error_t http2ProcessWindowUpdate(HttpConnection *connection, const Http2FrameHeader *header);
+
+error_t http2WriteHeader(HttpConnection *connection);
+error_t http2SendData(HttpConnection *connection, const void *data, size_t length, uint_t flags);
+error_t http2SendPending(HttpConnection *connection);
+error_t http2SendStreamData(HttpConnection *connection, Http2Stream *stream);
+error_t http2ReceiveData(HttpConnection *connection, void *data, size_t size, size_t *received);
+error_t http2ConsumeData(HttpConnection *connection, size_t length, bool_t stream);
+error_t http2DiscardData(HttpConnection *connection);
+
+error_t http2ReadFrameHeader(HttpConnection *connection, Http2FrameHeader *header);
+error_t http2ReadPayload(HttpConnection *connection, void *data, size_t length);
+error_t http2SendFrame(HttpConnection *connection, uint8_t type,
+   uint8_t flags, uint32_t streamId, size_t length);
+
+error_t http2SendSettings(HttpConnection *connection);
+error_t http2SendRstStream(HttpConnection *connection, uint32_t streamId, uint32_t errorCode);
+error_t http2SendWindowUpdate(HttpConnection *connection, uint32_t streamId, uint32_t increment);
+error_t http2SendGoAway(HttpConnection *connection);
+error_t http2ConnectionError(HttpConnection *connection, uint32_t errorCode);
+
+#endif
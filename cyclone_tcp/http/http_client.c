@@ -0,0 +1,1169 @@
+/**
+ * @file http_client.c
+ * @brief HTTP/1.1 client with persistent connection pool
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The client sends requests and streams their responses over persistent
+ * connections (RFC 2616, section 8.1). A connection whose response has been
+ * read entirely is kept in a small pool, and the next request to the same
+ * server reuses it instead of paying a new TCP (and TLS) handshake. When a
+ * new TLS connection has to be opened, the session established previously
+ * with the server is resumed through the client-side session cache
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL HTTP_TRACE_LEVEL
+
+//Dependencies
+#include <stdlib.h>
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "http_client.h"
+#include "str.h"
+#include "debug.h"
+
+//Client-side session cache
+#if (HTTP_CLIENT_TLS_SUPPORT == ENABLED && TLS_CLIENT_CACHE_SUPPORT == ENABLED)
+   #include "tls_client_cache.h"
+#endif
+
+
+/**
+ * @brief Initialize an HTTP client
+ * @param[in] context Pointer to the HTTP client context
+ * @param[in] settings HTTP client specific settings
+ * @return Error code
+ **/
+
+error_t httpClientInit(HttpClientContext *context, const HttpClientSettings *settings)
+{
+   //Check parameters
+   if(context == NULL || settings == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Clear the HTTP client context
+   memset(context, 0, sizeof(HttpClientContext));
+   //Save user settings
+   context->settings = *settings;
+
+   //Create a mutex to protect the pool of idle connections
+   context->mutex = osMutexCreate(FALSE);
+   //Any error to report?
+   if(context->mutex == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+#if (HTTP_CLIENT_TLS_SUPPORT == ENABLED && TLS_CLIENT_CACHE_SUPPORT == ENABLED)
+   //Use the session cache supplied by the application, if any
+   context->tlsClientCache = settings->tlsClientCache;
+
+   //Otherwise share the default cache, or create one
+   if(context->tlsClientCache == NULL && tlsDefaultClientCache == NULL)
+   {
+      //Initialize session cache
+      context->tlsClientCache = tlsInitClientCache(HTTP_CLIENT_TLS_CACHE_SIZE);
+
+      //Failed to allocate memory?
+      if(context->tlsClientCache == NULL)
+      {
+         //Clean up side effects
+         osMutexClose(context->mutex);
+         //Report an error
+         return ERROR_OUT_OF_MEMORY;
+      }
+   }
+#endif
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release the resources held by an HTTP client
+ *
+ * The idle connections are closed. The connections that are still in
+ * use must have been closed beforehand
+ *
+ * @param[in] context Pointer to the HTTP client context
+ **/
+
+void httpClientDeinit(HttpClientContext *context)
+{
+   uint_t i;
+
+   //Close idle connections
+   for(i = 0; i < HTTP_CLIENT_POOL_SIZE; i++)
+   {
+      //Valid entry?
+      if(context->pool[i] != NULL)
+      {
+         //Disconnect from the server
+         httpClientDisconnect(context->pool[i]);
+         //Release connection context
+         osMemFree(context->pool[i]);
+         context->pool[i] = NULL;
+      }
+   }
+
+#if (HTTP_CLIENT_TLS_SUPPORT == ENABLED && TLS_CLIENT_CACHE_SUPPORT == ENABLED)
+   //Release the session cache created by the client
+   if(context->tlsClientCache != NULL &&
+      context->tlsClientCache != context->settings.tlsClientCache)
+   {
+      tlsFreeClientCache(context->tlsClientCache);
+   }
+
+   //The cache is no longer available
+   context->tlsClientCache = NULL;
+#endif
+
+   //Release mutex
+   osMutexClose(context->mutex);
+}
+
+
+/**
+ * @brief Get a connection to the specified server
+ *
+ * An idle connection to the same server is reused when possible. Otherwise
+ * a new connection is established
+ *
+ * @param[in] context Pointer to the HTTP client context
+ * @param[in] host Name or IP address of the server
+ * @param[in] port Port of the server
+ * @param[in] useTls Use SSL/TLS (HTTPS)
+ * @param[out] connection Connection to the server
+ * @return Error code
+ **/
+
+error_t httpClientOpen(HttpClientContext *context, const char_t *host,
+   uint16_t port, bool_t useTls, HttpClientConnection **connection)
+{
+   error_t error;
+   uint_t i;
+   HttpClientConnection *entry;
+
+   //Check parameters
+   if(context == NULL || host == NULL || connection == NULL)
+      return ERROR_INVALID_PARAMETER;
+   //Make sure the host name is acceptable
+   if(strlen(host) > HTTP_CLIENT_MAX_HOST_LEN)
+      return ERROR_INVALID_PARAMETER;
+
+#if (HTTP_CLIENT_TLS_SUPPORT == DISABLED)
+   //No support for SSL/TLS
+   if(useTls)
+      return ERROR_TLS_NOT_SUPPORTED;
+#endif
+
+   //Search the pool for an idle connection to the same server
+   while(1)
+   {
+      //No matching connection for the moment
+      entry = NULL;
+
+      //Acquire exclusive access to the pool
+      osMutexAcquire(context->mutex);
+
+      //Loop through the idle connections
+      for(i = 0; i < HTTP_CLIENT_POOL_SIZE; i++)
+      {
+         //Matching entry?
+         if(context->pool[i] != NULL && context->pool[i]->port == port &&
+            context->pool[i]->useTls == useTls && !strcasecmp(context->pool[i]->host, host))
+         {
+            //Remove the connection from the pool
+            entry = context->pool[i];
+            context->pool[i] = NULL;
+            break;
+         }
+      }
+
+      //Release exclusive access to the pool
+      osMutexRelease(context->mutex);
+
+      //No idle connection to this server?
+      if(entry == NULL)
+         break;
+
+      //Make sure the server has not closed the connection in the meantime
+      if((osGetTickCount() - entry->timestamp) < HTTP_CLIENT_IDLE_TIMEOUT &&
+         httpClientIsAlive(entry))
+      {
+         //Debug message
+         TRACE_INFO("Reusing HTTP connection to %s:%u...\r\n", host, port);
+         break;
+      }
+
+      //The connection cannot be reused
+      httpClientDisconnect(entry);
+      osMemFree(entry);
+   }
+
+   //A new connection must be established?
+   if(entry == NULL)
+   {
+      //Allocate a memory buffer to hold the connection context
+      entry = osMemAlloc(sizeof(HttpClientConnection));
+      //Failed to allocate memory?
+      if(!entry) return ERROR_OUT_OF_MEMORY;
+
+      //Initialize the connection context
+      memset(entry, 0, sizeof(HttpClientConnection));
+      entry->context = context;
+      strcpy(entry->host, host);
+      entry->port = port;
+      entry->useTls = useTls;
+
+      //Connect to the server
+      error = httpClientConnect(entry);
+
+      //Failed to connect?
+      if(error)
+      {
+         //Clean up side effects
+         httpClientDisconnect(entry);
+         osMemFree(entry);
+         //Report an error
+         return error;
+      }
+   }
+
+   //The response to the previous request has been read entirely
+   entry->bodyComplete = TRUE;
+
+   //Return the connection to the caller
+   *connection = entry;
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release a connection
+ *
+ * The connection returns to the pool when the response has been read
+ * entirely and the server keeps the connection open. Otherwise it is closed
+ *
+ * @param[in] connection Connection to the server
+ **/
+
+void httpClientClose(HttpClientConnection *connection)
+{
+   uint_t i;
+   uint_t j;
+   HttpClientContext *context;
+   HttpClientConnection *evicted;
+
+   //Invalid connection?
+   if(connection == NULL)
+      return;
+
+   //Point to the HTTP client context
+   context = connection->context;
+
+   //The connection cannot be reused if the exchange is not complete
+   if(!connection->keepAlive || !connection->bodyComplete ||
+      connection->chunkedRequest || connection->requestByteCount > 0)
+   {
+      //Close the connection
+      httpClientDisconnect(connection);
+      osMemFree(connection);
+      //We are done
+      return;
+   }
+
+   //Time at which the connection became idle
+   connection->timestamp = osGetTickCount();
+   //No connection evicted for the moment
+   evicted = NULL;
+
+   //Acquire exclusive access to the pool
+   osMutexAcquire(context->mutex);
+
+   //Search for a free entry, or else for the oldest idle connection
+   for(i = 0, j = 0; i < HTTP_CLIENT_POOL_SIZE; i++)
+   {
+      //Free entry?
+      if(context->pool[i] == NULL)
+         break;
+
+      //Keep track of the oldest idle connection
+      if(timeCompare(context->pool[i]->timestamp, context->pool[j]->timestamp) < 0)
+         j = i;
+   }
+
+   //The pool is full?
+   if(i >= HTTP_CLIENT_POOL_SIZE)
+   {
+      //The oldest idle connection is closed
+      evicted = context->pool[j];
+      i = j;
+   }
+
+   //Add the connection to the pool
+   context->pool[i] = connection;
+
+   //Release exclusive access to the pool
+   osMutexRelease(context->mutex);
+
+   //Close the evicted connection, if any
+   if(evicted != NULL)
+   {
+      httpClientDisconnect(evicted);
+      osMemFree(evicted);
+   }
+}
+
+
+/**
+ * @brief Send the header of a request
+ *
+ * The extra header fields, if any, must be formatted as a list of
+ * CRLF-terminated lines. HTTP_CLIENT_CHUNKED_BODY may be passed as content
+ * length when the size of the request body is not known in advance
+ *
+ * @param[in] connection Connection to the server
+ * @param[in] method Request method (GET, HEAD, POST, PUT...)
+ * @param[in] uri Requested URI
+ * @param[in] extraHeaders Additional header fields (optional)
+ * @param[in] contentLength Length of the request body
+ * @return Error code
+ **/
+
+error_t httpClientWriteHeader(HttpClientConnection *connection, const char_t *method,
+   const char_t *uri, const char_t *extraHeaders, size_t contentLength)
+{
+   size_t n;
+   char_t *p;
+
+   //Check parameters
+   if(connection == NULL || method == NULL || uri == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //The response to the previous request must have been read entirely
+   if(!connection->bodyComplete || connection->chunkedRequest ||
+      connection->requestByteCount > 0)
+   {
+      return ERROR_WRONG_STATE;
+   }
+
+   //Length of the fixed part of the header
+   n = strlen(method) + strlen(uri) + strlen(connection->host) + 96;
+   //Length of the extra header fields
+   if(extraHeaders != NULL)
+      n += strlen(extraHeaders);
+
+   //Make sure the header fits in the buffer
+   if(n > HTTP_CLIENT_BUFFER_SIZE)
+      return ERROR_INVALID_LENGTH;
+
+   //Point to the beginning of the buffer
+   p = connection->buffer;
+
+   //Format the Request-Line
+   p += sprintf(p, "%s %s HTTP/1.1\r\n", method, uri);
+
+   //The Host field is mandatory in HTTP/1.1. The port is omitted when the
+   //default port is used
+   if((!connection->useTls && connection->port == HTTP_PORT) ||
+      (connection->useTls && connection->port == HTTPS_PORT))
+   {
+      p += sprintf(p, "Host: %s\r\n", connection->host);
+   }
+   else
+   {
+      p += sprintf(p, "Host: %s:%u\r\n", connection->host, connection->port);
+   }
+
+   //Additional header fields
+   if(extraHeaders != NULL)
+      p += sprintf(p, "%s", extraHeaders);
+
+   //Size of the request body not known in advance?
+   if(contentLength == HTTP_CLIENT_CHUNKED_BODY)
+   {
+      //Use chunked encoding
+      p += sprintf(p, "Transfer-Encoding: chunked\r\n");
+      connection->chunkedRequest = TRUE;
+      connection->requestByteCount = 0;
+   }
+   else
+   {
+      //A Content-Length field is sent when the request has a body
+      if(contentLength > 0)
+         p += sprintf(p, "Content-Length: %u\r\n", contentLength);
+
+      connection->chunkedRequest = FALSE;
+      connection->requestByteCount = contentLength;
+   }
+
+   //The header is terminated by an empty line
+   p += sprintf(p, "\r\n");
+
+   //Debug message
+   TRACE_DEBUG("HTTP request header:\r\n%s", connection->buffer);
+
+   //Prepare to read the response
+   connection->headRequest = !strcasecmp(method, "HEAD") ? TRUE : FALSE;
+   connection->statusCode = 0;
+   connection->bodyComplete = FALSE;
+   connection->requestCount++;
+
+   //Send the request header
+   return httpClientSend(connection, connection->buffer, p - connection->buffer);
+}
+
+
+/**
+ * @brief Send a part of the request body
+ *
+ * With chunked encoding, each call produces a chunk. The body is terminated
+ * by a call with a zero length, or automatically when the response header
+ * is read
+ *
+ * @param[in] connection Connection to the server
+ * @param[in] data Pointer to the data to be transmitted
+ * @param[in] length Number of bytes to be transmitted
+ * @return Error code
+ **/
+
+error_t httpClientWriteBody(HttpClientConnection *connection, const void *data, size_t length)
+{
+   error_t error;
+   size_t n;
+
+   //Check parameters
+   if(connection == NULL || (data == NULL && length > 0))
+      return ERROR_INVALID_PARAMETER;
+
+   //Chunked encoding?
+   if(connection->chunkedRequest)
+   {
+      //The last chunk has a size of zero and no data
+      if(!length)
+      {
+         //The request body is complete
+         connection->chunkedRequest = FALSE;
+         //Send the last chunk
+         return httpClientSend(connection, "0\r\n\r\n", 5);
+      }
+
+      //The size of the chunk precedes the chunk data
+      n = sprintf(connection->buffer, "%X\r\n", length);
+
+      //Send the chunk size
+      error = httpClientSend(connection, connection->buffer, n);
+      //Any error to report?
+      if(error) return error;
+
+      //Send the chunk data
+      error = httpClientSend(connection, data, length);
+      //Any error to report?
+      if(error) return error;
+
+      //The chunk data is followed by a CRLF sequence
+      return httpClientSend(connection, "\r\n", 2);
+   }
+   else
+   {
+      //The body must not exceed the announced length
+      if(length > connection->requestByteCount)
+         return ERROR_INVALID_LENGTH;
+
+      //Send the data
+      error = httpClientSend(connection, data, length);
+      //Any error to report?
+      if(error) return error;
+
+      //Number of bytes left to send
+      connection->requestByteCount -= length;
+
+      //Successful processing
+      return NO_ERROR;
+   }
+}
+
+
+/**
+ * @brief Read the header of the response
+ *
+ * Interim responses (100 Continue) are skipped. The callback, if any, is
+ * invoked for each header field of the final response
+ *
+ * @param[in] connection Connection to the server
+ * @param[in] callback Function called for each header field (optional)
+ * @param[in] param Parameter passed to the callback function
+ * @return Error code
+ **/
+
+error_t httpClientReadHeader(HttpClientConnection *connection,
+   HttpClientHeaderCallback callback, void *param)
+{
+   error_t error;
+   size_t length;
+   uint_t version;
+   char_t *p;
+   char_t *separator;
+   char_t *name;
+   char_t *value;
+
+   //Check parameters
+   if(connection == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Terminate the request body if necessary
+   if(connection->chunkedRequest)
+   {
+      //Send the last chunk
+      error = httpClientWriteBody(connection, NULL, 0);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //The request body must have been sent entirely
+   if(connection->requestByteCount > 0)
+      return ERROR_WRONG_STATE;
+
+   //Skip interim responses
+   do
+   {
+      //Read the Status-Line
+      error = httpClientReadLine(connection, &length);
+      //Any error to report?
+      if(error) return error;
+
+      //Debug message
+      TRACE_DEBUG("HTTP response: %s\r\n", connection->buffer);
+
+      //Check the protocol version
+      if(!strncmp(connection->buffer, "HTTP/1.1 ", 9))
+         version = 1;
+      else if(!strncmp(connection->buffer, "HTTP/1.0 ", 9))
+         version = 0;
+      else
+         return ERROR_INVALID_SYNTAX;
+
+      //Retrieve the status code
+      connection->statusCode = strtoul(connection->buffer + 9, &p, 10);
+
+      //Malformed status code?
+      if(p != (connection->buffer + 12))
+         return ERROR_INVALID_SYNTAX;
+
+      //HTTP/1.1 connections are persistent unless the server says otherwise
+      connection->keepAlive = version ? TRUE : FALSE;
+      connection->chunkedEncoding = FALSE;
+      connection->closeDelimited = TRUE;
+      connection->byteCount = 0;
+
+      //Parse the header fields
+      while(1)
+      {
+         //Read a header field
+         error = httpClientReadLine(connection, &length);
+         //Any error to report?
+         if(error) return error;
+
+         //The header is terminated by an empty line
+         if(!length)
+            break;
+
+         //Check whether a separator is present
+         separator = strchr(connection->buffer, ':');
+         //Malformed field?
+         if(!separator)
+            continue;
+
+         //Split the line
+         *separator = '\0';
+
+         //Get field name and value
+         name = strTrimWhitespace(connection->buffer);
+         value = strTrimWhitespace(separator + 1);
+
+         //Connection field found?
+         if(!strcasecmp(name, "Connection"))
+         {
+            //Check whether the server keeps the connection open
+            if(!strcasecmp(value, "close"))
+               connection->keepAlive = FALSE;
+            else if(!strcasecmp(value, "keep-alive"))
+               connection->keepAlive = TRUE;
+         }
+         //Transfer-Encoding field found?
+         else if(!strcasecmp(name, "Transfer-Encoding"))
+         {
+            //Check whether chunked encoding is used
+            if(!strcasecmp(value, "chunked"))
+            {
+               connection->chunkedEncoding = TRUE;
+               connection->closeDelimited = FALSE;
+            }
+         }
+         //Content-Length field found?
+         else if(!strcasecmp(name, "Content-Length"))
+         {
+            //Chunked encoding takes precedence
+            if(!connection->chunkedEncoding)
+            {
+               //Get the length of the body
+               connection->byteCount = strtoul(value, NULL, 10);
+               connection->closeDelimited = FALSE;
+            }
+         }
+
+         //Pass the field to the application, unless it belongs to an
+         //interim response
+         if(callback != NULL && connection->statusCode >= 200)
+            callback(name, value, param);
+      }
+
+      //Interim responses consist of the Status-Line and header only
+   } while(connection->statusCode >= 100 && connection->statusCode < 200);
+
+   //Responses to HEAD requests and 204/304 responses have no body
+   if(connection->headRequest || connection->statusCode == 204 ||
+      connection->statusCode == 304)
+   {
+      connection->bodyComplete = TRUE;
+   }
+   //Chunked encoding?
+   else if(connection->chunkedEncoding)
+   {
+      //The size of the first chunk has not been read yet
+      connection->byteCount = 0;
+      connection->bodyComplete = FALSE;
+   }
+   //The body is delimited by the closing of the connection?
+   else if(connection->closeDelimited)
+   {
+      //The connection cannot be reused
+      connection->keepAlive = FALSE;
+      connection->bodyComplete = FALSE;
+   }
+   else
+   {
+      //Empty body?
+      connection->bodyComplete = connection->byteCount ? FALSE : TRUE;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Read a part of the response body
+ * @param[in] connection Connection to the server
+ * @param[out] data Buffer where to store the incoming data
+ * @param[in] size Maximum number of bytes that can be received
+ * @param[out] received Number of bytes that have been received
+ * @return Error code (ERROR_END_OF_STREAM once the body has been read entirely)
+ **/
+
+error_t httpClientReadBody(HttpClientConnection *connection,
+   void *data, size_t size, size_t *received)
+{
+   error_t error;
+   size_t n;
+
+   //Check parameters
+   if(connection == NULL || data == NULL || received == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //No data has been read yet
+   *received = 0;
+
+   //End of the response body?
+   if(connection->bodyComplete)
+      return ERROR_END_OF_STREAM;
+
+   //Chunked encoding?
+   if(connection->chunkedEncoding)
+   {
+      //Acquire a new chunk when the current chunk has been consumed
+      if(!connection->byteCount)
+      {
+         //Read the size of the chunk
+         error = httpClientReadChunkSize(connection);
+         //Any error to report?
+         if(error) return error;
+
+         //The last chunk terminates the body
+         if(connection->bodyComplete)
+            return ERROR_END_OF_STREAM;
+      }
+
+      //Limit the number of bytes to read
+      n = min(size, connection->byteCount);
+
+      //Read data
+      error = httpClientReceive(connection, data, n, received);
+      //Any error to report?
+      if(error) return error;
+
+      //Remaining data in the current chunk
+      connection->byteCount -= *received;
+
+      //The chunk data is followed by a CRLF sequence
+      if(!connection->byteCount)
+      {
+         //Skip the end of the chunk
+         error = httpClientReadLine(connection, &n);
+         //Any error to report?
+         if(error) return error;
+      }
+   }
+   //The body is delimited by the closing of the connection?
+   else if(connection->closeDelimited)
+   {
+      //Read data
+      error = httpClientReceive(connection, data, size, received);
+
+      //The server has closed the connection?
+      if(error == ERROR_END_OF_STREAM)
+         connection->bodyComplete = TRUE;
+      //Any error to report?
+      if(error) return error;
+   }
+   else
+   {
+      //Limit the number of bytes to read
+      n = min(size, connection->byteCount);
+
+      //Read data
+      error = httpClientReceive(connection, data, n, received);
+      //Any error to report?
+      if(error) return error;
+
+      //Decrement the count of remaining bytes to read
+      connection->byteCount -= *received;
+
+      //End of the response body?
+      if(!connection->byteCount)
+         connection->bodyComplete = TRUE;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Retrieve the status code of the response
+ * @param[in] connection Connection to the server
+ * @return Status code (0 if no response has been received)
+ **/
+
+uint_t httpClientGetStatusCode(HttpClientConnection *connection)
+{
+   //Invalid connection?
+   if(connection == NULL)
+      return 0;
+
+   //Return the status code of the last response
+   return connection->statusCode;
+}
+
+
+/**
+ * @brief Establish the connection with the server
+ * @param[in] connection Connection to the server
+ * @return Error code
+ **/
+
+error_t httpClientConnect(HttpClientConnection *connection)
+{
+   error_t error;
+   IpAddr serverIpAddr;
+   HttpClientSettings *settings;
+
+   //Point to the HTTP client settings
+   settings = &connection->context->settings;
+
+   //Debug message
+   TRACE_INFO("Connecting to HTTP server %s:%u...\r\n",
+      connection->host, connection->port);
+
+   //The server can be either an IP or a host name
+   error = getHostByName(settings->interface, connection->host,
+      &serverIpAddr, 1, NULL, 0);
+   //Unable to resolve server name?
+   if(error) return ERROR_NAME_RESOLUTION_FAILED;
+
+   //Open a TCP socket
+   connection->socket = socketOpen(SOCKET_TYPE_STREAM, SOCKET_PROTOCOL_TCP);
+   //Failed to open socket?
+   if(!connection->socket) return ERROR_OPEN_FAILED;
+
+   //Bind the socket to a particular network interface?
+   if(settings->interface)
+   {
+      //Associate the socket with the relevant interface
+      error = socketBindToInterface(connection->socket, settings->interface);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //Set timeout for blocking operations
+   error = socketSetTimeout(connection->socket, HTTP_CLIENT_TIMEOUT);
+   //Any error to report?
+   if(error) return error;
+
+   //Connect to the server
+   error = socketConnect(connection->socket, &serverIpAddr, connection->port);
+   //Connection to server failed?
+   if(error) return error;
+
+#if (HTTP_CLIENT_TLS_SUPPORT == ENABLED)
+   //Open a secure SSL/TLS session?
+   if(connection->useTls)
+   {
+      //Initialize TLS context
+      connection->tlsContext = tlsInit();
+      //Initialization failed?
+      if(!connection->tlsContext) return ERROR_OUT_OF_MEMORY;
+
+      //Bind TLS to the relevant socket
+      error = tlsSetSocket(connection->tlsContext, connection->socket);
+      //Any error to report?
+      if(error) return error;
+
+      //Select client operation mode
+      error = tlsSetConnectionEnd(connection->tlsContext, TLS_CONNECTION_END_CLIENT);
+      //Any error to report?
+      if(error) return error;
+
+      //Set the PRNG algorithm to be used
+      error = tlsSetPrng(connection->tlsContext, settings->prngAlgo, settings->prngContext);
+      //Any error to report?
+      if(error) return error;
+
+      //The server name is sent in the SNI extension and identifies the
+      //session to be resumed
+      error = tlsSetServerName(connection->tlsContext, connection->host);
+      //Any error to report?
+      if(error) return error;
+
+#if (TLS_CLIENT_CACHE_SUPPORT == ENABLED)
+      //Sessions are shared by all the connections of the client
+      if(connection->context->tlsClientCache != NULL)
+      {
+         //Select the session cache
+         error = tlsSetClientCache(connection->tlsContext,
+            connection->context->tlsClientCache);
+         //Any error to report?
+         if(error) return error;
+      }
+#endif
+
+      //Additional configuration (cipher suites, trusted CAs...)
+      if(settings->tlsInitCallback != NULL)
+      {
+         //Invoke user-defined callback
+         error = settings->tlsInitCallback(connection->context, connection->tlsContext);
+         //Any error to report?
+         if(error) return error;
+      }
+
+      //Perform TLS handshake. The last session established with the
+      //server is resumed when possible
+      error = tlsConnect(connection->tlsContext);
+      //Failed to established a TLS session?
+      if(error) return error;
+   }
+#endif
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Close the connection with the server
+ * @param[in] connection Connection to the server
+ **/
+
+void httpClientDisconnect(HttpClientConnection *connection)
+{
+#if (HTTP_CLIENT_TLS_SUPPORT == ENABLED)
+   //Gracefully close SSL/TLS session
+   if(connection->tlsContext != NULL)
+   {
+      tlsFree(connection->tlsContext);
+      connection->tlsContext = NULL;
+   }
+#endif
+
+   //Valid socket?
+   if(connection->socket != NULL)
+   {
+      //Graceful shutdown
+      socketShutdown(connection->socket, SOCKET_SD_BOTH);
+      //Close socket
+      socketClose(connection->socket);
+      connection->socket = NULL;
+   }
+}
+
+
+/**
+ * @brief Check whether an idle connection can be reused
+ *
+ * Nothing is expected from the server while the connection is idle. Any
+ * incoming data or a FIN means that the server is closing the connection
+ *
+ * @param[in] connection Connection to the server
+ * @return TRUE if the connection is still usable, else FALSE
+ **/
+
+bool_t httpClientIsAlive(HttpClientConnection *connection)
+{
+   error_t error;
+   SocketEventDesc eventDesc;
+
+   //Unexpected data left in the input buffer?
+   if(connection->rxOffset < connection->rxLength)
+      return FALSE;
+
+   //Check the state of the socket without blocking
+   eventDesc.socket = connection->socket;
+   eventDesc.eventMask = SOCKET_EVENT_CLOSED | SOCKET_EVENT_RX_READY |
+      SOCKET_EVENT_RX_SHUTDOWN;
+
+   //Poll the socket
+   error = socketPoll(&eventDesc, 1, NULL, 0);
+
+   //No event means that the connection is still open
+   return (error == ERROR_TIMEOUT || !eventDesc.eventFlags) ? TRUE : FALSE;
+}
+
+
+/**
+ * @brief Read the size of the next chunk
+ * @param[in] connection Connection to the server
+ * @return Error code
+ **/
+
+error_t httpClientReadChunkSize(HttpClientConnection *connection)
+{
+   error_t error;
+   size_t length;
+   char_t *p;
+
+   //Read the chunk-size line
+   error = httpClientReadLine(connection, &length);
+   //Any error to report?
+   if(error) return error;
+
+   //Chunk extensions, if any, are ignored
+   connection->byteCount = strtoul(connection->buffer, &p, 16);
+
+   //Make sure the chunk size is valid
+   if(p == connection->buffer || (*p != '\0' && *p != ';' && *p != ' '))
+      return ERROR_INVALID_SYNTAX;
+
+   //The last chunk has a size of zero
+   if(!connection->byteCount)
+   {
+      //Skip the trailer, which is terminated by an empty line
+      do
+      {
+         //Read a line
+         error = httpClientReadLine(connection, &length);
+         //Any error to report?
+         if(error) return error;
+      } while(length > 0);
+
+      //The response body has been read entirely
+      connection->bodyComplete = TRUE;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Read a line of the response header
+ *
+ * The CRLF sequence is removed and the line is stored in the buffer as a
+ * NULL-terminated string
+ *
+ * @param[in] connection Connection to the server
+ * @param[out] length Length of the line
+ * @return Error code
+ **/
+
+error_t httpClientReadLine(HttpClientConnection *connection, size_t *length)
+{
+   error_t error;
+   size_t n;
+   size_t m;
+   uint8_t *p;
+   uint8_t *q;
+
+   //The line is initially empty
+   n = 0;
+
+   //Read data until a LF character is encountered
+   while(1)
+   {
+      //The input buffer is empty?
+      if(connection->rxOffset >= connection->rxLength)
+      {
+         //Refill the input buffer
+         connection->rxOffset = 0;
+         connection->rxLength = 0;
+
+         //Read as much data as available
+         error = httpClientReceive(connection, connection->rxBuffer,
+            HTTP_CLIENT_RX_BUFFER_SIZE, &connection->rxLength);
+         //Any error to report?
+         if(error) return error;
+      }
+
+      //Point to the first unread byte
+      p = connection->rxBuffer + connection->rxOffset;
+      //Search the input buffer for the end of the line
+      q = memchr(p, '\n', connection->rxLength - connection->rxOffset);
+
+      //Number of bytes to copy
+      if(q != NULL)
+         m = q - p + 1;
+      else
+         m = connection->rxLength - connection->rxOffset;
+
+      //The line does not fit in the buffer?
+      if((n + m) >= HTTP_CLIENT_BUFFER_SIZE)
+         return ERROR_INVALID_SYNTAX;
+
+      //Copy the data
+      memcpy(connection->buffer + n, p, m);
+      connection->rxOffset += m;
+      n += m;
+
+      //End of line?
+      if(q != NULL)
+         break;
+   }
+
+   //Remove the trailing CRLF sequence
+   while(n > 0 && (connection->buffer[n - 1] == '\r' || connection->buffer[n - 1] == '\n'))
+      n--;
+
+   //Properly terminate the string with a NULL character
+   connection->buffer[n] = '\0';
+   //Return the length of the line
+   *length = n;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send data to the server
+ * @param[in] connection Connection to the server
+ * @param[in] data Pointer to the data to be transmitted
+ * @param[in] length Number of bytes to be transmitted
+ * @return Error code
+ **/
+
+error_t httpClientSend(HttpClientConnection *connection, const void *data, size_t length)
+{
+#if (HTTP_CLIENT_TLS_SUPPORT == ENABLED)
+   //Check whether a secure connection is being used
+   if(connection->tlsContext != NULL)
+   {
+      //Use SSL/TLS to transmit data to the server
+      return tlsWrite(connection->tlsContext, data, length, 0);
+   }
+   else
+#endif
+   {
+      //Transmit data to the server
+      return socketSend(connection->socket, data, length, NULL, 0);
+   }
+}
+
+
+/**
+ * @brief Receive data from the server
+ *
+ * The data left in the input buffer is returned first
+ *
+ * @param[in] connection Connection to the server
+ * @param[out] data Buffer into which received data will be placed
+ * @param[in] size Maximum number of bytes that can be received
+ * @param[out] received Actual number of bytes that have been received
+ * @return Error code
+ **/
+
+error_t httpClientReceive(HttpClientConnection *connection,
+   void *data, size_t size, size_t *received)
+{
+   error_t error;
+   size_t n;
+
+   //Any data left in the input buffer?
+   if(connection->rxOffset < connection->rxLength && data != connection->rxBuffer)
+   {
+      //Copy as much data as possible
+      n = min(size, connection->rxLength - connection->rxOffset);
+      memcpy(data, connection->rxBuffer + connection->rxOffset, n);
+
+      //Advance data pointer
+      connection->rxOffset += n;
+      *received = n;
+
+      //Successful processing
+      return NO_ERROR;
+   }
+
+#if (HTTP_CLIENT_TLS_SUPPORT == ENABLED)
+   //Check whether a secure connection is being used
+   if(connection->tlsContext != NULL)
+   {
+      //Use SSL/TLS to receive data from the server
+      error = tlsRead(connection->tlsContext, data, size, received, 0);
+   }
+   else
+#endif
+   {
+      //Receive data from the server
+      error = socketReceive(connection->socket, data, size, received, 0);
+   }
+
+   //The server has closed the connection?
+   if(!error && !*received)
+      error = ERROR_END_OF_STREAM;
+
+   //Return status code
+   return error;
+}
@@ -0,0 +1,230 @@
+/**
+ * @file http_client.h
+ * @brief HTTP/1.1 client with persistent connection pool
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _HTTP_CLIENT_H
+#define _HTTP_CLIENT_H
+
+//Dependencies
+#include "os.h"
+#include "socket.h"
+
+//Maximum time the client will wait for the server
+#ifndef HTTP_CLIENT_TIMEOUT
+   #define HTTP_CLIENT_TIMEOUT 10000
+#elif (HTTP_CLIENT_TIMEOUT < 1000)
+   #error HTTP_CLIENT_TIMEOUT parameter is invalid
+#endif
+
+//Maximum time an idle connection is kept in the pool. It should be shorter
+//than the keep-alive timeout of the servers
+#ifndef HTTP_CLIENT_IDLE_TIMEOUT
+   #define HTTP_CLIENT_IDLE_TIMEOUT 5000
+#elif (HTTP_CLIENT_IDLE_TIMEOUT < 0)
+   #error HTTP_CLIENT_IDLE_TIMEOUT parameter is invalid
+#endif
+
+//Maximum number of idle connections kept alive
+#ifndef HTTP_CLIENT_POOL_SIZE
+   #define HTTP_CLIENT_POOL_SIZE 2
+#elif (HTTP_CLIENT_POOL_SIZE < 1)
+   #error HTTP_CLIENT_POOL_SIZE parameter is invalid
+#endif
+
+//Maximum length of the host name
+#ifndef HTTP_CLIENT_MAX_HOST_LEN
+   #define HTTP_CLIENT_MAX_HOST_LEN 64
+#elif (HTTP_CLIENT_MAX_HOST_LEN < 1)
+   #error HTTP_CLIENT_MAX_HOST_LEN parameter is invalid
+#endif
+
+//Size of the buffer for header lines
+#ifndef HTTP_CLIENT_BUFFER_SIZE
+   #define HTTP_CLIENT_BUFFER_SIZE 512
+#elif (HTTP_CLIENT_BUFFER_SIZE < 128)
+   #error HTTP_CLIENT_BUFFER_SIZE parameter is invalid
+#endif
+
+//Size of the input buffer
+#ifndef HTTP_CLIENT_RX_BUFFER_SIZE
+   #define HTTP_CLIENT_RX_BUFFER_SIZE 536
+#elif (HTTP_CLIENT_RX_BUFFER_SIZE < 64)
+   #error HTTP_CLIENT_RX_BUFFER_SIZE parameter is invalid
+#endif
+
+//SSL/TLS support (HTTPS)
+#ifndef HTTP_CLIENT_TLS_SUPPORT
+   #define HTTP_CLIENT_TLS_SUPPORT DISABLED
+#elif (HTTP_CLIENT_TLS_SUPPORT != ENABLED && HTTP_CLIENT_TLS_SUPPORT != DISABLED)
+   #error HTTP_CLIENT_TLS_SUPPORT parameter is invalid
+#endif
+
+//Size of the session cache created by the client
+#ifndef HTTP_CLIENT_TLS_CACHE_SIZE
+   #define HTTP_CLIENT_TLS_CACHE_SIZE 4
+#elif (HTTP_CLIENT_TLS_CACHE_SIZE < 1)
+   #error HTTP_CLIENT_TLS_CACHE_SIZE parameter is invalid
+#endif
+
+//Check whether SSL/TLS support is enabled
+#if (HTTP_CLIENT_TLS_SUPPORT == ENABLED)
+   #include "tls.h"
+#endif
+
+//HTTP port number
+#ifndef HTTP_PORT
+   #define HTTP_PORT 80
+#endif
+
+//HTTPS port number (HTTP over SSL/TLS)
+#ifndef HTTPS_PORT
+   #define HTTPS_PORT 443
+#endif
+
+//Content length used to send the request body with chunked encoding
+#define HTTP_CLIENT_CHUNKED_BODY ((size_t) -1)
+
+//Forward declaration of HttpClientContext structure
+struct _HttpClientContext;
+
+
+/**
+ * @brief Callback invoked for each field of the response header
+ **/
+
+typedef void (*HttpClientHeaderCallback)(const char_t *name,
+   const char_t *value, void *param);
+
+
+#if (HTTP_CLIENT_TLS_SUPPORT == ENABLED)
+
+/**
+ * @brief TLS initialization callback
+ **/
+
+typedef error_t (*HttpClientTlsInitCallback)(struct _HttpClientContext *context,
+   TlsContext *tlsContext);
+
+#endif
+
+
+/**
+ * @brief HTTP client settings
+ **/
+
+typedef struct
+{
+   NetInterface *interface;                     ///<Underlying network interface (optional)
+#if (HTTP_CLIENT_TLS_SUPPORT == ENABLED)
+   const PrngAlgo *prngAlgo;                    ///<Pseudo-random number generator
+   void *prngContext;                           ///<Pseudo-random number generator context
+   TlsClientCache *tlsClientCache;              ///<Session cache (NULL to use the default one)
+   HttpClientTlsInitCallback tlsInitCallback;   ///<Additional TLS configuration (optional)
+#endif
+} HttpClientSettings;
+
+
+/**
+ * @brief Connection to an HTTP server
+ *
+ * A connection serves one request at a time. Once the response has been
+ * completely read, the connection returns to the pool of its client so
+ * that the next request to the same server skips the TCP and TLS handshakes
+ *
+ **/
+
+typedef struct
+{
+   struct _HttpClientContext *context;                 ///<HTTP client context
+   char_t host[HTTP_CLIENT_MAX_HOST_LEN + 1];          ///<Name of the server
+   uint16_t port;                                      ///<Port of the server
+   bool_t useTls;                                      ///<HTTPS connection
+   Socket *socket;                                     ///<Underlying socket
+#if (HTTP_CLIENT_TLS_SUPPORT == ENABLED)
+   TlsContext *tlsContext;                             ///<TLS context
+#endif
+   time_t timestamp;                                   ///<Time at which the connection became idle
+   uint_t requestCount;                                ///<Number of requests sent on this connection
+   bool_t headRequest;                                 ///<The response to a HEAD request has no body
+   bool_t chunkedRequest;                              ///<The request body uses chunked encoding
+   size_t requestByteCount;                            ///<Number of request body bytes left to send
+   uint_t statusCode;                                  ///<Status code of the response
+   bool_t keepAlive;                                   ///<The server keeps the connection open
+   bool_t chunkedEncoding;                             ///<The response body uses chunked encoding
+   bool_t closeDelimited;                              ///<The response body ends when the connection is closed
+   bool_t bodyComplete;                                ///<The response body has been completely read
+   size_t byteCount;                                   ///<Number of bytes left in the body or in the current chunk
+   char_t buffer[HTTP_CLIENT_BUFFER_SIZE];             ///<Buffer for header lines
+   uint8_t rxBuffer[HTTP_CLIENT_RX_BUFFER_SIZE];       ///<Input buffer
+   size_t rxOffset;                                    ///<Offset of the first unread byte
+   size_t rxLength;                                    ///<Number of bytes in the input buffer
+} HttpClientConnection;
+
+
+/**
+ * @brief HTTP client context
+ **/
+
+typedef struct _HttpClientContext
+{
+   HttpClientSettings settings;                        ///<User settings
+   OsMutex *mutex;                                     ///<Mutex protecting the pool
+#if (HTTP_CLIENT_TLS_SUPPORT == ENABLED && TLS_CLIENT_CACHE_SUPPORT == ENABLED)
+   TlsClientCache *tlsClientCache;                     ///<Session cache used by the connections
+#endif
+   HttpClientConnection *pool[HTTP_CLIENT_POOL_SIZE];  ///<Idle connections
+} HttpClientContext;
+
+
+//HTTP client related functions
+error_t httpClientInit(HttpClientContext *context, const HttpClientSettings *settings);
+void httpClientDeinit(HttpClientContext *context);
+
+error_t httpClientOpen(HttpClientContext *context, const char_t *host,
+   uint16_t port, bool_t useTls, HttpClientConnection **connection);
+void httpClientClose(HttpClientConnection *connection);
+
+error_t httpClientWriteHeader(HttpClientConnection *connection, const char_t *method,
+   const char_t *uri, const char_t *extraHeaders, size_t contentLength);
+error_t httpClientWriteBody(HttpClientConnection *connection, const void *data, size_t length);
+error_t httpClientReadHeader(HttpClientConnection *connection,
+   HttpClientHeaderCallback callback, void *param);
+error_t httpClientReadBody(HttpClientConnection *connection,
+   void *data, size_t size, size_t *received);
+uint_t httpClientGetStatusCode(HttpClientConnection *connection);
+
+error_t httpClientConnect(HttpClientConnection *connection);
+void httpClientDisconnect(HttpClientConnection *connection);
+bool_t httpClientIsAlive(HttpClientConnection *connection);
+error_t httpClientReadChunkSize(HttpClientConnection *connection);
+error_t httpClientReadLine(HttpClientConnection *connection, size_t *length);
+
+error_t httpClientSend(HttpClientConnection *connection, const void *data, size_t length);
+error_t httpClientReceive(HttpClientConnection *connection,
+   void *data, size_t size, size_t *received);
+
+#endif
@@ -30,6 +30,10 @@
  * - RFC 1945 : Hypertext Transfer Protocol - HTTP/1.0
  * - RFC 2616 : Hypertext Transfer Protocol - HTTP/1.1
  *
+ * By default, each connection is serviced by a dedicated task. In event-driven
+ * mode, a few worker tasks multiplex all the connections using non-blocking
+ * sockets, so that idle persistent connections no longer hold a task stack
+ *
  * @author Oryx Embedded (www.oryx-embedded.com)
  * @version 1.3.8
  **/
@@ -45,10 +49,17 @@
 #include "http_server.h"
 #include "mime.h"
 #include "ssi.h"
+#include "web_socket.h"
+#include "http2.h"
 #include "resource_manager.h"
 #include "str.h"
 #include "debug.h"
 
+//Resources read from a block device are streamed in blocking mode
+#if (RES_EXTERNAL_SUPPORT == ENABLED && HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+   #error RES_EXTERNAL_SUPPORT requires one task per connection
+#endif
+
 //HTTP status codes
 static const HttpStatusCodeDesc statusCodeList[] =
 {
@@ -57,6 +68,7 @@ static const HttpStatusCodeDesc statusCodeList[] =
    {201, "Created"},
    {202, "Accepted"},
    {204, "No Content"},
+   {206, "Partial Content"},
    //Redirection
    {301, "Moved Permanently"},
    {302, "Moved Temporarily"},
@@ -66,6 +78,7 @@ static const HttpStatusCodeDesc statusCodeList[] =
    {401, "Unauthorized"},
    {403, "Forbidden"},
    {404, "Not Found"},
+   {416, "Range Not Satisfiable"},
    //Server error
    {500, "Internal Server Error"},
    {501, "Not Implemented"},
@@ -85,6 +98,10 @@ error_t httpServerStart(HttpServerContext *context, const HttpServerSettings *se
 {
    error_t error;
    OsTask *task;
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+   uint_t i;
+   HttpServerWorker *worker;
+#endif
 
    //Debug message
    TRACE_INFO("Starting HTTP server...\r\n");
@@ -98,6 +115,36 @@ error_t httpServerStart(HttpServerContext *context, const HttpServerSettings *se
    //Save user settings
    context->settings = *settings;
 
+#if (HTTP_SERVER_STATS_SUPPORT == ENABLED)
+   //Create a mutex to protect the statistics
+   context->statsMutex = osMutexCreate(FALSE);
+   //Any error to report?
+   if(context->statsMutex == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Start collecting statistics
+   context->statsStartTime = osGetTickCount();
+#endif
+
+   //Index the routes registered by the application
+   error = httpInitRouteTable(context);
+   //Any error to report?
+   if(error) return error;
+
+#if (HTTP_SERVER_SSI_SUPPORT == ENABLED)
+   //Initialize SSI module
+   error = ssiInit();
+   //Any error to report?
+   if(error) return error;
+#endif
+
+#if (HTTP_SERVER_WEB_SOCKET_SUPPORT == ENABLED)
+   //Initialize WebSocket module
+   error = webSocketInit(context);
+   //Any error to report?
+   if(error) return error;
+#endif
+
    //Create a semaphore to limit the number of simultaneous connections
    context->semaphore = osSemaphoreCreate(HTTP_SERVER_MAX_CONNECTIONS,
       HTTP_SERVER_MAX_CONNECTIONS);
@@ -108,6 +155,17 @@ error_t httpServerStart(HttpServerContext *context, const HttpServerSettings *se
    //Start of exception handling block
    do
    {
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+      //HTTPS server?
+      if(settings->useTls)
+      {
+         //Create the TLS resources shared by the connections
+         error = httpInitTls(context);
+         //Any error to report?
+         if(error) break;
+      }
+#endif
+
       //Open a TCP socket
       context->socket = socketOpen(SOCKET_TYPE_STREAM, SOCKET_PROTOCOL_TCP);
       //Failed to open socket?
@@ -139,6 +197,46 @@ error_t httpServerStart(HttpServerContext *context, const HttpServerSettings *se
       //Any failure to report?
       if(error) break;
 
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+      //Start the worker tasks
+      for(i = 0; i < HTTP_SERVER_WORKER_COUNT; i++)
+      {
+         //Point to the current worker
+         worker = &context->worker[i];
+
+         //Initialize worker
+         worker->context = context;
+         worker->index = i;
+
+         //Create an event object used to signal new connections
+         worker->event = osEventCreate(FALSE, FALSE);
+         //Out of resources?
+         if(worker->event == OS_INVALID_HANDLE)
+         {
+            //Report an error
+            error = ERROR_OUT_OF_RESOURCES;
+            //Exit immediately
+            break;
+         }
+
+         //Create the worker task
+         task = osTaskCreate("HTTP Worker", httpWorkerTask,
+            worker, HTTP_SERVER_STACK_SIZE, HTTP_SERVER_PRIORITY);
+
+         //Unable to create the task?
+         if(task == OS_INVALID_HANDLE)
+         {
+            //Report an error
+            error = ERROR_OUT_OF_RESOURCES;
+            //Exit immediately
+            break;
+         }
+      }
+
+      //Propagate exception if necessary...
+      if(error) break;
+#endif
+
       //Create the HTTP server task
       task = osTaskCreate("HTTP Listener", httpListenerTask,
          context, HTTP_SERVER_STACK_SIZE, HTTP_SERVER_PRIORITY);
@@ -157,6 +255,10 @@ error_t httpServerStart(HttpServerContext *context, const HttpServerSettings *se
       osSemaphoreClose(context->semaphore);
       //Close socket
       socketClose(context->socket);
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+      //Release the TLS resources created by the server
+      httpFreeTls(context);
+#endif
    }
 
    //Return status code
@@ -178,7 +280,9 @@ void httpListenerTask(void *param)
    HttpServerContext *context;
    HttpConnection* connection;
    Socket *socket;
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == DISABLED)
    OsTask *task;
+#endif
 
    //Retrieve the HTTP server context
    context = (HttpServerContext *) param;
@@ -200,6 +304,10 @@ void httpListenerTask(void *param)
          //Debug message
          TRACE_INFO("Connection #%u refused with client %s port %u...\r\n",
             counter, ipAddrToString(&clientIpAddr, NULL), clientPort);
+#if (HTTP_SERVER_STATS_SUPPORT == ENABLED)
+         //Keep track of the connections refused
+         httpStatsRefuseConnection(context);
+#endif
          //Close socket
          socketClose(socket);
          //Connection request is requested
@@ -218,11 +326,28 @@ void httpListenerTask(void *param)
       {
          //Reference to the HTTP server settings
          connection->settings = &context->settings;
+         //Reference to the HTTP server context
+         connection->context = context;
          //Reference to the semaphore
          connection->semaphore = context->semaphore;
          //Reference to the new socket
          connection->socket = socket;
 
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+         //Hand the connection over to one of the worker tasks
+         error = httpAttachConnection(context, connection);
+
+         //Did we encounter an error?
+         if(error)
+         {
+            //Close socket
+            socketClose(connection->socket);
+            //Release semaphore
+            osSemaphoreRelease(connection->semaphore);
+            //Free previously allocated memory
+            osMemFree(connection);
+         }
+#else
          //Set timeout for blocking functions
          error = socketSetTimeout(connection->socket, HTTP_SERVER_TIMEOUT);
 
@@ -244,6 +369,7 @@ void httpListenerTask(void *param)
                osMemFree(connection);
             }
          }
+#endif
       }
    }
 }
@@ -262,9 +388,61 @@ void httpConnectionTask(void *param)
    //Point to the structure representing the HTTP connection
    HttpConnection *connection = (HttpConnection *) param;
 
+   //The input and output buffers are initially empty
+   connection->rxOffset = 0;
+   connection->rxLength = 0;
+   connection->txOffset = 0;
+   connection->txLength = 0;
+   connection->txFileData = NULL;
+   connection->txFileLength = 0;
+   connection->txFileCrlf = FALSE;
+
+#if (HTTP_SERVER_STATS_SUPPORT == ENABLED)
+   //Update statistics
+   httpStatsOpenConnection(connection);
+#endif
+
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+   //No TLS session for the moment
+   connection->tlsContext = NULL;
+#endif
+
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+   //HTTP/1.x is used until the client negotiates HTTP/2
+   connection->http2 = NULL;
+#endif
+
    //Process incoming requests
    for(counter = 0; counter < HTTP_SERVER_MAX_REQUESTS; counter++)
    {
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+      //The TLS handshake takes place before the first request
+      if(!counter && connection->settings->useTls)
+      {
+         //Open a secure SSL/TLS session
+         error = httpOpenTlsSession(connection);
+         //Failed to establish a TLS session?
+         if(error)
+         {
+            //Debug message
+            TRACE_INFO("TLS handshake failed...\r\n");
+            break;
+         }
+
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+         //The client has selected HTTP/2 through ALPN?
+         if(http2IsNegotiated(connection))
+         {
+            //Debug message
+            TRACE_INFO("Switching to HTTP/2 protocol...\r\n");
+            //All the requests are multiplexed over the connection
+            http2ProcessConnection(connection);
+            break;
+         }
+#endif
+      }
+#endif
+
       //Debug message
       TRACE_INFO("Waiting for request...\r\n");
 
@@ -278,66 +456,40 @@ void httpConnectionTask(void *param)
          break;
       }
 
-      //Debug message
-      TRACE_INFO("Sending HTTP response to the client...\r\n");
-
-      //Redirect to the default home page if necessary
-      if(!strcasecmp(connection->request.uri, "/"))
-         strcpy(connection->request.uri, connection->settings->defaultDocument);
-
-#if (HTTP_SERVER_SSI_SUPPORT == ENABLED)
-      //Use server-side scripting to dynamically generate HTML code?
-      if(httpCompExtension(connection->request.uri, ".stm") ||
-         httpCompExtension(connection->request.uri, ".shtm") ||
-         httpCompExtension(connection->request.uri, ".shtml"))
+#if (HTTP_SERVER_WEB_SOCKET_SUPPORT == ENABLED)
+      //The client asks to switch to the WebSocket protocol?
+      if(connection->request.upgradeWebSocket)
       {
-         //SSI processing (Server Side Includes)
-         error = ssiExecuteScript(connection, connection->request.uri, 0);
+         //Debug message
+         TRACE_INFO("Switching to WebSocket protocol...\r\n");
+         //The connection is closed when the WebSocket session ends
+         webSocketProcessRequest(connection);
+         break;
       }
-      else
 #endif
-      {
-         //Send the contents of the requested page
-         error = httpSendResponse(connection);
-      }
 
-      //The requested resource is not available?
-      if(error == ERROR_NOT_FOUND)
-      {
-         //Invoke user-defined callback, if any
-         if(connection->settings->uriNotFoundCallback != NULL)
-            error = connection->settings->uriNotFoundCallback(connection);
-      }
+      //Debug message
+      TRACE_INFO("Sending HTTP response to the client...\r\n");
 
-      //Page not found?
-      if(error == ERROR_NOT_FOUND)
-      {
-         //Send an error 404 and keep the connection alive
-         httpSendErrorResponse(connection, 404, "The requested page could not be found");
-      }
-      //Bad request?
-      else if(error == ERROR_INVALID_REQUEST)
-      {
-         //Send an error 400
-         httpSendErrorResponse(connection, 400, "The request is badly formed");
-         //Close the connection immediately
-         break;
-      }
-      //Internal error?
-      else if(error)
-      {
-         //Close the connection immediately
-         break;
-      }
+      //Send the response
+      error = httpProcessRequest(connection);
 
-      //Check whether the connection is persistent or not
-      if(!connection->request.keepAlive || !connection->response.keepAlive)
-      {
-         //Close the connection immediately
+      //Check whether the connection can be kept alive. The response is
+      //sent before waiting for the next request, so that the responses
+      //to pipelined requests are coalesced
+      if(!httpTerminateRequest(connection, error))
          break;
-      }
    }
 
+   //Send the data left in the output buffer
+   httpFlushStream(connection);
+
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+   //Gracefully close SSL/TLS session
+   if(connection->tlsContext != NULL)
+      tlsFree(connection->tlsContext);
+#endif
+
    //Debug message
    TRACE_INFO("Graceful shutdown...\r\n");
    //Graceful shutdown
@@ -348,6 +500,11 @@ void httpConnectionTask(void *param)
    //Close socket
    socketClose(connection->socket);
 
+#if (HTTP_SERVER_STATS_SUPPORT == ENABLED)
+   //Update statistics
+   httpStatsCloseConnection(connection);
+#endif
+
    //Release semaphore
    osSemaphoreRelease(connection->semaphore);
    //Release connection context
@@ -358,580 +515,2952 @@ void httpConnectionTask(void *param)
 }
 
 
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+
 /**
- * @brief Read HTTP request header and parse its contents
- * @param[in] connection Structure representing an HTTP connection
+ * @brief Create the TLS resources shared by the connections
+ *
+ * All the connections use the same session cache and the same session
+ * ticket keys, so that returning clients resume their sessions rather
+ * than performing a full handshake
+ *
+ * @param[in] context Pointer to the HTTP server context
  * @return Error code
  **/
 
-error_t httpReadHeader(HttpConnection *connection)
+error_t httpInitTls(HttpServerContext *context)
 {
-   error_t error;
-   uint_t length;
-   char_t *token;
-   char_t *p;
-   char_t *s;
-
-   //Read the first line of the request
-   error = socketReceive(connection->socket, connection->buffer,
-      HTTP_SERVER_BUFFER_SIZE - 1, &length, SOCKET_FLAG_BREAK_CRLF);
-   //Unable to read any data?
-   if(error) return error;
-
-   //Properly terminate the string with a NULL character
-   connection->buffer[length] = '\0';
-   //Debug message
-   TRACE_INFO("%s\r\n", connection->buffer);
+   //Check parameters
+   if(context->settings.prngAlgo == NULL || context->settings.certChain == NULL ||
+      context->settings.privateKey == NULL)
+   {
+      return ERROR_INVALID_PARAMETER;
+   }
 
-   //The Request-Line begins with a method token
-   token = strtok_r(connection->buffer, " \r\n", &p);
-   //Unable to retrieve the method?
-   if(!token) return ERROR_INVALID_REQUEST;
+   //Use the session cache supplied by the application, if any
+   context->tlsCache = context->settings.tlsCache;
 
-   //GET method?
-   if(!strcasecmp(token, "GET"))
-      connection->request.method = HTTP_METHOD_GET;
-   //HEAD method?
-   else if(!strcasecmp(token, "HEAD"))
-      connection->request.method = HTTP_METHOD_HEAD;
-   //POST method?
-   else if(!strcasecmp(token, "POST"))
-      connection->request.method = HTTP_METHOD_POST;
-   //Unsupported method?
-   else
-      return ERROR_INVALID_REQUEST;
+   //Otherwise create one
+   if(context->tlsCache == NULL)
+   {
+      //Initialize session cache
+      context->tlsCache = tlsInitCache(HTTP_SERVER_TLS_CACHE_SIZE);
+      //Failed to allocate memory?
+      if(context->tlsCache == NULL)
+         return ERROR_OUT_OF_MEMORY;
+   }
 
-   //The Request-URI is following the method token
-   token = strtok_r(NULL, " \r\n", &p);
-   //Unable to retrieve the Request-URI?
-   if(!token)
-      return ERROR_INVALID_REQUEST;
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //Use the session ticket keys supplied by the application, if any
+   context->tlsTicketContext = context->settings.tlsTicketContext;
 
-   //Check whether a query string is present
-   s = strchr(token, '?');
-   //Query string found?
-   if(s != NULL)
+   //Otherwise generate them
+   if(context->tlsTicketContext == NULL)
    {
-      //Calculate the length of the Request-URI
-      uint_t n = s - token;
+      //Initialize ticket context
+      context->tlsTicketContext = tlsInitTicketContext();
+      //Any error to report?
+      if(context->tlsTicketContext == NULL)
+         return ERROR_OUT_OF_RESOURCES;
+   }
+#endif
 
-      //Check the length of the field
-      if(n > HTTP_SERVER_URI_MAX_LEN)
-         return ERROR_INVALID_REQUEST;
+   //Successful processing
+   return NO_ERROR;
+}
 
-      //Save the Request-URI
-      strncpy(connection->request.uri, token, n);
-      //Properly terminate the string
-      connection->request.uri[n] = '\0';
 
-      //Check the length of the query string
-      if(strlen(s + 1) > HTTP_SERVER_QUERY_STRING_MAX_LEN)
-         return ERROR_INVALID_REQUEST;
+/**
+ * @brief Release the TLS resources created by the server
+ * @param[in] context Pointer to the HTTP server context
+ **/
 
-      //Save the query string
-      strcpy(connection->request.queryString, s + 1);
-   }
-   else
+void httpFreeTls(HttpServerContext *context)
+{
+   //Resources supplied by the application are not released
+   if(context->tlsCache != NULL && context->tlsCache != context->settings.tlsCache)
+      tlsFreeCache(context->tlsCache);
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //Release ticket context
+   if(context->tlsTicketContext != NULL &&
+      context->tlsTicketContext != context->settings.tlsTicketContext)
    {
-      //Check the length of the field
-      if(strlen(token) > HTTP_SERVER_URI_MAX_LEN)
-         return ERROR_INVALID_REQUEST;
-
-      //Save the Request-URI
-      strcpy(connection->request.uri, token);
-      //No query string
-      connection->request.queryString[0] = '\0';
+      tlsFreeTicketContext(context->tlsTicketContext);
    }
+#endif
 
-   //The protocol version is following the Request-URI
-   token = strtok_r(NULL, " \r\n", &p);
+   //The resources are no longer available
+   context->tlsCache = NULL;
+   context->tlsTicketContext = NULL;
+}
 
-   //HTTP version 0.9?
-   if(!token)
-   {
-      //Save version number
-      connection->request.version = HTTP_VERSION_0_9;
-      //Persistent connections are not supported
-      connection->request.keepAlive = FALSE;
-   }
-   //HTTP version 1.0?
-   else if(!strcasecmp(token, "HTTP/1.0"))
-   {
-      //Save version number
-      connection->request.version = HTTP_VERSION_1_0;
-      //By default connections are not persistent
-      connection->request.keepAlive = FALSE;
-   }
-   //HTTP version 1.1?
-   else if(!strcasecmp(token, "HTTP/1.1"))
-   {
-      //Save version number
-      connection->request.version = HTTP_VERSION_1_1;
-      //HTTP 1.1 makes persistent connections the default
-      connection->request.keepAlive = TRUE;
-   }
-   //HTTP version not supported?
-   else
-   {
-      return ERROR_INVALID_REQUEST;
-   }
 
-   //Default value for properties
-   connection->request.chunkedEncoding = FALSE;
-   connection->request.contentLength = 0;
+/**
+ * @brief Open a secure SSL/TLS session with the client
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
 
-   //HTTP 0.9 does not support Full-Request
-   if(connection->request.version >= HTTP_VERSION_1_0)
-   {
-      //Local variables
-      char_t *separator;
-      char_t *property;
-      char_t *value;
+error_t httpOpenTlsSession(HttpConnection *connection)
+{
+   error_t error;
+   TlsContext *tlsContext;
+   HttpServerSettings *settings;
 
-      //Parse header request fields
-      while(1)
-      {
-         //Read a complete line
-         error = socketReceive(connection->socket, connection->buffer,
-            HTTP_SERVER_BUFFER_SIZE - 1, &length, SOCKET_FLAG_BREAK_CRLF);
+   //Point to the HTTP server settings
+   settings = connection->settings;
 
-         //Any error to report?
-         if(error)
-            return error;
-         //Unable to read any data?
-         if(!length)
-            return ERROR_INVALID_REQUEST;
+   //Initialize TLS context
+   tlsContext = tlsInit();
+   //Initialization failed?
+   if(!tlsContext) return ERROR_OUT_OF_MEMORY;
 
-         //Properly terminate the string with a NULL character
-         connection->buffer[length] = '\0';
+   //The TLS context is released when the connection is closed
+   connection->tlsContext = tlsContext;
 
-         //The end of the header has been reached?
-         if(!strcmp(connection->buffer, "\r\n"))
-            break;
+   //Bind TLS to the relevant socket
+   error = tlsSetSocket(tlsContext, connection->socket);
+   //Any error to report?
+   if(error) return error;
 
-         //Check whether a separator is present
-         separator = strchr(connection->buffer, ':');
-         //Separator found?
-         if(separator)
-         {
-            //Split the line
-            *separator = '\0';
+   //Select server operation mode
+   error = tlsSetConnectionEnd(tlsContext, TLS_CONNECTION_END_SERVER);
+   //Any error to report?
+   if(error) return error;
 
-            //Get property name and value
-            property = strTrimWhitespace(connection->buffer);
-            value = strTrimWhitespace(separator + 1);
+   //Set the PRNG algorithm to be used
+   error = tlsSetPrng(tlsContext, settings->prngAlgo, settings->prngContext);
+   //Any error to report?
+   if(error) return error;
 
-            //Connection property found?
-            if(!strcasecmp(property, "Connection"))
-            {
-               //Check whether persistent connections are supported or not
-               if(!strcasecmp(value, "keep-alive"))
-                  connection->request.keepAlive = TRUE;
-               else if(!strcasecmp(value, "close"))
-                  connection->request.keepAlive = FALSE;
-            }
-            //Transfer-Encoding property found?
-            else if(!strcasecmp(property, "Transfer-Encoding"))
-            {
-               //Check whether chunked encoding is used
-               if(!strcasecmp(value, "chunked"))
-                  connection->request.chunkedEncoding = TRUE;
-            }
-            //Content-Length property found?
-            else if(!strcasecmp(property, "Content-Length"))
-            {
-               //Get the length of the body data
-               connection->request.contentLength = atoi(value);
-            }
+   //Sessions are shared by all the connections
+   error = tlsSetCache(tlsContext, connection->context->tlsCache);
+   //Any error to report?
+   if(error) return error;
+
+#if (TLS_TICKET_SUPPORT == ENABLED)
+   //Offer stateless session resumption
+   error = tlsSetTicketContext(tlsContext, connection->context->tlsTicketContext);
+   //Any error to report?
+   if(error) return error;
+#endif
+
+   //Import the server's certificate chain and private key
+   error = tlsAddCertificate(tlsContext, settings->certChain,
+      settings->certChainLength, settings->privateKey, settings->privateKeyLength);
+   //Any error to report?
+   if(error) return error;
+
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+   //Offer HTTP/2, falling back to HTTP/1.1 for older clients
+   error = tlsSetAlpnProtocolList(tlsContext, HTTP2_ALPN_PROTOCOL ",http/1.1");
+   //Any error to report?
+   if(error) return error;
+#endif
+
+   //Additional configuration (cipher suites, DH parameters...)
+   if(settings->tlsInitCallback != NULL)
+   {
+      //Invoke user-defined callback
+      error = settings->tlsInitCallback(connection, tlsContext);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //Perform TLS handshake
+   return tlsConnect(tlsContext);
+}
+
+#endif
+
+
+/**
+ * @brief Index the routes registered by the application
+ * @param[in] context Pointer to the HTTP server context
+ * @return Error code
+ **/
+
+error_t httpInitRouteTable(HttpServerContext *context)
+{
+   error_t error;
+   uint_t i;
+
+   //Loop through the routes
+   for(i = 0; i < context->settings.routeCount; i++)
+   {
+      //Add the current route to the table
+      error = httpAddRoute(context, &context->settings.routes[i]);
+      //Any error to report?
+      if(error) return error;
+   }
+
+#if (HTTP_SERVER_STATS_SUPPORT == ENABLED)
+   //Performance metrics exposed through a built-in URI?
+   if(context->settings.statsUri != NULL)
+   {
+      //The URI must match exactly
+      context->statsRoute.path = context->settings.statsUri;
+      context->statsRoute.flags = HTTP_ROUTE_FLAG_EXACT;
+      context->statsRoute.callback = httpSendStats;
+
+      //Add the built-in route to the table
+      error = httpAddRoute(context, &context->statsRoute);
+      //Any error to report?
+      if(error) return error;
+   }
+#endif
+
+#if (NET_CAPTURE_SUPPORT == ENABLED)
+   //Packet capture exposed through a built-in URI?
+   if(context->settings.captureUri != NULL)
+   {
+      //The URI must match exactly
+      context->captureRoute.path = context->settings.captureUri;
+      context->captureRoute.flags = HTTP_ROUTE_FLAG_EXACT;
+      context->captureRoute.callback = httpSendCapture;
+
+      //Add the built-in route to the table
+      error = httpAddRoute(context, &context->captureRoute);
+      //Any error to report?
+      if(error) return error;
+   }
+#endif
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Add a route to the route table
+ * @param[in] context Pointer to the HTTP server context
+ * @param[in] route Route to be added (must remain valid while the server runs)
+ * @return Error code
+ **/
+
+error_t httpAddRoute(HttpServerContext *context, const HttpRoute *route)
+{
+   uint_t i;
+   uint_t k;
+   uint32_t hash;
+   size_t length;
+
+   //Check parameters
+   if(route->path == NULL || route->path[0] != '/' || route->callback == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Get the length of the path
+   length = strlen(route->path);
+
+   //The path of a prefix route must end with a slash
+   if((route->flags & HTTP_ROUTE_FLAG_PREFIX) && route->path[length - 1] != '/')
+      return ERROR_INVALID_PARAMETER;
+
+   //Hash the path (FNV-1a)
+   for(hash = 2166136261UL, i = 0; i < length; i++)
+      hash = (hash ^ (uint8_t) route->path[i]) * 16777619UL;
+
+   //Search for a free entry (linear probing)
+   for(k = 0; k < HTTP_SERVER_ROUTE_TABLE_SIZE; k++)
+   {
+      //Index of the entry to probe
+      i = (hash + k) & (HTTP_SERVER_ROUTE_TABLE_SIZE - 1);
+
+      //Free entry found?
+      if(context->routeTable[i].route == NULL)
+      {
+         //Save the route
+         context->routeTable[i].hash = hash;
+         context->routeTable[i].route = route;
+         //One more route in the table
+         context->routeCount++;
+
+         //Successful processing
+         return NO_ERROR;
+      }
+   }
+
+   //The route table is full
+   return ERROR_OUT_OF_RESOURCES;
+}
+
+
+/**
+ * @brief Search the route table for the handler of a given URI
+ *
+ * The URI is hashed in a single pass, and the route table is probed for
+ * each of its prefixes that end with a slash, so the lookup time does not
+ * depend on the number of routes
+ *
+ * @param[in] context Pointer to the HTTP server context
+ * @param[in] uri NULL-terminated string containing the URI
+ * @return Matching route, or NULL if no route matches the URI
+ **/
+
+const HttpRoute *httpFindRoute(HttpServerContext *context, const char_t *uri)
+{
+   size_t n;
+   uint32_t hash;
+   const HttpRoute *route;
+   const HttpRoute *prefixRoute;
+
+   //No routes registered?
+   if(!context->routeCount)
+      return NULL;
+
+   //Hash the URI (FNV-1a)
+   for(prefixRoute = NULL, hash = 2166136261UL, n = 0; uri[n] != '\0'; n++)
+   {
+      //Update the hash value
+      hash = (hash ^ (uint8_t) uri[n]) * 16777619UL;
+
+      //The path of a prefix route ends with a slash
+      if(uri[n] == '/')
+      {
+         //Search for a prefix route matching the current prefix
+         route = httpLookupRoute(context, uri, n + 1, hash, HTTP_ROUTE_FLAG_PREFIX);
+         //The longest prefix takes precedence
+         if(route != NULL)
+            prefixRoute = route;
+      }
+   }
+
+   //Search for an exact route matching the whole URI
+   route = httpLookupRoute(context, uri, n, hash, HTTP_ROUTE_FLAG_EXACT);
+
+   //Exact routes take precedence over prefix routes
+   return (route != NULL) ? route : prefixRoute;
+}
+
+
+/**
+ * @brief Probe the route table
+ * @param[in] context Pointer to the HTTP server context
+ * @param[in] path Path to search for (not necessarily NULL-terminated)
+ * @param[in] length Length of the path
+ * @param[in] hash Hash value of the path
+ * @param[in] flags Type of route to search for
+ * @return Matching route, or NULL if no route matches the path
+ **/
+
+const HttpRoute *httpLookupRoute(HttpServerContext *context,
+   const char_t *path, size_t length, uint32_t hash, uint_t flags)
+{
+   uint_t i;
+   uint_t k;
+   const HttpRoute *route;
+
+   //Probe the entries that follow the home position
+   for(k = 0; k < HTTP_SERVER_ROUTE_TABLE_SIZE; k++)
+   {
+      //Index of the entry to probe
+      i = (hash + k) & (HTTP_SERVER_ROUTE_TABLE_SIZE - 1);
+      //Point to the route
+      route = context->routeTable[i].route;
+
+      //A free entry terminates the probe sequence
+      if(route == NULL)
+         break;
+
+      //Compare hash values first, then routes
+      if(context->routeTable[i].hash == hash &&
+         (route->flags & HTTP_ROUTE_FLAG_PREFIX) == flags &&
+         !strncmp(route->path, path, length) && route->path[length] == '\0')
+      {
+         //Matching route found
+         return route;
+      }
+   }
+
+   //No matching route
+   return NULL;
+}
+
+
+#if (HTTP_SERVER_STATS_SUPPORT == ENABLED)
+
+//Statistics exposed through the built-in URI
+static const HttpStatsField httpStatsFieldList[] =
+{
+   {"uptime",             offsetof(HttpServerStats, uptime)},
+   {"connections",        offsetof(HttpServerStats, connections)},
+   {"refusedConnections", offsetof(HttpServerStats, refusedConnections)},
+   {"activeConnections",  offsetof(HttpServerStats, activeConnections)},
+   {"peakConnections",    offsetof(HttpServerStats, peakConnections)},
+   {"requests",           offsetof(HttpServerStats, requests)},
+   {"bytesSent",          offsetof(HttpServerStats, bytesSent)},
+   {"headerTime",         offsetof(HttpServerStats, headerTime)},
+   {"maxHeaderTime",      offsetof(HttpServerStats, maxHeaderTime)},
+   {"firstByteTime",      offsetof(HttpServerStats, firstByteTime)},
+   {"maxFirstByteTime",   offsetof(HttpServerStats, maxFirstByteTime)},
+   {"responseTime",       offsetof(HttpServerStats, responseTime)},
+   {"maxResponseTime",    offsetof(HttpServerStats, maxResponseTime)},
+   {"scriptRequests",     offsetof(HttpServerStats, scriptRequests)},
+   {"scriptTime",         offsetof(HttpServerStats, scriptTime)},
+   {"maxScriptTime",      offsetof(HttpServerStats, maxScriptTime)},
+   {"callbackRequests",   offsetof(HttpServerStats, callbackRequests)},
+   {"callbackTime",       offsetof(HttpServerStats, callbackTime)},
+   {"maxCallbackTime",    offsetof(HttpServerStats, maxCallbackTime)}
+};
+
+
+/**
+ * @brief Retrieve the HTTP server statistics
+ * @param[in] context Pointer to the HTTP server context
+ * @param[out] stats Statistics collected since the server was started
+ *   or since the last call to httpResetStats()
+ * @return Error code
+ **/
+
+error_t httpGetStats(HttpServerContext *context, HttpServerStats *stats)
+{
+   //Check parameters
+   if(context == NULL || stats == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Acquire exclusive access to the statistics
+   osMutexAcquire(context->statsMutex);
+
+   //Copy the statistics
+   *stats = context->stats;
+   //Time elapsed since the statistics were reset
+   stats->uptime = osGetTickCount() - context->statsStartTime;
+
+   //Release exclusive access to the statistics
+   osMutexRelease(context->statsMutex);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Reset the HTTP server statistics
+ * @param[in] context Pointer to the HTTP server context
+ **/
+
+void httpResetStats(HttpServerContext *context)
+{
+   uint32_t activeConnections;
+
+   //Acquire exclusive access to the statistics
+   osMutexAcquire(context->statsMutex);
+
+   //The open connections are not affected
+   activeConnections = context->stats.activeConnections;
+
+   //Clear the statistics
+   memset(&context->stats, 0, sizeof(HttpServerStats));
+   context->stats.activeConnections = activeConnections;
+   context->stats.peakConnections = activeConnections;
+   context->statsStartTime = osGetTickCount();
+
+   //Release exclusive access to the statistics
+   osMutexRelease(context->statsMutex);
+}
+
+
+/**
+ * @brief Send the HTTP server statistics (built-in URI)
+ *
+ * The statistics are sent as plain text, one "name: value" pair per line
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t httpSendStats(HttpConnection *connection)
+{
+   error_t error;
+   uint_t i;
+   size_t length;
+   HttpServerStats stats;
+
+   //Take a snapshot of the statistics
+   httpGetStats(connection->context, &stats);
+
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+   //Resume where the previous invocation stopped
+   i = connection->callbackState;
+#else
+   //Start with the response header
+   i = 0;
+#endif
+
+   //The response header has not been sent yet?
+   if(i == 0)
+   {
+      //Format HTTP response header
+      connection->response.version = connection->request.version;
+      connection->response.statusCode = 200;
+      connection->response.keepAlive = connection->request.keepAlive;
+      connection->response.noCache = TRUE;
+      connection->response.contentType = mimeGetType(".txt");
+      connection->response.contentEncoding = NULL;
+      connection->response.etag[0] = '\0';
+      connection->response.acceptRanges = FALSE;
+      connection->response.chunkedEncoding = TRUE;
+
+      //Send the header to the client
+      error = httpWriteHeader(connection);
+      //Any error to report?
+      if(error) return error;
+
+      //The header has been queued
+      i = 1;
+   }
+
+   //Send the statistics one line at a time
+   while(1)
+   {
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+      //Save progress, in case the output buffer is full
+      connection->callbackState = i;
+#endif
+
+      //Format the current line
+      length = httpFormatStats(&stats, i - 1, connection->buffer);
+      //No more lines?
+      if(!length) break;
+
+      //Send the current line
+      error = httpWriteStream(connection, connection->buffer, length);
+      //Any error to report?
+      if(error) return error;
+
+      //Next line
+      i++;
+   }
+
+   //Properly close output stream
+   return httpCloseStream(connection);
+}
+
+
+/**
+ * @brief Format a line of the statistics report
+ * @param[in] stats Statistics to format
+ * @param[in] index Index of the line
+ * @param[out] buffer Buffer where to format the line
+ * @return Length of the line, or 0 if the index is past the last line
+ **/
+
+size_t httpFormatStats(const HttpServerStats *stats, uint_t index, char_t *buffer)
+{
+   uint32_t value;
+
+   //Counters come first
+   if(index < arraysize(httpStatsFieldList))
+   {
+      //Retrieve the value of the counter
+      value = *(const uint32_t *) ((const uint8_t *) stats + httpStatsFieldList[index].offset);
+      //Format the line
+      return sprintf(buffer, "%s: %lu\r\n", httpStatsFieldList[index].name, (unsigned long) value);
+   }
+
+   //Then the buckets of the response time histogram
+   index -= arraysize(httpStatsFieldList);
+
+   //Past the last bucket?
+   if(index >= HTTP_SERVER_STATS_HISTOGRAM_SIZE)
+      return 0;
+
+   //The last bucket has no upper bound
+   if(index == (HTTP_SERVER_STATS_HISTOGRAM_SIZE - 1))
+   {
+      return sprintf(buffer, "responseTimeHistogram[>=%lums]: %lu\r\n",
+         1UL << (index - 1), (unsigned long) stats->responseTimeHistogram[index]);
+   }
+   else
+   {
+      return sprintf(buffer, "responseTimeHistogram[<%lums]: %lu\r\n",
+         1UL << index, (unsigned long) stats->responseTimeHistogram[index]);
+   }
+}
+
+
+/**
+ * @brief Account for a new connection
+ * @param[in] connection Structure representing the new connection
+ **/
+
+void httpStatsOpenConnection(HttpConnection *connection)
+{
+   HttpServerContext *context;
+
+   //Point to the HTTP server context
+   context = connection->context;
+
+   //No request has been received yet
+   memset(&connection->metrics, 0, sizeof(HttpRequestMetrics));
+
+   //Acquire exclusive access to the statistics
+   osMutexAcquire(context->statsMutex);
+
+   //Update connection counters
+   context->stats.connections++;
+   context->stats.activeConnections++;
+   context->stats.peakConnections = max(context->stats.peakConnections,
+      context->stats.activeConnections);
+
+   //Release exclusive access to the statistics
+   osMutexRelease(context->statsMutex);
+}
+
+
+/**
+ * @brief Account for a connection refused by the server
+ * @param[in] context Pointer to the HTTP server context
+ **/
+
+void httpStatsRefuseConnection(HttpServerContext *context)
+{
+   //Acquire exclusive access to the statistics
+   osMutexAcquire(context->statsMutex);
+   //HTTP_SERVER_MAX_CONNECTIONS connections are already open
+   context->stats.refusedConnections++;
+   //Release exclusive access to the statistics
+   osMutexRelease(context->statsMutex);
+}
+
+
+/**
+ * @brief Account for the closure of a connection
+ * @param[in] connection Structure representing the connection
+ **/
+
+void httpStatsCloseConnection(HttpConnection *connection)
+{
+   HttpServerContext *context;
+
+   //Point to the HTTP server context
+   context = connection->context;
+
+   //Acquire exclusive access to the statistics
+   osMutexAcquire(context->statsMutex);
+
+   //Data sent after the completion of the last request
+   context->stats.bytesSent += connection->metrics.bytesSent;
+   //One less connection
+   context->stats.activeConnections--;
+
+   //Release exclusive access to the statistics
+   osMutexRelease(context->statsMutex);
+}
+
+
+/**
+ * @brief Start measuring a new request
+ * @param[in] connection Structure representing an HTTP connection
+ **/
+
+void httpStatsStartRequest(HttpConnection *connection)
+{
+   uint32_t bytesSent;
+
+   //The response to the previous request may be still in flight
+   bytesSent = connection->metrics.bytesSent;
+
+   //Reset the metrics of the request
+   memset(&connection->metrics, 0, sizeof(HttpRequestMetrics));
+   connection->metrics.bytesSent = bytesSent;
+
+   //The Request-Line has just been received
+   connection->metrics.startTime = osGetTickCount();
+}
+
+
+/**
+ * @brief Account for a completed request
+ * @param[in] connection Structure representing an HTTP connection
+ **/
+
+void httpStatsCompleteRequest(HttpConnection *connection)
+{
+   uint_t i;
+   uint32_t time;
+   HttpRequestMetrics *metrics;
+   HttpServerStats *stats;
+
+   //Point to the metrics of the request
+   metrics = &connection->metrics;
+   //Point to the statistics
+   stats = &connection->context->stats;
+
+   //Response time
+   time = osGetTickCount() - metrics->startTime;
+
+   //Small responses may be entirely buffered at this point
+   if(!metrics->firstByteSent)
+      metrics->firstByteTime = time;
+
+   //Select the relevant bucket of the histogram
+   for(i = 0; i < (HTTP_SERVER_STATS_HISTOGRAM_SIZE - 1) && (time >> i) != 0; i++);
+
+   //Acquire exclusive access to the statistics
+   osMutexAcquire(connection->context->statsMutex);
+
+   //Update request counters
+   stats->requests++;
+   stats->bytesSent += metrics->bytesSent;
+   stats->headerTime += metrics->headerTime;
+   stats->maxHeaderTime = max(stats->maxHeaderTime, metrics->headerTime);
+   stats->firstByteTime += metrics->firstByteTime;
+   stats->maxFirstByteTime = max(stats->maxFirstByteTime, metrics->firstByteTime);
+   stats->responseTime += time;
+   stats->maxResponseTime = max(stats->maxResponseTime, time);
+   stats->responseTimeHistogram[i]++;
+
+   //The response was generated by an SSI script?
+   if(metrics->scriptCount > 0)
+   {
+      stats->scriptRequests++;
+      stats->scriptTime += metrics->scriptTime;
+      stats->maxScriptTime = max(stats->maxScriptTime, metrics->scriptTime);
+   }
+
+   //Any user-defined callback invoked?
+   if(metrics->callbackCount > 0)
+   {
+      stats->callbackRequests++;
+      stats->callbackTime += metrics->callbackTime;
+      stats->maxCallbackTime = max(stats->maxCallbackTime, metrics->callbackTime);
+   }
+
+   //Release exclusive access to the statistics
+   osMutexRelease(connection->context->statsMutex);
+
+   //The bytes sent so far have been accounted for
+   metrics->bytesSent = 0;
+}
+
+#endif
+
+
+#if (NET_CAPTURE_SUPPORT == ENABLED)
+
+/**
+ * @brief Send the captured frames as a pcap file (built-in URI)
+ *
+ * Only the frames held in the ring when the request is received are
+ * sent, so that the capture of the response itself does not keep the
+ * transfer going. The transfer ends early if the frames that have not
+ * been sent yet get overwritten
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t httpSendCapture(HttpConnection *connection)
+{
+   error_t error;
+   uint_t i;
+   size_t length;
+   uint32_t first;
+
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+   //Resume where the previous invocation stopped
+   i = connection->callbackState;
+   first = connection->callbackParam;
+#else
+   //Start with the response header
+   i = 0;
+   first = 0;
+#endif
+
+   //The response header has not been sent yet?
+   if(i == 0)
+   {
+      //Oldest frame to be sent
+      first = netCaptureGetFirstRecord();
+
+      //Format HTTP response header
+      connection->response.version = connection->request.version;
+      connection->response.statusCode = 200;
+      connection->response.keepAlive = connection->request.keepAlive;
+      connection->response.noCache = TRUE;
+      connection->response.contentType = mimeGetType(".pcap");
+      connection->response.contentEncoding = NULL;
+      connection->response.etag[0] = '\0';
+      connection->response.acceptRanges = FALSE;
+      connection->response.chunkedEncoding = TRUE;
+
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+      //Save the oldest frame to be sent
+      connection->callbackParam = first;
+#endif
+
+      //Send the header to the client
+      error = httpWriteHeader(connection);
+      //Any error to report?
+      if(error) return error;
+
+      //The header has been queued
+      i = 1;
+   }
+
+   //Send the pcap global header, then one frame at a time
+   while(1)
+   {
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+      //Save progress, in case the output buffer is full
+      connection->callbackState = i;
+#endif
+
+      //Global header?
+      if(i == 1)
+      {
+         //Format the pcap global header
+         length = netCaptureFormatHeader((uint8_t *) connection->buffer);
+      }
+      //Frames held in the ring when the request was received?
+      else if((i - 2) < NET_CAPTURE_RING_SIZE)
+      {
+         //Format the current frame
+         length = netCaptureFormatRecord(first + i - 2,
+            (uint8_t *) connection->buffer, HTTP_SERVER_BUFFER_SIZE);
+      }
+      else
+      {
+         //No more frames
+         length = 0;
+      }
+
+      //No more data?
+      if(!length) break;
+
+      //Send the current chunk of the file
+      error = httpWriteStream(connection, connection->buffer, length);
+      //Any error to report?
+      if(error) return error;
+
+      //Next frame
+      i++;
+   }
+
+   //Properly close output stream
+   return httpCloseStream(connection);
+}
+
+#endif
+
+
+/**
+ * @brief Send the response to the current request
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t httpProcessRequest(HttpConnection *connection)
+{
+   error_t error;
+   const HttpRoute *route;
+
+   //Redirect to the default home page if necessary
+   if(!strcasecmp(connection->request.uri, "/"))
+      strcpy(connection->request.uri, connection->settings->defaultDocument);
+
+   //No content-coding is applied unless specified otherwise
+   connection->response.contentEncoding = NULL;
+   //Dynamic content has no entity tag
+   connection->response.etag[0] = '\0';
+   //Byte ranges are only supported for static resources
+   connection->response.acceptRanges = FALSE;
+
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+   //No callback has been invoked yet for this request
+   connection->callbackState = 0;
+#endif
+
+   //Search for a request handler registered for this URI
+   route = httpFindRoute(connection->context, connection->request.uri);
+
+   //Any matching route?
+   if(route != NULL)
+   {
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+      //The callback is invoked again as long as it returns ERROR_WOULD_BLOCK
+      connection->state = HTTP_CONNECTION_STATE_CALLBACK;
+      connection->callback = route->callback;
+#endif
+      //Invoke the request handler
+      HTTP_STATS_START(connection, callback);
+      error = route->callback(connection);
+      HTTP_STATS_STOP(connection, callback);
+   }
+   else
+#if (HTTP_SERVER_SSI_SUPPORT == ENABLED)
+   //Use server-side scripting to dynamically generate HTML code?
+   if(httpCompExtension(connection->request.uri, ".stm") ||
+      httpCompExtension(connection->request.uri, ".shtm") ||
+      httpCompExtension(connection->request.uri, ".shtml"))
+   {
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+      //The script is resumed whenever the connection becomes writable
+      connection->state = HTTP_CONNECTION_STATE_SCRIPT;
+      //Start SSI processing
+      HTTP_STATS_START(connection, script);
+      error = ssiStartScript(connection);
+      HTTP_STATS_STOP(connection, script);
+#else
+      //SSI processing (Server Side Includes)
+      HTTP_STATS_START(connection, script);
+      error = ssiExecuteScript(connection, connection->request.uri, 0);
+      HTTP_STATS_STOP(connection, script);
+#endif
+   }
+   else
+#endif
+   {
+      //Send the contents of the requested page
+      error = httpSendResponse(connection);
+   }
+
+   //The requested resource is not available?
+   if(error == ERROR_NOT_FOUND && route == NULL)
+   {
+      //Invoke user-defined callback, if any
+      if(connection->settings->uriNotFoundCallback != NULL)
+      {
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+         //The callback is invoked again as long as it returns ERROR_WOULD_BLOCK
+         connection->state = HTTP_CONNECTION_STATE_CALLBACK;
+         connection->callback = connection->settings->uriNotFoundCallback;
+#endif
+         //Invoke user-defined callback
+         HTTP_STATS_START(connection, callback);
+         error = connection->settings->uriNotFoundCallback(connection);
+         HTTP_STATS_STOP(connection, callback);
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Complete the processing of a request
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] error Status code returned by the request handler
+ * @return TRUE if the connection can be kept alive, else FALSE
+ **/
+
+bool_t httpTerminateRequest(HttpConnection *connection, error_t error)
+{
+#if (HTTP_SERVER_STATS_SUPPORT == ENABLED)
+   //Update statistics
+   httpStatsCompleteRequest(connection);
+#endif
+
+   //Page not found?
+   if(error == ERROR_NOT_FOUND)
+   {
+      //Send an error 404 and keep the connection alive
+      httpSendErrorResponse(connection, 404, "The requested page could not be found");
+   }
+   //Bad request?
+   else if(error == ERROR_INVALID_REQUEST)
+   {
+      //Send an error 400
+      httpSendErrorResponse(connection, 400, "The request is badly formed");
+      //Close the connection immediately
+      return FALSE;
+   }
+   //Internal error?
+   else if(error)
+   {
+      //Close the connection immediately
+      return FALSE;
+   }
+
+   //Check whether the connection is persistent or not
+   if(!connection->request.keepAlive || !connection->response.keepAlive)
+      return FALSE;
+
+   //The connection can be kept alive
+   return TRUE;
+}
+
+
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+
+/**
+ * @brief Hand a new connection over to a worker task (event-driven mode)
+ * @param[in] context Pointer to the HTTP server context
+ * @param[in] connection Structure representing the new connection
+ * @return Error code
+ **/
+
+error_t httpAttachConnection(HttpServerContext *context, HttpConnection *connection)
+{
+   error_t error;
+   uint_t i;
+
+   //The socket is used in non-blocking mode
+   error = socketSetTimeout(connection->socket, 0);
+   //Any error to report?
+   if(error) return error;
+
+   //Wait for the Request-Line
+   connection->state = HTTP_CONNECTION_STATE_REQUEST_LINE;
+   connection->timestamp = osGetTickCount();
+   connection->requestCount = 0;
+   connection->persistent = FALSE;
+   connection->lineLength = 0;
+   connection->callbackState = 0;
+#if (HTTP_SERVER_SSI_SUPPORT == ENABLED)
+   connection->ssiDepth = 0;
+#endif
+
+   //The output buffer is empty
+   connection->rxOffset = 0;
+   connection->rxLength = 0;
+   connection->txOffset = 0;
+   connection->txLength = 0;
+   connection->txFileData = NULL;
+   connection->txFileLength = 0;
+   connection->txFileCrlf = FALSE;
+
+   //The semaphore guarantees that a free entry is available
+   for(i = 0; i < HTTP_SERVER_MAX_CONNECTIONS; i++)
+   {
+      //Free entry?
+      if(context->connections[i] == NULL)
+         break;
+   }
+
+   //Sanity check
+   if(i >= HTTP_SERVER_MAX_CONNECTIONS)
+      return ERROR_OUT_OF_RESOURCES;
+
+#if (HTTP_SERVER_STATS_SUPPORT == ENABLED)
+   //Update statistics
+   httpStatsOpenConnection(connection);
+#endif
+
+   //The connection is visible to the worker once fully initialized
+   context->connections[i] = connection;
+   //Wake up the worker task in charge of this entry
+   osEventSet(context->worker[i % HTTP_SERVER_WORKER_COUNT].event);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Worker task (event-driven mode)
+ *
+ * The worker waits for events on all the sockets it is in charge of, and
+ * resumes the connections that can make progress. No call blocks, except
+ * the infrequent operations documented in httpReceive() and httpSend()
+ *
+ * @param[in] param Pointer to the worker structure
+ **/
+
+void httpWorkerTask(void *param)
+{
+   error_t error;
+   uint_t i;
+   uint_t k;
+   uint_t n;
+   uint_t eventFlags;
+   time_t time;
+   time_t elapsed;
+   time_t timeout;
+   HttpServerContext *context;
+   HttpServerWorker *worker;
+   HttpConnection *connection;
+
+   //Point to the worker structure
+   worker = (HttpServerWorker *) param;
+   //Retrieve the HTTP server context
+   context = worker->context;
+
+   //Process events
+   while(1)
+   {
+      //Get current time
+      time = osGetTickCount();
+      //Maximum time to wait for an event
+      timeout = INFINITE_DELAY;
+
+      //Loop through the connections serviced by this worker
+      for(n = 0, i = worker->index; i < HTTP_SERVER_MAX_CONNECTIONS;
+         i += HTTP_SERVER_WORKER_COUNT)
+      {
+         //Point to the current connection
+         connection = context->connections[i];
+         //Unused entry?
+         if(connection == NULL) continue;
+
+         //Time elapsed since the last activity
+         elapsed = time - connection->timestamp;
+
+         //Inactive connection?
+         if(elapsed >= HTTP_SERVER_TIMEOUT)
+         {
+            //Debug message
+            TRACE_INFO("HTTP connection timeout...\r\n");
+            //Release the connection
+            httpCloseConnection(context, i);
+         }
+         else
+         {
+            //Do not wait beyond the expiration of the connection
+            timeout = min(timeout, HTTP_SERVER_TIMEOUT - elapsed);
+
+            //Monitor the socket
+            worker->eventDesc[n].socket = connection->socket;
+            worker->eventDesc[n].eventMask = httpGetEventMask(connection);
+            worker->eventDesc[n].eventFlags = 0;
+            n++;
+         }
+      }
+
+      //Any connection to monitor?
+      if(n > 0)
+      {
+         //Wait for socket events or for a new connection
+         error = socketPoll(worker->eventDesc, n, worker->event, timeout);
+      }
+      else
+      {
+         //Wait for a new connection
+         osEventWait(worker->event, INFINITE_DELAY);
+         error = NO_ERROR;
+      }
+
+      //Timeout error?
+      if(error == ERROR_TIMEOUT)
+         continue;
+
+      //Loop through the connections serviced by this worker
+      for(k = 0, i = worker->index; i < HTTP_SERVER_MAX_CONNECTIONS;
+         i += HTTP_SERVER_WORKER_COUNT)
+      {
+         //Point to the current connection
+         connection = context->connections[i];
+         //Unused entry?
+         if(connection == NULL) continue;
+
+         //Connection monitored by the previous call to socketPoll()?
+         if(k < n && worker->eventDesc[k].socket == connection->socket)
+         {
+            //Retrieve the events that occurred
+            eventFlags = worker->eventDesc[k++].eventFlags;
+         }
+         else
+         {
+            //Connections attached in the meantime are processed right away
+            eventFlags = SOCKET_EVENT_RX_READY;
+         }
+
+         //Any event to process?
+         if(eventFlags)
+         {
+            //Make as much progress as possible
+            error = httpResumeConnection(connection);
+
+            //The connection is complete or a fatal error occurred?
+            if(error != ERROR_WOULD_BLOCK)
+               httpCloseConnection(context, i);
+         }
+      }
+   }
+}
+
+
+/**
+ * @brief Socket events a connection is waiting for (event-driven mode)
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Logic OR of the socket events to monitor
+ **/
+
+uint_t httpGetEventMask(HttpConnection *connection)
+{
+   uint_t eventMask;
+
+   //Check connection state
+   switch(connection->state)
+   {
+   //Receiving the request header?
+   case HTTP_CONNECTION_STATE_REQUEST_LINE:
+   case HTTP_CONNECTION_STATE_REQUEST_HEADER:
+      //Wait for incoming data
+      eventMask = SOCKET_EVENT_RX_READY;
+
+      //The responses to the previous requests may not be entirely sent
+      if(connection->txOffset < connection->txLength || connection->txFileLength > 0)
+         eventMask |= SOCKET_EVENT_TX_READY;
+      break;
+   //Graceful shutdown in progress?
+   case HTTP_CONNECTION_STATE_SHUTDOWN_TX:
+      //Wait for all the data to be acknowledged
+      eventMask = SOCKET_EVENT_TX_COMPLETE;
+      break;
+   case HTTP_CONNECTION_STATE_SHUTDOWN_RX:
+      //Wait for the client to close its side of the connection
+      eventMask = SOCKET_EVENT_RX_SHUTDOWN;
+      break;
+   //Sending the response?
+   default:
+      //A write operation can only be deferred while the output buffer holds
+      //data. Otherwise, the handler is waiting for the body of the request
+      if(connection->txOffset < connection->txLength || connection->txFileLength > 0)
+         eventMask = SOCKET_EVENT_TX_READY;
+      else
+         eventMask = SOCKET_EVENT_RX_READY;
+      break;
+   }
+
+   //Return the events to monitor
+   return eventMask;
+}
+
+
+/**
+ * @brief Make as much progress as possible on a connection (event-driven mode)
+ * @param[in] connection Structure representing an HTTP connection
+ * @return ERROR_WOULD_BLOCK if the connection is waiting for an event. Any
+ *   other value means that the connection must be closed
+ **/
+
+error_t httpResumeConnection(HttpConnection *connection)
+{
+   error_t error;
+   uint_t eventFlags;
+
+   //Any event restarts the inactivity timer
+   connection->timestamp = osGetTickCount();
+
+   //Process the connection until it would block
+   while(1)
+   {
+      //Receiving the request header?
+      if(connection->state == HTTP_CONNECTION_STATE_REQUEST_LINE ||
+         connection->state == HTTP_CONNECTION_STATE_REQUEST_HEADER)
+      {
+         //Read the HTTP request header and parse its contents
+         error = httpReceiveHeader(connection);
+
+         //The header is not complete yet?
+         if(error == ERROR_WOULD_BLOCK)
+         {
+            //Send the responses to the previous requests while waiting
+            httpFlushStream(connection);
+            return error;
+         }
+
+         //Any error to report?
+         if(error)
+         {
+            //Debug message
+            TRACE_INFO("No HTTP request received or parsing error...\r\n");
+
+            //Close the connection
+            connection->persistent = FALSE;
+            connection->state = HTTP_CONNECTION_STATE_FLUSH;
+            continue;
+         }
+
+         //Debug message
+         TRACE_INFO("Sending HTTP response to the client...\r\n");
+
+         //Number of requests received on this connection
+         connection->requestCount++;
+         //Send the response
+         error = httpProcessRequest(connection);
+      }
+#if (HTTP_SERVER_SSI_SUPPORT == ENABLED)
+      //Executing an SSI script?
+      else if(connection->state == HTTP_CONNECTION_STATE_SCRIPT)
+      {
+         //Resume the execution of the script
+         HTTP_STATS_START(connection, script);
+         error = ssiResumeScript(connection);
+         HTTP_STATS_STOP(connection, script);
+      }
+#endif
+      //Executing a request handler or the URI not found callback?
+      else if(connection->state == HTTP_CONNECTION_STATE_CALLBACK)
+      {
+         //Invoke user-defined callback again
+         HTTP_STATS_START(connection, callback);
+         error = connection->callback(connection);
+         HTTP_STATS_STOP(connection, callback);
+      }
+      //Sending the rest of the response?
+      else if(connection->state == HTTP_CONNECTION_STATE_FLUSH)
+      {
+         //Check whether the connection is persistent or not
+         if(connection->persistent &&
+            connection->requestCount < HTTP_SERVER_MAX_REQUESTS)
+         {
+            //The responses to pipelined requests are coalesced. Otherwise
+            //the response must be sent before waiting for the next request
+            if(connection->rxOffset >= connection->rxLength)
+            {
+               //Send the data left in the output buffer
+               error = httpFlushStream(connection);
+               //The response has not been entirely sent?
+               if(error) return error;
+            }
+
+            //Debug message
+            TRACE_INFO("Waiting for request...\r\n");
+
+            //Wait for the next request
+            connection->state = HTTP_CONNECTION_STATE_REQUEST_LINE;
+            connection->lineLength = 0;
+         }
+         else
+         {
+            //Send the data left in the output buffer
+            error = httpFlushStream(connection);
+            //The response has not been entirely sent?
+            if(error) return error;
+
+            //Debug message
+            TRACE_INFO("Graceful shutdown...\r\n");
+
+            //Wait for the data to be acknowledged before sending a FIN
+            connection->state = HTTP_CONNECTION_STATE_SHUTDOWN_TX;
+         }
+
+         //Continue processing
+         continue;
+      }
+      //Graceful shutdown in progress?
+      else
+      {
+         //The FIN must not be sent before the data is acknowledged
+         if(connection->state == HTTP_CONNECTION_STATE_SHUTDOWN_TX)
+         {
+            //Retrieve the current state of the socket
+            socketGetEvents(connection->socket, &eventFlags);
+
+            //Some data is still outstanding?
+            if(!(eventFlags & SOCKET_EVENT_TX_COMPLETE))
+               return ERROR_WOULD_BLOCK;
+         }
+
+         //Disable transmission and reception
+         error = socketShutdown(connection->socket, SOCKET_SD_BOTH);
+
+         //The client has not closed its side of the connection yet?
+         if(error == ERROR_TIMEOUT)
+         {
+            //The FIN has been sent at this point
+            connection->state = HTTP_CONNECTION_STATE_SHUTDOWN_RX;
+            //Wait for the FIN of the client
+            return ERROR_WOULD_BLOCK;
+         }
+
+         //The connection can be closed
+         return error;
+      }
+
+      //The response cannot be completed for the time being?
+      if(error == ERROR_WOULD_BLOCK)
+      {
+         //Send the output produced so far while waiting
+         httpFlushStream(connection);
+         return error;
+      }
+
+      //Check whether the connection can be kept alive
+      connection->persistent = httpTerminateRequest(connection, error);
+      //Send the rest of the response
+      connection->state = HTTP_CONNECTION_STATE_FLUSH;
+   }
+}
+
+
+/**
+ * @brief Release a connection (event-driven mode)
+ * @param[in] context Pointer to the HTTP server context
+ * @param[in] index Index of the connection in the connection table
+ **/
+
+void httpCloseConnection(HttpServerContext *context, uint_t index)
+{
+   HttpConnection *connection;
+
+   //Point to the connection
+   connection = context->connections[index];
+
+   //Debug message
+   TRACE_INFO("Close socket...\r\n");
+   //Close socket
+   socketClose(connection->socket);
+
+#if (HTTP_SERVER_SSI_SUPPORT == ENABLED)
+   //Release the scripts being executed, if any
+   ssiAbortScript(connection);
+#endif
+
+#if (HTTP_SERVER_STATS_SUPPORT == ENABLED)
+   //Update statistics
+   httpStatsCloseConnection(connection);
+#endif
+
+   //Free the entry
+   context->connections[index] = NULL;
+   //Release semaphore
+   osSemaphoreRelease(connection->semaphore);
+   //Release connection context
+   osMemFree(connection);
+}
+
+#endif
+
+
+/**
+ * @brief Read HTTP request header and parse its contents
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t httpReadHeader(HttpConnection *connection)
+{
+   error_t error;
+   size_t length;
+
+   //Read the first line of the request
+   error = httpReceive(connection, connection->buffer,
+      HTTP_SERVER_BUFFER_SIZE - 1, &length, SOCKET_FLAG_BREAK_CRLF);
+   //Unable to read any data?
+   if(error) return error;
+
+   //Properly terminate the string with a NULL character
+   connection->buffer[length] = '\0';
+
+   //Parse the Request-Line
+   error = httpParseRequestLine(connection, connection->buffer);
+   //Any error to report?
+   if(error) return error;
+
+   //HTTP 0.9 does not support Full-Request
+   if(connection->request.version >= HTTP_VERSION_1_0)
+   {
+      //Parse header request fields
+      while(1)
+      {
+         //Read a complete line
+         error = httpReceive(connection, connection->buffer,
+            HTTP_SERVER_BUFFER_SIZE - 1, &length, SOCKET_FLAG_BREAK_CRLF);
+
+         //Any error to report?
+         if(error)
+            return error;
+         //Unable to read any data?
+         if(!length)
+            return ERROR_INVALID_REQUEST;
+
+         //Properly terminate the string with a NULL character
+         connection->buffer[length] = '\0';
+
+         //The end of the header has been reached?
+         if(!strcmp(connection->buffer, "\r\n"))
+            break;
+
+         //Parse the current header field
+         httpParseHeaderField(connection, connection->buffer);
+      }
+   }
+
+   //Prepare to read the HTTP request body
+   httpInitRequestBody(connection);
+
+   //The request header has been successfully parsed
+   return NO_ERROR;
+}
+
+
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+
+/**
+ * @brief Receive HTTP request header without blocking (event-driven mode)
+ *
+ * The header is parsed one line at a time, as soon as each line is complete.
+ * A partial line is kept in the connection buffer until more data arrives
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return ERROR_WOULD_BLOCK if the header is not complete yet, else error code
+ **/
+
+error_t httpReceiveHeader(HttpConnection *connection)
+{
+   error_t error;
+   size_t n;
+
+   //Process the lines as they become available
+   while(1)
+   {
+      //Read as much of the current line as possible
+      error = httpReceiveData(connection, connection->buffer + connection->lineLength,
+         HTTP_SERVER_BUFFER_SIZE - 1 - connection->lineLength, &n, SOCKET_FLAG_BREAK_CRLF);
+
+      //Some data may have been read before the receive buffer ran empty
+      connection->lineLength += n;
+
+      //The line is not complete yet?
+      if(error == ERROR_TIMEOUT)
+         return ERROR_WOULD_BLOCK;
+      //Any other error to report?
+      if(error)
+         return error;
+
+      //Lines that do not fit in the buffer are rejected
+      if(!connection->lineLength || connection->buffer[connection->lineLength - 1] != '\n')
+         return ERROR_INVALID_REQUEST;
+
+      //Properly terminate the string with a NULL character
+      connection->buffer[connection->lineLength] = '\0';
+      //Prepare to receive the next line
+      connection->lineLength = 0;
+
+      //First line of the request?
+      if(connection->state == HTTP_CONNECTION_STATE_REQUEST_LINE)
+      {
+         //Parse the Request-Line
+         error = httpParseRequestLine(connection, connection->buffer);
+         //Any error to report?
+         if(error) return error;
+
+         //HTTP 0.9 does not support Full-Request
+         if(connection->request.version < HTTP_VERSION_1_0)
+            break;
+
+         //The header fields follow the Request-Line
+         connection->state = HTTP_CONNECTION_STATE_REQUEST_HEADER;
+      }
+      else
+      {
+         //The end of the header has been reached?
+         if(!strcmp(connection->buffer, "\r\n"))
+            break;
+
+         //Parse the current header field
+         httpParseHeaderField(connection, connection->buffer);
+      }
+   }
+
+   //Prepare to read the HTTP request body
+   httpInitRequestBody(connection);
+
+   //The request header has been successfully parsed
+   return NO_ERROR;
+}
+
+#endif
+
+
+/**
+ * @brief Parse the Request-Line
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] line NULL-terminated string containing the Request-Line
+ * @return Error code
+ **/
+
+error_t httpParseRequestLine(HttpConnection *connection, char_t *line)
+{
+   char_t *token;
+   char_t *p;
+   char_t *s;
+
+   //Debug message
+   TRACE_INFO("%s\r\n", line);
+
+#if (HTTP_SERVER_STATS_SUPPORT == ENABLED)
+   //The response time is measured from the reception of the Request-Line
+   httpStatsStartRequest(connection);
+#endif
+
+   //The Request-Line begins with a method token
+   token = strtok_r(line, " \r\n", &p);
+   //Unable to retrieve the method?
+   if(!token) return ERROR_INVALID_REQUEST;
+
+   //GET method?
+   if(!strcasecmp(token, "GET"))
+      connection->request.method = HTTP_METHOD_GET;
+   //HEAD method?
+   else if(!strcasecmp(token, "HEAD"))
+      connection->request.method = HTTP_METHOD_HEAD;
+   //POST method?
+   else if(!strcasecmp(token, "POST"))
+      connection->request.method = HTTP_METHOD_POST;
+   //Unsupported method?
+   else
+      return ERROR_INVALID_REQUEST;
+
+   //The Request-URI is following the method token
+   token = strtok_r(NULL, " \r\n", &p);
+   //Unable to retrieve the Request-URI?
+   if(!token)
+      return ERROR_INVALID_REQUEST;
+
+   //Check whether a query string is present
+   s = strchr(token, '?');
+   //Query string found?
+   if(s != NULL)
+   {
+      //Calculate the length of the Request-URI
+      uint_t n = s - token;
+
+      //Check the length of the field
+      if(n > HTTP_SERVER_URI_MAX_LEN)
+         return ERROR_INVALID_REQUEST;
+
+      //Save the Request-URI
+      strncpy(connection->request.uri, token, n);
+      //Properly terminate the string
+      connection->request.uri[n] = '\0';
+
+      //Check the length of the query string
+      if(strlen(s + 1) > HTTP_SERVER_QUERY_STRING_MAX_LEN)
+         return ERROR_INVALID_REQUEST;
+
+      //Save the query string
+      strcpy(connection->request.queryString, s + 1);
+   }
+   else
+   {
+      //Check the length of the field
+      if(strlen(token) > HTTP_SERVER_URI_MAX_LEN)
+         return ERROR_INVALID_REQUEST;
+
+      //Save the Request-URI
+      strcpy(connection->request.uri, token);
+      //No query string
+      connection->request.queryString[0] = '\0';
+   }
+
+   //The protocol version is following the Request-URI
+   token = strtok_r(NULL, " \r\n", &p);
+
+   //HTTP version 0.9?
+   if(!token)
+   {
+      //Save version number
+      connection->request.version = HTTP_VERSION_0_9;
+      //Persistent connections are not supported
+      connection->request.keepAlive = FALSE;
+   }
+   //HTTP version 1.0?
+   else if(!strcasecmp(token, "HTTP/1.0"))
+   {
+      //Save version number
+      connection->request.version = HTTP_VERSION_1_0;
+      //By default connections are not persistent
+      connection->request.keepAlive = FALSE;
+   }
+   //HTTP version 1.1?
+   else if(!strcasecmp(token, "HTTP/1.1"))
+   {
+      //Save version number
+      connection->request.version = HTTP_VERSION_1_1;
+      //HTTP 1.1 makes persistent connections the default
+      connection->request.keepAlive = TRUE;
+   }
+   //HTTP version not supported?
+   else
+   {
+      return ERROR_INVALID_REQUEST;
+   }
+
+   //Default value for properties
+   connection->request.chunkedEncoding = FALSE;
+   connection->request.acceptGzipEncoding = FALSE;
+   connection->request.ifNoneMatch[0] = '\0';
+   connection->request.ifRange[0] = '\0';
+   connection->request.byteRange = FALSE;
+   connection->request.contentLength = 0;
+#if (HTTP_SERVER_WEB_SOCKET_SUPPORT == ENABLED)
+   connection->request.upgradeWebSocket = FALSE;
+   connection->request.webSocketKey[0] = '\0';
+   connection->request.webSocketVersion = 0;
+#endif
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Parse a header field of the request
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] line NULL-terminated string containing the header field
+ **/
+
+void httpParseHeaderField(HttpConnection *connection, char_t *line)
+{
+   char_t *separator;
+   char_t *property;
+   char_t *value;
+
+   //Check whether a separator is present
+   separator = strchr(line, ':');
+   //Separator not found?
+   if(!separator)
+      return;
+
+   //Split the line
+   *separator = '\0';
+
+   //Get property name and value
+   property = strTrimWhitespace(line);
+   value = strTrimWhitespace(separator + 1);
+
+   //Connection property found?
+   if(!strcasecmp(property, "Connection"))
+   {
+      //Check whether persistent connections are supported or not
+      if(!strcasecmp(value, "keep-alive"))
+         connection->request.keepAlive = TRUE;
+      else if(!strcasecmp(value, "close"))
+         connection->request.keepAlive = FALSE;
+   }
+#if (HTTP_SERVER_WEB_SOCKET_SUPPORT == ENABLED)
+   //Upgrade property found?
+   else if(!strcasecmp(property, "Upgrade"))
+   {
+      //The upgrade is only honored when the application handles WebSockets
+      if(!strcasecmp(value, "websocket") && connection->settings->webSocketCallback != NULL)
+         connection->request.upgradeWebSocket = TRUE;
+   }
+   //Sec-WebSocket-Key property found?
+   else if(!strcasecmp(property, "Sec-WebSocket-Key"))
+   {
+      //Save the nonce sent by the client
+      if(strlen(value) < sizeof(connection->request.webSocketKey))
+         strcpy(connection->request.webSocketKey, value);
+   }
+   //Sec-WebSocket-Version property found?
+   else if(!strcasecmp(property, "Sec-WebSocket-Version"))
+   {
+      //Get the version of the protocol
+      connection->request.webSocketVersion = atoi(value);
+   }
+#endif
+   //Transfer-Encoding property found?
+   else if(!strcasecmp(property, "Transfer-Encoding"))
+   {
+      //Check whether chunked encoding is used
+      if(!strcasecmp(value, "chunked"))
+         connection->request.chunkedEncoding = TRUE;
+   }
+   //Content-Length property found?
+   else if(!strcasecmp(property, "Content-Length"))
+   {
+      //Get the length of the body data
+      connection->request.contentLength = atoi(value);
+   }
+   //Accept-Encoding property found?
+   else if(!strcasecmp(property, "Accept-Encoding"))
+   {
+      //Check whether gzip-compressed content is acceptable
+      httpParseAcceptEncoding(connection, value);
+   }
+   //If-None-Match property found?
+   else if(!strcasecmp(property, "If-None-Match"))
+   {
+      //Save the list of entity tags (lists that are too long are ignored,
+      //which simply disables the conditional request)
+      if(strlen(value) <= HTTP_SERVER_IF_NONE_MATCH_MAX_LEN)
+         strcpy(connection->request.ifNoneMatch, value);
+   }
+   //Range property found?
+   else if(!strcasecmp(property, "Range"))
+   {
+      //Parse the byte range
+      httpParseRange(connection, value);
+   }
+   //If-Range property found?
+   else if(!strcasecmp(property, "If-Range"))
+   {
+      //Save the validator. Dates and tags that are too long cannot match
+      //any entity tag generated by the server
+      if(strlen(value) < sizeof(connection->request.ifRange))
+         strcpy(connection->request.ifRange, value);
+      else
+         strcpy(connection->request.ifRange, "-");
+   }
+}
+
+
+/**
+ * @brief Parse Accept-Encoding field
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] value NULL-terminated string containing the field value
+ **/
+
+void httpParseAcceptEncoding(HttpConnection *connection, char_t *value)
+{
+   char_t *token;
+   char_t *param;
+   char_t *p;
+
+   //The field value is a comma-separated list of content-codings
+   token = strtok_r(value, ",", &p);
+
+   //Parse the list
+   while(token != NULL)
+   {
+      //Each content-coding may be followed by a quality value
+      param = strchr(token, ';');
+
+      //Quality value found?
+      if(param != NULL)
+      {
+         //Split the token
+         *param = '\0';
+         param = strTrimWhitespace(param + 1);
+      }
+
+      //Remove leading and trailing whitespace
+      token = strTrimWhitespace(token);
+
+      //gzip content-coding?
+      if(!strcasecmp(token, "gzip") || !strcasecmp(token, "x-gzip") || !strcmp(token, "*"))
+      {
+         //A quality value of 0 means "not acceptable"
+         if(param != NULL && !strncasecmp(param, "q=", 2) &&
+            strspn(param + 2, "0.") == strlen(param + 2))
+         {
+            connection->request.acceptGzipEncoding = FALSE;
+         }
+         else
+         {
+            connection->request.acceptGzipEncoding = TRUE;
+         }
+
+         //An explicit gzip token takes precedence over the wildcard
+         if(strcmp(token, "*"))
+            break;
+      }
+
+      //Get next token
+      token = strtok_r(NULL, ",", &p);
+   }
+}
+
+
+/**
+ * @brief Parse Range field
+ *
+ * Only single byte ranges are supported. The whole resource is sent
+ * when several ranges are requested
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] value NULL-terminated string containing the field value
+ **/
+
+void httpParseRange(HttpConnection *connection, char_t *value)
+{
+   char_t *first;
+   char_t *last;
+   char_t *separator;
+
+   //Byte ranges are the only range unit defined by HTTP/1.1
+   if(strncasecmp(value, "bytes=", 6))
+      return;
+
+   //Multiple ranges are not supported
+   if(strchr(value, ','))
+      return;
+
+   //Check whether a separator is present
+   separator = strchr(value + 6, '-');
+   //Separator not found?
+   if(!separator)
+      return;
+
+   //Split the byte range
+   *separator = '\0';
+
+   //Get the first and last byte positions
+   first = strTrimWhitespace(value + 6);
+   last = strTrimWhitespace(separator + 1);
+
+   //Byte positions are made of decimal digits only
+   if(strspn(first, "0123456789") != strlen(first))
+      return;
+   if(strspn(last, "0123456789") != strlen(last))
+      return;
+
+   //Suffix byte range (last N bytes of the resource)?
+   if(first[0] == '\0')
+   {
+      //The suffix length is mandatory
+      if(last[0] == '\0')
+         return;
+
+      //Save the suffix length
+      connection->request.rangeSuffix = TRUE;
+      connection->request.rangeFirst = 0;
+      connection->request.rangeLast = strtoul(last, NULL, 10);
+   }
+   else
+   {
+      //Save the first byte position
+      connection->request.rangeSuffix = FALSE;
+      connection->request.rangeFirst = strtoul(first, NULL, 10);
+
+      //The last byte position may be omitted
+      if(last[0] != '\0')
+         connection->request.rangeLast = strtoul(last, NULL, 10);
+      else
+         connection->request.rangeLast = UINT_MAX;
+
+      //Syntactically invalid byte ranges are ignored
+      if(connection->request.rangeLast < connection->request.rangeFirst)
+         return;
+   }
+
+   //A valid byte range has been requested
+   connection->request.byteRange = TRUE;
+}
+
+
+/**
+ * @brief Prepare to read the body of the request
+ * @param[in] connection Structure representing an HTTP connection
+ **/
+
+void httpInitRequestBody(HttpConnection *connection)
+{
+#if (HTTP_SERVER_STATS_SUPPORT == ENABLED)
+   //The request header is complete
+   connection->metrics.headerTime = osGetTickCount() - connection->metrics.startTime;
+#endif
+
+   //Chunked encoding transfer is used?
+   if(connection->request.chunkedEncoding)
+   {
+      connection->request.byteCount = 0;
+      connection->request.firstChunk = TRUE;
+      connection->request.lastChunk = FALSE;
+   }
+   else
+   {
+      connection->request.byteCount = connection->request.contentLength;
+   }
+}
+
+
+/**
+ * @brief Send HTTP response header
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t httpWriteHeader(HttpConnection *connection)
+{
+   error_t error;
+   uint_t i;
+   char_t *p;
+
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+   //HTTP/2 connection?
+   if(connection->http2 != NULL)
+   {
+      //The header fields are compressed into a HEADERS frame
+      return http2WriteHeader(connection);
+   }
+#endif
+
+   //HTTP version 0.9?
+   if(connection->response.version == HTTP_VERSION_0_9)
+   {
+      //Enforce default parameters
+      connection->response.keepAlive = FALSE;
+      connection->response.chunkedEncoding = FALSE;
+      //The size of the response body is not limited
+      connection->response.byteCount = UINT_MAX;
+      //We are done since HTTP 0.9 does not support Full-Response format
+      return NO_ERROR;
+   }
+
+   //When generating dynamic web pages with HTTP 1.0, the only way to
+   //signal the end of the body is to close the connection
+   if(connection->response.version == HTTP_VERSION_1_0 &&
+      connection->response.chunkedEncoding)
+   {
+      //Make the connection non persistent
+      connection->response.keepAlive = FALSE;
+      connection->response.chunkedEncoding = FALSE;
+      //The size of the response body is not limited
+      connection->response.byteCount = UINT_MAX;
+   }
+   else
+   {
+      //Limit the size of the response body
+      connection->response.byteCount = connection->response.contentLength;
+   }
+
+   //Point to the beginning of the buffer
+   p = connection->buffer;
+
+   //The first line of a response message is the Status-Line, consisting
+   //of the protocol version followed by a numeric status code and its
+   //associated textual phrase
+   p += sprintf(p, "HTTP/%u.%u %u ", MSB(connection->response.version),
+      LSB(connection->response.version), connection->response.statusCode);
+
+   //Retrieve the Reason-Phrase that corresponds to the Status-Code
+   for(i = 0; i < arraysize(statusCodeList); i++)
+   {
+      //Check the status code
+      if(statusCodeList[i].value == connection->response.statusCode)
+      {
+         //Append the textual phrase to the Status-Line
+         p += sprintf(p, statusCodeList[i].message);
+         //Break the loop and continue processing
+         break;
+      }
+   }
+
+   //Properly terminate the Status-Line
+   p += sprintf(p, "\r\n");
+   //The Server response-header field contains information about the
+   //software used by the origin server to handle the request
+   p += sprintf(p, "Server: Oryx Embedded HTTP Server\r\n");
+
+   //Persistent connection?
+   if(connection->response.keepAlive)
+   {
+      //Set Connection property
+      p += sprintf(p, "Connection: keep-alive\r\n");
+
+      //Set Keep-Alive property
+      p += sprintf(p, "Keep-Alive: timeout=%u, max=%u\r\n",
+         HTTP_SERVER_TIMEOUT / 1000, HTTP_SERVER_MAX_REQUESTS);
+   }
+   else
+   {
+      //Set Connection property
+      p += sprintf(p, "Connection: close\r\n");
+   }
+
+   //Prevent the client from using cache?
+   if(connection->response.noCache)
+   {
+      //Set Pragma property
+      p += sprintf(p, "Pragma: no-cache\r\n");
+      //Set Cache-Control property
+      p += sprintf(p, "Cache-Control: no-store, no-cache, must-revalidate\r\n");
+      p += sprintf(p, "Cache-Control: post-check=0, pre-check=0\r\n");
+   }
+
+   //Static resource?
+   if(connection->response.etag[0] != '\0')
+   {
+      //Set ETag field
+      p += sprintf(p, "ETag: %s\r\n", connection->response.etag);
+      //Set Cache-Control field
+      p += sprintf(p, "Cache-Control: max-age=%u\r\n", HTTP_SERVER_MAX_AGE);
+   }
+
+   //Byte ranges are supported for this resource?
+   if(connection->response.acceptRanges)
+   {
+      //Set Accept-Ranges field
+      p += sprintf(p, "Accept-Ranges: bytes\r\n");
+   }
+
+   //Partial content?
+   if(connection->response.statusCode == 206)
+   {
+      //Set Content-Range field
+      p += sprintf(p, "Content-Range: bytes %u-%u/%u\r\n", connection->response.rangeFirst,
+         connection->response.rangeLast, connection->response.resourceLength);
+   }
+   //Unsatisfiable byte range?
+   else if(connection->response.statusCode == 416)
+   {
+      //Set Content-Range field
+      p += sprintf(p, "Content-Range: bytes */%u\r\n", connection->response.resourceLength);
+   }
+
+   //Content type
+   p += sprintf(p, "Content-Type: %s\r\n", connection->response.contentType);
+
+   //Compressed content?
+   if(connection->response.contentEncoding != NULL)
+   {
+      //Set Content-Encoding field
+      p += sprintf(p, "Content-Encoding: %s\r\n", connection->response.contentEncoding);
+      //The representation depends on the Accept-Encoding field of the request
+      p += sprintf(p, "Vary: Accept-Encoding\r\n");
+   }
+
+   //Use chunked encoding transfer?
+   if(connection->response.chunkedEncoding)
+   {
+      //Set Transfer-Encoding field
+      p += sprintf(p, "Transfer-Encoding: chunked\r\n");
+   }
+   //Persistent connection? (a 304 response never contains a body)
+   else if(connection->response.keepAlive && connection->response.statusCode != 304)
+   {
+      //Set Content-Length field
+      p += sprintf(p, "Content-Length: %u\r\n", connection->response.contentLength);
+   }
+
+   //Terminate the header with an empty line
+   p += sprintf(p, "\r\n");
+
+   //Debug message
+   TRACE_DEBUG("HTTP response header:\r\n%s", connection->buffer);
+
+   //Send HTTP response header to the client
+   error = httpSend(connection, connection->buffer,
+      strlen(connection->buffer), 0);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Read data from client request
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[out] data Buffer where to store the incoming data
+ * @param[in] size Maximum number of bytes that can be received
+ * @param[out] received Number of bytes that have been received
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t httpReadStream(HttpConnection *connection, void *data, size_t size, size_t *received, uint_t flags)
+{
+   error_t error;
+   uint_t n;
+
+   //No data has been read yet
+   *received = 0;
+
+   //Chunked encoding transfer is used?
+   if(connection->request.chunkedEncoding)
+   {
+      //Point to the output buffer
+      char_t *p = data;
+
+      //Read as much data as possible
+      while(*received < size)
+      {
+         //End of HTTP request body?
+         if(connection->request.lastChunk)
+            return ERROR_END_OF_STREAM;
+
+         //Acquire a new chunk when the current chunk
+         //has been completely consumed
+         if(connection->request.byteCount == 0)
+         {
+            //The size of each chunk is sent right before the chunk itself
+            error = httpReadChunkSize(connection);
+            //Failed to decode the chunk-size field?
+            if(error) return error;
+
+            //Any chunk whose size is zero terminates the data transfer
+            if(!connection->request.byteCount)
+            {
+               //The user must be satisfied with data already on hand
+               return (*received > 0) ? NO_ERROR : ERROR_END_OF_STREAM;
+            }
+         }
+
+         //Limit the number of bytes to read at a time
+         n = min(size - *received, connection->request.byteCount);
+
+         //Read data
+         error = httpReceive(connection, p, n, &n, flags);
+         //No more data available for the time being?
+         if(error == ERROR_WOULD_BLOCK && *received > 0)
+            break;
+         //Any error to report?
+         if(error) return error;
+
+         //Total number of data that have been read
+         *received += n;
+         //Remaining data still available in the current chunk
+         connection->request.byteCount -= n;
+
+         //The HTTP_FLAG_BREAK_CHAR flag causes the function to stop reading
+         //data as soon as the specified break character is encountered
+         if(flags & HTTP_FLAG_BREAK_CRLF)
+         {
+            //Check whether a break character has been received
+            if(p[n - 1] == LSB(flags)) break;
+         }
+         //The HTTP_FLAG_WAIT_ALL flag causes the function to return
+         //only when the requested number of bytes have been read
+         else if(!(flags & HTTP_FLAG_WAIT_ALL))
+         {
+            break;
+         }
+
+         //Advance data pointer
+         p += n;
+      }
+   }
+   //Default encoding?
+   else
+   {
+      //Return immediately if the end of the request body has been reached
+      if(!connection->request.byteCount)
+         return ERROR_END_OF_STREAM;
+
+      //Limit the number of bytes to read
+      n = min(size, connection->request.byteCount);
+
+      //Read data
+      error = httpReceive(connection, data, n, received, flags);
+      //Any error to report
+      if(error) return error;
+
+      //Decrement the count of remaining bytes to read
+      connection->request.byteCount -= *received;
+   }
+
+   //Successful read operation
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Read chunk-size field from the input stream
+ * @param[in] connection Structure representing an HTTP connection
+ **/
+
+error_t httpReadChunkSize(HttpConnection *connection)
+{
+   error_t error;
+   uint_t n;
+   char_t *end;
+   char_t s[8];
+
+   //First chunk to be received?
+   if(connection->request.firstChunk)
+   {
+      //Clear the flag
+      connection->request.firstChunk = FALSE;
+   }
+   else
+   {
+      //Read the CRLF that follows the previous chunk-data field
+      error = httpReceive(connection,
+         s, sizeof(s) - 1, &n, SOCKET_FLAG_BREAK_CRLF);
+      //Any error to report?
+      if(error) return error;
+
+      //Properly terminate the string with a NULL character
+      s[n] = '\0';
+
+      //The chunk data must be terminated by CRLF
+      if(strcmp(s, "\r\n"))
+         return ERROR_WRONG_ENCODING;
+   }
+
+   //Read the chunk-size field
+   error = httpReceive(connection,
+      s, sizeof(s) - 1, &n, SOCKET_FLAG_BREAK_CRLF);
+   //Any error to report?
+   if(error) return error;
+
+   //Properly terminate the string with a NULL character
+   s[n] = '\0';
+   //Remove extra whitespaces
+   strRemoveTrailingSpace(s);
+
+   //Retrieve the size of the chunk
+   connection->request.byteCount = strtoul(s, &end, 16);
+
+   //No valid conversion could be performed?
+   if(end == s || *end != '\0')
+      return ERROR_WRONG_ENCODING;
+
+   //Any chunk whose size is zero terminates the data transfer
+   if(!connection->request.byteCount)
+   {
+      //The end of the HTTP request body has been reached
+      connection->request.lastChunk = TRUE;
+
+      //Skip the trailer
+      while(1)
+      {
+         //Read a complete line
+         error = httpReceive(connection,
+            s, sizeof(s) - 1, &n, SOCKET_FLAG_BREAK_CRLF);
+         //Unable to read any data?
+         if(error) return error;
+
+         //Properly terminate the string with a NULL character
+         s[n] = '\0';
+
+         //The trailer is terminated by an empty line
+         if(!strcmp(s, "\r\n"))
+            break;
+      }
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Write data to the client
+ *
+ * In event-driven mode, the data is either accepted as a whole or not at all.
+ * ERROR_WOULD_BLOCK is returned when the output buffer cannot hold the data
+ * yet, in which case the caller is expected to return the same error code
+ * so as to be invoked again when the connection becomes writable
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] data Buffer containing the data to be transmitted
+ * @param[in] length Number of bytes to be transmitted
+ * @return Error code
+ **/
+
+error_t httpWriteStream(HttpConnection *connection, const void *data, size_t length)
+{
+   //Send data
+   return httpWriteData(connection, data, length, 0);
+}
+
+
+/**
+ * @brief Write immutable resource data to the client
+ *
+ * The data is referenced by the send buffer rather than copied, so it must
+ * remain valid until it has been acknowledged (resource blobs for instance)
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] data Buffer containing the data to be transmitted
+ * @param[in] length Number of bytes to be transmitted
+ * @return Error code
+ **/
+
+error_t httpWriteResource(HttpConnection *connection, const void *data, size_t length)
+{
+   //Send data without copying it
+   return httpWriteData(connection, data, length, SOCKET_FLAG_NO_COPY);
+}
+
+
+/**
+ * @brief Write data to the client using the appropriate transfer encoding
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] data Buffer containing the data to be transmitted
+ * @param[in] length Number of bytes to be transmitted
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t httpWriteData(HttpConnection *connection, const void *data, size_t length, uint_t flags)
+{
+   error_t error;
+   uint_t n;
+
+   //Use chunked encoding transfer?
+   if(connection->response.chunkedEncoding)
+   {
+      //Any data to send?
+      if(length > 0)
+      {
+         char_t s[8];
+
+         //The chunk-size field is a string of hex digits
+         //indicating the size of the chunk
+         n = sprintf(s, "%X\r\n", length);
+
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+         //Small immutable chunks are copied to the output buffer so that
+         //they are coalesced with the surrounding data
+         if((flags & SOCKET_FLAG_NO_COPY) && !connection->txFileLength &&
+            (connection->txLength - connection->txOffset + n + length + 2) <= HTTP_SERVER_TX_BUFFER_SIZE)
+         {
+            flags &= ~SOCKET_FLAG_NO_COPY;
+         }
+
+         //The chunk must be queued as a whole
+         if(flags & SOCKET_FLAG_NO_COPY)
+            error = httpReserveStream(connection, n);
+         else
+            error = httpReserveStream(connection, n + length + 2);
+
+         //The output buffer is full?
+         if(error) return error;
+#endif
+
+         //Send the chunk-size field
+         error = httpSend(connection, s, n, 0);
+         //Failed to send data?
+         if(error) return error;
+
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+         //Immutable data?
+         if(flags & SOCKET_FLAG_NO_COPY)
+         {
+            //The CRLF is sent once the data has been entirely sent
+            connection->txFileCrlf = TRUE;
+            //Send the chunk-data
+            error = httpSend(connection, data, length, flags);
+         }
+         else
+#endif
+         {
+            //Send the chunk-data
+            error = httpSend(connection, data, length, flags);
+            //Failed to send data?
+            if(error) return error;
+
+            //Terminate the chunk-data by CRLF
+            error = httpSend(connection, "\r\n", 2, 0);
          }
       }
+      else
+      {
+         //Any chunk whose size is zero may terminate the data
+         //transfer and must be discarded
+         error = NO_ERROR;
+      }
    }
-
-   //Prepare to read the HTTP request body
-   if(connection->request.chunkedEncoding)
-   {
-      connection->request.byteCount = 0;
-      connection->request.firstChunk = TRUE;
-      connection->request.lastChunk = FALSE;
-   }
+   //Default encoding?
    else
    {
-      connection->request.byteCount = connection->request.contentLength;
+      //The length of the body shall not exceed the value
+      //specified in the Content-Length field
+      length = min(length, connection->response.byteCount);
+
+      //Send user data
+      error = httpSend(connection, data, length, flags);
+
+      //Decrement the count of remaining bytes to transfer
+      if(!error)
+         connection->response.byteCount -= length;
    }
 
-   //The request header has been successfully parsed
-   return NO_ERROR;
+   //Return status code
+   return error;
 }
 
 
 /**
- * @brief Send HTTP response header
+ * @brief Close output stream
  * @param[in] connection Structure representing an HTTP connection
  * @return Error code
  **/
 
-error_t httpWriteHeader(HttpConnection *connection)
+error_t httpCloseStream(HttpConnection *connection)
 {
    error_t error;
-   uint_t i;
-   char_t *p;
-
-   //HTTP version 0.9?
-   if(connection->response.version == HTTP_VERSION_0_9)
-   {
-      //Enforce default parameters
-      connection->response.keepAlive = FALSE;
-      connection->response.chunkedEncoding = FALSE;
-      //The size of the response body is not limited
-      connection->response.byteCount = UINT_MAX;
-      //We are done since HTTP 0.9 does not support Full-Response format
-      return NO_ERROR;
-   }
 
-   //When generating dynamic web pages with HTTP 1.0, the only way to
-   //signal the end of the body is to close the connection
-   if(connection->response.version == HTTP_VERSION_1_0 &&
-      connection->response.chunkedEncoding)
+   //Use chunked encoding transfer?
+   if(connection->response.chunkedEncoding)
    {
-      //Make the connection non persistent
-      connection->response.keepAlive = FALSE;
-      connection->response.chunkedEncoding = FALSE;
-      //The size of the response body is not limited
-      connection->response.byteCount = UINT_MAX;
+      //The chunked encoding is ended by any chunk whose size is zero
+      error = httpSend(connection, "0\r\n\r\n", 5, 0);
    }
    else
    {
-      //Limit the size of the response body
-      connection->response.byteCount = connection->response.contentLength;
+      //Chunked encoding is not used...
+      error = NO_ERROR;
    }
 
-   //Point to the beginning of the buffer
-   p = connection->buffer;
+   //Return status code
+   return error;
+}
 
-   //The first line of a response message is the Status-Line, consisting
-   //of the protocol version followed by a numeric status code and its
-   //associated textual phrase
-   p += sprintf(p, "HTTP/%u.%u %u ", MSB(connection->response.version),
-      LSB(connection->response.version), connection->response.statusCode);
 
-   //Retrieve the Reason-Phrase that corresponds to the Status-Code
-   for(i = 0; i < arraysize(statusCodeList); i++)
-   {
-      //Check the status code
-      if(statusCodeList[i].value == connection->response.statusCode)
-      {
-         //Append the textual phrase to the Status-Line
-         p += sprintf(p, statusCodeList[i].message);
-         //Break the loop and continue processing
-         break;
-      }
-   }
+/**
+ * @brief Receive data from the client
+ *
+ * In event-driven mode, plain reads return ERROR_WOULD_BLOCK when no data
+ * is available. Reads that would have to be resumed in the middle of a line
+ * or of a fixed-size block (HTTP_FLAG_BREAK_CHAR or HTTP_FLAG_WAIT_ALL) are
+ * short and block for at most HTTP_SERVER_TIMEOUT instead
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[out] data Buffer where to store the incoming data
+ * @param[in] size Maximum number of bytes that can be received
+ * @param[out] received Number of bytes that have been received
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
 
-   //Properly terminate the Status-Line
-   p += sprintf(p, "\r\n");
-   //The Server response-header field contains information about the
-   //software used by the origin server to handle the request
-   p += sprintf(p, "Server: Oryx Embedded HTTP Server\r\n");
+error_t httpReceive(HttpConnection *connection, void *data, size_t size, size_t *received, uint_t flags)
+{
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+   error_t error;
 
-   //Persistent connection?
-   if(connection->response.keepAlive)
+   //The caller cannot resume this kind of read operation?
+   if(flags & (SOCKET_FLAG_BREAK_CHAR | SOCKET_FLAG_WAIT_ALL))
    {
-      //Set Connection property
-      p += sprintf(p, "Connection: keep-alive\r\n");
-
-      //Set Keep-Alive property
-      p += sprintf(p, "Keep-Alive: timeout=%u, max=%u\r\n",
-         HTTP_SERVER_TIMEOUT / 1000, HTTP_SERVER_MAX_REQUESTS);
+      //Temporarily switch to blocking mode
+      socketSetTimeout(connection->socket, HTTP_SERVER_TIMEOUT);
+      //Read data
+      error = httpReceiveData(connection, data, size, received, flags);
+      //Switch back to non-blocking mode
+      socketSetTimeout(connection->socket, 0);
    }
    else
    {
-      //Set Connection property
-      p += sprintf(p, "Connection: close\r\n");
-   }
-
-   //Prevent the client from using cache?
-   if(connection->response.noCache)
-   {
-      //Set Pragma property
-      p += sprintf(p, "Pragma: no-cache\r\n");
-      //Set Cache-Control property
-      p += sprintf(p, "Cache-Control: no-store, no-cache, must-revalidate\r\n");
-      p += sprintf(p, "Cache-Control: post-check=0, pre-check=0\r\n");
-   }
-
-   //Content type
-   p += sprintf(p, "Content-Type: %s\r\n", connection->response.contentType);
+      //Read the data available, if any
+      error = httpReceiveData(connection, data, size, received, flags);
 
-   //Use chunked encoding transfer?
-   if(connection->response.chunkedEncoding)
-   {
-      //Set Transfer-Encoding field
-      p += sprintf(p, "Transfer-Encoding: chunked\r\n");
-   }
-   //Persistent connection?
-   else if(connection->response.keepAlive)
-   {
-      //Set Content-Length field
-      p += sprintf(p, "Content-Length: %u\r\n", connection->response.contentLength);
+      //No data available for the time being?
+      if(error == ERROR_TIMEOUT)
+         error = ERROR_WOULD_BLOCK;
    }
 
-   //Terminate the header with an empty line
-   p += sprintf(p, "\r\n");
-
-   //Debug message
-   TRACE_DEBUG("HTTP response header:\r\n%s", connection->buffer);
-
-   //Send HTTP response header to the client
-   error = socketSend(connection->socket, connection->buffer,
-      strlen(connection->buffer), NULL, 0);
-
    //Return status code
    return error;
+#else
+   //Read data
+   return httpReceiveData(connection, data, size, received, flags);
+#endif
 }
 
 
 /**
- * @brief Read data from client request
+ * @brief Read data through the input buffer
+ *
+ * The socket is read in blocks of HTTP_SERVER_RX_BUFFER_SIZE bytes. The
+ * bytes that follow the current request (pipelined requests for instance)
+ * are kept in the input buffer until the next read operation
+ *
  * @param[in] connection Structure representing an HTTP connection
  * @param[out] data Buffer where to store the incoming data
  * @param[in] size Maximum number of bytes that can be received
  * @param[out] received Number of bytes that have been received
  * @param[in] flags Set of flags that influences the behavior of this function
+ *   (SOCKET_FLAG_BREAK_CHAR and SOCKET_FLAG_WAIT_ALL are supported)
  * @return Error code
  **/
 
-error_t httpReadStream(HttpConnection *connection, void *data, size_t size, size_t *received, uint_t flags)
+error_t httpReceiveData(HttpConnection *connection, void *data, size_t size, size_t *received, uint_t flags)
 {
    error_t error;
-   uint_t n;
+   size_t n;
+   uint8_t *p;
+   uint8_t *q;
+   bool_t found;
 
    //No data has been read yet
    *received = 0;
+   //The break character has not been encountered yet
+   found = FALSE;
 
-   //Chunked encoding transfer is used?
-   if(connection->request.chunkedEncoding)
+   //Read as much data as requested
+   while(*received < size && !found)
    {
-      //Point to the output buffer
-      char_t *p = data;
-
-      //Read as much data as possible
-      while(*received < size)
+      //The input buffer is empty?
+      if(connection->rxOffset >= connection->rxLength)
       {
-         //End of HTTP request body?
-         if(connection->request.lastChunk)
-            return ERROR_END_OF_STREAM;
-
-         //Acquire a new chunk when the current chunk
-         //has been completely consumed
-         if(connection->request.byteCount == 0)
-         {
-            //The size of each chunk is sent right before the chunk itself
-            error = httpReadChunkSize(connection);
-            //Failed to decode the chunk-size field?
-            if(error) return error;
+         //Return the data already read, unless the caller is waiting for
+         //a complete line or for a fixed amount of data
+         if(*received > 0 && !(flags & (SOCKET_FLAG_BREAK_CHAR | SOCKET_FLAG_WAIT_ALL)))
+            break;
 
-            //Any chunk whose size is zero terminates the data transfer
-            if(!connection->request.byteCount)
-            {
-               //The user must be satisfied with data already on hand
-               return (*received > 0) ? NO_ERROR : ERROR_END_OF_STREAM;
-            }
-         }
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == DISABLED)
+         //The pending output must be sent before waiting for more data
+         error = httpFlushStream(connection);
+         //Failed to send data?
+         if(error) return error;
+#endif
 
-         //Limit the number of bytes to read at a time
-         n = min(size - *received, connection->request.byteCount);
+         //Refill the input buffer
+         connection->rxOffset = 0;
+         connection->rxLength = 0;
 
-         //Read data
-         error = socketReceive(connection->socket, p, n, &n, flags);
+         //Read as much data as available
+         error = httpSocketReceive(connection, connection->rxBuffer,
+            HTTP_SERVER_RX_BUFFER_SIZE, &connection->rxLength, 0);
          //Any error to report?
          if(error) return error;
+      }
 
-         //Total number of data that have been read
-         *received += n;
-         //Remaining data still available in the current chunk
-         connection->request.byteCount -= n;
+      //Point to the first unread byte
+      p = connection->rxBuffer + connection->rxOffset;
+      //Number of bytes that can be copied
+      n = min(connection->rxLength - connection->rxOffset, size - *received);
 
-         //The HTTP_FLAG_BREAK_CHAR flag causes the function to stop reading
-         //data as soon as the specified break character is encountered
-         if(flags & HTTP_FLAG_BREAK_CRLF)
-         {
-            //Check whether a break character has been received
-            if(p[n - 1] == LSB(flags)) break;
-         }
-         //The HTTP_FLAG_WAIT_ALL flag causes the function to return
-         //only when the requested number of bytes have been read
-         else if(!(flags & HTTP_FLAG_WAIT_ALL))
+      //Stop reading when the specified character is encountered?
+      if(flags & SOCKET_FLAG_BREAK_CHAR)
+      {
+         //Search the input buffer for the break character
+         q = memchr(p, LSB(flags), n);
+
+         //Character found?
+         if(q != NULL)
          {
-            break;
+            //Read the data up to and including the break character
+            n = q - p + 1;
+            found = TRUE;
          }
+      }
 
-         //Advance data pointer
-         p += n;
+      //Copy the data
+      memcpy((uint8_t *) data + *received, p, n);
+
+      //Advance data pointer
+      connection->rxOffset += n;
+      *received += n;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send data to the client
+ *
+ * Headers, chunk framing and small writes are coalesced in the output
+ * buffer, which is sent when full or when httpFlushStream() is called,
+ * so that the response goes out in full-sized segments.
+ *
+ * In event-driven mode, immutable data (SOCKET_FLAG_NO_COPY) that does not
+ * fit in the output buffer is referenced rather than copied. A write is
+ * either queued as a whole or not at all; ERROR_WOULD_BLOCK is returned
+ * when the output buffer cannot hold the data yet. Data larger than the
+ * output buffer is sent in blocking mode
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] data Buffer containing the data to be transmitted
+ * @param[in] length Number of bytes to be transmitted
+ * @param[in] flags Set of flags that influences the behavior of this function
+ * @return Error code
+ **/
+
+error_t httpSend(HttpConnection *connection, const void *data, size_t length, uint_t flags)
+{
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+   error_t error;
+   size_t n;
+
+   //Immutable data that cannot be copied to the output buffer?
+   if((flags & SOCKET_FLAG_NO_COPY) && (connection->txFileLength > 0 ||
+      (connection->txLength - connection->txOffset + length) > HTTP_SERVER_TX_BUFFER_SIZE))
+   {
+      //Only one block of immutable data can be queued at a time
+      if(connection->txFileLength > 0)
+      {
+         //Try to send the pending data
+         error = httpFlushStream(connection);
+         //The data cannot be queued yet?
+         if(error) return error;
       }
+
+      //The data is referenced rather than copied
+      connection->txFileData = data;
+      connection->txFileLength = length;
+
+      //Send as much data as possible
+      error = httpFlushStream(connection);
+
+      //The rest of the data will be sent when the connection becomes writable
+      if(error == ERROR_WOULD_BLOCK)
+         error = NO_ERROR;
    }
-   //Default encoding?
    else
    {
-      //Return immediately if the end of the request body has been reached
-      if(!connection->request.byteCount)
-         return ERROR_END_OF_STREAM;
+      //Data cannot be queued behind immutable data
+      if(connection->txFileLength > 0 || (connection->txLength -
+         connection->txOffset + length) > HTTP_SERVER_TX_BUFFER_SIZE)
+      {
+         //Try to make room in the output buffer
+         error = httpFlushStream(connection);
+         //Any error other than a full send buffer?
+         if(error && error != ERROR_WOULD_BLOCK)
+            return error;
+      }
+
+      //Number of bytes waiting in the output buffer
+      n = connection->txLength - connection->txOffset;
+
+      //The data does not fit in the output buffer?
+      if(connection->txFileLength > 0 || (n + length) > HTTP_SERVER_TX_BUFFER_SIZE)
+      {
+         //The data can be sent later on?
+         if(length <= HTTP_SERVER_TX_BUFFER_SIZE)
+            return ERROR_WOULD_BLOCK;
+
+         //Temporarily switch to blocking mode
+         socketSetTimeout(connection->socket, HTTP_SERVER_TIMEOUT);
+
+         //Send the pending data first
+         error = httpFlushStream(connection);
+
+         //Check status code
+         if(error == ERROR_WOULD_BLOCK)
+            error = ERROR_TIMEOUT;
+         else if(!error)
+            error = httpSocketSend(connection, data, length, NULL, 0);
+
+         //Switch back to non-blocking mode
+         socketSetTimeout(connection->socket, 0);
+         //Return status code
+         return error;
+      }
+
+      //Move the pending data to the beginning of the output buffer
+      if(connection->txOffset > 0)
+      {
+         memmove(connection->txBuffer, connection->txBuffer + connection->txOffset, n);
+         connection->txOffset = 0;
+         connection->txLength = n;
+      }
+
+      //Queue the data. It is sent when the output buffer is full
+      //or when the response is complete
+      memcpy(connection->txBuffer + n, data, length);
+      connection->txLength += length;
+
+      //Successful processing
+      error = NO_ERROR;
+   }
+
+   //Return status code
+   return error;
+#else
+   error_t error;
+   size_t n;
+
+   //Number of bytes that can be added to the output buffer
+   n = HTTP_SERVER_TX_BUFFER_SIZE - connection->txLength;
+
+   //The data fits in the output buffer?
+   if(length <= n)
+   {
+      //Coalesce the data with the previous writes
+      memcpy(connection->txBuffer + connection->txLength, data, length);
+      connection->txLength += length;
+      //The data will be sent later on
+      return NO_ERROR;
+   }
 
-      //Limit the number of bytes to read
-      n = min(size, connection->request.byteCount);
+   //Top off the output buffer so that a full-sized segment is sent
+   memcpy(connection->txBuffer + connection->txLength, data, n);
+   connection->txLength += n;
 
-      //Read data
-      error = socketReceive(connection->socket, data, n, received, flags);
-      //Any error to report
-      if(error) return error;
+   //Advance data pointer
+   data = (uint8_t *) data + n;
+   length -= n;
 
-      //Decrement the count of remaining bytes to read
-      connection->request.byteCount -= *received;
-   }
+   //Send the contents of the output buffer
+   error = httpFlushStream(connection);
+   //Failed to send data?
+   if(error) return error;
 
-   //Successful read operation
+   //The remaining data is large enough to be sent directly?
+   if(length >= HTTP_SERVER_TX_BUFFER_SIZE)
+      return httpSocketSend(connection, data, length, NULL, flags);
+
+   //Keep the rest of the data in the output buffer
+   memcpy(connection->txBuffer, data, length);
+   connection->txLength = length;
+
+   //Successful processing
    return NO_ERROR;
+#endif
 }
 
 
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+
 /**
- * @brief Read chunk-size field from the input stream
+ * @brief Make sure the output buffer can accept data (event-driven mode)
  * @param[in] connection Structure representing an HTTP connection
+ * @param[in] length Number of bytes to be queued by subsequent write operations
+ * @return ERROR_WOULD_BLOCK if the output buffer cannot hold the data yet
  **/
 
-error_t httpReadChunkSize(HttpConnection *connection)
+error_t httpReserveStream(HttpConnection *connection, size_t length)
 {
    error_t error;
-   uint_t n;
-   char_t *end;
-   char_t s[8];
 
-   //First chunk to be received?
-   if(connection->request.firstChunk)
+   //Data larger than the output buffer is sent in blocking mode
+   if(length > HTTP_SERVER_TX_BUFFER_SIZE)
+      return NO_ERROR;
+
+   //Not enough room in the output buffer?
+   if(connection->txFileLength > 0 || (connection->txLength -
+      connection->txOffset + length) > HTTP_SERVER_TX_BUFFER_SIZE)
    {
-      //Clear the flag
-      connection->request.firstChunk = FALSE;
+      //Try to send the pending data
+      error = httpFlushStream(connection);
+      //Any error other than a full send buffer?
+      if(error && error != ERROR_WOULD_BLOCK)
+         return error;
    }
-   else
+
+   //Check whether enough room is now available
+   if(connection->txFileLength > 0 || (connection->txLength -
+      connection->txOffset + length) > HTTP_SERVER_TX_BUFFER_SIZE)
    {
-      //Read the CRLF that follows the previous chunk-data field
-      error = socketReceive(connection->socket,
-         s, sizeof(s) - 1, &n, SOCKET_FLAG_BREAK_CRLF);
-      //Any error to report?
-      if(error) return error;
+      return ERROR_WOULD_BLOCK;
+   }
 
-      //Properly terminate the string with a NULL character
-      s[n] = '\0';
+   //The data can be queued
+   return NO_ERROR;
+}
 
-      //The chunk data must be terminated by CRLF
-      if(strcmp(s, "\r\n"))
-         return ERROR_WRONG_ENCODING;
-   }
+#endif
 
-   //Read the chunk-size field
-   error = socketReceive(connection->socket,
-      s, sizeof(s) - 1, &n, SOCKET_FLAG_BREAK_CRLF);
-   //Any error to report?
-   if(error) return error;
 
-   //Properly terminate the string with a NULL character
-   s[n] = '\0';
-   //Remove extra whitespaces
-   strRemoveTrailingSpace(s);
+/**
+ * @brief Send the contents of the output buffer
+ *
+ * The output buffer is flushed automatically once the response is complete.
+ * Callbacks may call this function explicitly to push partial output to
+ * the client
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code (ERROR_WOULD_BLOCK if some data is still pending,
+ *   in event-driven mode)
+ **/
 
-   //Retrieve the size of the chunk
-   connection->request.byteCount = strtoul(s, &end, 16);
+error_t httpFlushStream(HttpConnection *connection)
+{
+   error_t error;
+   size_t n;
 
-   //No valid conversion could be performed?
-   if(end == s || *end != '\0')
-      return ERROR_WRONG_ENCODING;
+   //Send the data held in the output buffer
+   while(connection->txOffset < connection->txLength)
+   {
+      //Send as much data as possible
+      n = 0;
+      error = httpSocketSend(connection, connection->txBuffer + connection->txOffset,
+         connection->txLength - connection->txOffset, &n, 0);
+
+      //Advance data pointer
+      connection->txOffset += n;
+
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+      //The send buffer is full?
+      if(error == ERROR_TIMEOUT)
+         return ERROR_WOULD_BLOCK;
+#endif
+      //Any other error to report?
+      if(error)
+         return error;
+   }
 
-   //Any chunk whose size is zero terminates the data transfer
-   if(!connection->request.byteCount)
+   //The output buffer is now empty
+   connection->txOffset = 0;
+   connection->txLength = 0;
+
+   //Any immutable data queued behind the output buffer?
+   if(connection->txFileLength > 0)
    {
-      //The end of the HTTP request body has been reached
-      connection->request.lastChunk = TRUE;
+      //Send as much data as possible
+      n = 0;
+      error = httpSocketSend(connection, connection->txFileData,
+         connection->txFileLength, &n, SOCKET_FLAG_NO_COPY);
+
+      //Advance data pointer
+      connection->txFileData += n;
+      connection->txFileLength -= n;
+
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+      //The send buffer is full?
+      if(error == ERROR_TIMEOUT)
+         return ERROR_WOULD_BLOCK;
+#endif
+      //Any other error to report?
+      if(error)
+         return error;
 
-      //Skip the trailer
-      while(1)
+      //The data is the body of a chunk?
+      if(connection->txFileCrlf)
       {
-         //Read a complete line
-         error = socketReceive(connection->socket,
-            s, sizeof(s) - 1, &n, SOCKET_FLAG_BREAK_CRLF);
-         //Unable to read any data?
-         if(error) return error;
-
-         //Properly terminate the string with a NULL character
-         s[n] = '\0';
+         //Terminate the chunk-data by CRLF
+         connection->txFileCrlf = FALSE;
+         memcpy(connection->txBuffer, "\r\n", 2);
+         connection->txLength = 2;
 
-         //The trailer is terminated by an empty line
-         if(!strcmp(s, "\r\n"))
-            break;
+         //Send the CRLF
+         return httpFlushStream(connection);
       }
    }
 
-   //Successful processing
+   //All the data has been sent
    return NO_ERROR;
 }
 
 
 /**
- * @brief Write data to the client
+ * @brief Send data to the client
  * @param[in] connection Structure representing an HTTP connection
- * @param[in] data Buffer containing the data to be transmitted
+ * @param[in] data Pointer to a buffer containing the data to be transmitted
  * @param[in] length Number of bytes to be transmitted
+ * @param[out] written Actual number of bytes written (optional parameter)
+ * @param[in] flags Set of flags that influences the behavior of this function
  * @return Error code
  **/
 
-error_t httpWriteStream(HttpConnection *connection, const void *data, size_t length)
+error_t httpSocketSend(HttpConnection *connection, const void *data,
+   size_t length, size_t *written, uint_t flags)
 {
    error_t error;
-   uint_t n;
+   size_t n;
 
-   //Use chunked encoding transfer?
-   if(connection->response.chunkedEncoding)
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+   //HTTP/2 connection?
+   if(connection->http2 != NULL)
    {
-      //Any data to send?
-      if(length > 0)
-      {
-         char_t s[8];
-
-         //The chunk-size field is a string of hex digits
-         //indicating the size of the chunk
-         n = sprintf(s, "%X\r\n", length);
-
-         //Send the chunk-size field
-         error = socketSend(connection->socket, s, n, NULL, 0);
-         //Failed to send data?
-         if(error) return error;
-
-         //Send the chunk-data
-         error = socketSend(connection->socket, data, length, NULL, 0);
-         //Failed to send data?
-         if(error) return error;
-
-         //Terminate the chunk-data by CRLF
-         error = socketSend(connection->socket, "\r\n", 2, NULL, 0);
-      }
-      else
-      {
-         //Any chunk whose size is zero may terminate the data
-         //transfer and must be discarded
-         error = NO_ERROR;
-      }
+      //The data is carried by DATA frames on the current stream
+      error = http2SendData(connection, data, length, flags);
+      //The data is either queued as a whole or not at all
+      n = error ? 0 : length;
    }
-   //Default encoding?
    else
+#endif
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+   //Check whether a secure connection is being used
+   if(connection->tlsContext != NULL)
    {
-      //The length of the body shall not exceed the value
-      //specified in the Content-Length field
-      length = min(length, connection->response.byteCount);
+      //Use SSL/TLS to transmit data to the client. The data is encrypted
+      //into the TLS record buffer, so the socket flags do not apply
+      error = tlsWrite(connection->tlsContext, data, length, 0);
+      //The TLS layer either sends all the data or fails
+      n = error ? 0 : length;
+   }
+   else
+#endif
+   {
+      //Transmit data to the client
+      n = 0;
+      error = socketSend(connection->socket, data, length, &n, flags);
+   }
 
-      //Send user data
-      error = socketSend(connection->socket, data, length, NULL, 0);
+#if (HTTP_SERVER_STATS_SUPPORT == ENABLED)
+   //Any data sent?
+   if(n > 0)
+   {
+      //Time to first byte
+      if(!connection->metrics.firstByteSent)
+      {
+         connection->metrics.firstByteSent = TRUE;
+         connection->metrics.firstByteTime = osGetTickCount() - connection->metrics.startTime;
+      }
 
-      //Decrement the count of remaining bytes to transfer
-      connection->response.byteCount -= length;
+      //Number of bytes sent
+      connection->metrics.bytesSent += n;
    }
+#endif
+
+   //Total number of bytes successfully sent
+   if(written != NULL)
+      *written = n;
 
    //Return status code
    return error;
@@ -939,29 +3468,40 @@ error_t httpWriteStream(HttpConnection *connection, const void *data, size_t len
 
 
 /**
- * @brief Close output stream
+ * @brief Receive data from the client
  * @param[in] connection Structure representing an HTTP connection
+ * @param[out] data Buffer into which received data will be placed
+ * @param[in] size Maximum number of bytes that can be received
+ * @param[out] received Actual number of bytes that have been received
+ * @param[in] flags Set of flags that influences the behavior of this function
  * @return Error code
  **/
 
-error_t httpCloseStream(HttpConnection *connection)
+error_t httpSocketReceive(HttpConnection *connection, void *data,
+   size_t size, size_t *received, uint_t flags)
 {
-   error_t error;
-
-   //Use chunked encoding transfer?
-   if(connection->response.chunkedEncoding)
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+   //HTTP/2 connection?
+   if(connection->http2 != NULL)
    {
-      //The chunked encoding is ended by any chunk whose size is zero
-      error = socketSend(connection->socket, "0\r\n\r\n", 5, NULL, 0);
+      //The request body is read from the DATA frames of the current stream
+      return http2ReceiveData(connection, data, size, received);
    }
    else
+#endif
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+   //Check whether a secure connection is being used
+   if(connection->tlsContext != NULL)
    {
-      //Chunked encoding is not used...
-      error = NO_ERROR;
+      //Use SSL/TLS to receive data from the client
+      return tlsRead(connection->tlsContext, data, size, received, flags);
+   }
+   else
+#endif
+   {
+      //Receive data from the client
+      return socketReceive(connection->socket, data, size, received, flags);
    }
-
-   //Return status code
-   return error;
 }
 
 
@@ -974,33 +3514,125 @@ error_t httpCloseStream(HttpConnection *connection)
 error_t httpSendResponse(HttpConnection *connection)
 {
    error_t error;
-   uint8_t *data;
+   uint_t flags;
    size_t length;
+#if (RES_EXTERNAL_SUPPORT == ENABLED)
+   uint32_t tag;
+   uint32_t offset;
+   DirEntry dirEntry;
+#else
+   uint8_t *data;
+#endif
 
    //Get absolute path to the specified URI
    httpGetAbsolutePath(connection, connection->request.uri, connection->buffer);
 
-   //Get the resource data associated with the URI
-   error = resGetData(connection->buffer, &data, &length);
+#if (RES_EXTERNAL_SUPPORT == ENABLED)
+   //Search the resource image for the file associated with the URI
+   error = resSearchFileEx(connection->buffer, connection->request.acceptGzipEncoding ?
+      RES_FLAG_GZIP : 0, &dirEntry);
+   //The specified URI cannot be found?
+   if(error) return error;
+
+   //Retrieve the length and the flags of the resource
+   length = dirEntry.dataLength;
+   flags = dirEntry.type & RES_FLAG_MASK;
+   //The file is sent from the beginning
+   offset = 0;
+
+   //The resource compiler stores a content hash along with each file
+   if(!resGetFileTag(&dirEntry, &tag))
+      sprintf(connection->response.etag, "\"%08lX\"", (unsigned long) tag);
+   else
+      connection->response.etag[0] = '\0';
+#else
+   //Get the resource data associated with the URI. A precompressed variant
+   //is sent as-is when the client accepts gzip-compressed content
+   error = resGetDataEx(connection->buffer, connection->request.acceptGzipEncoding ?
+      RES_FLAG_GZIP : 0, &data, &length, &flags);
    //The specified URI cannot be found?
    if(error) return error;
 
+   //The resource compiler stores a content hash along with each file
+   if(flags & RES_FLAG_TAG)
+      sprintf(connection->response.etag, "\"%08X\"", resGetTag(data));
+   else
+      connection->response.etag[0] = '\0';
+#endif
+
    //Format HTTP response header
    connection->response.version = connection->request.version;
    connection->response.statusCode = 200;
    connection->response.keepAlive = connection->request.keepAlive;
    connection->response.noCache = FALSE;
    connection->response.contentType = mimeGetType(connection->request.uri);
+   connection->response.contentEncoding = (flags & RES_FLAG_GZIP) ? "gzip" : NULL;
+   connection->response.acceptRanges = TRUE;
    connection->response.chunkedEncoding = FALSE;
    connection->response.contentLength = length;
 
+   //The client already holds the current representation of the resource?
+   if(httpCheckEntityTag(connection))
+   {
+      //Debug message
+      TRACE_INFO("Resource not modified...\r\n");
+
+      //Send a 304 Not Modified response without any body
+      connection->response.statusCode = 304;
+      connection->response.contentLength = 0;
+
+      //Send the header to the client
+      return httpWriteHeader(connection);
+   }
+
+   //Byte range requested?
+   if(connection->request.byteRange)
+   {
+      //Determine the part of the resource to be sent
+      error = httpResolveRange(connection, length);
+
+      //Unsatisfiable byte range?
+      if(error == ERROR_OUT_OF_RANGE)
+      {
+         //Send a 416 response without any body
+         connection->response.statusCode = 416;
+         connection->response.contentLength = 0;
+
+         //Send the header to the client
+         return httpWriteHeader(connection);
+      }
+      //Partial content?
+      else if(!error)
+      {
+         //Debug message
+         TRACE_INFO("Sending bytes %u-%u...\r\n", connection->response.rangeFirst,
+            connection->response.rangeLast);
+
+         //Send a 206 response that contains the requested byte range only
+         connection->response.statusCode = 206;
+#if (RES_EXTERNAL_SUPPORT == ENABLED)
+         offset = connection->response.rangeFirst;
+#else
+         data += connection->response.rangeFirst;
+#endif
+         length = connection->response.rangeLast - connection->response.rangeFirst + 1;
+         connection->response.contentLength = length;
+      }
+   }
+
    //Send the header to the client
    error = httpWriteHeader(connection);
    //Any error to report?
    if(error) return error;
 
-   //Send response body
-   error = httpWriteStream(connection, data, length);
+#if (RES_EXTERNAL_SUPPORT == ENABLED)
+   //Stream the resource from the block device. The read-ahead of the
+   //resource manager overlaps the device accesses with the transmission
+   error = httpSendResourceFile(connection, &dirEntry, offset, length);
+#else
+   //Resource data is immutable and can be sent without being copied
+   error = httpWriteResource(connection, data, length);
+#endif
    //Any error to report?
    if(error) return error;
 
@@ -1011,6 +3643,133 @@ error_t httpSendResponse(HttpConnection *connection)
 }
 
 
+#if (RES_EXTERNAL_SUPPORT == ENABLED)
+
+/**
+ * @brief Send part of a resource stored on a block device
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] dirEntry Resource to be sent
+ * @param[in] offset Offset of the first byte to send
+ * @param[in] length Number of bytes to send
+ * @return Error code
+ **/
+
+error_t httpSendResourceFile(HttpConnection *connection,
+   const DirEntry *dirEntry, uint32_t offset, size_t length)
+{
+   error_t error;
+   size_t n;
+   FsFile file;
+
+   //Open the resource
+   error = resOpenFile(&file, dirEntry, MODE_BINARY);
+   //Any error to report?
+   if(error) return error;
+
+   //Move to the first byte to send
+   error = resSeekFile(&file, &offset);
+   //Any error to report?
+   if(error) return error;
+
+   //Send the resource
+   while(length > 0)
+   {
+      //Read as much data as the buffer can hold
+      n = resReadFile(&file, connection->buffer, min(length, HTTP_SERVER_BUFFER_SIZE));
+      //Failed to read data?
+      if(!n) return ERROR_READ_FAILED;
+
+      //Send the data to the client
+      error = httpWriteStream(connection, connection->buffer, n);
+      //Any error to report?
+      if(error) return error;
+
+      //Remaining bytes to send
+      length -= n;
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+#endif
+
+
+/**
+ * @brief Check whether the entity tag of the response matches If-None-Match
+ * @param[in] connection Structure representing an HTTP connection
+ * @return TRUE if the client copy of the resource is up to date, else FALSE
+ **/
+
+bool_t httpCheckEntityTag(HttpConnection *connection)
+{
+   //The resource has no entity tag?
+   if(connection->response.etag[0] == '\0')
+      return FALSE;
+
+   //The wildcard matches any current representation of the resource
+   if(!strcmp(connection->request.ifNoneMatch, "*"))
+      return TRUE;
+
+   //If-None-Match uses the weak comparison function, so that a weak tag
+   //(W/ prefix) matches as well
+   if(strstr(connection->request.ifNoneMatch, connection->response.etag))
+      return TRUE;
+
+   //The client copy is outdated
+   return FALSE;
+}
+
+
+/**
+ * @brief Determine the byte range to be sent
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] length Length of the resource
+ * @return NO_ERROR if a partial response can be sent, ERROR_OUT_OF_RANGE if
+ *   the byte range cannot be satisfied, or ERROR_INVALID_REQUEST if the whole
+ *   resource is to be sent
+ **/
+
+error_t httpResolveRange(HttpConnection *connection, size_t length)
+{
+   //The Range field is ignored if the representation has changed
+   //(If-Range uses the strong comparison function)
+   if(connection->request.ifRange[0] != '\0' &&
+      strcmp(connection->request.ifRange, connection->response.etag))
+   {
+      return ERROR_INVALID_REQUEST;
+   }
+
+   //Save the length of the resource
+   connection->response.resourceLength = length;
+
+   //Suffix byte range?
+   if(connection->request.rangeSuffix)
+   {
+      //A suffix length of zero cannot be satisfied
+      if(!connection->request.rangeLast || !length)
+         return ERROR_OUT_OF_RANGE;
+
+      //Send the last bytes of the resource
+      connection->response.rangeFirst = length - min(connection->request.rangeLast, length);
+      connection->response.rangeLast = length - 1;
+   }
+   else
+   {
+      //The first byte position must lie within the resource
+      if(connection->request.rangeFirst >= length)
+         return ERROR_OUT_OF_RANGE;
+
+      //The last byte position is limited to the end of the resource
+      connection->response.rangeFirst = connection->request.rangeFirst;
+      connection->response.rangeLast = min(connection->request.rangeLast, length - 1);
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Send error response to the client
  * @param[in] connection Structure representing an HTTP connection
@@ -1044,6 +3803,9 @@ error_t httpSendErrorResponse(HttpConnection *connection, uint_t statusCode, con
    connection->response.keepAlive = connection->request.keepAlive;
    connection->response.noCache = FALSE;
    connection->response.contentType = mimeGetType(".htm");
+   connection->response.contentEncoding = NULL;
+   connection->response.etag[0] = '\0';
+   connection->response.acceptRanges = FALSE;
    connection->response.chunkedEncoding = FALSE;
    connection->response.contentLength = length;
 
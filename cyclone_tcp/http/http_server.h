@@ -32,6 +32,7 @@
 //Dependencies
 #include "os.h"
 #include "socket.h"
+#include "resource_manager.h"
 
 //Stack size required to run the HTTP server
 #ifndef HTTP_SERVER_STACK_SIZE
@@ -104,6 +105,20 @@
    #error HTTP_SERVER_QUERY_STRING_MAX_LEN parameter is invalid
 #endif
 
+//Maximum length of the If-None-Match field
+#ifndef HTTP_SERVER_IF_NONE_MATCH_MAX_LEN
+   #define HTTP_SERVER_IF_NONE_MATCH_MAX_LEN 47
+#elif (HTTP_SERVER_IF_NONE_MATCH_MAX_LEN < 10)
+   #error HTTP_SERVER_IF_NONE_MATCH_MAX_LEN parameter is invalid
+#endif
+
+//Freshness lifetime of static resources, in seconds
+#ifndef HTTP_SERVER_MAX_AGE
+   #define HTTP_SERVER_MAX_AGE 0
+#elif (HTTP_SERVER_MAX_AGE < 0)
+   #error HTTP_SERVER_MAX_AGE parameter is invalid
+#endif
+
 //Maximum length of CGI parameters
 #ifndef HTTP_SERVER_CGI_PARAM_MAX_LEN
    #define HTTP_SERVER_CGI_PARAM_MAX_LEN 31
@@ -125,6 +140,108 @@
    #error HTTP_SERVER_SSI_MAX_RECURSION parameter is invalid
 #endif
 
+//Keep compiled SSI scripts between requests
+#ifndef HTTP_SERVER_SSI_CACHE_SUPPORT
+   #define HTTP_SERVER_SSI_CACHE_SUPPORT ENABLED
+#elif (HTTP_SERVER_SSI_CACHE_SUPPORT != ENABLED && HTTP_SERVER_SSI_CACHE_SUPPORT != DISABLED)
+   #error HTTP_SERVER_SSI_CACHE_SUPPORT parameter is invalid
+#endif
+
+//Maximum number of compiled SSI scripts in the cache
+#ifndef HTTP_SERVER_SSI_CACHE_SIZE
+   #define HTTP_SERVER_SSI_CACHE_SIZE 8
+#elif (HTTP_SERVER_SSI_CACHE_SIZE < 1 || HTTP_SERVER_SSI_CACHE_SIZE > 64)
+   #error HTTP_SERVER_SSI_CACHE_SIZE parameter is invalid
+#endif
+
+//Event-driven mode (a few tasks multiplex all the connections)
+#ifndef HTTP_SERVER_EVENT_DRIVEN_SUPPORT
+   #define HTTP_SERVER_EVENT_DRIVEN_SUPPORT DISABLED
+#elif (HTTP_SERVER_EVENT_DRIVEN_SUPPORT != ENABLED && HTTP_SERVER_EVENT_DRIVEN_SUPPORT != DISABLED)
+   #error HTTP_SERVER_EVENT_DRIVEN_SUPPORT parameter is invalid
+#endif
+
+//Number of worker tasks (event-driven mode)
+#ifndef HTTP_SERVER_WORKER_COUNT
+   #define HTTP_SERVER_WORKER_COUNT 1
+#elif (HTTP_SERVER_WORKER_COUNT < 1 || HTTP_SERVER_WORKER_COUNT > HTTP_SERVER_MAX_CONNECTIONS)
+   #error HTTP_SERVER_WORKER_COUNT parameter is invalid
+#endif
+
+//Size of the per-connection input buffer
+#ifndef HTTP_SERVER_RX_BUFFER_SIZE
+   #define HTTP_SERVER_RX_BUFFER_SIZE 512
+#elif (HTTP_SERVER_RX_BUFFER_SIZE < 64)
+   #error HTTP_SERVER_RX_BUFFER_SIZE parameter is invalid
+#endif
+
+//Size of the per-connection output buffer
+#ifndef HTTP_SERVER_TX_BUFFER_SIZE
+   #define HTTP_SERVER_TX_BUFFER_SIZE 1430
+#elif (HTTP_SERVER_TX_BUFFER_SIZE < 128)
+   #error HTTP_SERVER_TX_BUFFER_SIZE parameter is invalid
+#endif
+
+//Size of the route table (power of two)
+#ifndef HTTP_SERVER_ROUTE_TABLE_SIZE
+   #define HTTP_SERVER_ROUTE_TABLE_SIZE 16
+#elif (HTTP_SERVER_ROUTE_TABLE_SIZE < 1 || (HTTP_SERVER_ROUTE_TABLE_SIZE & (HTTP_SERVER_ROUTE_TABLE_SIZE - 1)) != 0)
+   #error HTTP_SERVER_ROUTE_TABLE_SIZE parameter is invalid
+#endif
+
+//Performance metrics
+#ifndef HTTP_SERVER_STATS_SUPPORT
+   #define HTTP_SERVER_STATS_SUPPORT DISABLED
+#elif (HTTP_SERVER_STATS_SUPPORT != ENABLED && HTTP_SERVER_STATS_SUPPORT != DISABLED)
+   #error HTTP_SERVER_STATS_SUPPORT parameter is invalid
+#endif
+
+//Number of buckets of the response time histogram
+#ifndef HTTP_SERVER_STATS_HISTOGRAM_SIZE
+   #define HTTP_SERVER_STATS_HISTOGRAM_SIZE 12
+#elif (HTTP_SERVER_STATS_HISTOGRAM_SIZE < 2 || HTTP_SERVER_STATS_HISTOGRAM_SIZE > 32)
+   #error HTTP_SERVER_STATS_HISTOGRAM_SIZE parameter is invalid
+#endif
+
+//SSL/TLS support (HTTPS)
+#ifndef HTTP_SERVER_TLS_SUPPORT
+   #define HTTP_SERVER_TLS_SUPPORT DISABLED
+#elif (HTTP_SERVER_TLS_SUPPORT != ENABLED && HTTP_SERVER_TLS_SUPPORT != DISABLED)
+   #error HTTP_SERVER_TLS_SUPPORT parameter is invalid
+#elif (HTTP_SERVER_TLS_SUPPORT == ENABLED && HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+   #error HTTP_SERVER_TLS_SUPPORT requires one task per connection (blocking TLS layer)
+#endif
+
+//WebSocket support
+#ifndef HTTP_SERVER_WEB_SOCKET_SUPPORT
+   #define HTTP_SERVER_WEB_SOCKET_SUPPORT DISABLED
+#elif (HTTP_SERVER_WEB_SOCKET_SUPPORT != ENABLED && HTTP_SERVER_WEB_SOCKET_SUPPORT != DISABLED)
+   #error HTTP_SERVER_WEB_SOCKET_SUPPORT parameter is invalid
+#elif (HTTP_SERVER_WEB_SOCKET_SUPPORT == ENABLED && HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+   #error HTTP_SERVER_WEB_SOCKET_SUPPORT requires one task per connection (blocking frame I/O)
+#endif
+
+//HTTP/2 support (negotiated through ALPN over TLS)
+#ifndef HTTP_SERVER_HTTP2_SUPPORT
+   #define HTTP_SERVER_HTTP2_SUPPORT DISABLED
+#elif (HTTP_SERVER_HTTP2_SUPPORT != ENABLED && HTTP_SERVER_HTTP2_SUPPORT != DISABLED)
+   #error HTTP_SERVER_HTTP2_SUPPORT parameter is invalid
+#elif (HTTP_SERVER_HTTP2_SUPPORT == ENABLED && HTTP_SERVER_TLS_SUPPORT == DISABLED)
+   #error HTTP_SERVER_HTTP2_SUPPORT requires HTTP_SERVER_TLS_SUPPORT
+#endif
+
+//Size of the TLS session cache created by the server
+#ifndef HTTP_SERVER_TLS_CACHE_SIZE
+   #define HTTP_SERVER_TLS_CACHE_SIZE 16
+#elif (HTTP_SERVER_TLS_CACHE_SIZE < 1)
+   #error HTTP_SERVER_TLS_CACHE_SIZE parameter is invalid
+#endif
+
+//Check whether SSL/TLS support is enabled
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+   #include "tls.h"
+#endif
+
 //HTTP port number
 #define HTTP_PORT 80
 //HTTPS port number (HTTP over SSL/TLS)
@@ -134,6 +251,15 @@
 struct _HttpConnection;
 typedef struct _HttpConnection HttpConnection;
 
+//Forward declaration of HttpServerContext structure
+struct _HttpServerContext;
+
+//Forward declaration of SsiScript structure
+struct _SsiScript;
+
+//Forward declaration of Http2Context structure
+struct _Http2Context;
+
 
 /**
  * @brief HTTP version numbers
@@ -186,6 +312,22 @@ typedef enum
 #define HTTP_FLAG_BREAK(c) (HTTP_FLAG_BREAK_CHAR | LSB(c))
 
 
+/**
+ * @brief Connection states (event-driven mode)
+ **/
+
+typedef enum
+{
+   HTTP_CONNECTION_STATE_REQUEST_LINE,   ///<Waiting for the Request-Line
+   HTTP_CONNECTION_STATE_REQUEST_HEADER, ///<Receiving the header fields
+   HTTP_CONNECTION_STATE_SCRIPT,         ///<Executing an SSI script
+   HTTP_CONNECTION_STATE_CALLBACK,       ///<Executing the URI not found callback
+   HTTP_CONNECTION_STATE_FLUSH,          ///<Sending the rest of the response
+   HTTP_CONNECTION_STATE_SHUTDOWN_TX,    ///<Waiting for the data to be acknowledged
+   HTTP_CONNECTION_STATE_SHUTDOWN_RX     ///<Waiting for the FIN of the client
+} HttpConnectionState;
+
+
 /**
  * @brief CGI callback function
  **/
@@ -200,6 +342,167 @@ typedef error_t (*CgiCallback)(HttpConnection *connection, const char_t *param);
 typedef error_t (*UriNotFoundCallback)(HttpConnection *connection);
 
 
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+
+/**
+ * @brief TLS initialization callback function
+ **/
+
+typedef error_t (*HttpTlsInitCallback)(HttpConnection *connection, TlsContext *tlsContext);
+
+#endif
+
+
+#if (HTTP_SERVER_WEB_SOCKET_SUPPORT == ENABLED)
+
+/**
+ * @brief WebSocket events
+ **/
+
+typedef enum
+{
+   WEB_SOCKET_EVENT_OPEN    = 0, ///<The opening handshake is complete
+   WEB_SOCKET_EVENT_MESSAGE = 1, ///<A complete message has been received
+   WEB_SOCKET_EVENT_CLOSE   = 2  ///<The connection is about to be closed
+} WebSocketEvent;
+
+
+/**
+ * @brief WebSocket callback function
+ **/
+
+typedef error_t (*WebSocketCallback)(HttpConnection *connection, WebSocketEvent event,
+   uint_t opcode, const uint8_t *data, size_t length);
+
+#endif
+
+
+/**
+ * @brief Request callback function
+ **/
+
+typedef error_t (*HttpRequestCallback)(HttpConnection *connection);
+
+
+/**
+ * @brief Route flags
+ **/
+
+typedef enum
+{
+   HTTP_ROUTE_FLAG_EXACT  = 0x00, ///<The path must match the whole URI
+   HTTP_ROUTE_FLAG_PREFIX = 0x01  ///<The path (ending with a slash) matches any URI it begins
+} HttpRouteFlags;
+
+
+/**
+ * @brief Route
+ *
+ * A route binds a request handler to a URI, or to all the URIs that
+ * begin with a given path. Routes take precedence over the resources,
+ * an exact route over a prefix route, and a longer prefix over a
+ * shorter one
+ *
+ **/
+
+typedef struct
+{
+   const char_t *path;           ///<Path to match (query string excluded)
+   uint_t flags;                 ///<Route flags (see HttpRouteFlags)
+   HttpRequestCallback callback; ///<Request handler
+} HttpRoute;
+
+
+/**
+ * @brief HTTP server statistics
+ *
+ * Times are expressed in milliseconds and measured from the reception
+ * of the Request-Line. Bucket n of the response time histogram counts
+ * the responses that took less than 2^n ms (and at least 2^(n-1) ms),
+ * the last bucket counting all the slower ones
+ *
+ **/
+
+typedef struct
+{
+   uint32_t uptime;             ///<Time elapsed since the statistics were reset
+   uint32_t connections;        ///<Number of connections accepted
+   uint32_t refusedConnections; ///<Connections refused because HTTP_SERVER_MAX_CONNECTIONS were open
+   uint32_t activeConnections;  ///<Number of connections currently open
+   uint32_t peakConnections;    ///<Highest number of simultaneous connections
+   uint32_t requests;           ///<Number of requests served
+   uint32_t bytesSent;          ///<Number of bytes sent, headers included
+   uint32_t headerTime;         ///<Cumulative time spent receiving and parsing request headers
+   uint32_t maxHeaderTime;      ///<Longest time spent receiving and parsing a request header
+   uint32_t firstByteTime;      ///<Cumulative time to first byte
+   uint32_t maxFirstByteTime;   ///<Longest time to first byte
+   uint32_t responseTime;       ///<Cumulative response time
+   uint32_t maxResponseTime;    ///<Longest response time
+   uint32_t scriptRequests;     ///<Number of requests served by SSI scripts
+   uint32_t scriptTime;         ///<Cumulative SSI execution time
+   uint32_t maxScriptTime;      ///<Longest SSI execution time
+   uint32_t callbackRequests;   ///<Number of requests that invoked CGI, route or URI not found callbacks
+   uint32_t callbackTime;       ///<Cumulative time spent in these callbacks
+   uint32_t maxCallbackTime;    ///<Longest time spent in these callbacks by a request
+   uint32_t responseTimeHistogram[HTTP_SERVER_STATS_HISTOGRAM_SIZE]; ///<Response time histogram
+} HttpServerStats;
+
+
+/**
+ * @brief Performance metrics of the request being served
+ **/
+
+typedef struct
+{
+   time_t startTime;       ///<Time at which the Request-Line was received
+   uint32_t headerTime;    ///<Time spent receiving and parsing the header
+   bool_t firstByteSent;   ///<The first byte of the response has been sent
+   uint32_t firstByteTime; ///<Time to first byte
+   time_t scriptStart;     ///<Time at which the SSI script was last resumed
+   uint32_t scriptTime;    ///<Time spent executing SSI scripts
+   uint_t scriptCount;     ///<Number of invocations of the SSI interpreter
+   time_t callbackStart;   ///<Time at which a callback was last invoked
+   uint32_t callbackTime;  ///<Time spent in callbacks
+   uint_t callbackCount;   ///<Number of callback invocations
+   uint32_t bytesSent;     ///<Bytes sent and not yet accounted for
+} HttpRequestMetrics;
+
+
+/**
+ * @brief Statistic exposed through the built-in URI
+ **/
+
+typedef struct
+{
+   const char_t *name; ///<Name of the statistic
+   size_t offset;      ///<Offset of the counter in the HttpServerStats structure
+} HttpStatsField;
+
+
+//Performance metrics related macros
+#if (HTTP_SERVER_STATS_SUPPORT == ENABLED)
+   #define HTTP_STATS_START(connection, phase) \
+      (connection)->metrics.phase##Start = osGetTickCount()
+   #define HTTP_STATS_STOP(connection, phase) \
+      (connection)->metrics.phase##Time += osGetTickCount() - (connection)->metrics.phase##Start, \
+      (connection)->metrics.phase##Count++
+#else
+   #define HTTP_STATS_START(connection, phase)
+   #define HTTP_STATS_STOP(connection, phase)
+#endif
+
+
+/**
+ * @brief Entry of the route table
+ **/
+
+typedef struct
+{
+   uint32_t hash;          ///<Hash value of the path
+   const HttpRoute *route; ///<Route (NULL if the entry is free)
+} HttpRouteEntry;
+
+
 /**
  * @brief HTTP status code
  **/
@@ -224,10 +527,22 @@ typedef struct
    char_t queryString[HTTP_SERVER_QUERY_STRING_MAX_LEN + 1]; ///<Query string
    bool_t keepAlive;
    bool_t chunkedEncoding;
+   bool_t acceptGzipEncoding;
+   char_t ifNoneMatch[HTTP_SERVER_IF_NONE_MATCH_MAX_LEN + 1];
+   char_t ifRange[16];
+   bool_t byteRange;
+   bool_t rangeSuffix;
+   size_t rangeFirst;
+   size_t rangeLast;
    size_t contentLength;
    size_t byteCount;
    bool_t firstChunk;
    bool_t lastChunk;
+#if (HTTP_SERVER_WEB_SOCKET_SUPPORT == ENABLED)
+   bool_t upgradeWebSocket;
+   char_t webSocketKey[25];
+   uint_t webSocketVersion;
+#endif
 } HttpRequest;
 
 
@@ -242,6 +557,12 @@ typedef struct
    bool_t keepAlive;
    bool_t noCache;
    const char_t *contentType;
+   const char_t *contentEncoding;
+   char_t etag[16];
+   bool_t acceptRanges;
+   size_t rangeFirst;
+   size_t rangeLast;
+   size_t resourceLength;
    bool_t chunkedEncoding;
    size_t contentLength;
    size_t byteCount;
@@ -261,21 +582,96 @@ typedef struct
    char_t defaultDocument[HTTP_SERVER_DEFAULT_DOC_MAX_LEN + 1]; ///<Default home page
    CgiCallback cgiCallback;                                     ///<CGI callback function
    UriNotFoundCallback uriNotFoundCallback;                     ///<URI not found callback function
+   const HttpRoute *routes;                                     ///<Routes registered by the application
+   uint_t routeCount;                                           ///<Number of routes
+#if (HTTP_SERVER_STATS_SUPPORT == ENABLED)
+   const char_t *statsUri;                                      ///<URI serving the statistics (optional)
+#endif
+#if (NET_CAPTURE_SUPPORT == ENABLED)
+   const char_t *captureUri;                                    ///<URI serving the packet capture (optional)
+#endif
+#if (HTTP_SERVER_WEB_SOCKET_SUPPORT == ENABLED)
+   WebSocketCallback webSocketCallback;                         ///<WebSocket callback function (optional)
+#endif
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+   bool_t useTls;                                               ///<Use SSL/TLS (HTTPS)
+   const PrngAlgo *prngAlgo;                                    ///<Pseudo-random number generator
+   void *prngContext;                                           ///<Pseudo-random number generator context
+   const char_t *certChain;                                     ///<Server certificate chain (PEM format)
+   size_t certChainLength;                                      ///<Length of the certificate chain
+   const char_t *privateKey;                                    ///<Private key (PEM format)
+   size_t privateKeyLength;                                     ///<Length of the private key
+   TlsCache *tlsCache;                                          ///<Session cache (NULL to let the server create one)
+   TlsTicketContext *tlsTicketContext;                          ///<Session ticket keys (NULL to let the server create them)
+   HttpTlsInitCallback tlsInitCallback;                         ///<Additional TLS configuration (optional)
+#endif
 } HttpServerSettings;
 
 
 /**
- * @brief HTTP server context
+ * @brief Worker task (event-driven mode)
+ *
+ * A worker services the connections whose index in the connection
+ * table is congruent to its own index modulo HTTP_SERVER_WORKER_COUNT
+ *
  **/
 
 typedef struct
+{
+   struct _HttpServerContext *context;                     ///<HTTP server context
+   uint_t index;                                           ///<Index of the worker
+   OsEvent *event;                                         ///<Event signaled when a connection is attached
+   SocketEventDesc eventDesc[HTTP_SERVER_MAX_CONNECTIONS]; ///<Sockets being monitored
+} HttpServerWorker;
+
+
+/**
+ * @brief HTTP server context
+ **/
+
+typedef struct _HttpServerContext
 {
    HttpServerSettings settings;  ///<User settings
    OsSemaphore *semaphore;       ///<Semaphore limiting the number of connections
    Socket *socket;               ///<Listening socket
+   HttpRouteEntry routeTable[HTTP_SERVER_ROUTE_TABLE_SIZE]; ///<Routes indexed by hash value
+   uint_t routeCount;                                       ///<Number of routes in the table
+#if (HTTP_SERVER_STATS_SUPPORT == ENABLED)
+   HttpRoute statsRoute;         ///<Built-in route serving the statistics
+   OsMutex *statsMutex;          ///<Mutex protecting the statistics
+   time_t statsStartTime;        ///<Time at which the statistics were reset
+   HttpServerStats stats;        ///<Statistics
+#endif
+#if (NET_CAPTURE_SUPPORT == ENABLED)
+   HttpRoute captureRoute;       ///<Built-in route serving the packet capture
+#endif
+#if (HTTP_SERVER_WEB_SOCKET_SUPPORT == ENABLED)
+   OsMutex *webSocketMutex;                                 ///<Mutex protecting the WebSocket table
+   HttpConnection *webSockets[HTTP_SERVER_MAX_CONNECTIONS]; ///<Open WebSocket connections
+#endif
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+   TlsCache *tlsCache;                 ///<Session cache shared by the connections
+   TlsTicketContext *tlsTicketContext; ///<Session ticket keys shared by the connections
+#endif
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+   HttpConnection *connections[HTTP_SERVER_MAX_CONNECTIONS]; ///<Active connections
+   HttpServerWorker worker[HTTP_SERVER_WORKER_COUNT];        ///<Worker tasks
+#endif
 } HttpServerContext;
 
 
+/**
+ * @brief SSI script being executed (event-driven mode)
+ **/
+
+typedef struct
+{
+   char_t *uri;               ///<Path to the script (NULL for the requested URI)
+   struct _SsiScript *script; ///<Compiled script
+   uint_t index;              ///<Next operation to execute
+} SsiFrame;
+
+
 /**
  * @brief HTTP connection
  *
@@ -287,12 +683,48 @@ typedef struct
 typedef struct _HttpConnection
 {
    HttpServerSettings *settings;                       ///<HTTP server settings
+   HttpServerContext *context;                         ///<HTTP server context
    OsSemaphore *semaphore;                             ///<Semaphore limiting the number of connections
    Socket *socket;                                     ///<Socket
+#if (HTTP_SERVER_TLS_SUPPORT == ENABLED)
+   TlsContext *tlsContext;                             ///<TLS context (NULL for plain HTTP)
+#endif
+#if (HTTP_SERVER_WEB_SOCKET_SUPPORT == ENABLED)
+   OsMutex *webSocketMutex;                            ///<Mutex serializing the outgoing frames
+#endif
+#if (HTTP_SERVER_HTTP2_SUPPORT == ENABLED)
+   struct _Http2Context *http2;                        ///<HTTP/2 connection state (NULL for HTTP/1.x)
+#endif
    HttpRequest request;                                ///<Incoming HTTP request header
    HttpResponse response;                              ///<HTTP response header
+#if (HTTP_SERVER_STATS_SUPPORT == ENABLED)
+   HttpRequestMetrics metrics;                         ///<Performance metrics of the current request
+#endif
    char_t cgiParam[HTTP_SERVER_CGI_PARAM_MAX_LEN + 1]; ///<CGI parameter
    char_t buffer[HTTP_SERVER_BUFFER_SIZE];             ///<Memory buffer for input/output operations
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+   HttpConnectionState state;                          ///<Connection state
+   time_t timestamp;                                   ///<Time of the last activity
+   uint_t requestCount;                                ///<Number of requests received so far
+   bool_t persistent;                                  ///<The connection is kept open after the response
+   size_t lineLength;                                  ///<Length of the line being received
+   HttpRequestCallback callback;                       ///<Callback being executed
+   uint_t callbackState;                               ///<Progress of a resumable callback
+   uint32_t callbackParam;                             ///<Additional state of a resumable callback
+#if (HTTP_SERVER_SSI_SUPPORT == ENABLED)
+   uint_t ssiDepth;                                    ///<Number of nested scripts
+   SsiFrame ssiFrame[HTTP_SERVER_SSI_MAX_RECURSION];   ///<Scripts being executed
+#endif
+#endif
+   size_t rxOffset;                                    ///<Offset of the first unread byte
+   size_t rxLength;                                    ///<Number of bytes in the input buffer
+   uint8_t rxBuffer[HTTP_SERVER_RX_BUFFER_SIZE];       ///<Input buffer
+   size_t txOffset;                                    ///<Offset of the first byte to send
+   size_t txLength;                                    ///<Number of bytes in the output buffer
+   const uint8_t *txFileData;                          ///<Immutable data queued behind the output buffer
+   size_t txFileLength;                                ///<Length of the immutable data
+   bool_t txFileCrlf;                                  ///<A CRLF follows the immutable data
+   char_t txBuffer[HTTP_SERVER_TX_BUFFER_SIZE];        ///<Output buffer
 } HttpConnection;
 
 
@@ -302,15 +734,72 @@ error_t httpServerStart(HttpServerContext *context, const HttpServerSettings *se
 void httpListenerTask(void *param);
 void httpConnectionTask(void *param);
 
+error_t httpInitTls(HttpServerContext *context);
+void httpFreeTls(HttpServerContext *context);
+error_t httpOpenTlsSession(HttpConnection *connection);
+
+error_t httpInitRouteTable(HttpServerContext *context);
+error_t httpAddRoute(HttpServerContext *context, const HttpRoute *route);
+const HttpRoute *httpFindRoute(HttpServerContext *context, const char_t *uri);
+const HttpRoute *httpLookupRoute(HttpServerContext *context,
+   const char_t *path, size_t length, uint32_t hash, uint_t flags);
+
+error_t httpProcessRequest(HttpConnection *connection);
+bool_t httpTerminateRequest(HttpConnection *connection, error_t error);
+
+error_t httpAttachConnection(HttpServerContext *context, HttpConnection *connection);
+void httpWorkerTask(void *param);
+uint_t httpGetEventMask(HttpConnection *connection);
+error_t httpResumeConnection(HttpConnection *connection);
+void httpCloseConnection(HttpServerContext *context, uint_t index);
+
 error_t httpReadHeader(HttpConnection *connection);
+error_t httpReceiveHeader(HttpConnection *connection);
+error_t httpParseRequestLine(HttpConnection *connection, char_t *line);
+void httpParseHeaderField(HttpConnection *connection, char_t *line);
+void httpParseAcceptEncoding(HttpConnection *connection, char_t *value);
+void httpParseRange(HttpConnection *connection, char_t *value);
+void httpInitRequestBody(HttpConnection *connection);
 error_t httpWriteHeader(HttpConnection *connection);
 
 error_t httpReadStream(HttpConnection *connection, void *data, size_t size, size_t *received, uint_t flags);
 error_t httpWriteStream(HttpConnection *connection, const void *data, size_t length);
+error_t httpWriteResource(HttpConnection *connection, const void *data, size_t length);
+error_t httpWriteData(HttpConnection *connection, const void *data, size_t length, uint_t flags);
 error_t httpReadChunkSize(HttpConnection *connection);
 error_t httpCloseStream(HttpConnection *connection);
 
+error_t httpReceive(HttpConnection *connection, void *data, size_t size, size_t *received, uint_t flags);
+error_t httpReceiveData(HttpConnection *connection, void *data, size_t size, size_t *received, uint_t flags);
+error_t httpSend(HttpConnection *connection, const void *data, size_t length, uint_t flags);
+error_t httpReserveStream(HttpConnection *connection, size_t length);
+error_t httpFlushStream(HttpConnection *connection);
+
+error_t httpGetStats(HttpServerContext *context, HttpServerStats *stats);
+void httpResetStats(HttpServerContext *context);
+error_t httpSendStats(HttpConnection *connection);
+size_t httpFormatStats(const HttpServerStats *stats, uint_t index, char_t *buffer);
+
+error_t httpSendCapture(HttpConnection *connection);
+
+void httpStatsOpenConnection(HttpConnection *connection);
+void httpStatsRefuseConnection(HttpServerContext *context);
+void httpStatsCloseConnection(HttpConnection *connection);
+void httpStatsStartRequest(HttpConnection *connection);
+void httpStatsCompleteRequest(HttpConnection *connection);
+
+error_t httpSocketSend(HttpConnection *connection, const void *data,
+   size_t length, size_t *written, uint_t flags);
+error_t httpSocketReceive(HttpConnection *connection, void *data,
+   size_t size, size_t *received, uint_t flags);
+
 error_t httpSendResponse(HttpConnection *connection);
+#if (RES_EXTERNAL_SUPPORT == ENABLED)
+error_t httpSendResourceFile(HttpConnection *connection,
+   const DirEntry *dirEntry, uint32_t offset, size_t length);
+#endif
+bool_t httpCheckEntityTag(HttpConnection *connection);
+error_t httpResolveRange(HttpConnection *connection, size_t length);
 error_t httpSendErrorResponse(HttpConnection *connection, uint_t statusCode, const char_t *message);
 
 void httpGetAbsolutePath(HttpConnection *connection, const char_t *relative, char_t *absolute);
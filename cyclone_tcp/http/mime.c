@@ -34,60 +34,56 @@
 #include "mime.h"
 #include "debug.h"
 
-//MIME type list
+//MIME type list, sorted by extension (the list is searched by bisection)
 static const MimeType mimeTypeList[] =
 {
-   //Text MIME types
+   {".aac",   "audio/x-aac"},
+   {".aif",   "audio/x-aiff"},
+   {".avi",   "video/x-msvideo"},
    {".css",   "text/css"},
    {".csv",   "text/csv"},
+   {".doc",   "application/msword"},
+   {".flv",   "video/x-flv"},
+   {".gif",   "image/gif"},
+   {".gz",    "application/x-gzip"},
+   {".gzip",  "application/x-gzip"},
    {".htc",   "text/x-component"},
    {".htm",   "text/html"},
    {".html",  "text/html"},
-   {".shtm",  "text/html"},
-   {".shtml", "text/html"},
-   {".stm",   "text/html"},
-   {".txt",   "text/plain"},
-   {".vcf",   "text/vcard"},
-   {".vcard", "text/vcard"},
-   {".xml",   "text/xml"},
-   //Image MIME types
-   {".gif",   "image/gif"},
    {".ico",   "image/x-icon"},
-   {".jpg",   "image/jpeg"},
    {".jpeg",  "image/jpeg"},
-   {".png",   "image/png"},
-   {".svg",   "image/svg+xml"},
-   {".tif",   "image/tiff"},
-   //Audio MIME types
-   {".aac",   "audio/x-aac"},
-   {".aif",   "audio/x-aiff"},
-   {".mp3",   "audio/mpeg"},
-   {".wav",   "audio/x-wav"},
-   {".wma",   "audio/x-ms-wma"},
-   //Video MIME types
-   {".avi",   "video/x-msvideo"},
-   {".flv",   "video/x-flv"},
+   {".jpg",   "image/jpeg"},
+   {".js",    "application/javascript"},
+   {".json",  "application/json"},
    {".mov",   "video/quicktime"},
+   {".mp3",   "audio/mpeg"},
    {".mp4",   "video/mp4"},
-   {".mpg",   "video/mpeg"},
    {".mpeg",  "video/mpeg"},
-   {".wmv",   "video/x-ms-wmv"},
-   //Application MIME types
-   {".doc",   "application/msword"},
-   {".gz",    "application/x-gzip"},
-   {".gzip",  "application/x-gzip"},
-   {".js",    "application/javascript"},
-   {".json",  "application/json"},
+   {".mpg",   "video/mpeg"},
    {".ogg",   "application/ogg"},
+   {".pcap",  "application/vnd.tcpdump.pcap"},
    {".pdf",   "application/pdf"},
+   {".png",   "image/png"},
    {".ppt",   "application/vnd.ms-powerpoint"},
    {".rar",   "application/x-rar-compressed"},
    {".rtf",   "application/rtf"},
+   {".shtm",  "text/html"},
+   {".shtml", "text/html"},
+   {".stm",   "text/html"},
+   {".svg",   "image/svg+xml"},
    {".tar",   "application/x-tar"},
    {".tgz",   "application/x-gzip"},
+   {".tif",   "image/tiff"},
+   {".txt",   "text/plain"},
+   {".vcard", "text/vcard"},
+   {".vcf",   "text/vcard"},
+   {".wav",   "audio/x-wav"},
+   {".wma",   "audio/x-ms-wma"},
+   {".wmv",   "video/x-ms-wmv"},
    {".xht",   "application/xhtml+xml"},
    {".xhtml", "application/xhtml+xml"},
    {".xls",   "application/vnd.ms-excel"},
+   {".xml",   "text/xml"},
    {".zip",   "application/zip"}
 };
 
@@ -103,24 +99,37 @@ static const MimeType mimeTypeList[] =
 
 const char_t *mimeGetType(const char_t *filename)
 {
+   int_t res;
    uint_t i;
-   uint_t n;
-   uint_t m;
+   uint_t low;
+   uint_t high;
+   const char_t *extension;
 
    //MIME type for unknown extensions
    static const char_t defaultMimeType[] = "application/octet-stream";
 
-   //Get the length of the specified filename
-   n = strlen(filename);
+   //Locate the extension of the filename
+   extension = strrchr(filename, '.');
 
-   //Search the MIME type that matches the specified extension
-   for(i = 0; i < arraysize(mimeTypeList); i++)
+   //The extension must not belong to a directory name
+   if(extension != NULL && strchr(extension, '/') == NULL)
    {
-      //Length of the extension
-      m = strlen(mimeTypeList[i].extension);
-      //Compare file extensions
-      if(m <= n && !strcasecmp(filename + n - m, mimeTypeList[i].extension))
-         return mimeTypeList[i].type;
+      //Search the MIME type that matches the extension
+      for(low = 0, high = arraysize(mimeTypeList); low < high; )
+      {
+         //Compare the extension with the middle entry
+         i = (low + high) / 2;
+         res = strcasecmp(extension, mimeTypeList[i].extension);
+
+         //Matching extension?
+         if(!res)
+            return mimeTypeList[i].type;
+         //Search the relevant half of the list
+         else if(res < 0)
+            high = i;
+         else
+            low = i + 1;
+      }
    }
 
    //Return the default MIME type when an unknown extension is encountered
@@ -43,6 +43,45 @@
 #include "str.h"
 #include "debug.h"
 
+//Check TCP/IP stack configuration
+#if (HTTP_SERVER_SSI_SUPPORT == ENABLED)
+
+#if (HTTP_SERVER_SSI_CACHE_SUPPORT == ENABLED)
+
+//Mutex preventing simultaneous access to the script cache
+static OsMutex *ssiCacheMutex = OS_INVALID_HANDLE;
+//Compiled scripts
+static SsiScript *ssiCache[HTTP_SERVER_SSI_CACHE_SIZE];
+
+#endif
+
+
+/**
+ * @brief SSI module initialization
+ * @return Error code
+ **/
+
+error_t ssiInit(void)
+{
+#if (HTTP_SERVER_SSI_CACHE_SUPPORT == ENABLED)
+   //The cache is shared by all the HTTP server instances
+   if(ssiCacheMutex == OS_INVALID_HANDLE)
+   {
+      //Create a mutex to protect the script cache
+      ssiCacheMutex = osMutexCreate(FALSE);
+      //Any error to report?
+      if(ssiCacheMutex == OS_INVALID_HANDLE)
+         return ERROR_OUT_OF_RESOURCES;
+
+      //The cache is initially empty
+      memset(ssiCache, 0, sizeof(ssiCache));
+   }
+#endif
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
 
 /**
  * @brief Execute SSI script
@@ -55,10 +94,10 @@
 error_t ssiExecuteScript(HttpConnection *connection, const char_t *uri, uint_t level)
 {
    error_t error;
-   int_t i;
-   int_t j;
+   uint_t i;
    size_t length;
    char_t *data;
+   SsiScript *script;
 
    //Recursion exceeded?
    if(level >= HTTP_SERVER_SSI_MAX_RECURSION)
@@ -72,155 +111,553 @@ error_t ssiExecuteScript(HttpConnection *connection, const char_t *uri, uint_t l
    //The specified URI cannot be found?
    if(error) return error;
 
+   //Retrieve the compiled form of the script
+   script = ssiLoadScript(data, length);
+   //Failed to compile the script?
+   if(!script) return ERROR_OUT_OF_MEMORY;
+
    //Send the HTTP response header before executing the script
    if(!level)
+      error = ssiWriteHeader(connection);
+
+   //Execute the script
+   for(i = 0; i < script->opCount && !error; i++)
    {
-      //Format HTTP response header
-      connection->response.version = connection->request.version;
-      connection->response.statusCode = 200;
-      connection->response.keepAlive = connection->request.keepAlive;
-      connection->response.noCache = FALSE;
-      connection->response.contentType = mimeGetType(connection->request.uri);
-      connection->response.chunkedEncoding = TRUE;
-
-      //Send the header to the client
-      error = httpWriteHeader(connection);
-      //Any error to report?
-      if(error) return error;
+      //Emit the current literal span or execute the current command
+      error = ssiProcessCommand(connection, &script->op[i], uri, level);
    }
 
-   //Parse the specified file
-   while(length > 0)
+   //Release the script
+   ssiReleaseScript(script);
+
+   //Properly close output stream
+   if(!error && !level)
+      error = httpCloseStream(connection);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send the HTTP response header of an SSI script
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t ssiWriteHeader(HttpConnection *connection)
+{
+   //Format HTTP response header
+   connection->response.version = connection->request.version;
+   connection->response.statusCode = 200;
+   connection->response.keepAlive = connection->request.keepAlive;
+   connection->response.noCache = FALSE;
+   connection->response.contentType = mimeGetType(connection->request.uri);
+   connection->response.contentEncoding = NULL;
+   connection->response.etag[0] = '\0';
+   connection->response.acceptRanges = FALSE;
+   connection->response.chunkedEncoding = TRUE;
+
+   //Send the header to the client
+   return httpWriteHeader(connection);
+}
+
+
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+
+/**
+ * @brief Start the execution of the requested SSI script (event-driven mode)
+ *
+ * The script is executed one operation at a time, an operation being either
+ * a literal span or a command. An operation whose output cannot be queued
+ * yet returns ERROR_WOULD_BLOCK and is executed again once the connection is
+ * writable, while the output of consecutive operations is coalesced. Nested
+ * scripts are kept on a stack instead of being executed recursively
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return ERROR_WOULD_BLOCK if the script is not complete yet, else error code
+ **/
+
+error_t ssiStartScript(HttpConnection *connection)
+{
+   error_t error;
+
+   //No script is being executed
+   connection->ssiDepth = 0;
+
+   //Load the requested script
+   error = ssiPushScript(connection, NULL);
+   //The specified URI cannot be found?
+   if(error) return error;
+
+   //Send the HTTP response header before executing the script
+   error = ssiWriteHeader(connection);
+   //Any error to report?
+   if(error) return error;
+
+   //Execute the script
+   return ssiResumeScript(connection);
+}
+
+
+/**
+ * @brief Resume the execution of an SSI script (event-driven mode)
+ * @param[in] connection Structure representing an HTTP connection
+ * @return ERROR_WOULD_BLOCK if the script is not complete yet, else error code
+ **/
+
+error_t ssiResumeScript(HttpConnection *connection)
+{
+   error_t error;
+   uint_t level;
+   SsiFrame *frame;
+
+   //Execute the scripts until the output buffer fills up
+   while(connection->ssiDepth > 0)
    {
-      //Search for any SSI tags
-      i = ssiSearchTag(data, length, "<!--#", 5);
+      //Point to the innermost script
+      level = connection->ssiDepth - 1;
+      frame = &connection->ssiFrame[level];
 
-      //Opening identifier found?
-      if(i >= 0)
+      //End of script?
+      if(frame->index >= frame->script->opCount)
       {
-         //Search for the comment terminator
-         j = ssiSearchTag(data + i + 5, length - i - 5, "-->", 3);
-      }
-      else
-      {
-         j = -1;
+         //Release the path to the script
+         if(frame->uri != NULL)
+            osMemFree(frame->uri);
+
+         //Release the script
+         ssiReleaseScript(frame->script);
+
+         //Return to the including script
+         connection->ssiDepth--;
+         continue;
       }
 
-      //Check whether a valid SSI tag has been found?
-      if(i > 0 && j > 0)
-      {
-         //Send the part of the file that precedes the tag
-         error = httpWriteStream(connection, data, i);
-         //Failed to send data?
-         if(error) return error;
+      //Emit the current literal span or execute the current command. The
+      //frame pointer remains valid when a nested script is pushed onto the
+      //stack
+      error = ssiProcessCommand(connection, &frame->script->op[frame->index],
+         (frame->uri != NULL) ? frame->uri : connection->request.uri, level);
 
-         //Advance data pointer over the opening identifier
-         data += i + 5;
-         length -= i + 5;
+      //The operation has to be resumed later, or an error occurred?
+      if(error) return error;
 
-         //Include command found?
-         if(j > 7 && !strncasecmp(data, "include", 7))
-         {
-            //Process SSI include directive
-            error = ssiProcessIncludeCommand(connection, data, j, uri, level);
-         }
-         //Echo command found?
-         else if(j > 4 && !strncasecmp(data, "echo", 4))
-         {
-            //Process SSI echo directive
-            error = ssiProcessEchoCommand(connection, data, j);
-         }
-         //Exec command found?
-         else if(j > 4 && !strncasecmp(data, "exec", 4))
-         {
-            //Process SSI exec directive
-            error = ssiProcessExecCommand(connection, data, j);
-         }
-         //Unknown command?
-         else
-         {
-            //The server is unable to decode the SSI tag
-            error = ERROR_INVALID_TAG;
-         }
+      //Move to the next operation
+      frame->index++;
+      //The next command starts from a clean state
+      connection->callbackState = 0;
+   }
 
-         //Check whether the tag was successfully decoded or not
-         if(error == ERROR_INVALID_TAG)
-         {
-            //Report a warning to the user
-            error = httpWriteStream(connection, "Warning: Invalid SSI Tag", 24);
-            //Failed to send data?
-            if(error) return error;
-         }
-         //Any other error to report?
-         else if(error)
-         {
-            //Exit immediately
-            return error;
-         }
+   //Properly close output stream
+   return httpCloseStream(connection);
+}
+
+
+/**
+ * @brief Push an SSI script onto the stack (event-driven mode)
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] uri NULL terminated string containing the file to process
+ *   (NULL for the requested URI)
+ * @return Error code
+ **/
+
+error_t ssiPushScript(HttpConnection *connection, const char_t *uri)
+{
+   error_t error;
+   size_t length;
+   char_t *data;
+   SsiFrame *frame;
+
+   //Recursion exceeded?
+   if(connection->ssiDepth >= HTTP_SERVER_SSI_MAX_RECURSION)
+      return NO_ERROR;
+
+   //Get absolute path to the specified URI
+   httpGetAbsolutePath(connection, (uri != NULL) ? uri :
+      connection->request.uri, connection->buffer);
+
+   //Get the resource data associated with the URI
+   error = resGetData(connection->buffer, (uint8_t **) &data, &length);
+   //The specified URI cannot be found?
+   if(error) return error;
 
-         //Advance data pointer over the SSI tag
-         data += j + 3;
-         length -= j + 3;
+   //Point to the next free entry
+   frame = &connection->ssiFrame[connection->ssiDepth];
+
+   //Relative includes are resolved against the path of the script
+   if(uri != NULL)
+   {
+      //Save the path to the script
+      frame->uri = strDuplicate(uri);
+      //Failed to duplicate the string?
+      if(!frame->uri) return ERROR_OUT_OF_MEMORY;
+   }
+   else
+   {
+      //The path is the requested URI
+      frame->uri = NULL;
+   }
+
+   //Retrieve the compiled form of the script
+   frame->script = ssiLoadScript(data, length);
+
+   //Failed to compile the script?
+   if(!frame->script)
+   {
+      //Clean up side effects
+      if(frame->uri != NULL)
+         osMemFree(frame->uri);
+
+      //Report an error
+      return ERROR_OUT_OF_MEMORY;
+   }
+
+   //Start at the beginning of the script
+   frame->index = 0;
+
+   //One more script on the stack
+   connection->ssiDepth++;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release the SSI scripts being executed (event-driven mode)
+ * @param[in] connection Structure representing an HTTP connection
+ **/
+
+void ssiAbortScript(HttpConnection *connection)
+{
+   SsiFrame *frame;
+
+   //Loop through the stack
+   while(connection->ssiDepth > 0)
+   {
+      //Pop the innermost script
+      connection->ssiDepth--;
+      frame = &connection->ssiFrame[connection->ssiDepth];
+
+      //Release the path to the script
+      if(frame->uri != NULL)
+         osMemFree(frame->uri);
+
+      //Release the script
+      ssiReleaseScript(frame->script);
+   }
+}
+
+#endif
+
+
+/**
+ * @brief Get the compiled form of an SSI script
+ *
+ * Resources are immutable, so a script is compiled the first time it is
+ * used and kept in the cache, as long as a free entry is available
+ *
+ * @param[in] data Pointer to the script
+ * @param[in] length Length of the script
+ * @return Compiled script (NULL if memory could not be allocated)
+ **/
+
+SsiScript *ssiLoadScript(const char_t *data, size_t length)
+{
+#if (HTTP_SERVER_SSI_CACHE_SUPPORT == ENABLED)
+   uint_t i;
+   SsiScript *script;
+
+   //Acquire exclusive access to the cache
+   osMutexAcquire(ssiCacheMutex);
+
+   //The script may have already been compiled
+   for(script = NULL, i = 0; i < HTTP_SERVER_SSI_CACHE_SIZE; i++)
+   {
+      //Compare resource data pointers
+      if(ssiCache[i] != NULL && ssiCache[i]->data == data)
+      {
+         script = ssiCache[i];
+         break;
       }
-      else
+   }
+
+   //Cache miss?
+   if(script == NULL)
+   {
+      //Compile the script
+      script = ssiCompileScript(data, length);
+
+      //Successful compilation?
+      if(script != NULL)
       {
-         //Send the rest of the file
-         error = httpWriteStream(connection, data, length);
-         //Failed to send data?
-         if(error) return error;
-         //Advance data pointer
-         data += length;
-         length = 0;
+         //Search for a free entry
+         for(i = 0; i < HTTP_SERVER_SSI_CACHE_SIZE; i++)
+         {
+            //Free entry found?
+            if(ssiCache[i] == NULL)
+            {
+               //Keep the script for subsequent requests
+               script->cached = TRUE;
+               ssiCache[i] = script;
+               break;
+            }
+         }
       }
    }
 
-   //Properly close output stream
-   if(!level)
-      error = httpCloseStream(connection);
+   //Release exclusive access to the cache
+   osMutexRelease(ssiCacheMutex);
 
-   //Return status code
-   return error;
+   //Return the compiled script
+   return script;
+#else
+   //Compile the script
+   return ssiCompileScript(data, length);
+#endif
 }
 
 
 /**
- * @brief Process SSI include directive
+ * @brief Release a compiled SSI script
+ * @param[in] script Compiled script returned by ssiLoadScript()
+ **/
+
+void ssiReleaseScript(SsiScript *script)
+{
+   //Scripts that belong to the cache are never released
+   if(!script->cached)
+      osMemFree(script);
+}
+
+
+/**
+ * @brief Compile an SSI script
  *
- * This include directive allows the content of one document to be included
- * in another. The file parameter defines the included file as relative to
- * the document path. The virtual parameter defines the included file as
- * relative to the document root
+ * The script is split into literal spans and commands whose attributes
+ * are parsed once and for all
  *
- * @param[in] connection Structure representing an HTTP connection
- * @param[in] tag Pointer to the SSI tag
- * @param[in] length Total length of the SSI tag
- * @param[in] uri NULL terminated string containing the file being processed
- * @param[in] level Current level of recursion
- * @return Error code
+ * @param[in] data Pointer to the script
+ * @param[in] length Length of the script
+ * @return Compiled script (NULL if memory could not be allocated)
  **/
 
-error_t ssiProcessIncludeCommand(HttpConnection *connection,
-   const char_t *tag, size_t length, const char_t *uri, uint_t level)
+SsiScript *ssiCompileScript(const char_t *data, size_t length)
+{
+   int_t i;
+   size_t j;
+   size_t n;
+   size_t size;
+   uint_t count;
+   const char_t *p;
+   char_t *q;
+   SsiOp *op;
+   SsiScript *script;
+
+   //Count the SSI tags and the room needed to store their contents
+   for(count = 0, size = 0, p = data, n = length; n > 0; count++)
+   {
+      //Search for the next valid SSI tag
+      i = ssiFindTag(p, n, &j);
+      //No more tags?
+      if(i < 0) break;
+
+      //Each tag is stored as a NULL-terminated string
+      size += j + 1;
+
+      //Advance data pointer over the SSI tag
+      p += i + j + 8;
+      n -= i + j + 8;
+   }
+
+   //Each tag may be preceded by a literal span, and one more literal span
+   //may follow the last tag
+   count = 2 * count + 1;
+
+   //Allocate a memory buffer to hold the compiled script
+   script = osMemAlloc(sizeof(SsiScript) + count * sizeof(SsiOp) + size);
+   //Failed to allocate memory?
+   if(!script) return NULL;
+
+   //Initialize the script
+   script->data = data;
+   script->cached = FALSE;
+   script->opCount = 0;
+
+   //The contents of the tags follow the operations
+   q = (char_t *) (script->op + count);
+
+   //Parse the script
+   for(p = data, n = length; n > 0; )
+   {
+      //Search for the next valid SSI tag
+      i = ssiFindTag(p, n, &j);
+
+      //Any literal text that precedes the tag?
+      if(i != 0)
+      {
+         //Add a literal span
+         op = &script->op[script->opCount++];
+         op->opcode = SSI_OP_TEXT;
+         op->flags = 0;
+         op->data = p;
+         op->length = (i > 0) ? (size_t) i : n;
+
+         //Advance data pointer
+         p += op->length;
+         n -= op->length;
+      }
+
+      //Valid tag found?
+      if(i >= 0)
+      {
+         //Copy the contents of the tag
+         memcpy(q, p + 5, j);
+         //Ensure the resulting string is NULL-terminated
+         q[j] = '\0';
+
+         //Parse the SSI command
+         op = &script->op[script->opCount++];
+         ssiParseCommand(op, q);
+
+         //Advance pointers over the SSI tag
+         q += j + 1;
+         p += j + 8;
+         n -= j + 8;
+      }
+   }
+
+   //Return the compiled script
+   return script;
+}
+
+
+/**
+ * @brief Parse an SSI command
+ * @param[out] op Resulting operation
+ * @param[in] tag NULL-terminated string containing the SSI tag, past the
+ *   opening identifier and without the comment terminator. The attribute
+ *   value is referenced by the operation, so the string must not be released
+ **/
+
+void ssiParseCommand(SsiOp *op, char_t *tag)
 {
    error_t error;
-   uint8_t *data;
-   char_t *separator;
    char_t *attribute;
    char_t *value;
-   char_t *path;
-   char_t *p;
 
-   //Discard invalid SSI directives
-   if(length < 7 || length >= HTTP_SERVER_BUFFER_SIZE)
-      return ERROR_INVALID_TAG;
+   //Unless decoded successfully, the tag is regarded as invalid
+   op->opcode = SSI_OP_INVALID;
+   op->flags = 0;
+   op->data = NULL;
+   op->length = 0;
 
-   //Skip the SSI include command (7 bytes)
-   memcpy(connection->buffer, tag + 7, length - 7);
-   //Ensure the resulting string is NULL-terminated
-   connection->buffer[length - 7] = '\0';
+   //Include command found?
+   if(!strncasecmp(tag, "include", 7))
+   {
+      //Get attribute name and value
+      error = ssiParseAttribute(tag + 7, &attribute, &value);
+      //Invalid attribute?
+      if(error) return;
+
+      //Check the length of the filename
+      if(strlen(value) > HTTP_SERVER_URI_MAX_LEN)
+         return;
+
+      //The file parameter defines the included file as relative to the document path
+      if(!strcasecmp(attribute, "file"))
+         op->flags |= SSI_FLAG_RELATIVE_PATH;
+      //The virtual parameter defines the included file as relative to the document root
+      else if(strcasecmp(attribute, "virtual"))
+         return;
+
+      //Use server-side scripting to dynamically generate HTML code?
+      if(httpCompExtension(value, ".stm") ||
+         httpCompExtension(value, ".shtm") ||
+         httpCompExtension(value, ".shtml"))
+      {
+         op->flags |= SSI_FLAG_SCRIPT;
+      }
+
+      //Save the path to the file
+      op->opcode = SSI_OP_INCLUDE;
+      op->data = value;
+   }
+   //Echo command found?
+   else if(!strncasecmp(tag, "echo", 4))
+   {
+      //Get attribute name and value
+      error = ssiParseAttribute(tag + 4, &attribute, &value);
+      //Invalid attribute?
+      if(error) return;
+
+      //Enforce attribute name
+      if(strcasecmp(attribute, "var"))
+         return;
+
+      //Resolve the name of the environment variable
+      if(!strcasecmp(value, "REMOTE_ADDR"))
+         op->length = SSI_VAR_REMOTE_ADDR;
+      else if(!strcasecmp(value, "REMOTE_PORT"))
+         op->length = SSI_VAR_REMOTE_PORT;
+      else if(!strcasecmp(value, "SERVER_ADDR"))
+         op->length = SSI_VAR_SERVER_ADDR;
+      else if(!strcasecmp(value, "SERVER_PORT"))
+         op->length = SSI_VAR_SERVER_PORT;
+      else if(!strcasecmp(value, "REQUEST_METHOD"))
+         op->length = SSI_VAR_REQUEST_METHOD;
+      else if(!strcasecmp(value, "DOCUMENT_URI"))
+         op->length = SSI_VAR_DOCUMENT_URI;
+      else if(!strcasecmp(value, "QUERY_STRING"))
+         op->length = SSI_VAR_QUERY_STRING;
+      else if(!strcasecmp(value, "DATE_GMT"))
+         op->length = SSI_VAR_DATE_GMT;
+      else if(!strcasecmp(value, "DATE_LOCAL"))
+         op->length = SSI_VAR_DATE_LOCAL;
+      else
+         return;
+
+      //The variable has been successfully resolved
+      op->opcode = SSI_OP_ECHO;
+   }
+   //Exec command found?
+   else if(!strncasecmp(tag, "exec", 4))
+   {
+      //Get attribute name and value
+      error = ssiParseAttribute(tag + 4, &attribute, &value);
+      //Invalid attribute?
+      if(error) return;
+
+      //Enforce attribute name
+      if(strcasecmp(attribute, "cmd") && strcasecmp(attribute, "cgi"))
+         return;
+      //Check the length of the CGI parameter
+      if(strlen(value) > HTTP_SERVER_CGI_PARAM_MAX_LEN)
+         return;
+
+      //Save the CGI parameter
+      op->opcode = SSI_OP_EXEC;
+      op->data = value;
+   }
+}
+
+
+/**
+ * @brief Parse the attribute of an SSI command
+ * @param[in] s NULL-terminated string of the form attribute="value"
+ * @param[out] attribute Attribute name
+ * @param[out] value Attribute value, without quotes
+ * @return Error code
+ **/
+
+error_t ssiParseAttribute(char_t *s, char_t **attribute, char_t **value)
+{
+   size_t length;
+   char_t *separator;
 
    //Check whether a separator is present
-   separator = strchr(connection->buffer, '=');
+   separator = strchr(s, '=');
    //Separator not found?
    if(!separator)
       return ERROR_INVALID_TAG;
@@ -229,68 +666,150 @@ error_t ssiProcessIncludeCommand(HttpConnection *connection,
    *separator = '\0';
 
    //Get attribute name and value
-   attribute = strTrimWhitespace(connection->buffer);
-   value = strTrimWhitespace(separator + 1);
+   *attribute = strTrimWhitespace(s);
+   *value = strTrimWhitespace(separator + 1);
 
    //Remove leading simple or double quote
-   if(value[0] == '\'' || value[0] == '\"')
-      value++;
+   if((*value)[0] == '\'' || (*value)[0] == '\"')
+      (*value)++;
 
    //Get the length of the attribute value
-   length = strlen(value);
+   length = strlen(*value);
 
    //Remove trailing simple or double quote
    if(length > 0)
    {
-      if(value[length - 1] == '\'' || value[length - 1] == '\"')
-         value[length - 1] = '\0';
+      if((*value)[length - 1] == '\'' || (*value)[length - 1] == '\"')
+         (*value)[length - 1] = '\0';
    }
 
-   //Check the length of the filename
-   if(strlen(value) > HTTP_SERVER_URI_MAX_LEN)
-      return ERROR_INVALID_TAG;
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Execute an operation of a compiled SSI script
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] op Literal span or command to execute
+ * @param[in] uri NULL terminated string containing the file being processed
+ * @param[in] level Current level of recursion
+ * @return Error code
+ **/
+
+error_t ssiProcessCommand(HttpConnection *connection,
+   const SsiOp *op, const char_t *uri, uint_t level)
+{
+   error_t error;
+
+   //Literal span?
+   if(op->opcode == SSI_OP_TEXT)
+   {
+      //Script contents are immutable
+      error = httpWriteResource(connection, op->data, op->length);
+   }
+   //Include command?
+   else if(op->opcode == SSI_OP_INCLUDE)
+   {
+      //Process SSI include directive
+      error = ssiProcessIncludeCommand(connection, op, uri, level);
+   }
+   //Echo command?
+   else if(op->opcode == SSI_OP_ECHO)
+   {
+      //Process SSI echo directive
+      error = ssiProcessEchoCommand(connection, op);
+   }
+   //Exec command?
+   else if(op->opcode == SSI_OP_EXEC)
+   {
+      //Process SSI exec directive
+      error = ssiProcessExecCommand(connection, op);
+   }
+   //Invalid tag?
+   else
+   {
+      //The server is unable to decode the SSI tag
+      error = ERROR_INVALID_TAG;
+   }
+
+   //Check whether the tag was successfully processed or not
+   if(error == ERROR_INVALID_TAG)
+   {
+      //Report a warning to the user
+      error = httpWriteStream(connection, "Warning: Invalid SSI Tag", 24);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Process SSI include directive
+ *
+ * This include directive allows the content of one document to be included
+ * in another. The file parameter defines the included file as relative to
+ * the document path. The virtual parameter defines the included file as
+ * relative to the document root
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] op Compiled SSI command
+ * @param[in] uri NULL terminated string containing the file being processed
+ * @param[in] level Current level of recursion
+ * @return Error code
+ **/
+
+error_t ssiProcessIncludeCommand(HttpConnection *connection,
+   const SsiOp *op, const char_t *uri, uint_t level)
+{
+   error_t error;
+   size_t length;
+   uint8_t *data;
+   const char_t *path;
+   char_t *buffer;
+   char_t *p;
 
    //The file parameter defines the included file as relative to the document path
-   if(!strcasecmp(attribute, "file"))
+   if(op->flags & SSI_FLAG_RELATIVE_PATH)
    {
       //Allocate a buffer to hold the path to the file to be included
-      path = osMemAlloc(strlen(uri) + strlen(value) + 1);
+      buffer = osMemAlloc(strlen(uri) + strlen(op->data) + 1);
       //Failed to allocate memory?
-      if(!path) return ERROR_OUT_OF_MEMORY;
+      if(!buffer) return ERROR_OUT_OF_MEMORY;
 
       //Copy the path identifying the script file being processed
-      strcpy(path, uri);
+      strcpy(buffer, uri);
       //Search for the last slash character
-      p = strrchr(path, '/');
+      p = strrchr(buffer, '/');
 
       //Remove the filename from the path if applicable
       if(p)
-         strcpy(p + 1, value);
+         strcpy(p + 1, op->data);
       else
-         strcpy(path, value);
+         strcpy(buffer, op->data);
+
+      //Point to the resulting path
+      path = buffer;
    }
    //The virtual parameter defines the included file as relative to the document root
-   else if(!strcasecmp(attribute, "virtual"))
-   {
-      //Copy the absolute path
-      path = strDuplicate(value);
-      //Failed to duplicate the string?
-      if(!path) return ERROR_OUT_OF_MEMORY;
-   }
-   //Unknown parameter...
    else
    {
-      //Report an error
-      return ERROR_INVALID_TAG;
+      //The path is used as is
+      buffer = NULL;
+      path = op->data;
    }
 
    //Use server-side scripting to dynamically generate HTML code?
-   if(httpCompExtension(value, ".stm") ||
-      httpCompExtension(value, ".shtm") ||
-      httpCompExtension(value, ".shtml"))
+   if(op->flags & SSI_FLAG_SCRIPT)
    {
+#if (HTTP_SERVER_EVENT_DRIVEN_SUPPORT == ENABLED)
+      //The included script is executed by ssiResumeScript()
+      error = ssiPushScript(connection, path);
+#else
       //SSI processing (Server Side Includes)
       error = ssiExecuteScript(connection, path, level + 1);
+#endif
    }
    else
    {
@@ -301,7 +820,7 @@ error_t ssiProcessIncludeCommand(HttpConnection *connection,
 
       //Send the contents of the requested file
       if(!error)
-         error = httpWriteStream(connection, data, length);
+         error = httpWriteResource(connection, data, length);
    }
 
    //Cannot found the specified resource?
@@ -309,7 +828,9 @@ error_t ssiProcessIncludeCommand(HttpConnection *connection,
       error = ERROR_INVALID_TAG;
 
    //Release previously allocated memory
-   osMemFree(path);
+   if(buffer != NULL)
+      osMemFree(buffer);
+
    //return status code
    return error;
 }
@@ -322,85 +843,39 @@ error_t ssiProcessIncludeCommand(HttpConnection *connection,
  * HTTP environment variable
  *
  * @param[in] connection Structure representing an HTTP connection
- * @param[in] tag Pointer to the SSI tag
- * @param[in] length Total length of the SSI tag
+ * @param[in] op Compiled SSI command
  * @return Error code
  **/
 
-error_t ssiProcessEchoCommand(HttpConnection *connection, const char_t *tag, size_t length)
+error_t ssiProcessEchoCommand(HttpConnection *connection, const SsiOp *op)
 {
-   error_t error;
-   char_t *separator;
-   char_t *attribute;
-   char_t *value;
-
-   //Discard invalid SSI directives
-   if(length < 4 || length >= HTTP_SERVER_BUFFER_SIZE)
-      return ERROR_INVALID_TAG;
-
-   //Skip the SSI echo command (4 bytes)
-   memcpy(connection->buffer, tag + 4, length - 4);
-   //Ensure the resulting string is NULL-terminated
-   connection->buffer[length - 4] = '\0';
-
-   //Check whether a separator is present
-   separator = strchr(connection->buffer, '=');
-   //Separator not found?
-   if(!separator)
-      return ERROR_INVALID_TAG;
-
-   //Split the tag
-   *separator = '\0';
-
-   //Get attribute name and value
-   attribute = strTrimWhitespace(connection->buffer);
-   value = strTrimWhitespace(separator + 1);
-
-   //Remove leading simple or double quote
-   if(value[0] == '\'' || value[0] == '\"')
-      value++;
-
-   //Get the length of the attribute value
-   length = strlen(value);
+   size_t length;
 
-   //Remove trailing simple or double quote
-   if(length > 0)
+   //Check the environment variable to display
+   switch(op->length)
    {
-      if(value[length - 1] == '\'' || value[length - 1] == '\"')
-         value[length - 1] = '\0';
-   }
-
-   //Enforce attribute name
-   if(strcasecmp(attribute, "var"))
-      return ERROR_INVALID_TAG;
-
    //Remote address?
-   if(!strcasecmp(value, "REMOTE_ADDR"))
-   {
+   case SSI_VAR_REMOTE_ADDR:
       //The IP address of the host making this request
       ipAddrToString(&connection->socket->remoteIpAddr, connection->buffer);
-   }
+      break;
    //Remote port?
-   else if(!strcasecmp(value, "REMOTE_PORT"))
-   {
+   case SSI_VAR_REMOTE_PORT:
       //The port number used by the remote host when making this request
       sprintf(connection->buffer, "%u", connection->socket->remotePort);
-   }
+      break;
    //Server address?
-   else if(!strcasecmp(value, "SERVER_ADDR"))
-   {
+   case SSI_VAR_SERVER_ADDR:
       //The IP address of the server for this URL
       ipAddrToString(&connection->socket->localIpAddr, connection->buffer);
-   }
+      break;
    //Server port?
-   else if(!strcasecmp(value, "SERVER_PORT"))
-   {
+   case SSI_VAR_SERVER_PORT:
       //The port number on this server to which this request was directed
       sprintf(connection->buffer, "%u", connection->socket->localPort);
-   }
+      break;
    //Request method?
-   else if(!strcasecmp(value, "REQUEST_METHOD"))
-   {
+   case SSI_VAR_REQUEST_METHOD:
       //The method used for this HTTP request
       if(connection->request.method == HTTP_METHOD_GET)
          strcpy(connection->buffer, "GET");
@@ -410,34 +885,29 @@ error_t ssiProcessEchoCommand(HttpConnection *connection, const char_t *tag, siz
          strcpy(connection->buffer, "POST");
       else
          connection->buffer[0] = '\0';
-   }
+      break;
    //Document URI?
-   else if(!strcasecmp(value, "DOCUMENT_URI"))
-   {
+   case SSI_VAR_DOCUMENT_URI:
       //The URI for this request relative to the root directory
       strcpy(connection->buffer, connection->request.uri);
-   }
+      break;
    //Query string?
-   else if(!strcasecmp(value, "QUERY_STRING"))
-   {
+   case SSI_VAR_QUERY_STRING:
       //The information following the "?" in the URL for this request
       strcpy(connection->buffer, connection->request.queryString);
-   }
+      break;
    //GMT time?
-   else if(!strcasecmp(value, "DATE_GMT"))
-   {
+   case SSI_VAR_DATE_GMT:
       //The current date and time in Greenwich Mean Time
       connection->buffer[0] = '\0';
-   }
+      break;
    //Local time?
-   else if(!strcasecmp(value, "DATE_LOCAL"))
-   {
+   case SSI_VAR_DATE_LOCAL:
       //The current date and time in the local timezone
       connection->buffer[0] = '\0';
-   }
+      break;
    //Unknown variable?
-   else
-   {
+   default:
       //Report an error
       return ERROR_INVALID_TAG;
    }
@@ -446,12 +916,7 @@ error_t ssiProcessEchoCommand(HttpConnection *connection, const char_t *tag, siz
    length = strlen(connection->buffer);
 
    //Send the contents of the specified environment variable
-   error = httpWriteStream(connection, connection->buffer, length);
-   //Failed to send data?
-   if(error) return error;
-
-   //Successful processing
-   return NO_ERROR;
+   return httpWriteStream(connection, connection->buffer, length);
 }
 
 
@@ -463,70 +928,63 @@ error_t ssiProcessEchoCommand(HttpConnection *connection, const char_t *tag, siz
  * cgi parameter specifies the path to a CGI script
  *
  * @param[in] connection Structure representing an HTTP connection
- * @param[in] tag Pointer to the SSI tag
- * @param[in] length Total length of the SSI tag
+ * @param[in] op Compiled SSI command
  * @return Error code
  **/
 
-error_t ssiProcessExecCommand(HttpConnection *connection, const char_t *tag, size_t length)
+error_t ssiProcessExecCommand(HttpConnection *connection, const SsiOp *op)
 {
-   char_t *separator;
-   char_t *attribute;
-   char_t *value;
+   error_t error;
 
    //First, check whether CGI is supported by the server
    if(connection->settings->cgiCallback == NULL)
       return ERROR_INVALID_TAG;
 
-   //Discard invalid SSI directives
-   if(length < 4 || length >= HTTP_SERVER_BUFFER_SIZE)
-      return ERROR_INVALID_TAG;
-
-   //Skip the SSI exec command (4 bytes)
-   memcpy(connection->buffer, tag + 4, length - 4);
-   //Ensure the resulting string is NULL-terminated
-   connection->buffer[length - 4] = '\0';
-
-   //Check whether a separator is present
-   separator = strchr(connection->buffer, '=');
-   //Separator not found?
-   if(!separator)
-      return ERROR_INVALID_TAG;
+   //The scratch buffer may be altered by the user-defined callback.
+   //So the CGI parameter must be copied prior to function invocation
+   strcpy(connection->cgiParam, op->data);
 
-   //Split the tag
-   *separator = '\0';
+   //Invoke user-defined callback. In event-driven mode, a callback can return
+   //ERROR_WOULD_BLOCK when httpWriteStream() does. It is then invoked again
+   //with the same parameter once the pending output has been sent, and can
+   //use connection->callbackState to keep track of its progress
+   HTTP_STATS_START(connection, callback);
+   error = connection->settings->cgiCallback(connection, connection->cgiParam);
+   HTTP_STATS_STOP(connection, callback);
 
-   //Get attribute name and value
-   attribute = strTrimWhitespace(connection->buffer);
-   value = strTrimWhitespace(separator + 1);
+   //Return status code
+   return error;
+}
 
-   //Remove leading simple or double quote
-   if(value[0] == '\'' || value[0] == '\"')
-      value++;
 
-   //Get the length of the attribute value
-   length = strlen(value);
+/**
+ * @brief Search a script for the next valid SSI tag
+ * @param[in] s Script to search
+ * @param[in] length Length of the script
+ * @param[out] tagLength Length of the tag contents, excluding the opening
+ *   identifier and the comment terminator
+ * @return Offset of the tag, or -1 if no valid tag follows
+ **/
 
-   //Remove trailing simple or double quote
-   if(length > 0)
-   {
-      if(value[length - 1] == '\'' || value[length - 1] == '\"')
-         value[length - 1] = '\0';
-   }
+int_t ssiFindTag(const char_t *s, size_t length, size_t *tagLength)
+{
+   int_t i;
+   int_t j;
 
-   //Enforce attribute name
-   if(strcasecmp(attribute, "cmd") && strcasecmp(attribute, "cgi"))
-      return ERROR_INVALID_TAG;
-   //Check the length of the CGI parameter
-   if(strlen(value) > HTTP_SERVER_CGI_PARAM_MAX_LEN)
-      return ERROR_INVALID_TAG;
+   //Search for any SSI tags
+   i = ssiSearchTag(s, length, "<!--#", 5);
+   //Opening identifier not found?
+   if(i < 0) return -1;
 
-   //The scratch buffer may be altered by the user-defined callback.
-   //So the CGI parameter must be copied prior to function invocation
-   strcpy(connection->cgiParam, value);
+   //Search for the comment terminator
+   j = ssiSearchTag(s + i + 5, length - i - 5, "-->", 3);
+   //Empty or unterminated tags are not valid
+   if(j <= 0) return -1;
 
-   //Invoke user-defined callback
-   return connection->settings->cgiCallback(connection, connection->cgiParam);
+   //Return the length of the tag contents
+   *tagLength = j;
+   //Return the offset of the tag
+   return i;
 }
 
 
@@ -542,24 +1000,8 @@ error_t ssiProcessExecCommand(HttpConnection *connection, const char_t *tag, siz
 
 int_t ssiSearchTag(const char_t *s, size_t sLen, const char_t *tag, size_t tagLen)
 {
-   size_t i;
-   size_t j;
-
-   //Loop through input string
-   for(i = 0; (i + tagLen) <= sLen; i++)
-   {
-      //Compare current substring with the given tag
-      for(j = 0; j < tagLen; j++)
-      {
-         if(s[i + j] != tag[j])
-            break;
-      }
-
-      //Check whether the tag has been found
-      if(j == tagLen)
-         return i;
-   }
-
-   //The tag does not appear in the string
-   return -1;
+   //Use the optimized substring search
+   return strSearch(s, sLen, tag, tagLen);
 }
+
+#endif
@@ -33,15 +33,102 @@
 #include "os.h"
 #include "http_server.h"
 
+/**
+ * @brief Operations of a compiled SSI script
+ **/
+
+typedef enum
+{
+   SSI_OP_TEXT    = 0, ///<Literal span
+   SSI_OP_INCLUDE = 1, ///<Include command
+   SSI_OP_ECHO    = 2, ///<Echo command
+   SSI_OP_EXEC    = 3, ///<Exec command
+   SSI_OP_INVALID = 4  ///<Tag that cannot be decoded
+} SsiOpcode;
+
+
+/**
+ * @brief Flags of SSI include commands
+ **/
+
+typedef enum
+{
+   SSI_FLAG_RELATIVE_PATH = 0x01, ///<Path relative to the current document
+   SSI_FLAG_SCRIPT        = 0x02  ///<The included file is an SSI script
+} SsiFlags;
+
+
+/**
+ * @brief Environment variables displayed by SSI echo commands
+ **/
+
+typedef enum
+{
+   SSI_VAR_REMOTE_ADDR    = 0,
+   SSI_VAR_REMOTE_PORT    = 1,
+   SSI_VAR_SERVER_ADDR    = 2,
+   SSI_VAR_SERVER_PORT    = 3,
+   SSI_VAR_REQUEST_METHOD = 4,
+   SSI_VAR_DOCUMENT_URI   = 5,
+   SSI_VAR_QUERY_STRING   = 6,
+   SSI_VAR_DATE_GMT       = 7,
+   SSI_VAR_DATE_LOCAL     = 8
+} SsiVariable;
+
+
+/**
+ * @brief Operation of a compiled SSI script
+ **/
+
+typedef struct
+{
+   uint_t opcode;      ///<Type of operation (see SsiOpcode)
+   uint_t flags;       ///<Include flags (see SsiFlags)
+   const char_t *data; ///<Literal span, path or CGI parameter
+   size_t length;      ///<Length of the literal span or environment variable
+} SsiOp;
+
+
+/**
+ * @brief Compiled SSI script
+ **/
+
+typedef struct _SsiScript
+{
+   const char_t *data; ///<Resource data the script was compiled from
+   bool_t cached;      ///<The script belongs to the cache
+   uint_t opCount;     ///<Number of operations
+   SsiOp op[];         ///<Operations, followed by the contents of the tags
+} SsiScript;
+
+
 //SSI related functions
+error_t ssiInit(void);
+
 error_t ssiExecuteScript(HttpConnection *connection, const char_t *uri, uint_t level);
+error_t ssiWriteHeader(HttpConnection *connection);
+
+error_t ssiStartScript(HttpConnection *connection);
+error_t ssiResumeScript(HttpConnection *connection);
+error_t ssiPushScript(HttpConnection *connection, const char_t *uri);
+void ssiAbortScript(HttpConnection *connection);
+
+SsiScript *ssiLoadScript(const char_t *data, size_t length);
+void ssiReleaseScript(SsiScript *script);
+SsiScript *ssiCompileScript(const char_t *data, size_t length);
+void ssiParseCommand(SsiOp *op, char_t *tag);
+error_t ssiParseAttribute(char_t *s, char_t **attribute, char_t **value);
+
+error_t ssiProcessCommand(HttpConnection *connection,
+   const SsiOp *op, const char_t *uri, uint_t level);
 
 error_t ssiProcessIncludeCommand(HttpConnection *connection,
-   const char_t *tag, size_t length, const char_t *uri, uint_t level);
+   const SsiOp *op, const char_t *uri, uint_t level);
 
-error_t ssiProcessEchoCommand(HttpConnection *connection, const char_t *tag, size_t length);
-error_t ssiProcessExecCommand(HttpConnection *connection, const char_t *tag, size_t length);
+error_t ssiProcessEchoCommand(HttpConnection *connection, const SsiOp *op);
+error_t ssiProcessExecCommand(HttpConnection *connection, const SsiOp *op);
 
+int_t ssiFindTag(const char_t *s, size_t length, size_t *tagLength);
 int_t ssiSearchTag(const char_t *s, size_t sLen, const char_t *tag, size_t tagLen);
 
 #endif
@@ -0,0 +1,704 @@
+/**
+ * @file web_socket.c
+ * @brief WebSocket protocol (RFC 6455)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * A WebSocket connection starts as an HTTP/1.1 request carrying an
+ * Upgrade header. Once the opening handshake is complete, the TCP
+ * connection carries full-duplex frames, so that the server can push
+ * updates to the client without being polled
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL HTTP_TRACE_LEVEL
+
+//Dependencies
+#include <string.h>
+#include "tcp_ip_stack.h"
+#include "http_server.h"
+#include "web_socket.h"
+#include "sha1.h"
+#include "base64.h"
+#include "debug.h"
+
+//Check TCP/IP stack configuration
+#if (HTTP_SERVER_WEB_SOCKET_SUPPORT == ENABLED)
+
+
+/**
+ * @brief WebSocket module initialization
+ * @param[in] context Pointer to the HTTP server context
+ * @return Error code
+ **/
+
+error_t webSocketInit(HttpServerContext *context)
+{
+   //Create a mutex to protect the table of open connections
+   context->webSocketMutex = osMutexCreate(FALSE);
+   //Any error to report?
+   if(context->webSocketMutex == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Successful initialization
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Serve a WebSocket connection
+ *
+ * The function completes the opening handshake and then processes
+ * the incoming frames until the session is closed. The connection
+ * cannot be reused for HTTP requests afterwards
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t webSocketProcessRequest(HttpConnection *connection)
+{
+   error_t error;
+   WebSocketCallback callback;
+
+   //Point to the application callback
+   callback = connection->settings->webSocketCallback;
+
+   //Perform the opening handshake
+   error = webSocketHandshake(connection);
+   //Any error to report?
+   if(error) return error;
+
+   //Create a mutex serializing the frames sent on this connection
+   connection->webSocketMutex = osMutexCreate(FALSE);
+   //Any error to report?
+   if(connection->webSocketMutex == OS_INVALID_HANDLE)
+      return ERROR_OUT_OF_RESOURCES;
+
+   //Notify the application
+   error = callback(connection, WEB_SOCKET_EVENT_OPEN, 0, NULL, 0);
+
+   //The application accepted the connection?
+   if(!error)
+   {
+      //Messages can now be pushed to the client
+      webSocketRegister(connection);
+      //Process the incoming frames
+      error = webSocketReceiveMessages(connection);
+      //Stop pushing messages
+      webSocketUnregister(connection);
+
+      //Notify the application
+      callback(connection, WEB_SOCKET_EVENT_CLOSE, 0, NULL, 0);
+   }
+   else
+   {
+      //Reject the connection
+      webSocketClose(connection, WEB_SOCKET_STATUS_GOING_AWAY);
+   }
+
+   //Release the mutex
+   osMutexClose(connection->webSocketMutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Perform the opening handshake
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t webSocketHandshake(HttpConnection *connection)
+{
+   error_t error;
+   size_t n;
+   char_t accept[29];
+   uint8_t digest[SHA1_DIGEST_SIZE];
+
+   //The opening handshake must be a GET request
+   if(connection->request.method != HTTP_METHOD_GET)
+   {
+      //Send a 400 Bad Request response
+      httpSendErrorResponse(connection, 400, "The WebSocket handshake must use GET");
+      //Report an error
+      return ERROR_INVALID_REQUEST;
+   }
+
+   //Only version 13 of the protocol is supported
+   if(connection->request.webSocketVersion != 13)
+   {
+      //Send a 400 Bad Request response
+      httpSendErrorResponse(connection, 400, "Unsupported WebSocket version");
+      //Report an error
+      return ERROR_INVALID_VERSION;
+   }
+
+   //The key is a base64-encoded 16-byte nonce
+   if(strlen(connection->request.webSocketKey) != 24)
+   {
+      //Send a 400 Bad Request response
+      httpSendErrorResponse(connection, 400, "Invalid WebSocket key");
+      //Report an error
+      return ERROR_INVALID_REQUEST;
+   }
+
+   //Concatenate the key with the GUID
+   strcpy(connection->buffer, connection->request.webSocketKey);
+   strcat(connection->buffer, WEB_SOCKET_GUID);
+
+   //The accept value is the base64-encoded SHA-1 of the resulting string
+   error = sha1Compute(connection->buffer, strlen(connection->buffer), digest);
+   //Any error to report?
+   if(error) return error;
+
+   //Encode the digest
+   base64Encode(digest, SHA1_DIGEST_SIZE, accept, NULL);
+
+   //Format the response
+   n = sprintf(connection->buffer, "HTTP/1.1 101 Switching Protocols\r\n"
+      "Upgrade: websocket\r\nConnection: Upgrade\r\n"
+      "Sec-WebSocket-Accept: %s\r\n\r\n", accept);
+
+   //Debug message
+   TRACE_DEBUG("HTTP server: Sending WebSocket handshake (%u bytes)...\r\n", n);
+   TRACE_DEBUG("%s", connection->buffer);
+
+   //Send the responses to the preceding pipelined requests first
+   error = httpFlushStream(connection);
+   //Any error to report?
+   if(error) return error;
+
+   //The output buffer is not used by the HTTP layer anymore. From now on,
+   //the frames are sent directly through the underlying transport
+   return httpSocketSend(connection, connection->buffer, n, NULL, 0);
+}
+
+
+/**
+ * @brief Process incoming frames
+ *
+ * Fragmented messages are reassembled in the connection buffer before
+ * being passed to the application. Control frames are handled as they
+ * arrive. The client is pinged whenever the connection stays idle for
+ * longer than the socket timeout
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @return Error code
+ **/
+
+error_t webSocketReceiveMessages(HttpConnection *connection)
+{
+   error_t error;
+   uint_t opcode;
+   size_t length;
+   WebSocketFrameHeader header;
+   uint8_t control[WEB_SOCKET_MAX_CONTROL_LEN];
+
+   //No message is being received
+   opcode = WEB_SOCKET_OPCODE_CONTINUATION;
+   length = 0;
+
+   //Process incoming frames
+   while(1)
+   {
+      //Read the frame header
+      error = webSocketReadFrameHeader(connection, &header);
+
+      //No frame received for a while?
+      if(error == ERROR_TIMEOUT)
+      {
+         //Make sure the client is still there
+         error = webSocketSend(connection, NULL, 0, WEB_SOCKET_OPCODE_PING);
+         //Failed to send the frame?
+         if(error) break;
+
+         //Wait for the next frame
+         continue;
+      }
+      //Any other error to report?
+      else if(error)
+      {
+         break;
+      }
+
+      //Control frame?
+      if(header.opcode & 0x08)
+      {
+         //Control frames must not be fragmented
+         if(!header.fin || header.length > WEB_SOCKET_MAX_CONTROL_LEN)
+         {
+            error = ERROR_INVALID_HEADER;
+            break;
+         }
+
+         //Read the payload
+         error = webSocketReadPayload(connection, &header, control);
+         //Any error to report?
+         if(error) break;
+
+         //Close frame?
+         if(header.opcode == WEB_SOCKET_OPCODE_CLOSE)
+         {
+            //Echo the status code to complete the closing handshake
+            webSocketSend(connection, control, min(header.length, 2),
+               WEB_SOCKET_OPCODE_CLOSE);
+            //The session is over
+            break;
+         }
+         //Ping frame?
+         else if(header.opcode == WEB_SOCKET_OPCODE_PING)
+         {
+            //Reply with a pong frame carrying the same data
+            error = webSocketSend(connection, control, header.length,
+               WEB_SOCKET_OPCODE_PONG);
+            //Failed to send the frame?
+            if(error) break;
+         }
+         //Unknown opcode?
+         else if(header.opcode != WEB_SOCKET_OPCODE_PONG)
+         {
+            error = ERROR_INVALID_HEADER;
+            break;
+         }
+      }
+      //Data frame?
+      else
+      {
+         //First fragment of a message?
+         if(header.opcode != WEB_SOCKET_OPCODE_CONTINUATION)
+         {
+            //The previous message must be complete and
+            //the opcode must be a known one
+            if(opcode != WEB_SOCKET_OPCODE_CONTINUATION ||
+               header.opcode > WEB_SOCKET_OPCODE_BINARY)
+            {
+               error = ERROR_INVALID_HEADER;
+               break;
+            }
+
+            //Start a new message
+            opcode = header.opcode;
+            length = 0;
+         }
+         //Continuation of a message that has not been started?
+         else if(opcode == WEB_SOCKET_OPCODE_CONTINUATION)
+         {
+            error = ERROR_INVALID_HEADER;
+            break;
+         }
+
+         //The message must fit in the connection buffer
+         if(header.length > (HTTP_SERVER_BUFFER_SIZE - length))
+         {
+            error = ERROR_MESSAGE_TOO_LONG;
+            break;
+         }
+
+         //Append the payload to the message
+         error = webSocketReadPayload(connection, &header,
+            (uint8_t *) connection->buffer + length);
+         //Any error to report?
+         if(error) break;
+
+         //Update the length of the message
+         length += header.length;
+
+         //Final fragment?
+         if(header.fin)
+         {
+            //Pass the message to the application
+            error = connection->settings->webSocketCallback(connection,
+               WEB_SOCKET_EVENT_MESSAGE, opcode, (uint8_t *) connection->buffer, length);
+
+            //The application wants to close the connection?
+            if(error)
+            {
+               webSocketClose(connection, WEB_SOCKET_STATUS_NORMAL);
+               break;
+            }
+
+            //Wait for the next message
+            opcode = WEB_SOCKET_OPCODE_CONTINUATION;
+            length = 0;
+         }
+      }
+   }
+
+   //Protocol violation?
+   if(error == ERROR_INVALID_HEADER)
+      webSocketClose(connection, WEB_SOCKET_STATUS_PROTOCOL_ERROR);
+   //Message too large?
+   else if(error == ERROR_MESSAGE_TOO_LONG)
+      webSocketClose(connection, WEB_SOCKET_STATUS_TOO_BIG);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Read a frame header
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[out] header Decoded frame header
+ * @return Error code (ERROR_TIMEOUT if no frame has been received)
+ **/
+
+error_t webSocketReadFrameHeader(HttpConnection *connection, WebSocketFrameHeader *header)
+{
+   error_t error;
+   size_t n;
+   uint8_t buffer[8];
+
+   //Read the first byte of the frame. A timeout at this point
+   //means that the connection is idle
+   error = httpReceiveData(connection, buffer, 1, &n, 0);
+   //Any error to report?
+   if(error) return error;
+
+   //Read the second byte of the frame
+   error = webSocketReceiveData(connection, buffer + 1, 1);
+   //Any error to report?
+   if(error) return error;
+
+   //Reserved bits must be cleared since no extension is negotiated
+   if(buffer[0] & WEB_SOCKET_FLAG_RSV)
+      return ERROR_INVALID_HEADER;
+   //All the frames sent by the client must be masked
+   if(!(buffer[1] & WEB_SOCKET_FLAG_MASK))
+      return ERROR_INVALID_HEADER;
+
+   //Decode the first byte
+   header->fin = (buffer[0] & WEB_SOCKET_FLAG_FIN) ? TRUE : FALSE;
+   header->opcode = buffer[0] & 0x0F;
+
+   //Get the payload length
+   n = buffer[1] & 0x7F;
+
+   //16-bit extended payload length?
+   if(n == 126)
+   {
+      //Read the extended payload length
+      error = webSocketReceiveData(connection, buffer, 2);
+      //Any error to report?
+      if(error) return error;
+
+      //Convert from network byte order
+      header->length = LOAD16BE(buffer);
+   }
+   //64-bit extended payload length?
+   else if(n == 127)
+   {
+      //Read the extended payload length
+      error = webSocketReceiveData(connection, buffer, 8);
+      //Any error to report?
+      if(error) return error;
+
+      //Payloads longer than 4 GB are not supported
+      if(LOAD32BE(buffer) != 0)
+         return ERROR_MESSAGE_TOO_LONG;
+
+      //Convert from network byte order
+      header->length = LOAD32BE(buffer + 4);
+   }
+   else
+   {
+      //7-bit payload length
+      header->length = n;
+   }
+
+   //Read the masking key
+   return webSocketReceiveData(connection, header->mask, 4);
+}
+
+
+/**
+ * @brief Read and unmask the payload of a frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] header Frame header
+ * @param[out] data Buffer where to store the payload
+ * @return Error code
+ **/
+
+error_t webSocketReadPayload(HttpConnection *connection,
+   const WebSocketFrameHeader *header, uint8_t *data)
+{
+   error_t error;
+   size_t i;
+
+   //Read the payload
+   error = webSocketReceiveData(connection, data, header->length);
+   //Any error to report?
+   if(error) return error;
+
+   //Unmask the payload
+   for(i = 0; i < header->length; i++)
+      data[i] ^= header->mask[i & 3];
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Read a fixed amount of data within a frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[out] data Buffer where to store the incoming data
+ * @param[in] length Number of bytes to read
+ * @return Error code
+ **/
+
+error_t webSocketReceiveData(HttpConnection *connection, void *data, size_t length)
+{
+   error_t error;
+   size_t n;
+
+   //Nothing to read?
+   if(!length)
+      return NO_ERROR;
+
+   //Wait for the requested amount of data
+   error = httpReceiveData(connection, data, length, &n, SOCKET_FLAG_WAIT_ALL);
+
+   //The frame cannot be resumed once it has been partially read, so
+   //a timeout in the middle of a frame is a fatal error
+   if(error == ERROR_TIMEOUT)
+      error = ERROR_CONNECTION_FAILED;
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send a frame to the client
+ *
+ * Messages are sent unfragmented, as required from a server, without
+ * masking. This function may be called from any task while the
+ * connection is registered
+ *
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] data Payload of the frame
+ * @param[in] length Length of the payload
+ * @param[in] opcode Frame opcode
+ * @return Error code
+ **/
+
+error_t webSocketSend(HttpConnection *connection,
+   const void *data, size_t length, uint_t opcode)
+{
+   error_t error;
+   size_t n;
+   uint8_t *p;
+
+   //Point to the output buffer, which is free once
+   //the connection has switched to the WebSocket protocol
+   p = (uint8_t *) connection->txBuffer;
+
+   //Enter critical section
+   osMutexAcquire(connection->webSocketMutex);
+
+   //Format the first byte of the frame header
+   p[0] = WEB_SOCKET_FLAG_FIN | (opcode & 0x0F);
+
+   //7-bit payload length?
+   if(length < 126)
+   {
+      p[1] = (uint8_t) length;
+      n = 2;
+   }
+   //16-bit payload length?
+   else if(length < 65536)
+   {
+      p[1] = 126;
+      STORE16BE(length, p + 2);
+      n = 4;
+   }
+   //64-bit payload length?
+   else
+   {
+      p[1] = 127;
+      STORE32BE(0, p + 2);
+      STORE32BE(length, p + 6);
+      n = 10;
+   }
+
+   //Small frames are sent in a single segment
+   if(length <= (HTTP_SERVER_TX_BUFFER_SIZE - n))
+   {
+      //Copy the payload behind the header
+      memcpy(p + n, data, length);
+      //Send the whole frame
+      error = httpSocketSend(connection, p, n + length, NULL, 0);
+   }
+   else
+   {
+      //Send the frame header
+      error = httpSocketSend(connection, p, n, NULL, 0);
+
+      //Check status code
+      if(!error)
+      {
+         //Send the payload
+         error = httpSocketSend(connection, data, length, NULL, 0);
+      }
+   }
+
+   //Leave critical section
+   osMutexRelease(connection->webSocketMutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Push a message to every WebSocket client
+ * @param[in] context Pointer to the HTTP server context
+ * @param[in] uri Only the clients that opened this URI receive the
+ *   message (NULL to send the message to all the clients)
+ * @param[in] data Payload of the message
+ * @param[in] length Length of the payload
+ * @param[in] opcode Frame opcode (WEB_SOCKET_OPCODE_TEXT or WEB_SOCKET_OPCODE_BINARY)
+ * @return Error code
+ **/
+
+error_t webSocketBroadcast(HttpServerContext *context, const char_t *uri,
+   const void *data, size_t length, uint_t opcode)
+{
+   uint_t i;
+   HttpConnection *connection;
+
+   //Enter critical section
+   osMutexAcquire(context->webSocketMutex);
+
+   //Loop through the open connections
+   for(i = 0; i < HTTP_SERVER_MAX_CONNECTIONS; i++)
+   {
+      //Point to the current connection
+      connection = context->webSockets[i];
+
+      //Check whether the client is interested in the message
+      if(connection != NULL && (uri == NULL || !strcmp(connection->request.uri, uri)))
+      {
+         //Failures are detected by the task servicing the connection
+         webSocketSend(connection, data, length, opcode);
+      }
+   }
+
+   //Leave critical section
+   osMutexRelease(context->webSocketMutex);
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send a close frame
+ * @param[in] connection Structure representing an HTTP connection
+ * @param[in] statusCode Reason for closing the connection
+ * @return Error code
+ **/
+
+error_t webSocketClose(HttpConnection *connection, uint_t statusCode)
+{
+   uint8_t payload[2];
+
+   //The payload of the close frame is the status code
+   STORE16BE(statusCode, payload);
+
+   //Send the close frame
+   return webSocketSend(connection, payload, sizeof(payload), WEB_SOCKET_OPCODE_CLOSE);
+}
+
+
+/**
+ * @brief Add a connection to the table of open WebSocket connections
+ * @param[in] connection Structure representing an HTTP connection
+ **/
+
+void webSocketRegister(HttpConnection *connection)
+{
+   uint_t i;
+   HttpServerContext *context;
+
+   //Point to the HTTP server context
+   context = connection->context;
+
+   //Enter critical section
+   osMutexAcquire(context->webSocketMutex);
+
+   //Look for a free entry
+   for(i = 0; i < HTTP_SERVER_MAX_CONNECTIONS; i++)
+   {
+      //Free entry?
+      if(context->webSockets[i] == NULL)
+      {
+         context->webSockets[i] = connection;
+         break;
+      }
+   }
+
+   //Leave critical section
+   osMutexRelease(context->webSocketMutex);
+}
+
+
+/**
+ * @brief Remove a connection from the table of open WebSocket connections
+ * @param[in] connection Structure representing an HTTP connection
+ **/
+
+void webSocketUnregister(HttpConnection *connection)
+{
+   uint_t i;
+   HttpServerContext *context;
+
+   //Point to the HTTP server context
+   context = connection->context;
+
+   //Enter critical section
+   osMutexAcquire(context->webSocketMutex);
+
+   //Look for the corresponding entry
+   for(i = 0; i < HTTP_SERVER_MAX_CONNECTIONS; i++)
+   {
+      //Matching entry?
+      if(context->webSockets[i] == connection)
+      {
+         context->webSockets[i] = NULL;
+         break;
+      }
+   }
+
+   //Leave critical section
+   osMutexRelease(context->webSocketMutex);
+}
+
+#endif
@@ -0,0 +1,119 @@
+/**
+ * @file web_socket.h
+ * @brief WebSocket protocol (RFC 6455)
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * A WebSocket connection starts as an HTTP/1.1 request carrying an
+ * Upgrade header. Once the opening handshake is complete, the TCP
+ * connection carries full-duplex frames, so that the server can push
+ * updates to the client without being polled
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _WEB_SOCKET_H
+#define _WEB_SOCKET_H
+
+//Dependencies
+#include "os.h"
+#include "http_server.h"
+
+//GUID appended to the key of the client to compute the accept value
+#define WEB_SOCKET_GUID "258EAFA5-E914-47DA-95CA-C5AB0DC85B11"
+//Maximum payload length of a control frame
+#define WEB_SOCKET_MAX_CONTROL_LEN 125
+
+//FIN bit
+#define WEB_SOCKET_FLAG_FIN  0x80
+//Reserved bits
+#define WEB_SOCKET_FLAG_RSV  0x70
+//MASK bit
+#define WEB_SOCKET_FLAG_MASK 0x80
+
+
+/**
+ * @brief Frame opcodes
+ **/
+
+typedef enum
+{
+   WEB_SOCKET_OPCODE_CONTINUATION = 0x00, ///<Continuation frame
+   WEB_SOCKET_OPCODE_TEXT         = 0x01, ///<Text frame
+   WEB_SOCKET_OPCODE_BINARY       = 0x02, ///<Binary frame
+   WEB_SOCKET_OPCODE_CLOSE        = 0x08, ///<Connection close
+   WEB_SOCKET_OPCODE_PING         = 0x09, ///<Ping
+   WEB_SOCKET_OPCODE_PONG         = 0x0A  ///<Pong
+} WebSocketOpcode;
+
+
+/**
+ * @brief Status codes carried by close frames
+ **/
+
+typedef enum
+{
+   WEB_SOCKET_STATUS_NORMAL         = 1000, ///<Normal closure
+   WEB_SOCKET_STATUS_GOING_AWAY     = 1001, ///<The endpoint is going away
+   WEB_SOCKET_STATUS_PROTOCOL_ERROR = 1002, ///<Protocol error
+   WEB_SOCKET_STATUS_UNSUPPORTED    = 1003, ///<Unsupported data type
+   WEB_SOCKET_STATUS_TOO_BIG        = 1009  ///<Message too big to process
+} WebSocketStatusCode;
+
+
+/**
+ * @brief Frame header
+ **/
+
+typedef struct
+{
+   uint_t opcode;   ///<Frame opcode
+   bool_t fin;      ///<Final fragment of the message
+   size_t length;   ///<Payload length
+   uint8_t mask[4]; ///<Masking key
+} WebSocketFrameHeader;
+
+
+//WebSocket related functions
+error_t webSocketInit(HttpServerContext *context);
+
+error_t webSocketProcessRequest(HttpConnection *connection);
+error_t webSocketHandshake(HttpConnection *connection);
+error_t webSocketReceiveMessages(HttpConnection *connection);
+
+error_t webSocketReadFrameHeader(HttpConnection *connection, WebSocketFrameHeader *header);
+error_t webSocketReadPayload(HttpConnection *connection,
+   const WebSocketFrameHeader *header, uint8_t *data);
+error_t webSocketReceiveData(HttpConnection *connection, void *data, size_t length);
+
+error_t webSocketSend(HttpConnection *connection,
+   const void *data, size_t length, uint_t opcode);
+error_t webSocketBroadcast(HttpServerContext *context, const char_t *uri,
+   const void *data, size_t length, uint_t opcode);
+error_t webSocketClose(HttpConnection *connection, uint_t statusCode);
+
+void webSocketRegister(HttpConnection *connection);
+void webSocketUnregister(HttpConnection *connection);
+
+#endif
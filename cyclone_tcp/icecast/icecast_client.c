@@ -192,62 +192,147 @@ error_t icecastClientStart(IcecastClientContext *context,
 error_t icecastClientReadStream(IcecastClientContext *context,
    uint8_t *data, size_t size, size_t *length, time_t timeout)
 {
-   bool_t status;
+   error_t error;
+   size_t n;
+   const uint8_t *p;
 
    //Ensure the parameters are valid
-   if(!context || !data)
+   if(!context || !data || !length)
       return ERROR_INVALID_PARAMETER;
 
-   //Wait for the buffer to be available for reading
-   status = osEventWait(context->readEvent, timeout);
-   //Timeout error?
-   if(!status) return ERROR_TIMEOUT;
+   //No data has been read yet
+   *length = 0;
 
-   //Enter critical section
-   osMutexAcquire(context->mutex);
-   //Compute the number of bytes to read at a time
-   *length = min(size, context->bufferLength);
-   //Leave critical section
-   osMutexRelease(context->mutex);
+   //Wait for the first contiguous region of the buffer
+   error = icecastClientPeekStream(context, &p, &n, timeout);
+   //Timeout error?
+   if(error) return error;
 
-   //Check whether the specified data crosses buffer boundaries
-   if((context->readIndex + *length) <= context->bufferSize)
+   //Limit the number of bytes to copy
+   n = min(n, size);
+   //Copy the data
+   memcpy(data, p, n);
+   //Release the corresponding space
+   icecastClientCommitStream(context, n);
+   //Number of bytes that have been read so far
+   *length = n;
+
+   //The data may wrap around the end of the circular buffer
+   if(*length < size)
    {
-      //Copy the data
-      memcpy(data, context->streamBuffer + context->readIndex, *length);
+      //Get the second contiguous region without waiting
+      error = icecastClientPeekStream(context, &p, &n, 0);
+
+      //Any data available?
+      if(!error)
+      {
+         //Limit the number of bytes to copy
+         n = min(n, size - *length);
+         //Copy the data
+         memcpy(data + *length, p, n);
+         //Release the corresponding space
+         icecastClientCommitStream(context, n);
+         //Total number of bytes that have been read
+         *length += n;
+      }
    }
-   else
+
+   //Successful read operation
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Get a contiguous region of the input stream without copying it
+ *
+ * Data remains in the streaming buffer until icecastClientCommitStream is
+ * called. The buffer must be consumed by a single task
+ *
+ * @param[in] context Pointer to the Icecast client context
+ * @param[out] data Pointer to the first readable byte
+ * @param[out] length Number of contiguous bytes that can be read
+ * @param[in] timeout Maximum time to wait before returning
+ * @return Error code
+ **/
+
+error_t icecastClientPeekStream(IcecastClientContext *context,
+   const uint8_t **data, size_t *length, time_t timeout)
+{
+   size_t i;
+   size_t n;
+
+   //Ensure the parameters are valid
+   if(!context || !data || !length)
+      return ERROR_INVALID_PARAMETER;
+
+   //Wait for the buffer to be available for reading
+   while(1)
    {
-      //Copy the first part of the data
-      memcpy(data, context->streamBuffer + context->readIndex,
-         context->bufferSize - context->readIndex);
-      //Wrap around to the beginning of the circular buffer
-      memcpy(data + context->bufferSize - context->readIndex, context->streamBuffer,
-         *length - context->bufferSize + context->readIndex);
+      //Number of bytes waiting in the buffer
+      n = icecastClientGetBufferLength(context);
+      //Any data available?
+      if(n > 0) break;
+
+      //The event may have been set by a previous write operation,
+      //hence the need to check the buffer length once again
+      if(!osEventWait(context->readEvent, timeout))
+         return ERROR_TIMEOUT;
    }
 
-   //Enter critical section
-   osMutexAcquire(context->mutex);
+   //Make sure the data are read after the write index
+   ICECAST_MEMORY_BARRIER();
+
+   //Map the read index to an offset within the buffer
+   i = context->readIndex;
+   if(i >= context->bufferSize)
+      i -= context->bufferSize;
+
+   //Limit the length to the end of the circular buffer
+   *length = min(n, context->bufferSize - i);
+   //Point to the first readable byte
+   *data = context->streamBuffer + i;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Release data previously obtained with icecastClientPeekStream
+ * @param[in] context Pointer to the Icecast client context
+ * @param[in] length Number of bytes that have been consumed
+ * @return Error code
+ **/
+
+error_t icecastClientCommitStream(IcecastClientContext *context, size_t length)
+{
+   size_t i;
+
+   //Ensure the parameters are valid
+   if(!context)
+      return ERROR_INVALID_PARAMETER;
+
+   //Nothing to do?
+   if(!length)
+      return NO_ERROR;
+
+   //Make sure the data are not read after the index is updated
+   ICECAST_MEMORY_BARRIER();
 
    //Increment read index
-   context->readIndex += *length;
-   //Wrap around if necessary
-   if(context->readIndex >= context->bufferSize)
-      context->readIndex -= context->bufferSize;
-
-   //Update buffer length
-   context->bufferLength -= *length;
-   //Check whether the buffer is available for writing
-   if(context->bufferLength < context->bufferSize)
-      osEventSet(context->writeEvent);
-   //Check whether the buffer is available for reading
-   if(context->bufferLength > 0)
-      osEventSet(context->readEvent);
+   i = context->readIndex + length;
+   //The index runs over twice the buffer size so that a full buffer
+   //can be distinguished from an empty one
+   if(i >= (2 * context->bufferSize))
+      i -= 2 * context->bufferSize;
 
-   //Leave critical section
-   osMutexRelease(context->mutex);
+   //Only the consumer updates the read index
+   context->readIndex = i;
 
-   //Successful read operation
+   //The buffer is now available for writing
+   osEventSet(context->writeEvent);
+
+   //Successful processing
    return NO_ERROR;
 }
 
@@ -293,6 +378,7 @@ void icecastClientTask(void *param)
 {
    error_t error;
    bool_t end;
+   size_t i;
    size_t n;
    size_t length;
    size_t received;
@@ -341,47 +427,53 @@ void icecastClientTask(void *param)
          while(!end && length > 0)
          {
             //Wait for the buffer to be available for writing
-            osEventWait(context->writeEvent, INFINITE_DELAY);
-
-            //Enter critical section
-            osMutexAcquire(context->mutex);
-            //Compute the number of bytes to read at a time
-            n = min(length, context->bufferSize - context->bufferLength);
-            //Leave critical section
-            osMutexRelease(context->mutex);
+            while(1)
+            {
+               //Compute the number of bytes to read at a time
+               n = min(length, context->bufferSize -
+                  icecastClientGetBufferLength(context));
+               //Any space available?
+               if(n > 0) break;
+
+               //The event may have been set by a previous read operation,
+               //hence the need to check the buffer length once again
+               osEventWait(context->writeEvent, INFINITE_DELAY);
+            }
+
+            //Make sure the buffer is written after the read index is loaded
+            ICECAST_MEMORY_BARRIER();
+
+            //Map the write index to an offset within the buffer
+            i = context->writeIndex;
+            if(i >= context->bufferSize)
+               i -= context->bufferSize;
 
             //Check whether the specified data crosses buffer boundaries
-            if((context->writeIndex + n) > context->bufferSize)
-               n = context->bufferSize - context->writeIndex;
+            if((i + n) > context->bufferSize)
+               n = context->bufferSize - i;
 
             //Receive data
-            error = socketReceive(context->socket, context->streamBuffer +
-               context->writeIndex, n, &received, SOCKET_FLAG_WAIT_ALL);
+            error = socketReceive(context->socket, context->streamBuffer + i,
+               n, &received, SOCKET_FLAG_WAIT_ALL);
 
             //Make sure the expected number of bytes have been received
             if(error || received != n)
                end = TRUE;
 
-            //Enter critical section
-            osMutexAcquire(context->mutex);
+            //Make sure the data are visible before the write index is updated
+            ICECAST_MEMORY_BARRIER();
 
             //Increment write index
-            context->writeIndex += n;
+            i = context->writeIndex + n;
             //Wrap around if necessary
-            if(context->writeIndex >= context->bufferSize)
-               context->writeIndex -= context->bufferSize;
+            if(i >= (2 * context->bufferSize))
+               i -= 2 * context->bufferSize;
 
-            //Update buffer length
-            context->bufferLength += n;
-            //Check whether the buffer is available for writing
-            if(context->bufferLength < context->bufferSize)
-               osEventSet(context->writeEvent);
-            //Check whether the buffer is available for reading
-            if(context->bufferLength > 0)
-               osEventSet(context->readEvent);
+            //Only the Icecast client task updates the write index
+            context->writeIndex = i;
 
-            //Leave critical section
-            osMutexRelease(context->mutex);
+            //The buffer is now available for reading
+            osEventSet(context->readEvent);
 
             //Update the total number of bytes that have been received
             context->totalLength += n;
@@ -457,7 +549,7 @@ error_t icecastClientConnect(IcecastClientContext *context)
          context->settings.resource, context->settings.serverName);
 
       //Debug message
-      TRACE_DEBUG(context->buffer);
+      TRACE_DEBUG("%s", context->buffer);
 
       //Send Icecast request
       error = socketSend(context->socket, context->buffer,
@@ -610,3 +702,27 @@ error_t icecastClientProcessMetadata(IcecastClientContext *context)
    //Successful processing
    return NO_ERROR;
 }
+
+
+/**
+ * @brief Get the number of bytes waiting in the streaming buffer
+ * @param[in] context Pointer to the Icecast client context
+ * @return Number of bytes that can be read
+ **/
+
+size_t icecastClientGetBufferLength(IcecastClientContext *context)
+{
+   size_t readIndex;
+   size_t writeIndex;
+
+   //Each index is modified by a single task, so that a
+   //consistent snapshot can be taken without locking
+   readIndex = context->readIndex;
+   writeIndex = context->writeIndex;
+
+   //Both indices run over twice the buffer size
+   if(writeIndex >= readIndex)
+      return writeIndex - readIndex;
+   else
+      return writeIndex + 2 * context->bufferSize - readIndex;
+}
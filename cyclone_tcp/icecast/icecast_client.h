@@ -49,6 +49,15 @@
 //Maximum size of metadata blocks
 #define ICECAST_CLIENT_METADATA_MAX_SIZE 512
 
+//Memory barrier used by the lock-free streaming buffer
+#ifndef ICECAST_MEMORY_BARRIER
+   #if defined(__GNUC__)
+      #define ICECAST_MEMORY_BARRIER() __sync_synchronize()
+   #else
+      #define ICECAST_MEMORY_BARRIER()
+   #endif
+#endif
+
 
 /**
  * @brief Icecast client settings
@@ -71,16 +80,15 @@ typedef struct
 typedef struct
 {
    IcecastClientSettings settings;                    ///<User settings
-   OsMutex *mutex;                                    ///<Mutex protecting critical sections
+   OsMutex *mutex;                                    ///<Mutex protecting metadata
    OsEvent *writeEvent;                               ///<This event tells whether the buffer is writable
    OsEvent *readEvent;                                ///<This event tells whether the buffer is readable
    Socket *socket;                                    ///<Underlying socket
    size_t blockSize;                                  ///<Number of data bytes between subsequent metadata blocks
    uint8_t *streamBuffer;                             ///<Streaming buffer
    size_t bufferSize;                                 ///<Streaming buffer size
-   size_t bufferLength;                               ///<Streaming buffer length
-   size_t writeIndex;                                 ///<Current write index within the buffer
-   size_t readIndex;                                  ///<Current read index within the buffer
+   volatile size_t writeIndex;                        ///<Write index (updated by the Icecast client task only)
+   volatile size_t readIndex;                         ///<Read index (updated by the consumer only)
    size_t totalLength;                                ///<Total number of bytes that have been received
    char_t buffer[ICECAST_CLIENT_METADATA_MAX_SIZE];   ///<Memory buffer for input/output operations
    char_t metadata[ICECAST_CLIENT_METADATA_MAX_SIZE]; ///<Metadata information
@@ -95,6 +103,11 @@ error_t icecastClientStart(IcecastClientContext *context,
 error_t icecastClientReadStream(IcecastClientContext *context,
    uint8_t *data, size_t size, size_t *length, time_t timeout);
 
+error_t icecastClientPeekStream(IcecastClientContext *context,
+   const uint8_t **data, size_t *length, time_t timeout);
+
+error_t icecastClientCommitStream(IcecastClientContext *context, size_t length);
+
 error_t icecastClientReadMetadata(IcecastClientContext *context,
    char_t *metadata, size_t size, size_t *length);
 
@@ -103,4 +116,6 @@ void icecastClientTask(void *param);
 error_t icecastClientConnect(IcecastClientContext *context);
 error_t icecastClientProcessMetadata(IcecastClientContext *context);
 
+size_t icecastClientGetBufferLength(IcecastClientContext *context);
+
 #endif
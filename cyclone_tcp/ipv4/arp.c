@@ -44,6 +44,12 @@
 //Check TCP/IP stack configuration
 #if (IPV4_SUPPORT == ENABLED)
 
+//ARP related local functions
+static uint_t arpHashAddr(Ipv4Addr ipAddr);
+static void arpLruUnlink(NetInterface *interface, ArpCacheEntry *entry);
+static void arpLruInsertHead(NetInterface *interface, ArpCacheEntry *entry);
+static void arpLruInsertTail(NetInterface *interface, ArpCacheEntry *entry);
+
 
 /**
  * @brief ARP cache initialization
@@ -53,14 +59,25 @@
 
 error_t arpInit(NetInterface *interface)
 {
+   uint_t i;
+
    //Create a mutex to prevent simultaneous access to ARP cache
-   interface->arpCacheMutex = osMutexCreate(FALSE);
+   interface->arpCacheMutex = osMutexCreateNamed(FALSE, "ArpCache");
    //Any error to report?
    if(interface->arpCacheMutex == OS_INVALID_HANDLE)
       return ERROR_OUT_OF_RESOURCES;
 
    //Initialize ARP cache
    memset(interface->arpCache, 0, sizeof(interface->arpCache));
+   //No IPv4 address is indexed yet
+   memset(interface->arpHashTable, 0, sizeof(interface->arpHashTable));
+
+   //All the entries are free and sit on the LRU list
+   interface->arpLruHead = NULL;
+   interface->arpLruTail = NULL;
+
+   for(i = 0; i < ARP_CACHE_SIZE; i++)
+      arpLruInsertTail(interface, &interface->arpCache[i]);
 
    //Successful initialization
    return NO_ERROR;
@@ -86,10 +103,9 @@ void arpFlushCache(NetInterface *interface)
       //Point to the current entry
       entry = &interface->arpCache[i];
 
-      //Drop packets that are waiting for address resolution
-      arpFlushQueuedPackets(interface, entry);
       //Release ARP entry
-      entry->state = ARP_STATE_NONE;
+      if(entry->state != ARP_STATE_NONE)
+         arpDeleteEntry(interface, entry);
    }
 
    //Release exclusive access to ARP cache
@@ -99,50 +115,59 @@ void arpFlushCache(NetInterface *interface)
 
 /**
  * @brief Create a new entry in the ARP cache
+ *
+ * Free entries are kept at the tail of the LRU list. When the cache is
+ * full, the tail is the least recently used entry and gets recycled
+ *
  * @param[in] interface Underlying network interface
+ * @param[in] ipAddr IPv4 address the entry refers to
  * @return Pointer to the newly created entry
  **/
 
-ArpCacheEntry *arpCreateEntry(NetInterface *interface)
+ArpCacheEntry *arpCreateEntry(NetInterface *interface, Ipv4Addr ipAddr)
 {
    uint_t i;
    ArpCacheEntry *entry;
-   ArpCacheEntry *oldestEntry;
 
-   //Keep track of the oldest entry
-   oldestEntry = &interface->arpCache[0];
+   //Point to the least recently used entry
+   entry = interface->arpLruTail;
 
-   //Loop through ARP cache entries
-   for(i = 0; i < ARP_CACHE_SIZE; i++)
+   //The cache is full?
+   if(entry->state != ARP_STATE_NONE)
    {
-      //Point to the current entry
-      entry = &interface->arpCache[i];
+      //The least recently used entry is removed
+      arpDeleteEntry(interface, entry);
+   }
 
-      //Check whether the entry is currently in used or not
-      if(entry->state == ARP_STATE_NONE)
-      {
-         //Erase contents
-         memset(entry, 0, sizeof(ArpCacheEntry));
-         //Return a pointer to the ARP entry
-         return entry;
-      }
+   //Initialize the entry
+   entry->ipAddr = ipAddr;
+   entry->macAddr = MAC_UNSPECIFIED_ADDR;
+   entry->timestamp = 0;
+   entry->timeout = 0;
+   entry->retransmitCount = 0;
+   entry->lastUsed = 0;
+   entry->refreshFlag = FALSE;
+   entry->queueSize = 0;
 
-      //Keep track of the oldest entry in the table
-      if(timeCompare(entry->timestamp, oldestEntry->timestamp) < 0)
-         oldestEntry = entry;
-   }
+   //Index the entry by IPv4 address
+   i = arpHashAddr(ipAddr);
+   entry->hashNext = interface->arpHashTable[i];
+   interface->arpHashTable[i] = entry;
+
+   //The entry is now the most recently used one
+   arpLruUnlink(interface, entry);
+   arpLruInsertHead(interface, entry);
 
-   //Drop any pending packets
-   arpFlushQueuedPackets(interface, oldestEntry);
-   //The oldest entry is removed whenever the table runs out of space
-   memset(oldestEntry, 0, sizeof(ArpCacheEntry));
    //Return a pointer to the ARP entry
-   return oldestEntry;
+   return entry;
 }
 
 
 /**
  * @brief Search the ARP cache for a given IPv4 address
+ *
+ * The matching entry becomes the most recently used one
+ *
  * @param[in] interface Underlying network interface
  * @param[in] ipAddr IPv4 address
  * @return A pointer to the matching ARP entry is returned. NULL is returned
@@ -151,21 +176,24 @@ ArpCacheEntry *arpCreateEntry(NetInterface *interface)
 
 ArpCacheEntry *arpFindEntry(NetInterface *interface, Ipv4Addr ipAddr)
 {
-   uint_t i;
    ArpCacheEntry *entry;
 
-   //Loop through ARP cache entries
-   for(i = 0; i < ARP_CACHE_SIZE; i++)
+   //Walk through the entries sharing the same hash value
+   for(entry = interface->arpHashTable[arpHashAddr(ipAddr)];
+      entry != NULL; entry = entry->hashNext)
    {
-      //Point to the current entry
-      entry = &interface->arpCache[i];
-
-      //Check whether the entry is currently in used
-      if(entry->state != ARP_STATE_NONE)
+      //Current entry matches the specified address?
+      if(entry->ipAddr == ipAddr)
       {
-         //Current entry matches the specified address?
-         if(entry->ipAddr == ipAddr)
-            return entry;
+         //Move the entry to the head of the LRU list
+         if(entry != interface->arpLruHead)
+         {
+            arpLruUnlink(interface, entry);
+            arpLruInsertHead(interface, entry);
+         }
+
+         //Return a pointer to the ARP entry
+         return entry;
       }
    }
 
@@ -174,6 +202,137 @@ ArpCacheEntry *arpFindEntry(NetInterface *interface, Ipv4Addr ipAddr)
 }
 
 
+/**
+ * @brief Remove an entry from the ARP cache
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the entry to be deleted
+ **/
+
+void arpDeleteEntry(NetInterface *interface, ArpCacheEntry *entry)
+{
+   ArpCacheEntry **p;
+
+   //Drop packets that are waiting for address resolution
+   arpFlushQueuedPackets(interface, entry);
+
+   //Look for the link pointing to the entry
+   for(p = &interface->arpHashTable[arpHashAddr(entry->ipAddr)];
+      *p != NULL; p = &(*p)->hashNext)
+   {
+      //Unlink the entry
+      if(*p == entry)
+      {
+         *p = entry->hashNext;
+         break;
+      }
+   }
+
+   //Release ARP entry
+   entry->hashNext = NULL;
+   entry->state = ARP_STATE_NONE;
+
+   //Invalidate the paths cached by connected sockets
+   interface->neighborCacheGen++;
+
+   //Free entries are reused first
+   arpLruUnlink(interface, entry);
+   arpLruInsertTail(interface, entry);
+}
+
+
+/**
+ * @brief Compute the hash bucket of an IPv4 address
+ *
+ * Hosts on the same subnet differ in their last bytes, whose position
+ * depends on the byte order, so all the bytes are folded together
+ *
+ * @param[in] ipAddr IPv4 address
+ * @return Index of the hash bucket
+ **/
+
+static uint_t arpHashAddr(Ipv4Addr ipAddr)
+{
+   uint32_t h;
+
+   //Fold the address
+   h = ipAddr ^ (ipAddr >> 16);
+   h ^= h >> 8;
+
+   //Return the index of the hash bucket
+   return h & (ARP_HASH_TABLE_SIZE - 1);
+}
+
+
+/**
+ * @brief Remove an entry from the LRU list
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the ARP entry
+ **/
+
+static void arpLruUnlink(NetInterface *interface, ArpCacheEntry *entry)
+{
+   //Update the link held by the previous entry
+   if(entry->lruPrev != NULL)
+      entry->lruPrev->lruNext = entry->lruNext;
+   else
+      interface->arpLruHead = entry->lruNext;
+
+   //Update the link held by the next entry
+   if(entry->lruNext != NULL)
+      entry->lruNext->lruPrev = entry->lruPrev;
+   else
+      interface->arpLruTail = entry->lruPrev;
+
+   //The entry is no longer linked
+   entry->lruPrev = NULL;
+   entry->lruNext = NULL;
+}
+
+
+/**
+ * @brief Insert an entry at the head of the LRU list
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the ARP entry
+ **/
+
+static void arpLruInsertHead(NetInterface *interface, ArpCacheEntry *entry)
+{
+   //Link the entry in front of the current head
+   entry->lruPrev = NULL;
+   entry->lruNext = interface->arpLruHead;
+
+   if(interface->arpLruHead != NULL)
+      interface->arpLruHead->lruPrev = entry;
+   else
+      interface->arpLruTail = entry;
+
+   //The entry is now the most recently used one
+   interface->arpLruHead = entry;
+}
+
+
+/**
+ * @brief Insert an entry at the tail of the LRU list
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the ARP entry
+ **/
+
+static void arpLruInsertTail(NetInterface *interface, ArpCacheEntry *entry)
+{
+   //Link the entry behind the current tail
+   entry->lruPrev = interface->arpLruTail;
+   entry->lruNext = NULL;
+
+   if(interface->arpLruTail != NULL)
+      interface->arpLruTail->lruNext = entry;
+   else
+      interface->arpLruHead = entry;
+
+   //The entry will be the first one to be reused
+   interface->arpLruTail = entry;
+}
+
+
 /**
  * @brief Send packets that are waiting for address resolution
  * @param[in] interface Underlying network interface
@@ -276,6 +435,8 @@ error_t arpResolve(NetInterface *interface, Ipv4Addr ipAddr, MacAddr *macAddr)
       {
          //Copy the MAC address associated with the specified IPv4 address
          *macAddr = entry->macAddr;
+         //Keep track of the entries that are actively used
+         entry->lastUsed = osGetTickCount();
 
          //Release exclusive access to ARP cache
          osMutexRelease(interface->arpCacheMutex);
@@ -285,7 +446,7 @@ error_t arpResolve(NetInterface *interface, Ipv4Addr ipAddr, MacAddr *macAddr)
    }
 
    //If no entry exists, then create a new one
-   entry = arpCreateEntry(interface);
+   entry = arpCreateEntry(interface, ipAddr);
 
    //Any error to report?
    if(!entry)
@@ -296,15 +457,6 @@ error_t arpResolve(NetInterface *interface, Ipv4Addr ipAddr, MacAddr *macAddr)
       return ERROR_OUT_OF_RESOURCES;
    }
 
-   //Record the IPv4 address whose MAC address is unknown
-   entry->ipAddr = ipAddr;
-   entry->macAddr = MAC_UNSPECIFIED_ADDR;
-
-   //Reset retransmission counter
-   entry->retransmitCount = 0;
-   //No packet are pending in the transmit queue
-   entry->queueSize = 0;
-
    //Send an ARP request
    arpSendRequest(interface, interface->ipv4Config.addr,
       entry->ipAddr, &MAC_BROADCAST_ADDR);
@@ -378,8 +530,8 @@ error_t arpEnqueuePacket(NetInterface *interface,
 
       //Index of the entry to be filled in
       i = entry->queueSize;
-      //Allocate a memory buffer to store the packet
-      entry->queue[i].buffer = chunkedBufferAlloc(length);
+      //Keep a reference to the packet contents rather than a copy
+      entry->queue[i].buffer = chunkedBufferClone(buffer, 0, length);
 
       //Failed to allocate memory?
       if(!entry->queue[i].buffer)
@@ -390,8 +542,6 @@ error_t arpEnqueuePacket(NetInterface *interface,
          return ERROR_OUT_OF_MEMORY;
       }
 
-      //Copy packet contents
-      chunkedBufferCopy(entry->queue[i].buffer, 0, buffer, 0, length);
       //Offset to the first byte of the IPv4 header
       entry->queue[i].offset = offset;
 
@@ -463,10 +613,8 @@ void arpTick(NetInterface *interface)
             }
             else
             {
-               //Drop packets that are waiting for address resolution
-               arpFlushQueuedPackets(interface, entry);
                //The entry should be deleted since address resolution has failed
-               entry->state = ARP_STATE_NONE;
+               arpDeleteEntry(interface, entry);
             }
          }
       }
@@ -478,9 +626,26 @@ void arpTick(NetInterface *interface)
          {
             //Save current time
             entry->timestamp = osGetTickCount();
+            //Invalidate the paths cached by connected sockets
+            interface->neighborCacheGen++;
             //Enter STALE state
             entry->state = ARP_STATE_STALE;
          }
+#if (ARP_REFRESH_TIME > 0)
+         //An entry that has been used since its last confirmation is
+         //refreshed shortly before it expires, so that steady flows never
+         //have to wait for the address to be resolved again
+         else if(!entry->refreshFlag &&
+            (time - entry->timestamp) >= (entry->timeout - ARP_REFRESH_TIME) &&
+            timeCompare(entry->lastUsed, entry->timestamp) > 0)
+         {
+            //Send a point-to-point ARP request to the host
+            arpSendRequest(interface, interface->ipv4Config.addr,
+               entry->ipAddr, &entry->macAddr);
+            //Only one refresh request is sent
+            entry->refreshFlag = TRUE;
+         }
+#endif
       }
       //DELAY state?
       else if(entry->state == ARP_STATE_DELAY)
@@ -524,7 +689,7 @@ void arpTick(NetInterface *interface)
             else
             {
                //The entry should be deleted since the host is not reachable anymore
-               entry->state = ARP_STATE_NONE;
+               arpDeleteEntry(interface, entry);
             }
          }
       }
@@ -662,6 +827,8 @@ void arpProcessReply(NetInterface *interface, ArpPacket *arpReply)
          entry->timestamp = osGetTickCount();
          //The validity of the ARP entry is limited in time
          entry->timeout = ARP_REACHABLE_TIME;
+         //The entry may be refreshed before it expires
+         entry->refreshFlag = FALSE;
          //Switch to the REACHABLE state
          entry->state = ARP_STATE_REACHABLE;
       }
@@ -670,9 +837,19 @@ void arpProcessReply(NetInterface *interface, ArpPacket *arpReply)
          //Different link-layer address than cached?
          if(!macCompAddr(&arpReply->sha, &entry->macAddr))
          {
+            //Invalidate the paths cached by connected sockets
+            interface->neighborCacheGen++;
             //Enter STALE state
             entry->state = ARP_STATE_STALE;
          }
+         else
+         {
+            //The host is still reachable
+            entry->timestamp = osGetTickCount();
+            entry->timeout = ARP_REACHABLE_TIME;
+            //The entry may be refreshed again before it expires
+            entry->refreshFlag = FALSE;
+         }
       }
       else if(entry->state == ARP_STATE_PROBE)
       {
@@ -680,10 +857,15 @@ void arpProcessReply(NetInterface *interface, ArpPacket *arpReply)
          entry->ipAddr = arpReply->spa;
          entry->macAddr = arpReply->sha;
 
+         //Invalidate the paths cached by connected sockets
+         interface->neighborCacheGen++;
+
          //Save current time
          entry->timestamp = osGetTickCount();
          //The validity of the ARP entry is limited in time
          entry->timeout = ARP_REACHABLE_TIME;
+         //The entry may be refreshed before it expires
+         entry->refreshFlag = FALSE;
          //Switch to the REACHABLE state
          entry->state = ARP_STATE_REACHABLE;
       }
@@ -46,6 +46,13 @@
    #error ARP_CACHE_SIZE parameter is invalid
 #endif
 
+//Size of the hash table used to index the ARP cache
+#ifndef ARP_HASH_TABLE_SIZE
+   #define ARP_HASH_TABLE_SIZE 16
+#elif (ARP_HASH_TABLE_SIZE < 1 || (ARP_HASH_TABLE_SIZE & (ARP_HASH_TABLE_SIZE - 1)))
+   #error ARP_HASH_TABLE_SIZE parameter is invalid
+#endif
+
 //Maximum number of packets waiting for address resolution to complete
 #ifndef ARP_MAX_PENDING_PACKETS
    #define ARP_MAX_PENDING_PACKETS 2
@@ -95,6 +102,13 @@
    #error ARP_DELAY_FIRST_PROBE_TIME parameter is invalid
 #endif
 
+//Time before the expiry of a reachable entry at which it is refreshed if in use
+#ifndef ARP_REFRESH_TIME
+   #define ARP_REFRESH_TIME 5000
+#elif (ARP_REFRESH_TIME < 0 || ARP_REFRESH_TIME >= ARP_REACHABLE_TIME)
+   #error ARP_REFRESH_TIME parameter is invalid
+#endif
+
 //Hardware type
 #define ARP_HARDWARE_TYPE_ETH 0x0001
 //Protocol type
@@ -173,7 +187,7 @@ typedef struct
  * @brief ARP cache entry
  **/
 
-typedef struct
+typedef struct _ArpCacheEntry
 {
    ArpState state;                              //Reachability state
    Ipv4Addr ipAddr;                             //Unicast IPv4 address
@@ -181,8 +195,13 @@ typedef struct
    time_t timestamp;                            //Time stamp to manage entry lifetime
    time_t timeout;                              //Timeout value
    uint_t retransmitCount;                      //Retransmission counter
+   time_t lastUsed;                             //Time at which the entry was last used to send a packet
+   bool_t refreshFlag;                          //A refresh request has been sent
    ArpQueueItem queue[ARP_MAX_PENDING_PACKETS]; //Packets waiting for address resolution to complete
    uint_t queueSize;                            //Number of queued packets
+   struct _ArpCacheEntry *hashNext;             //Next entry in the same hash bucket
+   struct _ArpCacheEntry *lruPrev;              //More recently used entry
+   struct _ArpCacheEntry *lruNext;              //Less recently used entry
 } ArpCacheEntry;
 
 
@@ -190,8 +209,9 @@ typedef struct
 error_t arpInit(NetInterface *interface);
 void arpFlushCache(NetInterface *interface);
 
-ArpCacheEntry *arpCreateEntry(NetInterface *interface);
+ArpCacheEntry *arpCreateEntry(NetInterface *interface, Ipv4Addr ipAddr);
 ArpCacheEntry *arpFindEntry(NetInterface *interface, Ipv4Addr ipAddr);
+void arpDeleteEntry(NetInterface *interface, ArpCacheEntry *entry);
 
 void arpSendQueuedPackets(NetInterface *interface, ArpCacheEntry *entry);
 void arpFlushQueuedPackets(NetInterface *interface, ArpCacheEntry *entry);
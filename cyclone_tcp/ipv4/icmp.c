@@ -35,6 +35,8 @@
 #include "ip.h"
 #include "ipv4.h"
 #include "icmp.h"
+#include "ip_pmtu.h"
+#include "tcp_misc.h"
 #include "debug.h"
 
 //Check TCP/IP stack configuration
@@ -44,12 +46,13 @@
 /**
  * @brief Incoming ICMP message processing
  * @param[in] interface Underlying network interface
+ * @param[in] srcMacAddr MAC address of the source
  * @param[in] srcIpAddr Source IPv4 address
  * @param[in] buffer Multi-part buffer containing the incoming ICMP message
  * @param[in] offset Offset to the first byte of the ICMP message
  **/
 
-void icmpProcessMessage(NetInterface *interface,
+void icmpProcessMessage(NetInterface *interface, const MacAddr *srcMacAddr,
    Ipv4Addr srcIpAddr, const ChunkedBuffer *buffer, size_t offset)
 {
    size_t length;
@@ -77,8 +80,9 @@ void icmpProcessMessage(NetInterface *interface,
    //Dump message contents for debugging purpose
    icmpDumpMessage(header);
 
-   //Verify checksum value
-   if(ipCalcChecksumEx(buffer, offset, length) != 0x0000)
+   //Verify checksum value, unless the hardware already did it
+   if(!(interface->nicRxChecksumFlags & NIC_RX_CHECKSUM_PAYLOAD) &&
+      ipCalcChecksumEx(buffer, offset, length) != 0x0000)
    {
       //Debug message
       TRACE_WARNING("Wrong ICMP header checksum!\r\n");
@@ -92,8 +96,15 @@ void icmpProcessMessage(NetInterface *interface,
    //Echo request?
    case ICMP_TYPE_ECHO_REQUEST:
       //Process Echo Request message
-      icmpProcessEchoRequest(interface, srcIpAddr, buffer, offset);
+      icmpProcessEchoRequest(interface, srcMacAddr, srcIpAddr, buffer, offset);
       break;
+#if (IP_PMTU_SUPPORT == ENABLED)
+   //Destination Unreachable?
+   case ICMP_TYPE_DEST_UNREACHABLE:
+      //Process Destination Unreachable message
+      icmpProcessDestUnreachable(interface, buffer, offset);
+      break;
+#endif
    //Unknown type?
    default:
       //Debug message
@@ -107,12 +118,13 @@ void icmpProcessMessage(NetInterface *interface,
 /**
  * @brief Echo Request message processing
  * @param[in] interface Underlying network interface
+ * @param[in] srcMacAddr MAC address of the source
  * @param[in] srcIpAddr Source IPv4 address
  * @param[in] request Multi-part buffer containing the incoming Echo Request message
  * @param[in] requestOffset Offset to the first byte of the Echo Request message
  **/
 
-void icmpProcessEchoRequest(NetInterface *interface,
+void icmpProcessEchoRequest(NetInterface *interface, const MacAddr *srcMacAddr,
    Ipv4Addr srcIpAddr, const ChunkedBuffer *request, size_t requestOffset)
 {
    error_t error;
@@ -141,6 +153,12 @@ void icmpProcessEchoRequest(NetInterface *interface,
    //Dump message contents for debugging purpose
    icmpDumpEchoMessage(requestHeader);
 
+#if (ICMP_ECHO_FAST_PATH_SUPPORT == ENABLED)
+   //Turn the request around in the receive buffer whenever possible
+   if(icmpTurnAroundEchoRequest(interface, srcMacAddr, request, requestOffset) == NO_ERROR)
+      return;
+#endif
+
    //Allocate memory to hold the Echo Reply message
    reply = ipAllocBuffer(sizeof(IcmpEchoMessage), &replyOffset);
    //Failed to allocate memory?
@@ -173,11 +191,14 @@ void icmpProcessEchoRequest(NetInterface *interface,
 
    //Get the length of the resulting message
    replyLength = chunkedBufferGetLength(reply) - replyOffset;
-   //Calculate ICMP header checksum
-   replyHeader->checksum = ipCalcChecksumEx(reply, replyOffset, replyLength);
+   //Calculate ICMP header checksum, unless the hardware inserts it
+   if(!ipv4IsChecksumOffloaded(interface, srcIpAddr, replyLength))
+      replyHeader->checksum = ipCalcChecksumEx(reply, replyOffset, replyLength);
+
+   //Select the source address of the reply
+   ipv4SelectSourceAddr(&interface, srcIpAddr, &pseudoHeader.srcAddr);
 
    //Format IPv4 pseudo header
-   pseudoHeader.srcAddr = interface->ipv4Config.addr;
    pseudoHeader.destAddr = srcIpAddr;
    pseudoHeader.reserved = 0;
    pseudoHeader.protocol = IPV4_PROTOCOL_ICMP;
@@ -189,13 +210,232 @@ void icmpProcessEchoRequest(NetInterface *interface,
    icmpDumpEchoMessage(replyHeader);
 
    //Send Echo Reply message
-   ipv4SendDatagram(interface, &pseudoHeader, reply, replyOffset, IPV4_DEFAULT_TTL);
+   ipv4SendDatagram(interface, &pseudoHeader, reply, replyOffset, IPV4_DEFAULT_TTL, 0, NULL);
 
    //Free previously allocated memory block
    chunkedBufferFree(reply);
 }
 
 
+/**
+ * @brief Send an Echo Reply from the buffer holding the Echo Request
+ *
+ * The addresses are swapped, the type is changed and the checksum is
+ * updated incrementally. The frame is sent back to the MAC address it
+ * came from, so that no buffer allocation, copy or address resolution
+ * is needed. Only unfragmented requests without IP options that are
+ * addressed to the interface and received over Ethernet qualify
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] srcMacAddr MAC address of the source
+ * @param[in] request Multi-part buffer containing the incoming Echo Request message
+ * @param[in] requestOffset Offset to the first byte of the Echo Request message
+ * @return Error code
+ **/
+
+error_t icmpTurnAroundEchoRequest(NetInterface *interface, const MacAddr *srcMacAddr,
+   const ChunkedBuffer *request, size_t requestOffset)
+{
+   size_t length;
+   Ipv4Addr ipAddr;
+   MacAddr destMacAddr;
+   EthHeader *ethHeader;
+   Ipv4Header *ipHeader;
+   IcmpEchoMessage *header;
+   IcmpEchoReplyFrame frame;
+
+   //The whole datagram must be held by a single chunk
+   if(srcMacAddr == NULL || request->chunkCount != 1)
+      return ERROR_INVALID_PARAMETER;
+
+   //IP options are not reflected in the reply
+   if(requestOffset != sizeof(Ipv4Header))
+      return ERROR_INVALID_PARAMETER;
+
+   //Point to the IPv4 header
+   ipHeader = request->chunk[0].address;
+   //Point to the Ethernet header that precedes it
+   ethHeader = (EthHeader *) ((uint8_t *) ipHeader - sizeof(EthHeader));
+
+   //Make sure the datagram lies in an Ethernet frame
+   if(&ethHeader->srcAddr != srcMacAddr)
+      return ERROR_INVALID_PARAMETER;
+
+   //Requests sent to a broadcast or multicast address are answered
+   //from the unicast address of the interface
+   if(ipHeader->destAddr != interface->ipv4Config.addr)
+      return ERROR_INVALID_PARAMETER;
+
+   //Point to the Echo Request header
+   header = (IcmpEchoMessage *) (ipHeader + 1);
+   //Total length of the datagram
+   length = request->chunk[0].length;
+
+   //Swap the IP addresses
+   ipAddr = ipHeader->srcAddr;
+   ipHeader->srcAddr = ipHeader->destAddr;
+   ipHeader->destAddr = ipAddr;
+
+   //Format the remaining fields of the IPv4 header
+   ipHeader->typeOfService = 0;
+   ipHeader->identification = htons(osAtomicInc16(&interface->ipv4Identification));
+   ipHeader->timeToLive = IPV4_DEFAULT_TTL;
+   ipHeader->headerChecksum = 0;
+   ipHeader->headerChecksum = ipCalcChecksum(ipHeader, sizeof(Ipv4Header));
+
+   //Change the message type, and update the checksum accordingly
+   header->checksum = ipUpdateChecksum(header->checksum,
+      htons((ICMP_TYPE_ECHO_REQUEST << 8) | header->code),
+      htons((ICMP_TYPE_ECHO_REPLY << 8) | header->code));
+   header->type = ICMP_TYPE_ECHO_REPLY;
+
+   //Debug message
+   TRACE_INFO("Sending ICMP Echo Reply message (%u bytes)...\r\n", length - sizeof(Ipv4Header));
+   //Dump message contents for debugging purpose
+   icmpDumpEchoMessage(header);
+
+   //The reply goes back to the sender of the request
+   destMacAddr = ethHeader->srcAddr;
+
+   //The outgoing Ethernet header overwrites the incoming one
+   frame.chunkCount = 1;
+   frame.maxChunkCount = arraysize(frame.chunk);
+   frame.chunk[0].address = ethHeader;
+   frame.chunk[0].length = sizeof(EthHeader) + length;
+   frame.chunk[0].size = 0;
+   frame.chunk[0].block = NULL;
+
+   //Update IP statistics
+   IPV4_MIB_INC(interface, ipOutRequests);
+
+   //Send Echo Reply message
+   ethSendFrame(interface, &destMacAddr, (ChunkedBuffer *) &frame,
+      sizeof(EthHeader), ETH_TYPE_IPV4);
+
+   //The request has been answered
+   return NO_ERROR;
+}
+
+
+#if (IP_PMTU_SUPPORT == ENABLED)
+
+/**
+ * @brief Destination Unreachable message processing
+ *
+ * Only the Fragmentation Needed code is of interest. The path MTU of
+ * the destination of the original datagram is lowered, and any TCP
+ * connection the datagram belongs to adjusts its segment size
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] buffer Multi-part buffer containing the incoming message
+ * @param[in] offset Offset to the first byte of the message
+ **/
+
+void icmpProcessDestUnreachable(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset)
+{
+   uint_t i;
+   size_t n;
+   size_t length;
+   size_t headerLength;
+   size_t mtu;
+   IcmpFragNeededMessage *message;
+   Ipv4Header *ipHeader;
+#if (TCP_SUPPORT == ENABLED)
+   const uint8_t *p;
+   IpPseudoHeader pseudoHeader;
+#endif
+   uint8_t data[sizeof(IcmpFragNeededMessage) + IPV4_MAX_HEADER_LENGTH + 8];
+
+   //MTU plateaus used when the router does not report the
+   //MTU of the next hop (refer to RFC 1191 section 7)
+   static const uint16_t plateau[] =
+   {
+      32000, 17914, 8166, 4352, 2002, 1492, 1006, 508, 296, 68
+   };
+
+   //Copy the message and the beginning of the original datagram
+   length = chunkedBufferRead(data, buffer, offset, sizeof(data));
+
+   //Point to the message and to the header of the original datagram
+   message = (IcmpFragNeededMessage *) data;
+   ipHeader = (Ipv4Header *) message->data;
+
+   //Only the Fragmentation Needed code is processed
+   if(message->code != ICMP_CODE_FRAGMENTATION_NEEDED)
+      return;
+   //Ensure the original IPv4 header is present
+   if(length < (sizeof(IcmpFragNeededMessage) + sizeof(Ipv4Header)))
+      return;
+
+   //Retrieve the length of the original header
+   headerLength = ipHeader->headerLength * 4;
+
+   //Check the original header
+   if(ipHeader->version != IPV4_VERSION || headerLength < sizeof(Ipv4Header))
+      return;
+   if(length < (sizeof(IcmpFragNeededMessage) + headerLength))
+      return;
+
+   //The original datagram must have been sent by the local host
+   if(ipHeader->srcAddr != interface->ipv4Config.addr)
+      return;
+
+   //Length of the original datagram
+   n = ntohs(ipHeader->totalLength);
+   //MTU of the next hop
+   mtu = ntohs(message->nextHopMtu);
+
+   //Old routers leave the field set to zero
+   if(mtu == 0)
+   {
+      //Guess the MTU from the length of the original datagram
+      i = 0;
+      while(i < (arraysize(plateau) - 1) && plateau[i] >= n)
+         i++;
+
+      //Use the largest plateau below the length of the datagram
+      mtu = plateau[i];
+   }
+   //The original datagram must not fit in the reported MTU
+   else if(mtu >= n)
+   {
+      //Debug message
+      TRACE_WARNING("Invalid next-hop MTU!\r\n");
+      //Discard the message
+      return;
+   }
+
+   //Debug message
+   TRACE_INFO("ICMP Fragmentation Needed (next-hop MTU = %u)\r\n", mtu);
+
+   //Lower the path MTU of the destination
+   ipv4UpdatePathMtu(interface, ipHeader->destAddr, mtu);
+
+#if (TCP_SUPPORT == ENABLED)
+   //The original datagram carried a TCP segment?
+   if(ipHeader->protocol == IPV4_PROTOCOL_TCP &&
+      length >= (sizeof(IcmpFragNeededMessage) + headerLength + 8))
+   {
+      //Only the first 8 bytes of the TCP header are quoted, so the ports
+      //and the sequence number are read directly from the raw bytes
+      p = message->data + headerLength;
+
+      //The connection is looked up as for a segment it would receive
+      pseudoHeader.length = sizeof(Ipv4PseudoHeader);
+      pseudoHeader.ipv4Data.srcAddr = ipHeader->destAddr;
+      pseudoHeader.ipv4Data.destAddr = ipHeader->srcAddr;
+
+      //Adjust the segment size of the connection
+      tcpUpdatePathMtu(interface, &pseudoHeader, LOAD16BE(p),
+         LOAD16BE(p + 2), (uint32_t) LOAD32BE(p + 4));
+   }
+#endif
+}
+
+#endif
+
+
 /**
  * @brief Send an ICMP Error message
  * @param[in] interface Underlying network interface
@@ -268,8 +508,9 @@ error_t icmpSendErrorMessage(NetInterface *interface, uint8_t type,
 
    //Get the length of the resulting message
    length = chunkedBufferGetLength(icmpMessage) - offset;
-   //Message checksum calculation
-   icmpHeader->checksum = ipCalcChecksumEx(icmpMessage, offset, length);
+   //Message checksum calculation, unless the hardware inserts it
+   if(!ipv4IsChecksumOffloaded(interface, ipHeader->srcAddr, length))
+      icmpHeader->checksum = ipCalcChecksumEx(icmpMessage, offset, length);
 
    //Format IPv4 pseudo header
    pseudoHeader.srcAddr = ipHeader->destAddr;
@@ -285,7 +526,7 @@ error_t icmpSendErrorMessage(NetInterface *interface, uint8_t type,
 
    //Send ICMP Error message
    error = ipv4SendDatagram(interface, &pseudoHeader,
-      icmpMessage, offset, IPV4_DEFAULT_TTL);
+      icmpMessage, offset, IPV4_DEFAULT_TTL, 0, NULL);
 
    //Free previously allocated memory
    chunkedBufferFree(icmpMessage);
@@ -32,6 +32,13 @@
 //Dependencies
 #include "tcp_ip_stack.h"
 
+//Echo Reply sent straight from the receive buffer
+#ifndef ICMP_ECHO_FAST_PATH_SUPPORT
+   #define ICMP_ECHO_FAST_PATH_SUPPORT DISABLED
+#elif (ICMP_ECHO_FAST_PATH_SUPPORT != ENABLED && ICMP_ECHO_FAST_PATH_SUPPORT != DISABLED)
+   #error ICMP_ECHO_FAST_PATH_SUPPORT parameter is invalid
+#endif
+
 
 /**
  * @brief ICMP message type
@@ -131,6 +138,25 @@ typedef __packed struct
 } IcmpDestUnreachableMessage;
 
 
+/**
+ * @brief ICMP Fragmentation Needed message
+ *
+ * A router that cannot forward a datagram whose DF flag is set
+ * reports the MTU of the next hop (refer to RFC 1191)
+ *
+ **/
+
+typedef __packed struct
+{
+   uint8_t type;        //0
+   uint8_t code;        //1
+   uint16_t checksum;   //2-3
+   uint16_t unused;     //4-5
+   uint16_t nextHopMtu; //6-7
+   uint8_t data[];      //8
+} IcmpFragNeededMessage;
+
+
 /**
  * @brief ICMP Time Exceeded message
  **/
@@ -181,13 +207,36 @@ typedef __packed struct
 #endif
 
 
+/**
+ * @brief Echo Reply turned around in the receive buffer
+ *
+ * The first chunk covers the Ethernet header and the IP packet of the
+ * Echo Request. The other chunks leave room for the padding and the
+ * CRC that ethSendFrame() may append
+ *
+ **/
+
+typedef struct
+{
+   uint_t chunkCount;
+   uint_t maxChunkCount;
+   ChunkDesc chunk[3];
+} IcmpEchoReplyFrame;
+
+
 //ICMP related functions
-void icmpProcessMessage(NetInterface *interface,
+void icmpProcessMessage(NetInterface *interface, const MacAddr *srcMacAddr,
    Ipv4Addr srcIpAddr, const ChunkedBuffer *buffer, size_t offset);
 
-void icmpProcessEchoRequest(NetInterface *interface,
+void icmpProcessEchoRequest(NetInterface *interface, const MacAddr *srcMacAddr,
    Ipv4Addr srcIpAddr, const ChunkedBuffer *request, size_t requestOffset);
 
+error_t icmpTurnAroundEchoRequest(NetInterface *interface, const MacAddr *srcMacAddr,
+   const ChunkedBuffer *request, size_t requestOffset);
+
+void icmpProcessDestUnreachable(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset);
+
 error_t icmpSendErrorMessage(NetInterface *interface, uint8_t type,
    uint8_t code, uint8_t parameter, const ChunkedBuffer *ipPacket);
 
@@ -64,6 +64,12 @@ error_t igmpInit(NetInterface *interface)
    interface->igmpv1RouterPresentTimer =
       osGetTickCount() + IGMP_V1_ROUTER_PRESENT_TIMEOUT;
 
+#if (IPV4_MULTICAST_FILTER_SUPPORT == ENABLED)
+   //IGMPv3 is used until an IGMPv2 query is heard
+   interface->igmpv2RouterPresent = FALSE;
+   interface->igmpv2RouterPresentTimer = interface->igmpv1RouterPresentTimer;
+#endif
+
    //Successful initialization
    return NO_ERROR;
 }
@@ -95,7 +101,7 @@ error_t igmpJoinGroup(NetInterface *interface, Ipv4FilterEntry *entry)
       {
          //When a host joins a multicast group, it should immediately transmit
          //an unsolicited Membership Report for that group
-         igmpSendReportMessage(interface, entry->addr);
+         igmpReportGroup(interface, entry, TRUE);
 
          //Set flag
          entry->flag = TRUE;
@@ -131,9 +137,21 @@ error_t igmpLeaveGroup(NetInterface *interface, Ipv4FilterEntry *entry)
    //Check link state
    if(interface->linkState)
    {
+      //IGMPv3 host compatibility mode?
+      if(IGMP_V3_MODE(interface))
+      {
+         //Leaving a group is reported as a change to an empty include list
+         if(entry->addr != IGMP_ALL_SYSTEMS_ADDR)
+         {
+            igmpSendReportV3Message(interface, entry->addr,
+               IGMP_GROUP_RECORD_TYPE_TO_IN, NULL, 0);
+         }
+      }
       //Send a Leave Group message if the flag is set
-      if(entry->flag)
+      else if(entry->flag)
+      {
          igmpSendLeaveGroupMessage(interface, entry->addr);
+      }
    }
 
    //Switch to the Non-Member state
@@ -144,6 +162,41 @@ error_t igmpLeaveGroup(NetInterface *interface, Ipv4FilterEntry *entry)
 }
 
 
+/**
+ * @brief Report the change of the source filter of a group
+ *
+ * The caller is responsible for holding the IPv4 filter mutex
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] entry IPv4 filter entry whose source filter has changed
+ **/
+
+void igmpStateChange(NetInterface *interface, Ipv4FilterEntry *entry)
+{
+   //The all-systems group (224.0.0.1) is never reported
+   if(entry->addr == IGMP_ALL_SYSTEMS_ADDR)
+      return;
+   //The report is sent when the link comes up
+   if(!interface->linkState)
+      return;
+
+   //Older versions of IGMP do not convey source filters, hence the
+   //membership reported to the routers is left unchanged
+   if(IGMP_V3_MODE(interface))
+   {
+      //Send a State-Change Report for the group
+      igmpReportGroup(interface, entry, TRUE);
+
+      //Set flag
+      entry->flag = TRUE;
+      //The report is retransmitted when the timer expires
+      entry->timer = osGetTickCount() + IGMP_UNSOLICITED_REPORT_INTERVAL;
+      //Enter the Delaying Member state
+      entry->state = IGMP_STATE_DELAYING_MEMBER;
+   }
+}
+
+
 /**
  * @brief IGMP timer handler
  *
@@ -166,6 +219,12 @@ void igmpTick(NetInterface *interface)
    if(timeCompare(time, interface->igmpv1RouterPresentTimer) >= 0)
       interface->igmpv1RouterPresent = FALSE;
 
+#if (IPV4_MULTICAST_FILTER_SUPPORT == ENABLED)
+   //Check IGMPv2 router present timer
+   if(timeCompare(time, interface->igmpv2RouterPresentTimer) >= 0)
+      interface->igmpv2RouterPresent = FALSE;
+#endif
+
    //Acquire exclusive access to the IPv4 filter table
    osMutexAcquire(interface->ipv4FilterMutex);
 
@@ -182,7 +241,7 @@ void igmpTick(NetInterface *interface)
          if(timeCompare(time, entry->timer) >= 0)
          {
             //Send a Membership Report message for the group on the interface
-            igmpSendReportMessage(interface, entry->addr);
+            igmpReportGroup(interface, entry, FALSE);
 
             //Set flag
             entry->flag = TRUE;
@@ -222,6 +281,12 @@ void igmpLinkChangeEvent(NetInterface *interface)
       //Start IGMPv1 router present timer
       interface->igmpv1RouterPresentTimer = time + IGMP_V1_ROUTER_PRESENT_TIMEOUT;
 
+#if (IPV4_MULTICAST_FILTER_SUPPORT == ENABLED)
+      //IGMPv3 is used until an IGMPv2 query is heard
+      interface->igmpv2RouterPresent = FALSE;
+      interface->igmpv2RouterPresentTimer = interface->igmpv1RouterPresentTimer;
+#endif
+
       //Loop through filter table entries
       for(i = 0; i < interface->ipv4FilterSize; i++)
       {
@@ -235,7 +300,7 @@ void igmpLinkChangeEvent(NetInterface *interface)
             continue;
 
          //Send an unsolicited Membership Report for that group
-         igmpSendReportMessage(interface, entry->addr);
+         igmpReportGroup(interface, entry, TRUE);
 
          //Set flag
          entry->flag = TRUE;
@@ -352,8 +417,23 @@ void igmpProcessQueryMessage(NetInterface *interface,
    //Get current time
    time = osGetTickCount();
 
+#if (IPV4_MULTICAST_FILTER_SUPPORT == ENABLED)
+   //IGMPv3 Membership Query message?
+   if(length >= sizeof(IgmpMembershipQueryV3))
+   {
+      //The Max Resp Code field is expressed in units of 1/10 second. Large
+      //values are encoded using a floating-point representation
+      maxRespTime = igmpDecodeFloatingPointValue(message->maxRespTime) * 100;
+
+      //Group-and-Source-Specific Queries are answered with the current
+      //state of the whole group
+   }
+   //IGMPv1 Membership Query message?
+   else if(message->maxRespTime == 0)
+#else
    //IGMPv1 Membership Query message?
    if(message->maxRespTime == 0)
+#endif
    {
       //The host receives a query with the Max Response Time field set to 0
       interface->igmpv1RouterPresent = TRUE;
@@ -365,6 +445,12 @@ void igmpProcessQueryMessage(NetInterface *interface,
    //IGMPv2 Membership Query message?
    else
    {
+#if (IPV4_MULTICAST_FILTER_SUPPORT == ENABLED)
+      //The host falls back to IGMPv2 while IGMPv2 queries are heard
+      interface->igmpv2RouterPresent = TRUE;
+      //Restart IGMPv2 router present timer
+      interface->igmpv2RouterPresentTimer = time + IGMP_V1_ROUTER_PRESENT_TIMEOUT;
+#endif
       //The Max Resp Time field specifies the maximum time allowed
       //before sending a responding report
       maxRespTime = message->maxRespTime * 10;
@@ -436,6 +522,10 @@ void igmpProcessReportMessage(NetInterface *interface,
    uint_t i;
    Ipv4FilterEntry *entry;
 
+   //IGMPv3 hosts do not suppress their reports
+   if(IGMP_V3_MODE(interface))
+      return;
+
    //Acquire exclusive access to the IPv4 filter table
    osMutexAcquire(interface->ipv4FilterMutex);
 
@@ -465,6 +555,44 @@ void igmpProcessReportMessage(NetInterface *interface,
 }
 
 
+/**
+ * @brief Report the membership of a group
+ *
+ * The type of report is determined by the host compatibility mode. IGMPv3
+ * reports carry the current source filter of the group
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] entry IPv4 filter entry identifying the group
+ * @param[in] stateChange Report a change of state rather than the current state
+ * @return Error code
+ **/
+
+error_t igmpReportGroup(NetInterface *interface,
+   const Ipv4FilterEntry *entry, bool_t stateChange)
+{
+#if (IPV4_MULTICAST_FILTER_SUPPORT == ENABLED)
+   uint8_t recordType;
+
+   //IGMPv3 host compatibility mode?
+   if(IGMP_V3_MODE(interface))
+   {
+      //Select the type of group record
+      if(entry->filterMode == IP_FILTER_MODE_INCLUDE)
+         recordType = stateChange ? IGMP_GROUP_RECORD_TYPE_TO_IN : IGMP_GROUP_RECORD_TYPE_IS_IN;
+      else
+         recordType = stateChange ? IGMP_GROUP_RECORD_TYPE_TO_EX : IGMP_GROUP_RECORD_TYPE_IS_EX;
+
+      //Send an IGMPv3 Membership Report message
+      return igmpSendReportV3Message(interface, entry->addr, recordType,
+         entry->srcAddr, entry->srcAddrCount);
+   }
+#endif
+
+   //Send an IGMPv1 or IGMPv2 Membership Report message
+   return igmpSendReportMessage(interface, entry->addr);
+}
+
+
 /**
  * @brief Send Membership Report message
  * @param[in] interface Underlying network interface
@@ -524,7 +652,91 @@ error_t igmpSendReportMessage(NetInterface *interface, Ipv4Addr ipAddr)
    igmpDumpMessage(message);
 
    //The Membership Report message is sent to the group being reported
-   error = ipv4SendDatagram(interface, &pseudoHeader, buffer, offset, IGMP_TTL);
+   error = ipv4SendDatagram(interface, &pseudoHeader, buffer, offset, IGMP_TTL, IP_TOS_NETWORK_CONTROL, NULL);
+
+   //Free previously allocated memory
+   chunkedBufferFree(buffer);
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send IGMPv3 Membership Report message
+ * @param[in] interface Underlying network interface
+ * @param[in] ipAddr IPv4 address specifying the group address
+ * @param[in] recordType Type of the group record
+ * @param[in] srcAddr List of source addresses
+ * @param[in] srcAddrCount Number of source addresses
+ * @return Error code
+ **/
+
+error_t igmpSendReportV3Message(NetInterface *interface, Ipv4Addr ipAddr,
+   uint8_t recordType, const Ipv4Addr *srcAddr, uint_t srcAddrCount)
+{
+   error_t error;
+   uint_t i;
+   size_t length;
+   size_t offset;
+   IgmpMembershipReportV3 *message;
+   ChunkedBuffer *buffer;
+   Ipv4PseudoHeader pseudoHeader;
+
+   //Make sure the specified address is a valid multicast address
+   if(!ipv4IsMulticastAddr(ipAddr))
+      return ERROR_INVALID_ADDRESS;
+
+   //The all-systems group (224.0.0.1) is handled as a special case.
+   //The host never sends a report for that group
+   if(ipAddr == IGMP_ALL_SYSTEMS_ADDR)
+      return ERROR_INVALID_ADDRESS;
+
+   //The report contains a single group record
+   length = sizeof(IgmpMembershipReportV3) + srcAddrCount * sizeof(Ipv4Addr);
+
+   //Allocate a memory buffer to hold an IGMP message
+   buffer = ipAllocBuffer(length, &offset);
+   //Failed to allocate memory?
+   if(!buffer) return ERROR_OUT_OF_MEMORY;
+
+   //Point to the beginning of the IGMP message
+   message = chunkedBufferAt(buffer, offset);
+
+   //Format the Membership Report message
+   message->type = IGMP_TYPE_MEMBERSHIP_REPORT_V3;
+   message->reserved = 0;
+   message->checksum = 0;
+   message->flags = 0;
+   message->numOfGroupRecords = HTONS(1);
+
+   //Format the group record
+   message->record.recordType = recordType;
+   message->record.auxDataLen = 0;
+   message->record.numOfSources = htons(srcAddrCount);
+   message->record.multicastAddr = ipAddr;
+
+   //Copy the list of source addresses
+   for(i = 0; i < srcAddrCount; i++)
+      message->record.srcAddr[i] = srcAddr[i];
+
+   //Message checksum calculation
+   message->checksum = ipCalcChecksumEx(buffer, offset, length);
+
+   //Format IPv4 pseudo header
+   pseudoHeader.srcAddr = interface->ipv4Config.addr;
+   pseudoHeader.destAddr = IGMP_V3_ALL_ROUTERS_ADDR;
+   pseudoHeader.reserved = 0;
+   pseudoHeader.protocol = IPV4_PROTOCOL_IGMP;
+   pseudoHeader.length = htons(length);
+
+   //Debug message
+   TRACE_INFO("Sending IGMPv3 Membership Report (%u bytes)...\r\n", length);
+   TRACE_DEBUG("  Record Type = %u\r\n", recordType);
+   TRACE_DEBUG("  Multicast Address = %s\r\n", ipv4AddrToString(ipAddr, NULL));
+   TRACE_DEBUG("  Number of Sources = %u\r\n", srcAddrCount);
+
+   //Version 3 Reports are sent to the all-IGMPv3-capable-routers group
+   error = ipv4SendDatagram(interface, &pseudoHeader, buffer, offset, IGMP_TTL, IP_TOS_NETWORK_CONTROL, NULL);
 
    //Free previously allocated memory
    chunkedBufferFree(buffer);
@@ -592,7 +804,7 @@ error_t igmpSendLeaveGroupMessage(NetInterface *interface, Ipv4Addr ipAddr)
    igmpDumpMessage(message);
 
    //The Leave Group message is sent to the all-routers multicast group
-   error = ipv4SendDatagram(interface, &pseudoHeader, buffer, offset, IGMP_TTL);
+   error = ipv4SendDatagram(interface, &pseudoHeader, buffer, offset, IGMP_TTL, IP_TOS_NETWORK_CONTROL, NULL);
 
    //Free previously allocated memory
    chunkedBufferFree(buffer);
@@ -614,6 +826,34 @@ uint32_t igmpRand(uint32_t max)
 }
 
 
+/**
+ * @brief Decode a floating-point value
+ *
+ * Max Resp Code values greater than or equal to 128 represent a mantissa
+ * and an exponent (refer to RFC 3376, section 4.1.1)
+ *
+ * @param[in] code Encoded value
+ * @return Decoded value
+ **/
+
+uint32_t igmpDecodeFloatingPointValue(uint8_t code)
+{
+   uint8_t exp;
+   uint8_t mant;
+
+   //Small values are encoded directly
+   if(code < 128)
+      return code;
+
+   //Retrieve the exponent and the mantissa
+   exp = (code >> 4) & 0x07;
+   mant = code & 0x0F;
+
+   //Return the decoded value
+   return (mant | 0x10) << (exp + 3);
+}
+
+
 /**
  * @brief Dump IGMP message for debugging purpose
  * @param[in] message Pointer to the IGMP message
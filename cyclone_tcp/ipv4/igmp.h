@@ -74,6 +74,16 @@
 #define IGMP_ALL_SYSTEMS_ADDR IPV4_ADDR(224, 0, 0, 1)
 //All-Routers address
 #define IGMP_ALL_ROUTERS_ADDR IPV4_ADDR(224, 0, 0, 2)
+//All IGMPv3-capable multicast routers address
+#define IGMP_V3_ALL_ROUTERS_ADDR IPV4_ADDR(224, 0, 0, 22)
+
+//IGMPv3 is used unless an older version querier is present
+#if (IPV4_MULTICAST_FILTER_SUPPORT == ENABLED)
+   #define IGMP_V3_MODE(interface) (!(interface)->igmpv1RouterPresent && \
+      !(interface)->igmpv2RouterPresent)
+#else
+   #define IGMP_V3_MODE(interface) FALSE
+#endif
 
 
 /**
@@ -102,6 +112,21 @@ typedef enum
 } IgmpType;
 
 
+/**
+ * @brief IGMPv3 group record types
+ **/
+
+typedef enum
+{
+   IGMP_GROUP_RECORD_TYPE_IS_IN    = 1,
+   IGMP_GROUP_RECORD_TYPE_IS_EX    = 2,
+   IGMP_GROUP_RECORD_TYPE_TO_IN    = 3,
+   IGMP_GROUP_RECORD_TYPE_TO_EX    = 4,
+   IGMP_GROUP_RECORD_TYPE_ALLOW    = 5,
+   IGMP_GROUP_RECORD_TYPE_BLOCK    = 6
+} IgmpGroupRecordType;
+
+
 #if (defined(__GNUC__) || defined(_WIN32))
    #define __packed
    #pragma pack(push, 1)
@@ -121,6 +146,52 @@ typedef __packed struct
 } IgmpMessage;
 
 
+/**
+ * @brief IGMPv3 Membership Query message
+ **/
+
+typedef __packed struct
+{
+   uint8_t type;          //0
+   uint8_t maxRespCode;   //1
+   uint16_t checksum;     //2-3
+   Ipv4Addr groupAddr;    //4-7
+   uint8_t flags;         //8
+   uint8_t qqic;          //9
+   uint16_t numOfSources; //10-11
+   Ipv4Addr srcAddr[];    //12
+} IgmpMembershipQueryV3;
+
+
+/**
+ * @brief IGMPv3 group record
+ **/
+
+typedef __packed struct
+{
+   uint8_t recordType;     //0
+   uint8_t auxDataLen;     //1
+   uint16_t numOfSources;  //2-3
+   Ipv4Addr multicastAddr; //4-7
+   Ipv4Addr srcAddr[];     //8
+} IgmpGroupRecord;
+
+
+/**
+ * @brief IGMPv3 Membership Report message
+ **/
+
+typedef __packed struct
+{
+   uint8_t type;               //0
+   uint8_t reserved;           //1
+   uint16_t checksum;          //2-3
+   uint16_t flags;             //4-5
+   uint16_t numOfGroupRecords; //6-7
+   IgmpGroupRecord record;     //8
+} IgmpMembershipReportV3;
+
+
 #if (defined(__GNUC__) || defined(_WIN32))
    #undef __packed
    #pragma pack(pop)
@@ -131,6 +202,7 @@ typedef __packed struct
 error_t igmpInit(NetInterface *interface);
 error_t igmpJoinGroup(NetInterface *interface, Ipv4FilterEntry *entry);
 error_t igmpLeaveGroup(NetInterface *interface, Ipv4FilterEntry *entry);
+void igmpStateChange(NetInterface *interface, Ipv4FilterEntry *entry);
 
 void igmpTick(NetInterface *interface);
 void igmpLinkChangeEvent(NetInterface *interface);
@@ -144,10 +216,17 @@ void igmpProcessQueryMessage(NetInterface *interface,
 void igmpProcessReportMessage(NetInterface *interface,
    const IgmpMessage *message, size_t length);
 
+error_t igmpReportGroup(NetInterface *interface,
+   const Ipv4FilterEntry *entry, bool_t stateChange);
+
 error_t igmpSendReportMessage(NetInterface *interface, Ipv4Addr ipAddr);
+
+error_t igmpSendReportV3Message(NetInterface *interface, Ipv4Addr ipAddr,
+   uint8_t recordType, const Ipv4Addr *srcAddr, uint_t srcAddrCount);
 error_t igmpSendLeaveGroupMessage(NetInterface *interface, Ipv4Addr ipAddr);
 
 uint32_t igmpRand(uint32_t max);
+uint32_t igmpDecodeFloatingPointValue(uint8_t code);
 
 void igmpDumpMessage(const IgmpMessage *message);
 
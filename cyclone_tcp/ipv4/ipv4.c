@@ -43,11 +43,14 @@
 #include "arp.h"
 #include "ip.h"
 #include "ipv4.h"
+#include "ip_route.h"
+#include "ip_pmtu.h"
 #include "icmp.h"
 #include "igmp.h"
 #include "udp.h"
 #include "tcp_fsm.h"
 #include "raw_socket.h"
+#include "probe.h"
 #include "debug.h"
 
 //Check TCP/IP stack configuration
@@ -74,25 +77,10 @@ error_t ipv4Init(NetInterface *interface)
 
    //Clear IPv4 filter table contents
    memset(interface->ipv4Filter, 0, sizeof(interface->ipv4Filter));
+   memset(interface->ipv4FilterHashTable, 0, sizeof(interface->ipv4FilterHashTable));
    //No entry in the filter table
    interface->ipv4FilterSize = 0;
 
-#if (IPV4_FRAG_SUPPORT == ENABLED)
-   //Create a mutex to prevent simultaneous access to the reassembly queue
-   interface->ipv4FragQueueMutex = osMutexCreate(FALSE);
-   //Any error to report?
-   if(interface->ipv4FragQueueMutex == OS_INVALID_HANDLE)
-   {
-      //Clean up side effects
-      osMutexClose(interface->ipv4FilterMutex);
-      //Stop immediately
-      return ERROR_OUT_OF_RESOURCES;
-   }
-
-   //Clear the reassembly queue
-   memset(interface->ipv4FragQueue, 0, sizeof(interface->ipv4FragQueue));
-#endif
-
    //Successful initialization
    return NO_ERROR;
 }
@@ -109,40 +97,85 @@ error_t ipv4Init(NetInterface *interface)
 void ipv4ProcessPacket(NetInterface *interface,
    const MacAddr *srcMacAddr, Ipv4Header *packet, size_t length)
 {
+   //Instrumentation point
+   PROBE_ENTER(PROBE_IPV4_PROCESS_PACKET);
+
+   //Update IP statistics
+   IPV4_MIB_INC(interface, ipInReceives);
+
    //Ensure the packet length is greater than 20 bytes
    if(length < sizeof(Ipv4Header))
+   {
+      //Update IP statistics
+      IPV4_MIB_INC(interface, ipInHdrErrors);
+      //Discard incoming packet
       return;
+   }
 
    //Debug message
    TRACE_INFO("IPv4 packet received (%u bytes)...\r\n", length);
    //Dump IP header contents for debugging purpose
    ipv4DumpHeader(packet);
 
-   //A packet whose version number is not 4 must be silently discarded
-   if(packet->version != IPV4_VERSION)
-      return;
-   //Valid IPv4 header shall contains more than five 32-bit words
-   if(packet->headerLength < 5)
-      return;
-   //Ensure the total length is correct before processing the packet
-   if(ntohs(packet->totalLength) < (packet->headerLength * 4))
-      return;
-   if(ntohs(packet->totalLength) > length)
+   //A packet whose version number is not 4 must be silently discarded,
+   //as well as packets whose header length or total length is not valid
+   if(packet->version != IPV4_VERSION || packet->headerLength < 5 ||
+      ntohs(packet->totalLength) < (packet->headerLength * 4) ||
+      ntohs(packet->totalLength) > length)
+   {
+      //Update IP statistics
+      IPV4_MIB_INC(interface, ipInHdrErrors);
+      //Discard incoming packet
       return;
+   }
+
    //Destination address filtering
    if(ipv4CheckDestAddr(interface, packet->destAddr))
+   {
+#if (IP_FORWARD_SUPPORT == ENABLED)
+      //Packets addressed to another host may be forwarded
+      if(interface->ipForwarding)
+      {
+         ipv4ForwardPacket(interface, packet, length);
+         return;
+      }
+#endif
+      //Update IP statistics
+      IPV4_MIB_INC(interface, ipInAddrErrors);
+      //Discard incoming packet
       return;
+   }
+
    //Source address filtering
    if(ipv4CheckSourceAddr(interface, packet->srcAddr))
+   {
+      //Update IP statistics
+      IPV4_MIB_INC(interface, ipInHdrErrors);
+      //Discard incoming packet
+      return;
+   }
+
+#if (IPV4_MULTICAST_FILTER_SUPPORT == ENABLED)
+   //Drop multicast packets sent by unwanted sources
+   if(ipv4CheckSourceFilter(interface, packet->destAddr, packet->srcAddr))
+   {
+      //Update IP statistics
+      IPV4_MIB_INC(interface, ipInAddrErrors);
+      //Discard incoming packet
       return;
+   }
+#endif
 
    //The host must verify the IP header checksum on every received
    //datagram and silently discard every datagram that has a bad
    //checksum (see RFC 1122 3.2.1.2)
-   if(ipCalcChecksum(packet, packet->headerLength * 4) != 0x0000)
+   if(!(interface->nicRxChecksumFlags & NIC_RX_CHECKSUM_IP) &&
+      ipCalcChecksum(packet, packet->headerLength * 4) != 0x0000)
    {
       //Debug message
       TRACE_WARNING("Wrong IP header checksum!\r\n");
+      //Update IP statistics
+      IPV4_MIB_INC(interface, ipInHdrErrors);
       //Discard incoming packet
       return;
    }
@@ -153,13 +186,19 @@ void ipv4ProcessPacket(NetInterface *interface,
    //A fragmented packet was received?
    if(ntohs(packet->fragmentOffset) & (IPV4_FLAG_MF | IPV4_OFFSET_MASK))
    {
+      //The hardware cannot verify the checksum of a reassembled payload
+      interface->nicRxChecksumFlags &= ~NIC_RX_CHECKSUM_PAYLOAD;
+
+      //Update IP statistics
+      IPV4_MIB_INC(interface, ipReasmReqds);
+
 #if (IPV4_FRAG_SUPPORT == ENABLED)
       //Acquire exclusive access to the reassembly queue
-      osMutexAcquire(interface->ipv4FragQueueMutex);
+      osMutexAcquire(interface->ipFragQueueMutex);
       //Reassemble the original datagram
       ipv4ReassembleDatagram(interface, srcMacAddr, packet, length);
       //Release exclusive access to the reassembly queue
-      osMutexRelease(interface->ipv4FragQueueMutex);
+      osMutexRelease(interface->ipFragQueueMutex);
 #endif
    }
    else
@@ -171,6 +210,8 @@ void ipv4ProcessPacket(NetInterface *interface,
       buffer.maxChunkCount = 1;
       buffer.chunk[0].address = packet;
       buffer.chunk[0].length = length;
+      buffer.chunk[0].size = 0;
+      buffer.chunk[0].block = NULL;
 
       //Pass the IPv4 datagram to the higher protocol layer
       ipv4ProcessDatagram(interface, srcMacAddr, (ChunkedBuffer *) &buffer);
@@ -225,12 +266,13 @@ void ipv4ProcessDatagram(NetInterface *interface,
    {
    //ICMP protocol?
    case IPV4_PROTOCOL_ICMP:
-      //Process incoming ICMP message
-      icmpProcessMessage(interface, header->srcAddr, buffer, offset);
 #if (RAW_SOCKET_SUPPORT == ENABLED)
-      //Allow raw sockets to process ICMP messages
+      //Allow raw sockets to process ICMP messages. This must be done first,
+      //since an Echo Request may be turned around in the receive buffer
       rawSocketProcessDatagram(interface, &pseudoHeader, buffer, offset);
 #endif
+      //Process incoming ICMP message
+      icmpProcessMessage(interface, srcMacAddr, header->srcAddr, buffer, offset);
       //No error to report
       error = NO_ERROR;
       //Continue processing
@@ -284,6 +326,12 @@ void ipv4ProcessDatagram(NetInterface *interface,
       break;
    }
 
+   //Update IP statistics
+   if(error == ERROR_PROTOCOL_UNREACHABLE && header->protocol != IPV4_PROTOCOL_UDP)
+      IPV4_MIB_INC(interface, ipInUnknownProtos);
+   else
+      IPV4_MIB_INC(interface, ipInDelivers);
+
    //Unreachable protocol?
    if(error == ERROR_PROTOCOL_UNREACHABLE)
    {
@@ -308,15 +356,22 @@ void ipv4ProcessDatagram(NetInterface *interface,
  * @param[in] buffer Multi-part buffer containing the payload
  * @param[in] offset Offset to the first byte of the payload
  * @param[in] timeToLive TTL value
+ * @param[in] tos Differentiated Services field
+ * @param[in,out] cache Cached path to the destination (optional parameter)
  * @return Error code
  **/
 
 error_t ipv4SendDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
-   ChunkedBuffer *buffer, size_t offset, uint8_t timeToLive)
+   ChunkedBuffer *buffer, size_t offset, uint8_t timeToLive, uint8_t tos, IpPathCache *cache)
 {
    error_t error;
    size_t length;
+   size_t mtu;
    uint16_t id;
+   uint16_t flags;
+
+   //Update IP statistics
+   IPV4_MIB_INC(interface, ipOutRequests);
 
    //Retrieve the length of payload
    length = chunkedBufferGetLength(buffer) - offset;
@@ -325,26 +380,54 @@ error_t ipv4SendDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader
    //fragments of an original IP datagram
    id = osAtomicInc16(&interface->ipv4Identification);
 
-   //If the payload length is smaller than the network
-   //interface MTU then no fragmentation is needed
-   if(length <= IPV4_MAX_PAYLOAD_SIZE)
+#if (IP_PMTU_SUPPORT == ENABLED)
+   //Largest packet that can reach the destination without fragmentation
+   mtu = ipv4GetPathMtu(interface, pseudoHeader->destAddr);
+
+   //Routers must not fragment unicast datagrams, but report the MTU of
+   //the link they could not be forwarded on (refer to RFC 1191)
+   if(!ipv4IsBroadcastAddr(interface, pseudoHeader->destAddr) &&
+      !ipv4IsMulticastAddr(pseudoHeader->destAddr))
+   {
+      flags = IPV4_FLAG_DF;
+   }
+   else
+   {
+      flags = 0;
+   }
+#else
+   //Use the MTU of the network interface
+   mtu = interface->mtu;
+   //Routers are allowed to fragment the datagram
+   flags = 0;
+#endif
+
+   //If the payload length is smaller than the path
+   //MTU then no fragmentation is needed
+   if(length <= (mtu - sizeof(Ipv4Header)))
    {
       //Send data as is
       error = ipv4SendPacket(interface,
-         pseudoHeader, id, 0, buffer, offset, timeToLive);
+         pseudoHeader, id, flags, buffer, offset, timeToLive, tos, cache);
    }
-   //If the payload length exceeds the network interface MTU
+   //If the payload length exceeds the path MTU
    //then the device must fragment the data
    else
    {
 #if (IPV4_FRAG_SUPPORT == ENABLED)
       //Fragment IP datagram into smaller packets
       error = ipv4FragmentDatagram(interface,
-         pseudoHeader, id, buffer, offset, timeToLive);
+         pseudoHeader, id, mtu, buffer, offset, timeToLive, tos);
 #else
       //Fragmentation is not supported
       error = ERROR_MESSAGE_TOO_LONG;
 #endif
+
+      //Update IP statistics
+      if(!error)
+         IPV4_MIB_INC(interface, ipFragOKs);
+      else
+         IPV4_MIB_INC(interface, ipFragFails);
    }
 
    //Return status code
@@ -361,13 +444,17 @@ error_t ipv4SendDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader
  * @param[in] buffer Multi-part buffer containing the payload
  * @param[in] offset Offset to the first byte of the payload
  * @param[in] timeToLive TTL value
+ * @param[in] tos Differentiated Services field
+ * @param[in,out] cache Cached path to the destination (optional parameter)
  * @return Error code
  **/
 
 error_t ipv4SendPacket(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
-   uint16_t fragId, uint16_t fragOffset, ChunkedBuffer *buffer, size_t offset, uint8_t timeToLive)
+   uint16_t fragId, uint16_t fragOffset, ChunkedBuffer *buffer, size_t offset,
+   uint8_t timeToLive, uint8_t tos, IpPathCache *cache)
 {
    error_t error;
+   uint_t generation;
    size_t length;
    Ipv4Addr destIpAddr;
    MacAddr destMacAddr;
@@ -388,7 +475,7 @@ error_t ipv4SendPacket(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
    //Format IPv4 header
    packet->version = IPV4_VERSION;
    packet->headerLength = 5;
-   packet->typeOfService = 0;
+   packet->typeOfService = tos;
    packet->totalLength = htons(length);
    packet->identification = htons(fragId);
    packet->fragmentOffset = htons(fragOffset);
@@ -398,25 +485,41 @@ error_t ipv4SendPacket(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
    packet->srcAddr = pseudoHeader->srcAddr;
    packet->destAddr = pseudoHeader->destAddr;
 
-   //Calculate IP header checksum
-   packet->headerChecksum = ipCalcChecksumEx(buffer, offset, packet->headerLength * 4);
+   //Calculate IP header checksum, unless the hardware inserts it or
+   //the packet is sent to the local host
+   if(!interface->nicDriver->autoChecksumGen && !ipv4IsLocalHostAddr(interface, packet->destAddr))
+      packet->headerChecksum = ipCalcChecksumEx(buffer, offset, packet->headerLength * 4);
 
    //Ensure the source address is valid
    error = ipv4CheckSourceAddr(interface, pseudoHeader->srcAddr);
    //Invalid source address?
    if(error) return error;
 
+   //Any change to the ARP cache made from now on invalidates the result
+   //of the address resolution
+   generation = interface->neighborCacheGen;
+
    //Destination address is the unspecified address?
    if(pseudoHeader->destAddr == IPV4_UNSPECIFIED_ADDR)
    {
       //Destination address is not acceptable
       error = ERROR_INVALID_ADDRESS;
    }
-   //Destination address is the loopback address?
-   else if(pseudoHeader->destAddr == IPV4_LOOPBACK_ADDR)
+   //Destination address is the loopback address or a local address?
+   else if(ipv4IsLocalHostAddr(interface, pseudoHeader->destAddr))
    {
-      //Not yet implemented...
+#if (NIC_LOOPBACK_SUPPORT == ENABLED)
+      //Debug message
+      TRACE_INFO("Sending IPv4 packet to the local host (%u bytes)...\r\n", length);
+      //Dump IP header contents for debugging purpose
+      ipv4DumpHeader(packet);
+
+      //The packet does not go through the network controller
+      return nicLoopbackSendPacket(interface, buffer, offset);
+#else
+      //Loopback is not supported
       error = ERROR_NOT_IMPLEMENTED;
+#endif
    }
    //Destination address is a broadcast address?
    else if(ipv4IsBroadcastAddr(interface, pseudoHeader->destAddr))
@@ -436,29 +539,27 @@ error_t ipv4SendPacket(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
       //Map IPv4 multicast address to MAC-layer multicast address
       error = ipv4MapMulticastAddrToMac(pseudoHeader->destAddr, &destMacAddr);
    }
-   //Destination host is in the local subnet?
-   else if(ipv4IsInLocalSubnet(interface, pseudoHeader->destAddr))
-   {
-      //Destination IPv4 address
-      destIpAddr = pseudoHeader->destAddr;
-      //Resolve host address before sending the packet
-      error = arpResolve(interface, pseudoHeader->destAddr, &destMacAddr);
-   }
-   //Destination host is outside the local subnet?
+   //Destination address is a unicast address?
    else
    {
-      //Make sure the default gateway is properly set
-      if(interface->ipv4Config.defaultGateway != IPV4_UNSPECIFIED_ADDR)
+      //Determine the next hop (local host, static route or default gateway)
+      error = ipv4GetNextHop(interface, pseudoHeader->destAddr, &destIpAddr);
+
+      //The link-layer address of the next hop is already known?
+      if(!error && ipv4CheckPathCache(interface, cache, pseudoHeader->destAddr, destIpAddr))
       {
-         //Use the default gateway to forward the packet
-         destIpAddr = interface->ipv4Config.defaultGateway;
-         //Perform address resolution
-         error = arpResolve(interface, interface->ipv4Config.defaultGateway, &destMacAddr);
+         //Skip address resolution
+         destMacAddr = cache->macAddr;
       }
-      else
+      else if(!error)
       {
-         //There is no route to the outside world...
-         error = ERROR_NO_ROUTE;
+         //Perform address resolution
+         error = arpResolve(interface, destIpAddr, &destMacAddr);
+
+         //Save the resolved path for subsequent packets
+         if(!error)
+            ipv4UpdatePathCache(interface, cache, generation,
+               pseudoHeader->destAddr, destIpAddr, &destMacAddr);
       }
    }
 
@@ -491,11 +592,123 @@ error_t ipv4SendPacket(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
       TRACE_WARNING("Cannot map IPv4 address to Ethernet address!\r\n");
    }
 
+   //Update IP statistics
+   if(error == ERROR_NO_ROUTE)
+      IPV4_MIB_INC(interface, ipOutNoRoutes);
+   else if(error)
+      IPV4_MIB_INC(interface, ipOutDiscards);
+
    //Return status code
    return error;
 }
 
 
+/**
+ * @brief Determine the next hop to a unicast destination
+ * @param[in] interface Underlying network interface
+ * @param[in] destAddr Destination IPv4 address
+ * @param[out] nextHop Next-hop IPv4 address
+ * @return Error code
+ **/
+
+error_t ipv4GetNextHop(NetInterface *interface, Ipv4Addr destAddr, Ipv4Addr *nextHop)
+{
+   error_t error;
+
+   //Destination host is in the local subnet?
+   if(ipv4IsInLocalSubnet(interface, destAddr))
+   {
+      //The next hop is the destination itself
+      *nextHop = destAddr;
+      error = NO_ERROR;
+   }
+   else
+   {
+#if (IP_ROUTE_SUPPORT == ENABLED)
+      //Use the most specific static route, if any
+      error = ipv4RouteLookup(interface, destAddr, nextHop);
+#else
+      //Static routes are not supported
+      error = ERROR_NO_ROUTE;
+#endif
+
+      //No static route to the destination?
+      if(error == ERROR_NO_ROUTE)
+      {
+         //Make sure the default gateway is properly set
+         if(interface->ipv4Config.defaultGateway != IPV4_UNSPECIFIED_ADDR)
+         {
+            //Use the default gateway to forward the packet
+            *nextHop = interface->ipv4Config.defaultGateway;
+            error = NO_ERROR;
+         }
+      }
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Check whether a cached path can be used
+ * @param[in] interface Underlying network interface
+ * @param[in] cache Cached path to the destination (may be NULL)
+ * @param[in] destAddr Destination IPv4 address
+ * @param[in] nextHop Next hop selected for this packet
+ * @return TRUE if the link-layer address of the next hop is up to date
+ **/
+
+bool_t ipv4CheckPathCache(NetInterface *interface,
+   const IpPathCache *cache, Ipv4Addr destAddr, Ipv4Addr nextHop)
+{
+   //No cache or no resolved path?
+   if(cache == NULL || !cache->valid)
+      return FALSE;
+   //The path must have been resolved on the same interface
+   if(cache->interface != interface || cache->destAddr.length != sizeof(Ipv4Addr))
+      return FALSE;
+   //Has any neighbor been updated or removed since then?
+   if(cache->generation != interface->neighborCacheGen)
+      return FALSE;
+   //The destination must still be reached through the same next hop
+   if(cache->destAddr.ipv4Addr != destAddr || cache->nextHop.ipv4Addr != nextHop)
+      return FALSE;
+
+   //The cached link-layer address can be used
+   return TRUE;
+}
+
+
+/**
+ * @brief Save the outcome of routing and address resolution
+ * @param[in] interface Underlying network interface
+ * @param[out] cache Cached path to the destination (may be NULL)
+ * @param[in] generation Neighbor cache generation sampled before resolution
+ * @param[in] destAddr Destination IPv4 address
+ * @param[in] nextHop Next-hop IPv4 address
+ * @param[in] macAddr Link-layer address of the next hop
+ **/
+
+void ipv4UpdatePathCache(NetInterface *interface, IpPathCache *cache,
+   uint_t generation, Ipv4Addr destAddr, Ipv4Addr nextHop, const MacAddr *macAddr)
+{
+   //Nothing to do if the caller does not maintain a cache
+   if(cache == NULL)
+      return;
+
+   //Save the resolved path
+   cache->interface = interface;
+   cache->generation = generation;
+   cache->destAddr.length = sizeof(Ipv4Addr);
+   cache->destAddr.ipv4Addr = destAddr;
+   cache->nextHop.length = sizeof(Ipv4Addr);
+   cache->nextHop.ipv4Addr = nextHop;
+   cache->macAddr = *macAddr;
+   cache->valid = TRUE;
+}
+
+
 /**
  * @brief Source IPv4 address filtering
  * @param[in] interface Underlying network interface
@@ -529,13 +742,35 @@ error_t ipv4CheckSourceAddr(NetInterface *interface, Ipv4Addr ipAddr)
 
 error_t ipv4CheckDestAddr(NetInterface *interface, Ipv4Addr ipAddr)
 {
+   Ipv4FilterEntry *entry;
+
    //Host IPv4 address?
    if(ipAddr == interface->ipv4Config.addr)
       return NO_ERROR;
+#if (NIC_LOOPBACK_SUPPORT == ENABLED)
+   //The loopback address is only valid for packets that never left the host
+   if(ipAddr == IPV4_LOOPBACK_ADDR && interface->nicRxLoopback)
+      return NO_ERROR;
+#endif
    //Broadcast address?
    if(ipv4IsBroadcastAddr(interface, ipAddr))
       return NO_ERROR;
 
+   //Multicast address?
+   if(ipv4IsMulticastAddr(ipAddr))
+   {
+      //Acquire exclusive access to the IPv4 filter table
+      osMutexAcquire(interface->ipv4FilterMutex);
+      //Check whether the host is a member of the group
+      entry = ipv4FindFilterEntry(interface, ipAddr);
+      //Release exclusive access to the IPv4 filter table
+      osMutexRelease(interface->ipv4FilterMutex);
+
+      //The specified IPv4 address is acceptable?
+      if(entry != NULL)
+         return NO_ERROR;
+   }
+
    //Debug message
    TRACE_WARNING("Wrong destination IPv4 address!\r\n");
    //The destination address is not acceptable
@@ -559,18 +794,117 @@ error_t ipv4CheckDestAddr(NetInterface *interface, Ipv4Addr ipAddr)
 error_t ipv4SelectSourceAddr(NetInterface **interface,
    Ipv4Addr destAddr, Ipv4Addr *srcAddr)
 {
-   //Use default network interface?
+   uint_t i;
+   NetInterface *p;
+#if (IP_ROUTE_SUPPORT == ENABLED)
+   IpAddr ipAddr;
+#endif
+
+   //No interface specified?
    if(*interface == NULL)
-      *interface = tcpIpStackGetDefaultInterface();
+   {
+      //Prefer an interface attached to the destination subnet
+      for(i = 0; i < NET_INTERFACE_COUNT && *interface == NULL; i++)
+      {
+         //Point to the current interface
+         p = &netInterface[i];
+
+         //Check whether the destination is on-link
+         if(p->configured && p->ipv4Config.subnetMask != IPV4_UNSPECIFIED_ADDR &&
+            ipv4IsInLocalSubnet(p, destAddr))
+         {
+            *interface = p;
+         }
+      }
+
+#if (IP_ROUTE_SUPPORT == ENABLED)
+      //Otherwise let the routing table decide
+      if(*interface == NULL)
+      {
+         ipAddr.length = sizeof(Ipv4Addr);
+         ipAddr.ipv4Addr = destAddr;
+         ipRouteLookup(&ipAddr, interface, NULL);
+      }
+#endif
+
+      //Use default network interface?
+      if(*interface == NULL)
+         *interface = tcpIpStackGetDefaultInterface();
+   }
 
    //Select the most appropriate source address
-   *srcAddr = (*interface)->ipv4Config.addr;
+   if(destAddr == IPV4_LOOPBACK_ADDR)
+      *srcAddr = IPV4_LOOPBACK_ADDR;
+   else
+      *srcAddr = (*interface)->ipv4Config.addr;
 
    //Successful processing
    return NO_ERROR;
 }
 
 
+/**
+ * @brief Check whether an IPv4 address designates the local host
+ * @param[in] interface Underlying network interface
+ * @param[in] ipAddr IPv4 address to be checked
+ * @return TRUE if the address is the loopback address or the address
+ *   assigned to the interface, else FALSE
+ **/
+
+bool_t ipv4IsLocalHostAddr(NetInterface *interface, Ipv4Addr ipAddr)
+{
+   //Loopback address?
+   if(ipAddr == IPV4_LOOPBACK_ADDR)
+      return TRUE;
+   //Address assigned to the interface?
+   else if(ipAddr != IPV4_UNSPECIFIED_ADDR && ipAddr == interface->ipv4Config.addr)
+      return TRUE;
+   else
+      return FALSE;
+}
+
+
+/**
+ * @brief Check whether the checksum of an IPv4 payload can be omitted
+ *
+ * The network controller can only insert TCP, UDP and ICMP checksums
+ * when the datagram is sent in a single packet. The same applies to
+ * datagrams sent to the local host, which are never verified on receipt
+ * unless they have to be reassembled
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] destAddr Destination IPv4 address
+ * @param[in] length Length of the IPv4 payload
+ * @return TRUE if the checksum need not be computed in software, else FALSE
+ **/
+
+bool_t ipv4IsChecksumOffloaded(NetInterface *interface, Ipv4Addr destAddr, size_t length)
+{
+   //Datagrams that are fragmented must carry a valid checksum
+   if(length > IPV4_MAX_PAYLOAD_SIZE(interface))
+      return FALSE;
+
+#if (IP_PMTU_SUPPORT == ENABLED)
+   //So are the datagrams that exceed the path MTU
+   if((length + sizeof(Ipv4Header)) > ipv4GetPathMtu(interface, destAddr))
+      return FALSE;
+#endif
+
+   //Check whether the checksum can be offloaded to the hardware
+   if(interface->nicDriver->autoChecksumGen)
+      return TRUE;
+
+#if (NIC_LOOPBACK_SUPPORT == ENABLED)
+   //Packets sent to the local host are not checked on receipt
+   if(ipv4IsLocalHostAddr(interface, destAddr))
+      return TRUE;
+#endif
+
+   //The checksum must be computed in software
+   return FALSE;
+}
+
+
 /**
  * @brief Join the specified host group
  * @param[in] interface Underlying network interface
@@ -583,6 +917,7 @@ error_t ipv4JoinMulticastGroup(NetInterface *interface, Ipv4Addr groupAddr)
    error_t error;
    uint_t i;
    MacAddr macAddr;
+   Ipv4FilterEntry *entry;
 
    //Ensure the specified IPv4 address is a multicast address
    if(!ipv4IsMulticastAddr(groupAddr))
@@ -591,21 +926,23 @@ error_t ipv4JoinMulticastGroup(NetInterface *interface, Ipv4Addr groupAddr)
    //Acquire exclusive access to the IPv4 filter table
    osMutexAcquire(interface->ipv4FilterMutex);
 
-   //Loop through filter table entries
-   for(i = 0; i < interface->ipv4FilterSize; i++)
+   //Check whether the table already contains the specified IPv4 address
+   entry = ipv4FindFilterEntry(interface, groupAddr);
+
+   //Matching entry found?
+   if(entry != NULL)
    {
-      //Check whether the table already contains the specified IPv4 address
-      if(interface->ipv4Filter[i].addr == groupAddr)
-      {
-         //Increment the reference count
-         interface->ipv4Filter[i].refCount++;
-         //Release exclusive access to the IPv4 filter table
-         osMutexRelease(interface->ipv4FilterMutex);
-         //No error to report
-         return NO_ERROR;
-      }
+      //Increment the reference count
+      entry->refCount++;
+      //Release exclusive access to the IPv4 filter table
+      osMutexRelease(interface->ipv4FilterMutex);
+      //No error to report
+      return NO_ERROR;
    }
 
+   //Index of the first free entry
+   i = interface->ipv4FilterSize;
+
    //The IPv4 filter table is full ?
    if(i >= IPV4_FILTER_MAX_SIZE)
    {
@@ -627,8 +964,15 @@ error_t ipv4JoinMulticastGroup(NetInterface *interface, Ipv4Addr groupAddr)
       interface->ipv4Filter[i].addr = groupAddr;
       //Initialize the reference count
       interface->ipv4Filter[i].refCount = 1;
+#if (IPV4_MULTICAST_FILTER_SUPPORT == ENABLED)
+      //Traffic from any source is accepted until a filter is set
+      interface->ipv4Filter[i].filterMode = IP_FILTER_MODE_EXCLUDE;
+      interface->ipv4Filter[i].srcAddrCount = 0;
+#endif
       //Adjust the size of the IPv4 filter table
       interface->ipv4FilterSize++;
+      //Update the hash table used to look up the filter table
+      ipv4UpdateFilterHash(interface);
 
 #if (IGMP_SUPPORT == ENABLED)
       //Report multicast group membership to the router
@@ -655,6 +999,7 @@ error_t ipv4LeaveMulticastGroup(NetInterface *interface, Ipv4Addr groupAddr)
    uint_t i;
    uint_t j;
    MacAddr macAddr;
+   Ipv4FilterEntry *entry;
 
    //Ensure the specified IPv4 address is a multicast address
    if(!ipv4IsMulticastAddr(groupAddr))
@@ -663,46 +1008,264 @@ error_t ipv4LeaveMulticastGroup(NetInterface *interface, Ipv4Addr groupAddr)
    //Acquire exclusive access to the IPv4 filter table
    osMutexAcquire(interface->ipv4FilterMutex);
 
-   //Loop through filter table entries
-   for(i = 0; i < interface->ipv4FilterSize; i++)
+   //Search the table for the specified IPv4 address
+   entry = ipv4FindFilterEntry(interface, groupAddr);
+
+   //The specified IPv4 address does not exist?
+   if(entry == NULL)
    {
-      //Specified IPv4 address found?
-      if(interface->ipv4Filter[i].addr == groupAddr)
-      {
-         //Decrement the reference count
-         interface->ipv4Filter[i].refCount--;
+      //Release exclusive access to the IPv4 filter table
+      osMutexRelease(interface->ipv4FilterMutex);
+      //Report an error
+      return ERROR_FAILURE;
+   }
 
-         //Remove the entry if the reference count drops to zero
-         if(interface->ipv4Filter[i].refCount < 1)
-         {
+   //Decrement the reference count
+   entry->refCount--;
+
+   //Remove the entry if the reference count drops to zero
+   if(entry->refCount < 1)
+   {
 #if (IGMP_SUPPORT == ENABLED)
-            //Report group membership termination
-            igmpLeaveGroup(interface, &interface->ipv4Filter[i]);
+      //Report group membership termination
+      igmpLeaveGroup(interface, entry);
 #endif
-            //Map the multicast IPv4 address to a MAC-layer address
-            ipv4MapMulticastAddrToMac(groupAddr, &macAddr);
-            //Drop the corresponding address from the MAC filter table
-            ethDropMulticastAddr(interface, &macAddr);
+      //Map the multicast IPv4 address to a MAC-layer address
+      ipv4MapMulticastAddrToMac(groupAddr, &macAddr);
+      //Drop the corresponding address from the MAC filter table
+      ethDropMulticastAddr(interface, &macAddr);
 
-            //Adjust the size of the IPv4 filter table
-            interface->ipv4FilterSize--;
+      //Index of the entry in the IPv4 filter table
+      i = entry - interface->ipv4Filter;
+      //Adjust the size of the IPv4 filter table
+      interface->ipv4FilterSize--;
 
-            //Remove the corresponding entry
-            for(j = i; j < interface->ipv4FilterSize; j++)
-               interface->ipv4Filter[j] = interface->ipv4Filter[j + 1];
-         }
+      //Remove the corresponding entry
+      for(j = i; j < interface->ipv4FilterSize; j++)
+         interface->ipv4Filter[j] = interface->ipv4Filter[j + 1];
 
-         //Release exclusive access to the IPv4 filter table
-         osMutexRelease(interface->ipv4FilterMutex);
-         //No error to report
-         return NO_ERROR;
+      //Entries have moved, so the hash table must be rebuilt
+      ipv4UpdateFilterHash(interface);
+   }
+
+   //Release exclusive access to the IPv4 filter table
+   osMutexRelease(interface->ipv4FilterMutex);
+   //No error to report
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set the source filter of a host group
+ *
+ * The group must have been joined beforehand. In include mode, only the
+ * traffic sent by the listed sources is accepted. In exclude mode, the
+ * traffic sent by the listed sources is dropped. The new filter state is
+ * reported to the routers so that they can prune unwanted sources
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] groupAddr IPv4 address identifying the host group
+ * @param[in] filterMode Filter mode (include or exclude)
+ * @param[in] srcAddr List of source addresses
+ * @param[in] srcAddrCount Number of source addresses
+ * @return Error code
+ **/
+
+error_t ipv4SetMulticastSourceFilter(NetInterface *interface, Ipv4Addr groupAddr,
+   uint_t filterMode, const Ipv4Addr *srcAddr, uint_t srcAddrCount)
+{
+#if (IPV4_MULTICAST_FILTER_SUPPORT == ENABLED)
+   uint_t i;
+   Ipv4FilterEntry *entry;
+
+   //Ensure the specified IPv4 address is a multicast address
+   if(!ipv4IsMulticastAddr(groupAddr))
+      return ERROR_INVALID_ADDRESS;
+   //Check filter mode
+   if(filterMode != IP_FILTER_MODE_INCLUDE && filterMode != IP_FILTER_MODE_EXCLUDE)
+      return ERROR_INVALID_PARAMETER;
+   //Check the number of source addresses
+   if(srcAddrCount > IPV4_MAX_MULTICAST_SRC_ADDRS)
+      return ERROR_INVALID_PARAMETER;
+   if(srcAddrCount > 0 && srcAddr == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Source addresses must be unicast addresses
+   for(i = 0; i < srcAddrCount; i++)
+   {
+      //Check current address
+      if(ipv4IsMulticastAddr(srcAddr[i]) || srcAddr[i] == IPV4_UNSPECIFIED_ADDR)
+         return ERROR_INVALID_ADDRESS;
+   }
+
+   //Acquire exclusive access to the IPv4 filter table
+   osMutexAcquire(interface->ipv4FilterMutex);
+
+   //Search the table for the specified IPv4 address
+   entry = ipv4FindFilterEntry(interface, groupAddr);
+
+   //The group has not been joined?
+   if(entry == NULL)
+   {
+      //Release exclusive access to the IPv4 filter table
+      osMutexRelease(interface->ipv4FilterMutex);
+      //Report an error
+      return ERROR_FAILURE;
+   }
+
+   //Save the new source filter
+   entry->filterMode = filterMode;
+   entry->srcAddrCount = srcAddrCount;
+
+   //Copy the list of source addresses
+   for(i = 0; i < srcAddrCount; i++)
+      entry->srcAddr[i] = srcAddr[i];
+
+#if (IGMP_SUPPORT == ENABLED)
+   //Report the change of the source filter to the routers
+   igmpStateChange(interface, entry);
+#endif
+
+   //Release exclusive access to the IPv4 filter table
+   osMutexRelease(interface->ipv4FilterMutex);
+   //No error to report
+   return NO_ERROR;
+#else
+   //Source-specific multicast is not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Check the source of a multicast packet against the group filter
+ * @param[in] interface Underlying network interface
+ * @param[in] groupAddr Destination IPv4 address
+ * @param[in] srcAddr Source IPv4 address
+ * @return Error code
+ **/
+
+error_t ipv4CheckSourceFilter(NetInterface *interface,
+   Ipv4Addr groupAddr, Ipv4Addr srcAddr)
+{
+#if (IPV4_MULTICAST_FILTER_SUPPORT == ENABLED)
+   uint_t i;
+   bool_t accept;
+   Ipv4FilterEntry *entry;
+
+   //Unicast and broadcast packets are not subject to source filtering
+   if(!ipv4IsMulticastAddr(groupAddr))
+      return NO_ERROR;
+
+   //Accept the packet by default
+   accept = TRUE;
+
+   //Acquire exclusive access to the IPv4 filter table
+   osMutexAcquire(interface->ipv4FilterMutex);
+
+   //Search the table for the specified group
+   entry = ipv4FindFilterEntry(interface, groupAddr);
+
+   //Matching entry found?
+   if(entry != NULL)
+   {
+      //Look for the source address in the list
+      for(i = 0; i < entry->srcAddrCount; i++)
+      {
+         //Matching address?
+         if(entry->srcAddr[i] == srcAddr)
+            break;
       }
+
+      //In include mode, the source must be listed. In exclude
+      //mode, the source must not be listed
+      if(entry->filterMode == IP_FILTER_MODE_INCLUDE)
+         accept = (i < entry->srcAddrCount);
+      else
+         accept = (i >= entry->srcAddrCount);
    }
 
    //Release exclusive access to the IPv4 filter table
    osMutexRelease(interface->ipv4FilterMutex);
-   //The specified IPv4 address does not exist
-   return ERROR_FAILURE;
+
+   //Return status code
+   return accept ? NO_ERROR : ERROR_INVALID_ADDRESS;
+#else
+   //Source filtering is not supported
+   return NO_ERROR;
+#endif
+}
+
+
+/**
+ * @brief Search the IPv4 filter table for a given address
+ *
+ * The caller is responsible for holding the IPv4 filter mutex
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] ipAddr IPv4 host group address
+ * @return Matching entry, or NULL if the address is not in the table
+ **/
+
+Ipv4FilterEntry *ipv4FindFilterEntry(NetInterface *interface, Ipv4Addr ipAddr)
+{
+   Ipv4FilterEntry *entry;
+
+   //Walk the hash bucket the address maps to
+   for(entry = interface->ipv4FilterHashTable[ipv4CalcFilterHash(ipAddr)];
+      entry != NULL; entry = entry->hashNext)
+   {
+      //Matching entry?
+      if(entry->addr == ipAddr)
+         return entry;
+   }
+
+   //The address is not in the table
+   return NULL;
+}
+
+
+/**
+ * @brief Rebuild the hash table used to look up the IPv4 filter table
+ * @param[in] interface Underlying network interface
+ **/
+
+void ipv4UpdateFilterHash(NetInterface *interface)
+{
+   uint_t i;
+   uint_t k;
+
+   //Clear hash table
+   memset(interface->ipv4FilterHashTable, 0, sizeof(interface->ipv4FilterHashTable));
+
+   //Loop through the IPv4 filter table
+   for(i = 0; i < interface->ipv4FilterSize; i++)
+   {
+      //Insert the entry in the corresponding hash bucket
+      k = ipv4CalcFilterHash(interface->ipv4Filter[i].addr);
+      interface->ipv4Filter[i].hashNext = interface->ipv4FilterHashTable[k];
+      interface->ipv4FilterHashTable[k] = &interface->ipv4Filter[i];
+   }
+}
+
+
+/**
+ * @brief Hash function used to look up the IPv4 filter table
+ * @param[in] ipAddr IPv4 host group address
+ * @return Index of the hash bucket
+ **/
+
+uint_t ipv4CalcFilterHash(Ipv4Addr ipAddr)
+{
+   uint32_t h;
+
+   //Fold the address
+   h = ipAddr;
+   h ^= h >> 16;
+   h ^= h >> 8;
+
+   //Return the index of the hash bucket
+   return h & (IPV4_FILTER_HASH_TABLE_SIZE - 1);
 }
 
 
@@ -62,6 +62,27 @@
    #error IPV4_FILTER_MAX_SIZE parameter is invalid
 #endif
 
+//Size of the hash table used to look up the IPv4 filter table (must be a power of two)
+#ifndef IPV4_FILTER_HASH_TABLE_SIZE
+   #define IPV4_FILTER_HASH_TABLE_SIZE 8
+#elif (IPV4_FILTER_HASH_TABLE_SIZE < 1 || (IPV4_FILTER_HASH_TABLE_SIZE & (IPV4_FILTER_HASH_TABLE_SIZE - 1)))
+   #error IPV4_FILTER_HASH_TABLE_SIZE parameter is invalid
+#endif
+
+//Source-specific multicast filtering (IGMPv3)
+#ifndef IPV4_MULTICAST_FILTER_SUPPORT
+   #define IPV4_MULTICAST_FILTER_SUPPORT DISABLED
+#elif (IPV4_MULTICAST_FILTER_SUPPORT != ENABLED && IPV4_MULTICAST_FILTER_SUPPORT != DISABLED)
+   #error IPV4_MULTICAST_FILTER_SUPPORT parameter is invalid
+#endif
+
+//Maximum number of source addresses per multicast group
+#ifndef IPV4_MAX_MULTICAST_SRC_ADDRS
+   #define IPV4_MAX_MULTICAST_SRC_ADDRS 4
+#elif (IPV4_MAX_MULTICAST_SRC_ADDRS < 1)
+   #error IPV4_MAX_MULTICAST_SRC_ADDRS parameter is invalid
+#endif
+
 //Version number for IPv4
 #define IPV4_VERSION 4
 //Minimum MTU that routers and physical links are required to handle
@@ -70,8 +91,8 @@
 #define IPV4_MIN_HEADER_LENGTH 20
 //Maximum header length
 #define IPV4_MAX_HEADER_LENGTH 60
-//Maximum payload size
-#define IPV4_MAX_PAYLOAD_SIZE (ETH_MTU - sizeof(Ipv4Header))
+//Maximum payload size for the specified interface
+#define IPV4_MAX_PAYLOAD_SIZE(interface) ((interface)->mtu - sizeof(Ipv4Header))
 //Shortcut to data field
 #define IPV4_DATA(packet) PTR_OFFSET(packet, packet->headerLength * 4)
 
@@ -236,13 +257,19 @@ typedef struct
  * @brief IPv4 filter table entry
  **/
 
-typedef struct
+typedef struct _Ipv4FilterEntry
 {
-   Ipv4Addr addr;    ///<IPv4 address
-   uint_t refCount;  ///<Reference count for the current entry
-   uint_t state;     ///<IGMP host state
-   bool_t flag;      ///<IGMP flag
-   time_t timer;     ///<Delay timer
+   Ipv4Addr addr;                     ///<IPv4 address
+   uint_t refCount;                   ///<Reference count for the current entry
+   uint_t state;                      ///<IGMP host state
+   bool_t flag;                       ///<IGMP flag
+   time_t timer;                      ///<Delay timer
+#if (IPV4_MULTICAST_FILTER_SUPPORT == ENABLED)
+   uint_t filterMode;                 ///<Source filter mode (include or exclude)
+   uint_t srcAddrCount;               ///<Number of source addresses
+   Ipv4Addr srcAddr[IPV4_MAX_MULTICAST_SRC_ADDRS]; ///<Source addresses
+#endif
+   struct _Ipv4FilterEntry *hashNext; ///<Next entry in the same hash bucket
 } Ipv4FilterEntry;
 
 
@@ -256,10 +283,19 @@ void ipv4ProcessDatagram(NetInterface *interface,
    const MacAddr *srcMacAddr, const ChunkedBuffer *buffer);
 
 error_t ipv4SendDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
-   ChunkedBuffer *buffer, size_t offset, uint8_t timeToLive);
+   ChunkedBuffer *buffer, size_t offset, uint8_t timeToLive, uint8_t tos, IpPathCache *cache);
 
 error_t ipv4SendPacket(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
-   uint16_t fragId, uint16_t fragOffset, ChunkedBuffer *buffer, size_t offset, uint8_t timeToLive);
+   uint16_t fragId, uint16_t fragOffset, ChunkedBuffer *buffer, size_t offset,
+   uint8_t timeToLive, uint8_t tos, IpPathCache *cache);
+
+error_t ipv4GetNextHop(NetInterface *interface, Ipv4Addr destAddr, Ipv4Addr *nextHop);
+
+bool_t ipv4CheckPathCache(NetInterface *interface,
+   const IpPathCache *cache, Ipv4Addr destAddr, Ipv4Addr nextHop);
+
+void ipv4UpdatePathCache(NetInterface *interface, IpPathCache *cache,
+   uint_t generation, Ipv4Addr destAddr, Ipv4Addr nextHop, const MacAddr *macAddr);
 
 error_t ipv4CheckSourceAddr(NetInterface *interface, Ipv4Addr ipAddr);
 error_t ipv4CheckDestAddr(NetInterface *interface, Ipv4Addr ipAddr);
@@ -267,9 +303,22 @@ error_t ipv4CheckDestAddr(NetInterface *interface, Ipv4Addr ipAddr);
 error_t ipv4SelectSourceAddr(NetInterface **interface,
    Ipv4Addr destAddr, Ipv4Addr *srcAddr);
 
+bool_t ipv4IsLocalHostAddr(NetInterface *interface, Ipv4Addr ipAddr);
+bool_t ipv4IsChecksumOffloaded(NetInterface *interface, Ipv4Addr destAddr, size_t length);
+
 error_t ipv4JoinMulticastGroup(NetInterface *interface, Ipv4Addr groupAddr);
 error_t ipv4LeaveMulticastGroup(NetInterface *interface, Ipv4Addr groupAddr);
 
+error_t ipv4SetMulticastSourceFilter(NetInterface *interface, Ipv4Addr groupAddr,
+   uint_t filterMode, const Ipv4Addr *srcAddr, uint_t srcAddrCount);
+
+error_t ipv4CheckSourceFilter(NetInterface *interface,
+   Ipv4Addr groupAddr, Ipv4Addr srcAddr);
+
+Ipv4FilterEntry *ipv4FindFilterEntry(NetInterface *interface, Ipv4Addr ipAddr);
+void ipv4UpdateFilterHash(NetInterface *interface);
+uint_t ipv4CalcFilterHash(Ipv4Addr ipAddr);
+
 error_t ipv4MapMulticastAddrToMac(Ipv4Addr ipAddr, MacAddr *macAddr);
 
 error_t ipv4StringToAddr(const char_t *str, Ipv4Addr *ipAddr);
@@ -40,15 +40,7 @@
    #error IPV4_FRAG_SUPPORT parameter is invalid
 #endif
 
-//Reassembly algorithm tick interval
-#ifndef IPV4_FRAG_TICK_INTERVAL
-   #define IPV4_FRAG_TICK_INTERVAL 1000
-#elif (IPV4_FRAG_TICK_INTERVAL < 100)
-   #error IPV4_FRAG_TICK_INTERVAL parameter is invalid
-#endif
-
-//Maximum number of fragmented packets the host will accept
-//and hold in the reassembly queue simultaneously
+//Number of entries IPv4 contributes to the shared reassembly queue
 #ifndef IPV4_MAX_FRAG_DATAGRAMS
    #define IPV4_MAX_FRAG_DATAGRAMS 4
 #elif (IPV4_MAX_FRAG_DATAGRAMS < 1)
@@ -70,74 +62,15 @@
 #endif
 
 //Maximum payload size for fragmented packets (shall be a multiple of 8-byte blocks)
-#define IPV4_MAX_FRAG_SIZE (IPV4_MAX_PAYLOAD_SIZE & ~0x0007)
-//Infinity is implemented by a very large integer
-#define IPV4_INFINITY 0xFFFF
-
-
-#if (defined(__GNUC__) || defined(_WIN32))
-   #define __packed
-   #pragma pack(push, 1)
-#endif
-
-
-/**
- * @brief Hole descriptor
- **/
-
-__packed typedef struct
-{
-   uint16_t first;
-   uint16_t last;
-   uint16_t next;
-} Ipv4HoleDesc;
-
-
-#if (defined(__GNUC__) || defined(_WIN32))
-   #undef __packed
-   #pragma pack(pop)
-#endif
-
-
-/**
- * @brief Reassembly buffer
- **/
-
-typedef struct
-{
-   uint_t chunkCount;
-   uint_t maxChunkCount;
-   ChunkDesc chunk[N(IPV4_MAX_FRAG_DATAGRAM_SIZE) + 1];
-} Ipv4ReassemblyBuffer;
-
-
-/**
- * @brief Fragmented packet descriptor
- **/
-
-typedef struct
-{
-   time_t timestamp;            ///<Time at which the first fragment was received
-   size_t headerLength;         ///<Length of the header
-   size_t dataLength;           ///<Length of the payload
-   uint16_t firstHole;          ///<Index of the first hole
-   Ipv4ReassemblyBuffer buffer; ///<Buffer containing the reassembled datagram
-} Ipv4FragDesc;
+#define IPV4_MAX_FRAG_SIZE(mtu) (((mtu) - sizeof(Ipv4Header)) & ~0x0007)
 
 
 //IPv4 datagram fragmentation and reassembly
 error_t ipv4FragmentDatagram(NetInterface *interface, Ipv4PseudoHeader *pseudoHeader,
-   uint16_t id, const ChunkedBuffer *payload, size_t payloadOffset, uint8_t timeToLive);
+   uint16_t id, size_t mtu, const ChunkedBuffer *payload, size_t payloadOffset,
+   uint8_t timeToLive, uint8_t tos);
 
 void ipv4ReassembleDatagram(NetInterface *interface,
    const MacAddr *srcMacAddr, const Ipv4Header *packet, size_t length);
 
-void ipv4FragTick(NetInterface *interface);
-
-Ipv4FragDesc *ipv4SearchFragQueue(NetInterface *interface, const Ipv4Header *packet);
-void ipv4FlushFragQueue(NetInterface *interface);
-
-Ipv4HoleDesc *ipv4FindHole(Ipv4FragDesc *frag, uint16_t offset);
-void ipv4DumpHoleList(Ipv4FragDesc *frag);
-
 #endif
@@ -44,6 +44,8 @@
 #include "icmpv6.h"
 #include "mld.h"
 #include "ndp.h"
+#include "ip_pmtu.h"
+#include "tcp_misc.h"
 #include "debug.h"
 
 //Check TCP/IP stack configuration
@@ -105,6 +107,13 @@ void icmpv6ProcessMessage(NetInterface *interface, Ipv6PseudoHeader *pseudoHeade
       //Process Echo Request message
       icmpv6ProcessEchoRequest(interface, pseudoHeader, buffer, offset);
       break;
+#if (IP_PMTU_SUPPORT == ENABLED)
+   //Packet Too Big message?
+   case ICMPV6_TYPE_PACKET_TOO_BIG:
+      //Process Packet Too Big message
+      icmpv6ProcessPacketTooBig(interface, buffer, offset);
+      break;
+#endif
 #if (MLD_SUPPORT == ENABLED)
    //Multicast Listener Query message?
    case ICMPV6_TYPE_MULTICAST_LISTENER_QUERY:
@@ -224,13 +233,91 @@ void icmpv6ProcessEchoRequest(NetInterface *interface, Ipv6PseudoHeader *request
    icmpv6DumpEchoMessage(replyHeader);
 
    //Send Echo Reply message
-   ipv6SendDatagram(interface, &replyPseudoHeader, reply, replyOffset, IPV6_DEFAULT_HOP_LIMIT);
+   ipv6SendDatagram(interface, &replyPseudoHeader, reply, replyOffset, IPV6_DEFAULT_HOP_LIMIT, 0, NULL);
 
    //Free previously allocated memory block
    chunkedBufferFree(reply);
 }
 
 
+#if (IP_PMTU_SUPPORT == ENABLED)
+
+/**
+ * @brief Packet Too Big message processing
+ *
+ * The path MTU of the destination of the original packet is lowered,
+ * and any TCP connection the packet belongs to adjusts its segment size
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] buffer Multi-part buffer containing the incoming message
+ * @param[in] offset Offset to the first byte of the message
+ **/
+
+void icmpv6ProcessPacketTooBig(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset)
+{
+   size_t length;
+   size_t mtu;
+   Icmpv6PacketTooBigMessage *message;
+   Ipv6Header *ipHeader;
+#if (TCP_SUPPORT == ENABLED)
+   const uint8_t *p;
+   IpPseudoHeader pseudoHeader;
+#endif
+   uint8_t data[sizeof(Icmpv6PacketTooBigMessage) + sizeof(Ipv6Header) + 8];
+
+   //Copy the message and the beginning of the original packet
+   length = chunkedBufferRead(data, buffer, offset, sizeof(data));
+
+   //Ensure the original IPv6 header is present
+   if(length < (sizeof(Icmpv6PacketTooBigMessage) + sizeof(Ipv6Header)))
+      return;
+
+   //Point to the message and to the header of the original packet
+   message = (Icmpv6PacketTooBigMessage *) data;
+   ipHeader = (Ipv6Header *) message->data;
+
+   //The original packet must have been sent by the local host
+   if(!ipv6CompAddr(&ipHeader->srcAddr, &interface->ipv6Config.linkLocalAddr) &&
+      !ipv6CompAddr(&ipHeader->srcAddr, &interface->ipv6Config.globalAddr))
+   {
+      return;
+   }
+
+   //MTU of the next hop
+   mtu = ntohl(message->mtu);
+
+   //Debug message
+   TRACE_INFO("ICMPv6 Packet Too Big (MTU = %u)\r\n", mtu);
+
+   //Lower the path MTU of the destination
+   ipv6UpdatePathMtu(interface, &ipHeader->destAddr, mtu);
+
+#if (TCP_SUPPORT == ENABLED)
+   //The original packet carried a TCP segment? Extension headers
+   //are not parsed, since they are not used by outgoing segments
+   if(ipHeader->nextHeader == IPV6_TCP_HEADER &&
+      length >= (sizeof(Icmpv6PacketTooBigMessage) + sizeof(Ipv6Header) + 8))
+   {
+      //Only the first 8 bytes of the TCP header are quoted, so the ports
+      //and the sequence number are read directly from the raw bytes
+      p = ipHeader->payload;
+
+      //The connection is looked up as for a segment it would receive
+      pseudoHeader.length = sizeof(Ipv6PseudoHeader);
+      pseudoHeader.ipv6Data.srcAddr = ipHeader->destAddr;
+      pseudoHeader.ipv6Data.destAddr = ipHeader->srcAddr;
+
+      //Adjust the segment size of the connection
+      tcpUpdatePathMtu(interface, &pseudoHeader, LOAD16BE(p),
+         LOAD16BE(p + 2), (uint32_t) LOAD32BE(p + 4));
+   }
+#endif
+}
+
+#endif
+
+
 /**
  * @brief Send an ICMPv6 Error message
  * @param[in] interface Underlying network interface
@@ -319,7 +406,7 @@ error_t icmpv6SendErrorMessage(NetInterface *interface, uint8_t type,
 
    //Send ICMPv6 Error message
    error = ipv6SendDatagram(interface, &pseudoHeader,
-      icmpMessage, offset, IPV6_DEFAULT_HOP_LIMIT);
+      icmpMessage, offset, IPV6_DEFAULT_HOP_LIMIT, 0, NULL);
 
    //Free previously allocated memory
    chunkedBufferFree(icmpMessage);
@@ -236,6 +236,9 @@ void icmpv6ProcessMessage(NetInterface *interface, Ipv6PseudoHeader *pseudoHeade
 void icmpv6ProcessEchoRequest(NetInterface *interface, Ipv6PseudoHeader *requestPseudoHeader,
    const ChunkedBuffer *request, size_t requestOffset);
 
+void icmpv6ProcessPacketTooBig(NetInterface *interface,
+   const ChunkedBuffer *buffer, size_t offset);
+
 error_t icmpv6SendErrorMessage(NetInterface *interface, uint8_t type,
    uint8_t code, uint32_t parameter, const ChunkedBuffer *ipPacket);
 
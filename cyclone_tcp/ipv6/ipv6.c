@@ -38,13 +38,17 @@
 #include <string.h>
 #include <ctype.h>
 #include "tcp_ip_stack.h"
+#include "ip.h"
 #include "ipv6.h"
 #include "icmpv6.h"
 #include "mld.h"
 #include "ndp.h"
+#include "ip_route.h"
+#include "ip_pmtu.h"
 #include "udp.h"
 #include "tcp_fsm.h"
 #include "raw_socket.h"
+#include "probe.h"
 #include "debug.h"
 
 //Check TCP/IP stack configuration
@@ -87,26 +91,13 @@ error_t ipv6Init(NetInterface *interface)
 
    //Clear IPv6 filter table contents
    memset(interface->ipv6Filter, 0, sizeof(interface->ipv6Filter));
+   memset(interface->ipv6FilterHashTable, 0, sizeof(interface->ipv6FilterHashTable));
    //No entry in the filter table
    interface->ipv6FilterSize = 0;
 
 #if (IPV6_FRAG_SUPPORT == ENABLED)
    //Identification field is used to identify fragments of an original IP datagram
    interface->ipv6Identification = 0;
-
-   //Create a mutex to prevent simultaneous access to the reassembly queue
-   interface->ipv6FragQueueMutex = osMutexCreate(FALSE);
-   //Any error to report?
-   if(interface->ipv6FragQueueMutex == OS_INVALID_HANDLE)
-   {
-      //Clean up side effects
-      osMutexClose(interface->ipv6FilterMutex);
-      //Stop immediately
-      return ERROR_OUT_OF_RESOURCES;
-   }
-
-   //Clear the reassembly queue
-   memset(interface->ipv6FragQueue, 0, sizeof(interface->ipv6FragQueue));
 #endif
 
    //Successful initialization
@@ -128,15 +119,28 @@ void ipv6ProcessPacket(NetInterface *interface,
    size_t offset;
    size_t length;
    size_t nextHeaderOffset;
+   uint8_t *type;
    Ipv6Header *packet;
    IpPseudoHeader pseudoHeader;
+   ChunkedBufferCursor cursor;
+
+   //Instrumentation point
+   PROBE_ENTER(PROBE_IPV6_PROCESS_PACKET);
+
+   //Update IP statistics
+   IPV6_MIB_INC(interface, ipInReceives);
 
    //Retrieve the length of the IPv6 packet
    length = chunkedBufferGetLength(buffer);
 
    //Ensure the packet length is greater than 40 bytes
    if(length < sizeof(Ipv6Header))
+   {
+      //Update IP statistics
+      IPV6_MIB_INC(interface, ipInHdrErrors);
+      //Discard incoming packet
       return;
+   }
 
    //Point to the IPv6 header
    packet = chunkedBufferAt(buffer, 0);
@@ -148,18 +152,53 @@ void ipv6ProcessPacket(NetInterface *interface,
    //Dump IPv6 header contents for debugging purpose
    ipv6DumpHeader(packet);
 
-   //Check IP version number
-   if(packet->version != IPV6_VERSION)
-      return;
-   //Ensure the payload length is correct before processing the packet
-   if(ntohs(packet->payloadLength) > (length - sizeof(Ipv6Header)))
+   //Check IP version number and ensure the payload length is correct
+   //before processing the packet
+   if(packet->version != IPV6_VERSION ||
+      ntohs(packet->payloadLength) > (length - sizeof(Ipv6Header)))
+   {
+      //Update IP statistics
+      IPV6_MIB_INC(interface, ipInHdrErrors);
+      //Discard incoming packet
       return;
+   }
+
    //Destination address filtering
    if(ipv6CheckDestAddr(interface, &packet->destAddr))
+   {
+#if (IP_FORWARD_SUPPORT == ENABLED)
+      //Packets addressed to another host may be forwarded
+      if(interface->ipForwarding)
+      {
+         ipv6ForwardPacket(interface, buffer);
+         return;
+      }
+#endif
+      //Update IP statistics
+      IPV6_MIB_INC(interface, ipInAddrErrors);
+      //Discard incoming packet
       return;
+   }
+
    //Source address filtering
    if(ipv6CheckSourceAddr(interface, &packet->srcAddr))
+   {
+      //Update IP statistics
+      IPV6_MIB_INC(interface, ipInHdrErrors);
+      //Discard incoming packet
+      return;
+   }
+
+#if (IPV6_MULTICAST_FILTER_SUPPORT == ENABLED)
+   //Drop multicast packets sent by unwanted sources
+   if(ipv6CheckSourceFilter(interface, &packet->destAddr, &packet->srcAddr))
+   {
+      //Update IP statistics
+      IPV6_MIB_INC(interface, ipInAddrErrors);
+      //Discard incoming packet
       return;
+   }
+#endif
 
    //Calculate the effective length of the IPv6 packet
    length = sizeof(Ipv6Header) + ntohs(packet->payloadLength);
@@ -177,11 +216,16 @@ void ipv6ProcessPacket(NetInterface *interface,
    //Point to the first extension header
    offset = sizeof(Ipv6Header);
 
+   //Extension headers are walked sequentially
+   chunkedBufferCursorInit(&cursor, buffer);
+
    //Parse extension headers
    while(offset < length)
    {
       //Retrieve the Next Header field of preceding header
-      uint8_t *type = chunkedBufferAt(buffer, nextHeaderOffset);
+      type = chunkedBufferCursorSeek(&cursor, nextHeaderOffset);
+      //Sanity check
+      if(!type) return;
 
       //Update IPv6 pseudo header
       pseudoHeader.ipv6Data.length = htonl(length - offset);
@@ -214,13 +258,15 @@ void ipv6ProcessPacket(NetInterface *interface,
 
       //Fragment header?
       case IPV6_FRAGMENT_HEADER:
+         //Update IP statistics
+         IPV6_MIB_INC(interface, ipReasmReqds);
 #if (IPV6_FRAG_SUPPORT == ENABLED)
          //Acquire exclusive access to the reassembly queue
-         osMutexAcquire(interface->ipv6FragQueueMutex);
+         osMutexAcquire(interface->ipFragQueueMutex);
          //Parse current extension header
          ipv6ParseFragmentHeader(interface, srcMacAddr, buffer, offset, nextHeaderOffset);
          //Release exclusive access to the reassembly queue
-         osMutexRelease(interface->ipv6FragQueueMutex);
+         osMutexRelease(interface->ipFragQueueMutex);
 #endif
          //Exit immediately
          return;
@@ -241,6 +287,8 @@ void ipv6ProcessPacket(NetInterface *interface,
 
       //ICMPv6 header?
       case IPV6_ICMPV6_HEADER:
+         //Update IP statistics
+         IPV6_MIB_INC(interface, ipInDelivers);
          //Process incoming ICMPv6 message
          icmpv6ProcessMessage(interface, &pseudoHeader.ipv6Data, buffer, offset, packet->hopLimit);
 #if (RAW_SOCKET_SUPPORT == ENABLED)
@@ -253,6 +301,8 @@ void ipv6ProcessPacket(NetInterface *interface,
 #if (TCP_SUPPORT == ENABLED)
       //TCP header?
       case IPV6_TCP_HEADER:
+         //Update IP statistics
+         IPV6_MIB_INC(interface, ipInDelivers);
          //Process incoming TCP segment
          tcpProcessSegment(interface, &pseudoHeader, buffer, offset);
          //Exit immediately
@@ -262,6 +312,8 @@ void ipv6ProcessPacket(NetInterface *interface,
 #if (UDP_SUPPORT == ENABLED)
       //UDP header?
       case IPV6_UDP_HEADER:
+         //Update IP statistics
+         IPV6_MIB_INC(interface, ipInDelivers);
          //Process incoming UDP datagram
          udpProcessDatagram(interface, &pseudoHeader, buffer, offset);
          //Exit immediately
@@ -278,6 +330,8 @@ void ipv6ProcessPacket(NetInterface *interface,
       default:
          //Debug message
          TRACE_WARNING("Unrecognized Next Header type\r\n");
+         //Update IP statistics
+         IPV6_MIB_INC(interface, ipInUnknownProtos);
 
          //Send an ICMP Parameter Problem message
          icmpv6SendErrorMessage(interface, ICMPV6_TYPE_PARAM_PROBLEM,
@@ -489,39 +543,60 @@ error_t ipv6ParseEspHeader(NetInterface *interface,
  * @param[in] buffer Multi-part buffer containing the payload
  * @param[in] offset Offset to the first byte of the payload
  * @param[in] hopLimit Hop Limit value
+ * @param[in] trafficClass Traffic Class field
+ * @param[in,out] cache Cached path to the destination (optional parameter)
  * @return Error code
  **/
 
 
 error_t ipv6SendDatagram(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader,
-   ChunkedBuffer *buffer, size_t offset, uint8_t hopLimit)
+   ChunkedBuffer *buffer, size_t offset, uint8_t hopLimit, uint8_t trafficClass, IpPathCache *cache)
 {
    error_t error;
    size_t length;
+   size_t mtu;
+
+   //Update IP statistics
+   IPV6_MIB_INC(interface, ipOutRequests);
 
    //Retrieve the length of payload
    length = chunkedBufferGetLength(buffer) - offset;
 
-   //If the payload length is smaller than the network
-   //interface MTU then no fragmentation is needed
-   if(length <= IPV6_MAX_PAYLOAD_SIZE)
+#if (IP_PMTU_SUPPORT == ENABLED)
+   //Routers never fragment IPv6 packets, hence the source must
+   //respect the path MTU (refer to RFC 8201)
+   mtu = ipv6GetPathMtu(interface, &pseudoHeader->destAddr);
+#else
+   //Use the MTU of the network interface
+   mtu = interface->mtu;
+#endif
+
+   //If the payload length is smaller than the path
+   //MTU then no fragmentation is needed
+   if(length <= (mtu - sizeof(Ipv6Header)))
    {
       //Send data as is
       error = ipv6SendPacket(interface,
-         pseudoHeader, 0, 0, buffer, offset, hopLimit);
+         pseudoHeader, 0, 0, buffer, offset, hopLimit, trafficClass, cache);
    }
-   //If the payload length exceeds the network interface MTU
+   //If the payload length exceeds the path MTU
    //then the device must fragment the data
    else
    {
 #if (IPV6_FRAG_SUPPORT == ENABLED)
       //Fragment IP datagram into smaller packets
       error = ipv6FragmentDatagram(interface,
-         pseudoHeader, buffer, offset, hopLimit);
+         pseudoHeader, mtu, buffer, offset, hopLimit, trafficClass);
 #else
       //Fragmentation is not supported
       error = ERROR_MESSAGE_TOO_LONG;
 #endif
+
+      //Update IP statistics
+      if(!error)
+         IPV6_MIB_INC(interface, ipFragOKs);
+      else
+         IPV6_MIB_INC(interface, ipFragFails);
    }
 
    //Return status code
@@ -538,13 +613,17 @@ error_t ipv6SendDatagram(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader
  * @param[in] buffer Multi-part buffer containing the payload
  * @param[in] offset Offset to the first byte of the payload
  * @param[in] hopLimit Hop Limit value
+ * @param[in] trafficClass Traffic Class field
+ * @param[in,out] cache Cached path to the destination (optional parameter)
  * @return Error code
  **/
 
 error_t ipv6SendPacket(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader,
-   uint32_t fragId, uint16_t fragOffset, ChunkedBuffer *buffer, size_t offset, uint8_t hopLimit)
+   uint32_t fragId, uint16_t fragOffset, ChunkedBuffer *buffer, size_t offset,
+   uint8_t hopLimit, uint8_t trafficClass, IpPathCache *cache)
 {
    error_t error;
+   uint_t generation;
    size_t length;
    Ipv6Addr destIpAddr;
    MacAddr destMacAddr;
@@ -601,8 +680,8 @@ error_t ipv6SendPacket(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader,
 
    //Format IPv6 header
    packet->version = IPV6_VERSION;
-   packet->trafficClassH = 0;
-   packet->trafficClassL = 0;
+   packet->trafficClassH = (trafficClass >> 4) & 0x0F;
+   packet->trafficClassL = trafficClass & 0x0F;
    packet->flowLabelH = 0;
    packet->flowLabelL = 0;
    packet->payloadLength = htons(length - sizeof(Ipv6Header));
@@ -615,17 +694,31 @@ error_t ipv6SendPacket(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader,
    //Invalid source address?
    if(error) return error;
 
+   //Any change to the Neighbor cache made from now on invalidates the
+   //result of the address resolution
+   generation = interface->neighborCacheGen;
+
    //Destination IPv6 address is the unspecified address?
    if(ipv6CompAddr(&pseudoHeader->destAddr, &IPV6_UNSPECIFIED_ADDR))
    {
       //Destination address is not acceptable
       error = ERROR_INVALID_ADDRESS;
    }
-   //Destination address is the loopback address?
-   else if(ipv6CompAddr(&pseudoHeader->destAddr, &IPV6_LOOPBACK_ADDR))
+   //Destination address is the loopback address or a local address?
+   else if(ipv6IsLocalHostAddr(interface, &pseudoHeader->destAddr))
    {
-      //Not yet implemented...
+#if (NIC_LOOPBACK_SUPPORT == ENABLED)
+      //Debug message
+      TRACE_INFO("Sending IPv6 packet to the local host (%u bytes)...\r\n", length);
+      //Dump IP header contents for debugging purpose
+      ipv6DumpHeader(packet);
+
+      //The packet does not go through the network controller
+      return nicLoopbackSendPacket(interface, buffer, offset);
+#else
+      //Loopback is not supported
       return ERROR_NOT_IMPLEMENTED;
+#endif
    }
    //Destination IPv6 address is a multicast address?
    else if(ipv6IsMulticastAddr(&pseudoHeader->destAddr))
@@ -635,38 +728,27 @@ error_t ipv6SendPacket(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader,
       //Map IPv6 multicast address to MAC-layer multicast address
       error = ipv6MapMulticastAddrToMac(&pseudoHeader->destAddr, &destMacAddr);
    }
-   //Destination IPv6 address is a link-local unicast address?
-   else if(ipv6IsLinkLocalUnicastAddr(&pseudoHeader->destAddr))
-   {
-      //Destination IPv6 address
-      destIpAddr = pseudoHeader->destAddr;
-      //Resolve host address using Neighbor Discovery protocol
-      error = ndpResolve(interface, &pseudoHeader->destAddr, &destMacAddr);
-   }
-   //Destination host is on the same link?
-   else if(ipv6CompPrefix(&pseudoHeader->destAddr,
-      &interface->ipv6Config.prefix, interface->ipv6Config.prefixLength))
-   {
-      //Destination IPv6 address
-      destIpAddr = pseudoHeader->destAddr;
-      //Resolve host address using Neighbor Discovery protocol
-      error = ndpResolve(interface, &pseudoHeader->destAddr, &destMacAddr);
-   }
-   //Destination host is outside the local network?
+   //Destination IPv6 address is a unicast address?
    else
    {
-      //Make sure the default router is properly set
-      if(!ipv6CompAddr(&interface->ipv6Config.router, &IPV6_UNSPECIFIED_ADDR))
+      //Determine the next hop (on-link destination or router)
+      error = ndpGetNextHop(interface, &pseudoHeader->destAddr, &destIpAddr);
+
+      //The link-layer address of the next hop is already known?
+      if(!error && ipv6CheckPathCache(interface, cache, &pseudoHeader->destAddr, &destIpAddr))
       {
-         //Use the default router to forward the packet
-         destIpAddr = interface->ipv6Config.router;
-         //Perform address resolution
-         error = ndpResolve(interface, &interface->ipv6Config.router, &destMacAddr);
+         //Skip address resolution
+         destMacAddr = cache->macAddr;
       }
-      else
+      else if(!error)
       {
-         //There is no route to the outside world...
-         error = ERROR_NO_ROUTE;
+         //Resolve the next-hop address using Neighbor Discovery protocol
+         error = ndpResolve(interface, &destIpAddr, &destMacAddr);
+
+         //Save the resolved path for subsequent packets
+         if(!error)
+            ipv6UpdatePathCache(interface, cache, generation,
+               &pseudoHeader->destAddr, &destIpAddr, &destMacAddr);
       }
    }
 
@@ -699,11 +781,79 @@ error_t ipv6SendPacket(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader,
       TRACE_WARNING("Cannot map IPv6 address to Ethernet address!\r\n");
    }
 
+   //Update IP statistics
+   if(error == ERROR_NO_ROUTE)
+      IPV6_MIB_INC(interface, ipOutNoRoutes);
+   else if(error)
+      IPV6_MIB_INC(interface, ipOutDiscards);
+
    //Return status code
    return error;
 }
 
 
+/**
+ * @brief Check whether a cached path can be used
+ * @param[in] interface Underlying network interface
+ * @param[in] cache Cached path to the destination (may be NULL)
+ * @param[in] destAddr Destination IPv6 address
+ * @param[in] nextHop Next hop selected for this packet
+ * @return TRUE if the link-layer address of the next hop is up to date
+ **/
+
+bool_t ipv6CheckPathCache(NetInterface *interface, const IpPathCache *cache,
+   const Ipv6Addr *destAddr, const Ipv6Addr *nextHop)
+{
+   //No cache or no resolved path?
+   if(cache == NULL || !cache->valid)
+      return FALSE;
+   //The path must have been resolved on the same interface
+   if(cache->interface != interface || cache->destAddr.length != sizeof(Ipv6Addr))
+      return FALSE;
+   //Has any neighbor been updated or removed since then?
+   if(cache->generation != interface->neighborCacheGen)
+      return FALSE;
+   //The destination must still be reached through the same next hop
+   if(!ipv6CompAddr(&cache->destAddr.ipv6Addr, destAddr) ||
+      !ipv6CompAddr(&cache->nextHop.ipv6Addr, nextHop))
+   {
+      return FALSE;
+   }
+
+   //The cached link-layer address can be used
+   return TRUE;
+}
+
+
+/**
+ * @brief Save the outcome of next-hop determination and address resolution
+ * @param[in] interface Underlying network interface
+ * @param[out] cache Cached path to the destination (may be NULL)
+ * @param[in] generation Neighbor cache generation sampled before resolution
+ * @param[in] destAddr Destination IPv6 address
+ * @param[in] nextHop Next-hop IPv6 address
+ * @param[in] macAddr Link-layer address of the next hop
+ **/
+
+void ipv6UpdatePathCache(NetInterface *interface, IpPathCache *cache, uint_t generation,
+   const Ipv6Addr *destAddr, const Ipv6Addr *nextHop, const MacAddr *macAddr)
+{
+   //Nothing to do if the caller does not maintain a cache
+   if(cache == NULL)
+      return;
+
+   //Save the resolved path
+   cache->interface = interface;
+   cache->generation = generation;
+   cache->destAddr.length = sizeof(Ipv6Addr);
+   cache->destAddr.ipv6Addr = *destAddr;
+   cache->nextHop.length = sizeof(Ipv6Addr);
+   cache->nextHop.ipv6Addr = *nextHop;
+   cache->macAddr = *macAddr;
+   cache->valid = TRUE;
+}
+
+
 /**
  * @brief Source IPv6 address filtering
  * @param[in] interface Underlying network interface
@@ -736,35 +886,34 @@ error_t ipv6CheckSourceAddr(NetInterface *interface, const Ipv6Addr *ipAddr)
 
 error_t ipv6CheckDestAddr(NetInterface *interface, const Ipv6Addr *ipAddr)
 {
-   uint_t i;
-
-   //Link-local address?
-   if(ipv6CompAddr(ipAddr, &interface->ipv6Config.linkLocalAddr))
-      return NO_ERROR;
-   //Global address?
-   if(ipv6CompAddr(ipAddr, &interface->ipv6Config.globalAddr))
-      return NO_ERROR;
+   Ipv6FilterEntry *entry;
 
-   //Acquire exclusive access to the IPv6 filter table
-   osMutexAcquire(interface->ipv6FilterMutex);
-
-   //Loop through the IPv6 filter table
-   for(i = 0; i < interface->ipv6FilterSize; i++)
+   //Link-local or global address?
+   if(ipv6IsLocalHostAddr(interface, ipAddr) && !ipv6CompAddr(ipAddr, &IPV6_LOOPBACK_ADDR))
    {
-      //Check whether the destination IPv6 address matches
-      //a relevant multicast address
-      if(ipv6CompAddr(&interface->ipv6Filter[i].addr, ipAddr))
-      {
-         //Release exclusive access to the IPv6 filter table
-         osMutexRelease(interface->ipv6FilterMutex);
-         //The specified IPv6 address is acceptable
+      //Packets destined to a tentative address must be silently discarded
+      //(Neighbor Discovery messages are sent to multicast addresses)
+      if(ipv6GetAddrState(interface, ipAddr) != IPV6_ADDR_STATE_TENTATIVE)
          return NO_ERROR;
-      }
    }
+#if (NIC_LOOPBACK_SUPPORT == ENABLED)
+   //The loopback address is only valid for packets that never left the host
+   if(ipv6CompAddr(ipAddr, &IPV6_LOOPBACK_ADDR) && interface->nicRxLoopback)
+      return NO_ERROR;
+#endif
 
+   //Acquire exclusive access to the IPv6 filter table
+   osMutexAcquire(interface->ipv6FilterMutex);
+   //Check whether the destination IPv6 address matches
+   //a relevant multicast address
+   entry = ipv6FindFilterEntry(interface, ipAddr);
    //Release exclusive access to the IPv6 filter table
    osMutexRelease(interface->ipv6FilterMutex);
 
+   //The specified IPv6 address is acceptable?
+   if(entry != NULL)
+      return NO_ERROR;
+
    //Debug message
    TRACE_WARNING("Wrong destination IPv6 address!\r\n");
    //The destination address is not acceptable
@@ -788,12 +937,52 @@ error_t ipv6CheckDestAddr(NetInterface *interface, const Ipv6Addr *ipAddr)
 error_t ipv6SelectSourceAddr(NetInterface **interface,
    const Ipv6Addr *destAddr, Ipv6Addr *srcAddr)
 {
-   //Use default network interface?
+   uint_t i;
+   NetInterface *p;
+#if (IP_ROUTE_SUPPORT == ENABLED)
+   IpAddr ipAddr;
+#endif
+
+   //No interface specified?
    if(*interface == NULL)
-      *interface = tcpIpStackGetDefaultInterface();
+   {
+      //Prefer an interface attached to the destination prefix. Link-local
+      //destinations are ambiguous and use the default interface
+      for(i = 0; i < NET_INTERFACE_COUNT && *interface == NULL; i++)
+      {
+         //Point to the current interface
+         p = &netInterface[i];
+
+         //Check whether the destination is on-link
+         if(p->configured && p->ipv6Config.prefixLength > 0 &&
+            ipv6CompPrefix(destAddr, &p->ipv6Config.prefix, p->ipv6Config.prefixLength))
+         {
+            *interface = p;
+         }
+      }
+
+#if (IP_ROUTE_SUPPORT == ENABLED)
+      //Otherwise let the routing table decide
+      if(*interface == NULL && !ipv6IsLinkLocalUnicastAddr(destAddr))
+      {
+         ipAddr.length = sizeof(Ipv6Addr);
+         ipAddr.ipv6Addr = *destAddr;
+         ipRouteLookup(&ipAddr, interface, NULL);
+      }
+#endif
+
+      //Use default network interface?
+      if(*interface == NULL)
+         *interface = tcpIpStackGetDefaultInterface();
+   }
 
    //Get the most appropriate source address to use
-   if(ipv6IsLinkLocalUnicastAddr(destAddr))
+   if(ipv6CompAddr(destAddr, &IPV6_LOOPBACK_ADDR))
+   {
+      //Use loopback address
+      *srcAddr = IPV6_LOOPBACK_ADDR;
+   }
+   else if(ipv6IsLinkLocalUnicastAddr(destAddr))
    {
       //Use link local address
       *srcAddr = (*interface)->ipv6Config.linkLocalAddr;
@@ -809,11 +998,67 @@ error_t ipv6SelectSourceAddr(NetInterface **interface,
       *srcAddr = (*interface)->ipv6Config.globalAddr;
    }
 
+   //A tentative address cannot be used until DAD completes, whereas an
+   //optimistic address is usable right away (RFC 4429 3.3)
+   if(ipv6GetAddrState(*interface, srcAddr) == IPV6_ADDR_STATE_TENTATIVE)
+      return ERROR_NO_ADDRESS;
+
    //Successful processing
    return NO_ERROR;
 }
 
 
+/**
+ * @brief Check whether an IPv6 address designates the local host
+ * @param[in] interface Underlying network interface
+ * @param[in] ipAddr IPv6 address to be checked
+ * @return TRUE if the address is the loopback address or one of the
+ *   unicast addresses assigned to the interface, else FALSE
+ **/
+
+bool_t ipv6IsLocalHostAddr(NetInterface *interface, const Ipv6Addr *ipAddr)
+{
+   //Loopback address?
+   if(ipv6CompAddr(ipAddr, &IPV6_LOOPBACK_ADDR))
+      return TRUE;
+   //The unspecified address never designates the local host
+   else if(ipv6CompAddr(ipAddr, &IPV6_UNSPECIFIED_ADDR))
+      return FALSE;
+   //Link-local address?
+   else if(ipv6CompAddr(ipAddr, &interface->ipv6Config.linkLocalAddr))
+      return TRUE;
+   //Global address?
+   else if(ipv6CompAddr(ipAddr, &interface->ipv6Config.globalAddr))
+      return TRUE;
+   else
+      return FALSE;
+}
+
+
+/**
+ * @brief Retrieve the state of a local IPv6 address
+ * @param[in] interface Underlying network interface
+ * @param[in] ipAddr IPv6 address
+ * @return State of the address, or IPV6_ADDR_STATE_INVALID if the
+ *   address is not assigned to the interface
+ **/
+
+Ipv6AddrState ipv6GetAddrState(NetInterface *interface, const Ipv6Addr *ipAddr)
+{
+   //The unspecified address is never assigned to an interface
+   if(ipv6CompAddr(ipAddr, &IPV6_UNSPECIFIED_ADDR))
+      return IPV6_ADDR_STATE_INVALID;
+   //Link-local address?
+   else if(ipv6CompAddr(ipAddr, &interface->ipv6Config.linkLocalAddr))
+      return interface->ipv6Config.linkLocalAddrState;
+   //Global address?
+   else if(ipv6CompAddr(ipAddr, &interface->ipv6Config.globalAddr))
+      return interface->ipv6Config.globalAddrState;
+   else
+      return IPV6_ADDR_STATE_INVALID;
+}
+
+
 /**
  * @brief Join an IPv6 multicast group
  * @param[in] interface Underlying network interface
@@ -826,6 +1071,7 @@ error_t ipv6JoinMulticastGroup(NetInterface *interface, const Ipv6Addr *groupAdd
    error_t error;
    uint_t i;
    MacAddr macAddr;
+   Ipv6FilterEntry *entry;
 
    //Ensure the specified IPv6 address is a multicast address
    if(!ipv6IsMulticastAddr(groupAddr))
@@ -834,21 +1080,23 @@ error_t ipv6JoinMulticastGroup(NetInterface *interface, const Ipv6Addr *groupAdd
    //Acquire exclusive access to the IPv6 filter table
    osMutexAcquire(interface->ipv6FilterMutex);
 
-   //Loop through filter table entries
-   for(i = 0; i < interface->ipv6FilterSize; i++)
+   //Check whether the table already contains the specified IPv6 address
+   entry = ipv6FindFilterEntry(interface, groupAddr);
+
+   //Matching entry found?
+   if(entry != NULL)
    {
-      //Check whether the table already contains the specified IPv6 address
-      if(ipv6CompAddr(&interface->ipv6Filter[i].addr, groupAddr))
-      {
-         //Increment the reference count
-         interface->ipv6Filter[i].refCount++;
-         //Release exclusive access to the IPv6 filter table
-         osMutexRelease(interface->ipv6FilterMutex);
-         //No error to report
-         return NO_ERROR;
-      }
+      //Increment the reference count
+      entry->refCount++;
+      //Release exclusive access to the IPv6 filter table
+      osMutexRelease(interface->ipv6FilterMutex);
+      //No error to report
+      return NO_ERROR;
    }
 
+   //Index of the first free entry
+   i = interface->ipv6FilterSize;
+
    //The IPv6 filter table is full ?
    if(i >= IPV6_FILTER_MAX_SIZE)
    {
@@ -870,8 +1118,15 @@ error_t ipv6JoinMulticastGroup(NetInterface *interface, const Ipv6Addr *groupAdd
       interface->ipv6Filter[i].addr = *groupAddr;
       //Initialize the reference count
       interface->ipv6Filter[i].refCount = 1;
+#if (IPV6_MULTICAST_FILTER_SUPPORT == ENABLED)
+      //Traffic from any source is accepted until a filter is set
+      interface->ipv6Filter[i].filterMode = IP_FILTER_MODE_EXCLUDE;
+      interface->ipv6Filter[i].srcAddrCount = 0;
+#endif
       //Adjust the size of the IPv6 filter table
       interface->ipv6FilterSize++;
+      //Update the hash table used to look up the filter table
+      ipv6UpdateFilterHash(interface);
 
 #if (MLD_SUPPORT == ENABLED)
       //Start listening to the multicast address
@@ -898,6 +1153,7 @@ error_t ipv6LeaveMulticastGroup(NetInterface *interface, const Ipv6Addr *groupAd
    uint_t i;
    uint_t j;
    MacAddr macAddr;
+   Ipv6FilterEntry *entry;
 
    //Ensure the specified IPv6 address is a multicast address
    if(!ipv6IsMulticastAddr(groupAddr))
@@ -906,46 +1162,268 @@ error_t ipv6LeaveMulticastGroup(NetInterface *interface, const Ipv6Addr *groupAd
    //Acquire exclusive access to the IPv6 filter table
    osMutexAcquire(interface->ipv6FilterMutex);
 
-   //Loop through filter table entries
-   for(i = 0; i < interface->ipv6FilterSize; i++)
+   //Search the table for the specified IPv6 address
+   entry = ipv6FindFilterEntry(interface, groupAddr);
+
+   //The specified IPv6 address does not exist?
+   if(entry == NULL)
    {
-      //Specified IPv6 address found?
-      if(ipv6CompAddr(&interface->ipv6Filter[i].addr, groupAddr))
-      {
-         //Decrement the reference count
-         interface->ipv6Filter[i].refCount--;
+      //Release exclusive access to the IPv6 filter table
+      osMutexRelease(interface->ipv6FilterMutex);
+      //Report an error
+      return ERROR_FAILURE;
+   }
 
-         //Remove the entry if the reference count drops to zero
-         if(interface->ipv6Filter[i].refCount < 1)
-         {
+   //Decrement the reference count
+   entry->refCount--;
+
+   //Remove the entry if the reference count drops to zero
+   if(entry->refCount < 1)
+   {
 #if (MLD_SUPPORT == ENABLED)
-            //Stop listening to the multicast address
-            mldStopListening(interface, &interface->ipv6Filter[i]);
+      //Stop listening to the multicast address
+      mldStopListening(interface, entry);
 #endif
-            //Map the multicast IPv6 address to a MAC-layer address
-            ipv6MapMulticastAddrToMac(groupAddr, &macAddr);
-            //Drop the corresponding address from the MAC filter table
-            ethDropMulticastAddr(interface, &macAddr);
+      //Map the multicast IPv6 address to a MAC-layer address
+      ipv6MapMulticastAddrToMac(groupAddr, &macAddr);
+      //Drop the corresponding address from the MAC filter table
+      ethDropMulticastAddr(interface, &macAddr);
 
-            //Adjust the size of the IPv6 filter table
-            interface->ipv6FilterSize--;
+      //Index of the entry in the IPv6 filter table
+      i = entry - interface->ipv6Filter;
+      //Adjust the size of the IPv6 filter table
+      interface->ipv6FilterSize--;
 
-            //Remove the corresponding entry
-            for(j = i; j < interface->ipv6FilterSize; j++)
-               interface->ipv6Filter[j] = interface->ipv6Filter[j + 1];
-         }
+      //Remove the corresponding entry
+      for(j = i; j < interface->ipv6FilterSize; j++)
+         interface->ipv6Filter[j] = interface->ipv6Filter[j + 1];
 
-         //Release exclusive access to the IPv6 filter table
-         osMutexRelease(interface->ipv6FilterMutex);
-         //No error to report
-         return NO_ERROR;
+      //Entries have moved, so the hash table must be rebuilt
+      ipv6UpdateFilterHash(interface);
+   }
+
+   //Release exclusive access to the IPv6 filter table
+   osMutexRelease(interface->ipv6FilterMutex);
+   //No error to report
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Set the source filter of a multicast address
+ *
+ * The multicast address must have been joined beforehand. In include mode,
+ * only the traffic sent by the listed sources is accepted. In exclude mode,
+ * the traffic sent by the listed sources is dropped. The new filter state
+ * is reported to the routers so that they can prune unwanted sources
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] groupAddr IPv6 multicast address
+ * @param[in] filterMode Filter mode (include or exclude)
+ * @param[in] srcAddr List of source addresses
+ * @param[in] srcAddrCount Number of source addresses
+ * @return Error code
+ **/
+
+error_t ipv6SetMulticastSourceFilter(NetInterface *interface, const Ipv6Addr *groupAddr,
+   uint_t filterMode, const Ipv6Addr *srcAddr, uint_t srcAddrCount)
+{
+#if (IPV6_MULTICAST_FILTER_SUPPORT == ENABLED)
+   uint_t i;
+   Ipv6FilterEntry *entry;
+
+   //Ensure the specified IPv6 address is a multicast address
+   if(!ipv6IsMulticastAddr(groupAddr))
+      return ERROR_INVALID_ADDRESS;
+   //Check filter mode
+   if(filterMode != IP_FILTER_MODE_INCLUDE && filterMode != IP_FILTER_MODE_EXCLUDE)
+      return ERROR_INVALID_PARAMETER;
+   //Check the number of source addresses
+   if(srcAddrCount > IPV6_MAX_MULTICAST_SRC_ADDRS)
+      return ERROR_INVALID_PARAMETER;
+   if(srcAddrCount > 0 && srcAddr == NULL)
+      return ERROR_INVALID_PARAMETER;
+
+   //Source addresses must be unicast addresses
+   for(i = 0; i < srcAddrCount; i++)
+   {
+      //Check current address
+      if(ipv6IsMulticastAddr(&srcAddr[i]) || ipv6CompAddr(&srcAddr[i], &IPV6_UNSPECIFIED_ADDR))
+         return ERROR_INVALID_ADDRESS;
+   }
+
+   //Acquire exclusive access to the IPv6 filter table
+   osMutexAcquire(interface->ipv6FilterMutex);
+
+   //Search the table for the specified IPv6 address
+   entry = ipv6FindFilterEntry(interface, groupAddr);
+
+   //The multicast address has not been joined?
+   if(entry == NULL)
+   {
+      //Release exclusive access to the IPv6 filter table
+      osMutexRelease(interface->ipv6FilterMutex);
+      //Report an error
+      return ERROR_FAILURE;
+   }
+
+   //Save the new source filter
+   entry->filterMode = filterMode;
+   entry->srcAddrCount = srcAddrCount;
+
+   //Copy the list of source addresses
+   for(i = 0; i < srcAddrCount; i++)
+      entry->srcAddr[i] = srcAddr[i];
+
+#if (MLD_SUPPORT == ENABLED)
+   //Report the change of the source filter to the routers
+   mldStateChange(interface, entry);
+#endif
+
+   //Release exclusive access to the IPv6 filter table
+   osMutexRelease(interface->ipv6FilterMutex);
+   //No error to report
+   return NO_ERROR;
+#else
+   //Source-specific multicast is not supported
+   return ERROR_NOT_IMPLEMENTED;
+#endif
+}
+
+
+/**
+ * @brief Check the source of a multicast packet against the address filter
+ * @param[in] interface Underlying network interface
+ * @param[in] groupAddr Destination IPv6 address
+ * @param[in] srcAddr Source IPv6 address
+ * @return Error code
+ **/
+
+error_t ipv6CheckSourceFilter(NetInterface *interface,
+   const Ipv6Addr *groupAddr, const Ipv6Addr *srcAddr)
+{
+#if (IPV6_MULTICAST_FILTER_SUPPORT == ENABLED)
+   uint_t i;
+   bool_t accept;
+   Ipv6FilterEntry *entry;
+
+   //Unicast packets are not subject to source filtering
+   if(!ipv6IsMulticastAddr(groupAddr))
+      return NO_ERROR;
+
+   //Accept the packet by default
+   accept = TRUE;
+
+   //Acquire exclusive access to the IPv6 filter table
+   osMutexAcquire(interface->ipv6FilterMutex);
+
+   //Search the table for the specified multicast address
+   entry = ipv6FindFilterEntry(interface, groupAddr);
+
+   //Matching entry found?
+   if(entry != NULL)
+   {
+      //Look for the source address in the list
+      for(i = 0; i < entry->srcAddrCount; i++)
+      {
+         //Matching address?
+         if(ipv6CompAddr(&entry->srcAddr[i], srcAddr))
+            break;
       }
+
+      //In include mode, the source must be listed. In exclude
+      //mode, the source must not be listed
+      if(entry->filterMode == IP_FILTER_MODE_INCLUDE)
+         accept = (i < entry->srcAddrCount);
+      else
+         accept = (i >= entry->srcAddrCount);
    }
 
    //Release exclusive access to the IPv6 filter table
    osMutexRelease(interface->ipv6FilterMutex);
-   //The specified IPv6 address does not exist
-   return ERROR_FAILURE;
+
+   //Return status code
+   return accept ? NO_ERROR : ERROR_INVALID_ADDRESS;
+#else
+   //Source filtering is not supported
+   return NO_ERROR;
+#endif
+}
+
+
+/**
+ * @brief Search the IPv6 filter table for a given address
+ *
+ * The caller is responsible for holding the IPv6 filter mutex
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] ipAddr IPv6 multicast address
+ * @return Matching entry, or NULL if the address is not in the table
+ **/
+
+Ipv6FilterEntry *ipv6FindFilterEntry(NetInterface *interface, const Ipv6Addr *ipAddr)
+{
+   Ipv6FilterEntry *entry;
+
+   //Walk the hash bucket the address maps to
+   for(entry = interface->ipv6FilterHashTable[ipv6CalcFilterHash(ipAddr)];
+      entry != NULL; entry = entry->hashNext)
+   {
+      //Matching entry?
+      if(ipv6CompAddr(&entry->addr, ipAddr))
+         return entry;
+   }
+
+   //The address is not in the table
+   return NULL;
+}
+
+
+/**
+ * @brief Rebuild the hash table used to look up the IPv6 filter table
+ * @param[in] interface Underlying network interface
+ **/
+
+void ipv6UpdateFilterHash(NetInterface *interface)
+{
+   uint_t i;
+   uint_t k;
+
+   //Clear hash table
+   memset(interface->ipv6FilterHashTable, 0, sizeof(interface->ipv6FilterHashTable));
+
+   //Loop through the IPv6 filter table
+   for(i = 0; i < interface->ipv6FilterSize; i++)
+   {
+      //Insert the entry in the corresponding hash bucket
+      k = ipv6CalcFilterHash(&interface->ipv6Filter[i].addr);
+      interface->ipv6Filter[i].hashNext = interface->ipv6FilterHashTable[k];
+      interface->ipv6FilterHashTable[k] = &interface->ipv6Filter[i];
+   }
+}
+
+
+/**
+ * @brief Hash function used to look up the IPv6 filter table
+ *
+ * Solicited-node multicast addresses only differ in their low-order
+ * 24 bits, so every word of the address is folded into the result
+ *
+ * @param[in] ipAddr IPv6 multicast address
+ * @return Index of the hash bucket
+ **/
+
+uint_t ipv6CalcFilterHash(const Ipv6Addr *ipAddr)
+{
+   uint32_t h;
+
+   //Fold the address
+   h = ipAddr->dw[0] ^ ipAddr->dw[1] ^ ipAddr->dw[2] ^ ipAddr->dw[3];
+   h ^= h >> 16;
+   h ^= h >> 8;
+
+   //Return the index of the hash bucket
+   return h & (IPV6_FILTER_HASH_TABLE_SIZE - 1);
 }
 
 
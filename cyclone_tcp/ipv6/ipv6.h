@@ -62,12 +62,33 @@
    #error IPV6_FILTER_MAX_SIZE parameter is invalid
 #endif
 
+//Size of the hash table used to look up the IPv6 filter table (must be a power of two)
+#ifndef IPV6_FILTER_HASH_TABLE_SIZE
+   #define IPV6_FILTER_HASH_TABLE_SIZE 8
+#elif (IPV6_FILTER_HASH_TABLE_SIZE < 1 || (IPV6_FILTER_HASH_TABLE_SIZE & (IPV6_FILTER_HASH_TABLE_SIZE - 1)))
+   #error IPV6_FILTER_HASH_TABLE_SIZE parameter is invalid
+#endif
+
+//Source-specific multicast filtering (MLDv2)
+#ifndef IPV6_MULTICAST_FILTER_SUPPORT
+   #define IPV6_MULTICAST_FILTER_SUPPORT DISABLED
+#elif (IPV6_MULTICAST_FILTER_SUPPORT != ENABLED && IPV6_MULTICAST_FILTER_SUPPORT != DISABLED)
+   #error IPV6_MULTICAST_FILTER_SUPPORT parameter is invalid
+#endif
+
+//Maximum number of source addresses per multicast address
+#ifndef IPV6_MAX_MULTICAST_SRC_ADDRS
+   #define IPV6_MAX_MULTICAST_SRC_ADDRS 4
+#elif (IPV6_MAX_MULTICAST_SRC_ADDRS < 1)
+   #error IPV6_MAX_MULTICAST_SRC_ADDRS parameter is invalid
+#endif
+
 //Version number for IPv6
 #define IPV6_VERSION 6
 //Minimum MTU that routers and physical links are required to handle
 #define IPV6_DEFAULT_MTU 1280
-//Maximum payload size
-#define IPV6_MAX_PAYLOAD_SIZE (ETH_MTU - sizeof(Ipv6Header))
+//Maximum payload size for the specified interface
+#define IPV6_MAX_PAYLOAD_SIZE(interface) ((interface)->mtu - sizeof(Ipv6Header))
 
 //Macro used for defining IPv6 addresses
 #define IPV6_ADDR(a, b, c, d, e, f, g, h) {{{ \
@@ -120,7 +141,8 @@ typedef enum
    IPV6_ADDR_STATE_TENTATIVE  = 1, ///<An address whose uniqueness on a link is being verified
    IPV6_ADDR_STATE_VALID      = 2, ///<A preferred or deprecated address
    IPV6_ADDR_STATE_PREFERRED  = 2, ///<An address assigned to an interface whose use is unrestricted
-   IPV6_ADDR_STATE_DEPRECATED = 3  ///<An address assigned to an interface whose use is discouraged
+   IPV6_ADDR_STATE_DEPRECATED = 3, ///<An address assigned to an interface whose use is discouraged
+   IPV6_ADDR_STATE_OPTIMISTIC = 4  ///<A tentative address that may already be used (RFC 4429)
 } Ipv6AddrState;
 
 
@@ -296,6 +318,17 @@ typedef __packed struct
 #endif
 
 
+/**
+ * @brief Duplicate Address Detection state
+ **/
+
+typedef struct
+{
+   uint_t transmitCount; ///<Number of Neighbor Solicitations sent so far
+   time_t timestamp;     ///<Time at which the last solicitation was sent
+} Ipv6DadState;
+
+
 /**
  * @brief IPv6 configuration
  **/
@@ -304,8 +337,10 @@ typedef struct
 {
    Ipv6Addr linkLocalAddr;                   ///<IPv6 link-local address
    Ipv6AddrState linkLocalAddrState;         ///<Current state of link-local address
+   Ipv6DadState linkLocalDad;                ///<DAD state of link-local address
    Ipv6Addr globalAddr;                      ///<IPv6 global address
    Ipv6AddrState globalAddrState;            ///<Current state of global address
+   Ipv6DadState globalDad;                   ///<DAD state of global address
    Ipv6Addr prefix;                          ///<IPv6 prefix information
    uint_t prefixLength;                      ///<IPv6 prefix length
    Ipv6Addr router;                          ///<IPv6 router
@@ -318,13 +353,19 @@ typedef struct
  * @brief IPv6 filter table entry
  **/
 
-typedef struct
+typedef struct _Ipv6FilterEntry
 {
-   Ipv6Addr addr;   ///<IPv6 address
-   uint_t refCount; ///<Reference count for the current entry
-   uint_t state;    ///<MLD node state
-   bool_t flag;     ///<MLD flag
-   time_t timer;    ///<Delay timer
+   Ipv6Addr addr;                     ///<IPv6 address
+   uint_t refCount;                   ///<Reference count for the current entry
+   uint_t state;                      ///<MLD node state
+   bool_t flag;                       ///<MLD flag
+   time_t timer;                      ///<Delay timer
+#if (IPV6_MULTICAST_FILTER_SUPPORT == ENABLED)
+   uint_t filterMode;                 ///<Source filter mode (include or exclude)
+   uint_t srcAddrCount;               ///<Number of source addresses
+   Ipv6Addr srcAddr[IPV6_MAX_MULTICAST_SRC_ADDRS]; ///<Source addresses
+#endif
+   struct _Ipv6FilterEntry *hashNext; ///<Next entry in the same hash bucket
 } Ipv6FilterEntry;
 
 
@@ -357,10 +398,17 @@ error_t ipv6ParseEspHeader(NetInterface *interface,
    const ChunkedBuffer *buffer, size_t *offset, size_t *nextHeaderOffset);
 
 error_t ipv6SendDatagram(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader,
-   ChunkedBuffer *buffer, size_t offset, uint8_t hopLimit);
+   ChunkedBuffer *buffer, size_t offset, uint8_t hopLimit, uint8_t trafficClass, IpPathCache *cache);
 
 error_t ipv6SendPacket(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader,
-   uint32_t fragId, uint16_t fragOffset, ChunkedBuffer *buffer, size_t offset, uint8_t hopLimit);
+   uint32_t fragId, uint16_t fragOffset, ChunkedBuffer *buffer, size_t offset,
+   uint8_t hopLimit, uint8_t trafficClass, IpPathCache *cache);
+
+bool_t ipv6CheckPathCache(NetInterface *interface, const IpPathCache *cache,
+   const Ipv6Addr *destAddr, const Ipv6Addr *nextHop);
+
+void ipv6UpdatePathCache(NetInterface *interface, IpPathCache *cache, uint_t generation,
+   const Ipv6Addr *destAddr, const Ipv6Addr *nextHop, const MacAddr *macAddr);
 
 error_t ipv6CheckSourceAddr(NetInterface *interface, const Ipv6Addr *ipAddr);
 error_t ipv6CheckDestAddr(NetInterface *interface, const Ipv6Addr *ipAddr);
@@ -368,9 +416,22 @@ error_t ipv6CheckDestAddr(NetInterface *interface, const Ipv6Addr *ipAddr);
 error_t ipv6SelectSourceAddr(NetInterface **interface,
    const Ipv6Addr *destAddr, Ipv6Addr *srcAddr);
 
+bool_t ipv6IsLocalHostAddr(NetInterface *interface, const Ipv6Addr *ipAddr);
+Ipv6AddrState ipv6GetAddrState(NetInterface *interface, const Ipv6Addr *ipAddr);
+
 error_t ipv6JoinMulticastGroup(NetInterface *interface, const Ipv6Addr *groupAddr);
 error_t ipv6LeaveMulticastGroup(NetInterface *interface, const Ipv6Addr *groupAddr);
 
+error_t ipv6SetMulticastSourceFilter(NetInterface *interface, const Ipv6Addr *groupAddr,
+   uint_t filterMode, const Ipv6Addr *srcAddr, uint_t srcAddrCount);
+
+error_t ipv6CheckSourceFilter(NetInterface *interface,
+   const Ipv6Addr *groupAddr, const Ipv6Addr *srcAddr);
+
+Ipv6FilterEntry *ipv6FindFilterEntry(NetInterface *interface, const Ipv6Addr *ipAddr);
+void ipv6UpdateFilterHash(NetInterface *interface);
+uint_t ipv6CalcFilterHash(const Ipv6Addr *ipAddr);
+
 bool_t ipv6CompPrefix(const Ipv6Addr *ipAddr1, const Ipv6Addr *ipAddr2, size_t length);
 error_t ipv6ComputeSolicitedNodeAddr(const Ipv6Addr *ipAddr, Ipv6Addr *solicitedNodeAddr);
 error_t ipv6MapMulticastAddrToMac(const Ipv6Addr *ipAddr, MacAddr *macAddr);
@@ -22,6 +22,14 @@
  * along with this program; if not, write to the Free Software Foundation,
  * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
  *
+ * @section Description
+ *
+ * Unlike IPv4, IPv6 fragmentation is only performed by the source node,
+ * using the Fragment header. Fragments are reassembled by the engine shared
+ * with IPv4 (see ip_frag.c). This file only parses the Fragment header and
+ * rebuilds the unfragmentable part of the original packet. Refer to
+ * RFC 2460 for more details
+ *
  * @author Oryx Embedded (www.oryx-embedded.com)
  * @version 1.3.8
  **/
@@ -34,6 +42,7 @@
 #include "ip.h"
 #include "ipv6.h"
 #include "ipv6_frag.h"
+#include "ip_frag.h"
 #include "icmpv6.h"
 #include "debug.h"
 
@@ -45,14 +54,17 @@
  * @brief Fragment IPv6 datagram into smaller packets
  * @param[in] interface Underlying network interface
  * @param[in] pseudoHeader IPv6 pseudo header
+ * @param[in] mtu Size of the largest packet that can be sent
  * @param[in] payload Multi-part buffer containing the payload
  * @param[in] payloadOffset Offset to the first payload byte
  * @param[in] hopLimit Hop Limit value
+ * @param[in] trafficClass Traffic Class field
  * @return Error code
  **/
 
 error_t ipv6FragmentDatagram(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader,
-   const ChunkedBuffer *payload, size_t payloadOffset, uint8_t hopLimit)
+   size_t mtu, const ChunkedBuffer *payload, size_t payloadOffset,
+   uint8_t hopLimit, uint8_t trafficClass)
 {
    error_t error;
    uint32_t id;
@@ -68,22 +80,26 @@ error_t ipv6FragmentDatagram(NetInterface *interface, Ipv6PseudoHeader *pseudoHe
    //Retrieve the length of the payload
    payloadLength = chunkedBufferGetLength(payload) - payloadOffset;
 
-   //Allocate a memory buffer to hold IP fragments
-   fragment = ipAllocBuffer(0, &fragmentOffset);
-   //Failed to allocate memory?
-   if(!fragment)
-      return ERROR_OUT_OF_MEMORY;
+   //Initialize status code
+   error = NO_ERROR;
 
    //Split the payload into multiple IP fragments
    for(offset = 0; offset < payloadLength; offset += length)
    {
-      //Flush the contents of the fragment
-      error = chunkedBufferSetLength(fragment, fragmentOffset);
-      //Sanity check
-      if(error) break;
+      //Each fragment is built in a fresh buffer. The header chunk cannot be
+      //reused since lower layers may still reference it once the fragment
+      //has been sent (address resolution queue, transmit queue, DMA)
+      fragment = ipAllocBuffer(0, &fragmentOffset);
+      //Failed to allocate memory?
+      if(!fragment)
+      {
+         //Report an error
+         error = ERROR_OUT_OF_MEMORY;
+         break;
+      }
 
       //Process the last fragment?
-      if((payloadLength - offset) <= IPV6_MAX_FRAG_SIZE)
+      if((payloadLength - offset) <= IPV6_MAX_FRAG_SIZE(mtu))
       {
          //Size of the current fragment
          length = payloadLength - offset;
@@ -92,26 +108,30 @@ error_t ipv6FragmentDatagram(NetInterface *interface, Ipv6PseudoHeader *pseudoHe
 
          //Do not set the MF flag for the last fragment
          error = ipv6SendPacket(interface, pseudoHeader, id,
-            offset, fragment, fragmentOffset, hopLimit);
+            offset, fragment, fragmentOffset, hopLimit, trafficClass, NULL);
       }
       else
       {
          //Size of the current fragment (must be a multiple of 8-byte blocks)
-         length = IPV6_MAX_FRAG_SIZE;
+         length = IPV6_MAX_FRAG_SIZE(mtu);
          //Copy fragment data
          chunkedBufferConcat(fragment, payload, payloadOffset + offset, length);
 
          //Fragmented packets must have the M flag set
          error = ipv6SendPacket(interface, pseudoHeader, id,
-            offset | IPV6_FLAG_M, fragment, fragmentOffset, hopLimit);
+            offset | IPV6_FLAG_M, fragment, fragmentOffset, hopLimit, trafficClass, NULL);
       }
 
+      //Release the fragment
+      chunkedBufferFree(fragment);
+
       //Failed to send current IP fragment?
       if(error) break;
+
+      //Update IP statistics
+      IPV6_MIB_INC(interface, ipFragCreates);
    }
 
-   //Free previously allocated memory
-   chunkedBufferFree(fragment);
    //Return status code
    return error;
 }
@@ -130,14 +150,17 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const MacAddr *srcMacAddr,
    const ChunkedBuffer *buffer, size_t fragHeaderOffset, size_t nextHeaderOffset)
 {
    error_t error;
+   size_t n;
    size_t length;
    uint16_t offset;
-   uint16_t dataFirst;
-   uint16_t dataLast;
-   Ipv6FragDesc *frag;
-   Ipv6HoleDesc *hole;
-   Ipv6HoleDesc *prevHole;
+   size_t dataFirst;
+   size_t dataLast;
+   uint8_t *p;
+   IpAddr srcAddr;
+   IpAddr destAddr;
+   IpFragDesc *frag;
    Ipv6Header *packet;
+   Ipv6Header *datagram;
    Ipv6FragmentHeader *header;
 
    //Remaining bytes to process in the payload
@@ -166,7 +189,7 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const MacAddr *srcMacAddr,
    if((offset & IPV6_FLAG_M) && (length % 8))
    {
       //Compute the offset of the Payload Length field within the packet
-      size_t n = (uint8_t *) &packet->payloadLength - (uint8_t *) packet;
+      n = (uint8_t *) &packet->payloadLength - (uint8_t *) packet;
 
       //The fragment must be discarded and an ICMP Parameter Problem
       //message should be sent to the source of the fragment, pointing
@@ -174,6 +197,8 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const MacAddr *srcMacAddr,
       icmpv6SendErrorMessage(interface, ICMPV6_TYPE_PARAM_PROBLEM,
          ICMPV6_CODE_INVALID_HEADER_FIELD, n, buffer);
 
+      //Update IP statistics
+      IPV6_MIB_INC(interface, ipReasmFails);
       //Exit immediately
       return;
    }
@@ -183,459 +208,108 @@ void ipv6ParseFragmentHeader(NetInterface *interface, const MacAddr *srcMacAddr,
    //Calculate the index immediately following the last byte
    dataLast = dataFirst + length;
 
+   //Source and destination addresses identify the datagram
+   srcAddr.length = sizeof(Ipv6Addr);
+   ipv6CopyAddr(&srcAddr.ipv6Addr, &packet->srcAddr);
+   destAddr.length = sizeof(Ipv6Addr);
+   ipv6CopyAddr(&destAddr.ipv6Addr, &packet->destAddr);
+
    //Search for a matching IP datagram being reassembled
-   frag = ipv6SearchFragQueue(interface, packet, header);
+   frag = ipSearchFragQueue(interface, &srcAddr, &destAddr, header->identification, 0);
    //No matching entry in the reassembly queue?
-   if(!frag) return;
-
-   //The very first fragment requires special handling
-   if(!(offset & IPV6_OFFSET_MASK))
+   if(!frag)
    {
-      uint8_t *p;
-
-      //Calculate the length of the unfragmentable part
-      frag->unfragPartLength = fragHeaderOffset;
+      //Update IP statistics
+      IPV6_MIB_INC(interface, ipReasmFails);
+      //Drop incoming packet
+      return;
+   }
 
-      //The size of the reconstructed datagram exceeds the maximum value?
-      if((frag->unfragPartLength + frag->fragPartLength) > IPV6_MAX_FRAG_DATAGRAM_SIZE)
-      {
-         //Compute the offset of the Fragment Offset field within the packet
-         size_t n = fragHeaderOffset + (uint8_t *) &header->fragmentOffset -
-            (uint8_t *) header;
-
-         //The fragment must be discarded and an ICMP Parameter Problem
-         //message should be sent to the source of the fragment, pointing
-         //to the Fragment Offset field of the fragment packet
-         icmpv6SendErrorMessage(interface, ICMPV6_TYPE_PARAM_PROBLEM,
-            ICMPV6_CODE_INVALID_HEADER_FIELD, n, buffer);
-
-         //Drop any allocated resources
-         chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
-      }
+   //The size of the reconstructed datagram exceeds the maximum value?
+   if((fragHeaderOffset + dataLast) > IPV6_MAX_FRAG_DATAGRAM_SIZE)
+   {
+      //Compute the offset of the Fragment Offset field within the packet
+      n = fragHeaderOffset + (uint8_t *) &header->fragmentOffset - (uint8_t *) header;
 
-      //Make sure the unfragmentable part entirely fits in the first chunk
-      if(frag->unfragPartLength > frag->buffer.chunk[0].size)
-      {
-         //Drop the reconstructed datagram
-         chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
-      }
+      //The fragment must be discarded and an ICMP Parameter Problem
+      //message should be sent to the source of the fragment, pointing
+      //to the Fragment Offset field of the fragment packet
+      icmpv6SendErrorMessage(interface, ICMPV6_TYPE_PARAM_PROBLEM,
+         ICMPV6_CODE_INVALID_HEADER_FIELD, n, buffer);
 
-      //Fix the length of the first chunk
-      frag->buffer.chunk[0].length = frag->unfragPartLength;
+      //Update IP statistics
+      IPV6_MIB_INC(interface, ipReasmFails);
+      //Drop the reconstructed datagram
+      ipDeleteFragDesc(interface, frag);
+      //Exit immediately
+      return;
+   }
 
+   //The very first fragment requires special handling
+   if(dataFirst == 0 && frag->headerLength == 0)
+   {
       //The unfragmentable part of the reassembled packet consists
       //of all headers up to, but not including, the Fragment header
       //of the first fragment packet
-      chunkedBufferCopy((ChunkedBuffer *) &frag->buffer, 0, buffer, 0, frag->unfragPartLength);
-
-      //Point to the Next Header field of the last header
-      p = chunkedBufferAt((ChunkedBuffer *) &frag->buffer, nextHeaderOffset);
-
-      //The Next Header field of the last header of the unfragmentable
-      //part is obtained from the Next Header field of the first
-      //fragment's Fragment header
-      *p = header->nextHeader;
-   }
-
-   //It may be necessary to increase the size of the buffer...
-   if(dataLast > frag->fragPartLength)
-   {
-      //The size of the reconstructed datagram exceeds the maximum value?
-      if((frag->unfragPartLength + dataLast) > IPV6_MAX_FRAG_DATAGRAM_SIZE)
-      {
-         //Compute the offset of the Fragment Offset field within the packet
-         size_t n = fragHeaderOffset + (uint8_t *) &header->fragmentOffset - (uint8_t *) header;
-
-         //The fragment must be discarded and an ICMP Parameter Problem
-         //message should be sent to the source of the fragment, pointing
-         //to the Fragment Offset field of the fragment packet
-         icmpv6SendErrorMessage(interface, ICMPV6_TYPE_PARAM_PROBLEM,
-            ICMPV6_CODE_INVALID_HEADER_FIELD, n, buffer);
-
-         //Drop any allocated resources
-         chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-         //Exit immediately
-         return;
-      }
-
-      //Adjust the size of the reconstructed datagram
-      error = chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer,
-         frag->unfragPartLength + dataLast + sizeof(Ipv6HoleDesc));
+      error = ipInsertFragHeader(interface, frag, buffer, fragHeaderOffset);
 
       //Any error to report?
       if(error)
       {
+         //Update IP statistics
+         IPV6_MIB_INC(interface, ipReasmFails);
          //Drop the reconstructed datagram
-         chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
+         ipDeleteFragDesc(interface, frag);
          //Exit immediately
          return;
       }
 
-      //Actual length of the fragmentable part
-      frag->fragPartLength = dataLast;
-   }
-
-   //Select the first hole descriptor from the list
-   hole = ipv6FindHole(frag, frag->firstHole);
-   //Keep track of the previous hole in the list
-   prevHole = NULL;
-
-   //Iterate through the hole descriptors
-   while(hole != NULL)
-   {
-      //Save lower and upper boundaries for later use
-      uint16_t holeFirst = hole->first;
-      uint16_t holeLast = hole->last;
-
-      //Check whether the newly arrived fragment
-      //interacts with this hole in some way
-      if(dataFirst < holeLast && dataLast > holeFirst)
-      {
-         //The current descriptor is no longer valid. We will destroy
-         //it, and in the next two steps, we will determine whether
-         //or not it is necessary to create any new hole descriptors
-         if(prevHole != NULL)
-            prevHole->next = hole->next;
-         else
-            frag->firstHole = hole->next;
-
-         //Is there still a hole at the beginning of the segment?
-         if(dataFirst > holeFirst)
-         {
-            //Create a new entry that describes this hole
-            hole = ipv6FindHole(frag, holeFirst);
-            hole->first = holeFirst;
-            hole->last = dataFirst;
-
-            //Insert the newly created entry into the hole descriptor list
-            if(prevHole != NULL)
-            {
-               hole->next = prevHole->next;
-               prevHole->next = hole->first;
-            }
-            else
-            {
-               hole->next = frag->firstHole;
-               frag->firstHole = hole->first;
-            }
-
-            //Always keep track of the previous hole
-            prevHole = hole;
-         }
-
-         //Is there still a hole at the end of the segment?
-         if(dataLast < holeLast && (offset & IPV6_FLAG_M))
-         {
-            //Create a new entry that describes this hole
-            hole = ipv6FindHole(frag, dataLast);
-            hole->first = dataLast;
-            hole->last = holeLast;
-
-            //Insert the newly created entry into the hole descriptor list
-            if(prevHole != NULL)
-            {
-               hole->next = prevHole->next;
-               prevHole->next = hole->first;
-            }
-            else
-            {
-               hole->next = frag->firstHole;
-               frag->firstHole = hole->first;
-            }
-
-            //Always keep track of the previous hole
-            prevHole = hole;
-         }
-      }
-      else
-      {
-         //The newly arrived fragment does not interact with the current hole
-         prevHole = hole;
-      }
-
-      //Select the next hole descriptor from the list
-      hole = ipv6FindHole(frag, prevHole ? prevHole->next : frag->firstHole);
-   }
-
-   //Copy data from the fragment to the reassembly buffer
-   chunkedBufferCopy((ChunkedBuffer *) &frag->buffer, frag->unfragPartLength + dataFirst,
-      buffer, fragHeaderOffset + sizeof(Ipv6FragmentHeader), length);
-
-   //Dump hole descriptor list
-   ipv6DumpHoleList(frag);
-
-   //If the hole descriptor list is empty, the reassembly process is now complete
-   if(!ipv6FindHole(frag, frag->firstHole))
-   {
-      //Discard the extra hole descriptor that follows the reconstructed datagram
-      error = chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer,
-         frag->unfragPartLength + frag->fragPartLength);
-
-      //Check status code
-      if(!error)
-      {
-         //Point to the IPv6 header
-         Ipv6Header *datagram = chunkedBufferAt((ChunkedBuffer *) &frag->buffer, 0);
-
-         //Fix the Payload Length field
-         datagram->payloadLength = htons(frag->unfragPartLength +
-            frag->fragPartLength - sizeof(Ipv6Header));
-
-         //Pass the original IPv6 datagram to the higher protocol layer
-         ipv6ProcessPacket(interface, srcMacAddr, (ChunkedBuffer *) &frag->buffer);
-      }
-
-      //Release previously allocated memory
-      chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-   }
-}
-
-
-/**
- * @brief Fragment reassembly timeout handler
- *
- * This routine must be periodically called by the TCP/IP stack to
- * handle IPv6 fragment reassembly timeout
- *
- * @param[in] interface Underlying network interface
- **/
-
-void ipv6FragTick(NetInterface *interface)
-{
-   error_t error;
-   uint_t i;
-   time_t time;
-   Ipv6HoleDesc *hole;
-
-   //Acquire exclusive access to the reassembly queue
-   osMutexAcquire(interface->ipv6FragQueueMutex);
-
-   //Get current time
-   time = osGetTickCount();
-
-   //Loop through the reassembly queue
-   for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
-   {
-      //Point to the current entry in the reassembly queue
-      Ipv6FragDesc *frag = &interface->ipv6FragQueue[i];
+      //Point to the Next Header field of the last header
+      p = (uint8_t *) frag->buffer.chunk[0].address + nextHeaderOffset;
 
-      //Make sure the entry is currently in use
-      if(frag->buffer.chunkCount > 0)
-      {
-         //If the timer runs out, the partially-reassembled datagram must be
-         //discarded and ICMPv6 Time Exceeded message sent to the source host
-         if((time - frag->timestamp) >= IPV6_FRAG_TIME_TO_LIVE)
-         {
-            //Debug message
-            TRACE_INFO("IPv6 fragment reassembly timeout...\r\n");
-            //Dump IP header contents for debugging purpose
-            ipv6DumpHeader(frag->buffer.chunk[0].address);
-
-            //Point to the first hole descriptor
-            hole = ipv6FindHole(frag, frag->firstHole);
-
-            //Make sure the fragment zero has been received
-            //before sending an ICMPv6 message
-            if(hole != NULL && hole->first > 0)
-            {
-               //Fix the size of the reconstructed datagram
-               error = chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer,
-                  frag->unfragPartLength + hole->first);
-
-               //Check status code
-               if(!error)
-               {
-                  //Send an ICMPv6 Time Exceeded message
-                  icmpv6SendErrorMessage(interface, ICMPV6_TYPE_TIME_EXCEEDED,
-                     ICMPV6_CODE_REASSEMBLY_TIME_EXCEEDED, 0, (ChunkedBuffer *) &frag->buffer);
-               }
-            }
-
-            //Drop the partially reconstructed datagram
-            chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-         }
-      }
+      //The Next Header field of the last header of the unfragmentable
+      //part is obtained from the Next Header field of the first
+      //fragment's Fragment header
+      *p = header->nextHeader;
    }
 
-   //Release exclusive access to the reassembly queue
-   osMutexRelease(interface->ipv6FragQueueMutex);
-}
-
-
-/**
- * @brief Search for a matching datagram in the reassembly queue
- * @param[in] interface Underlying network interface
- * @param[in] packet Incoming IPv6 packet
- * @param[in] header Pointer to the Fragment header
- * @return Matching fragment descriptor
- **/
-
-Ipv6FragDesc *ipv6SearchFragQueue(NetInterface *interface,
-   Ipv6Header *packet, Ipv6FragmentHeader *header)
-{
-   error_t error;
-   uint_t i;
-   Ipv6Header *datagram;
-   Ipv6FragDesc *frag;
-   Ipv6HoleDesc *hole;
-
-   //Search for a matching IP datagram being reassembled
-   for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
-   {
-      //Point to the current entry in the reassembly queue
-      frag = &interface->ipv6FragQueue[i];
-
-      //Check whether the current entry is used?
-      if(frag->buffer.chunkCount > 0)
-      {
-         //Point to the corresponding datagram
-         datagram = chunkedBufferAt((ChunkedBuffer *) &frag->buffer, 0);
-
-         //Check source and destination addresses
-         if(!ipv6CompAddr(&datagram->srcAddr, &packet->srcAddr))
-            continue;
-         if(!ipv6CompAddr(&datagram->destAddr, &packet->destAddr))
-            continue;
-         //Compare fragment identification fields
-         if(frag->identification != header->identification)
-            continue;
-
-         //A matching entry has been found in the reassembly queue
-         return frag;
-      }
-   }
+   //Add the fragmentable part of the packet to the datagram
+   error = ipInsertFragment(interface, frag, dataFirst, dataLast, !(offset & IPV6_FLAG_M),
+      buffer, fragHeaderOffset + sizeof(Ipv6FragmentHeader));
 
-   //If the current packet does not match an existing entry
-   //in the reassembly queue, then create a new entry
-   for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
+   //Any error to report?
+   if(error)
    {
-      //Point to the current entry in the reassembly queue
-      frag = &interface->ipv6FragQueue[i];
-
-      //The current entry is free?
-      if(!frag->buffer.chunkCount)
-      {
-         //Number of chunks that comprise the reassembly buffer
-         frag->buffer.maxChunkCount = arraysize(frag->buffer.chunk);
-
-         //Allocate sufficient memory to hold the IPv6 header and
-         //the first hole descriptor
-         error = chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer,
-            MEM_POOL_BUFFER_SIZE + sizeof(Ipv6HoleDesc));
-
-         //Failed to allocate memory?
-         if(error)
-         {
-            //Clean up side effects
-            chunkedBufferSetLength((ChunkedBuffer *) &frag->buffer, 0);
-            //Exit immediately
-            return NULL;
-         }
-
-         //Initial length of the reconstructed datagram
-         frag->unfragPartLength = sizeof(Ipv6Header);
-         frag->fragPartLength = 0;
-
-         //Fix the length of the first chunk
-         frag->buffer.chunk[0].length = frag->unfragPartLength;
-         //Copy IPv6 header from the incoming fragment
-         chunkedBufferWrite((ChunkedBuffer *) &frag->buffer, 0, packet, frag->unfragPartLength);
-
-         //Save current time
-         frag->timestamp = osGetTickCount();
-         //Record fragment identification field
-         frag->identification = header->identification;
-         //Create a new entry in the hole descriptor list
-         frag->firstHole = 0;
-
-         //Point to first hole descriptor
-         hole = ipv6FindHole(frag, frag->firstHole);
-         //The entry describes the datagram  as  being completely missing
-         hole->first = 0;
-         hole->last = IPV6_INFINITY;
-         hole->next = IPV6_INFINITY;
-
-         //Dump hole descriptor list
-         ipv6DumpHoleList(frag);
-
-         //Return the matching fragment descriptor
-         return frag;
-      }
+      //Update IP statistics
+      IPV6_MIB_INC(interface, ipReasmFails);
+      //Drop the reconstructed datagram
+      ipDeleteFragDesc(interface, frag);
+      //Exit immediately
+      return;
    }
 
-   //The reassembly queue is full
-   return NULL;
-}
-
-
-/**
- * @brief Flush IPv6 reassembly queue
- * @param[in] interface Underlying network interface
- **/
-
-void ipv6FlushFragQueue(NetInterface *interface)
-{
-   uint_t i;
-
-   //Acquire exclusive access to the reassembly queue
-   osMutexAcquire(interface->ipv6FragQueueMutex);
+   //Dump the list of received fragments
+   ipDumpFragList(frag);
 
-   //Loop through the reassembly queue
-   for(i = 0; i < IPV6_MAX_FRAG_DATAGRAMS; i++)
+   //The reassembly process is complete once all the payload has been received
+   if(ipIsFragComplete(frag))
    {
-      //Drop any partially reconstructed datagram
-      chunkedBufferSetLength((ChunkedBuffer *) &interface->ipv6FragQueue[i].buffer, 0);
-   }
-
-   //Release exclusive access to the reassembly queue
-   osMutexRelease(interface->ipv6FragQueueMutex);
-}
-
-
-/**
- * @brief Retrieve hole descriptor
- * @param[in] frag IPv6 fragment descriptor
- * @param[in] offset Offset of the hole
- * @return A pointer to the hole descriptor is returned if the
- *   specified offset is valid. Otherwise NULL is returned
- **/
-
-Ipv6HoleDesc *ipv6FindHole(Ipv6FragDesc *frag, uint16_t offset)
-{
-   //Return a pointer to the hole descriptor
-   return chunkedBufferAt((ChunkedBuffer *) &frag->buffer, frag->unfragPartLength + offset);
-}
+      //Point to the IPv6 header
+      datagram = frag->buffer.chunk[0].address;
 
+      //Fix the Payload Length field
+      datagram->payloadLength = htons(frag->headerLength +
+         frag->dataLength - sizeof(Ipv6Header));
 
-/**
- * @brief Dump hole descriptor list
- * @param[in] frag IPv6 fragment descriptor
- **/
+      //Update IP statistics
+      IPV6_MIB_INC(interface, ipReasmOKs);
 
-void ipv6DumpHoleList(Ipv6FragDesc *frag)
-{
-//Check debugging level
-#if (TRACE_LEVEL >= TRACE_LEVEL_DEBUG)
-   Ipv6HoleDesc *hole;
+      //Pass the original IPv6 datagram to the higher protocol layer
+      ipv6ProcessPacket(interface, srcMacAddr, (ChunkedBuffer *) &frag->buffer);
 
-   //Debug message
-   TRACE_DEBUG("Hole descriptor list:\r\n");
-   //Select the first hole descriptor from the list
-   hole = ipv6FindHole(frag, frag->firstHole);
-
-   //Loop through the hole descriptor list
-   while(hole != NULL)
-   {
-      //Display current hole
-      TRACE_DEBUG("  %u - %u\r\n", hole->first, hole->last);
-      //Select the next hole descriptor from the list
-      hole = ipv6FindHole(frag, hole->next);
+      //Release previously allocated memory
+      ipDeleteFragDesc(interface, frag);
    }
-#endif
 }
 
 #endif
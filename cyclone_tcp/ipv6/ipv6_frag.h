@@ -40,15 +40,7 @@
    #error IPV6_FRAG_SUPPORT parameter is invalid
 #endif
 
-//Reassembly algorithm tick interval
-#ifndef IPV6_FRAG_TICK_INTERVAL
-   #define IPV6_FRAG_TICK_INTERVAL 1000
-#elif (IPV6_FRAG_TICK_INTERVAL < 100)
-   #error IPV6_FRAG_TICK_INTERVAL parameter is invalid
-#endif
-
-//Maximum number of fragmented packets the host will accept
-//and hold in the reassembly queue simultaneously
+//Number of entries IPv6 contributes to the shared reassembly queue
 #ifndef IPV6_MAX_FRAG_DATAGRAMS
    #define IPV6_MAX_FRAG_DATAGRAMS 4
 #elif (IPV6_MAX_FRAG_DATAGRAMS < 1)
@@ -70,77 +62,15 @@
 #endif
 
 //Maximum payload size for fragmented packets (shall be a multiple of 8-byte blocks)
-#define IPV6_MAX_FRAG_SIZE ((IPV6_MAX_PAYLOAD_SIZE - sizeof(Ipv6FragmentHeader)) & ~0x0007)
-//Infinity is implemented by a very large integer
-#define IPV6_INFINITY 0xFFFF
-
-
-#if (defined(__GNUC__) || defined(_WIN32))
-   #define __packed
-   #pragma pack(push, 1)
-#endif
-
-
-/**
- * @brief Hole descriptor
- **/
-
-__packed typedef struct
-{
-   uint16_t first;
-   uint16_t last;
-   uint16_t next;
-} Ipv6HoleDesc;
-
-
-#if (defined(__GNUC__) || defined(_WIN32))
-   #undef __packed
-   #pragma pack(pop)
-#endif
-
-
-/**
- * @brief Reassembly buffer
- **/
-
-typedef struct
-{
-   uint_t chunkCount;
-   uint_t maxChunkCount;
-   ChunkDesc chunk[N(IPV6_MAX_FRAG_DATAGRAM_SIZE) + 1];
-} Ipv6ReassemblyBuffer;
-
-
-/**
- * @brief Fragmented packet descriptor
- **/
-
-typedef struct
-{
-   time_t timestamp;            ///<Time at which the first fragment was received
-   uint32_t identification;     ///<Fragment identification field
-   size_t unfragPartLength;     ///<Length of the unfragmentable part
-   size_t fragPartLength;       ///<Length of the fragmentable part
-   uint16_t firstHole;          ///<Index of the first hole
-   Ipv6ReassemblyBuffer buffer; ///<Buffer containing the reassembled datagram
-} Ipv6FragDesc;
+#define IPV6_MAX_FRAG_SIZE(mtu) (((mtu) - sizeof(Ipv6Header) - sizeof(Ipv6FragmentHeader)) & ~0x0007)
 
 
 //IPv6 datagram fragmentation and reassembly
 error_t ipv6FragmentDatagram(NetInterface *interface, Ipv6PseudoHeader *pseudoHeader,
-   const ChunkedBuffer *payload, size_t payloadOffset, uint8_t hopLimit);
+   size_t mtu, const ChunkedBuffer *payload, size_t payloadOffset,
+   uint8_t hopLimit, uint8_t trafficClass);
 
 void ipv6ParseFragmentHeader(NetInterface *interface, const MacAddr *srcMacAddr,
    const ChunkedBuffer *buffer, size_t fragHeaderOffset, size_t nextHeaderOffset);
 
-void ipv6FragTick(NetInterface *interface);
-
-Ipv6FragDesc *ipv6SearchFragQueue(NetInterface *interface,
-   Ipv6Header *packet, Ipv6FragmentHeader *header);
-
-void ipv6FlushFragQueue(NetInterface *interface);
-
-Ipv6HoleDesc *ipv6FindHole(Ipv6FragDesc *frag, uint16_t offset);
-void ipv6DumpHoleList(Ipv6FragDesc *frag);
-
 #endif
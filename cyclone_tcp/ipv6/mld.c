@@ -50,6 +50,10 @@
 //Check TCP/IP stack configuration
 #if (IPV6_SUPPORT == ENABLED && MLD_SUPPORT == ENABLED)
 
+//All MLDv2-capable routers address
+const Ipv6Addr MLD_V2_ALL_ROUTERS_ADDR =
+   IPV6_ADDR(0xFF02, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0016);
+
 
 /**
  * @brief MLD initialization
@@ -59,6 +63,12 @@
 
 error_t mldInit(NetInterface *interface)
 {
+#if (IPV6_MULTICAST_FILTER_SUPPORT == ENABLED)
+   //MLDv2 is used until an MLDv1 query is heard
+   interface->mldv1QuerierPresent = FALSE;
+   interface->mldv1QuerierPresentTimer = osGetTickCount();
+#endif
+
    //Successful initialization
    return NO_ERROR;
 }
@@ -89,7 +99,7 @@ error_t mldStartListening(NetInterface *interface, Ipv6FilterEntry *entry)
       if(interface->linkState)
       {
          //Send a Multicast Listener Report message for the group on the interface
-         mldSendListenerReport(interface, &entry->addr);
+         mldReportListener(interface, entry, TRUE);
 
          //Set flag
          entry->flag = TRUE;
@@ -125,9 +135,21 @@ error_t mldStopListening(NetInterface *interface, Ipv6FilterEntry *entry)
    //Check link state
    if(interface->linkState)
    {
+      //MLDv2 host compatibility mode?
+      if(MLD_V2_MODE(interface))
+      {
+         //Leaving an address is reported as a change to an empty include list
+         if(!ipv6CompAddr(&entry->addr, &IPV6_LINK_LOCAL_ALL_NODES_ADDR))
+         {
+            mldSendListenerReportV2(interface, &entry->addr,
+               MLD_ADDR_RECORD_TYPE_TO_IN, NULL, 0);
+         }
+      }
       //Send a Multicast Listener Done message if the flag is set
-      if(entry->flag)
+      else if(entry->flag)
+      {
          mldSendListenerDone(interface, &entry->addr);
+      }
    }
 
    //Switch to the Non-Listener state
@@ -138,6 +160,41 @@ error_t mldStopListening(NetInterface *interface, Ipv6FilterEntry *entry)
 }
 
 
+/**
+ * @brief Report the change of the source filter of a multicast address
+ *
+ * The caller is responsible for holding the IPv6 filter mutex
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] entry IPv6 filter entry whose source filter has changed
+ **/
+
+void mldStateChange(NetInterface *interface, Ipv6FilterEntry *entry)
+{
+   //The link-scope all-nodes address (FF02::1) is never reported
+   if(ipv6CompAddr(&entry->addr, &IPV6_LINK_LOCAL_ALL_NODES_ADDR))
+      return;
+   //The report is sent when the link comes up
+   if(!interface->linkState)
+      return;
+
+   //MLDv1 does not convey source filters, hence the state reported
+   //to the queriers is left unchanged
+   if(MLD_V2_MODE(interface))
+   {
+      //Send a State Change Report for the multicast address
+      mldReportListener(interface, entry, TRUE);
+
+      //Set flag
+      entry->flag = TRUE;
+      //The report is retransmitted when the timer expires
+      entry->timer = osGetTickCount() + MLD_UNSOLICITED_REPORT_INTERVAL;
+      //Enter the Delaying Listener state
+      entry->state = MLD_STATE_DELAYING_LISTENER;
+   }
+}
+
+
 /**
  * @brief MLD timer handler
  *
@@ -156,6 +213,12 @@ void mldTick(NetInterface *interface)
    //Get current time
    time = osGetTickCount();
 
+#if (IPV6_MULTICAST_FILTER_SUPPORT == ENABLED)
+   //Check MLDv1 querier present timer
+   if(timeCompare(time, interface->mldv1QuerierPresentTimer) >= 0)
+      interface->mldv1QuerierPresent = FALSE;
+#endif
+
    //Acquire exclusive access to the IPv6 filter table
    osMutexAcquire(interface->ipv6FilterMutex);
 
@@ -172,7 +235,7 @@ void mldTick(NetInterface *interface)
          if(timeCompare(time, entry->timer) >= 0)
          {
             //Send a Multicast Listener Report message
-            mldSendListenerReport(interface, &entry->addr);
+            mldReportListener(interface, entry, FALSE);
 
             //Set flag
             entry->flag = TRUE;
@@ -207,6 +270,12 @@ void mldLinkChangeEvent(NetInterface *interface)
    //Link up event?
    if(interface->linkState)
    {
+#if (IPV6_MULTICAST_FILTER_SUPPORT == ENABLED)
+      //MLDv2 is used until an MLDv1 query is heard
+      interface->mldv1QuerierPresent = FALSE;
+      interface->mldv1QuerierPresentTimer = time;
+#endif
+
       //Loop through filter table entries
       for(i = 0; i < interface->ipv6FilterSize; i++)
       {
@@ -220,7 +289,7 @@ void mldLinkChangeEvent(NetInterface *interface)
             continue;
 
          //Send an unsolicited Multicast Listener Report message for that group
-         mldSendListenerReport(interface, &entry->addr);
+         mldReportListener(interface, entry, TRUE);
 
          //Set flag
          entry->flag = TRUE;
@@ -297,9 +366,34 @@ void mldProcessListenerQuery(NetInterface *interface, Ipv6PseudoHeader *pseudoHe
    //Get current time
    time = osGetTickCount();
 
+#if (IPV6_MULTICAST_FILTER_SUPPORT == ENABLED)
+   //MLDv2 Multicast Listener Query message?
+   if(length >= sizeof(MldListenerQueryV2))
+   {
+      //The Maximum Response Code field is expressed in milliseconds. Large
+      //values are encoded using a floating-point representation
+      maxRespDelay = mldDecodeFloatingPointValue(ntohs(message->maxRespDelay));
+
+      //Multicast Address and Source Specific Queries are answered with
+      //the current state of the whole multicast address
+   }
+   //MLDv1 Multicast Listener Query message?
+   else
+   {
+      //The host falls back to MLDv1 while MLDv1 queries are heard
+      interface->mldv1QuerierPresent = TRUE;
+      //Restart MLDv1 querier present timer
+      interface->mldv1QuerierPresentTimer = time + MLD_V1_QUERIER_PRESENT_TIMEOUT;
+
+      //The Max Resp Delay field specifies the maximum time allowed
+      //before sending a responding report
+      maxRespDelay = message->maxRespDelay * 10;
+   }
+#else
    //The Max Resp Delay field specifies the maximum time allowed
    //before sending a responding report
    maxRespDelay = message->maxRespDelay * 10;
+#endif
 
    //Acquire exclusive access to the IPv6 filter table
    osMutexAcquire(interface->ipv6FilterMutex);
@@ -395,6 +489,10 @@ void mldProcessListenerReport(NetInterface *interface, Ipv6PseudoHeader *pseudoH
    if(hopLimit != MLD_HOP_LIMIT)
       return;
 
+   //MLDv2 nodes do not suppress their reports
+   if(MLD_V2_MODE(interface))
+      return;
+
    //Acquire exclusive access to the IPv6 filter table
    osMutexAcquire(interface->ipv6FilterMutex);
 
@@ -424,6 +522,44 @@ void mldProcessListenerReport(NetInterface *interface, Ipv6PseudoHeader *pseudoH
 }
 
 
+/**
+ * @brief Report the state of a multicast address
+ *
+ * The type of report is determined by the host compatibility mode. MLDv2
+ * reports carry the current source filter of the multicast address
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] entry IPv6 filter entry identifying the multicast address
+ * @param[in] stateChange Report a change of state rather than the current state
+ * @return Error code
+ **/
+
+error_t mldReportListener(NetInterface *interface,
+   Ipv6FilterEntry *entry, bool_t stateChange)
+{
+#if (IPV6_MULTICAST_FILTER_SUPPORT == ENABLED)
+   uint8_t recordType;
+
+   //MLDv2 host compatibility mode?
+   if(MLD_V2_MODE(interface))
+   {
+      //Select the type of multicast address record
+      if(entry->filterMode == IP_FILTER_MODE_INCLUDE)
+         recordType = stateChange ? MLD_ADDR_RECORD_TYPE_TO_IN : MLD_ADDR_RECORD_TYPE_IS_IN;
+      else
+         recordType = stateChange ? MLD_ADDR_RECORD_TYPE_TO_EX : MLD_ADDR_RECORD_TYPE_IS_EX;
+
+      //Send an MLDv2 Multicast Listener Report message
+      return mldSendListenerReportV2(interface, &entry->addr, recordType,
+         entry->srcAddr, entry->srcAddrCount);
+   }
+#endif
+
+   //Send an MLDv1 Multicast Listener Report message
+   return mldSendListenerReport(interface, &entry->addr);
+}
+
+
 /**
  * @brief Send Multicast Listener Report message
  * @param[in] interface Underlying network interface
@@ -481,7 +617,92 @@ error_t mldSendListenerReport(NetInterface *interface, Ipv6Addr *ipAddr)
    mldDumpMessage(message);
 
    //The Multicast Listener Report message is sent to the multicast address being reported
-   error = ipv6SendDatagram(interface, &pseudoHeader, buffer, offset, MLD_HOP_LIMIT);
+   error = ipv6SendDatagram(interface, &pseudoHeader, buffer, offset, MLD_HOP_LIMIT, IP_TOS_NETWORK_CONTROL, NULL);
+
+   //Free previously allocated memory
+   chunkedBufferFree(buffer);
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Send MLDv2 Multicast Listener Report message
+ * @param[in] interface Underlying network interface
+ * @param[in] ipAddr IPv6 address specifying the multicast address
+ * @param[in] recordType Type of the multicast address record
+ * @param[in] srcAddr List of source addresses
+ * @param[in] srcAddrCount Number of source addresses
+ * @return Error code
+ **/
+
+error_t mldSendListenerReportV2(NetInterface *interface, const Ipv6Addr *ipAddr,
+   uint8_t recordType, const Ipv6Addr *srcAddr, uint_t srcAddrCount)
+{
+   error_t error;
+   uint_t i;
+   size_t length;
+   size_t offset;
+   MldListenerReportV2 *message;
+   ChunkedBuffer *buffer;
+   Ipv6PseudoHeader pseudoHeader;
+
+   //Make sure the specified address is a valid multicast address
+   if(!ipv6IsMulticastAddr(ipAddr))
+      return ERROR_INVALID_ADDRESS;
+
+   //The link-scope all-nodes address (FF02::1) is handled as a special
+   //case. The host never sends a report for that address
+   if(ipv6CompAddr(ipAddr, &IPV6_LINK_LOCAL_ALL_NODES_ADDR))
+      return ERROR_INVALID_ADDRESS;
+
+   //The report contains a single multicast address record
+   length = sizeof(MldListenerReportV2) + srcAddrCount * sizeof(Ipv6Addr);
+
+   //Allocate a memory buffer to hold a MLD message
+   buffer = ipAllocBuffer(length, &offset);
+   //Failed to allocate memory?
+   if(!buffer) return ERROR_OUT_OF_MEMORY;
+
+   //Point to the beginning of the MLD message
+   message = chunkedBufferAt(buffer, offset);
+
+   //Format the Multicast Listener Report message
+   message->type = ICMPV6_TYPE_MULTICAST_LISTENER_REPORT_V2;
+   message->reserved = 0;
+   message->checksum = 0;
+   message->flags = 0;
+   message->numOfAddrRecords = HTONS(1);
+
+   //Format the multicast address record
+   message->record.recordType = recordType;
+   message->record.auxDataLen = 0;
+   message->record.numOfSources = htons(srcAddrCount);
+   message->record.multicastAddr = *ipAddr;
+
+   //Copy the list of source addresses
+   for(i = 0; i < srcAddrCount; i++)
+      message->record.srcAddr[i] = srcAddr[i];
+
+   //Format IPv6 pseudo header
+   pseudoHeader.srcAddr = interface->ipv6Config.linkLocalAddr;
+   pseudoHeader.destAddr = MLD_V2_ALL_ROUTERS_ADDR;
+   pseudoHeader.length = htonl(length);
+   pseudoHeader.reserved = 0;
+   pseudoHeader.nextHeader = IPV6_ICMPV6_HEADER;
+
+   //Message checksum calculation
+   message->checksum = ipCalcUpperLayerChecksumEx(&pseudoHeader,
+      sizeof(Ipv6PseudoHeader), buffer, offset, length);
+
+   //Debug message
+   TRACE_INFO("Sending MLDv2 Multicast Listener Report (%u bytes)...\r\n", length);
+   TRACE_DEBUG("  Record Type = %u\r\n", recordType);
+   TRACE_DEBUG("  Multicast Address = %s\r\n", ipv6AddrToString(ipAddr, NULL));
+   TRACE_DEBUG("  Number of Sources = %u\r\n", srcAddrCount);
+
+   //Version 2 Reports are sent to the all-MLDv2-capable-routers address
+   error = ipv6SendDatagram(interface, &pseudoHeader, buffer, offset, MLD_HOP_LIMIT, IP_TOS_NETWORK_CONTROL, NULL);
 
    //Free previously allocated memory
    chunkedBufferFree(buffer);
@@ -547,7 +768,7 @@ error_t mldSendListenerDone(NetInterface *interface, Ipv6Addr *ipAddr)
    mldDumpMessage(message);
 
    //The Multicast Listener Done message is sent to the all-routers multicast address
-   error = ipv6SendDatagram(interface, &pseudoHeader, buffer, offset, MLD_HOP_LIMIT);
+   error = ipv6SendDatagram(interface, &pseudoHeader, buffer, offset, MLD_HOP_LIMIT, IP_TOS_NETWORK_CONTROL, NULL);
 
    //Free previously allocated memory
    chunkedBufferFree(buffer);
@@ -556,6 +777,34 @@ error_t mldSendListenerDone(NetInterface *interface, Ipv6Addr *ipAddr)
 }
 
 
+/**
+ * @brief Decode a floating-point value
+ *
+ * Maximum Response Code values greater than or equal to 32768 represent
+ * a mantissa and an exponent (refer to RFC 3810, section 5.1.3)
+ *
+ * @param[in] code Encoded value
+ * @return Decoded value
+ **/
+
+uint32_t mldDecodeFloatingPointValue(uint16_t code)
+{
+   uint16_t exp;
+   uint16_t mant;
+
+   //Small values are encoded directly
+   if(code < 32768)
+      return code;
+
+   //Retrieve the exponent and the mantissa
+   exp = (code >> 12) & 0x07;
+   mant = code & 0x0FFF;
+
+   //Return the decoded value
+   return (uint32_t) (mant | 0x1000) << (exp + 3);
+}
+
+
 /**
  * @brief Get a random value in the specified range
  * @param[in] max Upper bound
@@ -53,9 +53,23 @@
    #error MLD_UNSOLICITED_REPORT_INTERVAL parameter is invalid
 #endif
 
+//MLDv1 querier present timeout
+#ifndef MLD_V1_QUERIER_PRESENT_TIMEOUT
+   #define MLD_V1_QUERIER_PRESENT_TIMEOUT 260000
+#elif (MLD_V1_QUERIER_PRESENT_TIMEOUT < 1000)
+   #error MLD_V1_QUERIER_PRESENT_TIMEOUT parameter is invalid
+#endif
+
 //Hop Limit used by MLD messages
 #define MLD_HOP_LIMIT 1
 
+//MLDv2 host compatibility mode
+#if (IPV6_MULTICAST_FILTER_SUPPORT == ENABLED)
+   #define MLD_V2_MODE(interface) (!(interface)->mldv1QuerierPresent)
+#else
+   #define MLD_V2_MODE(interface) FALSE
+#endif
+
 
 /**
  * @brief MLD node states
@@ -69,6 +83,21 @@ typedef enum
 } MldState;
 
 
+/**
+ * @brief MLDv2 multicast address record types
+ **/
+
+typedef enum
+{
+   MLD_ADDR_RECORD_TYPE_IS_IN    = 1,
+   MLD_ADDR_RECORD_TYPE_IS_EX    = 2,
+   MLD_ADDR_RECORD_TYPE_TO_IN    = 3,
+   MLD_ADDR_RECORD_TYPE_TO_EX    = 4,
+   MLD_ADDR_RECORD_TYPE_ALLOW    = 5,
+   MLD_ADDR_RECORD_TYPE_BLOCK    = 6
+} MldAddrRecordType;
+
+
 #if (defined(__GNUC__) || defined(_WIN32))
    #define __packed
    #pragma pack(push, 1)
@@ -90,16 +119,68 @@ typedef __packed struct
 } MldMessage;
 
 
+/**
+ * @brief MLDv2 Multicast Listener Query message
+ **/
+
+typedef __packed struct
+{
+   uint8_t type;           //0
+   uint8_t code;           //1
+   uint16_t checksum;      //2-3
+   uint16_t maxRespCode;   //4-5
+   uint16_t reserved;      //6-7
+   Ipv6Addr multicastAddr; //8-23
+   uint8_t flags;          //24
+   uint8_t qqic;           //25
+   uint16_t numOfSources;  //26-27
+   Ipv6Addr srcAddr[];     //28
+} MldListenerQueryV2;
+
+
+/**
+ * @brief MLDv2 multicast address record
+ **/
+
+typedef __packed struct
+{
+   uint8_t recordType;     //0
+   uint8_t auxDataLen;     //1
+   uint16_t numOfSources;  //2-3
+   Ipv6Addr multicastAddr; //4-19
+   Ipv6Addr srcAddr[];     //20
+} MldAddrRecord;
+
+
+/**
+ * @brief MLDv2 Multicast Listener Report message
+ **/
+
+typedef __packed struct
+{
+   uint8_t type;                 //0
+   uint8_t reserved;             //1
+   uint16_t checksum;            //2-3
+   uint16_t flags;               //4-5
+   uint16_t numOfAddrRecords;    //6-7
+   MldAddrRecord record;         //8
+} MldListenerReportV2;
+
+
 #if (defined(__GNUC__) || defined(_WIN32))
    #undef __packed
    #pragma pack(pop)
 #endif
 
 
+//MLDv2 related constants
+extern const Ipv6Addr MLD_V2_ALL_ROUTERS_ADDR;
+
 //MLD related functions
 error_t mldInit(NetInterface *interface);
 error_t mldStartListening(NetInterface *interface, Ipv6FilterEntry *entry);
 error_t mldStopListening(NetInterface *interface, Ipv6FilterEntry *entry);
+void mldStateChange(NetInterface *interface, Ipv6FilterEntry *entry);
 
 void mldTick(NetInterface *interface);
 void mldLinkChangeEvent(NetInterface *interface);
@@ -113,6 +194,14 @@ void mldProcessListenerReport(NetInterface *interface, Ipv6PseudoHeader *pseudoH
 error_t mldSendListenerReport(NetInterface *interface, Ipv6Addr *ipAddr);
 error_t mldSendListenerDone(NetInterface *interface, Ipv6Addr *ipAddr);
 
+error_t mldReportListener(NetInterface *interface,
+   Ipv6FilterEntry *entry, bool_t stateChange);
+
+error_t mldSendListenerReportV2(NetInterface *interface, const Ipv6Addr *ipAddr,
+   uint8_t recordType, const Ipv6Addr *srcAddr, uint_t srcAddrCount);
+
+uint32_t mldDecodeFloatingPointValue(uint16_t code);
+
 uint32_t mldRand(uint32_t max);
 
 void mldDumpMessage(const MldMessage *message);
@@ -43,11 +43,19 @@
 #include "ipv6.h"
 #include "icmpv6.h"
 #include "ndp.h"
+#include "slaac.h"
+#include "ip_route.h"
 #include "debug.h"
 
 //Check TCP/IP stack configuration
 #if (IPV6_SUPPORT == ENABLED)
 
+//NDP related local functions
+static uint_t ndpHashAddr(const Ipv6Addr *ipAddr);
+static void ndpLruUnlink(NetInterface *interface, NdpCacheEntry *entry);
+static void ndpLruInsertHead(NetInterface *interface, NdpCacheEntry *entry);
+static void ndpLruInsertTail(NetInterface *interface, NdpCacheEntry *entry);
+
 
 /**
  * @brief Neighbor cache initialization
@@ -57,14 +65,27 @@
 
 error_t ndpInit(NetInterface *interface)
 {
+   uint_t i;
+
    //Create a mutex to prevent simultaneous access to Neighbor cache
-   interface->ndpCacheMutex = osMutexCreate(FALSE);
+   interface->ndpCacheMutex = osMutexCreateNamed(FALSE, "NdpCache");
    //Any error to report?
    if(interface->ndpCacheMutex == OS_INVALID_HANDLE)
       return ERROR_OUT_OF_RESOURCES;
 
    //Initialize Neighbor cache
    memset(interface->ndpCache, 0, sizeof(interface->ndpCache));
+   //No IPv6 address is indexed yet
+   memset(interface->ndpHashTable, 0, sizeof(interface->ndpHashTable));
+   //Initialize Destination cache
+   memset(interface->ndpDestCache, 0, sizeof(interface->ndpDestCache));
+
+   //All the entries are free and sit on the LRU list
+   interface->ndpLruHead = NULL;
+   interface->ndpLruTail = NULL;
+
+   for(i = 0; i < NDP_CACHE_SIZE; i++)
+      ndpLruInsertTail(interface, &interface->ndpCache[i]);
 
    //Successful initialization
    return NO_ERROR;
@@ -90,12 +111,14 @@ void ndpFlushCache(NetInterface *interface)
       //Point to the current entry
       entry = &interface->ndpCache[i];
 
-      //Drop packets that are waiting for address resolution
-      ndpFlushQueuedPackets(interface, entry);
       //Release Neighbor cache entry
-      entry->state = NDP_STATE_NONE;
+      if(entry->state != NDP_STATE_NONE)
+         ndpDeleteEntry(interface, entry);
    }
 
+   //The next hops must be determined again
+   ndpFlushDestCache(interface);
+
    //Release exclusive access to Neighbor cache
    osMutexRelease(interface->ndpCacheMutex);
 }
@@ -103,50 +126,59 @@ void ndpFlushCache(NetInterface *interface)
 
 /**
  * @brief Create a new entry in the Neighbor cache
+ *
+ * Free entries are kept at the tail of the LRU list. When the cache is
+ * full, the tail is the least recently used entry and gets recycled
+ *
  * @param[in] interface Underlying network interface
+ * @param[in] ipAddr IPv6 address the entry refers to
  * @return Pointer to the newly created entry
  **/
 
-NdpCacheEntry *ndpCreateEntry(NetInterface *interface)
+NdpCacheEntry *ndpCreateEntry(NetInterface *interface, const Ipv6Addr *ipAddr)
 {
    uint_t i;
    NdpCacheEntry *entry;
-   NdpCacheEntry *oldestEntry;
 
-   //Keep track of the oldest entry
-   oldestEntry = &interface->ndpCache[0];
+   //Point to the least recently used entry
+   entry = interface->ndpLruTail;
 
-   //Loop through Neighbor cache entries
-   for(i = 0; i < NDP_CACHE_SIZE; i++)
+   //The cache is full?
+   if(entry->state != NDP_STATE_NONE)
    {
-      //Point to the current entry
-      entry = &interface->ndpCache[i];
+      //The least recently used entry is removed
+      ndpDeleteEntry(interface, entry);
+   }
 
-      //Check whether the entry is currently in used or not
-      if(entry->state == NDP_STATE_NONE)
-      {
-         //Erase contents
-         memset(entry, 0, sizeof(NdpCacheEntry));
-         //Return a pointer to the Neighbor cache entry
-         return entry;
-      }
+   //Initialize the entry
+   entry->ipAddr = *ipAddr;
+   entry->macAddr = MAC_UNSPECIFIED_ADDR;
+   entry->timestamp = 0;
+   entry->timeout = 0;
+   entry->retransmitCount = 0;
+   entry->lastUsed = 0;
+   entry->refreshFlag = FALSE;
+   entry->queueSize = 0;
 
-      //Keep track of the oldest entry in the table
-      if(timeCompare(entry->timestamp, oldestEntry->timestamp) < 0)
-         oldestEntry = entry;
-   }
+   //Index the entry by IPv6 address
+   i = ndpHashAddr(ipAddr);
+   entry->hashNext = interface->ndpHashTable[i];
+   interface->ndpHashTable[i] = entry;
+
+   //The entry is now the most recently used one
+   ndpLruUnlink(interface, entry);
+   ndpLruInsertHead(interface, entry);
 
-   //Drop any pending packets
-   ndpFlushQueuedPackets(interface, oldestEntry);
-   //The oldest entry is removed whenever the table runs out of space
-   memset(oldestEntry, 0, sizeof(NdpCacheEntry));
    //Return a pointer to the Neighbor cache entry
-   return oldestEntry;
+   return entry;
 }
 
 
 /**
  * @brief Search the Neighbor cache for a given IPv6 address
+ *
+ * The matching entry becomes the most recently used one
+ *
  * @param[in] interface Underlying network interface
  * @param[in] ipAddr IPv6 address
  * @return A pointer to the matching entry is returned. NULL is returned if
@@ -155,21 +187,24 @@ NdpCacheEntry *ndpCreateEntry(NetInterface *interface)
 
 NdpCacheEntry *ndpFindEntry(NetInterface *interface, const Ipv6Addr *ipAddr)
 {
-   uint_t i;
    NdpCacheEntry *entry;
 
-   //Loop through Neighbor cache entries
-   for(i = 0; i < NDP_CACHE_SIZE; i++)
+   //Walk through the entries sharing the same hash value
+   for(entry = interface->ndpHashTable[ndpHashAddr(ipAddr)];
+      entry != NULL; entry = entry->hashNext)
    {
-      //Point to the current entry
-      entry = &interface->ndpCache[i];
-
-      //Check whether the entry is currently in used
-      if(entry->state != NDP_STATE_NONE)
+      //Current entry matches the specified address?
+      if(ipv6CompAddr(&entry->ipAddr, ipAddr))
       {
-         //Current entry matches the specified address?
-         if(ipv6CompAddr(&entry->ipAddr, ipAddr))
-            return entry;
+         //Move the entry to the head of the LRU list
+         if(entry != interface->ndpLruHead)
+         {
+            ndpLruUnlink(interface, entry);
+            ndpLruInsertHead(interface, entry);
+         }
+
+         //Return a pointer to the Neighbor cache entry
+         return entry;
       }
    }
 
@@ -178,6 +213,294 @@ NdpCacheEntry *ndpFindEntry(NetInterface *interface, const Ipv6Addr *ipAddr)
 }
 
 
+/**
+ * @brief Remove an entry from the Neighbor cache
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the entry to be deleted
+ **/
+
+void ndpDeleteEntry(NetInterface *interface, NdpCacheEntry *entry)
+{
+   NdpCacheEntry **p;
+
+   //Drop packets that are waiting for address resolution
+   ndpFlushQueuedPackets(interface, entry);
+
+   //Look for the link pointing to the entry
+   for(p = &interface->ndpHashTable[ndpHashAddr(&entry->ipAddr)];
+      *p != NULL; p = &(*p)->hashNext)
+   {
+      //Unlink the entry
+      if(*p == entry)
+      {
+         *p = entry->hashNext;
+         break;
+      }
+   }
+
+   //Release Neighbor cache entry
+   entry->hashNext = NULL;
+   entry->state = NDP_STATE_NONE;
+
+   //Invalidate the paths cached by connected sockets
+   interface->neighborCacheGen++;
+
+   //Free entries are reused first
+   ndpLruUnlink(interface, entry);
+   ndpLruInsertTail(interface, entry);
+}
+
+
+/**
+ * @brief Determine the next hop for a given destination
+ *
+ * The Destination cache is checked first. On a miss, the next-hop
+ * determination of RFC 4861 section 5.2 is performed and its result
+ * is saved in the cache
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] destAddr Unicast destination address
+ * @param[out] nextHop Address of the neighbor the packet must be sent to
+ * @return Error code
+ **/
+
+error_t ndpGetNextHop(NetInterface *interface,
+   const Ipv6Addr *destAddr, Ipv6Addr *nextHop)
+{
+   error_t error;
+   bool_t routed;
+   NdpDestCacheEntry *entry;
+
+   //Acquire exclusive access to Neighbor cache
+   osMutexAcquire(interface->ndpCacheMutex);
+
+   //Search the Destination cache
+   entry = ndpFindDestEntry(interface, destAddr);
+
+   //Cache hit?
+   if(entry)
+   {
+      //Retrieve the next-hop address
+      *nextHop = entry->nextHop;
+      //Successful lookup
+      error = NO_ERROR;
+   }
+   else
+   {
+      //Not a static route so far
+      routed = FALSE;
+
+      //Link-local destinations and destinations that match the prefix
+      //are on-link. Static routes come next, then the default router
+      if(ipv6IsLinkLocalUnicastAddr(destAddr) || ipv6CompPrefix(destAddr,
+         &interface->ipv6Config.prefix, interface->ipv6Config.prefixLength))
+      {
+         //The next hop is the destination itself
+         *nextHop = *destAddr;
+         error = NO_ERROR;
+      }
+#if (IP_ROUTE_SUPPORT == ENABLED)
+      else if(!ipv6RouteLookup(interface, destAddr, nextHop))
+      {
+         //Use the next hop of the most specific route
+         routed = TRUE;
+         error = NO_ERROR;
+      }
+#endif
+      else if(!ipv6CompAddr(&interface->ipv6Config.router, &IPV6_UNSPECIFIED_ADDR))
+      {
+         //Use the default router to forward the packet
+         *nextHop = interface->ipv6Config.router;
+         error = NO_ERROR;
+      }
+      else
+      {
+         //There is no route to the outside world...
+         error = ERROR_NO_ROUTE;
+      }
+
+      //Save the result in the Destination cache
+      if(!error)
+      {
+         //Point to the slot the destination maps to
+         entry = &interface->ndpDestCache[ndpHashAddr(destAddr) &
+            (NDP_DEST_CACHE_SIZE - 1)];
+
+         //Replace the previous contents of the slot
+         entry->valid = TRUE;
+         entry->destAddr = *destAddr;
+         entry->nextHop = *nextHop;
+         entry->routed = routed;
+         entry->pathMtu = interface->mtu;
+         entry->timestamp = osGetTickCount();
+      }
+   }
+
+   //Release exclusive access to Neighbor cache
+   osMutexRelease(interface->ndpCacheMutex);
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Search the Destination cache for a given address
+ *
+ * The cache is direct-mapped. Entries expire after NDP_DEST_CACHE_LIFETIME,
+ * so that a change of the prefix is eventually taken into account. An
+ * entry that refers to a router other than the current one is ignored.
+ * The caller must hold the Neighbor cache mutex
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] destAddr Destination address
+ * @return A pointer to the matching entry, or NULL if none was found
+ **/
+
+NdpDestCacheEntry *ndpFindDestEntry(NetInterface *interface, const Ipv6Addr *destAddr)
+{
+   NdpDestCacheEntry *entry;
+
+   //Point to the slot the destination maps to
+   entry = &interface->ndpDestCache[ndpHashAddr(destAddr) &
+      (NDP_DEST_CACHE_SIZE - 1)];
+
+   //Empty slot or different destination?
+   if(!entry->valid || !ipv6CompAddr(&entry->destAddr, destAddr))
+      return NULL;
+
+   //The entry has expired?
+   if((osGetTickCount() - entry->timestamp) >= NDP_DEST_CACHE_LIFETIME)
+   {
+      entry->valid = FALSE;
+      return NULL;
+   }
+
+   //The default router has changed? Static routes are taken care of by
+   //flushing the cache when the routing table is modified
+   if(!entry->routed && !ipv6CompAddr(&entry->nextHop, destAddr) &&
+      !ipv6CompAddr(&entry->nextHop, &interface->ipv6Config.router))
+   {
+      entry->valid = FALSE;
+      return NULL;
+   }
+
+   //Return a pointer to the matching entry
+   return entry;
+}
+
+
+/**
+ * @brief Flush Destination cache
+ *
+ * The caller must hold the Neighbor cache mutex
+ *
+ * @param[in] interface Underlying network interface
+ **/
+
+void ndpFlushDestCache(NetInterface *interface)
+{
+   uint_t i;
+
+   //Invalidate all the entries
+   for(i = 0; i < NDP_DEST_CACHE_SIZE; i++)
+      interface->ndpDestCache[i].valid = FALSE;
+}
+
+
+/**
+ * @brief Compute the hash value of an IPv6 address
+ *
+ * The interface identifier carries most of the entropy
+ *
+ * @param[in] ipAddr IPv6 address
+ * @return Hash value (to be masked by the size of the table)
+ **/
+
+static uint_t ndpHashAddr(const Ipv6Addr *ipAddr)
+{
+   uint32_t h;
+
+   //Fold the interface identifier
+   h = ipAddr->dw[2] ^ ipAddr->dw[3];
+   h ^= h >> 16;
+   h ^= h >> 8;
+
+   //Return the hash value
+   return h;
+}
+
+
+/**
+ * @brief Remove an entry from the LRU list
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the Neighbor cache entry
+ **/
+
+static void ndpLruUnlink(NetInterface *interface, NdpCacheEntry *entry)
+{
+   //Update the link held by the previous entry
+   if(entry->lruPrev != NULL)
+      entry->lruPrev->lruNext = entry->lruNext;
+   else
+      interface->ndpLruHead = entry->lruNext;
+
+   //Update the link held by the next entry
+   if(entry->lruNext != NULL)
+      entry->lruNext->lruPrev = entry->lruPrev;
+   else
+      interface->ndpLruTail = entry->lruPrev;
+
+   //The entry is no longer linked
+   entry->lruPrev = NULL;
+   entry->lruNext = NULL;
+}
+
+
+/**
+ * @brief Insert an entry at the head of the LRU list
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the Neighbor cache entry
+ **/
+
+static void ndpLruInsertHead(NetInterface *interface, NdpCacheEntry *entry)
+{
+   //Link the entry in front of the current head
+   entry->lruPrev = NULL;
+   entry->lruNext = interface->ndpLruHead;
+
+   if(interface->ndpLruHead != NULL)
+      interface->ndpLruHead->lruPrev = entry;
+   else
+      interface->ndpLruTail = entry;
+
+   //The entry is now the most recently used one
+   interface->ndpLruHead = entry;
+}
+
+
+/**
+ * @brief Insert an entry at the tail of the LRU list
+ * @param[in] interface Underlying network interface
+ * @param[in] entry Pointer to the Neighbor cache entry
+ **/
+
+static void ndpLruInsertTail(NetInterface *interface, NdpCacheEntry *entry)
+{
+   //Link the entry behind the current tail
+   entry->lruPrev = interface->ndpLruTail;
+   entry->lruNext = NULL;
+
+   if(interface->ndpLruTail != NULL)
+      interface->ndpLruTail->lruNext = entry;
+   else
+      interface->ndpLruHead = entry;
+
+   //The entry will be the first one to be reused
+   interface->ndpLruTail = entry;
+}
+
+
 /**
  * @brief Send packets that are waiting for address resolution
  * @param[in] interface Underlying network interface
@@ -280,6 +603,8 @@ error_t ndpResolve(NetInterface *interface, const Ipv6Addr *ipAddr, MacAddr *mac
       {
          //Copy the MAC address associated with the specified IPv6 address
          *macAddr = entry->macAddr;
+         //Keep track of the entries that are actively used
+         entry->lastUsed = osGetTickCount();
 
          //Release exclusive access to Neighbor cache
          osMutexRelease(interface->ndpCacheMutex);
@@ -289,7 +614,7 @@ error_t ndpResolve(NetInterface *interface, const Ipv6Addr *ipAddr, MacAddr *mac
    }
 
    //If no entry exists, then create a new one
-   entry = ndpCreateEntry(interface);
+   entry = ndpCreateEntry(interface, ipAddr);
 
    //Any error to report?
    if(!entry)
@@ -300,17 +625,8 @@ error_t ndpResolve(NetInterface *interface, const Ipv6Addr *ipAddr, MacAddr *mac
       return ERROR_OUT_OF_RESOURCES;
    }
 
-   //Record the IPv6 address whose MAC address is unknown
-   entry->ipAddr = *ipAddr;
-   entry->macAddr = MAC_UNSPECIFIED_ADDR;
-
-   //Reset retransmission counter
-   entry->retransmitCount = 0;
-   //No packet are pending in the transmit queue
-   entry->queueSize = 0;
-
    //Send a multicast Neighbor Solicitation message
-   ndpSendNeighborSol(interface, ipAddr);
+   ndpSendNeighborSol(interface, ipAddr, TRUE);
 
    //Save the time at which the message was sent
    entry->timestamp = osGetTickCount();
@@ -381,8 +697,8 @@ error_t ndpEnqueuePacket(NetInterface *interface,
 
       //Index of the entry to be filled in
       i = entry->queueSize;
-      //Allocate a memory buffer to store the packet
-      entry->queue[i].buffer = chunkedBufferAlloc(length);
+      //Keep a reference to the packet contents rather than a copy
+      entry->queue[i].buffer = chunkedBufferClone(buffer, 0, length);
 
       //Failed to allocate memory?
       if(!entry->queue[i].buffer)
@@ -393,8 +709,6 @@ error_t ndpEnqueuePacket(NetInterface *interface,
          return ERROR_OUT_OF_MEMORY;
       }
 
-      //Copy packet contents
-      chunkedBufferCopy(entry->queue[i].buffer, 0, buffer, 0, length);
       //Offset to the first byte of the IPv6 header
       entry->queue[i].offset = offset;
 
@@ -456,7 +770,7 @@ void ndpTick(NetInterface *interface)
             if(entry->retransmitCount < NDP_MAX_MULTICAST_SOLICIT)
             {
                //Retransmit a multicast Neighbor Solicitation message
-               ndpSendNeighborSol(interface, &entry->ipAddr);
+               ndpSendNeighborSol(interface, &entry->ipAddr, TRUE);
 
                //Save the time at which the message was sent
                entry->timestamp = time;
@@ -465,10 +779,8 @@ void ndpTick(NetInterface *interface)
             }
             else
             {
-               //Drop packets that are waiting for address resolution
-               ndpFlushQueuedPackets(interface, entry);
                //The entry should be deleted since address resolution has failed
-               entry->state = NDP_STATE_NONE;
+               ndpDeleteEntry(interface, entry);
             }
          }
       }
@@ -480,9 +792,25 @@ void ndpTick(NetInterface *interface)
          {
             //Save current time
             entry->timestamp = osGetTickCount();
+            //Invalidate the paths cached by connected sockets
+            interface->neighborCacheGen++;
             //Enter STALE state
             entry->state = NDP_STATE_STALE;
          }
+#if (NDP_REFRESH_TIME > 0)
+         //An entry that has been used since its last confirmation is
+         //refreshed shortly before it expires, so that steady flows never
+         //have to wait for the address to be resolved again
+         else if(!entry->refreshFlag &&
+            (time - entry->timestamp) >= (entry->timeout - NDP_REFRESH_TIME) &&
+            timeCompare(entry->lastUsed, entry->timestamp) > 0)
+         {
+            //Send a unicast Neighbor Solicitation message
+            ndpSendNeighborSol(interface, &entry->ipAddr, FALSE);
+            //Only one refresh solicitation is sent
+            entry->refreshFlag = TRUE;
+         }
+#endif
       }
       //DELAY state?
       else if(entry->state == NDP_STATE_DELAY)
@@ -491,7 +819,7 @@ void ndpTick(NetInterface *interface)
          if((time - entry->timestamp) >= entry->timeout)
          {
             //Send a unicast Neighbor Solicitation message
-            ndpSendNeighborSol(interface, &entry->ipAddr);
+            ndpSendNeighborSol(interface, &entry->ipAddr, FALSE);
 
             //Save the time at which the message was sent
             entry->timestamp = time;
@@ -514,7 +842,7 @@ void ndpTick(NetInterface *interface)
             if(entry->retransmitCount < NDP_MAX_UNICAST_SOLICIT)
             {
                //Send a unicast Neighbor Solicitation message
-               ndpSendNeighborSol(interface, &entry->ipAddr);
+               ndpSendNeighborSol(interface, &entry->ipAddr, FALSE);
 
                //Save the time at which the packet was sent
                entry->timestamp = time;
@@ -524,7 +852,7 @@ void ndpTick(NetInterface *interface)
             else
             {
                //The entry should be deleted since the host is not reachable anymore
-               entry->state = NDP_STATE_NONE;
+               ndpDeleteEntry(interface, entry);
             }
          }
       }
@@ -548,6 +876,7 @@ void ndpProcessNeighborSol(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
    const ChunkedBuffer *buffer, size_t offset, uint8_t hopLimit)
 {
    size_t length;
+   Ipv6AddrState state;
    NdpNeighborSolMessage *message;
    NdpLinkLayerAddrOption *option;
    NdpCacheEntry *entry;
@@ -600,6 +929,28 @@ void ndpProcessNeighborSol(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
       return;
    }
 
+   //Get the state of the target address
+   state = ipv6GetAddrState(interface, &message->targetAddr);
+
+   //DAD is still in progress for the target address?
+   if(state == IPV6_ADDR_STATE_TENTATIVE || state == IPV6_ADDR_STATE_OPTIMISTIC)
+   {
+      //A solicitation sent from the unspecified address means that another
+      //node is performing DAD for the same address (RFC 4862 5.4.3)
+      if(ipv6CompAddr(&pseudoHeader->srcAddr, &IPV6_UNSPECIFIED_ADDR))
+      {
+         //The address is a duplicate and must not be used
+         slaacDupAddrDetected(interface, &message->targetAddr);
+         //Exit immediately
+         return;
+      }
+
+      //A tentative address does not answer solicitations. An optimistic
+      //address answers them without the Override flag (RFC 4429 3.3)
+      if(state == IPV6_ADDR_STATE_TENTATIVE)
+         return;
+   }
+
    //Calculate the length of the Options field
    length -= sizeof(NdpNeighborSolMessage);
    //Search for the Source Link-Layer Address option
@@ -627,16 +978,17 @@ void ndpProcessNeighborSol(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
       if(!entry)
       {
          //Create an entry
-         entry = ndpCreateEntry(interface);
+         entry = ndpCreateEntry(interface, &pseudoHeader->srcAddr);
 
          //Neighbor cache entry successfully created?
          if(entry)
          {
-            //Record the IPv6 and the corresponding MAC address
-            entry->ipAddr = pseudoHeader->srcAddr;
+            //Record the corresponding MAC address
             entry->macAddr = option->linkLayerAddr;
             //Save current time
             entry->timestamp = osGetTickCount();
+            //Invalidate the paths cached by connected sockets
+            interface->neighborCacheGen++;
             //Enter the STALE state
             entry->state = NDP_STATE_STALE;
          }
@@ -652,6 +1004,8 @@ void ndpProcessNeighborSol(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
             ndpSendQueuedPackets(interface, entry);
             //Save current time
             entry->timestamp = osGetTickCount();
+            //Invalidate the paths cached by connected sockets
+            interface->neighborCacheGen++;
             //Enter the STALE state
             entry->state = NDP_STATE_STALE;
          }
@@ -665,6 +1019,8 @@ void ndpProcessNeighborSol(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
                entry->macAddr = option->linkLayerAddr;
                //Save current time
                entry->timestamp = osGetTickCount();
+               //Invalidate the paths cached by connected sockets
+               interface->neighborCacheGen++;
                //Enter the STALE state
                entry->state = NDP_STATE_STALE;
             }
@@ -677,8 +1033,10 @@ void ndpProcessNeighborSol(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
    //Source Link-Layer Address option not found?
    else
    {
-      //This option must be included in multicast solicitations
-      if(ipv6IsMulticastAddr(&pseudoHeader->destAddr))
+      //This option must be included in multicast solicitations, except
+      //for DAD probes that are sent from the unspecified address
+      if(ipv6IsMulticastAddr(&pseudoHeader->destAddr) &&
+         !ipv6CompAddr(&pseudoHeader->srcAddr, &IPV6_UNSPECIFIED_ADDR))
       {
          //Debug message
          TRACE_WARNING("The Source Link-Layer Address must be included!\r\n");
@@ -706,6 +1064,7 @@ void ndpProcessNeighborAdv(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
    const ChunkedBuffer *buffer, size_t offset, uint8_t hopLimit)
 {
    size_t length;
+   Ipv6AddrState state;
    NdpNeighborAdvMessage *message;
    NdpLinkLayerAddrOption *option;
    NdpCacheEntry *entry;
@@ -754,6 +1113,19 @@ void ndpProcessNeighborAdv(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
       return;
    }
 
+   //Get the state of the target address
+   state = ipv6GetAddrState(interface, &message->targetAddr);
+
+   //An advertisement for a tentative or optimistic address means that
+   //the address is already in use on the link (RFC 4862 5.4.4)
+   if(state == IPV6_ADDR_STATE_TENTATIVE || state == IPV6_ADDR_STATE_OPTIMISTIC)
+   {
+      //The address is a duplicate and must not be used
+      slaacDupAddrDetected(interface, &message->targetAddr);
+      //Exit immediately
+      return;
+   }
+
    //Calculate the length of the Options field
    length -= sizeof(NdpNeighborSolMessage);
    //Search for the Target Link-Layer Address option
@@ -790,12 +1162,16 @@ void ndpProcessNeighborAdv(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
             {
                //Computing the random ReachableTime value
                entry->timeout = NDP_REACHABLE_TIME;
+               //The entry may be refreshed before it expires
+               entry->refreshFlag = FALSE;
                //Switch to the REACHABLE state
                entry->state = NDP_STATE_REACHABLE;
             }
             //Solicited flag is cleared?
             else
             {
+               //Invalidate the paths cached by connected sockets
+               interface->neighborCacheGen++;
                //Enter the STALE state
                entry->state = NDP_STATE_STALE;
             }
@@ -813,6 +1189,8 @@ void ndpProcessNeighborAdv(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
                   entry->timestamp = osGetTickCount();
                   //Computing the random ReachableTime value
                   entry->timeout = NDP_REACHABLE_TIME;
+                  //The entry may be refreshed before it expires
+                  entry->refreshFlag = FALSE;
                   //Switch to the REACHABLE state
                   entry->state = NDP_STATE_REACHABLE;
                }
@@ -824,6 +1202,8 @@ void ndpProcessNeighborAdv(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
                   {
                      //Save current time
                      entry->timestamp = osGetTickCount();
+                     //Invalidate the paths cached by connected sockets
+                     interface->neighborCacheGen++;
                      //Enter the STALE state
                      entry->state = NDP_STATE_STALE;
                   }
@@ -834,10 +1214,14 @@ void ndpProcessNeighborAdv(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
             {
                //Record link-layer address (if different)
                entry->macAddr = option->linkLayerAddr;
+               //Invalidate the paths cached by connected sockets
+               interface->neighborCacheGen++;
                //Save current time
                entry->timestamp = osGetTickCount();
                //Computing the random ReachableTime value
                entry->timeout = NDP_REACHABLE_TIME;
+               //The entry may be refreshed before it expires
+               entry->refreshFlag = FALSE;
                //Switch to the REACHABLE state
                entry->state = NDP_STATE_REACHABLE;
             }
@@ -851,6 +1235,8 @@ void ndpProcessNeighborAdv(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
                   entry->macAddr = option->linkLayerAddr;
                   //Save current time
                   entry->timestamp = osGetTickCount();
+                  //Invalidate the paths cached by connected sockets
+                  interface->neighborCacheGen++;
                   //Enter the STALE state
                   entry->state = NDP_STATE_STALE;
                }
@@ -880,6 +1266,7 @@ error_t ndpSendRouterSol(NetInterface *interface)
    error_t error;
    size_t offset;
    size_t length;
+   Ipv6AddrState state;
    ChunkedBuffer *buffer;
    NdpRouterSolMessage *message;
    Ipv6PseudoHeader pseudoHeader;
@@ -904,9 +1291,19 @@ error_t ndpSendRouterSol(NetInterface *interface)
    //Length of the message, excluding any option
    length = sizeof(NdpRouterSolMessage);
 
-   //The Source Link-Layer Address option must not be included
-   //when the host IPv6 address is unspecified
-   if(!ipv6CompAddr(&interface->ipv6Config.linkLocalAddr, &IPV6_UNSPECIFIED_ADDR))
+   //Get the state of the link-local address
+   state = ipv6GetAddrState(interface, &interface->ipv6Config.linkLocalAddr);
+
+   //A tentative address cannot be used as source address
+   if(state == IPV6_ADDR_STATE_TENTATIVE)
+      pseudoHeader.srcAddr = IPV6_UNSPECIFIED_ADDR;
+   else
+      pseudoHeader.srcAddr = interface->ipv6Config.linkLocalAddr;
+
+   //The Source Link-Layer Address option must not be included when the
+   //source address is unspecified or optimistic (RFC 4429 3.2)
+   if(!ipv6CompAddr(&pseudoHeader.srcAddr, &IPV6_UNSPECIFIED_ADDR) &&
+      state != IPV6_ADDR_STATE_OPTIMISTIC)
    {
       //Add Source Link-Layer Address option
       ndpAddOption(message, &length, NDP_OPT_SOURCE_LINK_LAYER_ADDR,
@@ -917,7 +1314,6 @@ error_t ndpSendRouterSol(NetInterface *interface)
    chunkedBufferSetLength(buffer, offset + length);
 
    //Format IPv6 pseudo header
-   pseudoHeader.srcAddr = interface->ipv6Config.linkLocalAddr;
    pseudoHeader.destAddr = IPV6_LINK_LOCAL_ALL_ROUTERS_ADDR;
    pseudoHeader.length = htonl(length);
    pseudoHeader.reserved = 0;
@@ -933,7 +1329,7 @@ error_t ndpSendRouterSol(NetInterface *interface)
    ndpDumpRouterSolMessage(message);
 
    //Send Router Solicitation message
-   error = ipv6SendDatagram(interface, &pseudoHeader, buffer, offset, NDP_HOP_LIMIT);
+   error = ipv6SendDatagram(interface, &pseudoHeader, buffer, offset, NDP_HOP_LIMIT, IP_TOS_NETWORK_CONTROL, NULL);
 
    //Free previously allocated memory
    chunkedBufferFree(buffer);
@@ -946,14 +1342,18 @@ error_t ndpSendRouterSol(NetInterface *interface)
  * @brief Send a Neighbor Solicitation message
  * @param[in] interface Underlying network interface
  * @param[in] targetIpAddr Target IPv6 address
+ * @param[in] multicast Send the message to the solicited-node multicast
+ *   address (address resolution) rather than to the target (NUD probe)
  * @return Error code
  **/
 
-error_t ndpSendNeighborSol(NetInterface *interface, const Ipv6Addr *targetIpAddr)
+error_t ndpSendNeighborSol(NetInterface *interface,
+   const Ipv6Addr *targetIpAddr, bool_t multicast)
 {
    error_t error;
    size_t offset;
    size_t length;
+   Ipv6AddrState state;
    ChunkedBuffer *buffer;
    NdpNeighborSolMessage *message;
    Ipv6PseudoHeader pseudoHeader;
@@ -979,9 +1379,25 @@ error_t ndpSendNeighborSol(NetInterface *interface, const Ipv6Addr *targetIpAddr
    //Length of the message, excluding any option
    length = sizeof(NdpNeighborSolMessage);
 
+   //Get the state of the target address
+   state = ipv6GetAddrState(interface, targetIpAddr);
+
+   //Soliciting one of our own addresses while DAD is in progress?
+   if(state == IPV6_ADDR_STATE_TENTATIVE || state == IPV6_ADDR_STATE_OPTIMISTIC)
+   {
+      //DAD probes are multicast from the unspecified address (RFC 4862 5.4.2)
+      pseudoHeader.srcAddr = IPV6_UNSPECIFIED_ADDR;
+      multicast = TRUE;
+   }
+   else
+   {
+      //Use the link-local address as source address
+      pseudoHeader.srcAddr = interface->ipv6Config.linkLocalAddr;
+   }
+
    //The Source Link-Layer Address option must not be included
-   //when the host IPv6 address is unspecified
-   if(!ipv6CompAddr(&interface->ipv6Config.linkLocalAddr, &IPV6_UNSPECIFIED_ADDR))
+   //when the source IPv6 address is unspecified
+   if(!ipv6CompAddr(&pseudoHeader.srcAddr, &IPV6_UNSPECIFIED_ADDR))
    {
       //Add Source Link-Layer Address option
       ndpAddOption(message, &length, NDP_OPT_SOURCE_LINK_LAYER_ADDR,
@@ -991,12 +1407,21 @@ error_t ndpSendNeighborSol(NetInterface *interface, const Ipv6Addr *targetIpAddr
    //Adjust the length of the multi-part buffer
    chunkedBufferSetLength(buffer, offset + length);
 
-   //Compute the solicited-node multicast address that
-   //corresponds to the target IPv6 address
-   ipv6ComputeSolicitedNodeAddr(targetIpAddr, &pseudoHeader.destAddr);
+   //Address resolution uses multicast solicitations whereas reachability
+   //confirmation is sent directly to the cached address (RFC 4861 7.2.2)
+   if(multicast)
+   {
+      //Compute the solicited-node multicast address that
+      //corresponds to the target IPv6 address
+      ipv6ComputeSolicitedNodeAddr(targetIpAddr, &pseudoHeader.destAddr);
+   }
+   else
+   {
+      //Unicast solicitation
+      pseudoHeader.destAddr = *targetIpAddr;
+   }
 
    //Format IPv6 pseudo header
-   pseudoHeader.srcAddr = interface->ipv6Config.linkLocalAddr;
    pseudoHeader.length = htonl(length);
    pseudoHeader.reserved = 0;
    pseudoHeader.nextHeader = IPV6_ICMPV6_HEADER;
@@ -1011,7 +1436,7 @@ error_t ndpSendNeighborSol(NetInterface *interface, const Ipv6Addr *targetIpAddr
    ndpDumpNeighborSolMessage(message);
 
    //Send Neighbor Solicitation message
-   error = ipv6SendDatagram(interface, &pseudoHeader, buffer, offset, NDP_HOP_LIMIT);
+   error = ipv6SendDatagram(interface, &pseudoHeader, buffer, offset, NDP_HOP_LIMIT, IP_TOS_NETWORK_CONTROL, NULL);
 
    //Free previously allocated memory
    chunkedBufferFree(buffer);
@@ -1060,6 +1485,11 @@ error_t ndpSendNeighborAdv(NetInterface *interface,
    message->reserved2 = 0;
    message->targetAddr = *targetIpAddr;
 
+   //An optimistic address must not override an existing
+   //Neighbor cache entry (RFC 4429 3.3)
+   if(ipv6GetAddrState(interface, targetIpAddr) == IPV6_ADDR_STATE_OPTIMISTIC)
+      message->o = FALSE;
+
    //Length of the message, excluding any option
    length = sizeof(NdpNeighborAdvMessage);
 
@@ -1102,7 +1532,7 @@ error_t ndpSendNeighborAdv(NetInterface *interface,
    ndpDumpNeighborAdvMessage(message);
 
    //Send Neighbor Advertisement message
-   error = ipv6SendDatagram(interface, &pseudoHeader, buffer, offset, NDP_HOP_LIMIT);
+   error = ipv6SendDatagram(interface, &pseudoHeader, buffer, offset, NDP_HOP_LIMIT, IP_TOS_NETWORK_CONTROL, NULL);
 
    //Free previously allocated memory
    chunkedBufferFree(buffer);
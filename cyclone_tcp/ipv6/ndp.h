@@ -46,6 +46,27 @@
    #error NDP_CACHE_SIZE parameter is invalid
 #endif
 
+//Size of the hash table used to index the Neighbor cache
+#ifndef NDP_HASH_TABLE_SIZE
+   #define NDP_HASH_TABLE_SIZE 16
+#elif (NDP_HASH_TABLE_SIZE < 1 || (NDP_HASH_TABLE_SIZE & (NDP_HASH_TABLE_SIZE - 1)))
+   #error NDP_HASH_TABLE_SIZE parameter is invalid
+#endif
+
+//Destination cache size
+#ifndef NDP_DEST_CACHE_SIZE
+   #define NDP_DEST_CACHE_SIZE 16
+#elif (NDP_DEST_CACHE_SIZE < 1 || (NDP_DEST_CACHE_SIZE & (NDP_DEST_CACHE_SIZE - 1)))
+   #error NDP_DEST_CACHE_SIZE parameter is invalid
+#endif
+
+//Lifetime of Destination cache entries
+#ifndef NDP_DEST_CACHE_LIFETIME
+   #define NDP_DEST_CACHE_LIFETIME 60000
+#elif (NDP_DEST_CACHE_LIFETIME < 1000)
+   #error NDP_DEST_CACHE_LIFETIME parameter is invalid
+#endif
+
 //Maximum number of packets waiting for address resolution to complete
 #ifndef NDP_MAX_PENDING_PACKETS
    #define NDP_MAX_PENDING_PACKETS 2
@@ -74,6 +95,13 @@
    #error NDP_RETRANS_TIMER parameter is invalid
 #endif
 
+//Number of Neighbor Solicitations sent while performing DAD
+#ifndef NDP_DUP_ADDR_DETECT_TRANSMITS
+   #define NDP_DUP_ADDR_DETECT_TRANSMITS 1
+#elif (NDP_DUP_ADDR_DETECT_TRANSMITS < 1)
+   #error NDP_DUP_ADDR_DETECT_TRANSMITS parameter is invalid
+#endif
+
 //The time a neighbor is considered reachable after receiving a reachability confirmation
 #ifndef NDP_REACHABLE_TIME
    #define NDP_REACHABLE_TIME 30000
@@ -88,6 +116,13 @@
    #error NDP_DELAY_FIRST_PROBE_TIME parameter is invalid
 #endif
 
+//Time before the expiry of a reachable entry at which it is refreshed if in use
+#ifndef NDP_REFRESH_TIME
+   #define NDP_REFRESH_TIME 3000
+#elif (NDP_REFRESH_TIME < 0 || NDP_REFRESH_TIME >= NDP_REACHABLE_TIME)
+   #error NDP_REFRESH_TIME parameter is invalid
+#endif
+
 //Hop Limit used by NDP messages
 #define NDP_HOP_LIMIT 255
 
@@ -287,7 +322,7 @@ typedef struct
  * @brief Neighbor cache entry
  **/
 
-typedef struct
+typedef struct _NdpCacheEntry
 {
    NdpState state;                              //Reachability state
    Ipv6Addr ipAddr;                             //Unicast IPv6 address
@@ -295,17 +330,44 @@ typedef struct
    time_t timestamp;                            //Timestamp to manage entry lifetime
    time_t timeout;                              //Timeout value
    uint_t retransmitCount;                      //Retransmission counter
+   time_t lastUsed;                             //Time at which the entry was last used to send a packet
+   bool_t refreshFlag;                          //A refresh solicitation has been sent
    NdpQueueItem queue[NDP_MAX_PENDING_PACKETS]; //Packets waiting for address resolution to complete
    uint_t queueSize;                            //Number of queued packets
+   struct _NdpCacheEntry *hashNext;             //Next entry in the same hash bucket
+   struct _NdpCacheEntry *lruPrev;              //More recently used entry
+   struct _NdpCacheEntry *lruNext;              //Less recently used entry
 } NdpCacheEntry;
 
 
+/**
+ * @brief Destination cache entry
+ **/
+
+typedef struct
+{
+   bool_t valid;                                //The entry is in use
+   Ipv6Addr destAddr;                           //Destination address
+   Ipv6Addr nextHop;                            //Next-hop address
+   bool_t routed;                               //The next hop comes from the routing table
+   size_t pathMtu;                              //Path MTU
+   time_t timestamp;                            //Time at which the entry was created
+} NdpDestCacheEntry;
+
+
 //NDP related functions
 error_t ndpInit(NetInterface *interface);
 void ndpFlushCache(NetInterface *interface);
 
-NdpCacheEntry *ndpCreateEntry(NetInterface *interface);
+NdpCacheEntry *ndpCreateEntry(NetInterface *interface, const Ipv6Addr *ipAddr);
 NdpCacheEntry *ndpFindEntry(NetInterface *interface, const Ipv6Addr *ipAddr);
+void ndpDeleteEntry(NetInterface *interface, NdpCacheEntry *entry);
+
+error_t ndpGetNextHop(NetInterface *interface,
+   const Ipv6Addr *destAddr, Ipv6Addr *nextHop);
+
+NdpDestCacheEntry *ndpFindDestEntry(NetInterface *interface, const Ipv6Addr *destAddr);
+void ndpFlushDestCache(NetInterface *interface);
 
 void ndpSendQueuedPackets(NetInterface *interface, NdpCacheEntry *entry);
 void ndpFlushQueuedPackets(NetInterface *interface, NdpCacheEntry *entry);
@@ -324,7 +386,8 @@ void ndpProcessNeighborAdv(NetInterface *interface, Ipv6PseudoHeader *pseudoHead
    const ChunkedBuffer *buffer, size_t offset, uint8_t hopLimit);
 
 error_t ndpSendRouterSol(NetInterface *interface);
-error_t ndpSendNeighborSol(NetInterface *interface, const Ipv6Addr *targetIpAddr);
+error_t ndpSendNeighborSol(NetInterface *interface,
+   const Ipv6Addr *targetIpAddr, bool_t multicast);
 
 error_t ndpSendNeighborAdv(NetInterface *interface,
    const Ipv6Addr *targetIpAddr, const Ipv6Addr *destIpAddr);
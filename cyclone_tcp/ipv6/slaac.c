@@ -38,6 +38,7 @@
 //Dependencies
 #include "tcp_ip_stack.h"
 #include "ethernet.h"
+#include "ipv6.h"
 #include "ndp.h"
 #include "slaac.h"
 #include "debug.h"
@@ -46,12 +47,22 @@
 #if (IPV6_SUPPORT == ENABLED)
 
 
+/**
+ * @brief Stateless address autoconfiguration
+ *
+ * The link-local address is assigned as soon as it has been formed. Duplicate
+ * Address Detection then runs in the background, so that the host can solicit
+ * routers without waiting for DAD to complete
+ *
+ * @param[in] interface Underlying network interface
+ * @return Error code
+ **/
+
 error_t statelessAddrConfig(NetInterface *interface)
 {
    error_t error;
    Eui64 interfaceId;
    Ipv6Addr linkLocalAddr;
-   Ipv6Addr solicitedNodeAddr;
 
    //Generate the 64-bit interface identifier
    macAddrToEui64(&interface->macAddr, &interfaceId);
@@ -67,26 +78,19 @@ error_t statelessAddrConfig(NetInterface *interface)
    linkLocalAddr.w[6] = interfaceId.w[2];
    linkLocalAddr.w[7] = interfaceId.w[3];
 
-   //Form the Solicited-Node address
-   ipv6ComputeSolicitedNodeAddr(&linkLocalAddr, &solicitedNodeAddr);
-   //Join the Solicited-Node multicast group for the tentative address
-   ipv6JoinMulticastGroup(interface, &solicitedNodeAddr);
+   //Assign the link-local address to the interface
+   interface->ipv6Config.linkLocalAddr = linkLocalAddr;
+   interface->ipv6Config.linkLocalAddrState = IPV6_ADDR_STATE_INVALID;
 
    //Ensure that the address is not already in use on the local network
-   error = slaacDetectDuplicateAddr(&linkLocalAddr);
-   //If a duplicate address is discovered during the procedure,
-   //the address cannot be assigned to the interface
-   if(error)
-   {
-      ipv6LeaveMulticastGroup(interface, &solicitedNodeAddr);
-      return error;
-   }
-
-   //Assign the link-local address to the local IPv6 address
-   interface->ipv6Config.linkLocalAddr = linkLocalAddr;
+   error = slaacStartDad(interface, &linkLocalAddr);
+   //Any error to report?
+   if(error) return error;
 
    //The node next attempts to contact a local router for more
-   //information on continuing the configuration
+   //information on continuing the configuration. The solicitation
+   //is sent right away rather than after DAD has completed
+   ndpSendRouterSol(interface);
 
    //The global address is formed by appending the interface
    //identifier to a prefix of appropriate length
@@ -98,20 +102,258 @@ error_t statelessAddrConfig(NetInterface *interface)
 
 /**
  * @brief Duplicate IPv6 Address Detection
- * @param[in] ipAddr Tentative address
+ *
+ * The function blocks until the address is usable. A tentative address becomes
+ * usable when DAD completes, whereas an optimistic address is usable at once
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] ipAddr Tentative address (must be assigned to the interface)
+ * @return Error code
+ **/
+
+error_t slaacDetectDuplicateAddr(NetInterface *interface, const Ipv6Addr *ipAddr)
+{
+   error_t error;
+   Ipv6Addr addr;
+   Ipv6AddrState state;
+
+   //The address is cleared from the configuration if found to be a duplicate
+   addr = *ipAddr;
+
+   //Start Duplicate Address Detection
+   error = slaacStartDad(interface, &addr);
+   //Any error to report?
+   if(error) return error;
+
+   //Wait for the address to become usable
+   while(1)
+   {
+      //Get the current state of the address
+      state = ipv6GetAddrState(interface, &addr);
+
+      //The address has been found to be in use on the link?
+      if(state == IPV6_ADDR_STATE_INVALID)
+         return ERROR_DUPLICATE_ADDRESS;
+      //The address can be used for traffic?
+      else if(state != IPV6_ADDR_STATE_TENTATIVE)
+         return NO_ERROR;
+
+      //DAD is still in progress
+      osDelay(NDP_TICK_INTERVAL);
+   }
+}
+
+
+/**
+ * @brief Start Duplicate Address Detection
+ *
+ * The first Neighbor Solicitation is sent immediately. Retransmissions and the
+ * transition to the preferred state are handled by slaacTick, so that DAD can
+ * run concurrently for the link-local and the global addresses
+ *
+ * @param[in] interface Underlying network interface
+ * @param[in] ipAddr Link-local or global address assigned to the interface
  * @return Error code
  **/
 
-error_t slaacDetectDuplicateAddr(const Ipv6Addr *ipAddr)
+error_t slaacStartDad(NetInterface *interface, const Ipv6Addr *ipAddr)
 {
-   //Send a Neighbor Solicitation message
-   //Attention pas d'option !!
-   //ndpSendNeighborSol(ipAddr);
+   error_t error;
+   Ipv6AddrState *state;
+   Ipv6DadState *dad;
+   Ipv6Addr solicitedNodeAddr;
+
+   //Link-local address?
+   if(ipv6CompAddr(ipAddr, &interface->ipv6Config.linkLocalAddr))
+   {
+      state = &interface->ipv6Config.linkLocalAddrState;
+      dad = &interface->ipv6Config.linkLocalDad;
+   }
+   //Global address?
+   else if(ipv6CompAddr(ipAddr, &interface->ipv6Config.globalAddr))
+   {
+      state = &interface->ipv6Config.globalAddrState;
+      dad = &interface->ipv6Config.globalDad;
+   }
+   //The address is not assigned to the interface?
+   else
+   {
+      return ERROR_INVALID_ADDRESS;
+   }
 
+   //The Solicited-Node multicast group is joined only once,
+   //when DAD is performed for the first time on this address
+   if(*state == IPV6_ADDR_STATE_INVALID)
+   {
+      //Form the Solicited-Node address
+      ipv6ComputeSolicitedNodeAddr(ipAddr, &solicitedNodeAddr);
+      //Join the Solicited-Node multicast group for the tentative address
+      error = ipv6JoinMulticastGroup(interface, &solicitedNodeAddr);
+      //Any error to report?
+      if(error) return error;
+   }
+
+#if (SLAAC_OPTIMISTIC_DAD_SUPPORT == ENABLED)
+   //The address may be used before DAD completes (RFC 4429)
+   *state = IPV6_ADDR_STATE_OPTIMISTIC;
+#else
+   //Address uniqueness on the link is being verified...
+   *state = IPV6_ADDR_STATE_TENTATIVE;
+#endif
+
+   //Debug message
+   TRACE_INFO("Starting DAD for %s...\r\n", ipv6AddrToString(ipAddr, NULL));
+
+   //Save current time
+   dad->timestamp = osGetTickCount();
+   //Number of solicitations sent so far
+   dad->transmitCount = 1;
+
+   //Send the first Neighbor Solicitation right away
+   ndpSendNeighborSol(interface, ipAddr, TRUE);
+
+   //Successful processing
    return NO_ERROR;
 }
 
 
+/**
+ * @brief A duplicate address has been detected
+ * @param[in] interface Underlying network interface
+ * @param[in] ipAddr Tentative or optimistic address found to be in use
+ **/
+
+void slaacDupAddrDetected(NetInterface *interface, const Ipv6Addr *ipAddr)
+{
+   Ipv6Addr addr;
+   Ipv6Addr solicitedNodeAddr;
+   Ipv6AddrState state;
+
+   //Save the address before it is removed from the configuration
+   addr = *ipAddr;
+   //Get the current state of the address
+   state = ipv6GetAddrState(interface, &addr);
+
+   //Only an address on which DAD is being performed can be a duplicate
+   if(state != IPV6_ADDR_STATE_TENTATIVE && state != IPV6_ADDR_STATE_OPTIMISTIC)
+      return;
+
+   //Debug message
+   TRACE_WARNING("Duplicate IPv6 address %s detected!\r\n",
+      ipv6AddrToString(&addr, NULL));
+
+   //The address cannot be assigned to the interface
+   if(ipv6CompAddr(&addr, &interface->ipv6Config.linkLocalAddr))
+   {
+      interface->ipv6Config.linkLocalAddrState = IPV6_ADDR_STATE_INVALID;
+      interface->ipv6Config.linkLocalAddr = IPV6_UNSPECIFIED_ADDR;
+   }
+   else
+   {
+      interface->ipv6Config.globalAddrState = IPV6_ADDR_STATE_INVALID;
+      interface->ipv6Config.globalAddr = IPV6_UNSPECIFIED_ADDR;
+   }
+
+   //Form the Solicited-Node address
+   ipv6ComputeSolicitedNodeAddr(&addr, &solicitedNodeAddr);
+   //Leave the corresponding multicast group
+   ipv6LeaveMulticastGroup(interface, &solicitedNodeAddr);
+}
+
+
+/**
+ * @brief SLAAC timer handler
+ *
+ * This routine must be periodically called by the TCP/IP stack to
+ * manage Duplicate Address Detection
+ *
+ * @param[in] interface Underlying network interface
+ **/
+
+void slaacTick(NetInterface *interface)
+{
+   //Manage DAD for the link-local address
+   slaacManageDad(interface, &interface->ipv6Config.linkLocalAddr,
+      &interface->ipv6Config.linkLocalAddrState, &interface->ipv6Config.linkLocalDad);
+
+   //Manage DAD for the global address
+   slaacManageDad(interface, &interface->ipv6Config.globalAddr,
+      &interface->ipv6Config.globalAddrState, &interface->ipv6Config.globalDad);
+}
+
+
+/**
+ * @brief Retransmit DAD probes and complete the procedure
+ * @param[in] interface Underlying network interface
+ * @param[in] ipAddr Address on which DAD is performed
+ * @param[in,out] state Current state of the address
+ * @param[in,out] dad DAD state of the address
+ **/
+
+void slaacManageDad(NetInterface *interface, const Ipv6Addr *ipAddr,
+   Ipv6AddrState *state, Ipv6DadState *dad)
+{
+   time_t time;
+
+   //DAD is not in progress for this address?
+   if(*state != IPV6_ADDR_STATE_TENTATIVE && *state != IPV6_ADDR_STATE_OPTIMISTIC)
+      return;
+
+   //Get current time
+   time = osGetTickCount();
+
+   //Wait for RetransTimer milliseconds after each solicitation
+   if(timeCompare(time, dad->timestamp + NDP_RETRANS_TIMER) < 0)
+      return;
+
+   //Any more solicitations to send?
+   if(dad->transmitCount < NDP_DUP_ADDR_DETECT_TRANSMITS)
+   {
+      //Retransmit Neighbor Solicitation
+      ndpSendNeighborSol(interface, ipAddr, TRUE);
+      //Save the time at which the message was sent
+      dad->timestamp = time;
+      //Increment transmission counter
+      dad->transmitCount++;
+   }
+   else
+   {
+      //No duplicate has been found. The use of the address is now unrestricted
+      *state = IPV6_ADDR_STATE_PREFERRED;
+      //Debug message
+      TRACE_INFO("IPv6 address %s is now preferred\r\n", ipv6AddrToString(ipAddr, NULL));
+   }
+}
+
+
+/**
+ * @brief Callback function for link change event
+ *
+ * DAD is performed again on the configured addresses when the link comes up,
+ * and a Router Solicitation is sent immediately
+ *
+ * @param[in] interface Underlying network interface
+ **/
+
+void slaacLinkChangeEvent(NetInterface *interface)
+{
+   //Nothing to do when the link goes down
+   if(!interface->linkState)
+      return;
+
+   //Addresses that are not managed by SLAAC or DHCPv6 (static configuration)
+   //are left in the invalid state and do not undergo DAD
+   if(interface->ipv6Config.linkLocalAddrState != IPV6_ADDR_STATE_INVALID)
+      slaacStartDad(interface, &interface->ipv6Config.linkLocalAddr);
+   if(interface->ipv6Config.globalAddrState != IPV6_ADDR_STATE_INVALID)
+      slaacStartDad(interface, &interface->ipv6Config.globalAddr);
+
+   //Solicit routers without waiting for DAD to complete
+   if(!ipv6CompAddr(&interface->ipv6Config.linkLocalAddr, &IPV6_UNSPECIFIED_ADDR))
+      ndpSendRouterSol(interface);
+}
+
+
 /**
  * @brief Map a MAC address to the IPv6 modified EUI-64 identifier
  * @param[in] macAddr Host MAC address
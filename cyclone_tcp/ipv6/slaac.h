@@ -29,6 +29,16 @@
 #ifndef _SLAAC_H
 #define _SLAAC_H
 
+//Dependencies
+#include "tcp_ip_stack.h"
+
+//Optimistic Duplicate Address Detection (RFC 4429)
+#ifndef SLAAC_OPTIMISTIC_DAD_SUPPORT
+   #define SLAAC_OPTIMISTIC_DAD_SUPPORT DISABLED
+#elif (SLAAC_OPTIMISTIC_DAD_SUPPORT != ENABLED && SLAAC_OPTIMISTIC_DAD_SUPPORT != DISABLED)
+   #error SLAAC_OPTIMISTIC_DAD_SUPPORT parameter is invalid
+#endif
+
 
 #if (defined(__GNUC__) || defined(_WIN32))
    #define __packed
@@ -59,7 +69,16 @@ typedef __packed struct
 
 //SLAAC related functions
 error_t statelessAddrConfig(NetInterface *interface);
-error_t slaacDetectDuplicateAddr(const Ipv6Addr *ipAddr);
+error_t slaacDetectDuplicateAddr(NetInterface *interface, const Ipv6Addr *ipAddr);
+
+error_t slaacStartDad(NetInterface *interface, const Ipv6Addr *ipAddr);
+void slaacDupAddrDetected(NetInterface *interface, const Ipv6Addr *ipAddr);
+void slaacTick(NetInterface *interface);
+
+void slaacManageDad(NetInterface *interface, const Ipv6Addr *ipAddr,
+   Ipv6AddrState *state, Ipv6DadState *dad);
+
+void slaacLinkChangeEvent(NetInterface *interface);
 
 void macAddrToEui64(const MacAddr *macAddr, Eui64 *interfaceId);
 
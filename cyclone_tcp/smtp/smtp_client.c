@@ -57,7 +57,6 @@
 error_t smtpSendMail(const SmtpAuthInfo *authInfo, const SmtpMail *mail)
 {
    error_t error;
-   uint_t i;
    uint_t replyCode;
    IpAddr serverIpAddr;
    SmtpClientContext *context;
@@ -185,6 +184,7 @@ error_t smtpSendMail(const SmtpAuthInfo *authInfo, const SmtpMail *mail)
       context->authPlainSupported = FALSE;
       context->authCramMd5Supported = FALSE;
       context->startTlsSupported = FALSE;
+      context->pipeliningSupported = FALSE;
 
       //Send EHLO command and parse server response
       error = smtpSendCommand(context, "EHLO [127.0.0.1]\r\n",
@@ -254,6 +254,7 @@ error_t smtpSendMail(const SmtpAuthInfo *authInfo, const SmtpMail *mail)
          context->authLoginSupported = FALSE;
          context->authPlainSupported = FALSE;
          context->authCramMd5Supported = FALSE;
+         context->pipeliningSupported = FALSE;
 
          //Send EHLO command and parse server response
          error = smtpSendCommand(context, "EHLO [127.0.0.1]\r\n",
@@ -314,51 +315,19 @@ error_t smtpSendMail(const SmtpAuthInfo *authInfo, const SmtpMail *mail)
          }
       }
 
-      //Format the MAIL FROM command (a null return path must be accepted)
-      if(mail->from.addr)
-         sprintf(context->buffer, "MAIL FROM:<%s>\r\n", mail->from.addr);
-      else
-         strcpy(context->buffer, "MAIL FROM:<>\r\n");
-
-      //Send the command to the server
-      error = smtpSendCommand(context, context->buffer, &replyCode, NULL);
-      //Any communication error to report?
-      if(error) break;
-
-      //Check SMTP response code
-      if(!SMTP_REPLY_CODE_2YZ(replyCode))
+      //The server may accept the whole envelope in a single group
+      if(context->pipeliningSupported)
       {
-         //An unexpected response was received...
-         error = ERROR_UNEXPECTED_RESPONSE;
-         //Stop immediately
-         break;
+         //Send MAIL FROM, RCPT TO and DATA commands without waiting
+         error = smtpSendPipelinedEnvelope(context, mail);
       }
-
-      //Format the RCPT TO command
-      for(i = 0; i < mail->recipientCount; i++)
+      else
       {
-         //Skip recipient addresses that are not valid
-         if(!mail->recipients[i].addr)
-            continue;
-
-         //Format the RCPT TO command
-         sprintf(context->buffer, "RCPT TO:<%s>\r\n", mail->recipients[i].addr);
-         //Send the command to the server
-         error = smtpSendCommand(context, context->buffer, &replyCode, NULL);
-         //Any communication error to report?
-         if(error) break;
-
-         //Check SMTP response code
-         if(!SMTP_REPLY_CODE_2YZ(replyCode))
-         {
-            //An unexpected response was received...
-            error = ERROR_UNEXPECTED_RESPONSE;
-            //Stop immediately
-            break;
-         }
+         //Send MAIL FROM, RCPT TO and DATA commands one at a time
+         error = smtpSendEnvelope(context, mail);
       }
 
-      //Propagate exception if necessary
+      //Any error to report?
       if(error) break;
 
       //Send message body
@@ -450,6 +419,13 @@ error_t smtpEhloReplyCallback(SmtpClientContext *context,
       //STARTTLS use is allowed
       context->startTlsSupported = TRUE;
    }
+   //The PIPELINING keyword indicates that the server accepts
+   //groups of commands without waiting for each reply (RFC 2920)
+   else if(!strcasecmp(token, "PIPELINING"))
+   {
+      //Command pipelining is allowed
+      context->pipeliningSupported = TRUE;
+   }
 
    //Successful processing
    return NO_ERROR;
@@ -653,19 +629,51 @@ error_t smtpSendAuthCramMd5(SmtpClientContext *context, const SmtpAuthInfo *auth
 
 
 /**
- * @brief Send message body
+ * @brief Send mail envelope, one command at a time
  * @param[in] context SMTP client context
  * @param[in] mail Mail contents
  * @return Error code
  **/
 
-error_t smtpSendData(SmtpClientContext *context, const SmtpMail *mail)
+error_t smtpSendEnvelope(SmtpClientContext *context, const SmtpMail *mail)
 {
    error_t error;
-   bool_t first;
    uint_t i;
    uint_t replyCode;
-   char_t *p;
+
+   //Format the MAIL FROM command (a null return path must be accepted)
+   if(mail->from.addr)
+      sprintf(context->buffer, "MAIL FROM:<%s>\r\n", mail->from.addr);
+   else
+      strcpy(context->buffer, "MAIL FROM:<>\r\n");
+
+   //Send the command to the server
+   error = smtpSendCommand(context, context->buffer, &replyCode, NULL);
+   //Any communication error to report?
+   if(error) return error;
+
+   //Check SMTP response code
+   if(!SMTP_REPLY_CODE_2YZ(replyCode))
+      return ERROR_UNEXPECTED_RESPONSE;
+
+   //Format the RCPT TO command
+   for(i = 0; i < mail->recipientCount; i++)
+   {
+      //Skip recipient addresses that are not valid
+      if(!mail->recipients[i].addr)
+         continue;
+
+      //Format the RCPT TO command
+      sprintf(context->buffer, "RCPT TO:<%s>\r\n", mail->recipients[i].addr);
+      //Send the command to the server
+      error = smtpSendCommand(context, context->buffer, &replyCode, NULL);
+      //Any communication error to report?
+      if(error) return error;
+
+      //Check SMTP response code
+      if(!SMTP_REPLY_CODE_2YZ(replyCode))
+         return ERROR_UNEXPECTED_RESPONSE;
+   }
 
    //Send DATA command
    error = smtpSendCommand(context, "DATA\r\n", &replyCode, NULL);
@@ -676,6 +684,147 @@ error_t smtpSendData(SmtpClientContext *context, const SmtpMail *mail)
    if(!SMTP_REPLY_CODE_3YZ(replyCode))
       return ERROR_UNEXPECTED_RESPONSE;
 
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send mail envelope using command pipelining
+ *
+ * MAIL FROM, RCPT TO and DATA commands are sent as a single group
+ * and the replies are then collected in order (refer to RFC 2920)
+ *
+ * @param[in] context SMTP client context
+ * @param[in] mail Mail contents
+ * @return Error code
+ **/
+
+error_t smtpSendPipelinedEnvelope(SmtpClientContext *context, const SmtpMail *mail)
+{
+   error_t error;
+   bool_t rejected;
+   uint_t i;
+   uint_t replyCode;
+   size_t n;
+
+   //Format the MAIL FROM command (a null return path must be accepted)
+   if(mail->from.addr)
+      n = sprintf(context->buffer, "MAIL FROM:<%s>\r\n", mail->from.addr);
+   else
+      n = sprintf(context->buffer, "MAIL FROM:<>\r\n");
+
+   //Append the RCPT TO commands
+   for(i = 0; i < mail->recipientCount; i++)
+   {
+      //Skip recipient addresses that are not valid
+      if(!mail->recipients[i].addr)
+         continue;
+
+      //Not enough room to hold the next command?
+      if((n + strlen(mail->recipients[i].addr) + 12) >= sizeof(context->buffer))
+      {
+         //Debug message
+         TRACE_DEBUG("SMTP client: %.*s", (int) n, context->buffer);
+
+         //Flush the pending commands
+         error = smtpWrite(context, context->buffer, n, 0);
+         //Failed to send commands?
+         if(error) return error;
+
+         //Rewind to the beginning of the buffer
+         n = 0;
+      }
+
+      //Format the RCPT TO command
+      n += sprintf(context->buffer + n, "RCPT TO:<%s>\r\n", mail->recipients[i].addr);
+   }
+
+   //Not enough room to hold the DATA command?
+   if((n + 6) >= sizeof(context->buffer))
+   {
+      //Debug message
+      TRACE_DEBUG("SMTP client: %.*s", (int) n, context->buffer);
+
+      //Flush the pending commands
+      error = smtpWrite(context, context->buffer, n, 0);
+      //Failed to send commands?
+      if(error) return error;
+
+      //Rewind to the beginning of the buffer
+      n = 0;
+   }
+
+   //The DATA command must be the last command in the group
+   n += sprintf(context->buffer + n, "DATA\r\n");
+
+   //Debug message
+   TRACE_DEBUG("SMTP client: %.*s", (int) n, context->buffer);
+
+   //Send the last commands of the group
+   error = smtpWrite(context, context->buffer, n, SOCKET_FLAG_WAIT_ACK);
+   //Failed to send commands?
+   if(error) return error;
+
+   //Wait for the reply to the MAIL FROM command
+   error = smtpSendCommand(context, NULL, &replyCode, NULL);
+   //Any communication error to report?
+   if(error) return error;
+
+   //Check SMTP response code
+   rejected = !SMTP_REPLY_CODE_2YZ(replyCode);
+
+   //The server must send one reply per RCPT TO command
+   for(i = 0; i < mail->recipientCount; i++)
+   {
+      //Skip recipient addresses that are not valid
+      if(!mail->recipients[i].addr)
+         continue;
+
+      //Wait for the reply to the RCPT TO command
+      error = smtpSendCommand(context, NULL, &replyCode, NULL);
+      //Any communication error to report?
+      if(error) return error;
+
+      //Check SMTP response code
+      if(!SMTP_REPLY_CODE_2YZ(replyCode))
+         rejected = TRUE;
+   }
+
+   //Wait for the reply to the DATA command
+   error = smtpSendCommand(context, NULL, &replyCode, NULL);
+   //Any communication error to report?
+   if(error) return error;
+
+   //Check SMTP reply code
+   if(!SMTP_REPLY_CODE_3YZ(replyCode))
+      return ERROR_UNEXPECTED_RESPONSE;
+
+   //The server entered mail input mode although some commands were refused.
+   //The connection must be closed so that the transaction is aborted
+   if(rejected)
+      return ERROR_INVALID_RECIPIENT;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Send message body
+ * @param[in] context SMTP client context
+ * @param[in] mail Mail contents
+ * @return Error code
+ **/
+
+error_t smtpSendData(SmtpClientContext *context, const SmtpMail *mail)
+{
+   error_t error;
+   bool_t first;
+   uint_t i;
+   uint_t replyCode;
+   char_t *p;
+
    //Point to the beginning of the buffer
    p = context->buffer;
 
@@ -757,8 +906,8 @@ error_t smtpSendData(SmtpClientContext *context, const SmtpMail *mail)
    sprintf(p, "\r\n");
 
    //Debug message
-   TRACE_DEBUG(context->buffer);
-   TRACE_DEBUG(mail->body);
+   TRACE_DEBUG("%s", context->buffer);
+   TRACE_DEBUG("%s", mail->body);
    TRACE_DEBUG("\r\n.\r\n");
 
    //Send message header
@@ -171,6 +171,7 @@ typedef struct
    bool_t authPlainSupported;                //PLAIN authentication mechanism supported
    bool_t authCramMd5Supported;              //CRAM-MD5 authentication mechanism supported
    bool_t startTlsSupported;                 //STARTTLS command supported
+   bool_t pipeliningSupported;               //Command pipelining supported
    char_t buffer[SMTP_MAX_LINE_LENGTH / 2];  //Memory buffer for input/output operations
    char_t buffer2[SMTP_MAX_LINE_LENGTH / 2];
 #if (SMTP_TLS_SUPPORT == ENABLED)
@@ -192,6 +193,8 @@ error_t smtpSendAuthLogin(SmtpClientContext *context, const SmtpAuthInfo *authIn
 error_t smtpSendAuthPlain(SmtpClientContext *context, const SmtpAuthInfo *authInfo);
 error_t smtpSendAuthCramMd5(SmtpClientContext *context, const SmtpAuthInfo *authInfo);
 
+error_t smtpSendEnvelope(SmtpClientContext *context, const SmtpMail *mail);
+error_t smtpSendPipelinedEnvelope(SmtpClientContext *context, const SmtpMail *mail);
 error_t smtpSendData(SmtpClientContext *context, const SmtpMail *mail);
 
 error_t smtpSendCommand(SmtpClientContext *context, const char_t *command,
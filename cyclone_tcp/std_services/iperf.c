@@ -0,0 +1,869 @@
+/**
+ * @file iperf.c
+ * @brief iperf throughput benchmark
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @section Description
+ *
+ * The iperf service measures TCP and UDP throughput. The server side is
+ * compatible with iperf 2 clients: TCP streams are counted as they arrive,
+ * while UDP tests are acknowledged with a server report giving the number
+ * of lost and out-of-order datagrams and the interarrival jitter. The client
+ * side sends one or more parallel streams to an iperf 2 server
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+//Switch to the appropriate trace level
+#define TRACE_LEVEL STD_SERVICES_TRACE_LEVEL
+
+//Dependencies
+#include "tcp_ip_stack.h"
+#include "iperf.h"
+#include "debug.h"
+
+
+/**
+ * @brief Start TCP iperf service
+ * @return Error code
+ **/
+
+error_t tcpIperfStart(void)
+{
+   error_t error;
+   Socket *socket;
+   OsTask *task;
+
+   //Debug message
+   TRACE_INFO("Starting TCP iperf service...\r\n");
+
+   //Open a TCP socket
+   socket = socketOpen(SOCKET_TYPE_STREAM, SOCKET_PROTOCOL_TCP);
+   //Failed to open socket?
+   if(!socket) return ERROR_OPEN_FAILED;
+
+   //Start of exception handling block
+   do
+   {
+      //Bind the newly created socket to port 5001
+      error = socketBind(socket, &IP_ADDR_ANY, IPERF_PORT);
+      //Failed to bind the socket to the desired port?
+      if(error) break;
+
+      //Place the socket into listening mode
+      error = socketListen(socket);
+      //Any error to report?
+      if(error) break;
+
+      //Create a task to handle incoming connection requests
+      task = osTaskCreate("TCP iperf Listener", tcpIperfListenerTask,
+         socket, IPERF_SERVICE_STACK_SIZE, IPERF_SERVICE_PRIORITY);
+
+      //Unable to create the task?
+      if(task == OS_INVALID_HANDLE)
+      {
+         //Report an error to the calling function
+         error = ERROR_OUT_OF_RESOURCES;
+         break;
+      }
+
+      //End of exception handling block
+   } while(0);
+
+   //Any error to report?
+   if(error)
+   {
+      //Clean up side effects...
+      socketClose(socket);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Task handling connection requests
+ * @param[in] param Pointer to the listening socket
+ **/
+
+void tcpIperfListenerTask(void *param)
+{
+   error_t error;
+   uint16_t clientPort;
+   IpAddr clientIpAddr;
+   Socket *serverSocket;
+   Socket *clientSocket;
+   IperfServiceContext *context;
+   OsTask *task;
+
+   //Point to the listening socket
+   serverSocket = (Socket *) param;
+
+   //Main loop
+   while(1)
+   {
+      //Accept an incoming connection
+      clientSocket = socketAccept(serverSocket, &clientIpAddr, &clientPort);
+      //Check whether a valid connection request has been received
+      if(!clientSocket) continue;
+
+      //Debug message
+      TRACE_INFO("iperf service: connection established with client %s port %u\r\n",
+         ipAddrToString(&clientIpAddr, NULL), clientPort);
+
+      //Adjust timeout
+      error = socketSetTimeout(clientSocket, IPERF_TIMEOUT);
+
+      //Any error to report?
+      if(error)
+      {
+         //Close socket
+         socketClose(clientSocket);
+         //Wait for an incoming connection attempt
+         continue;
+      }
+
+      //Allocate resources for the new connection
+      context = osMemAlloc(sizeof(IperfServiceContext));
+
+      //Failed to allocate memory?
+      if(!context)
+      {
+         //Close socket
+         socketClose(clientSocket);
+         //Wait for an incoming connection attempt
+         continue;
+      }
+
+      //Record the handle of the newly created socket
+      context->socket = clientSocket;
+
+      //Each parallel stream is serviced by its own task
+      task = osTaskCreate("TCP iperf Connection", tcpIperfConnectionTask,
+         context, IPERF_SERVICE_STACK_SIZE, IPERF_SERVICE_PRIORITY);
+
+      //Did we encounter an error?
+      if(task == OS_INVALID_HANDLE)
+      {
+         //Close socket
+         socketClose(clientSocket);
+         //Release resources
+         osMemFree(context);
+      }
+   }
+}
+
+
+/**
+ * @brief TCP iperf service implementation
+ * @param[in] param Pointer to the iperf service context
+ **/
+
+void tcpIperfConnectionTask(void *param)
+{
+   error_t error;
+   size_t n;
+   uint64_t byteCount;
+   time_t startTime;
+   IperfServiceContext *context;
+
+   //Get a pointer to the context
+   context = (IperfServiceContext *) param;
+   //Get current time
+   startTime = osGetTickCount();
+
+   //Total number of bytes received
+   byteCount = 0;
+
+   //The client streams data until the end of the test. The optional
+   //header sent by iperf 2 clients is counted like any other data
+   while(1)
+   {
+      //Receive data
+      error = socketReceive(context->socket, context->buffer, IPERF_BUFFER_SIZE, &n, 0);
+      //Any error to report?
+      if(error) break;
+
+      //Total number of bytes received
+      byteCount += n;
+   }
+
+   //Graceful shutdown
+   socketShutdown(context->socket, SOCKET_SD_BOTH);
+
+   //Display the measured throughput
+   iperfTraceResult("TCP server", byteCount, osGetTickCount() - startTime);
+
+   //Close socket
+   socketClose(context->socket);
+   //Release previously allocated memory
+   osMemFree(context);
+
+   //Kill ourselves
+   osTaskDelete(NULL);
+}
+
+
+/**
+ * @brief Start UDP iperf service
+ * @return Error code
+ **/
+
+error_t udpIperfStart(void)
+{
+   error_t error;
+   IperfUdpServiceContext *context;
+   OsTask *task;
+
+   //Debug message
+   TRACE_INFO("Starting UDP iperf service...\r\n");
+
+   //Allocate a memory block to hold the context
+   context = osMemAlloc(sizeof(IperfUdpServiceContext));
+   //Failed to allocate memory?
+   if(!context) return ERROR_OUT_OF_MEMORY;
+
+   //No test is in progress
+   memset(&context->stats, 0, sizeof(IperfUdpStats));
+
+   //Start of exception handling block
+   do
+   {
+      //Open a UDP socket
+      context->socket = socketOpen(SOCKET_TYPE_DGRAM, SOCKET_PROTOCOL_UDP);
+
+      //Failed to open socket?
+      if(!context->socket)
+      {
+         //Report an error
+         error = ERROR_OPEN_FAILED;
+         //Exit immediately
+         break;
+      }
+
+      //The server listens for incoming datagrams on port 5001
+      error = socketBind(context->socket, &IP_ADDR_ANY, IPERF_PORT);
+      //Unable to bind the socket to the desired port?
+      if(error) break;
+
+      //Create a task to handle incoming datagrams
+      task = osTaskCreate("UDP iperf", udpIperfTask,
+         context, IPERF_SERVICE_STACK_SIZE, IPERF_SERVICE_PRIORITY);
+
+      //Unable to create the task?
+      if(task == OS_INVALID_HANDLE)
+      {
+         //Report an error to the calling function
+         error = ERROR_OUT_OF_RESOURCES;
+         break;
+      }
+
+      //End of exception handling block
+   } while(0);
+
+   //Any error to report?
+   if(error)
+   {
+      //Clean up side effects...
+      socketClose(context->socket);
+      osMemFree(context);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief UDP iperf service implementation
+ * @param[in] param Pointer to the UDP iperf service context
+ **/
+
+void udpIperfTask(void *param)
+{
+   error_t error;
+   size_t length;
+   uint16_t port;
+   IpAddr ipAddr;
+   IperfUdpServiceContext *context;
+
+   //Get a pointer to the context
+   context = (IperfUdpServiceContext *) param;
+
+   //Main loop
+   while(1)
+   {
+      //Wait for an incoming datagram
+      error = socketReceiveFrom(context->socket, &ipAddr, &port,
+         context->buffer, IPERF_BUFFER_SIZE, &length, 0);
+
+      //Any datagram received?
+      if(!error)
+      {
+         //Update statistics and answer the end of test notification
+         udpIperfProcessDatagram(context, &ipAddr, port, length);
+      }
+   }
+}
+
+
+/**
+ * @brief Process an incoming UDP iperf datagram
+ * @param[in] context Pointer to the UDP iperf service context
+ * @param[in] ipAddr Source IP address
+ * @param[in] port Source port
+ * @param[in] length Length of the datagram
+ **/
+
+void udpIperfProcessDatagram(IperfUdpServiceContext *context,
+   const IpAddr *ipAddr, uint16_t port, size_t length)
+{
+   int32_t id;
+   int32_t transit;
+   int32_t delta;
+   uint32_t sec;
+   uint32_t usec;
+   IperfUdpHeader *header;
+   IperfUdpStats *stats;
+
+   //Malformed datagram?
+   if(length < sizeof(IperfUdpHeader))
+      return;
+
+   //Point to the datagram header and to the statistics
+   header = (IperfUdpHeader *) context->buffer;
+   stats = &context->stats;
+
+   //Get the sequence number (negative for the end of test notification)
+   id = ntohl(header->id);
+
+   //A new test is starting?
+   if(!stats->running && id >= 0)
+   {
+      //Clear statistics
+      memset(stats, 0, sizeof(IperfUdpStats));
+
+      //Save the identity of the client
+      stats->clientIpAddr = *ipAddr;
+      stats->clientPort = port;
+      stats->startTime = osGetTickCount();
+      stats->running = TRUE;
+
+      //Debug message
+      TRACE_INFO("iperf service: UDP test started by client %s port %u\r\n",
+         ipAddrToString(ipAddr, NULL), port);
+   }
+
+   //Only one UDP test can be serviced at a time
+   if(stats->clientPort != port || !ipCompAddr(&stats->clientIpAddr, ipAddr))
+      return;
+
+   //End of test notification?
+   if(id < 0)
+   {
+      //First notification?
+      if(stats->running)
+      {
+         //The test is over
+         stats->stopTime = osGetTickCount();
+         stats->running = FALSE;
+
+         //The notification carries the sequence number of the last datagram
+         id = -id;
+
+         //Datagrams that never showed up are accounted as lost
+         if(id > stats->nextId)
+            stats->errorCount += id - stats->nextId;
+
+         //Display the measured throughput
+         iperfTraceResult("UDP server", stats->totalLength,
+            stats->stopTime - stats->startTime);
+
+         //Debug message
+         TRACE_INFO("iperf service: %u datagrams, %u lost, %u out of order, jitter %u us\r\n",
+            stats->datagrams, stats->errorCount, stats->outOfOrderCount, stats->jitter);
+      }
+
+      //The client retransmits the notification until it gets the report
+      udpIperfSendReport(context, ipAddr, port);
+   }
+   else if(stats->running)
+   {
+      //Update statistics
+      stats->datagrams++;
+      stats->totalLength += length;
+
+      //Check sequence number
+      if(id >= stats->nextId)
+      {
+         //Gaps in the sequence are accounted as lost datagrams
+         stats->errorCount += id - stats->nextId;
+         //Next expected sequence number
+         stats->nextId = id + 1;
+      }
+      else
+      {
+         //A datagram previously accounted as lost has been received
+         stats->outOfOrderCount++;
+
+         if(stats->errorCount > 0)
+            stats->errorCount--;
+      }
+
+      //Get current time
+      iperfGetTimestamp(&sec, &usec);
+
+      //Transit time (the clock offset between peers has no effect on jitter)
+      transit = (int32_t) ((sec - ntohl(header->tvSec)) * 1000000 +
+         (usec - ntohl(header->tvUsec)));
+
+      //Compute interarrival jitter (refer to RFC 1889)
+      if(stats->datagrams > 1)
+      {
+         //Difference between consecutive transit times
+         delta = transit - stats->lastTransit;
+         //Absolute value
+         if(delta < 0) delta = -delta;
+
+         //Update the smoothed jitter estimate
+         stats->jitter += ((int32_t) delta - (int32_t) stats->jitter) / 16;
+      }
+
+      //Save the transit time
+      stats->lastTransit = transit;
+   }
+}
+
+
+/**
+ * @brief Send the UDP server report
+ * @param[in] context Pointer to the UDP iperf service context
+ * @param[in] ipAddr Client IP address
+ * @param[in] port Client port
+ **/
+
+void udpIperfSendReport(IperfUdpServiceContext *context,
+   const IpAddr *ipAddr, uint16_t port)
+{
+   time_t duration;
+   IperfUdpStats *stats;
+   IperfServerReport *report;
+
+   //Point to the statistics
+   stats = &context->stats;
+   //The report follows the header of the received datagram
+   report = (IperfServerReport *) (context->buffer + sizeof(IperfUdpHeader));
+
+   //Duration of the test
+   duration = stats->stopTime - stats->startTime;
+
+   //Format server report
+   report->flags = htonl(IPERF_HEADER_VERSION1);
+   report->totalLenHigh = htonl((uint32_t) (stats->totalLength >> 32));
+   report->totalLenLow = htonl((uint32_t) stats->totalLength);
+   report->stopSec = htonl(duration / 1000);
+   report->stopUsec = htonl((duration % 1000) * 1000);
+   report->errorCount = htonl(stats->errorCount);
+   report->outOfOrderCount = htonl(stats->outOfOrderCount);
+   report->datagrams = htonl(stats->datagrams);
+   report->jitterSec = htonl(stats->jitter / 1000000);
+   report->jitterUsec = htonl(stats->jitter % 1000000);
+
+   //Send the report to the client
+   socketSendTo(context->socket, ipAddr, port, context->buffer,
+      sizeof(IperfUdpHeader) + sizeof(IperfServerReport), NULL, 0);
+}
+
+
+/**
+ * @brief Start iperf client
+ * @param[in] settings Test parameters
+ * @return Error code
+ **/
+
+error_t iperfClientStart(const IperfClientSettings *settings)
+{
+   uint_t i;
+   IperfClientContext *context;
+   OsTask *task;
+
+   //Check parameters
+   if(!settings)
+      return ERROR_INVALID_PARAMETER;
+   //Check the number of parallel streams
+   if(settings->streamCount < 1 || settings->streamCount > IPERF_MAX_STREAMS)
+      return ERROR_INVALID_PARAMETER;
+   //The buffer must be large enough to hold the UDP datagram header
+   if(settings->bufferSize < sizeof(IperfUdpHeader) || settings->bufferSize > IPERF_BUFFER_SIZE)
+      return ERROR_INVALID_PARAMETER;
+   //UDP tests require a target bandwidth
+   if(settings->udp && !settings->bandwidth)
+      return ERROR_INVALID_PARAMETER;
+
+   //Debug message
+   TRACE_INFO("Starting iperf client (%s, %u stream(s))...\r\n",
+      settings->udp ? "UDP" : "TCP", settings->streamCount);
+
+   //Each stream is handled by its own task
+   for(i = 0; i < settings->streamCount; i++)
+   {
+      //Allocate a memory block to hold the context
+      context = osMemAlloc(sizeof(IperfClientContext));
+      //Failed to allocate memory?
+      if(!context) return ERROR_OUT_OF_MEMORY;
+
+      //Save test parameters
+      context->settings = *settings;
+      context->index = i;
+      context->socket = NULL;
+
+      //Create a task to run the test
+      task = osTaskCreate("iperf Client", iperfClientTask,
+         context, IPERF_SERVICE_STACK_SIZE, IPERF_SERVICE_PRIORITY);
+
+      //Unable to create the task?
+      if(task == OS_INVALID_HANDLE)
+      {
+         //Release resources
+         osMemFree(context);
+         //Report an error to the calling function
+         return ERROR_OUT_OF_RESOURCES;
+      }
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief iperf client task
+ * @param[in] param Pointer to the iperf client context
+ **/
+
+void iperfClientTask(void *param)
+{
+   error_t error;
+   uint_t i;
+   IperfClientContext *context;
+
+   //Get a pointer to the context
+   context = (IperfClientContext *) param;
+
+   //The payload follows the usual iperf pattern
+   for(i = 0; i < context->settings.bufferSize; i++)
+      context->buffer[i] = '0' + (i % 10);
+
+   //Start of exception handling block
+   do
+   {
+      //Open a TCP or UDP socket
+      if(context->settings.udp)
+         context->socket = socketOpen(SOCKET_TYPE_DGRAM, SOCKET_PROTOCOL_UDP);
+      else
+         context->socket = socketOpen(SOCKET_TYPE_STREAM, SOCKET_PROTOCOL_TCP);
+
+      //Failed to open socket?
+      if(!context->socket)
+      {
+         //Report an error
+         error = ERROR_OPEN_FAILED;
+         //Exit immediately
+         break;
+      }
+
+      //Bind the socket to a particular network interface?
+      if(context->settings.interface)
+      {
+         //Associate the socket with the relevant interface
+         error = socketBindToInterface(context->socket, context->settings.interface);
+         //Any error to report?
+         if(error) break;
+      }
+
+      //Run the test
+      if(context->settings.udp)
+         error = udpIperfClient(context);
+      else
+         error = tcpIperfClient(context);
+
+      //End of exception handling block
+   } while(0);
+
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_WARNING("iperf client: stream %u failed (error %u)\r\n",
+         context->index, error);
+   }
+
+   //Close socket
+   if(context->socket)
+      socketClose(context->socket);
+
+   //Release previously allocated memory
+   osMemFree(context);
+
+   //Kill ourselves
+   osTaskDelete(NULL);
+}
+
+
+/**
+ * @brief Run a TCP throughput test
+ * @param[in] context Pointer to the iperf client context
+ * @return Error code
+ **/
+
+error_t tcpIperfClient(IperfClientContext *context)
+{
+   error_t error;
+   size_t n;
+   uint64_t byteCount;
+   time_t startTime;
+   TcpInfo info;
+
+   //Adjust TCP buffer sizes?
+   if(context->settings.windowSize)
+   {
+      //Set the size of the send buffer
+      error = socketSetTxBufferSize(context->socket, context->settings.windowSize);
+      //Any error to report?
+      if(error) return error;
+
+      //Set the size of the receive buffer
+      error = socketSetRxBufferSize(context->socket, context->settings.windowSize);
+      //Any error to report?
+      if(error) return error;
+   }
+
+   //Set timeout for blocking operations
+   error = socketSetTimeout(context->socket, IPERF_TIMEOUT);
+   //Any error to report?
+   if(error) return error;
+
+   //Connect to the iperf server
+   error = socketConnect(context->socket, &context->settings.serverIpAddr,
+      context->settings.serverPort);
+   //Connection to server failed?
+   if(error) return error;
+
+   //Total number of bytes sent
+   byteCount = 0;
+   //Start of the test
+   startTime = osGetTickCount();
+
+   //Send data until the end of the test
+   while(timeCompare(osGetTickCount(), startTime + context->settings.duration) < 0)
+   {
+      //Send data
+      error = socketSend(context->socket, context->buffer,
+         context->settings.bufferSize, &n, 0);
+      //Any error to report?
+      if(error) return error;
+
+      //Total number of bytes sent
+      byteCount += n;
+   }
+
+   //Wait for all the data to be acknowledged
+   error = socketShutdown(context->socket, SOCKET_SD_SEND);
+   //Any error to report?
+   if(error) return error;
+
+   //Display the measured throughput
+   iperfTraceResult("TCP client", byteCount, osGetTickCount() - startTime);
+
+   //Retrieve the state of the connection
+   if(!socketGetTcpInfo(context->socket, &info))
+   {
+      //Debug message
+      TRACE_INFO("iperf client: RTT %u ms, RTT variation %u ms, %u retransmission(s)\r\n",
+         info.srtt, info.rttvar, info.stats.retransmits);
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Run a UDP throughput test
+ * @param[in] context Pointer to the iperf client context
+ * @return Error code
+ **/
+
+error_t udpIperfClient(IperfClientContext *context)
+{
+   error_t error;
+   uint_t i;
+   int32_t id;
+   size_t n;
+   uint32_t sec;
+   uint32_t usec;
+   uint64_t byteCount;
+   time_t startTime;
+   time_t time;
+   IperfUdpHeader *header;
+   IperfServerReport *report;
+
+   //Point to the datagram header
+   header = (IperfUdpHeader *) context->buffer;
+
+   //Total number of bytes sent
+   byteCount = 0;
+   //Sequence number of the first datagram
+   id = 0;
+   //Start of the test
+   startTime = osGetTickCount();
+
+   //Send datagrams until the end of the test
+   while(1)
+   {
+      //Get current time
+      time = osGetTickCount();
+      //End of the test?
+      if(timeCompare(time, startTime + context->settings.duration) >= 0)
+         break;
+
+      //Limit the rate to the requested bandwidth
+      if((byteCount * 8000) > ((uint64_t) context->settings.bandwidth * (time - startTime)))
+      {
+         //Wait for the next tick
+         osDelay(1);
+         //Check the rate once again
+         continue;
+      }
+
+      //Get current time
+      iperfGetTimestamp(&sec, &usec);
+
+      //Format datagram header
+      header->id = htonl(id);
+      header->tvSec = htonl(sec);
+      header->tvUsec = htonl(usec);
+
+      //Send datagram
+      error = socketSendTo(context->socket, &context->settings.serverIpAddr,
+         context->settings.serverPort, context->buffer, context->settings.bufferSize, NULL, 0);
+      //Any error to report?
+      if(error) return error;
+
+      //Total number of bytes sent
+      byteCount += context->settings.bufferSize;
+      //Increment sequence number
+      id++;
+   }
+
+   //Display the sending rate
+   iperfTraceResult("UDP client", byteCount, osGetTickCount() - startTime);
+
+   //Wait for the server report for a limited amount of time
+   error = socketSetTimeout(context->socket, IPERF_FIN_TIMEOUT);
+   //Any error to report?
+   if(error) return error;
+
+   //The end of the test is notified with a negative sequence number
+   for(i = 0; i < IPERF_FIN_MAX_RETRIES; i++)
+   {
+      //Get current time
+      iperfGetTimestamp(&sec, &usec);
+
+      //Format datagram header
+      header->id = htonl(-id);
+      header->tvSec = htonl(sec);
+      header->tvUsec = htonl(usec);
+
+      //Send datagram
+      error = socketSendTo(context->socket, &context->settings.serverIpAddr,
+         context->settings.serverPort, context->buffer, context->settings.bufferSize, NULL, 0);
+      //Any error to report?
+      if(error) return error;
+
+      //Wait for the server report
+      error = socketReceiveFrom(context->socket, NULL, NULL,
+         context->buffer, IPERF_BUFFER_SIZE, &n, 0);
+
+      //Valid report received?
+      if(!error && n >= (sizeof(IperfUdpHeader) + sizeof(IperfServerReport)))
+      {
+         //Point to the server report
+         report = (IperfServerReport *) (context->buffer + sizeof(IperfUdpHeader));
+
+         //The report is only valid if the server sets the version flag
+         if(!(ntohl(report->flags) & IPERF_HEADER_VERSION1))
+            continue;
+
+         //Debug message
+         TRACE_INFO("iperf client: server report: %u/%u datagrams lost, %u out of order, jitter %u.%03u ms\r\n",
+            ntohl(report->errorCount), ntohl(report->datagrams), ntohl(report->outOfOrderCount),
+            ntohl(report->jitterSec) * 1000 + ntohl(report->jitterUsec) / 1000,
+            ntohl(report->jitterUsec) % 1000);
+
+         //Successful processing
+         return NO_ERROR;
+      }
+   }
+
+   //The server did not answer
+   return ERROR_TIMEOUT;
+}
+
+
+/**
+ * @brief Get a timestamp for the UDP datagram header
+ * @param[out] sec Seconds
+ * @param[out] usec Microseconds
+ **/
+
+void iperfGetTimestamp(uint32_t *sec, uint32_t *usec)
+{
+   time_t time;
+
+   //Only differences between timestamps are meaningful
+   time = osGetTickCount();
+
+   //Convert the system time
+   *sec = time / 1000;
+   *usec = (time % 1000) * 1000;
+}
+
+
+/**
+ * @brief Display the result of a test
+ * @param[in] name Description of the test
+ * @param[in] byteCount Number of bytes transferred
+ * @param[in] duration Duration of the test, in milliseconds
+ **/
+
+void iperfTraceResult(const char_t *name, uint64_t byteCount, time_t duration)
+{
+   //Avoid division by zero...
+   if(!duration) duration = 1;
+
+   //Debug message
+   TRACE_INFO("iperf %s: %u kB in %u ms (%u kbps)\r\n", name,
+      (uint32_t) (byteCount / 1000), duration, (uint32_t) ((byteCount * 8) / duration));
+}
@@ -0,0 +1,232 @@
+/**
+ * @file iperf.h
+ * @brief iperf throughput benchmark
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This file is part of CycloneTCP Open.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#ifndef _IPERF_H
+#define _IPERF_H
+
+//Dependencies
+#include "tcp_ip_stack.h"
+#include "socket.h"
+
+//Stack size required to run the iperf service
+#ifndef IPERF_SERVICE_STACK_SIZE
+   #define IPERF_SERVICE_STACK_SIZE 600
+#elif (IPERF_SERVICE_STACK_SIZE < 1)
+   #error IPERF_SERVICE_STACK_SIZE parameter is invalid
+#endif
+
+//Priority at which the iperf service should run
+#ifndef IPERF_SERVICE_PRIORITY
+   #define IPERF_SERVICE_PRIORITY 1
+#elif (IPERF_SERVICE_PRIORITY < 0)
+   #error IPERF_SERVICE_PRIORITY parameter is invalid
+#endif
+
+//Size of the buffer for input/output operations
+#ifndef IPERF_BUFFER_SIZE
+   #define IPERF_BUFFER_SIZE 1500
+#elif (IPERF_BUFFER_SIZE < 64)
+   #error IPERF_BUFFER_SIZE parameter is invalid
+#endif
+
+//Maximum time the TCP iperf server will wait before closing the connection
+#ifndef IPERF_TIMEOUT
+   #define IPERF_TIMEOUT 20000
+#elif (IPERF_TIMEOUT < 1)
+   #error IPERF_TIMEOUT parameter is invalid
+#endif
+
+//Maximum number of parallel streams
+#ifndef IPERF_MAX_STREAMS
+   #define IPERF_MAX_STREAMS 4
+#elif (IPERF_MAX_STREAMS < 1)
+   #error IPERF_MAX_STREAMS parameter is invalid
+#endif
+
+//Number of attempts to get the UDP server report
+#ifndef IPERF_FIN_MAX_RETRIES
+   #define IPERF_FIN_MAX_RETRIES 10
+#elif (IPERF_FIN_MAX_RETRIES < 1)
+   #error IPERF_FIN_MAX_RETRIES parameter is invalid
+#endif
+
+//Time to wait for the UDP server report
+#ifndef IPERF_FIN_TIMEOUT
+   #define IPERF_FIN_TIMEOUT 250
+#elif (IPERF_FIN_TIMEOUT < 1)
+   #error IPERF_FIN_TIMEOUT parameter is invalid
+#endif
+
+//iperf service port
+#define IPERF_PORT 5001
+
+//Server report format
+#define IPERF_HEADER_VERSION1 0x80000000
+
+
+#if (defined(__GNUC__) || defined(_WIN32))
+   #define __packed
+   #pragma pack(push, 1)
+#endif
+
+
+/**
+ * @brief UDP datagram header
+ **/
+
+typedef __packed struct
+{
+   int32_t id;      //0-3
+   uint32_t tvSec;  //4-7
+   uint32_t tvUsec; //8-11
+} IperfUdpHeader;
+
+
+/**
+ * @brief UDP server report
+ **/
+
+typedef __packed struct
+{
+   int32_t flags;           //0-3
+   int32_t totalLenHigh;    //4-7
+   int32_t totalLenLow;     //8-11
+   int32_t stopSec;         //12-15
+   int32_t stopUsec;        //16-19
+   int32_t errorCount;      //20-23
+   int32_t outOfOrderCount; //24-27
+   int32_t datagrams;       //28-31
+   int32_t jitterSec;       //32-35
+   int32_t jitterUsec;      //36-39
+} IperfServerReport;
+
+
+#if (defined(__GNUC__) || defined(_WIN32))
+   #undef __packed
+   #pragma pack(pop)
+#endif
+
+
+/**
+ * @brief iperf client settings
+ **/
+
+typedef struct
+{
+   NetInterface *interface; ///<Underlying network interface
+   IpAddr serverIpAddr;     ///<IP address of the iperf server
+   uint16_t serverPort;     ///<Port number of the iperf server
+   bool_t udp;              ///<Use UDP instead of TCP
+   uint_t streamCount;      ///<Number of parallel streams
+   size_t bufferSize;       ///<Length of the buffers to write
+   size_t windowSize;       ///<TCP buffer size (0 to keep the default value)
+   time_t duration;         ///<Duration of the test, in milliseconds
+   uint32_t bandwidth;      ///<Target UDP bandwidth, in bits per second
+} IperfClientSettings;
+
+
+/**
+ * @brief iperf client stream
+ **/
+
+typedef struct
+{
+   IperfClientSettings settings;
+   uint_t index;
+   Socket *socket;
+   char_t buffer[IPERF_BUFFER_SIZE];
+} IperfClientContext;
+
+
+/**
+ * @brief iperf service context
+ **/
+
+typedef struct
+{
+   Socket *socket;
+   char_t buffer[IPERF_BUFFER_SIZE];
+} IperfServiceContext;
+
+
+/**
+ * @brief UDP test statistics
+ **/
+
+typedef struct
+{
+   bool_t running;
+   IpAddr clientIpAddr;
+   uint16_t clientPort;
+   int32_t nextId;
+   uint64_t totalLength;
+   uint32_t datagrams;
+   uint32_t errorCount;
+   uint32_t outOfOrderCount;
+   int32_t lastTransit;
+   uint32_t jitter;
+   time_t startTime;
+   time_t stopTime;
+} IperfUdpStats;
+
+
+/**
+ * @brief UDP iperf service context
+ **/
+
+typedef struct
+{
+   Socket *socket;
+   IperfUdpStats stats;
+   char_t buffer[IPERF_BUFFER_SIZE];
+} IperfUdpServiceContext;
+
+
+//TCP iperf service related functions
+error_t tcpIperfStart(void);
+void tcpIperfListenerTask(void *param);
+void tcpIperfConnectionTask(void *param);
+
+//UDP iperf service related functions
+error_t udpIperfStart(void);
+void udpIperfTask(void *param);
+void udpIperfProcessDatagram(IperfUdpServiceContext *context,
+   const IpAddr *ipAddr, uint16_t port, size_t length);
+void udpIperfSendReport(IperfUdpServiceContext *context,
+   const IpAddr *ipAddr, uint16_t port);
+
+//iperf client related functions
+error_t iperfClientStart(const IperfClientSettings *settings);
+void iperfClientTask(void *param);
+error_t tcpIperfClient(IperfClientContext *context);
+error_t udpIperfClient(IperfClientContext *context);
+
+void iperfGetTimestamp(uint32_t *sec, uint32_t *usec);
+void iperfTraceResult(const char_t *name, uint64_t byteCount, time_t duration);
+
+#endif
@@ -1,6 +1,7 @@
 CYCLONETCPSRC += $(CYCLONETCP)/cyclone_tcp/std_services/chargen.c \
 				 $(CYCLONETCP)/cyclone_tcp/std_services/daytime.c \
 				 $(CYCLONETCP)/cyclone_tcp/std_services/discard.c \
-				 $(CYCLONETCP)/cyclone_tcp/std_services/echo.c 
+				 $(CYCLONETCP)/cyclone_tcp/std_services/echo.c \
+				 $(CYCLONETCP)/cyclone_tcp/std_services/iperf.c 
 				 
 CYCLONETCPINC += $(CYCLONETCP)/cyclone_tcp/std_services/
@@ -203,6 +203,33 @@ uint16_t adcGetValue(void)
 }
 
 
+/**
+ * @brief TRNG initialization
+ **/
+
+void trngInit(void)
+{
+   //Enable TRNG peripheral clock
+   PMC->PMC_PCER1 = (1 << (ID_TRNG - 32));
+   //Enable TRNG
+   TRNG->TRNG_CR = TRNG_CR_KEY(0x524E47) | TRNG_CR_ENABLE;
+}
+
+
+/**
+ * @brief Get a random number from the TRNG
+ * @return 32-bit random value
+ **/
+
+uint32_t trngGetValue(void)
+{
+   //Wait for a new random number to be available
+   while(!(TRNG->TRNG_ISR & TRNG_ISR_DATRDY));
+   //Return the 32-bit random value
+   return TRNG->TRNG_ODATA;
+}
+
+
 /**
  * @brief User task
  **/
@@ -248,12 +275,19 @@ void userTask(void *param)
 
 void blinkTask(void *parameters)
 {
+   uint32_t value;
+
    while(1)
    {
       PIO_LED3->PIO_CODR = LED3;
       osDelay(100);
       PIO_LED3->PIO_SODR = LED3;
       osDelay(900);
+
+      //Get 32-bit random value
+      value = trngGetValue();
+      //Periodically feed the PRNG with fresh hardware entropy
+      yarrowAddEntropy(&yarrowContext, 0, (uint8_t *) &value, sizeof(value), 32);
    }
 }
 
@@ -266,6 +300,8 @@ void blinkTask(void *parameters)
 int_t main(void)
 {
    error_t error;
+   uint_t i;
+   uint32_t value;
    Ipv6Addr solicitedNodeAddr;
    NetInterface *interface;
    OsTask *task;
@@ -294,6 +330,8 @@ int_t main(void)
    ioInit();
    //ADC initialization
    adcInit();
+   //TRNG initialization
+   trngInit();
 
    //Initialize LCD display
    GLCD_Init();
@@ -316,6 +354,17 @@ int_t main(void)
    }
 
    //Generate a random seed
+   for(i = 0; i < 32; i += 4)
+   {
+      //Get 32-bit random value
+      value = trngGetValue();
+
+      //Copy random value
+      seed[i] = value & 0xFF;
+      seed[i + 1] = (value >> 8) & 0xFF;
+      seed[i + 2] = (value >> 16) & 0xFF;
+      seed[i + 3] = (value >> 24) & 0xFF;
+   }
 
    //Properly seed the PRNG
    error = yarrowSeed(&yarrowContext, seed, sizeof(seed));
@@ -155,6 +155,33 @@ void adc3Init(void)
 }
 
 
+/**
+ * @brief RNG initialization
+ **/
+
+void rngInit(void)
+{
+   //Enable RNG peripheral clock
+   RCC_AHB2PeriphClockCmd(RCC_AHB2Periph_RNG, ENABLE);
+   //Enable RNG
+   RNG_Cmd(ENABLE);
+}
+
+
+/**
+ * @brief Get a random number from the hardware RNG
+ * @return 32-bit random value
+ **/
+
+uint32_t rngGetValue(void)
+{
+   //Wait for a new random number to be available
+   while(RNG_GetFlagStatus(RNG_FLAG_DRDY) == RESET);
+   //Return the 32-bit random value
+   return RNG_GetRandomNumber();
+}
+
+
 /**
  * @brief User task
  **/
@@ -210,12 +237,19 @@ void userTask(void *param)
 
 void blinkTask(void *parameters)
 {
+   uint32_t value;
+
    while(1)
    {
       STM_EVAL_LEDOn(LED1);
       osDelay(100);
       STM_EVAL_LEDOff(LED1);
       osDelay(900);
+
+      //Get 32-bit random value
+      value = rngGetValue();
+      //Periodically feed the PRNG with fresh hardware entropy
+      yarrowAddEntropy(&yarrowContext, 0, (uint8_t *) &value, sizeof(value), 32);
    }
 }
 
@@ -228,6 +262,8 @@ void blinkTask(void *parameters)
 int_t main(void)
 {
    error_t error;
+   uint_t i;
+   uint32_t value;
    Ipv6Addr solicitedNodeAddr;
    NetInterface *interface;
    OsTask *task;
@@ -283,6 +319,8 @@ int_t main(void)
 
    //ADC3 initialization
    adc3Init();
+   //RNG initialization
+   rngInit();
 
    //PRNG initialization
    error = yarrowInit(&yarrowContext);
@@ -295,6 +333,17 @@ int_t main(void)
    }
 
    //Generate a random seed
+   for(i = 0; i < 32; i += 4)
+   {
+      //Get 32-bit random value
+      value = rngGetValue();
+
+      //Copy random value
+      seed[i] = value & 0xFF;
+      seed[i + 1] = (value >> 8) & 0xFF;
+      seed[i + 2] = (value >> 16) & 0xFF;
+      seed[i + 3] = (value >> 24) & 0xFF;
+   }
 
    //Properly seed the PRNG
    error = yarrowSeed(&yarrowContext, seed, sizeof(seed));
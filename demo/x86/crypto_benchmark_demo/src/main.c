@@ -0,0 +1,190 @@
+/**
+ * @file main.c
+ * @brief Crypto benchmark demo
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#define _CRTDBG_MAP_ALLOC
+#define _WINERROR_
+
+//Dependencies
+#include <stdlib.h>
+#include <crtdbg.h>
+#include <windows.h>
+#include <intrin.h>
+#include "os.h"
+#include "crypto.h"
+#include "crypto_benchmark.h"
+#include "yarrow.h"
+#include "error.h"
+#include "debug.h"
+
+//Duration of the time stamp counter calibration, in milliseconds
+#define CALIBRATION_TIME 500
+
+//Forward declaration of functions
+uint32_t calibrateTimeStampCounter(void);
+
+//Global variables
+YarrowContext yarrowContext;
+uint32_t cpuFrequency;
+
+
+/**
+ * @brief Main entry point
+ * @return Status code
+ **/
+
+int_t main(void)
+{
+   error_t error;
+   int_t ret;
+   HCRYPTPROV hProvider;
+   uint8_t seed[32];
+
+   //Start-up message
+   TRACE_INFO("************************************\r\n");
+   TRACE_INFO("*** CycloneCrypto Benchmark Demo ***\r\n");
+   TRACE_INFO("************************************\r\n");
+   TRACE_INFO("\r\n");
+
+   //PRNG initialization
+   error = yarrowInit(&yarrowContext);
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Error: PRNG initialization failed (%d)\r\n", error);
+      //Exit immediately
+      return ERROR_FAILURE;
+   }
+
+   //Acquire cryptographic context
+   ret = CryptAcquireContext(&hProvider, 0, 0, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT | CRYPT_SILENT);
+   //Any error to report?
+   if(!ret)
+   {
+      //Debug message
+      TRACE_ERROR("Error: Cannot acquire cryptographic context (%d)\r\n", GetLastError());
+      //Exit immediately
+      return ERROR_FAILURE;
+   }
+
+   //Generate a random seed
+   ret = CryptGenRandom(hProvider, sizeof(seed), seed);
+   //Any error to report?
+   if(!ret)
+   {
+      //Debug message
+      TRACE_ERROR("Error: Failed to generate random data (%d)\r\n", GetLastError());
+      //Exit immediately
+      return ERROR_FAILURE;
+   }
+
+   //Release cryptographic context
+   CryptReleaseContext(hProvider, 0);
+
+   //Properly seed the PRNG
+   error = yarrowSeed(&yarrowContext, seed, sizeof(seed));
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Error: Failed to seed PRNG (%d)\r\n", error);
+      //Exit immediately
+      return error;
+   }
+
+   //Avoid being preempted by other processes during the measurements
+   SetPriorityClass(GetCurrentProcess(), HIGH_PRIORITY_CLASS);
+   //Keep the time stamp counter readings on a single core
+   SetThreadAffinityMask(GetCurrentThread(), 1);
+
+   //Measure the frequency of the time stamp counter
+   cpuFrequency = calibrateTimeStampCounter();
+   //Debug message
+   TRACE_INFO("Time stamp counter frequency: %u MHz\r\n", cpuFrequency / 1000000);
+   TRACE_INFO("\r\n");
+
+   //Run the whole benchmark suite and print the results
+   error = cryptoBenchmarkRun(YARROW_PRNG_ALGO, &yarrowContext, NULL, NULL);
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Error: Benchmark failed (%d)\r\n", error);
+   }
+
+   //Release PRNG context
+   yarrowRelease(&yarrowContext);
+
+   //Wait for the user to press a key
+   system("pause");
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Time base used by the benchmark
+ * @return Lower 32 bits of the time stamp counter
+ **/
+
+uint32_t getCycles(void)
+{
+   //Read the time stamp counter
+   return (uint32_t) __rdtsc();
+}
+
+
+/**
+ * @brief Measure the frequency of the time stamp counter
+ * @return Frequency of the time stamp counter, in Hz
+ **/
+
+uint32_t calibrateTimeStampCounter(void)
+{
+   LARGE_INTEGER frequency;
+   LARGE_INTEGER start;
+   LARGE_INTEGER stop;
+   uint64_t cycles;
+
+   //Resolution of the performance counter
+   QueryPerformanceFrequency(&frequency);
+
+   //Take both counters at the beginning of the interval
+   QueryPerformanceCounter(&start);
+   cycles = __rdtsc();
+
+   //Wait for a while
+   Sleep(CALIBRATION_TIME);
+
+   //Take both counters at the end of the interval
+   QueryPerformanceCounter(&stop);
+   cycles = __rdtsc() - cycles;
+
+   //Scale the number of elapsed cycles to one second
+   return (uint32_t) ((double) cycles * (double) frequency.QuadPart /
+      (double) (stop.QuadPart - start.QuadPart));
+}
@@ -0,0 +1,805 @@
+/**
+ * @file main.c
+ * @brief SSL benchmark demo
+ *
+ * @section License
+ *
+ * Copyright (C) 2010-2013 Oryx Embedded. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ * @author Oryx Embedded (www.oryx-embedded.com)
+ * @version 1.3.8
+ **/
+
+#define _CRTDBG_MAP_ALLOC
+#define _WINERROR_
+
+//Dependencies
+#include <stdlib.h>
+#include <crtdbg.h>
+#include <winsock2.h>
+#include "os.h"
+#include "tls.h"
+#include "tls_cipher_suites.h"
+#include "yarrow.h"
+#include "error.h"
+#include "debug.h"
+
+//Libraries
+#pragma comment(lib, "ws2_32.lib")
+
+//Loopback port used by the benchmark
+#define BENCHMARK_PORT 4433
+//Number of handshakes performed with each cipher suite
+#define HANDSHAKE_COUNT 50
+//Amount of application data sent with each cipher suite
+#define BULK_TRANSFER_SIZE 4194304
+//Number of bytes passed to tlsWrite at a time
+#define BULK_CHUNK_SIZE 16384
+
+//Diffie-Hellman parameters
+#define SERVER_DH_PARAMS "..\\..\\ssl_server_demo\\certs\\dh_params.pem"
+
+//Server's RSA certificate and private key
+#define SERVER_RSA_CERT "..\\..\\ssl_server_demo\\certs\\server_rsa_cert.pem"
+#define SERVER_RSA_PRIVATE_KEY "..\\..\\ssl_server_demo\\certs\\server_rsa_key.pem"
+
+//Forward declaration of functions
+error_t readPemFile(const char_t *filename, char_t **buffer, size_t *length);
+error_t benchmarkCipherSuite(uint16_t cipherSuite);
+error_t clientRun(uint16_t cipherSuite, size_t length,
+   TlsProfile *profile, uint32_t *transferTime);
+void serverTask(void *params);
+error_t serverProcessConnection(SOCKET clientSocket);
+void addProfile(TlsProfile *total, const TlsProfile *profile);
+void dumpProfile(const TlsProfile *client, const TlsProfile *server, uint_t iterations);
+
+//Cipher suites to be benchmarked
+static const uint16_t cipherSuites[] =
+{
+   TLS_RSA_WITH_RC4_128_SHA,
+   TLS_RSA_WITH_3DES_EDE_CBC_SHA,
+   TLS_RSA_WITH_AES_128_CBC_SHA,
+   TLS_RSA_WITH_AES_256_CBC_SHA256,
+   TLS_RSA_WITH_AES_128_GCM_SHA256,
+   TLS_DHE_RSA_WITH_AES_128_CBC_SHA,
+   TLS_DHE_RSA_WITH_AES_128_GCM_SHA256,
+   TLS_RSA_WITH_CAMELLIA_128_CBC_SHA
+};
+
+//Name of the profiled phases
+static const char_t *phaseNames[TLS_PROFILE_PHASE_COUNT] =
+{
+   "Handshake",
+   "Certificate",
+   "Key exchange",
+   "Key derivation",
+   "PEM decoding",
+   "Record write",
+   "Record read",
+   "I/O"
+};
+
+//Credentials
+char_t *dhParams = NULL;
+size_t dhParamsLength = 0;
+char_t *serverRsaCert = NULL;
+size_t serverRsaCertLength = 0;
+char_t *serverRsaPrivateKey = NULL;
+size_t serverRsaPrivateKeyLength = 0;
+
+//Global variables
+YarrowContext yarrowContext;
+LARGE_INTEGER frequency;
+SOCKET serverSocket = INVALID_SOCKET;
+OsEvent *serverEvent = NULL;
+TlsProfile serverProfile;
+
+
+/**
+ * @brief Main entry point
+ * @return Status code
+ **/
+
+int_t main(void)
+{
+   error_t error;
+   uint_t i;
+   int_t ret;
+   WSADATA wsaData;
+   SOCKADDR_IN addr;
+   HCRYPTPROV hProvider;
+   OsTask *task;
+   uint8_t seed[32];
+
+   //Start-up message
+   TRACE_INFO("*********************************\r\n");
+   TRACE_INFO("*** CycloneSSL Benchmark Demo ***\r\n");
+   TRACE_INFO("*********************************\r\n");
+   TRACE_INFO("\r\n");
+
+   //Resolution of the performance counter
+   QueryPerformanceFrequency(&frequency);
+
+   //PRNG initialization
+   error = yarrowInit(&yarrowContext);
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Error: PRNG initialization failed (%d)\r\n", error);
+      //Exit immediately
+      return ERROR_FAILURE;
+   }
+
+   //Acquire cryptographic context
+   ret = CryptAcquireContext(&hProvider, 0, 0, PROV_RSA_FULL, CRYPT_VERIFYCONTEXT | CRYPT_SILENT);
+   //Any error to report?
+   if(!ret)
+   {
+      //Debug message
+      TRACE_ERROR("Error: Cannot acquire cryptographic context (%d)\r\n", GetLastError());
+      //Exit immediately
+      return ERROR_FAILURE;
+   }
+
+   //Generate a random seed
+   ret = CryptGenRandom(hProvider, sizeof(seed), seed);
+   //Any error to report?
+   if(!ret)
+   {
+      //Debug message
+      TRACE_ERROR("Error: Failed to generate random data (%d)\r\n", GetLastError());
+      //Exit immediately
+      return ERROR_FAILURE;
+   }
+
+   //Release cryptographic context
+   CryptReleaseContext(hProvider, 0);
+
+   //Properly seed the PRNG
+   error = yarrowSeed(&yarrowContext, seed, sizeof(seed));
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Error: Failed to seed PRNG (%d)\r\n", error);
+      //Exit immediately
+      return error;
+   }
+
+   //Winsock initialization
+   ret = WSAStartup(MAKEWORD(2, 2), &wsaData);
+   //Any error to report?
+   if(ret)
+   {
+      //Debug message
+      TRACE_ERROR("Error: Winsock initialization failed (%d)\r\n", ret);
+      //Exit immediately
+      return ERROR_FAILURE;
+   }
+
+   //Start of exception handling block
+   do
+   {
+      //Debug message
+      TRACE_INFO("Loading credentials...\r\n");
+
+      //Load Diffie-Hellman parameters
+      error = readPemFile(SERVER_DH_PARAMS, &dhParams, &dhParamsLength);
+      //Any error to report?
+      if(error) break;
+
+      //Load server's RSA certificate
+      error = readPemFile(SERVER_RSA_CERT, &serverRsaCert, &serverRsaCertLength);
+      //Any error to report?
+      if(error) break;
+
+      //Load server's RSA private key
+      error = readPemFile(SERVER_RSA_PRIVATE_KEY, &serverRsaPrivateKey, &serverRsaPrivateKeyLength);
+      //Any error to report?
+      if(error) break;
+
+      //Create an event signaling that the server is done with a connection
+      serverEvent = osEventCreate(FALSE, FALSE);
+      //Failed to create event?
+      if(!serverEvent)
+      {
+         //Report an error
+         error = ERROR_OUT_OF_RESOURCES;
+         //Exit immediately
+         break;
+      }
+
+      //Open a socket
+      serverSocket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+      //Failed to open socket?
+      if(serverSocket == INVALID_SOCKET)
+      {
+         //Debug message
+         TRACE_ERROR("Error: Cannot open socket (%d)\r\n", WSAGetLastError());
+         //Report an error
+         error = ERROR_FAILURE;
+         //Exit immediately
+         break;
+      }
+
+      //The server listens on the loopback interface
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      addr.sin_port = htons(BENCHMARK_PORT);
+
+      //Bind the socket to the relevant port number
+      ret = bind(serverSocket, (PSOCKADDR) &addr, sizeof(addr));
+      //Failed to bind the socket?
+      if(ret < 0)
+      {
+         //Debug message
+         TRACE_ERROR("Error: Failed to bind socket (%d)\r\n", WSAGetLastError());
+         //Report an error
+         error = ERROR_FAILURE;
+         //Exit immediately
+         break;
+      }
+
+      //Place the socket in the listening state
+      ret = listen(serverSocket, 1);
+      //Any error to report?
+      if(ret < 0)
+      {
+         //Debug message
+         TRACE_ERROR("Error: Failed to enter listening state (%d)\r\n", WSAGetLastError());
+         //Report an error
+         error = ERROR_FAILURE;
+         //Exit immediately
+         break;
+      }
+
+      //Create a task to serve the connections
+      task = osTaskCreate("Server", serverTask, NULL, 0, 0);
+      //Unable to create the task?
+      if(task == OS_INVALID_HANDLE)
+      {
+         //Report an error
+         error = ERROR_OUT_OF_RESOURCES;
+         //Exit immediately
+         break;
+      }
+
+      //Benchmark each cipher suite in turn
+      for(i = 0; i < arraysize(cipherSuites); i++)
+      {
+         //Run handshakes and a bulk transfer with the current cipher suite
+         error = benchmarkCipherSuite(cipherSuites[i]);
+         //Any error to report?
+         if(error) break;
+      }
+
+      //End of exception handling block
+   } while(0);
+
+   //Close the listening socket
+   if(serverSocket != INVALID_SOCKET)
+      closesocket(serverSocket);
+
+   //Free previously allocated resources
+   free(dhParams);
+   free(serverRsaCert);
+   free(serverRsaPrivateKey);
+
+   //Release PRNG context
+   yarrowRelease(&yarrowContext);
+
+   //Winsock related cleanup
+   WSACleanup();
+
+   //Wait for the user to press a key
+   system("pause");
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Time base used by the benchmark and by the TLS profiling counters
+ * @return Current value of the performance counter, in microseconds
+ **/
+
+uint32_t getMicroseconds(void)
+{
+   LARGE_INTEGER counter;
+
+   //Read the performance counter
+   QueryPerformanceCounter(&counter);
+   //Convert the value to microseconds
+   return (uint32_t) ((double) counter.QuadPart * 1000000.0 / (double) frequency.QuadPart);
+}
+
+
+/**
+ * @brief Benchmark a given cipher suite
+ * @param[in] cipherSuite Cipher suite identifier
+ * @return Error code
+ **/
+
+error_t benchmarkCipherSuite(uint16_t cipherSuite)
+{
+   error_t error;
+   uint_t i;
+   uint32_t time;
+   uint32_t transferTime;
+   TlsProfile clientProfile;
+
+   //Debug message
+   TRACE_INFO("\r\n%s\r\n", tlsGetCipherSuiteName(cipherSuite));
+
+   //Clear profiling counters
+   memset(&clientProfile, 0, sizeof(TlsProfile));
+   memset(&serverProfile, 0, sizeof(TlsProfile));
+
+   //Start of the handshake benchmark
+   time = getMicroseconds();
+
+   //Perform full handshakes, without any application data
+   for(i = 0; i < HANDSHAKE_COUNT; i++)
+   {
+      //Run a client connection
+      error = clientRun(cipherSuite, 0, &clientProfile, NULL);
+      //Any error to report?
+      if(error)
+      {
+         //Debug message
+         TRACE_ERROR("Error: Handshake failed (%d)\r\n", error);
+         //Exit immediately
+         return error;
+      }
+   }
+
+   //Total time spent
+   time = getMicroseconds() - time;
+
+   //Display handshake rate
+   TRACE_INFO("  Handshakes: %u in %u ms (%.1f handshakes/s)\r\n", HANDSHAKE_COUNT,
+      time / 1000, HANDSHAKE_COUNT * 1000000.0 / max(time, 1));
+
+   //Display the average time spent in each phase
+   dumpProfile(&clientProfile, &serverProfile, HANDSHAKE_COUNT);
+
+   //Send a large amount of application data over a single connection
+   error = clientRun(cipherSuite, BULK_TRANSFER_SIZE, &clientProfile, &transferTime);
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Error: Bulk transfer failed (%d)\r\n", error);
+      //Exit immediately
+      return error;
+   }
+
+   //Display throughput
+   TRACE_INFO("  Bulk transfer: %u bytes in %u ms (%.1f KB/s)\r\n", BULK_TRANSFER_SIZE,
+      transferTime / 1000, BULK_TRANSFER_SIZE * 1000000.0 / 1024 / max(transferTime, 1));
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Run a client connection against the loopback server
+ * @param[in] cipherSuite Cipher suite to be offered by the client
+ * @param[in] length Number of bytes of application data to send
+ * @param[in,out] profile Profiling counters of the client
+ * @param[out] transferTime Time spent sending the application data (optional parameter)
+ * @return Error code
+ **/
+
+error_t clientRun(uint16_t cipherSuite, size_t length,
+   TlsProfile *profile, uint32_t *transferTime)
+{
+   error_t error;
+   int_t ret;
+   size_t n;
+   uint32_t time;
+   SOCKADDR_IN addr;
+   TlsProfile connectionProfile;
+   static uint8_t buffer[BULK_CHUNK_SIZE];
+
+   //Socket descriptor
+   SOCKET sock = INVALID_SOCKET;
+
+   //SSL/TLS context
+   TlsContext *tlsContext = NULL;
+
+   //Start of exception handling block
+   do
+   {
+      //Open a socket
+      sock = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+      //Failed to open socket?
+      if(sock == INVALID_SOCKET)
+      {
+         //Report an error
+         error = ERROR_OPEN_FAILED;
+         //Exit immediately
+         break;
+      }
+
+      //Destination address
+      addr.sin_family = AF_INET;
+      addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+      addr.sin_port = htons(BENCHMARK_PORT);
+
+      //Connect to the loopback server
+      ret = connect(sock, (PSOCKADDR) &addr, sizeof(addr));
+      //Connection with server failed?
+      if(ret < 0)
+      {
+         //Report an error
+         error = ERROR_CONNECTION_FAILED;
+         //Exit immediately
+         break;
+      }
+
+      //Initialize SSL/TLS context
+      tlsContext = tlsInit();
+      //Initialization failed?
+      if(!tlsContext)
+      {
+         //Report an error
+         error = ERROR_OUT_OF_MEMORY;
+         //Exit immediately
+         break;
+      }
+
+      //Bind TLS to the relevant socket
+      error = tlsSetSocket(tlsContext, sock);
+      //Any error to report?
+      if(error) break;
+
+      //Select client operation mode
+      error = tlsSetConnectionEnd(tlsContext, TLS_CONNECTION_END_CLIENT);
+      //Any error to report?
+      if(error) break;
+
+      //Set the PRNG algorithm to be used
+      error = tlsSetPrng(tlsContext, YARROW_PRNG_ALGO, &yarrowContext);
+      //Any error to report?
+      if(error) break;
+
+      //Offer a single cipher suite so that the server has no choice
+      error = tlsSetCipherSuites(tlsContext, &cipherSuite, 1);
+      //Any error to report?
+      if(error) break;
+
+      //Establish a secure session
+      error = tlsConnect(tlsContext);
+      //TLS handshake failure?
+      if(error) break;
+
+      //Start of the bulk transfer
+      time = getMicroseconds();
+
+      //Send application data
+      while(length > 0)
+      {
+         //Number of bytes to write at a time
+         n = min(length, BULK_CHUNK_SIZE);
+
+         //Send data to the server
+         error = tlsWrite(tlsContext, buffer, n, 0);
+         //Any error to report?
+         if(error) break;
+
+         //Number of bytes left to send
+         length -= n;
+      }
+
+      //Propagate exception if necessary...
+      if(error) break;
+
+      //Time spent sending application data
+      if(transferTime != NULL)
+         *transferTime = getMicroseconds() - time;
+
+      //Terminate TLS session
+      error = tlsShutdown(tlsContext);
+
+      //End of exception handling block
+   } while(0);
+
+   //Release SSL/TLS context
+   if(tlsContext != NULL)
+   {
+      //Retrieve the profiling counters of the connection
+      if(!tlsGetProfile(tlsContext, &connectionProfile))
+         addProfile(profile, &connectionProfile);
+
+      //Release resources
+      tlsFree(tlsContext);
+   }
+
+   //Close socket
+   if(sock != INVALID_SOCKET)
+   {
+      closesocket(sock);
+
+      //Wait for the server to release its own context
+      if(tlsContext != NULL)
+         osEventWait(serverEvent, INFINITE_DELAY);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Server task
+ * @param[in] params Unused parameter
+ **/
+
+void serverTask(void *params)
+{
+   SOCKET clientSocket;
+   SOCKADDR_IN clientAddr;
+   int_t clientAddrLen;
+
+   //Process incoming connections
+   while(1)
+   {
+      //Length of the client address
+      clientAddrLen = sizeof(clientAddr);
+
+      //Accept an incoming connection
+      clientSocket = accept(serverSocket, (PSOCKADDR) &clientAddr, &clientAddrLen);
+      //Listening socket closed?
+      if(clientSocket == INVALID_SOCKET)
+         break;
+
+      //Serve the client
+      serverProcessConnection(clientSocket);
+
+      //Close the socket
+      closesocket(clientSocket);
+
+      //Notify the client side that the connection has been processed
+      osEventSet(serverEvent);
+   }
+}
+
+
+/**
+ * @brief Server side of a benchmark connection
+ * @param[in] clientSocket Socket used to communicate with the client
+ * @return Error code
+ **/
+
+error_t serverProcessConnection(SOCKET clientSocket)
+{
+   error_t error;
+   size_t n;
+   TlsProfile connectionProfile;
+   TlsContext *tlsContext;
+   static uint8_t buffer[BULK_CHUNK_SIZE];
+
+   //Start of exception handling block
+   do
+   {
+      //Initialize SSL/TLS context
+      tlsContext = tlsInit();
+      //Initialization failed?
+      if(!tlsContext)
+      {
+         //Report an error
+         error = ERROR_OUT_OF_MEMORY;
+         //Exit immediately
+         break;
+      }
+
+      //Select server operation mode
+      error = tlsSetConnectionEnd(tlsContext, TLS_CONNECTION_END_SERVER);
+      //Any error to report?
+      if(error) break;
+
+      //Bind TLS to the relevant socket
+      error = tlsSetSocket(tlsContext, clientSocket);
+      //Any error to report?
+      if(error) break;
+
+      //Set the PRNG algorithm to be used
+      error = tlsSetPrng(tlsContext, YARROW_PRNG_ALGO, &yarrowContext);
+      //Any error to report?
+      if(error) break;
+
+      //Import Diffie-Hellman parameters
+      error = tlsSetDhParameters(tlsContext, dhParams, dhParamsLength);
+      //Any error to report?
+      if(error) break;
+
+      //Import the server's RSA certificate
+      error = tlsAddCertificate(tlsContext, serverRsaCert,
+         serverRsaCertLength, serverRsaPrivateKey, serverRsaPrivateKeyLength);
+      //Any error to report?
+      if(error) break;
+
+      //Establish a secure session
+      error = tlsConnect(tlsContext);
+      //TLS handshake failure?
+      if(error) break;
+
+      //Receive application data until the client closes the connection
+      while(1)
+      {
+         //Read incoming data
+         error = tlsRead(tlsContext, buffer, sizeof(buffer), &n, 0);
+         //Any error to report?
+         if(error) break;
+      }
+
+      //The client has terminated the session
+      if(error == ERROR_END_OF_STREAM)
+         error = NO_ERROR;
+
+      //End of exception handling block
+   } while(0);
+
+   //Release SSL/TLS context
+   if(tlsContext != NULL)
+   {
+      //Retrieve the profiling counters of the connection
+      if(!tlsGetProfile(tlsContext, &connectionProfile))
+         addProfile(&serverProfile, &connectionProfile);
+
+      //Release resources
+      tlsFree(tlsContext);
+   }
+
+   //Return status code
+   return error;
+}
+
+
+/**
+ * @brief Accumulate profiling counters
+ * @param[in,out] total Accumulated counters
+ * @param[in] profile Counters of a single connection
+ **/
+
+void addProfile(TlsProfile *total, const TlsProfile *profile)
+{
+   uint_t i;
+
+   //Loop through the phases
+   for(i = 0; i < TLS_PROFILE_PHASE_COUNT; i++)
+   {
+      total->count[i] += profile->count[i];
+      total->time[i] += profile->time[i];
+   }
+}
+
+
+/**
+ * @brief Display the average time spent in each phase
+ * @param[in] client Accumulated counters of the client
+ * @param[in] server Accumulated counters of the server
+ * @param[in] iterations Number of connections
+ **/
+
+void dumpProfile(const TlsProfile *client, const TlsProfile *server, uint_t iterations)
+{
+   uint_t i;
+
+   //Table header
+   TRACE_INFO("  %-16s %12s %12s\r\n", "Phase", "Client (us)", "Server (us)");
+
+   //Loop through the phases
+   for(i = 0; i < TLS_PROFILE_PHASE_COUNT; i++)
+   {
+      //Average time per connection
+      TRACE_INFO("  %-16s %12u %12u\r\n", phaseNames[i],
+         client->time[i] / iterations, server->time[i] / iterations);
+   }
+}
+
+
+/**
+ * @brief Load the specified PEM file
+ * @param[in] filename Name of the PEM file to load
+ * @param[out] buffer Memory buffer that holds the contents of the file
+ * @param[out] length Length of the file in bytes
+ **/
+
+error_t readPemFile(const char_t *filename, char_t **buffer, size_t *length)
+{
+   int_t ret;
+   error_t error;
+   FILE *fp;
+
+   //Initialize output parameters
+   *buffer = NULL;
+   *length = 0;
+
+   //Start of exception handling block
+   do
+   {
+      //Open the specified file
+      fp = fopen(filename, "rb");
+
+      //Failed to open the file?
+      if(fp == NULL)
+      {
+         error = ERROR_OPEN_FAILED;
+         break;
+      }
+
+      //Jump to the end of the file
+      ret = fseek(fp, 0, SEEK_END);
+
+      //Any error to report?
+      if(ret != 0)
+      {
+         error = ERROR_FAILURE;
+         break;
+      }
+
+      //Retrieve the length of the file
+      *length = ftell(fp);
+      //Allocate a buffer to hold the contents of the file
+      *buffer = malloc(*length);
+
+      //Failed to allocate memory?
+      if(*buffer == NULL)
+      {
+         error = ERROR_OUT_OF_MEMORY;
+         break;
+      }
+
+      //Rewind to the beginning of the file
+      rewind(fp);
+      //Read file contents
+      ret = fread(*buffer, 1, *length, fp);
+
+      //Failed to read data?
+      if(ret != *length)
+      {
+         error = ERROR_READ_FAILED;
+         break;
+      }
+
+      //Successful processing
+      error = NO_ERROR;
+
+      //End of exception handling block
+   } while(0);
+
+   //Close file
+   if(fp != NULL)
+      fclose(fp);
+
+   //Any error to report?
+   if(error)
+   {
+      //Debug message
+      TRACE_ERROR("Error: Cannot load file %s\r\n", filename);
+      //Clean up side effects
+      free(*buffer);
+   }
+
+   //Return status code
+   return error;
+}
@@ -31,6 +31,7 @@
 #include <windows.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <ctype.h>
 #include <direct.h>
 #include <shlwapi.h>
 
@@ -55,6 +56,29 @@ typedef enum
 } tResType;
 
 
+/**
+ * @brief Resource flags (stored in the upper bits of the type field)
+ **/
+
+typedef enum
+{
+   RES_FLAG_GZIP   = 0x10,
+   RES_FLAG_TAG    = 0x20,
+   RES_FLAG_SORTED = 0x40,
+   RES_FLAG_INDEX  = 0x80
+} tResFlags;
+
+//Mask used to retrieve the type of an entry
+#define RES_TYPE_MASK 0x0F
+
+//Maximum length of a path stored in the hash index
+#define MAX_INDEX_PATH_LEN 255
+
+//Extension of precompressed files
+#define GZIP_EXT ".gz"
+#define GZIP_EXT_LEN 3
+
+
 /**
  * @brief Resource entry
  **/
@@ -79,10 +103,220 @@ typedef struct
    tResEntry rootEntry;
 } tResHeader;
 
+
+/**
+ * @brief Hash index descriptor (follows the resource header)
+ **/
+
+typedef struct
+{
+   unsigned long dataOffset;
+   unsigned long bucketCount;
+} tResIndex;
+
+
+/**
+ * @brief Hash index record
+ **/
+
+typedef struct
+{
+   unsigned long hash;
+   unsigned long entryOffset;
+   unsigned char pathLength;
+   char path[];
+} tResIndexEntry;
+
 //Restore previous settings for data aligment
 #pragma pack(pop)
 
 
+/**
+ * @brief File contents already stored in the resource data
+ **/
+
+typedef struct
+{
+   unsigned long offset;
+   unsigned long length;
+   unsigned long tag;
+} tBlob;
+
+
+//Alignment of the file data
+static unsigned long dataAlignment = 4;
+//Contents stored so far
+static tBlob *blobTable = NULL;
+static unsigned int blobCount = 0;
+static unsigned int blobMaxCount = 0;
+//Number of bytes saved by deduplication
+static unsigned long savedBytes = 0;
+
+
+/**
+ * @brief Directory entry collected before being sorted
+ **/
+
+typedef struct
+{
+   unsigned char type;
+   unsigned char nameLength;
+   char name[MAX_PATH];
+} tFileInfo;
+
+
+/**
+ * @brief Compute the content hash of a file (32-bit FNV-1a)
+ * @param[in] data Pointer to the file contents
+ * @param[in] length Length of the file
+ * @return Hash value
+ **/
+
+unsigned long computeTag(const unsigned char *data, unsigned long length)
+{
+   unsigned long i;
+   unsigned long h;
+
+   //FNV offset basis
+   h = 2166136261UL;
+
+   //Process the file contents
+   for(i = 0; i < length; i++)
+   {
+      //Mix in the current byte
+      h ^= data[i];
+      //Multiply by the FNV prime
+      h = (h * 16777619UL) & 0xFFFFFFFFUL;
+   }
+
+   //Return the resulting hash
+   return h;
+}
+
+
+/**
+ * @brief Compute the hash of a path (32-bit FNV-1a, case-insensitive)
+ * @param[in] path Path using / as separator
+ * @param[in] length Length of the path
+ * @return Hash value
+ **/
+
+unsigned long computePathHash(const char *path, unsigned long length)
+{
+   unsigned long i;
+   unsigned long h;
+
+   //FNV offset basis
+   h = 2166136261UL;
+
+   //Process the path
+   for(i = 0; i < length; i++)
+   {
+      //Mix in the current character (lowercase)
+      h ^= (unsigned char) tolower((unsigned char) path[i]);
+      //Multiply by the FNV prime
+      h = (h * 16777619UL) & 0xFFFFFFFFUL;
+   }
+
+   //Return the resulting hash
+   return h;
+}
+
+
+/**
+ * @brief Compare the names of two directory entries
+ *
+ * The names are compared case-insensitively, a name sorting before any
+ * longer name it is a prefix of. The resource manager relies on the same
+ * ordering to stop searching a directory early
+ *
+ * @param[in] a Pointer to the first entry
+ * @param[in] b Pointer to the second entry
+ * @return Comparison result
+ **/
+
+int compareFileInfo(const void *a, const void *b)
+{
+   int r;
+   const tFileInfo *p = (const tFileInfo *) a;
+   const tFileInfo *q = (const tFileInfo *) b;
+
+   //Compare the common part of the names
+   r = _strnicmp(p->name, q->name, min(p->nameLength, q->nameLength));
+
+   //The shorter name comes first when the common part is identical
+   if(!r)
+      r = (int) p->nameLength - (int) q->nameLength;
+
+   //Return comparison result
+   return r;
+}
+
+
+/**
+ * @brief Look for identical contents already stored in the resource data
+ * @param[in] data Pointer to the resource data
+ * @param[in] offset Offset of the contents to look for
+ * @param[in] length Length of the contents
+ * @param[in] tag Content hash
+ * @return Offset of the identical contents, or 0 if none
+ **/
+
+unsigned long findBlob(const unsigned char *data, unsigned long offset,
+   unsigned long length, unsigned long tag)
+{
+   unsigned int i;
+
+   //Loop through the contents stored so far
+   for(i = 0; i < blobCount; i++)
+   {
+      //The hash is checked first, then the data itself
+      if(blobTable[i].tag == tag && blobTable[i].length == length &&
+         !memcmp(data + blobTable[i].offset, data + offset, length))
+      {
+         return blobTable[i].offset;
+      }
+   }
+
+   //No identical contents found
+   return 0;
+}
+
+
+/**
+ * @brief Record the contents of a file
+ * @param[in] offset Offset of the contents
+ * @param[in] length Length of the contents
+ * @param[in] tag Content hash
+ * @return Status code
+ **/
+
+int addBlob(unsigned long offset, unsigned long length, unsigned long tag)
+{
+   tBlob *p;
+
+   //Grow the table if necessary
+   if(blobCount >= blobMaxCount)
+   {
+      //Double the capacity of the table
+      blobMaxCount = blobMaxCount ? (blobMaxCount * 2) : 64;
+      p = realloc(blobTable, blobMaxCount * sizeof(tBlob));
+      //Failed to allocate memory?
+      if(!p) return ERROR_FAILURE;
+      blobTable = p;
+   }
+
+   //Save the location of the contents
+   blobTable[blobCount].offset = offset;
+   blobTable[blobCount].length = length;
+   blobTable[blobCount].tag = tag;
+   blobCount++;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Add the contents of a file to the resource data
  * @param[in] filename Path to the filename
@@ -167,8 +401,16 @@ int addDirectory(unsigned long parentOffset, unsigned long parentSize,
    char path[MAX_PATH];
    char filename[MAX_PATH];
    unsigned int i;
+   unsigned int k;
    unsigned int pos;
+   unsigned int count;
+   unsigned int maxCount;
+   unsigned long mark;
+   unsigned long tag;
+   unsigned long duplicate;
    tResEntry *entry;
+   tFileInfo *info;
+   void *p;
    WIN32_FIND_DATA findFileData;
    HANDLE hFind;
 
@@ -190,52 +432,30 @@ int addDirectory(unsigned long parentOffset, unsigned long parentSize,
    if(hFind == INVALID_HANDLE_VALUE)
       return ERROR_OPEN_FAILED;
 
-   //Point to the location where to write the directory contents
-   i = pos;
-
-   //Check the actual size of the resource data
-   if((i + sizeof(tResEntry) + 1) >= maxSize)
+   //Allocate room for the entries of the directory
+   maxCount = 16;
+   info = malloc(maxCount * sizeof(tFileInfo));
+   //Failed to allocate memory?
+   if(!info)
    {
       FindClose(hFind);
-      return ERROR_FILE_TOO_LARGE;
+      return ERROR_FAILURE;
    }
 
    //Current directory
-   entry = (tResEntry *) (data + i);
-   entry->type = RES_TYPE_DIR;
-   entry->dataOffset = 0;
-   entry->dataLength = 0;
-   entry->nameLength = 1;
-   entry->name[0] = '.';
-
-   //Jump to the following entry
-   i += sizeof(tResEntry) + entry->nameLength;
-   //Update the length of the directory
-   *length += sizeof(tResEntry) + entry->nameLength;
+   info[0].type = RES_TYPE_DIR;
+   info[0].nameLength = 1;
+   strcpy(info[0].name, ".");
+   count = 1;
 
    //Add a link to the parent directory?
    if(parentOffset && parentSize)
    {
-      //Check the actual size of the resource data
-      if((i + sizeof(tResEntry) + 2) >= maxSize)
-      {
-         FindClose(hFind);
-         return ERROR_FILE_TOO_LARGE;
-      }
-
       //Parent directory
-      entry = (tResEntry *) (data + i);
-      entry->type = RES_TYPE_DIR;
-      entry->dataOffset = 0;
-      entry->dataLength = 0;
-      entry->nameLength = 2;
-      entry->name[0] = '.';
-      entry->name[1] = '.';
-
-      //Jump to the following entry
-      i += sizeof(tResEntry) + entry->nameLength;
-      //Update the length of the directory
-      *length += sizeof(tResEntry) + entry->nameLength;
+      info[1].type = RES_TYPE_DIR;
+      info[1].nameLength = 2;
+      strcpy(info[1].name, "..");
+      count = 2;
    }
 
    //Loop through directory entries
@@ -248,28 +468,85 @@ int addDirectory(unsigned long parentOffset, unsigned long parentSize,
       if(findFileData.dwFileAttributes & FILE_ATTRIBUTE_HIDDEN)
          continue;
 
+      //Make sure the name fits in an entry
+      if(strlen(findFileData.cFileName) > 255)
+      {
+         free(info);
+         FindClose(hFind);
+         return ERROR_FILENAME_EXCED_RANGE;
+      }
+
+      //Grow the array if necessary
+      if(count >= maxCount)
+      {
+         maxCount *= 2;
+         p = realloc(info, maxCount * sizeof(tFileInfo));
+         //Failed to allocate memory?
+         if(!p)
+         {
+            free(info);
+            FindClose(hFind);
+            return ERROR_FAILURE;
+         }
+         info = p;
+      }
+
+      //Save the entry
+      info[count].type = (findFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ? RES_TYPE_DIR : RES_TYPE_FILE;
+      info[count].nameLength = strlen(findFileData.cFileName);
+      strcpy(info[count].name, findFileData.cFileName);
+
+      //A file whose name ends with .gz is the gzip-compressed variant of
+      //the file without the extension. It is served as-is to the clients
+      //that accept gzip content-coding
+      if(info[count].type == RES_TYPE_FILE && info[count].nameLength > GZIP_EXT_LEN &&
+         !_strnicmp(info[count].name + info[count].nameLength - GZIP_EXT_LEN, GZIP_EXT, GZIP_EXT_LEN))
+      {
+         //Strip the extension and flag the entry
+         info[count].type |= RES_FLAG_GZIP;
+         info[count].nameLength -= GZIP_EXT_LEN;
+      }
+
+      //Next entry
+      count++;
+
+      //Get next file
+   } while(FindNextFile(hFind, &findFileData));
+
+   //Sort the entries by name, so that the resource manager does not have
+   //to scan the whole directory when looking for an entry
+   qsort(info, count, sizeof(tFileInfo), compareFileInfo);
+
+   //Point to the location where to write the directory contents
+   i = pos;
+
+   //Write the directory entries
+   for(k = 0; k < count; k++)
+   {
       //Make sure the maximum size is not exceeded
-      if((i + sizeof(tResEntry) + strlen(findFileData.cFileName)) >= maxSize)
+      if((i + sizeof(tResEntry) + info[k].nameLength) >= maxSize)
       {
+         free(info);
          FindClose(hFind);
          return ERROR_FILE_TOO_LARGE;
       }
 
       //Add a new entry
       entry = (tResEntry *) (data + i);
-      entry->type = (findFileData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) ? RES_TYPE_DIR : RES_TYPE_FILE;
+      entry->type = info[k].type;
       entry->dataOffset = 0;
       entry->dataLength = 0;
-      entry->nameLength = strlen(findFileData.cFileName);
-      strncpy(entry->name, findFileData.cFileName, entry->nameLength);
+      entry->nameLength = info[k].nameLength;
+      strncpy(entry->name, info[k].name, entry->nameLength);
 
       //Jump to the following entry
       i += sizeof(tResEntry) + entry->nameLength;
       //Update the length of the directory
       *length += sizeof(tResEntry) + entry->nameLength;
+   }
 
-      //Get next file
-   } while(FindNextFile(hFind, &findFileData));
+   //The entries have been copied
+   free(info);
 
    //Update the total size of the resource file
    ResHeader->totalSize += *length;
@@ -298,8 +575,30 @@ int addDirectory(unsigned long parentOffset, unsigned long parentSize,
       }
       else
       {
-         //Data must be aligned on 4-byte boundaries
-         ResHeader->totalSize = (ResHeader->totalSize + 3) / 4 * 4;
+         //Save the current size, in case the contents are a duplicate
+         mark = ResHeader->totalSize;
+
+         //The content hash of a file is stored just before its data
+         if(entry->type != RES_TYPE_DIR)
+         {
+            //Reserve room for the hash and align the file data on the
+            //requested boundary
+            ResHeader->totalSize = (ResHeader->totalSize + 4 + dataAlignment - 1) /
+               dataAlignment * dataAlignment;
+
+            //Make sure the maximum size is not exceeded
+            if(ResHeader->totalSize > maxSize)
+            {
+               FindClose(hFind);
+               return ERROR_FILE_TOO_LARGE;
+            }
+         }
+         else
+         {
+            //Directories are aligned on 4-byte boundaries
+            ResHeader->totalSize = (ResHeader->totalSize + 3) / 4 * 4;
+         }
+
          //Set data offset
          entry->dataOffset = ResHeader->totalSize;
 
@@ -307,6 +606,11 @@ int addDirectory(unsigned long parentOffset, unsigned long parentSize,
          strcpy(path, directory);
          strncpy(filename, entry->name, entry->nameLength);
          filename[entry->nameLength] = '\0';
+
+         //Restore the extension of precompressed files
+         if(entry->type & RES_FLAG_GZIP)
+            strcat(filename, GZIP_EXT);
+
          PathAppend(path, filename);
 
          //Check entry type
@@ -319,6 +623,38 @@ int addDirectory(unsigned long parentOffset, unsigned long parentSize,
          {
             //Add the contents of the file to the resource data
             error = addFile(path, data, maxSize, &entry->dataLength);
+
+            //Successful processing?
+            if(!error)
+            {
+               //Compute the content hash
+               tag = computeTag(data + entry->dataOffset, entry->dataLength);
+
+               //Store the content hash (little-endian) so that the HTTP
+               //server can generate entity tags
+               *((unsigned long *) (data + entry->dataOffset - 4)) = tag;
+               entry->type |= RES_FLAG_TAG;
+
+               //Look for identical contents stored by another entry
+               duplicate = findBlob(data, entry->dataOffset, entry->dataLength, tag);
+
+               //Duplicate found?
+               if(duplicate)
+               {
+                  //Both entries share the same data (and the same hash)
+                  entry->dataOffset = duplicate;
+                  //Update the number of bytes saved
+                  savedBytes += ResHeader->totalSize - mark;
+                  //Discard the copy
+                  memset(data + mark, 0, ResHeader->totalSize - mark);
+                  ResHeader->totalSize = mark;
+               }
+               else
+               {
+                  //Record the contents of the file
+                  error = addBlob(entry->dataOffset, entry->dataLength, tag);
+               }
+            }
          }
 
          //Any error to report?
@@ -337,6 +673,181 @@ int addDirectory(unsigned long parentOffset, unsigned long parentSize,
 }
 
 
+/**
+ * @brief Add the files of a directory to the hash index
+ * @param[in] data Pointer to the resource data
+ * @param[in] maxSize Maximum size of the resulting resource file
+ * @param[in] directory Directory to index
+ * @param[in] path Buffer holding the path to the directory
+ * @param[in] pathLength Length of the path to the directory
+ * @param[out] count Number of records added to the index
+ * @return Status code
+ **/
+
+int indexDirectory(unsigned char *data, unsigned long maxSize,
+   const tResEntry *directory, char *path, unsigned int pathLength, unsigned int *count)
+{
+   int error;
+   unsigned int n;
+   unsigned int length;
+   tResEntry *entry;
+   tResIndexEntry *record;
+
+   //Point to the header of the resource data
+   tResHeader *resHeader = (tResHeader *) data;
+
+   //Retrieve the length of the directory
+   n = directory->dataLength;
+   //Point to the first entry
+   entry = (tResEntry *) (data + directory->dataOffset);
+
+   //Loop through the directory
+   while(n > 0)
+   {
+      //Discard . and .. directories
+      if(entry->type != RES_TYPE_DIR || entry->name[0] != '.' ||
+         (entry->nameLength != 1 && (entry->nameLength != 2 || entry->name[1] != '.')))
+      {
+         //Length of the full path to the entry
+         length = pathLength + entry->nameLength;
+
+         //Make sure the path can be stored in the index
+         if(length > MAX_INDEX_PATH_LEN)
+            return ERROR_FILENAME_EXCED_RANGE;
+
+         //Append the name of the entry to the path
+         strncpy(path + pathLength, entry->name, entry->nameLength);
+
+         //Check entry type
+         if(entry->type == RES_TYPE_DIR)
+         {
+            //Append a separator
+            path[length] = '/';
+
+            //Recursively index the contents of the directory
+            error = indexDirectory(data, maxSize, entry, path, length + 1, count);
+            //Any error to report?
+            if(error) return error;
+         }
+         else
+         {
+            //Make sure the maximum size is not exceeded
+            if((resHeader->totalSize + sizeof(tResIndexEntry) + length) > maxSize)
+               return ERROR_FILE_TOO_LARGE;
+
+            //Add a new record. Each variant of a file gets its own record
+            record = (tResIndexEntry *) (data + resHeader->totalSize);
+            record->hash = computePathHash(path, length);
+            record->entryOffset = (unsigned char *) entry - data;
+            record->pathLength = length;
+            memcpy(record->path, path, length);
+
+            //Update the total size of the resource file
+            resHeader->totalSize += sizeof(tResIndexEntry) + length;
+            //Update the number of records
+            (*count)++;
+         }
+      }
+
+      //Remaining bytes to process
+      n -= sizeof(tResEntry) + entry->nameLength;
+      //Point to the next entry
+      entry = (tResEntry *) ((unsigned char *) entry + sizeof(tResEntry) + entry->nameLength);
+   }
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
+/**
+ * @brief Append a hash index of the file paths to the resource data
+ *
+ * The index maps the full path of each file (case-insensitive, / as
+ * separator, no leading separator) to its entry, so that the resource
+ * manager can resolve a path without walking the directories. Collisions
+ * are resolved by linear probing
+ *
+ * @param[in] data Pointer to the resource data
+ * @param[in] maxSize Maximum size of the resulting resource file
+ * @return Status code
+ **/
+
+int addIndex(unsigned char *data, unsigned long maxSize)
+{
+   int error;
+   char path[MAX_PATH];
+   unsigned int i;
+   unsigned int j;
+   unsigned int n;
+   unsigned int count;
+   unsigned long bucketCount;
+   unsigned long *bucket;
+   unsigned long start;
+   tResIndexEntry *record;
+   tResIndex *index;
+
+   //Point to the header of the resource data
+   tResHeader *resHeader = (tResHeader *) data;
+   //The index descriptor immediately follows the header
+   index = (tResIndex *) (data + sizeof(tResHeader));
+
+   //The records are written at the end of the resource data
+   start = resHeader->totalSize;
+   count = 0;
+
+   //Add a record for each file
+   error = indexDirectory(data, maxSize, &resHeader->rootEntry, path, 0, &count);
+   //Any error to report?
+   if(error) return error;
+
+   //Nothing to index?
+   if(!count) return NO_ERROR;
+
+   //Keep the load factor of the table below 50%
+   for(bucketCount = 2; bucketCount < (2 * count); bucketCount *= 2);
+
+   //The bucket table must be aligned on 4-byte boundaries
+   resHeader->totalSize = (resHeader->totalSize + 3) / 4 * 4;
+
+   //Make sure the maximum size is not exceeded
+   if((resHeader->totalSize + bucketCount * 4) > maxSize)
+      return ERROR_FILE_TOO_LARGE;
+
+   //Point to the bucket table
+   bucket = (unsigned long *) (data + resHeader->totalSize);
+   //Empty buckets are set to zero
+   memset(bucket, 0, bucketCount * 4);
+
+   //Insert the records in the table
+   for(i = start, n = 0; n < count; n++)
+   {
+      //Point to the current record
+      record = (tResIndexEntry *) (data + i);
+
+      //Look for a free bucket
+      for(j = record->hash & (bucketCount - 1); bucket[j] != 0; j = (j + 1) & (bucketCount - 1));
+      //Save the offset of the record
+      bucket[j] = i;
+
+      //Point to the next record
+      i += sizeof(tResIndexEntry) + record->pathLength;
+   }
+
+   //Fill in the index descriptor
+   index->dataOffset = resHeader->totalSize;
+   index->bucketCount = bucketCount;
+
+   //Update the total size of the resource file
+   resHeader->totalSize += bucketCount * 4;
+   //The resource data now carries an index
+   resHeader->rootEntry.type |= RES_FLAG_INDEX;
+
+   //Successful processing
+   return NO_ERROR;
+}
+
+
 /**
  * @brief Dump the contents of a directory
  * @param[in] directory Directory to dump
@@ -354,7 +865,7 @@ int dumpDirectory(const unsigned char *data, tResEntry *directory, unsigned int
    char filename[MAX_PATH];
 
    //Check entry type
-   if(directory->type != RES_TYPE_DIR)
+   if((directory->type & RES_TYPE_MASK) != RES_TYPE_DIR)
       return ERROR_FAILURE;
 
    //Retrieve the length of the directory
@@ -383,6 +894,12 @@ int dumpDirectory(const unsigned char *data, tResEntry *directory, unsigned int
       //Display filename
       if(entry->type == RES_TYPE_DIR)
          printf("[%s]\r\n", filename);
+      else if(entry->type & RES_FLAG_GZIP)
+         printf("%s (%u bytes, gzip, tag %08X)\r\n", filename, entry->dataLength,
+            *((unsigned long *) (data + entry->dataOffset - 4)));
+      else if(entry->type & RES_FLAG_TAG)
+         printf("%s (%u bytes, tag %08X)\r\n", filename, entry->dataLength,
+            *((unsigned long *) (data + entry->dataOffset - 4)));
       else
          printf("%s (%u bytes)\r\n", filename, entry->dataLength);
 
@@ -424,17 +941,20 @@ int main(int argc, char* argv[])
    const char *destFile;
    char *p;
    char *c;
+   unsigned long indexOffset;
    tResHeader *resHeader;
    FILE *fp;
 
    //Check parameters
-   if(argc != 3 && argc != 4)
+   if(argc < 3 || argc > 5)
    {
       //Print command syntax
-      printf("Usage: rc.exe input output [maxsize]\r\n");
+      printf("Usage: rc.exe input output [maxsize [alignment]]\r\n");
       printf("  - input:   Source directory to include in resource file\r\n");
+      printf("             (files ending with .gz are stored as precompressed variants)\r\n");
       printf("  - output:  Compiled resource file\r\n");
       printf("  - maxsize: Maximum size of the resource file\r\n");
+      printf("  - alignment: Alignment of the file data (power of two, 4 by default)\r\n");
       printf("Copyright (c) 2011-2012 Oryx Embedded\r\n");
       //Report an error
       return ERROR_FAILURE;
@@ -457,7 +977,17 @@ int main(int argc, char* argv[])
    //Destination resource file
    destFile = argv[2];
    //Maximum size of the resulting resource file
-   maxSize = (argc == 4) ? atoi(argv[3]) : (1024 * 1024);
+   maxSize = (argc >= 4) ? atoi(argv[3]) : (1024 * 1024);
+   //Alignment of the file data
+   dataAlignment = (argc == 5) ? atoi(argv[4]) : 4;
+
+   //The alignment must be a power of two, at least as large as the hash
+   if(dataAlignment < 4 || (dataAlignment & (dataAlignment - 1)))
+   {
+      printf("Error: Invalid alignment!\r\n");
+      //Report an error
+      return ERROR_FAILURE;
+   }
 
    //Allocate a memory buffer to hold the resulting data
    data = malloc(maxSize);
@@ -473,17 +1003,41 @@ int main(int argc, char* argv[])
    //Clear memory buffer
    memset(data, 0, maxSize);
 
-   //Initialize resource data header
+   //Initialize resource data header. Room is reserved for the index
+   //descriptor between the header and the root directory
    resHeader = (tResHeader *) data;
-   resHeader->totalSize = sizeof(tResHeader);
+   resHeader->totalSize = sizeof(tResHeader) + sizeof(tResIndex);
    resHeader->rootEntry.type = RES_TYPE_DIR;
-   resHeader->rootEntry.dataOffset = sizeof(tResHeader);
+   resHeader->rootEntry.dataOffset = sizeof(tResHeader) + sizeof(tResIndex);
    resHeader->rootEntry.dataLength = 0;
    resHeader->rootEntry.nameLength = 0;
 
    //Add the contents of the specified directory to the resource file
    error = addDirectory(0, 0, sourceDir, data, maxSize, &resHeader->rootEntry.dataLength);
 
+   //Successful processing?
+   if(!error)
+   {
+      //The entries of each directory are sorted by name
+      resHeader->rootEntry.type |= RES_FLAG_SORTED;
+
+      //Save the current size of the resource data
+      indexOffset = resHeader->totalSize;
+      //Append the hash index
+      error = addIndex(data, maxSize);
+
+      //The index is optional
+      if(error == ERROR_FILENAME_EXCED_RANGE)
+      {
+         //User message
+         printf("Warning: Path too long, no hash index generated!\r\n");
+         //Discard the partial index
+         memset(data + indexOffset, 0, resHeader->totalSize - indexOffset);
+         resHeader->totalSize = indexOffset;
+         error = NO_ERROR;
+      }
+   }
+
    //Any error to report?
    if(error == ERROR_FILE_TOO_LARGE)
    {
@@ -525,6 +1079,13 @@ int main(int argc, char* argv[])
    c = strchr(p, '.');
    if(c) *c = '\0';
 
+   //The offsets of the file data are only aligned if the array itself is
+   fprintf(fp, "#if defined(__ICCARM__)\n");
+   fprintf(fp, "#pragma data_alignment=%u\n", dataAlignment);
+   fprintf(fp, "#elif defined(__GNUC__) || defined(__ARMCC_VERSION)\n");
+   fprintf(fp, "__attribute__((aligned(%u)))\n", dataAlignment);
+   fprintf(fp, "#endif\n");
+
    //Write header
    fprintf(fp, "const unsigned char %s[] =\n", p);
    fprintf(fp, "{\n");
@@ -556,9 +1117,20 @@ int main(int argc, char* argv[])
 
    //Dump the contents of the resource file
    dumpDirectory(data, &resHeader->rootEntry, 0);
+
+   //Display the size of the hash index
+   if(resHeader->rootEntry.type & RES_FLAG_INDEX)
+      printf("\r\nHash index: %u buckets\r\n", ((tResIndex *) (data + sizeof(tResHeader)))->bucketCount);
    //User message
    printf("\r\n%u bytes successfully written !\r\n", resHeader->totalSize);
 
+   //Display the gain of deduplication
+   if(savedBytes > 0)
+      printf("%u bytes saved by sharing identical files\r\n", savedBytes);
+
+   //Release the table of contents
+   free(blobTable);
+
    //Release previoulsy allocated memory
    free(data);
 